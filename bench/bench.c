@@ -0,0 +1,128 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static bool json = false;
+static const char *filter = NULL;
+static volatile uint64_t sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+bool bench_init(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (NULL == filter && argv[i][0] != '-') {
+            filter = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--json] [NAME-FILTER]\n", argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool bench_run(const char *name, size_t bytes_per_op, BenchFn f, void *ctx) {
+    if (filter != NULL && strstr(name, filter) == NULL) {
+        return true;
+    }
+
+    // Doubles the number of iterations until a run is long enough to be
+    // timed reliably, which also warms up the caches.
+    size_t iterations = 1;
+    double elapsed_ns;
+    for (;;) {
+        const double start = now_ns();
+        if (!f(ctx, iterations)) {
+            fprintf(stderr, "%s: failed\n", name);
+            return false;
+        }
+        elapsed_ns = now_ns() - start;
+
+        if (elapsed_ns >= BENCH_ROUND_NS / 10) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    iterations = (size_t)((double)iterations * BENCH_ROUND_NS / elapsed_ns);
+    if (0 == iterations) {
+        iterations = 1;
+    }
+
+    double best_ns = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        const double start = now_ns();
+        if (!f(ctx, iterations)) {
+            fprintf(stderr, "%s: failed\n", name);
+            return false;
+        }
+
+        const double ns = (now_ns() - start) / (double)iterations;
+        if (0 == round || ns < best_ns) {
+            best_ns = ns;
+        }
+    }
+
+    const double ops_per_sec = 1e9 / best_ns;
+    const double mb_per_sec = (double)bytes_per_op * ops_per_sec / 1e6;
+
+    if (json) {
+        printf(
+            "{\"name\":\"%s\",\"iterations\":%zu,\"ns_per_op\":%.3f,"
+            "\"ops_per_sec\":%.1f,\"mb_per_sec\":%.3f}\n",
+            name, iterations, best_ns, ops_per_sec, mb_per_sec);
+    } else if (bytes_per_op > 0) {
+        printf(
+            "%-40s %12.1f ns/op %14.0f ops/s %10.1f MB/s\n", name, best_ns,
+            ops_per_sec, mb_per_sec);
+    } else {
+        printf("%-40s %12.1f ns/op %14.0f ops/s\n", name, best_ns, ops_per_sec);
+    }
+    fflush(stdout);
+
+    return true;
+}
+
+void bench_sink(uint64_t value) {
+    sink += value;
+}
+
+uint8_t *bench_read_file(const char *path, size_t *restrict len) {
+    FILE *fp = fopen(path, "rb");
+    if (NULL == fp) {
+        perror(path);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        goto cleanup;
+    }
+    const long size = ftell(fp);
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        goto cleanup;
+    }
+
+    if ((data = malloc(size > 0 ? (size_t)size : 1)) == NULL) {
+        goto cleanup;
+    }
+    if (fread(data, 1, (size_t)size, fp) != (size_t)size) {
+        free(data);
+        data = NULL;
+        goto cleanup;
+    }
+    *len = (size_t)size;
+
+cleanup:
+    fclose(fp);
+    return data;
+}
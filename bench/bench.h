@@ -0,0 +1,32 @@
+// A minimal micro-benchmark harness.
+//
+// Every benchmark is calibrated to run for about `BENCH_ROUND_NS`, and then
+// the fastest of `BENCH_ROUNDS` rounds is reported, which is the most stable
+// figure on a noisy machine.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_ROUND_NS 50000000.0
+#define BENCH_ROUNDS 5
+
+// Runs the measured operation `iterations` times. Returns false on failure.
+typedef bool (*BenchFn)(void *ctx, size_t iterations);
+
+// Parses the command-line options (`--json` and an optional name filter).
+// Returns false if they are malformed.
+bool bench_init(int argc, char *argv[]);
+
+// Measures `f` and prints a result line, unless `name` is filtered out.
+// `bytes_per_op` is used to report the throughput (zero if not applicable).
+// Returns false if `f` fails.
+bool bench_run(const char *name, size_t bytes_per_op, BenchFn f, void *ctx);
+
+// Keeps the computation of `value` from being optimized away.
+void bench_sink(uint64_t value);
+
+// Reads the whole file at `path`. Returns NULL on failure.
+uint8_t *bench_read_file(const char *path, size_t *restrict len);
@@ -0,0 +1,1021 @@
+// A load generator for RTSP servers: opens many sessions to a single URI from
+// several threads, runs the requests of a mix on every one of them, and counts
+// and validates the RTP they receive.
+//
+// Usage: smolrtsp-load [--json] [--sessions N] [--threads T] [--seconds S]
+//                      [--rate R] [--transport udp|tcp]
+//                      [--mix describe|setup|play] [--keepalive-ms MS] URI
+//
+// The mixes are:
+//
+//  - `describe`: connect, `DESCRIBE`, disconnect, and again.
+//  - `setup`: connect, `DESCRIBE`, `SETUP`, `TEARDOWN`, disconnect, and again.
+//  - `play`: connect, `DESCRIBE`, `SETUP`, `PLAY`, and keep receiving, with a
+//    `GET_PARAMETER` every `--keepalive-ms`.
+//
+// The sessions are opened at `--rate` per second in total. The handshake
+// latency is measured from `connect` to the last response of the mix, and the
+// keep-alive latency is the round trip of a `GET_PARAMETER`. Only the first
+// media of the description is set up. The RTP packets must be of version 2
+// and keep their SSRC; the gaps in their sequence numbers are counted as lost,
+// except for the packets arriving late, which are counted as reordered.
+//
+// Every session takes a socket (two with `--transport udp`), so raise
+// `ulimit -n` accordingly.
+
+#include <smolrtsp/latency_histogram.h>
+#include <smolrtsp/timer_wheel.h>
+#include <smolrtsp/types/header.h>
+#include <smolrtsp/types/method.h>
+#include <smolrtsp/types/request.h>
+#include <smolrtsp/types/response.h>
+#include <smolrtsp/types/rtp.h>
+#include <smolrtsp/util.h>
+#include <smolrtsp/writer.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_EVENTS 256
+#define RECV_BUFFER_SIZE (8 * 1024)
+#define REQUEST_BUFFER_SIZE 1024
+#define MAX_URI_SIZE 256
+#define MAX_SESSION_ID_SIZE 64
+
+// The time limit of a handshake, and the pause before a failed session is
+// opened again.
+#define HANDSHAKE_TIMEOUT_MS 10000
+#define RECONNECT_DELAY_MS 100
+
+#define INTERLEAVED_HEADER_SIZE 4
+
+typedef enum {
+    Mix_Describe,
+    Mix_Setup,
+    Mix_Play,
+} Mix;
+
+typedef struct {
+    bool json, udp;
+    Mix mix;
+    size_t sessions, threads;
+    double seconds, rate;
+    int keepalive_ms;
+    const char *uri;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+} Options;
+
+typedef enum {
+    // Waiting to be opened (again).
+    State_Idle,
+    State_Connecting,
+    State_Describing,
+    State_SettingUp,
+    State_Starting,
+    State_Playing,
+    State_TearingDown,
+} State;
+
+typedef struct {
+    uint64_t handshakes, failures, keepalives;
+    uint64_t packets, bytes, lost, reordered, invalid;
+    SmolRTSP_LatencyHistogram handshake_latency, keepalive_latency;
+} Totals;
+
+typedef struct Worker Worker;
+
+typedef struct {
+    Worker *worker;
+    int fd, rtp_fd;
+    State state;
+    SmolRTSP_Timer timer;
+
+    // The `CSeq` of the request awaiting its response and its send time.
+    uint32_t cseq;
+    uint64_t opened_ns, request_ns;
+    bool keepalive_pending;
+
+    char control[MAX_URI_SIZE];
+    char session_id[MAX_SESSION_ID_SIZE];
+
+    // The RTP stream seen so far.
+    bool has_rtp;
+    uint32_t ssrc;
+    uint16_t next_seq;
+
+    size_t in_len;
+    char in[RECV_BUFFER_SIZE];
+} Session;
+
+struct Worker {
+    const Options *options;
+    Session *sessions;
+    size_t sessions_count, opened_count;
+    double rate;
+
+    int epoll_fd;
+    SmolRTSP_TimerWheel *timers;
+    pthread_t thread;
+
+    Totals totals;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options);
+static bool resolve_uri(Options *options);
+static void *worker_routine(void *arg);
+static void open_session(Session *s);
+static void close_session(Session *s, bool failed);
+static void handle_events(Session *s, uint32_t events);
+static int handle_connected(Session *s);
+static int handle_input(Session *s);
+static int handle_response(Session *s, const SmolRTSP_Response *res);
+static void handle_rtp(Session *s, U8Slice99 packet);
+static int send_request(
+    Session *s, CharSlice99 method, CharSlice99 uri, CharSlice99 key,
+    CharSlice99 value);
+static int find_control(Session *s, const SmolRTSP_Response *res);
+static int open_rtp_socket(Session *s, uint16_t *port);
+static void merge_totals(Totals *self, const Totals *other);
+static void report(const Options *options, const Totals *totals);
+static CharSlice99 trim(CharSlice99 s);
+static uint64_t now_ns(void);
+
+#define Session_on_timer_CUSTOM ()
+static uint64_t Session_on_timer(VSelf, uint64_t now);
+
+impl(SmolRTSP_TimerHandler, Session);
+
+int main(int argc, char *argv[]) {
+    Options options = {
+        .json = false,
+        .udp = false,
+        .mix = Mix_Play,
+        .sessions = 100,
+        .threads = 1,
+        .seconds = 10,
+        .rate = 1000,
+        .keepalive_ms = 1000,
+        .uri = NULL,
+    };
+    if (!parse_options(argc, argv, &options) || !resolve_uri(&options)) {
+        return EXIT_FAILURE;
+    }
+
+    Worker *workers = calloc(options.threads, sizeof workers[0]);
+    Session *sessions = calloc(options.sessions, sizeof sessions[0]);
+    if (NULL == workers || NULL == sessions) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    size_t started = 0;
+    for (size_t i = 0; i < options.threads; i++) {
+        Worker *worker = &workers[i];
+        const size_t first = options.sessions * i / options.threads,
+                     last = options.sessions * (i + 1) / options.threads;
+
+        worker->options = &options;
+        worker->sessions = sessions + first;
+        worker->sessions_count = last - first;
+        worker->rate = options.rate / (double)options.threads;
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        worker->timers = SmolRTSP_TimerWheel_new(now_ns() / 1000000);
+        if (-1 == worker->epoll_fd || NULL == worker->timers) {
+            perror("epoll_create1");
+            break;
+        }
+
+        for (size_t j = 0; j < worker->sessions_count; j++) {
+            Session *s = &worker->sessions[j];
+            s->worker = worker;
+            s->fd = s->rtp_fd = -1;
+            s->state = State_Idle;
+            s->timer = SmolRTSP_Timer_new(
+                DYN(Session, SmolRTSP_TimerHandler, s));
+        }
+
+        if (pthread_create(&worker->thread, NULL, worker_routine, worker) !=
+            0) {
+            perror("pthread_create");
+            break;
+        }
+        started++;
+    }
+
+    Totals totals = {0};
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        merge_totals(&totals, &workers[i].totals);
+    }
+
+    if (started == options.threads) {
+        report(&options, &totals);
+    }
+
+    for (size_t i = 0; i < options.threads; i++) {
+        if (workers[i].timers != NULL) {
+            VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable)
+                .drop(workers[i].timers);
+        }
+        if (workers[i].epoll_fd > 0) {
+            close(workers[i].epoll_fd);
+        }
+    }
+    free(sessions);
+    free(workers);
+
+    return started == options.threads ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--json") == 0) {
+            options->json = true;
+        } else if (strcmp(argv[i], "--sessions") == 0 && has_value) {
+            options->sessions = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            options->threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+            options->seconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--rate") == 0 && has_value) {
+            options->rate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--keepalive-ms") == 0 && has_value) {
+            options->keepalive_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--transport") == 0 && has_value) {
+            const char *transport = argv[++i];
+            if (strcmp(transport, "udp") == 0) {
+                options->udp = true;
+            } else if (strcmp(transport, "tcp") == 0) {
+                options->udp = false;
+            } else {
+                goto usage;
+            }
+        } else if (strcmp(argv[i], "--mix") == 0 && has_value) {
+            const char *mix = argv[++i];
+            if (strcmp(mix, "describe") == 0) {
+                options->mix = Mix_Describe;
+            } else if (strcmp(mix, "setup") == 0) {
+                options->mix = Mix_Setup;
+            } else if (strcmp(mix, "play") == 0) {
+                options->mix = Mix_Play;
+            } else {
+                goto usage;
+            }
+        } else if (argv[i][0] != '-' && NULL == options->uri) {
+            options->uri = argv[i];
+        } else {
+            goto usage;
+        }
+    }
+
+    if (options->uri != NULL && strlen(options->uri) < MAX_URI_SIZE &&
+        options->sessions > 0 && options->threads > 0 &&
+        options->threads <= options->sessions && options->seconds > 0 &&
+        options->rate > 0 && options->keepalive_ms >= 0) {
+        return true;
+    }
+
+usage:
+    fprintf(
+        stderr,
+        "Usage: %s [--json] [--sessions N] [--threads T] [--seconds S] "
+        "[--rate R]\n"
+        "       [--transport udp|tcp] [--mix describe|setup|play] "
+        "[--keepalive-ms MS] URI\n",
+        argv[0]);
+    return false;
+}
+
+// Resolves the host of `rtsp://host[:port][/path]`.
+static bool resolve_uri(Options *options) {
+    const char *scheme = "rtsp://";
+    if (strncmp(options->uri, scheme, strlen(scheme)) != 0) {
+        fprintf(stderr, "%s: not an rtsp:// URI\n", options->uri);
+        return false;
+    }
+
+    const char *authority = options->uri + strlen(scheme);
+    const size_t authority_len = strcspn(authority, "/");
+    char host[MAX_URI_SIZE], port[8] = "554";
+    if (authority_len >= sizeof host) {
+        return false;
+    }
+    memcpy(host, authority, authority_len);
+    host[authority_len] = '\0';
+
+    char *colon = strrchr(host, ':');
+    if (colon != NULL && NULL == strchr(colon, ']')) {
+        snprintf(port, sizeof port, "%s", colon + 1);
+        *colon = '\0';
+    }
+    if ('[' == host[0]) {
+        memmove(host, host + 1, strlen(host));
+        host[strcspn(host, "]")] = '\0';
+    }
+
+    const struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *info;
+    const int error = getaddrinfo(host, port, &hints, &info);
+    if (error != 0) {
+        fprintf(stderr, "%s: %s\n", host, gai_strerror(error));
+        return false;
+    }
+
+    memcpy(&options->addr, info->ai_addr, info->ai_addrlen);
+    options->addr_len = info->ai_addrlen;
+    freeaddrinfo(info);
+
+    return true;
+}
+
+static void *worker_routine(void *arg) {
+    Worker *worker = arg;
+    const Options *options = worker->options;
+
+    const uint64_t start_ns = now_ns(),
+                   deadline_ns = start_ns + (uint64_t)(options->seconds * 1e9);
+    static __thread uint8_t datagram[64 * 1024];
+
+    for (uint64_t now = start_ns; now < deadline_ns; now = now_ns()) {
+        // Opens the sessions due at the rate.
+        const double elapsed = (double)(now - start_ns) / 1e9;
+        size_t due = (size_t)(elapsed * worker->rate) + 1;
+        if (due > worker->sessions_count) {
+            due = worker->sessions_count;
+        }
+        while (worker->opened_count < due) {
+            open_session(&worker->sessions[worker->opened_count++]);
+        }
+
+        SmolRTSP_TimerWheel_advance(worker->timers, now / 1000000);
+
+        struct epoll_event events[MAX_EVENTS];
+        const int n = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, 1);
+        for (int i = 0; i < n; i++) {
+            // The index of the session and whether it is the RTP socket.
+            const uint64_t data = events[i].data.u64;
+            Session *s = &worker->sessions[data >> 1];
+            const bool rtp = data & 1;
+
+            if (!rtp) {
+                handle_events(s, events[i].events);
+                continue;
+            }
+
+            ssize_t len;
+            while (s->rtp_fd != -1 &&
+                   (len = recv(
+                        s->rtp_fd, datagram, sizeof datagram, MSG_DONTWAIT)) >
+                       0) {
+                handle_rtp(s, U8Slice99_new(datagram, (size_t)len));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < worker->opened_count; i++) {
+        Session *s = &worker->sessions[i];
+        // The sessions still in the middle of a mix are neither succeeded nor
+        // failed.
+        SmolRTSP_TimerWheel_cancel(worker->timers, &s->timer);
+        if (s->fd != -1) {
+            close(s->fd);
+        }
+        if (s->rtp_fd != -1) {
+            close(s->rtp_fd);
+        }
+    }
+
+    return NULL;
+}
+
+// Connects `s` to the server; the failures are retried after a pause.
+static void open_session(Session *s) {
+    Worker *worker = s->worker;
+    const Options *options = worker->options;
+
+    s->fd = socket(
+        options->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        0);
+    if (-1 == s->fd) {
+        goto fail;
+    }
+
+    s->opened_ns = now_ns();
+    if (connect(s->fd, (const struct sockaddr *)&options->addr,
+                options->addr_len) == -1 &&
+        errno != EINPROGRESS) {
+        goto fail;
+    }
+
+    const uint64_t index = (uint64_t)(s - worker->sessions);
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT,
+        .data.u64 = index << 1,
+    };
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, s->fd, &event) == -1) {
+        goto fail;
+    }
+
+    s->state = State_Connecting;
+    s->cseq = 0;
+    s->keepalive_pending = false;
+    s->session_id[0] = '\0';
+    s->has_rtp = false;
+    s->in_len = 0;
+    SmolRTSP_TimerWheel_schedule(
+        worker->timers, &s->timer, HANDSHAKE_TIMEOUT_MS);
+    return;
+
+fail:
+    if (s->fd != -1) {
+        close(s->fd);
+        s->fd = -1;
+    }
+    worker->totals.failures++;
+    s->state = State_Idle;
+    SmolRTSP_TimerWheel_schedule(
+        worker->timers, &s->timer, RECONNECT_DELAY_MS);
+}
+
+// Closes the sockets of `s` and opens it again: at once after a completed
+// mix, or after a pause if `failed`.
+static void close_session(Session *s, bool failed) {
+    Worker *worker = s->worker;
+
+    if (s->fd != -1) {
+        close(s->fd);
+        s->fd = -1;
+    }
+    if (s->rtp_fd != -1) {
+        close(s->rtp_fd);
+        s->rtp_fd = -1;
+    }
+
+    s->state = State_Idle;
+    if (failed) {
+        worker->totals.failures++;
+    }
+
+    SmolRTSP_TimerWheel_cancel(worker->timers, &s->timer);
+    SmolRTSP_TimerWheel_schedule(
+        worker->timers, &s->timer, failed ? RECONNECT_DELAY_MS : 0);
+}
+
+static uint64_t Session_on_timer(VSelf, uint64_t now) {
+    VSELF(Session);
+    (void)now;
+
+    const Options *options = self->worker->options;
+
+    switch (self->state) {
+    case State_Idle:
+        open_session(self);
+        return 0;
+    case State_Playing:
+        // The previous keep-alive has not been answered for a whole period.
+        if (self->keepalive_pending) {
+            close_session(self, true);
+            return 0;
+        }
+
+        if (send_request(
+                self, SMOLRTSP_METHOD_GET_PARAMETER,
+                CharSlice99_from_str((char *)options->uri),
+                SMOLRTSP_HEADER_SESSION,
+                CharSlice99_from_str(self->session_id)) == -1) {
+            close_session(self, true);
+            return 0;
+        }
+        self->keepalive_pending = true;
+        return (uint64_t)options->keepalive_ms;
+    default:
+        // The handshake has timed out.
+        close_session(self, true);
+        return 0;
+    }
+}
+
+static void handle_events(Session *s, uint32_t events) {
+    int ret = 0;
+    if (State_Connecting == s->state && (events & (EPOLLOUT | EPOLLERR))) {
+        ret = handle_connected(s);
+    } else if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ret = handle_input(s);
+    }
+
+    if (-1 == ret) {
+        close_session(s, true);
+    }
+}
+
+static int handle_connected(Session *s) {
+    Worker *worker = s->worker;
+
+    int error = 0;
+    socklen_t error_len = sizeof error;
+    if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1 ||
+        error != 0) {
+        return -1;
+    }
+
+    const uint64_t index = (uint64_t)(s - worker->sessions);
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = index << 1};
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, s->fd, &event) == -1) {
+        return -1;
+    }
+
+    s->state = State_Describing;
+    return send_request(
+        s, SMOLRTSP_METHOD_DESCRIBE,
+        CharSlice99_from_str((char *)worker->options->uri),
+        SMOLRTSP_HEADER_ACCEPT, CharSlice99_from_str("application/sdp"));
+}
+
+// Handles the responses and the interleaved frames received.
+static int handle_input(Session *s) {
+    for (;;) {
+        const ssize_t n =
+            read(s->fd, s->in + s->in_len, sizeof s->in - s->in_len);
+        if (n < 0) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                return 0;
+            }
+            return EINTR == errno ? 0 : -1;
+        }
+        if (0 == n) {
+            return -1;
+        }
+        s->in_len += (size_t)n;
+
+        size_t offset = 0;
+        while (offset < s->in_len) {
+            const char *data = s->in + offset;
+            const size_t len = s->in_len - offset;
+
+            if ('$' == data[0]) {
+                if (len < INTERLEAVED_HEADER_SIZE) {
+                    break;
+                }
+
+                uint8_t channel_id = 0;
+                uint16_t payload_len = 0;
+                smolrtsp_parse_interleaved_header(
+                    (const uint8_t *)data, &channel_id, &payload_len);
+                if (len < INTERLEAVED_HEADER_SIZE + (size_t)payload_len) {
+                    break;
+                }
+
+                // Only the RTP channel of the track; RTCP is ignored.
+                if (0 == channel_id) {
+                    handle_rtp(
+                        s, U8Slice99_new(
+                               (uint8_t *)data + INTERLEAVED_HEADER_SIZE,
+                               payload_len));
+                }
+                offset += INTERLEAVED_HEADER_SIZE + (size_t)payload_len;
+                continue;
+            }
+
+            SmolRTSP_Response res = SmolRTSP_Response_uninit();
+            const SmolRTSP_ParseResult ret = SmolRTSP_Response_parse(
+                &res, CharSlice99_new((char *)data, len));
+
+            size_t consumed = 0;
+            match(ret) {
+                of(SmolRTSP_ParseResult_Success, status) {
+                    match(*status) {
+                        of(SmolRTSP_ParseStatus_Complete, complete_len) {
+                            consumed = *complete_len;
+                        }
+                        otherwise {}
+                    }
+                }
+                of(SmolRTSP_ParseResult_Failure, error) {
+                    (void)error;
+                    return -1;
+                }
+            }
+
+            if (0 == consumed) {
+                break;
+            }
+            if (handle_response(s, &res) == -1) {
+                return -1;
+            }
+            if (State_Idle == s->state) {
+                // The mix is complete and the session is closed.
+                return 0;
+            }
+            offset += consumed;
+        }
+
+        // A message that does not fit into the buffer.
+        if (0 == offset && s->in_len == sizeof s->in) {
+            return -1;
+        }
+        memmove(s->in, s->in + offset, s->in_len - offset);
+        s->in_len -= offset;
+    }
+}
+
+static int handle_response(Session *s, const SmolRTSP_Response *res) {
+    Worker *worker = s->worker;
+    const Options *options = worker->options;
+    Totals *totals = &worker->totals;
+
+    const uint64_t now = now_ns();
+    const uint64_t latency_us = (now - s->request_ns) / 1000,
+                   handshake_us = (now - s->opened_ns) / 1000;
+
+    if (res->cseq != s->cseq || res->start_line.code < 200 ||
+        res->start_line.code >= 300) {
+        return -1;
+    }
+
+    const CharSlice99 uri = CharSlice99_from_str((char *)options->uri);
+
+    switch (s->state) {
+    case State_Describing:
+        if (Mix_Describe == options->mix) {
+            totals->handshakes++;
+            SmolRTSP_LatencyHistogram_record(
+                &totals->handshake_latency, handshake_us);
+            close_session(s, false);
+            return 0;
+        }
+
+        if (find_control(s, res) == -1) {
+            return -1;
+        }
+
+        char transport[64];
+        if (options->udp) {
+            uint16_t port;
+            if (open_rtp_socket(s, &port) == -1) {
+                return -1;
+            }
+            snprintf(
+                transport, sizeof transport,
+                "RTP/AVP;unicast;client_port=%u-%u", port, port + 1);
+        } else {
+            snprintf(
+                transport, sizeof transport,
+                "RTP/AVP/TCP;unicast;interleaved=0-1");
+        }
+
+        s->state = State_SettingUp;
+        return send_request(
+            s, SMOLRTSP_METHOD_SETUP, CharSlice99_from_str(s->control),
+            SMOLRTSP_HEADER_TRANSPORT, CharSlice99_from_str(transport));
+    case State_SettingUp: {
+        CharSlice99 session;
+        if (!SmolRTSP_HeaderMap_find(
+                &res->header_map, SMOLRTSP_HEADER_SESSION, &session)) {
+            return -1;
+        }
+
+        // Without the parameters, such as `;timeout=60`.
+        const char *semicolon = memchr(session.ptr, ';', session.len);
+        if (semicolon != NULL) {
+            session.len = (size_t)(semicolon - session.ptr);
+        }
+        session = trim(session);
+        if (0 == session.len || session.len >= sizeof s->session_id) {
+            return -1;
+        }
+        memcpy(s->session_id, session.ptr, session.len);
+        s->session_id[session.len] = '\0';
+
+        const CharSlice99 id = CharSlice99_from_str(s->session_id);
+        if (Mix_Setup == options->mix) {
+            totals->handshakes++;
+            SmolRTSP_LatencyHistogram_record(
+                &totals->handshake_latency, handshake_us);
+            s->state = State_TearingDown;
+            return send_request(
+                s, SMOLRTSP_METHOD_TEARDOWN, uri, SMOLRTSP_HEADER_SESSION, id);
+        }
+
+        s->state = State_Starting;
+        return send_request(
+            s, SMOLRTSP_METHOD_PLAY, uri, SMOLRTSP_HEADER_SESSION, id);
+    }
+    case State_Starting:
+        totals->handshakes++;
+        SmolRTSP_LatencyHistogram_record(
+            &totals->handshake_latency, handshake_us);
+
+        s->state = State_Playing;
+        SmolRTSP_TimerWheel_cancel(worker->timers, &s->timer);
+        if (options->keepalive_ms > 0) {
+            SmolRTSP_TimerWheel_schedule(
+                worker->timers, &s->timer, (uint64_t)options->keepalive_ms);
+        }
+        return 0;
+    case State_Playing:
+        if (!s->keepalive_pending) {
+            return -1;
+        }
+        s->keepalive_pending = false;
+        totals->keepalives++;
+        SmolRTSP_LatencyHistogram_record(
+            &totals->keepalive_latency, latency_us);
+        return 0;
+    case State_TearingDown:
+        close_session(s, false);
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static void handle_rtp(Session *s, U8Slice99 packet) {
+    Totals *totals = &s->worker->totals;
+
+    const size_t len = packet.len;
+    SmolRTSP_RtpHeader header;
+    if (SmolRTSP_RtpHeader_parse(&packet, &header) == -1) {
+        totals->invalid++;
+        return;
+    }
+
+    const uint32_t ssrc = ntohl(header.ssrc);
+    const uint16_t seq = ntohs(header.sequence_number);
+
+    if (s->has_rtp && ssrc != s->ssrc) {
+        // Another stream, which restarts the sequence.
+        totals->invalid++;
+        s->has_rtp = false;
+    }
+
+    if (!s->has_rtp) {
+        s->has_rtp = true;
+        s->ssrc = ssrc;
+    } else {
+        const int16_t gap = (int16_t)(seq - s->next_seq);
+        if (gap > 0) {
+            totals->lost += (uint64_t)gap;
+        } else if (gap < 0) {
+            // A late packet, counted as lost when its successor arrived.
+            totals->reordered++;
+            if (totals->lost > 0) {
+                totals->lost--;
+            }
+            totals->packets++;
+            totals->bytes += len;
+            return;
+        }
+    }
+
+    s->next_seq = (uint16_t)(seq + 1);
+    totals->packets++;
+    totals->bytes += len;
+}
+
+static int send_request(
+    Session *s, CharSlice99 method, CharSlice99 uri, CharSlice99 key,
+    CharSlice99 value) {
+    SmolRTSP_Request req = {
+        .start_line =
+            {
+                .method = method,
+                .uri = uri,
+                .version = {.major = 1, .minor = 0},
+            },
+        .header_map = SmolRTSP_HeaderMap_empty(),
+        .body = SmolRTSP_MessageBody_empty(),
+        .cseq = ++s->cseq,
+    };
+    SmolRTSP_HeaderMap_append(&req.header_map, (SmolRTSP_Header){key, value});
+
+    char buffer[REQUEST_BUFFER_SIZE];
+    SmolRTSP_StringBuffer out =
+        SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+    if (SmolRTSP_Request_serialize(&req, smolrtsp_string_buffer_writer(&out)) <
+        0) {
+        return -1;
+    }
+
+    // A request is much smaller than the send buffer of a fresh socket, so a
+    // partial write means the server does not keep up.
+    const CharSlice99 data = SmolRTSP_StringBuffer_as_slice(&out);
+    s->request_ns = now_ns();
+    return write(s->fd, data.ptr, data.len) == (ssize_t)data.len ? 0 : -1;
+}
+
+// Finds the control URI of the first media of the description `res`.
+static int find_control(Session *s, const SmolRTSP_Response *res) {
+    const char *uri = s->worker->options->uri;
+
+    CharSlice99 base;
+    if (!SmolRTSP_HeaderMap_find(
+            &res->header_map, SMOLRTSP_HEADER_CONTENT_BASE, &base)) {
+        base = CharSlice99_from_str((char *)uri);
+    }
+
+    CharSlice99 control = CharSlice99_empty();
+    bool in_media = false;
+
+    CharSlice99 sdp = res->body;
+    while (sdp.len > 0) {
+        const char *eol = memchr(sdp.ptr, '\n', sdp.len);
+        const size_t line_len = eol != NULL ? (size_t)(eol - sdp.ptr + 1)
+                                            : sdp.len;
+        const CharSlice99 line =
+            trim(CharSlice99_new(sdp.ptr, line_len));
+        sdp = CharSlice99_advance(sdp, line_len);
+
+        if (CharSlice99_primitive_starts_with(
+                line, CharSlice99_from_str("m="))) {
+            if (in_media) {
+                break;
+            }
+            in_media = true;
+        } else if (
+            in_media && CharSlice99_primitive_starts_with(
+                            line, CharSlice99_from_str("a=control:"))) {
+            control = CharSlice99_advance(line, sizeof("a=control:") - 1);
+        }
+    }
+
+    if (!in_media) {
+        return -1;
+    }
+
+    int len;
+    if (0 == control.len || (1 == control.len && '*' == control.ptr[0])) {
+        len = snprintf(
+            s->control, sizeof s->control, "%.*s", (int)base.len, base.ptr);
+    } else if (CharSlice99_primitive_starts_with(
+                   control, CharSlice99_from_str("rtsp://"))) {
+        len = snprintf(
+            s->control, sizeof s->control, "%.*s", (int)control.len,
+            control.ptr);
+    } else {
+        const bool slash = base.len > 0 && '/' == base.ptr[base.len - 1];
+        len = snprintf(
+            s->control, sizeof s->control, "%.*s%s%.*s", (int)base.len,
+            base.ptr, slash ? "" : "/", (int)control.len, control.ptr);
+    }
+
+    return len > 0 && (size_t)len < sizeof s->control ? 0 : -1;
+}
+
+// Binds a socket for the RTP of `s` and watches it.
+static int open_rtp_socket(Session *s, uint16_t *port) {
+    Worker *worker = s->worker;
+    const int family = worker->options->addr.ss_family;
+
+    s->rtp_fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (-1 == s->rtp_fd) {
+        return -1;
+    }
+
+    struct sockaddr_storage addr = {.ss_family = family};
+    socklen_t addr_len = AF_INET6 == family ? sizeof(struct sockaddr_in6)
+                                            : sizeof(struct sockaddr_in);
+    if (bind(s->rtp_fd, (const struct sockaddr *)&addr, addr_len) == -1 ||
+        getsockname(s->rtp_fd, (struct sockaddr *)&addr, &addr_len) == -1) {
+        return -1;
+    }
+    *port = ntohs(
+        AF_INET6 == family ? ((const struct sockaddr_in6 *)&addr)->sin6_port
+                           : ((const struct sockaddr_in *)&addr)->sin_port);
+
+    const uint64_t index = (uint64_t)(s - worker->sessions);
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = index << 1 | 1};
+    return epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, s->rtp_fd, &event);
+}
+
+static void merge_totals(Totals *self, const Totals *other) {
+    self->handshakes += other->handshakes;
+    self->failures += other->failures;
+    self->keepalives += other->keepalives;
+    self->packets += other->packets;
+    self->bytes += other->bytes;
+    self->lost += other->lost;
+    self->reordered += other->reordered;
+    self->invalid += other->invalid;
+    SmolRTSP_LatencyHistogram_merge(
+        &self->handshake_latency, &other->handshake_latency);
+    SmolRTSP_LatencyHistogram_merge(
+        &self->keepalive_latency, &other->keepalive_latency);
+}
+
+static void report(const Options *options, const Totals *totals) {
+    static const char *const mixes[] = {"describe", "setup", "play"};
+    static const double percentiles[] = {50, 90, 99, 99.9};
+
+    const SmolRTSP_LatencyHistogram *handshake = &totals->handshake_latency,
+                                    *keepalive = &totals->keepalive_latency;
+    uint64_t handshake_us[4], keepalive_us[4];
+    for (size_t i = 0; i < 4; i++) {
+        handshake_us[i] = SmolRTSP_LatencyHistogram_value_at_percentile(
+            handshake, percentiles[i]);
+        keepalive_us[i] = SmolRTSP_LatencyHistogram_value_at_percentile(
+            keepalive, percentiles[i]);
+    }
+
+    const double expected = (double)(totals->packets + totals->lost),
+                 loss_percent =
+                     expected > 0 ? (double)totals->lost * 100 / expected : 0,
+                 mbit_per_sec =
+                     (double)totals->bytes * 8 / options->seconds / 1e6;
+    const char *transport = options->udp ? "udp" : "tcp";
+
+    if (options->json) {
+        printf(
+            "{\"name\":\"load/%s\",\"transport\":\"%s\",\"sessions\":%zu,"
+            "\"threads\":%zu,\"seconds\":%.3f,\"handshakes\":%llu,"
+            "\"handshakes_per_sec\":%.1f,\"failures\":%llu,"
+            "\"handshake_us\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+            "\"p999\":%llu,\"max\":%llu},\"keepalives\":%llu,"
+            "\"keepalive_us\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+            "\"p999\":%llu,\"max\":%llu},\"packets\":%llu,"
+            "\"mbit_per_sec\":%.3f,\"lost\":%llu,\"loss_percent\":%.4f,"
+            "\"reordered\":%llu,\"invalid\":%llu}\n",
+            mixes[options->mix], transport, options->sessions,
+            options->threads, options->seconds,
+            (unsigned long long)totals->handshakes,
+            (double)totals->handshakes / options->seconds,
+            (unsigned long long)totals->failures,
+            (unsigned long long)handshake_us[0],
+            (unsigned long long)handshake_us[1],
+            (unsigned long long)handshake_us[2],
+            (unsigned long long)handshake_us[3],
+            (unsigned long long)handshake->max_us,
+            (unsigned long long)totals->keepalives,
+            (unsigned long long)keepalive_us[0],
+            (unsigned long long)keepalive_us[1],
+            (unsigned long long)keepalive_us[2],
+            (unsigned long long)keepalive_us[3],
+            (unsigned long long)keepalive->max_us,
+            (unsigned long long)totals->packets, mbit_per_sec,
+            (unsigned long long)totals->lost, loss_percent,
+            (unsigned long long)totals->reordered,
+            (unsigned long long)totals->invalid);
+    } else {
+        printf(
+            "load/%s (%s, %zu sessions, %zu threads): %llu handshakes "
+            "(%.1f/s), %llu failures\n"
+            "  handshake: p50 %llu us, p90 %llu us, p99 %llu us, p99.9 %llu "
+            "us, max %llu us\n"
+            "  keep-alive: %llu, p50 %llu us, p99 %llu us, max %llu us\n"
+            "  media: %llu packets, %.1f Mbit/s, %llu lost (%.4f%%), %llu "
+            "reordered, %llu invalid\n",
+            mixes[options->mix], transport, options->sessions,
+            options->threads, (unsigned long long)totals->handshakes,
+            (double)totals->handshakes / options->seconds,
+            (unsigned long long)totals->failures,
+            (unsigned long long)handshake_us[0],
+            (unsigned long long)handshake_us[1],
+            (unsigned long long)handshake_us[2],
+            (unsigned long long)handshake_us[3],
+            (unsigned long long)handshake->max_us,
+            (unsigned long long)totals->keepalives,
+            (unsigned long long)keepalive_us[0],
+            (unsigned long long)keepalive_us[2],
+            (unsigned long long)keepalive->max_us,
+            (unsigned long long)totals->packets, mbit_per_sec,
+            (unsigned long long)totals->lost, loss_percent,
+            (unsigned long long)totals->reordered,
+            (unsigned long long)totals->invalid);
+    }
+    fflush(stdout);
+}
+
+static CharSlice99 trim(CharSlice99 s) {
+    while (s.len > 0 && isspace((unsigned char)s.ptr[0])) {
+        s = CharSlice99_advance(s, 1);
+    }
+    while (s.len > 0 && isspace((unsigned char)s.ptr[s.len - 1])) {
+        s.len--;
+    }
+    return s;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,617 @@
+// An end-to-end streaming benchmark: streams `examples/media/video.h264` and
+// `examples/media/audio.g711a` through `SmolRTSP_NalTransport` and
+// `SmolRTSP_RtpTransport` to local sinks as fast as possible, first to UDP
+// sinks and then to TCP-interleaved sinks.
+//
+// Usage: smolrtsp-loopback [--json] [--sinks N] [--seconds S] [--gso]
+//                          [--zerocopy]
+//
+// The CPU time is that of the sending thread only; the sinks are drained by
+// another thread. The sent throughput counts the RTP packets; the received one
+// also counts the interleaved headers of TCP, and misses the datagrams dropped
+// by UDP. On the loopback interface, `MSG_ZEROCOPY` falls back to
+// copying, so `--zerocopy` measures its overhead rather than its gain.
+
+#include "bench.h"
+
+#include <smolrtsp/nal_splitter.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BENCH_VIDEO_PATH
+#define BENCH_VIDEO_PATH "examples/media/video.h264"
+#endif
+
+#ifndef BENCH_AUDIO_PATH
+#define BENCH_AUDIO_PATH "examples/media/audio.g711a"
+#endif
+
+#define VIDEO_PAYLOAD_TY 96
+#define VIDEO_CLOCK_RATE 90000
+#define VIDEO_FPS 25
+
+#define AUDIO_PAYLOAD_TY 8 // PCMA
+#define AUDIO_CLOCK_RATE 8000
+// 20 milliseconds of G.711.
+#define AUDIO_PACKET_SIZE 160
+
+#define SINK_RCVBUF (4 * 1024 * 1024)
+#define ZEROCOPY_THRESHOLD 1000
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+// The allocations of the library and the benchmark, counted by wrapping the
+// allocator at link time (`-Wl,--wrap=malloc`, etc.).
+static uint64_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t allocations_count(void) {
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+#else
+
+static uint64_t allocations_count(void) {
+    return 0;
+}
+
+#endif // BENCH_COUNT_ALLOCATIONS
+
+typedef struct {
+    bool json, gso, zerocopy;
+    size_t sinks;
+    double seconds;
+} Options;
+
+typedef struct {
+    // The NAL units point into `video`.
+    uint8_t *video;
+    SmolRTSP_NalUnit *nalus;
+    size_t nalus_count;
+    U8Slice99 audio;
+} Media;
+
+// A consumer of one video and one audio stream.
+typedef struct {
+    // The UDP sinks have a socket pair per stream; the TCP sinks have a single
+    // connection in `video_fds`, with the audio on the second channel.
+    int video_fds[2], audio_fds[2];
+    SmolRTSP_ZeroCopyState video_zerocopy, audio_zerocopy;
+    SmolRTSP_NalTransport *video;
+    SmolRTSP_RtpTransport *audio;
+} Sink;
+
+typedef struct {
+    Sink *sinks;
+    size_t sinks_count;
+    bool stop;
+    uint64_t received_bytes;
+} Drain;
+
+typedef struct {
+    uint64_t frames, allocations, errors;
+    double wall_ns, cpu_ns;
+} Run;
+
+static bool parse_options(int argc, char *argv[], Options *options);
+static bool load_media(Media *media);
+static bool open_udp_sink(Sink *sink, const Options *options);
+static bool open_tcp_sink(Sink *sink);
+static void close_sink(Sink *sink);
+static int udp_socket_pair(int fds[2]);
+static void *drain(void *arg);
+static void
+stream(const Media *media, Sink *sinks, const Options *options, Run *run);
+static void report(
+    const char *name, const Sink *sinks, const Options *options,
+    const Run *run, uint64_t received_bytes);
+static bool bench_loopback(
+    const char *name, const Media *media, const Options *options, bool tcp);
+static double clock_ns(clockid_t clock);
+
+int main(int argc, char *argv[]) {
+    Options options = {
+        .json = false,
+        .gso = false,
+        .zerocopy = false,
+        .sinks = 4,
+        .seconds = 2,
+    };
+    if (!parse_options(argc, argv, &options)) {
+        return EXIT_FAILURE;
+    }
+
+    Media media;
+    if (!load_media(&media)) {
+        return EXIT_FAILURE;
+    }
+
+    const bool ok = bench_loopback("loopback/udp", &media, &options, false) &&
+                    bench_loopback("loopback/tcp", &media, &options, true);
+
+    free(media.nalus);
+    free(media.video);
+    free(media.audio.ptr);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            options->json = true;
+        } else if (strcmp(argv[i], "--gso") == 0) {
+            options->gso = true;
+        } else if (strcmp(argv[i], "--zerocopy") == 0) {
+            options->zerocopy = true;
+        } else if (strcmp(argv[i], "--sinks") == 0 && i + 1 < argc) {
+            options->sinks = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            options->seconds = strtod(argv[++i], NULL);
+        } else {
+            goto usage;
+        }
+    }
+
+    if (options->sinks > 0 && options->seconds > 0) {
+        return true;
+    }
+
+usage:
+    fprintf(
+        stderr,
+        "Usage: %s [--json] [--sinks N] [--seconds S] [--gso] [--zerocopy]\n",
+        argv[0]);
+    return false;
+}
+
+static bool load_media(Media *media) {
+    size_t video_len = 0, audio_len = 0;
+    uint8_t *video = bench_read_file(BENCH_VIDEO_PATH, &video_len),
+            *audio = bench_read_file(BENCH_AUDIO_PATH, &audio_len);
+    if (NULL == video || NULL == audio || audio_len < AUDIO_PACKET_SIZE) {
+        free(video);
+        free(audio);
+        return false;
+    }
+
+    // The whole stream is fed as a single chunk, so the NAL units are not
+    // copied.
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H264);
+    if (NULL == splitter) {
+        free(video);
+        free(audio);
+        return false;
+    }
+
+    size_t capacity = 0;
+    media->nalus = NULL;
+    media->nalus_count = 0;
+
+    SmolRTSP_NalSplitter_feed(splitter, U8Slice99_new(video, video_len));
+    SmolRTSP_NalUnit nalu;
+    int ret;
+    while ((ret = SmolRTSP_NalSplitter_next(splitter, &nalu)) == 1 ||
+           (0 == ret && SmolRTSP_NalSplitter_finish(splitter, &nalu))) {
+        if (media->nalus_count == capacity) {
+            capacity = 0 == capacity ? 1024 : 2 * capacity;
+            SmolRTSP_NalUnit *nalus =
+                realloc(media->nalus, capacity * sizeof nalus[0]);
+            if (NULL == nalus) {
+                break;
+            }
+            media->nalus = nalus;
+        }
+
+        media->nalus[media->nalus_count++] = nalu;
+    }
+
+    VTABLE(SmolRTSP_NalSplitter, SmolRTSP_Droppable).drop(splitter);
+
+    if (0 == media->nalus_count) {
+        fprintf(stderr, "%s: no NAL units\n", BENCH_VIDEO_PATH);
+        free(media->nalus);
+        free(video);
+        free(audio);
+        return false;
+    }
+
+    media->video = video;
+    media->audio = U8Slice99_new(audio, audio_len);
+    return true;
+}
+
+static bool bench_loopback(
+    const char *name, const Media *media, const Options *options, bool tcp) {
+    Sink *sinks = calloc(options->sinks, sizeof sinks[0]);
+    if (NULL == sinks) {
+        return false;
+    }
+
+    size_t opened = 0;
+    for (; opened < options->sinks; opened++) {
+        const bool ok = tcp ? open_tcp_sink(&sinks[opened])
+                            : open_udp_sink(&sinks[opened], options);
+        if (!ok) {
+            perror(name);
+            break;
+        }
+    }
+
+    bool ok = opened == options->sinks;
+    if (ok) {
+        Drain state = {
+            .sinks = sinks,
+            .sinks_count = options->sinks,
+            .stop = false,
+            .received_bytes = 0,
+        };
+
+        pthread_t thread;
+        ok = pthread_create(&thread, NULL, drain, &state) == 0;
+        if (ok) {
+            Run run;
+            stream(media, sinks, options, &run);
+
+            __atomic_store_n(&state.stop, true, __ATOMIC_RELAXED);
+            pthread_join(thread, NULL);
+
+            report(name, sinks, options, &run, state.received_bytes);
+        }
+    }
+
+    for (size_t i = 0; i < opened; i++) {
+        close_sink(&sinks[i]);
+    }
+    free(sinks);
+
+    return ok;
+}
+
+// Sends the media in a loop for `options->seconds`, a video NAL unit at a time
+// to every sink, and two audio packets per video frame.
+static void
+stream(const Media *media, Sink *sinks, const Options *options, Run *run) {
+    const uint64_t allocations_before = allocations_count();
+    const double wall_start = clock_ns(CLOCK_MONOTONIC),
+                 cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID),
+                 deadline = wall_start + options->seconds * 1e9;
+
+    run->frames = 0;
+    run->errors = 0;
+
+    size_t audio_offset = 0;
+    uint32_t audio_ts = 0;
+
+    while (clock_ns(CLOCK_MONOTONIC) < deadline) {
+        for (size_t i = 0; i < media->nalus_count; i++) {
+            const SmolRTSP_NalUnit nalu = media->nalus[i];
+            const SmolRTSP_RtpTimestamp video_ts = SmolRTSP_RtpTimestamp_Raw(
+                (uint32_t)(run->frames * (VIDEO_CLOCK_RATE / VIDEO_FPS)));
+
+            for (size_t j = 0; j < options->sinks; j++) {
+                if (SmolRTSP_NalTransport_send_packet(
+                        sinks[j].video, video_ts, nalu) == -1) {
+                    run->errors++;
+                }
+            }
+
+            const bool is_frame =
+                SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header) ||
+                SmolRTSP_NalHeader_is_coded_slice_non_idr(nalu.header);
+            if (!is_frame) {
+                continue;
+            }
+            run->frames++;
+
+            for (int k = 0; k < 2; k++) {
+                if (audio_offset + AUDIO_PACKET_SIZE > media->audio.len) {
+                    audio_offset = 0;
+                }
+                const U8Slice99 payload = U8Slice99_new(
+                    media->audio.ptr + audio_offset, AUDIO_PACKET_SIZE);
+
+                for (size_t j = 0; j < options->sinks; j++) {
+                    if (SmolRTSP_RtpTransport_send_packet(
+                            sinks[j].audio, SmolRTSP_RtpTimestamp_Raw(audio_ts),
+                            false, U8Slice99_empty(), payload) == -1) {
+                        run->errors++;
+                    }
+                }
+
+                audio_offset += AUDIO_PACKET_SIZE;
+                audio_ts += AUDIO_PACKET_SIZE;
+            }
+
+            // The buffers are never reused, so the notifications are only
+            // read to keep the error queues from filling up.
+            for (size_t j = 0; options->zerocopy && j < options->sinks; j++) {
+                int ret = smolrtsp_zerocopy_reap(
+                    sinks[j].video_fds[0], &sinks[j].video_zerocopy);
+                ret = smolrtsp_zerocopy_reap(
+                    sinks[j].audio_fds[0], &sinks[j].audio_zerocopy);
+                (void)ret;
+            }
+        }
+    }
+
+    run->wall_ns = clock_ns(CLOCK_MONOTONIC) - wall_start;
+    run->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    run->allocations = allocations_count() - allocations_before;
+}
+
+static void report(
+    const char *name, const Sink *sinks, const Options *options,
+    const Run *run, uint64_t received_bytes) {
+    uint64_t packets = 0, bytes = 0, nalus = 0;
+    for (size_t i = 0; i < options->sinks; i++) {
+        const SmolRTSP_NalTransportStats video =
+            SmolRTSP_NalTransport_stats(sinks[i].video);
+        const SmolRTSP_RtpTransportStats audio =
+            SmolRTSP_RtpTransport_stats(sinks[i].audio);
+
+        nalus += video.nalus;
+        packets += video.rtp.packets + audio.packets;
+        bytes += video.rtp.transport.bytes + audio.transport.bytes;
+    }
+
+    const double seconds = run->wall_ns / 1e9;
+    const double packets_per_sec = (double)packets / seconds,
+                 mbit_per_sec = (double)bytes * 8 / seconds / 1e6,
+                 received_mbit_per_sec =
+                     (double)received_bytes * 8 / seconds / 1e6,
+                 ns_per_packet = packets > 0 ? run->cpu_ns / packets : 0,
+                 ns_per_nalu = nalus > 0 ? run->cpu_ns / nalus : 0;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    const double allocations_per_frame =
+        run->frames > 0 ? (double)run->allocations / run->frames : 0;
+#else
+    const double allocations_per_frame = -1;
+#endif
+
+    const char *mode =
+        options->gso && options->zerocopy ? "gso+zerocopy"
+        : options->gso                    ? "gso"
+        : options->zerocopy               ? "zerocopy"
+                                          : "batch";
+
+    if (options->json) {
+        printf(
+            "{\"name\":\"%s\",\"mode\":\"%s\",\"sinks\":%zu,"
+            "\"seconds\":%.3f,\"frames\":%llu,\"packets\":%llu,"
+            "\"packets_per_sec\":%.1f,\"mbit_per_sec\":%.3f,"
+            "\"received_mbit_per_sec\":%.3f,\"cpu_ns_per_packet\":%.1f,"
+            "\"cpu_ns_per_nalu\":%.1f,\"allocations_per_frame\":%.3f,"
+            "\"errors\":%llu}\n",
+            name, mode, options->sinks, seconds,
+            (unsigned long long)run->frames, (unsigned long long)packets,
+            packets_per_sec, mbit_per_sec, received_mbit_per_sec,
+            ns_per_packet, ns_per_nalu, allocations_per_frame,
+            (unsigned long long)run->errors);
+    } else {
+        printf(
+            "%s (%s, %zu sinks): %.0f packets/s, %.1f Mbit/s sent, %.1f "
+            "Mbit/s received, %.1f CPU ns/packet, %.1f CPU ns/NALU, ",
+            name, mode, options->sinks, packets_per_sec, mbit_per_sec,
+            received_mbit_per_sec, ns_per_packet, ns_per_nalu);
+        if (allocations_per_frame < 0) {
+            printf("allocations not counted");
+        } else {
+            printf("%.3f allocations/frame", allocations_per_frame);
+        }
+        printf(", %llu errors\n", (unsigned long long)run->errors);
+    }
+    fflush(stdout);
+}
+
+static bool open_udp_sink(Sink *sink, const Options *options) {
+    sink->video_fds[0] = sink->video_fds[1] = -1;
+    sink->audio_fds[0] = sink->audio_fds[1] = -1;
+
+    if (udp_socket_pair(sink->video_fds) == -1 ||
+        udp_socket_pair(sink->audio_fds) == -1) {
+        return false;
+    }
+
+    SmolRTSP_UdpTransportConfig video_config =
+                                    SmolRTSP_UdpTransportConfig_default(),
+                                audio_config =
+                                    SmolRTSP_UdpTransportConfig_default();
+    video_config.gso =
+        options->gso && smolrtsp_udp_gso_supported(sink->video_fds[0]);
+    if (options->zerocopy) {
+        video_config.zerocopy_threshold = ZEROCOPY_THRESHOLD;
+        video_config.zerocopy_state = &sink->video_zerocopy;
+        audio_config.zerocopy_threshold = ZEROCOPY_THRESHOLD;
+        audio_config.zerocopy_state = &sink->audio_zerocopy;
+    }
+
+    sink->video = SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_udp_with_config(sink->video_fds[0], video_config),
+        VIDEO_PAYLOAD_TY, VIDEO_CLOCK_RATE));
+    sink->audio = SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_udp_with_config(sink->audio_fds[0], audio_config),
+        AUDIO_PAYLOAD_TY, AUDIO_CLOCK_RATE);
+
+    return true;
+}
+
+static bool open_tcp_sink(Sink *sink) {
+    sink->video_fds[0] = sink->video_fds[1] = -1;
+    sink->audio_fds[0] = sink->audio_fds[1] = -1;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+
+    const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (-1 == listen_fd) {
+        return false;
+    }
+
+    bool ok =
+        bind(listen_fd, (const struct sockaddr *)&addr, sizeof addr) == 0 &&
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) == 0 &&
+        listen(listen_fd, 1) == 0 &&
+        (sink->video_fds[0] = socket(AF_INET, SOCK_STREAM, 0)) != -1 &&
+        connect(
+            sink->video_fds[0], (const struct sockaddr *)&addr, sizeof addr) ==
+            0 &&
+        (sink->video_fds[1] = accept(listen_fd, NULL, NULL)) != -1;
+
+    const int saved_errno = errno;
+    close(listen_fd);
+    errno = saved_errno;
+    if (!ok) {
+        return false;
+    }
+
+    // Interleaved on channels 0 and 2, as negotiated by a typical client.
+    sink->video = SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_tcp(smolrtsp_fd_writer(&sink->video_fds[0]), 0, 0),
+        VIDEO_PAYLOAD_TY, VIDEO_CLOCK_RATE));
+    sink->audio = SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_tcp(smolrtsp_fd_writer(&sink->video_fds[0]), 2, 0),
+        AUDIO_PAYLOAD_TY, AUDIO_CLOCK_RATE);
+
+    return true;
+}
+
+static void close_sink(Sink *sink) {
+    if (sink->video != NULL) {
+        VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(sink->video);
+    }
+    if (sink->audio != NULL) {
+        VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(sink->audio);
+    }
+
+    const int fds[] = {
+        sink->video_fds[0],
+        sink->video_fds[1],
+        sink->audio_fds[0],
+        sink->audio_fds[1],
+    };
+    for (size_t i = 0; i < sizeof fds / sizeof fds[0]; i++) {
+        if (fds[i] != -1) {
+            close(fds[i]);
+        }
+    }
+}
+
+// Binds a receiving socket on the loopback interface and connects a sending
+// socket to it: `fds[0]` is for sending, `fds[1]` for receiving.
+static int udp_socket_pair(int fds[2]) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    const int rcvbuf = SINK_RCVBUF;
+
+    if ((fds[1] = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+        return -1;
+    }
+    if (setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf) ==
+            -1 ||
+        bind(fds[1], (const struct sockaddr *)&addr, sizeof addr) == -1 ||
+        getsockname(fds[1], (struct sockaddr *)&addr, &addr_len) == -1) {
+        return -1;
+    }
+
+    fds[0] =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    return fds[0];
+}
+
+// Reads everything the sinks receive until `stop`, counting the bytes.
+static void *drain(void *arg) {
+    Drain *self = arg;
+
+    const size_t max_fds = 2 * self->sinks_count;
+    struct pollfd *fds = calloc(max_fds, sizeof fds[0]);
+    if (NULL == fds) {
+        return NULL;
+    }
+
+    nfds_t fds_count = 0;
+    for (size_t i = 0; i < self->sinks_count; i++) {
+        const int recv_fds[] = {
+            self->sinks[i].video_fds[1],
+            self->sinks[i].audio_fds[1],
+        };
+        for (size_t j = 0; j < 2; j++) {
+            if (recv_fds[j] != -1) {
+                fds[fds_count++] = (struct pollfd){recv_fds[j], POLLIN, 0};
+            }
+        }
+    }
+
+    static uint8_t buffer[64 * 1024];
+    uint64_t received_bytes = 0;
+
+    while (!__atomic_load_n(&self->stop, __ATOMIC_RELAXED)) {
+        if (poll(fds, fds_count, 100) <= 0) {
+            continue;
+        }
+
+        for (nfds_t i = 0; i < fds_count; i++) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+
+            ssize_t n;
+            while ((n = recv(fds[i].fd, buffer, sizeof buffer, MSG_DONTWAIT)) >
+                   0) {
+                received_bytes += (uint64_t)n;
+            }
+        }
+    }
+
+    free(fds);
+    self->received_bytes = received_bytes;
+    return NULL;
+}
+
+static double clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,23 @@
+// Micro-benchmarks of the hot paths of SmolRTSP.
+//
+// Usage: smolrtsp-bench [--json] [NAME-FILTER]
+//
+// With `--json`, every result is printed as a JSON object on its own line, so
+// that runs can be compared across versions.
+
+#include "bench.h"
+#include "suites.h"
+
+#include <stdlib.h>
+
+int main(int argc, char *argv[]) {
+    if (!bench_init(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!bench_rtsp() || !bench_rtp() || !bench_nal()) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+// Annex B start code scanning over `examples/media/video.h264`, and the
+// reassembly of a fragmented NAL unit from RTP packets.
+
+#include "bench.h"
+#include "suites.h"
+
+#include <smolrtsp/nal.h>
+#include <smolrtsp/rtp_depacketizer.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef BENCH_VIDEO_PATH
+#define BENCH_VIDEO_PATH "examples/media/video.h264"
+#endif
+
+// Tests every offset with `smolrtsp_test_start_code_3b`.
+static size_t count_bytewise(U8Slice99 data) {
+    size_t count = 0;
+
+    while (!U8Slice99_is_empty(data)) {
+        const size_t start_code_len = smolrtsp_test_start_code_3b(data);
+        if (start_code_len > 0) {
+            count++;
+            data = U8Slice99_advance(data, start_code_len);
+        } else {
+            data = U8Slice99_advance(data, 1);
+        }
+    }
+
+    return count;
+}
+
+// Jumps between start codes with `smolrtsp_find_next_start_code`.
+static size_t count_find(U8Slice99 data) {
+    size_t count = 0;
+
+    for (;;) {
+        data = U8Slice99_advance(data, smolrtsp_find_next_start_code(data));
+        if (U8Slice99_is_empty(data)) {
+            break;
+        }
+
+        count++;
+        data = U8Slice99_advance(data, 3);
+    }
+
+    return count;
+}
+
+typedef struct {
+    U8Slice99 data;
+    size_t expected;
+} ScanCtx;
+
+static bool scan_bytewise(void *ctx, size_t iterations) {
+    const ScanCtx *self = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (count_bytewise(self->data) != self->expected) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool scan_find(void *ctx, size_t iterations) {
+    const ScanCtx *self = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (count_find(self->data) != self->expected) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#define DEPACKETIZE_NALU_SIZE   (64 * 1024)
+#define DEPACKETIZE_PACKET_SIZE 1200
+#define DEPACKETIZE_PACKETS                                                    \
+    ((DEPACKETIZE_NALU_SIZE + DEPACKETIZE_PACKET_SIZE - 1) /                   \
+     DEPACKETIZE_PACKET_SIZE)
+// The RTP header, the FU indicator and header, and the fragment.
+#define DEPACKETIZE_STRIDE (12 + 2 + DEPACKETIZE_PACKET_SIZE)
+
+typedef struct {
+    SmolRTSP_RtpDepacketizer *depacketizer;
+    uint8_t *packets;
+    size_t lens[DEPACKETIZE_PACKETS];
+    uint16_t seq_num;
+} DepacketizeCtx;
+
+// Splits an IDR slice into FU-A packets with the sequence numbers starting at
+// 0; `depacketize` rewrites them as it goes.
+static void make_fu_a_packets(DepacketizeCtx *ctx) {
+    for (size_t i = 0; i < DEPACKETIZE_PACKETS; i++) {
+        uint8_t *packet = ctx->packets + i * DEPACKETIZE_STRIDE;
+        const size_t offset = i * DEPACKETIZE_PACKET_SIZE,
+                     left = DEPACKETIZE_NALU_SIZE - offset,
+                     len = left < DEPACKETIZE_PACKET_SIZE
+                               ? left
+                               : DEPACKETIZE_PACKET_SIZE;
+
+        memset(packet, 0, 12);
+        packet[0] = 0x80;
+        packet[1] = 96;
+        packet[12] = 0x7C;
+        packet[13] = (0 == i ? 0x80 : 0) |
+                     (DEPACKETIZE_PACKETS - 1 == i ? 0x40 : 0) |
+                     SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR;
+        memset(packet + 14, (int)i, len);
+        ctx->lens[i] = 14 + len;
+    }
+}
+
+static bool depacketize(void *ctx, size_t iterations) {
+    DepacketizeCtx *self = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        size_t len = 0;
+        for (size_t j = 0; j < DEPACKETIZE_PACKETS; j++) {
+            uint8_t *packet = self->packets + j * DEPACKETIZE_STRIDE;
+            packet[2] = (uint8_t)(self->seq_num >> 8);
+            packet[3] = (uint8_t)self->seq_num;
+            self->seq_num++;
+
+            SmolRTSP_RtpHeader header;
+            if (SmolRTSP_RtpDepacketizer_feed(
+                    self->depacketizer,
+                    U8Slice99_new(packet, self->lens[j]), &header) == -1) {
+                return false;
+            }
+
+            SmolRTSP_NalUnit nalu;
+            while (SmolRTSP_RtpDepacketizer_next(self->depacketizer, &nalu)) {
+                len += nalu.payload.len;
+            }
+        }
+
+        if (len != DEPACKETIZE_NALU_SIZE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool bench_depacketize(void) {
+    DepacketizeCtx ctx = {
+        .depacketizer = SmolRTSP_RtpDepacketizer_new(
+            SmolRTSP_NalCodec_H264, DEPACKETIZE_NALU_SIZE + 1),
+        .packets = malloc(DEPACKETIZE_PACKETS * DEPACKETIZE_STRIDE),
+        .seq_num = 0,
+    };
+    if (NULL == ctx.depacketizer || NULL == ctx.packets) {
+        return false;
+    }
+    make_fu_a_packets(&ctx);
+
+    const bool ok = bench_run(
+        "rtp_depacketizer/fu_a", DEPACKETIZE_NALU_SIZE, depacketize, &ctx);
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable)
+        .drop(ctx.depacketizer);
+    free(ctx.packets);
+    return ok;
+}
+
+bool bench_nal(void) {
+    size_t len = 0;
+    uint8_t *video = bench_read_file(BENCH_VIDEO_PATH, &len);
+    if (NULL == video) {
+        return false;
+    }
+
+    ScanCtx ctx = {.data = U8Slice99_new(video, len), .expected = 0};
+    ctx.expected = count_bytewise(ctx.data);
+
+    const bool ok =
+        bench_run("start_code/bytewise", len, scan_bytewise, &ctx) &&
+        bench_run("start_code/find", len, scan_find, &ctx);
+
+    free(video);
+    return ok && bench_depacketize();
+}
@@ -0,0 +1,1141 @@
+// A benchmark of the receive side: replays the RTP packets of a capture of a
+// real camera through `SmolRTSP_JitterBuffer`, `SmolRTSP_RtpDepacketizer`, and
+// a `SmolRTSP_LiveSource` relaying the access units.
+//
+// Usage: smolrtsp-replay [--json] [--realtime] [--rounds N]
+//                        [--codec h264|h265] [--payload-type PT]
+//                        [--latency-ms MS] FILE.pcap
+//
+// The capture is a classic pcap file (convert pcapng with
+// `editcap -F pcap`) of Ethernet, Linux cooked (v1 and v2), raw IP, or
+// loopback frames. The RTP packets are taken from UDP datagrams and from the
+// interleaved frames of reassembled TCP connections. The packets of the payload
+// type `--payload-type` (by default, the dynamic payload type of the most
+// packets) are depacketized as `--codec`; the others only pass through the
+// jitter buffer.
+//
+// The capture is first replayed as captured and then with the packets of every
+// stream sorted by their sequence numbers, as if the network had not reordered
+// them; the difference of the CPU time per packet is the cost of handling the
+// reordering and the losses. The jitter buffer runs on the capture time, so
+// its decisions do not depend on the replay speed. Every replay is run
+// `--rounds` times, as fast as possible, and the fastest one is reported; with
+// `--realtime`, the packets are replayed once, as captured, at their original
+// timing. The memory high-water mark is that of the allocations of the
+// library, counted with `smolrtsp_set_allocator`.
+
+#include "bench.h"
+
+#include <smolrtsp/allocator.h>
+#include <smolrtsp/jitter_buffer.h>
+#include <smolrtsp/live_source.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/rtp_depacketizer.h>
+#include <smolrtsp/types/rtp.h>
+
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define MAX_STREAMS   16
+#define MAX_FLOWS     64
+#define MAX_AU_NALUS  256
+#define MAX_NAL_TYPES 64
+
+#define JITTER_CAPACITY   1024
+#define MAX_NALU_SIZE     (4 * 1024 * 1024)
+#define LIVE_SOURCE_FRAMES 64
+
+// A TCP connection is resynchronized to the next interleaved frame once its
+// pending data exceeds this without a complete message.
+#define MAX_FLOW_PENDING (256 * 1024)
+
+#define RTP_HEADER_SIZE 12
+
+#define LINKTYPE_NULL      0
+#define LINKTYPE_ETHERNET  1
+#define LINKTYPE_RAW       101
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4      228
+#define LINKTYPE_IPV6      229
+#define LINKTYPE_LINUX_SLL2 276
+
+typedef struct {
+    bool json, realtime;
+    size_t rounds;
+    SmolRTSP_NalCodec codec;
+    int payload_ty;
+    uint64_t latency_us;
+    const char *path;
+} Options;
+
+typedef struct {
+    // The capture time relative to the first packet.
+    uint64_t ts_us;
+    size_t stream;
+    // The sequence number extended to 32 bits.
+    uint32_t ext_seq;
+    // The packet in `Capture.arena`.
+    size_t offset, len;
+} Packet;
+
+typedef struct {
+    uint32_t ssrc;
+    uint8_t payload_ty;
+    uint64_t packets;
+    uint32_t max_ext_seq;
+    bool depacketized;
+} Stream;
+
+// The reassembly of one direction of a TCP connection.
+typedef struct {
+    uint8_t key[36];
+    uint32_t next_seq;
+    bool resync;
+    uint8_t *data;
+    size_t len, capacity;
+} Flow;
+
+typedef struct {
+    uint8_t *arena;
+    size_t arena_len, arena_capacity;
+
+    Packet *packets;
+    size_t packets_count, packets_capacity;
+
+    Stream streams[MAX_STREAMS];
+    size_t streams_count;
+
+    Flow flows[MAX_FLOWS];
+    size_t flows_count;
+
+    uint64_t first_ts_us;
+    bool has_first_ts;
+    size_t max_packet_size;
+
+    uint64_t skipped_fragments;
+} Capture;
+
+// The NAL units of the access unit being received.
+typedef struct {
+    bool has_ts;
+    uint32_t ts;
+    uint8_t *data;
+    size_t len, capacity;
+    SmolRTSP_NalHeader headers[MAX_AU_NALUS];
+    size_t offsets[MAX_AU_NALUS], lens[MAX_AU_NALUS];
+    size_t count;
+} AccessUnit;
+
+typedef struct {
+    SmolRTSP_JitterBuffer *jitter_buffer;
+    SmolRTSP_RtpDepacketizer *depacketizer;
+    SmolRTSP_LiveSource *source;
+    AccessUnit au;
+} Pipeline;
+
+typedef struct {
+    double wall_ns, cpu_ns;
+    uint64_t packets, bytes, nalus, reassembled_nalus, frames;
+    // The packets replayed after one of the same stream with a greater
+    // sequence number.
+    uint64_t reordered;
+    uint64_t lost, late, duplicates, discarded, depacketizer_discarded;
+    uint64_t nal_types[MAX_NAL_TYPES];
+    size_t peak_bytes;
+} Run;
+
+static bool parse_options(int argc, char *argv[], Options *options);
+static bool load_capture(const Options *options, Capture *capture);
+static void parse_frame(
+    Capture *capture, uint32_t linktype, uint64_t ts_us, const uint8_t *data,
+    size_t len);
+static void parse_ip(
+    Capture *capture, uint64_t ts_us, const uint8_t *data, size_t len);
+static void parse_tcp(
+    Capture *capture, uint64_t ts_us, const uint8_t key[36],
+    const uint8_t *data, size_t len);
+static void drain_flow(Capture *capture, Flow *flow, uint64_t ts_us);
+static void add_packet(
+    Capture *capture, uint64_t ts_us, const uint8_t *data, size_t len);
+static void select_streams(const Options *options, Capture *capture);
+static void sort_by_sequence(const Capture *capture, size_t order[]);
+static bool replay(
+    const Options *options, const Capture *capture, const size_t order[],
+    bool realtime, Run *run);
+static void feed_depacketizer(Pipeline *pipeline, U8Slice99 packet, Run *run);
+static void finish_access_unit(Pipeline *pipeline, Run *run);
+static void report(
+    const char *name, const Options *options, const Run *run,
+    const Capture *capture);
+static double clock_ns(clockid_t clock);
+static uint16_t read_u16(const uint8_t *data);
+static uint32_t read_u32(const uint8_t *data, bool little_endian);
+
+// Counts the live bytes allocated by the library and their high-water mark.
+static size_t allocated_bytes, peak_bytes;
+
+typedef union {
+    size_t size;
+    long double align;
+} AllocationHeader;
+
+static void *counting_malloc(void *user_data, size_t size) {
+    (void)user_data;
+
+    AllocationHeader *header = malloc(sizeof *header + size);
+    if (NULL == header) {
+        return NULL;
+    }
+    header->size = size;
+
+    allocated_bytes += size;
+    if (allocated_bytes > peak_bytes) {
+        peak_bytes = allocated_bytes;
+    }
+
+    return header + 1;
+}
+
+static void *counting_realloc(void *user_data, void *ptr, size_t size) {
+    (void)user_data;
+
+    AllocationHeader *header = (AllocationHeader *)ptr - 1;
+    const size_t old_size = header->size;
+
+    header = realloc(header, sizeof *header + size);
+    if (NULL == header) {
+        return NULL;
+    }
+    header->size = size;
+
+    allocated_bytes = allocated_bytes - old_size + size;
+    if (allocated_bytes > peak_bytes) {
+        peak_bytes = allocated_bytes;
+    }
+
+    return header + 1;
+}
+
+static void counting_free(void *user_data, void *ptr) {
+    (void)user_data;
+
+    AllocationHeader *header = (AllocationHeader *)ptr - 1;
+    allocated_bytes -= header->size;
+    free(header);
+}
+
+int main(int argc, char *argv[]) {
+    Options options = {
+        .json = false,
+        .realtime = false,
+        .rounds = 5,
+        .codec = SmolRTSP_NalCodec_H264,
+        .payload_ty = -1,
+        .latency_us = 200000,
+        .path = NULL,
+    };
+    if (!parse_options(argc, argv, &options)) {
+        return EXIT_FAILURE;
+    }
+
+    smolrtsp_set_allocator((SmolRTSP_Allocator){
+        .malloc = counting_malloc,
+        .realloc = counting_realloc,
+        .free = counting_free,
+        .user_data = NULL,
+    });
+
+    Capture capture = {0};
+    if (!load_capture(&options, &capture)) {
+        return EXIT_FAILURE;
+    }
+    select_streams(&options, &capture);
+
+    size_t *captured = malloc(capture.packets_count * sizeof captured[0]),
+           *ordered = malloc(capture.packets_count * sizeof ordered[0]);
+    if (NULL == captured || NULL == ordered) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < capture.packets_count; i++) {
+        captured[i] = ordered[i] = i;
+    }
+    sort_by_sequence(&capture, ordered);
+
+    bool ok = true;
+    if (options.realtime) {
+        Run run;
+        ok = replay(&options, &capture, captured, true, &run);
+        if (ok) {
+            report("replay/realtime", &options, &run, &capture);
+        }
+    } else {
+        Run best[2];
+        const size_t *orders[] = {captured, ordered};
+        const char *names[] = {"replay/captured", "replay/ordered"};
+
+        for (size_t i = 0; i < 2 && ok; i++) {
+            for (size_t round = 0; round < options.rounds && ok; round++) {
+                Run run;
+                ok = replay(&options, &capture, orders[i], false, &run);
+                if (ok && (0 == round || run.cpu_ns < best[i].cpu_ns)) {
+                    best[i] = run;
+                }
+            }
+            if (ok) {
+                report(names[i], &options, &best[i], &capture);
+            }
+        }
+
+        if (ok && best[0].packets > 0) {
+            const double cost_ns =
+                (best[0].cpu_ns - best[1].cpu_ns) / (double)best[0].packets;
+            if (options.json) {
+                printf(
+                    "{\"name\":\"replay/reorder_cost\","
+                    "\"cpu_ns_per_packet\":%.1f}\n",
+                    cost_ns);
+            } else {
+                printf(
+                    "reordering and losses: %+.1f CPU ns/packet\n", cost_ns);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < capture.flows_count; i++) {
+        free(capture.flows[i].data);
+    }
+    free(capture.arena);
+    free(capture.packets);
+    free(captured);
+    free(ordered);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--json") == 0) {
+            options->json = true;
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            options->realtime = true;
+        } else if (strcmp(argv[i], "--rounds") == 0 && has_value) {
+            options->rounds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--payload-type") == 0 && has_value) {
+            options->payload_ty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--latency-ms") == 0 && has_value) {
+            options->latency_us = strtoull(argv[++i], NULL, 10) * 1000;
+        } else if (strcmp(argv[i], "--codec") == 0 && has_value) {
+            const char *codec = argv[++i];
+            if (strcmp(codec, "h264") == 0) {
+                options->codec = SmolRTSP_NalCodec_H264;
+            } else if (strcmp(codec, "h265") == 0) {
+                options->codec = SmolRTSP_NalCodec_H265;
+            } else {
+                goto usage;
+            }
+        } else if (argv[i][0] != '-' && NULL == options->path) {
+            options->path = argv[i];
+        } else {
+            goto usage;
+        }
+    }
+
+    if (options->path != NULL && options->rounds > 0 &&
+        options->payload_ty < 128) {
+        return true;
+    }
+
+usage:
+    fprintf(
+        stderr,
+        "Usage: %s [--json] [--realtime] [--rounds N] [--codec h264|h265]\n"
+        "       [--payload-type PT] [--latency-ms MS] FILE.pcap\n",
+        argv[0]);
+    return false;
+}
+
+static bool load_capture(const Options *options, Capture *capture) {
+    size_t len;
+    uint8_t *file = bench_read_file(options->path, &len);
+    if (NULL == file) {
+        return false;
+    }
+
+    bool ok = false;
+    if (len < 24) {
+        goto bad_format;
+    }
+
+    // The magic number tells the byte order of the file and the precision of
+    // its timestamps.
+    const uint32_t magic = read_u32(file, false);
+    bool little_endian, nanoseconds;
+    if (0xa1b2c3d4 == magic || 0xa1b23c4d == magic) {
+        little_endian = false;
+        nanoseconds = 0xa1b23c4d == magic;
+    } else if (0xd4c3b2a1 == magic || 0x4d3cb2a1 == magic) {
+        little_endian = true;
+        nanoseconds = 0x4d3cb2a1 == magic;
+    } else {
+        goto bad_format;
+    }
+    const uint32_t linktype = read_u32(file + 20, little_endian) & 0xffff;
+
+    size_t offset = 24;
+    while (offset + 16 <= len) {
+        const uint8_t *record = file + offset;
+        const uint64_t frac = read_u32(record + 4, little_endian);
+        const uint64_t secs = read_u32(record, little_endian);
+        const uint64_t ts_us =
+            secs * 1000000 + (nanoseconds ? frac / 1000 : frac);
+        const size_t captured_len = read_u32(record + 8, little_endian);
+        if (offset + 16 + captured_len > len) {
+            break;
+        }
+
+        parse_frame(capture, linktype, ts_us, record + 16, captured_len);
+        offset += 16 + captured_len;
+    }
+
+    if (0 == capture->packets_count) {
+        fprintf(stderr, "%s: no RTP packets\n", options->path);
+        goto cleanup;
+    }
+
+    ok = true;
+    goto cleanup;
+
+bad_format:
+    fprintf(stderr, "%s: not a pcap file\n", options->path);
+cleanup:
+    free(file);
+    return ok;
+}
+
+// Strips the link-layer header of a frame.
+static void parse_frame(
+    Capture *capture, uint32_t linktype, uint64_t ts_us, const uint8_t *data,
+    size_t len) {
+    switch (linktype) {
+    case LINKTYPE_NULL:
+        if (len >= 4) {
+            parse_ip(capture, ts_us, data + 4, len - 4);
+        }
+        break;
+    case LINKTYPE_ETHERNET: {
+        size_t header_len = 14;
+        if (len < header_len) {
+            return;
+        }
+        uint16_t ethertype = read_u16(data + 12);
+        // 802.1Q and 802.1ad tags.
+        while ((0x8100 == ethertype || 0x88a8 == ethertype) &&
+               len >= header_len + 4) {
+            ethertype = read_u16(data + header_len + 2);
+            header_len += 4;
+        }
+        if (0x0800 == ethertype || 0x86dd == ethertype) {
+            parse_ip(capture, ts_us, data + header_len, len - header_len);
+        }
+        break;
+    }
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        parse_ip(capture, ts_us, data, len);
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (len >= 16) {
+            parse_ip(capture, ts_us, data + 16, len - 16);
+        }
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (len >= 20) {
+            parse_ip(capture, ts_us, data + 20, len - 20);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+parse_ip(Capture *capture, uint64_t ts_us, const uint8_t *data, size_t len) {
+    // The addresses and the ports of a TCP connection.
+    uint8_t key[36] = {0};
+    uint8_t protocol;
+    size_t header_len;
+
+    if (len >= 20 && 4 == data[0] >> 4) {
+        header_len = (size_t)(data[0] & 0x0f) * 4;
+        const size_t total_len = read_u16(data + 2);
+        // A fragment cannot be parsed on its own.
+        if ((read_u16(data + 6) & 0x3fff) != 0) {
+            capture->skipped_fragments++;
+            return;
+        }
+        if (header_len < 20 || total_len < header_len || total_len > len) {
+            return;
+        }
+        len = total_len;
+        protocol = data[9];
+        memcpy(key, data + 12, 8);
+    } else if (len >= 40 && 6 == data[0] >> 4) {
+        const size_t payload_len = read_u16(data + 4);
+        if (40 + payload_len > len) {
+            return;
+        }
+        len = 40 + payload_len;
+        protocol = data[6];
+        memcpy(key, data + 8, 32);
+        header_len = 40;
+
+        // Hop-by-hop, routing, and destination options.
+        while ((0 == protocol || 43 == protocol || 60 == protocol) &&
+               header_len + 8 <= len) {
+            protocol = data[header_len];
+            header_len += ((size_t)data[header_len + 1] + 1) * 8;
+        }
+        if (44 == protocol) {
+            capture->skipped_fragments++;
+            return;
+        }
+    } else {
+        return;
+    }
+
+    if (header_len > len) {
+        return;
+    }
+    data += header_len;
+    len -= header_len;
+
+    if (17 == protocol && len >= 8) {
+        const size_t udp_len = read_u16(data + 4);
+        if (udp_len >= 8 && udp_len <= len) {
+            add_packet(capture, ts_us, data + 8, udp_len - 8);
+        }
+    } else if (6 == protocol && len >= 20) {
+        memcpy(key + 32, data, 4);
+        parse_tcp(capture, ts_us, key, data, len);
+    }
+}
+
+// Appends the payload of a TCP segment to its connection and extracts the
+// complete interleaved frames.
+static void parse_tcp(
+    Capture *capture, uint64_t ts_us, const uint8_t key[36],
+    const uint8_t *data, size_t len) {
+    const size_t header_len = (size_t)(data[12] >> 4) * 4;
+    const bool syn = data[13] & 0x02;
+    if (header_len < 20 || header_len > len) {
+        return;
+    }
+
+    uint32_t seq = read_u32(data + 4, false);
+    const uint8_t *payload = data + header_len;
+    size_t payload_len = len - header_len;
+
+    Flow *flow = NULL;
+    for (size_t i = 0; i < capture->flows_count; i++) {
+        if (memcmp(capture->flows[i].key, key, 36) == 0) {
+            flow = &capture->flows[i];
+            break;
+        }
+    }
+    if (NULL == flow) {
+        if (MAX_FLOWS == capture->flows_count) {
+            return;
+        }
+        flow = &capture->flows[capture->flows_count++];
+        memcpy(flow->key, key, 36);
+        // Captured in the middle of the connection.
+        flow->next_seq = syn ? seq + 1 : seq;
+        flow->resync = !syn;
+    }
+    if (syn) {
+        flow->next_seq = seq + 1;
+        return;
+    }
+
+    const int32_t ahead = (int32_t)(seq - flow->next_seq);
+    if (ahead < 0) {
+        // A retransmission, possibly with some new data.
+        const size_t overlap = (size_t)-(int64_t)ahead;
+        if (overlap >= payload_len) {
+            return;
+        }
+        payload += overlap;
+        payload_len -= overlap;
+        seq += (uint32_t)overlap;
+    } else if (ahead > 0) {
+        // The capture has missed a segment.
+        flow->len = 0;
+        flow->resync = true;
+    }
+    flow->next_seq = seq + (uint32_t)payload_len;
+
+    if (flow->len + payload_len > flow->capacity) {
+        size_t capacity = flow->capacity > 0 ? flow->capacity : 64 * 1024;
+        while (capacity < flow->len + payload_len) {
+            capacity *= 2;
+        }
+        uint8_t *grown = realloc(flow->data, capacity);
+        if (NULL == grown) {
+            return;
+        }
+        flow->data = grown;
+        flow->capacity = capacity;
+    }
+    memcpy(flow->data + flow->len, payload, payload_len);
+    flow->len += payload_len;
+
+    drain_flow(capture, flow, ts_us);
+}
+
+static void drain_flow(Capture *capture, Flow *flow, uint64_t ts_us) {
+    size_t offset = 0;
+
+    while (offset < flow->len) {
+        const uint8_t *data = flow->data + offset;
+        const size_t len = flow->len - offset;
+
+        if (flow->resync) {
+            // Skips to what looks like an interleaved frame of RTP or RTCP.
+            if (len < 5) {
+                break;
+            }
+            if ('$' == data[0] && 0x80 == (data[4] & 0xc0)) {
+                flow->resync = false;
+            } else {
+                offset++;
+            }
+            continue;
+        }
+
+        if ('$' == data[0]) {
+            if (len < 4) {
+                break;
+            }
+            const size_t frame_len = read_u16(data + 2);
+            if (len < 4 + frame_len) {
+                break;
+            }
+            add_packet(capture, ts_us, data + 4, frame_len);
+            offset += 4 + frame_len;
+            continue;
+        }
+
+        // An RTSP message, skipped with its body.
+        const uint8_t *end = memmem(data, len, "\r\n\r\n", 4);
+        if (NULL == end) {
+            if (len > MAX_FLOW_PENDING) {
+                flow->resync = true;
+            }
+            break;
+        }
+        const size_t header_len = (size_t)(end - data) + 4;
+
+        size_t body_len = 0;
+        for (size_t i = 0; i + 15 < header_len; i++) {
+            if (('\n' == data[i] || 0 == i) &&
+                strncasecmp(
+                    (const char *)data + i + (0 == i ? 0 : 1),
+                    "Content-Length:", 15) == 0) {
+                body_len = strtoul(
+                    (const char *)data + i + (0 == i ? 15 : 16), NULL, 10);
+                break;
+            }
+        }
+        if (len < header_len + body_len) {
+            break;
+        }
+        offset += header_len + body_len;
+    }
+
+    memmove(flow->data, flow->data + offset, flow->len - offset);
+    flow->len -= offset;
+    if (flow->len > MAX_FLOW_PENDING) {
+        flow->len = 0;
+        flow->resync = true;
+    }
+}
+
+// Copies an RTP packet into the capture, skipping anything else.
+static void add_packet(
+    Capture *capture, uint64_t ts_us, const uint8_t *data, size_t len) {
+    if (len < RTP_HEADER_SIZE || (data[0] & 0xc0) != 0x80) {
+        return;
+    }
+    // RTCP (and RTP payload types that would clash with it).
+    const uint8_t payload_ty = data[1] & 0x7f;
+    if (payload_ty >= 72 && payload_ty <= 76) {
+        return;
+    }
+
+    const uint32_t ssrc = read_u32(data + 8, false);
+    size_t stream_idx = 0;
+    while (stream_idx < capture->streams_count &&
+           capture->streams[stream_idx].ssrc != ssrc) {
+        stream_idx++;
+    }
+    if (stream_idx == capture->streams_count) {
+        if (MAX_STREAMS == capture->streams_count) {
+            return;
+        }
+        capture->streams[capture->streams_count++] = (Stream){
+            .ssrc = ssrc,
+            .payload_ty = payload_ty,
+            .packets = 0,
+            .max_ext_seq = read_u16(data + 2) + 0x10000,
+            .depacketized = false,
+        };
+    }
+    Stream *stream = &capture->streams[stream_idx];
+
+    // The extended sequence number closest to the greatest one so far.
+    const uint16_t seq = read_u16(data + 2);
+    const int16_t delta = (int16_t)(seq - (uint16_t)stream->max_ext_seq);
+    const uint32_t ext_seq = stream->max_ext_seq + (uint32_t)(int32_t)delta;
+    if (delta > 0) {
+        stream->max_ext_seq = ext_seq;
+    }
+
+    if (capture->arena_len + len > capture->arena_capacity) {
+        size_t capacity = capture->arena_capacity > 0
+                              ? capture->arena_capacity
+                              : 1024 * 1024;
+        while (capacity < capture->arena_len + len) {
+            capacity *= 2;
+        }
+        uint8_t *arena = realloc(capture->arena, capacity);
+        if (NULL == arena) {
+            return;
+        }
+        capture->arena = arena;
+        capture->arena_capacity = capacity;
+    }
+    if (capture->packets_count == capture->packets_capacity) {
+        const size_t capacity = capture->packets_capacity > 0
+                                    ? capture->packets_capacity * 2
+                                    : 4096;
+        Packet *packets =
+            realloc(capture->packets, capacity * sizeof packets[0]);
+        if (NULL == packets) {
+            return;
+        }
+        capture->packets = packets;
+        capture->packets_capacity = capacity;
+    }
+
+    if (!capture->has_first_ts) {
+        capture->has_first_ts = true;
+        capture->first_ts_us = ts_us;
+    }
+
+    memcpy(capture->arena + capture->arena_len, data, len);
+    capture->packets[capture->packets_count++] = (Packet){
+        .ts_us = ts_us > capture->first_ts_us ? ts_us - capture->first_ts_us
+                                              : 0,
+        .stream = stream_idx,
+        .ext_seq = ext_seq,
+        .offset = capture->arena_len,
+        .len = len,
+    };
+    capture->arena_len += len;
+    stream->packets++;
+    if (len > capture->max_packet_size) {
+        capture->max_packet_size = len;
+    }
+}
+
+// Marks the streams to depacketize: those of `--payload-type`, or else of the
+// dynamic payload type of the most packets.
+static void select_streams(const Options *options, Capture *capture) {
+    int payload_ty = options->payload_ty;
+
+    if (-1 == payload_ty) {
+        uint64_t counts[128] = {0}, best = 0;
+        for (size_t i = 0; i < capture->streams_count; i++) {
+            counts[capture->streams[i].payload_ty] +=
+                capture->streams[i].packets;
+        }
+        for (int ty = 96; ty < 128; ty++) {
+            if (counts[ty] > best) {
+                best = counts[ty];
+                payload_ty = ty;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < capture->streams_count; i++) {
+        capture->streams[i].depacketized =
+            capture->streams[i].payload_ty == payload_ty;
+    }
+}
+
+static const Capture *sort_capture;
+
+static int compare_by_sequence(const void *a, const void *b) {
+    const uint32_t x = sort_capture->packets[*(const size_t *)a].ext_seq,
+                   y = sort_capture->packets[*(const size_t *)b].ext_seq;
+    return (x > y) - (x < y);
+}
+
+// Sorts the packets of every stream by their sequence numbers, keeping the
+// positions of the streams in `order`.
+static void sort_by_sequence(const Capture *capture, size_t order[]) {
+    size_t *indices = malloc(capture->packets_count * sizeof indices[0]);
+    if (NULL == indices) {
+        return;
+    }
+
+    sort_capture = capture;
+    for (size_t stream = 0; stream < capture->streams_count; stream++) {
+        size_t n = 0;
+        for (size_t i = 0; i < capture->packets_count; i++) {
+            if (capture->packets[i].stream == stream) {
+                indices[n++] = i;
+            }
+        }
+        qsort(indices, n, sizeof indices[0], compare_by_sequence);
+
+        size_t j = 0;
+        for (size_t i = 0; i < capture->packets_count; i++) {
+            if (capture->packets[i].stream == stream) {
+                order[i] = indices[j++];
+            }
+        }
+    }
+
+    free(indices);
+}
+
+static bool replay(
+    const Options *options, const Capture *capture, const size_t order[],
+    bool realtime, Run *run) {
+    memset(run, '\0', sizeof *run);
+
+    Pipeline pipelines[MAX_STREAMS] = {0};
+    bool ok = true;
+
+    const size_t baseline_bytes = allocated_bytes;
+    peak_bytes = allocated_bytes;
+
+    for (size_t i = 0; i < capture->streams_count; i++) {
+        Pipeline *p = &pipelines[i];
+        p->jitter_buffer = SmolRTSP_JitterBuffer_new(
+            JITTER_CAPACITY, capture->max_packet_size, options->latency_us);
+        if (NULL == p->jitter_buffer) {
+            ok = false;
+        }
+        if (capture->streams[i].depacketized) {
+            p->depacketizer =
+                SmolRTSP_RtpDepacketizer_new(options->codec, MAX_NALU_SIZE);
+            p->source = SmolRTSP_LiveSource_new(LIVE_SOURCE_FRAMES);
+            if (NULL == p->depacketizer || NULL == p->source) {
+                ok = false;
+            }
+        }
+    }
+    if (!ok) {
+        perror("replay");
+        goto cleanup;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const double wall_start = clock_ns(CLOCK_MONOTONIC),
+                 cpu_start = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    uint64_t now_us = 0;
+    uint32_t max_ext_seq[MAX_STREAMS] = {0};
+    for (size_t i = 0; i < capture->packets_count; i++) {
+        const Packet *packet = &capture->packets[order[i]];
+        Pipeline *p = &pipelines[packet->stream];
+
+        if (packet->ext_seq < max_ext_seq[packet->stream]) {
+            run->reordered++;
+        } else {
+            max_ext_seq[packet->stream] = packet->ext_seq;
+        }
+
+        // The packets sorted by their sequence numbers may go back in time.
+        if (packet->ts_us > now_us) {
+            now_us = packet->ts_us;
+        }
+
+        if (realtime) {
+            struct timespec due = {
+                .tv_sec = start.tv_sec + (time_t)(now_us / 1000000),
+                .tv_nsec = start.tv_nsec + (long)(now_us % 1000000) * 1000,
+            };
+            if (due.tv_nsec >= 1000000000) {
+                due.tv_sec++;
+                due.tv_nsec -= 1000000000;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+        }
+
+        const U8Slice99 data =
+            U8Slice99_new(capture->arena + packet->offset, packet->len);
+        if (SmolRTSP_JitterBuffer_push(p->jitter_buffer, data, now_us) == -1) {
+            continue;
+        }
+
+        U8Slice99 released;
+        while (SmolRTSP_JitterBuffer_pop(p->jitter_buffer, now_us, &released)) {
+            feed_depacketizer(p, released, run);
+        }
+    }
+
+    // Gives up on the packets still missing.
+    now_us += options->latency_us + 1;
+    for (size_t i = 0; i < capture->streams_count; i++) {
+        Pipeline *p = &pipelines[i];
+        U8Slice99 released;
+        while (SmolRTSP_JitterBuffer_pop(p->jitter_buffer, now_us, &released)) {
+            feed_depacketizer(p, released, run);
+        }
+        if (p->depacketizer != NULL) {
+            finish_access_unit(p, run);
+        }
+    }
+
+    run->wall_ns = clock_ns(CLOCK_MONOTONIC) - wall_start;
+    run->cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    run->peak_bytes = peak_bytes - baseline_bytes;
+
+    for (size_t i = 0; i < capture->streams_count; i++) {
+        const SmolRTSP_JitterBufferStats stats =
+            SmolRTSP_JitterBuffer_stats(pipelines[i].jitter_buffer);
+        run->lost += stats.lost;
+        run->late += stats.late;
+        run->duplicates += stats.duplicates;
+        run->discarded += stats.discarded;
+
+        if (pipelines[i].depacketizer != NULL) {
+            const SmolRTSP_RtpDepacketizerStats depacketizer_stats =
+                SmolRTSP_RtpDepacketizer_stats(pipelines[i].depacketizer);
+            run->nalus += depacketizer_stats.nalus;
+            run->reassembled_nalus += depacketizer_stats.reassembled_nalus;
+            run->depacketizer_discarded +=
+                depacketizer_stats.discarded_packets;
+        }
+    }
+
+cleanup:
+    for (size_t i = 0; i < capture->streams_count; i++) {
+        Pipeline *p = &pipelines[i];
+        if (p->jitter_buffer != NULL) {
+            VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable)
+                .drop(p->jitter_buffer);
+        }
+        if (p->depacketizer != NULL) {
+            VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable)
+                .drop(p->depacketizer);
+        }
+        if (p->source != NULL) {
+            VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(p->source);
+        }
+        free(p->au.data);
+    }
+
+    return ok;
+}
+
+// Depacketizes a released packet of a depacketized stream and collects its NAL
+// units into access units, which are relayed by the live source.
+static void feed_depacketizer(Pipeline *p, U8Slice99 packet, Run *run) {
+    run->packets++;
+    run->bytes += packet.len;
+
+    if (NULL == p->depacketizer) {
+        return;
+    }
+
+    SmolRTSP_RtpHeader header;
+    if (SmolRTSP_RtpDepacketizer_feed(p->depacketizer, packet, &header) ==
+        -1) {
+        return;
+    }
+
+    AccessUnit *au = &p->au;
+    const uint32_t ts = ntohl(header.timestamp);
+    if (au->has_ts && au->ts != ts) {
+        finish_access_unit(p, run);
+    }
+    au->has_ts = true;
+    au->ts = ts;
+
+    SmolRTSP_NalUnit nalu;
+    while (SmolRTSP_RtpDepacketizer_next(p->depacketizer, &nalu)) {
+        const uint8_t unit_type = SmolRTSP_NalHeader_unit_type(nalu.header);
+        run->nal_types[unit_type % MAX_NAL_TYPES]++;
+
+        if (MAX_AU_NALUS == au->count) {
+            finish_access_unit(p, run);
+            au->has_ts = true;
+            au->ts = ts;
+        }
+
+        if (au->len + nalu.payload.len > au->capacity) {
+            size_t capacity = au->capacity > 0 ? au->capacity : 64 * 1024;
+            while (capacity < au->len + nalu.payload.len) {
+                capacity *= 2;
+            }
+            uint8_t *data = realloc(au->data, capacity);
+            if (NULL == data) {
+                continue;
+            }
+            au->data = data;
+            au->capacity = capacity;
+        }
+
+        memcpy(au->data + au->len, nalu.payload.ptr, nalu.payload.len);
+        au->headers[au->count] = nalu.header;
+        au->offsets[au->count] = au->len;
+        au->lens[au->count] = nalu.payload.len;
+        au->count++;
+        au->len += nalu.payload.len;
+    }
+
+    if (header.marker) {
+        finish_access_unit(p, run);
+    }
+}
+
+static void finish_access_unit(Pipeline *p, Run *run) {
+    AccessUnit *au = &p->au;
+
+    if (au->count > 0) {
+        SmolRTSP_NalUnit nalus[MAX_AU_NALUS];
+        for (size_t i = 0; i < au->count; i++) {
+            nalus[i] = (SmolRTSP_NalUnit){
+                au->headers[i],
+                U8Slice99_new(au->data + au->offsets[i], au->lens[i]),
+            };
+        }
+
+        SmolRTSP_LiveFrame *frame = SmolRTSP_LiveFrame_new(
+            SmolRTSP_RtpTimestamp_Raw(au->ts), nalus, au->count);
+        if (frame != NULL) {
+            SmolRTSP_LiveSource_push(p->source, frame);
+            run->frames++;
+        }
+    }
+
+    au->has_ts = false;
+    au->len = 0;
+    au->count = 0;
+}
+
+static void report(
+    const char *name, const Options *options, const Run *run,
+    const Capture *capture) {
+    const double seconds = run->wall_ns / 1e9;
+    const double packets_per_sec = (double)run->packets / seconds,
+                 nalus_per_sec = (double)run->nalus / seconds,
+                 mbit_per_sec = (double)run->bytes * 8 / seconds / 1e6,
+                 ns_per_packet =
+                     run->packets > 0 ? run->cpu_ns / run->packets : 0,
+                 ns_per_nalu = run->nalus > 0 ? run->cpu_ns / run->nalus : 0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const long max_rss_kb = usage.ru_maxrss;
+
+    if (options->json) {
+        printf(
+            "{\"name\":\"%s\",\"streams\":%zu,\"seconds\":%.3f,"
+            "\"packets\":%llu,\"packets_per_sec\":%.1f,\"nalus\":%llu,"
+            "\"nalus_per_sec\":%.1f,\"reassembled_nalus\":%llu,"
+            "\"frames\":%llu,\"mbit_per_sec\":%.3f,"
+            "\"cpu_ns_per_packet\":%.1f,\"cpu_ns_per_nalu\":%.1f,"
+            "\"reordered\":%llu,\"lost\":%llu,\"late\":%llu,"
+            "\"duplicates\":%llu,\"discarded\":%llu,"
+            "\"depacketizer_discarded\":%llu,\"peak_bytes\":%zu,"
+            "\"max_rss_kb\":%ld,\"nal_types\":{",
+            name, capture->streams_count, seconds,
+            (unsigned long long)run->packets, packets_per_sec,
+            (unsigned long long)run->nalus, nalus_per_sec,
+            (unsigned long long)run->reassembled_nalus,
+            (unsigned long long)run->frames, mbit_per_sec, ns_per_packet,
+            ns_per_nalu, (unsigned long long)run->reordered,
+            (unsigned long long)run->lost, (unsigned long long)run->late,
+            (unsigned long long)run->duplicates,
+            (unsigned long long)run->discarded,
+            (unsigned long long)run->depacketizer_discarded, run->peak_bytes,
+            max_rss_kb);
+        const char *separator = "";
+        for (size_t ty = 0; ty < MAX_NAL_TYPES; ty++) {
+            if (run->nal_types[ty] > 0) {
+                printf(
+                    "%s\"%zu\":%llu", separator, ty,
+                    (unsigned long long)run->nal_types[ty]);
+                separator = ",";
+            }
+        }
+        printf("}}\n");
+    } else {
+        printf(
+            "%s (%zu streams): %.0f packets/s, %.0f NALUs/s, %.1f Mbit/s, "
+            "%.1f CPU ns/packet, %.1f CPU ns/NALU\n"
+            "  %llu packets, %llu NALUs (%llu reassembled), %llu frames; "
+            "%llu reordered, %llu lost, %llu late, %llu duplicates, %llu "
+            "discarded, %llu undepacketizable\n"
+            "  peak %.1f KiB allocated by the library, max RSS %ld KiB\n"
+            "  NAL units by type:",
+            name, capture->streams_count, packets_per_sec, nalus_per_sec,
+            mbit_per_sec, ns_per_packet, ns_per_nalu,
+            (unsigned long long)run->packets, (unsigned long long)run->nalus,
+            (unsigned long long)run->reassembled_nalus,
+            (unsigned long long)run->frames,
+            (unsigned long long)run->reordered,
+            (unsigned long long)run->lost, (unsigned long long)run->late,
+            (unsigned long long)run->duplicates,
+            (unsigned long long)run->discarded,
+            (unsigned long long)run->depacketizer_discarded,
+            (double)run->peak_bytes / 1024, max_rss_kb);
+        for (size_t ty = 0; ty < MAX_NAL_TYPES; ty++) {
+            if (run->nal_types[ty] > 0) {
+                printf(
+                    " %zu: %llu", ty, (unsigned long long)run->nal_types[ty]);
+            }
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static double clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint16_t read_u16(const uint8_t *data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+// Reads a big-endian 32-bit integer, or a little-endian one if
+// `little_endian`.
+static uint32_t read_u32(const uint8_t *data, bool little_endian) {
+    if (little_endian) {
+        return (uint32_t)data[3] << 24 | (uint32_t)data[2] << 16 |
+               (uint32_t)data[1] << 8 | data[0];
+    }
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+           (uint32_t)data[2] << 8 | data[3];
+}
@@ -0,0 +1,197 @@
+// RTP packetization against a transport that only touches the data, so the
+// numbers reflect the library overhead without system calls.
+
+#include "bench.h"
+#include "suites.h"
+
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+#include <smolrtsp/srtp.h>
+#include <smolrtsp/types/rtp.h>
+
+#include <arpa/inet.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define RTP_PAYLOAD_SIZE 1200
+#define RTP_MAX_HEADER_SIZE 16
+#define SMALL_NALU_SIZE 800
+#define LARGE_NALU_SIZE (64 * 1024)
+
+typedef struct {
+    uint64_t checksum;
+} NullTransport;
+
+static int NullTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(NullTransport);
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            self->checksum += ((const uint8_t *)bufs.ptr[i].iov_base)[0] +
+                              bufs.ptr[i].iov_len;
+        }
+    }
+
+    return 0;
+}
+
+static bool NullTransport_is_full(VSelf) {
+    VSELF(NullTransport);
+    (void)self;
+
+    return false;
+}
+
+static void NullTransport_drop(VSelf) {
+    VSELF(NullTransport);
+    bench_sink(self->checksum);
+}
+
+impl(SmolRTSP_Droppable, NullTransport);
+impl(SmolRTSP_Transport, NullTransport);
+
+static uint8_t payload_buf[LARGE_NALU_SIZE];
+
+static bool rtp_header_serialize(void *ctx, size_t iterations) {
+    const SmolRTSP_Transport t = *(SmolRTSP_Transport *)ctx;
+    const U8Slice99 payload = U8Slice99_new(payload_buf, RTP_PAYLOAD_SIZE);
+    uint8_t header_buf[RTP_MAX_HEADER_SIZE];
+
+    for (size_t i = 0; i < iterations; i++) {
+        const SmolRTSP_RtpHeader header = {
+            .version = 2,
+            .padding = false,
+            .extension = false,
+            .csrc_count = 0,
+            .marker = 0 == i % 100,
+            .payload_ty = 96,
+            .sequence_number = htons((uint16_t)i),
+            .timestamp = htonl((uint32_t)i * 3000),
+            .ssrc = 0x12345678,
+            .csrc = NULL,
+            .extension_profile = htons(0),
+            .extension_payload_len = htons(0),
+            .extension_payload = NULL,
+        };
+
+        const size_t rtp_header_size = SmolRTSP_RtpHeader_size(header);
+        const U8Slice99 rtp_header = U8Slice99_new(
+            SmolRTSP_RtpHeader_serialize(header, header_buf),
+            rtp_header_size);
+
+        const SmolRTSP_IoVecSlice bufs =
+            (SmolRTSP_IoVecSlice)Slice99_typed_from_array((struct iovec[]){
+                smolrtsp_slice_to_iovec(rtp_header),
+                smolrtsp_slice_to_iovec(payload),
+            });
+
+        if (VCALL(t, transmit, bufs) == -1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool rtp_transport_send_packet(void *ctx, size_t iterations) {
+    SmolRTSP_RtpTransport *t = ctx;
+    const U8Slice99 payload = U8Slice99_new(payload_buf, RTP_PAYLOAD_SIZE);
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (SmolRTSP_RtpTransport_send_packet(
+                t, SmolRTSP_RtpTimestamp_Raw((uint32_t)i * 3000),
+                0 == i % 100, U8Slice99_empty(), payload) == -1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+typedef struct {
+    SmolRTSP_NalTransport *t;
+    size_t nalu_size;
+} NalCtx;
+
+static bool nal_transport_send_packet(void *ctx, size_t iterations) {
+    const NalCtx *self = ctx;
+
+    const SmolRTSP_NalUnit nalu = {
+        .header = SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+            .forbidden_zero_bit = false,
+            .ref_idc = 0b11,
+            .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        }),
+        .payload = U8Slice99_new(payload_buf, self->nalu_size),
+    };
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (SmolRTSP_NalTransport_send_packet(
+                self->t, SmolRTSP_RtpTimestamp_Raw((uint32_t)i * 3000),
+                nalu) == -1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool bench_rtp(void) {
+    for (size_t i = 0; i < sizeof payload_buf; i++) {
+        payload_buf[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    NullTransport sink = {0};
+    SmolRTSP_Transport t = DYN(NullTransport, SmolRTSP_Transport, &sink);
+    if (!bench_run(
+            "rtp_header/serialize", RTP_PAYLOAD_SIZE, rtp_header_serialize,
+            &t)) {
+        return false;
+    }
+
+    SmolRTSP_RtpTransport *rtp = SmolRTSP_RtpTransport_new(t, 96, 90000);
+    const bool rtp_ok = bench_run(
+        "rtp_header/template", RTP_PAYLOAD_SIZE, rtp_transport_send_packet,
+        rtp);
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(rtp);
+    if (!rtp_ok) {
+        return false;
+    }
+
+    // The same with SRTP, so the difference is the cost of the protection.
+    SmolRTSP_SrtpKeys keys;
+    if (SmolRTSP_SrtpKeys_generate(
+            &keys, SmolRTSP_SrtpSuite_AesCm128HmacSha1_80) == -1) {
+        return false;
+    }
+    SmolRTSP_SrtpTransport *srtp = SmolRTSP_SrtpTransport_new(t, keys);
+    if (NULL == srtp) {
+        return false;
+    }
+    SmolRTSP_RtpTransport *secure = SmolRTSP_RtpTransport_new(
+        DYN(SmolRTSP_SrtpTransport, SmolRTSP_Transport, srtp), 96, 90000);
+    const bool srtp_ok = bench_run(
+        "srtp/send_packet", RTP_PAYLOAD_SIZE, rtp_transport_send_packet,
+        secure);
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(secure);
+    if (!srtp_ok) {
+        return false;
+    }
+
+    NalCtx ctx = {
+        .t = SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport_new(t, 96, 90000)),
+        .nalu_size = SMALL_NALU_SIZE,
+    };
+    bool nal_ok = bench_run(
+        "nal_transport_send_packet/single", SMALL_NALU_SIZE,
+        nal_transport_send_packet, &ctx);
+
+    ctx.nalu_size = LARGE_NALU_SIZE;
+    nal_ok = nal_ok && bench_run(
+                           "nal_transport_send_packet/fu", LARGE_NALU_SIZE,
+                           nal_transport_send_packet, &ctx);
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(ctx.t);
+
+    return nal_ok;
+}
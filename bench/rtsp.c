@@ -0,0 +1,407 @@
+// RTSP message parsing and serialization.
+
+#include "bench.h"
+#include "suites.h"
+
+#include <smolrtsp/context.h>
+#include <smolrtsp/sdp_cache.h>
+#include <smolrtsp/types/request.h>
+#include <smolrtsp/types/request_parser.h>
+#include <smolrtsp/types/response.h>
+#include <smolrtsp/types/sdp.h>
+#include <smolrtsp/util.h>
+#include <smolrtsp/writer.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define SEGMENT_SIZE 32
+
+typedef struct {
+    const char *name;
+    const char *data;
+} Message;
+
+// Requests as sent by VLC (LIVE555) to an IP camera.
+static const Message requests[] = {
+    {"request_parse/options",
+     "OPTIONS rtsp://192.168.1.10:554/stream1 RTSP/1.0\r\n"
+     "CSeq: 2\r\n"
+     "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+     "\r\n"},
+    {"request_parse/describe",
+     "DESCRIBE rtsp://192.168.1.10:554/stream1 RTSP/1.0\r\n"
+     "CSeq: 3\r\n"
+     "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+     "Accept: application/sdp\r\n"
+     "\r\n"},
+    {"request_parse/setup",
+     "SETUP rtsp://192.168.1.10:554/stream1/trackID=0 RTSP/1.0\r\n"
+     "CSeq: 4\r\n"
+     "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+     "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n"
+     "\r\n"},
+    {"request_parse/play",
+     "PLAY rtsp://192.168.1.10:554/stream1/ RTSP/1.0\r\n"
+     "CSeq: 5\r\n"
+     "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+     "Session: 5A3F8C21B7D04E69\r\n"
+     "Range: npt=0.000-\r\n"
+     "\r\n"},
+    {"request_parse/get_parameter",
+     "GET_PARAMETER rtsp://192.168.1.10:554/stream1 RTSP/1.0\r\n"
+     "CSeq: 12345\r\n"
+     "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+     "Session: 5A3F8C21B7D04E69\r\n"
+     "Authorization: Digest username=\"admin\", realm=\"camera\", "
+     "nonce=\"4f1b2c3d4e5f\", uri=\"rtsp://192.168.1.10:554/stream1\", "
+     "response=\"0123456789abcdef0123456789abcdef\"\r\n"
+     "Accept: text/parameters\r\n"
+     "Content-Length: 0\r\n"
+     "\r\n"},
+};
+
+#define KEEP_ALIVE (requests[SLICE99_ARRAY_LEN(requests) - 1].data)
+
+static bool parse_whole(void *ctx, size_t iterations) {
+    const CharSlice99 input = CharSlice99_from_str((char *)ctx);
+
+    for (size_t i = 0; i < iterations; i++) {
+        SmolRTSP_Request req = SmolRTSP_Request_uninit();
+        if (!SmolRTSP_ParseResult_is_complete(
+                SmolRTSP_Request_parse(&req, input))) {
+            return false;
+        }
+        bench_sink(req.cseq);
+    }
+
+    return true;
+}
+
+// Feeds the request in `SEGMENT_SIZE`-byte segments, either restarting
+// `SmolRTSP_Request_parse` on every one of them or continuing with
+// `SmolRTSP_RequestParser`.
+static bool parse_segmented(const char *data, size_t iterations, bool resume) {
+    const CharSlice99 input = CharSlice99_from_str((char *)data);
+
+    for (size_t i = 0; i < iterations; i++) {
+        SmolRTSP_RequestParser parser = SmolRTSP_RequestParser_new();
+        SmolRTSP_Request req = SmolRTSP_Request_uninit();
+
+        for (size_t len = SEGMENT_SIZE;; len += SEGMENT_SIZE) {
+            if (len > input.len) {
+                len = input.len;
+            }
+
+            const CharSlice99 received = CharSlice99_sub(input, 0, len);
+            const SmolRTSP_ParseResult res =
+                resume ? SmolRTSP_RequestParser_parse(&parser, &req, received)
+                       : SmolRTSP_Request_parse(&req, received);
+
+            if (SmolRTSP_ParseResult_is_complete(res)) {
+                break;
+            }
+            if (SmolRTSP_ParseResult_is_failure(res) || len == input.len) {
+                return false;
+            }
+        }
+        bench_sink(req.cseq);
+    }
+
+    return true;
+}
+
+static bool parse_restart(void *ctx, size_t iterations) {
+    return parse_segmented(ctx, iterations, false);
+}
+
+static bool parse_incremental(void *ctx, size_t iterations) {
+    return parse_segmented(ctx, iterations, true);
+}
+
+static bool parse_transport(void *ctx, size_t iterations) {
+    const CharSlice99 input = CharSlice99_from_str((char *)ctx);
+
+    for (size_t i = 0; i < iterations; i++) {
+        SmolRTSP_TransportConfig config;
+        if (smolrtsp_parse_transport(&config, input) == -1) {
+            return false;
+        }
+        bench_sink(config.lower);
+    }
+
+    return true;
+}
+
+// A typical response to `SETUP`.
+static SmolRTSP_Response setup_response(void) {
+    return (SmolRTSP_Response){
+        .start_line =
+            {
+                .version = {.major = 1, .minor = 0},
+                .code = SMOLRTSP_STATUS_OK,
+                .reason = CharSlice99_from_str("OK"),
+            },
+        .header_map = SmolRTSP_HeaderMap_from_array({
+            {SMOLRTSP_HEADER_TRANSPORT,
+             CharSlice99_from_str("RTP/AVP/TCP;unicast;interleaved=0-1;"
+                                  "ssrc=5D3A2F01")},
+            {SMOLRTSP_HEADER_SESSION,
+             CharSlice99_from_str("5A3F8C21B7D04E69;timeout=60")},
+            {SMOLRTSP_HEADER_SERVER, CharSlice99_from_str("smolrtsp")},
+            {SMOLRTSP_HEADER_DATE,
+             CharSlice99_from_str("Wed, 14 Oct 2026 12:00:00 GMT")},
+            {SMOLRTSP_HEADER_CACHE_CONTROL, CharSlice99_from_str("no-cache")},
+        }),
+        .body = CharSlice99_empty(),
+        .cseq = 4,
+    };
+}
+
+typedef struct {
+    SmolRTSP_Response response;
+    SmolRTSP_Writer w;
+    char *buffer;
+} SerializeCtx;
+
+static bool serialize(void *ctx, size_t iterations) {
+    SerializeCtx *self = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (self->buffer != NULL) {
+            self->buffer[0] = '\0';
+        }
+
+        const ssize_t ret =
+            SmolRTSP_Response_serialize(&self->response, self->w);
+        if (ret < 0) {
+            return false;
+        }
+        bench_sink((uint64_t)ret);
+    }
+
+    return true;
+}
+
+// The same as `serialize` but rewinds the string buffer behind `self->w`.
+static bool serialize_string_buffer(void *ctx, size_t iterations) {
+    const SerializeCtx *self = ctx;
+    SmolRTSP_StringBuffer *sb = self->w.self;
+
+    for (size_t i = 0; i < iterations; i++) {
+        sb->len = 0;
+
+        const ssize_t ret =
+            SmolRTSP_Response_serialize(&self->response, self->w);
+        if (ret < 0) {
+            return false;
+        }
+        bench_sink((uint64_t)ret);
+    }
+
+    return true;
+}
+
+// The same as `serialize` but gathers the response in a buffered writer first.
+static bool serialize_buffered(void *ctx, size_t iterations) {
+    SerializeCtx *self = ctx;
+    char buffer[1024];
+
+    for (size_t i = 0; i < iterations; i++) {
+        SmolRTSP_BufferedWriter bw =
+            SmolRTSP_BufferedWriter_new(self->w, buffer, sizeof buffer);
+
+        const ssize_t ret = SmolRTSP_Response_serialize(
+            &self->response, smolrtsp_buffered_writer(&bw));
+        if (ret < 0 || SmolRTSP_BufferedWriter_flush(&bw) < 0) {
+            return false;
+        }
+        bench_sink((uint64_t)ret);
+    }
+
+    return true;
+}
+
+// Responds to `SETUP` through `SmolRTSP_Context` as a controller would.
+static bool respond(void *ctx, size_t iterations) {
+    char *buffer = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        buffer[0] = '\0';
+
+        SmolRTSP_Context *rtsp_ctx =
+            SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 4);
+        smolrtsp_header(
+            rtsp_ctx, SMOLRTSP_HEADER_TRANSPORT,
+            "RTP/AVP/TCP;unicast;interleaved=%d-%d", 0, 1);
+        smolrtsp_header(
+            rtsp_ctx, SMOLRTSP_HEADER_SESSION, "%s;timeout=%d",
+            "5A3F8C21B7D04E69", 60);
+        const ssize_t ret = smolrtsp_respond_ok(rtsp_ctx);
+        VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(rtsp_ctx);
+
+        if (ret < 0) {
+            return false;
+        }
+        bench_sink((uint64_t)ret);
+    }
+
+    return true;
+}
+
+static const char sprop[] =
+    "sprop-parameter-sets=Z2QAKKzZQHgCJ+IQAAADABAAAAMDyPGDGWA=,aOvjyyLA";
+
+static ssize_t render_sdp(SmolRTSP_Writer w) {
+    ssize_t ret = 0;
+
+    SMOLRTSP_SDP_DESCRIBE(
+        ret, w, (SMOLRTSP_SDP_VERSION, "0"),
+        (SMOLRTSP_SDP_ORIGIN, "SmolRTSP 3855320066 3855320129 IN IP4 0.0.0.0"),
+        (SMOLRTSP_SDP_SESSION_NAME, "SmolRTSP bench"),
+        (SMOLRTSP_SDP_CONNECTION, "IN IP4 0.0.0.0"),
+        (SMOLRTSP_SDP_TIME, "0 0"),
+        (SMOLRTSP_SDP_MEDIA, "video 0 RTP/AVP %d", 96),
+        (SMOLRTSP_SDP_ATTR, "control:video"),
+        (SMOLRTSP_SDP_ATTR, "rtpmap:%d H264/%d", 96, 90000),
+        (SMOLRTSP_SDP_ATTR, "fmtp:%d packetization-mode=1;%s", 96, sprop),
+        (SMOLRTSP_SDP_ATTR, "framerate:%d", 30));
+
+    return ret;
+}
+
+// Renders the SDP of a DESCRIBE response from scratch every time.
+static bool sdp_render(void *ctx, size_t iterations) {
+    char *buffer = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        SmolRTSP_StringBuffer sb = SmolRTSP_StringBuffer_new(buffer, 1024);
+        const ssize_t ret = render_sdp(smolrtsp_string_buffer_writer(&sb));
+        if (ret < 0) {
+            return false;
+        }
+        bench_sink((uint64_t)ret);
+    }
+
+    return true;
+}
+
+// Computes the content key and takes the SDP from `SmolRTSP_SdpCache`.
+static bool sdp_cached(void *ctx, size_t iterations) {
+    SmolRTSP_SdpCache *cache = ctx;
+
+    for (size_t i = 0; i < iterations; i++) {
+        const uint64_t key =
+            smolrtsp_sdp_key(SMOLRTSP_SDP_KEY_INIT, sprop, sizeof sprop - 1);
+
+        CharSlice99 sdp;
+        if (!SmolRTSP_SdpCache_lookup(cache, key, &sdp)) {
+            if (render_sdp(SmolRTSP_SdpCache_begin(cache)) < 0 ||
+                SmolRTSP_SdpCache_commit(cache, key, &sdp) == -1) {
+                return false;
+            }
+        }
+        bench_sink(sdp.len);
+    }
+
+    return true;
+}
+
+bool bench_rtsp(void) {
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(requests); i++) {
+        if (!bench_run(
+                requests[i].name, strlen(requests[i].data), parse_whole,
+                (void *)requests[i].data)) {
+            return false;
+        }
+    }
+
+    if (!bench_run(
+            "request_parse/segmented_restart", strlen(KEEP_ALIVE),
+            parse_restart, (void *)KEEP_ALIVE) ||
+        !bench_run(
+            "request_parse/segmented_incremental", strlen(KEEP_ALIVE),
+            parse_incremental, (void *)KEEP_ALIVE)) {
+        return false;
+    }
+
+    static const char transport[] =
+        "RTP/AVP/TCP;unicast;interleaved=0-1;mode=\"PLAY\", "
+        "RTP/AVP;unicast;client_port=4588-4589";
+    if (!bench_run(
+            "transport_parse", sizeof transport - 1, parse_transport,
+            (void *)transport)) {
+        return false;
+    }
+
+    static char sdp_buffer[1024];
+    SmolRTSP_SdpCache sdp_cache =
+        SmolRTSP_SdpCache_new(sdp_buffer, sizeof sdp_buffer);
+    if (!bench_run("sdp/render", 0, sdp_render, sdp_buffer) ||
+        !bench_run("sdp/cached", 0, sdp_cached, &sdp_cache)) {
+        return false;
+    }
+
+    static char buffer[1024];
+    SerializeCtx ctx = {
+        .response = setup_response(),
+        .w = smolrtsp_string_writer(buffer),
+        .buffer = buffer,
+    };
+    if (!serialize(&ctx, 1)) {
+        return false;
+    }
+    const size_t response_len = strlen(buffer);
+
+    if (!bench_run(
+            "response_serialize/string", response_len, serialize, &ctx)) {
+        return false;
+    }
+
+    SmolRTSP_StringBuffer sb = SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+    const SerializeCtx sb_ctx = {
+        .response = ctx.response,
+        .w = smolrtsp_string_buffer_writer(&sb),
+    };
+    if (!bench_run(
+            "response_serialize/string_buffer", response_len,
+            serialize_string_buffer, (void *)&sb_ctx)) {
+        return false;
+    }
+
+    if (!bench_run("respond/context", 0, respond, buffer)) {
+        return false;
+    }
+
+    FILE *stream = fopen("/dev/null", "w");
+    if (NULL == stream) {
+        perror("/dev/null");
+        return false;
+    }
+    ctx.w = smolrtsp_file_writer(stream);
+    ctx.buffer = NULL;
+    const bool file_ok =
+        bench_run("response_serialize/file", response_len, serialize, &ctx);
+    fclose(stream);
+    if (!file_ok) {
+        return false;
+    }
+
+    int fd = open("/dev/null", O_WRONLY);
+    if (-1 == fd) {
+        perror("/dev/null");
+        return false;
+    }
+    ctx.w = smolrtsp_fd_writer(&fd);
+    const bool fd_ok =
+        bench_run("response_serialize/fd", response_len, serialize, &ctx) &&
+        bench_run(
+            "response_serialize/buffered_fd", response_len, serialize_buffered,
+            &ctx);
+    close(fd);
+
+    return fd_ok;
+}
@@ -0,0 +1,9 @@
+// The benchmark suites. Each returns false if one of its benchmarks fails.
+
+#pragma once
+
+#include <stdbool.h>
+
+bool bench_rtsp(void);
+bool bench_rtp(void);
+bool bench_nal(void);
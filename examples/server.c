@@ -52,6 +52,10 @@
 #define AUDIO_PACKETIZATION_TIME_US                                            \
     (1e6 / (AUDIO_SAMPLE_RATE / AUDIO_SAMPLES_PER_PACKET))
 
+// 20 ms frames are aggregated into 60 ms packets, three per timer tick.
+#define AUDIO_PTIME_MS        60
+#define AUDIO_FRAMES_PER_TICK 3
+
 #define VIDEO_PAYLOAD_TYPE 96 // dynamic PT
 #define VIDEO_SAMPLE_RATE  90000
 #define VIDEO_FPS          25
@@ -257,8 +261,10 @@ Client_describe(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
     (void)self;
     (void)req;
 
-    char sdp_buf[1024] = {0};
-    SmolRTSP_Writer sdp = smolrtsp_string_writer(sdp_buf);
+    char sdp_buf[1024];
+    SmolRTSP_StringBuffer sdp_str =
+        SmolRTSP_StringBuffer_new(sdp_buf, sizeof sdp_buf);
+    SmolRTSP_Writer sdp = smolrtsp_string_buffer_writer(&sdp_str);
     ssize_t ret = 0;
 
     // clang-format off
@@ -274,7 +280,8 @@ Client_describe(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
     SMOLRTSP_SDP_DESCRIBE(
         ret, sdp,
         (SMOLRTSP_SDP_MEDIA, "audio 0 RTP/AVP %d", AUDIO_PCMU_PAYLOAD_TYPE),
-        (SMOLRTSP_SDP_ATTR, "control:audio"));
+        (SMOLRTSP_SDP_ATTR, "control:audio"),
+        (SMOLRTSP_SDP_ATTR, "ptime:%d", AUDIO_PTIME_MS));
 #endif
 
 #ifdef ENABLE_VIDEO
@@ -291,7 +298,7 @@ Client_describe(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
     assert(ret > 0);
 
     smolrtsp_header(ctx, SMOLRTSP_HEADER_CONTENT_TYPE, "application/sdp");
-    smolrtsp_body(ctx, CharSlice99_from_str(sdp_buf));
+    smolrtsp_body(ctx, SmolRTSP_StringBuffer_as_slice(&sdp_str));
 
     smolrtsp_respond_ok(ctx);
 }
@@ -559,6 +566,13 @@ static SmolRTSP_Droppable play_audio(
         .bev = bev,
     };
 
+    SmolRTSP_RtpAudioAggregationConfig aggregation =
+        SmolRTSP_RtpAudioAggregationConfig_default();
+    aggregation.ptime_ms = AUDIO_PTIME_MS;
+    if (SmolRTSP_RtpTransport_enable_audio_aggregation(t, aggregation) == -1) {
+        perror("Failed to enable audio aggregation");
+    }
+
     ctx->ev = event_new(
         base, -1, EV_PERSIST | EV_TIMEOUT, send_audio_packet_cb, (void *)ctx);
     assert(ctx->ev);
@@ -566,7 +580,8 @@ static SmolRTSP_Droppable play_audio(
     event_add(
         ctx->ev, &(const struct timeval){
                      .tv_sec = 0,
-                     .tv_usec = AUDIO_PACKETIZATION_TIME_US,
+                     .tv_usec =
+                         AUDIO_PACKETIZATION_TIME_US * AUDIO_FRAMES_PER_TICK,
                  });
     *ev = ctx->ev;
     (*streams_playing)++;
@@ -580,35 +595,37 @@ static void send_audio_packet_cb(evutil_socket_t fd, short events, void *arg) {
 
     AudioCtx *ctx = arg;
 
-    if (ctx->i * AUDIO_SAMPLES_PER_PACKET >= ___media_audio_g711a_len) {
-        event_del(ctx->ev);
-        (*ctx->streams_playing)--;
-        if (0 == *ctx->streams_playing) {
-            bufferevent_trigger_event(ctx->bev, BEV_EVENT_EOF, 0);
+    for (int frame = 0; frame < AUDIO_FRAMES_PER_TICK; frame++) {
+        if (ctx->i * AUDIO_SAMPLES_PER_PACKET >= ___media_audio_g711a_len) {
+            if (SmolRTSP_RtpTransport_flush_audio(ctx->transport) == -1) {
+                perror("Failed to send RTP/PCMU");
+            }
+            event_del(ctx->ev);
+            (*ctx->streams_playing)--;
+            if (0 == *ctx->streams_playing) {
+                bufferevent_trigger_event(ctx->bev, BEV_EVENT_EOF, 0);
+            }
+            return;
         }
-        return;
-    }
 
-    const SmolRTSP_RtpTimestamp ts =
-        SmolRTSP_RtpTimestamp_Raw(ctx->i * AUDIO_SAMPLES_PER_PACKET);
-    const bool marker = false;
-    const size_t samples_count =
-        ___media_audio_g711a_len <
-                ctx->i * AUDIO_SAMPLES_PER_PACKET + AUDIO_SAMPLES_PER_PACKET
-            ? ___media_audio_g711a_len % AUDIO_SAMPLES_PER_PACKET
-            : AUDIO_SAMPLES_PER_PACKET;
-    const U8Slice99 header = U8Slice99_empty(),
-                    payload = U8Slice99_new(
-                        ___media_audio_g711a +
-                            ctx->i * AUDIO_SAMPLES_PER_PACKET,
-                        samples_count);
-
-    if (SmolRTSP_RtpTransport_send_packet(
-            ctx->transport, ts, marker, header, payload) == -1) {
-        perror("Failed to send RTP/PCMU");
-    }
+        const SmolRTSP_RtpTimestamp ts =
+            SmolRTSP_RtpTimestamp_Raw(ctx->i * AUDIO_SAMPLES_PER_PACKET);
+        const size_t samples_count =
+            ___media_audio_g711a_len <
+                    ctx->i * AUDIO_SAMPLES_PER_PACKET + AUDIO_SAMPLES_PER_PACKET
+                ? ___media_audio_g711a_len % AUDIO_SAMPLES_PER_PACKET
+                : AUDIO_SAMPLES_PER_PACKET;
+        const U8Slice99 samples = U8Slice99_new(
+            ___media_audio_g711a + ctx->i * AUDIO_SAMPLES_PER_PACKET,
+            samples_count);
+
+        if (SmolRTSP_RtpTransport_send_audio_frame(
+                ctx->transport, ts, samples, (uint32_t)samples_count) == -1) {
+            perror("Failed to send RTP/PCMU");
+        }
 
-    ctx->i++;
+        ctx->i++;
+    }
 }
 
 static void VideoCtx_drop(VSelf) {
@@ -679,7 +696,10 @@ again:
 
     const size_t start_code_len = ctx->start_code_tester(ctx->video);
     if (0 == start_code_len) {
-        ctx->video = U8Slice99_advance(ctx->video, 1);
+        // Jump right to the next start code instead of testing every byte.
+        const U8Slice99 rest = U8Slice99_advance(ctx->video, 1);
+        ctx->video =
+            U8Slice99_advance(rest, smolrtsp_find_next_start_code(rest));
         goto again;
     }
 
@@ -23,22 +23,62 @@
 #include <smolrtsp/types/reason_phrase.h>
 #include <smolrtsp/types/request.h>
 #include <smolrtsp/types/request_line.h>
+#include <smolrtsp/types/request_parser.h>
 #include <smolrtsp/types/request_uri.h>
 #include <smolrtsp/types/response.h>
 #include <smolrtsp/types/response_line.h>
+#include <smolrtsp/types/rtcp.h>
 #include <smolrtsp/types/rtp.h>
 #include <smolrtsp/types/rtsp_version.h>
 #include <smolrtsp/types/sdp.h>
 #include <smolrtsp/types/status_code.h>
 
+#include <smolrtsp/admission.h>
+#include <smolrtsp/allocator.h>
+#include <smolrtsp/bandwidth_estimator.h>
+#include <smolrtsp/client.h>
 #include <smolrtsp/context.h>
 #include <smolrtsp/controller.h>
+#include <smolrtsp/demuxer.h>
+#include <smolrtsp/digest_auth.h>
 #include <smolrtsp/droppable.h>
+#include <smolrtsp/fec.h>
+#include <smolrtsp/gop_cache.h>
+#include <smolrtsp/frame_queue.h>
 #include <smolrtsp/io_vec.h>
+#include <smolrtsp/jitter_buffer.h>
+#include <smolrtsp/latency_histogram.h>
+#include <smolrtsp/live_source.h>
+#include <smolrtsp/media_file.h>
+#include <smolrtsp/multicast.h>
 #include <smolrtsp/nal.h>
+#include <smolrtsp/nal_length.h>
+#include <smolrtsp/nal_rbsp.h>
+#include <smolrtsp/nal_splitter.h>
 #include <smolrtsp/nal_transport.h>
+#include <smolrtsp/numa.h>
 #include <smolrtsp/option.h>
+#include <smolrtsp/packet_pool.h>
+#include <smolrtsp/packetized_file.h>
+#include <smolrtsp/pacer.h>
+#include <smolrtsp/param_set_cache.h>
+#include <smolrtsp/rtp_clock.h>
+#include <smolrtsp/rtp_depacketizer.h>
+#include <smolrtsp/rtp_fanout.h>
 #include <smolrtsp/rtp_transport.h>
+#include <smolrtsp/sdp_cache.h>
+#include <smolrtsp/send_workers.h>
+#include <smolrtsp/server.h>
+#include <smolrtsp/session_registry.h>
+#include <smolrtsp/shm_ring.h>
+#include <smolrtsp/srtp.h>
+#include <smolrtsp/tcp_scheduler.h>
+#include <smolrtsp/timer_wheel.h>
+#include <smolrtsp/track_scheduler.h>
 #include <smolrtsp/transport.h>
+#include <smolrtsp/udp_receiver.h>
+#include <smolrtsp/udp_sender.h>
+#include <smolrtsp/uring.h>
 #include <smolrtsp/util.h>
 #include <smolrtsp/writer.h>
+#include <smolrtsp/xdp.h>
@@ -0,0 +1,215 @@
+/**
+ * @file
+ * @brief Egress-aware admission control of `SETUP` and `PLAY`.
+ */
+
+#pragma once
+
+#include <smolrtsp/context.h>
+#include <smolrtsp/controller.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/types/request.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The default value for #SmolRTSP_AdmissionConfig.window_us (one second).
+ */
+#define SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US 1000000
+
+/**
+ * The configuration structure for #SmolRTSP_Admission.
+ */
+typedef struct {
+    /**
+     * The egress budget in bits per second, or 0 for no limit.
+     */
+    uint64_t max_bitrate;
+
+    /**
+     * The egress budget in packets per second, or 0 for no limit.
+     */
+    uint64_t max_packet_rate;
+
+    /**
+     * The expected bitrate of a new session.
+     *
+     * A session admitted within the current measurement window is not
+     * reflected in the measured rates yet, so it is accounted with this
+     * estimate instead. Otherwise, all the viewers of a rush would be admitted
+     * before the meter catches up.
+     */
+    uint64_t session_bitrate;
+
+    /**
+     * The expected packet rate of a new session, as `session_bitrate`.
+     */
+    uint64_t session_packet_rate;
+
+    /**
+     * The length of the measurement window in microseconds.
+     */
+    uint64_t window_us;
+
+    /**
+     * The clock in microseconds; if `NULL`, `CLOCK_MONOTONIC` is used.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_AdmissionConfig;
+
+/**
+ * Returns the default #SmolRTSP_AdmissionConfig.
+ *
+ * The default values are:
+ *
+ *  - `max_bitrate`, `max_packet_rate`, `session_bitrate`, and
+ * `session_packet_rate` are 0, i.e., everything is admitted.
+ *  - `window_us` is #SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US.
+ *  - `clock_us` is `NULL`.
+ */
+SmolRTSP_AdmissionConfig
+SmolRTSP_AdmissionConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The egress rates measured by #SmolRTSP_Admission.
+ */
+typedef struct {
+    /**
+     * Bits per second.
+     */
+    uint64_t bitrate;
+
+    /**
+     * Packets per second.
+     */
+    uint64_t packet_rate;
+} SmolRTSP_EgressRates;
+
+/**
+ * An egress meter together with a budget for admitting new sessions.
+ *
+ * The transports of the sessions are wrapped with #smolrtsp_transport_metered,
+ * which counts every packet they transmit. The rates are measured over
+ * consecutive windows of #SmolRTSP_AdmissionConfig.window_us; a new session is
+ * admitted while the rates of the last window plus the estimates of the
+ * sessions admitted since then stay within the budget. Call
+ * #SmolRTSP_Admission_rates periodically (e.g., from #SmolRTSP_ServerTickCb),
+ * so that a window does not stretch over an idle period.
+ *
+ * Create one admission per worker (see #SmolRTSP_ServerConnection_worker) to
+ * keep the load of each worker within what it can sustain. Counting is
+ * lock-free, and the admission can be shared between threads.
+ */
+typedef struct SmolRTSP_Admission SmolRTSP_Admission;
+
+/**
+ * Creates a new admission with @p config.
+ *
+ * @pre `config.window_us > 0`
+ *
+ * @return The admission, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_Admission *
+SmolRTSP_Admission_new(SmolRTSP_AdmissionConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Counts @p packets_count packets of @p bytes bytes in total as transmitted.
+ *
+ * #smolrtsp_transport_metered calls it automatically; call it yourself for the
+ * traffic sent by other means.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_Admission_record(
+    SmolRTSP_Admission *self, uint64_t packets_count, uint64_t bytes);
+
+/**
+ * Returns the rates measured over the last complete window.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_EgressRates
+SmolRTSP_Admission_rates(SmolRTSP_Admission *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Tests whether the budget is exhausted, i.e., one more session would exceed
+ * it.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_Admission_is_over_budget(SmolRTSP_Admission *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Admits a new session unless the budget is exhausted.
+ *
+ * On success, the estimates of the session are accounted until the end of the
+ * current window.
+ *
+ * @return Whether the session is admitted.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_Admission_try_admit(SmolRTSP_Admission *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of requests rejected by #smolrtsp_admission_check.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_Admission_rejected(const SmolRTSP_Admission *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Admission.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Admission);
+
+/**
+ * Rejects @p req with `453 Not Enough Bandwidth` if it would start a new
+ * session beyond the budget of @p self.
+ *
+ * Meant to be called from the `before` method of a controller, which should
+ * return the result:
+ *
+ *  - `SETUP` is rejected if #SmolRTSP_Admission_is_over_budget.
+ *  - `PLAY` is admitted via #SmolRTSP_Admission_try_admit.
+ *  - Other requests, including `TEARDOWN`, are always continued, so that the
+ * existing sessions are not affected.
+ *
+ * @return #SmolRTSP_ControlFlow_Break if the response has been sent,
+ * #SmolRTSP_ControlFlow_Continue otherwise.
+ *
+ * @pre `self != NULL`
+ * @pre `ctx != NULL`
+ * @pre `req != NULL`
+ */
+SmolRTSP_ControlFlow smolrtsp_admission_check(
+    SmolRTSP_Admission *self, SmolRTSP_Context *ctx,
+    const SmolRTSP_Request *restrict req) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a transport counting the packets transmitted through @p t in
+ * @p admission.
+ *
+ * The new transport takes ownership of @p t: it is dropped together with the
+ * new transport.
+ *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails; @p t is left to the caller then.
+ *
+ * @pre `t.self && t.vptr`
+ * @pre `admission != NULL`
+ */
+SmolRTSP_Transport smolrtsp_transport_metered(
+    SmolRTSP_Transport t,
+    SmolRTSP_Admission *admission) SMOLRTSP_PRIV_MUST_USE;
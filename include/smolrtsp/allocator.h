@@ -0,0 +1,248 @@
+/**
+ * @file
+ * @brief Pluggable memory allocation.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * An allocator through which the library allocates and frees all its memory.
+ *
+ * The functions follow their libc counterparts, except that they also accept
+ * #SmolRTSP_Allocator.user_data, @p realloc is never called with a null
+ * pointer, and @p free is never called with a null pointer. An allocation
+ * failure is reported by returning `NULL`.
+ *
+ * The functions can be called from any thread that uses the library.
+ */
+typedef struct {
+    /**
+     * Allocates @p size bytes.
+     */
+    void *(*malloc)(void *user_data, size_t size);
+
+    /**
+     * Resizes the allocation @p ptr to @p size bytes.
+     */
+    void *(*realloc)(void *user_data, void *ptr, size_t size);
+
+    /**
+     * Frees the allocation @p ptr.
+     */
+    void (*free)(void *user_data, void *ptr);
+
+    /**
+     * Some user-defined data passed to the functions.
+     */
+    void *user_data;
+} SmolRTSP_Allocator;
+
+/**
+ * Returns the allocator that calls libc `malloc`, `realloc`, and `free`, which
+ * is the default unless the library is built with `SMOLRTSP_STATIC_POOLS`.
+ */
+SmolRTSP_Allocator SmolRTSP_Allocator_libc(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The number of block sizes of #SmolRTSP_Pools.
+ */
+#define SMOLRTSP_POOL_CLASSES 8
+
+/**
+ * The block size of the class @p i of #SmolRTSP_Pools: 64 bytes, 256 bytes,
+ * 1 KiB, and so on up to 1 MiB.
+ */
+#define SMOLRTSP_POOL_BLOCK_SIZE(i) ((size_t)64 << (2 * (i)))
+
+/**
+ * The alignment of the arena of #SmolRTSP_Pools and of its blocks.
+ */
+#define SMOLRTSP_POOL_ALIGNMENT 16
+
+/**
+ * The size of the arena of #SmolRTSP_Pools holding @p b0 blocks of 64 bytes,
+ * @p b1 blocks of 256 bytes, and so on, suitable for a static array.
+ */
+#define SMOLRTSP_POOLS_ARENA_SIZE(b0, b1, b2, b3, b4, b5, b6, b7)              \
+    ((b0)*SMOLRTSP_POOL_BLOCK_SIZE(0) + (b1)*SMOLRTSP_POOL_BLOCK_SIZE(1) +     \
+     (b2)*SMOLRTSP_POOL_BLOCK_SIZE(2) + (b3)*SMOLRTSP_POOL_BLOCK_SIZE(3) +     \
+     (b4)*SMOLRTSP_POOL_BLOCK_SIZE(4) + (b5)*SMOLRTSP_POOL_BLOCK_SIZE(5) +     \
+     (b6)*SMOLRTSP_POOL_BLOCK_SIZE(6) + (b7)*SMOLRTSP_POOL_BLOCK_SIZE(7))
+
+/**
+ * A class of blocks of the same size of #SmolRTSP_Pools.
+ *
+ * All the fields are private to the pools.
+ */
+typedef struct {
+    /**
+     * The offset of the first block in the arena.
+     */
+    size_t offset;
+
+    /**
+     * The number of blocks, of which the first `unused` have never been
+     * allocated.
+     */
+    size_t blocks, unused;
+
+    /**
+     * The number of allocated blocks and its high-water mark.
+     */
+    size_t used, peak;
+
+    /**
+     * The number of allocations that have found no free block.
+     */
+    uint64_t failures;
+
+    /**
+     * The freed blocks, each pointing to the next one.
+     */
+    void *free_list;
+} SmolRTSP_PoolClass;
+
+/**
+ * Fixed-size blocks carved out of a caller-provided arena, for a heap-free
+ * allocator with a RAM ceiling known at build time.
+ *
+ * An allocation takes a block of the smallest class that fits it and fails
+ * if there is none left, even if a larger class has free blocks. Blocks are
+ * allocated and freed in constant time.
+ *
+ * All the fields are private; initialize the pools with #SmolRTSP_Pools_init.
+ */
+typedef struct {
+    /**
+     * The arena.
+     */
+    uint8_t *arena;
+
+    /**
+     * The size of the arena used by the classes.
+     */
+    size_t size;
+
+    /**
+     * The classes, by increasing block size.
+     */
+    SmolRTSP_PoolClass classes[SMOLRTSP_POOL_CLASSES];
+
+    /**
+     * A spinlock guarding the classes.
+     */
+    bool locked;
+} SmolRTSP_Pools;
+
+/**
+ * The statistics of a class of #SmolRTSP_Pools.
+ */
+typedef struct {
+    /**
+     * The size of a block of the class.
+     */
+    size_t block_size;
+
+    /**
+     * The number of blocks of the class.
+     */
+    size_t blocks;
+
+    /**
+     * The number of blocks currently allocated.
+     */
+    size_t used;
+
+    /**
+     * The maximum number of blocks that have been allocated at once.
+     */
+    size_t peak;
+
+    /**
+     * The number of allocations of the class that have failed.
+     */
+    uint64_t failures;
+} SmolRTSP_PoolStats;
+
+/**
+ * Initializes pools of @p blocks[i] blocks of #SMOLRTSP_POOL_BLOCK_SIZE(i)
+ * bytes in the @p size bytes of @p arena.
+ *
+ * @pre `self != NULL`
+ * @pre @p arena is aligned to #SMOLRTSP_POOL_ALIGNMENT.
+ *
+ * @return 0 on success, -1 if @p arena is smaller than
+ * #SMOLRTSP_POOLS_ARENA_SIZE of @p blocks (and sets `errno` to `EINVAL`).
+ */
+int SmolRTSP_Pools_init(
+    SmolRTSP_Pools *self, void *arena, size_t size,
+    const size_t blocks[SMOLRTSP_POOL_CLASSES]) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of the class @p i of @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `i < SMOLRTSP_POOL_CLASSES`
+ */
+SmolRTSP_PoolStats
+SmolRTSP_Pools_stats(SmolRTSP_Pools *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the allocator that allocates from @p pools.
+ *
+ * An allocation larger than the largest class fails; a reallocation within the
+ * block size keeps its block.
+ *
+ * @pre `pools != NULL`
+ */
+SmolRTSP_Allocator
+SmolRTSP_Allocator_pools(SmolRTSP_Pools *pools) SMOLRTSP_PRIV_MUST_USE;
+
+#ifdef SMOLRTSP_STATIC_POOLS
+
+/**
+ * Returns the pools of the `SMOLRTSP_STATIC_POOLS` build, allocated
+ * statically with the numbers of blocks of the `SMOLRTSP_POOL_BLOCKS` CMake
+ * option, from which the library allocates by default.
+ */
+SmolRTSP_Pools *smolrtsp_static_pools(void) SMOLRTSP_PRIV_MUST_USE;
+
+#endif
+
+/**
+ * Sets the allocator of the library.
+ *
+ * The memory is always freed by the current allocator, so it must be set
+ * before any object is created and must not be changed while any object is
+ * alive. This function is not thread-safe.
+ *
+ * No function of the library aborts if an allocation fails, so that running
+ * out of memory (e.g., exhausting #SmolRTSP_Pools) is an ordinary runtime
+ * event. The functions creating objects (e.g., #SmolRTSP_Context_new,
+ * #SmolRTSP_NalTransport_new, #SmolRTSP_MediaFile_open,
+ * #SmolRTSP_SessionRegistry_create) set `errno` to `ENOMEM` and return `NULL`
+ * or a transport with `self == NULL`. The functions that allocate as they go
+ * (e.g., #SmolRTSP_ParamSetCache_update, and through it the `send` functions
+ * of #SmolRTSP_NalTransport, #SmolRTSP_NalSplitter_next,
+ * #SmolRTSP_GopCache_push, #SmolRTSP_RtpFanout_subscribe,
+ * #SmolRTSP_SendQueue_push, #SmolRTSP_FrameQueue_push,
+ * #SmolRTSP_MulticastPool_acquire) return -1 with `errno` set to `ENOMEM`;
+ * #smolrtsp_header and #smolrtsp_vheader skip the header and make
+ * #SmolRTSP_Context_get_ret return -1. #SmolRTSP_Server closes a connection
+ * that it cannot allocate and counts it in
+ * #SmolRTSP_ServerWorkerStats.rejected_connections.
+ *
+ * @pre `allocator.malloc && allocator.realloc && allocator.free`
+ */
+void smolrtsp_set_allocator(SmolRTSP_Allocator allocator);
+
+/**
+ * Returns the allocator of the library.
+ */
+SmolRTSP_Allocator smolrtsp_allocator(void) SMOLRTSP_PRIV_MUST_USE;
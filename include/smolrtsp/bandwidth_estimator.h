@@ -0,0 +1,245 @@
+/**
+ * @file
+ * @brief Send-side bandwidth estimation from transport-wide feedback.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/types/rtcp.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The default value for #SmolRTSP_BandwidthEstimatorConfig.initial_bitrate
+ * (1 Mbit/s).
+ */
+#define SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE 1000000
+
+/**
+ * The default value for #SmolRTSP_BandwidthEstimatorConfig.min_bitrate
+ * (100 kbit/s).
+ */
+#define SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MIN_BITRATE 100000
+
+/**
+ * The default value for #SmolRTSP_BandwidthEstimatorConfig.max_bitrate
+ * (50 Mbit/s).
+ */
+#define SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MAX_BITRATE 50000000
+
+/**
+ * The default value for #SmolRTSP_BandwidthEstimatorConfig.history_size.
+ */
+#define SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_HISTORY_SIZE 4096
+
+/**
+ * The state of the network path inferred from the one-way delay variation.
+ */
+typedef enum {
+    /**
+     * The delay is stable: the path is not congested.
+     */
+    SmolRTSP_BandwidthUsage_Normal,
+
+    /**
+     * The delay grows: a queue builds up on the path.
+     */
+    SmolRTSP_BandwidthUsage_Overusing,
+
+    /**
+     * The delay shrinks: a queue on the path drains.
+     */
+    SmolRTSP_BandwidthUsage_Underusing,
+} SmolRTSP_BandwidthUsage;
+
+/**
+ * The configuration structure for #SmolRTSP_BandwidthEstimator.
+ */
+typedef struct {
+    /**
+     * The estimate before any feedback, in bits per second.
+     */
+    uint64_t initial_bitrate;
+
+    /**
+     * The lower bound of the estimate, in bits per second.
+     */
+    uint64_t min_bitrate;
+
+    /**
+     * The upper bound of the estimate, in bits per second.
+     */
+    uint64_t max_bitrate;
+
+    /**
+     * The number of the last sent packets whose send times are kept until
+     * their feedback arrives, a power of two from 2 to 32768.
+     */
+    size_t history_size;
+} SmolRTSP_BandwidthEstimatorConfig;
+
+/**
+ * Returns the default #SmolRTSP_BandwidthEstimatorConfig.
+ *
+ * The default values are:
+ *
+ *  - `initial_bitrate` is
+ * #SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE.
+ *  - `min_bitrate` is #SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MIN_BITRATE.
+ *  - `max_bitrate` is #SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MAX_BITRATE.
+ *  - `history_size` is #SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_HISTORY_SIZE.
+ */
+SmolRTSP_BandwidthEstimatorConfig
+SmolRTSP_BandwidthEstimatorConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The statistics of #SmolRTSP_BandwidthEstimator.
+ *
+ * All the bitrates are in bits per second.
+ */
+typedef struct {
+    /**
+     * The estimate: the smaller one of #delay_based_bitrate and
+     * #loss_based_bitrate within the configured bounds.
+     */
+    uint64_t target_bitrate;
+
+    /**
+     * The estimate of the delay-based controller.
+     */
+    uint64_t delay_based_bitrate;
+
+    /**
+     * The estimate of the loss-based controller.
+     */
+    uint64_t loss_based_bitrate;
+
+    /**
+     * The rate at which the receiver has got the packets, or 0 until enough
+     * of them are acknowledged.
+     */
+    uint64_t acked_bitrate;
+
+    /**
+     * The last state of the path.
+     */
+    SmolRTSP_BandwidthUsage usage;
+
+    /**
+     * The fraction of the packets lost in the last loss interval, as a fixed
+     * point number with the binary point at the left edge.
+     */
+    uint8_t fraction_lost;
+
+    /**
+     * The number of feedback packets processed.
+     */
+    uint64_t feedbacks;
+
+    /**
+     * The number of packets reported as received.
+     */
+    uint64_t packets_acked;
+
+    /**
+     * The number of packets reported as lost.
+     */
+    uint64_t packets_lost;
+} SmolRTSP_BandwidthEstimatorStats;
+
+/**
+ * A send-side bandwidth estimator following Google Congestion Control
+ * (draft-ietf-rmcat-gcc-02).
+ *
+ * The estimator pairs the send time of every packet, identified by its
+ * transport-wide sequence number, with its arrival time from transport-wide
+ * feedback, which comes once per tens of milliseconds instead of once per
+ * RTCP report interval. Its delay-based controller groups the packets sent
+ * within 5 ms, feeds the variation of the one-way delay between groups into a
+ * trendline filter, and compares the trend with an adaptive threshold: the
+ * rate grows while the delay is stable, holds while a queue drains, and drops
+ * to 85% of the acknowledged rate once a queue builds up. Its loss-based
+ * controller cuts the rate when more than 10% of the packets are lost and lets
+ * it grow when less than 2% are.
+ *
+ * The target bitrate is meant to drive #SmolRTSP_Pacer_set_rate (divided by
+ * 8), frame thinning, and the choice of a bitrate rendition. All the RTP
+ * transports of a client share an estimator, together with the counter of the
+ * transport-wide sequence numbers (see
+ * #SmolRTSP_RtpExtensionsConfig.transport_wide_seq_num and
+ * #SmolRTSP_RtpTransport_set_bandwidth_estimator). An estimator must be used
+ * from a single thread.
+ */
+typedef struct SmolRTSP_BandwidthEstimator SmolRTSP_BandwidthEstimator;
+
+/**
+ * Creates a new estimator with @p config.
+ *
+ * @pre `config.min_bitrate > 0`
+ * @pre `config.min_bitrate <= config.initial_bitrate`
+ * @pre `config.initial_bitrate <= config.max_bitrate`
+ * @pre `config.history_size` is a power of two from 2 to 32768.
+ *
+ * @return The estimator, or `NULL` if an allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_BandwidthEstimator *SmolRTSP_BandwidthEstimator_new(
+    SmolRTSP_BandwidthEstimatorConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Records the packet of @p transport_wide_seq_num and @p size bytes sent at
+ * @p time_us.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_BandwidthEstimator_on_packet_sent(
+    SmolRTSP_BandwidthEstimator *self, uint16_t transport_wide_seq_num,
+    size_t size, uint64_t time_us);
+
+/**
+ * Updates the estimate of @p self from the transport-wide feedback @p packet
+ * received at @p time_us.
+ *
+ * The statuses of the packets not recorded by
+ * #SmolRTSP_BandwidthEstimator_on_packet_sent, or already acknowledged by a
+ * previous feedback, are ignored.
+ *
+ * @pre `self != NULL`
+ * @pre `packet.packet_ty == SMOLRTSP_RTCP_RTPFB`
+ * @pre `packet.count == SMOLRTSP_RTCP_FMT_TRANSPORT_CC`
+ * @pre @p packet is returned by #SmolRTSP_RtcpPacket_parse.
+ *
+ * @return 0 on success, -1 if @p packet is malformed (`errno` is set to
+ * `EBADMSG`).
+ */
+int SmolRTSP_BandwidthEstimator_on_feedback(
+    SmolRTSP_BandwidthEstimator *self, SmolRTSP_RtcpPacket packet,
+    uint64_t time_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the estimate of @p self in bits per second.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_BandwidthEstimator_target_bitrate(
+    const SmolRTSP_BandwidthEstimator *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_BandwidthEstimatorStats SmolRTSP_BandwidthEstimator_stats(
+    const SmolRTSP_BandwidthEstimator *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_BandwidthEstimator.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_BandwidthEstimator);
@@ -0,0 +1,271 @@
+/**
+ * @file
+ * @brief An RTSP client pulling H.264/H.265 streams from upstream sources.
+ */
+
+#pragma once
+
+#include <smolrtsp/demuxer.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/types/status_code.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/socket.h>
+
+#include <interface99.h>
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum number of video tracks set up per session: an RTP/RTCP pair of
+ * interleaved channels each.
+ */
+#define SMOLRTSP_CLIENT_MAX_TRACKS (SMOLRTSP_DEMUXER_MAX_CHANNELS / 2)
+
+/**
+ * A set of upstream RTSP sessions multiplexed over a single `epoll` loop.
+ *
+ * A session connects to the source, sends `DESCRIBE`, and sets up every
+ * H.264/H.265 video track of the SDP description with RTP interleaved into the
+ * RTSP connection (`RTP/AVP/TCP`), so that it costs a single socket. Once the
+ * first `SETUP` has established the session, the `SETUP`s of the remaining
+ * tracks and `PLAY` are sent at once without waiting for one another, so the
+ * whole handshake takes three round trips however many tracks there are.
+ *
+ * The received RTP packets are depacketized (see #SmolRTSP_RtpDepacketizer),
+ * and their NAL units are handed to #SmolRTSP_ClientHandler. Every session
+ * has a receive buffer and a send buffer allocated once, which the responses
+ * and the interleaved frames are parsed from in place.
+ *
+ * A client is driven by #SmolRTSP_Client_poll and must be used from a single
+ * thread; run a client per thread to spread the sessions over several.
+ */
+typedef struct SmolRTSP_Client SmolRTSP_Client;
+
+/**
+ * An upstream session of #SmolRTSP_Client.
+ */
+typedef struct SmolRTSP_ClientSession SmolRTSP_ClientSession;
+
+/**
+ * The state of #SmolRTSP_ClientSession.
+ */
+typedef enum {
+    /**
+     * Connecting to the source.
+     */
+    SmolRTSP_ClientState_Connecting,
+
+    /**
+     * Waiting for the SDP description.
+     */
+    SmolRTSP_ClientState_Describing,
+
+    /**
+     * Setting up the tracks.
+     */
+    SmolRTSP_ClientState_SettingUp,
+
+    /**
+     * Waiting for the response to `PLAY`.
+     */
+    SmolRTSP_ClientState_Starting,
+
+    /**
+     * Receiving the media.
+     */
+    SmolRTSP_ClientState_Playing,
+} SmolRTSP_ClientState;
+
+/**
+ * A receiver of the events of #SmolRTSP_ClientSession.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+#define SmolRTSP_ClientHandler_IFACE                                           \
+                                                                               \
+    /*                                                                         \
+     * Invoked once the source has accepted `PLAY`.                            \
+     */                                                                        \
+    vfunc99(void, on_playing, VSelf99, SmolRTSP_ClientSession *session)        \
+                                                                               \
+    /*                                                                         \
+     * Handles a NAL unit received on the track @p track_id with the RTP       \
+     * timestamp @p timestamp.                                                 \
+     *                                                                         \
+     * @p nalu is valid only during the call.                                  \
+     */                                                                        \
+    vfunc99(                                                                   \
+        void, on_nal_unit, VSelf99, SmolRTSP_ClientSession *session,           \
+        size_t track_id, uint32_t timestamp, SmolRTSP_NalUnit nalu)            \
+                                                                               \
+    /*                                                                         \
+     * Invoked when the session has ended, right before it is freed.           \
+     *                                                                         \
+     * @p error is 0 if the source has closed the connection, `EPROTO` if the  \
+     * source has responded with the non-2xx status code @p status (0          \
+     * otherwise) or has no H.264/H.265 video track, and the error of the      \
+     * socket otherwise.                                                       \
+     */                                                                        \
+    vfunc99(                                                                   \
+        void, on_close, VSelf99, SmolRTSP_ClientSession *session, int error,   \
+        SmolRTSP_StatusCode status)
+
+/**
+ * Defines the `SmolRTSP_ClientHandler` interface.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+interface99(SmolRTSP_ClientHandler);
+
+/**
+ * The configuration of #SmolRTSP_Client.
+ */
+typedef struct {
+    /**
+     * The size of the receive buffer of a session, which bounds the size of a
+     * response and of an interleaved frame.
+     */
+    size_t recv_buffer_size;
+
+    /**
+     * The size of the send buffer of a session.
+     */
+    size_t send_buffer_size;
+
+    /**
+     * The maximum size of a fragmented NAL unit received (see
+     * #SmolRTSP_RtpDepacketizer_new).
+     */
+    size_t max_nalu_size;
+
+    /**
+     * Whether to send the `SETUP`s of the tracks after the first one and
+     * `PLAY` without waiting for the responses; disable it for sources that
+     * mishandle pipelined requests.
+     */
+    bool pipelining;
+
+    /**
+     * The period of the `OPTIONS` requests keeping a playing session alive,
+     * or 0 to send none.
+     */
+    int keepalive_interval_ms;
+} SmolRTSP_ClientConfig;
+
+/**
+ * Returns the default configuration: a 64 KiB receive buffer, a 4 KiB send
+ * buffer, NAL units of up to 1 MiB, pipelining, and a keep-alive every 30
+ * seconds.
+ */
+SmolRTSP_ClientConfig
+SmolRTSP_ClientConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a client without sessions.
+ *
+ * @pre `config.recv_buffer_size > 0`
+ * @pre `config.send_buffer_size > 0`
+ * @pre `config.max_nalu_size > 0`
+ *
+ * @return The client, or `NULL` on error (and sets `errno` appropriately).
+ */
+SmolRTSP_Client *
+SmolRTSP_Client_new(SmolRTSP_ClientConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the `epoll` file descriptor of @p self, which becomes readable when
+ * #SmolRTSP_Client_poll has work to do (e.g., to nest @p self into another
+ * event loop).
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_Client_fd(const SmolRTSP_Client *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Waits up to @p timeout_ms milliseconds (-1 for no limit) for the sessions of
+ * @p self, and handles their input, output, and keep-alives. The keep-alives
+ * are due only if it is called at least every
+ * #SmolRTSP_ClientConfig.keepalive_interval_ms.
+ *
+ * @pre `self != NULL`
+ *
+ * @return The number of handled events, or -1 on error (and sets `errno`
+ * appropriately).
+ */
+int SmolRTSP_Client_poll(
+    SmolRTSP_Client *self, int timeout_ms) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Starts pulling @p uri from the source at @p addr.
+ *
+ * @param[in] self The client to run the session.
+ * @param[in] addr The address of the source.
+ * @param[in] addr_len The size of @p addr.
+ * @param[in] uri The absolute `rtsp://` URI of the presentation.
+ * @param[in] handler The receiver of the events of the session, which is not
+ * owned by it.
+ *
+ * @pre `self != NULL`
+ * @pre `addr != NULL`
+ * @pre `handler.self && handler.vptr`
+ *
+ * @return The session, or `NULL` if @p uri is too long (and sets `errno` to
+ * `ENAMETOOLONG`) or on error (and sets `errno` appropriately).
+ */
+SmolRTSP_ClientSession *SmolRTSP_Client_open(
+    SmolRTSP_Client *self, const struct sockaddr *addr, socklen_t addr_len,
+    CharSlice99 uri, SmolRTSP_ClientHandler handler) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends `TEARDOWN` if @p self is playing, and frees it without invoking
+ * `on_close`.
+ *
+ * @pre `self != NULL`
+ * @pre It is not called from the handler of @p self.
+ */
+void SmolRTSP_ClientSession_close(SmolRTSP_ClientSession *self);
+
+/**
+ * Returns the state of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_ClientState SmolRTSP_ClientSession_state(
+    const SmolRTSP_ClientSession *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of tracks of @p self, known once the source has
+ * described the presentation.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_ClientSession_tracks_count(
+    const SmolRTSP_ClientSession *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the codec of the track @p track_id of @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `track_id < SmolRTSP_ClientSession_tracks_count(self)`
+ */
+SmolRTSP_NalCodec SmolRTSP_ClientSession_track_codec(
+    const SmolRTSP_ClientSession *self,
+    size_t track_id) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Client.
+ *
+ * Closes all the sessions as #SmolRTSP_ClientSession_close does.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Client);
@@ -25,6 +25,8 @@ typedef struct SmolRTSP_Context SmolRTSP_Context;
 /**
  * Creates a new SmolRTSP context.
  *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails.
+ *
  * @param[in] w The writer to be provided with the response.
  * @param[in] cseq The sequence number for an RTSP request/response pair.
  *
@@ -33,6 +35,18 @@ typedef struct SmolRTSP_Context SmolRTSP_Context;
 SmolRTSP_Context *
 SmolRTSP_Context_new(SmolRTSP_Writer w, uint32_t cseq) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Prepares @p ctx for responding to another request with the sequence number
+ * @p cseq.
+ *
+ * The headers, the body, and the return value of the previous response are
+ * discarded; the writer is kept. This way, a single context can serve all the
+ * requests of a connection.
+ *
+ * @pre `ctx != NULL`
+ */
+void SmolRTSP_Context_reset(SmolRTSP_Context *ctx, uint32_t cseq);
+
 /**
  * Retrieves the writer specified in #SmolRTSP_Context_new.
  *
@@ -62,6 +76,9 @@ SmolRTSP_Context_get_ret(const SmolRTSP_Context *ctx) SMOLRTSP_PRIV_MUST_USE;
 /**
  * Appends an RTSP header to the request context.
  *
+ * If the value cannot be allocated, the header is skipped, `errno` is set to
+ * `ENOMEM`, and #SmolRTSP_Context_get_ret returns -1.
+ *
  * @param[out] ctx The request context to modify.
  * @param[in] key The header key.
  * @param[in] fmt The `printf`-like format string (header value).
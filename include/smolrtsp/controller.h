@@ -47,7 +47,7 @@ typedef enum {
         const SmolRTSP_Request *req)                                           \
                                                                                \
     /*                                                                         \
-     * Handles `OPTIONS` as defined in                                         \
+     * Handles `DESCRIBE` as defined in                                        \
      * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.2>.           \
      */                                                                        \
     vfunc99(                                                                   \
@@ -55,7 +55,7 @@ typedef enum {
         const SmolRTSP_Request *req)                                           \
                                                                                \
     /*                                                                         \
-     * Handles `OPTIONS` as defined in                                         \
+     * Handles `SETUP` as defined in                                           \
      * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.4>.           \
      */                                                                        \
     vfunc99(                                                                   \
@@ -63,7 +63,7 @@ typedef enum {
         const SmolRTSP_Request *req)                                           \
                                                                                \
     /*                                                                         \
-     * Handles `OPTIONS` as defined in                                         \
+     * Handles `PLAY` as defined in                                            \
      * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.5>.           \
      */                                                                        \
     vfunc99(                                                                   \
@@ -71,13 +71,58 @@ typedef enum {
         const SmolRTSP_Request *req)                                           \
                                                                                \
     /*                                                                         \
-     * Handles `OPTIONS` as defined in                                         \
+     * Handles `TEARDOWN` as defined in                                        \
      * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.7>.           \
      */                                                                        \
     vfunc99(                                                                   \
         void, teardown, VSelf99, SmolRTSP_Context *ctx,                        \
         const SmolRTSP_Request *req)                                           \
                                                                                \
+    /*                                                                         \
+     * Handles `ANNOUNCE` as defined in                                        \
+     * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.3>.           \
+     * Defaults to `unknown`.                                                  \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        void, announce, VSelf99, SmolRTSP_Context *ctx,                        \
+        const SmolRTSP_Request *req)                                           \
+                                                                               \
+    /*                                                                         \
+     * Handles `PAUSE` as defined in                                           \
+     * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.6>.           \
+     * Defaults to `unknown`.                                                  \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        void, pause, VSelf99, SmolRTSP_Context *ctx,                           \
+        const SmolRTSP_Request *req)                                           \
+                                                                               \
+    /*                                                                         \
+     * Handles `GET_PARAMETER` as defined in                                   \
+     * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.8>.           \
+     * Defaults to `unknown`.                                                  \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        void, get_parameter, VSelf99, SmolRTSP_Context *ctx,                   \
+        const SmolRTSP_Request *req)                                           \
+                                                                               \
+    /*                                                                         \
+     * Handles `SET_PARAMETER` as defined in                                   \
+     * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.9>.           \
+     * Defaults to `unknown`.                                                  \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        void, set_parameter, VSelf99, SmolRTSP_Context *ctx,                   \
+        const SmolRTSP_Request *req)                                           \
+                                                                               \
+    /*                                                                         \
+     * Handles `RECORD` as defined in                                          \
+     * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.11>.          \
+     * Defaults to `unknown`.                                                  \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        void, record, VSelf99, SmolRTSP_Context *ctx,                          \
+        const SmolRTSP_Request *req)                                           \
+                                                                               \
     /*                                                                         \
      * Handles a command that is neither of the above.                         \
      */                                                                        \
@@ -112,6 +157,44 @@ typedef enum {
  */
 interface99(SmolRTSP_Controller);
 
+/**
+ * The default implementation of `announce`.
+ *
+ * Does nothing: #smolrtsp_dispatch recognizes it (and the other defaults
+ * below) and invokes `unknown` instead, so that controllers without such
+ * handlers keep receiving these requests in `unknown`.
+ */
+void SmolRTSP_Controller_announce(
+    VSelf99, SmolRTSP_Context *ctx, const SmolRTSP_Request *req);
+
+/**
+ * The default implementation of `pause`, the same as
+ * #SmolRTSP_Controller_announce.
+ */
+void SmolRTSP_Controller_pause(
+    VSelf99, SmolRTSP_Context *ctx, const SmolRTSP_Request *req);
+
+/**
+ * The default implementation of `get_parameter`, the same as
+ * #SmolRTSP_Controller_announce.
+ */
+void SmolRTSP_Controller_get_parameter(
+    VSelf99, SmolRTSP_Context *ctx, const SmolRTSP_Request *req);
+
+/**
+ * The default implementation of `set_parameter`, the same as
+ * #SmolRTSP_Controller_announce.
+ */
+void SmolRTSP_Controller_set_parameter(
+    VSelf99, SmolRTSP_Context *ctx, const SmolRTSP_Request *req);
+
+/**
+ * The default implementation of `record`, the same as
+ * #SmolRTSP_Controller_announce.
+ */
+void SmolRTSP_Controller_record(
+    VSelf99, SmolRTSP_Context *ctx, const SmolRTSP_Request *req);
+
 /**
  * Dispatches an incoming request to @p controller.
  *
@@ -123,15 +206,20 @@ interface99(SmolRTSP_Controller);
  * preliminary stuff like logging a request or setting up initial response
  * headers via #smolrtsp_header. If `before` returns
  * #SmolRTSP_ControlFlow_Break, jump to step #4.
- *  3. Invoke a corresponding command handler of @p controller. Here you should
- * handle the request and respond to your client via
- * #smolrtsp_respond/#smolrtsp_respond_ok or similar.
+ *  3. Invoke a corresponding command handler of @p controller, selected by
+ * #SmolRTSP_MethodId_from_method. Here you should handle the request and
+ * respond to your client via #smolrtsp_respond/#smolrtsp_respond_ok or
+ * similar.
  *  4. Invoke the `after` method of @p controller. Here you automatically
  * receive the return value of `smolrtsp_respond_*` (invoked during one of the
  * previous steps). If it is <0, it means that something bad happened so that
  * the handler has not been able to respond properly.
  *  5. Drop the request context.
  *
+ * The context is kept on the stack, so that dispatching does not allocate
+ * unless the response headers outgrow its inline storage. Use
+ * #smolrtsp_dispatch_with_context to reuse a context of your own instead.
+ *
  * @param[out] conn The writer to send RTSP responses.
  * @param[in] controller The controller to handle the incoming request @p req.
  * @param[in] req The fully parsed RTSP request object.
@@ -143,3 +231,19 @@ interface99(SmolRTSP_Controller);
 void smolrtsp_dispatch(
     SmolRTSP_Writer conn, SmolRTSP_Controller controller,
     const SmolRTSP_Request *restrict req);
+
+/**
+ * The same as #smolrtsp_dispatch but handles @p req in the caller-owned
+ * context @p ctx, which is reset with #SmolRTSP_Context_reset beforehand.
+ *
+ * A connection can thereby create its context with #SmolRTSP_Context_new once
+ * and reuse it for all its requests. The responses are written to the writer
+ * of @p ctx; @p ctx is not dropped afterwards.
+ *
+ * @pre `ctx != NULL`
+ * @pre `controller.self && controller.vptr`
+ * @pre `req != NULL`
+ */
+void smolrtsp_dispatch_with_context(
+    SmolRTSP_Context *ctx, SmolRTSP_Controller controller,
+    const SmolRTSP_Request *restrict req);
@@ -0,0 +1,175 @@
+/**
+ * @file
+ * @brief A demultiplexer of RTSP requests and interleaved binary data.
+ */
+
+#pragma once
+
+#include <smolrtsp/types/error.h>
+#include <smolrtsp/types/request.h>
+#include <smolrtsp/types/request_parser.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <interface99.h>
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A receiver of interleaved binary data frames.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+#define SmolRTSP_FrameHandler_IFACE                                            \
+                                                                               \
+    /*                                                                         \
+     * Handles the payload of a frame received on the channel @p channel_id.   \
+     *                                                                         \
+     * @p payload points into the input of #SmolRTSP_Demuxer_parse and is      \
+     * valid only during the call.                                             \
+     */                                                                        \
+    vfunc99(void, on_frame, VSelf99, uint8_t channel_id, U8Slice99 payload)
+
+/**
+ * Defines the `SmolRTSP_FrameHandler` interface.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+interface99(SmolRTSP_FrameHandler);
+
+/**
+ * The maximum number of channels a single #SmolRTSP_Demuxer can be bound to.
+ */
+#define SMOLRTSP_DEMUXER_MAX_CHANNELS 8
+
+/**
+ * A channel bound to a frame handler.
+ */
+typedef struct {
+    /**
+     * The channel identifier.
+     */
+    uint8_t channel_id;
+
+    /**
+     * The handler of the frames received on #channel_id.
+     */
+    SmolRTSP_FrameHandler handler;
+} SmolRTSP_ChannelBinding;
+
+/**
+ * A connection-level demultiplexer of RTSP requests and
+ * [interleaved binary
+ * data](https://datatracker.ietf.org/doc/html/rfc2326#section-10.12).
+ *
+ * A TCP client may send RTP/RTCP packets (e.g., RTCP receiver reports) in
+ * `$`-framed chunks between its requests. The demultiplexer hands each
+ * complete frame to the handler bound to its channel without copying, and
+ * parses the requests in between with #SmolRTSP_RequestParser.
+ *
+ * Typical usage:
+ *
+ * @code
+ * SmolRTSP_Demuxer demuxer = SmolRTSP_Demuxer_new();
+ * SmolRTSP_Demuxer_bind(&demuxer, 1, rtcp_handler);
+ *
+ * // Every time new data has been appended to `buf`:
+ * SmolRTSP_ParseResult res = SmolRTSP_Demuxer_parse(&demuxer, &req, buf);
+ * // On a complete result of `n` bytes, process `req` and then drop the first
+ * // `n` bytes of `buf`. On a partial result, drop the first
+ * // `SmolRTSP_Demuxer_drain(&demuxer)` bytes of `buf`.
+ * @endcode
+ */
+typedef struct {
+    /**
+     * The parser of the current request.
+     */
+    SmolRTSP_RequestParser parser;
+
+    /**
+     * The number of leading bytes of the input holding the frames already
+     * handled.
+     */
+    size_t frames_len;
+
+    /**
+     * The number of frames received on channels without a handler.
+     */
+    size_t dropped_frames;
+
+    /**
+     * The bound channels.
+     */
+    SmolRTSP_ChannelBinding bindings[SMOLRTSP_DEMUXER_MAX_CHANNELS];
+
+    /**
+     * The number of elements in #bindings.
+     */
+    size_t bindings_len;
+} SmolRTSP_Demuxer;
+
+/**
+ * Returns a demultiplexer without bound channels.
+ */
+SmolRTSP_Demuxer SmolRTSP_Demuxer_new(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Binds @p channel_id to @p handler, replacing its previous handler, if any.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, -1 if all #SMOLRTSP_DEMUXER_MAX_CHANNELS channels are
+ * already bound (`errno` is set to `ENOSPC`).
+ */
+int SmolRTSP_Demuxer_bind(
+    SmolRTSP_Demuxer *self, uint8_t channel_id,
+    SmolRTSP_FrameHandler handler) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Removes the handler of @p channel_id, so that its frames are dropped.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_Demuxer_unbind(SmolRTSP_Demuxer *self, uint8_t channel_id);
+
+/**
+ * Continues demultiplexing @p input.
+ *
+ * Hands all complete frames preceding the next request to their handlers, and
+ * then continues parsing the request.
+ *
+ * @param[in] self The demultiplexer.
+ * @param[out] request The request being parsed, initialized with
+ * #SmolRTSP_Request_uninit.
+ * @param[in] input All the data received since the previous complete result.
+ * As with #SmolRTSP_RequestParser_parse, each call must pass the same buffer
+ * as before, possibly extended with new data, unless its first
+ * #SmolRTSP_Demuxer_drain bytes have been dropped.
+ *
+ * @return A complete result with the number of bytes of the handled frames and
+ * the request, a partial result, or a failure. After a complete result or a
+ * failure, @p self is ready for the data following the request.
+ *
+ * @pre `self != NULL`
+ * @pre `request != NULL`
+ */
+SmolRTSP_ParseResult SmolRTSP_Demuxer_parse(
+    SmolRTSP_Demuxer *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of leading bytes of the input that have been consumed by
+ * frames and are not followed by a partially parsed request, and forgets
+ * about them.
+ *
+ * The caller can drop these bytes from its buffer, so that a stream of frames
+ * without requests does not accumulate. The next call to
+ * #SmolRTSP_Demuxer_parse must then pass the input without them.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Demuxer_drain(SmolRTSP_Demuxer *self) SMOLRTSP_PRIV_MUST_USE;
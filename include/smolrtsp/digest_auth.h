@@ -0,0 +1,362 @@
+/**
+ * @file
+ * @brief The Digest authentication of RTSP requests (RFC 2617).
+ */
+
+#pragma once
+
+#include <smolrtsp/context.h>
+#include <smolrtsp/controller.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/types/request.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The length of the hexadecimal MD5 digests of the Digest authentication,
+ * such as an HA1.
+ */
+#define SMOLRTSP_DIGEST_HEX_LEN 32
+
+/**
+ * The length of the nonces issued by #SmolRTSP_DigestAuth.
+ */
+#define SMOLRTSP_DIGEST_NONCE_LEN 32
+
+/**
+ * The default value for #SmolRTSP_DigestAuthConfig.nonces_count.
+ */
+#define SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCES_COUNT 256
+
+/**
+ * The default value for #SmolRTSP_DigestAuthConfig.nonce_lifetime_us (five
+ * minutes).
+ */
+#define SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCE_LIFETIME_US 300000000
+
+/**
+ * The longest request line (the method, a space, and the URI) remembered for
+ * the fast path of #SmolRTSP_DigestAuth_verify.
+ */
+#define SMOLRTSP_DIGEST_AUTH_FAST_PATH_MAX 128
+
+/**
+ * The parameters of a Digest `Authorization` header.
+ *
+ * The fields point into the parsed header value; quoted values are returned
+ * without the quotes and with no quoted pairs unescaped. The absent fields are
+ * empty.
+ */
+typedef struct {
+    /**
+     * The user name.
+     */
+    CharSlice99 username;
+
+    /**
+     * The protection space of the server.
+     */
+    CharSlice99 realm;
+
+    /**
+     * The nonce issued by the server.
+     */
+    CharSlice99 nonce;
+
+    /**
+     * The request URI, as given by the client.
+     */
+    CharSlice99 uri;
+
+    /**
+     * The 32 hexadecimal digits of the request digest.
+     */
+    CharSlice99 response;
+
+    /**
+     * The algorithm, which is `MD5` if absent.
+     */
+    CharSlice99 algorithm;
+
+    /**
+     * The quality of protection, either empty or `auth`.
+     */
+    CharSlice99 qop;
+
+    /**
+     * The nonce count, as 8 hexadecimal digits, if `qop` is present.
+     */
+    CharSlice99 nc;
+
+    /**
+     * The client nonce, if `qop` is present.
+     */
+    CharSlice99 cnonce;
+
+    /**
+     * The opaque value of the challenge, if any.
+     */
+    CharSlice99 opaque;
+} SmolRTSP_DigestCredentials;
+
+/**
+ * Parses the value of an `Authorization` header with the `Digest` scheme.
+ *
+ * The parameters are split in place, with no memory allocated or copied.
+ * Unknown parameters are skipped.
+ *
+ * @param[in] value The header value, e.g., `Digest username="user", ...`.
+ * @param[out] credentials The parsed parameters.
+ *
+ * @return 0 on success, or -1 if @p value is malformed, of another scheme, or
+ * misses `username`, `nonce`, `uri`, or `response` (and sets `errno` to
+ * `EBADMSG`).
+ *
+ * @pre `credentials != NULL`
+ */
+int SmolRTSP_DigestCredentials_parse(
+    CharSlice99 value,
+    SmolRTSP_DigestCredentials *restrict credentials) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Computes the hexadecimal `HA1 = MD5(username ":" realm ":" password)`, as
+ * kept by `htdigest` files.
+ *
+ * @pre `username != NULL`
+ * @pre `realm != NULL`
+ * @pre `password != NULL`
+ * @pre `ha1 != NULL`
+ */
+void smolrtsp_digest_ha1(
+    const char *username, const char *realm, const char *password,
+    char ha1[restrict SMOLRTSP_DIGEST_HEX_LEN + 1]);
+
+/**
+ * The configuration structure for #SmolRTSP_DigestAuth.
+ */
+typedef struct {
+    /**
+     * The protection space announced in the challenges.
+     */
+    const char *realm;
+
+    /**
+     * The capacity of the nonce cache.
+     *
+     * Every challenge issues a nonce into the slot of the oldest one, which
+     * then becomes stale.
+     */
+    size_t nonces_count;
+
+    /**
+     * The time after which a nonce becomes stale, in microseconds.
+     */
+    uint64_t nonce_lifetime_us;
+
+    /**
+     * Whether the challenges offer `qop="auth"`.
+     *
+     * The requests with `qop=auth` are accepted regardless, but cannot take
+     * the fast path, since every one of them has a new nonce count.
+     */
+    bool qop_auth;
+
+    /**
+     * The clock in microseconds; if `NULL`, `CLOCK_MONOTONIC` is used.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_DigestAuthConfig;
+
+/**
+ * Returns the default #SmolRTSP_DigestAuthConfig for @p realm.
+ *
+ * The default values are:
+ *
+ *  - `nonces_count` is #SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCES_COUNT.
+ *  - `nonce_lifetime_us` is #SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCE_LIFETIME_US.
+ *  - `qop_auth` is `false`.
+ *  - `clock_us` is `NULL`.
+ *
+ * @pre `realm != NULL`
+ */
+SmolRTSP_DigestAuthConfig
+SmolRTSP_DigestAuthConfig_default(const char *realm) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The outcome of #SmolRTSP_DigestAuth_verify.
+ */
+typedef enum {
+    /**
+     * The request is authenticated.
+     */
+    SmolRTSP_DigestAuthResult_Accepted,
+
+    /**
+     * The digest is right, but the nonce has expired or has been evicted, so
+     * the client should retry with a new nonce without asking the user.
+     */
+    SmolRTSP_DigestAuthResult_Stale,
+
+    /**
+     * The credentials are wrong, malformed, or replayed.
+     */
+    SmolRTSP_DigestAuthResult_Rejected,
+} SmolRTSP_DigestAuthResult;
+
+/**
+ * The counters of #SmolRTSP_DigestAuth.
+ */
+typedef struct {
+    /**
+     * The number of requests accepted, including `fast_path`.
+     */
+    uint64_t accepted;
+
+    /**
+     * The number of requests accepted without computing a digest.
+     */
+    uint64_t fast_path;
+
+    /**
+     * The number of requests answered with a challenge by
+     * #smolrtsp_digest_auth_check.
+     */
+    uint64_t challenged;
+
+    /**
+     * The number of requests with a stale nonce.
+     */
+    uint64_t stale;
+
+    /**
+     * The number of requests rejected.
+     */
+    uint64_t rejected;
+} SmolRTSP_DigestAuthStats;
+
+/**
+ * A Digest authenticator with the users of a realm and a cache of the nonces
+ * issued to the clients.
+ *
+ * A user is kept with their HA1, so a digest costs two MD5 blocks and no
+ * password is kept in memory. The nonces live in a fixed array: a nonce
+ * carries the index of its slot, so that it is found in a constant time, and
+ * its slot also remembers the last request verified with it. Since the
+ * keep-alive requests of a session (e.g., `GET_PARAMETER`) repeat the same
+ * method, URI, and digest, they are accepted by comparing with that request,
+ * without any MD5.
+ *
+ * The authenticator can be shared between threads.
+ */
+typedef struct SmolRTSP_DigestAuth SmolRTSP_DigestAuth;
+
+/**
+ * Creates a new authenticator with @p config and no users.
+ *
+ * @return The authenticator, or `NULL` if the memory or the randomness for
+ * the nonces cannot be obtained (and sets `errno` appropriately).
+ *
+ * @pre `config.realm != NULL`
+ * @pre `config.nonces_count > 0`
+ * @pre `config.nonce_lifetime_us > 0`
+ */
+SmolRTSP_DigestAuth *SmolRTSP_DigestAuth_new(SmolRTSP_DigestAuthConfig config)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds the user @p username with @p password.
+ *
+ * Only the HA1 of the password is kept.
+ *
+ * @return 0 on success, or -1 if the memory cannot be allocated (and sets
+ * `errno` to `ENOMEM`).
+ *
+ * @pre `self != NULL`
+ * @pre `username != NULL`
+ * @pre `password != NULL`
+ */
+int SmolRTSP_DigestAuth_add_user(
+    SmolRTSP_DigestAuth *self, const char *username,
+    const char *password) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds the user @p username with the precomputed @p ha1 (see
+ * #smolrtsp_digest_ha1).
+ *
+ * @return 0 on success, or -1 if @p ha1 is not #SMOLRTSP_DIGEST_HEX_LEN
+ * hexadecimal digits (and sets `errno` to `EINVAL`) or if the memory cannot be
+ * allocated (and sets `errno` to `ENOMEM`).
+ *
+ * @pre `self != NULL`
+ * @pre `username != NULL`
+ */
+int SmolRTSP_DigestAuth_add_user_ha1(
+    SmolRTSP_DigestAuth *self, const char *username,
+    CharSlice99 ha1) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Issues a new nonce into @p nonce, null-terminated.
+ *
+ * #smolrtsp_digest_auth_check calls it for every challenge; call it yourself
+ * to build challenges of your own.
+ *
+ * @pre `self != NULL`
+ * @pre `nonce != NULL`
+ */
+void SmolRTSP_DigestAuth_issue_nonce(
+    SmolRTSP_DigestAuth *self,
+    char nonce[restrict SMOLRTSP_DIGEST_NONCE_LEN + 1]);
+
+/**
+ * Verifies the request @p method @p uri with the `Authorization` header
+ * @p authorization.
+ *
+ * The URI of the credentials must be @p uri. A request with `qop=auth` must
+ * have a nonce count greater than that of the previous request with the same
+ * nonce.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_DigestAuthResult SmolRTSP_DigestAuth_verify(
+    SmolRTSP_DigestAuth *self, CharSlice99 method, CharSlice99 uri,
+    CharSlice99 authorization) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the counters of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_DigestAuthStats SmolRTSP_DigestAuth_stats(
+    const SmolRTSP_DigestAuth *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_DigestAuth.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_DigestAuth);
+
+/**
+ * Rejects @p req with `401 Unauthorized` and a Digest challenge unless it is
+ * authenticated by @p self.
+ *
+ * Meant to be called from the `before` method of a controller, which should
+ * return the result. The challenge carries `stale=true` if the nonce of the
+ * request is stale (see #SmolRTSP_DigestAuthResult_Stale).
+ *
+ * @return #SmolRTSP_ControlFlow_Break if the response has been sent,
+ * #SmolRTSP_ControlFlow_Continue otherwise.
+ *
+ * @pre `self != NULL`
+ * @pre `ctx != NULL`
+ * @pre `req != NULL`
+ */
+SmolRTSP_ControlFlow smolrtsp_digest_auth_check(
+    SmolRTSP_DigestAuth *self, SmolRTSP_Context *ctx,
+    const SmolRTSP_Request *restrict req) SMOLRTSP_PRIV_MUST_USE;
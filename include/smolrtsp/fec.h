@@ -0,0 +1,227 @@
+/**
+ * @file
+ * @brief <a href="https://datatracker.ietf.org/doc/html/rfc8627">RFC
+ * 8627</a> (FlexFEC) XOR parity generation over row and column groups.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The number of bytes by which a repair packet exceeds the largest packet it
+ * protects: its CSRC (the protected SSRC) and its FEC header.
+ */
+#define SMOLRTSP_FEC_OVERHEAD 16
+
+/**
+ * The default value for #SmolRTSP_FecConfig.columns.
+ */
+#define SMOLRTSP_FEC_DEFAULT_COLUMNS 10
+
+/**
+ * The default value for #SmolRTSP_FecConfig.rows.
+ */
+#define SMOLRTSP_FEC_DEFAULT_ROWS 10
+
+/**
+ * The default value for #SmolRTSP_FecConfig.payload_ty.
+ */
+#define SMOLRTSP_FEC_DEFAULT_PAYLOAD_TY 127
+
+/**
+ * The default value for #SmolRTSP_FecConfig.max_packet_size.
+ */
+#define SMOLRTSP_FEC_DEFAULT_MAX_PACKET_SIZE 1500
+
+/**
+ * The configuration structure for #SmolRTSP_FecEncoder.
+ *
+ * The protected packets are arranged into blocks of #rows rows of #columns
+ * consecutive packets each. A row repair packet protects a row, a column
+ * repair packet protects the packets at the same position of every row of a
+ * block.
+ */
+typedef struct {
+    /**
+     * The number of packets in a row (`L`).
+     */
+    size_t columns;
+
+    /**
+     * The number of rows in a block (`D`); only used for column repair
+     * packets.
+     */
+    size_t rows;
+
+    /**
+     * Whether to emit a repair packet per row.
+     */
+    bool row;
+
+    /**
+     * Whether to emit a repair packet per column.
+     */
+    bool column;
+
+    /**
+     * The RTP payload type of the repair packets.
+     */
+    uint8_t payload_ty;
+
+    /**
+     * The SSRC of the repair stream, or 0 for a random one.
+     */
+    uint32_t ssrc;
+
+    /**
+     * The maximum size of a protected packet: the larger ones are sent
+     * unprotected.
+     */
+    size_t max_packet_size;
+} SmolRTSP_FecConfig;
+
+/**
+ * Returns the default #SmolRTSP_FecConfig.
+ *
+ * The default values are:
+ *
+ *  - `columns` is #SMOLRTSP_FEC_DEFAULT_COLUMNS.
+ *  - `rows` is #SMOLRTSP_FEC_DEFAULT_ROWS.
+ *  - `row` is `true`.
+ *  - `column` is `false`.
+ *  - `payload_ty` is #SMOLRTSP_FEC_DEFAULT_PAYLOAD_TY.
+ *  - `ssrc` is 0.
+ *  - `max_packet_size` is #SMOLRTSP_FEC_DEFAULT_MAX_PACKET_SIZE.
+ */
+SmolRTSP_FecConfig SmolRTSP_FecConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the SDP attributes of the repair stream described by @p self to @p w:
+ * `a=rtpmap:<PT> flexfec/<clock rate>` and
+ * `a=fmtp:<PT> repair-window=<us>; L=<columns>; D=<rows>; ToP=<type>`.
+ *
+ * @param[in] self The configuration of the encoder.
+ * @param[out] w The writer to be provided with SDP data.
+ * @param[in] clock_rate The clock rate of the protected stream.
+ * @param[in] repair_window_us The time span of a block, in microseconds.
+ *
+ * @pre `w.self && w.vptr`
+ *
+ * @return The number of bytes written or a negative value on error.
+ *
+ * @see FlexFEC media type parameters:
+ * <https://datatracker.ietf.org/doc/html/rfc8627#section-5.1.1>
+ */
+ssize_t SmolRTSP_FecConfig_sdp(
+    SmolRTSP_FecConfig self, SmolRTSP_Writer w, uint32_t clock_rate,
+    uint32_t repair_window_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The counters of #SmolRTSP_FecEncoder.
+ */
+typedef struct {
+    /**
+     * The number of packets protected.
+     */
+    uint64_t protected_packets;
+
+    /**
+     * The number of packets sent unprotected, because they are out of sequence
+     * (such as retransmissions) or too large.
+     */
+    uint64_t unprotected_packets;
+
+    /**
+     * The number of repair packets transmitted.
+     */
+    uint64_t repair_packets;
+
+    /**
+     * The number of repair packets that have failed to be transmitted.
+     */
+    uint64_t repair_errors;
+} SmolRTSP_FecStats;
+
+/**
+ * A transport that forwards RTP packets to an underlying transport and
+ * transmits XOR repair packets over them.
+ *
+ * The parity is accumulated directly from the I/O vectors of the forwarded
+ * packets with vectorized XOR (SSE2, AVX2, or NEON, selected at run time), so
+ * the protected packets are never copied. The repair packets follow the FEC
+ * header of RFC 8627 with fixed `L` and `D` (`R=0`, `F=1`) and carry the
+ * protected SSRC as their only CSRC; their timestamp is that of the last
+ * protected packet.
+ *
+ * A gap in the sequence numbers abandons the current groups. A repair packet
+ * that fails to be transmitted is only counted in #SmolRTSP_FecStats.
+ *
+ * Row repair packets carry `D=0`, column ones the configured `D`.
+ *
+ * The maximum packet size is reduced by #SMOLRTSP_FEC_OVERHEAD, so that the
+ * repair packets fit into the underlying one.
+ */
+typedef struct SmolRTSP_FecEncoder SmolRTSP_FecEncoder;
+
+/**
+ * Creates a new FEC encoder on top of @p t.
+ *
+ * The encoder takes ownership of @p t and @p repair: they are dropped together
+ * with the encoder.
+ *
+ * @param[in] t The transport of the protected packets.
+ * @param[in] repair The transport of the repair packets. If `repair.self` is
+ * `NULL`, they are transmitted through @p t.
+ * @param[in] config The FEC configuration.
+ *
+ * @pre `t.self && t.vptr`
+ * @pre `config.columns > 0`
+ * @pre `config.row || config.column`
+ * @pre `!config.column || config.rows > 0`
+ * @pre `config.columns <= 255 && config.rows <= 255`
+ * @pre `config.max_packet_size > 12`
+ *
+ * @return The encoder, or `NULL` if there is not enough memory (and sets
+ * `errno` to `ENOMEM`); the transports are left to the caller then.
+ */
+SmolRTSP_FecEncoder *SmolRTSP_FecEncoder_new(
+    SmolRTSP_Transport t, SmolRTSP_Transport repair,
+    SmolRTSP_FecConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns a snapshot of the FEC counters of @p self, whereas its `stats`
+ * method returns the counters of the transport of the protected packets. It
+ * can be called from any thread.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_FecStats
+SmolRTSP_FecEncoder_fec_stats(const SmolRTSP_FecEncoder *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Transport_IFACE for #SmolRTSP_FecEncoder.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Transport, SmolRTSP_FecEncoder);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_FecEncoder.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_FecEncoder);
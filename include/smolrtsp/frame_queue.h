@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief A lock-free queue of interleaved frames for one RTSP connection.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/io_vec.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A multi-producer, single-consumer queue of interleaved binary frames (RFC
+ * 2326, section 10.12) to be written to a connection.
+ *
+ * Unlike #smolrtsp_transport_tcp, producers (e.g., the audio and video tracks
+ * of a session fed from different threads) never wait on the writer lock of
+ * one another: a frame is copied into the queue with a single atomic
+ * exchange, and whichever producer finds the queue idle writes all the queued
+ * frames with one vectored write, while the others return immediately.
+ */
+typedef struct SmolRTSP_FrameQueue SmolRTSP_FrameQueue;
+
+/**
+ * Creates a queue writing to @p w.
+ *
+ * The writer lock of @p w is still taken around each vectored write, so that
+ * the frames do not interleave with RTSP responses written to @p w.
+ *
+ * @param[in] w The connection writer.
+ * @param[in] max_buffer The number of queued and unsent bytes above which the
+ * transports of the queue report themselves as full.
+ *
+ * @pre `w.self && w.vptr`
+ *
+ * @return The queue, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_FrameQueue *SmolRTSP_FrameQueue_new(
+    SmolRTSP_Writer w, size_t max_buffer) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Enqueues @p bufs as a frame of the channel @p channel_id and writes the
+ * queued frames if no other thread is doing so.
+ *
+ * @p bufs are copied, so they can be released as soon as this function
+ * returns. This function is safe to call from several threads at once.
+ *
+ * @return -1 if the frame cannot be allocated (and sets `errno` to `ENOMEM`)
+ * or if this call has written the queue and the write has failed (and sets
+ * `errno` appropriately), 0 otherwise.
+ *
+ * @pre `self != NULL`
+ * @pre `SmolRTSP_IoVecSlice_len(bufs) <= UINT16_MAX`
+ */
+int SmolRTSP_FrameQueue_push(
+    SmolRTSP_FrameQueue *self, uint8_t channel_id, SmolRTSP_IoVecSlice bufs);
+
+/**
+ * Writes the queued frames if no other thread is doing so.
+ *
+ * @return -1 if the write has failed (and sets `errno` appropriately), 0
+ * otherwise.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_FrameQueue_flush(SmolRTSP_FrameQueue *self);
+
+/**
+ * Returns the number of bytes of the queued frames.
+ *
+ * @pre `self != NULL`
+ */
+size_t
+SmolRTSP_FrameQueue_len(const SmolRTSP_FrameQueue *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of frames discarded because their write has failed.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_FrameQueue_failures(const SmolRTSP_FrameQueue *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_FrameQueue.
+ *
+ * The frames that are still queued are discarded. No thread may push to the
+ * queue concurrently.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_FrameQueue);
+
+/**
+ * Creates a transport pushing every packet to @p queue as a frame of the
+ * channel @p channel_id.
+ *
+ * The queue is not owned by the transport and must outlive it.
+ *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
+ * @pre `queue != NULL`
+ */
+SmolRTSP_Transport smolrtsp_transport_frame_queue(
+    SmolRTSP_FrameQueue *queue, uint8_t channel_id) SMOLRTSP_PRIV_MUST_USE;
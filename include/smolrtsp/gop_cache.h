@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief A cache of the most recent GOP of a live stream for instant-start
+ * PLAY.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The NAL units of a stream since its last IDR access unit (including the
+ * parameter sets sent along with it).
+ *
+ * A new client can be sent the cached GOP right after PLAY instead of waiting
+ * for the next IDR. The cache is reference-counted and thread-safe: it can be
+ * fed by the producer thread while PLAY handlers replay it. Each reference is
+ * released via #SmolRTSP_Droppable.
+ */
+typedef struct SmolRTSP_GopCache SmolRTSP_GopCache;
+
+/**
+ * Creates a new cache with one reference.
+ *
+ * @param[in] max_size The maximum number of NAL unit bytes to hold. A GOP that
+ * does not fit is discarded, and caching resumes with the next IDR.
+ *
+ * @pre `max_size > 0`
+ *
+ * @return The cache, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_GopCache *
+SmolRTSP_GopCache_new(size_t max_size) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Acquires one more reference to @p self.
+ *
+ * @pre `self != NULL`
+ *
+ * @return @p self.
+ */
+SmolRTSP_GopCache *
+SmolRTSP_GopCache_ref(SmolRTSP_GopCache *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Appends @p nalu with the timestamp @p ts to @p self.
+ *
+ * An IDR slice starts a new GOP: everything before its access unit (the NAL
+ * units sharing @p ts) is discarded. Before the first IDR, nothing is cached.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, or -1 if an allocation fails (and sets `errno` to
+ * `ENOMEM`), after which @p self is empty until the next IDR.
+ */
+int SmolRTSP_GopCache_push(
+    SmolRTSP_GopCache *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of NAL units in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_GopCache_len(SmolRTSP_GopCache *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the difference between the timestamps of the last and the first
+ * cached access units (in the units of the cached timestamps), or 0 if @p
+ * self is empty.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t
+SmolRTSP_GopCache_duration(SmolRTSP_GopCache *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends the cached GOP through @p t as fast as @p t accepts it.
+ *
+ * The timestamps are rewritten so that the first cached access unit is sent
+ * with @p first_ts and the others keep their distances to it. E.g., pass
+ * `SmolRTSP_RtpTimestamp_SysClockUs(now - duration)` to end the burst at the
+ * current time, then continue with live NAL units.
+ *
+ * The cache is copied beforehand, so the producer is not blocked while @p t
+ * sends.
+ *
+ * @param[in] self The cache to replay.
+ * @param[out] t The transport of the new client.
+ * @param[in] first_ts The new timestamp of the first access unit.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ * @pre @p first_ts is of the same variant as the cached timestamps.
+ *
+ * @return -1 if an I/O error occurred or the copy cannot be allocated and sets
+ * `errno` appropriately, 0 on success.
+ */
+int SmolRTSP_GopCache_replay(
+    SmolRTSP_GopCache *self, SmolRTSP_NalTransport *t,
+    SmolRTSP_RtpTimestamp first_ts) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_GopCache.
+ *
+ * Releases one reference; the cache is freed with the last one.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_GopCache);
@@ -19,6 +19,11 @@
  */
 SLICE99_DEF_TYPED(SmolRTSP_IoVecSlice, struct iovec);
 
+/**
+ * A batch of packets, each of which is represented as #SmolRTSP_IoVecSlice.
+ */
+SLICE99_DEF_TYPED(SmolRTSP_IoVecBatch, SmolRTSP_IoVecSlice);
+
 /**
  * Computes the total length of @p self.
  */
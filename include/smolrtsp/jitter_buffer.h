@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief A jitter buffer restoring the order of received RTP packets.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/types/rtcp.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The statistics of a jitter buffer.
+ */
+typedef struct {
+    /**
+     * The number of packets accepted by #SmolRTSP_JitterBuffer_push.
+     */
+    uint64_t packets;
+
+    /**
+     * The number of packets given up on after the latency budget.
+     */
+    uint64_t lost;
+
+    /**
+     * The number of packets that arrived after their turn had passed.
+     */
+    uint64_t late;
+
+    /**
+     * The number of packets received twice.
+     */
+    uint64_t duplicates;
+
+    /**
+     * The number of held packets discarded because the stream has restarted:
+     * a packet too far ahead of them arrived, a run of packets too far behind,
+     * or a packet of another SSRC.
+     */
+    uint64_t discarded;
+} SmolRTSP_JitterBufferStats;
+
+/**
+ * A buffer of the RTP packets of one stream, which releases them in the order
+ * of their sequence numbers.
+ *
+ * The packets are held in a ring of slots indexed by the sequence number
+ * modulo its power-of-two capacity, and copied into buffers allocated once, so
+ * that pushing and popping a packet costs O(1) and never allocates. Sequence
+ * numbers are compared modulo 2^16.
+ *
+ * A packet is released as soon as all the preceding ones have been. If one is
+ * missing, the following ones are held for up to the latency budget from
+ * their arrival; then the missing ones are given up on. Gaps in the sequence
+ * numbers are reported as soon as they are seen by
+ * #SmolRTSP_JitterBuffer_nacks, so that a retransmission can be requested
+ * within the budget.
+ *
+ * A packet further ahead than the capacity, the 8th packet in a row further
+ * behind than the capacity, or a packet of another SSRC restarts the buffer at
+ * its sequence number, discarding the held packets.
+ *
+ * Typical usage with #SmolRTSP_RtpDepacketizer:
+ *
+ * @code
+ * SmolRTSP_JitterBuffer_push(jitter_buffer, dgram.data, now_us);
+ * U8Slice99 packet;
+ * while (SmolRTSP_JitterBuffer_pop(jitter_buffer, now_us, &packet)) {
+ *     SmolRTSP_RtpDepacketizer_feed(depacketizer, packet, &header);
+ *     // ...
+ * }
+ * @endcode
+ */
+typedef struct SmolRTSP_JitterBuffer SmolRTSP_JitterBuffer;
+
+/**
+ * Creates a new jitter buffer.
+ *
+ * @param[in] capacity The number of slots, a power of two. It bounds the
+ * distance between the next packet to be released and the newest one.
+ * @param[in] max_packet_size The maximum size of a packet.
+ * @param[in] latency_us The latency budget, in microseconds.
+ *
+ * @pre `capacity` is a power of two in `[2; 32768]`.
+ * @pre `max_packet_size > 0`
+ *
+ * @return The jitter buffer, or `NULL` if `capacity * max_packet_size`
+ * overflows `size_t` (and sets `errno` to `EINVAL`) or if there is not enough
+ * memory (and sets `errno` to `ENOMEM`).
+ */
+SmolRTSP_JitterBuffer *SmolRTSP_JitterBuffer_new(
+    size_t capacity, size_t max_packet_size,
+    uint64_t latency_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Copies a received RTP packet into @p self.
+ *
+ * Late and duplicated packets are only counted in
+ * #SmolRTSP_JitterBufferStats.
+ *
+ * @param[in] self The jitter buffer.
+ * @param[in] packet The RTP packet.
+ * @param[in] now_us The current time, in microseconds.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p packet is shorter than an RTP header (and sets `errno` to
+ * `EBADMSG`) or exceeds the maximum packet size (and sets `errno` to
+ * `EMSGSIZE`), 0 otherwise.
+ */
+int SmolRTSP_JitterBuffer_push(
+    SmolRTSP_JitterBuffer *self, U8Slice99 packet,
+    uint64_t now_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Releases the next packet in order, if it is there or the packets missing
+ * before it have exceeded the latency budget.
+ *
+ * @param[in] self The jitter buffer.
+ * @param[in] now_us The current time, in microseconds.
+ * @param[out] packet The released packet, which is valid until the next call
+ * to #SmolRTSP_JitterBuffer_push or #SmolRTSP_JitterBuffer_pop.
+ *
+ * @pre `self != NULL`
+ * @pre `packet != NULL`
+ *
+ * @return `true` if a packet has been released, `false` otherwise.
+ */
+bool SmolRTSP_JitterBuffer_pop(
+    SmolRTSP_JitterBuffer *self, uint64_t now_us,
+    U8Slice99 *restrict packet) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the packets found missing since the last call and still awaited as
+ * generic NACKs (see #SmolRTSP_RtcpNack), ready to be sent to the source.
+ *
+ * @param[in] self The jitter buffer.
+ * @param[out] nacks The NACKs.
+ * @param[in] max The capacity of @p nacks; the packets that do not fit are
+ * reported by the next call.
+ *
+ * @pre `self != NULL`
+ * @pre `nacks != NULL || 0 == max`
+ *
+ * @return The number of NACKs written.
+ */
+size_t SmolRTSP_JitterBuffer_nacks(
+    SmolRTSP_JitterBuffer *self, SmolRTSP_RtcpNack *restrict nacks,
+    size_t max) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of packets held by @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_JitterBuffer_len(const SmolRTSP_JitterBuffer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_JitterBufferStats
+SmolRTSP_JitterBuffer_stats(const SmolRTSP_JitterBuffer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_JitterBuffer.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_JitterBuffer);
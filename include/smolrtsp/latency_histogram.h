@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @brief Fixed-size, lock-free latency histograms.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The number of linear sub-buckets of every power of two in
+ * #SmolRTSP_LatencyHistogram, as a power of two.
+ *
+ * A recorded value is bucketed with a relative error of at most
+ * `1 / 2^SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS` (6.25%); values below
+ * `2^(SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1)` are exact.
+ */
+#define SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS 4
+
+/**
+ * The largest value distinguished by #SmolRTSP_LatencyHistogram (about 71
+ * minutes in microseconds); larger values are counted in the last bucket.
+ */
+#define SMOLRTSP_LATENCY_HISTOGRAM_MAX_VALUE UINT64_C(0xFFFFFFFF)
+
+/**
+ * The number of buckets of #SmolRTSP_LatencyHistogram.
+ */
+#define SMOLRTSP_LATENCY_HISTOGRAM_BUCKETS                                     \
+    ((32 - SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1)                     \
+     << SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * An HDR-style histogram of latencies in microseconds.
+ *
+ * Every power of two is split into a fixed number of linear buckets, so the
+ * memory does not depend on the recorded values and the precision is relative
+ * to the value. Recording is lock-free: a histogram can be shared by several
+ * threads and read with #SmolRTSP_LatencyHistogram_snapshot while being
+ * recorded into.
+ *
+ * A zero-initialized histogram is empty.
+ */
+typedef struct {
+    /**
+     * The number of values of every bucket.
+     */
+    uint64_t counts[SMOLRTSP_LATENCY_HISTOGRAM_BUCKETS];
+
+    /**
+     * The number of recorded values.
+     */
+    uint64_t total_count;
+
+    /**
+     * The sum of the recorded values.
+     */
+    uint64_t sum_us;
+
+    /**
+     * The largest recorded value.
+     */
+    uint64_t max_us;
+} SmolRTSP_LatencyHistogram;
+
+/**
+ * Records @p value_us.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_LatencyHistogram_record(
+    SmolRTSP_LatencyHistogram *self, uint64_t value_us);
+
+/**
+ * Copies @p self into @p snapshot.
+ *
+ * The counters are copied one by one, so a snapshot taken while @p self is
+ * being recorded into may miss the values recorded meanwhile.
+ *
+ * @pre `self != NULL`
+ * @pre `snapshot != NULL`
+ */
+void SmolRTSP_LatencyHistogram_snapshot(
+    const SmolRTSP_LatencyHistogram *restrict self,
+    SmolRTSP_LatencyHistogram *restrict snapshot);
+
+/**
+ * Adds the values of @p other to @p self, e.g., to aggregate the histograms of
+ * several transports.
+ *
+ * @pre `self != NULL`
+ * @pre `other != NULL`
+ */
+void SmolRTSP_LatencyHistogram_merge(
+    SmolRTSP_LatencyHistogram *restrict self,
+    const SmolRTSP_LatencyHistogram *restrict other);
+
+/**
+ * Returns the value below which @p percentile percent of the recorded values
+ * fall, rounded up to its bucket, or 0 if @p self is empty.
+ *
+ * The value does not exceed #SmolRTSP_LatencyHistogram.max_us.
+ *
+ * @pre `self != NULL`
+ * @pre `percentile >= 0 && percentile <= 100`
+ */
+uint64_t SmolRTSP_LatencyHistogram_value_at_percentile(
+    const SmolRTSP_LatencyHistogram *self,
+    double percentile) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the mean of the recorded values, or 0 if @p self is empty.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_LatencyHistogram_mean(const SmolRTSP_LatencyHistogram *self)
+    SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,487 @@
+/**
+ * @file
+ * @brief Reference-counted access units shared by the clients of a live
+ * stream.
+ */
+
+#pragma once
+
+#include <smolrtsp/bandwidth_estimator.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * An immutable access unit: the NAL units of one picture, sharing the same
+ * timestamp.
+ *
+ * The NAL units are copied into a single allocation once, when the frame is
+ * created, and then only referenced. The frame is reference-counted and
+ * thread-safe; each reference is released via #SmolRTSP_Droppable.
+ */
+typedef struct SmolRTSP_LiveFrame SmolRTSP_LiveFrame;
+
+/**
+ * Creates a frame with one reference from @p nalus.
+ *
+ * @param[in] ts The timestamp of the access unit.
+ * @param[in] nalus The NAL units of the access unit, in the decoding order.
+ * They are copied, so they can be discarded when this function returns.
+ * @param[in] nalus_count The number of elements in @p nalus.
+ *
+ * @pre `nalus != NULL || 0 == nalus_count`
+ *
+ * @return The frame, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_LiveFrame *SmolRTSP_LiveFrame_new(
+    SmolRTSP_RtpTimestamp ts, const SmolRTSP_NalUnit *nalus,
+    size_t nalus_count) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Acquires one more reference to @p self.
+ *
+ * @pre `self != NULL`
+ *
+ * @return @p self.
+ */
+SmolRTSP_LiveFrame *
+SmolRTSP_LiveFrame_ref(SmolRTSP_LiveFrame *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the timestamp of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_RtpTimestamp SmolRTSP_LiveFrame_timestamp(
+    const SmolRTSP_LiveFrame *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns whether @p self contains an IDR slice.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_LiveFrame_is_idr(const SmolRTSP_LiveFrame *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of NAL units in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_LiveFrame_nalus_count(const SmolRTSP_LiveFrame *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NAL unit number @p i of @p self.
+ *
+ * The payload is valid as long as a reference to @p self is held.
+ *
+ * @pre `self != NULL`
+ * @pre `i < SmolRTSP_LiveFrame_nalus_count(self)`
+ */
+SmolRTSP_NalUnit SmolRTSP_LiveFrame_nalu(
+    const SmolRTSP_LiveFrame *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends @p self through @p t, setting the RTP marker on its last packet.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, 0 on
+ * success.
+ */
+int SmolRTSP_LiveFrame_send(
+    const SmolRTSP_LiveFrame *self,
+    SmolRTSP_NalTransport *t) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_LiveFrame.
+ *
+ * Releases one reference; the frame is freed with the last one.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_LiveFrame);
+
+/**
+ * A live stream fed by a single producer (e.g., an encoder) and consumed by
+ * any number of subscribers, each at its own pace.
+ *
+ * The source keeps the last `capacity` frames in a ring. Pushing a frame does
+ * not copy it for each subscriber, nor even look at the subscribers: they
+ * read the ring through their own cursors and take references to the frames
+ * they are sending. The memory of a stream is thus bounded by `capacity`
+ * frames (plus those being sent), however many clients there are and however
+ * slow they are.
+ *
+ * A subscriber that falls more than `capacity` frames behind skips to the
+ * latest IDR frame, or waits for the next one.
+ *
+ * The source is thread-safe: the producer and the subscribers can run on
+ * different threads.
+ *
+ * The keyframe requests of the subscribers (see
+ * #SmolRTSP_LiveSubscriber_request_keyframe) are coalesced before they reach
+ * the encoder; see #SmolRTSP_KeyframeRequestConfig.
+ *
+ * The source caches the latest parameter sets of its stream, so that a
+ * subscriber switching to it (see #SmolRTSP_LiveSubscriber_switch) can send
+ * them before an IDR frame that carries none.
+ */
+typedef struct SmolRTSP_LiveSource SmolRTSP_LiveSource;
+
+/**
+ * The default value for #SmolRTSP_KeyframeRequestConfig.window_us (500 ms).
+ */
+#define SMOLRTSP_KEYFRAME_REQUEST_DEFAULT_WINDOW_US 500000
+
+/**
+ * How #SmolRTSP_LiveSource forwards keyframe requests to its producer.
+ *
+ * When many clients lose packets at once (e.g., after a network blip), they
+ * all send PLI or FIR. The first request calls #request_keyframe right away;
+ * the ones within #window_us after it are merged into that call. A request of
+ * a subscriber that has a keyframe of the ring ahead of its cursor (e.g., a
+ * client that has just joined and starts from the latest IDR frame) is served
+ * from the ring and never reaches the encoder.
+ */
+typedef struct {
+    /**
+     * The time during which the requests following a forwarded one are
+     * merged into it.
+     */
+    uint64_t window_us;
+
+    /**
+     * Asks the encoder for a keyframe, if not `NULL`. It is called without the
+     * lock of the source held, from the thread of the requesting subscriber.
+     */
+    void (*request_keyframe)(void *user_data);
+
+    /**
+     * Some user-defined data passed to #request_keyframe.
+     */
+    void *user_data;
+
+    /**
+     * The clock in microseconds; if `NULL`, `CLOCK_MONOTONIC` is used.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_KeyframeRequestConfig;
+
+/**
+ * Returns the default #SmolRTSP_KeyframeRequestConfig.
+ *
+ * The default values are:
+ *
+ *  - `window_us` is #SMOLRTSP_KEYFRAME_REQUEST_DEFAULT_WINDOW_US.
+ *  - `request_keyframe` is `NULL`.
+ *  - `user_data` is `NULL`.
+ *  - `clock_us` is `NULL`.
+ */
+SmolRTSP_KeyframeRequestConfig
+SmolRTSP_KeyframeRequestConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The counters of the keyframe requests of #SmolRTSP_LiveSource.
+ */
+typedef struct {
+    /**
+     * The number of requests from the subscribers.
+     */
+    uint64_t requests;
+
+    /**
+     * The number of calls of #SmolRTSP_KeyframeRequestConfig.request_keyframe.
+     */
+    uint64_t forwarded;
+
+    /**
+     * The number of requests merged into a forwarded one.
+     */
+    uint64_t coalesced;
+
+    /**
+     * The number of requests served by a keyframe already in the ring.
+     */
+    uint64_t served_from_ring;
+} SmolRTSP_KeyframeRequestStats;
+
+/**
+ * A cursor of one client into #SmolRTSP_LiveSource.
+ */
+typedef struct SmolRTSP_LiveSubscriber SmolRTSP_LiveSubscriber;
+
+/**
+ * Creates a source keeping up to @p capacity frames.
+ *
+ * @pre `capacity > 0`
+ *
+ * @return The source, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_LiveSource *
+SmolRTSP_LiveSource_new(size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Appends @p frame to @p self, taking over the caller's reference.
+ *
+ * The oldest frame is released if @p self is full.
+ *
+ * @pre `self != NULL`
+ * @pre `frame != NULL`
+ */
+void SmolRTSP_LiveSource_push(
+    SmolRTSP_LiveSource *self, SmolRTSP_LiveFrame *frame);
+
+/**
+ * Sets how @p self forwards keyframe requests to its producer.
+ *
+ * Until it is called, the requests are only counted.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_LiveSource_set_keyframe_requests(
+    SmolRTSP_LiveSource *self, SmolRTSP_KeyframeRequestConfig config);
+
+/**
+ * Returns a snapshot of the keyframe request counters of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_KeyframeRequestStats
+SmolRTSP_LiveSource_keyframe_request_stats(SmolRTSP_LiveSource *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of frames ever pushed to @p self.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_LiveSource_frames_count(SmolRTSP_LiveSource *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_LiveSource.
+ *
+ * Releases the frames of the ring. All the subscribers must be dropped
+ * beforehand.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_LiveSource);
+
+/**
+ * Creates a subscriber of @p source that sends through @p t.
+ *
+ * The subscriber starts from the latest IDR frame in the ring, so that the
+ * client can decode right away, or from the next IDR frame if there is none.
+ *
+ * @p t is not owned by the subscriber.
+ *
+ * @pre `source != NULL`
+ * @pre `t != NULL`
+ *
+ * @return The subscriber, or `NULL` if an allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_LiveSubscriber *SmolRTSP_LiveSubscriber_new(
+    SmolRTSP_LiveSource *source,
+    SmolRTSP_NalTransport *t) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends up to @p max_frames pending frames through the transport of @p self.
+ *
+ * The frames are sent without holding the lock of the source, so a slow
+ * transport never blocks the producer.
+ *
+ * If the transport has ingested keyframe requests (counted in
+ * #SmolRTSP_RtcpStats.keyframe_requests) since the previous call, they are
+ * passed to #SmolRTSP_LiveSubscriber_request_keyframe first.
+ *
+ * @return The number of frames sent, or -1 if an I/O error occurred and sets
+ * `errno` appropriately. The failed frame is not retried.
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_LiveSubscriber_pump(
+    SmolRTSP_LiveSubscriber *self, size_t max_frames) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Asks the source of @p self for a keyframe on behalf of its client, e.g.,
+ * upon a PLI or FIR.
+ *
+ * @pre `self != NULL`
+ *
+ * @return Whether the request has been forwarded to the encoder, rather than
+ * coalesced or served from the ring.
+ */
+bool SmolRTSP_LiveSubscriber_request_keyframe(SmolRTSP_LiveSubscriber *self);
+
+/**
+ * Returns the number of frames pushed to the source but not yet sent by
+ * @p self.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_LiveSubscriber_lag(SmolRTSP_LiveSubscriber *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of frames that @p self has skipped because it fell
+ * behind the ring or was waiting for an IDR frame.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_LiveSubscriber_skipped(const SmolRTSP_LiveSubscriber *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Moves @p self to @p source, e.g., another rendition of the same camera.
+ *
+ * The subscriber keeps sending its current source until an IDR frame is
+ * pushed to @p source after this call, and asks @p source for one (see
+ * #SmolRTSP_LiveSubscriber_request_keyframe). It then sends that IDR frame,
+ * preceded by the cached parameter sets of @p source if the frame carries no
+ * SPS, and goes on with @p source. The pending frames of the old source are
+ * counted as skipped.
+ *
+ * Since the transport stays the same, the client sees one stream with a
+ * constant SSRC and continuous sequence numbers. The timestamps of the frames
+ * are sent as they are, so the renditions should be stamped by the same
+ * clock.
+ *
+ * Calling it again before the switch retargets it; switching to the current
+ * source cancels it. @p source must outlive the subscriber.
+ *
+ * @pre `self != NULL`
+ * @pre `source != NULL`
+ */
+void SmolRTSP_LiveSubscriber_switch(
+    SmolRTSP_LiveSubscriber *self, SmolRTSP_LiveSource *source);
+
+/**
+ * Returns the source that @p self is sending.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_LiveSource *
+SmolRTSP_LiveSubscriber_source(const SmolRTSP_LiveSubscriber *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of switches completed by @p self.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_LiveSubscriber_switches(const SmolRTSP_LiveSubscriber *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A source of a bitrate ladder: an encoding of a camera and its bitrate.
+ */
+typedef struct {
+    /**
+     * The source of the encoding.
+     */
+    SmolRTSP_LiveSource *source;
+
+    /**
+     * The bitrate of the encoding in bits per second.
+     */
+    uint64_t bitrate;
+} SmolRTSP_Rendition;
+
+/**
+ * The default value for #SmolRTSP_RenditionPolicy.max_fraction_lost (about
+ * 5%).
+ */
+#define SMOLRTSP_RENDITION_POLICY_DEFAULT_MAX_FRACTION_LOST 13
+
+/**
+ * The default value for #SmolRTSP_RenditionPolicy.headroom_percent.
+ */
+#define SMOLRTSP_RENDITION_POLICY_DEFAULT_HEADROOM_PERCENT 20
+
+/**
+ * How #SmolRTSP_LiveSubscriber_adapt picks a rendition.
+ */
+typedef struct {
+    /**
+     * The fraction of lost packets (divided by 256) in a receiver report
+     * above which the subscriber steps down a rendition.
+     */
+    uint8_t max_fraction_lost;
+
+    /**
+     * The share of the estimated bandwidth (in percent) that is kept unused,
+     * so that a rendition is picked only if it fits the rest.
+     */
+    uint32_t headroom_percent;
+} SmolRTSP_RenditionPolicy;
+
+/**
+ * Returns the default #SmolRTSP_RenditionPolicy.
+ *
+ * The default values are:
+ *
+ *  - `max_fraction_lost` is
+ * #SMOLRTSP_RENDITION_POLICY_DEFAULT_MAX_FRACTION_LOST.
+ *  - `headroom_percent` is #SMOLRTSP_RENDITION_POLICY_DEFAULT_HEADROOM_PERCENT.
+ */
+SmolRTSP_RenditionPolicy
+SmolRTSP_RenditionPolicy_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Picks a rendition of @p renditions for the client of @p self and switches
+ * to it (see #SmolRTSP_LiveSubscriber_switch).
+ *
+ * With @p estimator, the subscriber moves to the highest rendition that fits
+ * its target bitrate less `headroom_percent`, but only one rendition up at a
+ * time. It steps one rendition down without waiting for the estimator if its
+ * transport is full or if a receiver report with more than
+ * `max_fraction_lost` losses has arrived since the previous call.
+ *
+ * Call it periodically, e.g., once per RTCP interval.
+ *
+ * @param[in] self The subscriber to adapt.
+ * @param[in] renditions The renditions in ascending order of bitrate, one of
+ * which is the source of @p self (or the one it is switching to).
+ * @param[in] renditions_count The number of elements in @p renditions.
+ * @param[in] policy The thresholds of the decision.
+ * @param[in] estimator The bandwidth estimator of the transport of @p self,
+ * or `NULL`.
+ *
+ * @return The index of the rendition picked.
+ *
+ * @pre `self != NULL`
+ * @pre `renditions != NULL`
+ * @pre `renditions_count > 0`
+ */
+size_t SmolRTSP_LiveSubscriber_adapt(
+    SmolRTSP_LiveSubscriber *self, const SmolRTSP_Rendition *renditions,
+    size_t renditions_count, SmolRTSP_RenditionPolicy policy,
+    const SmolRTSP_BandwidthEstimator *estimator);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_LiveSubscriber.
+ *
+ * The transport is not dropped.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_LiveSubscriber);
@@ -0,0 +1,183 @@
+/**
+ * @file
+ * @brief A memory-mapped video file with an index of its NAL units, for
+ * video on demand.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * An access unit of #SmolRTSP_MediaFile, i.e., the NAL units of one picture.
+ */
+typedef struct {
+    /**
+     * The index of the first NAL unit of this access unit.
+     */
+    size_t first_nalu;
+
+    /**
+     * The number of NAL units in this access unit.
+     */
+    size_t nalus_count;
+
+    /**
+     * Whether this access unit contains an IDR slice, i.e., playback can start
+     * from it.
+     */
+    bool is_idr;
+} SmolRTSP_AccessUnit;
+
+/**
+ * A raw H.264 or H.265 elementary stream file, mapped into memory and indexed
+ * by NAL units, access units, and IDR access units.
+ *
+ * The NAL units point straight into the mapping, so that sending them copies
+ * nothing into user space, and all the clients playing the same file share
+ * the pages of the page cache. A file is immutable once opened and can be
+ * read from any number of threads.
+ *
+ * The index is built by a single scan of the file on open. When an index path
+ * is given, it is loaded from there instead if it has been built for the same
+ * file (of the same size and modification time), and written there otherwise,
+ * so that the scan is done once per file rather than once per process.
+ */
+typedef struct SmolRTSP_MediaFile SmolRTSP_MediaFile;
+
+/**
+ * Opens the video file @p path.
+ *
+ * @param[in] path The path to the file.
+ * @param[in] codec The codec of the video.
+ * @param[in] length_size 0 if the file is an Annex B byte stream; otherwise,
+ * the size of the length prefixes of NAL units (1, 2, or 4), as in AVCC/HVCC.
+ * @param[in] index_path The path to the persisted index, or `NULL` to build it
+ * in memory only. Failing to write the index is not an error.
+ *
+ * @return The file, or `NULL` if it cannot be opened or mapped (and sets
+ * `errno` accordingly), its length prefixes are malformed (and sets `errno`
+ * to `EBADMSG`), or its index cannot be allocated (and sets `errno` to
+ * `ENOMEM`).
+ *
+ * @pre `path != NULL`
+ * @pre `length_size` is 0, 1, 2, or 4.
+ */
+SmolRTSP_MediaFile *SmolRTSP_MediaFile_open(
+    const char *path, SmolRTSP_NalCodec codec, size_t length_size,
+    const char *index_path) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the codec of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_NalCodec SmolRTSP_MediaFile_codec(const SmolRTSP_MediaFile *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of NAL units in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_MediaFile_nalus_count(const SmolRTSP_MediaFile *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NAL unit number @p i of @p self.
+ *
+ * The payload points into the mapping and stays valid until @p self is
+ * dropped.
+ *
+ * @pre `self != NULL`
+ * @pre `i < SmolRTSP_MediaFile_nalus_count(self)`
+ */
+SmolRTSP_NalUnit SmolRTSP_MediaFile_nalu(
+    const SmolRTSP_MediaFile *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of access units in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_MediaFile_access_units_count(const SmolRTSP_MediaFile *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the access unit number @p i of @p self.
+ *
+ * Access units are delimited by the first slices of pictures and by the NAL
+ * units that may only precede them (access unit delimiters, parameter sets,
+ * SEI).
+ *
+ * @pre `self != NULL`
+ * @pre `i < SmolRTSP_MediaFile_access_units_count(self)`
+ */
+SmolRTSP_AccessUnit SmolRTSP_MediaFile_access_unit(
+    const SmolRTSP_MediaFile *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Finds the last IDR access unit at or before the access unit number @p i.
+ *
+ * The IDR access units are kept in a sorted table, so this takes logarithmic
+ * time regardless of the distance to the IDR.
+ *
+ * @return The index of the access unit, or -1 if there is none.
+ *
+ * @pre `self != NULL`
+ * @pre `i < SmolRTSP_MediaFile_access_units_count(self)`
+ */
+ssize_t SmolRTSP_MediaFile_find_idr(
+    const SmolRTSP_MediaFile *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Finds the access unit from which to play the normal play time @p npt_ms,
+ * i.e., the last IDR access unit at or before it.
+ *
+ * Raw elementary streams carry no timestamps, so access units are assumed to
+ * last `frame_rate_den / frame_rate_num` seconds each (e.g., 30000/1001 for
+ * 29.97 fps). Times past the end are clamped to the last access unit.
+ *
+ * Typical usage in `play`:
+ *
+ * @code
+ * SmolRTSP_NptRange range;
+ * CharSlice99 value;
+ * if (SmolRTSP_HeaderMap_find(&req->header_map, SMOLRTSP_HEADER_RANGE, &value)
+ *     && smolrtsp_parse_npt_range(&range, value) == 0) {
+ *     const ssize_t au = SmolRTSP_MediaFile_seek(file, range.start_ms, 25, 1);
+ *     // Start sending from `au`; the actual start to report in the `Range`
+ *     // response header is `au * 1000 * frame_rate_den / frame_rate_num`.
+ * }
+ * @endcode
+ *
+ * @return The index of the access unit, or -1 if there is no IDR access unit
+ * at or before @p npt_ms.
+ *
+ * @pre `self != NULL`
+ * @pre `frame_rate_num > 0 && frame_rate_den > 0`
+ */
+ssize_t SmolRTSP_MediaFile_seek(
+    const SmolRTSP_MediaFile *self, uint64_t npt_ms, uint32_t frame_rate_num,
+    uint32_t frame_rate_den) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_MediaFile.
+ *
+ * Unmaps the file; the NAL units obtained from it become invalid.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_MediaFile);
@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @brief UDP multicast delivery: sockets, group allocation, and `Transport`
+ * responses.
+ */
+
+#pragma once
+
+#include <smolrtsp/context.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/util.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The configuration structure for #smolrtsp_multicast_socket.
+ */
+typedef struct {
+    /**
+     * The time-to-live (IPv4) or hop limit (IPv6) of the datagrams, i.e., how
+     * many routers they can cross.
+     */
+    uint8_t ttl;
+
+    /**
+     * Whether the datagrams are looped back to the receivers on the sending
+     * host.
+     */
+    bool loopback;
+
+    /**
+     * The index of the outgoing interface (as returned by `if_nametoindex`),
+     * or 0 to follow the routing table.
+     */
+    unsigned interface_index;
+} SmolRTSP_MulticastConfig;
+
+/**
+ * Returns the default #SmolRTSP_MulticastConfig.
+ *
+ * The default values are:
+ *
+ *  - `ttl` is 16, enough for a campus network.
+ *  - `loopback` is `false`.
+ *  - `interface_index` is 0.
+ */
+SmolRTSP_MulticastConfig
+SmolRTSP_MulticastConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a datagram socket sending to the multicast group @p group.
+ *
+ * The socket is connected to @p group and @p port, so that it can be passed to
+ * #smolrtsp_transport_udp: the resulting transport sends every packet once for
+ * all the receivers that have joined the group. Share it (e.g., via
+ * #SmolRTSP_RtpFanout or #SmolRTSP_LiveSource) among all the sessions of the
+ * stream rather than creating one per client.
+ *
+ * @param[in] af The socket namespace. Can be `AF_INET` or `AF_INET6`; if none
+ * of them, returns -1 and sets `errno` to `EAFNOSUPPORT`.
+ * @param[in] group The group address: `struct in_addr` for `AF_INET` and
+ * `struct in6_addr` for `AF_INET6`. If it is not a multicast address, returns
+ * -1 and sets `errno` to `EINVAL`.
+ * @param[in] port The destination port in the host byte order.
+ * @param[in] config The multicast configuration.
+ *
+ * @return A valid file descriptor or -1 on error (and sets `errno`
+ * appropriately).
+ *
+ * @pre `group != NULL`
+ */
+int smolrtsp_multicast_socket(
+    int af, const void *restrict group, uint16_t port,
+    SmolRTSP_MulticastConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * An IPv4 multicast group and its RTP/RTCP port pair, as assigned to a stream.
+ */
+typedef struct {
+    /**
+     * The group address.
+     */
+    struct in_addr addr;
+
+    /**
+     * The RTP and RTCP ports.
+     */
+    SmolRTSP_PortPair ports;
+} SmolRTSP_MulticastGroup;
+
+/**
+ * A pool of multicast groups for `SETUP`.
+ *
+ * Each stream (identified by a key of the caller's choice, e.g., the request
+ * URI of its track) is assigned its own group, which is shared by all the
+ * clients watching it: the first `SETUP` of a stream acquires a group, the
+ * next ones get the same group, and the group returns to the pool once all of
+ * them have released it.
+ *
+ * The pool is thread-safe.
+ */
+typedef struct SmolRTSP_MulticastPool SmolRTSP_MulticastPool;
+
+/**
+ * Creates a pool of @p groups_count consecutive groups starting at
+ * @p first_group.
+ *
+ * The group number `i` is assigned the ports `first_port + 2 * i` (RTP) and
+ * `first_port + 2 * i + 1` (RTCP).
+ *
+ * @param[in] first_group The first group address (e.g., `239.255.0.1` of the
+ * administratively scoped range).
+ * @param[in] groups_count The number of groups.
+ * @param[in] first_port The first RTP port, which must be even.
+ *
+ * @pre `groups_count > 0`
+ * @pre `first_port % 2 == 0`
+ * @pre `first_port + 2 * groups_count - 1 <= UINT16_MAX`
+ *
+ * @return The pool, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_MulticastPool *SmolRTSP_MulticastPool_new(
+    struct in_addr first_group, size_t groups_count,
+    uint16_t first_port) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Acquires the group of the stream @p key, assigning a free one on its first
+ * acquisition.
+ *
+ * @param[in] self The pool to acquire from.
+ * @param[in] key The identifier of the stream (copied).
+ * @param[out] group The group of the stream.
+ *
+ * @return -1 if all the groups are assigned to other streams (and sets `errno`
+ * to `ENOSPC`) or if the key cannot be copied (and sets `errno` to `ENOMEM`),
+ * 0 on success.
+ *
+ * @pre `self != NULL`
+ * @pre `group != NULL`
+ */
+int SmolRTSP_MulticastPool_acquire(
+    SmolRTSP_MulticastPool *self, CharSlice99 key,
+    SmolRTSP_MulticastGroup *restrict group) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Releases one acquisition of the group of the stream @p key.
+ *
+ * @return `true` if this was the last acquisition, i.e., the stream can stop
+ * sending, `false` otherwise (or if @p key has no group).
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_MulticastPool_release(
+    SmolRTSP_MulticastPool *self, CharSlice99 key);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_MulticastPool.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_MulticastPool);
+
+/**
+ * Appends the `Transport` header answering a multicast `SETUP`, e.g.,
+ * `RTP/AVP;multicast;destination=239.255.0.1;port=5000-5001;ttl=16`.
+ *
+ * @param[out] ctx The request context to modify.
+ * @param[in] group The group of the stream.
+ * @param[in] ttl The time-to-live of the datagrams.
+ *
+ * @pre `ctx != NULL`
+ *
+ * @see <https://datatracker.ietf.org/doc/html/rfc2326#section-12.39>
+ */
+void smolrtsp_multicast_transport_header(
+    SmolRTSP_Context *ctx, SmolRTSP_MulticastGroup group, uint8_t ttl);
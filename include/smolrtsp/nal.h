@@ -124,6 +124,38 @@ typedef struct {
     U8Slice99 payload;
 } SmolRTSP_NalUnit;
 
+/**
+ * A video codec carried in NAL units.
+ */
+typedef enum {
+    /**
+     * H.264 (AVC).
+     */
+    SmolRTSP_NalCodec_H264,
+
+    /**
+     * H.265 (HEVC).
+     */
+    SmolRTSP_NalCodec_H265,
+} SmolRTSP_NalCodec;
+
+/**
+ * Returns the NAL header size of @p codec in bytes.
+ */
+size_t
+SmolRTSP_NalCodec_header_size(SmolRTSP_NalCodec codec) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Parses a NAL unit of @p codec from @p data, which consists of a NAL header
+ * followed by the payload.
+ *
+ * The payload of the result points into @p data.
+ *
+ * @pre `data.len >= SmolRTSP_NalCodec_header_size(codec)`
+ */
+SmolRTSP_NalUnit SmolRTSP_NalUnit_parse(
+    SmolRTSP_NalCodec codec, U8Slice99 data) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Creates a generic NAL FU header.
  */
@@ -165,3 +197,15 @@ size_t smolrtsp_test_start_code_3b(U8Slice99 data);
  * The 3-byte start code tester (`0x00000001`).
  */
 size_t smolrtsp_test_start_code_4b(U8Slice99 data);
+
+/**
+ * Finds the first start code in @p data.
+ *
+ * The whole buffer is scanned with SIMD instructions where available (SSE2,
+ * AVX2 selected at runtime, or NEON).
+ *
+ * @return The offset of the first start code in @p data, or `data.len` if there
+ * is none. If the start code is `0x00000001`, the offset of its first byte is
+ * returned, so that #smolrtsp_test_start_code_4b succeeds there.
+ */
+size_t smolrtsp_find_next_start_code(U8Slice99 data) SMOLRTSP_PRIV_MUST_USE;
@@ -120,6 +120,78 @@ void SmolRTSP_H264NalHeader_write_fu_header(
     SmolRTSP_H264NalHeader self, uint8_t buffer[restrict],
     bool is_first_fragment, bool is_last_fragment);
 
+/**
+ * The stream properties from an H.264 sequence parameter set.
+ *
+ * @see ITU-T H.264, section 7.3.2.1.1.
+ */
+typedef struct {
+    /**
+     * `profile_idc` u(8).
+     */
+    uint8_t profile_idc;
+
+    /**
+     * `constraint_set0_flag` to `constraint_set5_flag` and
+     * `reserved_zero_2bits`, as a single octet (`profile-level-id` of RFC
+     * 6184 has it in the middle).
+     */
+    uint8_t constraint_flags;
+
+    /**
+     * `level_idc` u(8).
+     */
+    uint8_t level_idc;
+
+    /**
+     * `seq_parameter_set_id` ue(v).
+     */
+    uint32_t seq_parameter_set_id;
+
+    /**
+     * `chroma_format_idc` ue(v); 1 (4:2:0) unless signalled.
+     */
+    uint32_t chroma_format_idc;
+
+    /**
+     * The bit depths of the luma and chroma samples.
+     */
+    uint32_t bit_depth_luma, bit_depth_chroma;
+
+    /**
+     * `max_num_ref_frames` ue(v).
+     */
+    uint32_t max_num_ref_frames;
+
+    /**
+     * `frame_mbs_only_flag` u(1).
+     */
+    bool frame_mbs_only_flag;
+
+    /**
+     * The size of the decoded frames in luma samples, after cropping.
+     */
+    uint32_t width, height;
+} SmolRTSP_H264Sps;
+
+/**
+ * Parses an H.264 sequence parameter set.
+ *
+ * The emulation prevention bytes are skipped while reading; nothing is
+ * allocated or copied. Fields after `frame_cropping_flag` (VUI) are not read.
+ *
+ * @param[out] self The parsed SPS.
+ * @param[in] payload The payload of an SPS NAL unit (not including the NAL
+ * header).
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p payload is truncated or malformed and sets `errno` to
+ * `EBADMSG`, 0 on success.
+ */
+int SmolRTSP_H264Sps_parse(
+    SmolRTSP_H264Sps *restrict self, U8Slice99 payload) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Unspecified.
  */
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <slice99.h>
 
@@ -124,6 +125,150 @@ void SmolRTSP_H265NalHeader_write_fu_header(
     SmolRTSP_H265NalHeader self, uint8_t buffer[restrict],
     bool is_first_fragment, bool is_last_fragment);
 
+/**
+ * The general part of an H.265 `profile_tier_level` structure.
+ *
+ * @see ITU-T H.265, section 7.3.3.
+ */
+typedef struct {
+    /**
+     * `general_profile_space` u(2).
+     */
+    uint8_t profile_space;
+
+    /**
+     * `general_tier_flag` u(1).
+     */
+    bool tier_flag;
+
+    /**
+     * `general_profile_idc` u(5).
+     */
+    uint8_t profile_idc;
+
+    /**
+     * `general_profile_compatibility_flag[j]` u(1) for `j = 0..31`, the first
+     * flag being the most significant bit.
+     */
+    uint32_t profile_compatibility_flags;
+
+    /**
+     * `general_level_idc` u(8).
+     */
+    uint8_t level_idc;
+} SmolRTSP_H265ProfileTierLevel;
+
+/**
+ * The stream properties from an H.265 video parameter set.
+ *
+ * @see ITU-T H.265, section 7.3.2.1.
+ */
+typedef struct {
+    /**
+     * `vps_video_parameter_set_id` u(4).
+     */
+    uint8_t video_parameter_set_id;
+
+    /**
+     * `vps_max_layers_minus1` u(6) plus 1.
+     */
+    uint8_t max_layers;
+
+    /**
+     * `vps_max_sub_layers_minus1` u(3) plus 1.
+     */
+    uint8_t max_sub_layers;
+
+    /**
+     * `vps_temporal_id_nesting_flag` u(1).
+     */
+    bool temporal_id_nesting_flag;
+
+    /**
+     * The general profile, tier, and level.
+     */
+    SmolRTSP_H265ProfileTierLevel profile_tier_level;
+} SmolRTSP_H265Vps;
+
+/**
+ * The stream properties from an H.265 sequence parameter set.
+ *
+ * @see ITU-T H.265, section 7.3.2.2.
+ */
+typedef struct {
+    /**
+     * `sps_video_parameter_set_id` u(4).
+     */
+    uint8_t video_parameter_set_id;
+
+    /**
+     * `sps_max_sub_layers_minus1` u(3) plus 1.
+     */
+    uint8_t max_sub_layers;
+
+    /**
+     * The general profile, tier, and level.
+     */
+    SmolRTSP_H265ProfileTierLevel profile_tier_level;
+
+    /**
+     * `sps_seq_parameter_set_id` ue(v).
+     */
+    uint32_t seq_parameter_set_id;
+
+    /**
+     * `chroma_format_idc` ue(v).
+     */
+    uint32_t chroma_format_idc;
+
+    /**
+     * The size of the decoded pictures in luma samples, after applying the
+     * conformance window.
+     */
+    uint32_t width, height;
+
+    /**
+     * The bit depths of the luma and chroma samples.
+     */
+    uint32_t bit_depth_luma, bit_depth_chroma;
+} SmolRTSP_H265Sps;
+
+/**
+ * Parses an H.265 video parameter set.
+ *
+ * The emulation prevention bytes are skipped while reading; nothing is
+ * allocated or copied. Fields after `profile_tier_level` are not read.
+ *
+ * @param[out] self The parsed VPS.
+ * @param[in] payload The payload of a VPS NAL unit (not including the NAL
+ * header).
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p payload is truncated or malformed and sets `errno` to
+ * `EBADMSG`, 0 on success.
+ */
+int SmolRTSP_H265Vps_parse(
+    SmolRTSP_H265Vps *restrict self, U8Slice99 payload) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Parses an H.265 sequence parameter set.
+ *
+ * The emulation prevention bytes are skipped while reading; nothing is
+ * allocated or copied. Fields after `bit_depth_chroma_minus8` are not read.
+ *
+ * @param[out] self The parsed SPS.
+ * @param[in] payload The payload of an SPS NAL unit (not including the NAL
+ * header).
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p payload is truncated or malformed and sets `errno` to
+ * `EBADMSG`, 0 on success.
+ */
+int SmolRTSP_H265Sps_parse(
+    SmolRTSP_H265Sps *restrict self, U8Slice99 payload) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Coded slice segment of a non-TSA, non-STSA trailing picture.
  */
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Length-prefixed (AVCC/HVCC) NAL unit input, as produced by MP4 and
+ * Matroska demuxers.
+ *
+ * @see ISO/IEC 14496-15, sections 5.3.3 (avcC) and 8.3.3 (hvcC).
+ */
+
+#pragma once
+
+#include <smolrtsp/nal.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum number of parameter sets stored in #SmolRTSP_NalExtradata.
+ */
+#define SMOLRTSP_NAL_EXTRADATA_MAX_PARAMETER_SETS 16
+
+/**
+ * An iterator over a buffer of NAL units, each preceded by its big-endian
+ * length.
+ */
+typedef struct {
+    /**
+     * The codec of the NAL units.
+     */
+    SmolRTSP_NalCodec codec;
+
+    /**
+     * The size of each length prefix in bytes (1, 2, or 4).
+     */
+    size_t length_size;
+
+    /**
+     * The remaining data.
+     */
+    U8Slice99 data;
+} SmolRTSP_NalLengthIter;
+
+/**
+ * Creates an iterator over @p data.
+ *
+ * @pre `length_size` is 1, 2, or 4.
+ */
+SmolRTSP_NalLengthIter SmolRTSP_NalLengthIter_new(
+    SmolRTSP_NalCodec codec, size_t length_size,
+    U8Slice99 data) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Extracts the next NAL unit.
+ *
+ * The payload of @p nalu points into the iterated buffer; no data is copied or
+ * scanned.
+ *
+ * @pre `self != NULL`
+ * @pre `nalu != NULL`
+ *
+ * @return 1 if a NAL unit has been written to @p nalu, 0 if the buffer is
+ * exhausted, or -1 if the buffer is malformed (a length prefix is truncated or
+ * exceeds the remaining data, or a NAL unit is shorter than its header) and
+ * sets `errno` to `EBADMSG`.
+ */
+int SmolRTSP_NalLengthIter_next(
+    SmolRTSP_NalLengthIter *restrict self,
+    SmolRTSP_NalUnit *restrict nalu) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Decoder configuration (`avcC` or `hvcC` extradata).
+ */
+typedef struct {
+    /**
+     * The size of the length prefixes of NAL units in the stream (1, 2, or 4).
+     */
+    size_t length_size;
+
+    /**
+     * The number of elements in `parameter_sets`.
+     */
+    size_t parameter_sets_count;
+
+    /**
+     * The parameter sets of the stream (VPS, SPS, PPS, and possibly SEI for
+     * H.265), in the order of their appearance; they point into the extradata.
+     */
+    SmolRTSP_NalUnit
+        parameter_sets[SMOLRTSP_NAL_EXTRADATA_MAX_PARAMETER_SETS];
+} SmolRTSP_NalExtradata;
+
+/**
+ * Parses the @p codec extradata @p data (`avcC` for H.264, `hvcC` for H.265).
+ *
+ * Parameter sets beyond #SMOLRTSP_NAL_EXTRADATA_MAX_PARAMETER_SETS are
+ * ignored.
+ *
+ * @param[in] codec The codec of the stream.
+ * @param[in] data The extradata, i.e., the contents of the `avcC` or `hvcC`
+ * box.
+ * @param[out] self The parsed configuration.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p data is malformed and sets `errno` to `EBADMSG` (or to
+ * `EINVAL` for H.265 in a build without it; see the `SMOLRTSP_H265` CMake
+ * option), 0 on success.
+ */
+int SmolRTSP_NalExtradata_parse(
+    SmolRTSP_NalExtradata *restrict self, SmolRTSP_NalCodec codec,
+    U8Slice99 data) SMOLRTSP_PRIV_MUST_USE;
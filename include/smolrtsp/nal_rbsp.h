@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @brief Emulation prevention and bit-level reading of NAL unit payloads.
+ *
+ * A NAL unit payload (EBSP) is its RBSP with an emulation prevention byte
+ * `0x03` inserted after every two zero bytes that are followed by a byte in
+ * `0x00..0x03`, so that no start code appears inside a NAL unit.
+ *
+ * @see ITU-T H.264, section 7.4.1.
+ * @see ITU-T H.265, section 7.4.2.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The size of a buffer sufficient for #smolrtsp_nal_escape applied to an RBSP
+ * of @p len bytes.
+ */
+#define SMOLRTSP_NAL_ESCAPED_MAX_SIZE(len) ((len) + (len) / 2 + 1)
+
+/**
+ * Removes the emulation prevention bytes from @p ebsp.
+ *
+ * The buffer is scanned with SIMD instructions where available (SSE2, AVX2
+ * selected at runtime, or NEON).
+ *
+ * @param[in] ebsp The NAL unit payload.
+ * @param[out] rbsp The memory area capable of storing `ebsp.len` bytes. It can
+ * be `ebsp.ptr` itself for in-place conversion.
+ *
+ * @return The size of the RBSP written to @p rbsp.
+ */
+size_t smolrtsp_nal_unescape(U8Slice99 ebsp, uint8_t *rbsp);
+
+/**
+ * Computes the size of @p rbsp after #smolrtsp_nal_escape.
+ */
+size_t smolrtsp_nal_escaped_size(U8Slice99 rbsp) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Inserts emulation prevention bytes into @p rbsp.
+ *
+ * The buffer is scanned with SIMD instructions where available (SSE2, AVX2
+ * selected at runtime, or NEON), and the runs between insertions are copied
+ * as a whole.
+ *
+ * @param[in] rbsp The raw payload.
+ * @param[out] ebsp The memory area capable of storing
+ * `smolrtsp_nal_escaped_size(rbsp)` bytes (at most
+ * `SMOLRTSP_NAL_ESCAPED_MAX_SIZE(rbsp.len)`).
+ *
+ * @return The size of the NAL unit payload written to @p ebsp.
+ */
+size_t smolrtsp_nal_escape(U8Slice99 rbsp, uint8_t ebsp[restrict]);
+
+/**
+ * A bit reader over a NAL unit payload that skips emulation prevention bytes
+ * on the fly, so that no unescaped copy is needed.
+ *
+ * Reading past the end or an invalid Exp-Golomb code marks the reader as
+ * failed and yields zeros afterwards; check #SmolRTSP_RbspReader_is_ok once
+ * after a series of reads.
+ */
+typedef struct {
+    /**
+     * The remaining payload bytes.
+     */
+    U8Slice99 data;
+
+    /**
+     * The number of consecutive zero bytes read last.
+     */
+    uint8_t zeros;
+
+    /**
+     * The current byte and the number of its bits not yet read.
+     */
+    uint8_t byte, bits_left;
+
+    /**
+     * Whether all the reads so far have succeeded.
+     */
+    bool ok;
+} SmolRTSP_RbspReader;
+
+/**
+ * Creates a reader at the beginning of @p ebsp.
+ */
+SmolRTSP_RbspReader
+SmolRTSP_RbspReader_new(U8Slice99 ebsp) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Reads @p n bits as a big-endian unsigned integer (`u(n)`).
+ *
+ * @pre `self != NULL`
+ * @pre `n <= 32`
+ */
+uint32_t SmolRTSP_RbspReader_bits(SmolRTSP_RbspReader *self, unsigned n);
+
+/**
+ * Skips @p n bits.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_RbspReader_skip(SmolRTSP_RbspReader *self, size_t n);
+
+/**
+ * Reads an unsigned Exp-Golomb code (`ue(v)`) of at most 32 bits.
+ *
+ * @pre `self != NULL`
+ */
+uint32_t SmolRTSP_RbspReader_ue(SmolRTSP_RbspReader *self);
+
+/**
+ * Reads a signed Exp-Golomb code (`se(v)`).
+ *
+ * @pre `self != NULL`
+ */
+int32_t SmolRTSP_RbspReader_se(SmolRTSP_RbspReader *self);
+
+/**
+ * Checks whether all the reads from @p self have succeeded.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_RbspReader_is_ok(const SmolRTSP_RbspReader *self)
+    SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief An incremental splitter of Annex B byte streams into NAL units.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+
+#include <stdbool.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A splitter of an Annex B byte stream (NAL units delimited by `0x000001` or
+ * `0x00000001` start codes), which is fed in chunks of arbitrary sizes.
+ *
+ * A NAL unit is emitted as soon as the start code that follows it is seen.
+ * NAL units that lie completely within one chunk are not copied; only a NAL
+ * unit that spans several chunks is accumulated in an internal buffer. Start
+ * codes that straddle chunk boundaries are recognized.
+ *
+ * Bytes before the first start code are discarded. Trailing zero bytes of NAL
+ * units (`trailing_zero_8bits`) are not included.
+ *
+ * Typical usage:
+ *
+ * @code
+ * SmolRTSP_NalSplitter_feed(splitter, chunk);
+ * SmolRTSP_NalUnit nalu;
+ * while (SmolRTSP_NalSplitter_next(splitter, &nalu) == 1) {
+ *     // Process `nalu`.
+ * }
+ * @endcode
+ */
+typedef struct SmolRTSP_NalSplitter SmolRTSP_NalSplitter;
+
+/**
+ * Creates a new splitter of a @p codec byte stream.
+ *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails.
+ */
+SmolRTSP_NalSplitter *
+SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec codec) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Supplies the next chunk of the byte stream.
+ *
+ * @p chunk must stay valid until the next call to #SmolRTSP_NalSplitter_feed
+ * or #SmolRTSP_NalSplitter_finish.
+ *
+ * @pre `self != NULL`
+ * @pre The previous chunk has been exhausted, that is,
+ * #SmolRTSP_NalSplitter_next has returned 0.
+ */
+void SmolRTSP_NalSplitter_feed(SmolRTSP_NalSplitter *self, U8Slice99 chunk);
+
+/**
+ * Extracts the next complete NAL unit.
+ *
+ * The data of @p nalu points either into the current chunk or into the
+ * internal buffer of @p self, and is valid until the next call to any function
+ * on @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `nalu != NULL`
+ *
+ * @return 1 if a NAL unit has been written to @p nalu, 0 if more data is
+ * needed, or -1 if the internal buffer cannot grow for a NAL unit that spans
+ * several chunks (and sets `errno` to `ENOMEM`). In the latter case, that NAL
+ * unit is skipped up to the next start code, and the rest of the chunk can
+ * still be split by calling this function again.
+ */
+int SmolRTSP_NalSplitter_next(
+    SmolRTSP_NalSplitter *self, SmolRTSP_NalUnit *restrict nalu)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Ends the byte stream and extracts the last NAL unit, which is not followed
+ * by a start code.
+ *
+ * After this function, @p self is ready to split a new byte stream.
+ *
+ * @pre `self != NULL`
+ * @pre `nalu != NULL`
+ * @pre #SmolRTSP_NalSplitter_next has returned 0.
+ *
+ * @return `true` if a NAL unit has been written to @p nalu, `false` otherwise.
+ */
+bool SmolRTSP_NalSplitter_finish(
+    SmolRTSP_NalSplitter *self, SmolRTSP_NalUnit *restrict nalu)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_NalSplitter.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_NalSplitter);
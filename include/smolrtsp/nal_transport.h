@@ -11,9 +11,12 @@
 #pragma once
 
 #include <smolrtsp/droppable.h>
+#include <smolrtsp/latency_histogram.h>
 #include <smolrtsp/nal.h>
+#include <smolrtsp/param_set_cache.h>
 #include <smolrtsp/rtp_transport.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -29,19 +32,114 @@
  */
 #define SMOLRTSP_MAX_H265_NALU_SIZE 4096
 
+/**
+ * The reaction of #SmolRTSP_NalTransport to a full underlying transport.
+ *
+ * The policy is applied to whole NAL units: a NAL unit that has started being
+ * sent is never truncated.
+ */
+typedef enum {
+    /**
+     * Send NAL units regardless of the transport state, waiting for the
+     * underlying transport if needed.
+     */
+    SmolRTSP_BackpressurePolicy_Block,
+
+    /**
+     * Drop all NAL units except parameter sets (VPS, SPS, PPS) until the next
+     * IDR access unit can be sent.
+     *
+     * The receiver sees a clean cut from one GOP to another instead of
+     * corrupted inter-predicted frames.
+     */
+    SmolRTSP_BackpressurePolicy_DropUntilIdr,
+
+    /**
+     * Drop the rest of the access unit (the NAL units sharing the same RTP
+     * timestamp) that was being sent when the transport became full.
+     */
+    SmolRTSP_BackpressurePolicy_DropAccessUnit,
+
+    /**
+     * Thin the stream by dropping the pictures that no other picture which is
+     * still sent depends on, starting with the most disposable ones: H.264
+     * non-reference pictures (`nal_ref_idc == 0`), and H.265 pictures from
+     * the highest temporal sub-layer down, sub-layer non-reference ones first.
+     *
+     * The thinning level is decided once per access unit: it is raised while
+     * the transport is full at the start of an access unit, and lowered again
+     * after #SMOLRTSP_THINNING_RECOVERY_ACCESS_UNITS access units that start
+     * with room in the transport. Parameter sets, other non-VCL NAL units,
+     * and the pictures of the H.264 reference or H.265 base layer are never
+     * dropped, so the stream stays decodable at a lower frame rate.
+     */
+    SmolRTSP_BackpressurePolicy_Thin,
+} SmolRTSP_BackpressurePolicy;
+
+/**
+ * The number of consecutive access units starting with room in the transport
+ * after which #SmolRTSP_BackpressurePolicy_Thin lowers its thinning level.
+ */
+#define SMOLRTSP_THINNING_RECOVERY_ACCESS_UNITS 8
+
 /**
  * The configuration structure for #SmolRTSP_NalTransport.
  */
 typedef struct {
     /**
      * The maximum size of an H.264 NAL unit (including the header).
+     *
+     * If the underlying transport reports a lower `max_packet_size` (e.g., the
+     * path MTU of a UDP socket), the latter is used instead; it is queried for
+     * every NAL unit, so the budget follows the path at runtime.
      */
     size_t max_h264_nalu_size;
 
     /**
      * The maximum size of an H.265 NAL unit (including the header).
+     *
+     * Lowered to the `max_packet_size` of the underlying transport in the same
+     * way as `max_h264_nalu_size`.
      */
     size_t max_h265_nalu_size;
+
+    /**
+     * What to do with NAL units when the underlying transport is full.
+     */
+    SmolRTSP_BackpressurePolicy backpressure_policy;
+
+    /**
+     * Whether to coalesce consecutive small NAL units sharing a timestamp into
+     * aggregation packets (STAP-A for H.264, AP for H.265) of at most
+     * `max_h264_nalu_size`/`max_h265_nalu_size` bytes.
+     *
+     * Non-VCL NAL units (such as parameter sets and SEI) are held back until a
+     * coded slice, a NAL unit with another timestamp, or
+     * #SmolRTSP_NalTransport_flush is sent.
+     *
+     * @see Aggregation Packets (H.264):
+     * <https://datatracker.ietf.org/doc/html/rfc6184#section-5.7.1>
+     * @see Aggregation Packets (H.265):
+     * <https://datatracker.ietf.org/doc/html/rfc7798#section-4.4.2>
+     */
+    bool aggregation;
+
+    /**
+     * If not `NULL`, the time from a `send_*` call to the last packet of the
+     * NAL unit being handed to the underlying transport is recorded there.
+     *
+     * Dropped NAL units, failed sends, and the NAL units held back for
+     * `aggregation` are not recorded. If the transport delays packets (e.g.,
+     * #SmolRTSP_Pacer), record its queueing delay as well (see
+     * #SmolRTSP_PacerConfig.latency).
+     */
+    SmolRTSP_LatencyHistogram *latency;
+
+    /**
+     * The clock in microseconds for `latency`; if `NULL`, `CLOCK_MONOTONIC`
+     * is used.
+     */
+    uint64_t (*clock_us)(void);
 } SmolRTSP_NalTransportConfig;
 
 /**
@@ -51,6 +149,9 @@ typedef struct {
  *
  *  - `max_h264_nalu_size` is #SMOLRTSP_MAX_H264_NALU_SIZE.
  *  - `max_h265_nalu_size` is #SMOLRTSP_MAX_H265_NALU_SIZE.
+ *  - `backpressure_policy` is #SmolRTSP_BackpressurePolicy_Block.
+ *  - `aggregation` is `false`.
+ *  - `latency` and `clock_us` are `NULL`.
  */
 SmolRTSP_NalTransportConfig
 SmolRTSP_NalTransportConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
@@ -60,9 +161,72 @@ SmolRTSP_NalTransportConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
  */
 typedef struct SmolRTSP_NalTransport SmolRTSP_NalTransport;
 
+/**
+ * The counters of #SmolRTSP_NalTransport, including the statistics of NAL
+ * units dropped by #SmolRTSP_NalTransportConfig.backpressure_policy.
+ */
+typedef struct {
+    /**
+     * The number of NAL units passed to the RTP transport (i.e., not
+     * dropped).
+     */
+    uint64_t nalus;
+
+    /**
+     * The number of NAL units split into fragmentation units.
+     */
+    uint64_t fragmented_nalus;
+
+    /**
+     * The number of fragmentation units sent; divide by `fragmented_nalus` to
+     * get the average number of fragments per fragmented NAL unit.
+     */
+    uint64_t fragments;
+
+    /**
+     * The number of NAL units resent with smaller fragments after `EMSGSIZE`.
+     */
+    uint64_t emsgsize_retries;
+
+    /**
+     * The number of NAL units that have failed to be sent.
+     */
+    uint64_t errors;
+
+    /**
+     * The number of dropped NAL units.
+     */
+    uint64_t dropped_nalus;
+
+    /**
+     * The number of dropped NAL unit bytes (including the NAL headers).
+     */
+    uint64_t dropped_bytes;
+
+    /**
+     * The number of access units of which at least one NAL unit was dropped.
+     */
+    uint64_t dropped_access_units;
+
+    /**
+     * The current thinning level of #SmolRTSP_BackpressurePolicy_Thin: the
+     * number of the most disposable kinds of pictures being dropped, 0 if
+     * none.
+     */
+    uint64_t thinning_level;
+
+    /**
+     * The counters of the underlying RTP transport.
+     */
+    SmolRTSP_RtpTransportStats rtp;
+} SmolRTSP_NalTransportStats;
+
 /**
  * Creates a new RTP/NAL transport with the default configuration.
  *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails; @p t is
+ * then left to the caller.
+ *
  * @param[in] t The underlying RTP transport.
  *
  * @pre `t != NULL`
@@ -73,6 +237,9 @@ SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport *t) SMOLRTSP_PRIV_MUST_USE;
 /**
  * Creates a new RTP/NAL transport with a custom configuration.
  *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails; @p t is
+ * then left to the caller.
+ *
  * @param[in] t The underlying RTP transport.
  * @param[in] config The transmission configuration structure.
  *
@@ -82,6 +249,30 @@ SmolRTSP_NalTransport *SmolRTSP_NalTransport_new_with_config(
     SmolRTSP_RtpTransport *t,
     SmolRTSP_NalTransportConfig config) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Creates a new RTP/NAL transport over an RTP transport over a UDP transport
+ * of @p fd, all three in a single allocation.
+ *
+ * The chain is bound at construction, so that a NAL unit reaches the socket
+ * through direct calls only (see #SmolRTSP_RtpTransport_new_udp). Dropping
+ * the result drops the underlying transports as well.
+ *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails.
+ *
+ * @param[in] fd The UDP socket, left open on drop.
+ * @param[in] udp_config The configuration of the UDP transport.
+ * @param[in] payload_ty The RTP payload type.
+ * @param[in] clock_rate The RTP clock rate of @p payload_ty (HZ).
+ * @param[in] config The transmission configuration structure.
+ *
+ * @pre `fd >= 0`
+ * @pre The `rand` PRNG must be set up via `srand`.
+ */
+SmolRTSP_NalTransport *SmolRTSP_NalTransport_new_udp(
+    int fd, SmolRTSP_UdpTransportConfig udp_config, uint8_t payload_ty,
+    uint32_t clock_rate,
+    SmolRTSP_NalTransportConfig config) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Sends an RTP/NAL packet.
  *
@@ -90,25 +281,135 @@ SmolRTSP_NalTransport *SmolRTSP_NalTransport_new_with_config(
  * @p nalu will be
  * [fragmented](https://datatracker.ietf.org/doc/html/rfc6184#section-5.8).
  *
+ * If the underlying transport rejects a packet with `EMSGSIZE` and reports a
+ * lower `max_packet_size` afterwards, @p nalu is sent once again in smaller
+ * packets.
+ *
+ * If the underlying transport is full, @p nalu can be dropped according to
+ * #SmolRTSP_NalTransportConfig.backpressure_policy; this is not an error.
+ *
+ * The RTP marker is set on every coded slice, i.e., each slice is assumed to
+ * complete its picture. For multi-slice pictures, use
+ * #SmolRTSP_NalTransport_send_au_packet instead.
+ *
  * @param[out] self The RTP/NAL transport for sending this packet.
  * @param[in] ts The RTP timestamp for this packet.
  * @param[in] nalu The NAL unit of this RTP packet.
  *
  * @pre `self != NULL`
  *
- * @return -1 if an I/O error occurred and sets `errno` appropriately, 0 on
- * success.
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, or if a
+ * new parameter set cannot be cached (see #SmolRTSP_NalTransport_param_sets)
+ * and sets `errno` to `ENOMEM`; 0 on success.
  */
 int SmolRTSP_NalTransport_send_packet(
     SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
     SmolRTSP_NalUnit nalu) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Sends an RTP/NAL packet that belongs to an access unit of several NAL units.
+ *
+ * Behaves as #SmolRTSP_NalTransport_send_packet, except that the RTP marker is
+ * set only on the last packet of @p nalu if @p end_of_access_unit is true.
+ * This way, the slices of a picture can be sent as soon as the encoder
+ * produces them, and the receiver will not consider the picture complete
+ * until the last one.
+ *
+ * With #SmolRTSP_NalTransportConfig.aggregation, held-back NAL units are sent
+ * together with any coded slice or the end of an access unit.
+ *
+ * @param[out] self The RTP/NAL transport for sending this packet.
+ * @param[in] ts The RTP timestamp for this packet, shared by the whole access
+ * unit.
+ * @param[in] nalu The NAL unit of this RTP packet.
+ * @param[in] end_of_access_unit Whether @p nalu is the last NAL unit of its
+ * access unit.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, or if a
+ * new parameter set cannot be cached and sets `errno` to `ENOMEM`; 0 on
+ * success.
+ *
+ * @see <https://datatracker.ietf.org/doc/html/rfc6184#section-5.1>
+ */
+int SmolRTSP_NalTransport_send_au_packet(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, bool end_of_access_unit) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends a whole access unit of @p n NAL units at once.
+ *
+ * Behaves as #SmolRTSP_NalTransport_send_au_packet for each of @p nalus, the
+ * last one ending the access unit, but packetizes them all in one pass into
+ * packet arrays of @p self that are reused for the next access units, and
+ * hands the packets to the underlying transport as a single batch. With
+ * #SmolRTSP_NalTransportConfig.aggregation, the NAL units preceding a coded
+ * slice are aggregated with it, and a batch is submitted before each
+ * aggregation packet but the first.
+ *
+ * Any NAL units held back by #SmolRTSP_NalTransport_send_au_packet are sent
+ * first.
+ *
+ * @param[out] self The RTP/NAL transport for sending this access unit.
+ * @param[in] ts The RTP timestamp of the access unit.
+ * @param[in] nalus The NAL units of the access unit, in decoding order.
+ * @param[in] n The number of NAL units in @p nalus.
+ *
+ * @pre `self != NULL`
+ * @pre `nalus != NULL || n == 0`
+ *
+ * @return -1 if an I/O error occurred, or the packet arrays cannot grow or a
+ * new parameter set cannot be cached (and sets `errno` appropriately), 0 on
+ * success.
+ */
+int SmolRTSP_NalTransport_send_access_unit(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t n) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends the NAL units held back by #SmolRTSP_NalTransportConfig.aggregation.
+ *
+ * Does nothing if there are no such NAL units.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, 0 on
+ * success.
+ */
+int SmolRTSP_NalTransport_flush(SmolRTSP_NalTransport *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_NalTransport.
  *
+ * NAL units that are held back for aggregation are discarded; call
+ * #SmolRTSP_NalTransport_flush beforehand to send them.
+ *
  * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
  * usage.
  */
 declImplExtern99(SmolRTSP_Droppable, SmolRTSP_NalTransport);
 
 bool SmolRTSP_NalTransport_is_full(SmolRTSP_NalTransport *self);
+
+/**
+ * Returns a snapshot of the counters of @p self.
+ *
+ * It can be called from any thread.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_NalTransportStats SmolRTSP_NalTransport_stats(
+    const SmolRTSP_NalTransport *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the cache of the latest parameter sets sent through @p self.
+ *
+ * Every NAL unit passed to #SmolRTSP_NalTransport_send_packet updates the
+ * cache, even if it is dropped afterwards.
+ *
+ * @pre `self != NULL`
+ */
+const SmolRTSP_ParamSetCache *SmolRTSP_NalTransport_param_sets(
+    const SmolRTSP_NalTransport *self) SMOLRTSP_PRIV_MUST_USE;
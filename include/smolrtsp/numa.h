@@ -0,0 +1,39 @@
+/**
+ * @file
+ * @brief The CPU and NUMA topology used for placing threads and memory.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * Returns the NUMA node of the CPU @p cpu, or -1 if it is unknown (e.g., the
+ * kernel is built without NUMA or `/sys` is not mounted).
+ */
+int smolrtsp_cpu_numa_node(int cpu) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NUMA node that the network device @p ifname is attached to, or
+ * -1 if it is unknown or the device is virtual (e.g., `lo`).
+ *
+ * The worker threads and the packet buffers of the streams leaving through
+ * @p ifname are best placed on this node (see
+ * #SmolRTSP_SendWorkers_attach_on_node and
+ * #SmolRTSP_PacketPoolConfig.numa_node).
+ *
+ * @pre `ifname != NULL`
+ */
+int smolrtsp_interface_numa_node(const char *ifname) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the CPU number @p i modulo their count among the CPUs that the
+ * calling thread may run on, in ascending order, or -1 on error (and sets
+ * `errno` appropriately).
+ *
+ * The worker pools pin their worker @p i to this CPU, so that the workers
+ * spread over the CPUs given to the process (e.g., by `taskset`).
+ */
+int smolrtsp_allowed_cpu(size_t i) SMOLRTSP_PRIV_MUST_USE;
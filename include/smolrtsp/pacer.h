@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @brief A token-bucket packet pacer.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/latency_histogram.h>
+#include <smolrtsp/transport.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The default value for #SmolRTSP_PacerConfig.rate (10 Mbit/s).
+ */
+#define SMOLRTSP_PACER_DEFAULT_RATE 1250000
+
+/**
+ * The default value for #SmolRTSP_PacerConfig.burst.
+ */
+#define SMOLRTSP_PACER_DEFAULT_BURST 8192
+
+/**
+ * The default value for #SmolRTSP_PacerConfig.max_queue_size.
+ */
+#define SMOLRTSP_PACER_DEFAULT_MAX_QUEUE_SIZE (1024 * 1024)
+
+/**
+ * The value of #SmolRTSP_Pacer_next_deadline when nothing is queued.
+ */
+#define SMOLRTSP_PACER_IDLE UINT64_MAX
+
+/**
+ * The configuration structure for #SmolRTSP_Pacer.
+ */
+typedef struct {
+    /**
+     * The target rate in bytes per second. To spread a burst of `N` bytes over
+     * an interval of `T` seconds, use `N / T`.
+     */
+    uint64_t rate;
+
+    /**
+     * The size of the token bucket in bytes, that is, how many bytes can be
+     * sent back-to-back at line rate after an idle period.
+     */
+    size_t burst;
+
+    /**
+     * The maximum number of bytes held in the queue of delayed packets.
+     */
+    size_t max_queue_size;
+
+    /**
+     * If not `NULL`, the time every packet spends in the queue until it is
+     * handed to the underlying transport is recorded there (0 for the packets
+     * transmitted immediately).
+     */
+    SmolRTSP_LatencyHistogram *latency;
+
+    /**
+     * The clock in microseconds; if `NULL`, `CLOCK_MONOTONIC` is used.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_PacerConfig;
+
+/**
+ * Returns the default #SmolRTSP_PacerConfig.
+ *
+ * The default values are:
+ *
+ *  - `rate` is #SMOLRTSP_PACER_DEFAULT_RATE.
+ *  - `burst` is #SMOLRTSP_PACER_DEFAULT_BURST.
+ *  - `max_queue_size` is #SMOLRTSP_PACER_DEFAULT_MAX_QUEUE_SIZE.
+ *  - `latency` is `NULL`.
+ *  - `clock_us` is `NULL`.
+ */
+SmolRTSP_PacerConfig
+SmolRTSP_PacerConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A transport that shapes the packets of an underlying transport to a target
+ * rate.
+ *
+ * Packets that fit into the token bucket are transmitted immediately; the
+ * others are copied into a queue and transmitted later by
+ * #SmolRTSP_Pacer_poll. The pacer has no timer of its own: an event loop
+ * should call #SmolRTSP_Pacer_poll no later than #SmolRTSP_Pacer_next_deadline.
+ *
+ * The pacer is reported as full when the underlying transport is full or more
+ * than a half of the queue is occupied.
+ */
+typedef struct SmolRTSP_Pacer SmolRTSP_Pacer;
+
+/**
+ * Creates a new pacer on top of @p t.
+ *
+ * The pacer takes ownership of @p t: it is dropped together with the pacer.
+ *
+ * @param[in] t The underlying transport.
+ * @param[in] config The pacing configuration.
+ *
+ * @pre `t.self && t.vptr`
+ * @pre `config.rate > 0`
+ *
+ * @return The pacer, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`); @p t is left to the caller then.
+ */
+SmolRTSP_Pacer *SmolRTSP_Pacer_new(
+    SmolRTSP_Transport t, SmolRTSP_PacerConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Changes the target rate of @p self (bytes per second).
+ *
+ * @pre `self != NULL`
+ * @pre `rate > 0`
+ */
+void SmolRTSP_Pacer_set_rate(SmolRTSP_Pacer *self, uint64_t rate);
+
+/**
+ * Transmits the queued packets that are due.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately (the
+ * failed packet stays queued), 0 on success.
+ */
+int SmolRTSP_Pacer_poll(SmolRTSP_Pacer *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the time (as measured by #SmolRTSP_PacerConfig.clock_us) at which
+ * the next queued packet is due, or #SMOLRTSP_PACER_IDLE if the queue is
+ * empty.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_Pacer_next_deadline(const SmolRTSP_Pacer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of bytes currently queued in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Pacer_queued_bytes(const SmolRTSP_Pacer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Transport_IFACE for #SmolRTSP_Pacer.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Transport, SmolRTSP_Pacer);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Pacer.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Pacer);
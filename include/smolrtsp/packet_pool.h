@@ -0,0 +1,244 @@
+/**
+ * @file
+ * @brief A pool of reference-counted packet buffers.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The alignment of the data of #SmolRTSP_PacketBuf.
+ */
+#define SMOLRTSP_PACKET_POOL_ALIGNMENT 64
+
+/**
+ * The statistics of a packet pool.
+ */
+typedef struct {
+    /**
+     * The number of buffers handed out by #SmolRTSP_PacketPool_acquire.
+     */
+    uint64_t acquired;
+
+    /**
+     * The number of #SmolRTSP_PacketPool_acquire calls that failed because all
+     * the buffers were in use.
+     */
+    uint64_t exhausted;
+
+    /**
+     * The largest number of buffers in use at once.
+     */
+    size_t peak_in_use;
+} SmolRTSP_PacketPoolStats;
+
+/**
+ * A slab of fixed-size packet buffers allocated once.
+ *
+ * The data of every buffer is aligned to #SMOLRTSP_PACKET_POOL_ALIGNMENT
+ * bytes (a cache line) and occupies a whole number of cache lines, so that no
+ * two buffers share one. Acquiring and releasing a buffer costs O(1) and never
+ * allocates. Buffers are reference-counted, so that a packet can be passed to
+ * several stages (e.g., sent to the subscribers of a fan-out and kept for
+ * retransmission) without being copied; it returns to the pool once the last
+ * reference is released.
+ *
+ * A pool and its buffers must be used from a single thread; create a pool per
+ * thread instead of sharing one.
+ */
+typedef struct SmolRTSP_PacketPool SmolRTSP_PacketPool;
+
+/**
+ * A buffer of #SmolRTSP_PacketPool.
+ */
+typedef struct SmolRTSP_PacketBuf SmolRTSP_PacketBuf;
+
+/**
+ * The configuration of #SmolRTSP_PacketPool.
+ */
+typedef struct {
+    /**
+     * The capacity of a buffer, rounded up to a multiple of
+     * #SMOLRTSP_PACKET_POOL_ALIGNMENT.
+     */
+    size_t buffer_size;
+
+    /**
+     * The number of buffers.
+     */
+    size_t buffers_count;
+
+    /**
+     * Whether to back the buffers by huge pages, which saves TLB misses when
+     * packets are scattered over a large pool.
+     *
+     * The pool is mapped with `MAP_HUGETLB` if the system has huge pages
+     * reserved, and with transparent huge pages (`MADV_HUGEPAGE`) otherwise.
+     * Otherwise, the buffers are allocated through #SmolRTSP_Allocator.
+     */
+    bool hugepages;
+
+    /**
+     * The NUMA node to place the buffers on, such as the node of the network
+     * device they are sent from (see #smolrtsp_interface_numa_node), or -1 to
+     * leave them to the first thread touching them.
+     *
+     * The pool is then mapped and its pages preferably allocated on the node;
+     * if the kernel refuses the policy (e.g., without NUMA support), the pool
+     * is created unbound, as reported by #SmolRTSP_PacketPool_numa_node.
+     */
+    int numa_node;
+} SmolRTSP_PacketPoolConfig;
+
+/**
+ * Returns the default configuration: 4096 buffers of 2048 bytes, without
+ * huge pages or a NUMA node.
+ */
+SmolRTSP_PacketPoolConfig
+SmolRTSP_PacketPoolConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a pool with @p config.
+ *
+ * @pre `config.buffer_size > 0`
+ * @pre `config.buffers_count > 0`
+ *
+ * @return The pool, or `NULL` on error (and sets `errno` appropriately).
+ */
+SmolRTSP_PacketPool *SmolRTSP_PacketPool_new(SmolRTSP_PacketPoolConfig config)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Takes a free buffer of @p self with a single reference and a length of 0.
+ *
+ * @pre `self != NULL`
+ *
+ * @return The buffer, or `NULL` if all of them are in use (and sets `errno`
+ * to `ENOBUFS`).
+ */
+SmolRTSP_PacketBuf *
+SmolRTSP_PacketPool_acquire(SmolRTSP_PacketPool *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the capacity of a buffer of @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_PacketPool_buffer_size(const SmolRTSP_PacketPool *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of free buffers of @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_PacketPool_available(const SmolRTSP_PacketPool *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns whether the buffers of @p self are backed by huge pages, explicit
+ * or transparent.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_PacketPool_is_hugepage_backed(const SmolRTSP_PacketPool *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NUMA node that the buffers of @p self are bound to, or -1 if
+ * they are not.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_PacketPool_numa_node(const SmolRTSP_PacketPool *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_PacketPoolStats SmolRTSP_PacketPool_stats(
+    const SmolRTSP_PacketPool *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_PacketPool.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ *
+ * @pre All the buffers have been released.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_PacketPool);
+
+/**
+ * Returns the data of @p self, of #SmolRTSP_PacketPool_buffer_size bytes.
+ *
+ * @pre `self != NULL`
+ */
+uint8_t *
+SmolRTSP_PacketBuf_data(SmolRTSP_PacketBuf *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the bytes of @p self up to its length.
+ *
+ * @pre `self != NULL`
+ */
+U8Slice99
+SmolRTSP_PacketBuf_bytes(const SmolRTSP_PacketBuf *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sets the length of @p self, i.e., the number of its bytes holding the
+ * packet.
+ *
+ * @pre `self != NULL`
+ * @pre @p len does not exceed the capacity of @p self.
+ */
+void SmolRTSP_PacketBuf_set_len(SmolRTSP_PacketBuf *self, size_t len);
+
+/**
+ * Copies @p packet into @p self and sets its length accordingly.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, or -1 if @p packet exceeds the capacity of @p self
+ * (and sets `errno` to `EMSGSIZE`).
+ */
+int SmolRTSP_PacketBuf_write(
+    SmolRTSP_PacketBuf *self, U8Slice99 packet) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds a reference to @p self.
+ *
+ * @pre `self != NULL`
+ * @pre @p self has not been returned to its pool.
+ *
+ * @return @p self.
+ */
+SmolRTSP_PacketBuf *SmolRTSP_PacketBuf_retain(SmolRTSP_PacketBuf *self);
+
+/**
+ * Releases a reference to @p self, returning it to its pool if it was the last
+ * one.
+ *
+ * @pre `self != NULL`
+ * @pre @p self has not been returned to its pool.
+ */
+void SmolRTSP_PacketBuf_release(SmolRTSP_PacketBuf *self);
+
+/**
+ * Returns the number of references to @p self.
+ *
+ * @pre `self != NULL`
+ */
+uint32_t SmolRTSP_PacketBuf_refcount(const SmolRTSP_PacketBuf *self)
+    SMOLRTSP_PRIV_MUST_USE;
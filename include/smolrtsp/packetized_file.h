@@ -0,0 +1,230 @@
+/**
+ * @file
+ * @brief A pre-packetized video file for video on demand.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/media_file.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The version of the format written by #SmolRTSP_PacketizedFile_write.
+ */
+#define SMOLRTSP_PACKETIZED_FILE_VERSION 1
+
+/**
+ * The default value for #SmolRTSP_PacketizedFileConfig.max_packet_size.
+ */
+#define SMOLRTSP_PACKETIZED_FILE_DEFAULT_MAX_PACKET_SIZE 1200
+
+/**
+ * The configuration of #SmolRTSP_PacketizedFile_write.
+ */
+typedef struct {
+    /**
+     * The maximum size of an RTP payload, including the payload header; the
+     * larger NAL units are fragmented.
+     */
+    size_t max_packet_size;
+
+    /**
+     * The RTP clock rate (HZ).
+     */
+    uint32_t clock_rate;
+
+    /**
+     * The frame rate as a fraction, since raw elementary streams carry no
+     * timestamps (see #SmolRTSP_MediaFile_seek).
+     */
+    uint32_t frame_rate_num, frame_rate_den;
+} SmolRTSP_PacketizedFileConfig;
+
+/**
+ * Returns the default #SmolRTSP_PacketizedFileConfig.
+ *
+ * The default values are:
+ *
+ *  - `max_packet_size` is #SMOLRTSP_PACKETIZED_FILE_DEFAULT_MAX_PACKET_SIZE.
+ *  - `clock_rate` is 90000.
+ *  - `frame_rate_num` is 25 and `frame_rate_den` is 1.
+ */
+SmolRTSP_PacketizedFileConfig
+SmolRTSP_PacketizedFileConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Packetizes the video of @p file into the pre-packetized file @p path.
+ *
+ * The file is written aside and renamed, so that a server serving @p path
+ * meanwhile never sees a partial file.
+ *
+ * @return 0 on success, or -1 on an I/O error (and sets `errno`
+ * appropriately).
+ *
+ * @pre `path != NULL`
+ * @pre `file != NULL`
+ * @pre `config.max_packet_size` fits an FU header and at most 65535 bytes.
+ * @pre `config.frame_rate_num > 0 && config.frame_rate_den > 0`
+ */
+int SmolRTSP_PacketizedFile_write(
+    const char *path, const SmolRTSP_MediaFile *file,
+    SmolRTSP_PacketizedFileConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * An RTP packet of #SmolRTSP_PacketizedFile.
+ */
+typedef struct {
+    /**
+     * The RTP payload, starting with the NAL header or the FU headers.
+     */
+    U8Slice99 payload;
+
+    /**
+     * The RTP timestamp relative to the first packet of the file.
+     */
+    uint32_t timestamp;
+
+    /**
+     * The RTP marker flag, i.e., whether this packet ends an access unit.
+     */
+    bool marker;
+
+    /**
+     * Whether this packet begins an IDR access unit, i.e., playback can start
+     * from it.
+     */
+    bool is_idr;
+} SmolRTSP_PacketizedPacket;
+
+/**
+ * A video file packetized ahead of time by #SmolRTSP_PacketizedFile_write and
+ * mapped into memory.
+ *
+ * The file stores the RTP payloads with their FU headers already laid out,
+ * a table of the packets with their timestamps and markers, a table of the IDR
+ * access units, and the SDP parameters of the stream. Serving a client thus
+ * only patches the RTP headers and hands the next packets to the transport in
+ * batches (see #SmolRTSP_PacketizedFile_send), instead of scanning and
+ * packetizing the video on every play.
+ *
+ * The payloads are handed to the transport in place, as pointers into the
+ * mapping: they are never read into user space, and the only copy of a
+ * payload byte is the one made by the kernel into the socket, for TCP
+ * interleaving as for UDP.
+ *
+ * The file carries the version of its format and is written in the native
+ * byte order, which are both checked on open. A file is immutable once opened
+ * and can be read from any number of threads.
+ */
+typedef struct SmolRTSP_PacketizedFile SmolRTSP_PacketizedFile;
+
+/**
+ * Opens the pre-packetized file @p path.
+ *
+ * @return The file, or `NULL` if it cannot be opened or mapped (and sets
+ * `errno` accordingly), or if it is malformed, of another version, or of
+ * another byte order (and sets `errno` to `EBADMSG`).
+ *
+ * @pre `path != NULL`
+ */
+SmolRTSP_PacketizedFile *
+SmolRTSP_PacketizedFile_open(const char *path) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the codec of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_NalCodec SmolRTSP_PacketizedFile_codec(
+    const SmolRTSP_PacketizedFile *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the RTP clock rate of @p self (HZ).
+ *
+ * @pre `self != NULL`
+ */
+uint32_t SmolRTSP_PacketizedFile_clock_rate(
+    const SmolRTSP_PacketizedFile *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the parameter sets of @p self as SDP `fmtp` parameters (see
+ * #SmolRTSP_ParamSetCache_sprop), or `NULL` if the video lacks some of them.
+ *
+ * @pre `self != NULL`
+ */
+const char *SmolRTSP_PacketizedFile_sprop(const SmolRTSP_PacketizedFile *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of packets in @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_PacketizedFile_packets_count(
+    const SmolRTSP_PacketizedFile *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the packet number @p i of @p self.
+ *
+ * The payload points into the mapping and stays valid until @p self is
+ * dropped.
+ *
+ * @pre `self != NULL`
+ * @pre `i < SmolRTSP_PacketizedFile_packets_count(self)`
+ */
+SmolRTSP_PacketizedPacket SmolRTSP_PacketizedFile_packet(
+    const SmolRTSP_PacketizedFile *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Finds the packet from which to play the normal play time @p npt_ms, i.e.,
+ * the first packet of the last IDR access unit at or before it.
+ *
+ * @return The index of the packet, or -1 if there is no IDR access unit at or
+ * before @p npt_ms.
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_PacketizedFile_seek(
+    const SmolRTSP_PacketizedFile *self,
+    uint64_t npt_ms) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends @p count packets of @p self starting from the packet number @p first
+ * via @p t, offsetting their timestamps by @p ts_offset.
+ *
+ * The packets of the same timestamp are sent by a single
+ * #SmolRTSP_RtpTransport_send_batch.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ * @pre `first + count <= SmolRTSP_PacketizedFile_packets_count(self)`
+ * @pre The clock rate of @p t is #SmolRTSP_PacketizedFile_clock_rate.
+ *
+ * @return 0 on success, or -1 if an I/O error occurred (and sets `errno`
+ * appropriately), in which case only some of the packets may have been sent.
+ */
+int SmolRTSP_PacketizedFile_send(
+    const SmolRTSP_PacketizedFile *self, SmolRTSP_RtpTransport *t, size_t first,
+    size_t count, uint32_t ts_offset) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_PacketizedFile.
+ *
+ * Unmaps the file; the packets obtained from it become invalid.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_PacketizedFile);
@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @brief A cache of the latest parameter sets (VPS, SPS, PPS) of a stream.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The latest parameter sets of a stream, together with their SDP
+ * representation.
+ *
+ * Late joiners can be primed with the cached parameter sets before the next
+ * IDR, and DESCRIBE can be answered without inspecting the stream.
+ */
+typedef struct SmolRTSP_ParamSetCache SmolRTSP_ParamSetCache;
+
+/**
+ * Creates an empty cache.
+ *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails.
+ */
+SmolRTSP_ParamSetCache *SmolRTSP_ParamSetCache_new(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Remembers @p nalu if it is a parameter set.
+ *
+ * The SDP representation is re-encoded only if the bytes of the parameter set
+ * differ from the cached ones.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 1 if the cache has changed, 0 if it has not, or -1 if an allocation
+ * fails (and sets `errno` to `ENOMEM`), in which case the cache is left as it
+ * was.
+ */
+int SmolRTSP_ParamSetCache_update(
+    SmolRTSP_ParamSetCache *self, SmolRTSP_NalUnit nalu);
+
+/**
+ * Returns the cached VPS (H.265 only), including the NAL header, or an empty
+ * slice if there is none.
+ *
+ * The slice is valid until the next update.
+ *
+ * @pre `self != NULL`
+ */
+U8Slice99 SmolRTSP_ParamSetCache_vps(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the cached SPS in the same way as #SmolRTSP_ParamSetCache_vps.
+ *
+ * @pre `self != NULL`
+ */
+U8Slice99 SmolRTSP_ParamSetCache_sps(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the cached PPS in the same way as #SmolRTSP_ParamSetCache_vps.
+ *
+ * @pre `self != NULL`
+ */
+U8Slice99 SmolRTSP_ParamSetCache_pps(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Checks whether all the parameter sets needed for decoding are cached (SPS
+ * and PPS, plus VPS for H.265).
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_ParamSetCache_is_complete(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of times the cache has changed, e.g., to bump the SDP
+ * session version.
+ *
+ * @pre `self != NULL`
+ */
+uint32_t SmolRTSP_ParamSetCache_version(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the base64-encoded parameter sets as SDP `fmtp` parameters:
+ * `sprop-parameter-sets=<SPS>,<PPS>` for H.264 or
+ * `sprop-vps=<VPS>;sprop-sps=<SPS>;sprop-pps=<PPS>` for H.265.
+ *
+ * The string is valid until the next update. If the cache is not complete,
+ * returns `NULL`.
+ *
+ * @pre `self != NULL`
+ *
+ * @see H.264 media type parameters:
+ * <https://datatracker.ietf.org/doc/html/rfc6184#section-8.1>
+ * @see H.265 media type parameters:
+ * <https://datatracker.ietf.org/doc/html/rfc7798#section-7.1>
+ */
+const char *SmolRTSP_ParamSetCache_sprop(const SmolRTSP_ParamSetCache *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_ParamSetCache.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_ParamSetCache);
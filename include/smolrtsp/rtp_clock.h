@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Conversion of wallclock time to RTP and NTP timestamps.
+ *
+ * @see RTP: A Transport Protocol for Real-Time Applications:
+ * <https://datatracker.ietf.org/doc/html/rfc3550#section-6.4.1>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The number of seconds between the NTP epoch (1900) and the Unix epoch
+ * (1970).
+ */
+#define SMOLRTSP_NTP_UNIX_EPOCH_DIFF UINT64_C(2208988800)
+
+/**
+ * The clock of an RTP stream.
+ *
+ * The clock maps microseconds of some system clock to RTP timestamps and to
+ * NTP timestamps, as needed by RTCP sender reports. All conversions use integer
+ * arithmetic only and are exact for any clock rate (such as 44100 or 22050),
+ * that is, the resulting RTP timestamp is
+ * `rtp_epoch + floor((time_us - epoch_us) * clock_rate / 1000000)`.
+ */
+typedef struct {
+    /**
+     * The RTP clock rate (HZ).
+     */
+    uint32_t clock_rate;
+
+    /**
+     * The system clock time (microseconds) that corresponds to `rtp_epoch`.
+     */
+    uint64_t epoch_us;
+
+    /**
+     * The RTP timestamp at `epoch_us`.
+     */
+    uint32_t rtp_epoch;
+
+    /**
+     * The Unix wallclock time (microseconds) at `epoch_us`.
+     */
+    uint64_t wallclock_epoch_us;
+} SmolRTSP_RtpClock;
+
+/**
+ * Creates a clock whose epochs are all zero.
+ *
+ * With this clock, a time of `T` microseconds is converted to the RTP
+ * timestamp `floor(T * clock_rate / 1000000)`, and `T` is assumed to be Unix
+ * time for NTP conversion.
+ */
+SmolRTSP_RtpClock
+SmolRTSP_RtpClock_new(uint32_t clock_rate) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a clock with custom epochs.
+ *
+ * @param[in] clock_rate The RTP clock rate (HZ).
+ * @param[in] epoch_us The system clock time (e.g., of `CLOCK_MONOTONIC`)
+ * corresponding to @p rtp_epoch and @p wallclock_epoch_us.
+ * @param[in] rtp_epoch The (typically random) initial RTP timestamp.
+ * @param[in] wallclock_epoch_us The Unix time at @p epoch_us (e.g., of
+ * `CLOCK_REALTIME`).
+ */
+SmolRTSP_RtpClock SmolRTSP_RtpClock_with_epoch(
+    uint32_t clock_rate, uint64_t epoch_us, uint32_t rtp_epoch,
+    uint64_t wallclock_epoch_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Computes the RTP timestamp of the system clock time @p time_us.
+ *
+ * @pre `self != NULL`
+ */
+uint32_t SmolRTSP_RtpClock_timestamp(
+    const SmolRTSP_RtpClock *self, uint64_t time_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Computes the 64-bit NTP timestamp of the system clock time @p time_us.
+ *
+ * Together with #SmolRTSP_RtpClock_timestamp, it gives the NTP/RTP timestamp
+ * pair of an RTCP sender report.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_RtpClock_ntp_timestamp(
+    const SmolRTSP_RtpClock *self, uint64_t time_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Converts the Unix time @p unix_us (microseconds) to a 64-bit NTP timestamp
+ * (32.32 fixed point seconds since 1900).
+ */
+uint64_t smolrtsp_ntp_timestamp(uint64_t unix_us) SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,150 @@
+/**
+ * @file
+ * @brief A depacketizer of H.264 and H.265 RTP streams into NAL units.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/types/rtp.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The statistics of an RTP depacketizer.
+ */
+typedef struct {
+    /**
+     * The number of NAL units emitted.
+     */
+    uint64_t nalus;
+
+    /**
+     * The number of NAL units that have been reassembled from fragmentation
+     * units (also counted in `nalus`).
+     */
+    uint64_t reassembled_nalus;
+
+    /**
+     * The number of packets missing from the sequence numbers of the stream.
+     */
+    uint64_t lost_packets;
+
+    /**
+     * The number of packets whose payload was malformed, of an unsupported
+     * type (STAP-B, MTAP, FU-B, or PACI), or a fragment of a NAL unit that
+     * could not be reassembled, because of a loss or because it exceeds the
+     * maximum NAL unit size.
+     */
+    uint64_t discarded_packets;
+} SmolRTSP_RtpDepacketizerStats;
+
+/**
+ * A depacketizer of the RTP packets of one H.264 (RFC 6184) or H.265
+ * (RFC 7798) stream, which are fed one by one in the order of their sequence
+ * numbers.
+ *
+ * Single NAL unit packets and the NAL units of aggregation packets (STAP-A and
+ * AP) are emitted without copying. Only a fragmented NAL unit (FU-A and FU) is
+ * reassembled in the buffer of the depacketizer, which is allocated once with
+ * the maximum NAL unit size.
+ *
+ * A fragmented NAL unit is discarded if any of its fragments is lost, as told
+ * by a gap in the sequence numbers. A packet behind the expected sequence
+ * number is discarded as late, but the 8th one in a row, like a packet of
+ * another SSRC, is taken for a restart of the stream, and the sequence numbers
+ * are resynchronized at it. The decoding order number of the interleaved mode
+ * (and of H.265 with `sprop-max-don-diff > 0`) is not supported.
+ *
+ * Typical usage:
+ *
+ * @code
+ * SmolRTSP_RtpHeader header;
+ * if (SmolRTSP_RtpDepacketizer_feed(depacketizer, packet, &header) == -1) {
+ *     // Not an RTP packet.
+ * }
+ * SmolRTSP_NalUnit nalu;
+ * while (SmolRTSP_RtpDepacketizer_next(depacketizer, &nalu)) {
+ *     // Process `nalu` of `header.timestamp`.
+ * }
+ * @endcode
+ */
+typedef struct SmolRTSP_RtpDepacketizer SmolRTSP_RtpDepacketizer;
+
+/**
+ * Creates a new depacketizer of a @p codec stream.
+ *
+ * @param[in] codec The codec of the stream.
+ * @param[in] max_nalu_size The maximum size of a fragmented NAL unit,
+ * including its header.
+ *
+ * @pre `max_nalu_size > 0`
+ *
+ * @return The depacketizer, or `NULL` if there is not enough memory (and sets
+ * `errno` to `ENOMEM`) or @p codec is H.265 in a build without it (and sets
+ * `errno` to `EINVAL`; see the `SMOLRTSP_H265` CMake option).
+ */
+SmolRTSP_RtpDepacketizer *SmolRTSP_RtpDepacketizer_new(
+    SmolRTSP_NalCodec codec, size_t max_nalu_size) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Supplies the next RTP packet of the stream.
+ *
+ * @p packet must stay valid until the next call to
+ * #SmolRTSP_RtpDepacketizer_feed, since the emitted NAL units may point into
+ * it.
+ *
+ * @param[in] self The depacketizer.
+ * @param[in] packet The RTP packet.
+ * @param[out] header The header of @p packet (see #SmolRTSP_RtpHeader_parse).
+ *
+ * @pre `self != NULL`
+ * @pre `header != NULL`
+ *
+ * @return -1 if @p packet is not a valid RTP packet (and sets `errno` to
+ * `EBADMSG`), 0 on success.
+ */
+int SmolRTSP_RtpDepacketizer_feed(
+    SmolRTSP_RtpDepacketizer *self, U8Slice99 packet,
+    SmolRTSP_RtpHeader *restrict header) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Extracts the next complete NAL unit of the last packet.
+ *
+ * The data of @p nalu points either into the last packet or into the buffer
+ * of @p self, and is valid until the next call to
+ * #SmolRTSP_RtpDepacketizer_feed.
+ *
+ * @pre `self != NULL`
+ * @pre `nalu != NULL`
+ *
+ * @return `true` if a NAL unit has been written to @p nalu, `false` if the
+ * packet has been exhausted.
+ */
+bool SmolRTSP_RtpDepacketizer_next(
+    SmolRTSP_RtpDepacketizer *self, SmolRTSP_NalUnit *restrict nalu)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_RtpDepacketizerStats
+SmolRTSP_RtpDepacketizer_stats(const SmolRTSP_RtpDepacketizer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_RtpDepacketizer.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_RtpDepacketizer);
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Packetize-once delivery of NAL units to many RTP subscribers.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A fan-out of NAL units to several RTP transports.
+ *
+ * A NAL unit is packetized (split into single NAL unit or FU packets) only
+ * once, and the resulting packet list is then sent to every subscriber. Each
+ * subscriber keeps its own SSRC and sequence number (as maintained by its
+ * #SmolRTSP_RtpTransport) and can have its own RTP timestamp offset.
+ *
+ * A received RTP stream (e.g., of an `ANNOUNCE`/`RECORD` session or a pulled
+ * RTSP stream) can be relayed with #SmolRTSP_RtpFanout_relay_packet instead,
+ * without depacketizing it for the subscribers that can take its packets.
+ */
+typedef struct SmolRTSP_RtpFanout SmolRTSP_RtpFanout;
+
+/**
+ * Creates a new fan-out.
+ *
+ * @param[in] clock_rate The RTP clock rate of the stream (HZ).
+ * @param[in] config The packetization configuration (only the maximum NAL unit
+ * sizes are used).
+ *
+ * @return The fan-out, or `NULL` if the allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_RtpFanout *SmolRTSP_RtpFanout_new(
+    uint32_t clock_rate,
+    SmolRTSP_NalTransportConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds the subscriber @p t to @p self.
+ *
+ * The fan-out does not take ownership of @p t; remove it via
+ * #SmolRTSP_RtpFanout_unsubscribe before dropping it.
+ *
+ * @param[out] self The fan-out to subscribe to.
+ * @param[in] t The RTP transport of the subscriber.
+ * @param[in] ts_offset The value added to the RTP timestamp of every packet
+ * sent to @p t.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ *
+ * @return 0 on success, or -1 if the subscribers cannot grow (and sets `errno`
+ * to `ENOMEM`).
+ */
+int SmolRTSP_RtpFanout_subscribe(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTransport *t,
+    uint32_t ts_offset) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Removes the subscriber @p t from @p self.
+ *
+ * @return `true` if @p t was subscribed, `false` otherwise.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_RtpFanout_unsubscribe(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTransport *t);
+
+/**
+ * Returns the number of subscribers of @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_RtpFanout_subscribers_count(const SmolRTSP_RtpFanout *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Packetizes @p nalu and sends the packets to all the subscribers.
+ *
+ * A failure to send to one subscriber does not prevent sending to the others.
+ *
+ * @param[out] self The fan-out for sending this NAL unit.
+ * @param[in] ts The RTP timestamp for this NAL unit.
+ * @param[in] nalu The NAL unit to send.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if an I/O error occurred for at least one subscriber and sets
+ * `errno` appropriately (as of the last failure) or if the packets cannot be
+ * allocated (and sets `errno` to `ENOMEM`), 0 on success.
+ */
+int SmolRTSP_RtpFanout_send_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Like #SmolRTSP_RtpFanout_send_packet, but sets the RTP marker only if @p
+ * end_of_access_unit is true.
+ *
+ * See #SmolRTSP_NalTransport_send_au_packet.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_RtpFanout_send_au_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts, SmolRTSP_NalUnit nalu,
+    bool end_of_access_unit) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Forwards a received RTP packet of an H.264 or H.265 stream to all the
+ * subscribers.
+ *
+ * The payload of @p packet is sent as it is, with the SSRC, sequence number,
+ * and payload type of each subscriber and the timestamp of @p packet plus the
+ * offset of the subscriber; the marker is kept. Gaps in the sequence numbers
+ * of the relayed stream are reproduced (see
+ * #SmolRTSP_RtpTransport_skip_seq_nums), and reordered or duplicated packets
+ * are dropped, so the stream should be passed through #SmolRTSP_JitterBuffer
+ * first.
+ *
+ * The packets of the stream are assumed to fit into the maximum NAL unit size
+ * of @p codec in the configuration. A subscriber whose maximum payload size
+ * (see #SmolRTSP_RtpTransport_max_payload_size) is lower receives the NAL
+ * units of the stream instead, depacketized and packetized anew to fit it.
+ *
+ * @param[out] self The fan-out for relaying this packet.
+ * @param[in] codec The codec of the relayed stream.
+ * @param[in] packet The RTP packet.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if @p packet is not a valid RTP packet (and sets `errno` to
+ * `EBADMSG`), if there is not enough memory to depacketize it (and sets
+ * `errno` to `ENOMEM`), or if an I/O error occurred for at least one
+ * subscriber (and sets `errno` appropriately, as of the last failure), 0 on
+ * success.
+ */
+int SmolRTSP_RtpFanout_relay_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec,
+    U8Slice99 packet) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_RtpFanout.
+ *
+ * The subscribers are not dropped.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_RtpFanout);
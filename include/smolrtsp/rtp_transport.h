@@ -5,8 +5,11 @@
 
 #pragma once
 
+#include <smolrtsp/bandwidth_estimator.h>
 #include <smolrtsp/droppable.h>
+#include <smolrtsp/rtp_clock.h>
 #include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -43,9 +46,24 @@ datatype99(
 );
 // clang-format on
 
+/**
+ * Computes the value of the RTP timestamp field from @p self.
+ *
+ * `SysClockUs` is converted as if by #SmolRTSP_RtpClock_timestamp with
+ * #SmolRTSP_RtpClock_new.
+ *
+ * @param[in] self The timestamp to convert.
+ * @param[in] clock_rate The RTP clock rate (HZ).
+ */
+uint32_t SmolRTSP_RtpTimestamp_compute(
+    SmolRTSP_RtpTimestamp self, uint32_t clock_rate) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Creates a new RTP transport from the underlying level-4 protocol @p t.
  *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if an allocation fails; @p t is
+ * then left to the caller.
+ *
  * @param[in] t The level-4 protocol (such as TCP or UDP).
  * @param[in] payload_ty The RTP payload type. The list of payload types is
  * available here: <https://en.wikipedia.org/wiki/RTP_payload_formats>.
@@ -58,6 +76,29 @@ SmolRTSP_RtpTransport *SmolRTSP_RtpTransport_new(
     SmolRTSP_Transport t, uint8_t payload_ty,
     uint32_t clock_rate) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Creates a new RTP transport over a UDP transport of @p fd (see
+ * #smolrtsp_transport_udp_with_config), both in a single allocation.
+ *
+ * Unlike #SmolRTSP_RtpTransport_new, the packets are handed to the UDP
+ * transport by direct calls instead of through #SmolRTSP_Transport, and the
+ * two transports share their cache lines. Dropping the result drops the UDP
+ * transport as well.
+ *
+ * Returns `NULL` and sets `errno` to `ENOMEM` if the allocation fails.
+ *
+ * @param[in] fd The UDP socket, left open on drop.
+ * @param[in] udp_config The configuration of the UDP transport.
+ * @param[in] payload_ty The RTP payload type.
+ * @param[in] clock_rate The RTP clock rate of @p payload_ty (HZ).
+ *
+ * @pre `fd >= 0`
+ * @pre The `rand` PRNG must be set up via `srand`.
+ */
+SmolRTSP_RtpTransport *SmolRTSP_RtpTransport_new_udp(
+    int fd, SmolRTSP_UdpTransportConfig udp_config, uint8_t payload_ty,
+    uint32_t clock_rate) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Sends an RTP packet.
  *
@@ -76,6 +117,53 @@ int SmolRTSP_RtpTransport_send_packet(
     SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts, bool marker,
     U8Slice99 payload_header, U8Slice99 payload) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * An RTP packet to be sent by #SmolRTSP_RtpTransport_send_batch.
+ */
+typedef struct {
+    /**
+     * The RTP marker flag.
+     */
+    bool marker;
+
+    /**
+     * The payload header. Can be `U8Slice99_empty()`.
+     */
+    U8Slice99 payload_header;
+
+    /**
+     * The payload data.
+     */
+    U8Slice99 payload;
+} SmolRTSP_RtpPacket;
+
+/**
+ * A slice of elements of type #SmolRTSP_RtpPacket.
+ */
+SLICE99_DEF_TYPED(SmolRTSP_RtpPacketSlice, SmolRTSP_RtpPacket);
+
+/**
+ * Sends a sequence of RTP packets sharing the same timestamp.
+ *
+ * The packets are handed to the underlying transport in batches (see
+ * #smolrtsp_transmit_batch), which makes it considerably cheaper than calling
+ * #SmolRTSP_RtpTransport_send_packet for every packet of a fragmented NAL
+ * unit.
+ *
+ * @param[out] self The RTP transport for sending these packets.
+ * @param[in] ts The RTP timestamp for all the packets.
+ * @param[in] packets The packets to send, in order.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, 0 on
+ * success. The sequence number is advanced only for the packets actually
+ * sent.
+ */
+int SmolRTSP_RtpTransport_send_batch(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_RtpPacketSlice packets) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_RtpTransport.
  *
@@ -85,3 +173,551 @@ int SmolRTSP_RtpTransport_send_packet(
 declImplExtern99(SmolRTSP_Droppable, SmolRTSP_RtpTransport);
 
 bool SmolRTSP_RtpTransport_is_full(SmolRTSP_RtpTransport *self);
+
+/**
+ * The quality of an RTP stream as experienced by its receivers, from the RTCP
+ * reports ingested by #SmolRTSP_RtpTransport_ingest_rtcp.
+ *
+ * The fields from #fraction_lost to #rtt_us are of the latest report block
+ * about the stream, and are all zero before the first one.
+ */
+typedef struct {
+    /**
+     * The number of sender reports sent by
+     * #SmolRTSP_RtpTransport_send_sender_report.
+     */
+    uint64_t sender_reports;
+
+    /**
+     * The number of report blocks received about the stream.
+     */
+    uint64_t reports;
+
+    /**
+     * The number of ingested compound RTCP packets that are malformed.
+     */
+    uint64_t malformed;
+
+    /**
+     * The number of lost packets reported by generic NACKs.
+     */
+    uint64_t nacks;
+
+    /**
+     * The number of PLI and FIR packets asking for a keyframe of the stream.
+     */
+    uint64_t keyframe_requests;
+
+    /**
+     * The fraction of packets lost since the previous report (divided by 256).
+     */
+    uint8_t fraction_lost;
+
+    /**
+     * The total number of packets lost.
+     */
+    int32_t cumulative_lost;
+
+    /**
+     * The extended highest sequence number received.
+     */
+    uint32_t extended_highest_seq_num;
+
+    /**
+     * The interarrival jitter, in RTP timestamp units.
+     */
+    uint32_t jitter;
+
+    /**
+     * The interarrival jitter, in microseconds.
+     */
+    uint64_t jitter_us;
+
+    /**
+     * The round-trip time computed from the LSR and DLSR fields of the report
+     * (with a precision of 1/65536 seconds), or 0 if the receiver has not got
+     * a sender report yet.
+     */
+    uint64_t rtt_us;
+} SmolRTSP_RtcpStats;
+
+/**
+ * The counters of #SmolRTSP_RtpTransport.
+ */
+typedef struct {
+    /**
+     * The number of RTP packets sent.
+     */
+    uint64_t packets;
+
+    /**
+     * The number of payload bytes sent, including the payload headers but not
+     * the RTP headers.
+     */
+    uint64_t payload_bytes;
+
+    /**
+     * The number of failed sends (of a single packet or a batch).
+     */
+    uint64_t errors;
+
+    /**
+     * The number of packets resent by #SmolRTSP_RtpTransport_retransmit.
+     */
+    uint64_t retransmissions;
+
+    /**
+     * The number of requested retransmissions of packets that are no longer
+     * (or have never been) stored.
+     */
+    uint64_t retransmission_misses;
+
+    /**
+     * The counters of the underlying transport.
+     */
+    SmolRTSP_TransportStats transport;
+
+    /**
+     * The RTCP state of the stream.
+     */
+    SmolRTSP_RtcpStats rtcp;
+} SmolRTSP_RtpTransportStats;
+
+/**
+ * Returns a snapshot of the counters of @p self.
+ *
+ * It can be called from any thread.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_RtpTransportStats SmolRTSP_RtpTransport_stats(
+    const SmolRTSP_RtpTransport *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the maximum size of an RTP payload (including the payload header)
+ * that fits into `max_packet_size` of the underlying transport, or 0 if there
+ * is no such limit.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_RtpTransport_max_payload_size(SmolRTSP_RtpTransport *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the clock used to convert `SysClockUs` timestamps of @p self.
+ *
+ * @pre `self != NULL`
+ */
+const SmolRTSP_RtpClock *SmolRTSP_RtpTransport_clock(
+    const SmolRTSP_RtpTransport *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Replaces the clock of @p self, e.g., to start from a random RTP timestamp
+ * and to map the system clock to the wallclock for RTCP.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_RtpTransport_set_clock(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpClock clock);
+
+/**
+ * Advances the sequence number of @p self by @p count without sending, so
+ * that receivers see @p count packets as lost (e.g., when relaying a stream
+ * that has lost them).
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_RtpTransport_skip_seq_nums(
+    SmolRTSP_RtpTransport *self, uint16_t count);
+
+/**
+ * Sends an RTCP sender report of @p self through @p rtcp.
+ *
+ * The NTP/RTP timestamp pair is computed from the clock of @p self (see
+ * #SmolRTSP_RtpTransport_clock); the packet and octet counts are those of
+ * #SmolRTSP_RtpTransport_stats. RFC 3550 expects a sender report about every
+ * five seconds.
+ *
+ * @param[out] self The RTP transport to report on.
+ * @param[in] rtcp The RTCP transport, such as #smolrtsp_transport_udp on the
+ * client's RTCP port or #smolrtsp_transport_tcp on the interleaved RTCP
+ * channel.
+ * @param[in] time_us The current time of the system clock of @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `rtcp.self && rtcp.vptr`
+ *
+ * @return -1 if an I/O error occurred and sets `errno` appropriately, 0 on
+ * success.
+ */
+int SmolRTSP_RtpTransport_send_sender_report(
+    SmolRTSP_RtpTransport *self, SmolRTSP_Transport rtcp,
+    uint64_t time_us) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Ingests a compound RTCP packet received from a client of @p self.
+ *
+ * The report blocks of SR and RR packets that are about the stream of @p self
+ * update #SmolRTSP_RtpTransportStats.rtcp, and the packets requested by its
+ * generic NACKs are resent by #SmolRTSP_RtpTransport_retransmit if the
+ * retransmission buffer is enabled; PLI and FIR packets are counted in
+ * #SmolRTSP_RtcpStats.keyframe_requests (which #SmolRTSP_LiveSubscriber_pump
+ * forwards to its source); transport-wide feedback is passed to the estimator
+ * of #SmolRTSP_RtpTransport_set_bandwidth_estimator, if any; all other packets
+ * are ignored. Since it may send, it must not be called concurrently with the
+ * other sending functions of @p self.
+ * Clients send RTCP to the server's RTCP port or, with TCP, on the odd
+ * interleaved channel, which can be routed here from a #SmolRTSP_FrameHandler
+ * bound to #SmolRTSP_Demuxer.
+ *
+ * @param[out] self The RTP transport the packet is about.
+ * @param[in] packet The compound RTCP packet.
+ * @param[in] time_us The current time of the system clock of @p self, used for
+ * the round-trip time.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, -1 if @p packet is malformed (`errno` is set to
+ * `EBADMSG`); the report blocks before the malformed packet are still
+ * ingested.
+ */
+int SmolRTSP_RtpTransport_ingest_rtcp(
+    SmolRTSP_RtpTransport *self, U8Slice99 packet, uint64_t time_us);
+
+/**
+ * The default value for #SmolRTSP_RtpRetransmissionConfig.max_packets.
+ */
+#define SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_PACKETS 1024
+
+/**
+ * The default value for #SmolRTSP_RtpRetransmissionConfig.max_bytes (1 MiB).
+ */
+#define SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_BYTES (1024 * 1024)
+
+/**
+ * The default value for #SmolRTSP_RtpRetransmissionConfig.max_age_us (one
+ * second).
+ */
+#define SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_AGE_US 1000000
+
+/**
+ * The configuration of the retransmission buffer of #SmolRTSP_RtpTransport.
+ */
+typedef struct {
+    /**
+     * The maximum number of stored packets, rounded up to a power of two (at
+     * most 32768).
+     */
+    size_t max_packets;
+
+    /**
+     * The maximum number of stored bytes (including the RTP headers), which is
+     * allocated upfront.
+     */
+    size_t max_bytes;
+
+    /**
+     * The age after which a packet is not worth resending anymore.
+     */
+    uint64_t max_age_us;
+
+    /**
+     * Whether to resend the packets in an RFC 4588 retransmission stream
+     * instead of as is.
+     *
+     * The RTX stream must be announced in SDP, e.g., `a=rtpmap:97 rtx/90000`
+     * and `a=fmtp:97 apt=96`.
+     */
+    bool rtx;
+
+    /**
+     * The payload type of the RTX stream, if #rtx.
+     */
+    uint8_t rtx_payload_ty;
+
+    /**
+     * The SSRC of the RTX stream (in host byte order), if #rtx, or 0 for a
+     * random one.
+     */
+    uint32_t rtx_ssrc;
+
+    /**
+     * The clock beneath #max_age_us, or `NULL` for `CLOCK_MONOTONIC`.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_RtpRetransmissionConfig;
+
+/**
+ * Returns the default configuration:
+ * #SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_PACKETS packets,
+ * #SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_BYTES bytes, and
+ * #SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_AGE_US, resending the packets as is.
+ */
+SmolRTSP_RtpRetransmissionConfig
+SmolRTSP_RtpRetransmissionConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Makes @p self keep the recently sent packets for retransmission.
+ *
+ * Every sent packet is then copied into a preallocated ring buffer, which is
+ * bounded by @p config in packets, bytes, and time. The packets requested by
+ * generic NACKs (see #SmolRTSP_RtpTransport_ingest_rtcp) are resent from the
+ * buffer without re-packetizing.
+ *
+ * @pre `self != NULL`
+ * @pre `config.max_packets > 0 && config.max_bytes > 0`
+ * @pre The retransmission buffer is not enabled yet.
+ * @pre The `rand` PRNG must be set up via `srand` if `config.rtx`.
+ *
+ * @return 0 on success, -1 if the buffer cannot be allocated (`errno` is set
+ * to `ENOMEM`).
+ */
+int SmolRTSP_RtpTransport_enable_retransmission(
+    SmolRTSP_RtpTransport *self,
+    SmolRTSP_RtpRetransmissionConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Resends the packet @p seq_num from the retransmission buffer of @p self.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, -1 if the packet is not in the buffer or is older than
+ * #SmolRTSP_RtpRetransmissionConfig.max_age_us (`errno` is set to `ENOENT`),
+ * or if an I/O error occurred (`errno` is set appropriately).
+ */
+int SmolRTSP_RtpTransport_retransmit(
+    SmolRTSP_RtpTransport *self, uint16_t seq_num) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The URI of the absolute send time header extension, a 24-bit 6.18
+ * fixed-point timestamp of the transmission in seconds.
+ *
+ * @see <https://webrtc.googlesource.com/src/+/main/docs/native-code/rtp-hdrext/abs-send-time>
+ */
+#define SMOLRTSP_RTP_EXT_ABS_SEND_TIME_URI                                     \
+    "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"
+
+/**
+ * The URI of the transport-wide sequence number header extension, a 16-bit
+ * sequence number shared by all the streams of a transport.
+ *
+ * @see <https://datatracker.ietf.org/doc/html/draft-holmer-rmcat-transport-wide-cc-extensions-01>
+ */
+#define SMOLRTSP_RTP_EXT_TRANSPORT_WIDE_CC_URI                                 \
+    "http://www.ietf.org/id/"                                                  \
+    "draft-holmer-rmcat-transport-wide-cc-extensions-01"
+
+/**
+ * The RTP header extensions (RFC 8285) written by #SmolRTSP_RtpTransport.
+ *
+ * An extension is identified by the ID negotiated in SDP (`a=extmap`), or
+ * disabled with the ID 0. The one-byte form is used if all the IDs are at
+ * most 14, and the two-byte form otherwise.
+ */
+typedef struct {
+    /**
+     * The ID of the absolute send time (#SMOLRTSP_RTP_EXT_ABS_SEND_TIME_URI).
+     */
+    uint8_t abs_send_time_id;
+
+    /**
+     * The ID of the transport-wide sequence number
+     * (#SMOLRTSP_RTP_EXT_TRANSPORT_WIDE_CC_URI).
+     */
+    uint8_t transport_wide_cc_id;
+
+    /**
+     * The counter of the transport-wide sequence numbers, shared by the RTP
+     * transports of the same network transport, or `NULL` for a counter of
+     * its own.
+     *
+     * The counter is not synchronized: the transports sharing it must be
+     * used from a single thread.
+     */
+    uint16_t *transport_wide_seq_num;
+
+    /**
+     * The clock of the absolute send time, or `NULL` for `CLOCK_MONOTONIC`.
+     * Only the differences between the send times matter to receivers.
+     */
+    uint64_t (*clock_us)(void);
+} SmolRTSP_RtpExtensionsConfig;
+
+/**
+ * Returns the configuration with all the extensions disabled.
+ */
+SmolRTSP_RtpExtensionsConfig
+SmolRTSP_RtpExtensionsConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the `a=extmap:<ID> <URI>` SDP attributes of the extensions of
+ * @p self to @p w.
+ *
+ * @pre `w.self && w.vptr`
+ *
+ * @return The number of bytes written or a negative value on error.
+ */
+ssize_t SmolRTSP_RtpExtensionsConfig_sdp(
+    SmolRTSP_RtpExtensionsConfig self,
+    SmolRTSP_Writer w) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Makes @p self write the header extensions of @p config into every packet.
+ *
+ * The extensions are serialized once into the header template, and only
+ * their values are patched for each packet, as the sequence number and the
+ * timestamp are. A retransmitted packet gets a new send time and
+ * transport-wide sequence number, since it is a new transmission for
+ * congestion control. #SmolRTSP_RtpTransport_max_payload_size shrinks by the
+ * size of the extensions.
+ *
+ * @pre `self != NULL`
+ * @pre No packet has been sent by @p self yet.
+ * @pre The IDs of @p config are distinct unless 0.
+ */
+void SmolRTSP_RtpTransport_enable_extensions(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpExtensionsConfig config);
+
+/**
+ * Makes @p self record the transport-wide sequence number, size, and send time
+ * of every packet it sends, retransmissions included, in @p estimator, and
+ * pass the transport-wide feedback it ingests to @p estimator.
+ *
+ * The send times come from #SmolRTSP_RtpExtensionsConfig.clock_us. @p estimator
+ * is not owned by @p self and must outlive it; pass `NULL` to detach it.
+ *
+ * @pre `self != NULL`
+ * @pre The transport-wide sequence number extension is enabled by
+ * #SmolRTSP_RtpTransport_enable_extensions.
+ * @pre @p self is not thread-safe (see
+ * #SmolRTSP_RtpTransport_enable_thread_safety) unless @p estimator is `NULL`.
+ */
+void SmolRTSP_RtpTransport_set_bandwidth_estimator(
+    SmolRTSP_RtpTransport *self, SmolRTSP_BandwidthEstimator *estimator);
+
+/**
+ * The configuration of the audio frame aggregation of #SmolRTSP_RtpTransport.
+ */
+typedef struct {
+    /**
+     * The duration of the frames to aggregate into a packet, in milliseconds,
+     * as signalled by `a=ptime`.
+     */
+    uint32_t ptime_ms;
+
+    /**
+     * The duration that a packet must never exceed, in milliseconds, as
+     * signalled by `a=maxptime`, or 0 to make it #ptime_ms.
+     */
+    uint32_t maxptime_ms;
+
+    /**
+     * The maximum size of an aggregated payload, which is allocated upfront.
+     */
+    size_t max_payload_size;
+} SmolRTSP_RtpAudioAggregationConfig;
+
+/**
+ * Returns the default configuration: 60 ms packets of at most 120 ms and 1200
+ * bytes.
+ */
+SmolRTSP_RtpAudioAggregationConfig
+SmolRTSP_RtpAudioAggregationConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the `a=ptime:<ms>` and `a=maxptime:<ms>` SDP attributes of @p self
+ * to @p w.
+ *
+ * @pre `w.self && w.vptr`
+ *
+ * @return The number of bytes written or a negative value on error.
+ */
+ssize_t SmolRTSP_RtpAudioAggregationConfig_sdp(
+    SmolRTSP_RtpAudioAggregationConfig self,
+    SmolRTSP_Writer w) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Makes @p self aggregate the audio frames of
+ * #SmolRTSP_RtpTransport_send_audio_frame into packets of @p config.
+ *
+ * With 20 ms G.711 frames and a 60 ms ptime, a stream costs a third of the
+ * packets and, if the frames are fed three at a time, of the wakeups.
+ *
+ * @pre `self != NULL`
+ * @pre `config.ptime_ms > 0 && config.max_payload_size > 0`
+ * @pre `config.maxptime_ms` is 0 or at least `config.ptime_ms`.
+ * @pre The aggregation is not enabled yet.
+ *
+ * @return 0 on success, or -1 if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+int SmolRTSP_RtpTransport_enable_audio_aggregation(
+    SmolRTSP_RtpTransport *self,
+    SmolRTSP_RtpAudioAggregationConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Queues the audio frame @p frame of @p duration RTP clock ticks starting at
+ * @p ts, sending the queued frames as one packet once they last
+ * #SmolRTSP_RtpAudioAggregationConfig.ptime_ms.
+ *
+ * The queued frames are sent first if @p frame does not follow them
+ * seamlessly (e.g., after silence suppression), or if it would make the packet
+ * exceed `maxptime_ms` or `max_payload_size`. A frame larger than
+ * `max_payload_size` is sent on its own. The timestamp of a packet is the one
+ * of its first frame.
+ *
+ * Without #SmolRTSP_RtpTransport_enable_audio_aggregation, @p frame is sent
+ * right away as by #SmolRTSP_RtpTransport_send_packet.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, or -1 if an I/O error occurred (and sets `errno`
+ * appropriately); the queued frames are discarded then.
+ */
+int SmolRTSP_RtpTransport_send_audio_frame(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts, U8Slice99 frame,
+    uint32_t duration) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends the audio frames queued by #SmolRTSP_RtpTransport_send_audio_frame as
+ * one packet, if any, e.g., at the end of a stream.
+ *
+ * @pre `self != NULL`
+ *
+ * @return 0 on success, or -1 if an I/O error occurred (and sets `errno`
+ * appropriately).
+ */
+int SmolRTSP_RtpTransport_flush_audio(SmolRTSP_RtpTransport *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Makes @p self safe to send from several threads at once, e.g., from the
+ * main sender, a retransmission thread, and an FEC thread.
+ *
+ * Every #SmolRTSP_RtpTransport_send_packet and
+ * #SmolRTSP_RtpTransport_send_batch reserves the sequence numbers of all its
+ * packets up front with a single atomic increment, and so do all the sends
+ * with the transport-wide sequence numbers. Thus the senders never wait for
+ * each other, except when the retransmission history is kept: storing packets
+ * into it and retransmitting from it take a spin lock, which a sender holds
+ * only to reserve the sequence numbers and copy the packets, and
+ * #SmolRTSP_RtpTransport_retransmit holds for its single transmission.
+ *
+ * Unlike in the default mode, the sequence numbers of the packets that
+ * failed to be sent are not reused; receivers see them as lost. With
+ * retransmission, the packets are stored before being transmitted.
+ *
+ * The transport passed to #SmolRTSP_RtpTransport_new must allow concurrent
+ * transmissions of whole packets, as UDP without zero-copy does. The audio
+ * aggregation, the clock, and the configuration functions are still meant for
+ * a single thread.
+ *
+ * @pre `self != NULL`
+ * @pre @p self has not sent anything yet.
+ * @pre @p self has no bandwidth estimator (see
+ * #SmolRTSP_RtpTransport_set_bandwidth_estimator), which must be used from a
+ * single thread.
+ * @pre All the transports sharing
+ * #SmolRTSP_RtpExtensionsConfig.transport_wide_seq_num are thread-safe.
+ */
+void SmolRTSP_RtpTransport_enable_thread_safety(SmolRTSP_RtpTransport *self);
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @brief A cache of pre-rendered SDP session descriptions.
+ */
+
+#pragma once
+
+#include <smolrtsp/writer.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The initial value of an SDP content key, to be extended with
+ * #smolrtsp_sdp_key.
+ */
+#define SMOLRTSP_SDP_KEY_INIT UINT64_C(14695981039346656037)
+
+/**
+ * Extends the content key @p key with @p data (FNV-1a).
+ *
+ * A key is computed from everything an SDP depends on, e.g., the `sprop-*`
+ * representation of #SmolRTSP_ParamSetCache and the ports, so that the cached
+ * SDP is re-rendered once any of them changes.
+ */
+uint64_t smolrtsp_sdp_key(uint64_t key, const void *data, size_t len)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * An SDP session description rendered once and served to every DESCRIBE until
+ * its content changes.
+ *
+ * Typical usage:
+ *
+ * @code
+ * uint64_t key = SMOLRTSP_SDP_KEY_INIT;
+ * key = smolrtsp_sdp_key(key, sprop, strlen(sprop));
+ * key = smolrtsp_sdp_key(key, &port, sizeof port);
+ *
+ * CharSlice99 sdp;
+ * if (!SmolRTSP_SdpCache_lookup(&cache, key, &sdp)) {
+ *     SmolRTSP_Writer w = SmolRTSP_SdpCache_begin(&cache);
+ *     ssize_t ret = 0;
+ *     SMOLRTSP_SDP_DESCRIBE(ret, w, (SMOLRTSP_SDP_VERSION, "0"), ...);
+ *     if (SmolRTSP_SdpCache_commit(&cache, key, &sdp) == -1) {
+ *         // The SDP does not fit into the buffer.
+ *     }
+ * }
+ *
+ * smolrtsp_body(ctx, sdp);
+ * @endcode
+ *
+ * The cache is not synchronized; guard it with a lock if several threads
+ * answer DESCRIBE for the same stream.
+ */
+typedef struct {
+    /**
+     * The rendered SDP.
+     */
+    SmolRTSP_StringBuffer sdp;
+
+    /**
+     * The content key #sdp has been rendered for.
+     */
+    uint64_t key;
+
+    /**
+     * Whether #sdp is complete and corresponds to #key.
+     */
+    bool valid;
+} SmolRTSP_SdpCache;
+
+/**
+ * Creates an empty cache rendering into @p buffer of @p capacity bytes.
+ *
+ * @pre `buffer != NULL`
+ * @pre `capacity > 0`
+ */
+SmolRTSP_SdpCache
+SmolRTSP_SdpCache_new(char *buffer, size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Retrieves the cached SDP if it has been rendered for @p key.
+ *
+ * @param[in] self The cache.
+ * @param[in] key The content key of the SDP being requested.
+ * @param[out] sdp The cached SDP, valid until the next
+ * #SmolRTSP_SdpCache_begin.
+ *
+ * @return Whether the SDP is cached.
+ *
+ * @pre `self != NULL`
+ * @pre `sdp != NULL`
+ */
+bool SmolRTSP_SdpCache_lookup(
+    const SmolRTSP_SdpCache *self, uint64_t key,
+    CharSlice99 *restrict sdp) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Discards the cached SDP and returns a writer to render the new one into.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer
+SmolRTSP_SdpCache_begin(SmolRTSP_SdpCache *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Finishes rendering started by #SmolRTSP_SdpCache_begin, remembering the SDP
+ * for @p key.
+ *
+ * @param[in] self The cache.
+ * @param[in] key The content key the SDP has been rendered for.
+ * @param[out] sdp The rendered SDP.
+ *
+ * @return 0 on success, -1 if the SDP has not fit into the buffer (`errno` is
+ * set to `ENOBUFS`).
+ *
+ * @pre `self != NULL`
+ * @pre `sdp != NULL`
+ */
+int SmolRTSP_SdpCache_commit(
+    SmolRTSP_SdpCache *self, uint64_t key,
+    CharSlice99 *restrict sdp) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Forces the next #SmolRTSP_SdpCache_lookup to fail.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_SdpCache_invalidate(SmolRTSP_SdpCache *self);
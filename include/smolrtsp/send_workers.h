@@ -0,0 +1,237 @@
+/**
+ * @file
+ * @brief Background threads sending NAL units on behalf of producers.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A pool of sender threads.
+ *
+ * Every NAL transport attached to the pool gets its own single-producer,
+ * single-consumer queue and is served by exactly one worker thread, so that
+ * packetization and system calls run off the producer thread and egress scales
+ * with the number of workers. Transports are distributed over the workers in a
+ * round-robin manner, or over the workers of a NUMA node by
+ * #SmolRTSP_SendWorkers_attach_on_node.
+ */
+typedef struct SmolRTSP_SendWorkers SmolRTSP_SendWorkers;
+
+/**
+ * A queue of NAL units from a single producer to one attached
+ * #SmolRTSP_NalTransport.
+ */
+typedef struct SmolRTSP_SendQueue SmolRTSP_SendQueue;
+
+/**
+ * The configuration of #SmolRTSP_SendWorkers.
+ */
+typedef struct {
+    /**
+     * The number of worker threads.
+     */
+    size_t workers_count;
+
+    /**
+     * Whether to pin the worker `i` to the CPU #smolrtsp_allowed_cpu(`i`),
+     * which also gives it a NUMA node for #SmolRTSP_SendWorkers_attach_on_node.
+     *
+     * A worker that cannot be pinned runs unpinned.
+     */
+    bool pin_workers;
+} SmolRTSP_SendWorkersConfig;
+
+/**
+ * Returns the default configuration of @p workers_count unpinned workers.
+ */
+SmolRTSP_SendWorkersConfig
+SmolRTSP_SendWorkersConfig_default(size_t workers_count) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The placement of a worker of #SmolRTSP_SendWorkers and its statistics.
+ */
+typedef struct {
+    /**
+     * The CPU that the worker is pinned to, or -1 if it is not pinned.
+     */
+    int cpu;
+
+    /**
+     * The NUMA node of #cpu, or -1 if it is unknown.
+     */
+    int numa_node;
+
+    /**
+     * The number of queues currently attached to the worker.
+     */
+    size_t queues;
+
+    /**
+     * The number of queues attached by #SmolRTSP_SendWorkers_attach_on_node to
+     * the worker on the requested node.
+     */
+    uint64_t local_attachments;
+
+    /**
+     * The number of queues attached by #SmolRTSP_SendWorkers_attach_on_node to
+     * the worker although no worker is on the requested node.
+     */
+    uint64_t remote_attachments;
+} SmolRTSP_SendWorkerStats;
+
+/**
+ * Starts @p workers_count sender threads.
+ *
+ * The same as #SmolRTSP_SendWorkers_new_with_config with
+ * #SmolRTSP_SendWorkersConfig_default.
+ *
+ * @pre `workers_count > 0`
+ *
+ * @return The sender pool, or `NULL` if an allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_SendWorkers *
+SmolRTSP_SendWorkers_new(size_t workers_count) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Starts the sender threads of @p config.
+ *
+ * @pre `config.workers_count > 0`
+ *
+ * @return The sender pool, or `NULL` if an allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_SendWorkers *SmolRTSP_SendWorkers_new_with_config(
+    SmolRTSP_SendWorkersConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Attaches @p t to one of the workers of @p self.
+ *
+ * The pool does not take ownership of @p t; detach the returned queue via
+ * #SmolRTSP_SendWorkers_detach before dropping @p t.
+ *
+ * @param[out] self The sender pool.
+ * @param[in] t The transport to send NAL units through.
+ * @param[in] capacity The maximum number of NAL units waiting in the queue.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ * @pre `capacity > 0`
+ *
+ * @return The queue, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_SendQueue *SmolRTSP_SendWorkers_attach(
+    SmolRTSP_SendWorkers *self, SmolRTSP_NalTransport *t,
+    size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Attaches @p t to the least loaded worker of @p self on the NUMA node
+ * @p numa_node, such as the node of the network device that @p t sends
+ * through (see #smolrtsp_interface_numa_node), so that the packetization and
+ * the fan-out of the stream never cross nodes.
+ *
+ * If @p numa_node is -1 or no worker is on it (e.g., the workers are not
+ * pinned), @p t is attached as by #SmolRTSP_SendWorkers_attach. The outcome is
+ * counted in #SmolRTSP_SendWorkerStats.
+ *
+ * @pre `self != NULL`
+ * @pre `t != NULL`
+ * @pre `capacity > 0`
+ *
+ * @return The queue, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`); nothing is counted then.
+ */
+SmolRTSP_SendQueue *SmolRTSP_SendWorkers_attach_on_node(
+    SmolRTSP_SendWorkers *self, SmolRTSP_NalTransport *t, size_t capacity,
+    int numa_node) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Detaches @p queue from @p self and frees it.
+ *
+ * NAL units that are still queued are discarded. After this function returns,
+ * no worker accesses the transport of @p queue.
+ *
+ * @pre `self != NULL`
+ * @pre @p queue has been returned by #SmolRTSP_SendWorkers_attach on @p self.
+ */
+void SmolRTSP_SendWorkers_detach(
+    SmolRTSP_SendWorkers *self, SmolRTSP_SendQueue *queue);
+
+/**
+ * Enqueues @p nalu to be sent by #SmolRTSP_NalTransport_send_packet.
+ *
+ * The payload of @p nalu is copied, so it can be released as soon as this
+ * function returns. This function never waits for the network.
+ *
+ * Only one thread at a time can push to the same queue.
+ *
+ * @param[out] queue The queue to push to.
+ * @param[in] ts The RTP timestamp of @p nalu.
+ * @param[in] nalu The NAL unit to send.
+ *
+ * @pre `queue != NULL`
+ *
+ * @return -1 if the queue is full and sets `errno` to `ENOBUFS`, -1 if the
+ * payload cannot be copied and sets `errno` to `ENOMEM`, 0 on success.
+ */
+int SmolRTSP_SendQueue_push(
+    SmolRTSP_SendQueue *queue, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of NAL units for which #SmolRTSP_NalTransport_send_packet
+ * has failed.
+ *
+ * @pre `queue != NULL`
+ */
+uint64_t SmolRTSP_SendQueue_failures(const SmolRTSP_SendQueue *queue)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the index of the worker serving @p queue.
+ *
+ * @pre `queue != NULL`
+ */
+size_t SmolRTSP_SendQueue_worker(const SmolRTSP_SendQueue *queue)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of workers of @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_SendWorkers_workers_count(const SmolRTSP_SendWorkers *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the placement and the statistics of the worker @p worker_id of
+ * @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `worker_id < SmolRTSP_SendWorkers_workers_count(self)`
+ */
+SmolRTSP_SendWorkerStats SmolRTSP_SendWorkers_worker_stats(
+    const SmolRTSP_SendWorkers *self, size_t worker_id) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_SendWorkers.
+ *
+ * Stops and joins all the workers and frees the remaining queues, but not their
+ * transports.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_SendWorkers);
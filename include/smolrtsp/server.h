@@ -0,0 +1,347 @@
+/**
+ * @file
+ * @brief A multi-threaded RTSP server engine.
+ */
+
+#pragma once
+
+#include <smolrtsp/controller.h>
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/session_registry.h>
+#include <smolrtsp/writer.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/socket.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * An RTSP server running a pool of worker threads.
+ *
+ * Every worker runs its own `epoll` loop with its own listening socket bound
+ * to the same address with `SO_REUSEPORT`, so that the kernel spreads
+ * incoming connections over the workers and none of them is shared between
+ * threads. A connection stays on the worker that has accepted it for its
+ * whole lifetime.
+ *
+ * With #SmolRTSP_ServerConfig.pin_workers, every worker runs on its own CPU
+ * and asks the kernel (`SO_INCOMING_CPU`) for the connections whose packets
+ * are received on that CPU, so that a connection is served on the NUMA node
+ * of the NIC queue it arrives on.
+ */
+typedef struct SmolRTSP_Server SmolRTSP_Server;
+
+/**
+ * An RTSP connection accepted by #SmolRTSP_Server.
+ */
+typedef struct SmolRTSP_ServerConnection SmolRTSP_ServerConnection;
+
+/**
+ * Creates a controller for a newly accepted connection @p conn.
+ *
+ * Invoked on the worker thread of @p conn. The server takes ownership of the
+ * controller and drops it when the connection is closed.
+ *
+ * @param[in] conn The accepted connection.
+ * @param[in] arg #SmolRTSP_ServerConfig.arg.
+ * @param[out] controller The controller to handle the requests of @p conn.
+ *
+ * @return Whether to accept the connection; otherwise, it is closed at once.
+ */
+typedef bool (*SmolRTSP_ServerAcceptCb)(
+    SmolRTSP_ServerConnection *conn, void *arg,
+    SmolRTSP_Controller *controller);
+
+/**
+ * Invoked periodically on every worker thread (e.g., to submit the writes of
+ * the worker's streams).
+ *
+ * @param[in] worker_id The index of the worker, less than
+ * #SmolRTSP_ServerConfig.workers_count.
+ * @param[in] arg #SmolRTSP_ServerConfig.arg.
+ */
+typedef void (*SmolRTSP_ServerTickCb)(size_t worker_id, void *arg);
+
+/**
+ * The configuration of #SmolRTSP_Server.
+ */
+typedef struct {
+    /**
+     * The number of worker threads.
+     */
+    size_t workers_count;
+
+    /**
+     * The `listen` backlog of every worker.
+     */
+    int backlog;
+
+    /**
+     * The size of the receive buffer of a connection, which bounds the size
+     * of a request (see also `max_request_size`). A connection whose request
+     * does not fit is closed.
+     *
+     * The requests received in full are parsed in a buffer of the worker; a
+     * connection is given a buffer of its own only while it has received a
+     * part of a request.
+     */
+    size_t recv_buffer_size;
+
+    /**
+     * The size of the send buffer of a connection, which holds the data that
+     * the socket has not accepted yet.
+     *
+     * The buffer is allocated only while there is such data.
+     */
+    size_t send_buffer_size;
+
+    /**
+     * Creates the controllers of the accepted connections.
+     */
+    SmolRTSP_ServerAcceptCb accept_cb;
+
+    /**
+     * Invoked roughly every `tick_interval_ms` milliseconds on every worker;
+     * can be `NULL`.
+     */
+    SmolRTSP_ServerTickCb tick_cb;
+
+    /**
+     * The period of `tick_cb`.
+     */
+    int tick_interval_ms;
+
+    /**
+     * The argument passed to `accept_cb` and `tick_cb`.
+     */
+    void *arg;
+
+    /**
+     * Whether to pin the worker `i` to the CPU #smolrtsp_allowed_cpu(`i`).
+     *
+     * A worker that cannot be pinned runs unpinned.
+     */
+    bool pin_workers;
+
+    /**
+     * The sessions whose keep-alive requests the workers answer themselves,
+     * or `NULL` to dispatch every request to the controllers.
+     *
+     * A `GET_PARAMETER` request with no body and the `Session` header of a
+     * session of the registry refreshes the timeout of the session (see
+     * #SmolRTSP_SessionRegistry_find) and is answered with `200 OK` and the
+     * same `CSeq` and `Session` directly: the request is not parsed in full,
+     * nothing is allocated, and the controller is not called, including its
+     * `before` hook, so the session identifier is the only credential of such
+     * a request. The other requests, including the keep-alives of unknown
+     * sessions, are dispatched as usual.
+     */
+    SmolRTSP_SessionRegistry *keep_alive_sessions;
+
+    /**
+     * The methods for the `Public` header with which the workers answer a
+     * keep-alive `OPTIONS` in the same way as `GET_PARAMETER` (e.g.,
+     * `"OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, GET_PARAMETER"`), or `NULL`
+     * to dispatch `OPTIONS` to the controllers.
+     */
+    const char *keep_alive_public;
+
+    /**
+     * The maximum size of a request with its body, at most `recv_buffer_size`,
+     * or 0 for `recv_buffer_size`.
+     *
+     * A request announcing a longer body in its `Content-Length` is rejected
+     * as soon as its headers are parsed.
+     */
+    size_t max_request_size;
+
+    /**
+     * The maximum time from the first received byte of a request to its last
+     * one, in milliseconds, or 0 for no limit.
+     *
+     * The partial requests are checked every quarter of this time, so that a
+     * client trickling its request is cut off in at most 1.25 times the limit.
+     */
+    int request_timeout_ms;
+
+    /**
+     * The maximum number of reads, and thus of parsing passes, that a request
+     * may take, or 0 for no limit.
+     */
+    size_t max_parse_attempts;
+
+    /**
+     * The maximum size of an interleaved binary data frame (with its 4-byte
+     * header) kept while it is being received, or 0 for `recv_buffer_size`.
+     *
+     * A frame announcing a longer payload is rejected at its header.
+     */
+    size_t max_interleaved_pending;
+} SmolRTSP_ServerConfig;
+
+/**
+ * The placement of a worker of #SmolRTSP_Server and its statistics.
+ */
+typedef struct {
+    /**
+     * The CPU that the worker is pinned to, or -1 if it is not pinned.
+     */
+    int cpu;
+
+    /**
+     * The NUMA node of #cpu, or -1 if it is unknown.
+     */
+    int numa_node;
+
+    /**
+     * The number of connections accepted by the worker.
+     */
+    uint64_t connections;
+
+    /**
+     * The number of the accepted connections received on the NUMA node of the
+     * worker (see #SmolRTSP_ServerConnection_numa_node).
+     */
+    uint64_t local_connections;
+
+    /**
+     * The number of the open connections holding a receive or a send buffer
+     * (see #SmolRTSP_ServerConfig.recv_buffer_size); an idle connection holds
+     * neither.
+     */
+    uint64_t buffered_connections;
+
+    /**
+     * The number of the keep-alive requests answered by the worker itself
+     * (see #SmolRTSP_ServerConfig.keep_alive_sessions).
+     */
+    uint64_t keep_alives;
+
+    /**
+     * The number of the connections closed for exceeding the limits of
+     * #SmolRTSP_ServerConfig (`recv_buffer_size`, `max_request_size`,
+     * `request_timeout_ms`, `max_parse_attempts`, or
+     * `max_interleaved_pending`), plus the connections closed right after
+     * `accept` because their state could not be allocated.
+     */
+    uint64_t rejected_connections;
+} SmolRTSP_ServerWorkerStats;
+
+/**
+ * The default value of #SmolRTSP_ServerConfig.request_timeout_ms.
+ */
+#define SMOLRTSP_SERVER_DEFAULT_REQUEST_TIMEOUT_MS 10000
+
+/**
+ * The default value of #SmolRTSP_ServerConfig.max_parse_attempts.
+ */
+#define SMOLRTSP_SERVER_DEFAULT_MAX_PARSE_ATTEMPTS 64
+
+/**
+ * Returns the default configuration with @p accept_cb: as many workers as
+ * there are online CPUs, a backlog of 128, a 4 KiB receive buffer, a 64 KiB
+ * send buffer, unpinned workers, no keep-alive fast path, requests and
+ * interleaved frames as large as the receive buffer, a request timeout of
+ * #SMOLRTSP_SERVER_DEFAULT_REQUEST_TIMEOUT_MS, and at most
+ * #SMOLRTSP_SERVER_DEFAULT_MAX_PARSE_ATTEMPTS reads per request.
+ *
+ * @pre `accept_cb != NULL`
+ */
+SmolRTSP_ServerConfig SmolRTSP_ServerConfig_default(
+    SmolRTSP_ServerAcceptCb accept_cb, void *arg) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Binds all the workers to @p addr and starts them.
+ *
+ * If the port of @p addr is 0, the workers listen on the port chosen by the
+ * kernel for the first one (see #SmolRTSP_Server_port).
+ *
+ * @return The running server, or `NULL` on error (and sets `errno`
+ * appropriately).
+ *
+ * @pre `addr != NULL`
+ * @pre `config.workers_count > 0`
+ * @pre `config.recv_buffer_size > 0`
+ * @pre `config.send_buffer_size > 0`
+ * @pre `config.accept_cb != NULL`
+ */
+SmolRTSP_Server *SmolRTSP_Server_start(
+    const struct sockaddr *addr, socklen_t addr_len,
+    SmolRTSP_ServerConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the port that @p self listens on, in host byte order.
+ *
+ * @pre `self != NULL`
+ */
+uint16_t
+SmolRTSP_Server_port(const SmolRTSP_Server *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the placement and the statistics of the worker @p worker_id of
+ * @p self.
+ *
+ * @pre `self != NULL`
+ * @pre `worker_id < config.workers_count`
+ */
+SmolRTSP_ServerWorkerStats SmolRTSP_Server_worker_stats(
+    const SmolRTSP_Server *self, size_t worker_id) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Server.
+ *
+ * Stops and joins all the workers, closes the connections, and drops their
+ * controllers.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Server);
+
+/**
+ * Returns the socket of @p self (e.g., to get the peer address for RTP/UDP).
+ *
+ * The socket is non-blocking and owned by the server.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_ServerConnection_fd(const SmolRTSP_ServerConnection *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the index of the worker serving @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_ServerConnection_worker(const SmolRTSP_ServerConnection *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NUMA node of the CPU that has received @p self from the
+ * network, or -1 if it is unknown.
+ *
+ * The streams of @p self are best sent from the same node, e.g., by
+ * #SmolRTSP_SendWorkers_attach_on_node.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_ServerConnection_numa_node(const SmolRTSP_ServerConnection *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the writer of @p self (e.g., for #smolrtsp_transport_tcp).
+ *
+ * The writer never blocks: data that the socket does not accept at once is
+ * kept in the send buffer and written when the socket becomes writable, and a
+ * write that does not fit into the send buffer fails with `EAGAIN`. Its
+ * `lock` and `unlock` take a recursive mutex, which the worker also holds
+ * while dispatching a request, so the writer can be used from other threads.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer
+SmolRTSP_ServerConnection_writer(SmolRTSP_ServerConnection *self)
+    SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,180 @@
+/**
+ * @file
+ * @brief A registry of RTSP sessions indexed by their identifiers.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum length of a session identifier.
+ */
+#define SMOLRTSP_SESSION_ID_MAX_LEN 64
+
+/**
+ * The maximum number of streams of a single session.
+ */
+#define SMOLRTSP_SESSION_MAX_STREAMS 8
+
+#ifndef SMOLRTSP_MAX_SESSIONS
+
+/**
+ * The maximum number of sessions of a #SmolRTSP_SessionRegistry, or 0 for no
+ * limit.
+ *
+ * Define it (e.g., with the `SMOLRTSP_MAX_SESSIONS` CMake option) to bound
+ * the memory taken by the sessions.
+ */
+#define SMOLRTSP_MAX_SESSIONS 0
+
+#endif
+
+/**
+ * An RTSP session (RFC 2326, section 12.37): a set of streams shared by the
+ * requests carrying the same `Session` header.
+ *
+ * Sessions are reference-counted: every session returned by the registry must
+ * be given back with #SmolRTSP_Session_release, and its streams are dropped
+ * once it has been removed from the registry and the last reference has been
+ * released.
+ */
+typedef struct SmolRTSP_Session SmolRTSP_Session;
+
+/**
+ * A thread-safe hash table of sessions with idle timeouts.
+ *
+ * Lookups take constant time regardless of the number of sessions, and the
+ * table is split into independently locked shards, so that the workers of
+ * a multi-threaded server seldom contend on the same lock.
+ */
+typedef struct SmolRTSP_SessionRegistry SmolRTSP_SessionRegistry;
+
+/**
+ * Creates an empty registry.
+ *
+ * @param[in] capacity The expected number of sessions, used to size the table
+ * upfront; it grows as needed either way.
+ * @param[in] timeout_ms The time after which a session not looked up is
+ * removed by #SmolRTSP_SessionRegistry_expire.
+ *
+ * @return The registry, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_SessionRegistry *SmolRTSP_SessionRegistry_new(
+    size_t capacity, uint32_t timeout_ms) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a session with the identifier @p id.
+ *
+ * @return The new session, or `NULL` if @p id is empty or longer than
+ * #SMOLRTSP_SESSION_ID_MAX_LEN (and sets `errno` to `EINVAL`), is already
+ * registered (and sets `errno` to `EEXIST`), or if @p self has
+ * #SMOLRTSP_MAX_SESSIONS sessions (and sets `errno` to `ENOSPC`) or the
+ * allocation fails (and sets `errno` to `ENOMEM`).
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Session *SmolRTSP_SessionRegistry_create(
+    SmolRTSP_SessionRegistry *self, CharSlice99 id) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Finds the session with the identifier @p id and resets its timeout.
+ *
+ * @p id can also be the whole value of a `Session` header; its parameters,
+ * such as `timeout`, are ignored.
+ *
+ * @return The session, or `NULL` if there is none.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Session *SmolRTSP_SessionRegistry_find(
+    SmolRTSP_SessionRegistry *self, CharSlice99 id) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Removes the session with the identifier @p id (e.g., on `TEARDOWN`).
+ *
+ * @return Whether the session has been found.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_SessionRegistry_remove(
+    SmolRTSP_SessionRegistry *self, CharSlice99 id);
+
+/**
+ * Removes the sessions idle for longer than the timeout of @p self.
+ *
+ * Scans the whole registry, so it is meant to be called periodically rather
+ * than per request.
+ *
+ * @return The number of removed sessions.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_SessionRegistry_expire(SmolRTSP_SessionRegistry *self);
+
+/**
+ * Returns the number of registered sessions.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_SessionRegistry_len(const SmolRTSP_SessionRegistry *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_SessionRegistry.
+ *
+ * Removes all the sessions. The sessions still referenced are freed once
+ * released.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_SessionRegistry);
+
+/**
+ * Returns the identifier of @p self.
+ *
+ * @pre `self != NULL`
+ */
+CharSlice99
+SmolRTSP_Session_id(const SmolRTSP_Session *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds @p stream (e.g., an object holding the RTP transport of a track) to
+ * @p self, which takes ownership of it.
+ *
+ * @return -1 if @p self already has #SMOLRTSP_SESSION_MAX_STREAMS streams (and
+ * sets `errno` to `ENOSPC`), 0 on success.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_Session_add_stream(
+    SmolRTSP_Session *self, SmolRTSP_Droppable stream) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Copies up to @p max streams of @p self into @p streams.
+ *
+ * The streams stay owned by @p self.
+ *
+ * @return The number of streams copied.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Session_streams(
+    SmolRTSP_Session *self, SmolRTSP_Droppable *streams, size_t max);
+
+/**
+ * Gives back a reference to @p self obtained from the registry.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_Session_release(SmolRTSP_Session *self);
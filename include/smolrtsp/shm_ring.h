@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief A shared-memory ring of access units passed from a local encoder
+ * process.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/nal.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum number of NAL units in an access unit of #SmolRTSP_ShmRing.
+ */
+#define SMOLRTSP_SHM_RING_MAX_NALUS 64
+
+/**
+ * A single-producer, single-consumer ring of access units in a `memfd`
+ * shared by two processes, e.g., an encoder and the server.
+ *
+ * The producer copies every access unit into the ring once, with the
+ * boundaries of its NAL units, and the consumer gets NAL units pointing into
+ * its own mapping of the ring, which it passes to the transports (e.g.,
+ * #SmolRTSP_NalTransport_send_au_packet) without copying them. The positions
+ * of both ends are exchanged through the shared memory with atomics, and the
+ * producer signals an `eventfd` after every access unit, so that the consumer
+ * can wait for data in its event loop.
+ *
+ * An access unit never wraps around the end of the ring, but the rest of the
+ * ring is skipped instead. The consumer does not trust the producer: it checks
+ * every record against the bounds of the ring before exposing it, and it maps
+ * only memory sealed against shrinking, so that a faulty producer cannot make
+ * it read outside the ring.
+ *
+ * One process may only push and the other may only peek and release; the
+ * handles themselves are not thread-safe.
+ */
+typedef struct SmolRTSP_ShmRing SmolRTSP_ShmRing;
+
+/**
+ * An access unit peeked from #SmolRTSP_ShmRing.
+ */
+typedef struct {
+    /**
+     * The timestamp of the access unit.
+     */
+    SmolRTSP_RtpTimestamp ts;
+
+    /**
+     * The NAL units of the access unit, in the decoding order; their payloads
+     * point into the ring.
+     */
+    const SmolRTSP_NalUnit *nalus;
+
+    /**
+     * The number of elements in #nalus.
+     */
+    size_t nalus_count;
+} SmolRTSP_ShmAccessUnit;
+
+/**
+ * Creates a ring of @p capacity bytes for NAL units of @p codec in a new
+ * sealed `memfd`, together with its `eventfd`.
+ *
+ * Pass #SmolRTSP_ShmRing_memfd and #SmolRTSP_ShmRing_eventfd to the other
+ * process (e.g., with `SCM_RIGHTS` over a UNIX socket), which opens the same
+ * ring with #SmolRTSP_ShmRing_open.
+ *
+ * @return The ring, or `NULL` on error (and sets `errno` appropriately).
+ *
+ * @pre `capacity > 0`
+ */
+SmolRTSP_ShmRing *SmolRTSP_ShmRing_new(
+    size_t capacity, SmolRTSP_NalCodec codec) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Maps the ring of @p memfd, signalled by @p eventfd, created by
+ * #SmolRTSP_ShmRing_new in another process.
+ *
+ * The ring takes ownership of both descriptors on success.
+ *
+ * @return The ring, or `NULL` on error (and sets `errno` appropriately). If
+ * @p memfd is not a ring, is not sealed against shrinking, or is smaller than
+ * its header claims, `errno` is `EINVAL`.
+ */
+SmolRTSP_ShmRing *
+SmolRTSP_ShmRing_open(int memfd, int eventfd) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the `memfd` of @p self.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_ShmRing_memfd(const SmolRTSP_ShmRing *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the `eventfd` of @p self, which becomes readable once the producer
+ * has pushed an access unit.
+ *
+ * The consumer should read the counter of the `eventfd` and then peek the
+ * access units until the ring is empty.
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_ShmRing_eventfd(const SmolRTSP_ShmRing *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the codec of the NAL units of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_NalCodec
+SmolRTSP_ShmRing_codec(const SmolRTSP_ShmRing *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Copies the access unit @p nalus with the timestamp @p ts into the ring and
+ * signals the consumer.
+ *
+ * A live encoder is never blocked by a slow consumer: if the ring has no room
+ * for the access unit, it is not pushed.
+ *
+ * @return 0 on success, or -1 if there is no room for the access unit (and
+ * sets `errno` to `ENOBUFS`), or if it is larger than the whole ring or has
+ * more than #SMOLRTSP_SHM_RING_MAX_NALUS NAL units (and sets `errno` to
+ * `EMSGSIZE`).
+ *
+ * @pre `self != NULL`
+ * @pre `nalus != NULL || 0 == nalus_count`
+ */
+int SmolRTSP_ShmRing_push(
+    SmolRTSP_ShmRing *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit *nalus, size_t nalus_count) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Gets the oldest access unit of the ring into @p au without removing it.
+ *
+ * The access unit stays valid until #SmolRTSP_ShmRing_release; peeking again
+ * before that returns the same access unit.
+ *
+ * @return 0 on success, or -1 if the ring is empty (and sets `errno` to
+ * `EAGAIN`) or holds a malformed record (and sets `errno` to `EBADMSG`), after
+ * which the ring is unusable.
+ *
+ * @pre `self != NULL`
+ * @pre `au != NULL`
+ */
+int SmolRTSP_ShmRing_peek(
+    SmolRTSP_ShmRing *self,
+    SmolRTSP_ShmAccessUnit *restrict au) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Removes the access unit returned by the last #SmolRTSP_ShmRing_peek, giving
+ * its memory back to the producer.
+ *
+ * Does nothing if no access unit is peeked.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_ShmRing_release(SmolRTSP_ShmRing *self);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_ShmRing.
+ *
+ * Unmaps the ring and closes its descriptors. The ring itself lives as long as
+ * the other process keeps it open.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_ShmRing);
@@ -0,0 +1,219 @@
+/**
+ * @file
+ * @brief <a href="https://datatracker.ietf.org/doc/html/rfc3711">RFC 3711</a>
+ * (SRTP) encryption and authentication of RTP and RTCP packets, keyed by SDP
+ * security descriptions.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The size of an SRTP master key.
+ */
+#define SMOLRTSP_SRTP_MASTER_KEY_SIZE 16
+
+/**
+ * The size of an SRTP master salt.
+ */
+#define SMOLRTSP_SRTP_MASTER_SALT_SIZE 14
+
+/**
+ * The number of bytes by which an SRTCP packet exceeds the RTCP packet: the
+ * SRTCP index and an 80-bit authentication tag.
+ */
+#define SMOLRTSP_SRTCP_OVERHEAD 14
+
+/**
+ * An SRTP crypto-suite.
+ *
+ * @see SDP security descriptions crypto-suites:
+ * <https://datatracker.ietf.org/doc/html/rfc4568#section-6.2>
+ */
+typedef enum {
+    /**
+     * `AES_CM_128_HMAC_SHA1_80`: AES-128 in counter mode with an 80-bit
+     * HMAC-SHA1 authentication tag.
+     */
+    SmolRTSP_SrtpSuite_AesCm128HmacSha1_80,
+
+    /**
+     * `AES_CM_128_HMAC_SHA1_32`: the same with a 32-bit authentication tag
+     * for SRTP (SRTCP keeps the 80-bit one).
+     */
+    SmolRTSP_SrtpSuite_AesCm128HmacSha1_32,
+} SmolRTSP_SrtpSuite;
+
+/**
+ * Returns the SDP name of @p self, e.g., `"AES_CM_128_HMAC_SHA1_80"`.
+ */
+const char *SmolRTSP_SrtpSuite_str(SmolRTSP_SrtpSuite self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of bytes by which an SRTP packet of @p self exceeds the
+ * RTP packet (its authentication tag).
+ */
+size_t SmolRTSP_SrtpSuite_overhead(SmolRTSP_SrtpSuite self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The master key and salt of an SRTP crypto context.
+ *
+ * The key derivation rate is 0, and there is no MKI.
+ */
+typedef struct {
+    /**
+     * The crypto-suite.
+     */
+    SmolRTSP_SrtpSuite suite;
+
+    /**
+     * The master key.
+     */
+    uint8_t master_key[SMOLRTSP_SRTP_MASTER_KEY_SIZE];
+
+    /**
+     * The master salt.
+     */
+    uint8_t master_salt[SMOLRTSP_SRTP_MASTER_SALT_SIZE];
+} SmolRTSP_SrtpKeys;
+
+/**
+ * Fills @p self with a random master key and salt from the system CSPRNG.
+ *
+ * @param[out] self The keys to generate.
+ * @param[in] suite The crypto-suite of the keys.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if the random bytes could not be obtained (and sets `errno`), 0
+ * on success.
+ */
+int SmolRTSP_SrtpKeys_generate(
+    SmolRTSP_SrtpKeys *self, SmolRTSP_SrtpSuite suite) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Parses the value of an SDP `crypto` attribute, e.g.,
+ * `1 AES_CM_128_HMAC_SHA1_80 inline:<base64 key and salt>|2^31`.
+ *
+ * The lifetime of the key is ignored. Only the first key parameter is used,
+ * and session parameters are ignored.
+ *
+ * @param[out] self The parsed keys.
+ * @param[in] value The attribute value, after `a=crypto:`.
+ *
+ * @pre `self != NULL`
+ *
+ * @return -1 if the value is malformed, its crypto-suite is unsupported, or it
+ * has an MKI (and sets `errno` to `EINVAL`), 0 on success.
+ *
+ * @see <https://datatracker.ietf.org/doc/html/rfc4568#section-9.1>
+ */
+int SmolRTSP_SrtpKeys_parse_sdp(SmolRTSP_SrtpKeys *self, CharSlice99 value)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the SDP attribute `a=crypto:<tag> <suite> inline:<key and salt>`
+ * describing @p self to @p w.
+ *
+ * @param[in] self The keys to describe.
+ * @param[out] w The writer to be provided with SDP data.
+ * @param[in] tag The tag of the attribute (1 for the first one of a media
+ * description).
+ *
+ * @pre `w.self && w.vptr`
+ *
+ * @return The number of bytes written or a negative value on error.
+ */
+ssize_t SmolRTSP_SrtpKeys_sdp(
+    SmolRTSP_SrtpKeys self, SmolRTSP_Writer w,
+    uint32_t tag) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A transport that encrypts and authenticates the RTP (or RTCP) packets
+ * forwarded to an underlying transport.
+ *
+ * Every packet is gathered from its I/O vectors into a buffer of the
+ * transport, which is then encrypted in place (with AES-NI or the ARMv8
+ * crypto extension if available) and authenticated, so that the packet is
+ * copied exactly once, as it would be anyway to append the authentication
+ * tag.
+ *
+ * The rollover counters are tracked for up to four SSRCs (e.g., the media,
+ * RTX, and FEC streams); a retransmission is encrypted with the index of the
+ * original packet.
+ *
+ * The maximum packet size is reduced by the overhead of the protection.
+ */
+typedef struct SmolRTSP_SrtpTransport SmolRTSP_SrtpTransport;
+
+/**
+ * Creates a new SRTP transport on top of @p t, which protects RTP packets.
+ *
+ * The SRTP transport takes ownership of @p t: it is dropped together with the
+ * SRTP transport.
+ *
+ * @pre `t.self && t.vptr`
+ *
+ * @return The SRTP transport, or `NULL` if there is not enough memory (and
+ * sets `errno` to `ENOMEM`); @p t is left to the caller then.
+ */
+SmolRTSP_SrtpTransport *SmolRTSP_SrtpTransport_new(
+    SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The same as #SmolRTSP_SrtpTransport_new, but protects RTCP packets (e.g.,
+ * from #SmolRTSP_RtpTransport_send_sender_report) with SRTCP.
+ */
+SmolRTSP_SrtpTransport *SmolRTSP_SrtpTransport_new_rtcp(
+    SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Authenticates and decrypts an SRTCP packet received from a client in place,
+ * before it is passed to #SmolRTSP_RtpTransport_ingest_rtcp.
+ *
+ * The packet must be protected with the same master key as @p self. Replayed
+ * packets are not detected.
+ *
+ * @param[in] self The transport whose keys protect the packet.
+ * @param[in, out] packet The SRTCP packet, which is shortened to the RTCP
+ * packet on success.
+ *
+ * @pre `self != NULL`
+ * @pre `packet != NULL`
+ *
+ * @return -1 if the packet is malformed or fails authentication (and sets
+ * `errno` to `EBADMSG`), 0 on success.
+ */
+int SmolRTSP_SrtpTransport_unprotect_rtcp(
+    SmolRTSP_SrtpTransport *self, U8Slice99 *packet) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Transport_IFACE for #SmolRTSP_SrtpTransport.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Transport, SmolRTSP_SrtpTransport);
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_SrtpTransport.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_SrtpTransport);
@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @brief A scheduler of the interleaved channels of a TCP connection.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum number of channels of #SmolRTSP_TcpScheduler.
+ */
+#define SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS 8
+
+/**
+ * The default #SmolRTSP_TcpSchedulerConfig.max_filled.
+ */
+#define SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_FILLED (16 * 1024)
+
+/**
+ * The default #SmolRTSP_TcpSchedulerConfig.max_queued.
+ */
+#define SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_QUEUED (1024 * 1024)
+
+/**
+ * The default #SmolRTSP_TcpSchedulerConfig.quantum.
+ */
+#define SMOLRTSP_TCP_SCHEDULER_DEFAULT_QUANTUM 1500
+
+/**
+ * The class of an interleaved channel of #SmolRTSP_TcpScheduler.
+ */
+typedef struct {
+    /**
+     * The priority of the channel: the queued packets of a higher priority are
+     * always written before those of a lower one.
+     */
+    uint8_t priority;
+
+    /**
+     * The share of the connection among the channels of the same priority, in
+     * quanta per round.
+     */
+    uint32_t weight;
+} SmolRTSP_TcpChannelClass;
+
+/**
+ * The configuration of #SmolRTSP_TcpScheduler.
+ */
+typedef struct {
+    /**
+     * The number of bytes in the output buffer of the writer (as reported by
+     * its `filled`) above which packets are held back in the queues of the
+     * scheduler, where they can still be overtaken. This bounds the delay of
+     * a packet of the highest priority behind the others.
+     */
+    size_t max_filled;
+
+    /**
+     * The maximum number of bytes queued on a single channel.
+     */
+    size_t max_queued;
+
+    /**
+     * The number of bytes a channel of weight 1 may write per round of the
+     * channels of its priority.
+     */
+    size_t quantum;
+} SmolRTSP_TcpSchedulerConfig;
+
+/**
+ * Returns the default configuration:
+ * #SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_FILLED,
+ * #SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_QUEUED, and
+ * #SMOLRTSP_TCP_SCHEDULER_DEFAULT_QUANTUM.
+ */
+SmolRTSP_TcpSchedulerConfig
+SmolRTSP_TcpSchedulerConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The statistics of #SmolRTSP_TcpScheduler.
+ */
+typedef struct {
+    /**
+     * The number of packets written at once, without being queued.
+     */
+    uint64_t direct;
+
+    /**
+     * The number of packets queued.
+     */
+    uint64_t queued;
+
+    /**
+     * The number of queued packets written while packets of a lower priority
+     * were queued, i.e., written ahead of them.
+     */
+    uint64_t overtakes;
+
+    /**
+     * The number of packets rejected because their channel queue was full.
+     */
+    uint64_t rejected;
+} SmolRTSP_TcpSchedulerStats;
+
+/**
+ * Schedules the packets of the interleaved channels sharing a TCP connection
+ * (e.g., audio, video, and their RTCP), so that a small audio packet does not
+ * wait behind the whole burst of a video keyframe.
+ *
+ * The transports of the channels (#smolrtsp_transport_tcp_scheduled) write
+ * their packets to the writer directly while its output buffer holds less
+ * than #SmolRTSP_TcpSchedulerConfig.max_filled bytes and nothing is queued.
+ * Otherwise, a packet is copied, with its interleaved header, into the queue
+ * of its channel. #SmolRTSP_TcpScheduler_flush writes the queued packets in
+ * the order of the priorities of their channels and shares the connection
+ * among the channels of the same priority in proportion to their weights
+ * (deficit round robin); the packets of a channel are never reordered.
+ *
+ * A transmission flushes the queues, but a connection that goes idle must be
+ * flushed once its output buffer drains, e.g., from the write callback of the
+ * event loop.
+ *
+ * The scheduler and its transports can be used from several threads; the
+ * writer is locked while it is written to. Drop all the transports before the
+ * scheduler itself.
+ */
+typedef struct SmolRTSP_TcpScheduler SmolRTSP_TcpScheduler;
+
+/**
+ * Creates a scheduler of no channels writing to @p w.
+ *
+ * @pre `w.self && w.vptr`
+ * @pre `config.max_queued > 0`
+ * @pre `config.quantum > 0`
+ *
+ * @return The scheduler, or `NULL` if the allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_TcpScheduler *SmolRTSP_TcpScheduler_new(
+    SmolRTSP_Writer w,
+    SmolRTSP_TcpSchedulerConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sets the class of @p channel_id, adding the channel if necessary.
+ *
+ * A channel added by #smolrtsp_transport_tcp_scheduled has the priority 0 and
+ * the weight 1.
+ *
+ * @pre `self != NULL`
+ * @pre `cls.weight > 0`
+ *
+ * @return 0 on success, or -1 if @p self has
+ * #SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS channels already (and sets `errno` to
+ * `ENOSPC`).
+ */
+int SmolRTSP_TcpScheduler_set_class(
+    SmolRTSP_TcpScheduler *self, uint8_t channel_id,
+    SmolRTSP_TcpChannelClass cls) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the queued packets while the output buffer of the writer holds less
+ * than #SmolRTSP_TcpSchedulerConfig.max_filled bytes.
+ *
+ * @return The number of packets written, or -1 if the writer has failed
+ * before writing any (and sets `errno` appropriately). A packet rejected by
+ * the writer stays queued.
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_TcpScheduler_flush(SmolRTSP_TcpScheduler *self);
+
+/**
+ * Returns the number of bytes queued on all the channels, including the
+ * interleaved headers.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_TcpScheduler_pending(SmolRTSP_TcpScheduler *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_TcpSchedulerStats
+SmolRTSP_TcpScheduler_stats(SmolRTSP_TcpScheduler *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_TcpScheduler.
+ *
+ * The queued packets are discarded; flush them beforehand. The writer is not
+ * dropped.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_TcpScheduler);
+
+/**
+ * Creates a transport of the interleaved channel @p channel_id through
+ * @p scheduler, in place of #smolrtsp_transport_tcp.
+ *
+ * `transmit` writes the packet or queues it as described in
+ * #SmolRTSP_TcpScheduler, and fails with `ENOBUFS` if the queue of the channel
+ * has no room for it; `transmit_batch` does the same for all the packets it
+ * can and then flushes the queues once. `is_full` reports whether the output
+ * buffer of the writer and the queue of the channel hold more than
+ * @p max_buffer bytes together.
+ *
+ * @pre `scheduler != NULL`
+ *
+ * @return The transport, or a transport with `self == NULL` on error (and sets
+ * `errno` appropriately): `ENOSPC` if the channel cannot be added.
+ */
+SmolRTSP_Transport smolrtsp_transport_tcp_scheduled(
+    SmolRTSP_TcpScheduler *scheduler, uint8_t channel_id,
+    size_t max_buffer) SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @brief A hierarchical timer wheel for scheduling stream packets.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <interface99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A receiver of timer expiries.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+#define SmolRTSP_TimerHandler_IFACE                                            \
+                                                                               \
+    /*                                                                         \
+     * Handles the expiry of a timer at the tick @p now.                       \
+     *                                                                         \
+     * @return The number of ticks until the next expiry, or 0 to stop the     \
+     * timer. The next expiry is counted from the scheduled tick rather than   \
+     * from @p now, so that periodic timers do not drift.                      \
+     */                                                                        \
+    vfunc99(uint64_t, on_timer, VSelf99, uint64_t now)
+
+/**
+ * Defines the `SmolRTSP_TimerHandler` interface.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+interface99(SmolRTSP_TimerHandler);
+
+/**
+ * A timer of #SmolRTSP_TimerWheel, typically embedded into a stream.
+ *
+ * All the fields except #handler are private to the wheel.
+ */
+typedef struct SmolRTSP_Timer {
+    /**
+     * The handler invoked on expiry.
+     */
+    SmolRTSP_TimerHandler handler;
+
+    /**
+     * The tick at which the timer expires.
+     */
+    uint64_t expires;
+
+    /**
+     * The level of the wheel holding the timer.
+     */
+    unsigned level;
+
+    /**
+     * The neighbours in the slot list; both are `NULL` while the timer is not
+     * pending.
+     */
+    struct SmolRTSP_Timer *prev, *next;
+} SmolRTSP_Timer;
+
+/**
+ * Creates a timer that is not pending.
+ */
+SmolRTSP_Timer
+SmolRTSP_Timer_new(SmolRTSP_TimerHandler handler) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns whether @p self is scheduled on a wheel.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_Timer_is_pending(const SmolRTSP_Timer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A hierarchical timer wheel (Varghese and Lauck) of four levels of 64 slots.
+ *
+ * Scheduling and cancelling a timer take constant time, and all the timers
+ * expiring at the same tick are fired by a single
+ * #SmolRTSP_TimerWheel_advance, instead of a wakeup and a heap operation per
+ * timer. Timers further than 2^24 ticks away are cascaded down as they come
+ * closer.
+ *
+ * The duration of a tick is up to the caller (e.g., a millisecond). When the
+ * handlers transmit through batching transports, such as
+ * #smolrtsp_transport_uring, all the packets due at a tick leave in one batch
+ * once the caller flushes them after #SmolRTSP_TimerWheel_advance.
+ *
+ * A wheel is not thread-safe; use one per event loop (e.g., per worker of
+ * #SmolRTSP_Server).
+ */
+typedef struct SmolRTSP_TimerWheel SmolRTSP_TimerWheel;
+
+/**
+ * Creates a wheel whose current tick is @p now.
+ *
+ * @return The wheel, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_TimerWheel *
+SmolRTSP_TimerWheel_new(uint64_t now) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Schedules @p timer to expire @p delay ticks after the current tick of
+ * @p self, rescheduling it if it is already pending.
+ *
+ * A zero @p delay is treated as 1, i.e., the timer expires on the next tick.
+ *
+ * @pre `self != NULL`
+ * @pre `timer != NULL`
+ */
+void SmolRTSP_TimerWheel_schedule(
+    SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer, uint64_t delay);
+
+/**
+ * Cancels @p timer if it is pending.
+ *
+ * @pre `self != NULL`
+ * @pre `timer != NULL`
+ */
+void SmolRTSP_TimerWheel_cancel(
+    SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer);
+
+/**
+ * Advances the current tick of @p self to @p now, firing every timer expired
+ * in between in the order of their expiry.
+ *
+ * Handlers can schedule and cancel any timers, including their own.
+ *
+ * @return The number of timers fired.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_TimerWheel_advance(SmolRTSP_TimerWheel *self, uint64_t now);
+
+/**
+ * Returns the current tick of @p self.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t SmolRTSP_TimerWheel_now(const SmolRTSP_TimerWheel *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of pending timers.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_TimerWheel_len(const SmolRTSP_TimerWheel *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_TimerWheel.
+ *
+ * The pending timers are cancelled, but their handlers are not dropped.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_TimerWheel);
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief A scheduler of the tracks of a session on a shared tick.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/timer_wheel.h>
+#include <smolrtsp/uring.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The maximum number of tracks of #SmolRTSP_TrackScheduler.
+ */
+#define SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS 8
+
+/**
+ * The configuration of #SmolRTSP_TrackScheduler.
+ */
+typedef struct {
+    /**
+     * The number of ticks by which a track may be run ahead of time, so that
+     * it is run together with the tracks due before it.
+     */
+    uint64_t slack;
+
+    /**
+     * The ring to submit once after the tracks due at a tick have been run, so
+     * that all their packets leave in one batch, or `NULL` to submit nothing.
+     * Not owned.
+     */
+    SmolRTSP_Uring *ring;
+} SmolRTSP_TrackSchedulerConfig;
+
+/**
+ * Returns the default configuration: a slack of 0 ticks, without a ring.
+ */
+SmolRTSP_TrackSchedulerConfig
+SmolRTSP_TrackSchedulerConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The statistics of #SmolRTSP_TrackScheduler.
+ */
+typedef struct {
+    /**
+     * The number of times the scheduler has been fired by its wheel.
+     */
+    uint64_t wakeups;
+
+    /**
+     * The number of times a track has been run.
+     */
+    uint64_t runs;
+} SmolRTSP_TrackSchedulerStats;
+
+/**
+ * Runs the tracks of a session (e.g., audio every 20 ms and video every 40
+ * ms) from a single timer of #SmolRTSP_TimerWheel.
+ *
+ * Every time the timer fires, all the tracks due within the slack of the
+ * current tick run one after another, and the ring (if any) is submitted
+ * once, instead of a wakeup and a submission per track. A track is a
+ * #SmolRTSP_TimerHandler: it is run on its due tick and tells the number of
+ * ticks until the next one, counted from the due tick, so that running it
+ * ahead of time does not make it drift.
+ *
+ * A scheduler must be used from the thread of its wheel.
+ */
+typedef struct SmolRTSP_TrackScheduler SmolRTSP_TrackScheduler;
+
+/**
+ * Creates a scheduler of no tracks on @p wheel.
+ *
+ * @pre `wheel != NULL`
+ *
+ * @return The scheduler, or `NULL` if the allocation fails (and sets `errno`
+ * to `ENOMEM`).
+ */
+SmolRTSP_TrackScheduler *SmolRTSP_TrackScheduler_new(
+    SmolRTSP_TimerWheel *wheel,
+    SmolRTSP_TrackSchedulerConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Adds @p track to @p self, due @p delay ticks after the current tick of the
+ * wheel.
+ *
+ * The track is removed once it returns 0. It is not owned by @p self and must
+ * outlive it or be removed first.
+ *
+ * @pre `self != NULL`
+ * @pre @p self is not running its tracks (i.e., a track does not add another
+ * one).
+ *
+ * @return 0 on success, or -1 if @p self has
+ * #SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS tracks already (and sets `errno` to
+ * `ENOSPC`).
+ */
+int SmolRTSP_TrackScheduler_add(
+    SmolRTSP_TrackScheduler *self, SmolRTSP_TimerHandler track,
+    uint64_t delay) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of tracks of @p self.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_TrackScheduler_len(const SmolRTSP_TrackScheduler *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_TrackSchedulerStats SmolRTSP_TrackScheduler_stats(
+    const SmolRTSP_TrackScheduler *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_TrackScheduler.
+ *
+ * The timer of @p self is cancelled, but the tracks are not dropped.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_TrackScheduler);
@@ -7,12 +7,102 @@
 
 #include <smolrtsp/droppable.h>
 #include <smolrtsp/io_vec.h>
+#include <smolrtsp/latency_histogram.h>
 #include <smolrtsp/writer.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <interface99.h>
 
 #include <smolrtsp/priv/compiler_attrs.h>
 
+/**
+ * The counters of a transport, as returned by its `stats` method.
+ *
+ * The counters are only incremented, so that rates can be derived from two
+ * snapshots (e.g., by Prometheus).
+ */
+typedef struct {
+    /**
+     * The number of packets transmitted.
+     */
+    uint64_t packets;
+
+    /**
+     * The number of bytes transmitted, excluding the headers added by the
+     * transport itself (such as the interleaved header of TCP).
+     */
+    uint64_t bytes;
+
+    /**
+     * The number of times `is_full` has returned `true`.
+     */
+    uint64_t full;
+
+    /**
+     * The number of failed transmissions with `EAGAIN` or `EWOULDBLOCK`.
+     */
+    uint64_t errors_eagain;
+
+    /**
+     * The number of failed transmissions with `ENOBUFS`.
+     */
+    uint64_t errors_enobufs;
+
+    /**
+     * The number of failed transmissions with `EMSGSIZE`.
+     */
+    uint64_t errors_emsgsize;
+
+    /**
+     * The number of failed transmissions with `ECONNREFUSED`, which a
+     * connected UDP socket reports when the peer is gone.
+     */
+    uint64_t errors_connrefused;
+
+    /**
+     * The number of failed transmissions with any other error.
+     */
+    uint64_t errors_other;
+} SmolRTSP_TransportStats;
+
+/**
+ * Counts @p packets_count packets of @p bytes bytes in total as transmitted.
+ *
+ * This function and the ones below update the counters with relaxed atomics,
+ * so that #SmolRTSP_TransportStats_load can be called from any thread at any
+ * time. Use them to implement `stats` for your own transports.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_TransportStats_record_sent(
+    SmolRTSP_TransportStats *self, uint64_t packets_count, uint64_t bytes);
+
+/**
+ * Counts a transmission that has failed with @p error.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_TransportStats_record_error(
+    SmolRTSP_TransportStats *self, int error);
+
+/**
+ * Counts an `is_full` call that has returned `true`.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_TransportStats_record_full(SmolRTSP_TransportStats *self);
+
+/**
+ * Takes a snapshot of the counters of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_TransportStats SmolRTSP_TransportStats_load(
+    const SmolRTSP_TransportStats *self) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * A transport-level RTSP data transmitter.
  *
@@ -28,7 +118,30 @@
      * on success.                                                             \
      */                                                                        \
     vfunc99(int, transmit, VSelf99, SmolRTSP_IoVecSlice bufs)                  \
-    vfunc99(bool, is_full, VSelf99)
+                                                                               \
+    /*                                                                         \
+     * Transmits each packet of @p batch as if by `transmit`, but possibly     \
+     * within a single system call.                                            \
+     *                                                                         \
+     * @return The number of packets transmitted, which can be less than       \
+     * `batch.len`, or -1 if no packet was transmitted (and sets `errno`       \
+     * appropriately).                                                         \
+     */                                                                        \
+    vfuncDefault99(                                                            \
+        ssize_t, transmit_batch, VSelf99, SmolRTSP_IoVecBatch batch)           \
+    vfunc99(bool, is_full, VSelf99)                                            \
+                                                                               \
+    /*                                                                         \
+     * Returns the maximum size of a packet that reaches the peer without      \
+     * fragmentation, or 0 if there is no such limit (e.g., for TCP).          \
+     */                                                                        \
+    vfuncDefault99(size_t, max_packet_size, VSelf99)                           \
+                                                                               \
+    /*                                                                         \
+     * Returns a snapshot of the counters of the transport. It can be called   \
+     * from any thread.                                                        \
+     */                                                                        \
+    vfuncDefault99(SmolRTSP_TransportStats, stats, VSelf99)
 
 /**
  * The superinterfaces of #SmolRTSP_Transport_IFACE.
@@ -43,9 +156,52 @@
  */
 interface99(SmolRTSP_Transport);
 
+/**
+ * The default implementation of `transmit_batch`.
+ *
+ * Returns -1 and sets `errno` to `ENOSYS`. Use #smolrtsp_transmit_batch to
+ * fall back to `transmit` for such transports.
+ */
+ssize_t SmolRTSP_Transport_transmit_batch(VSelf99, SmolRTSP_IoVecBatch batch);
+
+/**
+ * The default implementation of `max_packet_size`.
+ *
+ * Returns 0.
+ */
+size_t SmolRTSP_Transport_max_packet_size(VSelf99);
+
+/**
+ * The default implementation of `stats`.
+ *
+ * Returns all the counters set to 0.
+ */
+SmolRTSP_TransportStats SmolRTSP_Transport_stats(VSelf99);
+
+/**
+ * Transmits all the packets of @p batch through @p t.
+ *
+ * `transmit_batch` is invoked until the whole batch is transmitted; if @p t
+ * does not override `transmit_batch`, every packet is transmitted via
+ * `transmit`.
+ *
+ * @param[in] t The transport to transmit data through.
+ * @param[in] batch The packets to transmit.
+ *
+ * @pre `t.self && t.vptr`
+ *
+ * @return The number of packets transmitted. If it is less than `batch.len`,
+ * an I/O error has occurred and `errno` is set appropriately.
+ */
+size_t smolrtsp_transmit_batch(SmolRTSP_Transport t, SmolRTSP_IoVecBatch batch)
+    SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Creates a new TCP transport.
  *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
  * @param[in] w The writer to be provided with data.
  * @param[in] channel_id A one-byte channel identifier, as defined in
  * <https://datatracker.ietf.org/doc/html/rfc2326#section-10.12>.
@@ -57,25 +213,302 @@ SmolRTSP_Transport smolrtsp_transport_tcp(
     size_t max_buffer) SMOLRTSP_PRIV_MUST_USE;
 
 /**
- * Creates a new UDP transport.
+ * The state of zero-copy transmissions (`MSG_ZEROCOPY`) on a UDP socket.
+ *
+ * It is owned by the caller and updated by the UDP transport (`sent`) and
+ * #smolrtsp_zerocopy_reap (`completed`, `copied`). To find out when the
+ * buffers passed to the transport can be reused, remember the value of `sent`
+ * after transmitting them and wait until #SmolRTSP_ZeroCopyState_is_released
+ * returns `true` for this value.
+ */
+typedef struct {
+    /**
+     * The number of zero-copy transmissions issued so far.
+     */
+    uint32_t sent;
+
+    /**
+     * The number of zero-copy transmissions whose buffers have been released
+     * by the kernel.
+     */
+    uint32_t completed;
+
+    /**
+     * The number of completed transmissions for which the kernel had to copy
+     * the data after all (e.g., on the loopback interface).
+     */
+    uint32_t copied;
+} SmolRTSP_ZeroCopyState;
+
+/**
+ * Tests whether all zero-copy transmissions up to @p mark (a previously
+ * observed value of `sent`) have completed.
+ */
+bool SmolRTSP_ZeroCopyState_is_released(
+    SmolRTSP_ZeroCopyState self, uint32_t mark) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Reads zero-copy completion notifications from the error queue of @p fd.
+ *
+ * This function does not block. It discards the TX timestamps queued with the
+ * notifications, so use #SmolRTSP_TxTimestamps_reap instead if the UDP
+ * transport has `tx_timestamps`.
+ *
+ * @param[in] fd The socket used by the UDP transport.
+ * @param[out] state The zero-copy state to update.
+ *
+ * @pre `state != NULL`
+ *
+ * @return The number of notifications read or -1 on error (and sets `errno`
+ * appropriately).
+ */
+int smolrtsp_zerocopy_reap(int fd, SmolRTSP_ZeroCopyState *state)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The default value for #SmolRTSP_TxTimestampsConfig.capacity.
+ */
+#define SMOLRTSP_TX_TIMESTAMPS_DEFAULT_CAPACITY 1024
+
+/**
+ * The configuration structure for #SmolRTSP_TxTimestamps.
+ */
+typedef struct {
+    /**
+     * The number of the last transmissions whose send times are kept until
+     * their timestamps are reaped, a power of two.
+     */
+    size_t capacity;
+
+    /**
+     * Records the time from handing a datagram to the kernel until the driver
+     * passes it to the device (the software TX timestamp), that is, the
+     * queueing in the qdisc and the driver; if not `NULL`.
+     */
+    SmolRTSP_LatencyHistogram *software;
+
+    /**
+     * Records the time until the device puts the datagram on the wire (the
+     * hardware TX timestamp); if not `NULL`.
+     *
+     * The device must have hardware timestamping enabled (`SIOCSHWTSTAMP`,
+     * e.g., by `hwstamp_ctl`), and its clock must be synchronized to
+     * `CLOCK_REALTIME` (e.g., by `phc2sys`).
+     */
+    SmolRTSP_LatencyHistogram *hardware;
+} SmolRTSP_TxTimestampsConfig;
+
+/**
+ * Returns the default #SmolRTSP_TxTimestampsConfig.
+ *
+ * The default values are:
+ *
+ *  - `capacity` is #SMOLRTSP_TX_TIMESTAMPS_DEFAULT_CAPACITY.
+ *  - `software` is `NULL`.
+ *  - `hardware` is `NULL`.
+ */
+SmolRTSP_TxTimestampsConfig
+SmolRTSP_TxTimestampsConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The counters of #SmolRTSP_TxTimestamps.
+ */
+typedef struct {
+    /**
+     * The number of software TX timestamps reaped.
+     */
+    uint64_t software;
+
+    /**
+     * The number of hardware TX timestamps reaped.
+     */
+    uint64_t hardware;
+
+    /**
+     * The number of timestamps of transmissions no longer (or never) kept,
+     * e.g., because they were reaped too late.
+     */
+    uint64_t unmatched;
+} SmolRTSP_TxTimestampsStats;
+
+/**
+ * The kernel TX timestamps (`SO_TIMESTAMPING`) of the datagrams sent by a UDP
+ * transport.
+ *
+ * The transport remembers when it hands every datagram to the kernel.
+ * #SmolRTSP_TxTimestamps_reap then reads the timestamps back from the error
+ * queue of the socket in batches, matches them with the send times by the
+ * kernel-assigned transmission IDs (`SOF_TIMESTAMPING_OPT_ID`), and records
+ * the delays into the histograms of the configuration. Added to the latency
+ * of #SmolRTSP_NalTransportConfig.latency, they give the NAL-unit-to-wire
+ * latency.
+ *
+ * Nothing else may send through the socket, or the IDs would not match. The
+ * object is not thread-safe: reap it from the thread that transmits.
+ */
+typedef struct SmolRTSP_TxTimestamps SmolRTSP_TxTimestamps;
+
+/**
+ * Creates the TX timestamps state with @p config.
+ *
+ * @return The state, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ *
+ * @pre `config.capacity` is a power of two.
+ */
+SmolRTSP_TxTimestamps *SmolRTSP_TxTimestamps_new(
+    SmolRTSP_TxTimestampsConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Reads the TX timestamps from the error queue of @p fd and records the
+ * delays.
+ *
+ * This function does not block.
+ *
+ * @param[out] self The TX timestamps state of the UDP transport of @p fd.
+ * @param[in] fd The socket used by the UDP transport.
+ * @param[out] zerocopy_state The zero-copy state to update with the
+ * zero-copy notifications of the same queue (see #smolrtsp_zerocopy_reap), or
+ * `NULL`.
+ *
+ * @return The number of notifications read or -1 on error (and sets `errno`
+ * appropriately).
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_TxTimestamps_reap(
+    SmolRTSP_TxTimestamps *self, int fd,
+    SmolRTSP_ZeroCopyState *zerocopy_state) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the counters of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_TxTimestampsStats SmolRTSP_TxTimestamps_stats(
+    const SmolRTSP_TxTimestamps *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_TxTimestamps.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_TxTimestamps);
+
+/**
+ * The configuration structure for #smolrtsp_transport_udp_with_config.
+ */
+typedef struct {
+    /**
+     * Whether to use UDP generic segmentation offload (`UDP_SEGMENT`) for
+     * batches of equally sized packets.
+     *
+     * In this mode, `transmit_batch` passes a train of packets (all of the
+     * same size except possibly the last one, as is the case with FU
+     * fragments) to the kernel as a single super-buffer, which is then split
+     * by the kernel or the NIC. If the socket does not support GSO, the mode
+     * is disabled and `sendmmsg` is used instead. A super-buffer rejected
+     * with `EINVAL`, as when its segments exceed a lowered path MTU, does not
+     * disable the mode: `max_packet_size` is refreshed, and the batch fails
+     * with `EMSGSIZE` if the segments no longer fit, or is sent again
+     * otherwise (through `sendmmsg` if GSO fails again).
+     */
+    bool gso;
+
+    /**
+     * The minimum size of a packet to be sent with `MSG_ZEROCOPY`, or 0 to
+     * disable zero-copy transmission.
+     *
+     * Zero copy pays off only for large payloads because of the cost of page
+     * pinning and completion notifications. If `SO_ZEROCOPY` cannot be
+     * enabled on the socket, packets are copied as usual.
+     */
+    size_t zerocopy_threshold;
+
+    /**
+     * The zero-copy state to be updated on each zero-copy transmission.
+     * Must be non-null if `zerocopy_threshold` is non-zero.
+     */
+    SmolRTSP_ZeroCopyState *zerocopy_state;
+
+    /**
+     * The state to record the send times of the datagrams into, to enable TX
+     * timestamping (software and, where the device supports it, hardware);
+     * `NULL` to disable it.
+     *
+     * If `SO_TIMESTAMPING` cannot be enabled on the socket, nothing is
+     * recorded. The state is not owned by the transport.
+     */
+    SmolRTSP_TxTimestamps *tx_timestamps;
+} SmolRTSP_UdpTransportConfig;
+
+/**
+ * Returns the default #SmolRTSP_UdpTransportConfig.
+ *
+ * The default values are:
+ *
+ *  - `gso` is `false`.
+ *  - `zerocopy_threshold` is 0.
+ *  - `zerocopy_state` is `NULL`.
+ *  - `tx_timestamps` is `NULL`.
+ */
+SmolRTSP_UdpTransportConfig
+SmolRTSP_UdpTransportConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a new UDP transport with the default configuration.
+ *
+ * For a connected IP socket, `max_packet_size` is derived from the path MTU
+ * (`IP_MTU`/`IPV6_MTU`) minus the IP and UDP headers. On `EMSGSIZE`, the
+ * datagram is not retransmitted: the path MTU is queried again, so that the
+ * caller can shrink its packets (as #SmolRTSP_NalTransport does).
  *
  * Strictly speaking, it can handle any datagram-oriented protocol, not
  * necessarily UDP. E.g., you may use a `SOCK_SEQPACKET` socket for local
  * communication.
  *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
  * @param[in] fd The socket file descriptor to be provided with data.
  *
  * @pre `fd >= 0`
  */
 SmolRTSP_Transport smolrtsp_transport_udp(int fd) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Creates a new UDP transport with a custom configuration.
+ *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
+ * @param[in] fd The socket file descriptor to be provided with data.
+ * @param[in] config The transmission configuration structure.
+ *
+ * @pre `fd >= 0`
+ * @pre `config.zerocopy_threshold == 0 || config.zerocopy_state != NULL`
+ */
+SmolRTSP_Transport smolrtsp_transport_udp_with_config(
+    int fd, SmolRTSP_UdpTransportConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Tests whether the socket @p fd supports UDP generic segmentation offload.
+ *
+ * @return `true` if the `UDP_SEGMENT` socket option is available for @p fd,
+ * `false` otherwise.
+ */
+bool smolrtsp_udp_gso_supported(int fd) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Creates a new datagram socket suitable for #smolrtsp_transport_udp.
  *
  * The algorithm is:
  *  1. Create a socket using `socket(af, SOCK_DGRAM, 0)`.
  *  2. Connect this socket to @p addr with @p port.
- *  3. Set the `IP_PMTUDISC_WANT` option to allow IP fragmentation.
+ *  3. Set `IP_MTU_DISCOVER` (`IPV6_MTU_DISCOVER`) to `IP_PMTUDISC_DO`
+ * (`IPV6_PMTUDISC_DO`), so that the kernel performs path MTU discovery and
+ * reports oversized datagrams with `EMSGSIZE` instead of fragmenting them.
  *
  * @param[in] af The socket namespace. Can be `AF_INET` or `AF_INET6`; if none
  * of them, returns -1 and sets `errno` to `EAFNOSUPPORT`.
@@ -266,3 +266,72 @@ bool SmolRTSP_Header_eq(
  */
 #define SMOLRTSP_HEADER_WWW_AUTHENTICATE                                       \
     (CharSlice99_from_str("WWW-Authenticate"))
+
+/**
+ * An identifier of a well-known header key.
+ *
+ * Each one corresponds to the `SMOLRTSP_HEADER_*` macro of the same name.
+ */
+typedef enum {
+    /**
+     * A key that is not among the ones below.
+     */
+    SmolRTSP_HeaderId_Unknown,
+
+    SmolRTSP_HeaderId_Accept,
+    SmolRTSP_HeaderId_AcceptEncoding,
+    SmolRTSP_HeaderId_AcceptLanguage,
+    SmolRTSP_HeaderId_Allow,
+    SmolRTSP_HeaderId_Authorization,
+    SmolRTSP_HeaderId_Bandwidth,
+    SmolRTSP_HeaderId_Blocksize,
+    SmolRTSP_HeaderId_CacheControl,
+    SmolRTSP_HeaderId_Conference,
+    SmolRTSP_HeaderId_Connection,
+    SmolRTSP_HeaderId_ContentBase,
+    SmolRTSP_HeaderId_ContentEncoding,
+    SmolRTSP_HeaderId_ContentLanguage,
+    SmolRTSP_HeaderId_ContentLength,
+    SmolRTSP_HeaderId_ContentLocation,
+    SmolRTSP_HeaderId_ContentType,
+    SmolRTSP_HeaderId_CSeq,
+    SmolRTSP_HeaderId_Date,
+    SmolRTSP_HeaderId_Expires,
+    SmolRTSP_HeaderId_From,
+    SmolRTSP_HeaderId_IfModifiedSince,
+    SmolRTSP_HeaderId_LastModified,
+    SmolRTSP_HeaderId_ProxyAuthenticate,
+    SmolRTSP_HeaderId_ProxyRequire,
+    SmolRTSP_HeaderId_Public,
+    SmolRTSP_HeaderId_Range,
+    SmolRTSP_HeaderId_Referer,
+    SmolRTSP_HeaderId_Require,
+    SmolRTSP_HeaderId_RetryAfter,
+    SmolRTSP_HeaderId_RtpInfo,
+    SmolRTSP_HeaderId_Scale,
+    SmolRTSP_HeaderId_Session,
+    SmolRTSP_HeaderId_Server,
+    SmolRTSP_HeaderId_Speed,
+    SmolRTSP_HeaderId_Transport,
+    SmolRTSP_HeaderId_Unsupported,
+    SmolRTSP_HeaderId_UserAgent,
+    SmolRTSP_HeaderId_Via,
+    SmolRTSP_HeaderId_WwwAuthenticate,
+} SmolRTSP_HeaderId;
+
+/**
+ * The number of #SmolRTSP_HeaderId values, including
+ * #SmolRTSP_HeaderId_Unknown.
+ */
+#define SMOLRTSP_HEADER_ID_COUNT (SmolRTSP_HeaderId_WwwAuthenticate + 1)
+
+/**
+ * Identifies @p key, ignoring the case of ASCII letters.
+ *
+ * The lookup compares @p key with at most a few candidates of the same length
+ * instead of all the well-known keys.
+ *
+ * @return The identifier of @p key or #SmolRTSP_HeaderId_Unknown.
+ */
+SmolRTSP_HeaderId
+SmolRTSP_HeaderId_from_key(CharSlice99 key) SMOLRTSP_PRIV_MUST_USE;
@@ -11,6 +11,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <unistd.h>
@@ -19,6 +20,9 @@
 
 /**
  * Creates new #SmolRTSP_HeaderMap from an array expression of #SmolRTSP_Header.
+ *
+ * The resulting map has no #SmolRTSP_HeaderMap.index, so it is searched
+ * linearly.
  */
 #define SmolRTSP_HeaderMap_from_array(...)                                     \
     ((SmolRTSP_HeaderMap){                                                     \
@@ -26,11 +30,24 @@
         .len = SLICE99_ARRAY_LEN((SmolRTSP_Header[])__VA_ARGS__),              \
     })
 
+#ifndef SMOLRTSP_HEADER_MAP_CAPACITY
+
 /**
  * The maximum number of headers in #SmolRTSP_HeaderMap.headers.
+ *
+ * Every #SmolRTSP_Request and #SmolRTSP_Response embeds this many headers,
+ * 32 bytes each on 64-bit systems. Define it (e.g., with the
+ * `SMOLRTSP_HEADER_MAP_CAPACITY` CMake option) to a lower value to shrink
+ * them; the library and its users must agree on the value.
  */
 #define SMOLRTSP_HEADER_MAP_CAPACITY 32
 
+#endif
+
+#if SMOLRTSP_HEADER_MAP_CAPACITY < 1 || SMOLRTSP_HEADER_MAP_CAPACITY > 255
+#error SMOLRTSP_HEADER_MAP_CAPACITY must be within [1; 255]
+#endif
+
 /**
  * An RTSP header map.
  */
@@ -44,6 +61,19 @@ typedef struct {
      * The count of elements currently in #headers.
      */
     size_t len;
+
+    /**
+     * For each #SmolRTSP_HeaderId, the position of its first header within
+     * #headers plus one, or zero if there is none. Valid only if #indexed.
+     */
+    uint8_t index[SMOLRTSP_HEADER_ID_COUNT];
+
+    /**
+     * Whether #index is maintained, which is the case for the maps created by
+     * #SmolRTSP_HeaderMap_empty and filled by #SmolRTSP_HeaderMap_append or
+     * #SmolRTSP_HeaderMap_parse.
+     */
+    bool indexed;
 } SmolRTSP_HeaderMap;
 
 /**
@@ -51,6 +81,17 @@ typedef struct {
  */
 SmolRTSP_HeaderMap SmolRTSP_HeaderMap_empty(void) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Makes @p self empty in place.
+ *
+ * Unlike assigning #SmolRTSP_HeaderMap_empty, this function does not touch
+ * #SmolRTSP_HeaderMap.headers, so it costs the same regardless of
+ * #SMOLRTSP_HEADER_MAP_CAPACITY.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_HeaderMap_clear(SmolRTSP_HeaderMap *self);
+
 /**
  * Finds a value associated with @p key within @p self.
  *
@@ -58,6 +99,10 @@ SmolRTSP_HeaderMap SmolRTSP_HeaderMap_empty(void) SMOLRTSP_PRIV_MUST_USE;
  * this key (no copying occurs) and returns `true`. Otherwise, returns `false`
  * and @p value remains unchanged.
  *
+ * Keys are compared ignoring the case of ASCII letters, as required by RFC
+ * 2326. A well-known key is looked up in #SmolRTSP_HeaderMap.index in
+ * constant time.
+ *
  * @param[in] self The header map to be searched for @p key.
  * @param[in] key The key to be searched in @p self.
  * @param[out] value The header value to be assigned, if found. If `NULL`, no
@@ -69,6 +114,16 @@ bool SmolRTSP_HeaderMap_find(
     const SmolRTSP_HeaderMap *restrict self, CharSlice99 key,
     CharSlice99 *restrict value) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * The same as #SmolRTSP_HeaderMap_find but for an already identified key.
+ *
+ * @pre `self != NULL`
+ * @pre `id != SmolRTSP_HeaderId_Unknown`
+ */
+bool SmolRTSP_HeaderMap_find_id(
+    const SmolRTSP_HeaderMap *restrict self, SmolRTSP_HeaderId id,
+    CharSlice99 *restrict value) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Returns whether @p key is present in @p self.
  *
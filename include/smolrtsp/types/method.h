@@ -89,3 +89,36 @@ bool SmolRTSP_Method_eq(
  * `RECORD`.
  */
 #define SMOLRTSP_METHOD_RECORD (CharSlice99_from_str("RECORD"))
+
+/**
+ * An identifier of a method defined by RFC 2326.
+ */
+typedef enum {
+    /**
+     * A method that is not among the ones below.
+     */
+    SmolRTSP_MethodId_Unknown,
+
+    SmolRTSP_MethodId_Options,
+    SmolRTSP_MethodId_Describe,
+    SmolRTSP_MethodId_Announce,
+    SmolRTSP_MethodId_Setup,
+    SmolRTSP_MethodId_Play,
+    SmolRTSP_MethodId_Pause,
+    SmolRTSP_MethodId_Teardown,
+    SmolRTSP_MethodId_GetParameter,
+    SmolRTSP_MethodId_SetParameter,
+    SmolRTSP_MethodId_Redirect,
+    SmolRTSP_MethodId_Record,
+} SmolRTSP_MethodId;
+
+/**
+ * Identifies @p self (case-sensitively, as required by RFC 2326).
+ *
+ * The length and the first letter of a method select a single candidate,
+ * which is then compared as a whole.
+ *
+ * @return The identifier of @p self or #SmolRTSP_MethodId_Unknown.
+ */
+SmolRTSP_MethodId
+SmolRTSP_MethodId_from_method(SmolRTSP_Method self) SMOLRTSP_PRIV_MUST_USE;
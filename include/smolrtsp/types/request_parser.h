@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief An incremental RTSP request parser.
+ */
+
+#pragma once
+
+#include <smolrtsp/priv/compiler_attrs.h>
+#include <smolrtsp/types/error.h>
+#include <smolrtsp/types/request.h>
+
+#include <stddef.h>
+
+#include <slice99.h>
+
+/**
+ * The part of a request that #SmolRTSP_RequestParser expects next.
+ */
+typedef enum {
+    /**
+     * Interleaved binary data (`$`) preceding the request, or the request
+     * line.
+     */
+    SmolRTSP_RequestParserSection_StartLine,
+
+    /**
+     * The headers.
+     */
+    SmolRTSP_RequestParserSection_Headers,
+
+    /**
+     * The message body.
+     */
+    SmolRTSP_RequestParserSection_Body,
+
+    /**
+     * The request has been parsed.
+     */
+    SmolRTSP_RequestParserSection_Done,
+} SmolRTSP_RequestParserSection;
+
+/**
+ * A request parser that continues from where it stopped on incomplete input.
+ *
+ * #SmolRTSP_Request_parse starts from scratch on every call, so a request
+ * arriving in many small segments is parsed over and over again. This parser
+ * remembers the completed parts instead, and it looks for a line terminator
+ * only in the bytes received since the previous call, so the total cost stays
+ * linear in the size of the request.
+ *
+ * A line is handed to the underlying parsers only when it is complete, so
+ * malformed input is reported once its line terminator arrives.
+ */
+typedef struct {
+    /**
+     * The part expected next.
+     */
+    SmolRTSP_RequestParserSection section;
+
+    /**
+     * The number of bytes of the completed parts.
+     */
+    size_t offset;
+
+    /**
+     * The number of bytes after #offset already known to contain no line
+     * terminator.
+     */
+    size_t scanned;
+
+    /**
+     * The value of `Content-Length` (zero if absent).
+     */
+    size_t content_length;
+} SmolRTSP_RequestParser;
+
+/**
+ * Returns a parser at the beginning of a request.
+ */
+SmolRTSP_RequestParser SmolRTSP_RequestParser_new(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Continues parsing @p input to @p request.
+ *
+ * @param[in] self The parser.
+ * @param[out] request The request being parsed, initialized with
+ * #SmolRTSP_Request_uninit. It must be the same object during the whole
+ * request.
+ * @param[in] input All the data received so far. Each call must pass the same
+ * buffer as before, possibly extended with new data, because @p request
+ * refers to it.
+ *
+ * @return The same as #SmolRTSP_Request_parse. After a complete result or a
+ * failure, reset @p self with #SmolRTSP_RequestParser_new before parsing the
+ * next request.
+ *
+ * @pre `self != NULL`
+ * @pre `request != NULL`
+ */
+SmolRTSP_ParseResult SmolRTSP_RequestParser_parse(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input) SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,390 @@
+/**
+ * @file
+ * @brief <a href="https://datatracker.ietf.org/doc/html/rfc3550#section-6">RFC
+ * 3550</a>-compliant RTCP sender and receiver reports.
+ */
+
+#pragma once
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+/**
+ * The RTCP packet type of a sender report (SR).
+ */
+#define SMOLRTSP_RTCP_SR 200
+
+/**
+ * The RTCP packet type of a receiver report (RR).
+ */
+#define SMOLRTSP_RTCP_RR 201
+
+/**
+ * The RTCP packet type of a source description (SDES).
+ */
+#define SMOLRTSP_RTCP_SDES 202
+
+/**
+ * The RTCP packet type of a goodbye (BYE).
+ */
+#define SMOLRTSP_RTCP_BYE 203
+
+/**
+ * The RTCP packet type of a transport-layer feedback message (RTPFB, RFC
+ * 4585).
+ */
+#define SMOLRTSP_RTCP_RTPFB 205
+
+/**
+ * The RTCP packet type of a payload-specific feedback message (PSFB, RFC
+ * 4585).
+ */
+#define SMOLRTSP_RTCP_PSFB 206
+
+/**
+ * The feedback message type (#SmolRTSP_RtcpPacket.count) of a generic NACK
+ * RTPFB packet.
+ */
+#define SMOLRTSP_RTCP_FMT_NACK 1
+
+/**
+ * The feedback message type of a transport-wide congestion control feedback
+ * RTPFB packet (draft-holmer-rmcat-transport-wide-cc-extensions-01).
+ */
+#define SMOLRTSP_RTCP_FMT_TRANSPORT_CC 15
+
+/**
+ * The feedback message type of a Picture Loss Indication (PLI) PSFB packet.
+ */
+#define SMOLRTSP_RTCP_FMT_PLI 1
+
+/**
+ * The feedback message type of a Full Intra Request (FIR, RFC 5104) PSFB
+ * packet.
+ */
+#define SMOLRTSP_RTCP_FMT_FIR 4
+
+/**
+ * The size of a serialized report block.
+ */
+#define SMOLRTSP_RTCP_REPORT_BLOCK_SIZE 24
+
+/**
+ * The size of a serialized sender report without report blocks.
+ */
+#define SMOLRTSP_RTCP_SENDER_REPORT_SIZE 28
+
+/**
+ * A reception report block of an SR or RR packet.
+ *
+ * Unlike #SmolRTSP_RtpHeader, all numerical fields are in host byte order.
+ */
+typedef struct {
+    /**
+     * The SSRC of the source this block is about.
+     */
+    uint32_t ssrc;
+
+    /**
+     * The fraction of packets lost since the previous report, as a fixed point
+     * number with the binary point at the left edge (i.e., divided by 256).
+     */
+    uint8_t fraction_lost;
+
+    /**
+     * The total number of packets lost (24 bits, signed: duplicates may make it
+     * negative).
+     */
+    int32_t cumulative_lost;
+
+    /**
+     * The highest sequence number received, extended with the count of its
+     * cycles in the upper 16 bits.
+     */
+    uint32_t extended_highest_seq_num;
+
+    /**
+     * The interarrival jitter, in RTP timestamp units.
+     */
+    uint32_t jitter;
+
+    /**
+     * The middle 32 bits of the NTP timestamp of the last SR received from the
+     * source, or 0 if none.
+     */
+    uint32_t last_sr;
+
+    /**
+     * The delay between receiving the last SR and sending this block, in units
+     * of 1/65536 seconds, or 0 if no SR has been received.
+     */
+    uint32_t delay_since_last_sr;
+} SmolRTSP_RtcpReportBlock;
+
+/**
+ * The sender report of an SR packet.
+ *
+ * All numerical fields are in host byte order.
+ */
+typedef struct {
+    /**
+     * The SSRC of the sender.
+     */
+    uint32_t ssrc;
+
+    /**
+     * The 64-bit NTP timestamp (see #SmolRTSP_RtpClock_ntp_timestamp).
+     */
+    uint64_t ntp_timestamp;
+
+    /**
+     * The RTP timestamp of the same instant as #ntp_timestamp.
+     */
+    uint32_t rtp_timestamp;
+
+    /**
+     * The number of RTP packets sent (modulo 2^32).
+     */
+    uint32_t packet_count;
+
+    /**
+     * The number of RTP payload octets sent (modulo 2^32).
+     */
+    uint32_t octet_count;
+} SmolRTSP_RtcpSenderReport;
+
+/**
+ * A generic NACK of an RTPFB packet: a lost packet and a bitmask of the
+ * following lost ones.
+ *
+ * All numerical fields are in host byte order.
+ */
+typedef struct {
+    /**
+     * The sequence number of the lost packet (PID).
+     */
+    uint16_t seq_num;
+
+    /**
+     * The bitmask of the following lost packets (BLP): bit `i` (from the
+     * least significant one) stands for `seq_num + i + 1`.
+     */
+    uint16_t bitmask;
+} SmolRTSP_RtcpNack;
+
+/**
+ * The header of a transport-wide congestion control feedback RTPFB packet.
+ *
+ * All numerical fields are in host byte order.
+ */
+typedef struct {
+    /**
+     * The transport-wide sequence number of the first packet reported.
+     */
+    uint16_t base_seq_num;
+
+    /**
+     * The number of packets reported, received or not, starting from
+     * #base_seq_num.
+     */
+    uint16_t status_count;
+
+    /**
+     * The reference time of the arrival times in microseconds: the 24-bit
+     * reference time in multiples of 64 ms. Only the differences between the
+     * arrival times are meaningful.
+     */
+    int64_t reference_time_us;
+
+    /**
+     * The sequence number of this feedback packet (modulo 256).
+     */
+    uint8_t fb_pkt_count;
+} SmolRTSP_RtcpTransportFeedback;
+
+/**
+ * The status of a packet reported by a transport-wide congestion control
+ * feedback packet.
+ */
+typedef struct {
+    /**
+     * The transport-wide sequence number of the packet.
+     */
+    uint16_t seq_num;
+
+    /**
+     * Whether the packet has been received.
+     */
+    bool received;
+
+    /**
+     * The arrival time of the packet, in the time base of
+     * #SmolRTSP_RtcpTransportFeedback.reference_time_us, if #received.
+     */
+    int64_t arrival_us;
+} SmolRTSP_RtcpPacketStatus;
+
+/**
+ * A single RTCP packet of a compound packet.
+ */
+typedef struct {
+    /**
+     * The packet type, such as #SMOLRTSP_RTCP_SR or #SMOLRTSP_RTCP_RR.
+     */
+    uint8_t packet_ty;
+
+    /**
+     * (5 bits) The number of report blocks (SR, RR), the number of sources
+     * (SDES, BYE), or the feedback message type (RTPFB).
+     */
+    uint8_t count;
+
+    /**
+     * The packet data following the 4-byte common header, without padding.
+     */
+    U8Slice99 payload;
+} SmolRTSP_RtcpPacket;
+
+/**
+ * Parses the first RTCP packet of the compound packet @p input.
+ *
+ * On success, @p input is advanced past the packet. For SR and RR packets, the
+ * payload is checked to hold all the #SmolRTSP_RtcpPacket.count report blocks;
+ * for RTPFB and PSFB packets, the sender and media SSRCs.
+ *
+ * @param[in, out] input The compound packet.
+ * @param[out] packet The parsed packet.
+ *
+ * @pre `input != NULL`
+ * @pre `packet != NULL`
+ *
+ * @return 0 on success, -1 if @p input is malformed (`errno` is set to
+ * `EBADMSG`).
+ */
+int SmolRTSP_RtcpPacket_parse(
+    U8Slice99 *restrict input,
+    SmolRTSP_RtcpPacket *restrict packet) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the SSRC of the sender of the SR or RR packet @p self.
+ *
+ * @pre `self.packet_ty` is #SMOLRTSP_RTCP_SR, #SMOLRTSP_RTCP_RR,
+ * #SMOLRTSP_RTCP_RTPFB, or #SMOLRTSP_RTCP_PSFB.
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ */
+uint32_t SmolRTSP_RtcpPacket_sender_ssrc(SmolRTSP_RtcpPacket self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the sender report of the SR packet @p self.
+ *
+ * @pre `self.packet_ty == SMOLRTSP_RTCP_SR`
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ */
+SmolRTSP_RtcpSenderReport SmolRTSP_RtcpPacket_sender_report(
+    SmolRTSP_RtcpPacket self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the report block number @p i of the SR or RR packet @p self.
+ *
+ * @pre `self.packet_ty` is #SMOLRTSP_RTCP_SR or #SMOLRTSP_RTCP_RR.
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ * @pre `i < self.count`
+ */
+SmolRTSP_RtcpReportBlock SmolRTSP_RtcpPacket_report_block(
+    SmolRTSP_RtcpPacket self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the SSRC of the media source the RTPFB or PSFB packet @p self is
+ * about (0 for FIR, which lists its sources separately).
+ *
+ * @pre `self.packet_ty` is #SMOLRTSP_RTCP_RTPFB or #SMOLRTSP_RTCP_PSFB.
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ */
+uint32_t SmolRTSP_RtcpPacket_media_ssrc(SmolRTSP_RtcpPacket self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of NACKs in the generic NACK packet @p self.
+ *
+ * @pre `self.packet_ty == SMOLRTSP_RTCP_RTPFB`
+ * @pre `self.count == SMOLRTSP_RTCP_FMT_NACK`
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ */
+size_t SmolRTSP_RtcpPacket_nacks_count(SmolRTSP_RtcpPacket self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the NACK number @p i of the generic NACK packet @p self.
+ *
+ * @pre `self.packet_ty == SMOLRTSP_RTCP_RTPFB`
+ * @pre `self.count == SMOLRTSP_RTCP_FMT_NACK`
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ * @pre `i < SmolRTSP_RtcpPacket_nacks_count(self)`
+ */
+SmolRTSP_RtcpNack SmolRTSP_RtcpPacket_nack(
+    SmolRTSP_RtcpPacket self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Parses the transport-wide congestion control feedback packet @p self.
+ *
+ * @param[in] self The packet to parse.
+ * @param[out] feedback The header of the feedback.
+ * @param[out] statuses The statuses of the first
+ * `min(feedback->status_count, max)` packets reported, in the order of their
+ * sequence numbers.
+ * @param[in] max The capacity of @p statuses.
+ *
+ * @pre `self.packet_ty == SMOLRTSP_RTCP_RTPFB`
+ * @pre `self.count == SMOLRTSP_RTCP_FMT_TRANSPORT_CC`
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ * @pre `feedback != NULL`
+ * @pre `statuses != NULL || 0 == max`
+ *
+ * @return 0 on success, -1 if the packet chunks or the receive deltas are
+ * truncated or malformed (`errno` is set to `EBADMSG`).
+ */
+int SmolRTSP_RtcpPacket_transport_feedback(
+    SmolRTSP_RtcpPacket self, SmolRTSP_RtcpTransportFeedback *restrict feedback,
+    SmolRTSP_RtcpPacketStatus *restrict statuses,
+    size_t max) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns whether @p self is a PLI about @p ssrc or a FIR with an entry for
+ * @p ssrc, that is, whether the sender of @p ssrc is asked for a keyframe.
+ *
+ * @pre @p self is returned by #SmolRTSP_RtcpPacket_parse.
+ */
+bool SmolRTSP_RtcpPacket_is_keyframe_request(
+    SmolRTSP_RtcpPacket self, uint32_t ssrc) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes @p self as an SR packet without report blocks to @p buffer.
+ *
+ * @param[in] self The sender report to write.
+ * @param[out] buffer The pointer to write to. Must be at least of size
+ * #SMOLRTSP_RTCP_SENDER_REPORT_SIZE.
+ *
+ * @return The pointer to a passed buffer.
+ */
+uint8_t *SmolRTSP_RtcpSenderReport_serialize(
+    SmolRTSP_RtcpSenderReport self,
+    uint8_t buffer[restrict]) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes @p self to @p buffer.
+ *
+ * @param[in] self The report block to write.
+ * @param[out] buffer The pointer to write to. Must be at least of size
+ * #SMOLRTSP_RTCP_REPORT_BLOCK_SIZE.
+ *
+ * @return The pointer to a passed buffer.
+ */
+uint8_t *SmolRTSP_RtcpReportBlock_serialize(
+    SmolRTSP_RtcpReportBlock self,
+    uint8_t buffer[restrict]) SMOLRTSP_PRIV_MUST_USE;
@@ -12,6 +12,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <slice99.h>
+
 /**
  * An RTP header.
  *
@@ -129,3 +131,25 @@ size_t SmolRTSP_RtpHeader_size(SmolRTSP_RtpHeader self) SMOLRTSP_PRIV_MUST_USE;
  */
 uint8_t *SmolRTSP_RtpHeader_serialize(
     SmolRTSP_RtpHeader self, uint8_t buffer[restrict]) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Parses an RTP packet from @p packet.
+ *
+ * On success, @p packet is narrowed down to the payload, without the padding.
+ * `header->csrc` and `header->extension_payload` point into the header within
+ * the original packet (the former is 32-bit aligned if the packet is), and the
+ * fields of @p header are in network byte order.
+ *
+ * @param[in, out] packet The RTP packet.
+ * @param[out] header The parsed header.
+ *
+ * @pre `packet != NULL`
+ * @pre `header != NULL`
+ *
+ * @return -1 if @p packet is not an RTP version 2 packet or is truncated (and
+ * sets `errno` to `EBADMSG`), 0 on success. On failure, @p packet is left
+ * unchanged.
+ */
+int SmolRTSP_RtpHeader_parse(
+    U8Slice99 *restrict packet,
+    SmolRTSP_RtpHeader *restrict header) SMOLRTSP_PRIV_MUST_USE;
@@ -0,0 +1,180 @@
+/**
+ * @file
+ * @brief Batched reception of UDP datagrams, e.g., RTP and RTCP from clients
+ * and ingest sources.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * Creates a datagram socket bound to @p addr and @p port, suitable for
+ * #SmolRTSP_UdpReceiver.
+ *
+ * Besides, it requests the kernel to report the number of datagrams dropped
+ * because the receive buffer was full (`SO_RXQ_OVFL`), and sets the receive
+ * buffer size (`SO_RCVBUF`) if @p rcvbuf is non-zero.
+ *
+ * @param[in] af The socket namespace. Can be `AF_INET` or `AF_INET6`; if none
+ * of them, returns -1 and sets `errno` to `EAFNOSUPPORT`.
+ * @param[in] addr The local IP address: `struct in_addr` for `AF_INET` and
+ * `struct in6_addr` for `AF_INET6`, or `NULL` for any address.
+ * @param[in] port The local IP port in the host byte order, or 0 for an
+ * ephemeral one.
+ * @param[in] rcvbuf The requested receive buffer size in bytes (the kernel
+ * caps it at `net.core.rmem_max`), or 0 to keep the default.
+ *
+ * @return A valid file descriptor or -1 on error (and sets `errno`
+ * appropriately).
+ */
+int smolrtsp_recv_dgram_socket(
+    int af, const void *restrict addr, uint16_t port,
+    size_t rcvbuf) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A received datagram.
+ */
+typedef struct {
+    /**
+     * The data of the datagram, in the buffer of the receiver. It may be
+     * modified in place (e.g., by #SmolRTSP_SrtpTransport_unprotect_rtcp).
+     */
+    U8Slice99 data;
+
+    /**
+     * The source address.
+     */
+    const struct sockaddr *addr;
+
+    /**
+     * The size of `addr`.
+     */
+    socklen_t addr_len;
+
+    /**
+     * Whether the datagram exceeded the maximum packet size of the receiver,
+     * so that `data` holds only its beginning.
+     */
+    bool truncated;
+} SmolRTSP_UdpDatagram;
+
+/**
+ * The statistics of a UDP receiver.
+ */
+typedef struct {
+    /**
+     * The number of datagrams received.
+     */
+    uint64_t datagrams;
+
+    /**
+     * The number of received datagrams that have been truncated.
+     */
+    uint64_t truncated;
+
+    /**
+     * The number of datagrams dropped by the kernel because the receive buffer
+     * of the socket was full, as of the last received datagram (see
+     * `SO_RXQ_OVFL`). Always 0 if the socket has not been created by
+     * #smolrtsp_recv_dgram_socket.
+     */
+    uint64_t dropped;
+} SmolRTSP_UdpReceiverStats;
+
+/**
+ * A receiver of datagrams from a socket in batches, with `recvmmsg`.
+ *
+ * The datagrams are received into a pool of buffers allocated once, and stay
+ * valid until the next call to #SmolRTSP_UdpReceiver_receive, so that they can
+ * be handed to #SmolRTSP_RtpDepacketizer_feed or #SmolRTSP_RtcpPacket_parse
+ * without copying.
+ *
+ * Typical usage:
+ *
+ * @code
+ * ssize_t n;
+ * while ((n = SmolRTSP_UdpReceiver_receive(receiver)) > 0) {
+ *     for (size_t i = 0; i < (size_t)n; i++) {
+ *         const SmolRTSP_UdpDatagram dgram =
+ *             SmolRTSP_UdpReceiver_datagram(receiver, i);
+ *         // Process `dgram`.
+ *     }
+ * }
+ * @endcode
+ *
+ * A receiver must be used from a single thread.
+ */
+typedef struct SmolRTSP_UdpReceiver SmolRTSP_UdpReceiver;
+
+/**
+ * Creates a receiver with a pool of @p capacity datagrams of at most
+ * @p max_packet_size bytes each.
+ *
+ * @param[in] fd The datagram socket to receive from (not owned by the
+ * receiver).
+ * @param[in] capacity The maximum number of datagrams received at once.
+ * @param[in] max_packet_size The maximum size of a datagram; larger ones are
+ * truncated.
+ *
+ * @pre `fd >= 0`
+ * @pre `capacity > 0`
+ * @pre `max_packet_size > 0`
+ *
+ * @return The receiver, or `NULL` if there is not enough memory (and sets
+ * `errno` to `ENOMEM`).
+ */
+SmolRTSP_UdpReceiver *SmolRTSP_UdpReceiver_new(
+    int fd, size_t capacity, size_t max_packet_size) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Receives the next batch of datagrams, replacing the previous one.
+ *
+ * It waits for the first datagram if the socket is blocking, and then takes
+ * all the datagrams that have already arrived, up to the capacity of
+ * @p self.
+ *
+ * @pre `self != NULL`
+ *
+ * @return The number of received datagrams, or -1 on error (and sets `errno`
+ * appropriately, e.g., to `EAGAIN` if a non-blocking socket has no datagrams).
+ */
+ssize_t SmolRTSP_UdpReceiver_receive(SmolRTSP_UdpReceiver *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the datagram number @p i of the last batch.
+ *
+ * @pre `self != NULL`
+ * @pre @p i is less than the last result of #SmolRTSP_UdpReceiver_receive.
+ */
+SmolRTSP_UdpDatagram SmolRTSP_UdpReceiver_datagram(
+    SmolRTSP_UdpReceiver *self, size_t i) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the statistics of @p self.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_UdpReceiverStats
+SmolRTSP_UdpReceiver_stats(const SmolRTSP_UdpReceiver *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_UdpReceiver.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_UdpReceiver);
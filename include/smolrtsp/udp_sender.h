@@ -0,0 +1,133 @@
+/**
+ * @file
+ * @brief A shared unconnected UDP socket sending to many destinations.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+
+#include <stddef.h>
+
+#include <sys/socket.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * A queue of outgoing datagrams to many destinations over a single
+ * unconnected socket.
+ *
+ * Instead of a connected socket per client (see #smolrtsp_dgram_socket),
+ * every client of a worker is given a transport holding only its address
+ * (#smolrtsp_transport_udp_sender). The transports copy their packets into the
+ * queue together with the destination, and #SmolRTSP_UdpSender_flush passes
+ * the whole queue to the kernel with `sendmmsg`, so the packets of many
+ * clients are sent within a single system call. The queue is also flushed
+ * whenever it fills up.
+ *
+ * A sender, its socket, and its transports must be used from a single thread;
+ * create one per worker (or per core) rather than sharing it. Drop all the
+ * transports before the sender itself.
+ */
+typedef struct SmolRTSP_UdpSender SmolRTSP_UdpSender;
+
+/**
+ * Creates an unconnected datagram socket suitable for #SmolRTSP_UdpSender.
+ *
+ * Like #smolrtsp_dgram_socket, it sets `IP_MTU_DISCOVER` (`IPV6_MTU_DISCOVER`)
+ * to `IP_PMTUDISC_DO` (`IPV6_PMTUDISC_DO`), so that oversized datagrams are
+ * reported with `EMSGSIZE` instead of being fragmented.
+ *
+ * @param[in] af The socket namespace. Can be `AF_INET` or `AF_INET6`; if none
+ * of them, returns -1 and sets `errno` to `EAFNOSUPPORT`.
+ *
+ * @return A valid file descriptor or -1 on error (and sets `errno`
+ * appropriately).
+ */
+int smolrtsp_shared_dgram_socket(int af) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a sender with a queue of @p capacity datagrams of at most
+ * @p max_packet_size bytes each.
+ *
+ * @param[in] fd The unconnected datagram socket to send through (not owned by
+ * the sender).
+ * @param[in] capacity The number of datagrams queued before a flush.
+ * @param[in] max_packet_size The maximum size of a datagram, which is also the
+ * `max_packet_size` of the transports.
+ *
+ * @pre `fd >= 0`
+ * @pre `capacity > 0`
+ * @pre `max_packet_size > 0`
+ *
+ * @return The sender, or `NULL` if an allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_UdpSender *SmolRTSP_UdpSender_new(
+    int fd, size_t capacity, size_t max_packet_size) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Sends all the queued datagrams.
+ *
+ * A datagram rejected by the kernel (e.g., with `EMSGSIZE`) is discarded and
+ * counted by #SmolRTSP_UdpSender_errors, so that one bad destination does not
+ * hold back the others. If the socket buffer is full (`EAGAIN` on a
+ * non-blocking socket or `ENOBUFS`), the remaining datagrams stay queued.
+ *
+ * @return The number of datagrams sent, or -1 if they have to stay queued
+ * (and sets `errno` appropriately).
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_UdpSender_flush(SmolRTSP_UdpSender *self);
+
+/**
+ * Returns the number of queued datagrams.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_UdpSender_pending(const SmolRTSP_UdpSender *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of datagrams discarded by #SmolRTSP_UdpSender_flush.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_UdpSender_errors(const SmolRTSP_UdpSender *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_UdpSender.
+ *
+ * The queued datagrams are discarded; flush them beforehand.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_UdpSender);
+
+/**
+ * Creates a transport queueing datagrams to @p addr on @p sender.
+ *
+ * `transmit` copies the packet and its destination into the queue of
+ * @p sender, flushing it first if it is full, and fails with `EMSGSIZE` if
+ * the packet exceeds the `max_packet_size` of @p sender. `transmit_batch`
+ * queues all the packets it can. `is_full` reports whether the queue is full
+ * and cannot be flushed right now.
+ *
+ * @param[in] sender The sender to queue datagrams on.
+ * @param[in] addr The destination address (copied): `struct sockaddr_in` or
+ * `struct sockaddr_in6`.
+ *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
+ * @pre `sender != NULL`
+ * @pre `addr != NULL`
+ * @pre `addr->sa_family == AF_INET || addr->sa_family == AF_INET6`
+ */
+SmolRTSP_Transport smolrtsp_transport_udp_sender(
+    SmolRTSP_UdpSender *sender,
+    const struct sockaddr *addr) SMOLRTSP_PRIV_MUST_USE;
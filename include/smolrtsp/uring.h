@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief An io_uring backend for transports and writers.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/writer.h>
+
+#include <stddef.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * An io_uring instance together with a pool of registered packet buffers.
+ *
+ * Transports and writers on top of it copy outgoing data into the pool and
+ * only queue submission entries; nothing reaches the kernel until
+ * #SmolRTSP_Uring_submit, which is meant to be called once per event loop
+ * tick. Thousands of streams thereby cost a single `io_uring_enter` call per
+ * tick (plus one whenever the submission queue fills up) instead of a system
+ * call per packet.
+ *
+ * The ring, its transports, and its writers must be used from a single
+ * thread. Drop all the transports and writers before the ring itself.
+ */
+typedef struct SmolRTSP_Uring SmolRTSP_Uring;
+
+/**
+ * The configuration of #SmolRTSP_Uring.
+ */
+typedef struct {
+    /**
+     * The number of submission queue entries, rounded up to a power of two by
+     * the kernel.
+     */
+    unsigned entries;
+
+    /**
+     * The size of a single packet buffer, which bounds the size of a packet
+     * transmitted by #smolrtsp_transport_uring.
+     */
+    size_t buffer_size;
+
+    /**
+     * The number of packet buffers, i.e., the maximum number of packets and
+     * writer chunks in flight.
+     */
+    size_t buffers_count;
+} SmolRTSP_UringConfig;
+
+/**
+ * Returns the default configuration: 256 entries and 1024 buffers of 2048
+ * bytes.
+ */
+SmolRTSP_UringConfig SmolRTSP_UringConfig_default(void) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates an io_uring instance with @p config.
+ *
+ * The packet buffers are registered with the kernel if possible (see
+ * `IORING_REGISTER_BUFFERS`), so that it need not map them on every write.
+ *
+ * @return The ring, or `NULL` if io_uring is unavailable (`errno` is set
+ * appropriately) or the buffers cannot be allocated (`errno` is set to
+ * `ENOMEM`).
+ *
+ * @pre `config.entries > 0`
+ * @pre `config.buffer_size > 0`
+ * @pre `config.buffers_count > 0`
+ */
+SmolRTSP_Uring *
+SmolRTSP_Uring_new(SmolRTSP_UringConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Submits all the queued entries with a single `io_uring_enter` call and
+ * processes the completions that have arrived since the previous call.
+ *
+ * @return The number of entries submitted, or -1 on error (and sets `errno`
+ * appropriately).
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_Uring_submit(SmolRTSP_Uring *self);
+
+/**
+ * Processes the arrived completions without any system call, releasing their
+ * buffers.
+ *
+ * @return The number of completions processed.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Uring_reap(SmolRTSP_Uring *self);
+
+/**
+ * Submits all the queued entries and waits until every submitted one
+ * completes.
+ *
+ * @return 0 on success, -1 on error (and sets `errno` appropriately).
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_Uring_drain(SmolRTSP_Uring *self);
+
+/**
+ * Returns the number of buffers in use, i.e., holding data not yet written.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Uring_in_flight(const SmolRTSP_Uring *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of writes that have failed.
+ *
+ * Since datagrams are sent asynchronously, their errors are only counted.
+ *
+ * @pre `self != NULL`
+ */
+size_t
+SmolRTSP_Uring_errors(const SmolRTSP_Uring *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Uring.
+ *
+ * Waits for the entries in flight beforehand.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Uring);
+
+/**
+ * Creates a datagram transport queueing a write to @p fd on @p ring per
+ * packet.
+ *
+ * @p fd must be a connected datagram socket (e.g., from
+ * #smolrtsp_dgram_socket). `transmit` copies the packet into a buffer of
+ * @p ring and fails with `ENOBUFS` if there is none, or with `EMSGSIZE` if
+ * the packet exceeds #SmolRTSP_UringConfig.buffer_size, which is also its
+ * `max_packet_size`. `is_full` reports whether every buffer is in use.
+ *
+ * @pre `ring != NULL`
+ * @pre `fd >= 0`
+ *
+ * @return The transport, or a transport with `self == NULL` if the allocation
+ * fails (and sets `errno` to `ENOMEM`).
+ */
+SmolRTSP_Transport
+smolrtsp_transport_uring(SmolRTSP_Uring *ring, int fd) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer to a stream (e.g., an RTSP connection) through #SmolRTSP_Uring.
+ *
+ * Written data is appended to a chain of ring buffers, so that small writes
+ * coalesce into a single submission entry. At most one write per writer is in
+ * flight at a time, which keeps the stream in order; partial writes are
+ * resumed automatically.
+ */
+typedef struct SmolRTSP_UringWriter SmolRTSP_UringWriter;
+
+/**
+ * Creates a writer to @p fd on @p ring.
+ *
+ * @pre `ring != NULL`
+ * @pre `fd >= 0`
+ *
+ * @return The writer, or `NULL` if the allocation fails (and sets `errno` to
+ * `ENOMEM`).
+ */
+SmolRTSP_UringWriter *
+SmolRTSP_UringWriter_new(SmolRTSP_Uring *ring, int fd) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the writer interface of @p self.
+ *
+ * The writer returns the number of bytes accepted. Once a write of @p self
+ * has failed, all subsequent calls fail with its `errno`. It fails with
+ * `ENOBUFS` if the ring has run out of buffers. `filled` reports the number of
+ * bytes not yet written to the file descriptor, so that
+ * #smolrtsp_transport_tcp can apply backpressure.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer
+smolrtsp_uring_writer(SmolRTSP_UringWriter *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_UringWriter.
+ *
+ * The data not yet written is discarded.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_UringWriter);
@@ -88,7 +88,24 @@ typedef struct {
 SMOLRTSP_DEF_OPTION(SmolRTSP_ChannelPair);
 
 /**
- * The RTSP transport configuration.
+ * Defines `SmolRTSP_U8Option` holding `uint8_t`.
+ *
+ * See [Datatype99](https://github.com/Hirrolot/datatype99) for the macro usage.
+ */
+SMOLRTSP_DEF_OPTION(SmolRTSP_U8, uint8_t);
+
+/**
+ * Defines `SmolRTSP_U32Option` holding `uint32_t`.
+ *
+ * See [Datatype99](https://github.com/Hirrolot/datatype99) for the macro usage.
+ */
+SMOLRTSP_DEF_OPTION(SmolRTSP_U32, uint32_t);
+
+/**
+ * The RTSP transport configuration, i.e., a single transport specification.
+ *
+ * The slices point into the parsed header value. Unknown parameters are
+ * ignored.
  *
  * @see <https://datatracker.ietf.org/doc/html/rfc2326#section-12.39>
  */
@@ -98,6 +115,12 @@ typedef struct {
      */
     SmolRTSP_LowerTransport lower;
 
+    /**
+     * True if the profile is `RTP/SAVP`, i.e., the client expects SRTP (see
+     * #SmolRTSP_SrtpTransport).
+     */
+    bool secure;
+
     /**
      * True if the `unicast` parameter is present.
      */
@@ -117,6 +140,53 @@ typedef struct {
      * The `client_port` parameter, if present.
      */
     SmolRTSP_PortPairOption client_port;
+
+    /**
+     * The `server_port` parameter, if present.
+     */
+    SmolRTSP_PortPairOption server_port;
+
+    /**
+     * The `port` parameter (multicast), if present.
+     */
+    SmolRTSP_PortPairOption port;
+
+    /**
+     * The address of the `destination` parameter (empty if absent or given
+     * without a value).
+     */
+    CharSlice99 destination;
+
+    /**
+     * The address of the `source` parameter (empty if absent).
+     */
+    CharSlice99 source;
+
+    /**
+     * The `ttl` parameter, if present.
+     */
+    SmolRTSP_U8Option ttl;
+
+    /**
+     * The `layers` parameter, if present.
+     */
+    SmolRTSP_U32Option layers;
+
+    /**
+     * The `ssrc` parameter (hexadecimal in the header), if present.
+     */
+    SmolRTSP_U32Option ssrc;
+
+    /**
+     * The `mode` parameter without the quotes, e.g., `PLAY` or `"PLAY,RECORD"`
+     * (empty if absent, which means `PLAY`).
+     */
+    CharSlice99 mode;
+
+    /**
+     * True if the `append` parameter is present.
+     */
+    bool append;
 } SmolRTSP_TransportConfig;
 
 /**
@@ -124,6 +194,9 @@ typedef struct {
  * [`Transport`](https://datatracker.ietf.org/doc/html/rfc2326#section-12.39)
  * header.
  *
+ * If the header lists several transport specifications, only the first one is
+ * parsed; use #smolrtsp_parse_transport_next to go through all of them.
+ *
  * @param[out] config The result of parsing. It remains unchanged on failure.
  * @param[in] header_value The value of the `Transport` header.
  *
@@ -135,6 +208,74 @@ int smolrtsp_parse_transport(
     SmolRTSP_TransportConfig *restrict config,
     CharSlice99 header_value) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Parses the next comma-separated transport specification of the
+ * [`Transport`](https://datatracker.ietf.org/doc/html/rfc2326#section-12.39)
+ * header.
+ *
+ * @param[out] config The result of parsing. It remains unchanged unless 1 is
+ * returned.
+ * @param[in, out] header_value The rest of the `Transport` header value,
+ * advanced past the parsed specification.
+ *
+ * @return 1 if a specification has been parsed, 0 if there are no more
+ * specifications, -1 on failure.
+ *
+ * @pre `config != NULL`
+ * @pre `header_value != NULL`
+ */
+int smolrtsp_parse_transport_next(
+    SmolRTSP_TransportConfig *restrict config,
+    CharSlice99 *restrict header_value) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A range of the normal play time (NPT), as requested by `PLAY`.
+ *
+ * @see <https://datatracker.ietf.org/doc/html/rfc2326#section-3.6>
+ */
+typedef struct {
+    /**
+     * True if the range starts at `now`, i.e., at the current position.
+     */
+    bool start_is_now;
+
+    /**
+     * The start of the range in milliseconds (0 if #start_is_now).
+     */
+    uint64_t start_ms;
+
+    /**
+     * True if the range has an end; otherwise, it lasts until the end of the
+     * stream.
+     */
+    bool has_end;
+
+    /**
+     * The end of the range in milliseconds (0 unless #has_end).
+     */
+    uint64_t end_ms;
+} SmolRTSP_NptRange;
+
+/**
+ * Parses an `npt=` value of the
+ * [`Range`](https://datatracker.ietf.org/doc/html/rfc2326#section-12.29)
+ * header, e.g., `npt=12.5-`, `npt=0:01:30-0:02:00`, or `npt=now-`.
+ *
+ * Both `npt-sec` and `npt-hhmmss` times are accepted; fractions beyond
+ * milliseconds are truncated. The `time` parameter is ignored.
+ *
+ * @param[out] range The result of parsing. It remains unchanged on failure.
+ * @param[in] header_value The value of the `Range` header.
+ *
+ * @return 0 on success, -1 on failure (including other units, such as `smpte`
+ * and `clock`).
+ *
+ * @pre `range != NULL`
+ */
+int smolrtsp_parse_npt_range(
+    SmolRTSP_NptRange *restrict range,
+    CharSlice99 header_value) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * Returns a four-octet interleaved binary data header.
  *
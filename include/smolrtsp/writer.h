@@ -6,11 +6,15 @@
 #pragma once
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <unistd.h>
 
+#include <smolrtsp/io_vec.h>
+
 #include <interface99.h>
 #include <slice99.h>
 
@@ -30,6 +34,29 @@
      */                                                                        \
     vfunc99(ssize_t, write, VSelf99, CharSlice99 data)                         \
                                                                                \
+    /*                                                                         \
+     * Writes all the I/O vectors @p bufs into itself, in order, as a single   \
+     * unit if possible.                                                       \
+     *                                                                         \
+     * @return The number of bytes written or a negative value on error.       \
+     */                                                                        \
+    vfuncDefault99(ssize_t, writev, VSelf99, SmolRTSP_IoVecSlice bufs)         \
+                                                                               \
+    /*                                                                         \
+     * Returns a pointer to at least @p len bytes of output space, so that     \
+     * the caller can format data directly into it and then `commit` it.       \
+     *                                                                         \
+     * @return The output space or `NULL` if the writer cannot provide it,     \
+     * with `errno` set.                                                       \
+     */                                                                        \
+    vfuncDefault99(char *, reserve, VSelf99, size_t len)                       \
+                                                                               \
+    /*                                                                         \
+     * Appends the first @p len bytes of the space returned by the last        \
+     * `reserve` to the output.                                                \
+     */                                                                        \
+    vfuncDefault99(void, commit, VSelf99, size_t len)                          \
+                                                                               \
     /*                                                                         \
      * Lock writer to prevent race conditions on TCP interleaved channels      \
      */                                                                        \
@@ -67,6 +94,55 @@
  */
 interface99(SmolRTSP_Writer);
 
+/**
+ * The default implementation of `writev`.
+ *
+ * Returns -1 and sets `errno` to `ENOSYS`. Use #smolrtsp_writev to fall back
+ * to `write` for such writers.
+ */
+ssize_t SmolRTSP_Writer_writev(VSelf99, SmolRTSP_IoVecSlice bufs);
+
+/**
+ * The default implementation of `reserve`.
+ *
+ * Returns `NULL` and sets `errno` to `ENOSYS`, so that callers format into
+ * their own buffer and `write` it instead (see #smolrtsp_write_uint).
+ */
+char *SmolRTSP_Writer_reserve(VSelf99, size_t len);
+
+/**
+ * The default implementation of `commit`, which does nothing.
+ */
+void SmolRTSP_Writer_commit(VSelf99, size_t len);
+
+/**
+ * Writes all the I/O vectors @p bufs to @p w.
+ *
+ * If @p w does not override `writev`, every vector is written via `write`.
+ *
+ * @param[in] w The writer to be provided with data.
+ * @param[in] bufs The data to write.
+ *
+ * @return The number of bytes written or a negative value on error.
+ *
+ * @pre `w.self && w.vptr`
+ */
+ssize_t smolrtsp_writev(SmolRTSP_Writer w, SmolRTSP_IoVecSlice bufs)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the decimal representation of @p value to @p w.
+ *
+ * The digits are formatted directly into the space reserved by `reserve`, or
+ * passed to `write` if @p w does not provide it.
+ *
+ * @return The number of bytes written or a negative value on error.
+ *
+ * @pre `w.self && w.vptr`
+ */
+ssize_t smolrtsp_write_uint(SmolRTSP_Writer w, uint64_t value)
+    SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * The same as #smolrtsp_write_slices but calculates an array length from
  * variadic arguments (the syntactically separated items of the array).
@@ -94,10 +170,118 @@ ssize_t smolrtsp_write_slices(
 /**
  * A writer that invokes `write` on a provided file descriptor.
  *
+ * Its `filled` reports #smolrtsp_fd_unsent_bytes, so that
+ * #smolrtsp_transport_tcp can detect a slow client.
+ *
  * @pre `fd != NULL`
  */
 SmolRTSP_Writer smolrtsp_fd_writer(int *fd) SMOLRTSP_PRIV_MUST_USE;
 
+/**
+ * Returns the number of bytes queued in the kernel send buffer of the socket
+ * @p fd (`SIOCOUTQ`/`TIOCOUTQ`), or 0 if @p fd is not a socket or the system
+ * cannot tell.
+ */
+size_t smolrtsp_fd_unsent_bytes(int fd) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer to a non-blocking file descriptor that never tears a message.
+ *
+ * Whatever part of a message the kernel does not accept at once is kept in a
+ * caller-provided buffer and sent first by the following writes or by
+ * #SmolRTSP_NonblockingFdWriter_flush, which should be called once @p fd
+ * becomes writable. A message for which there is no room in the buffer is
+ * rejected as a whole with `EAGAIN`, so that the caller can drop it or retry
+ * it later.
+ */
+typedef struct {
+    /**
+     * The file descriptor, which should be in the non-blocking mode.
+     */
+    int fd;
+
+    /**
+     * The buffer of the data not yet accepted by the kernel.
+     */
+    char *buffer;
+
+    /**
+     * The size of #buffer.
+     */
+    size_t capacity;
+
+    /**
+     * The number of pending bytes in #buffer.
+     */
+    size_t len;
+
+    /**
+     * Whether #buffer is allocated by the writer when some data is to be kept
+     * and released once it has been sent, so that an idle writer holds no
+     * buffer.
+     */
+    bool lazy;
+} SmolRTSP_NonblockingFdWriter;
+
+/**
+ * Creates a non-blocking writer to @p fd with the pending data buffer
+ * @p buffer of @p capacity bytes.
+ *
+ * A message longer than @p capacity can still be torn if the kernel accepts
+ * only a part of it; then the writer returns the accepted number of bytes, as
+ * `write` does.
+ *
+ * @pre `buffer != NULL`
+ */
+SmolRTSP_NonblockingFdWriter SmolRTSP_NonblockingFdWriter_new(
+    int fd, char *buffer, size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * The same as #SmolRTSP_NonblockingFdWriter_new, but the pending data buffer
+ * of @p capacity bytes is allocated only while there is pending data (see
+ * #SmolRTSP_NonblockingFdWriter.lazy).
+ *
+ * A message that the kernel does not accept in full is rejected with `ENOMEM`
+ * if the buffer cannot be allocated. Release the writer with
+ * #SmolRTSP_NonblockingFdWriter_release.
+ */
+SmolRTSP_NonblockingFdWriter SmolRTSP_NonblockingFdWriter_new_lazy(
+    int fd, size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Frees the buffer allocated by a writer created with
+ * #SmolRTSP_NonblockingFdWriter_new_lazy, discarding the pending data; does
+ * nothing for the other writers.
+ *
+ * @pre `self != NULL`
+ */
+void SmolRTSP_NonblockingFdWriter_release(SmolRTSP_NonblockingFdWriter *self);
+
+/**
+ * Writes as much of the pending data of @p self as the kernel accepts.
+ *
+ * @return The number of bytes still pending, or -1 on error other than
+ * `EAGAIN`/`EWOULDBLOCK`.
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_NonblockingFdWriter_flush(SmolRTSP_NonblockingFdWriter *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer that writes to @p self as described in
+ * #SmolRTSP_NonblockingFdWriter.
+ *
+ * The writer returns the whole message length once the message has been either
+ * sent or buffered, and -1 with `errno` set to `EAGAIN` if it has been
+ * rejected. `filled` reports the pending bytes plus
+ * #smolrtsp_fd_unsent_bytes.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer smolrtsp_nonblocking_fd_writer(
+    SmolRTSP_NonblockingFdWriter *self) SMOLRTSP_PRIV_MUST_USE;
+
 /**
  * A writer that invokes `fwrite` on a provided file pointer.
  *
@@ -112,3 +296,129 @@ SmolRTSP_Writer smolrtsp_file_writer(FILE *stream) SMOLRTSP_PRIV_MUST_USE;
  * written into it.
  */
 SmolRTSP_Writer smolrtsp_string_writer(char *buffer) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A null-terminated string being written into a fixed-size buffer.
+ *
+ * Unlike #smolrtsp_string_writer, which appends at `strlen(buffer)` and has no
+ * bound, its writer appends at #len in constant time and never writes past
+ * #capacity.
+ */
+typedef struct {
+    /**
+     * The buffer of the string.
+     */
+    char *buffer;
+
+    /**
+     * The size of #buffer, including the null character.
+     */
+    size_t capacity;
+
+    /**
+     * The length of the string in #buffer.
+     */
+    size_t len;
+
+    /**
+     * Whether some data has not fit into #buffer.
+     */
+    bool truncated;
+} SmolRTSP_StringBuffer;
+
+/**
+ * Creates an empty string in @p buffer of @p capacity bytes.
+ *
+ * @pre `buffer != NULL`
+ * @pre `capacity > 0`
+ */
+SmolRTSP_StringBuffer SmolRTSP_StringBuffer_new(
+    char *buffer, size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the string written so far.
+ *
+ * @pre `self != NULL`
+ */
+CharSlice99 SmolRTSP_StringBuffer_as_slice(const SmolRTSP_StringBuffer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer that appends to @p self.
+ *
+ * Data that does not fit is truncated: its prefix is kept,
+ * #SmolRTSP_StringBuffer.truncated is set, and the call returns -1 with `errno`
+ * set to `ENOBUFS`. `filled` returns the current length.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer smolrtsp_string_buffer_writer(SmolRTSP_StringBuffer *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer that gathers the data written to it in a caller-provided buffer
+ * and passes it on to another writer at once.
+ *
+ * Serializers write every small piece separately (e.g., a header key, `": "`,
+ * the value, and CRLF), which costs a system call each with
+ * #smolrtsp_fd_writer. Wrapped into this writer, a whole message takes a
+ * single `writev` call on #SmolRTSP_BufferedWriter_flush.
+ *
+ * Data that does not fit into the remaining buffer space is written together
+ * with the buffered data in one vectored write, without being copied.
+ */
+typedef struct {
+    /**
+     * The writer to pass the data on to.
+     */
+    SmolRTSP_Writer inner;
+
+    /**
+     * The buffer of the pending data.
+     */
+    char *buffer;
+
+    /**
+     * The size of #buffer.
+     */
+    size_t capacity;
+
+    /**
+     * The number of pending bytes in #buffer.
+     */
+    size_t len;
+} SmolRTSP_BufferedWriter;
+
+/**
+ * Creates a buffered writer on top of @p inner.
+ *
+ * @pre `inner.self && inner.vptr`
+ * @pre `buffer != NULL`
+ */
+SmolRTSP_BufferedWriter SmolRTSP_BufferedWriter_new(
+    SmolRTSP_Writer inner, char *buffer,
+    size_t capacity) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Writes the pending data of @p self to #SmolRTSP_BufferedWriter.inner.
+ *
+ * The pending data is discarded even on failure.
+ *
+ * @return The number of bytes written or a negative value on error.
+ *
+ * @pre `self != NULL`
+ */
+ssize_t SmolRTSP_BufferedWriter_flush(SmolRTSP_BufferedWriter *self)
+    SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * A writer that buffers data in @p self until #SmolRTSP_BufferedWriter_flush.
+ *
+ * The writer returns the number of bytes accepted, which are not necessarily
+ * written yet. An error of the inner writer is reported by the call that
+ * writes to it.
+ *
+ * @pre `self != NULL`
+ */
+SmolRTSP_Writer smolrtsp_buffered_writer(SmolRTSP_BufferedWriter *self)
+    SMOLRTSP_PRIV_MUST_USE;
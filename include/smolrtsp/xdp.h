@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @brief An AF_XDP backend for UDP transports.
+ */
+
+#pragma once
+
+#include <smolrtsp/droppable.h>
+#include <smolrtsp/transport.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+
+#include <smolrtsp/priv/compiler_attrs.h>
+
+/**
+ * The size of the Ethernet, IPv4, and UDP headers that #smolrtsp_transport_xdp
+ * prepends to every packet.
+ */
+#define SMOLRTSP_XDP_HEADERS_SIZE 42
+
+/**
+ * An AF_XDP socket bound to a single transmit queue of a network interface,
+ * together with its UMEM, i.e., the frames shared with the kernel.
+ *
+ * Transports on top of it write whole Ethernet frames into the UMEM and only
+ * queue descriptors on the TX ring, bypassing the network stack of the kernel;
+ * nothing is sent before #SmolRTSP_Xdp_submit, which is meant to be called once
+ * per event loop tick. With a driver supporting zero-copy mode, the NIC reads
+ * the frames directly from the UMEM.
+ *
+ * An instance must be used from a single thread. To use several cores, create
+ * an instance per thread, each bound to a distinct queue (e.g., the thread `i`
+ * to the queue `i`), so that the TX rings need no locking. Drop all the
+ * transports before the instance itself.
+ *
+ * The packets bypass routing, ARP, and netfilter: the caller supplies the MAC
+ * address of the next hop (see #SmolRTSP_XdpFlow).
+ */
+typedef struct SmolRTSP_Xdp SmolRTSP_Xdp;
+
+/**
+ * The configuration of #SmolRTSP_Xdp.
+ */
+typedef struct {
+    /**
+     * The name of the network interface to transmit through.
+     */
+    const char *ifname;
+
+    /**
+     * The transmit queue of `ifname` to bind to.
+     */
+    uint32_t queue_id;
+
+    /**
+     * The size of a UMEM frame: 2048 or 4096. It bounds the size of a packet
+     * together with the MTU of `ifname`.
+     */
+    uint32_t frame_size;
+
+    /**
+     * The number of UMEM frames, i.e., the maximum number of packets in
+     * flight.
+     */
+    uint32_t frames_count;
+
+    /**
+     * The number of descriptors of the TX and completion rings, a power of
+     * two.
+     */
+    uint32_t ring_size;
+} SmolRTSP_XdpConfig;
+
+/**
+ * Returns the default configuration for @p ifname: the queue 0, 4096 frames of
+ * 2048 bytes, and rings of 2048 descriptors.
+ *
+ * @pre `ifname != NULL`
+ */
+SmolRTSP_XdpConfig
+SmolRTSP_XdpConfig_default(const char *ifname) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates an AF_XDP socket with @p config.
+ *
+ * Zero-copy mode is used if the driver supports it, and copy mode otherwise.
+ *
+ * @return The instance, or `NULL` on error (and sets `errno` appropriately):
+ * e.g., `EAFNOSUPPORT` if the kernel lacks AF_XDP, `EPERM` without
+ * `CAP_NET_RAW`, or `ENODEV` if there is no interface `ifname`. Fall back to
+ * #smolrtsp_transport_udp in this case (see #smolrtsp_transport_xdp_or_udp).
+ *
+ * @pre `config.ifname != NULL`
+ * @pre `config.frame_size` is 2048 or 4096.
+ * @pre `config.frames_count > 0`
+ * @pre `config.ring_size` is a power of two.
+ */
+SmolRTSP_Xdp *
+SmolRTSP_Xdp_new(SmolRTSP_XdpConfig config) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Hands the queued packets to the kernel, with a single `sendto` call if the
+ * driver needs a wake-up, and reclaims the frames of the packets sent since
+ * the previous call.
+ *
+ * @return The number of packets handed to the kernel, or -1 on error (and sets
+ * `errno` appropriately).
+ *
+ * @pre `self != NULL`
+ */
+int SmolRTSP_Xdp_submit(SmolRTSP_Xdp *self);
+
+/**
+ * Reclaims the frames of the sent packets without any system call.
+ *
+ * @return The number of frames reclaimed.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Xdp_reap(SmolRTSP_Xdp *self);
+
+/**
+ * Returns the number of frames in use, i.e., holding packets not yet sent.
+ *
+ * @pre `self != NULL`
+ */
+size_t SmolRTSP_Xdp_in_flight(const SmolRTSP_Xdp *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns whether the NIC reads the frames directly from the UMEM.
+ *
+ * @pre `self != NULL`
+ */
+bool SmolRTSP_Xdp_is_zerocopy(const SmolRTSP_Xdp *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Returns the number of TX descriptors that the kernel has rejected (see
+ * `XDP_STATISTICS`), e.g., because of an oversized frame.
+ *
+ * @pre `self != NULL`
+ */
+uint64_t
+SmolRTSP_Xdp_invalid_descs(const SmolRTSP_Xdp *self) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Implements #SmolRTSP_Droppable_IFACE for #SmolRTSP_Xdp.
+ *
+ * The packets not yet sent are discarded.
+ *
+ * See [Interface99](https://github.com/Hirrolot/interface99) for the macro
+ * usage.
+ */
+declImplExtern99(SmolRTSP_Droppable, SmolRTSP_Xdp);
+
+/**
+ * The addresses of a UDP flow over IPv4 and Ethernet.
+ */
+typedef struct {
+    /**
+     * The MAC address of the interface.
+     */
+    uint8_t src_mac[6];
+
+    /**
+     * The MAC address of the next hop: the peer itself or the gateway.
+     */
+    uint8_t dst_mac[6];
+
+    /**
+     * The IPv4 address of the interface.
+     */
+    struct in_addr src_addr;
+
+    /**
+     * The IPv4 address of the peer.
+     */
+    struct in_addr dst_addr;
+
+    /**
+     * The source port in the host byte order.
+     */
+    uint16_t src_port;
+
+    /**
+     * The destination port in the host byte order.
+     */
+    uint16_t dst_port;
+
+    /**
+     * The time to live of the IP packets, or 0 for 64.
+     */
+    uint8_t ttl;
+
+    /**
+     * The DSCP of the IP packets (e.g., 34 for AF41, commonly used for video).
+     */
+    uint8_t dscp;
+} SmolRTSP_XdpFlow;
+
+/**
+ * Writes the Ethernet, IPv4, and UDP headers of a packet of @p flow with a
+ * payload of @p payload_len bytes to `frame[0..SMOLRTSP_XDP_HEADERS_SIZE)`.
+ *
+ * The IPv4 packets have the DF flag set and the identification 0 (RFC 6864);
+ * the UDP checksum is 0, i.e., not computed.
+ *
+ * @pre `flow != NULL`
+ * @pre `frame != NULL`
+ * @pre `payload_len <= 65507`
+ */
+void smolrtsp_xdp_write_headers(
+    const SmolRTSP_XdpFlow *flow, size_t payload_len, uint8_t *restrict frame);
+
+/**
+ * Creates a datagram transport writing the packets of @p flow as Ethernet
+ * frames into @p xdp.
+ *
+ * `transmit` copies the packet into a UMEM frame after the headers and queues
+ * it on the TX ring of @p xdp, submitting the ring if it is full. It fails with
+ * `ENOBUFS` if there is no free frame or descriptor, or with `EMSGSIZE` if the
+ * packet exceeds `max_packet_size`, which is derived from the MTU of the
+ * interface and the frame size. `is_full` reports whether the next packet
+ * would fail with `ENOBUFS`.
+ *
+ * Returns a transport with `self == NULL` and sets `errno` to `ENOMEM` if an
+ * allocation fails.
+ *
+ * @pre `xdp != NULL`
+ */
+SmolRTSP_Transport smolrtsp_transport_xdp(
+    SmolRTSP_Xdp *xdp, SmolRTSP_XdpFlow flow) SMOLRTSP_PRIV_MUST_USE;
+
+/**
+ * Creates a transport of the flow of the connected UDP socket @p fd through
+ * @p xdp if possible, and #smolrtsp_transport_udp of @p fd otherwise.
+ *
+ * The flow takes its IPv4 addresses, ports, and DSCP (`IP_TOS`) from @p fd
+ * and its source MAC address from the interface of @p xdp. @p fd must stay
+ * open for the lifetime of the transport, which keeps its port reserved and
+ * lets the caller receive RTCP on it.
+ *
+ * The UDP transport is used if @p xdp is `NULL` (e.g., because
+ * #SmolRTSP_Xdp_new has failed) or @p fd is not an IPv4 socket.
+ *
+ * @pre `fd >= 0`
+ * @pre `xdp == NULL || next_hop_mac != NULL`
+ */
+SmolRTSP_Transport smolrtsp_transport_xdp_or_udp(
+    SmolRTSP_Xdp *xdp, const uint8_t next_hop_mac[6],
+    int fd) SMOLRTSP_PRIV_MUST_USE;
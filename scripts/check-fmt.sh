@@ -2,4 +2,5 @@
 
 ./run-clang-format/run-clang-format.py \
     --exclude tests/build \
-    -r include src tests
+    --exclude bench/build \
+    -r include src tests bench
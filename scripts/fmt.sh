@@ -1,5 +1,5 @@
 #!/bin/bash
 
-find include src tests \
-    \( -path examples/build -o -path tests/build \) -prune -false -o \
+find include src tests bench \
+    \( -path examples/build -o -path tests/build -o -path bench/build \) -prune -false -o \
     \( -iname "*.h" \) -or \( -iname "*.c" \) | xargs clang-format -i
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+mkdir bench/build -p
+cd bench/build
+cmake ..
+cmake --build .
+./smolrtsp-replay "$@"
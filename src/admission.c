@@ -0,0 +1,314 @@
+#include <smolrtsp/admission.h>
+
+#include <smolrtsp/types/method.h>
+#include <smolrtsp/types/status_code.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#define US_PER_SEC UINT64_C(1000000)
+
+struct SmolRTSP_Admission {
+    SmolRTSP_AdmissionConfig config;
+
+    // Updated with atomics by the transports.
+    uint64_t packets_total, bytes_total;
+    uint64_t rejected;
+
+    // The state of the measurement, guarded by `mutex`.
+    pthread_mutex_t mutex;
+    uint64_t window_start_us, window_packets, window_bytes;
+    SmolRTSP_EgressRates rates;
+    uint64_t admitted;
+};
+
+typedef struct {
+    SmolRTSP_Transport transport;
+    SmolRTSP_Admission *admission;
+} SmolRTSP_MeteredTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_MeteredTransport);
+
+static uint64_t now_us(const SmolRTSP_Admission *self);
+static void update(SmolRTSP_Admission *self);
+static bool has_room(const SmolRTSP_Admission *self);
+static bool
+fits(uint64_t measured, uint64_t admitted, uint64_t estimate, uint64_t budget);
+
+SmolRTSP_AdmissionConfig SmolRTSP_AdmissionConfig_default(void) {
+    return (SmolRTSP_AdmissionConfig){
+        .max_bitrate = 0,
+        .max_packet_rate = 0,
+        .session_bitrate = 0,
+        .session_packet_rate = 0,
+        .window_us = SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US,
+        .clock_us = NULL,
+    };
+}
+
+SmolRTSP_Admission *SmolRTSP_Admission_new(SmolRTSP_AdmissionConfig config) {
+    assert(config.window_us > 0);
+
+    SmolRTSP_Admission *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->config = config;
+    self->packets_total = 0;
+    self->bytes_total = 0;
+    self->rejected = 0;
+
+    const int ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == ret);
+    (void)ret;
+
+    self->window_start_us = now_us(self);
+    self->window_packets = 0;
+    self->window_bytes = 0;
+    self->rates = (SmolRTSP_EgressRates){0, 0};
+    self->admitted = 0;
+
+    return self;
+}
+
+void SmolRTSP_Admission_record(
+    SmolRTSP_Admission *self, uint64_t packets_count, uint64_t bytes) {
+    assert(self);
+
+    __atomic_fetch_add(&self->packets_total, packets_count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&self->bytes_total, bytes, __ATOMIC_RELAXED);
+}
+
+SmolRTSP_EgressRates SmolRTSP_Admission_rates(SmolRTSP_Admission *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    update(self);
+    const SmolRTSP_EgressRates rates = self->rates;
+    pthread_mutex_unlock(&self->mutex);
+
+    return rates;
+}
+
+bool SmolRTSP_Admission_is_over_budget(SmolRTSP_Admission *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    update(self);
+    const bool is_over_budget = !has_room(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return is_over_budget;
+}
+
+bool SmolRTSP_Admission_try_admit(SmolRTSP_Admission *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    update(self);
+    const bool is_admitted = has_room(self);
+    if (is_admitted) {
+        self->admitted++;
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return is_admitted;
+}
+
+uint64_t SmolRTSP_Admission_rejected(const SmolRTSP_Admission *self) {
+    assert(self);
+    return __atomic_load_n(&self->rejected, __ATOMIC_RELAXED);
+}
+
+static void SmolRTSP_Admission_drop(VSelf) {
+    VSELF(SmolRTSP_Admission);
+    assert(self);
+
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Admission);
+
+SmolRTSP_ControlFlow smolrtsp_admission_check(
+    SmolRTSP_Admission *self, SmolRTSP_Context *ctx,
+    const SmolRTSP_Request *restrict req) {
+    assert(self);
+    assert(ctx);
+    assert(req);
+
+    bool is_admitted;
+    switch (SmolRTSP_MethodId_from_method(req->start_line.method)) {
+    case SmolRTSP_MethodId_Setup:
+        is_admitted = !SmolRTSP_Admission_is_over_budget(self);
+        break;
+    case SmolRTSP_MethodId_Play:
+        is_admitted = SmolRTSP_Admission_try_admit(self);
+        break;
+    default:
+        return SmolRTSP_ControlFlow_Continue;
+    }
+
+    if (is_admitted) {
+        return SmolRTSP_ControlFlow_Continue;
+    }
+
+    __atomic_fetch_add(&self->rejected, 1, __ATOMIC_RELAXED);
+    smolrtsp_respond(
+        ctx, SMOLRTSP_STATUS_NOT_ENOUGH_BANDWIDTH, "Not Enough Bandwidth");
+
+    return SmolRTSP_ControlFlow_Break;
+}
+
+SmolRTSP_Transport smolrtsp_transport_metered(
+    SmolRTSP_Transport t, SmolRTSP_Admission *admission) {
+    assert(t.self && t.vptr);
+    assert(admission);
+
+    SmolRTSP_MeteredTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->transport = t;
+    self->admission = admission;
+
+    return DYN(SmolRTSP_MeteredTransport, SmolRTSP_Transport, self);
+}
+
+static void SmolRTSP_MeteredTransport_drop(VSelf) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    VCALL_SUPER(self->transport, SmolRTSP_Droppable, drop);
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_MeteredTransport);
+
+static int
+SmolRTSP_MeteredTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    const int ret = VCALL(self->transport, transmit, bufs);
+    if (ret != -1) {
+        SmolRTSP_Admission_record(
+            self->admission, 1, SmolRTSP_IoVecSlice_len(bufs));
+    }
+
+    return ret;
+}
+
+#define SmolRTSP_MeteredTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_MeteredTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    const ssize_t ret = VCALL(self->transport, transmit_batch, batch);
+    if (ret > 0) {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < (size_t)ret; i++) {
+            bytes += SmolRTSP_IoVecSlice_len(batch.ptr[i]);
+        }
+        SmolRTSP_Admission_record(self->admission, (uint64_t)ret, bytes);
+    }
+
+    return ret;
+}
+
+static bool SmolRTSP_MeteredTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    return VCALL(self->transport, is_full);
+}
+
+#define SmolRTSP_MeteredTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_MeteredTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    return VCALL(self->transport, max_packet_size);
+}
+
+#define SmolRTSP_MeteredTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_MeteredTransport_stats(VSelf) {
+    VSELF(SmolRTSP_MeteredTransport);
+    assert(self);
+
+    return VCALL(self->transport, stats);
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_MeteredTransport);
+
+static uint64_t now_us(const SmolRTSP_Admission *self) {
+    if (self->config.clock_us != NULL) {
+        return self->config.clock_us();
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * US_PER_SEC + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Closes the current window if it has elapsed. The sessions admitted within it
+// are reflected in the rates from now on.
+static void update(SmolRTSP_Admission *self) {
+    const uint64_t now = now_us(self),
+                   elapsed = now - self->window_start_us;
+    if (elapsed < self->config.window_us) {
+        return;
+    }
+
+    const uint64_t packets =
+                       __atomic_load_n(&self->packets_total, __ATOMIC_RELAXED),
+                   bytes =
+                       __atomic_load_n(&self->bytes_total, __ATOMIC_RELAXED);
+
+    self->rates = (SmolRTSP_EgressRates){
+        .bitrate = (bytes - self->window_bytes) * 8 * US_PER_SEC / elapsed,
+        .packet_rate = (packets - self->window_packets) * US_PER_SEC / elapsed,
+    };
+
+    self->window_start_us = now;
+    self->window_packets = packets;
+    self->window_bytes = bytes;
+    self->admitted = 0;
+}
+
+static bool has_room(const SmolRTSP_Admission *self) {
+    const SmolRTSP_AdmissionConfig *config = &self->config;
+
+    return fits(
+               self->rates.bitrate, self->admitted, config->session_bitrate,
+               config->max_bitrate) &&
+           fits(
+               self->rates.packet_rate, self->admitted,
+               config->session_packet_rate, config->max_packet_rate);
+}
+
+// Whether one more session fits into `budget` on top of the `measured` rate
+// and `admitted` sessions estimated at `estimate` each.
+static bool
+fits(uint64_t measured, uint64_t admitted, uint64_t estimate, uint64_t budget) {
+    if (0 == budget) {
+        return true;
+    }
+
+    const uint64_t projected = measured + admitted * estimate;
+    return projected < budget && projected + estimate <= budget;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+
+// The allocation functions of the library, which go through the allocator set
+// by `smolrtsp_set_allocator`.
+
+void *smolrtsp_malloc(size_t size);
+void *smolrtsp_calloc(size_t count, size_t size);
+void *smolrtsp_realloc(void *ptr, size_t size);
+void smolrtsp_free(void *ptr);
+
+// The alignment of the objects placed one after another into a single
+// allocation, as guaranteed by `malloc` for any fundamental type.
+#define SMOLRTSP_ALLOC_ALIGNMENT 16
+
+// Rounds `size` up to a multiple of `SMOLRTSP_ALLOC_ALIGNMENT`.
+#define SMOLRTSP_ALLOC_ALIGN(size)                                             \
+    (((size) + SMOLRTSP_ALLOC_ALIGNMENT - 1) &                                 \
+     ~(size_t)(SMOLRTSP_ALLOC_ALIGNMENT - 1))
@@ -0,0 +1,319 @@
+#include <smolrtsp/allocator.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *libc_malloc(void *user_data, size_t size);
+static void *libc_realloc(void *user_data, void *ptr, size_t size);
+static void libc_free(void *user_data, void *ptr);
+
+static void *pools_malloc(void *user_data, size_t size);
+static void *pools_realloc(void *user_data, void *ptr, size_t size);
+static void pools_free(void *user_data, void *ptr);
+
+static void lock_pools(SmolRTSP_Pools *self);
+static void unlock_pools(SmolRTSP_Pools *self);
+static size_t class_of(const SmolRTSP_Pools *self, const void *ptr);
+
+#ifdef SMOLRTSP_STATIC_POOLS
+
+// The numbers of blocks of the classes, set by the `SMOLRTSP_POOL_BLOCKS`
+// CMake option.
+#ifndef SMOLRTSP_POOL_BLOCKS_0
+#define SMOLRTSP_POOL_BLOCKS_0 256
+#define SMOLRTSP_POOL_BLOCKS_1 128
+#define SMOLRTSP_POOL_BLOCKS_2 64
+#define SMOLRTSP_POOL_BLOCKS_3 32
+#define SMOLRTSP_POOL_BLOCKS_4 16
+#define SMOLRTSP_POOL_BLOCKS_5 4
+#define SMOLRTSP_POOL_BLOCKS_6 2
+#define SMOLRTSP_POOL_BLOCKS_7 0
+#endif
+
+#define B0 SMOLRTSP_POOL_BLOCKS_0
+#define B1 SMOLRTSP_POOL_BLOCKS_1
+#define B2 SMOLRTSP_POOL_BLOCKS_2
+#define B3 SMOLRTSP_POOL_BLOCKS_3
+#define B4 SMOLRTSP_POOL_BLOCKS_4
+#define B5 SMOLRTSP_POOL_BLOCKS_5
+#define B6 SMOLRTSP_POOL_BLOCKS_6
+#define B7 SMOLRTSP_POOL_BLOCKS_7
+
+// A class of `n` blocks after those of the blocks listed in `...`.
+#define STATIC_POOL_CLASS(n, ...)                                              \
+    {                                                                          \
+        .offset = SMOLRTSP_POOLS_ARENA_SIZE(__VA_ARGS__), .blocks = (n),       \
+        .unused = (n), .used = 0, .peak = 0, .failures = 0, .free_list = NULL, \
+    }
+
+#define STATIC_ARENA_SIZE                                                      \
+    SMOLRTSP_POOLS_ARENA_SIZE(B0, B1, B2, B3, B4, B5, B6, B7)
+
+// One byte more, so that the array is not empty if all the classes are.
+static union {
+    uint8_t bytes[STATIC_ARENA_SIZE + 1];
+    long double align;
+} static_arena;
+
+// Initialized statically, so that the library needs no setup.
+static SmolRTSP_Pools static_pools = {
+    .arena = static_arena.bytes,
+    .size = STATIC_ARENA_SIZE,
+    .classes =
+        {
+            STATIC_POOL_CLASS(B0, 0, 0, 0, 0, 0, 0, 0, 0),
+            STATIC_POOL_CLASS(B1, B0, 0, 0, 0, 0, 0, 0, 0),
+            STATIC_POOL_CLASS(B2, B0, B1, 0, 0, 0, 0, 0, 0),
+            STATIC_POOL_CLASS(B3, B0, B1, B2, 0, 0, 0, 0, 0),
+            STATIC_POOL_CLASS(B4, B0, B1, B2, B3, 0, 0, 0, 0),
+            STATIC_POOL_CLASS(B5, B0, B1, B2, B3, B4, 0, 0, 0),
+            STATIC_POOL_CLASS(B6, B0, B1, B2, B3, B4, B5, 0, 0),
+            STATIC_POOL_CLASS(B7, B0, B1, B2, B3, B4, B5, B6, 0),
+        },
+    .locked = false,
+};
+
+SmolRTSP_Pools *smolrtsp_static_pools(void) {
+    return &static_pools;
+}
+
+static SmolRTSP_Allocator allocator = {
+    .malloc = pools_malloc,
+    .realloc = pools_realloc,
+    .free = pools_free,
+    .user_data = &static_pools,
+};
+
+#else
+
+static SmolRTSP_Allocator allocator = {
+    .malloc = libc_malloc,
+    .realloc = libc_realloc,
+    .free = libc_free,
+    .user_data = NULL,
+};
+
+#endif
+
+SmolRTSP_Allocator SmolRTSP_Allocator_libc(void) {
+    return (SmolRTSP_Allocator){
+        .malloc = libc_malloc,
+        .realloc = libc_realloc,
+        .free = libc_free,
+        .user_data = NULL,
+    };
+}
+
+void smolrtsp_set_allocator(SmolRTSP_Allocator a) {
+    assert(a.malloc && a.realloc && a.free);
+    allocator = a;
+}
+
+SmolRTSP_Allocator smolrtsp_allocator(void) {
+    return allocator;
+}
+
+void *smolrtsp_malloc(size_t size) {
+    return allocator.malloc(allocator.user_data, size);
+}
+
+void *smolrtsp_calloc(size_t count, size_t size) {
+    if (size > 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void *ptr = smolrtsp_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+void *smolrtsp_realloc(void *ptr, size_t size) {
+    if (NULL == ptr) {
+        return smolrtsp_malloc(size);
+    }
+
+    return allocator.realloc(allocator.user_data, ptr, size);
+}
+
+void smolrtsp_free(void *ptr) {
+    if (ptr != NULL) {
+        allocator.free(allocator.user_data, ptr);
+    }
+}
+
+static void *libc_malloc(void *user_data, size_t size) {
+    (void)user_data;
+    return malloc(size);
+}
+
+static void *libc_realloc(void *user_data, void *ptr, size_t size) {
+    (void)user_data;
+    return realloc(ptr, size);
+}
+
+static void libc_free(void *user_data, void *ptr) {
+    (void)user_data;
+    free(ptr);
+}
+
+int SmolRTSP_Pools_init(
+    SmolRTSP_Pools *self, void *arena, size_t size,
+    const size_t blocks[SMOLRTSP_POOL_CLASSES]) {
+    assert(self);
+    assert(arena);
+    assert(0 == (uintptr_t)arena % SMOLRTSP_POOL_ALIGNMENT);
+    assert(blocks);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < SMOLRTSP_POOL_CLASSES; i++) {
+        const size_t block_size = SMOLRTSP_POOL_BLOCK_SIZE(i);
+        if (blocks[i] > (size - offset) / block_size) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        self->classes[i] = (SmolRTSP_PoolClass){
+            .offset = offset,
+            .blocks = blocks[i],
+            .unused = blocks[i],
+            .used = 0,
+            .peak = 0,
+            .failures = 0,
+            .free_list = NULL,
+        };
+        offset += blocks[i] * block_size;
+    }
+
+    self->arena = arena;
+    self->size = offset;
+    self->locked = false;
+
+    return 0;
+}
+
+SmolRTSP_PoolStats SmolRTSP_Pools_stats(SmolRTSP_Pools *self, size_t i) {
+    assert(self);
+    assert(i < SMOLRTSP_POOL_CLASSES);
+
+    lock_pools(self);
+    const SmolRTSP_PoolClass *c = &self->classes[i];
+    const SmolRTSP_PoolStats stats = {
+        .block_size = SMOLRTSP_POOL_BLOCK_SIZE(i),
+        .blocks = c->blocks,
+        .used = c->used,
+        .peak = c->peak,
+        .failures = c->failures,
+    };
+    unlock_pools(self);
+
+    return stats;
+}
+
+SmolRTSP_Allocator SmolRTSP_Allocator_pools(SmolRTSP_Pools *pools) {
+    assert(pools);
+
+    return (SmolRTSP_Allocator){
+        .malloc = pools_malloc,
+        .realloc = pools_realloc,
+        .free = pools_free,
+        .user_data = pools,
+    };
+}
+
+static void *pools_malloc(void *user_data, size_t size) {
+    SmolRTSP_Pools *self = user_data;
+
+    size_t i = 0;
+    while (i < SMOLRTSP_POOL_CLASSES && SMOLRTSP_POOL_BLOCK_SIZE(i) < size) {
+        i++;
+    }
+    if (SMOLRTSP_POOL_CLASSES == i) {
+        return NULL;
+    }
+
+    lock_pools(self);
+
+    SmolRTSP_PoolClass *c = &self->classes[i];
+    void *block = NULL;
+    if (c->free_list != NULL) {
+        block = c->free_list;
+        memcpy(&c->free_list, block, sizeof c->free_list);
+    } else if (c->unused > 0) {
+        block = self->arena + c->offset +
+                (c->blocks - c->unused) * SMOLRTSP_POOL_BLOCK_SIZE(i);
+        c->unused--;
+    }
+
+    if (NULL == block) {
+        c->failures++;
+    } else if (++c->used > c->peak) {
+        c->peak = c->used;
+    }
+
+    unlock_pools(self);
+
+    return block;
+}
+
+static void *pools_realloc(void *user_data, void *ptr, size_t size) {
+    SmolRTSP_Pools *self = user_data;
+
+    const size_t block_size = SMOLRTSP_POOL_BLOCK_SIZE(class_of(self, ptr));
+    if (size <= block_size) {
+        return ptr;
+    }
+
+    void *block = pools_malloc(self, size);
+    if (NULL == block) {
+        return NULL;
+    }
+
+    memcpy(block, ptr, block_size);
+    pools_free(self, ptr);
+
+    return block;
+}
+
+static void pools_free(void *user_data, void *ptr) {
+    SmolRTSP_Pools *self = user_data;
+    SmolRTSP_PoolClass *c = &self->classes[class_of(self, ptr)];
+
+    lock_pools(self);
+    memcpy(ptr, &c->free_list, sizeof c->free_list);
+    c->free_list = ptr;
+    c->used--;
+    unlock_pools(self);
+}
+
+// The critical sections are a few instructions long, so a spinlock keeps
+// `SmolRTSP_Pools` free of platform types.
+static void lock_pools(SmolRTSP_Pools *self) {
+    while (__atomic_test_and_set(&self->locked, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static void unlock_pools(SmolRTSP_Pools *self) {
+    __atomic_clear(&self->locked, __ATOMIC_RELEASE);
+}
+
+static size_t class_of(const SmolRTSP_Pools *self, const void *ptr) {
+    const size_t offset = (size_t)((const uint8_t *)ptr - self->arena);
+    assert(offset < self->size);
+
+    size_t i = SMOLRTSP_POOL_CLASSES - 1;
+    while (offset < self->classes[i].offset) {
+        i--;
+    }
+    assert(0 == (offset - self->classes[i].offset) %
+                    SMOLRTSP_POOL_BLOCK_SIZE(i));
+
+    return i;
+}
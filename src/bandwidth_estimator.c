@@ -0,0 +1,576 @@
+#include <smolrtsp/bandwidth_estimator.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+// The packets sent within this interval after the first one of a group form
+// the group, which is treated as a single burst.
+#define BURST_US 5000
+
+// The trendline filter (draft-ietf-rmcat-gcc-02, section 5.3, as refined in
+// libwebrtc): the smoothing coefficient of the accumulated delay, the number
+// of points fitted, the gain of the slope, and the cap of the number of
+// deltas it is multiplied by.
+#define TRENDLINE_SMOOTHING  0.9
+#define TRENDLINE_WINDOW     20
+#define TRENDLINE_GAIN       4.0
+#define TRENDLINE_MAX_DELTAS 60
+
+// The adaptive threshold of the trend, in milliseconds (section 5.4).
+#define THRESHOLD_INITIAL_MS 12.5
+#define THRESHOLD_MIN_MS     6.0
+#define THRESHOLD_MAX_MS     600.0
+#define THRESHOLD_K_UP       0.0087
+#define THRESHOLD_K_DOWN     0.039
+#define THRESHOLD_MAX_JUMP   15.0
+#define THRESHOLD_MAX_DT_MS  100.0
+
+// The time the trend must stay over the threshold to signal overuse.
+#define OVERUSE_TIME_MS 10.0
+
+// The AIMD rate controller (section 5.5): the increase per second, the
+// fraction of the acknowledged rate to decrease to, the headroom above the
+// acknowledged rate, and the minimum interval between decreases (about an
+// RTT).
+#define INCREASE_PER_SECOND    0.08
+#define DECREASE_FACTOR        0.85
+#define MAX_ACKED_RATIO        1.5
+#define MAX_ACKED_HEADROOM     10000
+#define MIN_INCREASE           1000
+#define DECREASE_INTERVAL_US   200000
+#define MAX_INCREASE_PERIOD_US 1000000
+
+// The interval over which the acknowledged rate is measured.
+#define ACKED_WINDOW_US 500000
+
+// The loss-based controller (section 6): the interval and the number of
+// packets over which the loss is measured, and its thresholds.
+#define LOSS_INTERVAL_US    100000
+#define LOSS_MIN_PACKETS    20
+#define LOSS_HIGH           0.1
+#define LOSS_LOW            0.02
+#define LOSS_INCREASE_RATIO 1.05
+
+typedef struct {
+    uint16_t seq_num;
+    bool sent, acked;
+    size_t size;
+    uint64_t send_us;
+} Slot;
+
+typedef struct {
+    bool valid;
+    uint64_t first_send_us, last_send_us;
+    int64_t last_arrival_us;
+} PacketGroup;
+
+typedef enum {
+    RateControlState_Hold,
+    RateControlState_Increase,
+    RateControlState_Decrease,
+} RateControlState;
+
+struct SmolRTSP_BandwidthEstimator {
+    SmolRTSP_BandwidthEstimatorConfig config;
+
+    // The packet of the sequence number `s` is `slots[s & mask]`.
+    Slot *slots;
+    SmolRTSP_RtcpPacketStatus *statuses;
+    size_t mask;
+
+    // The inter-group delay variation.
+    PacketGroup group, prev_group;
+    bool started;
+    int64_t first_arrival_us;
+
+    // The trendline filter: the points of the window are
+    // `[window_start; window_start + window_len)` modulo the window size.
+    double accumulated_delay_ms, smoothed_delay_ms;
+    double window_x[TRENDLINE_WINDOW], window_y[TRENDLINE_WINDOW];
+    size_t window_start, window_len, deltas;
+
+    // The overuse detector.
+    double threshold_ms, prev_trend, time_over_using_ms;
+    int64_t threshold_updated_ms;
+    bool threshold_started;
+    size_t overuse_count;
+    SmolRTSP_BandwidthUsage usage;
+
+    // The AIMD rate controller.
+    RateControlState state;
+    uint64_t delay_based_bitrate, rate_updated_us, decreased_us;
+    bool decreased;
+
+    // The acknowledged rate over `ACKED_WINDOW_US` of arrivals.
+    uint64_t acked_bitrate, acked_bytes;
+    int64_t acked_window_start_us;
+    bool acked_window_started;
+
+    // The loss-based controller.
+    uint64_t loss_based_bitrate, loss_updated_us;
+    size_t loss_lost, loss_total;
+    uint8_t fraction_lost;
+
+    uint64_t feedbacks, packets_acked, packets_lost;
+};
+
+static void on_packet_arrival(
+    SmolRTSP_BandwidthEstimator *self, const Slot *slot, int64_t arrival_us);
+static void update_trendline(
+    SmolRTSP_BandwidthEstimator *self, double delay_delta_ms,
+    double send_delta_ms, int64_t arrival_us);
+static double trendline_slope(const SmolRTSP_BandwidthEstimator *self);
+static void detect_overuse(
+    SmolRTSP_BandwidthEstimator *self, double trend, double send_delta_ms,
+    int64_t now_ms);
+static void update_threshold(
+    SmolRTSP_BandwidthEstimator *self, double trend, int64_t now_ms);
+static void update_delay_based(
+    SmolRTSP_BandwidthEstimator *self, uint64_t time_us);
+static void
+update_loss_based(SmolRTSP_BandwidthEstimator *self, uint64_t time_us);
+static uint64_t
+clamp_bitrate(const SmolRTSP_BandwidthEstimator *self, double bitrate);
+static double abs_double(double x);
+
+SmolRTSP_BandwidthEstimatorConfig
+SmolRTSP_BandwidthEstimatorConfig_default(void) {
+    return (SmolRTSP_BandwidthEstimatorConfig){
+        .initial_bitrate = SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE,
+        .min_bitrate = SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MIN_BITRATE,
+        .max_bitrate = SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MAX_BITRATE,
+        .history_size = SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_HISTORY_SIZE,
+    };
+}
+
+SmolRTSP_BandwidthEstimator *
+SmolRTSP_BandwidthEstimator_new(SmolRTSP_BandwidthEstimatorConfig config) {
+    assert(config.min_bitrate > 0);
+    assert(config.min_bitrate <= config.initial_bitrate);
+    assert(config.initial_bitrate <= config.max_bitrate);
+    assert(config.history_size >= 2 && config.history_size <= 32768);
+    assert(0 == (config.history_size & (config.history_size - 1)));
+
+    SmolRTSP_BandwidthEstimator *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    Slot *slots = smolrtsp_calloc(config.history_size, sizeof slots[0]);
+    SmolRTSP_RtcpPacketStatus *statuses =
+        smolrtsp_malloc(config.history_size * sizeof statuses[0]);
+    if (NULL == slots || NULL == statuses) {
+        smolrtsp_free(slots);
+        smolrtsp_free(statuses);
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset(self, 0, sizeof *self);
+    self->config = config;
+    self->slots = slots;
+    self->statuses = statuses;
+    self->mask = config.history_size - 1;
+    self->threshold_ms = THRESHOLD_INITIAL_MS;
+    self->time_over_using_ms = -1;
+    self->usage = SmolRTSP_BandwidthUsage_Normal;
+    self->state = RateControlState_Hold;
+    self->delay_based_bitrate = config.initial_bitrate;
+    self->loss_based_bitrate = config.initial_bitrate;
+
+    return self;
+}
+
+static void SmolRTSP_BandwidthEstimator_drop(VSelf) {
+    VSELF(SmolRTSP_BandwidthEstimator);
+    assert(self);
+
+    smolrtsp_free(self->slots);
+    smolrtsp_free(self->statuses);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_BandwidthEstimator);
+
+void SmolRTSP_BandwidthEstimator_on_packet_sent(
+    SmolRTSP_BandwidthEstimator *self, uint16_t transport_wide_seq_num,
+    size_t size, uint64_t time_us) {
+    assert(self);
+
+    self->slots[transport_wide_seq_num & self->mask] = (Slot){
+        .seq_num = transport_wide_seq_num,
+        .sent = true,
+        .acked = false,
+        .size = size,
+        .send_us = time_us,
+    };
+}
+
+int SmolRTSP_BandwidthEstimator_on_feedback(
+    SmolRTSP_BandwidthEstimator *self, SmolRTSP_RtcpPacket packet,
+    uint64_t time_us) {
+    assert(self);
+
+    // The statuses beyond the history cannot be matched anyway.
+    SmolRTSP_RtcpTransportFeedback feedback;
+    if (SmolRTSP_RtcpPacket_transport_feedback(
+            packet, &feedback, self->statuses, self->mask + 1) == -1) {
+        return -1;
+    }
+
+    const size_t count = feedback.status_count < self->mask + 1
+                             ? feedback.status_count
+                             : self->mask + 1;
+    for (size_t i = 0; i < count; i++) {
+        const SmolRTSP_RtcpPacketStatus status = self->statuses[i];
+        Slot *slot = &self->slots[status.seq_num & self->mask];
+        if (!slot->sent || slot->seq_num != status.seq_num || slot->acked) {
+            continue;
+        }
+
+        self->loss_total++;
+        if (!status.received) {
+            // A later feedback may still report it received.
+            self->loss_lost++;
+            self->packets_lost++;
+            continue;
+        }
+
+        slot->acked = true;
+        self->packets_acked++;
+        on_packet_arrival(self, slot, status.arrival_us);
+    }
+
+    update_delay_based(self, time_us);
+    update_loss_based(self, time_us);
+    self->feedbacks++;
+
+    return 0;
+}
+
+uint64_t SmolRTSP_BandwidthEstimator_target_bitrate(
+    const SmolRTSP_BandwidthEstimator *self) {
+    assert(self);
+
+    const uint64_t bitrate =
+        self->delay_based_bitrate < self->loss_based_bitrate
+            ? self->delay_based_bitrate
+            : self->loss_based_bitrate;
+    return clamp_bitrate(self, (double)bitrate);
+}
+
+SmolRTSP_BandwidthEstimatorStats
+SmolRTSP_BandwidthEstimator_stats(const SmolRTSP_BandwidthEstimator *self) {
+    assert(self);
+
+    return (SmolRTSP_BandwidthEstimatorStats){
+        .target_bitrate = SmolRTSP_BandwidthEstimator_target_bitrate(self),
+        .delay_based_bitrate = self->delay_based_bitrate,
+        .loss_based_bitrate = self->loss_based_bitrate,
+        .acked_bitrate = self->acked_bitrate,
+        .usage = self->usage,
+        .fraction_lost = self->fraction_lost,
+        .feedbacks = self->feedbacks,
+        .packets_acked = self->packets_acked,
+        .packets_lost = self->packets_lost,
+    };
+}
+
+static void on_packet_arrival(
+    SmolRTSP_BandwidthEstimator *self, const Slot *slot, int64_t arrival_us) {
+    if (!self->acked_window_started) {
+        self->acked_window_started = true;
+        self->acked_window_start_us = arrival_us;
+    }
+    self->acked_bytes += slot->size;
+    if (arrival_us - self->acked_window_start_us >= ACKED_WINDOW_US) {
+        self->acked_bitrate =
+            self->acked_bytes * 8 * 1000000 /
+            (uint64_t)(arrival_us - self->acked_window_start_us);
+        self->acked_window_start_us = arrival_us;
+        self->acked_bytes = 0;
+    }
+
+    if (!self->started) {
+        self->started = true;
+        self->first_arrival_us = arrival_us;
+    }
+
+    PacketGroup *group = &self->group;
+    if (!group->valid) {
+        *group = (PacketGroup){
+            .valid = true,
+            .first_send_us = slot->send_us,
+            .last_send_us = slot->send_us,
+            .last_arrival_us = arrival_us,
+        };
+        return;
+    }
+
+    // A reordered packet of a finished group.
+    if (slot->send_us < group->first_send_us) {
+        return;
+    }
+
+    if (slot->send_us - group->first_send_us <= BURST_US) {
+        if (slot->send_us > group->last_send_us) {
+            group->last_send_us = slot->send_us;
+        }
+        if (arrival_us > group->last_arrival_us) {
+            group->last_arrival_us = arrival_us;
+        }
+        return;
+    }
+
+    if (self->prev_group.valid) {
+        const PacketGroup *prev = &self->prev_group;
+        const double send_delta_ms =
+            (double)(group->last_send_us - prev->last_send_us) / 1000;
+        const double arrival_delta_ms =
+            (double)(group->last_arrival_us - prev->last_arrival_us) / 1000;
+        update_trendline(
+            self, arrival_delta_ms - send_delta_ms, send_delta_ms,
+            group->last_arrival_us);
+    }
+
+    self->prev_group = *group;
+    *group = (PacketGroup){
+        .valid = true,
+        .first_send_us = slot->send_us,
+        .last_send_us = slot->send_us,
+        .last_arrival_us = arrival_us,
+    };
+}
+
+static void update_trendline(
+    SmolRTSP_BandwidthEstimator *self, double delay_delta_ms,
+    double send_delta_ms, int64_t arrival_us) {
+    if (self->deltas < TRENDLINE_MAX_DELTAS) {
+        self->deltas++;
+    }
+
+    self->accumulated_delay_ms += delay_delta_ms;
+    self->smoothed_delay_ms =
+        TRENDLINE_SMOOTHING * self->smoothed_delay_ms +
+        (1 - TRENDLINE_SMOOTHING) * self->accumulated_delay_ms;
+
+    size_t i;
+    if (self->window_len < TRENDLINE_WINDOW) {
+        i = (self->window_start + self->window_len++) % TRENDLINE_WINDOW;
+    } else {
+        i = self->window_start;
+        self->window_start = (self->window_start + 1) % TRENDLINE_WINDOW;
+    }
+    self->window_x[i] = (double)(arrival_us - self->first_arrival_us) / 1000;
+    self->window_y[i] = self->smoothed_delay_ms;
+
+    double trend = self->prev_trend;
+    if (TRENDLINE_WINDOW == self->window_len) {
+        trend = (double)self->deltas * trendline_slope(self) * TRENDLINE_GAIN;
+    }
+
+    detect_overuse(self, trend, send_delta_ms, arrival_us / 1000);
+}
+
+// The slope of the least squares fit of the window.
+static double trendline_slope(const SmolRTSP_BandwidthEstimator *self) {
+    double sum_x = 0, sum_y = 0;
+    for (size_t i = 0; i < self->window_len; i++) {
+        sum_x += self->window_x[i];
+        sum_y += self->window_y[i];
+    }
+    const double mean_x = sum_x / (double)self->window_len,
+                 mean_y = sum_y / (double)self->window_len;
+
+    double numerator = 0, denominator = 0;
+    for (size_t i = 0; i < self->window_len; i++) {
+        const double dx = self->window_x[i] - mean_x;
+        numerator += dx * (self->window_y[i] - mean_y);
+        denominator += dx * dx;
+    }
+
+    return 0 == denominator ? 0 : numerator / denominator;
+}
+
+static void detect_overuse(
+    SmolRTSP_BandwidthEstimator *self, double trend, double send_delta_ms,
+    int64_t now_ms) {
+    if (self->deltas < 2) {
+        return;
+    }
+
+    if (trend > self->threshold_ms) {
+        if (self->time_over_using_ms < 0) {
+            // The trend has crossed the threshold about halfway between the
+            // groups.
+            self->time_over_using_ms = send_delta_ms / 2;
+        } else {
+            self->time_over_using_ms += send_delta_ms;
+        }
+        self->overuse_count++;
+
+        if (self->time_over_using_ms > OVERUSE_TIME_MS &&
+            self->overuse_count > 1 && trend >= self->prev_trend) {
+            self->time_over_using_ms = 0;
+            self->overuse_count = 0;
+            self->usage = SmolRTSP_BandwidthUsage_Overusing;
+        }
+    } else if (trend < -self->threshold_ms) {
+        self->time_over_using_ms = -1;
+        self->overuse_count = 0;
+        self->usage = SmolRTSP_BandwidthUsage_Underusing;
+    } else {
+        self->time_over_using_ms = -1;
+        self->overuse_count = 0;
+        self->usage = SmolRTSP_BandwidthUsage_Normal;
+    }
+
+    self->prev_trend = trend;
+    update_threshold(self, trend, now_ms);
+}
+
+// The threshold follows the trend, faster downwards, so that the detector
+// neither starves against concurrent TCP flows nor reacts to noise.
+static void update_threshold(
+    SmolRTSP_BandwidthEstimator *self, double trend, int64_t now_ms) {
+    if (!self->threshold_started) {
+        self->threshold_started = true;
+        self->threshold_updated_ms = now_ms;
+    }
+
+    const double magnitude = abs_double(trend);
+    if (magnitude > self->threshold_ms + THRESHOLD_MAX_JUMP) {
+        // A spike, e.g., a route change: do not adapt to it.
+        self->threshold_updated_ms = now_ms;
+        return;
+    }
+
+    const double k = magnitude < self->threshold_ms ? THRESHOLD_K_DOWN
+                                                     : THRESHOLD_K_UP;
+    double dt_ms = (double)(now_ms - self->threshold_updated_ms);
+    if (dt_ms > THRESHOLD_MAX_DT_MS) {
+        dt_ms = THRESHOLD_MAX_DT_MS;
+    } else if (dt_ms < 0) {
+        dt_ms = 0;
+    }
+
+    self->threshold_ms += k * (magnitude - self->threshold_ms) * dt_ms;
+    if (self->threshold_ms < THRESHOLD_MIN_MS) {
+        self->threshold_ms = THRESHOLD_MIN_MS;
+    } else if (self->threshold_ms > THRESHOLD_MAX_MS) {
+        self->threshold_ms = THRESHOLD_MAX_MS;
+    }
+    self->threshold_updated_ms = now_ms;
+}
+
+static void update_delay_based(
+    SmolRTSP_BandwidthEstimator *self, uint64_t time_us) {
+    switch (self->usage) {
+    case SmolRTSP_BandwidthUsage_Normal:
+        if (RateControlState_Hold == self->state) {
+            self->state = RateControlState_Increase;
+            self->rate_updated_us = time_us;
+        }
+        break;
+    case SmolRTSP_BandwidthUsage_Overusing:
+        self->state = RateControlState_Decrease;
+        break;
+    case SmolRTSP_BandwidthUsage_Underusing:
+        self->state = RateControlState_Hold;
+        break;
+    }
+
+    uint64_t bitrate = self->delay_based_bitrate;
+    switch (self->state) {
+    case RateControlState_Hold:
+        break;
+    case RateControlState_Increase: {
+        uint64_t period_us = time_us - self->rate_updated_us;
+        if (period_us > MAX_INCREASE_PERIOD_US) {
+            period_us = MAX_INCREASE_PERIOD_US;
+        }
+        double increased = (double)bitrate * INCREASE_PER_SECOND *
+                           (double)period_us / 1000000;
+        if (increased < MIN_INCREASE) {
+            increased = MIN_INCREASE;
+        }
+        increased += (double)bitrate;
+
+        // Do not run far ahead of what the receiver actually gets.
+        if (self->acked_bitrate > 0) {
+            const double max = MAX_ACKED_RATIO * (double)self->acked_bitrate +
+                               MAX_ACKED_HEADROOM;
+            if (increased > max) {
+                increased = (double)bitrate > max ? (double)bitrate : max;
+            }
+        }
+        bitrate = clamp_bitrate(self, increased);
+        break;
+    }
+    case RateControlState_Decrease:
+        if (!self->decreased ||
+            time_us - self->decreased_us >= DECREASE_INTERVAL_US) {
+            const uint64_t base = self->acked_bitrate > 0 ? self->acked_bitrate
+                                                          : bitrate;
+            const uint64_t decreased =
+                clamp_bitrate(self, DECREASE_FACTOR * (double)base);
+            if (decreased < bitrate) {
+                bitrate = decreased;
+            }
+            self->decreased = true;
+            self->decreased_us = time_us;
+        }
+        self->state = RateControlState_Hold;
+        break;
+    }
+
+    self->delay_based_bitrate = bitrate;
+    self->rate_updated_us = time_us;
+}
+
+static void
+update_loss_based(SmolRTSP_BandwidthEstimator *self, uint64_t time_us) {
+    if (self->loss_total < LOSS_MIN_PACKETS ||
+        time_us - self->loss_updated_us < LOSS_INTERVAL_US) {
+        return;
+    }
+
+    const double loss = (double)self->loss_lost / (double)self->loss_total;
+    self->fraction_lost = (uint8_t)(loss * 255);
+
+    if (loss > LOSS_HIGH) {
+        const double target =
+            (double)SmolRTSP_BandwidthEstimator_target_bitrate(self);
+        self->loss_based_bitrate =
+            clamp_bitrate(self, target * (1 - 0.5 * loss));
+    } else if (loss < LOSS_LOW) {
+        self->loss_based_bitrate = clamp_bitrate(
+            self, (double)self->loss_based_bitrate * LOSS_INCREASE_RATIO);
+    }
+
+    self->loss_lost = 0;
+    self->loss_total = 0;
+    self->loss_updated_us = time_us;
+}
+
+static uint64_t
+clamp_bitrate(const SmolRTSP_BandwidthEstimator *self, double bitrate) {
+    if (bitrate < (double)self->config.min_bitrate) {
+        return self->config.min_bitrate;
+    }
+    if (bitrate > (double)self->config.max_bitrate) {
+        return self->config.max_bitrate;
+    }
+
+    return (uint64_t)bitrate;
+}
+
+static double abs_double(double x) {
+    return x < 0 ? -x : x;
+}
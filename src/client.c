@@ -0,0 +1,962 @@
+#include <smolrtsp/client.h>
+
+#include <smolrtsp/rtp_depacketizer.h>
+#include <smolrtsp/types/header.h>
+#include <smolrtsp/types/method.h>
+#include <smolrtsp/types/request.h>
+#include <smolrtsp/types/response.h>
+#include <smolrtsp/util.h>
+#include <smolrtsp/writer.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// The maximum number of events handled per `epoll_wait`.
+#define MAX_EVENTS 64
+
+// The maximum size of a URI, including the null character.
+#define MAX_URI_SIZE 512
+
+// The maximum size of a session identifier, including the null character.
+#define MAX_SESSION_ID_SIZE 128
+
+// Enough for the `SETUP`s of all the tracks, `PLAY`, and a keep-alive.
+#define MAX_PENDING_REQUESTS (SMOLRTSP_CLIENT_MAX_TRACKS + 2)
+
+// Enough for a batch of pipelined requests with the longest URIs.
+#define BATCH_SIZE (MAX_PENDING_REQUESTS * (MAX_URI_SIZE + 256))
+
+#define INTERLEAVED_HEADER_SIZE 4
+
+typedef enum {
+    RequestKind_Describe,
+    RequestKind_Setup,
+    RequestKind_Play,
+    RequestKind_KeepAlive,
+    RequestKind_Teardown,
+} RequestKind;
+
+typedef struct {
+    uint32_t cseq;
+    RequestKind kind;
+    size_t track_id;
+} PendingRequest;
+
+typedef struct {
+    SmolRTSP_NalCodec codec;
+    char control[MAX_URI_SIZE];
+    SmolRTSP_RtpDepacketizer *depacketizer;
+} Track;
+
+struct SmolRTSP_ClientSession {
+    SmolRTSP_Client *client;
+    int fd;
+    SmolRTSP_ClientHandler handler;
+    SmolRTSP_ClientState state;
+
+    // `uri` is requested by `DESCRIBE`, `base` is the aggregate control URI
+    // for `PLAY` and the base of relative track controls.
+    char uri[MAX_URI_SIZE], base[MAX_URI_SIZE];
+    char session_id[MAX_SESSION_ID_SIZE];
+
+    Track tracks[SMOLRTSP_CLIENT_MAX_TRACKS];
+    size_t tracks_count, setup_count;
+
+    uint32_t next_cseq;
+    PendingRequest pending[MAX_PENDING_REQUESTS];
+    size_t pending_len;
+
+    SmolRTSP_NonblockingFdWriter out;
+    bool want_write;
+
+    char *in;
+    size_t in_len;
+
+    uint64_t next_keepalive_ms;
+
+    // The status code of the response that has failed the session, if any.
+    SmolRTSP_StatusCode fail_status;
+
+    // The other sessions of the same client.
+    SmolRTSP_ClientSession *prev, *next;
+};
+
+struct SmolRTSP_Client {
+    SmolRTSP_ClientConfig config;
+    int epoll_fd;
+    SmolRTSP_ClientSession *sessions;
+};
+
+static int handle_events(SmolRTSP_ClientSession *self, uint32_t events);
+static int handle_connected(SmolRTSP_ClientSession *self);
+static int handle_readable(SmolRTSP_ClientSession *self);
+static int handle_writable(SmolRTSP_ClientSession *self);
+static int process_input(SmolRTSP_ClientSession *self);
+static int
+handle_frame(SmolRTSP_ClientSession *self, uint8_t channel_id, U8Slice99 data);
+static int handle_response(
+    SmolRTSP_ClientSession *self, const SmolRTSP_Response *response);
+static int handle_description(
+    SmolRTSP_ClientSession *self, const SmolRTSP_Response *response);
+static int
+handle_setup(SmolRTSP_ClientSession *self, const SmolRTSP_Response *response);
+static int send_setups(SmolRTSP_ClientSession *self);
+static int send_request(
+    SmolRTSP_ClientSession *self, SmolRTSP_StringBuffer *batch,
+    RequestKind kind, size_t track_id);
+static int flush_batch(
+    SmolRTSP_ClientSession *self, const SmolRTSP_StringBuffer *batch);
+static void watch_writable(SmolRTSP_ClientSession *self, bool enable);
+static void
+fail(SmolRTSP_ClientSession *self, int error, SmolRTSP_StatusCode status);
+static void free_session(SmolRTSP_ClientSession *self);
+static int parse_sdp(SmolRTSP_ClientSession *self, CharSlice99 sdp);
+static int
+add_track(SmolRTSP_ClientSession *self, bool has_codec, bool has_control);
+static int
+resolve_uri(char dst[restrict], const char *restrict base, CharSlice99 uri);
+static int copy_str(char dst[restrict], size_t size, CharSlice99 src);
+static bool next_line(CharSlice99 *restrict input, CharSlice99 *restrict line);
+static bool
+starts_with_nocase(CharSlice99 s, const char *restrict prefix);
+static uint64_t now_ms(void);
+
+SmolRTSP_ClientConfig SmolRTSP_ClientConfig_default(void) {
+    return (SmolRTSP_ClientConfig){
+        .recv_buffer_size = 64 * 1024,
+        .send_buffer_size = 4096,
+        .max_nalu_size = 1024 * 1024,
+        .pipelining = true,
+        .keepalive_interval_ms = 30 * 1000,
+    };
+}
+
+SmolRTSP_Client *SmolRTSP_Client_new(SmolRTSP_ClientConfig config) {
+    assert(config.recv_buffer_size > 0);
+    assert(config.send_buffer_size > 0);
+    assert(config.max_nalu_size > 0);
+
+    SmolRTSP_Client *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->config = config;
+    self->sessions = NULL;
+    self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == self->epoll_fd) {
+        const int error = errno;
+        smolrtsp_free(self);
+        errno = error;
+        return NULL;
+    }
+
+    return self;
+}
+
+static void SmolRTSP_Client_drop(VSelf) {
+    VSELF(SmolRTSP_Client);
+    assert(self);
+
+    while (self->sessions != NULL) {
+        SmolRTSP_ClientSession_close(self->sessions);
+    }
+
+    close(self->epoll_fd);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Client);
+
+int SmolRTSP_Client_fd(const SmolRTSP_Client *self) {
+    assert(self);
+    return self->epoll_fd;
+}
+
+int SmolRTSP_Client_poll(SmolRTSP_Client *self, int timeout_ms) {
+    assert(self);
+
+    struct epoll_event events[MAX_EVENTS];
+    const int n = epoll_wait(self->epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (-1 == n) {
+        return EINTR == errno ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        SmolRTSP_ClientSession *session = events[i].data.ptr;
+        if (handle_events(session, events[i].events) == -1) {
+            fail(session, errno, session->fail_status);
+        }
+    }
+
+    const int interval = self->config.keepalive_interval_ms;
+    if (interval > 0) {
+        const uint64_t now = now_ms();
+
+        SmolRTSP_ClientSession *session = self->sessions;
+        while (session != NULL) {
+            SmolRTSP_ClientSession *next = session->next;
+
+            if (SmolRTSP_ClientState_Playing == session->state &&
+                now >= session->next_keepalive_ms) {
+                session->next_keepalive_ms = now + (uint64_t)interval;
+
+                char buffer[BATCH_SIZE];
+                SmolRTSP_StringBuffer batch =
+                    SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+                if (send_request(
+                        session, &batch, RequestKind_KeepAlive, 0) == -1 ||
+                    flush_batch(session, &batch) == -1) {
+                    fail(session, errno, 0);
+                }
+            }
+
+            session = next;
+        }
+    }
+
+    return n;
+}
+
+SmolRTSP_ClientSession *SmolRTSP_Client_open(
+    SmolRTSP_Client *self, const struct sockaddr *addr, socklen_t addr_len,
+    CharSlice99 uri, SmolRTSP_ClientHandler handler) {
+    assert(self);
+    assert(addr);
+    assert(handler.self && handler.vptr);
+
+    const SmolRTSP_ClientConfig *config = &self->config;
+
+    SmolRTSP_ClientSession *session = smolrtsp_malloc(
+        sizeof *session + config->recv_buffer_size + config->send_buffer_size);
+    if (NULL == session) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (copy_str(session->uri, sizeof session->uri, uri) == -1) {
+        smolrtsp_free(session);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    memcpy(session->base, session->uri, sizeof session->base);
+
+    const int fd = socket(
+        addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        const int error = errno;
+        smolrtsp_free(session);
+        errno = error;
+        return NULL;
+    }
+
+    session->client = self;
+    session->fd = fd;
+    session->handler = handler;
+    session->state = SmolRTSP_ClientState_Connecting;
+    session->session_id[0] = '\0';
+    session->tracks_count = 0;
+    session->setup_count = 0;
+    session->next_cseq = 1;
+    session->pending_len = 0;
+    session->in = (char *)(session + 1);
+    session->in_len = 0;
+    session->out = SmolRTSP_NonblockingFdWriter_new(
+        fd, session->in + config->recv_buffer_size, config->send_buffer_size);
+    session->want_write = true;
+    session->next_keepalive_ms = 0;
+    session->fail_status = 0;
+
+    // Writable once connected.
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT,
+        .data.ptr = session,
+    };
+    if ((connect(fd, addr, addr_len) == -1 && errno != EINPROGRESS) ||
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        const int error = errno;
+        close(fd);
+        smolrtsp_free(session);
+        errno = error;
+        return NULL;
+    }
+
+    session->prev = NULL;
+    session->next = self->sessions;
+    if (self->sessions != NULL) {
+        self->sessions->prev = session;
+    }
+    self->sessions = session;
+
+    return session;
+}
+
+void SmolRTSP_ClientSession_close(SmolRTSP_ClientSession *self) {
+    assert(self);
+
+    if (SmolRTSP_ClientState_Playing == self->state) {
+        char buffer[BATCH_SIZE];
+        SmolRTSP_StringBuffer batch =
+            SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+        if (send_request(self, &batch, RequestKind_Teardown, 0) == 0) {
+            // The best effort: the connection is closed right away.
+            (void)flush_batch(self, &batch);
+        }
+    }
+
+    free_session(self);
+}
+
+SmolRTSP_ClientState
+SmolRTSP_ClientSession_state(const SmolRTSP_ClientSession *self) {
+    assert(self);
+    return self->state;
+}
+
+size_t
+SmolRTSP_ClientSession_tracks_count(const SmolRTSP_ClientSession *self) {
+    assert(self);
+    return self->tracks_count;
+}
+
+SmolRTSP_NalCodec SmolRTSP_ClientSession_track_codec(
+    const SmolRTSP_ClientSession *self, size_t track_id) {
+    assert(self);
+    assert(track_id < self->tracks_count);
+
+    return self->tracks[track_id].codec;
+}
+
+static int handle_events(SmolRTSP_ClientSession *self, uint32_t events) {
+    if (SmolRTSP_ClientState_Connecting == self->state) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return 0;
+        }
+        return handle_connected(self);
+    }
+
+    if ((events & EPOLLOUT) && handle_writable(self) == -1) {
+        return -1;
+    }
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        return handle_readable(self);
+    }
+
+    return 0;
+}
+
+static int handle_connected(SmolRTSP_ClientSession *self) {
+    int error = 0;
+    socklen_t error_len = sizeof error;
+    if (getsockopt(self->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1) {
+        return -1;
+    }
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    self->state = SmolRTSP_ClientState_Describing;
+    watch_writable(self, false);
+
+    char buffer[BATCH_SIZE];
+    SmolRTSP_StringBuffer batch =
+        SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+    if (send_request(self, &batch, RequestKind_Describe, 0) == -1) {
+        return -1;
+    }
+
+    return flush_batch(self, &batch);
+}
+
+static int handle_readable(SmolRTSP_ClientSession *self) {
+    const size_t capacity = self->client->config.recv_buffer_size;
+
+    ssize_t n;
+    do {
+        n = read(self->fd, self->in + self->in_len, capacity - self->in_len);
+    } while (n < 0 && EINTR == errno);
+
+    if (n < 0) {
+        return EAGAIN == errno || EWOULDBLOCK == errno ? 0 : -1;
+    }
+    if (0 == n) {
+        errno = 0;
+        return -1;
+    }
+
+    self->in_len += (size_t)n;
+    if (process_input(self) == -1) {
+        return -1;
+    }
+
+    // A response or a frame that does not fit into the buffer.
+    if (self->in_len == capacity) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int handle_writable(SmolRTSP_ClientSession *self) {
+    const ssize_t pending = SmolRTSP_NonblockingFdWriter_flush(&self->out);
+    if (pending < 0) {
+        return -1;
+    }
+
+    watch_writable(self, pending > 0);
+    return 0;
+}
+
+// Handles all the complete responses and interleaved frames of the receive
+// buffer.
+static int process_input(SmolRTSP_ClientSession *self) {
+    size_t offset = 0;
+
+    for (;;) {
+        const char *data = self->in + offset;
+        const size_t len = self->in_len - offset;
+
+        if (len > 0 && '$' == data[0]) {
+            if (len < INTERLEAVED_HEADER_SIZE) {
+                break;
+            }
+
+            uint8_t channel_id = 0;
+            uint16_t payload_len = 0;
+            smolrtsp_parse_interleaved_header(
+                (const uint8_t *)data, &channel_id, &payload_len);
+            if (len < INTERLEAVED_HEADER_SIZE + (size_t)payload_len) {
+                break;
+            }
+
+            if (handle_frame(
+                    self, channel_id,
+                    U8Slice99_new(
+                        (uint8_t *)data + INTERLEAVED_HEADER_SIZE,
+                        payload_len)) == -1) {
+                return -1;
+            }
+            offset += INTERLEAVED_HEADER_SIZE + (size_t)payload_len;
+            continue;
+        }
+
+        if (len < INTERLEAVED_HEADER_SIZE) {
+            break;
+        }
+
+        SmolRTSP_Response response = SmolRTSP_Response_uninit();
+        const SmolRTSP_ParseResult res = SmolRTSP_Response_parse(
+            &response, CharSlice99_new((char *)data, len));
+
+        size_t consumed = 0;
+        match(res) {
+            of(SmolRTSP_ParseResult_Success, status) {
+                match(*status) {
+                    of(SmolRTSP_ParseStatus_Complete, n) {
+                        consumed = *n;
+                    }
+                    otherwise {
+                        consumed = 0;
+                    }
+                }
+            }
+            of(SmolRTSP_ParseResult_Failure, error) {
+                (void)error;
+                errno = EPROTO;
+                return -1;
+            }
+        }
+
+        if (0 == consumed) {
+            break;
+        }
+        if (handle_response(self, &response) == -1) {
+            return -1;
+        }
+        offset += consumed;
+    }
+
+    memmove(self->in, self->in + offset, self->in_len - offset);
+    self->in_len -= offset;
+
+    return 0;
+}
+
+static int
+handle_frame(SmolRTSP_ClientSession *self, uint8_t channel_id, U8Slice99 data) {
+    const size_t track_id = channel_id / 2;
+
+    // RTCP, whose reports the source does not depend on, or a channel that
+    // has not been set up.
+    if (channel_id % 2 != 0 || track_id >= self->setup_count) {
+        return 0;
+    }
+
+    Track *track = &self->tracks[track_id];
+
+    SmolRTSP_RtpHeader header;
+    if (SmolRTSP_RtpDepacketizer_feed(track->depacketizer, data, &header) ==
+        -1) {
+        // A malformed packet is lost like any other.
+        return 0;
+    }
+
+    const uint32_t timestamp = ntohl(header.timestamp);
+
+    SmolRTSP_NalUnit nalu;
+    while (SmolRTSP_RtpDepacketizer_next(track->depacketizer, &nalu)) {
+        VCALL(self->handler, on_nal_unit, self, track_id, timestamp, nalu);
+    }
+
+    return 0;
+}
+
+static int handle_response(
+    SmolRTSP_ClientSession *self, const SmolRTSP_Response *response) {
+    size_t i = 0;
+    while (i < self->pending_len && self->pending[i].cseq != response->cseq) {
+        i++;
+    }
+    if (i == self->pending_len) {
+        // Not ours (e.g., of a request nobody waits for anymore).
+        return 0;
+    }
+
+    const PendingRequest request = self->pending[i];
+    memmove(
+        &self->pending[i], &self->pending[i + 1],
+        (self->pending_len - i - 1) * sizeof self->pending[0]);
+    self->pending_len--;
+
+    const SmolRTSP_StatusCode status = response->start_line.code;
+    if (RequestKind_KeepAlive == request.kind ||
+        RequestKind_Teardown == request.kind) {
+        return 0;
+    }
+    if (status < 200 || status >= 300) {
+        self->fail_status = status;
+        errno = EPROTO;
+        return -1;
+    }
+
+    switch (request.kind) {
+    case RequestKind_Describe:
+        return handle_description(self, response);
+    case RequestKind_Setup:
+        return handle_setup(self, response);
+    case RequestKind_Play:
+        self->state = SmolRTSP_ClientState_Playing;
+        self->next_keepalive_ms =
+            now_ms() + (uint64_t)self->client->config.keepalive_interval_ms;
+        VCALL(self->handler, on_playing, self);
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static int handle_description(
+    SmolRTSP_ClientSession *self, const SmolRTSP_Response *response) {
+    CharSlice99 content_base;
+    if (SmolRTSP_HeaderMap_find_id(
+            &response->header_map, SmolRTSP_HeaderId_ContentBase,
+            &content_base) &&
+        copy_str(self->base, sizeof self->base, content_base) == -1) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    if (parse_sdp(self, response->body) == -1) {
+        return -1;
+    }
+    if (0 == self->tracks_count) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    for (size_t i = 0; i < self->tracks_count; i++) {
+        Track *track = &self->tracks[i];
+        track->depacketizer = SmolRTSP_RtpDepacketizer_new(
+            track->codec, self->client->config.max_nalu_size);
+        if (NULL == track->depacketizer) {
+            return -1;
+        }
+    }
+
+    self->state = SmolRTSP_ClientState_SettingUp;
+    return send_setups(self);
+}
+
+static int
+handle_setup(SmolRTSP_ClientSession *self, const SmolRTSP_Response *response) {
+    // The first `SETUP` establishes the session that the others join.
+    if ('\0' == self->session_id[0]) {
+        CharSlice99 session;
+        if (!SmolRTSP_HeaderMap_find_id(
+                &response->header_map, SmolRTSP_HeaderId_Session, &session)) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        // Without the parameters, e.g., `;timeout=60`.
+        for (size_t i = 0; i < session.len; i++) {
+            if (';' == session.ptr[i]) {
+                session.len = i;
+                break;
+            }
+        }
+        if (copy_str(self->session_id, sizeof self->session_id, session) ==
+            -1) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    }
+
+    return send_setups(self);
+}
+
+// Sends the next `SETUP`s, and `PLAY` once every track is set up: one request
+// at a time until the session is established, and all the rest at once
+// afterwards if pipelining is enabled.
+static int send_setups(SmolRTSP_ClientSession *self) {
+    // `PLAY` has been sent along with the last pipelined `SETUP`.
+    if (SmolRTSP_ClientState_Starting == self->state) {
+        return 0;
+    }
+
+    const bool pipelining =
+        self->client->config.pipelining && self->session_id[0] != '\0';
+
+    char buffer[BATCH_SIZE];
+    SmolRTSP_StringBuffer batch =
+        SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+
+    do {
+        if (self->setup_count < self->tracks_count) {
+            if (send_request(
+                    self, &batch, RequestKind_Setup, self->setup_count) == -1) {
+                return -1;
+            }
+            self->setup_count++;
+        } else {
+            if (send_request(self, &batch, RequestKind_Play, 0) == -1) {
+                return -1;
+            }
+            self->state = SmolRTSP_ClientState_Starting;
+            break;
+        }
+    } while (pipelining);
+
+    return flush_batch(self, &batch);
+}
+
+// Appends the request to `batch` and registers it as pending.
+static int send_request(
+    SmolRTSP_ClientSession *self, SmolRTSP_StringBuffer *batch,
+    RequestKind kind, size_t track_id) {
+    if (self->pending_len == MAX_PENDING_REQUESTS) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    SmolRTSP_Request request = {
+        .start_line =
+            {
+                .uri = CharSlice99_from_str(self->base),
+                .version = {.major = 1, .minor = 0},
+            },
+        .header_map = SmolRTSP_HeaderMap_empty(),
+        .body = SmolRTSP_MessageBody_empty(),
+        .cseq = self->next_cseq,
+    };
+
+    char transport[64];
+    switch (kind) {
+    case RequestKind_Describe:
+        request.start_line.method = SMOLRTSP_METHOD_DESCRIBE;
+        request.start_line.uri = CharSlice99_from_str(self->uri);
+        SmolRTSP_HeaderMap_append(
+            &request.header_map,
+            (SmolRTSP_Header){
+                SMOLRTSP_HEADER_ACCEPT,
+                CharSlice99_from_str("application/sdp"),
+            });
+        break;
+    case RequestKind_Setup:
+        request.start_line.method = SMOLRTSP_METHOD_SETUP;
+        request.start_line.uri =
+            CharSlice99_from_str(self->tracks[track_id].control);
+        snprintf(
+            transport, sizeof transport,
+            "RTP/AVP/TCP;unicast;interleaved=%zu-%zu", 2 * track_id,
+            2 * track_id + 1);
+        SmolRTSP_HeaderMap_append(
+            &request.header_map,
+            (SmolRTSP_Header){
+                SMOLRTSP_HEADER_TRANSPORT,
+                CharSlice99_from_str(transport),
+            });
+        break;
+    case RequestKind_Play:
+        request.start_line.method = SMOLRTSP_METHOD_PLAY;
+        SmolRTSP_HeaderMap_append(
+            &request.header_map,
+            (SmolRTSP_Header){
+                SMOLRTSP_HEADER_RANGE,
+                CharSlice99_from_str("npt=0.000-"),
+            });
+        break;
+    case RequestKind_KeepAlive:
+        request.start_line.method = SMOLRTSP_METHOD_OPTIONS;
+        break;
+    case RequestKind_Teardown:
+        request.start_line.method = SMOLRTSP_METHOD_TEARDOWN;
+        break;
+    }
+
+    if (self->session_id[0] != '\0') {
+        SmolRTSP_HeaderMap_append(
+            &request.header_map,
+            (SmolRTSP_Header){
+                SMOLRTSP_HEADER_SESSION,
+                CharSlice99_from_str(self->session_id),
+            });
+    }
+
+    if (SmolRTSP_Request_serialize(
+            &request, smolrtsp_string_buffer_writer(batch)) < 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    self->pending[self->pending_len++] = (PendingRequest){
+        .cseq = self->next_cseq++,
+        .kind = kind,
+        .track_id = track_id,
+    };
+
+    return 0;
+}
+
+// Hands the whole batch to the socket at once, so that pipelined requests
+// share segments.
+static int flush_batch(
+    SmolRTSP_ClientSession *self, const SmolRTSP_StringBuffer *batch) {
+    const SmolRTSP_Writer w = smolrtsp_nonblocking_fd_writer(&self->out);
+    if (VCALL(w, write, SmolRTSP_StringBuffer_as_slice(batch)) < 0) {
+        return -1;
+    }
+
+    watch_writable(self, self->out.len > 0);
+    return 0;
+}
+
+static void watch_writable(SmolRTSP_ClientSession *self, bool enable) {
+    if (self->want_write == enable) {
+        return;
+    }
+
+    struct epoll_event event = {
+        .events = EPOLLIN | (enable ? EPOLLOUT : 0),
+        .data.ptr = self,
+    };
+    if (epoll_ctl(
+            self->client->epoll_fd, EPOLL_CTL_MOD, self->fd, &event) == 0) {
+        self->want_write = enable;
+    }
+}
+
+static void
+fail(SmolRTSP_ClientSession *self, int error, SmolRTSP_StatusCode status) {
+    VCALL(self->handler, on_close, self, error, status);
+    free_session(self);
+}
+
+static void free_session(SmolRTSP_ClientSession *self) {
+    SmolRTSP_Client *client = self->client;
+
+    if (self->prev != NULL) {
+        self->prev->next = self->next;
+    } else {
+        client->sessions = self->next;
+    }
+    if (self->next != NULL) {
+        self->next->prev = self->prev;
+    }
+
+    epoll_ctl(client->epoll_fd, EPOLL_CTL_DEL, self->fd, NULL);
+    close(self->fd);
+
+    for (size_t i = 0; i < self->tracks_count; i++) {
+        if (self->tracks[i].depacketizer != NULL) {
+            VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable)
+                .drop(self->tracks[i].depacketizer);
+        }
+    }
+
+    smolrtsp_free(self);
+}
+
+// Collects the H.264/H.265 video tracks of `sdp` and the aggregate control
+// URI of the session.
+static int parse_sdp(SmolRTSP_ClientSession *self, CharSlice99 sdp) {
+    // The video section being parsed, if any.
+    Track *track = NULL;
+    bool in_media = false, has_codec = false, has_control = false;
+
+    CharSlice99 line;
+    while (next_line(&sdp, &line)) {
+        if (starts_with_nocase(line, "m=")) {
+            if (track != NULL &&
+                add_track(self, has_codec, has_control) == -1) {
+                return -1;
+            }
+
+            in_media = true;
+            track = starts_with_nocase(line, "m=video ") &&
+                            self->tracks_count < SMOLRTSP_CLIENT_MAX_TRACKS
+                        ? &self->tracks[self->tracks_count]
+                        : NULL;
+            has_codec = false;
+            has_control = false;
+        } else if (starts_with_nocase(line, "a=control:")) {
+            const CharSlice99 control =
+                CharSlice99_advance(line, sizeof("a=control:") - 1);
+
+            if (!in_media) {
+                char base[MAX_URI_SIZE];
+                if (resolve_uri(base, self->base, control) == -1) {
+                    return -1;
+                }
+                memcpy(self->base, base, sizeof base);
+            } else if (track != NULL) {
+                if (resolve_uri(track->control, self->base, control) == -1) {
+                    return -1;
+                }
+                has_control = true;
+            }
+        } else if (track != NULL && starts_with_nocase(line, "a=rtpmap:")) {
+            // `a=rtpmap:<payload type> <encoding name>/<clock rate>`.
+            const char *space = memchr(line.ptr, ' ', line.len);
+            if (NULL == space) {
+                continue;
+            }
+
+            const CharSlice99 encoding =
+                CharSlice99_advance(line, space - line.ptr + 1);
+            if (starts_with_nocase(encoding, "H264/")) {
+                track->codec = SmolRTSP_NalCodec_H264;
+                has_codec = true;
+            }
+#ifndef SMOLRTSP_NO_H265
+            if (starts_with_nocase(encoding, "H265/")) {
+                track->codec = SmolRTSP_NalCodec_H265;
+                has_codec = true;
+            }
+#endif
+        }
+    }
+
+    if (track != NULL && add_track(self, has_codec, has_control) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Accepts the video section just parsed into the next track, if its codec is
+// supported; without a control URI of its own, it is the aggregate one.
+static int
+add_track(SmolRTSP_ClientSession *self, bool has_codec, bool has_control) {
+    Track *track = &self->tracks[self->tracks_count];
+    if (!has_codec) {
+        return 0;
+    }
+
+    if (!has_control &&
+        resolve_uri(track->control, self->base, CharSlice99_empty()) == -1) {
+        return -1;
+    }
+
+    track->depacketizer = NULL;
+    self->tracks_count++;
+    return 0;
+}
+
+// Writes the absolute form of `uri` relative to `base` into `dst`, of
+// `MAX_URI_SIZE` bytes.
+static int
+resolve_uri(char dst[restrict], const char *restrict base, CharSlice99 uri) {
+    if (starts_with_nocase(uri, "rtsp://") ||
+        starts_with_nocase(uri, "rtsps://")) {
+        return copy_str(dst, MAX_URI_SIZE, uri);
+    }
+
+    const size_t base_len = strlen(base);
+    if (0 == uri.len || (1 == uri.len && '*' == uri.ptr[0])) {
+        memmove(dst, base, base_len + 1);
+        return 0;
+    }
+
+    const bool slash = base_len > 0 && base[base_len - 1] != '/';
+    const int n = snprintf(
+        dst, MAX_URI_SIZE, "%s%s%.*s", base, slash ? "/" : "", (int)uri.len,
+        uri.ptr);
+
+    return n < 0 || (size_t)n >= MAX_URI_SIZE ? -1 : 0;
+}
+
+static int copy_str(char dst[restrict], size_t size, CharSlice99 src) {
+    if (src.len >= size) {
+        return -1;
+    }
+
+    memcpy(dst, src.ptr, src.len);
+    dst[src.len] = '\0';
+    return 0;
+}
+
+// Extracts the next line of `input` without its end-of-line.
+static bool next_line(CharSlice99 *restrict input, CharSlice99 *restrict line) {
+    if (0 == input->len) {
+        return false;
+    }
+
+    size_t len = 0;
+    while (len < input->len && input->ptr[len] != '\n') {
+        len++;
+    }
+
+    *line = CharSlice99_new(input->ptr, len);
+    if (line->len > 0 && '\r' == line->ptr[line->len - 1]) {
+        line->len--;
+    }
+    *input = CharSlice99_advance(*input, len < input->len ? len + 1 : len);
+
+    return true;
+}
+
+static bool starts_with_nocase(CharSlice99 s, const char *restrict prefix) {
+    const size_t len = strlen(prefix);
+    return s.len >= len && 0 == strncasecmp(s.ptr, prefix, len);
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
@@ -1,32 +1,66 @@
-#include <smolrtsp/context.h>
+#include "context.h"
 
 #include <smolrtsp/types/header_map.h>
-#include <smolrtsp/types/response.h>
+
+#include "alloc.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-struct SmolRTSP_Context {
-    SmolRTSP_Writer writer;
-    uint32_t cseq;
-    SmolRTSP_HeaderMap header_map;
-    SmolRTSP_MessageBody body;
-    ssize_t ret;
-};
+// Enough for the status line and a typical set of headers; a larger response
+// is written in a few more calls.
+#define SMOLRTSP_CONTEXT_RESPONSE_BUFFER_SIZE 1024
+
+static bool in_arena(const SmolRTSP_Context *self, const char *ptr);
 
 SmolRTSP_Context *SmolRTSP_Context_new(SmolRTSP_Writer w, uint32_t cseq) {
     assert(w.self && w.vptr);
 
-    SmolRTSP_Context *self = malloc(sizeof *self);
+    SmolRTSP_Context *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    smolrtsp_context_init(self, w, cseq);
+    self->on_heap = true;
+
+    return self;
+}
+
+void smolrtsp_context_init(
+    SmolRTSP_Context *self, SmolRTSP_Writer w, uint32_t cseq) {
     assert(self);
+    assert(w.self && w.vptr);
+
     self->writer = w;
-    self->cseq = cseq;
-    self->header_map = SmolRTSP_HeaderMap_empty();
-    self->body = SmolRTSP_MessageBody_empty();
+    SmolRTSP_HeaderMap_clear(&self->response.header_map);
+    self->response.body = SmolRTSP_MessageBody_empty();
+    self->response.cseq = cseq;
     self->ret = 0;
+    self->on_heap = false;
+    self->arena_len = 0;
+}
 
-    return self;
+void smolrtsp_context_uninit(SmolRTSP_Context *self) {
+    assert(self);
+
+    const SmolRTSP_HeaderMap *header_map = &self->response.header_map;
+    for (size_t i = 0; i < header_map->len; i++) {
+        if (!in_arena(self, header_map->headers[i].value.ptr)) {
+            smolrtsp_free(header_map->headers[i].value.ptr);
+        }
+    }
+}
+
+void SmolRTSP_Context_reset(SmolRTSP_Context *ctx, uint32_t cseq) {
+    assert(ctx);
+
+    const bool on_heap = ctx->on_heap;
+    smolrtsp_context_uninit(ctx);
+    smolrtsp_context_init(ctx, ctx->writer, cseq);
+    ctx->on_heap = on_heap;
 }
 
 SmolRTSP_Writer SmolRTSP_Context_get_writer(const SmolRTSP_Context *ctx) {
@@ -36,7 +70,7 @@ SmolRTSP_Writer SmolRTSP_Context_get_writer(const SmolRTSP_Context *ctx) {
 
 uint32_t SmolRTSP_Context_get_cseq(const SmolRTSP_Context *ctx) {
     assert(ctx);
-    return ctx->cseq;
+    return ctx->response.cseq;
 }
 
 ssize_t SmolRTSP_Context_get_ret(const SmolRTSP_Context *ctx) {
@@ -50,20 +84,35 @@ void smolrtsp_vheader(
     assert(ctx);
     assert(fmt);
 
+    // Try to format the value right into the arena first, so that a typical
+    // response needs only one `vsnprintf` call and no heap allocations.
+    char *value = ctx->arena + ctx->arena_len;
+    const size_t space_left = sizeof ctx->arena - ctx->arena_len;
+
     va_list list_copy;
     va_copy(list_copy, list);
+    const int space_required = vsnprintf(value, space_left, fmt, list_copy);
+    va_end(list_copy);
+    assert(space_required >= 0);
+
+    if ((size_t)space_required < space_left) {
+        ctx->arena_len += (size_t)space_required + 1 /* null character */;
+    } else {
+        value = smolrtsp_malloc(space_required + 1 /* null character */);
+        if (NULL == value) {
+            errno = ENOMEM;
+            ctx->ret = -1;
+            return;
+        }
+
+        const int bytes_written __attribute__((unused)) =
+            vsprintf(value, fmt, list);
+        assert(space_required == bytes_written);
+    }
 
-    const int space_required = vsnprintf(NULL, 0, fmt, list_copy);
-    assert(space_required > 0);
-    char *value = malloc(space_required + 1 /* null character */);
-    assert(value);
-
-    const int bytes_written __attribute__((unused)) =
-        vsprintf(value, fmt, list);
-    assert(space_required == bytes_written);
-
-    const SmolRTSP_Header h = {key, CharSlice99_from_str(value)};
-    SmolRTSP_HeaderMap_append(&ctx->header_map, h);
+    const SmolRTSP_Header h = {
+        key, CharSlice99_new(value, (size_t)space_required)};
+    SmolRTSP_HeaderMap_append(&ctx->response.header_map, h);
 }
 
 void smolrtsp_header(
@@ -79,7 +128,7 @@ void smolrtsp_header(
 
 void smolrtsp_body(SmolRTSP_Context *ctx, SmolRTSP_MessageBody body) {
     assert(ctx);
-    ctx->body = body;
+    ctx->response.body = body;
 }
 
 ssize_t smolrtsp_respond(
@@ -87,19 +136,26 @@ ssize_t smolrtsp_respond(
     assert(ctx);
     assert(reason);
 
-    const SmolRTSP_Response response = {
-        .start_line =
-            {
-                .version = {.major = 1, .minor = 0},
-                .code = code,
-                .reason = CharSlice99_from_str((char *)reason),
-            },
-        .header_map = ctx->header_map,
-        .body = ctx->body,
-        .cseq = ctx->cseq,
+    ctx->response.start_line = (SmolRTSP_ResponseLine){
+        .version = {.major = 1, .minor = 0},
+        .code = code,
+        .reason = CharSlice99_from_str((char *)reason),
     };
 
-    ctx->ret = SmolRTSP_Response_serialize(&response, ctx->writer);
+    // Gather the response so that it goes out in a single (vectored) write
+    // instead of one per header.
+    char buffer[SMOLRTSP_CONTEXT_RESPONSE_BUFFER_SIZE];
+    SmolRTSP_BufferedWriter bw =
+        SmolRTSP_BufferedWriter_new(ctx->writer, buffer, sizeof buffer);
+
+    ctx->ret = SmolRTSP_Response_serialize(
+        &ctx->response, smolrtsp_buffered_writer(&bw));
+
+    const ssize_t flushed = SmolRTSP_BufferedWriter_flush(&bw);
+    if (ctx->ret >= 0 && flushed < 0) {
+        ctx->ret = flushed;
+    }
+
     return ctx->ret;
 }
 
@@ -118,11 +174,14 @@ void SmolRTSP_Context_drop(VSelf) {
     VSELF(SmolRTSP_Context);
     assert(self);
 
-    for (size_t i = 0; i < self->header_map.len; i++) {
-        free(self->header_map.headers[i].value.ptr);
+    smolrtsp_context_uninit(self);
+    if (self->on_heap) {
+        smolrtsp_free(self);
     }
-
-    free(self);
 }
 
 implExtern(SmolRTSP_Droppable, SmolRTSP_Context);
+
+static bool in_arena(const SmolRTSP_Context *self, const char *ptr) {
+    return ptr >= self->arena && ptr < self->arena + sizeof self->arena;
+}
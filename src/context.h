@@ -0,0 +1,44 @@
+#pragma once
+
+#include <smolrtsp/context.h>
+#include <smolrtsp/types/response.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The size of the inline arena holding the formatted header values of a
+// context. Values that do not fit are allocated on the heap.
+#ifndef SMOLRTSP_CONTEXT_ARENA_SIZE
+#define SMOLRTSP_CONTEXT_ARENA_SIZE 512
+#endif
+
+/*
+ * The definition of the opaque `SmolRTSP_Context`, so that `smolrtsp_dispatch`
+ * can keep its context on the stack instead of allocating it.
+ */
+struct SmolRTSP_Context {
+    SmolRTSP_Writer writer;
+
+    // Accumulates the headers and the body, and is serialized in place by
+    // `smolrtsp_respond` instead of being copied.
+    SmolRTSP_Response response;
+
+    ssize_t ret;
+
+    // Whether the context itself has been allocated by
+    // `SmolRTSP_Context_new`.
+    bool on_heap;
+
+    // A bump allocator of header values, reset only with the whole context.
+    size_t arena_len;
+    char arena[SMOLRTSP_CONTEXT_ARENA_SIZE];
+};
+
+// Initializes a context in place. Must be released with
+// `smolrtsp_context_uninit`.
+void smolrtsp_context_init(
+    SmolRTSP_Context *self, SmolRTSP_Writer w, uint32_t cseq);
+
+// Frees the header values that did not fit into the arena.
+void smolrtsp_context_uninit(SmolRTSP_Context *self);
@@ -1,7 +1,31 @@
 #include <smolrtsp/controller.h>
 
+#include "context.h"
+#include "probes.h"
+
 #include <assert.h>
 
+#define DEFAULT_HANDLER(method)                                                \
+    void SmolRTSP_Controller_##method(                                         \
+        VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {           \
+        VSELF(void);                                                           \
+        (void)self;                                                            \
+        (void)ctx;                                                             \
+        (void)req;                                                             \
+    }
+
+DEFAULT_HANDLER(announce)
+DEFAULT_HANDLER(pause)
+DEFAULT_HANDLER(get_parameter)
+DEFAULT_HANDLER(set_parameter)
+DEFAULT_HANDLER(record)
+
+#undef DEFAULT_HANDLER
+
+static void dispatch(
+    SmolRTSP_Context *ctx, SmolRTSP_Controller controller,
+    const SmolRTSP_Request *restrict req);
+
 void smolrtsp_dispatch(
     SmolRTSP_Writer conn, SmolRTSP_Controller controller,
     const SmolRTSP_Request *restrict req) {
@@ -9,35 +33,84 @@ void smolrtsp_dispatch(
     assert(controller.self && controller.vptr);
     assert(req);
 
-    SmolRTSP_Context *ctx = SmolRTSP_Context_new(conn, req->cseq);
+    // The context lives on the stack, so that dispatching a request does not
+    // touch the heap unless the response headers outgrow its arena.
+    SmolRTSP_Context ctx;
+    smolrtsp_context_init(&ctx, conn, req->cseq);
+
+    dispatch(&ctx, controller, req);
+
+    smolrtsp_context_uninit(&ctx);
+}
+
+void smolrtsp_dispatch_with_context(
+    SmolRTSP_Context *ctx, SmolRTSP_Controller controller,
+    const SmolRTSP_Request *restrict req) {
+    assert(ctx);
+    assert(controller.self && controller.vptr);
+    assert(req);
+
+    SmolRTSP_Context_reset(ctx, req->cseq);
+    dispatch(ctx, controller, req);
+}
+
+static void dispatch(
+    SmolRTSP_Context *ctx, SmolRTSP_Controller controller,
+    const SmolRTSP_Request *restrict req) {
+    SMOLRTSP_PROBE(
+        dispatch_entry, req->start_line.method.ptr,
+        req->start_line.method.len, req->cseq);
 
     if (VCALL(controller, before, ctx, req) == SmolRTSP_ControlFlow_Break) {
         goto after;
     }
 
-    const SmolRTSP_Method method = req->start_line.method,
-                          options = SMOLRTSP_METHOD_OPTIONS,
-                          describe = SMOLRTSP_METHOD_DESCRIBE,
-                          setup = SMOLRTSP_METHOD_SETUP,
-                          play = SMOLRTSP_METHOD_PLAY,
-                          teardown = SMOLRTSP_METHOD_TEARDOWN;
+// A handler left to its default implementation falls back to `unknown`.
+#define DISPATCH_OR_UNKNOWN(method)                                            \
+    if (controller.vptr->method != SmolRTSP_Controller_##method) {             \
+        VCALL(controller, method, ctx, req);                                   \
+        break;                                                                 \
+    }                                                                          \
+    goto unknown
 
-    if (SmolRTSP_Method_eq(&method, &options)) {
+    // A dense switch over the interned method compiles to a jump table.
+    switch (SmolRTSP_MethodId_from_method(req->start_line.method)) {
+    case SmolRTSP_MethodId_Options:
         VCALL(controller, options, ctx, req);
-    } else if (SmolRTSP_Method_eq(&method, &describe)) {
+        break;
+    case SmolRTSP_MethodId_Describe:
         VCALL(controller, describe, ctx, req);
-    } else if (SmolRTSP_Method_eq(&method, &setup)) {
+        break;
+    case SmolRTSP_MethodId_Setup:
         VCALL(controller, setup, ctx, req);
-    } else if (SmolRTSP_Method_eq(&method, &play)) {
+        break;
+    case SmolRTSP_MethodId_Play:
         VCALL(controller, play, ctx, req);
-    } else if (SmolRTSP_Method_eq(&method, &teardown)) {
+        break;
+    case SmolRTSP_MethodId_Teardown:
         VCALL(controller, teardown, ctx, req);
-    } else {
+        break;
+    case SmolRTSP_MethodId_Announce:
+        DISPATCH_OR_UNKNOWN(announce);
+    case SmolRTSP_MethodId_Pause:
+        DISPATCH_OR_UNKNOWN(pause);
+    case SmolRTSP_MethodId_GetParameter:
+        DISPATCH_OR_UNKNOWN(get_parameter);
+    case SmolRTSP_MethodId_SetParameter:
+        DISPATCH_OR_UNKNOWN(set_parameter);
+    case SmolRTSP_MethodId_Record:
+        DISPATCH_OR_UNKNOWN(record);
+    case SmolRTSP_MethodId_Redirect:
+    case SmolRTSP_MethodId_Unknown:
+    unknown:
         VCALL(controller, unknown, ctx, req);
+        break;
     }
 
+#undef DISPATCH_OR_UNKNOWN
+
 after:
     VCALL(controller, after, SmolRTSP_Context_get_ret(ctx), ctx, req);
 
-    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    SMOLRTSP_PROBE(dispatch_exit, req->cseq, SmolRTSP_Context_get_ret(ctx));
 }
@@ -0,0 +1,798 @@
+#include "crypto.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SMOLRTSP_HAS_AESNI_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) &&                                                    \
+    (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define SMOLRTSP_HAS_ARMV8_AES
+#include <arm_neon.h>
+#endif
+
+// The number of blocks encrypted at once by the hardware kernels, which hides
+// the latency of the AES instructions.
+#define CTR_LANES 4
+
+typedef void (*CtrKernel)(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len);
+
+typedef void (*Sha1Kernel)(uint32_t h[restrict 5], const uint8_t *block);
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B,
+    0xFE, 0xD7, 0xAB, 0x76, 0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
+    0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0, 0xB7, 0xFD, 0x93, 0x26,
+    0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2,
+    0xEB, 0x27, 0xB2, 0x75, 0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
+    0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84, 0x53, 0xD1, 0x00, 0xED,
+    0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F,
+    0x50, 0x3C, 0x9F, 0xA8, 0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
+    0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2, 0xCD, 0x0C, 0x13, 0xEC,
+    0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14,
+    0xDE, 0x5E, 0x0B, 0xDB, 0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
+    0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79, 0xE7, 0xC8, 0x37, 0x6D,
+    0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F,
+    0x4B, 0xBD, 0x8B, 0x8A, 0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
+    0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E, 0xE1, 0xF8, 0x98, 0x11,
+    0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F,
+    0xB0, 0x54, 0xBB, 0x16,
+};
+
+// The sines of MD5 (RFC 1321, section 3.4).
+static const uint32_t md5_k[64] = {
+    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A,
+    0xA8304613, 0xFD469501, 0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE,
+    0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821, 0xF61E2562, 0xC040B340,
+    0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8,
+    0x676F02D9, 0x8D2A4C8A, 0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C,
+    0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70, 0x289B7EC6, 0xEAA127FA,
+    0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92,
+    0xFFEFF47D, 0x85845DD1, 0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1,
+    0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+};
+
+static const uint8_t md5_shifts[4][4] = {
+    {7, 12, 17, 22},
+    {5, 9, 14, 20},
+    {4, 11, 16, 23},
+    {6, 10, 15, 21},
+};
+
+static uint8_t xtime(uint8_t x);
+static void encrypt_block(
+    const SmolRTSP_Aes128 *key, const uint8_t in[restrict AES_BLOCK_SIZE],
+    uint8_t out[restrict AES_BLOCK_SIZE]);
+static uint16_t get_counter(const uint8_t block[restrict AES_BLOCK_SIZE]);
+static void set_counter(uint8_t block[restrict AES_BLOCK_SIZE], uint16_t n);
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len);
+static CtrKernel ctr_kernel(void);
+static void ctr_scalar(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len);
+
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+static void ctr_aesni(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len);
+#endif
+
+#ifdef SMOLRTSP_HAS_ARMV8_AES
+static void ctr_armv8(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len);
+#endif
+
+static void sha1_compress(uint32_t h[restrict 5], const uint8_t *block);
+static void
+sha1_compress_scalar(uint32_t h[restrict 5], const uint8_t *block);
+
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+__attribute__((target("sha,sse4.1"))) static void
+sha1_compress_shani(uint32_t h[restrict 5], const uint8_t *block);
+#endif
+
+static void md5_compress(uint32_t h[restrict 4], const uint8_t *block);
+
+static uint32_t rotl(uint32_t x, unsigned n);
+
+void SmolRTSP_Aes128_init(
+    SmolRTSP_Aes128 *self, const uint8_t key[restrict AES128_KEY_SIZE]) {
+    assert(self);
+    assert(key);
+
+    memcpy(self->round_keys[0], key, AES128_KEY_SIZE);
+
+    uint8_t rcon = 0x01;
+    for (size_t round = 1; round <= AES128_ROUNDS; round++) {
+        const uint8_t *prev = self->round_keys[round - 1];
+        uint8_t *next = self->round_keys[round];
+
+        // RotWord, SubWord, and Rcon of the last word of the previous key.
+        const uint8_t t[4] = {
+            (uint8_t)(sbox[prev[13]] ^ rcon),
+            sbox[prev[14]],
+            sbox[prev[15]],
+            sbox[prev[12]],
+        };
+        for (size_t i = 0; i < 4; i++) {
+            next[i] = prev[i] ^ t[i];
+        }
+        for (size_t i = 4; i < AES128_KEY_SIZE; i++) {
+            next[i] = prev[i] ^ next[i - 4];
+        }
+
+        rcon = xtime(rcon);
+    }
+}
+
+void SmolRTSP_Aes128_ctr(
+    const SmolRTSP_Aes128 *self, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len) {
+    assert(self);
+    assert(iv);
+    assert(data || 0 == len);
+    assert(len <= (size_t)AES_BLOCK_SIZE << 16);
+
+    if (len > 0) {
+        ctr_kernel()(self, iv, data, len);
+    }
+}
+
+void SmolRTSP_Sha1_init(SmolRTSP_Sha1 *self) {
+    assert(self);
+
+    self->h[0] = 0x67452301;
+    self->h[1] = 0xEFCDAB89;
+    self->h[2] = 0x98BADCFE;
+    self->h[3] = 0x10325476;
+    self->h[4] = 0xC3D2E1F0;
+    self->len = 0;
+    self->block_len = 0;
+}
+
+void SmolRTSP_Sha1_update(SmolRTSP_Sha1 *self, const void *data, size_t len) {
+    assert(self);
+    assert(data || 0 == len);
+
+    const uint8_t *bytes = data;
+    self->len += len;
+
+    if (self->block_len > 0) {
+        const size_t n = SHA1_BLOCK_SIZE - self->block_len < len
+                             ? SHA1_BLOCK_SIZE - self->block_len
+                             : len;
+        memcpy(self->block + self->block_len, bytes, n);
+        self->block_len += n;
+        bytes += n;
+        len -= n;
+
+        if (self->block_len < SHA1_BLOCK_SIZE) {
+            return;
+        }
+        sha1_compress(self->h, self->block);
+        self->block_len = 0;
+    }
+
+    for (; len >= SHA1_BLOCK_SIZE; bytes += SHA1_BLOCK_SIZE) {
+        sha1_compress(self->h, bytes);
+        len -= SHA1_BLOCK_SIZE;
+    }
+
+    if (len > 0) {
+        memcpy(self->block, bytes, len);
+        self->block_len = len;
+    }
+}
+
+void SmolRTSP_Sha1_final(
+    SmolRTSP_Sha1 *self, uint8_t digest[restrict SHA1_DIGEST_SIZE]) {
+    assert(self);
+    assert(digest);
+
+    const uint64_t bits = self->len * 8;
+
+    self->block[self->block_len++] = 0x80;
+    if (self->block_len > SHA1_BLOCK_SIZE - 8) {
+        memset(
+            self->block + self->block_len, 0,
+            SHA1_BLOCK_SIZE - self->block_len);
+        sha1_compress(self->h, self->block);
+        self->block_len = 0;
+    }
+    memset(
+        self->block + self->block_len, 0,
+        SHA1_BLOCK_SIZE - 8 - self->block_len);
+    for (size_t i = 0; i < 8; i++) {
+        self->block[SHA1_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    sha1_compress(self->h, self->block);
+
+    for (size_t i = 0; i < 5; i++) {
+        digest[4 * i] = (uint8_t)(self->h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(self->h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(self->h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)self->h[i];
+    }
+}
+
+void SmolRTSP_HmacSha1_init(
+    SmolRTSP_HmacSha1 *self, const uint8_t *key, size_t key_len) {
+    assert(self);
+    assert(key || 0 == key_len);
+
+    uint8_t pad[SHA1_BLOCK_SIZE] = {0};
+    if (key_len > SHA1_BLOCK_SIZE) {
+        SmolRTSP_Sha1 ctx;
+        SmolRTSP_Sha1_init(&ctx);
+        SmolRTSP_Sha1_update(&ctx, key, key_len);
+        SmolRTSP_Sha1_final(&ctx, pad);
+    } else if (key_len > 0) {
+        memcpy(pad, key, key_len);
+    }
+
+    for (size_t i = 0; i < SHA1_BLOCK_SIZE; i++) {
+        pad[i] ^= 0x36;
+    }
+    SmolRTSP_Sha1_init(&self->inner);
+    SmolRTSP_Sha1_update(&self->inner, pad, sizeof pad);
+
+    // 0x36 ^ 0x5C.
+    for (size_t i = 0; i < SHA1_BLOCK_SIZE; i++) {
+        pad[i] ^= 0x6A;
+    }
+    SmolRTSP_Sha1_init(&self->outer);
+    SmolRTSP_Sha1_update(&self->outer, pad, sizeof pad);
+
+    smolrtsp_crypto_wipe(pad, sizeof pad);
+}
+
+void SmolRTSP_HmacSha1_start(
+    const SmolRTSP_HmacSha1 *self, SmolRTSP_Sha1 *ctx) {
+    assert(self);
+    assert(ctx);
+
+    *ctx = self->inner;
+}
+
+void SmolRTSP_HmacSha1_finish(
+    const SmolRTSP_HmacSha1 *self, SmolRTSP_Sha1 *ctx,
+    uint8_t mac[restrict SHA1_DIGEST_SIZE]) {
+    assert(self);
+    assert(ctx);
+    assert(mac);
+
+    uint8_t inner[SHA1_DIGEST_SIZE];
+    SmolRTSP_Sha1_final(ctx, inner);
+
+    *ctx = self->outer;
+    SmolRTSP_Sha1_update(ctx, inner, sizeof inner);
+    SmolRTSP_Sha1_final(ctx, mac);
+}
+
+void SmolRTSP_Md5_init(SmolRTSP_Md5 *self) {
+    assert(self);
+
+    self->h[0] = 0x67452301;
+    self->h[1] = 0xEFCDAB89;
+    self->h[2] = 0x98BADCFE;
+    self->h[3] = 0x10325476;
+    self->len = 0;
+    self->block_len = 0;
+}
+
+void SmolRTSP_Md5_update(SmolRTSP_Md5 *self, const void *data, size_t len) {
+    assert(self);
+    assert(data || 0 == len);
+
+    const uint8_t *bytes = data;
+    self->len += len;
+
+    if (self->block_len > 0) {
+        const size_t n = MD5_BLOCK_SIZE - self->block_len < len
+                             ? MD5_BLOCK_SIZE - self->block_len
+                             : len;
+        memcpy(self->block + self->block_len, bytes, n);
+        self->block_len += n;
+        bytes += n;
+        len -= n;
+
+        if (self->block_len < MD5_BLOCK_SIZE) {
+            return;
+        }
+        md5_compress(self->h, self->block);
+        self->block_len = 0;
+    }
+
+    for (; len >= MD5_BLOCK_SIZE; bytes += MD5_BLOCK_SIZE) {
+        md5_compress(self->h, bytes);
+        len -= MD5_BLOCK_SIZE;
+    }
+
+    if (len > 0) {
+        memcpy(self->block, bytes, len);
+        self->block_len = len;
+    }
+}
+
+void SmolRTSP_Md5_final(
+    SmolRTSP_Md5 *self, uint8_t digest[restrict MD5_DIGEST_SIZE]) {
+    assert(self);
+    assert(digest);
+
+    const uint64_t bits = self->len * 8;
+
+    self->block[self->block_len++] = 0x80;
+    if (self->block_len > MD5_BLOCK_SIZE - 8) {
+        memset(
+            self->block + self->block_len, 0,
+            MD5_BLOCK_SIZE - self->block_len);
+        md5_compress(self->h, self->block);
+        self->block_len = 0;
+    }
+    memset(
+        self->block + self->block_len, 0,
+        MD5_BLOCK_SIZE - 8 - self->block_len);
+    // Unlike SHA-1, MD5 is little-endian.
+    for (size_t i = 0; i < 8; i++) {
+        self->block[MD5_BLOCK_SIZE - 8 + i] = (uint8_t)(bits >> (8 * i));
+    }
+    md5_compress(self->h, self->block);
+
+    for (size_t i = 0; i < 4; i++) {
+        digest[4 * i] = (uint8_t)self->h[i];
+        digest[4 * i + 1] = (uint8_t)(self->h[i] >> 8);
+        digest[4 * i + 2] = (uint8_t)(self->h[i] >> 16);
+        digest[4 * i + 3] = (uint8_t)(self->h[i] >> 24);
+    }
+}
+
+bool smolrtsp_crypto_eq(const uint8_t *a, const uint8_t *b, size_t len) {
+    assert(a || 0 == len);
+    assert(b || 0 == len);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+
+    return 0 == diff;
+}
+
+void smolrtsp_crypto_wipe(void *data, size_t len) {
+    volatile uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = 0;
+    }
+}
+
+static uint8_t xtime(uint8_t x) {
+    return (uint8_t)(x << 1 ^ (x & 0x80 ? 0x1B : 0));
+}
+
+static void encrypt_block(
+    const SmolRTSP_Aes128 *key, const uint8_t in[restrict AES_BLOCK_SIZE],
+    uint8_t out[restrict AES_BLOCK_SIZE]) {
+    uint8_t s[AES_BLOCK_SIZE];
+    for (size_t i = 0; i < AES_BLOCK_SIZE; i++) {
+        s[i] = in[i] ^ key->round_keys[0][i];
+    }
+
+    for (size_t round = 1; round <= AES128_ROUNDS; round++) {
+        // SubBytes and ShiftRows; the state is stored column by column.
+        uint8_t t[AES_BLOCK_SIZE];
+        for (size_t col = 0; col < 4; col++) {
+            for (size_t row = 0; row < 4; row++) {
+                t[4 * col + row] = sbox[s[4 * ((col + row) % 4) + row]];
+            }
+        }
+
+        if (round < AES128_ROUNDS) {
+            for (size_t col = 0; col < 4; col++) {
+                uint8_t *c = t + 4 * col;
+                const uint8_t all = c[0] ^ c[1] ^ c[2] ^ c[3], first = c[0];
+                c[0] ^= all ^ xtime(c[0] ^ c[1]);
+                c[1] ^= all ^ xtime(c[1] ^ c[2]);
+                c[2] ^= all ^ xtime(c[2] ^ c[3]);
+                c[3] ^= all ^ xtime(c[3] ^ first);
+            }
+        }
+
+        for (size_t i = 0; i < AES_BLOCK_SIZE; i++) {
+            s[i] = t[i] ^ key->round_keys[round][i];
+        }
+    }
+
+    memcpy(out, s, AES_BLOCK_SIZE);
+}
+
+static uint16_t get_counter(const uint8_t block[restrict AES_BLOCK_SIZE]) {
+    return (uint16_t)(block[AES_BLOCK_SIZE - 2] << 8 |
+                      block[AES_BLOCK_SIZE - 1]);
+}
+
+static void set_counter(uint8_t block[restrict AES_BLOCK_SIZE], uint16_t n) {
+    block[AES_BLOCK_SIZE - 2] = (uint8_t)(n >> 8);
+    block[AES_BLOCK_SIZE - 1] = (uint8_t)n;
+}
+
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+static CtrKernel select_ctr_kernel(void) {
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+    if (__builtin_cpu_supports("aes")) {
+        return ctr_aesni;
+    }
+#endif
+
+#ifdef SMOLRTSP_HAS_ARMV8_AES
+    return ctr_armv8;
+#else
+    return ctr_scalar;
+#endif
+}
+
+static CtrKernel ctr_kernel(void) {
+    // Racing initializations store the same value.
+    static CtrKernel selected = NULL;
+    CtrKernel f = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+    if (NULL == f) {
+        f = select_ctr_kernel();
+        __atomic_store_n(&selected, f, __ATOMIC_RELAXED);
+    }
+
+    return f;
+}
+
+static void ctr_scalar(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len) {
+    uint8_t counter[AES_BLOCK_SIZE], keystream[AES_BLOCK_SIZE];
+    memcpy(counter, iv, AES_BLOCK_SIZE);
+    uint16_t n = get_counter(iv);
+
+    for (size_t i = 0; i < len; i += AES_BLOCK_SIZE) {
+        set_counter(counter, n++);
+        encrypt_block(key, counter, keystream);
+        xor_bytes(
+            data + i, keystream,
+            len - i < AES_BLOCK_SIZE ? len - i : AES_BLOCK_SIZE);
+    }
+}
+
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+
+__attribute__((target("aes,sse2"))) static void ctr_aesni(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len) {
+    __m128i rk[AES128_ROUNDS + 1];
+    for (size_t i = 0; i <= AES128_ROUNDS; i++) {
+        rk[i] = _mm_loadu_si128((const __m128i *)key->round_keys[i]);
+    }
+
+    // The counter is inserted into the IV in a register, rather than stored
+    // to memory and loaded back for every block.
+    const __m128i counter = _mm_loadu_si128((const __m128i *)iv);
+    uint16_t n = get_counter(iv);
+#define COUNTER_BLOCK(n)                                                       \
+    _mm_insert_epi16(counter, __builtin_bswap16(n), AES_BLOCK_SIZE / 2 - 1)
+
+    size_t i = 0;
+    for (; i + CTR_LANES * AES_BLOCK_SIZE <= len;
+         i += CTR_LANES * AES_BLOCK_SIZE) {
+        __m128i b[CTR_LANES];
+        for (size_t j = 0; j < CTR_LANES; j++) {
+            b[j] = _mm_xor_si128(COUNTER_BLOCK(n), rk[0]);
+            n++;
+        }
+        for (size_t r = 1; r < AES128_ROUNDS; r++) {
+            for (size_t j = 0; j < CTR_LANES; j++) {
+                b[j] = _mm_aesenc_si128(b[j], rk[r]);
+            }
+        }
+        for (size_t j = 0; j < CTR_LANES; j++) {
+            __m128i *p = (__m128i *)(data + i + j * AES_BLOCK_SIZE);
+            b[j] = _mm_aesenclast_si128(b[j], rk[AES128_ROUNDS]);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), b[j]));
+        }
+    }
+
+    for (; i < len; i += AES_BLOCK_SIZE) {
+        __m128i b = _mm_xor_si128(COUNTER_BLOCK(n), rk[0]);
+        n++;
+        for (size_t r = 1; r < AES128_ROUNDS; r++) {
+            b = _mm_aesenc_si128(b, rk[r]);
+        }
+        b = _mm_aesenclast_si128(b, rk[AES128_ROUNDS]);
+
+        uint8_t keystream[AES_BLOCK_SIZE];
+        _mm_storeu_si128((__m128i *)keystream, b);
+        xor_bytes(
+            data + i, keystream,
+            len - i < AES_BLOCK_SIZE ? len - i : AES_BLOCK_SIZE);
+    }
+#undef COUNTER_BLOCK
+}
+
+#endif // SMOLRTSP_HAS_AESNI_DISPATCH
+
+#ifdef SMOLRTSP_HAS_ARMV8_AES
+
+static void ctr_armv8(
+    const SmolRTSP_Aes128 *key, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len) {
+    uint8x16_t rk[AES128_ROUNDS + 1];
+    for (size_t i = 0; i <= AES128_ROUNDS; i++) {
+        rk[i] = vld1q_u8(key->round_keys[i]);
+    }
+
+    uint8_t counter[AES_BLOCK_SIZE];
+    memcpy(counter, iv, AES_BLOCK_SIZE);
+    uint16_t n = get_counter(iv);
+
+    for (size_t i = 0; i < len; i += AES_BLOCK_SIZE) {
+        set_counter(counter, n++);
+
+        // AESE adds the round key before SubBytes and ShiftRows.
+        uint8x16_t b = vld1q_u8(counter);
+        for (size_t r = 0; r < AES128_ROUNDS - 1; r++) {
+            b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+        }
+        b = veorq_u8(
+            vaeseq_u8(b, rk[AES128_ROUNDS - 1]), rk[AES128_ROUNDS]);
+
+        if (len - i >= AES_BLOCK_SIZE) {
+            vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), b));
+        } else {
+            uint8_t keystream[AES_BLOCK_SIZE];
+            vst1q_u8(keystream, b);
+            xor_bytes(data + i, keystream, len - i);
+        }
+    }
+}
+
+#endif // SMOLRTSP_HAS_ARMV8_AES
+
+static Sha1Kernel select_sha1_kernel(void) {
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        return sha1_compress_shani;
+    }
+#endif
+
+    return sha1_compress_scalar;
+}
+
+static void sha1_compress(uint32_t h[restrict 5], const uint8_t *block) {
+    // Racing initializations store the same value.
+    static Sha1Kernel selected = NULL;
+    Sha1Kernel f = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+    if (NULL == f) {
+        f = select_sha1_kernel();
+        __atomic_store_n(&selected, f, __ATOMIC_RELAXED);
+    }
+
+    f(h, block);
+}
+
+// The message schedule is kept in a ring of 16 words, and every group of 20
+// rounds has its own loop so that the round function is not selected per
+// round.
+#define SHA1_W(i)                                                              \
+    (w[(i) & 15] = rotl(                                                       \
+         w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ w[((i) + 2) & 15] ^          \
+             w[(i) & 15],                                                      \
+         1))
+
+#define SHA1_ROUND(f, k, wi)                                                   \
+    do {                                                                       \
+        const uint32_t t = rotl(a, 5) + (f) + e + (k) + (wi);                  \
+        e = d;                                                                 \
+        d = c;                                                                 \
+        c = rotl(b, 30);                                                       \
+        b = a;                                                                 \
+        a = t;                                                                 \
+    } while (0)
+
+static void
+sha1_compress_scalar(uint32_t h[restrict 5], const uint8_t *block) {
+    uint32_t w[16];
+    for (size_t i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[4 * i] << 24 |
+               (uint32_t)block[4 * i + 1] << 16 |
+               (uint32_t)block[4 * i + 2] << 8 | (uint32_t)block[4 * i + 3];
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for (size_t i = 0; i < 16; i++) {
+        SHA1_ROUND(d ^ (b & (c ^ d)), 0x5A827999, w[i]);
+    }
+    for (size_t i = 16; i < 20; i++) {
+        SHA1_ROUND(d ^ (b & (c ^ d)), 0x5A827999, SHA1_W(i));
+    }
+    for (size_t i = 20; i < 40; i++) {
+        SHA1_ROUND(b ^ c ^ d, 0x6ED9EBA1, SHA1_W(i));
+    }
+    for (size_t i = 40; i < 60; i++) {
+        SHA1_ROUND((b & c) | (d & (b | c)), 0x8F1BBCDC, SHA1_W(i));
+    }
+    for (size_t i = 60; i < 80; i++) {
+        SHA1_ROUND(b ^ c ^ d, 0xCA62C1D6, SHA1_W(i));
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+#undef SHA1_W
+#undef SHA1_ROUND
+
+#ifdef SMOLRTSP_HAS_AESNI_DISPATCH
+
+// Four rounds with the message words `msg`, computing E of the next four
+// rounds from A of these ones.
+#define SHA1NI_ROUNDS(e, e_next, msg, f)                                       \
+    do {                                                                       \
+        e = _mm_sha1nexte_epu32(e, msg);                                       \
+        e_next = abcd;                                                         \
+        abcd = _mm_sha1rnds4_epu32(abcd, e, f);                                \
+    } while (0)
+
+// Advances the message schedule by the words `cur` of the current four
+// rounds: `next` is completed, and the words of the following rounds are
+// prepared.
+#define SHA1NI_SCHEDULE(cur, next, after_next, last)                           \
+    do {                                                                       \
+        next = _mm_sha1msg2_epu32(next, cur);                                  \
+        last = _mm_sha1msg1_epu32(last, cur);                                  \
+        after_next = _mm_xor_si128(after_next, cur);                           \
+    } while (0)
+
+__attribute__((target("sha,sse4.1"))) static void
+sha1_compress_shani(uint32_t h[restrict 5], const uint8_t *block) {
+    // Reverses the bytes, so that the first big-endian word is in the highest
+    // lane.
+    const __m128i bswap =
+        _mm_set_epi64x(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+
+    const __m128i abcd_save =
+        _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0x1B);
+    const __m128i e_save = _mm_set_epi32((int)h[4], 0, 0, 0);
+
+    __m128i abcd = abcd_save, e0, e1;
+    __m128i m0 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)block), bswap);
+    __m128i m1 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)(block + 16)), bswap);
+    __m128i m2 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)(block + 32)), bswap);
+    __m128i m3 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)(block + 48)), bswap);
+
+    // Rounds 0-15.
+    e0 = _mm_add_epi32(e_save, m0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    SHA1NI_ROUNDS(e1, e0, m1, 0);
+    m0 = _mm_sha1msg1_epu32(m0, m1);
+    SHA1NI_ROUNDS(e0, e1, m2, 0);
+    m1 = _mm_sha1msg1_epu32(m1, m2);
+    m0 = _mm_xor_si128(m0, m2);
+    SHA1NI_ROUNDS(e1, e0, m3, 0);
+    SHA1NI_SCHEDULE(m3, m0, m1, m2);
+
+    // Rounds 16-67.
+    SHA1NI_ROUNDS(e0, e1, m0, 0);
+    SHA1NI_SCHEDULE(m0, m1, m2, m3);
+    SHA1NI_ROUNDS(e1, e0, m1, 1);
+    SHA1NI_SCHEDULE(m1, m2, m3, m0);
+    SHA1NI_ROUNDS(e0, e1, m2, 1);
+    SHA1NI_SCHEDULE(m2, m3, m0, m1);
+    SHA1NI_ROUNDS(e1, e0, m3, 1);
+    SHA1NI_SCHEDULE(m3, m0, m1, m2);
+    SHA1NI_ROUNDS(e0, e1, m0, 1);
+    SHA1NI_SCHEDULE(m0, m1, m2, m3);
+    SHA1NI_ROUNDS(e1, e0, m1, 1);
+    SHA1NI_SCHEDULE(m1, m2, m3, m0);
+    SHA1NI_ROUNDS(e0, e1, m2, 2);
+    SHA1NI_SCHEDULE(m2, m3, m0, m1);
+    SHA1NI_ROUNDS(e1, e0, m3, 2);
+    SHA1NI_SCHEDULE(m3, m0, m1, m2);
+    SHA1NI_ROUNDS(e0, e1, m0, 2);
+    SHA1NI_SCHEDULE(m0, m1, m2, m3);
+    SHA1NI_ROUNDS(e1, e0, m1, 2);
+    SHA1NI_SCHEDULE(m1, m2, m3, m0);
+    SHA1NI_ROUNDS(e0, e1, m2, 2);
+    SHA1NI_SCHEDULE(m2, m3, m0, m1);
+    SHA1NI_ROUNDS(e1, e0, m3, 3);
+    SHA1NI_SCHEDULE(m3, m0, m1, m2);
+    SHA1NI_ROUNDS(e0, e1, m0, 3);
+    SHA1NI_SCHEDULE(m0, m1, m2, m3);
+
+    // Rounds 68-79, with no words left to prepare.
+    SHA1NI_ROUNDS(e1, e0, m1, 3);
+    m2 = _mm_sha1msg2_epu32(m2, m1);
+    m3 = _mm_xor_si128(m3, m1);
+    SHA1NI_ROUNDS(e0, e1, m2, 3);
+    m3 = _mm_sha1msg2_epu32(m3, m2);
+    SHA1NI_ROUNDS(e1, e0, m3, 3);
+
+    e0 = _mm_sha1nexte_epu32(e0, e_save);
+    abcd = _mm_shuffle_epi32(_mm_add_epi32(abcd, abcd_save), 0x1B);
+    _mm_storeu_si128((__m128i *)h, abcd);
+    h[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#undef SHA1NI_ROUNDS
+#undef SHA1NI_SCHEDULE
+
+#endif // SMOLRTSP_HAS_AESNI_DISPATCH
+
+static void md5_compress(uint32_t h[restrict 4], const uint8_t *block) {
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) {
+        m[i] = (uint32_t)block[4 * i] | (uint32_t)block[4 * i + 1] << 8 |
+               (uint32_t)block[4 * i + 2] << 16 |
+               (uint32_t)block[4 * i + 3] << 24;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+
+    for (size_t i = 0; i < 64; i++) {
+        uint32_t f;
+        size_t g;
+        switch (i / 16) {
+        case 0:
+            f = (b & c) | (~b & d);
+            g = i;
+            break;
+        case 1:
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+            break;
+        case 2:
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+            break;
+        default:
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+            break;
+        }
+
+        const uint32_t tmp = d;
+        d = c;
+        c = b;
+        b += rotl(a + f + md5_k[i] + m[g], md5_shifts[i / 16][i % 4]);
+        a = tmp;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+static uint32_t rotl(uint32_t x, unsigned n) {
+    return x << n | x >> (32 - n);
+}
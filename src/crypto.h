@@ -0,0 +1,79 @@
+// The cryptographic primitives of SRTP: AES-128 in counter mode and
+// HMAC-SHA1; and MD5 of the Digest authentication.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AES_BLOCK_SIZE   16
+#define AES128_KEY_SIZE  16
+#define AES128_ROUNDS    10
+#define SHA1_DIGEST_SIZE 20
+#define SHA1_BLOCK_SIZE  64
+#define MD5_DIGEST_SIZE  16
+#define MD5_BLOCK_SIZE   64
+
+// The expanded key of AES-128, in the byte order of FIPS 197 (which is also
+// the order expected by AES-NI and the ARMv8 crypto extension).
+typedef struct {
+    uint8_t round_keys[AES128_ROUNDS + 1][AES_BLOCK_SIZE];
+} SmolRTSP_Aes128;
+
+void SmolRTSP_Aes128_init(
+    SmolRTSP_Aes128 *self, const uint8_t key[restrict AES128_KEY_SIZE]);
+
+// XORs `len` bytes of `data` in place with the keystream of AES counter mode
+// starting at the counter block `iv`. Only the last 16 bits of the counter are
+// incremented (the block counter of SRTP), so `len` must be at most 2^20.
+void SmolRTSP_Aes128_ctr(
+    const SmolRTSP_Aes128 *self, const uint8_t iv[restrict AES_BLOCK_SIZE],
+    uint8_t *data, size_t len);
+
+typedef struct {
+    uint32_t h[5];
+    uint64_t len;
+    uint8_t block[SHA1_BLOCK_SIZE];
+    size_t block_len;
+} SmolRTSP_Sha1;
+
+void SmolRTSP_Sha1_init(SmolRTSP_Sha1 *self);
+void SmolRTSP_Sha1_update(SmolRTSP_Sha1 *self, const void *data, size_t len);
+void SmolRTSP_Sha1_final(
+    SmolRTSP_Sha1 *self, uint8_t digest[restrict SHA1_DIGEST_SIZE]);
+
+// The SHA-1 states after the inner and outer padded keys, so that a MAC costs
+// no key blocks.
+typedef struct {
+    SmolRTSP_Sha1 inner, outer;
+} SmolRTSP_HmacSha1;
+
+void SmolRTSP_HmacSha1_init(
+    SmolRTSP_HmacSha1 *self, const uint8_t *key, size_t key_len);
+
+// Starts a MAC in `ctx`, which is then fed with `SmolRTSP_Sha1_update`.
+void SmolRTSP_HmacSha1_start(
+    const SmolRTSP_HmacSha1 *self, SmolRTSP_Sha1 *ctx);
+void SmolRTSP_HmacSha1_finish(
+    const SmolRTSP_HmacSha1 *self, SmolRTSP_Sha1 *ctx,
+    uint8_t mac[restrict SHA1_DIGEST_SIZE]);
+
+typedef struct {
+    uint32_t h[4];
+    uint64_t len;
+    uint8_t block[MD5_BLOCK_SIZE];
+    size_t block_len;
+} SmolRTSP_Md5;
+
+void SmolRTSP_Md5_init(SmolRTSP_Md5 *self);
+void SmolRTSP_Md5_update(SmolRTSP_Md5 *self, const void *data, size_t len);
+void SmolRTSP_Md5_final(
+    SmolRTSP_Md5 *self, uint8_t digest[restrict MD5_DIGEST_SIZE]);
+
+// Compares `len` bytes of `a` and `b` in a constant time.
+bool smolrtsp_crypto_eq(const uint8_t *a, const uint8_t *b, size_t len);
+
+// Overwrites `len` bytes of `data` with zeros in a way that is not optimized
+// away.
+void smolrtsp_crypto_wipe(void *data, size_t len);
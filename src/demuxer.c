@@ -0,0 +1,141 @@
+#include <smolrtsp/demuxer.h>
+
+#include <smolrtsp/util.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#define FRAME_HEADER_SIZE sizeof(uint32_t)
+
+static SmolRTSP_ChannelBinding *
+find_binding(SmolRTSP_Demuxer *self, uint8_t channel_id);
+static bool handle_frame(SmolRTSP_Demuxer *restrict self, CharSlice99 input);
+
+SmolRTSP_Demuxer SmolRTSP_Demuxer_new(void) {
+    return (SmolRTSP_Demuxer){
+        .parser = SmolRTSP_RequestParser_new(),
+        .frames_len = 0,
+        .dropped_frames = 0,
+        .bindings_len = 0,
+    };
+}
+
+int SmolRTSP_Demuxer_bind(
+    SmolRTSP_Demuxer *self, uint8_t channel_id,
+    SmolRTSP_FrameHandler handler) {
+    assert(self);
+
+    SmolRTSP_ChannelBinding *binding = find_binding(self, channel_id);
+    if (binding != NULL) {
+        binding->handler = handler;
+        return 0;
+    }
+
+    if (SMOLRTSP_DEMUXER_MAX_CHANNELS == self->bindings_len) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    self->bindings[self->bindings_len++] = (SmolRTSP_ChannelBinding){
+        .channel_id = channel_id,
+        .handler = handler,
+    };
+
+    return 0;
+}
+
+void SmolRTSP_Demuxer_unbind(SmolRTSP_Demuxer *self, uint8_t channel_id) {
+    assert(self);
+
+    SmolRTSP_ChannelBinding *binding = find_binding(self, channel_id);
+    if (binding != NULL) {
+        *binding = self->bindings[--self->bindings_len];
+    }
+}
+
+SmolRTSP_ParseResult SmolRTSP_Demuxer_parse(
+    SmolRTSP_Demuxer *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input) {
+    assert(self);
+    assert(request);
+    assert(self->frames_len <= input.len);
+
+    // Frames can only come between requests, i.e., before the request line
+    // has begun.
+    while (SmolRTSP_RequestParserSection_StartLine == self->parser.section &&
+           0 == self->parser.scanned) {
+        if (!handle_frame(self, CharSlice99_advance(input, self->frames_len))) {
+            break;
+        }
+    }
+
+    const SmolRTSP_ParseResult res = SmolRTSP_RequestParser_parse(
+        &self->parser, request, CharSlice99_advance(input, self->frames_len));
+
+    if (SmolRTSP_ParseResult_is_partial(res)) {
+        return res;
+    }
+
+    // The request or the malformed data ends the current message either way.
+    const size_t len = self->frames_len + self->parser.offset;
+    self->parser = SmolRTSP_RequestParser_new();
+    self->frames_len = 0;
+
+    return SmolRTSP_ParseResult_is_complete(res)
+               ? SmolRTSP_ParseResult_complete(len)
+               : res;
+}
+
+size_t SmolRTSP_Demuxer_drain(SmolRTSP_Demuxer *self) {
+    assert(self);
+
+    if (self->parser.section != SmolRTSP_RequestParserSection_StartLine) {
+        return 0;
+    }
+
+    const size_t len = self->frames_len;
+    self->frames_len = 0;
+    return len;
+}
+
+static SmolRTSP_ChannelBinding *
+find_binding(SmolRTSP_Demuxer *self, uint8_t channel_id) {
+    for (size_t i = 0; i < self->bindings_len; i++) {
+        if (self->bindings[i].channel_id == channel_id) {
+            return &self->bindings[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Hands the frame at the beginning of `input` to its handler. Returns false if
+// `input` does not begin with a complete frame.
+static bool handle_frame(SmolRTSP_Demuxer *restrict self, CharSlice99 input) {
+    if (input.len < FRAME_HEADER_SIZE || input.ptr[0] != '$') {
+        return false;
+    }
+
+    uint8_t channel_id = 0;
+    uint16_t payload_len = 0;
+    smolrtsp_parse_interleaved_header(
+        (const uint8_t *)input.ptr, &channel_id, &payload_len);
+
+    if (input.len < FRAME_HEADER_SIZE + payload_len) {
+        return false;
+    }
+
+    const U8Slice99 payload = U8Slice99_new(
+        (uint8_t *)input.ptr + FRAME_HEADER_SIZE, payload_len);
+
+    SmolRTSP_ChannelBinding *binding = find_binding(self, channel_id);
+    if (binding != NULL) {
+        VCALL(binding->handler, on_frame, channel_id, payload);
+    } else {
+        self->dropped_frames++;
+    }
+
+    self->frames_len += FRAME_HEADER_SIZE + payload_len;
+    return true;
+}
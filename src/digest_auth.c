@@ -0,0 +1,743 @@
+#include <smolrtsp/digest_auth.h>
+
+#include <smolrtsp/types/header.h>
+#include <smolrtsp/types/status_code.h>
+
+#include "alloc.h"
+#include "crypto.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+#include <pthread.h>
+#include <sys/random.h>
+#include <time.h>
+
+#define US_PER_SEC UINT64_C(1000000)
+
+// A nonce is the index of its slot, the number of the challenge, and a MAC of
+// both under a random key, so that nonces are unpredictable.
+#define NONCE_SIZE     (SMOLRTSP_DIGEST_NONCE_LEN / 2)
+#define NONCE_MAC_SIZE (NONCE_SIZE - 8)
+#define NONCE_KEY_SIZE 20
+
+typedef struct {
+    char *name;
+    size_t name_len;
+    char ha1[SMOLRTSP_DIGEST_HEX_LEN];
+} User;
+
+typedef struct {
+    uint8_t nonce[NONCE_SIZE];
+    bool in_use;
+    uint64_t issued_us;
+
+    // The greatest nonce count of the requests with `qop=auth`.
+    uint32_t nc;
+
+    // The last request verified without `qop`, for the fast path.
+    bool has_last;
+    size_t last_user;
+    char last_request[SMOLRTSP_DIGEST_AUTH_FAST_PATH_MAX];
+    size_t last_request_len;
+    uint8_t last_response[MD5_DIGEST_SIZE];
+} NonceSlot;
+
+struct SmolRTSP_DigestAuth {
+    SmolRTSP_DigestAuthConfig config;
+    char *realm;
+    SmolRTSP_HmacSha1 nonce_key;
+
+    // Updated with atomics.
+    SmolRTSP_DigestAuthStats stats;
+
+    // Guards the users and the nonces.
+    pthread_mutex_t mutex;
+    User *users;
+    size_t users_count;
+    NonceSlot *nonces;
+    uint32_t challenges_count;
+};
+
+static uint64_t now_us(const SmolRTSP_DigestAuth *self);
+static NonceSlot *
+find_nonce(SmolRTSP_DigestAuth *self, CharSlice99 nonce, uint64_t now);
+static bool is_fast_path(
+    const SmolRTSP_DigestAuth *self, const NonceSlot *slot,
+    const SmolRTSP_DigestCredentials *creds, CharSlice99 method,
+    const uint8_t response[restrict MD5_DIGEST_SIZE]);
+static const User *find_user(
+    const SmolRTSP_DigestAuth *self, CharSlice99 username, size_t *index);
+static void compute_response(
+    const User *user, CharSlice99 method,
+    const SmolRTSP_DigestCredentials *creds,
+    uint8_t response[restrict MD5_DIGEST_SIZE]);
+static void remember_request(
+    NonceSlot *slot, size_t user, CharSlice99 method, CharSlice99 uri,
+    const uint8_t response[restrict MD5_DIGEST_SIZE]);
+static int add_user(SmolRTSP_DigestAuth *self, const char *username, User u);
+static void count(uint64_t *counter);
+
+static CharSlice99 skip_spaces(CharSlice99 s);
+static bool parse_param(
+    CharSlice99 *restrict input, CharSlice99 *restrict name,
+    CharSlice99 *restrict value);
+static bool eq_nocase(CharSlice99 s, const char *restrict str);
+static void
+hex_encode(const uint8_t *restrict bytes, size_t len, char *restrict hex);
+static bool
+hex_decode(CharSlice99 hex, uint8_t *restrict bytes, size_t len);
+static void md5_hex(SmolRTSP_Md5 *ctx, char hex[restrict MD5_DIGEST_SIZE * 2]);
+
+int SmolRTSP_DigestCredentials_parse(
+    CharSlice99 value, SmolRTSP_DigestCredentials *restrict credentials) {
+    assert(credentials);
+
+    *credentials = (SmolRTSP_DigestCredentials){
+        .username = CharSlice99_empty(),
+        .realm = CharSlice99_empty(),
+        .nonce = CharSlice99_empty(),
+        .uri = CharSlice99_empty(),
+        .response = CharSlice99_empty(),
+        .algorithm = CharSlice99_empty(),
+        .qop = CharSlice99_empty(),
+        .nc = CharSlice99_empty(),
+        .cnonce = CharSlice99_empty(),
+        .opaque = CharSlice99_empty(),
+    };
+
+    value = skip_spaces(value);
+    const CharSlice99 scheme = CharSlice99_from_str("Digest");
+    if (value.len <= scheme.len || ' ' != value.ptr[scheme.len] ||
+        !eq_nocase(CharSlice99_sub(value, 0, scheme.len), "Digest")) {
+        goto fail;
+    }
+    value = CharSlice99_advance(value, scheme.len);
+
+    for (;;) {
+        CharSlice99 name, param;
+        value = skip_spaces(value);
+        if (CharSlice99_is_empty(value)) {
+            break;
+        }
+        if (!parse_param(&value, &name, &param)) {
+            goto fail;
+        }
+
+        if (eq_nocase(name, "username")) {
+            credentials->username = param;
+        } else if (eq_nocase(name, "realm")) {
+            credentials->realm = param;
+        } else if (eq_nocase(name, "nonce")) {
+            credentials->nonce = param;
+        } else if (eq_nocase(name, "uri")) {
+            credentials->uri = param;
+        } else if (eq_nocase(name, "response")) {
+            credentials->response = param;
+        } else if (eq_nocase(name, "algorithm")) {
+            credentials->algorithm = param;
+        } else if (eq_nocase(name, "qop")) {
+            credentials->qop = param;
+        } else if (eq_nocase(name, "nc")) {
+            credentials->nc = param;
+        } else if (eq_nocase(name, "cnonce")) {
+            credentials->cnonce = param;
+        } else if (eq_nocase(name, "opaque")) {
+            credentials->opaque = param;
+        }
+    }
+
+    if (CharSlice99_is_empty(credentials->username) ||
+        CharSlice99_is_empty(credentials->nonce) ||
+        CharSlice99_is_empty(credentials->uri) ||
+        CharSlice99_is_empty(credentials->response)) {
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
+
+void smolrtsp_digest_ha1(
+    const char *username, const char *realm, const char *password,
+    char ha1[restrict SMOLRTSP_DIGEST_HEX_LEN + 1]) {
+    assert(username);
+    assert(realm);
+    assert(password);
+    assert(ha1);
+
+    SmolRTSP_Md5 ctx;
+    SmolRTSP_Md5_init(&ctx);
+    SmolRTSP_Md5_update(&ctx, username, strlen(username));
+    SmolRTSP_Md5_update(&ctx, ":", 1);
+    SmolRTSP_Md5_update(&ctx, realm, strlen(realm));
+    SmolRTSP_Md5_update(&ctx, ":", 1);
+    SmolRTSP_Md5_update(&ctx, password, strlen(password));
+    md5_hex(&ctx, ha1);
+    ha1[SMOLRTSP_DIGEST_HEX_LEN] = '\0';
+
+    smolrtsp_crypto_wipe(&ctx, sizeof ctx);
+}
+
+SmolRTSP_DigestAuthConfig SmolRTSP_DigestAuthConfig_default(const char *realm) {
+    assert(realm);
+
+    return (SmolRTSP_DigestAuthConfig){
+        .realm = realm,
+        .nonces_count = SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCES_COUNT,
+        .nonce_lifetime_us = SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCE_LIFETIME_US,
+        .qop_auth = false,
+        .clock_us = NULL,
+    };
+}
+
+SmolRTSP_DigestAuth *SmolRTSP_DigestAuth_new(SmolRTSP_DigestAuthConfig config) {
+    assert(config.realm);
+    assert(config.nonces_count > 0);
+    assert(config.nonce_lifetime_us > 0);
+
+    uint8_t key[NONCE_KEY_SIZE];
+    const ssize_t ret = getrandom(key, sizeof key, 0);
+    if (ret != (ssize_t)sizeof key) {
+        if (ret >= 0) {
+            errno = EIO;
+        }
+        return NULL;
+    }
+
+    SmolRTSP_DigestAuth *self = smolrtsp_malloc(sizeof *self);
+    const size_t realm_size = strlen(config.realm) + 1;
+    char *realm = smolrtsp_malloc(realm_size);
+    NonceSlot *nonces =
+        smolrtsp_malloc(config.nonces_count * sizeof nonces[0]);
+    if (NULL == self || NULL == realm || NULL == nonces) {
+        smolrtsp_free(self);
+        smolrtsp_free(realm);
+        smolrtsp_free(nonces);
+        smolrtsp_crypto_wipe(key, sizeof key);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(realm, config.realm, realm_size);
+    config.realm = realm;
+    self->config = config;
+    self->realm = realm;
+
+    SmolRTSP_HmacSha1_init(&self->nonce_key, key, sizeof key);
+    smolrtsp_crypto_wipe(key, sizeof key);
+
+    self->stats = (SmolRTSP_DigestAuthStats){0, 0, 0, 0, 0};
+
+    const int mutex_ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == mutex_ret);
+    (void)mutex_ret;
+
+    self->users = NULL;
+    self->users_count = 0;
+    self->nonces = nonces;
+    for (size_t i = 0; i < config.nonces_count; i++) {
+        nonces[i].in_use = false;
+    }
+    self->challenges_count = 0;
+
+    return self;
+}
+
+int SmolRTSP_DigestAuth_add_user(
+    SmolRTSP_DigestAuth *self, const char *username, const char *password) {
+    assert(self);
+    assert(username);
+    assert(password);
+
+    char ha1[SMOLRTSP_DIGEST_HEX_LEN + 1];
+    smolrtsp_digest_ha1(username, self->realm, password, ha1);
+
+    const int ret = SmolRTSP_DigestAuth_add_user_ha1(
+        self, username, CharSlice99_new(ha1, SMOLRTSP_DIGEST_HEX_LEN));
+    smolrtsp_crypto_wipe(ha1, sizeof ha1);
+
+    return ret;
+}
+
+int SmolRTSP_DigestAuth_add_user_ha1(
+    SmolRTSP_DigestAuth *self, const char *username, CharSlice99 ha1) {
+    assert(self);
+    assert(username);
+
+    uint8_t bytes[MD5_DIGEST_SIZE];
+    if (!hex_decode(ha1, bytes, sizeof bytes)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The digests are computed over the lowercase form.
+    User u;
+    hex_encode(bytes, sizeof bytes, u.ha1);
+    smolrtsp_crypto_wipe(bytes, sizeof bytes);
+
+    const int ret = add_user(self, username, u);
+    smolrtsp_crypto_wipe(&u, sizeof u);
+
+    return ret;
+}
+
+void SmolRTSP_DigestAuth_issue_nonce(
+    SmolRTSP_DigestAuth *self,
+    char nonce[restrict SMOLRTSP_DIGEST_NONCE_LEN + 1]) {
+    assert(self);
+    assert(nonce);
+
+    pthread_mutex_lock(&self->mutex);
+
+    // The challenges go round the slots, so a new nonce evicts the oldest one.
+    const uint32_t n = self->challenges_count++;
+    const uint32_t i = (uint32_t)(n % self->config.nonces_count);
+
+    NonceSlot *slot = &self->nonces[i];
+    const uint8_t header[8] = {
+        (uint8_t)(i >> 24), (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i,
+        (uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n,
+    };
+
+    SmolRTSP_Sha1 ctx;
+    uint8_t mac[SHA1_DIGEST_SIZE];
+    SmolRTSP_HmacSha1_start(&self->nonce_key, &ctx);
+    SmolRTSP_Sha1_update(&ctx, header, sizeof header);
+    SmolRTSP_HmacSha1_finish(&self->nonce_key, &ctx, mac);
+
+    memcpy(slot->nonce, header, sizeof header);
+    memcpy(slot->nonce + sizeof header, mac, NONCE_MAC_SIZE);
+    slot->in_use = true;
+    slot->issued_us = now_us(self);
+    slot->nc = 0;
+    slot->has_last = false;
+
+    hex_encode(slot->nonce, NONCE_SIZE, nonce);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    nonce[SMOLRTSP_DIGEST_NONCE_LEN] = '\0';
+}
+
+SmolRTSP_DigestAuthResult SmolRTSP_DigestAuth_verify(
+    SmolRTSP_DigestAuth *self, CharSlice99 method, CharSlice99 uri,
+    CharSlice99 authorization) {
+    assert(self);
+
+    SmolRTSP_DigestCredentials creds;
+    uint8_t response[MD5_DIGEST_SIZE];
+    uint32_t nc = 0;
+
+    if (SmolRTSP_DigestCredentials_parse(authorization, &creds) == -1 ||
+        !hex_decode(creds.response, response, sizeof response) ||
+        !CharSlice99_primitive_eq(creds.uri, uri) ||
+        !CharSlice99_primitive_eq(
+            creds.realm, CharSlice99_from_str(self->realm))) {
+        goto reject;
+    }
+
+    if (!CharSlice99_is_empty(creds.algorithm) &&
+        !eq_nocase(creds.algorithm, "MD5")) {
+        goto reject;
+    }
+
+    const bool has_qop = !CharSlice99_is_empty(creds.qop);
+    if (has_qop) {
+        uint8_t nc_bytes[4];
+        if (!eq_nocase(creds.qop, "auth") ||
+            CharSlice99_is_empty(creds.cnonce) ||
+            !hex_decode(creds.nc, nc_bytes, sizeof nc_bytes)) {
+            goto reject;
+        }
+        nc = (uint32_t)nc_bytes[0] << 24 | (uint32_t)nc_bytes[1] << 16 |
+             (uint32_t)nc_bytes[2] << 8 | (uint32_t)nc_bytes[3];
+    }
+
+    pthread_mutex_lock(&self->mutex);
+
+    const uint64_t now = now_us(self);
+    NonceSlot *slot = find_nonce(self, creds.nonce, now);
+
+    if (NULL != slot && !has_qop &&
+        is_fast_path(self, slot, &creds, method, response)) {
+        pthread_mutex_unlock(&self->mutex);
+        count(&self->stats.fast_path);
+        count(&self->stats.accepted);
+        return SmolRTSP_DigestAuthResult_Accepted;
+    }
+
+    size_t user_index;
+    const User *user = find_user(self, creds.username, &user_index);
+    uint8_t expected[MD5_DIGEST_SIZE];
+    if (NULL != user) {
+        compute_response(user, method, &creds, expected);
+    }
+
+    if (NULL == user ||
+        !smolrtsp_crypto_eq(expected, response, sizeof expected)) {
+        pthread_mutex_unlock(&self->mutex);
+        goto reject;
+    }
+
+    if (NULL == slot) {
+        pthread_mutex_unlock(&self->mutex);
+        count(&self->stats.stale);
+        return SmolRTSP_DigestAuthResult_Stale;
+    }
+
+    if (has_qop) {
+        // A nonce count that does not grow is a replay.
+        if (nc <= slot->nc) {
+            pthread_mutex_unlock(&self->mutex);
+            goto reject;
+        }
+        slot->nc = nc;
+    } else {
+        remember_request(slot, user_index, method, uri, response);
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    count(&self->stats.accepted);
+    return SmolRTSP_DigestAuthResult_Accepted;
+
+reject:
+    count(&self->stats.rejected);
+    return SmolRTSP_DigestAuthResult_Rejected;
+}
+
+SmolRTSP_DigestAuthStats
+SmolRTSP_DigestAuth_stats(const SmolRTSP_DigestAuth *self) {
+    assert(self);
+
+    return (SmolRTSP_DigestAuthStats){
+        .accepted = __atomic_load_n(&self->stats.accepted, __ATOMIC_RELAXED),
+        .fast_path = __atomic_load_n(&self->stats.fast_path, __ATOMIC_RELAXED),
+        .challenged =
+            __atomic_load_n(&self->stats.challenged, __ATOMIC_RELAXED),
+        .stale = __atomic_load_n(&self->stats.stale, __ATOMIC_RELAXED),
+        .rejected = __atomic_load_n(&self->stats.rejected, __ATOMIC_RELAXED),
+    };
+}
+
+static void SmolRTSP_DigestAuth_drop(VSelf) {
+    VSELF(SmolRTSP_DigestAuth);
+    assert(self);
+
+    for (size_t i = 0; i < self->users_count; i++) {
+        smolrtsp_free(self->users[i].name);
+    }
+    smolrtsp_crypto_wipe(self->users, self->users_count * sizeof(User));
+    smolrtsp_free(self->users);
+    smolrtsp_free(self->nonces);
+    smolrtsp_free(self->realm);
+    smolrtsp_crypto_wipe(&self->nonce_key, sizeof self->nonce_key);
+
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_DigestAuth);
+
+SmolRTSP_ControlFlow smolrtsp_digest_auth_check(
+    SmolRTSP_DigestAuth *self, SmolRTSP_Context *ctx,
+    const SmolRTSP_Request *restrict req) {
+    assert(self);
+    assert(ctx);
+    assert(req);
+
+    CharSlice99 authorization;
+    SmolRTSP_DigestAuthResult result = SmolRTSP_DigestAuthResult_Rejected;
+    if (SmolRTSP_HeaderMap_find_id(
+            &req->header_map, SmolRTSP_HeaderId_Authorization,
+            &authorization)) {
+        result = SmolRTSP_DigestAuth_verify(
+            self, req->start_line.method, req->start_line.uri, authorization);
+    }
+
+    if (SmolRTSP_DigestAuthResult_Accepted == result) {
+        return SmolRTSP_ControlFlow_Continue;
+    }
+
+    char nonce[SMOLRTSP_DIGEST_NONCE_LEN + 1];
+    SmolRTSP_DigestAuth_issue_nonce(self, nonce);
+
+    count(&self->stats.challenged);
+    smolrtsp_header(
+        ctx, SMOLRTSP_HEADER_WWW_AUTHENTICATE,
+        "Digest realm=\"%s\", nonce=\"%s\"%s%s", self->realm, nonce,
+        self->config.qop_auth ? ", qop=\"auth\"" : "",
+        SmolRTSP_DigestAuthResult_Stale == result ? ", stale=true" : "");
+    smolrtsp_respond(ctx, SMOLRTSP_STATUS_UNAUTHORIZED, "Unauthorized");
+
+    return SmolRTSP_ControlFlow_Break;
+}
+
+static uint64_t now_us(const SmolRTSP_DigestAuth *self) {
+    if (self->config.clock_us != NULL) {
+        return self->config.clock_us();
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * US_PER_SEC + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static NonceSlot *
+find_nonce(SmolRTSP_DigestAuth *self, CharSlice99 nonce, uint64_t now) {
+    uint8_t bytes[NONCE_SIZE];
+    if (!hex_decode(nonce, bytes, sizeof bytes)) {
+        return NULL;
+    }
+
+    const uint32_t i = (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 |
+                       (uint32_t)bytes[2] << 8 | (uint32_t)bytes[3];
+    if (i >= self->config.nonces_count) {
+        return NULL;
+    }
+
+    NonceSlot *slot = &self->nonces[i];
+    if (!slot->in_use || !smolrtsp_crypto_eq(slot->nonce, bytes, NONCE_SIZE) ||
+        now - slot->issued_us >= self->config.nonce_lifetime_us) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+static bool is_fast_path(
+    const SmolRTSP_DigestAuth *self, const NonceSlot *slot,
+    const SmolRTSP_DigestCredentials *creds, CharSlice99 method,
+    const uint8_t response[restrict MD5_DIGEST_SIZE]) {
+    if (!slot->has_last) {
+        return false;
+    }
+
+    // The digest is a function of the user, the nonce, the method, and the
+    // URI, so the same digest of the same request is valid again.
+    const User *user = &self->users[slot->last_user];
+    const CharSlice99 last = CharSlice99_new(
+        (char *)slot->last_request, slot->last_request_len);
+
+    return CharSlice99_primitive_eq(
+               creds->username, CharSlice99_new(user->name, user->name_len)) &&
+           method.len + 1 + creds->uri.len == last.len &&
+           CharSlice99_primitive_eq(
+               method, CharSlice99_sub(last, 0, method.len)) &&
+           CharSlice99_primitive_eq(
+               creds->uri, CharSlice99_advance(last, method.len + 1)) &&
+           smolrtsp_crypto_eq(slot->last_response, response, MD5_DIGEST_SIZE);
+}
+
+static const User *find_user(
+    const SmolRTSP_DigestAuth *self, CharSlice99 username, size_t *index) {
+    for (size_t i = 0; i < self->users_count; i++) {
+        const User *u = &self->users[i];
+        if (CharSlice99_primitive_eq(
+                username, CharSlice99_new(u->name, u->name_len))) {
+            *index = i;
+            return u;
+        }
+    }
+
+    return NULL;
+}
+
+static void compute_response(
+    const User *user, CharSlice99 method,
+    const SmolRTSP_DigestCredentials *creds,
+    uint8_t response[restrict MD5_DIGEST_SIZE]) {
+    char ha2[MD5_DIGEST_SIZE * 2];
+    SmolRTSP_Md5 ctx;
+    SmolRTSP_Md5_init(&ctx);
+    SmolRTSP_Md5_update(&ctx, method.ptr, method.len);
+    SmolRTSP_Md5_update(&ctx, ":", 1);
+    SmolRTSP_Md5_update(&ctx, creds->uri.ptr, creds->uri.len);
+    md5_hex(&ctx, ha2);
+
+    SmolRTSP_Md5_init(&ctx);
+    SmolRTSP_Md5_update(&ctx, user->ha1, sizeof user->ha1);
+    SmolRTSP_Md5_update(&ctx, ":", 1);
+    SmolRTSP_Md5_update(&ctx, creds->nonce.ptr, creds->nonce.len);
+    SmolRTSP_Md5_update(&ctx, ":", 1);
+    if (!CharSlice99_is_empty(creds->qop)) {
+        SmolRTSP_Md5_update(&ctx, creds->nc.ptr, creds->nc.len);
+        SmolRTSP_Md5_update(&ctx, ":", 1);
+        SmolRTSP_Md5_update(&ctx, creds->cnonce.ptr, creds->cnonce.len);
+        SmolRTSP_Md5_update(&ctx, ":", 1);
+        SmolRTSP_Md5_update(&ctx, creds->qop.ptr, creds->qop.len);
+        SmolRTSP_Md5_update(&ctx, ":", 1);
+    }
+    SmolRTSP_Md5_update(&ctx, ha2, sizeof ha2);
+    SmolRTSP_Md5_final(&ctx, response);
+}
+
+static void remember_request(
+    NonceSlot *slot, size_t user, CharSlice99 method, CharSlice99 uri,
+    const uint8_t response[restrict MD5_DIGEST_SIZE]) {
+    if (method.len + 1 + uri.len > sizeof slot->last_request) {
+        slot->has_last = false;
+        return;
+    }
+
+    memcpy(slot->last_request, method.ptr, method.len);
+    slot->last_request[method.len] = ' ';
+    memcpy(slot->last_request + method.len + 1, uri.ptr, uri.len);
+    slot->last_request_len = method.len + 1 + uri.len;
+    memcpy(slot->last_response, response, MD5_DIGEST_SIZE);
+    slot->last_user = user;
+    slot->has_last = true;
+}
+
+static int add_user(SmolRTSP_DigestAuth *self, const char *username, User u) {
+    u.name_len = strlen(username);
+    u.name = smolrtsp_malloc(u.name_len + 1);
+    if (NULL == u.name) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(u.name, username, u.name_len + 1);
+
+    pthread_mutex_lock(&self->mutex);
+
+    User *users = smolrtsp_realloc(
+        self->users, (self->users_count + 1) * sizeof self->users[0]);
+    if (NULL == users) {
+        pthread_mutex_unlock(&self->mutex);
+        smolrtsp_free(u.name);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    users[self->users_count] = u;
+    self->users = users;
+    self->users_count++;
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return 0;
+}
+
+static void count(uint64_t *counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static CharSlice99 skip_spaces(CharSlice99 s) {
+    while (!CharSlice99_is_empty(s) && (' ' == s.ptr[0] || '\t' == s.ptr[0])) {
+        s = CharSlice99_advance(s, 1);
+    }
+
+    return s;
+}
+
+// Parses `name=value` or `name="value"` followed by a comma or the end.
+static bool parse_param(
+    CharSlice99 *restrict input, CharSlice99 *restrict name,
+    CharSlice99 *restrict value) {
+    CharSlice99 s = *input;
+
+    size_t len = 0;
+    while (len < s.len && '=' != s.ptr[len] && ' ' != s.ptr[len] &&
+           ',' != s.ptr[len]) {
+        len++;
+    }
+    if (0 == len) {
+        return false;
+    }
+    *name = CharSlice99_sub(s, 0, len);
+
+    s = skip_spaces(CharSlice99_advance(s, len));
+    if (CharSlice99_is_empty(s) || '=' != s.ptr[0]) {
+        return false;
+    }
+    s = skip_spaces(CharSlice99_advance(s, 1));
+
+    if (!CharSlice99_is_empty(s) && '"' == s.ptr[0]) {
+        len = 1;
+        while (len < s.len && '"' != s.ptr[len]) {
+            // A quoted pair.
+            len += '\\' == s.ptr[len] ? 2 : 1;
+        }
+        if (len >= s.len) {
+            return false;
+        }
+        *value = CharSlice99_sub(s, 1, len);
+        s = CharSlice99_advance(s, len + 1);
+    } else {
+        len = 0;
+        while (len < s.len && ',' != s.ptr[len] && ' ' != s.ptr[len]) {
+            len++;
+        }
+        *value = CharSlice99_sub(s, 0, len);
+        s = CharSlice99_advance(s, len);
+    }
+
+    s = skip_spaces(s);
+    if (!CharSlice99_is_empty(s)) {
+        if (',' != s.ptr[0]) {
+            return false;
+        }
+        s = CharSlice99_advance(s, 1);
+    }
+
+    *input = s;
+    return true;
+}
+
+static bool eq_nocase(CharSlice99 s, const char *restrict str) {
+    return s.len == strlen(str) && 0 == strncasecmp(s.ptr, str, s.len);
+}
+
+static void
+hex_encode(const uint8_t *restrict bytes, size_t len, char *restrict hex) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < len; i++) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+}
+
+static bool
+hex_decode(CharSlice99 hex, uint8_t *restrict bytes, size_t len) {
+    if (hex.len != 2 * len) {
+        return false;
+    }
+
+    for (size_t i = 0; i < hex.len; i++) {
+        const char c = hex.ptr[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = (uint8_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = (uint8_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = (uint8_t)(c - 'A' + 10);
+        } else {
+            return false;
+        }
+
+        if (0 == i % 2) {
+            bytes[i / 2] = (uint8_t)(nibble << 4);
+        } else {
+            bytes[i / 2] |= nibble;
+        }
+    }
+
+    return true;
+}
+
+static void md5_hex(SmolRTSP_Md5 *ctx, char hex[restrict MD5_DIGEST_SIZE * 2]) {
+    uint8_t digest[MD5_DIGEST_SIZE];
+    SmolRTSP_Md5_final(ctx, digest);
+    hex_encode(digest, sizeof digest, hex);
+}
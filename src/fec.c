@@ -0,0 +1,595 @@
+#include <smolrtsp/fec.h>
+
+#include <smolrtsp/types/sdp.h>
+
+#include "alloc.h"
+#include "macros.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SMOLRTSP_HAS_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// The size of an RTP header without CSRCs and extensions, which is all the
+// parity skips of a protected packet.
+#define RTP_HEADER_SIZE 12
+
+#define RTP_VERSION_BITS 0x80
+#define RTP_CSRC_SIZE    4
+
+// The FEC header with fixed `L` and `D`: R=0, F=1.
+#define FEC_HEADER_SIZE 12
+#define FEC_HEADER_F    0x40
+
+// The 2 bits replacing the version (R and F in the FEC header).
+#define FEC_RECOVERY_MASK 0x3F
+
+#define REPAIR_HEADER_SIZE (RTP_HEADER_SIZE + RTP_CSRC_SIZE + FEC_HEADER_SIZE)
+
+// The types of protection of the `ToP` SDP parameter.
+#define TOP_INTERLEAVED     0
+#define TOP_NON_INTERLEAVED 1
+#define TOP_2D              2
+
+// Adds `len` bytes of `src` to `dst` with XOR.
+typedef void (*XorKernel)(uint8_t *dst, const uint8_t *src, size_t len);
+
+// The XOR of the protected packets of a group accumulated so far.
+typedef struct {
+    // The first two bytes of the RTP headers (P, X, CC, M, PT).
+    uint8_t bits[2];
+    // The lengths of the packets without their fixed RTP headers.
+    uint16_t length;
+    uint32_t timestamp;
+
+    uint16_t seq_num_base;
+    size_t count;
+
+    // The parity of the packets without their fixed RTP headers; only the
+    // first `len` bytes are valid (the rest is implicitly zero).
+    uint8_t *payload;
+    size_t len;
+} Parity;
+
+struct SmolRTSP_FecEncoder {
+    SmolRTSP_Transport transport, repair;
+    SmolRTSP_FecConfig config;
+    XorKernel xor_kernel;
+
+    uint16_t seq_num;
+    uint32_t ssrc;
+
+    // The expected sequence number, if `started`, and the position of the
+    // next protected packet in its block.
+    bool started;
+    uint16_t next_seq_num;
+    size_t index;
+
+    // The SSRC and timestamp of the last protected packet.
+    uint32_t protected_ssrc, last_timestamp;
+
+    // `config.columns` column parities, if `config.column`.
+    Parity row;
+    Parity *columns;
+
+    // Updated with relaxed atomics, so that they can be read from any thread.
+    SmolRTSP_FecStats stats;
+};
+
+static void protect(SmolRTSP_FecEncoder *self, SmolRTSP_IoVecSlice bufs);
+static void
+add(const SmolRTSP_FecEncoder *self, Parity *parity,
+    const uint8_t header[restrict], SmolRTSP_IoVecSlice bufs, size_t size);
+static void emit(SmolRTSP_FecEncoder *self, Parity *parity, uint8_t rows);
+static void reset(Parity *parity);
+static void reset_all(SmolRTSP_FecEncoder *self);
+static void gather(
+    SmolRTSP_IoVecSlice bufs, uint8_t header[restrict RTP_HEADER_SIZE]);
+static uint8_t *write_u16(uint8_t *buffer, uint16_t value);
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value);
+static uint32_t read_u32(const uint8_t *data);
+
+static XorKernel xor_kernel(void);
+static void xor_scalar(uint8_t *dst, const uint8_t *src, size_t len);
+
+#if defined(__SSE2__)
+static void xor_sse2(uint8_t *dst, const uint8_t *src, size_t len);
+#endif
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+static void xor_avx2(uint8_t *dst, const uint8_t *src, size_t len);
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+static void xor_neon(uint8_t *dst, const uint8_t *src, size_t len);
+#endif
+
+SmolRTSP_FecConfig SmolRTSP_FecConfig_default(void) {
+    return (SmolRTSP_FecConfig){
+        .columns = SMOLRTSP_FEC_DEFAULT_COLUMNS,
+        .rows = SMOLRTSP_FEC_DEFAULT_ROWS,
+        .row = true,
+        .column = false,
+        .payload_ty = SMOLRTSP_FEC_DEFAULT_PAYLOAD_TY,
+        .ssrc = 0,
+        .max_packet_size = SMOLRTSP_FEC_DEFAULT_MAX_PACKET_SIZE,
+    };
+}
+
+ssize_t SmolRTSP_FecConfig_sdp(
+    SmolRTSP_FecConfig self, SmolRTSP_Writer w, uint32_t clock_rate,
+    uint32_t repair_window_us) {
+    assert(w.self && w.vptr);
+
+    const int top = self.row && self.column ? TOP_2D
+                    : self.column           ? TOP_INTERLEAVED
+                                            : TOP_NON_INTERLEAVED;
+
+    ssize_t result = 0;
+
+    CHK_WRITE_ERR(
+        result, smolrtsp_sdp_printf(
+                    w, SMOLRTSP_SDP_ATTR, "rtpmap:%d flexfec/%" PRIu32,
+                    self.payload_ty, clock_rate));
+    CHK_WRITE_ERR(
+        result,
+        smolrtsp_sdp_printf(
+            w, SMOLRTSP_SDP_ATTR,
+            "fmtp:%d repair-window=%" PRIu32 "; L=%zu; D=%zu; ToP=%d",
+            self.payload_ty, repair_window_us, self.columns,
+            self.column ? self.rows : (size_t)0, top));
+
+    return result;
+}
+
+SmolRTSP_FecEncoder *SmolRTSP_FecEncoder_new(
+    SmolRTSP_Transport t, SmolRTSP_Transport repair,
+    SmolRTSP_FecConfig config) {
+    assert(t.self && t.vptr);
+    assert(config.columns > 0);
+    assert(config.row || config.column);
+    assert(!config.column || config.rows > 0);
+    assert(config.columns <= UINT8_MAX && config.rows <= UINT8_MAX);
+    assert(config.max_packet_size > RTP_HEADER_SIZE);
+
+    SmolRTSP_FecEncoder *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        goto fail;
+    }
+
+    const size_t columns_count = config.column ? config.columns : 0,
+                 payload_size = config.max_packet_size - RTP_HEADER_SIZE;
+
+    self->columns = NULL;
+    if (columns_count > 0) {
+        self->columns = smolrtsp_calloc(columns_count, sizeof(Parity));
+    }
+    self->row.payload = smolrtsp_malloc((columns_count + 1) * payload_size);
+    if ((columns_count > 0 && NULL == self->columns) ||
+        NULL == self->row.payload) {
+        smolrtsp_free(self->columns);
+        smolrtsp_free(self->row.payload);
+        smolrtsp_free(self);
+        goto fail;
+    }
+
+    // The column parities share the allocation of the row one.
+    for (size_t i = 0; i < columns_count; i++) {
+        self->columns[i].payload = self->row.payload + (i + 1) * payload_size;
+    }
+
+    self->transport = t;
+    self->repair = repair;
+    self->config = config;
+    self->xor_kernel = xor_kernel();
+    self->seq_num = (uint16_t)rand();
+    self->ssrc = 0 == config.ssrc ? (uint32_t)rand() : config.ssrc;
+    self->protected_ssrc = 0;
+    self->last_timestamp = 0;
+    self->stats = (SmolRTSP_FecStats){0};
+    reset_all(self);
+
+    return self;
+
+fail:
+    errno = ENOMEM;
+    return NULL;
+}
+
+static void SmolRTSP_FecEncoder_drop(VSelf) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    VCALL_SUPER(self->transport, SmolRTSP_Droppable, drop);
+    if (self->repair.self != NULL) {
+        VCALL_SUPER(self->repair, SmolRTSP_Droppable, drop);
+    }
+
+    smolrtsp_free(self->row.payload);
+    smolrtsp_free(self->columns);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_FecEncoder);
+
+SmolRTSP_FecStats
+SmolRTSP_FecEncoder_fec_stats(const SmolRTSP_FecEncoder *self) {
+    assert(self);
+
+    return (SmolRTSP_FecStats){
+        .protected_packets =
+            __atomic_load_n(&self->stats.protected_packets, __ATOMIC_RELAXED),
+        .unprotected_packets = __atomic_load_n(
+            &self->stats.unprotected_packets, __ATOMIC_RELAXED),
+        .repair_packets =
+            __atomic_load_n(&self->stats.repair_packets, __ATOMIC_RELAXED),
+        .repair_errors =
+            __atomic_load_n(&self->stats.repair_errors, __ATOMIC_RELAXED),
+    };
+}
+
+static int SmolRTSP_FecEncoder_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    const int ret = VCALL(self->transport, transmit, bufs);
+    if (ret != -1) {
+        protect(self, bufs);
+    }
+
+    return ret;
+}
+
+#define SmolRTSP_FecEncoder_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_FecEncoder_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    if (0 == batch.len) {
+        return 0;
+    }
+
+    const size_t sent = smolrtsp_transmit_batch(self->transport, batch);
+    for (size_t i = 0; i < sent; i++) {
+        protect(self, batch.ptr[i]);
+    }
+
+    return 0 == sent ? -1 : (ssize_t)sent;
+}
+
+static bool SmolRTSP_FecEncoder_is_full(VSelf) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    return VCALL(self->transport, is_full);
+}
+
+#define SmolRTSP_FecEncoder_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_FecEncoder_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    size_t max = self->config.max_packet_size;
+
+    const size_t inner = VCALL(self->transport, max_packet_size);
+    if (inner > 0) {
+        const size_t limit =
+            inner > SMOLRTSP_FEC_OVERHEAD ? inner - SMOLRTSP_FEC_OVERHEAD : 1;
+        max = limit < max ? limit : max;
+    }
+
+    return max;
+}
+
+// The repair packets are counted by `SmolRTSP_FecEncoder_fec_stats`.
+#define SmolRTSP_FecEncoder_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_FecEncoder_stats(VSelf) {
+    VSELF(SmolRTSP_FecEncoder);
+    assert(self);
+
+    return VCALL(self->transport, stats);
+}
+
+implExtern(SmolRTSP_Transport, SmolRTSP_FecEncoder);
+
+static void protect(SmolRTSP_FecEncoder *self, SmolRTSP_IoVecSlice bufs) {
+    const size_t size = SmolRTSP_IoVecSlice_len(bufs);
+    if (size < RTP_HEADER_SIZE || size > self->config.max_packet_size) {
+        __atomic_fetch_add(
+            &self->stats.unprotected_packets, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint8_t header[RTP_HEADER_SIZE];
+    gather(bufs, header);
+    const uint16_t seq_num = (uint16_t)(header[2] << 8 | header[3]);
+
+    if (self->started && seq_num != self->next_seq_num) {
+        if ((int16_t)(seq_num - self->next_seq_num) < 0) {
+            // A packet sent again, such as a retransmission.
+            __atomic_fetch_add(
+                &self->stats.unprotected_packets, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        reset_all(self);
+    }
+
+    self->started = true;
+    self->next_seq_num = (uint16_t)(seq_num + 1);
+    self->protected_ssrc = read_u32(header + 8);
+    self->last_timestamp = read_u32(header + 4);
+    __atomic_fetch_add(&self->stats.protected_packets, 1, __ATOMIC_RELAXED);
+
+    const size_t columns = self->config.columns;
+
+    if (self->config.row) {
+        add(self, &self->row, header, bufs, size);
+        if (self->row.count == columns) {
+            emit(self, &self->row, 0);
+        }
+    }
+
+    if (self->config.column) {
+        Parity *column = &self->columns[self->index % columns];
+        add(self, column, header, bufs, size);
+        if (column->count == self->config.rows) {
+            emit(self, column, (uint8_t)self->config.rows);
+        }
+        self->index = (self->index + 1) % (columns * self->config.rows);
+    }
+}
+
+static void
+add(const SmolRTSP_FecEncoder *self, Parity *parity,
+    const uint8_t header[restrict], SmolRTSP_IoVecSlice bufs, size_t size) {
+    if (0 == parity->count) {
+        parity->seq_num_base = (uint16_t)(header[2] << 8 | header[3]);
+    }
+
+    parity->bits[0] ^= header[0];
+    parity->bits[1] ^= header[1];
+    parity->length ^= (uint16_t)(size - RTP_HEADER_SIZE);
+    parity->timestamp ^= read_u32(header + 4);
+    parity->count++;
+
+    // Below the current length, the data is XORed in; above it, the parity is
+    // zero, so the data is just copied.
+    size_t skip = RTP_HEADER_SIZE, offset = 0;
+    for (size_t i = 0; i < bufs.len; i++) {
+        const uint8_t *data = bufs.ptr[i].iov_base;
+        size_t len = bufs.ptr[i].iov_len;
+
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        data += skip;
+        len -= skip;
+        skip = 0;
+
+        if (offset < parity->len) {
+            const size_t n =
+                len < parity->len - offset ? len : parity->len - offset;
+            self->xor_kernel(parity->payload + offset, data, n);
+            data += n;
+            len -= n;
+            offset += n;
+        }
+        if (len > 0) {
+            memcpy(parity->payload + offset, data, len);
+            offset += len;
+        }
+    }
+
+    if (offset > parity->len) {
+        parity->len = offset;
+    }
+}
+
+static void emit(SmolRTSP_FecEncoder *self, Parity *parity, uint8_t rows) {
+    /*
+     *  0                   1                   2                   3
+     *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |0|1|P|X|  CC   |M| PT recovery |        length recovery        |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |                          TS recovery                          |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |           SN base_i           |  M (columns)  |    N (rows)   |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     */
+
+    uint8_t header[REPAIR_HEADER_SIZE];
+    uint8_t *p = header;
+
+    *p++ = RTP_VERSION_BITS | 1;
+    *p++ = self->config.payload_ty;
+    p = write_u16(p, self->seq_num);
+    p = write_u32(p, self->last_timestamp);
+    p = write_u32(p, self->ssrc);
+    p = write_u32(p, self->protected_ssrc);
+
+    *p++ = FEC_HEADER_F | (parity->bits[0] & FEC_RECOVERY_MASK);
+    *p++ = parity->bits[1];
+    p = write_u16(p, parity->length);
+    p = write_u32(p, parity->timestamp);
+    p = write_u16(p, parity->seq_num_base);
+    *p++ = (uint8_t)self->config.columns;
+    *p++ = rows;
+    assert(p == header + sizeof header);
+
+    struct iovec bufs[] = {
+        {.iov_base = header, .iov_len = sizeof header},
+        {.iov_base = parity->payload, .iov_len = parity->len},
+    };
+
+    const SmolRTSP_Transport t =
+        self->repair.self != NULL ? self->repair : self->transport;
+    if (VCALL(t, transmit, SmolRTSP_IoVecSlice_new(bufs, 2)) != -1) {
+        __atomic_fetch_add(&self->stats.repair_packets, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&self->stats.repair_errors, 1, __ATOMIC_RELAXED);
+    }
+
+    self->seq_num++;
+    reset(parity);
+}
+
+static void reset(Parity *parity) {
+    parity->bits[0] = parity->bits[1] = 0;
+    parity->length = 0;
+    parity->timestamp = 0;
+    parity->count = 0;
+    parity->len = 0;
+}
+
+static void reset_all(SmolRTSP_FecEncoder *self) {
+    self->started = false;
+    self->index = 0;
+
+    reset(&self->row);
+    if (self->config.column) {
+        for (size_t i = 0; i < self->config.columns; i++) {
+            reset(&self->columns[i]);
+        }
+    }
+}
+
+// Copies the fixed RTP header of a packet that may span several buffers.
+static void gather(
+    SmolRTSP_IoVecSlice bufs, uint8_t header[restrict RTP_HEADER_SIZE]) {
+    size_t len = 0;
+    for (size_t i = 0; i < bufs.len && len < RTP_HEADER_SIZE; i++) {
+        const size_t n = bufs.ptr[i].iov_len < RTP_HEADER_SIZE - len
+                             ? bufs.ptr[i].iov_len
+                             : RTP_HEADER_SIZE - len;
+        if (n > 0) {
+            memcpy(header + len, bufs.ptr[i].iov_base, n);
+            len += n;
+        }
+    }
+    assert(RTP_HEADER_SIZE == len);
+}
+
+static uint8_t *write_u16(uint8_t *buffer, uint16_t value) {
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)value;
+    return buffer + 2;
+}
+
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+    return buffer + 4;
+}
+
+static uint32_t read_u32(const uint8_t *data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+           (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+static XorKernel select_xor_kernel(void) {
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        return xor_avx2;
+    }
+#endif
+
+#if defined(__SSE2__)
+    return xor_sse2;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    return xor_neon;
+#else
+    return xor_scalar;
+#endif
+}
+
+static XorKernel xor_kernel(void) {
+    // Racing initializations store the same value.
+    static XorKernel selected = NULL;
+    XorKernel f = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+    if (NULL == f) {
+        f = select_xor_kernel();
+        __atomic_store_n(&selected, f, __ATOMIC_RELAXED);
+    }
+
+    return f;
+}
+
+static void xor_scalar(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, sizeof a);
+        memcpy(&b, src + i, sizeof b);
+        a ^= b;
+        memcpy(dst + i, &a, sizeof a);
+    }
+
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+#if defined(__SSE2__)
+
+static void xor_sse2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(dst + i)),
+                      b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+
+    xor_scalar(dst + i, src + i, len - i);
+}
+
+#endif // defined(__SSE2__)
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+
+__attribute__((target("avx2"))) static void
+xor_avx2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i)),
+                      b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, b));
+    }
+
+    xor_scalar(dst + i, src + i, len - i);
+}
+
+#endif // SMOLRTSP_HAS_AVX2_DISPATCH
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+static void xor_neon(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+
+    xor_scalar(dst + i, src + i, len - i);
+}
+
+#endif // defined(__aarch64__) && defined(__ARM_NEON)
@@ -0,0 +1,286 @@
+#include <smolrtsp/frame_queue.h>
+
+#include <smolrtsp/util.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/uio.h>
+
+// The maximum number of frames written by a single vectored write.
+#define MAX_BATCH_FRAMES 64
+
+typedef struct Node {
+    struct Node *next;
+    size_t len;
+    char data[];
+} Node;
+
+// An intrusive queue of Dmitry Vyukov: producers exchange `tail` and then link
+// the previous node to theirs, while the consumer walks from `head`. `stub`
+// keeps the queue non-empty.
+struct SmolRTSP_FrameQueue {
+    SmolRTSP_Writer w;
+    size_t max_buffer;
+
+    Node *head;
+    Node *tail;
+    Node stub;
+
+    // Set while a thread is writing the queue, i.e., acts as the consumer.
+    bool writing;
+
+    // The number and total size of the frames pushed but not yet taken.
+    size_t frames_count, bytes_count;
+
+    uint64_t failures;
+};
+
+static void push_node(SmolRTSP_FrameQueue *self, Node *node);
+static Node *pop_node(SmolRTSP_FrameQueue *self);
+static int write_frames(SmolRTSP_FrameQueue *self);
+
+SmolRTSP_FrameQueue *
+SmolRTSP_FrameQueue_new(SmolRTSP_Writer w, size_t max_buffer) {
+    assert(w.self && w.vptr);
+
+    SmolRTSP_FrameQueue *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->w = w;
+    self->max_buffer = max_buffer;
+    self->stub.next = NULL;
+    self->stub.len = 0;
+    self->head = self->tail = &self->stub;
+    self->writing = false;
+    self->frames_count = self->bytes_count = 0;
+    self->failures = 0;
+
+    return self;
+}
+
+int SmolRTSP_FrameQueue_push(
+    SmolRTSP_FrameQueue *self, uint8_t channel_id, SmolRTSP_IoVecSlice bufs) {
+    assert(self);
+
+    const size_t payload_len = SmolRTSP_IoVecSlice_len(bufs);
+    assert(payload_len <= UINT16_MAX);
+
+    const uint32_t header =
+        smolrtsp_interleaved_header(channel_id, htons(payload_len));
+
+    Node *node = smolrtsp_malloc(sizeof *node + sizeof header + payload_len);
+    if (NULL == node) {
+        errno = ENOMEM;
+        return -1;
+    }
+    node->next = NULL;
+    node->len = sizeof header + payload_len;
+
+    memcpy(node->data, &header, sizeof header);
+    char *p = node->data + sizeof header;
+    for (size_t i = 0; i < bufs.len; i++) {
+        memcpy(p, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+        p += bufs.ptr[i].iov_len;
+    }
+
+    push_node(self, node);
+
+    // Counted only once linked, so that a writer seeing the count can reach
+    // the node.
+    __atomic_add_fetch(&self->bytes_count, node->len, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&self->frames_count, 1, __ATOMIC_RELEASE);
+
+    return SmolRTSP_FrameQueue_flush(self);
+}
+
+int SmolRTSP_FrameQueue_flush(SmolRTSP_FrameQueue *self) {
+    assert(self);
+
+    int ret = 0;
+
+    // A frame pushed after the last pop of the writer, but before it has
+    // cleared `writing`, is written by the writer on the next iteration.
+    while (__atomic_load_n(&self->frames_count, __ATOMIC_ACQUIRE) > 0) {
+        if (__atomic_exchange_n(&self->writing, true, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        if (write_frames(self) == -1) {
+            ret = -1;
+        }
+
+        __atomic_store_n(&self->writing, false, __ATOMIC_RELEASE);
+    }
+
+    return ret;
+}
+
+size_t SmolRTSP_FrameQueue_len(const SmolRTSP_FrameQueue *self) {
+    assert(self);
+    return __atomic_load_n(&self->bytes_count, __ATOMIC_RELAXED);
+}
+
+uint64_t SmolRTSP_FrameQueue_failures(const SmolRTSP_FrameQueue *self) {
+    assert(self);
+    return __atomic_load_n(&self->failures, __ATOMIC_RELAXED);
+}
+
+static void SmolRTSP_FrameQueue_drop(VSelf) {
+    VSELF(SmolRTSP_FrameQueue);
+    assert(self);
+
+    Node *node;
+    while ((node = pop_node(self)) != NULL) {
+        smolrtsp_free(node);
+    }
+
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_FrameQueue);
+
+static void push_node(SmolRTSP_FrameQueue *self, Node *node) {
+    Node *prev = __atomic_exchange_n(&self->tail, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+// Returns `NULL` if the queue is empty or the next node is still being linked.
+static Node *pop_node(SmolRTSP_FrameQueue *self) {
+    Node *head = self->head;
+    Node *next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+
+    if (&self->stub == head) {
+        if (NULL == next) {
+            return NULL;
+        }
+        self->head = head = next;
+        next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next != NULL) {
+        self->head = next;
+        return head;
+    }
+
+    if (__atomic_load_n(&self->tail, __ATOMIC_ACQUIRE) != head) {
+        return NULL;
+    }
+
+    // `head` is the last node; put the stub behind it to take it out.
+    self->stub.next = NULL;
+    push_node(self, &self->stub);
+
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        self->head = next;
+        return head;
+    }
+
+    return NULL;
+}
+
+// Writes all the reachable frames; called by a single thread at a time.
+static int write_frames(SmolRTSP_FrameQueue *self) {
+    int ret = 0;
+
+    for (;;) {
+        Node *nodes[MAX_BATCH_FRAMES];
+        struct iovec vecs[MAX_BATCH_FRAMES];
+        size_t count = 0, total = 0;
+
+        while (count < MAX_BATCH_FRAMES) {
+            Node *node = pop_node(self);
+            if (NULL == node) {
+                break;
+            }
+
+            nodes[count] = node;
+            vecs[count] = (struct iovec){node->data, node->len};
+            total += node->len;
+            count++;
+        }
+
+        if (0 == count) {
+            return ret;
+        }
+
+        VCALL(self->w, lock);
+        const ssize_t written =
+            smolrtsp_writev(self->w, SmolRTSP_IoVecSlice_new(vecs, count));
+        VCALL(self->w, unlock);
+
+        if (written != (ssize_t)total) {
+            __atomic_add_fetch(&self->failures, count, __ATOMIC_RELAXED);
+            ret = -1;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            smolrtsp_free(nodes[i]);
+        }
+
+        __atomic_sub_fetch(&self->bytes_count, total, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&self->frames_count, count, __ATOMIC_RELEASE);
+    }
+}
+
+typedef struct {
+    SmolRTSP_FrameQueue *queue;
+    uint8_t channel_id;
+} SmolRTSP_FrameQueueTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_FrameQueueTransport);
+
+SmolRTSP_Transport
+smolrtsp_transport_frame_queue(SmolRTSP_FrameQueue *queue, uint8_t channel_id) {
+    assert(queue);
+
+    SmolRTSP_FrameQueueTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->queue = queue;
+    self->channel_id = channel_id;
+
+    return DYN(SmolRTSP_FrameQueueTransport, SmolRTSP_Transport, self);
+}
+
+static void SmolRTSP_FrameQueueTransport_drop(VSelf) {
+    VSELF(SmolRTSP_FrameQueueTransport);
+    assert(self);
+
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_FrameQueueTransport);
+
+static int
+SmolRTSP_FrameQueueTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_FrameQueueTransport);
+    assert(self);
+
+    return SmolRTSP_FrameQueue_push(self->queue, self->channel_id, bufs);
+}
+
+static bool SmolRTSP_FrameQueueTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_FrameQueueTransport);
+    assert(self);
+
+    SmolRTSP_FrameQueue *queue = self->queue;
+
+    return SmolRTSP_FrameQueue_len(queue) + VCALL(queue->w, filled) >
+           queue->max_buffer;
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_FrameQueueTransport);
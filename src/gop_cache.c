@@ -0,0 +1,306 @@
+#include <smolrtsp/gop_cache.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+typedef struct {
+    SmolRTSP_RtpTimestamp ts;
+    SmolRTSP_NalHeader header;
+
+    // The payload is at `data + offset`.
+    size_t offset, len;
+} Entry;
+
+struct SmolRTSP_GopCache {
+    size_t refcount;
+    pthread_mutex_t mutex;
+
+    Entry *entries;
+    size_t entries_len, entries_capacity;
+
+    uint8_t *data;
+    size_t data_len, max_size;
+
+    // The first entry of the access unit being pushed.
+    size_t au_start;
+
+    // Whether an IDR has been seen since the start or the last overflow.
+    bool has_idr;
+};
+
+static uint64_t timestamp_value(SmolRTSP_RtpTimestamp ts);
+static bool timestamp_eq(SmolRTSP_RtpTimestamp a, SmolRTSP_RtpTimestamp b);
+static void discard_before(SmolRTSP_GopCache *self, size_t idx);
+static void clear(SmolRTSP_GopCache *self);
+static uint64_t duration(const SmolRTSP_GopCache *self);
+
+SmolRTSP_GopCache *SmolRTSP_GopCache_new(size_t max_size) {
+    assert(max_size > 0);
+
+    SmolRTSP_GopCache *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->data = smolrtsp_malloc(max_size);
+    if (NULL == self->data) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->refcount = 1;
+    const int ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == ret);
+    (void)ret;
+
+    self->entries = NULL;
+    self->entries_len = 0;
+    self->entries_capacity = 0;
+    self->data_len = 0;
+    self->max_size = max_size;
+    self->au_start = 0;
+    self->has_idr = false;
+
+    return self;
+}
+
+SmolRTSP_GopCache *SmolRTSP_GopCache_ref(SmolRTSP_GopCache *self) {
+    assert(self);
+
+    __atomic_fetch_add(&self->refcount, 1, __ATOMIC_RELAXED);
+    return self;
+}
+
+static void SmolRTSP_GopCache_drop(VSelf) {
+    VSELF(SmolRTSP_GopCache);
+    assert(self);
+
+    if (__atomic_sub_fetch(&self->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self->entries);
+    smolrtsp_free(self->data);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_GopCache);
+
+int SmolRTSP_GopCache_push(
+    SmolRTSP_GopCache *self, SmolRTSP_RtpTimestamp ts, SmolRTSP_NalUnit nalu) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+
+    if (self->entries_len > 0 &&
+        !timestamp_eq(self->entries[self->entries_len - 1].ts, ts)) {
+        self->au_start = self->entries_len;
+    }
+
+    const bool is_idr = SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header),
+               is_vcl = is_idr ||
+                        SmolRTSP_NalHeader_is_coded_slice_non_idr(nalu.header);
+
+    if (is_idr) {
+        discard_before(self, self->au_start);
+        self->has_idr = true;
+    } else if (is_vcl && !self->has_idr) {
+        // Slices before the first IDR cannot be decoded.
+        clear(self);
+        pthread_mutex_unlock(&self->mutex);
+        return 0;
+    }
+
+    if (self->data_len + nalu.payload.len > self->max_size) {
+        // A partial GOP cannot be decoded either; wait for the next IDR unless
+        // this is one.
+        clear(self);
+        self->has_idr = is_idr && nalu.payload.len <= self->max_size;
+        if (!self->has_idr) {
+            pthread_mutex_unlock(&self->mutex);
+            return 0;
+        }
+    }
+
+    if (self->entries_len == self->entries_capacity) {
+        const size_t capacity =
+            0 == self->entries_capacity ? 64 : self->entries_capacity * 2;
+        Entry *entries =
+            smolrtsp_realloc(self->entries, capacity * sizeof entries[0]);
+        if (NULL == entries) {
+            // The GOP misses this NAL unit, so wait for the next IDR as on
+            // an overflow.
+            clear(self);
+            pthread_mutex_unlock(&self->mutex);
+            errno = ENOMEM;
+            return -1;
+        }
+        self->entries = entries;
+        self->entries_capacity = capacity;
+    }
+
+    if (nalu.payload.len > 0) {
+        memcpy(self->data + self->data_len, nalu.payload.ptr, nalu.payload.len);
+    }
+    self->entries[self->entries_len++] = (Entry){
+        .ts = ts,
+        .header = nalu.header,
+        .offset = self->data_len,
+        .len = nalu.payload.len,
+    };
+    self->data_len += nalu.payload.len;
+
+    pthread_mutex_unlock(&self->mutex);
+    return 0;
+}
+
+size_t SmolRTSP_GopCache_len(SmolRTSP_GopCache *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const size_t len = self->has_idr ? self->entries_len : 0;
+    pthread_mutex_unlock(&self->mutex);
+
+    return len;
+}
+
+uint64_t SmolRTSP_GopCache_duration(SmolRTSP_GopCache *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const uint64_t result = duration(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return result;
+}
+
+int SmolRTSP_GopCache_replay(
+    SmolRTSP_GopCache *self, SmolRTSP_NalTransport *t,
+    SmolRTSP_RtpTimestamp first_ts) {
+    assert(self);
+    assert(t);
+
+    pthread_mutex_lock(&self->mutex);
+
+    const size_t entries_len = self->has_idr ? self->entries_len : 0;
+    if (0 == entries_len) {
+        pthread_mutex_unlock(&self->mutex);
+        return 0;
+    }
+
+    Entry *entries = smolrtsp_malloc(entries_len * sizeof entries[0]);
+    uint8_t *data = smolrtsp_malloc(self->data_len);
+    if (NULL == entries || (NULL == data && self->data_len > 0)) {
+        pthread_mutex_unlock(&self->mutex);
+        smolrtsp_free(entries);
+        smolrtsp_free(data);
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(entries, self->entries, entries_len * sizeof entries[0]);
+    if (self->data_len > 0) {
+        memcpy(data, self->data, self->data_len);
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    assert(first_ts.tag == entries[0].ts.tag);
+    const uint64_t base = timestamp_value(entries[0].ts),
+                   new_base = timestamp_value(first_ts);
+
+    int ret = 0;
+    for (size_t i = 0; i < entries_len && 0 == ret; i++) {
+        const uint64_t value =
+            new_base + (timestamp_value(entries[i].ts) - base);
+        const SmolRTSP_RtpTimestamp ts =
+            MATCHES(first_ts, SmolRTSP_RtpTimestamp_Raw)
+                ? SmolRTSP_RtpTimestamp_Raw((uint32_t)value)
+                : SmolRTSP_RtpTimestamp_SysClockUs(value);
+
+        const SmolRTSP_NalUnit nalu = {
+            .header = entries[i].header,
+            .payload = U8Slice99_new(data + entries[i].offset, entries[i].len),
+        };
+
+        // A change of the timestamp ends an access unit. The last cached one
+        // may still be in progress, so only its slices are marked.
+        const bool end_of_access_unit =
+            i + 1 < entries_len
+                ? !timestamp_eq(entries[i].ts, entries[i + 1].ts)
+                : SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header) ||
+                      SmolRTSP_NalHeader_is_coded_slice_non_idr(nalu.header);
+        ret = SmolRTSP_NalTransport_send_au_packet(
+            t, ts, nalu, end_of_access_unit);
+    }
+
+    smolrtsp_free(entries);
+    smolrtsp_free(data);
+
+    return ret;
+}
+
+static uint64_t timestamp_value(SmolRTSP_RtpTimestamp ts) {
+    match(ts) {
+        of(SmolRTSP_RtpTimestamp_Raw, raw_ts) return *raw_ts;
+        of(SmolRTSP_RtpTimestamp_SysClockUs, time_us) return *time_us;
+    }
+
+    return 0;
+}
+
+static bool timestamp_eq(SmolRTSP_RtpTimestamp a, SmolRTSP_RtpTimestamp b) {
+    return a.tag == b.tag && timestamp_value(a) == timestamp_value(b);
+}
+
+static void discard_before(SmolRTSP_GopCache *self, size_t idx) {
+    if (0 == idx) {
+        return;
+    }
+
+    const size_t data_offset =
+        idx < self->entries_len ? self->entries[idx].offset : self->data_len;
+
+    memmove(
+        self->entries, self->entries + idx,
+        (self->entries_len - idx) * sizeof self->entries[0]);
+    self->entries_len -= idx;
+    for (size_t i = 0; i < self->entries_len; i++) {
+        self->entries[i].offset -= data_offset;
+    }
+
+    memmove(
+        self->data, self->data + data_offset, self->data_len - data_offset);
+    self->data_len -= data_offset;
+
+    self->au_start -= idx;
+}
+
+static void clear(SmolRTSP_GopCache *self) {
+    self->entries_len = 0;
+    self->data_len = 0;
+    self->au_start = 0;
+    self->has_idr = false;
+}
+
+static uint64_t duration(const SmolRTSP_GopCache *self) {
+    if (!self->has_idr || 0 == self->entries_len) {
+        return 0;
+    }
+
+    const SmolRTSP_RtpTimestamp first = self->entries[0].ts,
+                                last = self->entries[self->entries_len - 1].ts;
+    if (MATCHES(first, SmolRTSP_RtpTimestamp_Raw)) {
+        return (uint32_t)(timestamp_value(last) - timestamp_value(first));
+    }
+
+    return timestamp_value(last) - timestamp_value(first);
+}
@@ -0,0 +1,313 @@
+#include <smolrtsp/jitter_buffer.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+// The number of packets following the PID of a NACK that its BLP covers.
+#define NACK_BITMASK_LEN 16
+
+// The number of consecutive packets further behind than the capacity after
+// which the sender is assumed to have restarted the sequence numbers.
+#define MAX_LATE_PACKETS 8
+
+typedef struct {
+    uint16_t seq_num;
+    bool present;
+
+    // Whether the packet has been found missing but not reported by
+    // `SmolRTSP_JitterBuffer_nacks` yet.
+    bool unreported;
+
+    size_t len;
+    uint64_t arrival_us;
+} Slot;
+
+struct SmolRTSP_JitterBuffer {
+    // The slot of the sequence number `s` is `slots[s & mask]`, and its data
+    // is `data[(s & mask) * max_packet_size..]`.
+    Slot *slots;
+    uint8_t *data;
+    size_t mask, max_packet_size;
+    uint64_t latency_us;
+
+    // The slots of `[next_seq_num; end_seq_num)` are in use, and all the
+    // packets of `[next_seq_num; scan_seq_num)` are known to be missing.
+    bool started;
+    uint16_t next_seq_num, end_seq_num, scan_seq_num;
+
+    // The SSRC of the stream, valid if `started`, and the number of the last
+    // packets, all late, that were further behind than the capacity.
+    uint32_t ssrc;
+    size_t late_run;
+
+    size_t len, unreported;
+    SmolRTSP_JitterBufferStats stats;
+};
+
+static int32_t seq_distance(uint16_t from, uint16_t to);
+static void reset(SmolRTSP_JitterBuffer *self, uint16_t seq_num);
+static Slot *slot(const SmolRTSP_JitterBuffer *self, uint16_t seq_num);
+static uint8_t *
+slot_data(const SmolRTSP_JitterBuffer *self, uint16_t seq_num);
+
+SmolRTSP_JitterBuffer *SmolRTSP_JitterBuffer_new(
+    size_t capacity, size_t max_packet_size, uint64_t latency_us) {
+    assert(capacity >= 2 && capacity <= 32768);
+    assert(0 == (capacity & (capacity - 1)));
+    assert(max_packet_size > 0);
+
+    // The slots are indexed by `slot_data` as `capacity * max_packet_size`
+    // contiguous bytes.
+    if (capacity > SIZE_MAX / max_packet_size) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    SmolRTSP_JitterBuffer *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    Slot *slots = smolrtsp_calloc(capacity, sizeof slots[0]);
+    uint8_t *data = smolrtsp_malloc(capacity * max_packet_size);
+    if (NULL == slots || NULL == data) {
+        smolrtsp_free(slots);
+        smolrtsp_free(data);
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *self = (SmolRTSP_JitterBuffer){
+        .slots = slots,
+        .data = data,
+        .mask = capacity - 1,
+        .max_packet_size = max_packet_size,
+        .latency_us = latency_us,
+        .started = false,
+        .next_seq_num = 0,
+        .end_seq_num = 0,
+        .scan_seq_num = 0,
+        .ssrc = 0,
+        .late_run = 0,
+        .len = 0,
+        .unreported = 0,
+        .stats = {0},
+    };
+
+    return self;
+}
+
+static void SmolRTSP_JitterBuffer_drop(VSelf) {
+    VSELF(SmolRTSP_JitterBuffer);
+    assert(self);
+
+    smolrtsp_free(self->slots);
+    smolrtsp_free(self->data);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_JitterBuffer);
+
+int SmolRTSP_JitterBuffer_push(
+    SmolRTSP_JitterBuffer *self, U8Slice99 packet, uint64_t now_us) {
+    assert(self);
+
+    if (packet.len < RTP_HEADER_SIZE) {
+        errno = EBADMSG;
+        return -1;
+    }
+    if (packet.len > self->max_packet_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    const uint16_t seq_num = (uint16_t)(packet.ptr[2] << 8 | packet.ptr[3]);
+    const uint32_t ssrc = (uint32_t)packet.ptr[8] << 24 |
+                          (uint32_t)packet.ptr[9] << 16 |
+                          (uint32_t)packet.ptr[10] << 8 | packet.ptr[11];
+
+    if (!self->started || ssrc != self->ssrc) {
+        // The first packet, or a new stream (e.g., a restarted sender).
+        self->started = true;
+        self->ssrc = ssrc;
+        reset(self, seq_num);
+    }
+
+    const int32_t offset = seq_distance(self->next_seq_num, seq_num);
+    if (offset < 0) {
+        // A late retransmission is not far behind; a restart may be.
+        self->late_run =
+            offset < -(int32_t)self->mask ? self->late_run + 1 : 0;
+        if (self->late_run < MAX_LATE_PACKETS) {
+            self->stats.late++;
+            return 0;
+        }
+
+        // The sequence numbers have jumped backwards.
+        reset(self, seq_num);
+    } else if (offset > (int32_t)self->mask) {
+        reset(self, seq_num);
+    }
+    self->late_run = 0;
+
+    Slot *s = slot(self, seq_num);
+
+    if (seq_distance(self->end_seq_num, seq_num) >= 0) {
+        // The packets between the newest one and this one are missing.
+        for (uint16_t missing = self->end_seq_num; missing != seq_num;
+             missing++) {
+            *slot(self, missing) = (Slot){
+                .seq_num = missing,
+                .present = false,
+                .unreported = true,
+            };
+            self->unreported++;
+        }
+        self->end_seq_num = seq_num + 1;
+    } else {
+        if (s->present) {
+            self->stats.duplicates++;
+            return 0;
+        }
+        if (s->unreported) {
+            self->unreported--;
+        }
+        if (seq_distance(seq_num, self->scan_seq_num) > 0) {
+            self->scan_seq_num = seq_num;
+        }
+    }
+
+    *s = (Slot){
+        .seq_num = seq_num,
+        .present = true,
+        .unreported = false,
+        .len = packet.len,
+        .arrival_us = now_us,
+    };
+    memcpy(slot_data(self, seq_num), packet.ptr, packet.len);
+    self->len++;
+    self->stats.packets++;
+
+    return 0;
+}
+
+bool SmolRTSP_JitterBuffer_pop(
+    SmolRTSP_JitterBuffer *self, uint64_t now_us, U8Slice99 *restrict packet) {
+    assert(self);
+    assert(packet);
+
+    if (0 == self->len) {
+        return false;
+    }
+
+    // Some packet of `[scan_seq_num; end_seq_num)` is present.
+    while (!slot(self, self->scan_seq_num)->present) {
+        self->scan_seq_num++;
+    }
+
+    const uint16_t seq_num = self->scan_seq_num;
+    Slot *s = slot(self, seq_num);
+
+    if (seq_num != self->next_seq_num) {
+        if (now_us < s->arrival_us + self->latency_us) {
+            return false;
+        }
+
+        for (uint16_t missing = self->next_seq_num; missing != seq_num;
+             missing++) {
+            Slot *m = slot(self, missing);
+            if (m->unreported) {
+                m->unreported = false;
+                self->unreported--;
+            }
+        }
+        self->stats.lost += (uint64_t)seq_distance(self->next_seq_num, seq_num);
+    }
+
+    *packet = U8Slice99_new(slot_data(self, seq_num), s->len);
+    s->present = false;
+    self->len--;
+    self->next_seq_num = self->scan_seq_num = seq_num + 1;
+
+    return true;
+}
+
+size_t SmolRTSP_JitterBuffer_nacks(
+    SmolRTSP_JitterBuffer *self, SmolRTSP_RtcpNack *restrict nacks,
+    size_t max) {
+    assert(self);
+    assert(nacks || 0 == max);
+
+    size_t n = 0;
+    for (uint16_t seq_num = self->next_seq_num;
+         self->unreported > 0 && seq_num != self->end_seq_num; seq_num++) {
+        Slot *s = slot(self, seq_num);
+        if (!s->unreported) {
+            continue;
+        }
+
+        const int32_t offset =
+            n > 0 ? seq_distance(nacks[n - 1].seq_num, seq_num) : 0;
+        if (n > 0 && offset <= NACK_BITMASK_LEN) {
+            nacks[n - 1].bitmask |= (uint16_t)(1u << (offset - 1));
+        } else if (n < max) {
+            nacks[n++] = (SmolRTSP_RtcpNack){.seq_num = seq_num, .bitmask = 0};
+        } else {
+            break;
+        }
+
+        s->unreported = false;
+        self->unreported--;
+    }
+
+    return n;
+}
+
+size_t SmolRTSP_JitterBuffer_len(const SmolRTSP_JitterBuffer *self) {
+    assert(self);
+    return self->len;
+}
+
+SmolRTSP_JitterBufferStats
+SmolRTSP_JitterBuffer_stats(const SmolRTSP_JitterBuffer *self) {
+    assert(self);
+    return self->stats;
+}
+
+// Returns the distance from `from` to `to` modulo 2^16, in `[-2^15; 2^15)`.
+static int32_t seq_distance(uint16_t from, uint16_t to) {
+    const uint16_t d = (uint16_t)(to - from);
+    return d < 0x8000 ? (int32_t)d : (int32_t)d - 0x10000;
+}
+
+// Discards the held packets and makes `seq_num` the next one.
+static void reset(SmolRTSP_JitterBuffer *self, uint16_t seq_num) {
+    if (self->len > 0 || self->unreported > 0) {
+        for (size_t i = 0; i <= self->mask; i++) {
+            self->slots[i].present = false;
+            self->slots[i].unreported = false;
+        }
+    }
+
+    self->stats.discarded += self->len;
+    self->len = 0;
+    self->unreported = 0;
+    self->next_seq_num = self->end_seq_num = self->scan_seq_num = seq_num;
+}
+
+static Slot *slot(const SmolRTSP_JitterBuffer *self, uint16_t seq_num) {
+    return &self->slots[seq_num & self->mask];
+}
+
+static uint8_t *
+slot_data(const SmolRTSP_JitterBuffer *self, uint16_t seq_num) {
+    return self->data + (seq_num & self->mask) * self->max_packet_size;
+}
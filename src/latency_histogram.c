@@ -0,0 +1,127 @@
+#include <smolrtsp/latency_histogram.h>
+
+#include <assert.h>
+#include <stddef.h>
+
+#define SUB_BUCKET_BITS SMOLRTSP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS
+#define SUB_BUCKETS     (1 << SUB_BUCKET_BITS)
+
+static size_t bucket_index(uint64_t value);
+static uint64_t bucket_upper_bound(size_t index);
+
+void SmolRTSP_LatencyHistogram_record(
+    SmolRTSP_LatencyHistogram *self, uint64_t value_us) {
+    assert(self);
+
+    __atomic_fetch_add(
+        &self->counts[bucket_index(value_us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&self->total_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&self->sum_us, value_us, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&self->max_us, __ATOMIC_RELAXED);
+    while (value_us > max &&
+           !__atomic_compare_exchange_n(
+               &self->max_us, &max, value_us, true, __ATOMIC_RELAXED,
+               __ATOMIC_RELAXED)) {
+    }
+}
+
+void SmolRTSP_LatencyHistogram_snapshot(
+    const SmolRTSP_LatencyHistogram *restrict self,
+    SmolRTSP_LatencyHistogram *restrict snapshot) {
+    assert(self);
+    assert(snapshot);
+
+    uint64_t total_count = 0;
+    for (size_t i = 0; i < SMOLRTSP_LATENCY_HISTOGRAM_BUCKETS; i++) {
+        snapshot->counts[i] =
+            __atomic_load_n(&self->counts[i], __ATOMIC_RELAXED);
+        total_count += snapshot->counts[i];
+    }
+
+    // Keep the snapshot consistent with its buckets, whatever has been recorded
+    // in the meantime.
+    snapshot->total_count = total_count;
+    snapshot->sum_us = __atomic_load_n(&self->sum_us, __ATOMIC_RELAXED);
+    snapshot->max_us = __atomic_load_n(&self->max_us, __ATOMIC_RELAXED);
+}
+
+void SmolRTSP_LatencyHistogram_merge(
+    SmolRTSP_LatencyHistogram *restrict self,
+    const SmolRTSP_LatencyHistogram *restrict other) {
+    assert(self);
+    assert(other);
+
+    for (size_t i = 0; i < SMOLRTSP_LATENCY_HISTOGRAM_BUCKETS; i++) {
+        self->counts[i] += other->counts[i];
+    }
+    self->total_count += other->total_count;
+    self->sum_us += other->sum_us;
+    if (other->max_us > self->max_us) {
+        self->max_us = other->max_us;
+    }
+}
+
+uint64_t SmolRTSP_LatencyHistogram_value_at_percentile(
+    const SmolRTSP_LatencyHistogram *self, double percentile) {
+    assert(self);
+    assert(percentile >= 0 && percentile <= 100);
+
+    if (0 == self->total_count) {
+        return 0;
+    }
+
+    // The rank of the value, counting from 1.
+    uint64_t rank =
+        (uint64_t)(percentile / 100 * (double)self->total_count + 0.5);
+    if (0 == rank) {
+        rank = 1;
+    }
+
+    // The last bucket also holds the values beyond the maximum, so it is left
+    // to `max_us`.
+    uint64_t seen = 0;
+    for (size_t i = 0; i < SMOLRTSP_LATENCY_HISTOGRAM_BUCKETS - 1; i++) {
+        seen += self->counts[i];
+        if (seen >= rank) {
+            const uint64_t value = bucket_upper_bound(i);
+            return value < self->max_us ? value : self->max_us;
+        }
+    }
+
+    return self->max_us;
+}
+
+uint64_t SmolRTSP_LatencyHistogram_mean(const SmolRTSP_LatencyHistogram *self) {
+    assert(self);
+
+    return 0 == self->total_count ? 0 : self->sum_us / self->total_count;
+}
+
+// Values below `2 * SUB_BUCKETS` get a bucket each; above, every power of two
+// `[2^msb, 2^(msb + 1))` is split into `SUB_BUCKETS` buckets of `2^shift`
+// values.
+static size_t bucket_index(uint64_t value) {
+    if (value > SMOLRTSP_LATENCY_HISTOGRAM_MAX_VALUE) {
+        value = SMOLRTSP_LATENCY_HISTOGRAM_MAX_VALUE;
+    }
+    if (value < 2 * SUB_BUCKETS) {
+        return (size_t)value;
+    }
+
+    const unsigned msb = 63 - (unsigned)__builtin_clzll(value),
+                   shift = msb - SUB_BUCKET_BITS;
+
+    return (size_t)shift * SUB_BUCKETS + (size_t)(value >> shift);
+}
+
+static uint64_t bucket_upper_bound(size_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+
+    const unsigned shift = (unsigned)(index / SUB_BUCKETS) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,717 @@
+#include <smolrtsp/live_source.h>
+
+#include <smolrtsp/param_set_cache.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <time.h>
+
+struct SmolRTSP_LiveFrame {
+    size_t refcount;
+    SmolRTSP_RtpTimestamp ts;
+    bool is_idr;
+
+    // The payloads point right past the array, into the same allocation.
+    size_t nalus_count;
+    SmolRTSP_NalUnit nalus[];
+};
+
+struct SmolRTSP_LiveSource {
+    pthread_mutex_t mutex;
+
+    // The frame number `i` is at `ring[i % capacity]` while `i` is within the
+    // last `capacity` frames before `head`.
+    SmolRTSP_LiveFrame **ring;
+    size_t capacity;
+    uint64_t head;
+
+    bool has_idr;
+    uint64_t last_idr;
+
+    // The time of the last forwarded keyframe request, if `requested`.
+    SmolRTSP_KeyframeRequestConfig keyframe_config;
+    bool requested;
+    uint64_t last_request_us;
+    SmolRTSP_KeyframeRequestStats keyframe_stats;
+
+    // The latest parameter sets, and a frame of them for the subscribers
+    // switching to this source, once they are complete.
+    SmolRTSP_ParamSetCache *param_sets;
+    SmolRTSP_LiveFrame *param_sets_frame;
+};
+
+struct SmolRTSP_LiveSubscriber {
+    SmolRTSP_LiveSource *source;
+    SmolRTSP_NalTransport *t;
+
+    // The number of the next frame to send.
+    uint64_t cursor;
+    bool waiting_idr;
+    uint64_t skipped;
+
+    // The last seen `SmolRTSP_RtcpStats.keyframe_requests` of `t`.
+    uint64_t keyframe_requests;
+
+    // The source to switch to at its first IDR frame numbered from
+    // `pending_cursor`, if not `NULL`.
+    SmolRTSP_LiveSource *pending;
+    uint64_t pending_cursor;
+    uint64_t switches;
+
+    // The last seen `SmolRTSP_RtcpStats.reports` of `t`.
+    uint64_t reports;
+};
+
+static uint64_t oldest(const SmolRTSP_LiveSource *self);
+static uint64_t now_us(const SmolRTSP_KeyframeRequestConfig *config);
+static uint64_t keyframe_requests(SmolRTSP_NalTransport *t);
+static void update_param_sets(
+    SmolRTSP_LiveSource *self, const SmolRTSP_LiveFrame *frame);
+static bool request_keyframe(SmolRTSP_LiveSource *source, uint64_t cursor);
+static ssize_t try_switch(SmolRTSP_LiveSubscriber *self);
+static int send_switch_frame(
+    SmolRTSP_NalTransport *t, const SmolRTSP_LiveFrame *frame,
+    const SmolRTSP_LiveFrame *param_sets);
+
+SmolRTSP_LiveFrame *SmolRTSP_LiveFrame_new(
+    SmolRTSP_RtpTimestamp ts, const SmolRTSP_NalUnit *nalus,
+    size_t nalus_count) {
+    assert(nalus || 0 == nalus_count);
+
+    size_t data_len = 0;
+    for (size_t i = 0; i < nalus_count; i++) {
+        data_len += nalus[i].payload.len;
+    }
+
+    SmolRTSP_LiveFrame *self = smolrtsp_malloc(
+        sizeof *self + nalus_count * sizeof self->nalus[0] + data_len);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->refcount = 1;
+    self->ts = ts;
+    self->is_idr = false;
+    self->nalus_count = nalus_count;
+
+    uint8_t *data = (uint8_t *)&self->nalus[nalus_count];
+    for (size_t i = 0; i < nalus_count; i++) {
+        const SmolRTSP_NalUnit nalu = nalus[i];
+
+        if (nalu.payload.len > 0) {
+            memcpy(data, nalu.payload.ptr, nalu.payload.len);
+        }
+        self->nalus[i] = (SmolRTSP_NalUnit){
+            .header = nalu.header,
+            .payload = U8Slice99_new(data, nalu.payload.len),
+        };
+        data += nalu.payload.len;
+
+        if (SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header)) {
+            self->is_idr = true;
+        }
+    }
+
+    return self;
+}
+
+SmolRTSP_LiveFrame *SmolRTSP_LiveFrame_ref(SmolRTSP_LiveFrame *self) {
+    assert(self);
+
+    __atomic_fetch_add(&self->refcount, 1, __ATOMIC_RELAXED);
+    return self;
+}
+
+SmolRTSP_RtpTimestamp
+SmolRTSP_LiveFrame_timestamp(const SmolRTSP_LiveFrame *self) {
+    assert(self);
+    return self->ts;
+}
+
+bool SmolRTSP_LiveFrame_is_idr(const SmolRTSP_LiveFrame *self) {
+    assert(self);
+    return self->is_idr;
+}
+
+size_t SmolRTSP_LiveFrame_nalus_count(const SmolRTSP_LiveFrame *self) {
+    assert(self);
+    return self->nalus_count;
+}
+
+SmolRTSP_NalUnit
+SmolRTSP_LiveFrame_nalu(const SmolRTSP_LiveFrame *self, size_t i) {
+    assert(self);
+    assert(i < self->nalus_count);
+
+    return self->nalus[i];
+}
+
+int SmolRTSP_LiveFrame_send(
+    const SmolRTSP_LiveFrame *self, SmolRTSP_NalTransport *t) {
+    assert(self);
+    assert(t);
+
+    for (size_t i = 0; i < self->nalus_count; i++) {
+        if (SmolRTSP_NalTransport_send_au_packet(
+                t, self->ts, self->nalus[i], i + 1 == self->nalus_count) ==
+            -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void SmolRTSP_LiveFrame_drop(VSelf) {
+    VSELF(SmolRTSP_LiveFrame);
+    assert(self);
+
+    if (__atomic_sub_fetch(&self->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_LiveFrame);
+
+SmolRTSP_LiveSource *SmolRTSP_LiveSource_new(size_t capacity) {
+    assert(capacity > 0);
+
+    SmolRTSP_LiveSource *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        goto fail;
+    }
+
+    self->ring = smolrtsp_calloc(capacity, sizeof self->ring[0]);
+    if (NULL == self->ring) {
+        goto fail_ring;
+    }
+    self->param_sets = SmolRTSP_ParamSetCache_new();
+    if (NULL == self->param_sets) {
+        goto fail_param_sets;
+    }
+
+    const int ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == ret);
+    (void)ret;
+
+    self->capacity = capacity;
+    self->head = 0;
+    self->has_idr = false;
+    self->last_idr = 0;
+    self->keyframe_config = SmolRTSP_KeyframeRequestConfig_default();
+    self->requested = false;
+    self->last_request_us = 0;
+    self->keyframe_stats = (SmolRTSP_KeyframeRequestStats){0};
+    self->param_sets_frame = NULL;
+
+    return self;
+
+fail_param_sets:
+    smolrtsp_free(self->ring);
+fail_ring:
+    smolrtsp_free(self);
+fail:
+    errno = ENOMEM;
+    return NULL;
+}
+
+SmolRTSP_KeyframeRequestConfig SmolRTSP_KeyframeRequestConfig_default(void) {
+    return (SmolRTSP_KeyframeRequestConfig){
+        .window_us = SMOLRTSP_KEYFRAME_REQUEST_DEFAULT_WINDOW_US,
+        .request_keyframe = NULL,
+        .user_data = NULL,
+        .clock_us = NULL,
+    };
+}
+
+void SmolRTSP_LiveSource_set_keyframe_requests(
+    SmolRTSP_LiveSource *self, SmolRTSP_KeyframeRequestConfig config) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    self->keyframe_config = config;
+    self->requested = false;
+    pthread_mutex_unlock(&self->mutex);
+}
+
+SmolRTSP_KeyframeRequestStats
+SmolRTSP_LiveSource_keyframe_request_stats(SmolRTSP_LiveSource *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const SmolRTSP_KeyframeRequestStats stats = self->keyframe_stats;
+    pthread_mutex_unlock(&self->mutex);
+
+    return stats;
+}
+
+void SmolRTSP_LiveSource_push(
+    SmolRTSP_LiveSource *self, SmolRTSP_LiveFrame *frame) {
+    assert(self);
+    assert(frame);
+
+    pthread_mutex_lock(&self->mutex);
+
+    SmolRTSP_LiveFrame **slot = &self->ring[self->head % self->capacity];
+    SmolRTSP_LiveFrame *evicted = *slot;
+    *slot = frame;
+
+    if (frame->is_idr) {
+        self->has_idr = true;
+        self->last_idr = self->head;
+    }
+    self->head++;
+
+    update_param_sets(self, frame);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    // Subscribers sending the evicted frame still hold their references.
+    if (evicted != NULL) {
+        VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(evicted);
+    }
+}
+
+uint64_t SmolRTSP_LiveSource_frames_count(SmolRTSP_LiveSource *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const uint64_t head = self->head;
+    pthread_mutex_unlock(&self->mutex);
+
+    return head;
+}
+
+static void SmolRTSP_LiveSource_drop(VSelf) {
+    VSELF(SmolRTSP_LiveSource);
+    assert(self);
+
+    for (size_t i = 0; i < self->capacity; i++) {
+        if (self->ring[i] != NULL) {
+            VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(self->ring[i]);
+        }
+    }
+
+    if (self->param_sets_frame != NULL) {
+        VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable)
+            .drop(self->param_sets_frame);
+    }
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(self->param_sets);
+
+    smolrtsp_free(self->ring);
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_LiveSource);
+
+SmolRTSP_LiveSubscriber *SmolRTSP_LiveSubscriber_new(
+    SmolRTSP_LiveSource *source, SmolRTSP_NalTransport *t) {
+    assert(source);
+    assert(t);
+
+    SmolRTSP_LiveSubscriber *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->source = source;
+    self->t = t;
+    self->skipped = 0;
+    self->keyframe_requests = keyframe_requests(t);
+    self->pending = NULL;
+    self->pending_cursor = 0;
+    self->switches = 0;
+    self->reports = SmolRTSP_NalTransport_stats(t).rtp.rtcp.reports;
+
+    pthread_mutex_lock(&source->mutex);
+
+    if (source->has_idr && source->last_idr >= oldest(source)) {
+        self->cursor = source->last_idr;
+        self->waiting_idr = false;
+    } else {
+        self->cursor = source->head;
+        self->waiting_idr = true;
+    }
+
+    pthread_mutex_unlock(&source->mutex);
+
+    return self;
+}
+
+ssize_t
+SmolRTSP_LiveSubscriber_pump(SmolRTSP_LiveSubscriber *self, size_t max_frames) {
+    assert(self);
+
+    SmolRTSP_LiveSource *source = self->source;
+    ssize_t sent = 0;
+
+    const uint64_t requests = keyframe_requests(self->t);
+    if (requests != self->keyframe_requests) {
+        self->keyframe_requests = requests;
+        const bool forwarded = SmolRTSP_LiveSubscriber_request_keyframe(self);
+        (void)forwarded;
+    }
+
+    if (self->pending != NULL && max_frames > 0) {
+        sent = try_switch(self);
+        if (-1 == sent) {
+            return -1;
+        }
+        source = self->source;
+    }
+
+    while ((size_t)sent < max_frames) {
+        pthread_mutex_lock(&source->mutex);
+
+        if (self->cursor < oldest(source)) {
+            // Overrun by the producer.
+            if (source->has_idr && source->last_idr >= oldest(source)) {
+                self->skipped += source->last_idr - self->cursor;
+                self->cursor = source->last_idr;
+                self->waiting_idr = false;
+            } else {
+                self->skipped += source->head - self->cursor;
+                self->cursor = source->head;
+                self->waiting_idr = true;
+            }
+        }
+
+        if (self->cursor == source->head) {
+            pthread_mutex_unlock(&source->mutex);
+            break;
+        }
+
+        SmolRTSP_LiveFrame *frame =
+            source->ring[self->cursor % source->capacity];
+        self->cursor++;
+
+        if (self->waiting_idr && !frame->is_idr) {
+            pthread_mutex_unlock(&source->mutex);
+            self->skipped++;
+            continue;
+        }
+        self->waiting_idr = false;
+
+        frame = SmolRTSP_LiveFrame_ref(frame);
+        pthread_mutex_unlock(&source->mutex);
+
+        const int ret = SmolRTSP_LiveFrame_send(frame, self->t);
+        VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(frame);
+        if (-1 == ret) {
+            return -1;
+        }
+
+        sent++;
+    }
+
+    return sent;
+}
+
+bool SmolRTSP_LiveSubscriber_request_keyframe(SmolRTSP_LiveSubscriber *self) {
+    assert(self);
+
+    // While switching, the keyframe to come is that of the new source.
+    return NULL == self->pending
+               ? request_keyframe(self->source, self->cursor)
+               : request_keyframe(self->pending, self->pending_cursor);
+}
+
+uint64_t SmolRTSP_LiveSubscriber_lag(SmolRTSP_LiveSubscriber *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->source->mutex);
+    const uint64_t lag = self->source->head - self->cursor;
+    pthread_mutex_unlock(&self->source->mutex);
+
+    return lag;
+}
+
+uint64_t SmolRTSP_LiveSubscriber_skipped(const SmolRTSP_LiveSubscriber *self) {
+    assert(self);
+    return self->skipped;
+}
+
+void SmolRTSP_LiveSubscriber_switch(
+    SmolRTSP_LiveSubscriber *self, SmolRTSP_LiveSource *source) {
+    assert(self);
+    assert(source);
+
+    if (source == self->source) {
+        self->pending = NULL;
+        return;
+    }
+    if (source == self->pending) {
+        return;
+    }
+
+    pthread_mutex_lock(&source->mutex);
+    self->pending = source;
+    self->pending_cursor = source->head;
+    pthread_mutex_unlock(&source->mutex);
+
+    const bool forwarded = request_keyframe(source, self->pending_cursor);
+    (void)forwarded;
+}
+
+SmolRTSP_LiveSource *
+SmolRTSP_LiveSubscriber_source(const SmolRTSP_LiveSubscriber *self) {
+    assert(self);
+    return self->source;
+}
+
+uint64_t SmolRTSP_LiveSubscriber_switches(const SmolRTSP_LiveSubscriber *self) {
+    assert(self);
+    return self->switches;
+}
+
+SmolRTSP_RenditionPolicy SmolRTSP_RenditionPolicy_default(void) {
+    return (SmolRTSP_RenditionPolicy){
+        .max_fraction_lost =
+            SMOLRTSP_RENDITION_POLICY_DEFAULT_MAX_FRACTION_LOST,
+        .headroom_percent = SMOLRTSP_RENDITION_POLICY_DEFAULT_HEADROOM_PERCENT,
+    };
+}
+
+size_t SmolRTSP_LiveSubscriber_adapt(
+    SmolRTSP_LiveSubscriber *self, const SmolRTSP_Rendition *renditions,
+    size_t renditions_count, SmolRTSP_RenditionPolicy policy,
+    const SmolRTSP_BandwidthEstimator *estimator) {
+    assert(self);
+    assert(renditions);
+    assert(renditions_count > 0);
+
+    const SmolRTSP_LiveSource *target =
+        self->pending != NULL ? self->pending : self->source;
+    size_t current = 0;
+    for (size_t i = 0; i < renditions_count; i++) {
+        if (renditions[i].source == target) {
+            current = i;
+        }
+    }
+
+    const SmolRTSP_RtcpStats rtcp =
+        SmolRTSP_NalTransport_stats(self->t).rtp.rtcp;
+    const bool has_new_report = rtcp.reports != self->reports;
+    self->reports = rtcp.reports;
+
+    size_t next = current;
+    if (estimator != NULL) {
+        const uint32_t share = policy.headroom_percent < 100
+                                   ? 100 - policy.headroom_percent
+                                   : 0;
+        const uint64_t budget =
+            SmolRTSP_BandwidthEstimator_target_bitrate(estimator) / 100 * share;
+
+        size_t fitting = 0;
+        for (size_t i = 0; i < renditions_count; i++) {
+            if (renditions[i].bitrate <= budget) {
+                fitting = i;
+            }
+        }
+
+        next = fitting > current ? current + 1 : fitting;
+    }
+
+    const bool is_congested =
+        SmolRTSP_NalTransport_is_full(self->t) ||
+        (has_new_report && rtcp.fraction_lost > policy.max_fraction_lost);
+    if (is_congested && next >= current && current > 0) {
+        next = current - 1;
+    }
+
+    if (next != current) {
+        SmolRTSP_LiveSubscriber_switch(self, renditions[next].source);
+    }
+
+    return next;
+}
+
+static void SmolRTSP_LiveSubscriber_drop(VSelf) {
+    VSELF(SmolRTSP_LiveSubscriber);
+    assert(self);
+
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_LiveSubscriber);
+
+// The number of the oldest frame in the ring.
+static uint64_t oldest(const SmolRTSP_LiveSource *self) {
+    return self->head > self->capacity ? self->head - self->capacity : 0;
+}
+
+static uint64_t now_us(const SmolRTSP_KeyframeRequestConfig *config) {
+    if (config->clock_us != NULL) {
+        return config->clock_us();
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t keyframe_requests(SmolRTSP_NalTransport *t) {
+    return SmolRTSP_NalTransport_stats(t).rtp.rtcp.keyframe_requests;
+}
+
+// Called with the mutex of `self` held.
+static void update_param_sets(
+    SmolRTSP_LiveSource *self, const SmolRTSP_LiveFrame *frame) {
+    bool is_changed = false;
+    for (size_t i = 0; i < frame->nalus_count; i++) {
+        // On an allocation failure, the cache keeps the old parameter set
+        // until the next frame that repeats it.
+        is_changed |= SmolRTSP_ParamSetCache_update(
+                          self->param_sets, frame->nalus[i]) == 1;
+    }
+    if (!is_changed || !SmolRTSP_ParamSetCache_is_complete(self->param_sets)) {
+        return;
+    }
+
+    SmolRTSP_NalCodec codec = SmolRTSP_NalCodec_H264;
+    match(frame->nalus[0].header) {
+        of(SmolRTSP_NalHeader_H265, h265) {
+            (void)h265;
+            codec = SmolRTSP_NalCodec_H265;
+        }
+        otherwise {}
+    }
+
+    const U8Slice99 sets[] = {
+        SmolRTSP_ParamSetCache_vps(self->param_sets),
+        SmolRTSP_ParamSetCache_sps(self->param_sets),
+        SmolRTSP_ParamSetCache_pps(self->param_sets),
+    };
+    SmolRTSP_NalUnit nalus[SLICE99_ARRAY_LEN(sets)];
+    size_t nalus_count = 0;
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(sets); i++) {
+        if (!U8Slice99_is_empty(sets[i])) {
+            nalus[nalus_count++] = SmolRTSP_NalUnit_parse(codec, sets[i]);
+        }
+    }
+
+    // The subscribers sending the old frame still hold their references. If
+    // the new frame cannot be allocated, late joiners start without the
+    // parameter sets until the next change, as before the first one.
+    if (self->param_sets_frame != NULL) {
+        VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable)
+            .drop(self->param_sets_frame);
+    }
+    self->param_sets_frame = SmolRTSP_LiveFrame_new(
+        SmolRTSP_RtpTimestamp_Raw(0), nalus, nalus_count);
+}
+
+static bool request_keyframe(SmolRTSP_LiveSource *source, uint64_t cursor) {
+    pthread_mutex_lock(&source->mutex);
+
+    SmolRTSP_KeyframeRequestStats *stats = &source->keyframe_stats;
+    const SmolRTSP_KeyframeRequestConfig config = source->keyframe_config;
+    stats->requests++;
+
+    // The subscriber is going to send an IDR frame anyway.
+    if (source->has_idr && source->last_idr >= cursor &&
+        source->last_idr >= oldest(source)) {
+        stats->served_from_ring++;
+        pthread_mutex_unlock(&source->mutex);
+        return false;
+    }
+
+    const uint64_t now = now_us(&config);
+    if (NULL == config.request_keyframe ||
+        (source->requested &&
+         now - source->last_request_us < config.window_us)) {
+        stats->coalesced++;
+        pthread_mutex_unlock(&source->mutex);
+        return false;
+    }
+
+    source->requested = true;
+    source->last_request_us = now;
+    stats->forwarded++;
+
+    pthread_mutex_unlock(&source->mutex);
+
+    config.request_keyframe(config.user_data);
+    return true;
+}
+
+// Moves `self` to its pending source if an IDR frame has come since the
+// switch was requested; returns the number of frames sent (0 or 1), or -1 on
+// an I/O error.
+static ssize_t try_switch(SmolRTSP_LiveSubscriber *self) {
+    SmolRTSP_LiveSource *pending = self->pending;
+
+    pthread_mutex_lock(&pending->mutex);
+
+    if (!pending->has_idr || pending->last_idr < self->pending_cursor ||
+        pending->last_idr < oldest(pending)) {
+        pthread_mutex_unlock(&pending->mutex);
+        return 0;
+    }
+
+    const uint64_t idr = pending->last_idr;
+    SmolRTSP_LiveFrame *frame =
+        SmolRTSP_LiveFrame_ref(pending->ring[idr % pending->capacity]);
+    SmolRTSP_LiveFrame *param_sets =
+        pending->param_sets_frame != NULL
+            ? SmolRTSP_LiveFrame_ref(pending->param_sets_frame)
+            : NULL;
+
+    pthread_mutex_unlock(&pending->mutex);
+
+    // The old source is never locked together with the new one.
+    SmolRTSP_LiveSource *old = self->source;
+    pthread_mutex_lock(&old->mutex);
+    self->skipped += old->head - self->cursor;
+    pthread_mutex_unlock(&old->mutex);
+
+    self->source = pending;
+    self->pending = NULL;
+    self->cursor = idr + 1;
+    self->waiting_idr = false;
+    self->switches++;
+
+    const int ret = send_switch_frame(self->t, frame, param_sets);
+    VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(frame);
+    if (param_sets != NULL) {
+        VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(param_sets);
+    }
+
+    return -1 == ret ? -1 : 1;
+}
+
+// Sends the parameter sets of `param_sets` (if not `NULL`) at the timestamp of
+// `frame`, unless `frame` carries an SPS, and then `frame`.
+static int send_switch_frame(
+    SmolRTSP_NalTransport *t, const SmolRTSP_LiveFrame *frame,
+    const SmolRTSP_LiveFrame *param_sets) {
+    bool has_sps = false;
+    for (size_t i = 0; i < frame->nalus_count; i++) {
+        has_sps |= SmolRTSP_NalHeader_is_sps(frame->nalus[i].header);
+    }
+
+    for (size_t i = 0; !has_sps && param_sets != NULL &&
+                       i < param_sets->nalus_count;
+         i++) {
+        if (SmolRTSP_NalTransport_send_au_packet(
+                t, frame->ts, param_sets->nalus[i], false) == -1) {
+            return -1;
+        }
+    }
+
+    return SmolRTSP_LiveFrame_send(frame, t);
+}
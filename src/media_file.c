@@ -0,0 +1,526 @@
+#include <smolrtsp/media_file.h>
+
+#include <smolrtsp/nal_length.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC   "SRTSPIDX"
+#define INDEX_VERSION 1
+
+// The NAL unit begins an access unit.
+#define ENTRY_STARTS_AU (UINT32_C(1) << 0)
+// The NAL unit is an IDR slice.
+#define ENTRY_IDR (UINT32_C(1) << 1)
+
+// An entry of the index, as persisted.
+typedef struct {
+    // The offset of the NAL header in the file.
+    uint64_t offset;
+    // The size of the NAL unit, including the header.
+    uint32_t len;
+    uint32_t flags;
+} Entry;
+
+// The header of a persisted index, followed by `entries_count` entries. The
+// index is only meant to be read back on the same machine, so it is written in
+// the native byte order, which `magic` and `version` catch together with the
+// layout.
+typedef struct {
+    char magic[8];
+    uint32_t version, entry_size;
+    uint32_t codec, length_size;
+    uint64_t file_size;
+    int64_t mtime_sec, mtime_nsec;
+    uint64_t entries_count;
+} IndexHeader;
+
+struct SmolRTSP_MediaFile {
+    SmolRTSP_NalCodec codec;
+
+    const uint8_t *data;
+    size_t size;
+
+    Entry *entries;
+    size_t entries_count;
+
+    SmolRTSP_AccessUnit *access_units;
+    size_t access_units_count;
+
+    // The indices of the IDR access units in ascending order.
+    size_t *idrs;
+    size_t idrs_count;
+};
+
+static IndexHeader index_header(
+    const SmolRTSP_MediaFile *self, size_t length_size, const struct stat *st);
+static bool load_index(
+    SmolRTSP_MediaFile *self, const char *path, const IndexHeader *expected);
+static void store_index(
+    const SmolRTSP_MediaFile *self, const char *path,
+    const IndexHeader *header);
+static int build_index(SmolRTSP_MediaFile *self, size_t length_size);
+static int push_entry(SmolRTSP_MediaFile *self, Entry entry, size_t *cap);
+static void classify(SmolRTSP_MediaFile *self);
+static int collect_access_units(SmolRTSP_MediaFile *self);
+static bool is_vcl(SmolRTSP_NalCodec codec, uint8_t unit_type);
+static bool precedes_vcl(SmolRTSP_NalCodec codec, uint8_t unit_type);
+
+SmolRTSP_MediaFile *SmolRTSP_MediaFile_open(
+    const char *path, SmolRTSP_NalCodec codec, size_t length_size,
+    const char *index_path) {
+    assert(path);
+    assert(
+        0 == length_size || 1 == length_size || 2 == length_size ||
+        4 == length_size);
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (-1 == fd) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    void *data = NULL;
+    if (st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == data) {
+            const int saved_errno = errno;
+            close(fd);
+            errno = saved_errno;
+            return NULL;
+        }
+    }
+
+    // The mapping outlives the descriptor.
+    close(fd);
+
+    SmolRTSP_MediaFile *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        if (data != NULL) {
+            munmap(data, (size_t)st.st_size);
+        }
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->codec = codec;
+    self->data = data;
+    self->size = (size_t)st.st_size;
+    self->entries = NULL;
+    self->entries_count = 0;
+    self->access_units = NULL;
+    self->access_units_count = 0;
+    self->idrs = NULL;
+    self->idrs_count = 0;
+
+    const IndexHeader header = index_header(self, length_size, &st);
+
+    if (NULL == index_path || !load_index(self, index_path, &header)) {
+        if (build_index(self, length_size) == -1) {
+            const int saved_errno = errno;
+            VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(self);
+            errno = saved_errno;
+            return NULL;
+        }
+
+        classify(self);
+        if (index_path != NULL) {
+            store_index(self, index_path, &header);
+        }
+    }
+
+    if (collect_access_units(self) == -1) {
+        VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return self;
+}
+
+SmolRTSP_NalCodec SmolRTSP_MediaFile_codec(const SmolRTSP_MediaFile *self) {
+    assert(self);
+    return self->codec;
+}
+
+size_t SmolRTSP_MediaFile_nalus_count(const SmolRTSP_MediaFile *self) {
+    assert(self);
+    return self->entries_count;
+}
+
+SmolRTSP_NalUnit
+SmolRTSP_MediaFile_nalu(const SmolRTSP_MediaFile *self, size_t i) {
+    assert(self);
+    assert(i < self->entries_count);
+
+    const Entry *entry = &self->entries[i];
+    return SmolRTSP_NalUnit_parse(
+        self->codec,
+        U8Slice99_new((uint8_t *)self->data + entry->offset, entry->len));
+}
+
+size_t SmolRTSP_MediaFile_access_units_count(const SmolRTSP_MediaFile *self) {
+    assert(self);
+    return self->access_units_count;
+}
+
+SmolRTSP_AccessUnit
+SmolRTSP_MediaFile_access_unit(const SmolRTSP_MediaFile *self, size_t i) {
+    assert(self);
+    assert(i < self->access_units_count);
+
+    return self->access_units[i];
+}
+
+ssize_t SmolRTSP_MediaFile_find_idr(const SmolRTSP_MediaFile *self, size_t i) {
+    assert(self);
+    assert(i < self->access_units_count);
+
+    // The number of IDR access units at or before `i`.
+    size_t lo = 0, hi = self->idrs_count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (self->idrs[mid] <= i) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return 0 == lo ? -1 : (ssize_t)self->idrs[lo - 1];
+}
+
+ssize_t SmolRTSP_MediaFile_seek(
+    const SmolRTSP_MediaFile *self, uint64_t npt_ms, uint32_t frame_rate_num,
+    uint32_t frame_rate_den) {
+    assert(self);
+    assert(frame_rate_num > 0);
+    assert(frame_rate_den > 0);
+
+    if (0 == self->access_units_count) {
+        return -1;
+    }
+
+    // Divided first to not overflow with large times.
+    const uint64_t den = (uint64_t)frame_rate_den * 1000;
+    const uint64_t au = npt_ms / den * frame_rate_num +
+                        npt_ms % den * frame_rate_num / den;
+
+    return SmolRTSP_MediaFile_find_idr(
+        self, au < self->access_units_count ? (size_t)au
+                                            : self->access_units_count - 1);
+}
+
+static void SmolRTSP_MediaFile_drop(VSelf) {
+    VSELF(SmolRTSP_MediaFile);
+    assert(self);
+
+    if (self->data != NULL) {
+        munmap((void *)self->data, self->size);
+    }
+    smolrtsp_free(self->entries);
+    smolrtsp_free(self->access_units);
+    smolrtsp_free(self->idrs);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_MediaFile);
+
+static IndexHeader index_header(
+    const SmolRTSP_MediaFile *self, size_t length_size, const struct stat *st) {
+    IndexHeader header;
+    // Zero the padding too, since the header is compared bytewise.
+    memset(&header, 0, sizeof header);
+
+    memcpy(header.magic, INDEX_MAGIC, sizeof header.magic);
+    header.version = INDEX_VERSION;
+    header.entry_size = sizeof(Entry);
+    header.codec = (uint32_t)self->codec;
+    header.length_size = (uint32_t)length_size;
+    header.file_size = (uint64_t)st->st_size;
+    header.mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    header.mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+
+    return header;
+}
+
+static bool load_index(
+    SmolRTSP_MediaFile *self, const char *path, const IndexHeader *expected) {
+    FILE *fp = fopen(path, "rb");
+    if (NULL == fp) {
+        return false;
+    }
+
+    IndexHeader header;
+    if (fread(&header, sizeof header, 1, fp) != 1) {
+        goto fail;
+    }
+
+    const uint64_t entries_count = header.entries_count;
+    header.entries_count = 0;
+    if (memcmp(&header, expected, sizeof header) != 0 ||
+        entries_count > self->size) {
+        goto fail;
+    }
+
+    // Without memory for the index, it is built in memory instead, which
+    // fails in the same way.
+    Entry *entries = smolrtsp_malloc(entries_count * sizeof entries[0] + 1);
+    if (NULL == entries) {
+        goto fail;
+    }
+
+    if (fread(entries, sizeof entries[0], entries_count, fp) !=
+        entries_count) {
+        smolrtsp_free(entries);
+        goto fail;
+    }
+
+    // A stale or corrupted index must not point outside of the mapping.
+    const size_t header_size = SmolRTSP_NalCodec_header_size(self->codec);
+    for (size_t i = 0; i < entries_count; i++) {
+        if (entries[i].len < header_size || entries[i].offset > self->size ||
+            entries[i].len > self->size - entries[i].offset) {
+            smolrtsp_free(entries);
+            goto fail;
+        }
+    }
+
+    fclose(fp);
+    self->entries = entries;
+    self->entries_count = (size_t)entries_count;
+    return true;
+
+fail:
+    fclose(fp);
+    return false;
+}
+
+static void store_index(
+    const SmolRTSP_MediaFile *self, const char *path,
+    const IndexHeader *header) {
+    // Written aside and renamed, so that concurrent readers never see a
+    // partial index.
+    char tmp_path[4096];
+    if (snprintf(
+            tmp_path, sizeof tmp_path, "%s.%ld.tmp", path, (long)getpid()) >=
+        (int)sizeof tmp_path) {
+        return;
+    }
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (NULL == fp) {
+        return;
+    }
+
+    IndexHeader h = *header;
+    h.entries_count = self->entries_count;
+
+    const bool ok =
+        fwrite(&h, sizeof h, 1, fp) == 1 &&
+        fwrite(
+            self->entries, sizeof self->entries[0], self->entries_count, fp) ==
+            self->entries_count;
+
+    if (fclose(fp) != 0 || !ok || rename(tmp_path, path) == -1) {
+        remove(tmp_path);
+    }
+}
+
+static int build_index(SmolRTSP_MediaFile *self, size_t length_size) {
+    const U8Slice99 data = U8Slice99_new((uint8_t *)self->data, self->size);
+    size_t cap = 0;
+
+    if (length_size > 0) {
+        SmolRTSP_NalLengthIter iter =
+            SmolRTSP_NalLengthIter_new(self->codec, length_size, data);
+
+        SmolRTSP_NalUnit nalu;
+        int ret;
+        while ((ret = SmolRTSP_NalLengthIter_next(&iter, &nalu)) == 1) {
+            const size_t header_size = SmolRTSP_NalHeader_size(nalu.header);
+            const size_t offset =
+                (size_t)(nalu.payload.ptr - data.ptr) - header_size;
+            if (push_entry(
+                    self,
+                    (Entry){
+                        .offset = offset,
+                        .len = (uint32_t)(header_size + nalu.payload.len),
+                    },
+                    &cap) == -1) {
+                return -1;
+            }
+        }
+
+        return ret;
+    }
+
+    const size_t header_size = SmolRTSP_NalCodec_header_size(self->codec);
+    size_t offset = smolrtsp_find_next_start_code(data);
+
+    while (offset < data.len) {
+        const U8Slice99 rest = U8Slice99_advance(data, offset);
+        const size_t start =
+            offset + (smolrtsp_test_start_code_4b(rest) > 0 ? 4 : 3);
+        const size_t end =
+            start + smolrtsp_find_next_start_code(
+                        U8Slice99_advance(data, start));
+
+        // Trailing zero bytes (`trailing_zero_8bits`) are not a part of the
+        // NAL unit.
+        size_t len = end - start;
+        while (len > 0 && 0x00 == data.ptr[start + len - 1]) {
+            len--;
+        }
+
+        if (len >= header_size &&
+            push_entry(
+                self, (Entry){.offset = start, .len = (uint32_t)len}, &cap) ==
+                -1) {
+            return -1;
+        }
+
+        offset = end;
+    }
+
+    return 0;
+}
+
+static int push_entry(SmolRTSP_MediaFile *self, Entry entry, size_t *cap) {
+    if (self->entries_count == *cap) {
+        const size_t new_cap = 0 == *cap ? 256 : *cap * 2;
+        Entry *entries =
+            smolrtsp_realloc(self->entries, new_cap * sizeof entry);
+        if (NULL == entries) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->entries = entries;
+        *cap = new_cap;
+    }
+
+    self->entries[self->entries_count++] = entry;
+    return 0;
+}
+
+// Marks the first NAL units of access units and the IDR slices, following
+// H.264 section 7.4.1.2.3 and H.265 section 7.4.2.4.4: an access unit begins
+// with the first NAL unit that may only precede the first slice of a picture,
+// or with that slice itself.
+static void classify(SmolRTSP_MediaFile *self) {
+    bool has_vcl = false;
+
+    for (size_t i = 0; i < self->entries_count; i++) {
+        Entry *entry = &self->entries[i];
+        const SmolRTSP_NalUnit nalu = SmolRTSP_MediaFile_nalu(self, i);
+        const uint8_t unit_type = SmolRTSP_NalHeader_unit_type(nalu.header);
+
+        entry->flags = 0;
+        if (0 == i) {
+            entry->flags |= ENTRY_STARTS_AU;
+        }
+
+        if (is_vcl(self->codec, unit_type)) {
+            // `first_mb_in_slice` is 0 (coded as `1` in ue(v)) for H.264, and
+            // `first_slice_segment_in_pic_flag` is set for H.265.
+            const bool is_first_slice =
+                nalu.payload.len > 0 && (nalu.payload.ptr[0] & 0x80) != 0;
+            if (has_vcl && is_first_slice) {
+                entry->flags |= ENTRY_STARTS_AU;
+            }
+            if (SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header)) {
+                entry->flags |= ENTRY_IDR;
+            }
+            has_vcl = true;
+        } else if (has_vcl && precedes_vcl(self->codec, unit_type)) {
+            entry->flags |= ENTRY_STARTS_AU;
+            has_vcl = false;
+        }
+    }
+}
+
+static int collect_access_units(SmolRTSP_MediaFile *self) {
+    size_t count = 0;
+    for (size_t i = 0; i < self->entries_count; i++) {
+        if ((self->entries[i].flags & ENTRY_STARTS_AU) != 0) {
+            count++;
+        }
+    }
+
+    self->access_units =
+        smolrtsp_malloc(count * sizeof self->access_units[0] + 1);
+    if (NULL == self->access_units) {
+        return -1;
+    }
+    self->access_units_count = 0;
+
+    for (size_t i = 0; i < self->entries_count; i++) {
+        const Entry *entry = &self->entries[i];
+
+        if ((entry->flags & ENTRY_STARTS_AU) != 0 ||
+            0 == self->access_units_count) {
+            self->access_units[self->access_units_count++] =
+                (SmolRTSP_AccessUnit){.first_nalu = i};
+        }
+
+        SmolRTSP_AccessUnit *au =
+            &self->access_units[self->access_units_count - 1];
+        au->nalus_count++;
+        if ((entry->flags & ENTRY_IDR) != 0) {
+            au->is_idr = true;
+        }
+    }
+
+    self->idrs = smolrtsp_malloc(
+        self->access_units_count * sizeof self->idrs[0] + 1);
+    if (NULL == self->idrs) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < self->access_units_count; i++) {
+        if (self->access_units[i].is_idr) {
+            self->idrs[self->idrs_count++] = i;
+        }
+    }
+
+    return 0;
+}
+
+static bool is_vcl(SmolRTSP_NalCodec codec, uint8_t unit_type) {
+    if (SmolRTSP_NalCodec_H264 == codec) {
+        return unit_type >= 1 && unit_type <= 5;
+    }
+
+    return unit_type <= 31;
+}
+
+// Access unit delimiters, parameter sets, prefix SEI, and the types reserved
+// for them.
+static bool precedes_vcl(SmolRTSP_NalCodec codec, uint8_t unit_type) {
+    if (SmolRTSP_NalCodec_H264 == codec) {
+        return (unit_type >= 6 && unit_type <= 9) ||
+               (unit_type >= 14 && unit_type <= 18);
+    }
+
+    return (unit_type >= 32 && unit_type <= 35) || 39 == unit_type ||
+           (unit_type >= 41 && unit_type <= 44) ||
+           (unit_type >= 48 && unit_type <= 55);
+}
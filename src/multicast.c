@@ -0,0 +1,296 @@
+#include <smolrtsp/multicast.h>
+
+#include <smolrtsp/types/header.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+typedef struct {
+    // `NULL` while the group is free.
+    char *key;
+    size_t key_len;
+    size_t refs;
+} Slot;
+
+struct SmolRTSP_MulticastPool {
+    pthread_mutex_t mutex;
+
+    uint32_t first_group; // In the host byte order.
+    uint16_t first_port;
+
+    Slot *slots;
+    size_t slots_count;
+};
+
+static int set_options(int fd, int af, SmolRTSP_MulticastConfig config);
+static Slot *find_slot(SmolRTSP_MulticastPool *self, CharSlice99 key);
+static SmolRTSP_MulticastGroup
+slot_group(const SmolRTSP_MulticastPool *self, const Slot *slot);
+
+SmolRTSP_MulticastConfig SmolRTSP_MulticastConfig_default(void) {
+    return (SmolRTSP_MulticastConfig){
+        .ttl = 16,
+        .loopback = false,
+        .interface_index = 0,
+    };
+}
+
+int smolrtsp_multicast_socket(
+    int af, const void *restrict group, uint16_t port,
+    SmolRTSP_MulticastConfig config) {
+    assert(group);
+
+    struct sockaddr_storage dest;
+    memset(&dest, '\0', sizeof dest);
+    socklen_t dest_len;
+
+    switch (af) {
+    case AF_INET: {
+        struct sockaddr_in *addr = (struct sockaddr_in *)&dest;
+        addr->sin_family = AF_INET;
+        memcpy(&addr->sin_addr, group, sizeof addr->sin_addr);
+        addr->sin_port = htons(port);
+        dest_len = sizeof *addr;
+
+        if (!IN_MULTICAST(ntohl(addr->sin_addr.s_addr))) {
+            errno = EINVAL;
+            return -1;
+        }
+        break;
+    }
+    case AF_INET6: {
+        struct sockaddr_in6 *addr = (struct sockaddr_in6 *)&dest;
+        addr->sin6_family = AF_INET6;
+        memcpy(&addr->sin6_addr, group, sizeof addr->sin6_addr);
+        addr->sin6_port = htons(port);
+        dest_len = sizeof *addr;
+
+        if (!IN6_IS_ADDR_MULTICAST(&addr->sin6_addr)) {
+            errno = EINVAL;
+            return -1;
+        }
+        break;
+    }
+    default:
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+
+    const int fd = socket(af, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    // The outgoing interface must be chosen before connecting, since it
+    // determines the route.
+    if (set_options(fd, af, config) == -1 ||
+        connect(fd, (const struct sockaddr *)&dest, dest_len) == -1) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return fd;
+}
+
+SmolRTSP_MulticastPool *SmolRTSP_MulticastPool_new(
+    struct in_addr first_group, size_t groups_count, uint16_t first_port) {
+    assert(groups_count > 0);
+    assert(first_port % 2 == 0);
+    assert((size_t)first_port + 2 * groups_count - 1 <= UINT16_MAX);
+
+    SmolRTSP_MulticastPool *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->slots = smolrtsp_calloc(groups_count, sizeof self->slots[0]);
+    if (NULL == self->slots) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->slots_count = groups_count;
+
+    const int ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == ret);
+    (void)ret;
+
+    self->first_group = ntohl(first_group.s_addr);
+    self->first_port = first_port;
+
+    return self;
+}
+
+int SmolRTSP_MulticastPool_acquire(
+    SmolRTSP_MulticastPool *self, CharSlice99 key,
+    SmolRTSP_MulticastGroup *restrict group) {
+    assert(self);
+    assert(group);
+
+    pthread_mutex_lock(&self->mutex);
+
+    Slot *slot = find_slot(self, key);
+    if (NULL == slot) {
+        for (size_t i = 0; i < self->slots_count; i++) {
+            if (NULL == self->slots[i].key) {
+                slot = &self->slots[i];
+                break;
+            }
+        }
+
+        if (NULL == slot) {
+            pthread_mutex_unlock(&self->mutex);
+            errno = ENOSPC;
+            return -1;
+        }
+
+        slot->key = smolrtsp_malloc(key.len + 1);
+        if (NULL == slot->key) {
+            pthread_mutex_unlock(&self->mutex);
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy(slot->key, key.ptr, key.len);
+        slot->key_len = key.len;
+        slot->refs = 0;
+    }
+
+    slot->refs++;
+    *group = slot_group(self, slot);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return 0;
+}
+
+bool SmolRTSP_MulticastPool_release(
+    SmolRTSP_MulticastPool *self, CharSlice99 key) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+
+    Slot *slot = find_slot(self, key);
+    const bool is_last = slot != NULL && 0 == --slot->refs;
+    if (is_last) {
+        smolrtsp_free(slot->key);
+        slot->key = NULL;
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return is_last;
+}
+
+static void SmolRTSP_MulticastPool_drop(VSelf) {
+    VSELF(SmolRTSP_MulticastPool);
+    assert(self);
+
+    for (size_t i = 0; i < self->slots_count; i++) {
+        smolrtsp_free(self->slots[i].key);
+    }
+
+    smolrtsp_free(self->slots);
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_MulticastPool);
+
+void smolrtsp_multicast_transport_header(
+    SmolRTSP_Context *ctx, SmolRTSP_MulticastGroup group, uint8_t ttl) {
+    assert(ctx);
+
+    char destination[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &group.addr, destination, sizeof destination);
+
+    smolrtsp_header(
+        ctx, SMOLRTSP_HEADER_TRANSPORT,
+        "RTP/AVP;multicast;destination=%s;port=%" PRIu16 "-%" PRIu16
+        ";ttl=%" PRIu8,
+        destination, group.ports.rtp_port, group.ports.rtcp_port, ttl);
+}
+
+static int set_options(int fd, int af, SmolRTSP_MulticastConfig config) {
+    const int ttl = config.ttl, loopback = config.loopback;
+
+    if (AF_INET == af) {
+        if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof ttl) ==
+                -1 ||
+            setsockopt(
+                fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopback,
+                sizeof loopback) == -1) {
+            return -1;
+        }
+
+        if (config.interface_index != 0) {
+            const struct ip_mreqn mreq = {
+                .imr_ifindex = (int)config.interface_index,
+            };
+            if (setsockopt(
+                    fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof mreq) ==
+                -1) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    const unsigned loopback6 = config.loopback;
+    if (setsockopt(
+            fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof ttl) == -1 ||
+        setsockopt(
+            fd, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loopback6,
+            sizeof loopback6) == -1) {
+        return -1;
+    }
+
+    if (config.interface_index != 0 &&
+        setsockopt(
+            fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, &config.interface_index,
+            sizeof config.interface_index) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static Slot *find_slot(SmolRTSP_MulticastPool *self, CharSlice99 key) {
+    for (size_t i = 0; i < self->slots_count; i++) {
+        Slot *slot = &self->slots[i];
+        if (slot->key != NULL && slot->key_len == key.len &&
+            memcmp(slot->key, key.ptr, key.len) == 0) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static SmolRTSP_MulticastGroup
+slot_group(const SmolRTSP_MulticastPool *self, const Slot *slot) {
+    const size_t i = (size_t)(slot - self->slots);
+
+    return (SmolRTSP_MulticastGroup){
+        .addr = {.s_addr = htonl(self->first_group + (uint32_t)i)},
+        .ports =
+            {
+                .rtp_port = (uint16_t)(self->first_port + 2 * i),
+                .rtcp_port = (uint16_t)(self->first_port + 2 * i + 1),
+            },
+    };
+}
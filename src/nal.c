@@ -1,6 +1,20 @@
 #include <smolrtsp/nal.h>
 
 #include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SMOLRTSP_HAS_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define NAL_HEADER_DERIVE_GETTER(T, name, h264_value, h265_value)              \
     T SmolRTSP_NalHeader_##name(SmolRTSP_NalHeader self) {                     \
@@ -71,6 +85,27 @@ void SmolRTSP_NalHeader_write_fu_header(
     }
 }
 
+size_t SmolRTSP_NalCodec_header_size(SmolRTSP_NalCodec codec) {
+    return SmolRTSP_NalCodec_H264 == codec ? SMOLRTSP_H264_NAL_HEADER_SIZE
+                                           : SMOLRTSP_H265_NAL_HEADER_SIZE;
+}
+
+SmolRTSP_NalUnit
+SmolRTSP_NalUnit_parse(SmolRTSP_NalCodec codec, U8Slice99 data) {
+    const size_t header_size = SmolRTSP_NalCodec_header_size(codec);
+    assert(data.len >= header_size);
+
+    const SmolRTSP_NalHeader header =
+        SmolRTSP_NalCodec_H264 == codec
+            ? SmolRTSP_NalHeader_H264(SmolRTSP_H264NalHeader_parse(data.ptr[0]))
+            : SmolRTSP_NalHeader_H265(SmolRTSP_H265NalHeader_parse(data.ptr));
+
+    return (SmolRTSP_NalUnit){
+        .header = header,
+        .payload = U8Slice99_advance(data, header_size),
+    };
+}
+
 // See <https://tools.ietf.org/html/rfc7798#section-4.4.3> (H.265),
 // <https://tools.ietf.org/html/rfc6184#section-5.8> (H.264).
 uint8_t smolrtsp_nal_fu_header(
@@ -141,3 +176,155 @@ size_t smolrtsp_test_start_code_4b(U8Slice99 data) {
 
     return 0;
 }
+
+static size_t find_3b_scalar(const uint8_t *data, size_t len);
+
+#if defined(__SSE2__)
+static size_t find_3b_sse2(const uint8_t *data, size_t len);
+#endif
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+static size_t find_3b_avx2(const uint8_t *data, size_t len);
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+static size_t find_3b_neon(const uint8_t *data, size_t len);
+#endif
+
+typedef size_t (*StartCodeFinder)(const uint8_t *data, size_t len);
+
+static StartCodeFinder select_finder(void) {
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        return find_3b_avx2;
+    }
+#endif
+
+#if defined(__SSE2__)
+    return find_3b_sse2;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    return find_3b_neon;
+#else
+    return find_3b_scalar;
+#endif
+}
+
+size_t smolrtsp_find_next_start_code(U8Slice99 data) {
+    // Racing initializations store the same value.
+    static StartCodeFinder finder = NULL;
+    StartCodeFinder f = __atomic_load_n(&finder, __ATOMIC_RELAXED);
+    if (NULL == f) {
+        f = select_finder();
+        __atomic_store_n(&finder, f, __ATOMIC_RELAXED);
+    }
+
+    const size_t offset = f(data.ptr, data.len);
+
+    // Prefer the 4-byte start code `0x00000001` if it is there.
+    if (offset < data.len && offset > 0 && 0x00 == data.ptr[offset - 1]) {
+        return offset - 1;
+    }
+
+    return offset;
+}
+
+// Each finder below returns the offset of the first `0x000001` in `data`, or
+// `len` if there is none.
+
+static size_t find_3b_scalar(const uint8_t *data, size_t len) {
+    size_t i = 0;
+
+    while (i + 2 < len) {
+        if (data[i + 2] > 0x01) {
+            // No start code can begin at `i`, `i + 1`, or `i + 2`.
+            i += 3;
+        } else if (0x01 == data[i + 2]) {
+            if (0x00 == data[i] && 0x00 == data[i + 1]) {
+                return i;
+            }
+            i += 3;
+        } else {
+            i++;
+        }
+    }
+
+    return len;
+}
+
+#if defined(__SSE2__)
+
+static size_t find_3b_sse2(const uint8_t *data, size_t len) {
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi8(1);
+
+    size_t i = 0;
+    for (; i + 2 + 16 <= len; i += 16) {
+        const __m128i b0 = _mm_loadu_si128((const __m128i *)(data + i)),
+                      b1 = _mm_loadu_si128((const __m128i *)(data + i + 1)),
+                      b2 = _mm_loadu_si128((const __m128i *)(data + i + 2));
+
+        const __m128i matches = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+            _mm_cmpeq_epi8(b2, one));
+
+        const unsigned mask = (unsigned)_mm_movemask_epi8(matches);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + find_3b_scalar(data + i, len - i);
+}
+
+#endif // defined(__SSE2__)
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+
+__attribute__((target("avx2"))) static size_t
+find_3b_avx2(const uint8_t *data, size_t len) {
+    const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi8(1);
+
+    size_t i = 0;
+    for (; i + 2 + 32 <= len; i += 32) {
+        const __m256i b0 = _mm256_loadu_si256((const __m256i *)(data + i)),
+                      b1 = _mm256_loadu_si256((const __m256i *)(data + i + 1)),
+                      b2 = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+
+        const __m256i matches = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+            _mm256_cmpeq_epi8(b2, one));
+
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(matches);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + find_3b_scalar(data + i, len - i);
+}
+
+#endif // SMOLRTSP_HAS_AVX2_DISPATCH
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+static size_t find_3b_neon(const uint8_t *data, size_t len) {
+    const uint8x16_t zero = vdupq_n_u8(0), one = vdupq_n_u8(1);
+
+    size_t i = 0;
+    for (; i + 2 + 16 <= len; i += 16) {
+        const uint8x16_t b0 = vld1q_u8(data + i), b1 = vld1q_u8(data + i + 1),
+                         b2 = vld1q_u8(data + i + 2);
+
+        const uint8x16_t matches = vandq_u8(
+            vandq_u8(vceqq_u8(b0, zero), vceqq_u8(b1, zero)),
+            vceqq_u8(b2, one));
+
+        if (vmaxvq_u8(matches) != 0) {
+            return i + find_3b_scalar(data + i, 18);
+        }
+    }
+
+    return i + find_3b_scalar(data + i, len - i);
+}
+
+#endif // defined(__aarch64__) && defined(__ARM_NEON)
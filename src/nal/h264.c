@@ -1,6 +1,14 @@
 #include <smolrtsp/nal/h264.h>
 
 #include <smolrtsp/nal.h>
+#include <smolrtsp/nal_rbsp.h>
+
+#include <assert.h>
+#include <errno.h>
+
+// Generous bounds that keep the frame size computations from overflowing.
+#define MAX_SIZE_IN_MBS (1u << 16)
+#define MAX_BIT_DEPTH   14
 
 SmolRTSP_H264NalHeader SmolRTSP_H264NalHeader_parse(uint8_t byte_header) {
     return (SmolRTSP_H264NalHeader){
@@ -55,3 +63,157 @@ void SmolRTSP_H264NalHeader_write_fu_header(
     buffer = SLICE99_APPEND(buffer, fu_identifier);
     buffer = SLICE99_APPEND(buffer, fu_header);
 }
+
+static bool has_chroma_format_idc(uint8_t profile_idc);
+static void
+skip_scaling_lists(SmolRTSP_RbspReader *r, uint32_t chroma_format_idc);
+
+int SmolRTSP_H264Sps_parse(SmolRTSP_H264Sps *restrict self, U8Slice99 payload) {
+    assert(self);
+
+    SmolRTSP_RbspReader r = SmolRTSP_RbspReader_new(payload);
+    *self = (SmolRTSP_H264Sps){0};
+
+    self->profile_idc = (uint8_t)SmolRTSP_RbspReader_bits(&r, 8);
+    self->constraint_flags = (uint8_t)SmolRTSP_RbspReader_bits(&r, 8);
+    self->level_idc = (uint8_t)SmolRTSP_RbspReader_bits(&r, 8);
+    self->seq_parameter_set_id = SmolRTSP_RbspReader_ue(&r);
+
+    self->chroma_format_idc = 1;
+    self->bit_depth_luma = self->bit_depth_chroma = 8;
+    if (has_chroma_format_idc(self->profile_idc)) {
+        self->chroma_format_idc = SmolRTSP_RbspReader_ue(&r);
+        if (self->chroma_format_idc > 3) {
+            goto fail;
+        }
+        if (3 == self->chroma_format_idc) {
+            SmolRTSP_RbspReader_skip(&r, 1); // separate_colour_plane_flag
+        }
+        self->bit_depth_luma = SmolRTSP_RbspReader_ue(&r) + 8;
+        self->bit_depth_chroma = SmolRTSP_RbspReader_ue(&r) + 8;
+        SmolRTSP_RbspReader_skip(&r, 1); // qpprime_y_zero_transform_bypass_flag
+        // seq_scaling_matrix_present_flag
+        if (SmolRTSP_RbspReader_bits(&r, 1)) {
+            skip_scaling_lists(&r, self->chroma_format_idc);
+        }
+    }
+
+    (void)SmolRTSP_RbspReader_ue(&r); // log2_max_frame_num_minus4
+    const uint32_t pic_order_cnt_type = SmolRTSP_RbspReader_ue(&r);
+    if (0 == pic_order_cnt_type) {
+        (void)SmolRTSP_RbspReader_ue(&r); // log2_max_pic_order_cnt_lsb_minus4
+    } else if (1 == pic_order_cnt_type) {
+        SmolRTSP_RbspReader_skip(&r, 1); // delta_pic_order_always_zero_flag
+        (void)SmolRTSP_RbspReader_se(&r); // offset_for_non_ref_pic
+        (void)SmolRTSP_RbspReader_se(&r); // offset_for_top_to_bottom_field
+        const uint32_t cycle = SmolRTSP_RbspReader_ue(&r);
+        if (cycle > 255) {
+            goto fail;
+        }
+        for (uint32_t i = 0; i < cycle; i++) {
+            (void)SmolRTSP_RbspReader_se(&r); // offset_for_ref_frame[i]
+        }
+    } else if (pic_order_cnt_type > 2) {
+        goto fail;
+    }
+
+    self->max_num_ref_frames = SmolRTSP_RbspReader_ue(&r);
+    SmolRTSP_RbspReader_skip(&r, 1); // gaps_in_frame_num_value_allowed_flag
+
+    const uint32_t width_in_mbs = SmolRTSP_RbspReader_ue(&r) + 1,
+                   height_in_map_units = SmolRTSP_RbspReader_ue(&r) + 1;
+    self->frame_mbs_only_flag = SmolRTSP_RbspReader_bits(&r, 1);
+    if (!self->frame_mbs_only_flag) {
+        SmolRTSP_RbspReader_skip(&r, 1); // mb_adaptive_frame_field_flag
+    }
+    SmolRTSP_RbspReader_skip(&r, 1); // direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (SmolRTSP_RbspReader_bits(&r, 1)) { // frame_cropping_flag
+        crop_left = SmolRTSP_RbspReader_ue(&r);
+        crop_right = SmolRTSP_RbspReader_ue(&r);
+        crop_top = SmolRTSP_RbspReader_ue(&r);
+        crop_bottom = SmolRTSP_RbspReader_ue(&r);
+    }
+
+    if (!SmolRTSP_RbspReader_is_ok(&r) || width_in_mbs > MAX_SIZE_IN_MBS ||
+        height_in_map_units > MAX_SIZE_IN_MBS ||
+        self->bit_depth_luma > MAX_BIT_DEPTH ||
+        self->bit_depth_chroma > MAX_BIT_DEPTH) {
+        goto fail;
+    }
+
+    // See Table 6-1 and the semantics of `frame_crop_left_offset`.
+    const uint32_t frame_height_factor = self->frame_mbs_only_flag ? 1 : 2;
+    uint32_t crop_unit_x = 1, crop_unit_y = frame_height_factor;
+    if (1 == self->chroma_format_idc) {
+        crop_unit_x = 2;
+        crop_unit_y *= 2;
+    } else if (2 == self->chroma_format_idc) {
+        crop_unit_x = 2;
+    }
+
+    const uint32_t width = width_in_mbs * 16,
+                   height = frame_height_factor * height_in_map_units * 16;
+    if (crop_left >= width || crop_right >= width || crop_top >= height ||
+        crop_bottom >= height ||
+        (crop_left + crop_right) * crop_unit_x >= width ||
+        (crop_top + crop_bottom) * crop_unit_y >= height) {
+        goto fail;
+    }
+
+    self->width = width - (crop_left + crop_right) * crop_unit_x;
+    self->height = height - (crop_top + crop_bottom) * crop_unit_y;
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
+
+// The High profiles signal the chroma format and the bit depths.
+static bool has_chroma_format_idc(uint8_t profile_idc) {
+    switch (profile_idc) {
+    case 100:
+    case 110:
+    case 122:
+    case 244:
+    case 44:
+    case 83:
+    case 86:
+    case 118:
+    case 128:
+    case 138:
+    case 139:
+    case 134:
+    case 135:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void
+skip_scaling_lists(SmolRTSP_RbspReader *r, uint32_t chroma_format_idc) {
+    const int count = 3 != chroma_format_idc ? 8 : 12;
+
+    for (int i = 0; i < count && SmolRTSP_RbspReader_is_ok(r); i++) {
+        if (!SmolRTSP_RbspReader_bits(r, 1)) { // seq_scaling_list_present_flag
+            continue;
+        }
+
+        // See section 7.3.2.1.1.1.
+        const int size = i < 6 ? 16 : 64;
+        int32_t last_scale = 8, next_scale = 8;
+        for (int j = 0; j < size && next_scale != 0; j++) {
+            const int32_t delta_scale = SmolRTSP_RbspReader_se(r);
+            if (delta_scale < -128 || delta_scale > 127) {
+                r->ok = false;
+                return;
+            }
+            next_scale = (last_scale + delta_scale + 256) % 256;
+            last_scale = 0 == next_scale ? last_scale : next_scale;
+        }
+    }
+}
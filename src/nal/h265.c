@@ -2,9 +2,17 @@
 
 #include <smolrtsp/nal.h>
 
+#include <smolrtsp/nal_rbsp.h>
+
 #include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
 #include <string.h>
 
+// Generous bounds that keep the picture size computations from overflowing.
+#define MAX_PICTURE_SIZE (1u << 20)
+#define MAX_BIT_DEPTH    16
+
 SmolRTSP_H265NalHeader
 SmolRTSP_H265NalHeader_parse(uint8_t bytes[restrict static 2]) {
     return (SmolRTSP_H265NalHeader){
@@ -70,3 +78,134 @@ void SmolRTSP_H265NalHeader_write_fu_header(
     buffer = SLICE99_APPEND(buffer, payload_hdr);
     buffer = SLICE99_APPEND(buffer, fu_header);
 }
+
+static void read_profile_tier_level(
+    SmolRTSP_RbspReader *r, uint8_t max_sub_layers_minus1,
+    SmolRTSP_H265ProfileTierLevel *ptl);
+
+int SmolRTSP_H265Vps_parse(SmolRTSP_H265Vps *restrict self, U8Slice99 payload) {
+    assert(self);
+
+    SmolRTSP_RbspReader r = SmolRTSP_RbspReader_new(payload);
+    *self = (SmolRTSP_H265Vps){0};
+
+    self->video_parameter_set_id = (uint8_t)SmolRTSP_RbspReader_bits(&r, 4);
+    // vps_base_layer_internal_flag, vps_base_layer_available_flag
+    SmolRTSP_RbspReader_skip(&r, 2);
+    self->max_layers = (uint8_t)SmolRTSP_RbspReader_bits(&r, 6) + 1;
+    const uint8_t max_sub_layers_minus1 =
+        (uint8_t)SmolRTSP_RbspReader_bits(&r, 3);
+    self->max_sub_layers = max_sub_layers_minus1 + 1;
+    self->temporal_id_nesting_flag = SmolRTSP_RbspReader_bits(&r, 1);
+    SmolRTSP_RbspReader_skip(&r, 16); // vps_reserved_0xffff_16bits
+
+    read_profile_tier_level(
+        &r, max_sub_layers_minus1, &self->profile_tier_level);
+
+    if (!SmolRTSP_RbspReader_is_ok(&r) || max_sub_layers_minus1 > 6) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    return 0;
+}
+
+int SmolRTSP_H265Sps_parse(SmolRTSP_H265Sps *restrict self, U8Slice99 payload) {
+    assert(self);
+
+    SmolRTSP_RbspReader r = SmolRTSP_RbspReader_new(payload);
+    *self = (SmolRTSP_H265Sps){0};
+
+    self->video_parameter_set_id = (uint8_t)SmolRTSP_RbspReader_bits(&r, 4);
+    const uint8_t max_sub_layers_minus1 =
+        (uint8_t)SmolRTSP_RbspReader_bits(&r, 3);
+    self->max_sub_layers = max_sub_layers_minus1 + 1;
+    SmolRTSP_RbspReader_skip(&r, 1); // sps_temporal_id_nesting_flag
+
+    read_profile_tier_level(
+        &r, max_sub_layers_minus1, &self->profile_tier_level);
+
+    self->seq_parameter_set_id = SmolRTSP_RbspReader_ue(&r);
+    self->chroma_format_idc = SmolRTSP_RbspReader_ue(&r);
+    if (3 == self->chroma_format_idc) {
+        SmolRTSP_RbspReader_skip(&r, 1); // separate_colour_plane_flag
+    }
+
+    const uint32_t width = SmolRTSP_RbspReader_ue(&r),
+                   height = SmolRTSP_RbspReader_ue(&r);
+
+    uint32_t left = 0, right = 0, top = 0, bottom = 0;
+    if (SmolRTSP_RbspReader_bits(&r, 1)) { // conformance_window_flag
+        left = SmolRTSP_RbspReader_ue(&r);
+        right = SmolRTSP_RbspReader_ue(&r);
+        top = SmolRTSP_RbspReader_ue(&r);
+        bottom = SmolRTSP_RbspReader_ue(&r);
+    }
+
+    self->bit_depth_luma = SmolRTSP_RbspReader_ue(&r) + 8;
+    self->bit_depth_chroma = SmolRTSP_RbspReader_ue(&r) + 8;
+
+    if (!SmolRTSP_RbspReader_is_ok(&r) || max_sub_layers_minus1 > 6 ||
+        self->chroma_format_idc > 3 || 0 == width || 0 == height ||
+        width > MAX_PICTURE_SIZE || height > MAX_PICTURE_SIZE ||
+        self->bit_depth_luma > MAX_BIT_DEPTH ||
+        self->bit_depth_chroma > MAX_BIT_DEPTH) {
+        goto fail;
+    }
+
+    // See Table 6-1.
+    uint32_t sub_width_c = 1, sub_height_c = 1;
+    if (1 == self->chroma_format_idc) {
+        sub_width_c = sub_height_c = 2;
+    } else if (2 == self->chroma_format_idc) {
+        sub_width_c = 2;
+    }
+
+    if (left >= width || right >= width || top >= height || bottom >= height ||
+        (left + right) * sub_width_c >= width ||
+        (top + bottom) * sub_height_c >= height) {
+        goto fail;
+    }
+
+    self->width = width - (left + right) * sub_width_c;
+    self->height = height - (top + bottom) * sub_height_c;
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
+
+static void read_profile_tier_level(
+    SmolRTSP_RbspReader *r, uint8_t max_sub_layers_minus1,
+    SmolRTSP_H265ProfileTierLevel *ptl) {
+    ptl->profile_space = (uint8_t)SmolRTSP_RbspReader_bits(r, 2);
+    ptl->tier_flag = SmolRTSP_RbspReader_bits(r, 1);
+    ptl->profile_idc = (uint8_t)SmolRTSP_RbspReader_bits(r, 5);
+    ptl->profile_compatibility_flags = SmolRTSP_RbspReader_bits(r, 32);
+    // The source and constraint flags.
+    SmolRTSP_RbspReader_skip(r, 48);
+    ptl->level_idc = (uint8_t)SmolRTSP_RbspReader_bits(r, 8);
+
+    bool profile_present[8] = {0}, level_present[8] = {0};
+    for (uint8_t i = 0; i < max_sub_layers_minus1 && i < 8; i++) {
+        profile_present[i] = SmolRTSP_RbspReader_bits(r, 1);
+        level_present[i] = SmolRTSP_RbspReader_bits(r, 1);
+    }
+    if (max_sub_layers_minus1 > 0) {
+        for (uint8_t i = max_sub_layers_minus1; i < 8; i++) {
+            SmolRTSP_RbspReader_skip(r, 2); // reserved_zero_2bits
+        }
+    }
+
+    for (uint8_t i = 0; i < max_sub_layers_minus1 && i < 8; i++) {
+        if (profile_present[i]) {
+            // From `sub_layer_profile_space` to `sub_layer_inbld_flag`.
+            SmolRTSP_RbspReader_skip(r, 88);
+        }
+        if (level_present[i]) {
+            SmolRTSP_RbspReader_skip(r, 8); // sub_layer_level_idc
+        }
+    }
+}
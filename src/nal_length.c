@@ -0,0 +1,235 @@
+#include <smolrtsp/nal_length.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+
+// The fixed part of `AVCDecoderConfigurationRecord` before the SPS count.
+#define AVCC_HEADER_SIZE 5
+
+#ifndef SMOLRTSP_NO_H265
+// The fixed part of `HEVCDecoderConfigurationRecord` before `numOfArrays`.
+#define HVCC_HEADER_SIZE 22
+#endif
+
+static bool read_be(U8Slice99 *restrict data, size_t size, uint32_t *value);
+static bool read_nalu(
+    SmolRTSP_NalCodec codec, U8Slice99 *restrict data, size_t length_size,
+    SmolRTSP_NalUnit *restrict nalu);
+static void push_parameter_set(
+    SmolRTSP_NalExtradata *restrict self, SmolRTSP_NalUnit nalu);
+static int parse_avcc(SmolRTSP_NalExtradata *restrict self, U8Slice99 data);
+#ifndef SMOLRTSP_NO_H265
+static int parse_hvcc(SmolRTSP_NalExtradata *restrict self, U8Slice99 data);
+#endif
+
+SmolRTSP_NalLengthIter SmolRTSP_NalLengthIter_new(
+    SmolRTSP_NalCodec codec, size_t length_size, U8Slice99 data) {
+    assert(1 == length_size || 2 == length_size || 4 == length_size);
+
+    return (SmolRTSP_NalLengthIter){
+        .codec = codec,
+        .length_size = length_size,
+        .data = data,
+    };
+}
+
+int SmolRTSP_NalLengthIter_next(
+    SmolRTSP_NalLengthIter *restrict self, SmolRTSP_NalUnit *restrict nalu) {
+    assert(self);
+    assert(nalu);
+
+    if (U8Slice99_is_empty(self->data)) {
+        return 0;
+    }
+
+    if (!read_nalu(self->codec, &self->data, self->length_size, nalu)) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    return 1;
+}
+
+int SmolRTSP_NalExtradata_parse(
+    SmolRTSP_NalExtradata *restrict self, SmolRTSP_NalCodec codec,
+    U8Slice99 data) {
+    assert(self);
+
+    self->length_size = 0;
+    self->parameter_sets_count = 0;
+
+#ifdef SMOLRTSP_NO_H265
+    if (codec != SmolRTSP_NalCodec_H264) {
+        errno = EINVAL;
+        return -1;
+    }
+    const int ret = parse_avcc(self, data);
+#else
+    const int ret = SmolRTSP_NalCodec_H264 == codec ? parse_avcc(self, data)
+                                                    : parse_hvcc(self, data);
+#endif
+    if (-1 == ret) {
+        errno = EBADMSG;
+    }
+
+    return ret;
+}
+
+static bool read_be(U8Slice99 *restrict data, size_t size, uint32_t *value) {
+    if (data->len < size) {
+        return false;
+    }
+
+    *value = 0;
+    for (size_t i = 0; i < size; i++) {
+        *value = (*value << 8) | data->ptr[i];
+    }
+    *data = U8Slice99_advance(*data, size);
+
+    return true;
+}
+
+static bool read_nalu(
+    SmolRTSP_NalCodec codec, U8Slice99 *restrict data, size_t length_size,
+    SmolRTSP_NalUnit *restrict nalu) {
+    uint32_t len;
+    if (!read_be(data, length_size, &len) || len > data->len ||
+        len < SmolRTSP_NalCodec_header_size(codec)) {
+        return false;
+    }
+
+    *nalu = SmolRTSP_NalUnit_parse(codec, U8Slice99_sub(*data, 0, len));
+    *data = U8Slice99_advance(*data, len);
+
+    return true;
+}
+
+static void push_parameter_set(
+    SmolRTSP_NalExtradata *restrict self, SmolRTSP_NalUnit nalu) {
+    if (self->parameter_sets_count <
+        SMOLRTSP_NAL_EXTRADATA_MAX_PARAMETER_SETS) {
+        self->parameter_sets[self->parameter_sets_count++] = nalu;
+    }
+}
+
+/*
+ * aligned(8) class AVCDecoderConfigurationRecord {
+ *     unsigned int(8) configurationVersion = 1;
+ *     unsigned int(8) AVCProfileIndication;
+ *     unsigned int(8) profile_compatibility;
+ *     unsigned int(8) AVCLevelIndication;
+ *     bit(6) reserved = '111111'b;
+ *     unsigned int(2) lengthSizeMinusOne;
+ *     bit(3) reserved = '111'b;
+ *     unsigned int(5) numOfSequenceParameterSets;
+ *     for (i=0; i< numOfSequenceParameterSets; i++) {
+ *         unsigned int(16) sequenceParameterSetLength ;
+ *         bit(8*sequenceParameterSetLength) sequenceParameterSetNALUnit;
+ *     }
+ *     unsigned int(8) numOfPictureParameterSets;
+ *     for (i=0; i< numOfPictureParameterSets; i++) {
+ *         unsigned int(16) pictureParameterSetLength;
+ *         bit(8*pictureParameterSetLength) pictureParameterSetNALUnit;
+ *     }
+ *     ...
+ * }
+ */
+static int parse_avcc(SmolRTSP_NalExtradata *restrict self, U8Slice99 data) {
+    if (data.len < AVCC_HEADER_SIZE + 1 || data.ptr[0] != 1) {
+        return -1;
+    }
+
+    self->length_size = (data.ptr[4] & 0x03) + 1;
+    if (3 == self->length_size) {
+        return -1;
+    }
+    data = U8Slice99_advance(data, AVCC_HEADER_SIZE);
+
+    uint32_t sps_count;
+    if (!read_be(&data, 1, &sps_count)) {
+        return -1;
+    }
+    sps_count &= 0x1F;
+
+    for (uint32_t i = 0; i < sps_count; i++) {
+        SmolRTSP_NalUnit nalu;
+        if (!read_nalu(SmolRTSP_NalCodec_H264, &data, 2, &nalu)) {
+            return -1;
+        }
+        push_parameter_set(self, nalu);
+    }
+
+    uint32_t pps_count;
+    if (!read_be(&data, 1, &pps_count)) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < pps_count; i++) {
+        SmolRTSP_NalUnit nalu;
+        if (!read_nalu(SmolRTSP_NalCodec_H264, &data, 2, &nalu)) {
+            return -1;
+        }
+        push_parameter_set(self, nalu);
+    }
+
+    // The optional High profile extension (chroma format, bit depth, SPS
+    // extensions) is not needed to send the stream.
+    return 0;
+}
+
+#ifndef SMOLRTSP_NO_H265
+
+/*
+ * aligned(8) class HEVCDecoderConfigurationRecord {
+ *     // 22 bytes of profile, tier, level, and format information; the last
+ *     // one ends with `unsigned int(2) lengthSizeMinusOne`.
+ *     unsigned int(8) numOfArrays;
+ *     for (j=0; j < numOfArrays; j++) {
+ *         bit(1) array_completeness;
+ *         unsigned int(1) reserved = 0;
+ *         unsigned int(6) NAL_unit_type;
+ *         unsigned int(16) numNalus;
+ *         for (i=0; i< numNalus; i++) {
+ *             unsigned int(16) nalUnitLength;
+ *             bit(8*nalUnitLength) nalUnit;
+ *         }
+ *     }
+ * }
+ */
+static int parse_hvcc(SmolRTSP_NalExtradata *restrict self, U8Slice99 data) {
+    if (data.len < HVCC_HEADER_SIZE + 1 || data.ptr[0] != 1) {
+        return -1;
+    }
+
+    self->length_size = (data.ptr[HVCC_HEADER_SIZE - 1] & 0x03) + 1;
+    if (3 == self->length_size) {
+        return -1;
+    }
+    data = U8Slice99_advance(data, HVCC_HEADER_SIZE);
+
+    uint32_t arrays_count;
+    if (!read_be(&data, 1, &arrays_count)) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < arrays_count; i++) {
+        uint32_t unit_type, nalus_count;
+        if (!read_be(&data, 1, &unit_type) ||
+            !read_be(&data, 2, &nalus_count)) {
+            return -1;
+        }
+
+        for (uint32_t j = 0; j < nalus_count; j++) {
+            SmolRTSP_NalUnit nalu;
+            if (!read_nalu(SmolRTSP_NalCodec_H265, &data, 2, &nalu)) {
+                return -1;
+            }
+            push_parameter_set(self, nalu);
+        }
+    }
+
+    return 0;
+}
+
+#endif // SMOLRTSP_NO_H265
@@ -0,0 +1,335 @@
+#include "nal_packetizer.h"
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    HEADER_SINGLE,
+    HEADER_START,
+    HEADER_MIDDLE,
+    HEADER_END,
+};
+
+static uint8_t drop_priority_h265(SmolRTSP_H265NalHeader h);
+
+SmolRTSP_NalHeaderInfo SmolRTSP_NalHeaderInfo_new(SmolRTSP_NalHeader h) {
+    SmolRTSP_NalHeaderInfo info = {0};
+    uint8_t fu_header[NAL_PACKETIZER_MAX_HEADER_SIZE];
+
+    match(h) {
+        of(SmolRTSP_NalHeader_H264, h264) {
+            info.codec = SmolRTSP_NalCodec_H264;
+            info.unit_type = h264->unit_type;
+            info.header_size = SMOLRTSP_H264_NAL_HEADER_SIZE;
+            info.fu_size = SMOLRTSP_H264_FU_HEADER_SIZE;
+            info.is_vps = SmolRTSP_H264NalHeader_is_vps(*h264);
+            info.is_sps = SmolRTSP_H264NalHeader_is_sps(*h264);
+            info.is_pps = SmolRTSP_H264NalHeader_is_pps(*h264);
+            info.is_idr = SmolRTSP_H264NalHeader_is_coded_slice_idr(*h264);
+            info.is_vcl =
+                info.is_idr ||
+                SmolRTSP_H264NalHeader_is_coded_slice_non_idr(*h264);
+            info.drop_priority = h264->unit_type >= 1 &&
+                                 h264->unit_type <= 5 && 0 == h264->ref_idc;
+            info.header[0] = SmolRTSP_H264NalHeader_serialize(*h264);
+            SmolRTSP_H264NalHeader_write_fu_header(
+                *h264, fu_header, false, false);
+        }
+        of(SmolRTSP_NalHeader_H265, h265) {
+            info.codec = SmolRTSP_NalCodec_H265;
+            info.unit_type = h265->unit_type;
+            info.header_size = SMOLRTSP_H265_NAL_HEADER_SIZE;
+            info.fu_size = SMOLRTSP_H265_FU_HEADER_SIZE;
+            info.is_vps = SmolRTSP_H265NalHeader_is_vps(*h265);
+            info.is_sps = SmolRTSP_H265NalHeader_is_sps(*h265);
+            info.is_pps = SmolRTSP_H265NalHeader_is_pps(*h265);
+            info.is_idr = SmolRTSP_H265NalHeader_is_coded_slice_idr(*h265);
+            info.is_vcl =
+                info.is_idr ||
+                SmolRTSP_H265NalHeader_is_coded_slice_non_idr(*h265);
+            info.drop_priority = drop_priority_h265(*h265);
+            const uint16_t repr = SmolRTSP_H265NalHeader_serialize(*h265);
+            memcpy(info.header, &repr, sizeof repr);
+            SmolRTSP_H265NalHeader_write_fu_header(
+                *h265, fu_header, false, false);
+        }
+    }
+
+    // Everything but the last byte of an FU header is the same for all the
+    // fragments.
+    memcpy(info.fu_indicator, fu_header, info.fu_size - 1);
+
+    return info;
+}
+
+static uint8_t drop_priority_h265(SmolRTSP_H265NalHeader h) {
+    // Only VCL NAL unit types are below 32.
+    if (h.unit_type >= 32 || 0 == h.nuh_temporal_id_plus1) {
+        return 0;
+    }
+
+    // `TRAIL_N`, `TSA_N`, ..., `RSV_VCL_N14`: not referenced by pictures of
+    // the same sub-layer.
+    const bool is_sub_layer_non_ref = h.unit_type <= 14 && h.unit_type % 2 == 0;
+    return (uint8_t)(2 * (h.nuh_temporal_id_plus1 - 1) + is_sub_layer_non_ref);
+}
+
+static void write_fu_header(
+    const SmolRTSP_NalHeaderInfo *info, uint8_t buffer[restrict],
+    bool is_first_fragment, bool is_last_fragment) {
+    memcpy(buffer, info->fu_indicator, info->fu_size - 1);
+    buffer[info->fu_size - 1] = smolrtsp_nal_fu_header(
+        is_first_fragment, is_last_fragment, info->unit_type);
+}
+
+void SmolRTSP_NalPacketizer_init(
+    SmolRTSP_NalPacketizer *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, size_t max_packet_size, bool marker) {
+    assert(self);
+    assert(info);
+    assert(max_packet_size > 0);
+
+    const size_t nalu_size = info->header_size + nalu.payload.len;
+
+    self->payload = nalu.payload;
+    self->max_packet_size = max_packet_size;
+    self->next_index = 0;
+    self->is_fragmented = nalu_size >= max_packet_size;
+    self->marker = marker;
+
+    if (!self->is_fragmented) {
+        self->count = 1;
+        self->header_size = info->header_size;
+        memcpy(self->headers[HEADER_SINGLE], info->header, info->header_size);
+        return;
+    }
+
+    // See <https://tools.ietf.org/html/rfc6184#section-5.8> (H.264),
+    // <https://tools.ietf.org/html/rfc7798#section-4.4.3> (H.265).
+    self->header_size = info->fu_size;
+    self->count =
+        nalu.payload.len > max_packet_size
+            ? (nalu.payload.len + max_packet_size - 1) / max_packet_size
+            : 1;
+    write_fu_header(info, self->headers[HEADER_SINGLE], true, true);
+    write_fu_header(info, self->headers[HEADER_START], true, false);
+    write_fu_header(info, self->headers[HEADER_MIDDLE], false, false);
+    write_fu_header(info, self->headers[HEADER_END], false, true);
+}
+
+size_t SmolRTSP_NalPacketizer_count(const SmolRTSP_NalPacketizer *self) {
+    assert(self);
+    return self->count;
+}
+
+SmolRTSP_RtpPacket
+SmolRTSP_NalPacketizer_at(SmolRTSP_NalPacketizer *self, size_t index) {
+    assert(self);
+    assert(index < self->count);
+
+    const bool is_last = self->count - 1 == index;
+
+    if (!self->is_fragmented) {
+        return (SmolRTSP_RtpPacket){
+            .marker = self->marker,
+            .payload_header =
+                U8Slice99_new(self->headers[HEADER_SINGLE], self->header_size),
+            .payload = self->payload,
+        };
+    }
+
+    const bool is_first = 0 == index;
+    const int header_idx = is_first && is_last ? HEADER_SINGLE
+                           : is_first          ? HEADER_START
+                           : is_last           ? HEADER_END
+                                               : HEADER_MIDDLE;
+
+    const size_t start = index * self->max_packet_size,
+                 end = is_last ? self->payload.len
+                               : start + self->max_packet_size;
+
+    return (SmolRTSP_RtpPacket){
+        .marker = is_last && self->marker,
+        .payload_header =
+            U8Slice99_new(self->headers[header_idx], self->header_size),
+        .payload = U8Slice99_sub(self->payload, start, end),
+    };
+}
+
+void SmolRTSP_NalPacketizer_range(
+    SmolRTSP_NalPacketizer *self, size_t first, size_t count,
+    SmolRTSP_RtpPacket packets[restrict static count]) {
+    assert(self);
+    assert(packets);
+    assert(first <= self->count && count <= self->count - first);
+
+    for (size_t i = 0; i < count; i++) {
+        packets[i] = SmolRTSP_NalPacketizer_at(self, first + i);
+    }
+}
+
+size_t SmolRTSP_NalPacketizer_next(
+    SmolRTSP_NalPacketizer *self, size_t max_count,
+    SmolRTSP_RtpPacket packets[restrict static max_count]) {
+    assert(self);
+    assert(packets);
+
+    const size_t left = self->count - self->next_index,
+                 count = left < max_count ? left : max_count;
+
+    SmolRTSP_NalPacketizer_range(self, self->next_index, count, packets);
+    self->next_index += count;
+
+    return count;
+}
+
+// See <https://tools.ietf.org/html/rfc6184#section-5.7.1> (H.264),
+// <https://tools.ietf.org/html/rfc7798#section-4.4.2> (H.265).
+#define H264_STAP_A_UNIT_TYPE 24
+#define H265_AP_UNIT_TYPE     48
+
+// The size field preceding each aggregated NAL unit.
+#define AGGREGATION_SIZE_FIELD 2
+
+int SmolRTSP_NalAggregator_init(
+    SmolRTSP_NalAggregator *self, size_t capacity) {
+    assert(self);
+
+    self->buffer = smolrtsp_malloc(capacity);
+    if (NULL == self->buffer) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->capacity = capacity;
+    self->len = 0;
+    self->count = 0;
+
+    return 0;
+}
+
+void SmolRTSP_NalAggregator_free(SmolRTSP_NalAggregator *self) {
+    assert(self);
+    smolrtsp_free(self->buffer);
+}
+
+bool SmolRTSP_NalAggregator_fits(
+    const SmolRTSP_NalAggregator *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, size_t max_packet_size) {
+    assert(self);
+    assert(info);
+
+    if (self->count > 0 && info->codec != self->codec) {
+        return false;
+    }
+
+    const size_t nalu_size = info->header_size + nalu.payload.len;
+    if (nalu_size > UINT16_MAX) {
+        return false;
+    }
+
+    const size_t len = self->len + AGGREGATION_SIZE_FIELD + nalu_size,
+                 packet_size = info->header_size + len;
+
+    return len <= self->capacity && packet_size <= max_packet_size;
+}
+
+void SmolRTSP_NalAggregator_push(
+    SmolRTSP_NalAggregator *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, bool marker) {
+    assert(self);
+    assert(info);
+
+    const size_t header_size = info->header_size,
+                 nalu_size = header_size + nalu.payload.len;
+    assert(self->len + AGGREGATION_SIZE_FIELD + nalu_size <= self->capacity);
+
+    uint8_t *ptr = self->buffer + self->len;
+    ptr[0] = (uint8_t)(nalu_size >> 8);
+    ptr[1] = (uint8_t)nalu_size;
+    memcpy(ptr + AGGREGATION_SIZE_FIELD, info->header, header_size);
+    if (nalu.payload.len > 0) {
+        memcpy(
+            ptr + AGGREGATION_SIZE_FIELD + header_size, nalu.payload.ptr,
+            nalu.payload.len);
+    }
+    self->len += AGGREGATION_SIZE_FIELD + nalu_size;
+
+    const bool is_first = 0 == self->count++;
+    if (is_first) {
+        self->codec = info->codec;
+        self->forbidden_zero_bit = 0;
+        self->ref_idc = 0;
+        self->nuh_layer_id = UINT8_MAX;
+        self->nuh_temporal_id_plus1 = UINT8_MAX;
+    }
+
+    self->marker = marker;
+
+    // F is the OR of all F bits, NRI is the maximum NRI (H.264), and LayerId
+    // and TID are the lowest ones (H.265). The fields are read back from the
+    // serialized header, which has the same F bit position in both codecs.
+    const uint8_t *h = info->header;
+    self->forbidden_zero_bit |= h[0] >> 7;
+
+    if (SmolRTSP_NalCodec_H264 == info->codec) {
+        const uint8_t ref_idc = (h[0] >> 5) & 0b11;
+        if (ref_idc > self->ref_idc) {
+            self->ref_idc = ref_idc;
+        }
+    } else {
+        const uint8_t nuh_layer_id = ((h[0] & 0b1) << 5) | (h[1] >> 3),
+                      nuh_temporal_id_plus1 = h[1] & 0b111;
+        if (nuh_layer_id < self->nuh_layer_id) {
+            self->nuh_layer_id = nuh_layer_id;
+        }
+        if (nuh_temporal_id_plus1 < self->nuh_temporal_id_plus1) {
+            self->nuh_temporal_id_plus1 = nuh_temporal_id_plus1;
+        }
+    }
+}
+
+SmolRTSP_RtpPacket SmolRTSP_NalAggregator_take(SmolRTSP_NalAggregator *self) {
+    assert(self);
+    assert(self->count > 0);
+
+    const size_t count = self->count, len = self->len;
+    self->count = 0;
+    self->len = 0;
+
+    if (1 == count) {
+        const U8Slice99 nalu = U8Slice99_advance(
+            U8Slice99_new(self->buffer, len), AGGREGATION_SIZE_FIELD);
+        const size_t header_size = SmolRTSP_NalCodec_header_size(self->codec);
+
+        return (SmolRTSP_RtpPacket){
+            .marker = self->marker,
+            .payload_header = U8Slice99_sub(nalu, 0, header_size),
+            .payload = U8Slice99_advance(nalu, header_size),
+        };
+    }
+
+    size_t header_size;
+    if (SmolRTSP_NalCodec_H264 == self->codec) {
+        self->header[0] = (uint8_t)((self->forbidden_zero_bit << 7) |
+                                    (self->ref_idc << 5) |
+                                    H264_STAP_A_UNIT_TYPE);
+        header_size = SMOLRTSP_H264_NAL_HEADER_SIZE;
+    } else {
+        self->header[0] = (uint8_t)((self->forbidden_zero_bit << 7) |
+                                    (H265_AP_UNIT_TYPE << 1) |
+                                    (self->nuh_layer_id >> 5));
+        self->header[1] = (uint8_t)(((self->nuh_layer_id & 0b11111) << 3) |
+                                    self->nuh_temporal_id_plus1);
+        header_size = SMOLRTSP_H265_NAL_HEADER_SIZE;
+    }
+
+    return (SmolRTSP_RtpPacket){
+        .marker = self->marker,
+        .payload_header = U8Slice99_new(self->header, header_size),
+        .payload = U8Slice99_new(self->buffer, len),
+    };
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <smolrtsp/nal.h>
+#include <smolrtsp/rtp_transport.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+// Enough to hold either a NAL header or an FU header of any codec.
+#define NAL_PACKETIZER_MAX_HEADER_SIZE SMOLRTSP_H265_FU_HEADER_SIZE
+
+/*
+ * The properties of a NAL header needed to packetize it, computed with a
+ * single dispatch on the codec. Everything downstream branches on plain
+ * fields instead of matching `SmolRTSP_NalHeader` again and again.
+ */
+typedef struct {
+    SmolRTSP_NalCodec codec;
+    uint8_t unit_type;
+    size_t header_size, fu_size;
+    bool is_vps, is_sps, is_pps, is_idr, is_vcl;
+
+    // How disposable the NAL unit is: 0 for non-VCL NAL units and the
+    // pictures every later one may depend on, 1 for the H.264 non-reference
+    // pictures (`nal_ref_idc == 0`), and `2 * TemporalId + 1` for the H.265
+    // sub-layer non-reference pictures (`2 * TemporalId` for the other
+    // pictures of a sub-layer).
+    uint8_t drop_priority;
+
+    // The serialized NAL header.
+    uint8_t header[SMOLRTSP_H265_NAL_HEADER_SIZE];
+
+    // The FU indicator (H.264) or the FU payload header (H.265), which
+    // precedes the FU header proper.
+    uint8_t fu_indicator[SMOLRTSP_H265_NAL_HEADER_SIZE];
+} SmolRTSP_NalHeaderInfo;
+
+SmolRTSP_NalHeaderInfo SmolRTSP_NalHeaderInfo_new(SmolRTSP_NalHeader h);
+
+/*
+ * Splits a NAL unit into RTP payloads: a single NAL unit packet if it fits
+ * into `max_packet_size`, or a sequence of FU packets otherwise. The RTP marker
+ * is set on the last packet if `marker` is true.
+ *
+ * All the fragments but the last are of `max_packet_size` bytes, so the
+ * number of packets is known up front and every packet is computed from its
+ * index alone: a NAL unit of megabytes can be split in ranges, in any order
+ * (see `SmolRTSP_NalPacketizer_range`).
+ *
+ * The produced packets point into the NAL unit and into the packetizer
+ * itself, so it must outlive them.
+ */
+typedef struct {
+    U8Slice99 payload;
+    size_t max_packet_size;
+    size_t count;
+    size_t next_index;
+    bool is_fragmented;
+    bool marker;
+    size_t header_size;
+
+    // For a single NAL unit packet, only the first buffer is used (the NAL
+    // header).
+    // FU headers differ only in the S/E bits, so these buffers are shared
+    // by all the fragments.
+    uint8_t headers[4][NAL_PACKETIZER_MAX_HEADER_SIZE];
+} SmolRTSP_NalPacketizer;
+
+// `info` must describe the header of `nalu`.
+void SmolRTSP_NalPacketizer_init(
+    SmolRTSP_NalPacketizer *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, size_t max_packet_size, bool marker);
+
+// The number of packets of the NAL unit.
+size_t SmolRTSP_NalPacketizer_count(const SmolRTSP_NalPacketizer *self);
+
+// Returns the packet `index`, which must be less than
+// `SmolRTSP_NalPacketizer_count`.
+//
+// The packet points into `self`, which is not modified, though.
+SmolRTSP_RtpPacket
+SmolRTSP_NalPacketizer_at(SmolRTSP_NalPacketizer *self, size_t index);
+
+// Writes the `count` packets starting at the packet `first` to `packets`;
+// `first + count` must not exceed `SmolRTSP_NalPacketizer_count`.
+//
+// Unlike `SmolRTSP_NalPacketizer_next`, this function does not modify `self`,
+// so disjoint ranges can be filled by several threads at once.
+void SmolRTSP_NalPacketizer_range(
+    SmolRTSP_NalPacketizer *self, size_t first, size_t count,
+    SmolRTSP_RtpPacket packets[restrict static count]);
+
+// Writes at most `max_count` next packets to `packets` and returns how many
+// were written; 0 means the NAL unit has been fully packetized.
+size_t SmolRTSP_NalPacketizer_next(
+    SmolRTSP_NalPacketizer *self, size_t max_count,
+    SmolRTSP_RtpPacket packets[restrict static max_count]);
+
+/*
+ * Accumulates NAL units into an aggregation packet: STAP-A for H.264
+ * (<https://datatracker.ietf.org/doc/html/rfc6184#section-5.7.1>) or AP for
+ * H.265 (<https://datatracker.ietf.org/doc/html/rfc7798#section-4.4.2>).
+ *
+ * The NAL units are copied, so they need not outlive
+ * `SmolRTSP_NalAggregator_push`.
+ */
+typedef struct {
+    // The aggregated NAL units, each preceded by its 16-bit size.
+    uint8_t *buffer;
+    size_t capacity, len, count;
+
+    SmolRTSP_NalCodec codec;
+    bool marker;
+
+    // The fields of the aggregation packet header, combined from the headers
+    // of the aggregated NAL units.
+    uint8_t forbidden_zero_bit, ref_idc, nuh_layer_id, nuh_temporal_id_plus1;
+
+    uint8_t header[NAL_PACKETIZER_MAX_HEADER_SIZE];
+} SmolRTSP_NalAggregator;
+
+// Returns -1 and sets `errno` to `ENOMEM` if the buffer cannot be allocated.
+int SmolRTSP_NalAggregator_init(
+    SmolRTSP_NalAggregator *self, size_t capacity);
+
+void SmolRTSP_NalAggregator_free(SmolRTSP_NalAggregator *self);
+
+// Checks whether `nalu` can be appended without the packet payload exceeding
+// `max_packet_size` bytes.
+bool SmolRTSP_NalAggregator_fits(
+    const SmolRTSP_NalAggregator *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, size_t max_packet_size);
+
+// Appends `nalu`, which must fit. The RTP marker of the resulting packet is
+// that of the last pushed NAL unit.
+void SmolRTSP_NalAggregator_push(
+    SmolRTSP_NalAggregator *self, SmolRTSP_NalUnit nalu,
+    const SmolRTSP_NalHeaderInfo *info, bool marker);
+
+// Makes a packet of the accumulated NAL units, which remains valid until the
+// next push, and empties the aggregator. A single NAL unit is returned as a
+// single NAL unit packet.
+//
+// The aggregator must not be empty.
+SmolRTSP_RtpPacket SmolRTSP_NalAggregator_take(SmolRTSP_NalAggregator *self);
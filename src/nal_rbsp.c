@@ -0,0 +1,338 @@
+#include <smolrtsp/nal_rbsp.h>
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SMOLRTSP_HAS_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define EMULATION_PREVENTION_BYTE 0x03
+
+// Each finder below returns the offset of the first `0x0000XX` in `data` with
+// `min_third <= XX <= 0x03`, or `len` if there is none: `min_third` is 0x03
+// for emulation prevention bytes and 0x00 for the places that need one.
+typedef size_t (*PatternFinder)(
+    const uint8_t *data, size_t len, uint8_t min_third);
+
+static size_t find_scalar(const uint8_t *data, size_t len, uint8_t min_third);
+
+#if defined(__SSE2__)
+static size_t find_sse2(const uint8_t *data, size_t len, uint8_t min_third);
+#endif
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+static size_t find_avx2(const uint8_t *data, size_t len, uint8_t min_third);
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+static size_t find_neon(const uint8_t *data, size_t len, uint8_t min_third);
+#endif
+
+static PatternFinder finder(void);
+static size_t escape(U8Slice99 rbsp, uint8_t *ebsp);
+static bool next_byte(SmolRTSP_RbspReader *self);
+
+size_t smolrtsp_nal_unescape(U8Slice99 ebsp, uint8_t *rbsp) {
+    const PatternFinder find = finder();
+
+    size_t i = 0, len = 0;
+    while (i < ebsp.len) {
+        const size_t p =
+            i + find(ebsp.ptr + i, ebsp.len - i, EMULATION_PREVENTION_BYTE);
+
+        // Keep the two zero bytes, drop the emulation prevention byte.
+        const size_t end = p < ebsp.len ? p + 2 : ebsp.len;
+        memmove(rbsp + len, ebsp.ptr + i, end - i);
+        len += end - i;
+        i = end + 1;
+    }
+
+    return len;
+}
+
+size_t smolrtsp_nal_escaped_size(U8Slice99 rbsp) {
+    return escape(rbsp, NULL);
+}
+
+size_t smolrtsp_nal_escape(U8Slice99 rbsp, uint8_t ebsp[restrict]) {
+    assert(ebsp || 0 == rbsp.len);
+    return escape(rbsp, ebsp);
+}
+
+// Writes to `ebsp` only if it is not `NULL`.
+static size_t escape(U8Slice99 rbsp, uint8_t *ebsp) {
+    const PatternFinder find = finder();
+
+    // Each chunk starts either at the beginning or right after an inserted
+    // emulation prevention byte, so zero bytes never carry over between
+    // chunks, and the first match within a chunk always needs an insertion.
+    size_t i = 0, len = 0;
+    while (i < rbsp.len) {
+        const size_t p = i + find(rbsp.ptr + i, rbsp.len - i, 0x00);
+        const bool found = p < rbsp.len;
+        const size_t end = found ? p + 2 : rbsp.len;
+
+        if (ebsp) {
+            memcpy(ebsp + len, rbsp.ptr + i, end - i);
+        }
+        len += end - i;
+
+        // Trailing zero bytes (`cabac_zero_word`) are followed by an
+        // emulation prevention byte too.
+        const bool trailing_zeros = !found && end - i >= 2 &&
+                                    0x00 == rbsp.ptr[end - 2] &&
+                                    0x00 == rbsp.ptr[end - 1];
+
+        if (found || trailing_zeros) {
+            if (ebsp) {
+                ebsp[len] = EMULATION_PREVENTION_BYTE;
+            }
+            len++;
+        }
+
+        i = end;
+    }
+
+    return len;
+}
+
+SmolRTSP_RbspReader SmolRTSP_RbspReader_new(U8Slice99 ebsp) {
+    return (SmolRTSP_RbspReader){
+        .data = ebsp,
+        .zeros = 0,
+        .byte = 0,
+        .bits_left = 0,
+        .ok = true,
+    };
+}
+
+uint32_t SmolRTSP_RbspReader_bits(SmolRTSP_RbspReader *self, unsigned n) {
+    assert(self);
+    assert(n <= 32);
+
+    uint32_t value = 0;
+    while (n > 0) {
+        if (!self->ok || (0 == self->bits_left && !next_byte(self))) {
+            return 0;
+        }
+
+        const unsigned take = n < self->bits_left ? n : self->bits_left;
+        const unsigned shift = self->bits_left - take;
+
+        value = (value << take) | ((self->byte >> shift) & ((1u << take) - 1));
+        self->bits_left -= take;
+        n -= take;
+    }
+
+    return value;
+}
+
+void SmolRTSP_RbspReader_skip(SmolRTSP_RbspReader *self, size_t n) {
+    assert(self);
+
+    for (; n >= 32; n -= 32) {
+        (void)SmolRTSP_RbspReader_bits(self, 32);
+    }
+    (void)SmolRTSP_RbspReader_bits(self, (unsigned)n);
+}
+
+uint32_t SmolRTSP_RbspReader_ue(SmolRTSP_RbspReader *self) {
+    assert(self);
+
+    unsigned leading_zeros = 0;
+    while (0 == SmolRTSP_RbspReader_bits(self, 1)) {
+        if (!self->ok) {
+            return 0;
+        }
+        if (++leading_zeros > 31) {
+            self->ok = false;
+            return 0;
+        }
+    }
+
+    return ((uint32_t)1 << leading_zeros) - 1 +
+           SmolRTSP_RbspReader_bits(self, leading_zeros);
+}
+
+int32_t SmolRTSP_RbspReader_se(SmolRTSP_RbspReader *self) {
+    assert(self);
+
+    const uint32_t k = SmolRTSP_RbspReader_ue(self);
+
+    // 1, 2, 3, 4, ... map to 1, -1, 2, -2, ...
+    return k % 2 == 1 ? (int32_t)((k + 1) / 2) : -(int32_t)(k / 2);
+}
+
+bool SmolRTSP_RbspReader_is_ok(const SmolRTSP_RbspReader *self) {
+    assert(self);
+    return self->ok;
+}
+
+static bool next_byte(SmolRTSP_RbspReader *self) {
+    for (;;) {
+        if (U8Slice99_is_empty(self->data)) {
+            self->ok = false;
+            return false;
+        }
+
+        const uint8_t byte = self->data.ptr[0];
+        self->data = U8Slice99_advance(self->data, 1);
+
+        if (2 == self->zeros && EMULATION_PREVENTION_BYTE == byte) {
+            self->zeros = 0;
+            continue;
+        }
+
+        self->zeros = 0x00 != byte ? 0 : self->zeros < 2 ? self->zeros + 1 : 2;
+        self->byte = byte;
+        self->bits_left = 8;
+        return true;
+    }
+}
+
+static PatternFinder select_finder(void) {
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        return find_avx2;
+    }
+#endif
+
+#if defined(__SSE2__)
+    return find_sse2;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    return find_neon;
+#else
+    return find_scalar;
+#endif
+}
+
+static PatternFinder finder(void) {
+    // Racing initializations store the same value.
+    static PatternFinder selected = NULL;
+    PatternFinder f = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+    if (NULL == f) {
+        f = select_finder();
+        __atomic_store_n(&selected, f, __ATOMIC_RELAXED);
+    }
+
+    return f;
+}
+
+static size_t find_scalar(const uint8_t *data, size_t len, uint8_t min_third) {
+    size_t i = 0;
+
+    while (i + 2 < len) {
+        if (data[i + 2] > 0x03) {
+            // No pattern can begin at `i`, `i + 1`, or `i + 2`.
+            i += 3;
+        } else if (
+            0x00 == data[i] && 0x00 == data[i + 1] &&
+            data[i + 2] >= min_third) {
+            return i;
+        } else {
+            i++;
+        }
+    }
+
+    return len;
+}
+
+#if defined(__SSE2__)
+
+static size_t find_sse2(const uint8_t *data, size_t len, uint8_t min_third) {
+    const __m128i zero = _mm_setzero_si128(), three = _mm_set1_epi8(0x03),
+                  min = _mm_set1_epi8((char)min_third);
+
+    size_t i = 0;
+    for (; i + 2 + 16 <= len; i += 16) {
+        const __m128i b0 = _mm_loadu_si128((const __m128i *)(data + i)),
+                      b1 = _mm_loadu_si128((const __m128i *)(data + i + 1)),
+                      b2 = _mm_loadu_si128((const __m128i *)(data + i + 2));
+
+        const __m128i in_range = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(b2, three), b2),
+            _mm_cmpeq_epi8(_mm_max_epu8(b2, min), b2));
+
+        const __m128i matches = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+            in_range);
+
+        const unsigned mask = (unsigned)_mm_movemask_epi8(matches);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + find_scalar(data + i, len - i, min_third);
+}
+
+#endif // defined(__SSE2__)
+
+#ifdef SMOLRTSP_HAS_AVX2_DISPATCH
+
+__attribute__((target("avx2"))) static size_t
+find_avx2(const uint8_t *data, size_t len, uint8_t min_third) {
+    const __m256i zero = _mm256_setzero_si256(),
+                  three = _mm256_set1_epi8(0x03),
+                  min = _mm256_set1_epi8((char)min_third);
+
+    size_t i = 0;
+    for (; i + 2 + 32 <= len; i += 32) {
+        const __m256i b0 = _mm256_loadu_si256((const __m256i *)(data + i)),
+                      b1 = _mm256_loadu_si256((const __m256i *)(data + i + 1)),
+                      b2 = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+
+        const __m256i in_range = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(b2, three), b2),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(b2, min), b2));
+
+        const __m256i matches = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+            in_range);
+
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(matches);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + find_scalar(data + i, len - i, min_third);
+}
+
+#endif // SMOLRTSP_HAS_AVX2_DISPATCH
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+static size_t find_neon(const uint8_t *data, size_t len, uint8_t min_third) {
+    const uint8x16_t zero = vdupq_n_u8(0), three = vdupq_n_u8(0x03),
+                     min = vdupq_n_u8(min_third);
+
+    size_t i = 0;
+    for (; i + 2 + 16 <= len; i += 16) {
+        const uint8x16_t b0 = vld1q_u8(data + i), b1 = vld1q_u8(data + i + 1),
+                         b2 = vld1q_u8(data + i + 2);
+
+        const uint8x16_t matches = vandq_u8(
+            vandq_u8(vceqq_u8(b0, zero), vceqq_u8(b1, zero)),
+            vandq_u8(vcleq_u8(b2, three), vcgeq_u8(b2, min)));
+
+        if (vmaxvq_u8(matches) != 0) {
+            return i + find_scalar(data + i, 18, min_third);
+        }
+    }
+
+    return i + find_scalar(data + i, len - i, min_third);
+}
+
+#endif // defined(__aarch64__) && defined(__ARM_NEON)
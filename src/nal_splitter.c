@@ -0,0 +1,286 @@
+#include <smolrtsp/nal_splitter.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SmolRTSP_NalSplitter {
+    SmolRTSP_NalCodec codec;
+
+    // The unscanned part of the current chunk.
+    U8Slice99 chunk;
+
+    // Whether a start code has been seen, i.e., we are inside a NAL unit.
+    bool in_nalu;
+
+    // The beginning of the current NAL unit within the current chunk, or
+    // `NULL` if the beginning is in `buffer`.
+    const uint8_t *nalu_start;
+
+    // The bytes of a NAL unit that spans several chunks. Before the first start
+    // code, it holds up to two last bytes of the stream instead, in case a
+    // start code straddles the chunk boundary.
+    uint8_t *buffer;
+    size_t buffer_len, buffer_capacity;
+
+    // Whether `buffer` holds a NAL unit that has been returned to the user.
+    bool buffer_emitted;
+};
+
+static void reclaim_buffer(SmolRTSP_NalSplitter *self);
+static int append(SmolRTSP_NalSplitter *self, U8Slice99 data);
+static void discard_nalu(SmolRTSP_NalSplitter *self);
+static size_t start_code_len(U8Slice99 data);
+static size_t straddling_start_code(const SmolRTSP_NalSplitter *self);
+static bool make_nalu(
+    const SmolRTSP_NalSplitter *self, U8Slice99 data,
+    SmolRTSP_NalUnit *restrict nalu);
+
+SmolRTSP_NalSplitter *SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec codec) {
+    SmolRTSP_NalSplitter *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->codec = codec;
+    self->chunk = U8Slice99_empty();
+    self->in_nalu = false;
+    self->nalu_start = NULL;
+    self->buffer = NULL;
+    self->buffer_len = 0;
+    self->buffer_capacity = 0;
+    self->buffer_emitted = false;
+
+    return self;
+}
+
+static void SmolRTSP_NalSplitter_drop(VSelf) {
+    VSELF(SmolRTSP_NalSplitter);
+    assert(self);
+
+    smolrtsp_free(self->buffer);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_NalSplitter);
+
+void SmolRTSP_NalSplitter_feed(SmolRTSP_NalSplitter *self, U8Slice99 chunk) {
+    assert(self);
+    assert(U8Slice99_is_empty(self->chunk));
+    assert(NULL == self->nalu_start);
+
+    reclaim_buffer(self);
+    self->chunk = chunk;
+}
+
+int SmolRTSP_NalSplitter_next(
+    SmolRTSP_NalSplitter *self, SmolRTSP_NalUnit *restrict nalu) {
+    assert(self);
+    assert(nalu);
+
+    reclaim_buffer(self);
+
+    for (;;) {
+        if (self->nalu_start != NULL) {
+            // The current NAL unit begins in this chunk, so it can be returned
+            // without copying if it also ends here.
+            const size_t offset = smolrtsp_find_next_start_code(self->chunk);
+            if (offset == self->chunk.len) {
+                const int ret = append(
+                    self, U8Slice99_from_ptrdiff(
+                              (uint8_t *)self->nalu_start,
+                              self->chunk.ptr + self->chunk.len));
+                self->chunk = U8Slice99_advance(self->chunk, offset);
+                self->nalu_start = NULL;
+                if (-1 == ret) {
+                    discard_nalu(self);
+                }
+                return ret;
+            }
+
+            const U8Slice99 data = U8Slice99_from_ptrdiff(
+                (uint8_t *)self->nalu_start, self->chunk.ptr + offset);
+            self->chunk = U8Slice99_advance(self->chunk, offset);
+            self->chunk = U8Slice99_advance(
+                self->chunk, start_code_len(self->chunk));
+            self->nalu_start = self->chunk.ptr;
+
+            if (make_nalu(self, data, nalu)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (U8Slice99_is_empty(self->chunk)) {
+            return 0;
+        }
+
+        // The current NAL unit (if any) begins in `buffer`.
+        size_t nalu_len = self->buffer_len, consumed = 0;
+        int ret = 0;
+        const size_t straddling = straddling_start_code(self);
+        if (straddling > 0) {
+            nalu_len -= 3 - straddling;
+            consumed = straddling;
+        } else {
+            const size_t offset = smolrtsp_find_next_start_code(self->chunk);
+            if (offset == self->chunk.len) {
+                if (self->in_nalu) {
+                    ret = append(self, self->chunk);
+                } else {
+                    // Keep the last bytes that can start a start code.
+                    const size_t keep =
+                        self->chunk.len < 2 ? self->chunk.len : 2;
+                    ret = append(
+                        self, U8Slice99_advance(
+                                  self->chunk, self->chunk.len - keep));
+                    if (self->buffer_len > 2) {
+                        memmove(
+                            self->buffer,
+                            self->buffer + self->buffer_len - 2, 2);
+                        self->buffer_len = 2;
+                    }
+                }
+                self->chunk = U8Slice99_advance(self->chunk, offset);
+                if (-1 == ret) {
+                    discard_nalu(self);
+                }
+                return ret;
+            }
+
+            if (self->in_nalu) {
+                ret = append(self, U8Slice99_sub(self->chunk, 0, offset));
+                nalu_len = self->buffer_len;
+            }
+            consumed = offset + start_code_len(U8Slice99_advance(
+                                    self->chunk, offset));
+        }
+
+        self->chunk = U8Slice99_advance(self->chunk, consumed);
+        self->nalu_start = self->chunk.ptr;
+
+        const bool was_in_nalu = self->in_nalu;
+        self->in_nalu = true;
+        if (!was_in_nalu) {
+            self->buffer_len = 0;
+            continue;
+        }
+
+        // The NAL unit that has not fit into the buffer is lost, but the next
+        // one has just begun.
+        if (-1 == ret) {
+            self->buffer_len = 0;
+            return -1;
+        }
+
+        self->buffer_emitted = true;
+        if (make_nalu(self, U8Slice99_new(self->buffer, nalu_len), nalu)) {
+            return 1;
+        }
+        reclaim_buffer(self);
+    }
+}
+
+bool SmolRTSP_NalSplitter_finish(
+    SmolRTSP_NalSplitter *self, SmolRTSP_NalUnit *restrict nalu) {
+    assert(self);
+    assert(nalu);
+    assert(U8Slice99_is_empty(self->chunk));
+    assert(NULL == self->nalu_start);
+
+    reclaim_buffer(self);
+
+    const bool was_in_nalu = self->in_nalu;
+    self->in_nalu = false;
+
+    if (!was_in_nalu) {
+        self->buffer_len = 0;
+        return false;
+    }
+
+    self->buffer_emitted = true;
+    return make_nalu(self, U8Slice99_new(self->buffer, self->buffer_len), nalu);
+}
+
+static void reclaim_buffer(SmolRTSP_NalSplitter *self) {
+    if (self->buffer_emitted) {
+        self->buffer_len = 0;
+        self->buffer_emitted = false;
+    }
+}
+
+static int append(SmolRTSP_NalSplitter *self, U8Slice99 data) {
+    if (U8Slice99_is_empty(data)) {
+        return 0;
+    }
+
+    if (self->buffer_len + data.len > self->buffer_capacity) {
+        size_t capacity = 0 == self->buffer_capacity ? 4096
+                                                     : self->buffer_capacity;
+        while (capacity < self->buffer_len + data.len) {
+            capacity *= 2;
+        }
+
+        uint8_t *buffer = smolrtsp_realloc(self->buffer, capacity);
+        if (NULL == buffer) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->buffer = buffer;
+        self->buffer_capacity = capacity;
+    }
+
+    memcpy(self->buffer + self->buffer_len, data.ptr, data.len);
+    self->buffer_len += data.len;
+    return 0;
+}
+
+// Skips the rest of the current NAL unit, up to the next start code.
+static void discard_nalu(SmolRTSP_NalSplitter *self) {
+    self->in_nalu = false;
+    self->buffer_len = 0;
+    self->buffer_emitted = false;
+}
+
+// `data` starts with a start code found by `smolrtsp_find_next_start_code`.
+static size_t start_code_len(U8Slice99 data) {
+    return smolrtsp_test_start_code_4b(data) > 0 ? 4 : 3;
+}
+
+// Returns the number of bytes of a `0x000001` start code that begins in
+// `buffer` and ends in `chunk` (1 or 2), or 0 if there is no such start code.
+static size_t straddling_start_code(const SmolRTSP_NalSplitter *self) {
+    const uint8_t *b = self->buffer;
+    const size_t n = self->buffer_len;
+    const U8Slice99 c = self->chunk;
+
+    if (n >= 2 && 0x00 == b[n - 2] && 0x00 == b[n - 1] && 0x01 == c.ptr[0]) {
+        return 1;
+    }
+
+    if (n >= 1 && 0x00 == b[n - 1] && c.len >= 2 && 0x00 == c.ptr[0] &&
+        0x01 == c.ptr[1]) {
+        return 2;
+    }
+
+    return 0;
+}
+
+static bool make_nalu(
+    const SmolRTSP_NalSplitter *self, U8Slice99 data,
+    SmolRTSP_NalUnit *restrict nalu) {
+    while (data.len > 0 && 0x00 == data.ptr[data.len - 1]) {
+        data.len--;
+    }
+
+    if (data.len < SmolRTSP_NalCodec_header_size(self->codec)) {
+        return false;
+    }
+
+    *nalu = SmolRTSP_NalUnit_parse(self->codec, data);
+    return true;
+}
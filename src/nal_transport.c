@@ -1,32 +1,130 @@
 #include <smolrtsp/nal_transport.h>
 
+#include "alloc.h"
+#include "nal_packetizer.h"
+#include "probes.h"
+#include "rtp_transport.h"
+
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
-#include <alloca.h>
+#include <time.h>
 
 #include <slice99.h>
 
-static int send_fragmentized_nal_data(
-    SmolRTSP_RtpTransport *t, SmolRTSP_RtpTimestamp ts, size_t max_packet_size,
-    SmolRTSP_NalUnit nalu);
-static int send_fu(
-    SmolRTSP_RtpTransport *t, SmolRTSP_RtpTimestamp ts, SmolRTSP_NalUnit fu,
-    bool is_first_fragment, bool is_last_fragment);
+// The number of packets handed to `SmolRTSP_RtpTransport_send_batch` at once.
+#define PACKETS_BATCH_SIZE 64
+
+// The counters are written by the sending thread only but can be read by any.
+#define COUNT(counter, n) __atomic_fetch_add(&(counter), (n), __ATOMIC_RELAXED)
 
 SmolRTSP_NalTransportConfig SmolRTSP_NalTransportConfig_default(void) {
     return (SmolRTSP_NalTransportConfig){
         .max_h264_nalu_size = SMOLRTSP_MAX_H264_NALU_SIZE,
-        .max_h265_nalu_size = SMOLRTSP_MAX_H264_NALU_SIZE,
+        .max_h265_nalu_size = SMOLRTSP_MAX_H265_NALU_SIZE,
+        .backpressure_policy = SmolRTSP_BackpressurePolicy_Block,
+        .aggregation = false,
+        .latency = NULL,
+        .clock_us = NULL,
     };
 }
 
+// A NAL unit of `SmolRTSP_NalTransport_send_access_unit`.
+typedef struct {
+    SmolRTSP_NalHeaderInfo info;
+    bool dropped;
+    size_t max_packet_size;
+
+    // The packets of the NAL unit point into `packetizer`; `packets_count`
+    // is 0 if the NAL unit is aggregated.
+    SmolRTSP_NalPacketizer packetizer;
+    size_t packets_count;
+} AccessUnitNalu;
+
 struct SmolRTSP_NalTransport {
     SmolRTSP_RtpTransport *transport;
     SmolRTSP_NalTransportConfig config;
+    SmolRTSP_NalTransportStats stats;
+
+    // Whether `SmolRTSP_BackpressurePolicy_DropUntilIdr` waits for an IDR.
+    bool waiting_for_idr;
+
+    // The timestamp of the last dropped NAL unit, if `has_dropped`.
+    bool has_dropped;
+    SmolRTSP_RtpTimestamp dropped_ts;
+
+    // The state of `SmolRTSP_BackpressurePolicy_Thin`: the highest drop
+    // priority seen, and the timestamp of the access unit for which the
+    // thinning level (`stats.thinning_level`) was last decided.
+    uint8_t max_drop_priority;
+    bool has_thinning_ts;
+    SmolRTSP_RtpTimestamp thinning_ts;
+    size_t calm_access_units;
+
+    // The NAL units held back for `config.aggregation`, all of `aggregate_ts`.
+    SmolRTSP_NalAggregator aggregator;
+    SmolRTSP_RtpTimestamp aggregate_ts;
+
+    SmolRTSP_ParamSetCache *param_sets;
+
+    // The storage of `SmolRTSP_NalTransport_send_access_unit`, reused from
+    // one access unit to the next: its NAL units, its packets, and the index
+    // of the NAL unit of every packet (the first one, if aggregated).
+    AccessUnitNalu *au_nalus;
+    size_t au_nalus_capacity;
+    SmolRTSP_RtpPacket *au_packets;
+    size_t *au_packet_nalus;
+    size_t au_packets_capacity;
 };
 
+static bool should_drop(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalHeaderInfo *info);
+static bool should_thin(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalHeaderInfo *info);
+static uint64_t timestamp_value(SmolRTSP_RtpTimestamp ts);
+static bool timestamp_eq(SmolRTSP_RtpTimestamp a, SmolRTSP_RtpTimestamp b);
+static void count_dropped(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info);
+static int send_unit(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker);
+static int send_au_nalus(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t from, size_t to, bool end_of_au,
+    bool may_retry);
+static int submit_au_packets(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t len, size_t to, bool end_of_au,
+    bool may_retry);
+static void
+probe_au_nalus_end(const SmolRTSP_NalTransport *self, size_t n, int ret);
+static void push_au_aggregate(SmolRTSP_NalTransport *self, size_t *len);
+static int reserve_au_nalus(SmolRTSP_NalTransport *self, size_t n);
+static int reserve_au_packets(SmolRTSP_NalTransport *self, size_t n);
+static int send_aggregated(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size);
+static int send_nalu(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size);
+static int send_fragments(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size);
+static size_t packet_budget(
+    SmolRTSP_NalTransport *self, const SmolRTSP_NalHeaderInfo *info);
+static uint64_t now_us(const SmolRTSP_NalTransport *self);
+static int init(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTransport *t,
+    SmolRTSP_NalTransportConfig config);
+
 SmolRTSP_NalTransport *SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport *t) {
     assert(t);
 
@@ -38,13 +136,83 @@ SmolRTSP_NalTransport *SmolRTSP_NalTransport_new_with_config(
     SmolRTSP_RtpTransport *t, SmolRTSP_NalTransportConfig config) {
     assert(t);
 
-    SmolRTSP_NalTransport *self = malloc(sizeof *self);
-    assert(self);
+    SmolRTSP_NalTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (init(self, t, config) == -1) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return self;
+}
+
+SmolRTSP_NalTransport *SmolRTSP_NalTransport_new_udp(
+    int fd, SmolRTSP_UdpTransportConfig udp_config, uint8_t payload_ty,
+    uint32_t clock_rate, SmolRTSP_NalTransportConfig config) {
+    assert(fd >= 0);
+
+    // The RTP and UDP transports follow in the same allocation and are freed
+    // with it.
+    const size_t rtp_offset =
+        SMOLRTSP_ALLOC_ALIGN(sizeof(SmolRTSP_NalTransport));
+    SmolRTSP_NalTransport *self =
+        smolrtsp_malloc(rtp_offset + smolrtsp_rtp_transport_udp_size());
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    SmolRTSP_RtpTransport *t = smolrtsp_rtp_transport_init_udp(
+        (uint8_t *)self + rtp_offset, fd, udp_config, payload_ty, clock_rate);
+    if (init(self, t, config) == -1) {
+        VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return self;
+}
 
+static int init(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTransport *t,
+    SmolRTSP_NalTransportConfig config) {
     self->transport = t;
     self->config = config;
+    self->stats = (SmolRTSP_NalTransportStats){0};
+    self->waiting_for_idr = false;
+    self->has_dropped = false;
+    self->dropped_ts = SmolRTSP_RtpTimestamp_Raw(0);
+    self->max_drop_priority = 0;
+    self->has_thinning_ts = false;
+    self->thinning_ts = SmolRTSP_RtpTimestamp_Raw(0);
+    self->calm_access_units = 0;
+    self->aggregate_ts = SmolRTSP_RtpTimestamp_Raw(0);
+    self->au_nalus = NULL;
+    self->au_nalus_capacity = 0;
+    self->au_packets = NULL;
+    self->au_packet_nalus = NULL;
+    self->au_packets_capacity = 0;
+    self->param_sets = SmolRTSP_ParamSetCache_new();
+    if (NULL == self->param_sets) {
+        return -1;
+    }
 
-    return self;
+    if (config.aggregation &&
+        SmolRTSP_NalAggregator_init(
+            &self->aggregator,
+            config.max_h264_nalu_size > config.max_h265_nalu_size
+                ? config.max_h264_nalu_size
+                : config.max_h265_nalu_size) == -1) {
+        VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable)
+            .drop(self->param_sets);
+        return -1;
+    }
+
+    return 0;
 }
 
 static void SmolRTSP_NalTransport_drop(VSelf) {
@@ -53,7 +221,14 @@ static void SmolRTSP_NalTransport_drop(VSelf) {
 
     VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(self->transport);
 
-    free(self);
+    if (self->config.aggregation) {
+        SmolRTSP_NalAggregator_free(&self->aggregator);
+    }
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(self->param_sets);
+    smolrtsp_free(self->au_nalus);
+    smolrtsp_free(self->au_packets);
+    smolrtsp_free(self->au_packet_nalus);
+    smolrtsp_free(self);
 }
 
 implExtern(SmolRTSP_Droppable, SmolRTSP_NalTransport);
@@ -62,85 +237,575 @@ bool SmolRTSP_NalTransport_is_full(SmolRTSP_NalTransport *self) {
     return SmolRTSP_RtpTransport_is_full(self->transport);
 }
 
+SmolRTSP_NalTransportStats
+SmolRTSP_NalTransport_stats(const SmolRTSP_NalTransport *self) {
+    assert(self);
+
+#define LOAD(field)                                                            \
+    .field = __atomic_load_n(&self->stats.field, __ATOMIC_RELAXED)
+    return (SmolRTSP_NalTransportStats){
+        LOAD(nalus),
+        LOAD(fragmented_nalus),
+        LOAD(fragments),
+        LOAD(emsgsize_retries),
+        LOAD(errors),
+        LOAD(dropped_nalus),
+        LOAD(dropped_bytes),
+        LOAD(dropped_access_units),
+        LOAD(thinning_level),
+        .rtp = SmolRTSP_RtpTransport_stats(self->transport),
+    };
+#undef LOAD
+}
+
+const SmolRTSP_ParamSetCache *
+SmolRTSP_NalTransport_param_sets(const SmolRTSP_NalTransport *self) {
+    assert(self);
+    return self->param_sets;
+}
+
 int SmolRTSP_NalTransport_send_packet(
     SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
     SmolRTSP_NalUnit nalu) {
     assert(self);
 
-    const size_t max_packet_size = MATCHES(nalu.header, SmolRTSP_NalHeader_H264)
-                                       ? self->config.max_h264_nalu_size
-                                       : self->config.max_h265_nalu_size,
-                 nalu_size =
-                     SmolRTSP_NalHeader_size(nalu.header) + nalu.payload.len;
+    // Dispatch on the codec once; everything below works on plain fields.
+    const SmolRTSP_NalHeaderInfo info = SmolRTSP_NalHeaderInfo_new(nalu.header);
+
+    // Without access unit boundaries, every coded slice is assumed to be the
+    // last one of its picture.
+    return send_unit(self, ts, nalu, &info, info.is_vcl);
+}
+
+int SmolRTSP_NalTransport_send_au_packet(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, bool end_of_access_unit) {
+    assert(self);
+
+    const SmolRTSP_NalHeaderInfo info = SmolRTSP_NalHeaderInfo_new(nalu.header);
 
-    if (nalu_size < max_packet_size) {
-        const bool marker =
-            SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header) ||
-            SmolRTSP_NalHeader_is_coded_slice_non_idr(nalu.header);
+    return send_unit(self, ts, nalu, &info, end_of_access_unit);
+}
+
+static int send_unit(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker) {
+    SMOLRTSP_PROBE(
+        nalu_send_start, info->unit_type, info->header_size + nalu.payload.len,
+        timestamp_value(ts));
+
+    if (SmolRTSP_ParamSetCache_update(self->param_sets, nalu) == -1) {
+        COUNT(self->stats.errors, 1);
+        SMOLRTSP_PROBE(nalu_send_end, -1);
+        return -1;
+    }
+
+    if (should_drop(self, ts, info)) {
+        count_dropped(self, ts, nalu, info);
+        SMOLRTSP_PROBE(nalu_send_end, 1);
+        return 0;
+    }
 
-        const size_t header_buf_size = SmolRTSP_NalHeader_size(nalu.header);
-        uint8_t *header_buf = alloca(header_buf_size);
-        SmolRTSP_NalHeader_serialize(nalu.header, header_buf);
+    const uint64_t start_us = self->config.latency != NULL ? now_us(self) : 0;
+    const size_t max_packet_size = packet_budget(self, info);
+
+    const int ret =
+        self->config.aggregation
+            ? send_aggregated(self, ts, nalu, info, marker, max_packet_size)
+            : send_nalu(self, ts, nalu, info, marker, max_packet_size);
+    SMOLRTSP_PROBE(nalu_send_end, ret);
+    if (-1 == ret) {
+        COUNT(self->stats.errors, 1);
+        return -1;
+    }
+
+    COUNT(self->stats.nalus, 1);
 
-        return SmolRTSP_RtpTransport_send_packet(
-            self->transport, ts, marker,
-            U8Slice99_new(header_buf, header_buf_size), nalu.payload);
+    // A NAL unit held back for aggregation has not been sent yet.
+    const bool is_held =
+        self->config.aggregation && self->aggregator.count > 0;
+    if (self->config.latency != NULL && !is_held) {
+        SmolRTSP_LatencyHistogram_record(
+            self->config.latency, now_us(self) - start_us);
     }
 
-    return send_fragmentized_nal_data(
-        self->transport, ts, max_packet_size, nalu);
+    return 0;
 }
 
-// See <https://tools.ietf.org/html/rfc6184#section-5.8> (H.264),
-// <https://tools.ietf.org/html/rfc7798#section-4.4.3> (H.265).
-static int send_fragmentized_nal_data(
-    SmolRTSP_RtpTransport *t, SmolRTSP_RtpTimestamp ts, size_t max_packet_size,
-    SmolRTSP_NalUnit nalu) {
-    const size_t rem = nalu.payload.len % max_packet_size,
-                 packets_count = (nalu.payload.len - rem) / max_packet_size;
+static void count_dropped(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info) {
+    if (!self->has_dropped || !timestamp_eq(self->dropped_ts, ts)) {
+        COUNT(self->stats.dropped_access_units, 1);
+    }
+    COUNT(self->stats.dropped_nalus, 1);
+    COUNT(self->stats.dropped_bytes, info->header_size + nalu.payload.len);
+    self->has_dropped = true;
+    self->dropped_ts = ts;
+}
+
+int SmolRTSP_NalTransport_send_access_unit(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t n) {
+    assert(self);
+    assert(nalus != NULL || 0 == n);
+
+    // The NAL units held back by `SmolRTSP_NalTransport_send_au_packet`
+    // precede this access unit.
+    if (SmolRTSP_NalTransport_flush(self) == -1 ||
+        reserve_au_nalus(self, n) == -1) {
+        COUNT(self->stats.errors, 1);
+        return -1;
+    }
+
+    const uint64_t start_us = self->config.latency != NULL ? now_us(self) : 0;
+
+    // The NAL units are sent in one batch, so all their `nalu_send_start`
+    // probes fire before their `nalu_send_end` probes.
+    for (size_t i = 0; i < n; i++) {
+        AccessUnitNalu *unit = &self->au_nalus[i];
+        unit->info = SmolRTSP_NalHeaderInfo_new(nalus[i].header);
+        SMOLRTSP_PROBE(
+            nalu_send_start, unit->info.unit_type,
+            unit->info.header_size + nalus[i].payload.len,
+            timestamp_value(ts));
+
+        if (SmolRTSP_ParamSetCache_update(self->param_sets, nalus[i]) == -1) {
+            COUNT(self->stats.errors, 1);
+            probe_au_nalus_end(self, i, -1);
+            SMOLRTSP_PROBE(nalu_send_end, -1);
+            return -1;
+        }
+
+        unit->dropped = should_drop(self, ts, &unit->info);
+        if (unit->dropped) {
+            count_dropped(self, ts, nalus[i], &unit->info);
+            SMOLRTSP_PROBE(nalu_send_end, 1);
+        }
+    }
 
-    for (size_t packet_idx = 0; packet_idx < packets_count; packet_idx++) {
-        const bool is_first_fragment = 0 == packet_idx,
-                   is_last_fragment =
-                       0 == rem && (packets_count - 1 == packet_idx);
+    const int ret = send_au_nalus(self, ts, nalus, 0, n, true, true);
+    probe_au_nalus_end(self, n, ret);
+    if (-1 == ret) {
+        COUNT(self->stats.errors, 1);
+        return -1;
+    }
+
+    const uint64_t latency_us =
+        self->config.latency != NULL ? now_us(self) - start_us : 0;
+    for (size_t i = 0; i < n; i++) {
+        const AccessUnitNalu *unit = &self->au_nalus[i];
+        if (unit->dropped) {
+            continue;
+        }
+
+        COUNT(self->stats.nalus, 1);
+        if (unit->packets_count > 1) {
+            COUNT(self->stats.fragmented_nalus, 1);
+            COUNT(self->stats.fragments, unit->packets_count);
+        }
+        if (self->config.latency != NULL) {
+            SmolRTSP_LatencyHistogram_record(self->config.latency, latency_us);
+        }
+    }
 
-        const U8Slice99 fu_data = U8Slice99_sub(
-            nalu.payload, packet_idx * max_packet_size,
-            is_last_fragment ? nalu.payload.len
-                             : (packet_idx + 1) * max_packet_size);
-        const SmolRTSP_NalUnit fu = {nalu.header, fu_data};
+    return 0;
+}
 
-        if (send_fu(t, ts, fu, is_first_fragment, is_last_fragment) == -1) {
+// Fires the `nalu_send_end` probes of the first `n` NAL units of the access
+// unit that are not dropped (which have fired theirs already).
+static void
+probe_au_nalus_end(const SmolRTSP_NalTransport *self, size_t n, int ret) {
+    for (size_t i = 0; SMOLRTSP_PROBES_ENABLED && i < n; i++) {
+        if (!self->au_nalus[i].dropped) {
+            SMOLRTSP_PROBE(nalu_send_end, ret);
+        }
+    }
+    (void)ret;
+}
+
+// Packetizes the NAL units `from..to` of the access unit into
+// `self->au_packets` and submits them as a batch. The aggregator holds one
+// aggregation packet at a time, so the packets are also submitted before it
+// is reused; only the last packet of the access unit carries the marker.
+static int send_au_nalus(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t from, size_t to, bool end_of_au,
+    bool may_retry) {
+    SmolRTSP_NalAggregator *aggregator = &self->aggregator;
+    const bool aggregation = self->config.aggregation;
+    size_t len = 0;
+    bool has_aggregate = false;
+
+    for (size_t i = from; i < to; i++) {
+        AccessUnitNalu *unit = &self->au_nalus[i];
+        if (unit->dropped) {
+            continue;
+        }
+        unit->max_packet_size = packet_budget(self, &unit->info);
+        unit->packets_count = 0;
+
+        if (aggregation && aggregator->count > 0 &&
+            !SmolRTSP_NalAggregator_fits(
+                aggregator, nalus[i], &unit->info, unit->max_packet_size)) {
+            push_au_aggregate(self, &len);
+            has_aggregate = true;
+        }
+
+        if (aggregation &&
+            SmolRTSP_NalAggregator_fits(
+                aggregator, nalus[i], &unit->info, unit->max_packet_size)) {
+            if (0 == aggregator->count) {
+                if (has_aggregate) {
+                    if (submit_au_packets(
+                            self, ts, nalus, len, i, false, may_retry) == -1) {
+                        return -1;
+                    }
+                    len = 0;
+                    has_aggregate = false;
+                }
+                if (reserve_au_packets(self, len + 1) == -1) {
+                    return -1;
+                }
+                self->au_packet_nalus[len] = i;
+            }
+
+            SmolRTSP_NalAggregator_push(
+                aggregator, nalus[i], &unit->info, false);
+            if (unit->info.is_vcl) {
+                push_au_aggregate(self, &len);
+                has_aggregate = true;
+            }
+            continue;
+        }
+
+        SmolRTSP_NalPacketizer_init(
+            &unit->packetizer, nalus[i], &unit->info, unit->max_packet_size,
+            false);
+        const size_t count = SmolRTSP_NalPacketizer_count(&unit->packetizer);
+        if (reserve_au_packets(self, len + count) == -1) {
             return -1;
         }
+        SmolRTSP_NalPacketizer_range(
+            &unit->packetizer, 0, count, &self->au_packets[len]);
+        for (size_t j = 0; j < count; j++) {
+            self->au_packet_nalus[len++] = i;
+        }
+        unit->packets_count = count;
     }
 
-    if (rem != 0) {
-        const U8Slice99 fu_data =
-            U8Slice99_advance(nalu.payload, packets_count * max_packet_size);
-        const SmolRTSP_NalUnit fu = {nalu.header, fu_data};
-        const bool is_first_fragment = 0 == packets_count,
-                   is_last_fragment = true;
+    if (aggregation && aggregator->count > 0) {
+        push_au_aggregate(self, &len);
+    }
+    if (0 == len) {
+        return 0;
+    }
 
-        if (send_fu(t, ts, fu, is_first_fragment, is_last_fragment) == -1) {
+    self->au_packets[len - 1].marker = end_of_au;
+    return submit_au_packets(self, ts, nalus, len, to, end_of_au, may_retry);
+}
+
+static int submit_au_packets(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit nalus[], size_t len, size_t to, bool end_of_au,
+    bool may_retry) {
+    size_t sent;
+    if (smolrtsp_rtp_transport_send_counted(
+            self->transport, ts,
+            SmolRTSP_RtpPacketSlice_new(self->au_packets, len), &sent) == 0) {
+        return 0;
+    }
+
+    // The path MTU has shrunk below our packets, as in `send_nalu`: resend
+    // the rest of the batch once with the new budget, starting from the NAL
+    // unit whose first packet did not get through.
+    if (EMSGSIZE == errno && may_retry && sent < len) {
+        const size_t i = self->au_packet_nalus[sent];
+        const bool is_first =
+            0 == sent || self->au_packet_nalus[sent - 1] != i;
+        const AccessUnitNalu *unit = &self->au_nalus[i];
+        if (is_first &&
+            packet_budget(self, &unit->info) < unit->max_packet_size) {
+            COUNT(self->stats.emsgsize_retries, 1);
+            return send_au_nalus(self, ts, nalus, i, to, end_of_au, false);
+        }
+        errno = EMSGSIZE;
+    }
+
+    return -1;
+}
+
+// Appends the aggregation packet of `self->aggregator` to `self->au_packets`,
+// which has room for it, along with its first NAL unit in
+// `self->au_packet_nalus`.
+static void push_au_aggregate(SmolRTSP_NalTransport *self, size_t *len) {
+    self->au_packets[(*len)++] = SmolRTSP_NalAggregator_take(&self->aggregator);
+}
+
+static int reserve_au_nalus(SmolRTSP_NalTransport *self, size_t n) {
+    if (n <= self->au_nalus_capacity) {
+        return 0;
+    }
+
+    AccessUnitNalu *nalus =
+        smolrtsp_realloc(self->au_nalus, n * sizeof nalus[0]);
+    if (NULL == nalus) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    self->au_nalus = nalus;
+    self->au_nalus_capacity = n;
+    return 0;
+}
+
+static int reserve_au_packets(SmolRTSP_NalTransport *self, size_t n) {
+    if (n <= self->au_packets_capacity) {
+        return 0;
+    }
+
+    size_t capacity =
+        self->au_packets_capacity > 0 ? self->au_packets_capacity * 2 : 16;
+    while (capacity < n) {
+        capacity *= 2;
+    }
+
+    SmolRTSP_RtpPacket *packets =
+        smolrtsp_realloc(self->au_packets, capacity * sizeof packets[0]);
+    if (NULL == packets) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->au_packets = packets;
+
+    size_t *packet_nalus =
+        smolrtsp_realloc(self->au_packet_nalus, capacity * sizeof(size_t));
+    if (NULL == packet_nalus) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->au_packet_nalus = packet_nalus;
+
+    self->au_packets_capacity = capacity;
+    return 0;
+}
+
+int SmolRTSP_NalTransport_flush(SmolRTSP_NalTransport *self) {
+    assert(self);
+
+    if (!self->config.aggregation || 0 == self->aggregator.count) {
+        return 0;
+    }
+
+    const SmolRTSP_RtpPacket packet =
+        SmolRTSP_NalAggregator_take(&self->aggregator);
+
+    return SmolRTSP_RtpTransport_send_batch(
+        self->transport, self->aggregate_ts,
+        (SmolRTSP_RtpPacketSlice)Slice99_typed_from_array(
+            (SmolRTSP_RtpPacket[]){packet}));
+}
+
+static int send_aggregated(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size) {
+    SmolRTSP_NalAggregator *aggregator = &self->aggregator;
+
+    if (aggregator->count > 0 &&
+        (!timestamp_eq(self->aggregate_ts, ts) ||
+         !SmolRTSP_NalAggregator_fits(
+             aggregator, nalu, info, max_packet_size))) {
+        if (SmolRTSP_NalTransport_flush(self) == -1) {
             return -1;
         }
     }
 
+    if (!SmolRTSP_NalAggregator_fits(aggregator, nalu, info, max_packet_size)) {
+        return send_nalu(self, ts, nalu, info, marker, max_packet_size);
+    }
+
+    SmolRTSP_NalAggregator_push(aggregator, nalu, info, marker);
+    self->aggregate_ts = ts;
+
+    // A coded slice completes what precedes it in the access unit, so do not
+    // delay it until the next NAL unit; neither the end of an access unit.
+    if (info->is_vcl || marker) {
+        return SmolRTSP_NalTransport_flush(self);
+    }
+
     return 0;
 }
 
-static int send_fu(
-    SmolRTSP_RtpTransport *t, SmolRTSP_RtpTimestamp ts, SmolRTSP_NalUnit fu,
-    bool is_first_fragment, bool is_last_fragment) {
-    const size_t fu_header_size = SmolRTSP_NalHeader_fu_size(fu.header);
-    U8Slice99 fu_header = U8Slice99_new(alloca(fu_header_size), fu_header_size);
+static int send_nalu(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size) {
+    if (send_fragments(self, ts, nalu, info, marker, max_packet_size) == 0) {
+        return 0;
+    }
 
-    SmolRTSP_NalHeader_write_fu_header(
-        fu.header, fu_header.ptr, is_first_fragment, is_last_fragment);
+    // The path MTU has shrunk below our packets. Resend the NAL unit once
+    // with the new budget: it is the first packet of a NAL unit that does not
+    // get through, since all the fragments are of the same size.
+    if (EMSGSIZE == errno) {
+        const size_t new_max_packet_size = packet_budget(self, info);
+        if (new_max_packet_size < max_packet_size) {
+            COUNT(self->stats.emsgsize_retries, 1);
+            return send_fragments(
+                self, ts, nalu, info, marker, new_max_packet_size);
+        }
+        errno = EMSGSIZE;
+    }
+
+    return -1;
+}
+
+static int send_fragments(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker,
+    size_t max_packet_size) {
+    SmolRTSP_NalPacketizer packetizer;
+    SmolRTSP_NalPacketizer_init(
+        &packetizer, nalu, info, max_packet_size, marker);
+
+    SmolRTSP_RtpPacket packets[PACKETS_BATCH_SIZE];
+    size_t count;
+    while ((count = SmolRTSP_NalPacketizer_next(
+                &packetizer, PACKETS_BATCH_SIZE, packets)) > 0) {
+        if (SmolRTSP_RtpTransport_send_batch(
+                self->transport, ts,
+                SmolRTSP_RtpPacketSlice_new(packets, count)) == -1) {
+            return -1;
+        }
+    }
+
+    // A NAL unit that fits into a packet is sent as is.
+    const size_t total = SmolRTSP_NalPacketizer_count(&packetizer);
+    if (total > 1) {
+        COUNT(self->stats.fragmented_nalus, 1);
+        COUNT(self->stats.fragments, total);
+    }
+
+    return 0;
+}
+
+// The configured limit for the codec of `info`, lowered to what the path of
+// the underlying transport allows.
+static size_t packet_budget(
+    SmolRTSP_NalTransport *self, const SmolRTSP_NalHeaderInfo *info) {
+    const size_t configured = SmolRTSP_NalCodec_H264 == info->codec
+                                  ? self->config.max_h264_nalu_size
+                                  : self->config.max_h265_nalu_size;
+
+    const size_t path_max =
+        SmolRTSP_RtpTransport_max_payload_size(self->transport);
+    if (0 == path_max) {
+        return configured;
+    }
+
+    // An FU packet carries up to `max_packet_size` bytes of the NAL unit
+    // after the FU header.
+    const size_t fu_size = info->fu_size,
+                 path_budget = path_max > fu_size ? path_max - fu_size : 1;
+
+    return path_budget < configured ? path_budget : configured;
+}
+
+static bool should_drop(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalHeaderInfo *info) {
+    const bool continues_dropped_au =
+        self->has_dropped && timestamp_eq(self->dropped_ts, ts);
+
+    switch (self->config.backpressure_policy) {
+    case SmolRTSP_BackpressurePolicy_Block:
+        return false;
+    case SmolRTSP_BackpressurePolicy_DropUntilIdr:
+        // Parameter sets are tiny and needed to decode the next IDR.
+        if (info->is_vps || info->is_sps || info->is_pps) {
+            return false;
+        }
+
+        if (!self->waiting_for_idr) {
+            self->waiting_for_idr =
+                SmolRTSP_NalTransport_is_full(self) || continues_dropped_au;
+            return self->waiting_for_idr;
+        }
+
+        // Do not resume in the middle of an IDR access unit that has already
+        // been partially dropped.
+        if (info->is_idr && !continues_dropped_au &&
+            !SmolRTSP_NalTransport_is_full(self)) {
+            self->waiting_for_idr = false;
+        }
+        return self->waiting_for_idr;
+    case SmolRTSP_BackpressurePolicy_DropAccessUnit:
+        return continues_dropped_au || SmolRTSP_NalTransport_is_full(self);
+    case SmolRTSP_BackpressurePolicy_Thin:
+        return should_thin(self, ts, info);
+    }
+
+    return false;
+}
+
+static bool should_thin(
+    SmolRTSP_NalTransport *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalHeaderInfo *info) {
+    if (info->drop_priority > self->max_drop_priority) {
+        self->max_drop_priority = info->drop_priority;
+    }
+
+    uint64_t level = self->stats.thinning_level;
+
+    // The level only changes between access units, so that all the slices of
+    // a picture share the same fate.
+    if (!self->has_thinning_ts || !timestamp_eq(self->thinning_ts, ts)) {
+        self->has_thinning_ts = true;
+        self->thinning_ts = ts;
+
+        if (SmolRTSP_NalTransport_is_full(self)) {
+            self->calm_access_units = 0;
+            if (level < self->max_drop_priority) {
+                level++;
+            }
+        } else if (
+            level > 0 && ++self->calm_access_units >=
+                             SMOLRTSP_THINNING_RECOVERY_ACCESS_UNITS) {
+            self->calm_access_units = 0;
+            level--;
+        }
+
+        __atomic_store_n(&self->stats.thinning_level, level, __ATOMIC_RELAXED);
+    }
+
+    // At level `n`, the `n` highest drop priorities seen are dropped.
+    return info->drop_priority > 0 &&
+           info->drop_priority + level > self->max_drop_priority;
+}
+
+static uint64_t timestamp_value(SmolRTSP_RtpTimestamp ts) {
+    match(ts) {
+        of(SmolRTSP_RtpTimestamp_Raw, raw_ts) return *raw_ts;
+        of(SmolRTSP_RtpTimestamp_SysClockUs, time_us) return *time_us;
+    }
+
+    return 0;
+}
+
+static bool timestamp_eq(SmolRTSP_RtpTimestamp a, SmolRTSP_RtpTimestamp b) {
+    return a.tag == b.tag && timestamp_value(a) == timestamp_value(b);
+}
+
+static uint64_t now_us(const SmolRTSP_NalTransport *self) {
+    if (self->config.clock_us != NULL) {
+        return self->config.clock_us();
+    }
 
-    const bool marker = is_last_fragment;
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
 
-    return SmolRTSP_RtpTransport_send_packet(
-        t, ts, marker, fu_header, fu.payload);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
 }
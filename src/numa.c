@@ -0,0 +1,97 @@
+#include <smolrtsp/numa.h>
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int smolrtsp_cpu_numa_node(int cpu) {
+    if (cpu < 0) {
+        return -1;
+    }
+
+    // The node of a CPU is a `nodeN` link in its directory.
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (NULL == dir) {
+        return -1;
+    }
+
+    int node = -1;
+    const struct dirent *entry;
+    while (-1 == node && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) != 0) {
+            continue;
+        }
+
+        char *end;
+        const long id = strtol(entry->d_name + 4, &end, 10);
+        if (end != entry->d_name + 4 && '\0' == *end && id >= 0 &&
+            id <= INT_MAX) {
+            node = (int)id;
+        }
+    }
+
+    closedir(dir);
+
+    return node;
+}
+
+int smolrtsp_interface_numa_node(const char *ifname) {
+    assert(ifname);
+
+    if ('\0' == ifname[0] || strchr(ifname, '/') != NULL ||
+        strcmp(ifname, ".") == 0 || strcmp(ifname, "..") == 0) {
+        return -1;
+    }
+
+    char path[128];
+    const int len = snprintf(
+        path, sizeof path, "/sys/class/net/%s/device/numa_node", ifname);
+    if (len < 0 || (size_t)len >= sizeof path) {
+        return -1;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (NULL == f) {
+        return -1;
+    }
+
+    // The kernel reports -1 itself if the device has no affinity.
+    int node = -1;
+    if (fscanf(f, "%d", &node) != 1 || node < 0) {
+        node = -1;
+    }
+    fclose(f);
+
+    return node;
+}
+
+int smolrtsp_allowed_cpu(size_t i) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof set, &set) == -1) {
+        return -1;
+    }
+
+    const int count = CPU_COUNT(&set);
+    if (0 == count) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    size_t n = i % (size_t)count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set) && 0 == n--) {
+            return cpu;
+        }
+    }
+
+    errno = ESRCH;
+    return -1;
+}
@@ -0,0 +1,398 @@
+#include <smolrtsp/pacer.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <time.h>
+
+// The maximum number of queued packets handed to the underlying transport at
+// once.
+#define BATCH_SIZE 64
+
+// Tokens are kept in byte-microseconds so that the bucket can be refilled with
+// integer arithmetic.
+#define US_PER_SEC UINT64_C(1000000)
+
+// Every queued packet is preceded by this header. The time is truncated to 32
+// bits, which is enough to measure a delay of up to 71 minutes.
+typedef struct {
+    uint32_t packet_size;
+    uint32_t enqueued_us;
+} EntryHeader;
+
+struct SmolRTSP_Pacer {
+    SmolRTSP_Transport transport;
+    SmolRTSP_PacerConfig config;
+
+    uint64_t tokens, last_refill_us;
+
+    // Queued packets, each stored as an entry header followed by the data.
+    uint8_t *queue;
+    size_t queue_head, queue_tail, queued_bytes;
+};
+
+static uint64_t now_us(const SmolRTSP_Pacer *self);
+static void refill(SmolRTSP_Pacer *self);
+static uint64_t packet_cost(const SmolRTSP_Pacer *self, size_t packet_size);
+static void consume(SmolRTSP_Pacer *self, size_t packet_size);
+static bool enqueue(SmolRTSP_Pacer *self, SmolRTSP_IoVecSlice bufs);
+static size_t queue_front(
+    const SmolRTSP_Pacer *self, size_t offset, void **data,
+    uint32_t *enqueued_us);
+static void record_latency(SmolRTSP_Pacer *self, uint32_t enqueued_us);
+
+SmolRTSP_PacerConfig SmolRTSP_PacerConfig_default(void) {
+    return (SmolRTSP_PacerConfig){
+        .rate = SMOLRTSP_PACER_DEFAULT_RATE,
+        .burst = SMOLRTSP_PACER_DEFAULT_BURST,
+        .max_queue_size = SMOLRTSP_PACER_DEFAULT_MAX_QUEUE_SIZE,
+        .latency = NULL,
+        .clock_us = NULL,
+    };
+}
+
+SmolRTSP_Pacer *
+SmolRTSP_Pacer_new(SmolRTSP_Transport t, SmolRTSP_PacerConfig config) {
+    assert(t.self && t.vptr);
+    assert(config.rate > 0);
+
+    SmolRTSP_Pacer *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->transport = t;
+    self->config = config;
+    self->tokens = (uint64_t)config.burst * US_PER_SEC;
+    self->last_refill_us = now_us(self);
+
+    self->queue = smolrtsp_malloc(config.max_queue_size);
+    if (NULL == self->queue && config.max_queue_size > 0) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->queue_head = 0;
+    self->queue_tail = 0;
+    self->queued_bytes = 0;
+
+    return self;
+}
+
+static void SmolRTSP_Pacer_drop(VSelf) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    VCALL_SUPER(self->transport, SmolRTSP_Droppable, drop);
+
+    smolrtsp_free(self->queue);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Pacer);
+
+void SmolRTSP_Pacer_set_rate(SmolRTSP_Pacer *self, uint64_t rate) {
+    assert(self);
+    assert(rate > 0);
+
+    refill(self);
+    self->config.rate = rate;
+}
+
+int SmolRTSP_Pacer_poll(SmolRTSP_Pacer *self) {
+    assert(self);
+
+    refill(self);
+
+    while (self->queue_head != self->queue_tail) {
+        struct iovec vecs[BATCH_SIZE];
+        SmolRTSP_IoVecSlice batch[BATCH_SIZE];
+        uint32_t enqueued_us[BATCH_SIZE];
+        size_t count = 0, offset = self->queue_head;
+        uint64_t tokens = self->tokens;
+
+        // Gather the queued packets that fit into the bucket.
+        while (count < BATCH_SIZE && offset != self->queue_tail) {
+            void *data;
+            const size_t packet_size =
+                queue_front(self, offset, &data, &enqueued_us[count]);
+            const uint64_t cost = packet_cost(self, packet_size);
+            if (tokens < cost) {
+                break;
+            }
+
+            tokens -= cost;
+            vecs[count] = (struct iovec){data, packet_size};
+            batch[count] = SmolRTSP_IoVecSlice_new(&vecs[count], 1);
+            count++;
+            offset += sizeof(EntryHeader) + packet_size;
+        }
+
+        if (0 == count) {
+            break;
+        }
+
+        const size_t sent = smolrtsp_transmit_batch(
+            self->transport, SmolRTSP_IoVecBatch_new(batch, count));
+
+        for (size_t i = 0; i < sent; i++) {
+            consume(self, vecs[i].iov_len);
+            record_latency(self, enqueued_us[i]);
+            self->queue_head += sizeof(EntryHeader) + vecs[i].iov_len;
+            self->queued_bytes -= vecs[i].iov_len;
+        }
+
+        if (sent < count) {
+            return -1;
+        }
+    }
+
+    if (self->queue_head == self->queue_tail) {
+        self->queue_head = self->queue_tail = 0;
+    }
+
+    return 0;
+}
+
+uint64_t SmolRTSP_Pacer_next_deadline(const SmolRTSP_Pacer *self) {
+    assert(self);
+
+    if (self->queue_head == self->queue_tail) {
+        return SMOLRTSP_PACER_IDLE;
+    }
+
+    void *data;
+    uint32_t enqueued_us;
+    const uint64_t cost = packet_cost(
+        self, queue_front(self, self->queue_head, &data, &enqueued_us));
+    if (self->tokens >= cost) {
+        return self->last_refill_us;
+    }
+
+    const uint64_t missing = cost - self->tokens;
+    return self->last_refill_us +
+           (missing + self->config.rate - 1) / self->config.rate;
+}
+
+size_t SmolRTSP_Pacer_queued_bytes(const SmolRTSP_Pacer *self) {
+    assert(self);
+    return self->queued_bytes;
+}
+
+static int SmolRTSP_Pacer_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    refill(self);
+
+    const size_t packet_size = SmolRTSP_IoVecSlice_len(bufs);
+
+    if (self->queue_head == self->queue_tail &&
+        self->tokens >= packet_cost(self, packet_size)) {
+        const int ret = VCALL(self->transport, transmit, bufs);
+        if (ret != -1) {
+            consume(self, packet_size);
+            record_latency(self, (uint32_t)self->last_refill_us);
+        }
+        return ret;
+    }
+
+    if (!enqueue(self, bufs)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // The packet is accepted; an I/O error will be reported by the next
+    // `SmolRTSP_Pacer_poll`.
+    const int ret = SmolRTSP_Pacer_poll(self);
+    (void)ret;
+
+    return 0;
+}
+
+#define SmolRTSP_Pacer_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_Pacer_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    refill(self);
+
+    // Transmit the leading packets that fit into the bucket right away.
+    size_t count = 0;
+    if (self->queue_head == self->queue_tail) {
+        uint64_t tokens = self->tokens;
+        for (; count < batch.len; count++) {
+            const uint64_t cost =
+                packet_cost(self, SmolRTSP_IoVecSlice_len(batch.ptr[count]));
+            if (tokens < cost) {
+                break;
+            }
+            tokens -= cost;
+        }
+    }
+
+    const size_t sent = smolrtsp_transmit_batch(
+        self->transport, SmolRTSP_IoVecBatch_new(batch.ptr, count));
+    for (size_t i = 0; i < sent; i++) {
+        consume(self, SmolRTSP_IoVecSlice_len(batch.ptr[i]));
+        record_latency(self, (uint32_t)self->last_refill_us);
+    }
+    if (sent < count) {
+        return 0 == sent ? -1 : (ssize_t)sent;
+    }
+
+    // Queue the rest.
+    size_t accepted = sent;
+    for (; accepted < batch.len; accepted++) {
+        if (!enqueue(self, batch.ptr[accepted])) {
+            break;
+        }
+    }
+
+    if (0 == accepted && batch.len > 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    return (ssize_t)accepted;
+}
+
+static bool SmolRTSP_Pacer_is_full(VSelf) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    return VCALL(self->transport, is_full) ||
+           self->queued_bytes > self->config.max_queue_size / 2;
+}
+
+#define SmolRTSP_Pacer_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_Pacer_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    return VCALL(self->transport, max_packet_size);
+}
+
+// The queued packets are counted by the underlying transport once they are
+// transmitted.
+#define SmolRTSP_Pacer_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_Pacer_stats(VSelf) {
+    VSELF(SmolRTSP_Pacer);
+    assert(self);
+
+    return VCALL(self->transport, stats);
+}
+
+implExtern(SmolRTSP_Transport, SmolRTSP_Pacer);
+
+static uint64_t now_us(const SmolRTSP_Pacer *self) {
+    if (self->config.clock_us != NULL) {
+        return self->config.clock_us();
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * US_PER_SEC + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void refill(SmolRTSP_Pacer *self) {
+    const uint64_t now = now_us(self),
+                   capacity = (uint64_t)self->config.burst * US_PER_SEC;
+
+    const uint64_t elapsed =
+        now > self->last_refill_us ? now - self->last_refill_us : 0;
+    self->last_refill_us = now;
+
+    // Avoid overflowing `elapsed * rate` after long idle periods.
+    if (elapsed >= (capacity - self->tokens) / self->config.rate + 1) {
+        self->tokens = capacity;
+    } else {
+        self->tokens += elapsed * self->config.rate;
+    }
+}
+
+// A packet larger than the bucket is sent once the bucket is full.
+static uint64_t packet_cost(const SmolRTSP_Pacer *self, size_t packet_size) {
+    const uint64_t cost = (uint64_t)packet_size * US_PER_SEC,
+                   capacity = (uint64_t)self->config.burst * US_PER_SEC;
+
+    return cost < capacity ? cost : capacity;
+}
+
+static void consume(SmolRTSP_Pacer *self, size_t packet_size) {
+    const uint64_t cost = (uint64_t)packet_size * US_PER_SEC;
+    self->tokens = self->tokens > cost ? self->tokens - cost : 0;
+}
+
+static bool enqueue(SmolRTSP_Pacer *self, SmolRTSP_IoVecSlice bufs) {
+    const size_t packet_size = SmolRTSP_IoVecSlice_len(bufs),
+                 entry_size = sizeof(EntryHeader) + packet_size;
+
+    if (packet_size > UINT32_MAX) {
+        return false;
+    }
+
+    if (self->queue_tail + entry_size > self->config.max_queue_size) {
+        // Move the queued packets to the beginning of the buffer.
+        const size_t used = self->queue_tail - self->queue_head;
+        if (used + entry_size > self->config.max_queue_size) {
+            return false;
+        }
+
+        memmove(self->queue, self->queue + self->queue_head, used);
+        self->queue_head = 0;
+        self->queue_tail = used;
+    }
+
+    // `refill` has just been called by the caller, so `last_refill_us` is the
+    // current time.
+    const EntryHeader header = {
+        .packet_size = (uint32_t)packet_size,
+        .enqueued_us = (uint32_t)self->last_refill_us,
+    };
+
+    uint8_t *entry = self->queue + self->queue_tail;
+    memcpy(entry, &header, sizeof header);
+    entry += sizeof header;
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            memcpy(entry, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+            entry += bufs.ptr[i].iov_len;
+        }
+    }
+
+    self->queue_tail += entry_size;
+    self->queued_bytes += packet_size;
+
+    return true;
+}
+
+static size_t queue_front(
+    const SmolRTSP_Pacer *self, size_t offset, void **data,
+    uint32_t *enqueued_us) {
+    EntryHeader header;
+    memcpy(&header, self->queue + offset, sizeof header);
+    *data = self->queue + offset + sizeof header;
+    *enqueued_us = header.enqueued_us;
+
+    return header.packet_size;
+}
+
+// `self->last_refill_us` is the current time of the caller.
+static void record_latency(SmolRTSP_Pacer *self, uint32_t enqueued_us) {
+    if (self->config.latency != NULL) {
+        SmolRTSP_LatencyHistogram_record(
+            self->config.latency,
+            (uint32_t)((uint32_t)self->last_refill_us - enqueued_us));
+    }
+}
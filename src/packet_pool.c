@@ -0,0 +1,354 @@
+#include <smolrtsp/packet_pool.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+
+// The size of an explicit huge page (x86-64 and AArch64 with 4 KiB pages).
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+struct SmolRTSP_PacketBuf {
+    SmolRTSP_PacketPool *pool;
+    uint8_t *data;
+    size_t len;
+    uint32_t refcount;
+    SmolRTSP_PacketBuf *next;
+};
+
+struct SmolRTSP_PacketPool {
+    // The buffer headers are kept apart from the data, which thereby stays
+    // contiguous and aligned.
+    SmolRTSP_PacketBuf *bufs, *free_list;
+    size_t buffer_size, buffers_count, available;
+
+    // Either mapped (`mapped_size > 0`) or allocated as `raw` and aligned.
+    uint8_t *data;
+    void *raw;
+    size_t mapped_size;
+    bool hugepages;
+    int numa_node;
+
+    SmolRTSP_PacketPoolStats stats;
+};
+
+static int map_data(SmolRTSP_PacketPool *self, size_t size);
+static int alloc_data(SmolRTSP_PacketPool *self, size_t size);
+static int map_plain_data(SmolRTSP_PacketPool *self, size_t size);
+static int bind_data(SmolRTSP_PacketPool *self, int node);
+
+SmolRTSP_PacketPoolConfig SmolRTSP_PacketPoolConfig_default(void) {
+    return (SmolRTSP_PacketPoolConfig){
+        .buffer_size = 2048,
+        .buffers_count = 4096,
+        .hugepages = false,
+        .numa_node = -1,
+    };
+}
+
+SmolRTSP_PacketPool *
+SmolRTSP_PacketPool_new(SmolRTSP_PacketPoolConfig config) {
+    assert(config.buffer_size > 0);
+    assert(config.buffers_count > 0);
+
+    const size_t buffer_size =
+        (config.buffer_size + SMOLRTSP_PACKET_POOL_ALIGNMENT - 1) &
+        ~(size_t)(SMOLRTSP_PACKET_POOL_ALIGNMENT - 1);
+    if (config.buffers_count > SIZE_MAX / buffer_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    SmolRTSP_PacketPool *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(self, 0, sizeof *self);
+
+    self->bufs = smolrtsp_malloc(config.buffers_count * sizeof self->bufs[0]);
+    if (NULL == self->bufs) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // A memory policy applies to whole pages, so a pool placed on a node is
+    // mapped on its own.
+    const size_t size = config.buffers_count * buffer_size;
+    int ret;
+    if (config.hugepages) {
+        ret = map_data(self, size);
+    } else if (config.numa_node >= 0) {
+        ret = map_plain_data(self, size);
+    } else {
+        ret = alloc_data(self, size);
+    }
+    if (-1 == ret) {
+        smolrtsp_free(self->bufs);
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Before the pages are touched, so that they are allocated on the node.
+    self->numa_node = -1;
+    if (config.numa_node >= 0 && self->mapped_size > 0) {
+        self->numa_node = bind_data(self, config.numa_node);
+    }
+
+    self->buffer_size = buffer_size;
+    self->buffers_count = self->available = config.buffers_count;
+    self->free_list = NULL;
+
+    // Hand out the buffers in address order, which keeps a lightly used pool
+    // within few pages.
+    for (size_t i = config.buffers_count; i > 0; i--) {
+        SmolRTSP_PacketBuf *buf = &self->bufs[i - 1];
+        *buf = (SmolRTSP_PacketBuf){
+            .pool = self,
+            .data = self->data + (i - 1) * buffer_size,
+            .len = 0,
+            .refcount = 0,
+            .next = self->free_list,
+        };
+        self->free_list = buf;
+    }
+
+    return self;
+}
+
+SmolRTSP_PacketBuf *SmolRTSP_PacketPool_acquire(SmolRTSP_PacketPool *self) {
+    assert(self);
+
+    SmolRTSP_PacketBuf *buf = self->free_list;
+    if (NULL == buf) {
+        self->stats.exhausted++;
+        errno = ENOBUFS;
+        return NULL;
+    }
+
+    self->free_list = buf->next;
+    self->available--;
+
+    buf->next = NULL;
+    buf->len = 0;
+    buf->refcount = 1;
+
+    self->stats.acquired++;
+    const size_t in_use = self->buffers_count - self->available;
+    if (in_use > self->stats.peak_in_use) {
+        self->stats.peak_in_use = in_use;
+    }
+
+    return buf;
+}
+
+size_t SmolRTSP_PacketPool_buffer_size(const SmolRTSP_PacketPool *self) {
+    assert(self);
+    return self->buffer_size;
+}
+
+size_t SmolRTSP_PacketPool_available(const SmolRTSP_PacketPool *self) {
+    assert(self);
+    return self->available;
+}
+
+bool SmolRTSP_PacketPool_is_hugepage_backed(const SmolRTSP_PacketPool *self) {
+    assert(self);
+    return self->hugepages;
+}
+
+int SmolRTSP_PacketPool_numa_node(const SmolRTSP_PacketPool *self) {
+    assert(self);
+    return self->numa_node;
+}
+
+SmolRTSP_PacketPoolStats
+SmolRTSP_PacketPool_stats(const SmolRTSP_PacketPool *self) {
+    assert(self);
+    return self->stats;
+}
+
+static void SmolRTSP_PacketPool_drop(VSelf) {
+    VSELF(SmolRTSP_PacketPool);
+    assert(self);
+    assert(self->available == self->buffers_count);
+
+    if (self->mapped_size > 0) {
+        munmap(self->data, self->mapped_size);
+    } else {
+        smolrtsp_free(self->raw);
+    }
+    smolrtsp_free(self->bufs);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_PacketPool);
+
+uint8_t *SmolRTSP_PacketBuf_data(SmolRTSP_PacketBuf *self) {
+    assert(self);
+    return self->data;
+}
+
+U8Slice99 SmolRTSP_PacketBuf_bytes(const SmolRTSP_PacketBuf *self) {
+    assert(self);
+    return U8Slice99_new(self->data, self->len);
+}
+
+void SmolRTSP_PacketBuf_set_len(SmolRTSP_PacketBuf *self, size_t len) {
+    assert(self);
+    assert(len <= self->pool->buffer_size);
+
+    self->len = len;
+}
+
+int SmolRTSP_PacketBuf_write(SmolRTSP_PacketBuf *self, U8Slice99 packet) {
+    assert(self);
+
+    if (packet.len > self->pool->buffer_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (packet.len > 0) {
+        memcpy(self->data, packet.ptr, packet.len);
+    }
+    self->len = packet.len;
+
+    return 0;
+}
+
+SmolRTSP_PacketBuf *SmolRTSP_PacketBuf_retain(SmolRTSP_PacketBuf *self) {
+    assert(self);
+    assert(self->refcount > 0);
+
+    self->refcount++;
+
+    return self;
+}
+
+void SmolRTSP_PacketBuf_release(SmolRTSP_PacketBuf *self) {
+    assert(self);
+    assert(self->refcount > 0);
+
+    if (--self->refcount > 0) {
+        return;
+    }
+
+    SmolRTSP_PacketPool *pool = self->pool;
+    self->next = pool->free_list;
+    pool->free_list = self;
+    pool->available++;
+}
+
+uint32_t SmolRTSP_PacketBuf_refcount(const SmolRTSP_PacketBuf *self) {
+    assert(self);
+    return self->refcount;
+}
+
+// Maps `size` bytes with explicit huge pages, or with transparent ones if none
+// are reserved; falls back to `alloc_data` if neither is available.
+static int map_data(SmolRTSP_PacketPool *self, size_t size) {
+    const size_t huge_size =
+        (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    void *data = mmap(
+        NULL, huge_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+        self->data = data;
+        self->mapped_size = huge_size;
+        self->hugepages = true;
+        return 0;
+    }
+#endif
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages need a mapping aligned to a huge page.
+    const size_t padded_size = huge_size + HUGE_PAGE_SIZE;
+    uint8_t *raw = mmap(
+        NULL, padded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+        -1, 0);
+    if (raw != MAP_FAILED) {
+        const uintptr_t addr = (uintptr_t)raw;
+        const uintptr_t aligned =
+            (addr + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+        const size_t head = aligned - addr;
+
+        if (head > 0) {
+            munmap(raw, head);
+        }
+        if (padded_size - head > huge_size) {
+            munmap(raw + head + huge_size, padded_size - head - huge_size);
+        }
+
+        self->data = raw + head;
+        self->mapped_size = huge_size;
+        self->hugepages = madvise(self->data, huge_size, MADV_HUGEPAGE) == 0;
+        return 0;
+    }
+#endif
+
+    return alloc_data(self, size);
+}
+
+static int alloc_data(SmolRTSP_PacketPool *self, size_t size) {
+    self->raw = smolrtsp_malloc(size + SMOLRTSP_PACKET_POOL_ALIGNMENT - 1);
+    if (NULL == self->raw) {
+        return -1;
+    }
+
+    const uintptr_t addr = (uintptr_t)self->raw;
+    self->data =
+        (uint8_t *)((addr + SMOLRTSP_PACKET_POOL_ALIGNMENT - 1) &
+                    ~(uintptr_t)(SMOLRTSP_PACKET_POOL_ALIGNMENT - 1));
+    self->mapped_size = 0;
+    self->hugepages = false;
+
+    return 0;
+}
+
+static int map_plain_data(SmolRTSP_PacketPool *self, size_t size) {
+    void *data = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == data) {
+        return alloc_data(self, size);
+    }
+
+    self->data = data;
+    self->mapped_size = size;
+    self->hugepages = false;
+
+    return 0;
+}
+
+// Prefers `node` for the pages of the mapping, so that they still come from
+// another node once it runs out of memory. Returns `node`, or -1 if the
+// kernel refuses the policy.
+static int bind_data(SmolRTSP_PacketPool *self, int node) {
+    enum { bits_per_word = sizeof(unsigned long) * 8, words = 16 };
+    // The kernel reads one bit less than `maxnode`.
+    if (node >= bits_per_word * words - 1) {
+        return -1;
+    }
+
+    unsigned long nodemask[words] = {0};
+    nodemask[node / bits_per_word] = 1UL << (node % bits_per_word);
+
+    // Called directly, since glibc has no wrapper outside of libnuma.
+    const long ret = syscall(
+        SYS_mbind, self->data, self->mapped_size, MPOL_PREFERRED, nodemask,
+        (unsigned long)(bits_per_word * words), 0);
+
+    return 0 == ret ? node : -1;
+}
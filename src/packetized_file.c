@@ -0,0 +1,560 @@
+#include <smolrtsp/packetized_file.h>
+
+#include <smolrtsp/param_set_cache.h>
+
+#include "alloc.h"
+#include "nal_packetizer.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_MAGIC      "SRTSPPKT"
+#define FILE_BYTE_ORDER UINT32_C(0x01020304)
+
+// The tables follow the payloads aligned to this, so that they are read from
+// the mapping in place.
+#define TABLE_ALIGNMENT 8
+
+// The number of packets handed to `SmolRTSP_RtpTransport_send_batch` at once,
+// and taken from the packetizer at once.
+#define PACKETS_BATCH_SIZE 64
+
+// The packet ends an access unit.
+#define ENTRY_MARKER (UINT16_C(1) << 0)
+// The packet begins an IDR access unit.
+#define ENTRY_IDR (UINT16_C(1) << 1)
+
+// An entry of the packet table, as persisted.
+typedef struct {
+    // The offset of the payload, relative to `data_offset`.
+    uint64_t offset;
+    uint32_t timestamp;
+    uint16_t len, flags;
+} Entry;
+
+// The header of a pre-packetized file, followed by the payloads, the packet
+// table (`packets_count` entries), the IDR table (the indices of the first
+// packets of the IDR access units in ascending order, as `uint64_t`), and the
+// `sprop` string with its null terminator (if `sprop_len > 0`). Like the index
+// of `SmolRTSP_MediaFile`, it is written in the native byte order, which
+// `byte_order` catches.
+typedef struct {
+    char magic[8];
+    uint32_t version, byte_order;
+    uint32_t entry_size, codec;
+    uint32_t clock_rate, reserved;
+    uint64_t data_offset, data_size;
+    uint64_t packets_offset, packets_count;
+    uint64_t idrs_offset, idrs_count;
+    uint64_t sprop_offset, sprop_len;
+} FileHeader;
+
+struct SmolRTSP_PacketizedFile {
+    SmolRTSP_NalCodec codec;
+    uint32_t clock_rate;
+
+    const uint8_t *data;
+    size_t size;
+
+    const uint8_t *payloads;
+    const Entry *entries;
+    size_t entries_count;
+    const uint64_t *idrs;
+    size_t idrs_count;
+    const char *sprop;
+};
+
+typedef struct {
+    FILE *fp;
+    uint64_t offset, data_offset;
+
+    // Whether the next packet begins an IDR access unit.
+    bool idr_pending;
+
+    Entry *entries;
+    size_t entries_count, entries_cap;
+    uint64_t *idrs;
+    size_t idrs_count, idrs_cap;
+} Writer;
+
+static int write_access_unit(
+    Writer *w, const SmolRTSP_MediaFile *file, SmolRTSP_AccessUnit au,
+    uint32_t timestamp, size_t max_packet_size, SmolRTSP_ParamSetCache *cache);
+static int write_bytes(Writer *w, const void *data, size_t len);
+static int write_padding(Writer *w);
+static int push_entry(Writer *w, Entry entry);
+static int push_idr(Writer *w, uint64_t packet);
+static bool
+is_valid(const FileHeader *header, const uint8_t *data, size_t size);
+static bool is_within(uint64_t offset, uint64_t len, size_t size);
+
+SmolRTSP_PacketizedFileConfig SmolRTSP_PacketizedFileConfig_default(void) {
+    return (SmolRTSP_PacketizedFileConfig){
+        .max_packet_size = SMOLRTSP_PACKETIZED_FILE_DEFAULT_MAX_PACKET_SIZE,
+        .clock_rate = 90000,
+        .frame_rate_num = 25,
+        .frame_rate_den = 1,
+    };
+}
+
+int SmolRTSP_PacketizedFile_write(
+    const char *path, const SmolRTSP_MediaFile *file,
+    SmolRTSP_PacketizedFileConfig config) {
+    assert(path);
+    assert(file);
+    assert(config.max_packet_size > SMOLRTSP_H265_FU_HEADER_SIZE);
+    assert(config.max_packet_size <= UINT16_MAX);
+    assert(config.frame_rate_num > 0 && config.frame_rate_den > 0);
+
+    // Written aside and renamed, so that concurrent readers never see a
+    // partial file.
+    char tmp_path[4096];
+    if (snprintf(
+            tmp_path, sizeof tmp_path, "%s.%ld.tmp", path, (long)getpid()) >=
+        (int)sizeof tmp_path) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    SmolRTSP_ParamSetCache *cache = SmolRTSP_ParamSetCache_new();
+    if (NULL == cache) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    Writer w = {0};
+    w.fp = fopen(tmp_path, "wb");
+    if (NULL == w.fp) {
+        const int saved_errno = errno;
+        VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+        errno = saved_errno;
+        return -1;
+    }
+
+    FileHeader header;
+    // Zero the padding too, so that the files of the same video are the same.
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, FILE_MAGIC, sizeof header.magic);
+    header.version = SMOLRTSP_PACKETIZED_FILE_VERSION;
+    header.byte_order = FILE_BYTE_ORDER;
+    header.entry_size = sizeof(Entry);
+    header.codec = (uint32_t)SmolRTSP_MediaFile_codec(file);
+    header.clock_rate = config.clock_rate;
+
+    // The header is rewritten once the tables are known.
+    if (write_bytes(&w, &header, sizeof header) == -1) {
+        goto fail;
+    }
+    header.data_offset = w.data_offset = w.offset;
+
+    const size_t access_units_count =
+        SmolRTSP_MediaFile_access_units_count(file);
+    for (size_t i = 0; i < access_units_count; i++) {
+        const uint64_t ticks = (uint64_t)i * config.clock_rate *
+                               config.frame_rate_den / config.frame_rate_num;
+        if (write_access_unit(
+                &w, file, SmolRTSP_MediaFile_access_unit(file, i),
+                (uint32_t)ticks, config.max_packet_size, cache) == -1) {
+            goto fail;
+        }
+    }
+    header.data_size = w.offset - header.data_offset;
+
+    if (write_padding(&w) == -1) {
+        goto fail;
+    }
+    header.packets_offset = w.offset;
+    header.packets_count = w.entries_count;
+    if (write_bytes(&w, w.entries, w.entries_count * sizeof w.entries[0]) ==
+        -1) {
+        goto fail;
+    }
+
+    header.idrs_offset = w.offset;
+    header.idrs_count = w.idrs_count;
+    if (write_bytes(&w, w.idrs, w.idrs_count * sizeof w.idrs[0]) == -1) {
+        goto fail;
+    }
+
+    const char *sprop = SmolRTSP_ParamSetCache_sprop(cache);
+    if (sprop != NULL) {
+        header.sprop_offset = w.offset;
+        header.sprop_len = strlen(sprop);
+        if (write_bytes(&w, sprop, header.sprop_len + 1) == -1) {
+            goto fail;
+        }
+    }
+
+    if (fseek(w.fp, 0, SEEK_SET) == -1 ||
+        fwrite(&header, sizeof header, 1, w.fp) != 1) {
+        goto fail;
+    }
+
+    const int ret = fclose(w.fp);
+    w.fp = NULL;
+    if (ret != 0 || rename(tmp_path, path) == -1) {
+        goto fail;
+    }
+
+    smolrtsp_free(w.entries);
+    smolrtsp_free(w.idrs);
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+    return 0;
+
+fail:;
+    const int saved_errno = errno;
+    if (w.fp != NULL) {
+        fclose(w.fp);
+    }
+    remove(tmp_path);
+    smolrtsp_free(w.entries);
+    smolrtsp_free(w.idrs);
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+    errno = saved_errno;
+    return -1;
+}
+
+SmolRTSP_PacketizedFile *SmolRTSP_PacketizedFile_open(const char *path) {
+    assert(path);
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (-1 == fd) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(FileHeader)) {
+        close(fd);
+        errno = EBADMSG;
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == data) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    // The mapping outlives the descriptor.
+    close(fd);
+
+    FileHeader header;
+    memcpy(&header, data, sizeof header);
+    if (!is_valid(&header, data, (size_t)st.st_size)) {
+        munmap(data, (size_t)st.st_size);
+        errno = EBADMSG;
+        return NULL;
+    }
+
+    SmolRTSP_PacketizedFile *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        munmap(data, (size_t)st.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    const uint8_t *bytes = data;
+    self->codec = (SmolRTSP_NalCodec)header.codec;
+    self->clock_rate = header.clock_rate;
+    self->data = bytes;
+    self->size = (size_t)st.st_size;
+    self->payloads = bytes + header.data_offset;
+    self->entries = (const Entry *)(bytes + header.packets_offset);
+    self->entries_count = (size_t)header.packets_count;
+    self->idrs = (const uint64_t *)(bytes + header.idrs_offset);
+    self->idrs_count = (size_t)header.idrs_count;
+    self->sprop = header.sprop_len > 0
+                      ? (const char *)(bytes + header.sprop_offset)
+                      : NULL;
+
+    // A corrupted table must not point outside of the payloads.
+    for (size_t i = 0; i < self->entries_count; i++) {
+        if (!is_within(
+                self->entries[i].offset, self->entries[i].len,
+                (size_t)header.data_size)) {
+            goto fail;
+        }
+    }
+    for (size_t i = 0; i < self->idrs_count; i++) {
+        if (self->idrs[i] >= self->entries_count ||
+            (i > 0 && self->idrs[i] <= self->idrs[i - 1])) {
+            goto fail;
+        }
+    }
+
+    return self;
+
+fail:
+    VTABLE(SmolRTSP_PacketizedFile, SmolRTSP_Droppable).drop(self);
+    errno = EBADMSG;
+    return NULL;
+}
+
+SmolRTSP_NalCodec
+SmolRTSP_PacketizedFile_codec(const SmolRTSP_PacketizedFile *self) {
+    assert(self);
+    return self->codec;
+}
+
+uint32_t
+SmolRTSP_PacketizedFile_clock_rate(const SmolRTSP_PacketizedFile *self) {
+    assert(self);
+    return self->clock_rate;
+}
+
+const char *
+SmolRTSP_PacketizedFile_sprop(const SmolRTSP_PacketizedFile *self) {
+    assert(self);
+    return self->sprop;
+}
+
+size_t
+SmolRTSP_PacketizedFile_packets_count(const SmolRTSP_PacketizedFile *self) {
+    assert(self);
+    return self->entries_count;
+}
+
+SmolRTSP_PacketizedPacket SmolRTSP_PacketizedFile_packet(
+    const SmolRTSP_PacketizedFile *self, size_t i) {
+    assert(self);
+    assert(i < self->entries_count);
+
+    const Entry entry = self->entries[i];
+
+    return (SmolRTSP_PacketizedPacket){
+        .payload = U8Slice99_new(
+            (uint8_t *)self->payloads + entry.offset, entry.len),
+        .timestamp = entry.timestamp,
+        .marker = entry.flags & ENTRY_MARKER,
+        .is_idr = entry.flags & ENTRY_IDR,
+    };
+}
+
+ssize_t SmolRTSP_PacketizedFile_seek(
+    const SmolRTSP_PacketizedFile *self, uint64_t npt_ms) {
+    assert(self);
+
+    const uint64_t ticks = npt_ms > UINT64_MAX / self->clock_rate
+                               ? UINT64_MAX
+                               : npt_ms * self->clock_rate / 1000;
+
+    // The last IDR access unit whose timestamp is at or before `ticks`.
+    size_t lo = 0, hi = self->idrs_count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (self->entries[self->idrs[mid]].timestamp <= ticks) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return 0 == lo ? -1 : (ssize_t)self->idrs[lo - 1];
+}
+
+int SmolRTSP_PacketizedFile_send(
+    const SmolRTSP_PacketizedFile *self, SmolRTSP_RtpTransport *t, size_t first,
+    size_t count, uint32_t ts_offset) {
+    assert(self);
+    assert(t);
+    assert(first <= self->entries_count);
+    assert(count <= self->entries_count - first);
+
+    SmolRTSP_RtpPacket packets[PACKETS_BATCH_SIZE];
+    const size_t end = first + count;
+
+    for (size_t i = first; i < end;) {
+        const uint32_t timestamp = self->entries[i].timestamp;
+
+        size_t n = 0;
+        for (; i < end && n < PACKETS_BATCH_SIZE &&
+               self->entries[i].timestamp == timestamp;
+             i++, n++) {
+            const Entry entry = self->entries[i];
+            packets[n] = (SmolRTSP_RtpPacket){
+                .marker = entry.flags & ENTRY_MARKER,
+                .payload_header = U8Slice99_empty(),
+                .payload = U8Slice99_new(
+                    (uint8_t *)self->payloads + entry.offset, entry.len),
+            };
+        }
+
+        if (SmolRTSP_RtpTransport_send_batch(
+                t, SmolRTSP_RtpTimestamp_Raw(ts_offset + timestamp),
+                SmolRTSP_RtpPacketSlice_new(packets, n)) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void SmolRTSP_PacketizedFile_drop(VSelf) {
+    VSELF(SmolRTSP_PacketizedFile);
+    assert(self);
+
+    munmap((void *)self->data, self->size);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_PacketizedFile);
+
+static int write_access_unit(
+    Writer *w, const SmolRTSP_MediaFile *file, SmolRTSP_AccessUnit au,
+    uint32_t timestamp, size_t max_packet_size, SmolRTSP_ParamSetCache *cache) {
+    if (au.is_idr) {
+        if (push_idr(w, w->entries_count) == -1) {
+            return -1;
+        }
+        w->idr_pending = true;
+    }
+
+    for (size_t i = 0; i < au.nalus_count; i++) {
+        const SmolRTSP_NalUnit nalu =
+            SmolRTSP_MediaFile_nalu(file, au.first_nalu + i);
+        if (SmolRTSP_ParamSetCache_update(cache, nalu) == -1) {
+            return -1;
+        }
+
+        const SmolRTSP_NalHeaderInfo info =
+            SmolRTSP_NalHeaderInfo_new(nalu.header);
+        // The packetizer bounds the bytes of a NAL unit after the FU header.
+        SmolRTSP_NalPacketizer packetizer;
+        SmolRTSP_NalPacketizer_init(
+            &packetizer, nalu, &info, max_packet_size - info.fu_size,
+            au.nalus_count - 1 == i);
+
+        SmolRTSP_RtpPacket packets[PACKETS_BATCH_SIZE];
+        size_t n;
+        while ((n = SmolRTSP_NalPacketizer_next(
+                    &packetizer, PACKETS_BATCH_SIZE, packets)) > 0) {
+            for (size_t j = 0; j < n; j++) {
+                const Entry entry = {
+                    .offset = w->offset - w->data_offset,
+                    .timestamp = timestamp,
+                    .len = (uint16_t)(packets[j].payload_header.len +
+                                      packets[j].payload.len),
+                    .flags = (uint16_t)((packets[j].marker ? ENTRY_MARKER : 0) |
+                                        (w->idr_pending ? ENTRY_IDR : 0)),
+                };
+                w->idr_pending = false;
+
+                if (write_bytes(
+                        w, packets[j].payload_header.ptr,
+                        packets[j].payload_header.len) == -1 ||
+                    write_bytes(
+                        w, packets[j].payload.ptr, packets[j].payload.len) ==
+                        -1 ||
+                    push_entry(w, entry) == -1) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int write_bytes(Writer *w, const void *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, w->fp) != len) {
+        return -1;
+    }
+
+    w->offset += len;
+    return 0;
+}
+
+static int write_padding(Writer *w) {
+    static const uint8_t zeros[TABLE_ALIGNMENT] = {0};
+
+    return write_bytes(
+        w, zeros,
+        (TABLE_ALIGNMENT - w->offset % TABLE_ALIGNMENT) % TABLE_ALIGNMENT);
+}
+
+static int push_entry(Writer *w, Entry entry) {
+    if (w->entries_count == w->entries_cap) {
+        const size_t cap = w->entries_cap > 0 ? w->entries_cap * 2 : 1024;
+        Entry *entries =
+            smolrtsp_realloc(w->entries, cap * sizeof w->entries[0]);
+        if (NULL == entries) {
+            errno = ENOMEM;
+            return -1;
+        }
+        w->entries = entries;
+        w->entries_cap = cap;
+    }
+
+    w->entries[w->entries_count++] = entry;
+    return 0;
+}
+
+static int push_idr(Writer *w, uint64_t packet) {
+    if (w->idrs_count == w->idrs_cap) {
+        const size_t cap = w->idrs_cap > 0 ? w->idrs_cap * 2 : 64;
+        uint64_t *idrs = smolrtsp_realloc(w->idrs, cap * sizeof w->idrs[0]);
+        if (NULL == idrs) {
+            errno = ENOMEM;
+            return -1;
+        }
+        w->idrs = idrs;
+        w->idrs_cap = cap;
+    }
+
+    w->idrs[w->idrs_count++] = packet;
+    return 0;
+}
+
+static bool
+is_valid(const FileHeader *header, const uint8_t *data, size_t size) {
+    if (memcmp(header->magic, FILE_MAGIC, sizeof header->magic) != 0 ||
+        header->version != SMOLRTSP_PACKETIZED_FILE_VERSION ||
+        header->byte_order != FILE_BYTE_ORDER ||
+        header->entry_size != sizeof(Entry) ||
+        (header->codec != SmolRTSP_NalCodec_H264 &&
+         header->codec != SmolRTSP_NalCodec_H265) ||
+        0 == header->clock_rate) {
+        return false;
+    }
+
+    if (!is_within(header->data_offset, header->data_size, size) ||
+        header->packets_count > size / sizeof(Entry) ||
+        !is_within(
+            header->packets_offset, header->packets_count * sizeof(Entry),
+            size) ||
+        header->idrs_count > size / sizeof(uint64_t) ||
+        !is_within(
+            header->idrs_offset, header->idrs_count * sizeof(uint64_t),
+            size) ||
+        header->packets_offset % TABLE_ALIGNMENT != 0 ||
+        header->idrs_offset % TABLE_ALIGNMENT != 0) {
+        return false;
+    }
+
+    // The `sprop` string must be terminated where the header says.
+    return 0 == header->sprop_len ||
+           (header->sprop_len < size &&
+            is_within(header->sprop_offset, header->sprop_len + 1, size) &&
+            '\0' == data[header->sprop_offset + header->sprop_len]);
+}
+
+static bool is_within(uint64_t offset, uint64_t len, size_t size) {
+    return offset <= size && len <= size - offset;
+}
@@ -0,0 +1,247 @@
+#include <smolrtsp/param_set_cache.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    PARAM_SET_VPS,
+    PARAM_SET_SPS,
+    PARAM_SET_PPS,
+    PARAM_SETS_COUNT,
+};
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} ParamSet;
+
+struct SmolRTSP_ParamSetCache {
+    SmolRTSP_NalCodec codec;
+    ParamSet sets[PARAM_SETS_COUNT];
+    uint32_t version;
+
+    // `NULL` if the cache is not complete.
+    char *sprop;
+};
+
+static int encode_sprop(SmolRTSP_ParamSetCache *self);
+static size_t base64_len(size_t len);
+static char *base64_encode(char *out, const ParamSet *set);
+
+SmolRTSP_ParamSetCache *SmolRTSP_ParamSetCache_new(void) {
+    SmolRTSP_ParamSetCache *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->codec = SmolRTSP_NalCodec_H264;
+    for (size_t i = 0; i < PARAM_SETS_COUNT; i++) {
+        self->sets[i] = (ParamSet){NULL, 0};
+    }
+    self->version = 0;
+    self->sprop = NULL;
+
+    return self;
+}
+
+static void SmolRTSP_ParamSetCache_drop(VSelf) {
+    VSELF(SmolRTSP_ParamSetCache);
+    assert(self);
+
+    for (size_t i = 0; i < PARAM_SETS_COUNT; i++) {
+        smolrtsp_free(self->sets[i].data);
+    }
+    smolrtsp_free(self->sprop);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_ParamSetCache);
+
+int SmolRTSP_ParamSetCache_update(
+    SmolRTSP_ParamSetCache *self, SmolRTSP_NalUnit nalu) {
+    assert(self);
+
+    int kind;
+    if (SmolRTSP_NalHeader_is_vps(nalu.header)) {
+        kind = PARAM_SET_VPS;
+    } else if (SmolRTSP_NalHeader_is_sps(nalu.header)) {
+        kind = PARAM_SET_SPS;
+    } else if (SmolRTSP_NalHeader_is_pps(nalu.header)) {
+        kind = PARAM_SET_PPS;
+    } else {
+        return 0;
+    }
+
+    const size_t header_size = SmolRTSP_NalHeader_size(nalu.header),
+                 len = header_size + nalu.payload.len;
+    uint8_t header[SMOLRTSP_H265_NAL_HEADER_SIZE];
+    SmolRTSP_NalHeader_serialize(nalu.header, header);
+
+    ParamSet *set = &self->sets[kind];
+    if (set->len == len && memcmp(set->data, header, header_size) == 0 &&
+        (0 == nalu.payload.len ||
+         memcmp(set->data + header_size, nalu.payload.ptr, nalu.payload.len) ==
+             0)) {
+        return 0;
+    }
+
+    // The old parameter set is kept until the new SDP representation is
+    // encoded, so that the cache stays as it is if anything fails.
+    uint8_t *data = smolrtsp_malloc(len);
+    if (NULL == data) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(data, header, header_size);
+    if (nalu.payload.len > 0) {
+        memcpy(data + header_size, nalu.payload.ptr, nalu.payload.len);
+    }
+
+    const ParamSet old_set = *set;
+    const SmolRTSP_NalCodec old_codec = self->codec;
+    *set = (ParamSet){data, len};
+    self->codec = MATCHES(nalu.header, SmolRTSP_NalHeader_H264)
+                      ? SmolRTSP_NalCodec_H264
+                      : SmolRTSP_NalCodec_H265;
+
+    if (encode_sprop(self) == -1) {
+        *set = old_set;
+        self->codec = old_codec;
+        smolrtsp_free(data);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    smolrtsp_free(old_set.data);
+    self->version++;
+
+    return 1;
+}
+
+U8Slice99 SmolRTSP_ParamSetCache_vps(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+    const ParamSet set = self->sets[PARAM_SET_VPS];
+    return U8Slice99_new(set.data, set.len);
+}
+
+U8Slice99 SmolRTSP_ParamSetCache_sps(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+    const ParamSet set = self->sets[PARAM_SET_SPS];
+    return U8Slice99_new(set.data, set.len);
+}
+
+U8Slice99 SmolRTSP_ParamSetCache_pps(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+    const ParamSet set = self->sets[PARAM_SET_PPS];
+    return U8Slice99_new(set.data, set.len);
+}
+
+bool SmolRTSP_ParamSetCache_is_complete(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+
+    return self->sets[PARAM_SET_SPS].len > 0 &&
+           self->sets[PARAM_SET_PPS].len > 0 &&
+           (SmolRTSP_NalCodec_H264 == self->codec ||
+            self->sets[PARAM_SET_VPS].len > 0);
+}
+
+uint32_t SmolRTSP_ParamSetCache_version(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+    return self->version;
+}
+
+const char *SmolRTSP_ParamSetCache_sprop(const SmolRTSP_ParamSetCache *self) {
+    assert(self);
+    return self->sprop;
+}
+
+// Replaces `self->sprop`, which is kept on failure.
+static int encode_sprop(SmolRTSP_ParamSetCache *self) {
+    if (!SmolRTSP_ParamSetCache_is_complete(self)) {
+        smolrtsp_free(self->sprop);
+        self->sprop = NULL;
+        return 0;
+    }
+
+    const ParamSet *vps = &self->sets[PARAM_SET_VPS],
+                   *sps = &self->sets[PARAM_SET_SPS],
+                   *pps = &self->sets[PARAM_SET_PPS];
+
+    static const char h264_key[] = "sprop-parameter-sets=",
+                      vps_key[] = "sprop-vps=", sps_key[] = ";sprop-sps=",
+                      pps_key[] = ";sprop-pps=";
+
+    // The lengths of the keys and separators, plus the null character.
+    const size_t len =
+        SmolRTSP_NalCodec_H264 == self->codec
+            ? sizeof h264_key + base64_len(sps->len) + 1 + base64_len(pps->len)
+            : sizeof vps_key + base64_len(vps->len) + sizeof sps_key - 1 +
+                  base64_len(sps->len) + sizeof pps_key - 1 +
+                  base64_len(pps->len);
+
+    char *sprop = smolrtsp_malloc(len);
+    if (NULL == sprop) {
+        return -1;
+    }
+
+    char *out = sprop;
+    if (SmolRTSP_NalCodec_H264 == self->codec) {
+        out = stpcpy(out, h264_key);
+        out = base64_encode(out, sps);
+        *out++ = ',';
+        out = base64_encode(out, pps);
+    } else {
+        out = stpcpy(out, vps_key);
+        out = base64_encode(out, vps);
+        out = stpcpy(out, sps_key);
+        out = base64_encode(out, sps);
+        out = stpcpy(out, pps_key);
+        out = base64_encode(out, pps);
+    }
+    *out = '\0';
+
+    assert((size_t)(out - sprop) + 1 == len);
+    smolrtsp_free(self->sprop);
+    self->sprop = sprop;
+    return 0;
+}
+
+static size_t base64_len(size_t len) {
+    return (len + 2) / 3 * 4;
+}
+
+// Writes the base64 representation of `set` to `out` (not null-terminated)
+// and returns the end of the written data.
+static char *base64_encode(char *out, const ParamSet *set) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    const uint8_t *data = set->data;
+    size_t i = 0;
+
+    for (; i + 3 <= set->len; i += 3) {
+        const uint32_t n = (uint32_t)data[i] << 16 |
+                           (uint32_t)data[i + 1] << 8 | data[i + 2];
+        *out++ = alphabet[(n >> 18) & 0x3F];
+        *out++ = alphabet[(n >> 12) & 0x3F];
+        *out++ = alphabet[(n >> 6) & 0x3F];
+        *out++ = alphabet[n & 0x3F];
+    }
+
+    const size_t rest = set->len - i;
+    if (rest > 0) {
+        const uint32_t n = (uint32_t)data[i] << 16 |
+                           (2 == rest ? (uint32_t)data[i + 1] << 8 : 0);
+        *out++ = alphabet[(n >> 18) & 0x3F];
+        *out++ = alphabet[(n >> 12) & 0x3F];
+        *out++ = 2 == rest ? alphabet[(n >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+
+    return out;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Static tracepoints (USDT) of the `smolrtsp` provider, compiled in if
+// `SMOLRTSP_USDT` is defined (see the `SMOLRTSP_USDT` CMake option). A probe is
+// a single `nop` until a tracer such as `bpftrace` attaches to it, e.g.:
+//
+//     bpftrace -e 'usdt:./server:smolrtsp:rtp_packet { @[arg0] = count(); }'
+//
+// The probes and their arguments:
+//
+//  - `request_parse_start(input, input_len, offset)`: `offset` is where the
+//    parser resumes.
+//  - `request_parse_end(status, offset)`: `status` is 0 on a complete request
+//    (then `offset` is its size), 1 on a partial one, and -1 on failure.
+//  - `dispatch_entry(method, method_len, cseq)` and `dispatch_exit(cseq, ret)`:
+//    `ret` is the result of `SmolRTSP_Context_get_ret`.
+//  - `nalu_send_start(unit_type, size, timestamp)` and `nalu_send_end(ret)`:
+//    `size` includes the NAL header; `ret` is 0 if the NAL unit is sent (or
+//    held back for aggregation), 1 if it is dropped by the backpressure
+//    policy, and -1 on failure. `timestamp` is the value of
+//    `SmolRTSP_RtpTimestamp` as passed by the caller.
+//    `SmolRTSP_NalTransport_send_access_unit` fires one pair per NAL unit too,
+//    but sends its NAL units in a single batch: first come the starts of all
+//    of them (a dropped one is ended right away), then the ends of the others.
+//  - `rtp_packet(ssrc, seq_num, timestamp, size, ret)`: `size` excludes the RTP
+//    header.
+//  - `udp_transmit(fd, packets, sent, bytes, error)` and
+//    `tcp_transmit(channel_id, packets, sent, bytes, error)`: `sent` out of
+//    `packets` packets (-1 if none for UDP) of `bytes` bytes in total are
+//    transmitted; `error` is `errno` on failure or 0.
+
+#ifdef SMOLRTSP_USDT
+
+#include <sys/sdt.h>
+
+#define SMOLRTSP_PROBES_ENABLED 1
+#define SMOLRTSP_PROBE(...)     STAP_PROBEV(smolrtsp, __VA_ARGS__)
+
+#else
+
+#define SMOLRTSP_PROBES_ENABLED 0
+#define SMOLRTSP_PROBE(...)     ((void)0)
+
+#endif // SMOLRTSP_USDT
@@ -0,0 +1,58 @@
+#include <smolrtsp/rtp_clock.h>
+
+#include <assert.h>
+
+#define US_PER_SEC UINT64_C(1000000)
+
+static uint64_t ticks(uint32_t clock_rate, uint64_t us);
+
+SmolRTSP_RtpClock SmolRTSP_RtpClock_new(uint32_t clock_rate) {
+    return SmolRTSP_RtpClock_with_epoch(clock_rate, 0, 0, 0);
+}
+
+SmolRTSP_RtpClock SmolRTSP_RtpClock_with_epoch(
+    uint32_t clock_rate, uint64_t epoch_us, uint32_t rtp_epoch,
+    uint64_t wallclock_epoch_us) {
+    return (SmolRTSP_RtpClock){
+        .clock_rate = clock_rate,
+        .epoch_us = epoch_us,
+        .rtp_epoch = rtp_epoch,
+        .wallclock_epoch_us = wallclock_epoch_us,
+    };
+}
+
+uint32_t
+SmolRTSP_RtpClock_timestamp(const SmolRTSP_RtpClock *self, uint64_t time_us) {
+    assert(self);
+
+    // RTP timestamps wrap around, so the result is taken modulo 2^32.
+    if (time_us >= self->epoch_us) {
+        return self->rtp_epoch +
+               (uint32_t)ticks(self->clock_rate, time_us - self->epoch_us);
+    }
+
+    return self->rtp_epoch -
+           (uint32_t)ticks(self->clock_rate, self->epoch_us - time_us);
+}
+
+uint64_t SmolRTSP_RtpClock_ntp_timestamp(
+    const SmolRTSP_RtpClock *self, uint64_t time_us) {
+    assert(self);
+
+    return smolrtsp_ntp_timestamp(
+        self->wallclock_epoch_us + (time_us - self->epoch_us));
+}
+
+uint64_t smolrtsp_ntp_timestamp(uint64_t unix_us) {
+    const uint64_t secs = unix_us / US_PER_SEC + SMOLRTSP_NTP_UNIX_EPOCH_DIFF,
+                   us = unix_us % US_PER_SEC;
+
+    return (secs << 32) | ((us << 32) / US_PER_SEC);
+}
+
+// Splitting into whole seconds and a remainder keeps the products within 64
+// bits; the divisions by a constant are lowered to multiply-shift sequences.
+static uint64_t ticks(uint32_t clock_rate, uint64_t us) {
+    return (us / US_PER_SEC) * clock_rate +
+           (us % US_PER_SEC) * clock_rate / US_PER_SEC;
+}
@@ -0,0 +1,366 @@
+#include <smolrtsp/rtp_depacketizer.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+
+#define H264_STAP_A_UNIT_TYPE 24
+#define H264_FU_A_UNIT_TYPE   28
+
+#ifndef SMOLRTSP_NO_H265
+#define H265_AP_UNIT_TYPE 48
+#define H265_FU_UNIT_TYPE 49
+#endif
+
+#define FU_START_MASK 0x80
+#define FU_END_MASK   0x40
+
+// The size of the NAL unit size field of aggregation packets.
+#define AGGREGATION_SIZE_LEN 2
+
+// The number of consecutive packets behind `next_seq_num` after which the
+// stream is assumed to have restarted, rather than being reordered.
+#define MAX_LATE_PACKETS 8
+
+struct SmolRTSP_RtpDepacketizer {
+    SmolRTSP_NalCodec codec;
+
+    // The sequence number of the next packet and the SSRC of the stream,
+    // valid if `has_seq_num`.
+    uint16_t next_seq_num;
+    uint32_t ssrc;
+    bool has_seq_num;
+
+    // The number of packets discarded as late since the last accepted one.
+    size_t late_packets;
+
+    // A NAL unit to be returned by `next`, or an empty slice.
+    U8Slice99 pending;
+
+    // The unread part of an aggregation packet.
+    U8Slice99 aggregate;
+
+    // The fragmented NAL unit being reassembled, of at most `capacity` bytes.
+    uint8_t *buffer;
+    size_t buffer_len, capacity;
+    bool in_fragment;
+
+    // The number of packets in `buffer`.
+    uint64_t fragment_packets;
+
+    SmolRTSP_RtpDepacketizerStats stats;
+};
+
+static void depacketize_h264(SmolRTSP_RtpDepacketizer *self, U8Slice99 payload);
+#ifndef SMOLRTSP_NO_H265
+static void depacketize_h265(SmolRTSP_RtpDepacketizer *self, U8Slice99 payload);
+#endif
+static void fragment(
+    SmolRTSP_RtpDepacketizer *self, const uint8_t *nal_header,
+    size_t nal_header_len, uint8_t fu_header, U8Slice99 data);
+static void abandon_fragment(SmolRTSP_RtpDepacketizer *self);
+static bool make_nalu(
+    SmolRTSP_RtpDepacketizer *self, U8Slice99 data,
+    SmolRTSP_NalUnit *restrict nalu);
+
+SmolRTSP_RtpDepacketizer *
+SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec codec, size_t max_nalu_size) {
+    assert(max_nalu_size > 0);
+
+#ifdef SMOLRTSP_NO_H265
+    if (SmolRTSP_NalCodec_H265 == codec) {
+        errno = EINVAL;
+        return NULL;
+    }
+#endif
+
+    SmolRTSP_RtpDepacketizer *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    uint8_t *buffer = smolrtsp_malloc(max_nalu_size);
+    if (NULL == buffer) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *self = (SmolRTSP_RtpDepacketizer){
+        .codec = codec,
+        .next_seq_num = 0,
+        .ssrc = 0,
+        .has_seq_num = false,
+        .late_packets = 0,
+        .pending = U8Slice99_empty(),
+        .aggregate = U8Slice99_empty(),
+        .buffer = buffer,
+        .buffer_len = 0,
+        .capacity = max_nalu_size,
+        .in_fragment = false,
+        .fragment_packets = 0,
+        .stats = {0},
+    };
+
+    return self;
+}
+
+static void SmolRTSP_RtpDepacketizer_drop(VSelf) {
+    VSELF(SmolRTSP_RtpDepacketizer);
+    assert(self);
+
+    smolrtsp_free(self->buffer);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_RtpDepacketizer);
+
+int SmolRTSP_RtpDepacketizer_feed(
+    SmolRTSP_RtpDepacketizer *self, U8Slice99 packet,
+    SmolRTSP_RtpHeader *restrict header) {
+    assert(self);
+    assert(header);
+
+    self->pending = U8Slice99_empty();
+    self->aggregate = U8Slice99_empty();
+
+    if (SmolRTSP_RtpHeader_parse(&packet, header) == -1) {
+        return -1;
+    }
+
+    const uint16_t seq_num = ntohs(header->sequence_number);
+    if (self->has_seq_num && header->ssrc != self->ssrc) {
+        // A new stream (e.g., a restarted sender), whose numbering starts over.
+        abandon_fragment(self);
+        self->has_seq_num = false;
+    }
+
+    if (self->has_seq_num && seq_num != self->next_seq_num) {
+        const uint16_t gap = (uint16_t)(seq_num - self->next_seq_num);
+        if (gap < 0x8000) {
+            self->stats.lost_packets += gap;
+        } else if (++self->late_packets < MAX_LATE_PACKETS) {
+            // A reordered or duplicated packet, which has been given up on.
+            self->stats.discarded_packets++;
+            return 0;
+        }
+        // Otherwise, the sequence numbers have jumped backwards; they are
+        // resynchronized at this packet.
+
+        abandon_fragment(self);
+    }
+    self->next_seq_num = seq_num + 1;
+    self->ssrc = header->ssrc;
+    self->has_seq_num = true;
+    self->late_packets = 0;
+
+    switch (self->codec) {
+    case SmolRTSP_NalCodec_H264:
+        depacketize_h264(self, packet);
+        break;
+    case SmolRTSP_NalCodec_H265:
+#ifndef SMOLRTSP_NO_H265
+        depacketize_h265(self, packet);
+#endif
+        break;
+    }
+
+    return 0;
+}
+
+bool SmolRTSP_RtpDepacketizer_next(
+    SmolRTSP_RtpDepacketizer *self, SmolRTSP_NalUnit *restrict nalu) {
+    assert(self);
+    assert(nalu);
+
+    if (!U8Slice99_is_empty(self->pending)) {
+        const U8Slice99 data = self->pending;
+        self->pending = U8Slice99_empty();
+        if (make_nalu(self, data, nalu)) {
+            return true;
+        }
+    }
+
+    /*
+     *  0                   1                   2                   3
+     *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |         NALU 1 Size           |            NALU 1             |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               |
+     * |                               |         NALU 2 Size           |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |                            NALU 2                             |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     */
+    while (!U8Slice99_is_empty(self->aggregate)) {
+        const U8Slice99 rest = self->aggregate;
+        const size_t size =
+            rest.len < AGGREGATION_SIZE_LEN
+                ? 0
+                : (size_t)rest.ptr[0] << 8 | (size_t)rest.ptr[1];
+        if (0 == size || rest.len - AGGREGATION_SIZE_LEN < size) {
+            self->stats.discarded_packets++;
+            self->aggregate = U8Slice99_empty();
+            break;
+        }
+
+        const size_t end = AGGREGATION_SIZE_LEN + size;
+        const U8Slice99 data = U8Slice99_sub(rest, AGGREGATION_SIZE_LEN, end);
+        self->aggregate = U8Slice99_advance(rest, end);
+        if (make_nalu(self, data, nalu)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SmolRTSP_RtpDepacketizerStats
+SmolRTSP_RtpDepacketizer_stats(const SmolRTSP_RtpDepacketizer *self) {
+    assert(self);
+    return self->stats;
+}
+
+static void
+depacketize_h264(SmolRTSP_RtpDepacketizer *self, U8Slice99 payload) {
+    if (U8Slice99_is_empty(payload)) {
+        self->stats.discarded_packets++;
+        return;
+    }
+
+    const uint8_t unit_type = payload.ptr[0] & 0x1F;
+
+    if (H264_FU_A_UNIT_TYPE == unit_type) {
+        if (payload.len < SMOLRTSP_H264_FU_HEADER_SIZE) {
+            abandon_fragment(self);
+            self->stats.discarded_packets++;
+            return;
+        }
+
+        // The NAL header is restored from the F and NRI bits of the FU
+        // indicator and the type of the FU header.
+        const uint8_t fu_header = payload.ptr[1],
+                      nal_header = (payload.ptr[0] & 0xE0) | (fu_header & 0x1F);
+        fragment(
+            self, &nal_header, SMOLRTSP_H264_NAL_HEADER_SIZE, fu_header,
+            U8Slice99_advance(payload, SMOLRTSP_H264_FU_HEADER_SIZE));
+        return;
+    }
+
+    abandon_fragment(self);
+
+    if (unit_type >= 1 && unit_type < H264_STAP_A_UNIT_TYPE) {
+        self->pending = payload;
+    } else if (H264_STAP_A_UNIT_TYPE == unit_type) {
+        self->aggregate =
+            U8Slice99_advance(payload, SMOLRTSP_H264_NAL_HEADER_SIZE);
+    } else {
+        self->stats.discarded_packets++;
+    }
+}
+
+#ifndef SMOLRTSP_NO_H265
+
+static void
+depacketize_h265(SmolRTSP_RtpDepacketizer *self, U8Slice99 payload) {
+    if (payload.len < SMOLRTSP_H265_NAL_HEADER_SIZE) {
+        self->stats.discarded_packets++;
+        return;
+    }
+
+    const uint8_t unit_type = (payload.ptr[0] >> 1) & 0x3F;
+
+    if (H265_FU_UNIT_TYPE == unit_type) {
+        if (payload.len < SMOLRTSP_H265_FU_HEADER_SIZE) {
+            abandon_fragment(self);
+            self->stats.discarded_packets++;
+            return;
+        }
+
+        // The NAL header is the payload header with the type of the FU
+        // header.
+        const uint8_t fu_header = payload.ptr[2];
+        const uint8_t nal_header[] = {
+            (payload.ptr[0] & 0x81) | (uint8_t)((fu_header & 0x3F) << 1),
+            payload.ptr[1],
+        };
+        fragment(
+            self, nal_header, SMOLRTSP_H265_NAL_HEADER_SIZE, fu_header,
+            U8Slice99_advance(payload, SMOLRTSP_H265_FU_HEADER_SIZE));
+        return;
+    }
+
+    abandon_fragment(self);
+
+    if (unit_type < H265_AP_UNIT_TYPE) {
+        self->pending = payload;
+    } else if (H265_AP_UNIT_TYPE == unit_type) {
+        self->aggregate =
+            U8Slice99_advance(payload, SMOLRTSP_H265_NAL_HEADER_SIZE);
+    } else {
+        self->stats.discarded_packets++;
+    }
+}
+
+#endif // SMOLRTSP_NO_H265
+
+static void fragment(
+    SmolRTSP_RtpDepacketizer *self, const uint8_t *nal_header,
+    size_t nal_header_len, uint8_t fu_header, U8Slice99 data) {
+    const bool is_start = fu_header & FU_START_MASK;
+    if (is_start) {
+        abandon_fragment(self);
+        self->buffer_len = 0;
+        self->fragment_packets = 0;
+        self->in_fragment = true;
+    } else if (!self->in_fragment) {
+        // The start of this NAL unit has been lost.
+        self->stats.discarded_packets++;
+        return;
+    }
+
+    const size_t header_len = is_start ? nal_header_len : 0;
+    if (self->capacity - self->buffer_len < header_len + data.len) {
+        self->fragment_packets++;
+        abandon_fragment(self);
+        return;
+    }
+
+    memcpy(self->buffer + self->buffer_len, nal_header, header_len);
+    self->buffer_len += header_len;
+    memcpy(self->buffer + self->buffer_len, data.ptr, data.len);
+    self->buffer_len += data.len;
+    self->fragment_packets++;
+
+    if (fu_header & FU_END_MASK) {
+        self->pending = U8Slice99_new(self->buffer, self->buffer_len);
+        self->in_fragment = false;
+        self->fragment_packets = 0;
+        self->stats.reassembled_nalus++;
+    }
+}
+
+static void abandon_fragment(SmolRTSP_RtpDepacketizer *self) {
+    if (self->in_fragment) {
+        self->stats.discarded_packets += self->fragment_packets;
+        self->in_fragment = false;
+        self->fragment_packets = 0;
+    }
+}
+
+static bool make_nalu(
+    SmolRTSP_RtpDepacketizer *self, U8Slice99 data,
+    SmolRTSP_NalUnit *restrict nalu) {
+    if (data.len < SmolRTSP_NalCodec_header_size(self->codec)) {
+        return false;
+    }
+
+    *nalu = SmolRTSP_NalUnit_parse(self->codec, data);
+    self->stats.nalus++;
+    return true;
+}
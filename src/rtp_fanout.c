@@ -0,0 +1,412 @@
+#include <smolrtsp/rtp_fanout.h>
+
+#include <smolrtsp/rtp_depacketizer.h>
+
+#include "alloc.h"
+#include "nal_packetizer.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <arpa/inet.h>
+
+#include <slice99.h>
+
+// The number of packets produced by one packetizer step.
+#define PACKETS_CHUNK_SIZE 64
+
+// The maximum size of a NAL unit reassembled for repacketization by
+// `SmolRTSP_RtpFanout_relay_packet`.
+#define RELAY_MAX_NALU_SIZE (1024 * 1024)
+
+typedef struct {
+    SmolRTSP_RtpTransport *transport;
+    uint32_t ts_offset;
+} Subscriber;
+
+struct SmolRTSP_RtpFanout {
+    uint32_t clock_rate;
+    SmolRTSP_NalTransportConfig config;
+
+    Subscriber *subscribers;
+    size_t subscribers_count, subscribers_capacity;
+
+    // The packet list of the current NAL unit, reused between calls.
+    SmolRTSP_RtpPacket *packets;
+    size_t packets_capacity;
+
+    // Reassembles the relayed NAL units for the subscribers that cannot take
+    // the packets as they are; created on demand.
+    SmolRTSP_RtpDepacketizer *depacketizer;
+    SmolRTSP_NalCodec depacketizer_codec;
+
+    // The sequence number expected next from the relayed stream.
+    bool relaying;
+    uint16_t relay_seq_num;
+};
+
+static int send_unit(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker);
+static int packetize(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalPacketizer *packetizer,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info,
+    size_t max_packet_size, bool marker,
+    SmolRTSP_RtpPacketSlice *restrict packets);
+static size_t
+max_nalu_size(const SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec);
+static bool is_relayed_as_is(
+    const SmolRTSP_RtpFanout *self, const Subscriber *sub,
+    SmolRTSP_NalCodec codec);
+static int repacketize(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec, U8Slice99 packet);
+static int reserve_packets(SmolRTSP_RtpFanout *self, size_t capacity);
+
+SmolRTSP_RtpFanout *SmolRTSP_RtpFanout_new(
+    uint32_t clock_rate, SmolRTSP_NalTransportConfig config) {
+    SmolRTSP_RtpFanout *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->clock_rate = clock_rate;
+    self->config = config;
+    self->subscribers = NULL;
+    self->subscribers_count = 0;
+    self->subscribers_capacity = 0;
+    self->packets = NULL;
+    self->packets_capacity = 0;
+    self->depacketizer = NULL;
+    self->depacketizer_codec = SmolRTSP_NalCodec_H264;
+    self->relaying = false;
+    self->relay_seq_num = 0;
+
+    return self;
+}
+
+static void SmolRTSP_RtpFanout_drop(VSelf) {
+    VSELF(SmolRTSP_RtpFanout);
+    assert(self);
+
+    smolrtsp_free(self->subscribers);
+    smolrtsp_free(self->packets);
+    if (self->depacketizer != NULL) {
+        VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable)
+            .drop(self->depacketizer);
+    }
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_RtpFanout);
+
+int SmolRTSP_RtpFanout_subscribe(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTransport *t, uint32_t ts_offset) {
+    assert(self);
+    assert(t);
+
+    if (self->subscribers_count == self->subscribers_capacity) {
+        const size_t capacity = 0 == self->subscribers_capacity
+                                    ? 4
+                                    : self->subscribers_capacity * 2;
+        Subscriber *subscribers = smolrtsp_realloc(
+            self->subscribers, capacity * sizeof subscribers[0]);
+        if (NULL == subscribers) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->subscribers = subscribers;
+        self->subscribers_capacity = capacity;
+    }
+
+    self->subscribers[self->subscribers_count++] = (Subscriber){
+        .transport = t,
+        .ts_offset = ts_offset,
+    };
+    return 0;
+}
+
+bool SmolRTSP_RtpFanout_unsubscribe(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTransport *t) {
+    assert(self);
+
+    for (size_t i = 0; i < self->subscribers_count; i++) {
+        if (self->subscribers[i].transport == t) {
+            self->subscribers[i] =
+                self->subscribers[--self->subscribers_count];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t SmolRTSP_RtpFanout_subscribers_count(const SmolRTSP_RtpFanout *self) {
+    assert(self);
+    return self->subscribers_count;
+}
+
+int SmolRTSP_RtpFanout_send_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu) {
+    assert(self);
+
+    const SmolRTSP_NalHeaderInfo info = SmolRTSP_NalHeaderInfo_new(nalu.header);
+
+    return send_unit(self, ts, nalu, &info, info.is_vcl);
+}
+
+int SmolRTSP_RtpFanout_send_au_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, bool end_of_access_unit) {
+    assert(self);
+
+    const SmolRTSP_NalHeaderInfo info = SmolRTSP_NalHeaderInfo_new(nalu.header);
+
+    return send_unit(self, ts, nalu, &info, end_of_access_unit);
+}
+
+int SmolRTSP_RtpFanout_relay_packet(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec, U8Slice99 packet) {
+    assert(self);
+
+    U8Slice99 payload = packet;
+    SmolRTSP_RtpHeader header;
+    if (SmolRTSP_RtpHeader_parse(&payload, &header) == -1) {
+        return -1;
+    }
+
+    const uint16_t seq_num = ntohs(header.sequence_number);
+    const uint16_t gap =
+        self->relaying ? (uint16_t)(seq_num - self->relay_seq_num) : 0;
+    if (gap >= 0x8000) {
+        // A reordered or duplicated packet, out of place in the subscribers'
+        // numbering.
+        return 0;
+    }
+    self->relaying = true;
+    self->relay_seq_num = seq_num + 1;
+
+    const uint32_t timestamp = ntohl(header.timestamp);
+
+    int result = 0, saved_errno = 0;
+    bool need_repacketization = false;
+    for (size_t i = 0; i < self->subscribers_count; i++) {
+        const Subscriber sub = self->subscribers[i];
+
+        if (!is_relayed_as_is(self, &sub, codec)) {
+            need_repacketization = true;
+            continue;
+        }
+
+        // Keep the losses of the source visible to the receivers.
+        if (gap > 0) {
+            SmolRTSP_RtpTransport_skip_seq_nums(sub.transport, gap);
+        }
+
+        if (SmolRTSP_RtpTransport_send_packet(
+                sub.transport,
+                SmolRTSP_RtpTimestamp_Raw(timestamp + sub.ts_offset),
+                header.marker, U8Slice99_empty(), payload) == -1) {
+            result = -1;
+            saved_errno = errno;
+        }
+    }
+
+    if (need_repacketization && repacketize(self, codec, packet) == -1) {
+        result = -1;
+        saved_errno = errno;
+    }
+
+    if (-1 == result) {
+        errno = saved_errno;
+    }
+
+    return result;
+}
+
+static int send_unit(
+    SmolRTSP_RtpFanout *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info, bool marker) {
+    if (0 == self->subscribers_count) {
+        return 0;
+    }
+
+    // Packetize once for all the subscribers.
+    SmolRTSP_NalPacketizer packetizer;
+    SmolRTSP_RtpPacketSlice packets;
+    if (packetize(
+            self, &packetizer, nalu, info, max_nalu_size(self, info->codec),
+            marker, &packets) == -1) {
+        return -1;
+    }
+    const uint32_t timestamp =
+        SmolRTSP_RtpTimestamp_compute(ts, self->clock_rate);
+
+    int result = 0, saved_errno = 0;
+    for (size_t i = 0; i < self->subscribers_count; i++) {
+        const Subscriber sub = self->subscribers[i];
+
+        if (SmolRTSP_RtpTransport_send_batch(
+                sub.transport,
+                SmolRTSP_RtpTimestamp_Raw(timestamp + sub.ts_offset),
+                packets) == -1) {
+            result = -1;
+            saved_errno = errno;
+        }
+    }
+
+    if (-1 == result) {
+        errno = saved_errno;
+    }
+
+    return result;
+}
+
+// The packets written to `packets` point into `packetizer` and `nalu`, and
+// stay valid until the next call.
+static int packetize(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalPacketizer *packetizer,
+    SmolRTSP_NalUnit nalu, const SmolRTSP_NalHeaderInfo *info,
+    size_t max_packet_size, bool marker,
+    SmolRTSP_RtpPacketSlice *restrict packets) {
+    SmolRTSP_NalPacketizer_init(
+        packetizer, nalu, info, max_packet_size, marker);
+
+    // The packets are counted up front, so they are reserved at once.
+    const size_t packets_count = SmolRTSP_NalPacketizer_count(packetizer);
+    if (reserve_packets(self, packets_count) == -1) {
+        return -1;
+    }
+    SmolRTSP_NalPacketizer_range(packetizer, 0, packets_count, self->packets);
+
+    *packets = SmolRTSP_RtpPacketSlice_new(self->packets, packets_count);
+    return 0;
+}
+
+static size_t
+max_nalu_size(const SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec) {
+    return SmolRTSP_NalCodec_H264 == codec ? self->config.max_h264_nalu_size
+                                           : self->config.max_h265_nalu_size;
+}
+
+static bool is_relayed_as_is(
+    const SmolRTSP_RtpFanout *self, const Subscriber *sub,
+    SmolRTSP_NalCodec codec) {
+    const size_t max_payload_size =
+        SmolRTSP_RtpTransport_max_payload_size(sub->transport);
+
+    return 0 == max_payload_size ||
+           max_payload_size >= max_nalu_size(self, codec);
+}
+
+// Depacketizes `packet` and sends its NAL units to the subscribers that cannot
+// take it as it is, packetized anew to fit each of them.
+static int repacketize(
+    SmolRTSP_RtpFanout *self, SmolRTSP_NalCodec codec, U8Slice99 packet) {
+    if (self->depacketizer != NULL && self->depacketizer_codec != codec) {
+        VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable)
+            .drop(self->depacketizer);
+        self->depacketizer = NULL;
+    }
+    if (NULL == self->depacketizer) {
+        self->depacketizer =
+            SmolRTSP_RtpDepacketizer_new(codec, RELAY_MAX_NALU_SIZE);
+        if (NULL == self->depacketizer) {
+            return -1;
+        }
+        self->depacketizer_codec = codec;
+    }
+
+    SmolRTSP_RtpHeader header;
+    if (SmolRTSP_RtpDepacketizer_feed(self->depacketizer, packet, &header) ==
+        -1) {
+        return -1;
+    }
+
+    const uint32_t timestamp = ntohl(header.timestamp);
+
+    int result = 0, saved_errno = 0;
+
+    // Look one NAL unit ahead to put the marker of the packet on the last one.
+    SmolRTSP_NalUnit nalu, next;
+    bool has_nalu = SmolRTSP_RtpDepacketizer_next(self->depacketizer, &nalu);
+    while (has_nalu) {
+        const bool has_next =
+            SmolRTSP_RtpDepacketizer_next(self->depacketizer, &next);
+        const bool marker = header.marker && !has_next;
+        const SmolRTSP_NalHeaderInfo info =
+            SmolRTSP_NalHeaderInfo_new(nalu.header);
+
+        // Subscribers sharing a payload size share the packets as well.
+        SmolRTSP_NalPacketizer packetizer;
+        SmolRTSP_RtpPacketSlice packets = SmolRTSP_RtpPacketSlice_new(NULL, 0);
+        size_t packets_size = 0;
+
+        for (size_t i = 0; i < self->subscribers_count; i++) {
+            const Subscriber sub = self->subscribers[i];
+            if (is_relayed_as_is(self, &sub, codec)) {
+                continue;
+            }
+
+            // An FU packet carries up to `max_packet_size` bytes of the NAL
+            // unit after the FU header.
+            const size_t path_max =
+                SmolRTSP_RtpTransport_max_payload_size(sub.transport);
+            const size_t max_packet_size =
+                path_max > info.fu_size ? path_max - info.fu_size : 1;
+            if (max_packet_size != packets_size) {
+                if (packetize(
+                        self, &packetizer, nalu, &info, max_packet_size,
+                        marker, &packets) == -1) {
+                    result = -1;
+                    saved_errno = errno;
+                    packets_size = 0;
+                    continue;
+                }
+                packets_size = max_packet_size;
+            }
+
+            if (SmolRTSP_RtpTransport_send_batch(
+                    sub.transport,
+                    SmolRTSP_RtpTimestamp_Raw(timestamp + sub.ts_offset),
+                    packets) == -1) {
+                result = -1;
+                saved_errno = errno;
+            }
+        }
+
+        nalu = next;
+        has_nalu = has_next;
+    }
+
+    if (-1 == result) {
+        errno = saved_errno;
+    }
+
+    return result;
+}
+
+static int reserve_packets(SmolRTSP_RtpFanout *self, size_t capacity) {
+    if (capacity <= self->packets_capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = 0 == self->packets_capacity
+                              ? PACKETS_CHUNK_SIZE
+                              : self->packets_capacity;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    SmolRTSP_RtpPacket *packets =
+        smolrtsp_realloc(self->packets, new_capacity * sizeof packets[0]);
+    if (NULL == packets) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->packets = packets;
+    self->packets_capacity = new_capacity;
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "rtp_history.h"
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+static void clear(SmolRTSP_RtpHistory *self, uint16_t seq_num);
+static SmolRTSP_RtpHistoryEntry *
+entry(const SmolRTSP_RtpHistory *self, uint16_t seq_num);
+
+int SmolRTSP_RtpHistory_init(
+    SmolRTSP_RtpHistory *self, size_t max_packets, size_t max_bytes) {
+    assert(self);
+    assert(max_packets > 0);
+    assert(max_bytes > 0);
+
+    size_t capacity = 1;
+    while (capacity < max_packets && capacity < RTP_HISTORY_MAX_PACKETS) {
+        capacity *= 2;
+    }
+
+    self->entries = smolrtsp_malloc(capacity * sizeof self->entries[0]);
+    self->data = smolrtsp_malloc(max_bytes);
+    if (NULL == self->entries || NULL == self->data) {
+        smolrtsp_free(self->entries);
+        smolrtsp_free(self->data);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    self->capacity = capacity;
+    self->data_capacity = max_bytes;
+    clear(self, 0);
+
+    return 0;
+}
+
+void SmolRTSP_RtpHistory_free(SmolRTSP_RtpHistory *self) {
+    assert(self);
+
+    smolrtsp_free(self->entries);
+    smolrtsp_free(self->data);
+}
+
+void SmolRTSP_RtpHistory_push(
+    SmolRTSP_RtpHistory *self, uint16_t seq_num, SmolRTSP_IoVecSlice bufs,
+    uint64_t sent_us) {
+    assert(self);
+
+    const size_t size = SmolRTSP_IoVecSlice_len(bufs);
+    if ((self->len > 0 && seq_num != (uint16_t)(self->last_seq_num + 1)) ||
+        size > self->data_capacity) {
+        clear(self, seq_num);
+        if (size > self->data_capacity) {
+            return;
+        }
+    }
+
+    // A packet is stored contiguously, so it skips the tail of the arena that
+    // it does not fit into.
+    uint64_t start = self->data_end;
+    const size_t offset = (size_t)(start % self->data_capacity);
+    if (offset + size > self->data_capacity) {
+        start += self->data_capacity - offset;
+    }
+    const uint64_t end = start + size;
+
+    while (self->len > 0) {
+        const SmolRTSP_RtpHistoryEntry *oldest = entry(
+            self, (uint16_t)(self->last_seq_num - (self->len - 1)));
+        if (self->len < self->capacity &&
+            end - oldest->start <= self->data_capacity) {
+            break;
+        }
+        self->len--;
+    }
+
+    SmolRTSP_RtpHistoryEntry *e = entry(self, seq_num);
+    *e = (SmolRTSP_RtpHistoryEntry){
+        .seq_num = seq_num,
+        .size = (uint32_t)size,
+        .sent_us = sent_us,
+        .start = start,
+    };
+
+    uint8_t *dst = self->data + start % self->data_capacity;
+    for (size_t i = 0; i < bufs.len; i++) {
+        // An empty part, such as a missing header extension, may be null.
+        if (0 == bufs.ptr[i].iov_len) {
+            continue;
+        }
+        memcpy(dst, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+        dst += bufs.ptr[i].iov_len;
+    }
+
+    self->len++;
+    self->last_seq_num = seq_num;
+    self->data_end = end;
+}
+
+U8Slice99 SmolRTSP_RtpHistory_find(
+    const SmolRTSP_RtpHistory *self, uint16_t seq_num, uint64_t min_sent_us) {
+    assert(self);
+
+    const uint16_t age = (uint16_t)(self->last_seq_num - seq_num);
+    if (age >= self->len) {
+        return U8Slice99_empty();
+    }
+
+    const SmolRTSP_RtpHistoryEntry *e = entry(self, seq_num);
+    assert(e->seq_num == seq_num);
+    if (e->sent_us < min_sent_us) {
+        return U8Slice99_empty();
+    }
+
+    return U8Slice99_new(
+        self->data + e->start % self->data_capacity, (size_t)e->size);
+}
+
+static void clear(SmolRTSP_RtpHistory *self, uint16_t seq_num) {
+    self->len = 0;
+    self->last_seq_num = (uint16_t)(seq_num - 1);
+    self->data_end = 0;
+}
+
+static SmolRTSP_RtpHistoryEntry *
+entry(const SmolRTSP_RtpHistory *self, uint16_t seq_num) {
+    return &self->entries[seq_num & (self->capacity - 1)];
+}
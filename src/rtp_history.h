@@ -0,0 +1,61 @@
+#pragma once
+
+#include <smolrtsp/io_vec.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <slice99.h>
+
+// The largest number of packets of `SmolRTSP_RtpHistory`, which must divide
+// 2^16 so that sequence numbers map to the same slots across wraparound.
+#define RTP_HISTORY_MAX_PACKETS 32768
+
+typedef struct {
+    uint16_t seq_num;
+    uint32_t size;
+    uint64_t sent_us;
+
+    // The position of the packet in the endless stream of bytes that
+    // `SmolRTSP_RtpHistory.data` is a window of.
+    uint64_t start;
+} SmolRTSP_RtpHistoryEntry;
+
+/*
+ * A ring buffer of the last sent RTP packets, copied into a preallocated
+ * arena and indexed by sequence number. Storing a packet evicts the oldest
+ * ones until both the packet and the byte limits are met; no allocation
+ * happens after `SmolRTSP_RtpHistory_init`.
+ *
+ * Consecutive packets must have consecutive sequence numbers; a gap drops all
+ * the stored ones.
+ */
+typedef struct {
+    SmolRTSP_RtpHistoryEntry *entries;
+    size_t capacity, len;
+    uint16_t last_seq_num;
+
+    uint8_t *data;
+    size_t data_capacity;
+    uint64_t data_end;
+} SmolRTSP_RtpHistory;
+
+// Rounds `max_packets` up to a power of two (at most
+// `RTP_HISTORY_MAX_PACKETS`). Returns -1 and sets `errno` to `ENOMEM` if the
+// buffers cannot be allocated.
+int SmolRTSP_RtpHistory_init(
+    SmolRTSP_RtpHistory *self, size_t max_packets, size_t max_bytes);
+
+void SmolRTSP_RtpHistory_free(SmolRTSP_RtpHistory *self);
+
+// Stores the packet `bufs` sent with `seq_num` at `sent_us`. A packet larger
+// than the whole arena is not stored.
+void SmolRTSP_RtpHistory_push(
+    SmolRTSP_RtpHistory *self, uint16_t seq_num, SmolRTSP_IoVecSlice bufs,
+    uint64_t sent_us);
+
+// Returns the stored packet `seq_num` if it has been sent not earlier than
+// `min_sent_us`, or an empty slice.
+U8Slice99 SmolRTSP_RtpHistory_find(
+    const SmolRTSP_RtpHistory *self, uint16_t seq_num, uint64_t min_sent_us);
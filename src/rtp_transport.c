@@ -1,38 +1,257 @@
 #include <smolrtsp/rtp_transport.h>
 
+#include <smolrtsp/types/rtcp.h>
 #include <smolrtsp/types/rtp.h>
+#include <smolrtsp/types/sdp.h>
+
+#include "alloc.h"
+#include "macros.h"
+#include "probes.h"
+#include "rtp_history.h"
+#include "rtp_transport.h"
+#include "transport/udp.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-#include <alloca.h>
 #include <arpa/inet.h>
 
+// The number of packets serialized on the stack per one transmission of
+// `SmolRTSP_RtpTransport_send_batch`.
+#define BATCH_SIZE 64
+
+// The size of an RTP header without CSRCs and extensions.
+#define RTP_HEADER_SIZE 12
+
+// The size of an RTP header with all the extensions of
+// `SmolRTSP_RtpExtensionsConfig` in the two-byte form: the extension header and
+// two elements of up to 2 + 3 bytes, padded to 32 bits.
+#define RTP_MAX_HEADER_SIZE (RTP_HEADER_SIZE + 4 + 12)
+
+#define RTP_HEADER_EXTENSION_MASK 0x10
+#define RTP_HEADER_MARKER_MASK    0x80
+
+// The profiles of the one-byte and two-byte header extensions (RFC 8285).
+#define RTP_EXT_ONE_BYTE_PROFILE 0xBEDE
+#define RTP_EXT_TWO_BYTE_PROFILE 0x1000
+
+#define RTP_EXT_MAX_ONE_BYTE_ID 14
+
+#define RTP_EXT_ABS_SEND_TIME_SIZE     3
+#define RTP_EXT_TRANSPORT_WIDE_CC_SIZE 2
+
+// The original sequence number (OSN) preceding the payload of an RTX packet.
+#define RTX_OSN_SIZE 2
+
 struct SmolRTSP_RtpTransport {
     uint16_t seq_num;
     uint32_t ssrc;
     uint8_t payload_ty;
-    uint32_t clock_rate;
+    SmolRTSP_RtpClock clock;
     SmolRTSP_Transport transport;
+
+    // `transport` if it is UDP, called directly instead of through its
+    // vtable, or `NULL`.
+    SmolRTSP_UdpTransport *udp;
+
+    // Placed into the allocation of its owner by
+    // `smolrtsp_rtp_transport_init_udp` rather than allocated on its own.
+    bool embedded;
+
+    // Updated with relaxed atomics, so that they can be read from any thread.
+    uint64_t packets, payload_bytes, errors;
+    uint64_t retransmissions, retransmission_misses;
+
+    // Updated from `SmolRTSP_RtpTransport_ingest_rtcp` field by field.
+    SmolRTSP_RtcpStats rtcp;
+
+    // The serialized RTP header with zero sequence number, timestamp, and
+    // marker, followed by the header extensions; only these fields and the
+    // extension values are patched for each packet.
+    uint8_t header_template[RTP_MAX_HEADER_SIZE];
+    size_t header_size;
+
+    // The offsets of the extension values in the header, or 0 if disabled.
+    size_t abs_send_time_offset, transport_wide_cc_offset;
+    uint64_t (*ext_clock_us)(void);
+    uint16_t *transport_wide_seq_num, own_transport_wide_seq_num;
+
+    // Not owned; fed by the packets with a transport-wide sequence number.
+    SmolRTSP_BandwidthEstimator *estimator;
+
+    // The last sent packets, if `retransmission`.
+    bool retransmission;
+    SmolRTSP_RtpRetransmissionConfig retransmission_config;
+    SmolRTSP_RtpHistory history;
+
+    // The RTX stream, if `retransmission_config.rtx`; the SSRC is in network
+    // byte order.
+    uint16_t rtx_seq_num;
+    uint32_t rtx_ssrc;
+
+    // The audio frames queued by `SmolRTSP_RtpTransport_send_audio_frame`, if
+    // `audio_aggregation`: `audio_len` bytes from `audio_ts` lasting
+    // `audio_duration` ticks. The packet durations are in ticks too.
+    bool audio_aggregation;
+    size_t audio_capacity;
+    uint32_t audio_ptime, audio_maxptime;
+    uint8_t *audio_buffer;
+    size_t audio_len;
+    uint32_t audio_ts, audio_duration;
+
+    // Set by `SmolRTSP_RtpTransport_enable_thread_safety`: the sequence numbers
+    // are reserved atomically, and `history_lock` guards `history` and the RTX
+    // stream if `retransmission`.
+    bool thread_safe;
+    bool history_lock;
 };
 
+static void write_header(
+    const SmolRTSP_RtpTransport *self, uint8_t buffer[restrict],
+    uint16_t seq_num, uint32_t timestamp, bool marker);
+static void write_extensions(
+    const SmolRTSP_RtpTransport *self, uint8_t buffer[restrict],
+    uint32_t abs_send_time, uint16_t transport_wide_seq_num);
+static bool has_extensions(const SmolRTSP_RtpTransport *self);
+static uint32_t abs_send_time(const SmolRTSP_RtpTransport *self);
+static uint16_t reserve_seq_nums(SmolRTSP_RtpTransport *self, size_t count);
+static void commit_seq_nums(SmolRTSP_RtpTransport *self, size_t count);
+static uint16_t
+reserve_transport_wide_seq_nums(SmolRTSP_RtpTransport *self, size_t count);
+static void
+advance_transport_wide_seq_num(SmolRTSP_RtpTransport *self, size_t count);
+static bool stores_before_transmit(const SmolRTSP_RtpTransport *self);
+static void lock_history(SmolRTSP_RtpTransport *self);
+static void unlock_history(SmolRTSP_RtpTransport *self);
+static void record_sent(
+    const SmolRTSP_RtpTransport *self, uint16_t transport_wide_seq_num,
+    size_t size);
+static size_t append_extension(
+    uint8_t ext[restrict], size_t *len, bool one_byte, uint8_t id,
+    size_t data_len);
 static uint32_t
-compute_timestamp(SmolRTSP_RtpTimestamp ts, uint32_t clock_rate);
+compute_timestamp(const SmolRTSP_RtpClock *clock, SmolRTSP_RtpTimestamp ts);
+static void record_report(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtcpReportBlock block,
+    uint64_t time_us);
+static void handle_nack(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtcpPacket rtcp_packet);
+static uint64_t now_us(const SmolRTSP_RtpTransport *self);
+static uint64_t clock_now_us(uint64_t (*clock_us)(void));
+static void init(
+    SmolRTSP_RtpTransport *self, SmolRTSP_Transport t, uint8_t payload_ty,
+    uint32_t clock_rate);
+static uint32_t ms_to_ticks(const SmolRTSP_RtpTransport *self, uint32_t ms);
+static int transmit(SmolRTSP_RtpTransport *self, SmolRTSP_IoVecSlice bufs);
+static size_t
+transmit_batch(SmolRTSP_RtpTransport *self, SmolRTSP_IoVecBatch batch);
 
 SmolRTSP_RtpTransport *SmolRTSP_RtpTransport_new(
     SmolRTSP_Transport t, uint8_t payload_ty, uint32_t clock_rate) {
     assert(t.self && t.vptr);
 
-    SmolRTSP_RtpTransport *self = malloc(sizeof *self);
-    assert(self);
+    SmolRTSP_RtpTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
 
+    init(self, t, payload_ty, clock_rate);
+    self->embedded = false;
+
+    return self;
+}
+
+SmolRTSP_RtpTransport *SmolRTSP_RtpTransport_new_udp(
+    int fd, SmolRTSP_UdpTransportConfig udp_config, uint8_t payload_ty,
+    uint32_t clock_rate) {
+    assert(fd >= 0);
+
+    // The UDP transport follows in the same allocation and is freed with it.
+    void *storage = smolrtsp_malloc(smolrtsp_rtp_transport_udp_size());
+    if (NULL == storage) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    SmolRTSP_RtpTransport *self = smolrtsp_rtp_transport_init_udp(
+        storage, fd, udp_config, payload_ty, clock_rate);
+    self->embedded = false;
+
+    return self;
+}
+
+size_t smolrtsp_rtp_transport_udp_size(void) {
+    return SMOLRTSP_ALLOC_ALIGN(sizeof(SmolRTSP_RtpTransport)) +
+           smolrtsp_udp_transport_size();
+}
+
+SmolRTSP_RtpTransport *smolrtsp_rtp_transport_init_udp(
+    void *storage, int fd, SmolRTSP_UdpTransportConfig udp_config,
+    uint8_t payload_ty, uint32_t clock_rate) {
+    assert(storage);
+    assert(fd >= 0);
+
+    SmolRTSP_RtpTransport *self = storage;
+    const SmolRTSP_Transport t = smolrtsp_udp_transport_init(
+        (uint8_t *)self + SMOLRTSP_ALLOC_ALIGN(sizeof *self), fd, udp_config);
+    init(self, t, payload_ty, clock_rate);
+    self->embedded = true;
+
+    return self;
+}
+
+static void init(
+    SmolRTSP_RtpTransport *self, SmolRTSP_Transport t, uint8_t payload_ty,
+    uint32_t clock_rate) {
     self->seq_num = 0;
     self->ssrc = (uint32_t)rand();
     self->payload_ty = payload_ty;
-    self->clock_rate = clock_rate;
+    self->clock = SmolRTSP_RtpClock_new(clock_rate);
     self->transport = t;
+    self->udp = smolrtsp_udp_transport_of(t);
+    self->packets = 0;
+    self->payload_bytes = 0;
+    self->errors = 0;
+    self->retransmissions = 0;
+    self->retransmission_misses = 0;
+    self->rtcp = (SmolRTSP_RtcpStats){0};
+    self->retransmission = false;
+    self->audio_aggregation = false;
+    self->header_size = RTP_HEADER_SIZE;
+    self->abs_send_time_offset = 0;
+    self->transport_wide_cc_offset = 0;
+    self->ext_clock_us = NULL;
+    self->own_transport_wide_seq_num = 0;
+    self->transport_wide_seq_num = &self->own_transport_wide_seq_num;
+    self->estimator = NULL;
+    self->thread_safe = false;
+    self->history_lock = false;
 
-    return self;
+    const SmolRTSP_RtpHeader header = {
+        .version = 2,
+        .padding = false,
+        .extension = false,
+        .csrc_count = 0,
+        .marker = false,
+        .payload_ty = payload_ty,
+        .sequence_number = htons(0),
+        .timestamp = htonl(0),
+        .ssrc = self->ssrc,
+        .csrc = NULL,
+        .extension_profile = htons(0),
+        .extension_payload_len = htons(0),
+        .extension_payload = NULL,
+    };
+    assert(SmolRTSP_RtpHeader_size(header) == RTP_HEADER_SIZE);
+    const uint8_t *template =
+        SmolRTSP_RtpHeader_serialize(header, self->header_template);
+    assert(template == self->header_template);
+    (void)template;
 }
 
 static void SmolRTSP_RtpTransport_drop(VSelf) {
@@ -41,7 +260,16 @@ static void SmolRTSP_RtpTransport_drop(VSelf) {
 
     VCALL_SUPER(self->transport, SmolRTSP_Droppable, drop);
 
-    free(self);
+    if (self->retransmission) {
+        SmolRTSP_RtpHistory_free(&self->history);
+    }
+    if (self->audio_aggregation) {
+        smolrtsp_free(self->audio_buffer);
+    }
+    // An embedded transport is freed together with its owner.
+    if (!self->embedded) {
+        smolrtsp_free(self);
+    }
 }
 
 implExtern(SmolRTSP_Droppable, SmolRTSP_RtpTransport);
@@ -51,60 +279,940 @@ int SmolRTSP_RtpTransport_send_packet(
     U8Slice99 payload_header, U8Slice99 payload) {
     assert(self);
 
-    const SmolRTSP_RtpHeader header = {
-        .version = 2,
-        .padding = false,
-        .extension = false,
-        .csrc_count = 0,
-        .marker = marker,
-        .payload_ty = self->payload_ty,
-        .sequence_number = htons(self->seq_num),
-        .timestamp = htobe32(compute_timestamp(ts, self->clock_rate)),
-        .ssrc = self->ssrc,
-        .csrc = NULL,
-        .extension_profile = htons(0),
-        .extension_payload_len = htons(0),
-        .extension_payload = NULL,
-    };
+    const uint32_t timestamp = compute_timestamp(&self->clock, ts);
 
-    const size_t rtp_header_size = SmolRTSP_RtpHeader_size(header);
-    const U8Slice99 rtp_header = U8Slice99_new(
-        SmolRTSP_RtpHeader_serialize(header, alloca(rtp_header_size)),
-        rtp_header_size);
+    lock_history(self);
+    const uint16_t seq_num = reserve_seq_nums(self, 1),
+                   tw_seq_num = reserve_transport_wide_seq_nums(self, 1);
+
+    uint8_t rtp_header[RTP_MAX_HEADER_SIZE];
+    write_header(self, rtp_header, seq_num, timestamp, marker);
+    if (has_extensions(self)) {
+        write_extensions(self, rtp_header, abs_send_time(self), tw_seq_num);
+    }
 
     const SmolRTSP_IoVecSlice bufs =
         (SmolRTSP_IoVecSlice)Slice99_typed_from_array((struct iovec[]){
-            smolrtsp_slice_to_iovec(rtp_header),
+            {rtp_header, self->header_size},
             smolrtsp_slice_to_iovec(payload_header),
             smolrtsp_slice_to_iovec(payload),
         });
 
-    const int ret = VCALL(self->transport, transmit, bufs);
+    if (stores_before_transmit(self)) {
+        SmolRTSP_RtpHistory_push(&self->history, seq_num, bufs, now_us(self));
+    }
+    unlock_history(self);
+
+    const int ret = transmit(self, bufs);
+    SMOLRTSP_PROBE(
+        rtp_packet, self->ssrc, seq_num, timestamp,
+        payload_header.len + payload.len, ret);
     if (ret != -1) {
-        self->seq_num++;
+        if (self->retransmission && !stores_before_transmit(self)) {
+            SmolRTSP_RtpHistory_push(
+                &self->history, seq_num, bufs, now_us(self));
+        }
+        commit_seq_nums(self, 1);
+        record_sent(
+            self, tw_seq_num,
+            self->header_size + payload_header.len + payload.len);
+        advance_transport_wide_seq_num(self, 1);
+        __atomic_fetch_add(&self->packets, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(
+            &self->payload_bytes, payload_header.len + payload.len,
+            __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&self->errors, 1, __ATOMIC_RELAXED);
     }
 
     return ret;
 }
 
+int SmolRTSP_RtpTransport_send_batch(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_RtpPacketSlice packets) {
+    assert(self);
+
+    size_t sent;
+    return smolrtsp_rtp_transport_send_counted(self, ts, packets, &sent);
+}
+
+int smolrtsp_rtp_transport_send_counted(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_RtpPacketSlice packets, size_t *restrict sent_total) {
+    assert(self);
+    assert(sent_total);
+
+    *sent_total = 0;
+
+    const uint32_t timestamp = compute_timestamp(&self->clock, ts);
+
+    uint8_t headers[BATCH_SIZE][RTP_MAX_HEADER_SIZE];
+    struct iovec vecs[BATCH_SIZE][3];
+    SmolRTSP_IoVecSlice batch[BATCH_SIZE];
+
+    while (!SmolRTSP_RtpPacketSlice_is_empty(packets)) {
+        const size_t count =
+            packets.len < BATCH_SIZE ? packets.len : BATCH_SIZE;
+        uint64_t payload_bytes = 0;
+
+        // All the packets of a batch leave at once.
+        const uint32_t send_time = abs_send_time(self);
+
+        lock_history(self);
+        const uint16_t first_seq_num = reserve_seq_nums(self, count),
+                       first_transport_wide_seq_num =
+                           reserve_transport_wide_seq_nums(self, count);
+
+        for (size_t i = 0; i < count; i++) {
+            const SmolRTSP_RtpPacket packet = packets.ptr[i];
+
+            write_header(
+                self, headers[i], (uint16_t)(first_seq_num + i), timestamp,
+                packet.marker);
+            if (has_extensions(self)) {
+                write_extensions(
+                    self, headers[i], send_time,
+                    (uint16_t)(first_transport_wide_seq_num + i));
+            }
+
+            vecs[i][0] = (struct iovec){headers[i], self->header_size};
+            vecs[i][1] = smolrtsp_slice_to_iovec(packet.payload_header);
+            vecs[i][2] = smolrtsp_slice_to_iovec(packet.payload);
+            batch[i] = (SmolRTSP_IoVecSlice)Slice99_typed_from_array(vecs[i]);
+        }
+
+        if (stores_before_transmit(self)) {
+            const uint64_t sent_us = now_us(self);
+            for (size_t i = 0; i < count; i++) {
+                SmolRTSP_RtpHistory_push(
+                    &self->history, (uint16_t)(first_seq_num + i), batch[i],
+                    sent_us);
+            }
+        }
+        unlock_history(self);
+
+        const size_t sent = transmit_batch(
+            self, SmolRTSP_IoVecBatch_new(batch, count));
+        // The packets after the failed one have not been attempted.
+        for (size_t i = 0; SMOLRTSP_PROBES_ENABLED && i < count && i <= sent;
+             i++) {
+            SMOLRTSP_PROBE(
+                rtp_packet, self->ssrc, (uint16_t)(first_seq_num + i),
+                timestamp,
+                packets.ptr[i].payload_header.len + packets.ptr[i].payload.len,
+                i < sent ? 0 : -1);
+        }
+        if (self->retransmission && !stores_before_transmit(self)) {
+            const uint64_t sent_us = now_us(self);
+            for (size_t i = 0; i < sent; i++) {
+                SmolRTSP_RtpHistory_push(
+                    &self->history, (uint16_t)(first_seq_num + i), batch[i],
+                    sent_us);
+            }
+        }
+        commit_seq_nums(self, sent);
+        for (size_t i = 0; self->estimator != NULL && i < sent; i++) {
+            record_sent(
+                self, (uint16_t)(first_transport_wide_seq_num + i),
+                SmolRTSP_IoVecSlice_len(batch[i]));
+        }
+        advance_transport_wide_seq_num(self, sent);
+
+        for (size_t i = 0; i < sent; i++) {
+            payload_bytes +=
+                packets.ptr[i].payload_header.len + packets.ptr[i].payload.len;
+        }
+        __atomic_fetch_add(&self->packets, sent, __ATOMIC_RELAXED);
+        __atomic_fetch_add(
+            &self->payload_bytes, payload_bytes, __ATOMIC_RELAXED);
+        *sent_total += sent;
+
+        if (sent < count) {
+            __atomic_fetch_add(&self->errors, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+
+        packets = SmolRTSP_RtpPacketSlice_advance(packets, count);
+    }
+
+    return 0;
+}
+
+static void write_header(
+    const SmolRTSP_RtpTransport *self, uint8_t buffer[restrict],
+    uint16_t seq_num, uint32_t timestamp, bool marker) {
+    memcpy(buffer, self->header_template, self->header_size);
+
+    if (marker) {
+        buffer[1] |= RTP_HEADER_MARKER_MASK;
+    }
+
+    const uint16_t seq_num_be = htons(seq_num);
+    const uint32_t timestamp_be = htonl(timestamp);
+    memcpy(buffer + 2, &seq_num_be, sizeof seq_num_be);
+    memcpy(buffer + 4, &timestamp_be, sizeof timestamp_be);
+}
+
+static void write_extensions(
+    const SmolRTSP_RtpTransport *self, uint8_t buffer[restrict],
+    uint32_t abs_send_time, uint16_t transport_wide_seq_num) {
+    if (self->abs_send_time_offset > 0) {
+        uint8_t *p = buffer + self->abs_send_time_offset;
+        p[0] = (uint8_t)(abs_send_time >> 16);
+        p[1] = (uint8_t)(abs_send_time >> 8);
+        p[2] = (uint8_t)abs_send_time;
+    }
+
+    if (self->transport_wide_cc_offset > 0) {
+        const uint16_t seq_num_be = htons(transport_wide_seq_num);
+        memcpy(
+            buffer + self->transport_wide_cc_offset, &seq_num_be,
+            sizeof seq_num_be);
+    }
+}
+
+static bool has_extensions(const SmolRTSP_RtpTransport *self) {
+    return self->header_size > RTP_HEADER_SIZE;
+}
+
+// The send time in seconds as a 6.18 fixed-point number, i.e., 64 seconds
+// wrapping around.
+static uint32_t abs_send_time(const SmolRTSP_RtpTransport *self) {
+    if (0 == self->abs_send_time_offset) {
+        return 0;
+    }
+
+    // Wrapped before the shift, which would overflow past 2^46 us (e.g., for a
+    // wall clock).
+    const uint64_t time_us =
+        clock_now_us(self->ext_clock_us) % (UINT64_C(64) * 1000000);
+    return (uint32_t)(((time_us << 18) / 1000000) & 0xFFFFFF);
+}
+
+// Returns the first of @p count sequence numbers, which are taken right away
+// if thread-safe and by `commit_seq_nums` for the packets actually sent
+// otherwise.
+static uint16_t reserve_seq_nums(SmolRTSP_RtpTransport *self, size_t count) {
+    if (self->thread_safe) {
+        return __atomic_fetch_add(
+            &self->seq_num, (uint16_t)count, __ATOMIC_RELAXED);
+    }
+
+    return self->seq_num;
+}
+
+static void commit_seq_nums(SmolRTSP_RtpTransport *self, size_t count) {
+    if (!self->thread_safe) {
+        self->seq_num += (uint16_t)count;
+    }
+}
+
+// The same as `reserve_seq_nums`, with `advance_transport_wide_seq_num`.
+static uint16_t
+reserve_transport_wide_seq_nums(SmolRTSP_RtpTransport *self, size_t count) {
+    if (0 == self->transport_wide_cc_offset) {
+        return 0;
+    }
+    if (self->thread_safe) {
+        return __atomic_fetch_add(
+            self->transport_wide_seq_num, (uint16_t)count, __ATOMIC_RELAXED);
+    }
+
+    return *self->transport_wide_seq_num;
+}
+
+static void
+advance_transport_wide_seq_num(SmolRTSP_RtpTransport *self, size_t count) {
+    if (!self->thread_safe && self->transport_wide_cc_offset > 0) {
+        *self->transport_wide_seq_num += (uint16_t)count;
+    }
+}
+
+// Concurrent senders store their packets into the history together with
+// reserving their sequence numbers, so that the history stays contiguous.
+static bool stores_before_transmit(const SmolRTSP_RtpTransport *self) {
+    return self->thread_safe && self->retransmission;
+}
+
+static void lock_history(SmolRTSP_RtpTransport *self) {
+    if (stores_before_transmit(self)) {
+        // Held for a few copies or a single retransmission.
+        while (__atomic_test_and_set(&self->history_lock, __ATOMIC_ACQUIRE)) {
+        }
+    }
+}
+
+static void unlock_history(SmolRTSP_RtpTransport *self) {
+    if (stores_before_transmit(self)) {
+        __atomic_clear(&self->history_lock, __ATOMIC_RELEASE);
+    }
+}
+
+static void record_sent(
+    const SmolRTSP_RtpTransport *self, uint16_t transport_wide_seq_num,
+    size_t size) {
+    if (self->estimator != NULL && self->transport_wide_cc_offset > 0) {
+        SmolRTSP_BandwidthEstimator_on_packet_sent(
+            self->estimator, transport_wide_seq_num, size,
+            clock_now_us(self->ext_clock_us));
+    }
+}
+
+void SmolRTSP_RtpTransport_set_bandwidth_estimator(
+    SmolRTSP_RtpTransport *self, SmolRTSP_BandwidthEstimator *estimator) {
+    assert(self);
+    assert(NULL == estimator || self->transport_wide_cc_offset > 0);
+    assert(NULL == estimator || !self->thread_safe);
+
+    self->estimator = estimator;
+}
+
+uint32_t
+SmolRTSP_RtpTimestamp_compute(SmolRTSP_RtpTimestamp self, uint32_t clock_rate) {
+    const SmolRTSP_RtpClock clock = SmolRTSP_RtpClock_new(clock_rate);
+    return compute_timestamp(&clock, self);
+}
+
 static uint32_t
-compute_timestamp(SmolRTSP_RtpTimestamp ts, uint32_t clock_rate) {
+compute_timestamp(const SmolRTSP_RtpClock *clock, SmolRTSP_RtpTimestamp ts) {
     match(ts) {
         of(SmolRTSP_RtpTimestamp_Raw, raw_ts) {
             return *raw_ts;
         }
         of(SmolRTSP_RtpTimestamp_SysClockUs, time_us) {
-            const uint64_t us_rem = *time_us % 1000,
-                           ms = (*time_us - us_rem) / 1000;
-            uint32_t clock_rate_kHz = clock_rate / 1000;
-            return ms * clock_rate_kHz +
-                   (uint32_t)(us_rem * ((double)clock_rate_kHz / 1000.0));
+            return SmolRTSP_RtpClock_timestamp(clock, *time_us);
         }
     }
 
     return 0;
 }
 
+const SmolRTSP_RtpClock *
+SmolRTSP_RtpTransport_clock(const SmolRTSP_RtpTransport *self) {
+    assert(self);
+    return &self->clock;
+}
+
+void SmolRTSP_RtpTransport_set_clock(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpClock clock) {
+    assert(self);
+    self->clock = clock;
+}
+
+void SmolRTSP_RtpTransport_skip_seq_nums(
+    SmolRTSP_RtpTransport *self, uint16_t count) {
+    assert(self);
+
+    if (self->thread_safe) {
+        __atomic_fetch_add(&self->seq_num, count, __ATOMIC_RELAXED);
+    } else {
+        self->seq_num += count;
+    }
+}
+
 bool SmolRTSP_RtpTransport_is_full(SmolRTSP_RtpTransport *self) {
     return VCALL(self->transport, is_full);
 }
+
+SmolRTSP_RtpTransportStats
+SmolRTSP_RtpTransport_stats(const SmolRTSP_RtpTransport *self) {
+    assert(self);
+
+    return (SmolRTSP_RtpTransportStats){
+        .packets = __atomic_load_n(&self->packets, __ATOMIC_RELAXED),
+        .payload_bytes =
+            __atomic_load_n(&self->payload_bytes, __ATOMIC_RELAXED),
+        .errors = __atomic_load_n(&self->errors, __ATOMIC_RELAXED),
+        .retransmissions =
+            __atomic_load_n(&self->retransmissions, __ATOMIC_RELAXED),
+        .retransmission_misses =
+            __atomic_load_n(&self->retransmission_misses, __ATOMIC_RELAXED),
+        .transport = VCALL(self->transport, stats),
+        .rtcp =
+            {
+                .sender_reports = __atomic_load_n(
+                    &self->rtcp.sender_reports, __ATOMIC_RELAXED),
+                .reports =
+                    __atomic_load_n(&self->rtcp.reports, __ATOMIC_RELAXED),
+                .malformed =
+                    __atomic_load_n(&self->rtcp.malformed, __ATOMIC_RELAXED),
+                .nacks = __atomic_load_n(&self->rtcp.nacks, __ATOMIC_RELAXED),
+                .keyframe_requests = __atomic_load_n(
+                    &self->rtcp.keyframe_requests, __ATOMIC_RELAXED),
+                .fraction_lost = __atomic_load_n(
+                    &self->rtcp.fraction_lost, __ATOMIC_RELAXED),
+                .cumulative_lost = __atomic_load_n(
+                    &self->rtcp.cumulative_lost, __ATOMIC_RELAXED),
+                .extended_highest_seq_num = __atomic_load_n(
+                    &self->rtcp.extended_highest_seq_num, __ATOMIC_RELAXED),
+                .jitter =
+                    __atomic_load_n(&self->rtcp.jitter, __ATOMIC_RELAXED),
+                .jitter_us =
+                    __atomic_load_n(&self->rtcp.jitter_us, __ATOMIC_RELAXED),
+                .rtt_us =
+                    __atomic_load_n(&self->rtcp.rtt_us, __ATOMIC_RELAXED),
+            },
+    };
+}
+
+size_t SmolRTSP_RtpTransport_max_payload_size(SmolRTSP_RtpTransport *self) {
+    assert(self);
+
+    const size_t max_packet_size = VCALL(self->transport, max_packet_size);
+    if (0 == max_packet_size) {
+        return 0;
+    }
+
+    return max_packet_size > self->header_size
+               ? max_packet_size - self->header_size
+               : 1;
+}
+
+int SmolRTSP_RtpTransport_send_sender_report(
+    SmolRTSP_RtpTransport *self, SmolRTSP_Transport rtcp, uint64_t time_us) {
+    assert(self);
+    assert(rtcp.self && rtcp.vptr);
+
+    const SmolRTSP_RtcpSenderReport report = {
+        .ssrc = ntohl(self->ssrc),
+        .ntp_timestamp = SmolRTSP_RtpClock_ntp_timestamp(&self->clock, time_us),
+        .rtp_timestamp = SmolRTSP_RtpClock_timestamp(&self->clock, time_us),
+        .packet_count =
+            (uint32_t)__atomic_load_n(&self->packets, __ATOMIC_RELAXED),
+        .octet_count =
+            (uint32_t)__atomic_load_n(&self->payload_bytes, __ATOMIC_RELAXED),
+    };
+
+    uint8_t buffer[SMOLRTSP_RTCP_SENDER_REPORT_SIZE];
+    const uint8_t *serialized =
+        SmolRTSP_RtcpSenderReport_serialize(report, buffer);
+    assert(serialized == buffer);
+    (void)serialized;
+
+    const SmolRTSP_IoVecSlice bufs =
+        (SmolRTSP_IoVecSlice)Slice99_typed_from_array(
+            (struct iovec[]){{buffer, sizeof buffer}});
+
+    const int ret = VCALL(rtcp, transmit, bufs);
+    if (ret != -1) {
+        __atomic_fetch_add(&self->rtcp.sender_reports, 1, __ATOMIC_RELAXED);
+    }
+
+    return ret;
+}
+
+int SmolRTSP_RtpTransport_ingest_rtcp(
+    SmolRTSP_RtpTransport *self, U8Slice99 packet, uint64_t time_us) {
+    assert(self);
+
+    while (!U8Slice99_is_empty(packet)) {
+        SmolRTSP_RtcpPacket rtcp_packet;
+        if (SmolRTSP_RtcpPacket_parse(&packet, &rtcp_packet) == -1) {
+            __atomic_fetch_add(&self->rtcp.malformed, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+
+        // The feedback covers all the streams of the network transport.
+        if (SMOLRTSP_RTCP_RTPFB == rtcp_packet.packet_ty &&
+            SMOLRTSP_RTCP_FMT_TRANSPORT_CC == rtcp_packet.count) {
+            if (self->estimator != NULL &&
+                SmolRTSP_BandwidthEstimator_on_feedback(
+                    self->estimator, rtcp_packet, time_us) == -1) {
+                __atomic_fetch_add(&self->rtcp.malformed, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+            continue;
+        }
+
+        if (SMOLRTSP_RTCP_RTPFB == rtcp_packet.packet_ty &&
+            SMOLRTSP_RTCP_FMT_NACK == rtcp_packet.count &&
+            ntohl(self->ssrc) == SmolRTSP_RtcpPacket_media_ssrc(rtcp_packet)) {
+            handle_nack(self, rtcp_packet);
+            continue;
+        }
+
+        if (SmolRTSP_RtcpPacket_is_keyframe_request(
+                rtcp_packet, ntohl(self->ssrc))) {
+            __atomic_fetch_add(
+                &self->rtcp.keyframe_requests, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (rtcp_packet.packet_ty != SMOLRTSP_RTCP_SR &&
+            rtcp_packet.packet_ty != SMOLRTSP_RTCP_RR) {
+            continue;
+        }
+
+        for (size_t i = 0; i < rtcp_packet.count; i++) {
+            const SmolRTSP_RtcpReportBlock block =
+                SmolRTSP_RtcpPacket_report_block(rtcp_packet, i);
+            if (ntohl(self->ssrc) == block.ssrc) {
+                record_report(self, block, time_us);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void record_report(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtcpReportBlock block,
+    uint64_t time_us) {
+    SmolRTSP_RtcpStats *rtcp = &self->rtcp;
+
+    __atomic_fetch_add(&rtcp->reports, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &rtcp->fraction_lost, block.fraction_lost, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &rtcp->cumulative_lost, block.cumulative_lost, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &rtcp->extended_highest_seq_num, block.extended_highest_seq_num,
+        __ATOMIC_RELAXED);
+    __atomic_store_n(&rtcp->jitter, block.jitter, __ATOMIC_RELAXED);
+
+    if (self->clock.clock_rate > 0) {
+        const uint64_t jitter_us =
+            (uint64_t)block.jitter * 1000000 / self->clock.clock_rate;
+        __atomic_store_n(&rtcp->jitter_us, jitter_us, __ATOMIC_RELAXED);
+    }
+
+    // RTT = A - LSR - DLSR, where A is the arrival time in the middle 32 bits
+    // of the NTP timestamp (RFC 3550, section 6.4.1).
+    if (block.last_sr != 0) {
+        const uint32_t arrival = (uint32_t)(
+            SmolRTSP_RtpClock_ntp_timestamp(&self->clock, time_us) >> 16);
+        const uint32_t rtt =
+            arrival - block.last_sr - block.delay_since_last_sr;
+
+        // A negative RTT means clock skew or a report about a foreign SR.
+        if ((int32_t)rtt >= 0) {
+            const uint64_t rtt_us = (uint64_t)rtt * 1000000 >> 16;
+            __atomic_store_n(&rtcp->rtt_us, rtt_us, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void handle_nack(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtcpPacket rtcp_packet) {
+    const size_t nacks_count = SmolRTSP_RtcpPacket_nacks_count(rtcp_packet);
+
+    for (size_t i = 0; i < nacks_count; i++) {
+        const SmolRTSP_RtcpNack nack =
+            SmolRTSP_RtcpPacket_nack(rtcp_packet, i);
+
+        for (int bit = -1; bit < 16; bit++) {
+            if (bit >= 0 && !(nack.bitmask & (1 << bit))) {
+                continue;
+            }
+
+            __atomic_fetch_add(&self->rtcp.nacks, 1, __ATOMIC_RELAXED);
+            if (self->retransmission) {
+                // Failures are accounted in the counters.
+                const int ret = SmolRTSP_RtpTransport_retransmit(
+                    self, (uint16_t)(nack.seq_num + bit + 1));
+                (void)ret;
+            }
+        }
+    }
+}
+
+SmolRTSP_RtpRetransmissionConfig
+SmolRTSP_RtpRetransmissionConfig_default(void) {
+    return (SmolRTSP_RtpRetransmissionConfig){
+        .max_packets = SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_PACKETS,
+        .max_bytes = SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_BYTES,
+        .max_age_us = SMOLRTSP_RTP_RETRANSMISSION_DEFAULT_MAX_AGE_US,
+        .rtx = false,
+        .rtx_payload_ty = 0,
+        .rtx_ssrc = 0,
+        .clock_us = NULL,
+    };
+}
+
+int SmolRTSP_RtpTransport_enable_retransmission(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpRetransmissionConfig config) {
+    assert(self);
+    assert(config.max_packets > 0 && config.max_bytes > 0);
+    assert(!self->retransmission);
+
+    if (SmolRTSP_RtpHistory_init(
+            &self->history, config.max_packets, config.max_bytes) == -1) {
+        return -1;
+    }
+
+    self->retransmission = true;
+    self->retransmission_config = config;
+    if (config.rtx) {
+        self->rtx_seq_num = (uint16_t)rand();
+        self->rtx_ssrc =
+            htonl(0 == config.rtx_ssrc ? (uint32_t)rand() : config.rtx_ssrc);
+    }
+
+    return 0;
+}
+
+int SmolRTSP_RtpTransport_retransmit(
+    SmolRTSP_RtpTransport *self, uint16_t seq_num) {
+    assert(self);
+
+    // The packet points into the history, which is locked until it is sent.
+    lock_history(self);
+
+    U8Slice99 packet = U8Slice99_empty();
+    if (self->retransmission) {
+        const uint64_t now = now_us(self),
+                       max_age_us = self->retransmission_config.max_age_us;
+        packet = SmolRTSP_RtpHistory_find(
+            &self->history, seq_num, now > max_age_us ? now - max_age_us : 0);
+    }
+
+    if (U8Slice99_is_empty(packet)) {
+        unlock_history(self);
+        __atomic_fetch_add(&self->retransmission_misses, 1, __ATOMIC_RELAXED);
+        errno = ENOENT;
+        return -1;
+    }
+
+    const size_t header_size = self->header_size;
+    const uint16_t tw_seq_num = reserve_transport_wide_seq_nums(self, 1);
+
+    int ret;
+    if (self->retransmission_config.rtx) {
+        // The RTX packet keeps the timestamp and the marker, and prepends the
+        // original sequence number to the payload (RFC 4588, section 4).
+        uint8_t header[RTP_MAX_HEADER_SIZE + RTX_OSN_SIZE];
+        memcpy(header, packet.ptr, header_size);
+        header[1] = (uint8_t)((header[1] & RTP_HEADER_MARKER_MASK) |
+                              self->retransmission_config.rtx_payload_ty);
+
+        const uint16_t rtx_seq_num_be = htons(self->rtx_seq_num);
+        memcpy(header + 2, &rtx_seq_num_be, sizeof rtx_seq_num_be);
+        memcpy(header + 8, &self->rtx_ssrc, sizeof self->rtx_ssrc);
+        memcpy(header + header_size, packet.ptr + 2, RTX_OSN_SIZE);
+        if (has_extensions(self)) {
+            write_extensions(self, header, abs_send_time(self), tw_seq_num);
+        }
+
+        const SmolRTSP_IoVecSlice bufs =
+            (SmolRTSP_IoVecSlice)Slice99_typed_from_array((struct iovec[]){
+                {header, header_size + RTX_OSN_SIZE},
+                smolrtsp_slice_to_iovec(U8Slice99_advance(packet, header_size)),
+            });
+        ret = transmit(self, bufs);
+        if (ret != -1) {
+            self->rtx_seq_num++;
+            record_sent(self, tw_seq_num, SmolRTSP_IoVecSlice_len(bufs));
+        }
+    } else if (has_extensions(self)) {
+        // The history keeps the extension values of the original
+        // transmission.
+        uint8_t header[RTP_MAX_HEADER_SIZE];
+        memcpy(header, packet.ptr, header_size);
+        write_extensions(self, header, abs_send_time(self), tw_seq_num);
+
+        const SmolRTSP_IoVecSlice bufs =
+            (SmolRTSP_IoVecSlice)Slice99_typed_from_array((struct iovec[]){
+                {header, header_size},
+                smolrtsp_slice_to_iovec(U8Slice99_advance(packet, header_size)),
+            });
+        ret = transmit(self, bufs);
+        if (ret != -1) {
+            record_sent(self, tw_seq_num, packet.len);
+        }
+    } else {
+        const SmolRTSP_IoVecSlice bufs =
+            (SmolRTSP_IoVecSlice)Slice99_typed_from_array(
+                (struct iovec[]){smolrtsp_slice_to_iovec(packet)});
+        ret = transmit(self, bufs);
+    }
+    unlock_history(self);
+
+    if (ret != -1) {
+        advance_transport_wide_seq_num(self, 1);
+        __atomic_fetch_add(&self->retransmissions, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&self->errors, 1, __ATOMIC_RELAXED);
+    }
+
+    return ret;
+}
+
+SmolRTSP_RtpExtensionsConfig SmolRTSP_RtpExtensionsConfig_default(void) {
+    return (SmolRTSP_RtpExtensionsConfig){
+        .abs_send_time_id = 0,
+        .transport_wide_cc_id = 0,
+        .transport_wide_seq_num = NULL,
+        .clock_us = NULL,
+    };
+}
+
+ssize_t SmolRTSP_RtpExtensionsConfig_sdp(
+    SmolRTSP_RtpExtensionsConfig self, SmolRTSP_Writer w) {
+    assert(w.self && w.vptr);
+
+    ssize_t result = 0;
+
+    if (self.abs_send_time_id > 0) {
+        CHK_WRITE_ERR(
+            result, smolrtsp_sdp_printf(
+                        w, SMOLRTSP_SDP_ATTR, "extmap:%" PRIu8 " %s",
+                        self.abs_send_time_id,
+                        SMOLRTSP_RTP_EXT_ABS_SEND_TIME_URI));
+    }
+    if (self.transport_wide_cc_id > 0) {
+        CHK_WRITE_ERR(
+            result, smolrtsp_sdp_printf(
+                        w, SMOLRTSP_SDP_ATTR, "extmap:%" PRIu8 " %s",
+                        self.transport_wide_cc_id,
+                        SMOLRTSP_RTP_EXT_TRANSPORT_WIDE_CC_URI));
+    }
+
+    return result;
+}
+
+void SmolRTSP_RtpTransport_enable_extensions(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpExtensionsConfig config) {
+    assert(self);
+    assert(0 == __atomic_load_n(&self->packets, __ATOMIC_RELAXED));
+    assert(
+        0 == config.abs_send_time_id ||
+        config.abs_send_time_id != config.transport_wide_cc_id);
+
+    const bool one_byte =
+        config.abs_send_time_id <= RTP_EXT_MAX_ONE_BYTE_ID &&
+        config.transport_wide_cc_id <= RTP_EXT_MAX_ONE_BYTE_ID;
+
+    // The elements follow the profile and the length of the extension.
+    uint8_t *ext = self->header_template + RTP_HEADER_SIZE;
+    size_t len = 4;
+
+    self->abs_send_time_offset = 0;
+    self->transport_wide_cc_offset = 0;
+    if (config.abs_send_time_id > 0) {
+        self->abs_send_time_offset =
+            RTP_HEADER_SIZE + append_extension(
+                                  ext, &len, one_byte, config.abs_send_time_id,
+                                  RTP_EXT_ABS_SEND_TIME_SIZE);
+    }
+    if (config.transport_wide_cc_id > 0) {
+        self->transport_wide_cc_offset =
+            RTP_HEADER_SIZE +
+            append_extension(
+                ext, &len, one_byte, config.transport_wide_cc_id,
+                RTP_EXT_TRANSPORT_WIDE_CC_SIZE);
+    }
+
+    self->ext_clock_us = config.clock_us;
+    self->transport_wide_seq_num = NULL == config.transport_wide_seq_num
+                                       ? &self->own_transport_wide_seq_num
+                                       : config.transport_wide_seq_num;
+
+    if (4 == len) {
+        self->header_template[0] &= (uint8_t)~RTP_HEADER_EXTENSION_MASK;
+        self->header_size = RTP_HEADER_SIZE;
+        return;
+    }
+
+    // Padding bytes are zero, which is also the ID of padding elements.
+    while (len % 4 != 0) {
+        ext[len++] = 0;
+    }
+    assert(RTP_HEADER_SIZE + len <= RTP_MAX_HEADER_SIZE);
+
+    const uint16_t profile_be = htons(
+                       one_byte ? RTP_EXT_ONE_BYTE_PROFILE
+                                : RTP_EXT_TWO_BYTE_PROFILE),
+                   words_be = htons((uint16_t)((len - 4) / 4));
+    memcpy(ext, &profile_be, sizeof profile_be);
+    memcpy(ext + 2, &words_be, sizeof words_be);
+
+    self->header_template[0] |= RTP_HEADER_EXTENSION_MASK;
+    self->header_size = RTP_HEADER_SIZE + len;
+}
+
+// Appends an element of `data_len` zero bytes to `ext[0..*len)`, returning the
+// offset of its data.
+static size_t append_extension(
+    uint8_t ext[restrict], size_t *len, bool one_byte, uint8_t id,
+    size_t data_len) {
+    if (one_byte) {
+        ext[(*len)++] = (uint8_t)(id << 4 | (data_len - 1));
+    } else {
+        ext[(*len)++] = id;
+        ext[(*len)++] = (uint8_t)data_len;
+    }
+
+    const size_t offset = *len;
+    memset(ext + offset, 0, data_len);
+    *len += data_len;
+
+    return offset;
+}
+
+static uint64_t now_us(const SmolRTSP_RtpTransport *self) {
+    return clock_now_us(self->retransmission_config.clock_us);
+}
+
+static uint64_t clock_now_us(uint64_t (*clock_us)(void)) {
+    if (clock_us != NULL) {
+        return clock_us();
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+SmolRTSP_RtpAudioAggregationConfig
+SmolRTSP_RtpAudioAggregationConfig_default(void) {
+    return (SmolRTSP_RtpAudioAggregationConfig){
+        .ptime_ms = 60,
+        .maxptime_ms = 120,
+        .max_payload_size = 1200,
+    };
+}
+
+ssize_t SmolRTSP_RtpAudioAggregationConfig_sdp(
+    SmolRTSP_RtpAudioAggregationConfig self, SmolRTSP_Writer w) {
+    assert(w.self && w.vptr);
+
+    ssize_t result = 0;
+
+    CHK_WRITE_ERR(
+        result, smolrtsp_sdp_printf(
+                    w, SMOLRTSP_SDP_ATTR, "ptime:%" PRIu32, self.ptime_ms));
+    CHK_WRITE_ERR(
+        result, smolrtsp_sdp_printf(
+                    w, SMOLRTSP_SDP_ATTR, "maxptime:%" PRIu32,
+                    0 == self.maxptime_ms ? self.ptime_ms : self.maxptime_ms));
+
+    return result;
+}
+
+int SmolRTSP_RtpTransport_enable_audio_aggregation(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpAudioAggregationConfig config) {
+    assert(self);
+    assert(config.ptime_ms > 0 && config.max_payload_size > 0);
+    assert(0 == config.maxptime_ms || config.maxptime_ms >= config.ptime_ms);
+    assert(!self->audio_aggregation);
+
+    self->audio_buffer = smolrtsp_malloc(config.max_payload_size);
+    if (NULL == self->audio_buffer) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    self->audio_aggregation = true;
+    self->audio_capacity = config.max_payload_size;
+    self->audio_ptime = ms_to_ticks(self, config.ptime_ms);
+    self->audio_maxptime = ms_to_ticks(
+        self, 0 == config.maxptime_ms ? config.ptime_ms : config.maxptime_ms);
+    self->audio_len = 0;
+    self->audio_ts = 0;
+    self->audio_duration = 0;
+
+    return 0;
+}
+
+int SmolRTSP_RtpTransport_send_audio_frame(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts, U8Slice99 frame,
+    uint32_t duration) {
+    assert(self);
+
+    if (!self->audio_aggregation) {
+        return SmolRTSP_RtpTransport_send_packet(
+            self, ts, false, U8Slice99_empty(), frame);
+    }
+
+    const uint32_t timestamp = compute_timestamp(&self->clock, ts);
+
+    const bool follows =
+        (uint32_t)(self->audio_ts + self->audio_duration) == timestamp;
+    if (self->audio_len > 0 &&
+        (!follows ||
+         (uint64_t)self->audio_duration + duration > self->audio_maxptime ||
+         self->audio_len + frame.len > self->audio_capacity) &&
+        SmolRTSP_RtpTransport_flush_audio(self) == -1) {
+        return -1;
+    }
+
+    if (frame.len > self->audio_capacity) {
+        return SmolRTSP_RtpTransport_send_packet(
+            self, SmolRTSP_RtpTimestamp_Raw(timestamp), false,
+            U8Slice99_empty(), frame);
+    }
+
+    if (0 == self->audio_len) {
+        self->audio_ts = timestamp;
+    }
+    memcpy(self->audio_buffer + self->audio_len, frame.ptr, frame.len);
+    self->audio_len += frame.len;
+    self->audio_duration += duration;
+
+    if (self->audio_duration >= self->audio_ptime) {
+        return SmolRTSP_RtpTransport_flush_audio(self);
+    }
+
+    return 0;
+}
+
+int SmolRTSP_RtpTransport_flush_audio(SmolRTSP_RtpTransport *self) {
+    assert(self);
+
+    if (!self->audio_aggregation || 0 == self->audio_len) {
+        return 0;
+    }
+
+    const size_t len = self->audio_len;
+    self->audio_len = 0;
+    self->audio_duration = 0;
+
+    return SmolRTSP_RtpTransport_send_packet(
+        self, SmolRTSP_RtpTimestamp_Raw(self->audio_ts), false,
+        U8Slice99_empty(), U8Slice99_new(self->audio_buffer, len));
+}
+
+void SmolRTSP_RtpTransport_enable_thread_safety(SmolRTSP_RtpTransport *self) {
+    assert(self);
+    assert(NULL == self->estimator);
+
+    self->thread_safe = true;
+}
+
+static uint32_t ms_to_ticks(const SmolRTSP_RtpTransport *self, uint32_t ms) {
+    return (uint32_t)((uint64_t)ms * self->clock.clock_rate / 1000);
+}
+
+static int transmit(SmolRTSP_RtpTransport *self, SmolRTSP_IoVecSlice bufs) {
+    if (NULL != self->udp) {
+        return smolrtsp_udp_transport_transmit(self->udp, bufs);
+    }
+
+    return VCALL(self->transport, transmit, bufs);
+}
+
+static size_t
+transmit_batch(SmolRTSP_RtpTransport *self, SmolRTSP_IoVecBatch batch) {
+    if (NULL == self->udp) {
+        return smolrtsp_transmit_batch(self->transport, batch);
+    }
+
+    // The UDP transport supports batching, so there is no fallback to
+    // `transmit` as in `smolrtsp_transmit_batch`.
+    size_t transmitted = 0;
+    while (transmitted < batch.len) {
+        const ssize_t ret = smolrtsp_udp_transport_transmit_batch(
+            self->udp, SmolRTSP_IoVecBatch_advance(batch, transmitted));
+        if (ret <= 0) {
+            break;
+        }
+
+        transmitted += (size_t)ret;
+    }
+
+    return transmitted;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <smolrtsp/rtp_transport.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// `SmolRTSP_RtpTransport_send_batch` that also writes the number of packets
+// sent to `sent`, which on failure is the index of the failed packet.
+int smolrtsp_rtp_transport_send_counted(
+    SmolRTSP_RtpTransport *self, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_RtpPacketSlice packets, size_t *restrict sent);
+
+// The size of the storage of `smolrtsp_rtp_transport_init_udp`.
+size_t smolrtsp_rtp_transport_udp_size(void);
+
+// Creates the transport of `SmolRTSP_RtpTransport_new_udp` in `storage`,
+// suitably aligned, together with its UDP transport; dropping it does not free
+// `storage`.
+SmolRTSP_RtpTransport *smolrtsp_rtp_transport_init_udp(
+    void *storage, int fd, SmolRTSP_UdpTransportConfig udp_config,
+    uint8_t payload_ty, uint32_t clock_rate);
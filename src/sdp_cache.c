@@ -0,0 +1,73 @@
+#include <smolrtsp/sdp_cache.h>
+
+#include <assert.h>
+#include <errno.h>
+
+#define FNV_PRIME UINT64_C(1099511628211)
+
+uint64_t smolrtsp_sdp_key(uint64_t key, const void *data, size_t len) {
+    assert(data || 0 == len);
+
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        key = (key ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return key;
+}
+
+SmolRTSP_SdpCache SmolRTSP_SdpCache_new(char *buffer, size_t capacity) {
+    assert(buffer);
+    assert(capacity > 0);
+
+    return (SmolRTSP_SdpCache){
+        .sdp = SmolRTSP_StringBuffer_new(buffer, capacity),
+        .key = 0,
+        .valid = false,
+    };
+}
+
+bool SmolRTSP_SdpCache_lookup(
+    const SmolRTSP_SdpCache *self, uint64_t key, CharSlice99 *restrict sdp) {
+    assert(self);
+    assert(sdp);
+
+    if (!self->valid || self->key != key) {
+        return false;
+    }
+
+    *sdp = SmolRTSP_StringBuffer_as_slice(&self->sdp);
+    return true;
+}
+
+SmolRTSP_Writer SmolRTSP_SdpCache_begin(SmolRTSP_SdpCache *self) {
+    assert(self);
+
+    self->sdp = SmolRTSP_StringBuffer_new(self->sdp.buffer, self->sdp.capacity);
+    self->valid = false;
+
+    return smolrtsp_string_buffer_writer(&self->sdp);
+}
+
+int SmolRTSP_SdpCache_commit(
+    SmolRTSP_SdpCache *self, uint64_t key, CharSlice99 *restrict sdp) {
+    assert(self);
+    assert(sdp);
+
+    *sdp = SmolRTSP_StringBuffer_as_slice(&self->sdp);
+
+    if (self->sdp.truncated) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    self->key = key;
+    self->valid = true;
+
+    return 0;
+}
+
+void SmolRTSP_SdpCache_invalidate(SmolRTSP_SdpCache *self) {
+    assert(self);
+    self->valid = false;
+}
@@ -0,0 +1,457 @@
+#include <smolrtsp/send_workers.h>
+
+#include <smolrtsp/numa.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+// The maximum number of NAL units taken from one queue before the worker moves
+// on to the next one.
+#define DRAIN_LIMIT 64
+
+typedef struct {
+    SmolRTSP_RtpTimestamp ts;
+    SmolRTSP_NalHeader header;
+    uint8_t *payload;
+    size_t payload_len;
+} Item;
+
+typedef struct Worker Worker;
+
+struct SmolRTSP_SendQueue {
+    SmolRTSP_NalTransport *transport;
+    Worker *worker;
+
+    // The ring of `capacity` items. `head` is advanced only by the worker,
+    // `tail` only by the producer; both grow monotonically.
+    Item *items;
+    size_t capacity, head, tail;
+
+    uint64_t failures;
+
+    // The next queue of the same worker (guarded by `Worker.mutex`).
+    SmolRTSP_SendQueue *next;
+};
+
+struct Worker {
+    pthread_t thread;
+    size_t id;
+
+    // The placement of the thread, -1 if unknown.
+    int cpu, numa_node;
+
+    // Updated with relaxed atomics, so that they can be read from any thread.
+    size_t queues_count;
+    uint64_t local_attachments, remote_attachments;
+
+    // Guards `queues` and `stop`, and is held while the queues are drained.
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    SmolRTSP_SendQueue *queues;
+    bool stop;
+
+    // Set while the worker waits on `cond`, so that producers signal it only
+    // when necessary.
+    bool sleeping;
+};
+
+struct SmolRTSP_SendWorkers {
+    Worker *workers;
+    size_t workers_count, next_worker;
+};
+
+static int start_worker(Worker *worker, bool pin);
+static SmolRTSP_SendQueue *attach_to(
+    Worker *worker, SmolRTSP_NalTransport *t, size_t capacity);
+static Worker *next_worker(SmolRTSP_SendWorkers *self);
+static void *worker_routine(void *arg);
+static bool drain(SmolRTSP_SendQueue *queue);
+static bool has_pending(const Worker *worker);
+static void free_queue(SmolRTSP_SendQueue *queue);
+
+SmolRTSP_SendWorkersConfig
+SmolRTSP_SendWorkersConfig_default(size_t workers_count) {
+    return (SmolRTSP_SendWorkersConfig){
+        .workers_count = workers_count,
+        .pin_workers = false,
+    };
+}
+
+SmolRTSP_SendWorkers *SmolRTSP_SendWorkers_new(size_t workers_count) {
+    assert(workers_count > 0);
+
+    return SmolRTSP_SendWorkers_new_with_config(
+        SmolRTSP_SendWorkersConfig_default(workers_count));
+}
+
+SmolRTSP_SendWorkers *
+SmolRTSP_SendWorkers_new_with_config(SmolRTSP_SendWorkersConfig config) {
+    assert(config.workers_count > 0);
+
+    SmolRTSP_SendWorkers *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        goto fail;
+    }
+
+    self->workers =
+        smolrtsp_malloc(config.workers_count * sizeof self->workers[0]);
+    if (NULL == self->workers) {
+        smolrtsp_free(self);
+        goto fail;
+    }
+    self->workers_count = config.workers_count;
+    self->next_worker = 0;
+
+    for (size_t i = 0; i < config.workers_count; i++) {
+        Worker *worker = &self->workers[i];
+
+        worker->id = i;
+        worker->queues = NULL;
+        worker->stop = false;
+        worker->sleeping = false;
+        worker->queues_count = 0;
+        worker->local_attachments = 0;
+        worker->remote_attachments = 0;
+
+        int ret = pthread_mutex_init(&worker->mutex, NULL);
+        assert(0 == ret);
+        ret = pthread_cond_init(&worker->cond, NULL);
+        assert(0 == ret);
+        ret = start_worker(worker, config.pin_workers);
+        assert(0 == ret);
+        (void)ret;
+    }
+
+    return self;
+
+fail:
+    errno = ENOMEM;
+    return NULL;
+}
+
+// Creates the thread of `worker`, on the CPU of its index if `pin`. A CPU that
+// the process may not use is not an error: the worker runs unpinned then.
+static int start_worker(Worker *worker, bool pin) {
+    worker->cpu = -1;
+    worker->numa_node = -1;
+
+    const int cpu = pin ? smolrtsp_allowed_cpu(worker->id) : -1;
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        int ret = pthread_attr_setaffinity_np(&attr, sizeof set, &set);
+        if (0 == ret) {
+            ret = pthread_create(
+                &worker->thread, &attr, worker_routine, worker);
+        }
+        pthread_attr_destroy(&attr);
+
+        if (0 == ret) {
+            worker->cpu = cpu;
+            worker->numa_node = smolrtsp_cpu_numa_node(cpu);
+            return 0;
+        }
+    }
+
+    return pthread_create(&worker->thread, NULL, worker_routine, worker);
+}
+
+static void SmolRTSP_SendWorkers_drop(VSelf) {
+    VSELF(SmolRTSP_SendWorkers);
+    assert(self);
+
+    for (size_t i = 0; i < self->workers_count; i++) {
+        Worker *worker = &self->workers[i];
+
+        pthread_mutex_lock(&worker->mutex);
+        worker->stop = true;
+        pthread_cond_signal(&worker->cond);
+        pthread_mutex_unlock(&worker->mutex);
+
+        pthread_join(worker->thread, NULL);
+
+        while (worker->queues != NULL) {
+            SmolRTSP_SendQueue *next = worker->queues->next;
+            free_queue(worker->queues);
+            worker->queues = next;
+        }
+
+        pthread_cond_destroy(&worker->cond);
+        pthread_mutex_destroy(&worker->mutex);
+    }
+
+    smolrtsp_free(self->workers);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_SendWorkers);
+
+SmolRTSP_SendQueue *SmolRTSP_SendWorkers_attach(
+    SmolRTSP_SendWorkers *self, SmolRTSP_NalTransport *t, size_t capacity) {
+    assert(self);
+    assert(t);
+    assert(capacity > 0);
+
+    return attach_to(next_worker(self), t, capacity);
+}
+
+SmolRTSP_SendQueue *SmolRTSP_SendWorkers_attach_on_node(
+    SmolRTSP_SendWorkers *self, SmolRTSP_NalTransport *t, size_t capacity,
+    int numa_node) {
+    assert(self);
+    assert(t);
+    assert(capacity > 0);
+
+    Worker *worker = NULL;
+    size_t least_queues = SIZE_MAX;
+    for (size_t i = 0; numa_node >= 0 && i < self->workers_count; i++) {
+        Worker *candidate = &self->workers[i];
+        const size_t queues =
+            __atomic_load_n(&candidate->queues_count, __ATOMIC_RELAXED);
+        if (candidate->numa_node == numa_node && queues < least_queues) {
+            worker = candidate;
+            least_queues = queues;
+        }
+    }
+
+    const bool is_local = NULL != worker;
+    if (!is_local) {
+        worker = next_worker(self);
+    }
+
+    SmolRTSP_SendQueue *queue = attach_to(worker, t, capacity);
+    if (NULL == queue) {
+        return NULL;
+    }
+
+    if (is_local) {
+        __atomic_fetch_add(&worker->local_attachments, 1, __ATOMIC_RELAXED);
+    } else if (numa_node >= 0) {
+        __atomic_fetch_add(&worker->remote_attachments, 1, __ATOMIC_RELAXED);
+    }
+
+    return queue;
+}
+
+static SmolRTSP_SendQueue *
+attach_to(Worker *worker, SmolRTSP_NalTransport *t, size_t capacity) {
+    SmolRTSP_SendQueue *queue = smolrtsp_malloc(sizeof *queue);
+    if (NULL == queue) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    queue->items = smolrtsp_malloc(capacity * sizeof queue->items[0]);
+    if (NULL == queue->items) {
+        smolrtsp_free(queue);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    queue->transport = t;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->failures = 0;
+    queue->worker = worker;
+
+    pthread_mutex_lock(&worker->mutex);
+    queue->next = worker->queues;
+    worker->queues = queue;
+    __atomic_fetch_add(&worker->queues_count, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&worker->mutex);
+
+    return queue;
+}
+
+static Worker *next_worker(SmolRTSP_SendWorkers *self) {
+    const size_t worker_idx =
+        __atomic_fetch_add(&self->next_worker, 1, __ATOMIC_RELAXED) %
+        self->workers_count;
+    return &self->workers[worker_idx];
+}
+
+void SmolRTSP_SendWorkers_detach(
+    SmolRTSP_SendWorkers *self, SmolRTSP_SendQueue *queue) {
+    assert(self);
+    assert(queue);
+
+    Worker *worker = queue->worker;
+
+    pthread_mutex_lock(&worker->mutex);
+    SmolRTSP_SendQueue **link = &worker->queues;
+    while (*link != queue) {
+        assert(*link != NULL);
+        link = &(*link)->next;
+    }
+    *link = queue->next;
+    __atomic_fetch_sub(&worker->queues_count, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&worker->mutex);
+
+    free_queue(queue);
+}
+
+int SmolRTSP_SendQueue_push(
+    SmolRTSP_SendQueue *queue, SmolRTSP_RtpTimestamp ts,
+    SmolRTSP_NalUnit nalu) {
+    assert(queue);
+
+    const size_t tail = queue->tail,
+                 head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (tail - head == queue->capacity) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    uint8_t *payload = smolrtsp_malloc(nalu.payload.len);
+    if (NULL == payload && nalu.payload.len > 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (nalu.payload.len > 0) {
+        memcpy(payload, nalu.payload.ptr, nalu.payload.len);
+    }
+
+    queue->items[tail % queue->capacity] = (Item){
+        .ts = ts,
+        .header = nalu.header,
+        .payload = payload,
+        .payload_len = nalu.payload.len,
+    };
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+    // Pairs with the store to `sleeping` before the worker rechecks its
+    // queues: either the worker sees the new item, or we see it sleeping.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    Worker *worker = queue->worker;
+    if (__atomic_load_n(&worker->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&worker->mutex);
+        pthread_cond_signal(&worker->cond);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    return 0;
+}
+
+uint64_t SmolRTSP_SendQueue_failures(const SmolRTSP_SendQueue *queue) {
+    assert(queue);
+    return __atomic_load_n(&queue->failures, __ATOMIC_RELAXED);
+}
+
+size_t SmolRTSP_SendQueue_worker(const SmolRTSP_SendQueue *queue) {
+    assert(queue);
+    return queue->worker->id;
+}
+
+size_t SmolRTSP_SendWorkers_workers_count(const SmolRTSP_SendWorkers *self) {
+    assert(self);
+    return self->workers_count;
+}
+
+SmolRTSP_SendWorkerStats SmolRTSP_SendWorkers_worker_stats(
+    const SmolRTSP_SendWorkers *self, size_t worker_id) {
+    assert(self);
+    assert(worker_id < self->workers_count);
+
+    const Worker *worker = &self->workers[worker_id];
+
+    return (SmolRTSP_SendWorkerStats){
+        .cpu = worker->cpu,
+        .numa_node = worker->numa_node,
+        .queues = __atomic_load_n(&worker->queues_count, __ATOMIC_RELAXED),
+        .local_attachments =
+            __atomic_load_n(&worker->local_attachments, __ATOMIC_RELAXED),
+        .remote_attachments =
+            __atomic_load_n(&worker->remote_attachments, __ATOMIC_RELAXED),
+    };
+}
+
+static void *worker_routine(void *arg) {
+    Worker *worker = arg;
+
+    pthread_mutex_lock(&worker->mutex);
+
+    while (!worker->stop) {
+        bool progress = false;
+        for (SmolRTSP_SendQueue *queue = worker->queues; queue != NULL;
+             queue = queue->next) {
+            progress |= drain(queue);
+        }
+
+        if (progress) {
+            // Let `attach`/`detach` in between the passes.
+            pthread_mutex_unlock(&worker->mutex);
+            pthread_mutex_lock(&worker->mutex);
+            continue;
+        }
+
+        __atomic_store_n(&worker->sleeping, true, __ATOMIC_SEQ_CST);
+        if (!has_pending(worker) && !worker->stop) {
+            pthread_cond_wait(&worker->cond, &worker->mutex);
+        }
+        __atomic_store_n(&worker->sleeping, false, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&worker->mutex);
+
+    return NULL;
+}
+
+static bool drain(SmolRTSP_SendQueue *queue) {
+    size_t head = queue->head;
+    const size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    size_t drained = 0;
+    for (; head != tail && drained < DRAIN_LIMIT; head++, drained++) {
+        Item *item = &queue->items[head % queue->capacity];
+
+        const SmolRTSP_NalUnit nalu = {
+            .header = item->header,
+            .payload = U8Slice99_new(item->payload, item->payload_len),
+        };
+        if (SmolRTSP_NalTransport_send_packet(
+                queue->transport, item->ts, nalu) == -1) {
+            __atomic_fetch_add(&queue->failures, 1, __ATOMIC_RELAXED);
+        }
+
+        smolrtsp_free(item->payload);
+        __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    return drained > 0;
+}
+
+static bool has_pending(const Worker *worker) {
+    for (const SmolRTSP_SendQueue *queue = worker->queues; queue != NULL;
+         queue = queue->next) {
+        if (__atomic_load_n(&queue->tail, __ATOMIC_SEQ_CST) != queue->head) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void free_queue(SmolRTSP_SendQueue *queue) {
+    for (size_t i = queue->head; i != queue->tail; i++) {
+        smolrtsp_free(queue->items[i % queue->capacity].payload);
+    }
+
+    smolrtsp_free(queue->items);
+    smolrtsp_free(queue);
+}
@@ -0,0 +1,1129 @@
+#include <smolrtsp/server.h>
+
+#include <smolrtsp/demuxer.h>
+#include <smolrtsp/numa.h>
+#include <smolrtsp/types/method.h>
+#include <smolrtsp/util.h>
+
+#include "alloc.h"
+#include "types/parsing.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// The maximum number of events handled per `epoll_wait`.
+#define MAX_EVENTS 64
+
+// A keep-alive request recognized by `match_keep_alive`.
+typedef struct {
+    SmolRTSP_MethodId method;
+    uint32_t cseq;
+    CharSlice99 session;
+} KeepAlive;
+
+// The first member of everything registered in the `epoll` set of a worker.
+typedef enum {
+    SourceKind_Listener,
+    SourceKind_Wakeup,
+    SourceKind_Connection,
+} SourceKind;
+
+typedef struct Worker Worker;
+
+// The received data not parsed yet, and the state of its parsing, which refers
+// to `data`.
+typedef struct {
+    SmolRTSP_Demuxer demuxer;
+    SmolRTSP_Request request;
+
+    // The number of reads since the last complete request or frame, and the
+    // time of the first one (if `request_timeout_ms` is set).
+    size_t reads;
+    uint64_t started_ms;
+
+    size_t len;
+    char data[];
+} Input;
+
+struct SmolRTSP_ServerConnection {
+    SourceKind kind;
+    Worker *worker;
+    int fd, numa_node;
+
+    SmolRTSP_Controller controller;
+
+    // Guards `out`, `want_write`, `in`, and `buffered`; recursive, since the
+    // controller can write while the worker holds it for dispatching.
+    pthread_mutex_t mutex;
+    SmolRTSP_NonblockingFdWriter out;
+    bool want_write;
+
+    // The partial request, or `NULL` if everything received has been
+    // dispatched. Set and cleared only by the worker.
+    Input *in;
+
+    // Whether `in` or the buffer of `out` is allocated.
+    bool buffered;
+
+    // The other connections of the same worker.
+    SmolRTSP_ServerConnection *prev, *next;
+};
+
+struct Worker {
+    SmolRTSP_Server *server;
+    size_t id;
+    pthread_t thread;
+
+    // The placement of the thread, -1 if unknown.
+    int cpu, numa_node;
+
+    // Updated with relaxed atomics, so that they can be read from any thread.
+    uint64_t connections, local_connections, buffered_connections;
+    uint64_t keep_alives, rejected_connections;
+
+    int epoll_fd, listen_fd, wakeup_fd;
+    SourceKind listener_kind, wakeup_kind;
+
+    SmolRTSP_ServerConnection *conns;
+
+    // The input that the connections without a partial request read into, so
+    // that they need no buffers of their own; `NULL` until needed.
+    Input *spare_input;
+};
+
+struct SmolRTSP_Server {
+    SmolRTSP_ServerConfig config;
+    uint16_t port;
+
+    Worker *workers;
+    size_t workers_count;
+};
+
+static int listen_on(
+    const SmolRTSP_Server *self, const struct sockaddr *addr,
+    socklen_t addr_len);
+static int init_worker(Worker *worker, int listen_fd);
+static int start_worker(Worker *worker);
+static void free_worker(Worker *worker);
+static void *worker_routine(void *arg);
+static void accept_all(Worker *worker);
+static void handle_events(SmolRTSP_ServerConnection *conn, uint32_t events);
+static int handle_readable(SmolRTSP_ServerConnection *conn);
+static int handle_writable(SmolRTSP_ServerConnection *conn);
+static int process_input(SmolRTSP_ServerConnection *conn, Input *in);
+static bool within_limits(const SmolRTSP_ServerConfig *config, const Input *in);
+static void sweep_requests(Worker *worker);
+static size_t answer_keep_alive(SmolRTSP_ServerConnection *conn, Input *in);
+static size_t
+match_keep_alive(CharSlice99 input, bool options, KeepAlive *restrict ka);
+static void consume_input(Input *in, size_t len);
+static void watch_writable(SmolRTSP_ServerConnection *conn, bool enable);
+static void track_buffers(SmolRTSP_ServerConnection *conn);
+static Input *new_input(size_t capacity);
+static void reset_input(Input *in);
+static void close_connection(SmolRTSP_ServerConnection *conn);
+static int incoming_numa_node(int fd);
+static uint64_t now_ms(void);
+
+SmolRTSP_ServerConfig
+SmolRTSP_ServerConfig_default(SmolRTSP_ServerAcceptCb accept_cb, void *arg) {
+    assert(accept_cb);
+
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (SmolRTSP_ServerConfig){
+        .workers_count = cpus > 0 ? (size_t)cpus : 1,
+        .backlog = 128,
+        .recv_buffer_size = 4096,
+        .send_buffer_size = 64 * 1024,
+        .accept_cb = accept_cb,
+        .tick_cb = NULL,
+        .tick_interval_ms = 0,
+        .arg = arg,
+        .pin_workers = false,
+        .keep_alive_sessions = NULL,
+        .keep_alive_public = NULL,
+        .max_request_size = 0,
+        .request_timeout_ms = SMOLRTSP_SERVER_DEFAULT_REQUEST_TIMEOUT_MS,
+        .max_parse_attempts = SMOLRTSP_SERVER_DEFAULT_MAX_PARSE_ATTEMPTS,
+        .max_interleaved_pending = 0,
+    };
+}
+
+SmolRTSP_Server *SmolRTSP_Server_start(
+    const struct sockaddr *addr, socklen_t addr_len,
+    SmolRTSP_ServerConfig config) {
+    assert(addr);
+    assert(config.workers_count > 0);
+    assert(config.recv_buffer_size > 0);
+    assert(config.send_buffer_size > 0);
+    assert(config.accept_cb);
+
+    SmolRTSP_Server *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->config = config;
+    self->workers =
+        smolrtsp_malloc(config.workers_count * sizeof self->workers[0]);
+    if (NULL == self->workers) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->workers_count = 0;
+
+    // The kernel picks an ephemeral port for the first listener; the others
+    // must join it there.
+    struct sockaddr_storage bound;
+    socklen_t bound_len = sizeof bound;
+
+    int error = 0;
+    for (size_t i = 0; i < config.workers_count; i++) {
+        const int listen_fd = 0 == i
+                                  ? listen_on(self, addr, addr_len)
+                                  : listen_on(
+                                        self, (const struct sockaddr *)&bound,
+                                        bound_len);
+        if (-1 == listen_fd) {
+            error = errno;
+            break;
+        }
+
+        if (0 == i &&
+            getsockname(listen_fd, (struct sockaddr *)&bound, &bound_len) ==
+                -1) {
+            error = errno;
+            close(listen_fd);
+            break;
+        }
+
+        Worker *worker = &self->workers[i];
+        worker->server = self;
+        worker->id = i;
+        worker->cpu = config.pin_workers ? smolrtsp_allowed_cpu(i) : -1;
+        if (init_worker(worker, listen_fd) == -1) {
+            error = errno;
+            break;
+        }
+
+        self->workers_count++;
+    }
+
+    if (0 == error) {
+        self->port = ntohs(
+            AF_INET6 == bound.ss_family
+                ? ((const struct sockaddr_in6 *)&bound)->sin6_port
+                : ((const struct sockaddr_in *)&bound)->sin_port);
+
+        for (size_t i = 0; i < self->workers_count; i++) {
+            error = start_worker(&self->workers[i]);
+            if (error != 0) {
+                break;
+            }
+        }
+    }
+
+    if (error != 0) {
+        // Stops the workers started so far and frees the initialized ones.
+        VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(self);
+        errno = error;
+        return NULL;
+    }
+
+    return self;
+}
+
+uint16_t SmolRTSP_Server_port(const SmolRTSP_Server *self) {
+    assert(self);
+    return self->port;
+}
+
+static void SmolRTSP_Server_drop(VSelf) {
+    VSELF(SmolRTSP_Server);
+    assert(self);
+
+    for (size_t i = 0; i < self->workers_count; i++) {
+        const uint64_t one = 1;
+        const ssize_t ret =
+            write(self->workers[i].wakeup_fd, &one, sizeof one);
+        (void)ret;
+    }
+
+    for (size_t i = 0; i < self->workers_count; i++) {
+        Worker *worker = &self->workers[i];
+        if (worker->thread != 0) {
+            pthread_join(worker->thread, NULL);
+        }
+        free_worker(worker);
+    }
+
+    smolrtsp_free(self->workers);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Server);
+
+SmolRTSP_ServerWorkerStats SmolRTSP_Server_worker_stats(
+    const SmolRTSP_Server *self, size_t worker_id) {
+    assert(self);
+    assert(worker_id < self->workers_count);
+
+    const Worker *worker = &self->workers[worker_id];
+
+    return (SmolRTSP_ServerWorkerStats){
+        .cpu = worker->cpu,
+        .numa_node = worker->numa_node,
+        .connections = __atomic_load_n(&worker->connections, __ATOMIC_RELAXED),
+        .local_connections =
+            __atomic_load_n(&worker->local_connections, __ATOMIC_RELAXED),
+        .buffered_connections =
+            __atomic_load_n(&worker->buffered_connections, __ATOMIC_RELAXED),
+        .keep_alives = __atomic_load_n(&worker->keep_alives, __ATOMIC_RELAXED),
+        .rejected_connections =
+            __atomic_load_n(&worker->rejected_connections, __ATOMIC_RELAXED),
+    };
+}
+
+int SmolRTSP_ServerConnection_fd(const SmolRTSP_ServerConnection *self) {
+    assert(self);
+    return self->fd;
+}
+
+size_t
+SmolRTSP_ServerConnection_worker(const SmolRTSP_ServerConnection *self) {
+    assert(self);
+    return self->worker->id;
+}
+
+int SmolRTSP_ServerConnection_numa_node(const SmolRTSP_ServerConnection *self) {
+    assert(self);
+    return self->numa_node;
+}
+
+typedef SmolRTSP_ServerConnection ConnectionWriter;
+
+#define ConnectionWriter_writev_CUSTOM ()
+static ssize_t ConnectionWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(ConnectionWriter);
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const ssize_t ret =
+        smolrtsp_writev(smolrtsp_nonblocking_fd_writer(&self->out), bufs);
+    watch_writable(self, self->out.len > 0);
+    track_buffers(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret;
+}
+
+static ssize_t ConnectionWriter_write(VSelf, CharSlice99 data) {
+    VSELF(ConnectionWriter);
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const ssize_t ret =
+        VCALL(smolrtsp_nonblocking_fd_writer(&self->out), write, data);
+    watch_writable(self, self->out.len > 0);
+    track_buffers(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret;
+}
+
+static void ConnectionWriter_lock(VSelf) {
+    VSELF(ConnectionWriter);
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+}
+
+static void ConnectionWriter_unlock(VSelf) {
+    VSELF(ConnectionWriter);
+    assert(self);
+
+    pthread_mutex_unlock(&self->mutex);
+}
+
+static size_t ConnectionWriter_filled(VSelf) {
+    VSELF(ConnectionWriter);
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const size_t ret =
+        VCALL(smolrtsp_nonblocking_fd_writer(&self->out), filled);
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret;
+}
+
+static int
+ConnectionWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
+    VSELF(ConnectionWriter);
+
+    assert(self);
+    assert(fmt);
+
+    pthread_mutex_lock(&self->mutex);
+    const int ret =
+        VCALL(smolrtsp_nonblocking_fd_writer(&self->out), vwritef, fmt, ap);
+    watch_writable(self, self->out.len > 0);
+    track_buffers(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret;
+}
+
+static int ConnectionWriter_writef(VSelf, const char *restrict fmt, ...) {
+    VSELF(ConnectionWriter);
+
+    assert(self);
+    assert(fmt);
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    const int ret = ConnectionWriter_vwritef(self, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+impl(SmolRTSP_Writer, ConnectionWriter);
+
+SmolRTSP_Writer
+SmolRTSP_ServerConnection_writer(SmolRTSP_ServerConnection *self) {
+    assert(self);
+    return DYN(ConnectionWriter, SmolRTSP_Writer, self);
+}
+
+static int listen_on(
+    const SmolRTSP_Server *self, const struct sockaddr *addr,
+    socklen_t addr_len) {
+    const int fd =
+        socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const int enable = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof enable) ==
+            -1 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof enable) ==
+            -1 ||
+        bind(fd, addr, addr_len) == -1 ||
+        listen(fd, self->config.backlog) == -1) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    return fd;
+}
+
+static int init_worker(Worker *worker, int listen_fd) {
+    worker->thread = 0;
+    worker->numa_node = smolrtsp_cpu_numa_node(worker->cpu);
+    worker->connections = 0;
+    worker->local_connections = 0;
+    worker->listen_fd = listen_fd;
+    worker->listener_kind = SourceKind_Listener;
+    worker->wakeup_kind = SourceKind_Wakeup;
+    worker->buffered_connections = 0;
+    worker->keep_alives = 0;
+    worker->rejected_connections = 0;
+    worker->conns = NULL;
+    worker->spare_input = NULL;
+
+    worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    worker->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event listener_event = {
+        .events = EPOLLIN,
+        .data.ptr = &worker->listener_kind,
+    };
+    struct epoll_event wakeup_event = {
+        .events = EPOLLIN,
+        .data.ptr = &worker->wakeup_kind,
+    };
+
+    if (-1 == worker->epoll_fd || -1 == worker->wakeup_fd ||
+        epoll_ctl(
+            worker->epoll_fd, EPOLL_CTL_ADD, listen_fd, &listener_event) ==
+            -1 ||
+        epoll_ctl(
+            worker->epoll_fd, EPOLL_CTL_ADD, worker->wakeup_fd,
+            &wakeup_event) == -1) {
+        const int error = errno;
+        if (worker->epoll_fd != -1) {
+            close(worker->epoll_fd);
+        }
+        if (worker->wakeup_fd != -1) {
+            close(worker->wakeup_fd);
+        }
+        close(listen_fd);
+        errno = error;
+        return -1;
+    }
+
+    // Among the listeners sharing the port, the kernel prefers the one of the
+    // CPU that has received the connection; merely a hint, so failures are
+    // ignored.
+    if (worker->cpu >= 0) {
+        const int ret = setsockopt(
+            listen_fd, SOL_SOCKET, SO_INCOMING_CPU, &worker->cpu,
+            sizeof worker->cpu);
+        (void)ret;
+    }
+
+    return 0;
+}
+
+// Returns 0 or an error number, as `pthread_create` does. A CPU that the
+// process may not use is not an error: the worker runs unpinned then.
+static int start_worker(Worker *worker) {
+    if (worker->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker->cpu, &set);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        int ret = pthread_attr_setaffinity_np(&attr, sizeof set, &set);
+        if (0 == ret) {
+            ret = pthread_create(
+                &worker->thread, &attr, worker_routine, worker);
+        }
+        pthread_attr_destroy(&attr);
+
+        if (0 == ret) {
+            return 0;
+        }
+
+        worker->cpu = -1;
+        worker->numa_node = -1;
+    }
+
+    return pthread_create(&worker->thread, NULL, worker_routine, worker);
+}
+
+static void free_worker(Worker *worker) {
+    while (worker->conns != NULL) {
+        close_connection(worker->conns);
+    }
+
+    smolrtsp_free(worker->spare_input);
+    close(worker->listen_fd);
+    close(worker->wakeup_fd);
+    close(worker->epoll_fd);
+}
+
+static void *worker_routine(void *arg) {
+    Worker *worker = arg;
+    const SmolRTSP_ServerConfig *config = &worker->server->config;
+
+    const bool ticks = config->tick_cb != NULL && config->tick_interval_ms > 0;
+    uint64_t next_tick = ticks ? now_ms() + config->tick_interval_ms : 0;
+
+    const bool sweeps = config->request_timeout_ms > 0;
+    const int sweep_interval_ms =
+        config->request_timeout_ms >= 4 ? config->request_timeout_ms / 4 : 1;
+    uint64_t next_sweep = sweeps ? now_ms() + sweep_interval_ms : 0;
+
+    for (;;) {
+        int timeout = -1;
+        if (ticks || sweeps) {
+            const uint64_t now = now_ms();
+            const uint64_t next = !sweeps || (ticks && next_tick < next_sweep)
+                                      ? next_tick
+                                      : next_sweep;
+            timeout = next > now ? (int)(next - now) : 0;
+        }
+
+        struct epoll_event events[MAX_EVENTS];
+        const int n = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, timeout);
+        if (-1 == n && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            switch (*(const SourceKind *)events[i].data.ptr) {
+            case SourceKind_Listener:
+                accept_all(worker);
+                break;
+            case SourceKind_Wakeup:
+                return NULL;
+            case SourceKind_Connection:
+                handle_events(events[i].data.ptr, events[i].events);
+                break;
+            }
+        }
+
+        if (ticks && now_ms() >= next_tick) {
+            config->tick_cb(worker->id, config->arg);
+            next_tick = now_ms() + config->tick_interval_ms;
+        }
+
+        if (sweeps && now_ms() >= next_sweep) {
+            sweep_requests(worker);
+            next_sweep = now_ms() + sweep_interval_ms;
+        }
+    }
+
+    return NULL;
+}
+
+static void accept_all(Worker *worker) {
+    const SmolRTSP_ServerConfig *config = &worker->server->config;
+
+    for (;;) {
+        const int fd = accept4(
+            worker->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (-1 == fd) {
+            // `EAGAIN` once the backlog is empty; the other errors concern
+            // only the connection being accepted.
+            if (EINTR == errno || ECONNABORTED == errno) {
+                continue;
+            }
+            return;
+        }
+
+        // The buffers are allocated only while they hold data, so that an
+        // idle connection costs just this structure.
+        SmolRTSP_ServerConnection *conn = smolrtsp_malloc(sizeof *conn);
+        if (NULL == conn) {
+            // Out of memory (e.g., the static pools are exhausted): turn this
+            // client away and keep serving the others.
+            __atomic_fetch_add(
+                &worker->rejected_connections, 1, __ATOMIC_RELAXED);
+            close(fd);
+            continue;
+        }
+
+        conn->kind = SourceKind_Connection;
+        conn->worker = worker;
+        conn->fd = fd;
+        conn->numa_node = incoming_numa_node(fd);
+        conn->out =
+            SmolRTSP_NonblockingFdWriter_new_lazy(fd, config->send_buffer_size);
+        conn->want_write = false;
+        conn->in = NULL;
+        conn->buffered = false;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&conn->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+        if (!config->accept_cb(conn, config->arg, &conn->controller) ||
+            epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            SmolRTSP_NonblockingFdWriter_release(&conn->out);
+            pthread_mutex_destroy(&conn->mutex);
+            close(fd);
+            smolrtsp_free(conn);
+            continue;
+        }
+
+        __atomic_fetch_add(&worker->connections, 1, __ATOMIC_RELAXED);
+        if (conn->numa_node >= 0 && conn->numa_node == worker->numa_node) {
+            __atomic_fetch_add(
+                &worker->local_connections, 1, __ATOMIC_RELAXED);
+        }
+
+        conn->prev = NULL;
+        conn->next = worker->conns;
+        if (worker->conns != NULL) {
+            worker->conns->prev = conn;
+        }
+        worker->conns = conn;
+    }
+}
+
+static void handle_events(SmolRTSP_ServerConnection *conn, uint32_t events) {
+    if ((events & EPOLLOUT) && handle_writable(conn) == -1) {
+        close_connection(conn);
+        return;
+    }
+
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) &&
+        handle_readable(conn) == -1) {
+        close_connection(conn);
+    }
+}
+
+static int handle_readable(SmolRTSP_ServerConnection *conn) {
+    Worker *worker = conn->worker;
+    const SmolRTSP_ServerConfig *config = &worker->server->config;
+    const size_t capacity = config->recv_buffer_size;
+
+    Input *in = conn->in;
+    if (NULL == in) {
+        if (NULL == worker->spare_input) {
+            worker->spare_input = new_input(capacity);
+            if (NULL == worker->spare_input) {
+                return -1;
+            }
+        }
+        in = worker->spare_input;
+    }
+
+    ssize_t n;
+    do {
+        n = read(conn->fd, in->data + in->len, capacity - in->len);
+    } while (n < 0 && EINTR == errno);
+
+    if (n < 0) {
+        return EAGAIN == errno || EWOULDBLOCK == errno ? 0 : -1;
+    }
+    if (0 == n) {
+        return -1;
+    }
+
+    in->len += (size_t)n;
+
+    const uint64_t now = config->request_timeout_ms > 0 ? now_ms() : 0;
+    if (0 == in->reads++) {
+        in->started_ms = now;
+    }
+
+    int ret = process_input(conn, in);
+
+    // The rest of the read begins the next request or frame.
+    if (0 == in->len) {
+        in->reads = 0;
+    } else if (0 == in->reads) {
+        in->reads = 1;
+        in->started_ms = now;
+    }
+
+    // Also fails on a request that does not fit into the buffer.
+    if (0 == ret && (in->len == capacity || !within_limits(config, in))) {
+        __atomic_fetch_add(&worker->rejected_connections, 1, __ATOMIC_RELAXED);
+        ret = -1;
+    }
+
+    if (-1 == ret) {
+        if (in == worker->spare_input) {
+            reset_input(in);
+        }
+        return -1;
+    }
+
+    pthread_mutex_lock(&conn->mutex);
+    if (in->len > 0 && NULL == conn->in) {
+        // The partial request keeps referring to the input, so the connection
+        // takes it over.
+        conn->in = in;
+        worker->spare_input = NULL;
+    } else if (0 == in->len && conn->in != NULL) {
+        conn->in = NULL;
+        if (NULL == worker->spare_input) {
+            reset_input(in);
+            worker->spare_input = in;
+        } else {
+            smolrtsp_free(in);
+        }
+    }
+    track_buffers(conn);
+    pthread_mutex_unlock(&conn->mutex);
+
+    return 0;
+}
+
+static int handle_writable(SmolRTSP_ServerConnection *conn) {
+    pthread_mutex_lock(&conn->mutex);
+    const ssize_t pending = SmolRTSP_NonblockingFdWriter_flush(&conn->out);
+    if (pending >= 0) {
+        watch_writable(conn, pending > 0);
+    }
+    track_buffers(conn);
+    pthread_mutex_unlock(&conn->mutex);
+
+    return pending < 0 ? -1 : 0;
+}
+
+// Dispatches all the complete requests of the receive buffer.
+static int process_input(SmolRTSP_ServerConnection *conn, Input *in) {
+    const SmolRTSP_Writer w = SmolRTSP_ServerConnection_writer(conn);
+
+    for (;;) {
+        const size_t keep_alive_len = answer_keep_alive(conn, in);
+        if (keep_alive_len > 0) {
+            consume_input(in, keep_alive_len);
+            in->reads = 0;
+            continue;
+        }
+
+        const SmolRTSP_ParseResult res = SmolRTSP_Demuxer_parse(
+            &in->demuxer, &in->request, CharSlice99_new(in->data, in->len));
+
+        size_t consumed = 0;
+        bool complete = false;
+
+        match(res) {
+            of(SmolRTSP_ParseResult_Success, status) {
+                match(*status) {
+                    of(SmolRTSP_ParseStatus_Complete, offset) {
+                        consumed = *offset;
+                        complete = true;
+                    }
+                    otherwise {
+                        // The interleaved frames before the request have
+                        // been handled already.
+                        consumed = SmolRTSP_Demuxer_drain(&in->demuxer);
+                    }
+                }
+            }
+            of(SmolRTSP_ParseResult_Failure, error) {
+                (void)error;
+                return -1;
+            }
+        }
+
+        if (complete) {
+            VCALL(w, lock);
+            smolrtsp_dispatch(w, conn->controller, &in->request);
+            VCALL(w, unlock);
+            in->request = SmolRTSP_Request_uninit();
+        }
+
+        consume_input(in, consumed);
+
+        // A complete request or frame restarts the limits of the input.
+        if (consumed > 0) {
+            in->reads = 0;
+        }
+
+        if (!complete) {
+            return 0;
+        }
+    }
+}
+
+// Returns whether the request or the interleaved frame being received can
+// still complete within the limits of `config`; the time limit is checked by
+// `sweep_requests`.
+static bool
+within_limits(const SmolRTSP_ServerConfig *config, const Input *in) {
+    const size_t frames_len = in->demuxer.frames_len;
+    const size_t len = in->len - frames_len;
+    if (0 == len) {
+        return true;
+    }
+
+    // Another read would be needed to complete it.
+    if (config->max_parse_attempts > 0 &&
+        in->reads >= config->max_parse_attempts) {
+        return false;
+    }
+
+    const SmolRTSP_RequestParser *parser = &in->demuxer.parser;
+    const char *data = in->data + frames_len;
+
+    if ('$' == data[0] &&
+        SmolRTSP_RequestParserSection_StartLine == parser->section &&
+        0 == parser->scanned) {
+        const size_t max = config->max_interleaved_pending > 0
+                               ? config->max_interleaved_pending
+                               : config->recv_buffer_size;
+        if (len < sizeof(uint32_t)) {
+            return len < max;
+        }
+
+        uint8_t channel_id;
+        uint16_t payload_len;
+        smolrtsp_parse_interleaved_header(
+            (const uint8_t *)data, &channel_id, &payload_len);
+        return sizeof(uint32_t) + payload_len <= max;
+    }
+
+    size_t max = config->recv_buffer_size;
+    if (config->max_request_size > 0 && config->max_request_size < max) {
+        max = config->max_request_size;
+    }
+
+    return len < max &&
+           (parser->section != SmolRTSP_RequestParserSection_Body ||
+            parser->offset + parser->content_length <= max);
+}
+
+// Closes the connections whose partial requests have exceeded
+// `request_timeout_ms`.
+static void sweep_requests(Worker *worker) {
+    const uint64_t timeout_ms =
+        (uint64_t)worker->server->config.request_timeout_ms;
+    const uint64_t now = now_ms();
+
+    for (SmolRTSP_ServerConnection *conn = worker->conns, *next; conn != NULL;
+         conn = next) {
+        next = conn->next;
+
+        if (conn->in != NULL && now - conn->in->started_ms >= timeout_ms) {
+            __atomic_fetch_add(
+                &worker->rejected_connections, 1, __ATOMIC_RELAXED);
+            close_connection(conn);
+        }
+    }
+}
+
+// Answers the keep-alive request at the beginning of `in`, if any, and returns
+// its length, or returns 0 to leave the input to the demultiplexer.
+static size_t answer_keep_alive(SmolRTSP_ServerConnection *conn, Input *in) {
+    Worker *worker = conn->worker;
+    const SmolRTSP_ServerConfig *config = &worker->server->config;
+    const SmolRTSP_RequestParser *parser = &in->demuxer.parser;
+
+    // The demultiplexer must not be amid a request, which it refers to.
+    if (NULL == config->keep_alive_sessions ||
+        parser->section != SmolRTSP_RequestParserSection_StartLine ||
+        parser->offset > 0 || in->demuxer.frames_len > 0) {
+        return 0;
+    }
+
+    KeepAlive ka;
+    const size_t len = match_keep_alive(
+        CharSlice99_new(in->data, in->len), config->keep_alive_public != NULL,
+        &ka);
+    if (0 == len) {
+        return 0;
+    }
+
+    SmolRTSP_Session *session =
+        SmolRTSP_SessionRegistry_find(config->keep_alive_sessions, ka.session);
+    if (NULL == session) {
+        return 0;
+    }
+
+    char cseq[10];
+    size_t cseq_len = 1;
+    for (uint32_t rest = ka.cseq / 10; rest > 0; rest /= 10) {
+        cseq_len++;
+    }
+    for (size_t i = cseq_len; i > 0; i--, ka.cseq /= 10) {
+        cseq[i - 1] = (char)('0' + ka.cseq % 10);
+    }
+
+    const CharSlice99 id = SmolRTSP_Session_id(session);
+    const bool options = SmolRTSP_MethodId_Options == ka.method;
+    const char *public = options ? config->keep_alive_public : "";
+
+#define VEC(ptr, len) {.iov_base = (void *)(ptr), .iov_len = (len)}
+#define VEC_STR(str)  VEC(str, sizeof str - 1)
+    struct iovec vecs[] = {
+        VEC_STR("RTSP/1.0 200 OK\r\nCSeq: "),
+        VEC(cseq, cseq_len),
+        VEC_STR("\r\nSession: "),
+        VEC(id.ptr, id.len),
+        VEC(options ? "\r\nPublic: " : "", options ? 10 : 0),
+        VEC(public, strlen(public)),
+        VEC_STR("\r\n\r\n"),
+    };
+#undef VEC_STR
+#undef VEC
+
+    __atomic_fetch_add(&worker->keep_alives, 1, __ATOMIC_RELAXED);
+
+    // If the response cannot be written, the connection fails on its own.
+    const ssize_t ret = smolrtsp_writev(
+        SmolRTSP_ServerConnection_writer(conn),
+        SmolRTSP_IoVecSlice_new(vecs, sizeof vecs / sizeof vecs[0]));
+    (void)ret;
+
+    SmolRTSP_Session_release(session);
+
+    // The parser may have scanned a part of the request line already.
+    in->demuxer.parser = SmolRTSP_RequestParser_new();
+
+    return len;
+}
+
+// Recognizes a complete `GET_PARAMETER` (or `OPTIONS` if `options`) with a
+// `CSeq`, a `Session`, and no body at the beginning of `input`, and returns
+// its length, or returns 0 if there is none. Anything unusual is left to the
+// full parser.
+static size_t
+match_keep_alive(CharSlice99 input, bool options, KeepAlive *restrict ka) {
+    const CharSlice99 get_parameter = CharSlice99_from_str("GET_PARAMETER ");
+    const CharSlice99 options_method = CharSlice99_from_str("OPTIONS ");
+
+    if (CharSlice99_primitive_starts_with(input, get_parameter)) {
+        ka->method = SmolRTSP_MethodId_GetParameter;
+    } else if (
+        options && CharSlice99_primitive_starts_with(input, options_method)) {
+        ka->method = SmolRTSP_MethodId_Options;
+    } else {
+        return 0;
+    }
+
+    const char *end = memmem(input.ptr, input.len, "\r\n\r\n", 4);
+    if (NULL == end) {
+        return 0;
+    }
+    const size_t len = (size_t)(end - input.ptr) + 4;
+
+    // The request line.
+    const char *line_end = memmem(input.ptr, len, "\r\n", 2);
+    const CharSlice99 request_line =
+        CharSlice99_from_ptrdiff(input.ptr, (char *)line_end);
+    if (!CharSlice99_primitive_ends_with(
+            request_line, CharSlice99_from_str(" RTSP/1.0"))) {
+        return 0;
+    }
+
+    bool has_cseq = false;
+    ka->session = CharSlice99_empty();
+
+    for (const char *line = line_end + 2; line < end;) {
+        line_end = memmem(line, (size_t)(end + 2 - line), "\r\n", 2);
+        const char *colon = memchr(line, ':', (size_t)(line_end - line));
+
+        // A line with no colon or a continuation line.
+        if (NULL == colon || ' ' == *line || '\t' == *line) {
+            return 0;
+        }
+
+        const CharSlice99 key = smolrtsp_trim(
+            CharSlice99_from_ptrdiff((char *)line, (char *)colon));
+        const CharSlice99 value = smolrtsp_trim(
+            CharSlice99_from_ptrdiff((char *)colon + 1, (char *)line_end));
+        uint64_t n;
+
+        if (smolrtsp_eq_ignore_case(key, SMOLRTSP_HEADER_C_SEQ)) {
+            if (!smolrtsp_parse_uint(value, UINT32_MAX, &n)) {
+                return 0;
+            }
+            ka->cseq = (uint32_t)n;
+            has_cseq = true;
+        } else if (smolrtsp_eq_ignore_case(key, SMOLRTSP_HEADER_SESSION)) {
+            ka->session = value;
+        } else if (smolrtsp_eq_ignore_case(
+                       key, SMOLRTSP_HEADER_CONTENT_LENGTH)) {
+            if (!smolrtsp_parse_uint(value, SIZE_MAX, &n) || n > 0) {
+                return 0;
+            }
+        }
+
+        line = line_end + 2;
+    }
+
+    if (!has_cseq || CharSlice99_is_empty(ka->session)) {
+        return 0;
+    }
+
+    return len;
+}
+
+static void consume_input(Input *in, size_t len) {
+    memmove(in->data, in->data + len, in->len - len);
+    in->len -= len;
+}
+
+// Called with `conn->mutex` held.
+static void watch_writable(SmolRTSP_ServerConnection *conn, bool enable) {
+    if (conn->want_write == enable) {
+        return;
+    }
+
+    struct epoll_event event = {
+        .events = EPOLLIN | (enable ? EPOLLOUT : 0),
+        .data.ptr = conn,
+    };
+    if (epoll_ctl(conn->worker->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event) ==
+        0) {
+        conn->want_write = enable;
+    }
+}
+
+// Called with `conn->mutex` held.
+static void track_buffers(SmolRTSP_ServerConnection *conn) {
+    const bool buffered = conn->in != NULL || conn->out.buffer != NULL;
+    if (buffered == conn->buffered) {
+        return;
+    }
+
+    conn->buffered = buffered;
+    if (buffered) {
+        __atomic_fetch_add(
+            &conn->worker->buffered_connections, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_sub(
+            &conn->worker->buffered_connections, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static Input *new_input(size_t capacity) {
+    Input *in = smolrtsp_malloc(sizeof *in + capacity);
+    if (in != NULL) {
+        reset_input(in);
+    }
+
+    return in;
+}
+
+static void reset_input(Input *in) {
+    in->demuxer = SmolRTSP_Demuxer_new();
+    in->request = SmolRTSP_Request_uninit();
+    in->reads = 0;
+    in->started_ms = 0;
+    in->len = 0;
+}
+
+static void close_connection(SmolRTSP_ServerConnection *conn) {
+    Worker *worker = conn->worker;
+
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        worker->conns = conn->next;
+    }
+    if (conn->next != NULL) {
+        conn->next->prev = conn->prev;
+    }
+
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+
+    // The controller stops whatever still writes to the connection.
+    VCALL_SUPER(conn->controller, SmolRTSP_Droppable, drop);
+
+    close(conn->fd);
+
+    if (conn->buffered) {
+        __atomic_fetch_sub(&worker->buffered_connections, 1, __ATOMIC_RELAXED);
+    }
+    SmolRTSP_NonblockingFdWriter_release(&conn->out);
+    smolrtsp_free(conn->in);
+
+    pthread_mutex_destroy(&conn->mutex);
+    smolrtsp_free(conn);
+}
+
+static int incoming_numa_node(int fd) {
+    int cpu = -1;
+    socklen_t len = sizeof cpu;
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == -1) {
+        return -1;
+    }
+
+    return smolrtsp_cpu_numa_node(cpu);
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,425 @@
+#include <smolrtsp/session_registry.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+
+// The number of independently locked shards; a power of two.
+#define SHARDS_COUNT 64
+#define SHARD_BITS   6
+
+#define MIN_BUCKETS_COUNT 4
+
+struct SmolRTSP_Session {
+    // The next session in the same bucket.
+    SmolRTSP_Session *next;
+    uint64_t hash;
+
+    char id[SMOLRTSP_SESSION_ID_MAX_LEN];
+    size_t id_len;
+
+    uint64_t last_used_ms;
+
+    // One reference is held by the registry while the session is in it.
+    unsigned refs;
+
+    // Guards `streams` and `streams_len`.
+    pthread_mutex_t mutex;
+    SmolRTSP_Droppable streams[SMOLRTSP_SESSION_MAX_STREAMS];
+    size_t streams_len;
+};
+
+typedef struct {
+    pthread_mutex_t mutex;
+
+    // Separate chaining over `buckets_count` buckets, a power of two.
+    SmolRTSP_Session **buckets;
+    size_t buckets_count, len;
+} Shard;
+
+struct SmolRTSP_SessionRegistry {
+    Shard shards[SHARDS_COUNT];
+    uint32_t timeout_ms;
+    size_t len;
+};
+
+static CharSlice99 normalize_id(CharSlice99 id);
+static uint64_t hash_id(CharSlice99 id);
+static Shard *shard_of(SmolRTSP_SessionRegistry *self, uint64_t hash);
+static SmolRTSP_Session **
+find_link(Shard *shard, uint64_t hash, CharSlice99 id);
+static void grow(Shard *shard);
+static uint64_t now_ms(void);
+
+SmolRTSP_SessionRegistry *
+SmolRTSP_SessionRegistry_new(size_t capacity, uint32_t timeout_ms) {
+    SmolRTSP_SessionRegistry *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t buckets_count = MIN_BUCKETS_COUNT;
+    while (buckets_count * SHARDS_COUNT < capacity) {
+        buckets_count *= 2;
+    }
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++) {
+        Shard *shard = &self->shards[i];
+
+        shard->buckets =
+            smolrtsp_calloc(buckets_count, sizeof shard->buckets[0]);
+        if (NULL == shard->buckets) {
+            while (i-- > 0) {
+                smolrtsp_free(self->shards[i].buckets);
+                pthread_mutex_destroy(&self->shards[i].mutex);
+            }
+            smolrtsp_free(self);
+            errno = ENOMEM;
+            return NULL;
+        }
+        pthread_mutex_init(&shard->mutex, NULL);
+        shard->buckets_count = buckets_count;
+        shard->len = 0;
+    }
+
+    self->timeout_ms = timeout_ms;
+    self->len = 0;
+
+    return self;
+}
+
+SmolRTSP_Session *SmolRTSP_SessionRegistry_create(
+    SmolRTSP_SessionRegistry *self, CharSlice99 id) {
+    assert(self);
+
+    if (0 == id.len || id.len > SMOLRTSP_SESSION_ID_MAX_LEN) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Reserve a place for the session, so that concurrent creations do not
+    // exceed the limit.
+    const size_t len = __atomic_add_fetch(&self->len, 1, __ATOMIC_RELAXED);
+    if (SMOLRTSP_MAX_SESSIONS > 0 && len > SMOLRTSP_MAX_SESSIONS) {
+        __atomic_sub_fetch(&self->len, 1, __ATOMIC_RELAXED);
+        errno = ENOSPC;
+        return NULL;
+    }
+
+    const uint64_t hash = hash_id(id);
+    Shard *shard = shard_of(self, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    int error = 0;
+    SmolRTSP_Session *session = NULL;
+    if (*find_link(shard, hash, id) != NULL) {
+        error = EEXIST;
+    } else if (NULL == (session = smolrtsp_malloc(sizeof *session))) {
+        error = ENOMEM;
+    }
+
+    if (error != 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        __atomic_sub_fetch(&self->len, 1, __ATOMIC_RELAXED);
+        errno = error;
+        return NULL;
+    }
+
+    session->hash = hash;
+    memcpy(session->id, id.ptr, id.len);
+    session->id_len = id.len;
+    session->last_used_ms = now_ms();
+    session->refs = 2;
+    pthread_mutex_init(&session->mutex, NULL);
+    session->streams_len = 0;
+
+    if (shard->len >= shard->buckets_count) {
+        grow(shard);
+    }
+
+    SmolRTSP_Session **bucket =
+        &shard->buckets[hash & (shard->buckets_count - 1)];
+    session->next = *bucket;
+    *bucket = session;
+    shard->len++;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return session;
+}
+
+SmolRTSP_Session *
+SmolRTSP_SessionRegistry_find(SmolRTSP_SessionRegistry *self, CharSlice99 id) {
+    assert(self);
+
+    id = normalize_id(id);
+    const uint64_t hash = hash_id(id);
+    Shard *shard = shard_of(self, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    SmolRTSP_Session *session = *find_link(shard, hash, id);
+    if (session != NULL) {
+        __atomic_add_fetch(&session->refs, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&session->last_used_ms, now_ms(), __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return session;
+}
+
+bool SmolRTSP_SessionRegistry_remove(
+    SmolRTSP_SessionRegistry *self, CharSlice99 id) {
+    assert(self);
+
+    id = normalize_id(id);
+    const uint64_t hash = hash_id(id);
+    Shard *shard = shard_of(self, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    SmolRTSP_Session **link = find_link(shard, hash, id);
+    SmolRTSP_Session *session = *link;
+    if (session != NULL) {
+        *link = session->next;
+        shard->len--;
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (NULL == session) {
+        return false;
+    }
+
+    __atomic_sub_fetch(&self->len, 1, __ATOMIC_RELAXED);
+
+    // The streams are dropped outside of the shard lock.
+    SmolRTSP_Session_release(session);
+    return true;
+}
+
+size_t SmolRTSP_SessionRegistry_expire(SmolRTSP_SessionRegistry *self) {
+    assert(self);
+
+    const uint64_t now = now_ms();
+    size_t expired_count = 0;
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++) {
+        Shard *shard = &self->shards[i];
+        SmolRTSP_Session *expired = NULL;
+
+        pthread_mutex_lock(&shard->mutex);
+
+        for (size_t j = 0; j < shard->buckets_count; j++) {
+            SmolRTSP_Session **link = &shard->buckets[j];
+
+            while (*link != NULL) {
+                SmolRTSP_Session *session = *link;
+                const uint64_t last_used = __atomic_load_n(
+                    &session->last_used_ms, __ATOMIC_RELAXED);
+
+                // A lookup can have touched the session after `now`.
+                if (last_used < now && now - last_used > self->timeout_ms) {
+                    *link = session->next;
+                    session->next = expired;
+                    expired = session;
+                    shard->len--;
+                } else {
+                    link = &session->next;
+                }
+            }
+        }
+
+        pthread_mutex_unlock(&shard->mutex);
+
+        while (expired != NULL) {
+            SmolRTSP_Session *next = expired->next;
+            __atomic_sub_fetch(&self->len, 1, __ATOMIC_RELAXED);
+            SmolRTSP_Session_release(expired);
+            expired = next;
+            expired_count++;
+        }
+    }
+
+    return expired_count;
+}
+
+size_t SmolRTSP_SessionRegistry_len(const SmolRTSP_SessionRegistry *self) {
+    assert(self);
+    return __atomic_load_n(&self->len, __ATOMIC_RELAXED);
+}
+
+static void SmolRTSP_SessionRegistry_drop(VSelf) {
+    VSELF(SmolRTSP_SessionRegistry);
+    assert(self);
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++) {
+        Shard *shard = &self->shards[i];
+
+        for (size_t j = 0; j < shard->buckets_count; j++) {
+            SmolRTSP_Session *session = shard->buckets[j];
+            while (session != NULL) {
+                SmolRTSP_Session *next = session->next;
+                SmolRTSP_Session_release(session);
+                session = next;
+            }
+        }
+
+        smolrtsp_free(shard->buckets);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_SessionRegistry);
+
+CharSlice99 SmolRTSP_Session_id(const SmolRTSP_Session *self) {
+    assert(self);
+    return CharSlice99_new((char *)self->id, self->id_len);
+}
+
+int SmolRTSP_Session_add_stream(
+    SmolRTSP_Session *self, SmolRTSP_Droppable stream) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+
+    if (SMOLRTSP_SESSION_MAX_STREAMS == self->streams_len) {
+        pthread_mutex_unlock(&self->mutex);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    self->streams[self->streams_len++] = stream;
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return 0;
+}
+
+size_t SmolRTSP_Session_streams(
+    SmolRTSP_Session *self, SmolRTSP_Droppable *streams, size_t max) {
+    assert(self);
+    assert(streams || 0 == max);
+
+    pthread_mutex_lock(&self->mutex);
+
+    const size_t n = self->streams_len < max ? self->streams_len : max;
+    memcpy(streams, self->streams, n * sizeof streams[0]);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return n;
+}
+
+void SmolRTSP_Session_release(SmolRTSP_Session *self) {
+    assert(self);
+
+    if (__atomic_sub_fetch(&self->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < self->streams_len; i++) {
+        VCALL(self->streams[i], drop);
+    }
+
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+// Strips the parameters (`;timeout=...`) and the whitespace of a `Session`
+// header value.
+static CharSlice99 normalize_id(CharSlice99 id) {
+    size_t end = 0;
+    while (end < id.len && id.ptr[end] != ';') {
+        end++;
+    }
+    id = CharSlice99_sub(id, 0, end);
+
+    while (id.len > 0 && (' ' == id.ptr[0] || '\t' == id.ptr[0])) {
+        id = CharSlice99_advance(id, 1);
+    }
+    while (id.len > 0 &&
+           (' ' == id.ptr[id.len - 1] || '\t' == id.ptr[id.len - 1])) {
+        id.len--;
+    }
+
+    return id;
+}
+
+// FNV-1a. The shard is chosen by the high bits and the bucket by the low
+// ones, so that the two are independent.
+static uint64_t hash_id(CharSlice99 id) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (size_t i = 0; i < id.len; i++) {
+        hash ^= (uint8_t)id.ptr[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+
+    return hash;
+}
+
+static Shard *shard_of(SmolRTSP_SessionRegistry *self, uint64_t hash) {
+    return &self->shards[hash >> (64 - SHARD_BITS)];
+}
+
+// Returns the link pointing to the session `id`, or to `NULL` at the end of
+// its bucket.
+static SmolRTSP_Session **
+find_link(Shard *shard, uint64_t hash, CharSlice99 id) {
+    SmolRTSP_Session **link =
+        &shard->buckets[hash & (shard->buckets_count - 1)];
+
+    while (*link != NULL) {
+        const SmolRTSP_Session *session = *link;
+        if (session->hash == hash && session->id_len == id.len &&
+            memcmp(session->id, id.ptr, id.len) == 0) {
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+// Keeps the buckets if the allocation fails, at the cost of longer chains.
+static void grow(Shard *shard) {
+    const size_t buckets_count = shard->buckets_count * 2;
+    SmolRTSP_Session **buckets =
+        smolrtsp_calloc(buckets_count, sizeof buckets[0]);
+    if (NULL == buckets) {
+        return;
+    }
+
+    for (size_t i = 0; i < shard->buckets_count; i++) {
+        SmolRTSP_Session *session = shard->buckets[i];
+        while (session != NULL) {
+            SmolRTSP_Session *next = session->next;
+            SmolRTSP_Session **bucket =
+                &buckets[session->hash & (buckets_count - 1)];
+            session->next = *bucket;
+            *bucket = session;
+            session = next;
+        }
+    }
+
+    smolrtsp_free(shard->buckets);
+    shard->buckets = buckets;
+    shard->buckets_count = buckets_count;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
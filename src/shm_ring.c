@@ -0,0 +1,449 @@
+#include <smolrtsp/shm_ring.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "SRNG" in the native byte order; both processes run on the same machine.
+#define MAGIC   0x474e5253
+#define VERSION 1
+
+// Every record begins at a multiple of this.
+#define RECORD_ALIGN 8
+#define ALIGN(n)     (((n) + RECORD_ALIGN - 1) & ~(uint64_t)(RECORD_ALIGN - 1))
+
+// `Record.nalus_count` of a record filling the rest of the ring.
+#define PADDING UINT32_MAX
+
+// The values of `Record.ts_kind`.
+#define TS_RAW          0
+#define TS_SYS_CLOCK_US 1
+
+// The beginning of the `memfd`, followed by `capacity` bytes of records. The
+// positions only grow, and each of them is on its own cache line.
+typedef struct {
+    uint32_t magic, version, codec, reserved;
+    uint64_t capacity;
+    char pad0[64 - 24];
+
+    // The end of the records pushed, written by the producer.
+    uint64_t head;
+    char pad1[64 - 8];
+
+    // The end of the records released, written by the consumer.
+    uint64_t tail;
+    char pad2[64 - 8];
+} Header;
+
+// An access unit, followed by `uint32_t nalu_sizes[nalus_count]` and the NAL
+// units, each with its header. The rest of the ring is skipped if it is shorter
+// than a record.
+typedef struct {
+    uint32_t size, nalus_count;
+    uint64_t ts;
+    uint32_t ts_kind, reserved;
+} Record;
+
+struct SmolRTSP_ShmRing {
+    int memfd, eventfd;
+    Header *header;
+    char *records;
+    size_t map_len;
+
+    // Copied from the header once, so that the other process cannot change
+    // them under our feet.
+    uint64_t capacity;
+    SmolRTSP_NalCodec codec;
+
+    // The position of the producer, or that of the consumer.
+    uint64_t head, tail;
+
+    // The access unit peeked and the position after it.
+    bool is_peeked;
+    uint64_t peeked_end;
+    SmolRTSP_ShmAccessUnit au;
+    SmolRTSP_NalUnit nalus[SMOLRTSP_SHM_RING_MAX_NALUS];
+};
+
+static SmolRTSP_ShmRing *map_ring(int memfd, int eventfd, size_t map_len);
+static bool parse_record(
+    SmolRTSP_ShmRing *self, const char *record, Record header,
+    SmolRTSP_ShmAccessUnit *restrict au);
+
+SmolRTSP_ShmRing *
+SmolRTSP_ShmRing_new(size_t capacity, SmolRTSP_NalCodec codec) {
+    assert(capacity > 0);
+
+    if (capacity > SIZE_MAX - sizeof(Header) - RECORD_ALIGN) {
+        errno = EINVAL;
+        return NULL;
+    }
+    capacity = ALIGN(capacity);
+
+    const int memfd =
+        memfd_create("smolrtsp-shm-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (-1 == memfd) {
+        return NULL;
+    }
+
+    const int eventfd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (-1 == eventfd_) {
+        const int error = errno;
+        close(memfd);
+        errno = error;
+        return NULL;
+    }
+
+    // The seals keep the consumer from a `SIGBUS` of a truncated mapping.
+    const size_t map_len = sizeof(Header) + capacity;
+    SmolRTSP_ShmRing *self = NULL;
+    if (ftruncate(memfd, (off_t)map_len) == -1 ||
+        fcntl(
+            memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) ==
+            -1 ||
+        NULL == (self = map_ring(memfd, eventfd_, map_len))) {
+        const int error = errno;
+        close(memfd);
+        close(eventfd_);
+        errno = error;
+        return NULL;
+    }
+
+    // The new `memfd` is zeroed, so both positions are 0 already.
+    Header *header = self->header;
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->codec = codec;
+    header->capacity = capacity;
+
+    self->capacity = capacity;
+    self->codec = codec;
+
+    return self;
+}
+
+SmolRTSP_ShmRing *SmolRTSP_ShmRing_open(int memfd, int eventfd) {
+    const int seals = fcntl(memfd, F_GET_SEALS);
+    if (-1 == seals) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(memfd, &st) == -1) {
+        return NULL;
+    }
+
+    if (!(seals & F_SEAL_SHRINK) || st.st_size < (off_t)sizeof(Header)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    SmolRTSP_ShmRing *self = map_ring(memfd, eventfd, (size_t)st.st_size);
+    if (NULL == self) {
+        return NULL;
+    }
+
+    const Header *header = self->header;
+    const uint64_t capacity = header->capacity;
+    const uint32_t codec = header->codec;
+
+    if (header->magic != MAGIC || header->version != VERSION ||
+        (codec != SmolRTSP_NalCodec_H264 && codec != SmolRTSP_NalCodec_H265) ||
+        0 == capacity || capacity % RECORD_ALIGN != 0 ||
+        capacity > self->map_len - sizeof(Header)) {
+        munmap(self->header, self->map_len);
+        smolrtsp_free(self);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self->capacity = capacity;
+    self->codec = (SmolRTSP_NalCodec)codec;
+    self->head = __atomic_load_n(&self->header->head, __ATOMIC_ACQUIRE);
+    self->tail = __atomic_load_n(&self->header->tail, __ATOMIC_ACQUIRE);
+
+    return self;
+}
+
+int SmolRTSP_ShmRing_memfd(const SmolRTSP_ShmRing *self) {
+    assert(self);
+    return self->memfd;
+}
+
+int SmolRTSP_ShmRing_eventfd(const SmolRTSP_ShmRing *self) {
+    assert(self);
+    return self->eventfd;
+}
+
+SmolRTSP_NalCodec SmolRTSP_ShmRing_codec(const SmolRTSP_ShmRing *self) {
+    assert(self);
+    return self->codec;
+}
+
+int SmolRTSP_ShmRing_push(
+    SmolRTSP_ShmRing *self, SmolRTSP_RtpTimestamp ts,
+    const SmolRTSP_NalUnit *nalus, size_t nalus_count) {
+    assert(self);
+    assert(nalus || 0 == nalus_count);
+
+    if (nalus_count > SMOLRTSP_SHM_RING_MAX_NALUS) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    uint64_t len = sizeof(Record) + nalus_count * sizeof(uint32_t);
+    for (size_t i = 0; i < nalus_count; i++) {
+        len += SmolRTSP_NalHeader_size(nalus[i].header) + nalus[i].payload.len;
+    }
+
+    const uint64_t size = ALIGN(len), capacity = self->capacity;
+    if (size > capacity || size > UINT32_MAX) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    // The consumer releases its records before we get to overwrite them.
+    const uint64_t tail =
+        __atomic_load_n(&self->header->tail, __ATOMIC_ACQUIRE);
+    uint64_t head = self->head;
+
+    const uint64_t to_end = capacity - head % capacity;
+    const uint64_t skip = size > to_end ? to_end : 0;
+    if (head + skip + size - tail > capacity) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    if (skip >= sizeof(Record)) {
+        const Record padding = {
+            .size = (uint32_t)skip,
+            .nalus_count = PADDING,
+        };
+        memcpy(self->records + head % capacity, &padding, sizeof padding);
+    }
+    head += skip;
+
+    Record record = {
+        .size = (uint32_t)size,
+        .nalus_count = (uint32_t)nalus_count,
+    };
+    match(ts) {
+        of(SmolRTSP_RtpTimestamp_Raw, raw_ts) {
+            record.ts = *raw_ts;
+            record.ts_kind = TS_RAW;
+        }
+        of(SmolRTSP_RtpTimestamp_SysClockUs, time_us) {
+            record.ts = *time_us;
+            record.ts_kind = TS_SYS_CLOCK_US;
+        }
+    }
+
+    char *p = self->records + head % capacity;
+    memcpy(p, &record, sizeof record);
+
+    char *data = p + sizeof record + nalus_count * sizeof(uint32_t);
+    for (size_t i = 0; i < nalus_count; i++) {
+        const size_t header_size = SmolRTSP_NalHeader_size(nalus[i].header);
+        const uint32_t nalu_size =
+            (uint32_t)(header_size + nalus[i].payload.len);
+        memcpy(
+            p + sizeof record + i * sizeof nalu_size, &nalu_size,
+            sizeof nalu_size);
+
+        SmolRTSP_NalHeader_serialize(nalus[i].header, (uint8_t *)data);
+        if (nalus[i].payload.len > 0) {
+            memcpy(
+                data + header_size, nalus[i].payload.ptr,
+                nalus[i].payload.len);
+        }
+        data += nalu_size;
+    }
+
+    self->head = head + size;
+    __atomic_store_n(&self->header->head, self->head, __ATOMIC_RELEASE);
+
+    // The consumer finds out anyway on its next peek, so a failed signal is
+    // not an error.
+    const uint64_t one = 1;
+    const ssize_t ret = write(self->eventfd, &one, sizeof one);
+    (void)ret;
+
+    return 0;
+}
+
+int SmolRTSP_ShmRing_peek(
+    SmolRTSP_ShmRing *self, SmolRTSP_ShmAccessUnit *restrict au) {
+    assert(self);
+    assert(au);
+
+    if (self->is_peeked) {
+        *au = self->au;
+        return 0;
+    }
+
+    const uint64_t capacity = self->capacity;
+    const uint64_t head =
+        __atomic_load_n(&self->header->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = self->tail;
+
+    for (;;) {
+        if (head == tail) {
+            self->tail = tail;
+            errno = EAGAIN;
+            return -1;
+        }
+
+        // Also catches a head behind the tail, which wraps around.
+        const uint64_t available = head - tail;
+        const uint64_t offset = tail % capacity, to_end = capacity - offset;
+        if (available > capacity) {
+            goto malformed;
+        }
+
+        if (to_end < sizeof(Record)) {
+            if (to_end > available) {
+                goto malformed;
+            }
+            tail += to_end;
+            continue;
+        }
+
+        const char *p = self->records + offset;
+        Record record;
+        memcpy(&record, p, sizeof record);
+
+        if (record.size < sizeof record || record.size % RECORD_ALIGN != 0 ||
+            record.size > to_end || record.size > available) {
+            goto malformed;
+        }
+
+        if (PADDING == record.nalus_count) {
+            tail += record.size;
+            continue;
+        }
+
+        if (!parse_record(self, p, record, au)) {
+            goto malformed;
+        }
+
+        self->tail = tail;
+        self->is_peeked = true;
+        self->peeked_end = tail + record.size;
+        self->au = *au;
+        return 0;
+    }
+
+malformed:
+    errno = EBADMSG;
+    return -1;
+}
+
+void SmolRTSP_ShmRing_release(SmolRTSP_ShmRing *self) {
+    assert(self);
+
+    if (!self->is_peeked) {
+        return;
+    }
+
+    self->is_peeked = false;
+    self->tail = self->peeked_end;
+
+    // Our reads of the access unit happen before the producer reuses it.
+    __atomic_store_n(&self->header->tail, self->tail, __ATOMIC_RELEASE);
+}
+
+static void SmolRTSP_ShmRing_drop(VSelf) {
+    VSELF(SmolRTSP_ShmRing);
+    assert(self);
+
+    munmap(self->header, self->map_len);
+    close(self->memfd);
+    close(self->eventfd);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_ShmRing);
+
+static SmolRTSP_ShmRing *map_ring(int memfd, int eventfd, size_t map_len) {
+    void *map =
+        mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (MAP_FAILED == map) {
+        return NULL;
+    }
+
+    SmolRTSP_ShmRing *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        munmap(map, map_len);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->memfd = memfd;
+    self->eventfd = eventfd;
+    self->header = map;
+    self->records = (char *)map + sizeof(Header);
+    self->map_len = map_len;
+    self->head = self->tail = 0;
+    self->is_peeked = false;
+    self->peeked_end = 0;
+
+    return self;
+}
+
+// Checks the access unit `header` at `record` against its size and splits it
+// into `self->nalus`.
+static bool parse_record(
+    SmolRTSP_ShmRing *self, const char *record, Record header,
+    SmolRTSP_ShmAccessUnit *restrict au) {
+    if (header.nalus_count > SMOLRTSP_SHM_RING_MAX_NALUS) {
+        return false;
+    }
+
+    const size_t sizes_len = header.nalus_count * sizeof(uint32_t);
+    if (sizeof header + sizes_len > header.size) {
+        return false;
+    }
+
+    switch (header.ts_kind) {
+    case TS_RAW:
+        au->ts = SmolRTSP_RtpTimestamp_Raw((uint32_t)header.ts);
+        break;
+    case TS_SYS_CLOCK_US:
+        au->ts = SmolRTSP_RtpTimestamp_SysClockUs(header.ts);
+        break;
+    default:
+        return false;
+    }
+
+    const size_t header_size = SmolRTSP_NalCodec_header_size(self->codec);
+    const char *data = record + sizeof header + sizes_len,
+               *end = record + header.size;
+
+    for (size_t i = 0; i < header.nalus_count; i++) {
+        uint32_t nalu_size;
+        memcpy(
+            &nalu_size, record + sizeof header + i * sizeof nalu_size,
+            sizeof nalu_size);
+        if (nalu_size < header_size || nalu_size > (size_t)(end - data)) {
+            return false;
+        }
+
+        self->nalus[i] = SmolRTSP_NalUnit_parse(
+            self->codec, U8Slice99_new((uint8_t *)data, nalu_size));
+        data += nalu_size;
+    }
+
+    au->nalus = self->nalus;
+    au->nalus_count = header.nalus_count;
+
+    return true;
+}
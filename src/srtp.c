@@ -0,0 +1,721 @@
+#include <smolrtsp/srtp.h>
+
+#include <smolrtsp/types/sdp.h>
+
+#include "alloc.h"
+#include "crypto.h"
+#include "macros.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <sys/random.h>
+
+#define RTP_HEADER_SIZE  12
+#define RTP_VERSION      2
+#define RTCP_HEADER_SIZE 8
+
+// The SRTCP index with the E flag, which follows the RTCP packet.
+#define SRTCP_INDEX_SIZE 4
+#define SRTCP_E_FLAG     UINT32_C(0x80000000)
+#define SRTCP_INDEX_MASK UINT32_C(0x7FFFFFFF)
+
+#define TAG_SIZE_80 10
+#define TAG_SIZE_32 4
+
+// The session key labels of the key derivation.
+#define LABEL_RTP_ENCRYPTION  0x00
+#define LABEL_RTP_AUTH        0x01
+#define LABEL_RTP_SALT        0x02
+#define LABEL_RTCP_ENCRYPTION 0x03
+#define LABEL_RTCP_AUTH       0x04
+#define LABEL_RTCP_SALT       0x05
+
+#define SESSION_AUTH_KEY_SIZE 20
+
+// The number of SSRCs whose rollover counters are tracked.
+#define MAX_STREAMS 4
+
+// The base64 length of the master key and salt.
+#define KEY_SALT_SIZE                                                          \
+    (SMOLRTSP_SRTP_MASTER_KEY_SIZE + SMOLRTSP_SRTP_MASTER_SALT_SIZE)
+#define KEY_SALT_BASE64_LEN (KEY_SALT_SIZE / 3 * 4)
+
+typedef struct {
+    SmolRTSP_Aes128 cipher;
+    SmolRTSP_HmacSha1 auth;
+    uint8_t salt[SMOLRTSP_SRTP_MASTER_SALT_SIZE];
+} SessionKeys;
+
+// The rollover counter of an SSRC and the highest sequence number sent.
+typedef struct {
+    uint32_t ssrc, roc;
+    uint16_t seq_num;
+} Stream;
+
+struct SmolRTSP_SrtpTransport {
+    SmolRTSP_Transport transport;
+    bool is_rtcp;
+    size_t overhead;
+
+    SessionKeys rtp, rtcp;
+
+    Stream streams[MAX_STREAMS];
+    size_t streams_count, next_stream;
+    uint32_t srtcp_index;
+
+    // The protected packets being transmitted, and the I/O vectors of a batch
+    // pointing to them.
+    uint8_t *buffer;
+    size_t buffer_size;
+    struct iovec *iovecs;
+    SmolRTSP_IoVecSlice *packets;
+    size_t packets_capacity;
+};
+
+static SmolRTSP_SrtpTransport *
+new_transport(SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys, bool is_rtcp);
+static void derive_session_keys(
+    const SmolRTSP_Aes128 *master, const SmolRTSP_SrtpKeys *keys,
+    uint8_t first_label, SessionKeys *session);
+static void derive(
+    const SmolRTSP_Aes128 *master,
+    const uint8_t master_salt[restrict SMOLRTSP_SRTP_MASTER_SALT_SIZE],
+    uint8_t label, uint8_t *out, size_t len);
+static int reserve(
+    SmolRTSP_SrtpTransport *self, size_t buffer_size, size_t packets_count);
+static ssize_t protect(
+    SmolRTSP_SrtpTransport *self, SmolRTSP_IoVecSlice bufs,
+    uint8_t out[restrict]);
+static ssize_t protect_rtp(
+    SmolRTSP_SrtpTransport *self, uint8_t packet[restrict], size_t len);
+static ssize_t protect_rtcp(
+    SmolRTSP_SrtpTransport *self, uint8_t packet[restrict], size_t len);
+static uint32_t rollover_counter(
+    SmolRTSP_SrtpTransport *self, uint32_t ssrc, uint16_t seq_num);
+static void make_iv(
+    const uint8_t salt[restrict SMOLRTSP_SRTP_MASTER_SALT_SIZE], uint32_t ssrc,
+    uint64_t index, uint8_t iv[restrict AES_BLOCK_SIZE]);
+static void authenticate(
+    const SessionKeys *keys, const uint8_t *data, size_t len,
+    const uint8_t suffix[restrict 4], uint8_t mac[restrict SHA1_DIGEST_SIZE]);
+static uint16_t read_u16(const uint8_t *data);
+static uint32_t read_u32(const uint8_t *data);
+static void write_u32(uint8_t *buffer, uint32_t value);
+static void base64_encode(
+    const uint8_t *data, size_t len, char out[restrict]);
+static int base64_decode(CharSlice99 input, uint8_t out[restrict]);
+static CharSlice99 next_word(CharSlice99 *input);
+
+const char *SmolRTSP_SrtpSuite_str(SmolRTSP_SrtpSuite self) {
+    switch (self) {
+    case SmolRTSP_SrtpSuite_AesCm128HmacSha1_80:
+        return "AES_CM_128_HMAC_SHA1_80";
+    case SmolRTSP_SrtpSuite_AesCm128HmacSha1_32:
+        return "AES_CM_128_HMAC_SHA1_32";
+    }
+
+    return "Unknown";
+}
+
+size_t SmolRTSP_SrtpSuite_overhead(SmolRTSP_SrtpSuite self) {
+    return SmolRTSP_SrtpSuite_AesCm128HmacSha1_32 == self ? TAG_SIZE_32
+                                                          : TAG_SIZE_80;
+}
+
+int SmolRTSP_SrtpKeys_generate(
+    SmolRTSP_SrtpKeys *self, SmolRTSP_SrtpSuite suite) {
+    assert(self);
+
+    uint8_t random[KEY_SALT_SIZE];
+    const ssize_t ret = getrandom(random, sizeof random, 0);
+    if (ret != (ssize_t)sizeof random) {
+        if (ret >= 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+
+    self->suite = suite;
+    memcpy(self->master_key, random, SMOLRTSP_SRTP_MASTER_KEY_SIZE);
+    memcpy(
+        self->master_salt, random + SMOLRTSP_SRTP_MASTER_KEY_SIZE,
+        SMOLRTSP_SRTP_MASTER_SALT_SIZE);
+    smolrtsp_crypto_wipe(random, sizeof random);
+
+    return 0;
+}
+
+int SmolRTSP_SrtpKeys_parse_sdp(SmolRTSP_SrtpKeys *self, CharSlice99 value) {
+    assert(self);
+
+    const CharSlice99 tag = next_word(&value), suite = next_word(&value);
+    CharSlice99 key_params = next_word(&value);
+
+    if (CharSlice99_is_empty(tag)) {
+        goto malformed;
+    }
+    for (size_t i = 0; i < tag.len; i++) {
+        if (tag.ptr[i] < '0' || tag.ptr[i] > '9') {
+            goto malformed;
+        }
+    }
+
+    if (CharSlice99_primitive_eq(
+            suite, CharSlice99_from_str("AES_CM_128_HMAC_SHA1_80"))) {
+        self->suite = SmolRTSP_SrtpSuite_AesCm128HmacSha1_80;
+    } else if (CharSlice99_primitive_eq(
+                   suite, CharSlice99_from_str("AES_CM_128_HMAC_SHA1_32"))) {
+        self->suite = SmolRTSP_SrtpSuite_AesCm128HmacSha1_32;
+    } else {
+        goto malformed;
+    }
+
+    const CharSlice99 method = CharSlice99_from_str("inline:");
+    if (!CharSlice99_primitive_starts_with(key_params, method)) {
+        goto malformed;
+    }
+    key_params = CharSlice99_advance(key_params, method.len);
+
+    // `<key and salt>[|<lifetime>][|<MKI>:<length>]`, up to the next key
+    // parameter.
+    size_t end = 0, separators = 0;
+    bool has_mki = false;
+    for (; end < key_params.len && key_params.ptr[end] != ';'; end++) {
+        if ('|' == key_params.ptr[end]) {
+            separators++;
+        } else if (':' == key_params.ptr[end] && separators > 0) {
+            has_mki = true;
+        }
+    }
+    size_t key_len = 0;
+    while (key_len < end && key_params.ptr[key_len] != '|') {
+        key_len++;
+    }
+
+    uint8_t key_salt[KEY_SALT_SIZE];
+    if (has_mki || key_len != KEY_SALT_BASE64_LEN ||
+        base64_decode(CharSlice99_sub(key_params, 0, key_len), key_salt) ==
+            -1) {
+        goto malformed;
+    }
+
+    memcpy(self->master_key, key_salt, SMOLRTSP_SRTP_MASTER_KEY_SIZE);
+    memcpy(
+        self->master_salt, key_salt + SMOLRTSP_SRTP_MASTER_KEY_SIZE,
+        SMOLRTSP_SRTP_MASTER_SALT_SIZE);
+    smolrtsp_crypto_wipe(key_salt, sizeof key_salt);
+
+    return 0;
+
+malformed:
+    errno = EINVAL;
+    return -1;
+}
+
+ssize_t SmolRTSP_SrtpKeys_sdp(
+    SmolRTSP_SrtpKeys self, SmolRTSP_Writer w, uint32_t tag) {
+    assert(w.self && w.vptr);
+
+    uint8_t key_salt[KEY_SALT_SIZE];
+    memcpy(key_salt, self.master_key, SMOLRTSP_SRTP_MASTER_KEY_SIZE);
+    memcpy(
+        key_salt + SMOLRTSP_SRTP_MASTER_KEY_SIZE, self.master_salt,
+        SMOLRTSP_SRTP_MASTER_SALT_SIZE);
+
+    char encoded[KEY_SALT_BASE64_LEN + 1];
+    base64_encode(key_salt, sizeof key_salt, encoded);
+    smolrtsp_crypto_wipe(key_salt, sizeof key_salt);
+
+    ssize_t result = 0;
+
+    CHK_WRITE_ERR(
+        result, smolrtsp_sdp_printf(
+                    w, SMOLRTSP_SDP_ATTR, "crypto:%" PRIu32 " %s inline:%s",
+                    tag, SmolRTSP_SrtpSuite_str(self.suite), encoded));
+
+    smolrtsp_crypto_wipe(encoded, sizeof encoded);
+
+    return result;
+}
+
+SmolRTSP_SrtpTransport *
+SmolRTSP_SrtpTransport_new(SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys) {
+    assert(t.self && t.vptr);
+    return new_transport(t, keys, false);
+}
+
+SmolRTSP_SrtpTransport *
+SmolRTSP_SrtpTransport_new_rtcp(SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys) {
+    assert(t.self && t.vptr);
+    return new_transport(t, keys, true);
+}
+
+static SmolRTSP_SrtpTransport *
+new_transport(SmolRTSP_Transport t, SmolRTSP_SrtpKeys keys, bool is_rtcp) {
+    SmolRTSP_SrtpTransport *self = smolrtsp_calloc(1, sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->transport = t;
+    self->is_rtcp = is_rtcp;
+    self->overhead = is_rtcp ? SMOLRTSP_SRTCP_OVERHEAD
+                             : SmolRTSP_SrtpSuite_overhead(keys.suite);
+
+    SmolRTSP_Aes128 master;
+    SmolRTSP_Aes128_init(&master, keys.master_key);
+    derive_session_keys(&master, &keys, LABEL_RTP_ENCRYPTION, &self->rtp);
+    derive_session_keys(&master, &keys, LABEL_RTCP_ENCRYPTION, &self->rtcp);
+    smolrtsp_crypto_wipe(&master, sizeof master);
+    smolrtsp_crypto_wipe(&keys, sizeof keys);
+
+    return self;
+}
+
+static void SmolRTSP_SrtpTransport_drop(VSelf) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    VCALL_SUPER(self->transport, SmolRTSP_Droppable, drop);
+
+    smolrtsp_free(self->buffer);
+    smolrtsp_free(self->iovecs);
+    smolrtsp_free(self->packets);
+    smolrtsp_crypto_wipe(self, sizeof *self);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_SrtpTransport);
+
+int SmolRTSP_SrtpTransport_unprotect_rtcp(
+    SmolRTSP_SrtpTransport *self, U8Slice99 *packet) {
+    assert(self);
+    assert(packet);
+
+    if (packet->len < RTCP_HEADER_SIZE + SMOLRTSP_SRTCP_OVERHEAD) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    uint8_t *data = packet->ptr;
+    const size_t len = packet->len - SMOLRTSP_SRTCP_OVERHEAD;
+
+    uint8_t mac[SHA1_DIGEST_SIZE];
+    authenticate(&self->rtcp, data, len, data + len, mac);
+    if (!smolrtsp_crypto_eq(mac, data + len + SRTCP_INDEX_SIZE, TAG_SIZE_80)) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    const uint32_t e_index = read_u32(data + len);
+    if (e_index & SRTCP_E_FLAG) {
+        uint8_t iv[AES_BLOCK_SIZE];
+        make_iv(
+            self->rtcp.salt, read_u32(data + 4), e_index & SRTCP_INDEX_MASK,
+            iv);
+        SmolRTSP_Aes128_ctr(
+            &self->rtcp.cipher, iv, data + RTCP_HEADER_SIZE,
+            len - RTCP_HEADER_SIZE);
+    }
+
+    packet->len = len;
+
+    return 0;
+}
+
+static int SmolRTSP_SrtpTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    if (reserve(self, SmolRTSP_IoVecSlice_len(bufs) + self->overhead, 0) ==
+        -1) {
+        return -1;
+    }
+
+    const ssize_t len = protect(self, bufs, self->buffer);
+    if (-1 == len) {
+        return -1;
+    }
+
+    struct iovec packet = {.iov_base = self->buffer, .iov_len = (size_t)len};
+    return VCALL(
+        self->transport, transmit, SmolRTSP_IoVecSlice_new(&packet, 1));
+}
+
+#define SmolRTSP_SrtpTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_SrtpTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    if (0 == batch.len) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < batch.len; i++) {
+        size += SmolRTSP_IoVecSlice_len(batch.ptr[i]) + self->overhead;
+    }
+    if (reserve(self, size, batch.len) == -1) {
+        return -1;
+    }
+
+    // A packet that fails to be protected ends the batch.
+    size_t count = 0, offset = 0;
+    for (; count < batch.len; count++) {
+        const ssize_t len =
+            protect(self, batch.ptr[count], self->buffer + offset);
+        if (-1 == len) {
+            break;
+        }
+
+        self->iovecs[count] = (struct iovec){
+            .iov_base = self->buffer + offset,
+            .iov_len = (size_t)len,
+        };
+        self->packets[count] = SmolRTSP_IoVecSlice_new(&self->iovecs[count], 1);
+        offset += (size_t)len;
+    }
+    if (0 == count) {
+        return -1;
+    }
+
+    const size_t sent = smolrtsp_transmit_batch(
+        self->transport, SmolRTSP_IoVecBatch_new(self->packets, count));
+
+    return 0 == sent ? -1 : (ssize_t)sent;
+}
+
+static bool SmolRTSP_SrtpTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    return VCALL(self->transport, is_full);
+}
+
+#define SmolRTSP_SrtpTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_SrtpTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    const size_t inner = VCALL(self->transport, max_packet_size);
+    if (0 == inner) {
+        return 0;
+    }
+
+    return inner > self->overhead ? inner - self->overhead : 1;
+}
+
+// The authentication tags are counted as transmitted bytes.
+#define SmolRTSP_SrtpTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_SrtpTransport_stats(VSelf) {
+    VSELF(SmolRTSP_SrtpTransport);
+    assert(self);
+
+    return VCALL(self->transport, stats);
+}
+
+implExtern(SmolRTSP_Transport, SmolRTSP_SrtpTransport);
+
+static void derive_session_keys(
+    const SmolRTSP_Aes128 *master, const SmolRTSP_SrtpKeys *keys,
+    uint8_t first_label, SessionKeys *session) {
+    uint8_t key[AES128_KEY_SIZE], auth_key[SESSION_AUTH_KEY_SIZE];
+
+    // The labels of the encryption key, the authentication key, and the salt
+    // are consecutive for both SRTP and SRTCP.
+    derive(master, keys->master_salt, first_label, key, sizeof key);
+    derive(
+        master, keys->master_salt, first_label + 1, auth_key, sizeof auth_key);
+    derive(
+        master, keys->master_salt, first_label + 2, session->salt,
+        sizeof session->salt);
+
+    SmolRTSP_Aes128_init(&session->cipher, key);
+    SmolRTSP_HmacSha1_init(&session->auth, auth_key, sizeof auth_key);
+
+    smolrtsp_crypto_wipe(key, sizeof key);
+    smolrtsp_crypto_wipe(auth_key, sizeof auth_key);
+}
+
+// The AES-CM PRF with a key derivation rate of 0: the keystream of the master
+// key from `(label << 48) XOR master_salt`.
+static void derive(
+    const SmolRTSP_Aes128 *master,
+    const uint8_t master_salt[restrict SMOLRTSP_SRTP_MASTER_SALT_SIZE],
+    uint8_t label, uint8_t *out, size_t len) {
+    uint8_t iv[AES_BLOCK_SIZE] = {0};
+    memcpy(iv, master_salt, SMOLRTSP_SRTP_MASTER_SALT_SIZE);
+    iv[7] ^= label;
+
+    memset(out, 0, len);
+    SmolRTSP_Aes128_ctr(master, iv, out, len);
+}
+
+static int reserve(
+    SmolRTSP_SrtpTransport *self, size_t buffer_size, size_t packets_count) {
+    if (buffer_size > self->buffer_size) {
+        uint8_t *buffer = smolrtsp_realloc(self->buffer, buffer_size);
+        if (NULL == buffer) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->buffer = buffer;
+        self->buffer_size = buffer_size;
+    }
+
+    if (packets_count > self->packets_capacity) {
+        struct iovec *iovecs =
+            smolrtsp_realloc(self->iovecs, packets_count * sizeof iovecs[0]);
+        if (NULL == iovecs) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->iovecs = iovecs;
+
+        SmolRTSP_IoVecSlice *packets = smolrtsp_realloc(
+            self->packets, packets_count * sizeof packets[0]);
+        if (NULL == packets) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->packets = packets;
+        self->packets_capacity = packets_count;
+    }
+
+    return 0;
+}
+
+// Gathers `bufs` into `out` and protects the packet there. `out` must have
+// room for the overhead.
+static ssize_t protect(
+    SmolRTSP_SrtpTransport *self, SmolRTSP_IoVecSlice bufs,
+    uint8_t out[restrict]) {
+    size_t len = 0;
+    for (size_t i = 0; i < bufs.len; i++) {
+        // An empty part, such as a missing header extension, may be null.
+        if (bufs.ptr[i].iov_len > 0) {
+            memcpy(out + len, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+            len += bufs.ptr[i].iov_len;
+        }
+    }
+
+    return self->is_rtcp ? protect_rtcp(self, out, len)
+                         : protect_rtp(self, out, len);
+}
+
+static ssize_t protect_rtp(
+    SmolRTSP_SrtpTransport *self, uint8_t packet[restrict], size_t len) {
+    if (len < RTP_HEADER_SIZE || packet[0] >> 6 != RTP_VERSION) {
+        goto malformed;
+    }
+
+    // The payload starts after the CSRCs and the header extension.
+    size_t header_size = RTP_HEADER_SIZE + 4 * (packet[0] & 0x0F);
+    if (packet[0] & 0x10) {
+        if (len < header_size + 4) {
+            goto malformed;
+        }
+        header_size += 4 + 4 * (size_t)read_u16(packet + header_size + 2);
+    }
+    if (len < header_size) {
+        goto malformed;
+    }
+
+    const uint16_t seq_num = read_u16(packet + 2);
+    const uint32_t ssrc = read_u32(packet + 8),
+                   roc = rollover_counter(self, ssrc, seq_num);
+
+    uint8_t iv[AES_BLOCK_SIZE];
+    make_iv(self->rtp.salt, ssrc, (uint64_t)roc << 16 | seq_num, iv);
+    SmolRTSP_Aes128_ctr(
+        &self->rtp.cipher, iv, packet + header_size, len - header_size);
+
+    uint8_t roc_bytes[4], mac[SHA1_DIGEST_SIZE];
+    write_u32(roc_bytes, roc);
+    authenticate(&self->rtp, packet, len, roc_bytes, mac);
+    memcpy(packet + len, mac, self->overhead);
+
+    return (ssize_t)(len + self->overhead);
+
+malformed:
+    errno = EINVAL;
+    return -1;
+}
+
+static ssize_t protect_rtcp(
+    SmolRTSP_SrtpTransport *self, uint8_t packet[restrict], size_t len) {
+    if (len < RTCP_HEADER_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const uint32_t index = self->srtcp_index;
+    self->srtcp_index = (index + 1) & SRTCP_INDEX_MASK;
+
+    uint8_t iv[AES_BLOCK_SIZE];
+    make_iv(self->rtcp.salt, read_u32(packet + 4), index, iv);
+    SmolRTSP_Aes128_ctr(
+        &self->rtcp.cipher, iv, packet + RTCP_HEADER_SIZE,
+        len - RTCP_HEADER_SIZE);
+
+    // The SRTCP index is authenticated as part of the packet.
+    write_u32(packet + len, SRTCP_E_FLAG | index);
+
+    uint8_t mac[SHA1_DIGEST_SIZE];
+    authenticate(&self->rtcp, packet, len, packet + len, mac);
+    memcpy(packet + len + SRTCP_INDEX_SIZE, mac, TAG_SIZE_80);
+
+    return (ssize_t)(len + SMOLRTSP_SRTCP_OVERHEAD);
+}
+
+// Estimates the rollover counter of `seq_num` as in RFC 3711, section 3.3.1,
+// and advances that of `ssrc` if `seq_num` is the highest one sent.
+static uint32_t rollover_counter(
+    SmolRTSP_SrtpTransport *self, uint32_t ssrc, uint16_t seq_num) {
+    Stream *stream = NULL;
+    for (size_t i = 0; i < self->streams_count; i++) {
+        if (self->streams[i].ssrc == ssrc) {
+            stream = &self->streams[i];
+            break;
+        }
+    }
+
+    if (NULL == stream) {
+        // The stream tracked longest is forgotten.
+        if (self->streams_count < MAX_STREAMS) {
+            stream = &self->streams[self->streams_count++];
+        } else {
+            stream = &self->streams[self->next_stream];
+            self->next_stream = (self->next_stream + 1) % MAX_STREAMS;
+        }
+
+        *stream = (Stream){.ssrc = ssrc, .roc = 0, .seq_num = seq_num};
+        return 0;
+    }
+
+    uint32_t roc = stream->roc;
+    if (stream->seq_num < 0x8000) {
+        if (seq_num - stream->seq_num > 0x8000) {
+            roc--;
+        }
+    } else if (stream->seq_num - 0x8000 > seq_num) {
+        roc++;
+    }
+
+    if (roc == stream->roc + 1 ||
+        (roc == stream->roc && seq_num > stream->seq_num)) {
+        stream->roc = roc;
+        stream->seq_num = seq_num;
+    }
+
+    return roc;
+}
+
+// `(salt << 16) XOR (SSRC << 64) XOR (index << 16)`.
+static void make_iv(
+    const uint8_t salt[restrict SMOLRTSP_SRTP_MASTER_SALT_SIZE], uint32_t ssrc,
+    uint64_t index, uint8_t iv[restrict AES_BLOCK_SIZE]) {
+    memcpy(iv, salt, SMOLRTSP_SRTP_MASTER_SALT_SIZE);
+    iv[AES_BLOCK_SIZE - 2] = 0;
+    iv[AES_BLOCK_SIZE - 1] = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        iv[4 + i] ^= (uint8_t)(ssrc >> (24 - 8 * i));
+    }
+    for (size_t i = 0; i < 6; i++) {
+        iv[8 + i] ^= (uint8_t)(index >> (40 - 8 * i));
+    }
+}
+
+static void authenticate(
+    const SessionKeys *keys, const uint8_t *data, size_t len,
+    const uint8_t suffix[restrict 4], uint8_t mac[restrict SHA1_DIGEST_SIZE]) {
+    SmolRTSP_Sha1 ctx;
+    SmolRTSP_HmacSha1_start(&keys->auth, &ctx);
+    SmolRTSP_Sha1_update(&ctx, data, len);
+    SmolRTSP_Sha1_update(&ctx, suffix, 4);
+    SmolRTSP_HmacSha1_finish(&keys->auth, &ctx, mac);
+}
+
+static uint16_t read_u16(const uint8_t *data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+static uint32_t read_u32(const uint8_t *data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+           (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+static void write_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+}
+
+static const char base64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Encodes `len` bytes, a multiple of 3, and null-terminates `out`.
+static void
+base64_encode(const uint8_t *data, size_t len, char out[restrict]) {
+    assert(0 == len % 3);
+
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t n = (uint32_t)data[i] << 16 |
+                           (uint32_t)data[i + 1] << 8 | data[i + 2];
+        for (size_t j = 0; j < 4; j++) {
+            *out++ = base64_alphabet[n >> (18 - 6 * j) & 0x3F];
+        }
+    }
+
+    *out = '\0';
+}
+
+// Decodes `input`, whose length is a multiple of 4, without padding.
+static int base64_decode(CharSlice99 input, uint8_t out[restrict]) {
+    assert(0 == input.len % 4);
+
+    for (size_t i = 0; i < input.len; i += 4) {
+        uint32_t n = 0;
+        for (size_t j = 0; j < 4; j++) {
+            const char *pos = input.ptr[i + j] != '\0'
+                                  ? strchr(base64_alphabet, input.ptr[i + j])
+                                  : NULL;
+            if (NULL == pos) {
+                return -1;
+            }
+            n = n << 6 | (uint32_t)(pos - base64_alphabet);
+        }
+
+        *out++ = (uint8_t)(n >> 16);
+        *out++ = (uint8_t)(n >> 8);
+        *out++ = (uint8_t)n;
+    }
+
+    return 0;
+}
+
+static CharSlice99 next_word(CharSlice99 *input) {
+    size_t start = 0;
+    while (start < input->len &&
+           (' ' == input->ptr[start] || '\t' == input->ptr[start])) {
+        start++;
+    }
+
+    size_t end = start;
+    while (end < input->len && input->ptr[end] != ' ' &&
+           input->ptr[end] != '\t') {
+        end++;
+    }
+
+    const CharSlice99 word = CharSlice99_sub(*input, start, end);
+    *input = CharSlice99_advance(*input, end);
+
+    return word;
+}
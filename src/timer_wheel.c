@@ -0,0 +1,267 @@
+#include <smolrtsp/timer_wheel.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#define LEVEL_BITS   6
+#define LEVEL_SLOTS  (1 << LEVEL_BITS)
+#define LEVEL_MASK   (LEVEL_SLOTS - 1)
+#define LEVELS_COUNT 4
+
+// The farthest expiry that the levels can hold, relative to the current tick.
+#define MAX_DELTA ((UINT64_C(1) << (LEVEL_BITS * LEVELS_COUNT)) - 1)
+
+struct SmolRTSP_TimerWheel {
+    uint64_t current;
+    size_t len;
+
+    // Every slot is a circular list with a sentinel head.
+    SmolRTSP_Timer slots[LEVELS_COUNT][LEVEL_SLOTS];
+    size_t levels_len[LEVELS_COUNT];
+};
+
+static void insert(SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer);
+static void unlink_timer(SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer);
+static void cascade(SmolRTSP_TimerWheel *self, int level, size_t slot);
+static void skip_empty_ticks(SmolRTSP_TimerWheel *self, uint64_t now);
+static size_t fire_slot(SmolRTSP_TimerWheel *self, size_t slot);
+static int level_of(uint64_t delta);
+
+SmolRTSP_Timer SmolRTSP_Timer_new(SmolRTSP_TimerHandler handler) {
+    return (SmolRTSP_Timer){
+        .handler = handler,
+        .expires = 0,
+        .level = 0,
+        .prev = NULL,
+        .next = NULL,
+    };
+}
+
+bool SmolRTSP_Timer_is_pending(const SmolRTSP_Timer *self) {
+    assert(self);
+    return self->next != NULL;
+}
+
+SmolRTSP_TimerWheel *SmolRTSP_TimerWheel_new(uint64_t now) {
+    SmolRTSP_TimerWheel *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->current = now;
+    self->len = 0;
+
+    for (size_t level = 0; level < LEVELS_COUNT; level++) {
+        for (size_t slot = 0; slot < LEVEL_SLOTS; slot++) {
+            SmolRTSP_Timer *head = &self->slots[level][slot];
+            head->prev = head->next = head;
+        }
+        self->levels_len[level] = 0;
+    }
+
+    return self;
+}
+
+void SmolRTSP_TimerWheel_schedule(
+    SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer, uint64_t delay) {
+    assert(self);
+    assert(timer);
+
+    SmolRTSP_TimerWheel_cancel(self, timer);
+
+    timer->expires = self->current + (delay > 0 ? delay : 1);
+    insert(self, timer);
+    self->len++;
+}
+
+void SmolRTSP_TimerWheel_cancel(
+    SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer) {
+    assert(self);
+    assert(timer);
+
+    if (!SmolRTSP_Timer_is_pending(timer)) {
+        return;
+    }
+
+    unlink_timer(self, timer);
+    self->len--;
+}
+
+size_t SmolRTSP_TimerWheel_advance(SmolRTSP_TimerWheel *self, uint64_t now) {
+    assert(self);
+
+    size_t fired = 0;
+
+    while (self->current < now) {
+        if (0 == self->len) {
+            self->current = now;
+            break;
+        }
+
+        skip_empty_ticks(self, now);
+
+        const uint64_t t = ++self->current;
+
+        // Higher levels first, so that their timers can cascade further
+        // down at the same tick.
+        int top = 0;
+        while (top + 1 < LEVELS_COUNT &&
+               0 == (t & ((UINT64_C(1) << (LEVEL_BITS * (top + 1))) - 1))) {
+            top++;
+        }
+        for (int level = top; level > 0; level--) {
+            cascade(
+                self, level, (size_t)(t >> (LEVEL_BITS * level)) & LEVEL_MASK);
+        }
+
+        fired += fire_slot(self, (size_t)t & LEVEL_MASK);
+    }
+
+    return fired;
+}
+
+uint64_t SmolRTSP_TimerWheel_now(const SmolRTSP_TimerWheel *self) {
+    assert(self);
+    return self->current;
+}
+
+size_t SmolRTSP_TimerWheel_len(const SmolRTSP_TimerWheel *self) {
+    assert(self);
+    return self->len;
+}
+
+static void SmolRTSP_TimerWheel_drop(VSelf) {
+    VSELF(SmolRTSP_TimerWheel);
+    assert(self);
+
+    for (size_t level = 0; level < LEVELS_COUNT; level++) {
+        for (size_t slot = 0; slot < LEVEL_SLOTS; slot++) {
+            SmolRTSP_Timer *head = &self->slots[level][slot];
+            while (head->next != head) {
+                unlink_timer(self, head->next);
+            }
+        }
+    }
+
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_TimerWheel);
+
+static void insert(SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer) {
+    uint64_t expires = timer->expires;
+    if (expires - self->current > MAX_DELTA) {
+        // Parked in the farthest slot until it comes into range.
+        expires = self->current + MAX_DELTA;
+    }
+
+    const int level = level_of(expires - self->current);
+    const size_t slot =
+        (size_t)(expires >> (LEVEL_BITS * level)) & LEVEL_MASK;
+
+    timer->level = (unsigned)level;
+
+    SmolRTSP_Timer *head = &self->slots[level][slot];
+    timer->next = head;
+    timer->prev = head->prev;
+    head->prev->next = timer;
+    head->prev = timer;
+
+    self->levels_len[level]++;
+}
+
+static void unlink_timer(SmolRTSP_TimerWheel *self, SmolRTSP_Timer *timer) {
+    // A timer in the detached list of `fire_slot` is still counted in level 0.
+    self->levels_len[timer->level]--;
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+static void cascade(SmolRTSP_TimerWheel *self, int level, size_t slot) {
+    SmolRTSP_Timer *head = &self->slots[level][slot];
+
+    while (head->next != head) {
+        SmolRTSP_Timer *timer = head->next;
+
+        head->next = timer->next;
+        timer->next->prev = head;
+        self->levels_len[level]--;
+
+        insert(self, timer);
+    }
+}
+
+// Jumps over the ticks at which nothing can expire or cascade, i.e., to just
+// before the next boundary of the lowest non-empty level.
+static void skip_empty_ticks(SmolRTSP_TimerWheel *self, uint64_t now) {
+    int level = 0;
+    while (level < LEVELS_COUNT && 0 == self->levels_len[level]) {
+        level++;
+    }
+    if (0 == level || LEVELS_COUNT == level) {
+        return;
+    }
+
+    const int shift = LEVEL_BITS * level;
+    const uint64_t boundary = ((self->current >> shift) + 1) << shift;
+    const uint64_t target = boundary - 1 < now ? boundary - 1 : now - 1;
+
+    if (target > self->current) {
+        self->current = target;
+    }
+}
+
+static size_t fire_slot(SmolRTSP_TimerWheel *self, size_t slot) {
+    SmolRTSP_Timer *head = &self->slots[0][slot];
+    if (head->next == head) {
+        return 0;
+    }
+
+    // Detach the slot first, so that handlers can freely reschedule their
+    // timers into it or cancel the other timers of the list.
+    SmolRTSP_Timer expired;
+    expired.next = head->next;
+    expired.prev = head->prev;
+    expired.next->prev = &expired;
+    expired.prev->next = &expired;
+    head->prev = head->next = head;
+
+    size_t fired = 0;
+
+    while (expired.next != &expired) {
+        SmolRTSP_Timer *timer = expired.next;
+        unlink_timer(self, timer);
+        self->len--;
+
+        const uint64_t delay =
+            VCALL(timer->handler, on_timer, timer->expires);
+        fired++;
+
+        if (delay > 0 && !SmolRTSP_Timer_is_pending(timer)) {
+            timer->expires += delay;
+            if (timer->expires <= self->current) {
+                timer->expires = self->current + 1;
+            }
+            insert(self, timer);
+            self->len++;
+        }
+    }
+
+    return fired;
+}
+
+static int level_of(uint64_t delta) {
+    int level = 0;
+    while (level + 1 < LEVELS_COUNT &&
+           delta >= (UINT64_C(1) << (LEVEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    return level;
+}
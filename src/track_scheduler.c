@@ -0,0 +1,160 @@
+#include <smolrtsp/track_scheduler.h>
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+
+typedef struct {
+    SmolRTSP_TimerHandler handler;
+    uint64_t due;
+} Track;
+
+struct SmolRTSP_TrackScheduler {
+    SmolRTSP_TimerWheel *wheel;
+    SmolRTSP_TrackSchedulerConfig config;
+    SmolRTSP_Timer timer;
+
+    // The tick at which `timer` expires, if it is pending.
+    uint64_t next_due;
+
+    Track tracks[SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS];
+    size_t tracks_count;
+
+    SmolRTSP_TrackSchedulerStats stats;
+};
+
+declImpl(SmolRTSP_TimerHandler, SmolRTSP_TrackScheduler);
+
+static bool earliest_due(const SmolRTSP_TrackScheduler *self, uint64_t *due);
+
+SmolRTSP_TrackSchedulerConfig SmolRTSP_TrackSchedulerConfig_default(void) {
+    return (SmolRTSP_TrackSchedulerConfig){
+        .slack = 0,
+        .ring = NULL,
+    };
+}
+
+SmolRTSP_TrackScheduler *SmolRTSP_TrackScheduler_new(
+    SmolRTSP_TimerWheel *wheel, SmolRTSP_TrackSchedulerConfig config) {
+    assert(wheel);
+
+    SmolRTSP_TrackScheduler *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->wheel = wheel;
+    self->config = config;
+    self->timer = SmolRTSP_Timer_new(
+        DYN(SmolRTSP_TrackScheduler, SmolRTSP_TimerHandler, self));
+    self->next_due = 0;
+    self->tracks_count = 0;
+    self->stats = (SmolRTSP_TrackSchedulerStats){0};
+
+    return self;
+}
+
+static void SmolRTSP_TrackScheduler_drop(VSelf) {
+    VSELF(SmolRTSP_TrackScheduler);
+    assert(self);
+
+    SmolRTSP_TimerWheel_cancel(self->wheel, &self->timer);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_TrackScheduler);
+
+int SmolRTSP_TrackScheduler_add(
+    SmolRTSP_TrackScheduler *self, SmolRTSP_TimerHandler track,
+    uint64_t delay) {
+    assert(self);
+
+    if (SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS == self->tracks_count) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    // As with `SmolRTSP_TimerWheel_schedule`, a track is due on the next tick
+    // at the earliest.
+    const uint64_t now = SmolRTSP_TimerWheel_now(self->wheel),
+                   due = now + (delay > 0 ? delay : 1);
+    self->tracks[self->tracks_count++] = (Track){track, due};
+
+    if (!SmolRTSP_Timer_is_pending(&self->timer) || due < self->next_due) {
+        SmolRTSP_TimerWheel_schedule(self->wheel, &self->timer, due - now);
+        self->next_due = due;
+    }
+
+    return 0;
+}
+
+size_t SmolRTSP_TrackScheduler_len(const SmolRTSP_TrackScheduler *self) {
+    assert(self);
+    return self->tracks_count;
+}
+
+SmolRTSP_TrackSchedulerStats
+SmolRTSP_TrackScheduler_stats(const SmolRTSP_TrackScheduler *self) {
+    assert(self);
+    return self->stats;
+}
+
+static uint64_t SmolRTSP_TrackScheduler_on_timer(VSelf, uint64_t now) {
+    VSELF(SmolRTSP_TrackScheduler);
+    assert(self);
+
+    self->stats.wakeups++;
+
+    // Every track runs at most once per wakeup, even if its next due tick is
+    // within the slack again.
+    for (size_t i = 0; i < self->tracks_count;) {
+        Track *track = &self->tracks[i];
+        if (track->due > now + self->config.slack) {
+            i++;
+            continue;
+        }
+
+        self->stats.runs++;
+        const uint64_t delay = VCALL(track->handler, on_timer, track->due);
+        if (0 == delay) {
+            *track = self->tracks[--self->tracks_count];
+            continue;
+        }
+
+        track->due += delay;
+        i++;
+    }
+
+    if (self->config.ring != NULL) {
+        // A failed submission leaves the entries queued for the next one.
+        (void)SmolRTSP_Uring_submit(self->config.ring);
+    }
+
+    uint64_t due;
+    if (!earliest_due(self, &due)) {
+        return 0;
+    }
+
+    self->next_due = due > now ? due : now + 1;
+    return self->next_due - now;
+}
+
+impl(SmolRTSP_TimerHandler, SmolRTSP_TrackScheduler);
+
+static bool earliest_due(const SmolRTSP_TrackScheduler *self, uint64_t *due) {
+    if (0 == self->tracks_count) {
+        return false;
+    }
+
+    *due = self->tracks[0].due;
+    for (size_t i = 1; i < self->tracks_count; i++) {
+        if (self->tracks[i].due < *due) {
+            *due = self->tracks[i].due;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,118 @@
+#include <smolrtsp/transport.h>
+
+#include <assert.h>
+#include <errno.h>
+
+ssize_t SmolRTSP_Transport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(void);
+    (void)self;
+    (void)batch;
+
+    errno = ENOSYS;
+    return -1;
+}
+
+size_t SmolRTSP_Transport_max_packet_size(VSelf) {
+    VSELF(void);
+    (void)self;
+
+    return 0;
+}
+
+SmolRTSP_TransportStats SmolRTSP_Transport_stats(VSelf) {
+    VSELF(void);
+    (void)self;
+
+    return (SmolRTSP_TransportStats){0};
+}
+
+void SmolRTSP_TransportStats_record_sent(
+    SmolRTSP_TransportStats *self, uint64_t packets_count, uint64_t bytes) {
+    assert(self);
+
+    __atomic_fetch_add(&self->packets, packets_count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&self->bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void SmolRTSP_TransportStats_record_error(
+    SmolRTSP_TransportStats *self, int error) {
+    assert(self);
+
+    uint64_t *counter;
+    switch (error) {
+    case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+        counter = &self->errors_eagain;
+        break;
+    case ENOBUFS:
+        counter = &self->errors_enobufs;
+        break;
+    case EMSGSIZE:
+        counter = &self->errors_emsgsize;
+        break;
+    case ECONNREFUSED:
+        counter = &self->errors_connrefused;
+        break;
+    default:
+        counter = &self->errors_other;
+        break;
+    }
+
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+void SmolRTSP_TransportStats_record_full(SmolRTSP_TransportStats *self) {
+    assert(self);
+
+    __atomic_fetch_add(&self->full, 1, __ATOMIC_RELAXED);
+}
+
+SmolRTSP_TransportStats
+SmolRTSP_TransportStats_load(const SmolRTSP_TransportStats *self) {
+    assert(self);
+
+#define LOAD(field) .field = __atomic_load_n(&self->field, __ATOMIC_RELAXED)
+    return (SmolRTSP_TransportStats){
+        LOAD(packets),
+        LOAD(bytes),
+        LOAD(full),
+        LOAD(errors_eagain),
+        LOAD(errors_enobufs),
+        LOAD(errors_emsgsize),
+        LOAD(errors_connrefused),
+        LOAD(errors_other),
+    };
+#undef LOAD
+}
+
+size_t
+smolrtsp_transmit_batch(SmolRTSP_Transport t, SmolRTSP_IoVecBatch batch) {
+    assert(t.self && t.vptr);
+
+    size_t transmitted = 0;
+
+    while (transmitted < batch.len) {
+        const ssize_t ret = VCALL(
+            t, transmit_batch, SmolRTSP_IoVecBatch_advance(batch, transmitted));
+        if (-1 == ret && ENOSYS == errno) {
+            break;
+        }
+        if (-1 == ret) {
+            return transmitted;
+        }
+
+        transmitted += (size_t)ret;
+    }
+
+    // The transport does not support batching, so transmit the rest of the
+    // packets one by one.
+    for (; transmitted < batch.len; transmitted++) {
+        if (VCALL(t, transmit, batch.ptr[transmitted]) == -1) {
+            return transmitted;
+        }
+    }
+
+    return transmitted;
+}
@@ -1,34 +1,58 @@
 #include <smolrtsp/transport.h>
 
+#include "../alloc.h"
+#include "../probes.h"
+
 #include <assert.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <alloca.h>
 #include <arpa/inet.h>
 
 #include <slice99.h>
 
 #include <smolrtsp/util.h>
 
+// The limits of a single vectored write of `transmit_batch`.
+#define MAX_BATCH_PACKETS 64
+#define MAX_BATCH_IOVECS  256
+
 typedef struct {
     SmolRTSP_Writer w;
     int channel_id;
     size_t max_buffer;
+    SmolRTSP_TransportStats stats;
 } SmolRTSP_TcpTransport;
 
 declImpl(SmolRTSP_Transport, SmolRTSP_TcpTransport);
 
+static int
+transmit_unlocked(SmolRTSP_TcpTransport *self, SmolRTSP_IoVecSlice bufs);
+static size_t transmit_batch_unlocked(
+    SmolRTSP_TcpTransport *self, SmolRTSP_IoVecBatch batch);
+static void record_batch(
+    SmolRTSP_TcpTransport *self, SmolRTSP_IoVecBatch batch,
+    size_t transmitted);
+static size_t gather(struct iovec vecs[restrict], SmolRTSP_IoVecSlice bufs);
+
 SmolRTSP_Transport smolrtsp_transport_tcp(
     SmolRTSP_Writer w, uint8_t channel_id, size_t max_buffer) {
     assert(w.self && w.vptr);
 
-    SmolRTSP_TcpTransport *self = malloc(sizeof *self);
-    assert(self);
+    SmolRTSP_TcpTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
 
     self->w = w;
     self->channel_id = channel_id;
     self->max_buffer = max_buffer;
+    self->stats = (SmolRTSP_TransportStats){0};
 
     return DYN(SmolRTSP_TcpTransport, SmolRTSP_Transport, self);
 }
@@ -37,7 +61,7 @@ static void SmolRTSP_TcpTransport_drop(VSelf) {
     VSELF(SmolRTSP_TcpTransport);
     assert(self);
 
-    free(self);
+    smolrtsp_free(self);
 }
 
 impl(SmolRTSP_Droppable, SmolRTSP_TcpTransport);
@@ -46,38 +70,161 @@ static int SmolRTSP_TcpTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
     VSELF(SmolRTSP_TcpTransport);
     assert(self);
 
+    VCALL(self->w, lock);
+    const int ret = transmit_unlocked(self, bufs);
+    VCALL(self->w, unlock);
+
+    record_batch(self, SmolRTSP_IoVecBatch_new(&bufs, 1), 0 == ret ? 1 : 0);
+
+    return ret;
+}
+
+#define SmolRTSP_TcpTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_TcpTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_TcpTransport);
+    assert(self);
+
+    // Hold the lock for the whole batch so that other channels cannot
+    // interleave with its packets.
+    VCALL(self->w, lock);
+    const size_t transmitted = transmit_batch_unlocked(self, batch);
+    VCALL(self->w, unlock);
+
+    record_batch(self, batch, transmitted);
+
+    return 0 == transmitted && batch.len > 0 ? -1 : (ssize_t)transmitted;
+}
+
+static bool SmolRTSP_TcpTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_TcpTransport);
+    assert(self);
+
+    const bool is_full = VCALL(self->w, filled) > self->max_buffer;
+    if (is_full) {
+        SmolRTSP_TransportStats_record_full(&self->stats);
+    }
+
+    return is_full;
+}
+
+#define SmolRTSP_TcpTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_TcpTransport_stats(VSelf) {
+    VSELF(SmolRTSP_TcpTransport);
+    assert(self);
+
+    return SmolRTSP_TransportStats_load(&self->stats);
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_TcpTransport);
+
+static int
+transmit_unlocked(SmolRTSP_TcpTransport *self, SmolRTSP_IoVecSlice bufs) {
     const size_t total_bytes = SmolRTSP_IoVecSlice_len(bufs);
 
     const uint32_t header =
         smolrtsp_interleaved_header(self->channel_id, htons(total_bytes));
 
-    VCALL(self->w, lock);
-    ssize_t ret =
-        VCALL(self->w, write, CharSlice99_new((char *)&header, sizeof header));
-    if (ret != sizeof header) {
-        VCALL(self->w, unlock);
+    // Send the header and the data as a single vectored write so that a
+    // packet does not produce several tiny TCP segments.
+    struct iovec *vecs = alloca((bufs.len + 1) * sizeof vecs[0]);
+    vecs[0] = (struct iovec){(void *)&header, sizeof header};
+    const size_t vecs_count = 1 + gather(vecs + 1, bufs);
+
+    const ssize_t ret =
+        smolrtsp_writev(self->w, SmolRTSP_IoVecSlice_new(vecs, vecs_count));
+    if (ret != (ssize_t)(sizeof header + total_bytes)) {
         return -1;
     }
 
-    for (size_t i = 0; i < bufs.len; i++) {
-        const CharSlice99 vec =
-            CharSlice99_new(bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
-        ret = VCALL(self->w, write, vec);
-        if (ret != (ssize_t)vec.len) {
-            VCALL(self->w, unlock);
-            return -1;
+    return 0;
+}
+
+// Gathers as many packets of `batch` as fit into `MAX_BATCH_IOVECS` and
+// writes them with a single `writev`; returns the number of packets written.
+static size_t transmit_batch_unlocked(
+    SmolRTSP_TcpTransport *self, SmolRTSP_IoVecBatch batch) {
+    uint32_t headers[MAX_BATCH_PACKETS];
+    struct iovec vecs[MAX_BATCH_IOVECS];
+
+    size_t transmitted = 0;
+
+    while (transmitted < batch.len) {
+        size_t packets_count = 0, vecs_count = 0, total_bytes = 0;
+
+        while (transmitted + packets_count < batch.len &&
+               packets_count < MAX_BATCH_PACKETS) {
+            const SmolRTSP_IoVecSlice bufs =
+                batch.ptr[transmitted + packets_count];
+            if (vecs_count + bufs.len + 1 > MAX_BATCH_IOVECS) {
+                break;
+            }
+
+            const size_t packet_size = SmolRTSP_IoVecSlice_len(bufs);
+            headers[packets_count] = smolrtsp_interleaved_header(
+                self->channel_id, htons(packet_size));
+
+            vecs[vecs_count++] = (struct iovec){
+                &headers[packets_count], sizeof headers[0]};
+            vecs_count += gather(vecs + vecs_count, bufs);
+
+            total_bytes += sizeof headers[0] + packet_size;
+            packets_count++;
+        }
+
+        if (0 == packets_count) {
+            // A packet with too many I/O vectors to be gathered.
+            if (transmit_unlocked(self, batch.ptr[transmitted]) == -1) {
+                return transmitted;
+            }
+            transmitted++;
+            continue;
+        }
+
+        const ssize_t ret = smolrtsp_writev(
+            self->w, SmolRTSP_IoVecSlice_new(vecs, vecs_count));
+        if (ret != (ssize_t)total_bytes) {
+            return transmitted;
         }
+
+        transmitted += packets_count;
     }
-    VCALL(self->w, unlock);
 
-    return 0;
+    return transmitted;
 }
 
-static bool SmolRTSP_TcpTransport_is_full(VSelf) {
-    VSELF(SmolRTSP_TcpTransport);
-    assert(self);
+// Counts the first `transmitted` packets of `batch` as sent and, if not all of
+// them have been transmitted, the error in `errno`.
+static void record_batch(
+    SmolRTSP_TcpTransport *self, SmolRTSP_IoVecBatch batch,
+    size_t transmitted) {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < transmitted; i++) {
+        bytes += SmolRTSP_IoVecSlice_len(batch.ptr[i]);
+    }
+    SMOLRTSP_PROBE(
+        tcp_transmit, self->channel_id, batch.len, transmitted, bytes,
+        transmitted < batch.len ? errno : 0);
+
+    if (transmitted > 0) {
+        SmolRTSP_TransportStats_record_sent(&self->stats, transmitted, bytes);
+    }
 
-    return VCALL(self->w, filled) > self->max_buffer;
+    if (transmitted < batch.len) {
+        SmolRTSP_TransportStats_record_error(&self->stats, errno);
+    }
 }
 
-impl(SmolRTSP_Transport, SmolRTSP_TcpTransport);
+// Copies the non-empty vectors of `bufs` to `vecs` and returns their number.
+// The packets of pre-packetized files have no payload header, so this saves a
+// vector per packet.
+static size_t gather(struct iovec vecs[restrict], SmolRTSP_IoVecSlice bufs) {
+    size_t count = 0;
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            vecs[count++] = bufs.ptr[i];
+        }
+    }
+
+    return count;
+}
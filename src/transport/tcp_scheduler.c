@@ -0,0 +1,551 @@
+#include <smolrtsp/tcp_scheduler.h>
+
+#include "../alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <alloca.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#include <slice99.h>
+
+#include <smolrtsp/util.h>
+
+#define INTERLEAVED_HEADER_SIZE 4
+
+// The initial capacity of a channel queue.
+#define MIN_QUEUE_CAPACITY 4096
+
+typedef struct {
+    uint8_t id;
+    SmolRTSP_TcpChannelClass cls;
+
+    // The queued packets in their wire format, i.e., each one preceded by its
+    // interleaved header, occupy `data[head..head + len]`.
+    char *data;
+    size_t head, len, capacity;
+
+    // The number of bytes the channel may still write in its current turn.
+    size_t deficit;
+} Channel;
+
+struct SmolRTSP_TcpScheduler {
+    SmolRTSP_Writer w;
+    SmolRTSP_TcpSchedulerConfig config;
+
+    // Guards all the fields below. It is taken before the lock of `w`.
+    pthread_mutex_t mutex;
+
+    Channel channels[SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS];
+    size_t channels_count;
+
+    // The channel of the current turn of the round robin.
+    size_t current;
+
+    // The number of bytes queued on all the channels.
+    size_t pending;
+
+    SmolRTSP_TcpSchedulerStats stats;
+};
+
+typedef struct {
+    SmolRTSP_TcpScheduler *scheduler;
+
+    // Channels are never removed, so the index stays valid.
+    size_t channel_idx;
+
+    size_t max_buffer;
+    SmolRTSP_TransportStats stats;
+} SmolRTSP_TcpScheduledTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_TcpScheduledTransport);
+
+static Channel *find_or_add_channel(SmolRTSP_TcpScheduler *self, uint8_t id);
+static int
+transmit_one(SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs);
+static int
+write_packet(SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs);
+static int enqueue(
+    SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs,
+    size_t total_bytes);
+static ssize_t flush_unlocked(SmolRTSP_TcpScheduler *self);
+static Channel *next_channel(SmolRTSP_TcpScheduler *self);
+static bool has_lower_pending(const SmolRTSP_TcpScheduler *self, uint8_t prio);
+static size_t packet_size(const Channel *c, size_t offset);
+static size_t gather(struct iovec vecs[restrict], SmolRTSP_IoVecSlice bufs);
+static void record_batch(
+    SmolRTSP_TcpScheduledTransport *self, SmolRTSP_IoVecBatch batch,
+    size_t transmitted);
+
+SmolRTSP_TcpSchedulerConfig SmolRTSP_TcpSchedulerConfig_default(void) {
+    return (SmolRTSP_TcpSchedulerConfig){
+        .max_filled = SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_FILLED,
+        .max_queued = SMOLRTSP_TCP_SCHEDULER_DEFAULT_MAX_QUEUED,
+        .quantum = SMOLRTSP_TCP_SCHEDULER_DEFAULT_QUANTUM,
+    };
+}
+
+SmolRTSP_TcpScheduler *SmolRTSP_TcpScheduler_new(
+    SmolRTSP_Writer w, SmolRTSP_TcpSchedulerConfig config) {
+    assert(w.self && w.vptr);
+    assert(config.max_queued > 0);
+    assert(config.quantum > 0);
+
+    SmolRTSP_TcpScheduler *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->w = w;
+    self->config = config;
+    const int ret = pthread_mutex_init(&self->mutex, NULL);
+    assert(0 == ret);
+    (void)ret;
+    self->channels_count = 0;
+    self->current = 0;
+    self->pending = 0;
+    self->stats = (SmolRTSP_TcpSchedulerStats){0};
+
+    return self;
+}
+
+int SmolRTSP_TcpScheduler_set_class(
+    SmolRTSP_TcpScheduler *self, uint8_t channel_id,
+    SmolRTSP_TcpChannelClass cls) {
+    assert(self);
+    assert(cls.weight > 0);
+
+    pthread_mutex_lock(&self->mutex);
+    Channel *c = find_or_add_channel(self, channel_id);
+    if (c != NULL) {
+        c->cls = cls;
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return NULL == c ? -1 : 0;
+}
+
+ssize_t SmolRTSP_TcpScheduler_flush(SmolRTSP_TcpScheduler *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const ssize_t ret = flush_unlocked(self);
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret;
+}
+
+size_t SmolRTSP_TcpScheduler_pending(SmolRTSP_TcpScheduler *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const size_t pending = self->pending;
+    pthread_mutex_unlock(&self->mutex);
+
+    return pending;
+}
+
+SmolRTSP_TcpSchedulerStats
+SmolRTSP_TcpScheduler_stats(SmolRTSP_TcpScheduler *self) {
+    assert(self);
+
+    pthread_mutex_lock(&self->mutex);
+    const SmolRTSP_TcpSchedulerStats stats = self->stats;
+    pthread_mutex_unlock(&self->mutex);
+
+    return stats;
+}
+
+static void SmolRTSP_TcpScheduler_drop(VSelf) {
+    VSELF(SmolRTSP_TcpScheduler);
+    assert(self);
+
+    for (size_t i = 0; i < self->channels_count; i++) {
+        smolrtsp_free(self->channels[i].data);
+    }
+    pthread_mutex_destroy(&self->mutex);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_TcpScheduler);
+
+SmolRTSP_Transport smolrtsp_transport_tcp_scheduled(
+    SmolRTSP_TcpScheduler *scheduler, uint8_t channel_id, size_t max_buffer) {
+    assert(scheduler);
+
+    pthread_mutex_lock(&scheduler->mutex);
+    const Channel *c = find_or_add_channel(scheduler, channel_id);
+    pthread_mutex_unlock(&scheduler->mutex);
+    if (NULL == c) {
+        return (SmolRTSP_Transport){0};
+    }
+
+    SmolRTSP_TcpScheduledTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->scheduler = scheduler;
+    self->channel_idx = (size_t)(c - scheduler->channels);
+    self->max_buffer = max_buffer;
+    self->stats = (SmolRTSP_TransportStats){0};
+
+    return DYN(SmolRTSP_TcpScheduledTransport, SmolRTSP_Transport, self);
+}
+
+static void SmolRTSP_TcpScheduledTransport_drop(VSelf) {
+    VSELF(SmolRTSP_TcpScheduledTransport);
+    assert(self);
+
+    // The queued packets of the channel are still written by the scheduler.
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_TcpScheduledTransport);
+
+static int
+SmolRTSP_TcpScheduledTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_TcpScheduledTransport);
+    assert(self);
+
+    SmolRTSP_TcpScheduler *scheduler = self->scheduler;
+
+    pthread_mutex_lock(&scheduler->mutex);
+    const int ret = transmit_one(
+        scheduler, &scheduler->channels[self->channel_idx], bufs);
+    const int saved_errno = errno;
+    (void)flush_unlocked(scheduler);
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    errno = saved_errno;
+    record_batch(self, SmolRTSP_IoVecBatch_new(&bufs, 1), 0 == ret ? 1 : 0);
+
+    return ret;
+}
+
+#define SmolRTSP_TcpScheduledTransport_transmit_batch_CUSTOM ()
+static ssize_t SmolRTSP_TcpScheduledTransport_transmit_batch(
+    VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_TcpScheduledTransport);
+    assert(self);
+
+    SmolRTSP_TcpScheduler *scheduler = self->scheduler;
+    Channel *c = &scheduler->channels[self->channel_idx];
+
+    pthread_mutex_lock(&scheduler->mutex);
+    size_t transmitted = 0;
+    while (transmitted < batch.len &&
+           transmit_one(scheduler, c, batch.ptr[transmitted]) == 0) {
+        transmitted++;
+    }
+    const int saved_errno = errno;
+    (void)flush_unlocked(scheduler);
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    errno = saved_errno;
+    record_batch(self, batch, transmitted);
+
+    return 0 == transmitted && batch.len > 0 ? -1 : (ssize_t)transmitted;
+}
+
+static bool SmolRTSP_TcpScheduledTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_TcpScheduledTransport);
+    assert(self);
+
+    SmolRTSP_TcpScheduler *scheduler = self->scheduler;
+
+    pthread_mutex_lock(&scheduler->mutex);
+    const size_t queued = scheduler->channels[self->channel_idx].len;
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    const bool is_full =
+        VCALL(scheduler->w, filled) + queued > self->max_buffer;
+    if (is_full) {
+        SmolRTSP_TransportStats_record_full(&self->stats);
+    }
+
+    return is_full;
+}
+
+#define SmolRTSP_TcpScheduledTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_TcpScheduledTransport_stats(VSelf) {
+    VSELF(SmolRTSP_TcpScheduledTransport);
+    assert(self);
+
+    return SmolRTSP_TransportStats_load(&self->stats);
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_TcpScheduledTransport);
+
+static Channel *find_or_add_channel(SmolRTSP_TcpScheduler *self, uint8_t id) {
+    for (size_t i = 0; i < self->channels_count; i++) {
+        if (self->channels[i].id == id) {
+            return &self->channels[i];
+        }
+    }
+
+    if (SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS == self->channels_count) {
+        errno = ENOSPC;
+        return NULL;
+    }
+
+    Channel *c = &self->channels[self->channels_count++];
+    *c = (Channel){
+        .id = id,
+        .cls = {.priority = 0, .weight = 1},
+        .data = NULL,
+    };
+
+    return c;
+}
+
+// Writes `bufs` at once if nothing is queued and the writer has room for it,
+// or queues it otherwise.
+static int transmit_one(
+    SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs) {
+    if (0 == self->pending) {
+        VCALL(self->w, lock);
+        const bool has_room = VCALL(self->w, filled) < self->config.max_filled;
+        const int ret = has_room ? write_packet(self, c, bufs) : 0;
+        VCALL(self->w, unlock);
+
+        if (has_room) {
+            if (0 == ret) {
+                self->stats.direct++;
+            }
+            return ret;
+        }
+    }
+
+    return enqueue(self, c, bufs, SmolRTSP_IoVecSlice_len(bufs));
+}
+
+// The same as `transmit_unlocked` of the TCP transport.
+static int write_packet(
+    SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs) {
+    const size_t total_bytes = SmolRTSP_IoVecSlice_len(bufs);
+
+    const uint32_t header =
+        smolrtsp_interleaved_header(c->id, htons(total_bytes));
+
+    struct iovec *vecs = alloca((bufs.len + 1) * sizeof vecs[0]);
+    vecs[0] = (struct iovec){(void *)&header, sizeof header};
+    const size_t vecs_count = 1 + gather(vecs + 1, bufs);
+
+    const ssize_t ret =
+        smolrtsp_writev(self->w, SmolRTSP_IoVecSlice_new(vecs, vecs_count));
+    if (ret != (ssize_t)(sizeof header + total_bytes)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int enqueue(
+    SmolRTSP_TcpScheduler *self, Channel *c, SmolRTSP_IoVecSlice bufs,
+    size_t total_bytes) {
+    const size_t size = INTERLEAVED_HEADER_SIZE + total_bytes;
+    if (c->len + size > self->config.max_queued) {
+        self->stats.rejected++;
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    if (c->head + c->len + size > c->capacity) {
+        // Move the queued packets to the beginning, and grow the queue if they
+        // still do not leave room for the new one.
+        if (c->head > 0) {
+            memmove(c->data, c->data + c->head, c->len);
+            c->head = 0;
+        }
+
+        if (c->len + size > c->capacity) {
+            size_t capacity =
+                c->capacity > 0 ? c->capacity : MIN_QUEUE_CAPACITY;
+            while (capacity < c->len + size) {
+                capacity *= 2;
+            }
+            if (capacity > self->config.max_queued) {
+                capacity = self->config.max_queued;
+            }
+
+            char *data = smolrtsp_realloc(c->data, capacity);
+            if (NULL == data) {
+                errno = ENOMEM;
+                return -1;
+            }
+            c->data = data;
+            c->capacity = capacity;
+        }
+    }
+
+    char *out = c->data + c->head + c->len;
+    const uint32_t header =
+        smolrtsp_interleaved_header(c->id, htons(total_bytes));
+    memcpy(out, &header, sizeof header);
+    out += sizeof header;
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            memcpy(out, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+            out += bufs.ptr[i].iov_len;
+        }
+    }
+
+    c->len += size;
+    self->pending += size;
+    self->stats.queued++;
+
+    return 0;
+}
+
+static ssize_t flush_unlocked(SmolRTSP_TcpScheduler *self) {
+    size_t written = 0;
+    bool failed = false;
+
+    VCALL(self->w, lock);
+
+    while (self->pending > 0) {
+        const size_t filled = VCALL(self->w, filled);
+        if (filled >= self->config.max_filled) {
+            break;
+        }
+
+        Channel *c = next_channel(self);
+
+        // The packets of `c` allowed by its deficit and the room of the writer
+        // are contiguous, so they are written at once. The first one is
+        // written even if it overfills the writer.
+        size_t run = 0, packets_count = 0;
+        while (run < c->len) {
+            const size_t size = packet_size(c, run);
+            if (run + size > c->deficit ||
+                (packets_count > 0 &&
+                 filled + run + size > self->config.max_filled)) {
+                break;
+            }
+            run += size;
+            packets_count++;
+        }
+        assert(packets_count > 0);
+
+        const ssize_t ret =
+            VCALL(self->w, write, CharSlice99_new(c->data + c->head, run));
+        if (ret != (ssize_t)run) {
+            failed = true;
+            break;
+        }
+
+        if (has_lower_pending(self, c->cls.priority)) {
+            self->stats.overtakes += packets_count;
+        }
+
+        c->head += run;
+        c->len -= run;
+        c->deficit -= run;
+        self->pending -= run;
+        if (0 == c->len) {
+            // An idle channel does not save up its turns.
+            c->head = 0;
+            c->deficit = 0;
+        }
+
+        written += packets_count;
+    }
+
+    VCALL(self->w, unlock);
+
+    return failed && 0 == written ? -1 : (ssize_t)written;
+}
+
+// Returns the channel to write from: the one of the current turn if it can
+// still write its next packet, or else the next one of the highest priority
+// with queued packets, whose deficit grows by its quanta on every turn.
+static Channel *next_channel(SmolRTSP_TcpScheduler *self) {
+    assert(self->pending > 0);
+
+    int priority = -1;
+    for (size_t i = 0; i < self->channels_count; i++) {
+        const Channel *c = &self->channels[i];
+        if (c->len > 0 && c->cls.priority > priority) {
+            priority = c->cls.priority;
+        }
+    }
+
+    Channel *c = &self->channels[self->current];
+    if (c->len > 0 && c->cls.priority == priority &&
+        c->deficit >= packet_size(c, 0)) {
+        return c;
+    }
+
+    for (;;) {
+        self->current = (self->current + 1) % self->channels_count;
+        c = &self->channels[self->current];
+        if (c->len > 0 && c->cls.priority == priority) {
+            c->deficit += self->config.quantum * c->cls.weight;
+            if (c->deficit >= packet_size(c, 0)) {
+                return c;
+            }
+        }
+    }
+}
+
+static bool has_lower_pending(const SmolRTSP_TcpScheduler *self, uint8_t prio) {
+    for (size_t i = 0; i < self->channels_count; i++) {
+        const Channel *c = &self->channels[i];
+        if (c->len > 0 && c->cls.priority < prio) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Returns the size of the queued packet at `offset`, including its
+// interleaved header.
+static size_t packet_size(const Channel *c, size_t offset) {
+    const uint8_t *header = (const uint8_t *)c->data + c->head + offset;
+    uint8_t channel_id;
+    uint16_t payload_len;
+    smolrtsp_parse_interleaved_header(header, &channel_id, &payload_len);
+
+    return INTERLEAVED_HEADER_SIZE + (size_t)payload_len;
+}
+
+// Copies the non-empty vectors of `bufs` to `vecs` and returns their number.
+static size_t gather(struct iovec vecs[restrict], SmolRTSP_IoVecSlice bufs) {
+    size_t count = 0;
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            vecs[count++] = bufs.ptr[i];
+        }
+    }
+
+    return count;
+}
+
+// Counts the first `transmitted` packets of `batch` as sent and, if not all of
+// them have been transmitted, the error in `errno`.
+static void record_batch(
+    SmolRTSP_TcpScheduledTransport *self, SmolRTSP_IoVecBatch batch,
+    size_t transmitted) {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < transmitted; i++) {
+        bytes += SmolRTSP_IoVecSlice_len(batch.ptr[i]);
+    }
+
+    if (transmitted > 0) {
+        SmolRTSP_TransportStats_record_sent(&self->stats, transmitted, bytes);
+    }
+
+    if (transmitted < batch.len) {
+        SmolRTSP_TransportStats_record_error(&self->stats, errno);
+    }
+}
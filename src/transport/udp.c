@@ -1,42 +1,195 @@
-#include <smolrtsp/transport.h>
+#include "udp.h"
+
+#include "../alloc.h"
+#include "../probes.h"
 
 #include <assert.h>
 #include <errno.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
+
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+// The IP and UDP header sizes subtracted from the path MTU.
+#define IPV4_HEADER_SIZE 20
+#define IPV6_HEADER_SIZE 40
+#define UDP_HEADER_SIZE  8
+
+// The maximum number of datagrams passed to a single `sendmmsg` call.
+#define MAX_BATCH_SIZE 64
+
+// The kernel limits on a single GSO super-buffer (see `UDP_MAX_SEGMENTS` in
+// `include/linux/udp.h`).
+#define GSO_MAX_SEGMENTS 64
+#define GSO_MAX_BYTES    64000
+#define GSO_MAX_IOVECS   256
+
+// The reports asked for by `SmolRTSP_UdpTransportConfig.tx_timestamps`: the
+// software and hardware TX timestamps, tagged with transmission IDs and
+// without the datagrams looped back.
+#define TX_TIMESTAMPING_FLAGS                                                  \
+    (SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE |             \
+     SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RAW_HARDWARE |               \
+     SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY)
+
+// A transmission handed to the kernel at `sent_ns` (`CLOCK_REALTIME`, as the
+// kernel timestamps).
+typedef struct {
+    uint32_t id;
+    uint64_t sent_ns;
+} TxSend;
 
-#define MAX_RETRANSMITS 10
+struct SmolRTSP_TxTimestamps {
+    SmolRTSP_TxTimestampsConfig config;
 
-typedef struct {
+    // The transmission `id` is kept at `sends[id % config.capacity]`.
+    TxSend *sends;
+    uint32_t next_id;
+
+    SmolRTSP_TxTimestampsStats stats;
+};
+
+struct SmolRTSP_UdpTransport {
     int fd;
-} SmolRTSP_UdpTransport;
+    SmolRTSP_UdpTransportConfig config;
+
+    // Derived from the path MTU (0 if unknown); refreshed on `EMSGSIZE`.
+    size_t max_packet_size;
+
+    SmolRTSP_TransportStats stats;
+
+    // Placed into the allocation of its owner by `smolrtsp_udp_transport_init`
+    // rather than allocated on its own.
+    bool embedded;
+};
 
 declImpl(SmolRTSP_Transport, SmolRTSP_UdpTransport);
 
+static void init(
+    SmolRTSP_UdpTransport *self, int fd, SmolRTSP_UdpTransportConfig config);
 static int send_packet(SmolRTSP_UdpTransport *self, struct msghdr message);
+static ssize_t send_gso(SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch);
+static size_t gso_segments_count(SmolRTSP_IoVecBatch batch);
+static ssize_t
+retry_gso(SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch);
+static bool is_gso_unsupported(int error);
+static int zerocopy_flags(const SmolRTSP_UdpTransport *self, size_t len);
+static void zerocopy_sent(SmolRTSP_UdpTransport *self, int flags, size_t n);
+static void
+record_zerocopy(SmolRTSP_ZeroCopyState *state, struct sock_extended_err err);
+static uint64_t tx_now_ns(const SmolRTSP_UdpTransport *self);
+static void tx_sent(SmolRTSP_UdpTransport *self, size_t n, uint64_t sent_ns);
+static void record_tx_timestamp(
+    SmolRTSP_TxTimestamps *self, uint32_t id,
+    const struct scm_timestamping *tss);
+static size_t path_max_packet_size(int fd);
+static void handle_emsgsize(SmolRTSP_UdpTransport *self, ssize_t ret);
+static void record_batch(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch, ssize_t ret);
 static int
 new_sockaddr(struct sockaddr *addr, int af, const void *ip, uint16_t port);
 
+SmolRTSP_UdpTransportConfig SmolRTSP_UdpTransportConfig_default(void) {
+    return (SmolRTSP_UdpTransportConfig){
+        .gso = false,
+        .zerocopy_threshold = 0,
+        .zerocopy_state = NULL,
+        .tx_timestamps = NULL,
+    };
+}
+
 SmolRTSP_Transport smolrtsp_transport_udp(int fd) {
     assert(fd >= 0);
 
-    SmolRTSP_UdpTransport *self = malloc(sizeof *self);
-    assert(self);
-    self->fd = fd;
+    return smolrtsp_transport_udp_with_config(
+        fd, SmolRTSP_UdpTransportConfig_default());
+}
+
+SmolRTSP_Transport smolrtsp_transport_udp_with_config(
+    int fd, SmolRTSP_UdpTransportConfig config) {
+    assert(fd >= 0);
+    assert(0 == config.zerocopy_threshold || config.zerocopy_state);
+
+    SmolRTSP_UdpTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+    init(self, fd, config);
+    self->embedded = false;
+
+    return DYN(SmolRTSP_UdpTransport, SmolRTSP_Transport, self);
+}
+
+size_t smolrtsp_udp_transport_size(void) {
+    return sizeof(SmolRTSP_UdpTransport);
+}
+
+SmolRTSP_Transport smolrtsp_udp_transport_init(
+    void *storage, int fd, SmolRTSP_UdpTransportConfig config) {
+    assert(storage);
+    assert(fd >= 0);
+    assert(0 == config.zerocopy_threshold || config.zerocopy_state);
+
+    SmolRTSP_UdpTransport *self = storage;
+    init(self, fd, config);
+    self->embedded = true;
 
     return DYN(SmolRTSP_UdpTransport, SmolRTSP_Transport, self);
 }
 
+SmolRTSP_UdpTransport *smolrtsp_udp_transport_of(SmolRTSP_Transport t) {
+    return t.vptr == &VTABLE(SmolRTSP_UdpTransport, SmolRTSP_Transport)
+               ? t.self
+               : NULL;
+}
+
+static void init(
+    SmolRTSP_UdpTransport *self, int fd, SmolRTSP_UdpTransportConfig config) {
+    self->fd = fd;
+    self->config = config;
+    self->config.gso = config.gso && smolrtsp_udp_gso_supported(fd);
+    self->max_packet_size = path_max_packet_size(fd);
+    self->stats = (SmolRTSP_TransportStats){0};
+
+#ifdef SO_ZEROCOPY
+    const int enable_zerocopy = 1;
+    if (config.zerocopy_threshold > 0 &&
+        setsockopt(
+            fd, SOL_SOCKET, SO_ZEROCOPY, &enable_zerocopy,
+            sizeof enable_zerocopy) == -1) {
+        self->config.zerocopy_threshold = 0;
+    }
+#else
+    self->config.zerocopy_threshold = 0;
+#endif
+
+    const int timestamping = TX_TIMESTAMPING_FLAGS;
+    if (config.tx_timestamps != NULL &&
+        setsockopt(
+            fd, SOL_SOCKET, SO_TIMESTAMPING, &timestamping,
+            sizeof timestamping) == -1) {
+        self->config.tx_timestamps = NULL;
+    }
+}
+
 static void SmolRTSP_UdpTransport_drop(VSelf) {
     VSELF(SmolRTSP_UdpTransport);
     assert(self);
 
-    free(self);
+    // An embedded transport is freed together with its owner.
+    if (!self->embedded) {
+        smolrtsp_free(self);
+    }
 }
 
 impl(SmolRTSP_Droppable, SmolRTSP_UdpTransport);
@@ -55,7 +208,76 @@ static int SmolRTSP_UdpTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
         .msg_flags = 0,
     };
 
-    return send_packet(self, msg);
+    const int ret = send_packet(self, msg);
+    SMOLRTSP_PROBE(
+        udp_transmit, self->fd, 1, -1 == ret ? -1 : 1,
+        SmolRTSP_IoVecSlice_len(bufs), -1 == ret ? errno : 0);
+    if (-1 == ret) {
+        SmolRTSP_TransportStats_record_error(&self->stats, errno);
+    } else {
+        SmolRTSP_TransportStats_record_sent(
+            &self->stats, 1, SmolRTSP_IoVecSlice_len(bufs));
+    }
+
+    return ret;
+}
+
+#define SmolRTSP_UdpTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_UdpTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_UdpTransport);
+    assert(self);
+
+    if (self->config.gso && gso_segments_count(batch) > 1) {
+        ssize_t ret = send_gso(self, batch);
+        if (-1 == ret && EINVAL == errno) {
+            ret = retry_gso(self, batch);
+        }
+        if (ret != -1 || (EINVAL != errno && !is_gso_unsupported(errno))) {
+            handle_emsgsize(self, ret);
+            record_batch(self, batch, ret);
+            return ret;
+        }
+
+        // The socket or the device cannot do GSO after all; do not try it
+        // again. After a persistent `EINVAL`, only this batch goes without it.
+        if (is_gso_unsupported(errno)) {
+            self->config.gso = false;
+        }
+    }
+
+    // All the datagrams of one `sendmmsg` call share the same flags, so take
+    // only those with the same zero-copy decision as the first one.
+    const int flags =
+        zerocopy_flags(self, SmolRTSP_IoVecSlice_len(batch.ptr[0]));
+
+    struct mmsghdr msgs[MAX_BATCH_SIZE];
+    size_t msgs_count = 0;
+    while (msgs_count < batch.len && msgs_count < MAX_BATCH_SIZE &&
+           zerocopy_flags(
+               self, SmolRTSP_IoVecSlice_len(batch.ptr[msgs_count])) == flags) {
+        memset(&msgs[msgs_count], '\0', sizeof msgs[0]);
+        msgs[msgs_count].msg_hdr.msg_iov = batch.ptr[msgs_count].ptr;
+        msgs[msgs_count].msg_hdr.msg_iovlen = batch.ptr[msgs_count].len;
+        msgs_count++;
+    }
+
+    const uint64_t sent_ns = tx_now_ns(self);
+    int ret = sendmmsg(self->fd, msgs, msgs_count, flags);
+    if (-1 == ret && ENOBUFS == errno && flags != 0) {
+        // Out of the pinned memory limit; copy the data instead.
+        ret = sendmmsg(self->fd, msgs, msgs_count, 0);
+    } else if (ret != -1) {
+        zerocopy_sent(self, flags, ret);
+    }
+    if (ret > 0) {
+        tx_sent(self, ret, sent_ns);
+    }
+
+    handle_emsgsize(self, ret);
+    record_batch(self, batch, ret);
+
+    return ret;
 }
 
 static bool SmolRTSP_UdpTransport_is_full(VSelf) {
@@ -65,30 +287,491 @@ static bool SmolRTSP_UdpTransport_is_full(VSelf) {
     return false;
 }
 
+#define SmolRTSP_UdpTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_UdpTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_UdpTransport);
+    assert(self);
+
+    return self->max_packet_size;
+}
+
+#define SmolRTSP_UdpTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_UdpTransport_stats(VSelf) {
+    VSELF(SmolRTSP_UdpTransport);
+    assert(self);
+
+    return SmolRTSP_TransportStats_load(&self->stats);
+}
+
 impl(SmolRTSP_Transport, SmolRTSP_UdpTransport);
 
+int smolrtsp_udp_transport_transmit(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecSlice bufs) {
+    return SmolRTSP_UdpTransport_transmit(self, bufs);
+}
+
+ssize_t smolrtsp_udp_transport_transmit_batch(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch) {
+    return SmolRTSP_UdpTransport_transmit_batch(self, batch);
+}
+
 static int send_packet(SmolRTSP_UdpTransport *self, struct msghdr message) {
-    // Try to retransmit a packet several times on `EMSGSIZE`. The kernel
-    // will fragment an IP packet because if `IP_PMTUDISC_WANT` is set.
-    size_t i = MAX_RETRANSMITS;
-    do {
-        const ssize_t ret = sendmsg(self->fd, &message, 0);
+    const SmolRTSP_IoVecSlice bufs = {
+        .ptr = message.msg_iov,
+        .len = message.msg_iovlen,
+    };
+    const int flags = zerocopy_flags(self, SmolRTSP_IoVecSlice_len(bufs));
+
+    const uint64_t sent_ns = tx_now_ns(self);
+    ssize_t ret = sendmsg(self->fd, &message, flags);
+    if (-1 == ret && ENOBUFS == errno && flags != 0) {
+        // Out of the pinned memory limit; copy the data instead.
+        ret = sendmsg(self->fd, &message, 0);
+    } else if (ret != -1) {
+        zerocopy_sent(self, flags, 1);
+    }
+    if (ret != -1) {
+        tx_sent(self, 1, sent_ns);
+    }
+
+    // Retransmitting the same datagram on `EMSGSIZE` is pointless; the caller
+    // has to send smaller ones.
+    handle_emsgsize(self, ret);
+
+    return -1 == ret ? -1 : 0;
+}
+
+static size_t path_max_packet_size(int fd) {
+    int domain;
+    socklen_t len = sizeof domain;
+    if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len) == -1) {
+        return 0;
+    }
 
-        if (ret != -1) {
+    // Both fail with `ENOTCONN` if the socket is not connected, in which case
+    // the path is unknown.
+    int mtu = 0;
+    len = sizeof mtu;
+    switch (domain) {
+    case AF_INET:
+        if (getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) == -1 ||
+            mtu <= IPV4_HEADER_SIZE + UDP_HEADER_SIZE) {
             return 0;
         }
-        if (EMSGSIZE != errno) {
-            return -1;
+        return (size_t)mtu - IPV4_HEADER_SIZE - UDP_HEADER_SIZE;
+    case AF_INET6:
+        if (getsockopt(fd, IPPROTO_IPV6, IPV6_MTU, &mtu, &len) == -1 ||
+            mtu <= IPV6_HEADER_SIZE + UDP_HEADER_SIZE) {
+            return 0;
         }
+        return (size_t)mtu - IPV6_HEADER_SIZE - UDP_HEADER_SIZE;
+    default:
+        return 0;
+    }
+}
+
+static void handle_emsgsize(SmolRTSP_UdpTransport *self, ssize_t ret) {
+    if (-1 == ret && EMSGSIZE == errno) {
+        self->max_packet_size = path_max_packet_size(self->fd);
+        errno = EMSGSIZE;
+    }
+}
+
+static void record_batch(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch, ssize_t ret) {
+    if (-1 == ret) {
+        SMOLRTSP_PROBE(udp_transmit, self->fd, batch.len, -1, 0, errno);
+        SmolRTSP_TransportStats_record_error(&self->stats, errno);
+        return;
+    }
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < (size_t)ret; i++) {
+        bytes += SmolRTSP_IoVecSlice_len(batch.ptr[i]);
+    }
+    SMOLRTSP_PROBE(udp_transmit, self->fd, batch.len, ret, bytes, 0);
+    SmolRTSP_TransportStats_record_sent(&self->stats, (uint64_t)ret, bytes);
+}
+
+static ssize_t
+send_gso(SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch) {
+#ifdef UDP_SEGMENT
+    const size_t segments_count = gso_segments_count(batch);
+    const uint16_t segment_size = SmolRTSP_IoVecSlice_len(batch.ptr[0]);
+
+    struct iovec iovecs[GSO_MAX_IOVECS];
+    size_t iovecs_count = 0, total_bytes = 0;
+    for (size_t i = 0; i < segments_count; i++) {
+        memcpy(
+            &iovecs[iovecs_count], batch.ptr[i].ptr,
+            batch.ptr[i].len * sizeof(struct iovec));
+        iovecs_count += batch.ptr[i].len;
+        total_bytes += SmolRTSP_IoVecSlice_len(batch.ptr[i]);
+    }
+
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, '\0', sizeof control);
+
+    struct msghdr msg = {
+        .msg_name = NULL,
+        .msg_namelen = 0,
+        .msg_iov = iovecs,
+        .msg_iovlen = iovecs_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof control.buf,
+        .msg_flags = 0,
+    };
 
-        assert(-1 == ret);
-        assert(EMSGSIZE == errno);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof segment_size);
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof segment_size);
+
+    const int flags = zerocopy_flags(self, total_bytes);
+    const uint64_t sent_ns = tx_now_ns(self);
+    ssize_t ret = sendmsg(self->fd, &msg, flags);
+    if (-1 == ret && ENOBUFS == errno && flags != 0) {
+        // Out of the pinned memory limit; copy the data instead.
+        ret = sendmsg(self->fd, &msg, 0);
+    } else if (ret != -1) {
+        zerocopy_sent(self, flags, 1);
+    }
+
+    if (-1 == ret) {
+        return -1;
+    }
 
-        // Try to retransmit the packet one more time.
-        i--;
-    } while (i > 0);
+    // The kernel reports a super-buffer as a single transmission.
+    tx_sent(self, 1, sent_ns);
 
+    return segments_count;
+#else
+    (void)self;
+    (void)batch;
+
+    errno = ENOPROTOOPT;
     return -1;
+#endif
+}
+
+// Computes how many leading packets of `batch` can be sent as one GSO
+// super-buffer: all the segments must be of the same size, except the last
+// one, which can be shorter.
+static size_t gso_segments_count(SmolRTSP_IoVecBatch batch) {
+    if (SmolRTSP_IoVecBatch_is_empty(batch)) {
+        return 0;
+    }
+
+    const size_t segment_size = SmolRTSP_IoVecSlice_len(batch.ptr[0]);
+    if (0 == segment_size) {
+        return 0;
+    }
+
+    size_t count = 0, total_bytes = 0, iovecs_count = 0;
+    while (count < batch.len && count < GSO_MAX_SEGMENTS) {
+        const size_t packet_size = SmolRTSP_IoVecSlice_len(batch.ptr[count]);
+        if (packet_size > segment_size ||
+            total_bytes + packet_size > GSO_MAX_BYTES ||
+            iovecs_count + batch.ptr[count].len > GSO_MAX_IOVECS) {
+            break;
+        }
+
+        count++;
+        total_bytes += packet_size;
+        iovecs_count += batch.ptr[count - 1].len;
+
+        if (packet_size < segment_size) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+// `EINVAL` is also how the kernel rejects segments larger than the path MTU,
+// which may have just dropped (the sockets do not fragment); like `EMSGSIZE`
+// for a single datagram, it refreshes `max_packet_size`. The batch is then
+// sent again if its segments still fit, and fails with `EMSGSIZE` otherwise.
+static ssize_t
+retry_gso(SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch) {
+    errno = EMSGSIZE;
+    handle_emsgsize(self, -1);
+
+    const size_t segment_size = SmolRTSP_IoVecSlice_len(batch.ptr[0]);
+    if (self->max_packet_size > 0 && segment_size > self->max_packet_size) {
+        return -1;
+    }
+
+    return send_gso(self, batch);
+}
+
+static bool is_gso_unsupported(int error) {
+    return EIO == error || ENOPROTOOPT == error || EOPNOTSUPP == error;
+}
+
+static int zerocopy_flags(const SmolRTSP_UdpTransport *self, size_t len) {
+#ifdef MSG_ZEROCOPY
+    const size_t threshold = self->config.zerocopy_threshold;
+    return threshold > 0 && len >= threshold ? MSG_ZEROCOPY : 0;
+#else
+    (void)self;
+    (void)len;
+    return 0;
+#endif
+}
+
+static void zerocopy_sent(SmolRTSP_UdpTransport *self, int flags, size_t n) {
+    if (flags != 0) {
+        self->config.zerocopy_state->sent += n;
+    }
+}
+
+bool SmolRTSP_ZeroCopyState_is_released(
+    SmolRTSP_ZeroCopyState self, uint32_t mark) {
+    // Handle the wraparound of the counters.
+    return (int32_t)(self.completed - mark) >= 0;
+}
+
+int smolrtsp_zerocopy_reap(int fd, SmolRTSP_ZeroCopyState *state) {
+    assert(state);
+
+    int notifications_count = 0;
+
+    for (;;) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg = {
+            .msg_control = control,
+            .msg_controllen = sizeof control,
+        };
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                return notifications_count;
+            }
+            return -1;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            const bool is_recverr =
+                (SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) ||
+                (SOL_IPV6 == cmsg->cmsg_level &&
+                 IPV6_RECVERR == cmsg->cmsg_type);
+            if (!is_recverr) {
+                continue;
+            }
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof err);
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+
+            record_zerocopy(state, err);
+            notifications_count++;
+        }
+    }
+}
+
+static void
+record_zerocopy(SmolRTSP_ZeroCopyState *state, struct sock_extended_err err) {
+    // The notification covers the range [ee_info, ee_data] of transmission
+    // IDs.
+    const uint32_t range_len = err.ee_data - err.ee_info + 1;
+    if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        state->copied += range_len;
+    }
+    if ((int32_t)(err.ee_data + 1 - state->completed) > 0) {
+        state->completed = err.ee_data + 1;
+    }
+}
+
+SmolRTSP_TxTimestampsConfig SmolRTSP_TxTimestampsConfig_default(void) {
+    return (SmolRTSP_TxTimestampsConfig){
+        .capacity = SMOLRTSP_TX_TIMESTAMPS_DEFAULT_CAPACITY,
+        .software = NULL,
+        .hardware = NULL,
+    };
+}
+
+SmolRTSP_TxTimestamps *
+SmolRTSP_TxTimestamps_new(SmolRTSP_TxTimestampsConfig config) {
+    assert(config.capacity > 0);
+    assert(0 == (config.capacity & (config.capacity - 1)));
+
+    SmolRTSP_TxTimestamps *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // A zeroed slot matches no transmission but the first one, which
+    // overwrites it before the kernel can report it.
+    self->sends = smolrtsp_calloc(config.capacity, sizeof self->sends[0]);
+    if (NULL == self->sends) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->config = config;
+    self->next_id = 0;
+    self->stats = (SmolRTSP_TxTimestampsStats){0};
+
+    return self;
+}
+
+int SmolRTSP_TxTimestamps_reap(
+    SmolRTSP_TxTimestamps *self, int fd,
+    SmolRTSP_ZeroCopyState *zerocopy_state) {
+    assert(self);
+
+    int notifications_count = 0;
+
+    for (;;) {
+        char control
+            [CMSG_SPACE(sizeof(struct scm_timestamping)) +
+             CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg = {
+            .msg_control = control,
+            .msg_controllen = sizeof control,
+        };
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                return notifications_count;
+            }
+            return -1;
+        }
+
+        // A timestamp comes as `SCM_TIMESTAMPING` followed by the error
+        // carrying its transmission ID.
+        struct scm_timestamping tss;
+        bool has_tss = false;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (SOL_SOCKET == cmsg->cmsg_level &&
+                SCM_TIMESTAMPING == cmsg->cmsg_type) {
+                memcpy(&tss, CMSG_DATA(cmsg), sizeof tss);
+                has_tss = true;
+                continue;
+            }
+
+            const bool is_recverr =
+                (SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) ||
+                (SOL_IPV6 == cmsg->cmsg_level &&
+                 IPV6_RECVERR == cmsg->cmsg_type);
+            if (!is_recverr) {
+                continue;
+            }
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof err);
+            if (ENOMSG == err.ee_errno &&
+                SO_EE_ORIGIN_TIMESTAMPING == err.ee_origin && has_tss) {
+                record_tx_timestamp(self, err.ee_data, &tss);
+                notifications_count++;
+            } else if (
+                0 == err.ee_errno && SO_EE_ORIGIN_ZEROCOPY == err.ee_origin &&
+                zerocopy_state != NULL) {
+                record_zerocopy(zerocopy_state, err);
+                notifications_count++;
+            }
+        }
+    }
+}
+
+SmolRTSP_TxTimestampsStats
+SmolRTSP_TxTimestamps_stats(const SmolRTSP_TxTimestamps *self) {
+    assert(self);
+    return self->stats;
+}
+
+static void SmolRTSP_TxTimestamps_drop(VSelf) {
+    VSELF(SmolRTSP_TxTimestamps);
+    assert(self);
+
+    smolrtsp_free(self->sends);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_TxTimestamps);
+
+// Returns the send time to pass to `tx_sent`, or 0 without TX timestamping.
+static uint64_t tx_now_ns(const SmolRTSP_UdpTransport *self) {
+    if (NULL == self->config.tx_timestamps) {
+        return 0;
+    }
+
+    struct timespec ts;
+    const int ret = clock_gettime(CLOCK_REALTIME, &ts);
+    assert(0 == ret);
+    (void)ret;
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Remembers the send time of the `n` next transmissions.
+static void tx_sent(SmolRTSP_UdpTransport *self, size_t n, uint64_t sent_ns) {
+    SmolRTSP_TxTimestamps *timestamps = self->config.tx_timestamps;
+    if (NULL == timestamps) {
+        return;
+    }
+
+    const size_t mask = timestamps->config.capacity - 1;
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t id = timestamps->next_id++;
+        timestamps->sends[id & mask] = (TxSend){id, sent_ns};
+    }
+}
+
+static void record_tx_timestamp(
+    SmolRTSP_TxTimestamps *self, uint32_t id,
+    const struct scm_timestamping *tss) {
+    // A software timestamp is in `ts[0]`, a hardware one in `ts[2]`.
+    const bool is_hardware = tss->ts[2].tv_sec != 0 || tss->ts[2].tv_nsec != 0;
+    const struct timespec ts = is_hardware ? tss->ts[2] : tss->ts[0];
+
+    const TxSend send = self->sends[id & (self->config.capacity - 1)];
+    if (send.id != id) {
+        // Overwritten by a later transmission, or never ours.
+        self->stats.unmatched++;
+        return;
+    }
+
+    const uint64_t tx_ns =
+        (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+    const uint64_t delay_us =
+        tx_ns > send.sent_ns ? (tx_ns - send.sent_ns) / 1000 : 0;
+
+    SmolRTSP_LatencyHistogram *histogram;
+    if (is_hardware) {
+        self->stats.hardware++;
+        histogram = self->config.hardware;
+    } else {
+        self->stats.software++;
+        histogram = self->config.software;
+    }
+    if (histogram != NULL) {
+        SmolRTSP_LatencyHistogram_record(histogram, delay_us);
+    }
+}
+
+bool smolrtsp_udp_gso_supported(int fd) {
+#ifdef UDP_SEGMENT
+    int segment_size = 0;
+    socklen_t len = sizeof segment_size;
+
+    return getsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment_size, &len) == 0;
+#else
+    (void)fd;
+    return false;
+#endif
 }
 
 int smolrtsp_dgram_socket(int af, const void *restrict addr, uint16_t port) {
@@ -111,11 +794,16 @@ int smolrtsp_dgram_socket(int af, const void *restrict addr, uint16_t port) {
         goto fail;
     }
 
-    const int enable_pmtud = 1;
-    if (setsockopt(
-            fd, IPPROTO_IP, IP_PMTUDISC_WANT, &enable_pmtud,
-            sizeof enable_pmtud) == -1) {
-        perror("setsockopt IP_PMTUDISC_WANT");
+    const int pmtudisc = IP_PMTUDISC_DO, pmtudisc6 = IPV6_PMTUDISC_DO;
+    const int ret =
+        AF_INET == af
+            ? setsockopt(
+                  fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtudisc, sizeof pmtudisc)
+            : setsockopt(
+                  fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &pmtudisc6,
+                  sizeof pmtudisc6);
+    if (-1 == ret) {
+        perror("setsockopt IP_MTU_DISCOVER");
         goto fail;
     }
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <smolrtsp/transport.h>
+
+#include <stddef.h>
+
+#include <sys/types.h>
+
+// The UDP transport of `smolrtsp_transport_udp`, exposed to the other modules
+// of the library for static dispatch: they call it directly instead of through
+// `SmolRTSP_Transport` and place it into their own allocations.
+typedef struct SmolRTSP_UdpTransport SmolRTSP_UdpTransport;
+
+// The size of the storage of `smolrtsp_udp_transport_init`.
+size_t smolrtsp_udp_transport_size(void);
+
+// Creates the transport of `smolrtsp_transport_udp_with_config` in `storage`,
+// suitably aligned; dropping it does not free `storage`.
+SmolRTSP_Transport smolrtsp_udp_transport_init(
+    void *storage, int fd, SmolRTSP_UdpTransportConfig config);
+
+// Returns the UDP transport implementing `t`, or `NULL` if `t` is another
+// transport.
+SmolRTSP_UdpTransport *smolrtsp_udp_transport_of(SmolRTSP_Transport t);
+
+// The `transmit` and `transmit_batch` methods of the UDP transport.
+int smolrtsp_udp_transport_transmit(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecSlice bufs);
+ssize_t smolrtsp_udp_transport_transmit_batch(
+    SmolRTSP_UdpTransport *self, SmolRTSP_IoVecBatch batch);
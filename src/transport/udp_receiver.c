@@ -0,0 +1,231 @@
+#include <smolrtsp/udp_receiver.h>
+
+#include "../alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
+// The ancillary data of a datagram: the `SO_RXQ_OVFL` counter.
+#define CONTROL_SIZE CMSG_SPACE(sizeof(uint32_t))
+
+typedef union {
+    struct sockaddr addr;
+    struct sockaddr_in addr_in;
+    struct sockaddr_in6 addr_in6;
+} Source;
+
+typedef union {
+    char buf[CONTROL_SIZE];
+    struct cmsghdr align;
+} Control;
+
+struct SmolRTSP_UdpReceiver {
+    int fd;
+    size_t max_packet_size;
+
+    // The datagram number `i` occupies `data[i * max_packet_size..]`.
+    uint8_t *data;
+    size_t capacity, len;
+
+    Source *sources;
+    Control *controls;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+
+    SmolRTSP_UdpReceiverStats stats;
+};
+
+static void free_receiver(SmolRTSP_UdpReceiver *self);
+static void read_control(SmolRTSP_UdpReceiver *self, const struct msghdr *msg);
+
+int smolrtsp_recv_dgram_socket(
+    int af, const void *restrict addr, uint16_t port, size_t rcvbuf) {
+    Source local;
+    memset(&local, '\0', sizeof local);
+    socklen_t local_len;
+
+    switch (af) {
+    case AF_INET:
+        local.addr_in.sin_family = AF_INET;
+        local.addr_in.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (addr != NULL) {
+            memcpy(&local.addr_in.sin_addr, addr, sizeof(struct in_addr));
+        }
+        local.addr_in.sin_port = htons(port);
+        local_len = sizeof local.addr_in;
+        break;
+    case AF_INET6:
+        local.addr_in6.sin6_family = AF_INET6;
+        local.addr_in6.sin6_addr = in6addr_any;
+        if (addr != NULL) {
+            memcpy(&local.addr_in6.sin6_addr, addr, sizeof(struct in6_addr));
+        }
+        local.addr_in6.sin6_port = htons(port);
+        local_len = sizeof local.addr_in6;
+        break;
+    default:
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+
+    const int fd = socket(af, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const int on = 1, size = rcvbuf > INT32_MAX ? INT32_MAX : (int)rcvbuf;
+    if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof on) == -1 ||
+        (rcvbuf > 0 &&
+         setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof size) == -1) ||
+        bind(fd, &local.addr, local_len) == -1) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return fd;
+}
+
+SmolRTSP_UdpReceiver *
+SmolRTSP_UdpReceiver_new(int fd, size_t capacity, size_t max_packet_size) {
+    assert(fd >= 0);
+    assert(capacity > 0);
+    assert(max_packet_size > 0);
+
+    SmolRTSP_UdpReceiver *self = smolrtsp_calloc(1, sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->fd = fd;
+    self->max_packet_size = max_packet_size;
+    self->capacity = capacity;
+    self->len = 0;
+    self->data = smolrtsp_malloc(capacity * max_packet_size);
+    self->sources = smolrtsp_malloc(capacity * sizeof self->sources[0]);
+    self->controls = smolrtsp_malloc(capacity * sizeof self->controls[0]);
+    self->msgs = smolrtsp_malloc(capacity * sizeof self->msgs[0]);
+    self->iovecs = smolrtsp_malloc(capacity * sizeof self->iovecs[0]);
+    if (NULL == self->data || NULL == self->sources ||
+        NULL == self->controls || NULL == self->msgs || NULL == self->iovecs) {
+        free_receiver(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        self->iovecs[i] = (struct iovec){
+            .iov_base = self->data + i * max_packet_size,
+            .iov_len = max_packet_size,
+        };
+    }
+
+    return self;
+}
+
+static void SmolRTSP_UdpReceiver_drop(VSelf) {
+    VSELF(SmolRTSP_UdpReceiver);
+    assert(self);
+
+    free_receiver(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_UdpReceiver);
+
+ssize_t SmolRTSP_UdpReceiver_receive(SmolRTSP_UdpReceiver *self) {
+    assert(self);
+
+    self->len = 0;
+
+    // `recvmmsg` overwrites the lengths of the names and control buffers.
+    for (size_t i = 0; i < self->capacity; i++) {
+        self->msgs[i] = (struct mmsghdr){
+            .msg_hdr =
+                {
+                    .msg_name = &self->sources[i],
+                    .msg_namelen = sizeof self->sources[i],
+                    .msg_iov = &self->iovecs[i],
+                    .msg_iovlen = 1,
+                    .msg_control = self->controls[i].buf,
+                    .msg_controllen = sizeof self->controls[i].buf,
+                },
+        };
+    }
+
+    const int ret = recvmmsg(
+        self->fd, self->msgs, (unsigned)self->capacity, MSG_WAITFORONE, NULL);
+    if (-1 == ret) {
+        return -1;
+    }
+
+    self->len = (size_t)ret;
+    self->stats.datagrams += self->len;
+    for (size_t i = 0; i < self->len; i++) {
+        const struct msghdr *msg = &self->msgs[i].msg_hdr;
+        if (msg->msg_flags & MSG_TRUNC) {
+            self->stats.truncated++;
+        }
+        read_control(self, msg);
+    }
+
+    return ret;
+}
+
+SmolRTSP_UdpDatagram
+SmolRTSP_UdpReceiver_datagram(SmolRTSP_UdpReceiver *self, size_t i) {
+    assert(self);
+    assert(i < self->len);
+
+    const struct mmsghdr *msg = &self->msgs[i];
+    const size_t len = msg->msg_len < self->max_packet_size
+                           ? msg->msg_len
+                           : self->max_packet_size;
+
+    return (SmolRTSP_UdpDatagram){
+        .data = U8Slice99_new(self->data + i * self->max_packet_size, len),
+        .addr = &self->sources[i].addr,
+        .addr_len = msg->msg_hdr.msg_namelen,
+        .truncated = msg->msg_hdr.msg_flags & MSG_TRUNC,
+    };
+}
+
+SmolRTSP_UdpReceiverStats
+SmolRTSP_UdpReceiver_stats(const SmolRTSP_UdpReceiver *self) {
+    assert(self);
+    return self->stats;
+}
+
+static void free_receiver(SmolRTSP_UdpReceiver *self) {
+    smolrtsp_free(self->data);
+    smolrtsp_free(self->sources);
+    smolrtsp_free(self->controls);
+    smolrtsp_free(self->msgs);
+    smolrtsp_free(self->iovecs);
+    smolrtsp_free(self);
+}
+
+static void
+read_control(SmolRTSP_UdpReceiver *self, const struct msghdr *msg) {
+    for (const struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr *)msg, (struct cmsghdr *)cmsg)) {
+        if (SOL_SOCKET == cmsg->cmsg_level &&
+            SO_RXQ_OVFL == cmsg->cmsg_type) {
+            // The counter of the socket, which only grows (modulo 2^32).
+            uint32_t dropped;
+            memcpy(&dropped, CMSG_DATA(cmsg), sizeof dropped);
+            self->stats.dropped = dropped;
+        }
+    }
+}
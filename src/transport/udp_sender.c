@@ -0,0 +1,304 @@
+#include <smolrtsp/udp_sender.h>
+
+#include "../alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef union {
+    struct sockaddr addr;
+    struct sockaddr_in addr_in;
+    struct sockaddr_in6 addr_in6;
+} Destination;
+
+typedef struct {
+    Destination dest;
+    socklen_t dest_len;
+    size_t len;
+} Datagram;
+
+struct SmolRTSP_UdpSender {
+    int fd;
+    size_t max_packet_size;
+
+    // The datagram number `i` occupies `data[i * max_packet_size..]`.
+    Datagram *queue;
+    char *data;
+    size_t capacity, len;
+
+    // Rebuilt from `queue` on every flush.
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+
+    size_t errors;
+};
+
+typedef struct {
+    SmolRTSP_UdpSender *sender;
+    Destination dest;
+    socklen_t dest_len;
+} SmolRTSP_UdpSenderTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_UdpSenderTransport);
+
+static void discard_sent(SmolRTSP_UdpSender *self, size_t n);
+static bool is_congested(int error);
+
+int smolrtsp_shared_dgram_socket(int af) {
+    if (af != AF_INET && af != AF_INET6) {
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+
+    const int fd = socket(af, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const int pmtudisc = IP_PMTUDISC_DO, pmtudisc6 = IPV6_PMTUDISC_DO;
+    const int ret =
+        AF_INET == af
+            ? setsockopt(
+                  fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtudisc, sizeof pmtudisc)
+            : setsockopt(
+                  fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &pmtudisc6,
+                  sizeof pmtudisc6);
+    if (-1 == ret) {
+        const int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return fd;
+}
+
+SmolRTSP_UdpSender *
+SmolRTSP_UdpSender_new(int fd, size_t capacity, size_t max_packet_size) {
+    assert(fd >= 0);
+    assert(capacity > 0);
+    assert(max_packet_size > 0);
+
+    SmolRTSP_UdpSender *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->fd = fd;
+    self->max_packet_size = max_packet_size;
+    self->queue = smolrtsp_malloc(capacity * sizeof self->queue[0]);
+    self->data = smolrtsp_malloc(capacity * max_packet_size);
+    self->capacity = capacity;
+    self->len = 0;
+    self->msgs = smolrtsp_malloc(capacity * sizeof self->msgs[0]);
+    self->iovecs = smolrtsp_malloc(capacity * sizeof self->iovecs[0]);
+    self->errors = 0;
+
+    if (NULL == self->queue || NULL == self->data || NULL == self->msgs ||
+        NULL == self->iovecs) {
+        VTABLE(SmolRTSP_UdpSender, SmolRTSP_Droppable).drop(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return self;
+}
+
+ssize_t SmolRTSP_UdpSender_flush(SmolRTSP_UdpSender *self) {
+    assert(self);
+
+    for (size_t i = 0; i < self->len; i++) {
+        self->iovecs[i] = (struct iovec){
+            .iov_base = self->data + i * self->max_packet_size,
+            .iov_len = self->queue[i].len,
+        };
+        self->msgs[i] = (struct mmsghdr){
+            .msg_hdr =
+                {
+                    .msg_name = &self->queue[i].dest,
+                    .msg_namelen = self->queue[i].dest_len,
+                    .msg_iov = &self->iovecs[i],
+                    .msg_iovlen = 1,
+                },
+        };
+    }
+
+    size_t sent = 0, done = 0;
+    while (done < self->len) {
+        const int ret =
+            sendmmsg(self->fd, &self->msgs[done], self->len - done, 0);
+        if (ret != -1) {
+            sent += ret;
+            done += ret;
+            continue;
+        }
+
+        if (is_congested(errno)) {
+            const int saved_errno = errno;
+            discard_sent(self, done);
+            errno = saved_errno;
+            return sent > 0 ? (ssize_t)sent : -1;
+        }
+
+        // `sendmmsg` stops at the first rejected datagram; skip it.
+        self->errors++;
+        done++;
+    }
+
+    self->len = 0;
+
+    return sent;
+}
+
+size_t SmolRTSP_UdpSender_pending(const SmolRTSP_UdpSender *self) {
+    assert(self);
+    return self->len;
+}
+
+size_t SmolRTSP_UdpSender_errors(const SmolRTSP_UdpSender *self) {
+    assert(self);
+    return self->errors;
+}
+
+static void SmolRTSP_UdpSender_drop(VSelf) {
+    VSELF(SmolRTSP_UdpSender);
+    assert(self);
+
+    smolrtsp_free(self->queue);
+    smolrtsp_free(self->data);
+    smolrtsp_free(self->msgs);
+    smolrtsp_free(self->iovecs);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_UdpSender);
+
+SmolRTSP_Transport smolrtsp_transport_udp_sender(
+    SmolRTSP_UdpSender *sender, const struct sockaddr *addr) {
+    assert(sender);
+    assert(addr);
+    assert(AF_INET == addr->sa_family || AF_INET6 == addr->sa_family);
+
+    SmolRTSP_UdpSenderTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->sender = sender;
+    memset(&self->dest, '\0', sizeof self->dest);
+    self->dest_len = AF_INET == addr->sa_family ? sizeof(struct sockaddr_in)
+                                                : sizeof(struct sockaddr_in6);
+    memcpy(&self->dest, addr, self->dest_len);
+
+    return DYN(SmolRTSP_UdpSenderTransport, SmolRTSP_Transport, self);
+}
+
+static void SmolRTSP_UdpSenderTransport_drop(VSelf) {
+    VSELF(SmolRTSP_UdpSenderTransport);
+    assert(self);
+
+    // The queued datagrams carry their own copy of the destination.
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_UdpSenderTransport);
+
+static int
+SmolRTSP_UdpSenderTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_UdpSenderTransport);
+    assert(self);
+
+    SmolRTSP_UdpSender *sender = self->sender;
+
+    const size_t total = SmolRTSP_IoVecSlice_len(bufs);
+    if (total > sender->max_packet_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (sender->len == sender->capacity &&
+        SmolRTSP_UdpSender_flush(sender) == -1) {
+        return -1;
+    }
+
+    Datagram *dgram = &sender->queue[sender->len];
+    dgram->dest = self->dest;
+    dgram->dest_len = self->dest_len;
+    dgram->len = total;
+
+    char *data = sender->data + sender->len * sender->max_packet_size;
+    for (size_t i = 0; i < bufs.len; i++) {
+        memcpy(data, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+        data += bufs.ptr[i].iov_len;
+    }
+
+    sender->len++;
+
+    return 0;
+}
+
+#define SmolRTSP_UdpSenderTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_UdpSenderTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_UdpSenderTransport);
+    assert(self);
+
+    // Queueing takes no system call, so there is nothing to gather.
+    size_t transmitted = 0;
+    while (transmitted < batch.len) {
+        if (SmolRTSP_UdpSenderTransport_transmit(
+                self, batch.ptr[transmitted]) == -1) {
+            break;
+        }
+        transmitted++;
+    }
+
+    return 0 == transmitted && batch.len > 0 ? -1 : (ssize_t)transmitted;
+}
+
+static bool SmolRTSP_UdpSenderTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_UdpSenderTransport);
+    assert(self);
+
+    SmolRTSP_UdpSender *sender = self->sender;
+
+    return sender->len == sender->capacity &&
+           SmolRTSP_UdpSender_flush(sender) == -1;
+}
+
+#define SmolRTSP_UdpSenderTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_UdpSenderTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_UdpSenderTransport);
+    assert(self);
+
+    return self->sender->max_packet_size;
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_UdpSenderTransport);
+
+// Removes the first `n` datagrams from the queue.
+static void discard_sent(SmolRTSP_UdpSender *self, size_t n) {
+    if (0 == n) {
+        return;
+    }
+
+    const size_t remaining = self->len - n;
+    memmove(self->queue, &self->queue[n], remaining * sizeof self->queue[0]);
+    memmove(
+        self->data, self->data + n * self->max_packet_size,
+        remaining * self->max_packet_size);
+    self->len = remaining;
+}
+
+static bool is_congested(int error) {
+    return EAGAIN == error || EWOULDBLOCK == error || ENOBUFS == error ||
+           EINTR == error;
+}
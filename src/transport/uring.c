@@ -0,0 +1,111 @@
+#include <smolrtsp/uring.h>
+
+#include "../alloc.h"
+#include "../uring.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    SmolRTSP_Uring *ring;
+    int fd;
+} SmolRTSP_UringTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_UringTransport);
+
+SmolRTSP_Transport smolrtsp_transport_uring(SmolRTSP_Uring *ring, int fd) {
+    assert(ring);
+    assert(fd >= 0);
+
+    SmolRTSP_UringTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->ring = ring;
+    self->fd = fd;
+
+    return DYN(SmolRTSP_UringTransport, SmolRTSP_Transport, self);
+}
+
+static void SmolRTSP_UringTransport_drop(VSelf) {
+    VSELF(SmolRTSP_UringTransport);
+    assert(self);
+
+    // The queued packets own their buffers and are still sent.
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_UringTransport);
+
+static int SmolRTSP_UringTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_UringTransport);
+    assert(self);
+
+    const size_t total = SmolRTSP_IoVecSlice_len(bufs);
+    if (total > smolrtsp_uring_buffer_size(self->ring)) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    SmolRTSP_UringBuffer *buf = smolrtsp_uring_acquire(self->ring);
+    if (NULL == buf) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        memcpy(buf->data + buf->len, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+        buf->len += bufs.ptr[i].iov_len;
+    }
+
+    if (0 == total) {
+        smolrtsp_uring_release(self->ring, buf);
+        return 0;
+    }
+
+    if (smolrtsp_uring_queue_write(self->ring, self->fd, buf) == -1) {
+        smolrtsp_uring_release(self->ring, buf);
+        return -1;
+    }
+
+    return 0;
+}
+
+#define SmolRTSP_UringTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_UringTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_UringTransport);
+    assert(self);
+
+    // Queueing takes no system call, so there is nothing to gather.
+    size_t transmitted = 0;
+    while (transmitted < batch.len) {
+        if (SmolRTSP_UringTransport_transmit(self, batch.ptr[transmitted]) ==
+            -1) {
+            break;
+        }
+        transmitted++;
+    }
+
+    return 0 == transmitted && batch.len > 0 ? -1 : (ssize_t)transmitted;
+}
+
+static bool SmolRTSP_UringTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_UringTransport);
+    assert(self);
+
+    return smolrtsp_uring_is_full(self->ring);
+}
+
+#define SmolRTSP_UringTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_UringTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_UringTransport);
+    assert(self);
+
+    return smolrtsp_uring_buffer_size(self->ring);
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_UringTransport);
@@ -0,0 +1,255 @@
+#include <smolrtsp/xdp.h>
+
+#include "../alloc.h"
+#include "../xdp.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define DEFAULT_TTL    64
+
+// The offsets of the header fields that depend on the payload size.
+#define IPV4_TOTAL_LENGTH_OFFSET 16
+#define IPV4_CHECKSUM_OFFSET     24
+#define UDP_LENGTH_OFFSET        38
+
+#define IPV4_UDP_HEADERS_SIZE 28
+
+typedef struct {
+    SmolRTSP_Xdp *xdp;
+
+    // The headers of an empty payload, patched per packet by `patch_lengths`.
+    uint8_t headers[SMOLRTSP_XDP_HEADERS_SIZE];
+
+    SmolRTSP_TransportStats stats;
+} SmolRTSP_XdpTransport;
+
+declImpl(SmolRTSP_Transport, SmolRTSP_XdpTransport);
+
+static void write_template(
+    const SmolRTSP_XdpFlow *flow, uint8_t frame[restrict]);
+static void patch_lengths(uint8_t frame[restrict], size_t payload_len);
+static void put_u16(uint8_t *p, uint16_t value);
+
+void smolrtsp_xdp_write_headers(
+    const SmolRTSP_XdpFlow *flow, size_t payload_len, uint8_t *restrict frame) {
+    assert(flow);
+    assert(frame);
+    assert(payload_len <= 65507);
+
+    write_template(flow, frame);
+    patch_lengths(frame, payload_len);
+}
+
+SmolRTSP_Transport
+smolrtsp_transport_xdp(SmolRTSP_Xdp *xdp, SmolRTSP_XdpFlow flow) {
+    assert(xdp);
+
+    SmolRTSP_XdpTransport *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return (SmolRTSP_Transport){0};
+    }
+
+    self->xdp = xdp;
+    write_template(&flow, self->headers);
+    self->stats = (SmolRTSP_TransportStats){0};
+
+    return DYN(SmolRTSP_XdpTransport, SmolRTSP_Transport, self);
+}
+
+SmolRTSP_Transport smolrtsp_transport_xdp_or_udp(
+    SmolRTSP_Xdp *xdp, const uint8_t next_hop_mac[6], int fd) {
+    assert(fd >= 0);
+    assert(NULL == xdp || next_hop_mac);
+
+    if (NULL == xdp) {
+        return smolrtsp_transport_udp(fd);
+    }
+
+    struct sockaddr_in local, peer;
+    socklen_t local_len = sizeof local, peer_len = sizeof peer;
+    if (getsockname(fd, (struct sockaddr *)&local, &local_len) == -1 ||
+        getpeername(fd, (struct sockaddr *)&peer, &peer_len) == -1 ||
+        local.sin_family != AF_INET || peer.sin_family != AF_INET) {
+        return smolrtsp_transport_udp(fd);
+    }
+
+    SmolRTSP_XdpFlow flow = {
+        .src_addr = local.sin_addr,
+        .dst_addr = peer.sin_addr,
+        .src_port = ntohs(local.sin_port),
+        .dst_port = ntohs(peer.sin_port),
+        .ttl = 0,
+        .dscp = 0,
+    };
+    memcpy(flow.src_mac, smolrtsp_xdp_mac(xdp), sizeof flow.src_mac);
+    memcpy(flow.dst_mac, next_hop_mac, sizeof flow.dst_mac);
+
+    // Keep the QoS marking configured on the socket.
+    int tos = 0;
+    socklen_t tos_len = sizeof tos;
+    if (getsockopt(fd, IPPROTO_IP, IP_TOS, &tos, &tos_len) == 0) {
+        flow.dscp = (uint8_t)((unsigned)tos >> 2);
+    }
+
+    return smolrtsp_transport_xdp(xdp, flow);
+}
+
+static void SmolRTSP_XdpTransport_drop(VSelf) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    // The queued frames belong to the UMEM and are still sent.
+    smolrtsp_free(self);
+}
+
+impl(SmolRTSP_Droppable, SmolRTSP_XdpTransport);
+
+static int SmolRTSP_XdpTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    const size_t total = SmolRTSP_IoVecSlice_len(bufs);
+    if (total > smolrtsp_xdp_max_payload_size(self->xdp)) {
+        SmolRTSP_TransportStats_record_error(&self->stats, EMSGSIZE);
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    uint8_t *frame = smolrtsp_xdp_acquire(self->xdp);
+    if (NULL == frame) {
+        SmolRTSP_TransportStats_record_error(&self->stats, errno);
+        return -1;
+    }
+
+    memcpy(frame, self->headers, sizeof self->headers);
+    patch_lengths(frame, total);
+
+    uint8_t *payload = frame + SMOLRTSP_XDP_HEADERS_SIZE;
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            memcpy(payload, bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+            payload += bufs.ptr[i].iov_len;
+        }
+    }
+
+    smolrtsp_xdp_queue(
+        self->xdp, (uint32_t)(SMOLRTSP_XDP_HEADERS_SIZE + total));
+    SmolRTSP_TransportStats_record_sent(&self->stats, 1, total);
+
+    return 0;
+}
+
+#define SmolRTSP_XdpTransport_transmit_batch_CUSTOM ()
+static ssize_t
+SmolRTSP_XdpTransport_transmit_batch(VSelf, SmolRTSP_IoVecBatch batch) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    // Queueing takes no system call, so there is nothing to gather.
+    size_t transmitted = 0;
+    while (transmitted < batch.len) {
+        if (SmolRTSP_XdpTransport_transmit(self, batch.ptr[transmitted]) ==
+            -1) {
+            break;
+        }
+        transmitted++;
+    }
+
+    return 0 == transmitted && batch.len > 0 ? -1 : (ssize_t)transmitted;
+}
+
+static bool SmolRTSP_XdpTransport_is_full(VSelf) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    const bool full = smolrtsp_xdp_is_full(self->xdp);
+    if (full) {
+        SmolRTSP_TransportStats_record_full(&self->stats);
+    }
+
+    return full;
+}
+
+#define SmolRTSP_XdpTransport_max_packet_size_CUSTOM ()
+static size_t SmolRTSP_XdpTransport_max_packet_size(VSelf) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    return smolrtsp_xdp_max_payload_size(self->xdp);
+}
+
+#define SmolRTSP_XdpTransport_stats_CUSTOM ()
+static SmolRTSP_TransportStats SmolRTSP_XdpTransport_stats(VSelf) {
+    VSELF(SmolRTSP_XdpTransport);
+    assert(self);
+
+    return SmolRTSP_TransportStats_load(&self->stats);
+}
+
+impl(SmolRTSP_Transport, SmolRTSP_XdpTransport);
+
+// Writes the headers of an empty payload, with a valid IPv4 checksum.
+static void write_template(
+    const SmolRTSP_XdpFlow *flow, uint8_t frame[restrict]) {
+    memcpy(frame, flow->dst_mac, 6);
+    memcpy(frame + 6, flow->src_mac, 6);
+    put_u16(frame + 12, ETHERTYPE_IPV4);
+
+    uint8_t *ip = frame + 14;
+    ip[0] = 0x45; // Version 4, 5 words of header.
+    ip[1] = (uint8_t)(flow->dscp << 2);
+    put_u16(ip + 2, IPV4_UDP_HEADERS_SIZE);
+    put_u16(ip + 4, 0);      // Identification.
+    put_u16(ip + 6, 0x4000); // Don't fragment.
+    ip[8] = flow->ttl > 0 ? flow->ttl : DEFAULT_TTL;
+    ip[9] = IPPROTO_UDP;
+    put_u16(ip + 10, 0);
+    memcpy(ip + 12, &flow->src_addr, 4);
+    memcpy(ip + 16, &flow->dst_addr, 4);
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < 20; i += 2) {
+        sum += (uint32_t)(ip[i] << 8 | ip[i + 1]);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    put_u16(ip + 10, (uint16_t)~sum);
+
+    uint8_t *udp = ip + 20;
+    put_u16(udp, flow->src_port);
+    put_u16(udp + 2, flow->dst_port);
+    put_u16(udp + 4, 8);
+    put_u16(udp + 6, 0); // No checksum.
+}
+
+// Turns the headers of an empty payload into the ones of `payload_len` bytes,
+// updating the IPv4 checksum incrementally (RFC 1624).
+static void patch_lengths(uint8_t frame[restrict], size_t payload_len) {
+    const uint16_t total_len = (uint16_t)(IPV4_UDP_HEADERS_SIZE + payload_len);
+
+    const uint16_t checksum = (uint16_t)(
+        frame[IPV4_CHECKSUM_OFFSET] << 8 | frame[IPV4_CHECKSUM_OFFSET + 1]);
+    uint32_t sum = (uint32_t)(uint16_t)~checksum +
+                   (uint32_t)(uint16_t)~IPV4_UDP_HEADERS_SIZE + total_len;
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    put_u16(frame + IPV4_TOTAL_LENGTH_OFFSET, total_len);
+    put_u16(frame + IPV4_CHECKSUM_OFFSET, (uint16_t)~sum);
+    put_u16(frame + UDP_LENGTH_OFFSET, (uint16_t)(8 + payload_len));
+}
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
@@ -1,5 +1,6 @@
 #include <smolrtsp/types/header.h>
 
+#include "../macros.h"
 #include "parsing.h"
 #include <smolrtsp/util.h>
 
@@ -20,6 +21,20 @@ ssize_t SmolRTSP_Header_serialize(
            });
 }
 
+ssize_t smolrtsp_serialize_uint_header(
+    CharSlice99 key, uint64_t value, SmolRTSP_Writer w) {
+    assert(w.self && w.vptr);
+
+    ssize_t result = 0;
+
+    CHK_WRITE_ERR(
+        result, SMOLRTSP_WRITE_SLICES(w, {key, CharSlice99_from_str(": ")}));
+    CHK_WRITE_ERR(result, smolrtsp_write_uint(w, value));
+    CHK_WRITE_ERR(result, VCALL(w, write, SMOLRTSP_CRLF));
+
+    return result;
+}
+
 SmolRTSP_ParseResult
 SmolRTSP_Header_parse(SmolRTSP_Header *restrict self, CharSlice99 input) {
     assert(self);
@@ -55,3 +70,127 @@ bool SmolRTSP_Header_eq(
     return CharSlice99_primitive_eq(lhs->key, rhs->key) &&
            CharSlice99_primitive_eq(lhs->value, rhs->value);
 }
+
+static const char *const key_names[SMOLRTSP_HEADER_ID_COUNT] = {
+    [SmolRTSP_HeaderId_Accept] = "Accept",
+    [SmolRTSP_HeaderId_AcceptEncoding] = "Accept-Encoding",
+    [SmolRTSP_HeaderId_AcceptLanguage] = "Accept-Language",
+    [SmolRTSP_HeaderId_Allow] = "Allow",
+    [SmolRTSP_HeaderId_Authorization] = "Authorization",
+    [SmolRTSP_HeaderId_Bandwidth] = "Bandwidth",
+    [SmolRTSP_HeaderId_Blocksize] = "Blocksize",
+    [SmolRTSP_HeaderId_CacheControl] = "Cache-Control",
+    [SmolRTSP_HeaderId_Conference] = "Conference",
+    [SmolRTSP_HeaderId_Connection] = "Connection",
+    [SmolRTSP_HeaderId_ContentBase] = "Content-Base",
+    [SmolRTSP_HeaderId_ContentEncoding] = "Content-Encoding",
+    [SmolRTSP_HeaderId_ContentLanguage] = "Content-Language",
+    [SmolRTSP_HeaderId_ContentLength] = "Content-Length",
+    [SmolRTSP_HeaderId_ContentLocation] = "Content-Location",
+    [SmolRTSP_HeaderId_ContentType] = "Content-Type",
+    [SmolRTSP_HeaderId_CSeq] = "CSeq",
+    [SmolRTSP_HeaderId_Date] = "Date",
+    [SmolRTSP_HeaderId_Expires] = "Expires",
+    [SmolRTSP_HeaderId_From] = "From",
+    [SmolRTSP_HeaderId_IfModifiedSince] = "If-Modified-Since",
+    [SmolRTSP_HeaderId_LastModified] = "Last-Modified",
+    [SmolRTSP_HeaderId_ProxyAuthenticate] = "Proxy-Authenticate",
+    [SmolRTSP_HeaderId_ProxyRequire] = "Proxy-Require",
+    [SmolRTSP_HeaderId_Public] = "Public",
+    [SmolRTSP_HeaderId_Range] = "Range",
+    [SmolRTSP_HeaderId_Referer] = "Referrer",
+    [SmolRTSP_HeaderId_Require] = "Require",
+    [SmolRTSP_HeaderId_RetryAfter] = "Retry-After",
+    [SmolRTSP_HeaderId_RtpInfo] = "RTP-Info",
+    [SmolRTSP_HeaderId_Scale] = "Scale",
+    [SmolRTSP_HeaderId_Session] = "Session",
+    [SmolRTSP_HeaderId_Server] = "Server",
+    [SmolRTSP_HeaderId_Speed] = "Speed",
+    [SmolRTSP_HeaderId_Transport] = "Transport",
+    [SmolRTSP_HeaderId_Unsupported] = "Unsupported",
+    [SmolRTSP_HeaderId_UserAgent] = "User-Agent",
+    [SmolRTSP_HeaderId_Via] = "Via",
+    [SmolRTSP_HeaderId_WwwAuthenticate] = "WWW-Authenticate",
+};
+
+static SmolRTSP_HeaderId match_candidates(
+    CharSlice99 key, const SmolRTSP_HeaderId *candidates, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        const CharSlice99 name =
+            CharSlice99_from_str((char *)key_names[candidates[i]]);
+        if (smolrtsp_eq_ignore_case(key, name)) {
+            return candidates[i];
+        }
+    }
+
+    return SmolRTSP_HeaderId_Unknown;
+}
+
+SmolRTSP_HeaderId SmolRTSP_HeaderId_from_key(CharSlice99 key) {
+#define CANDIDATES(...)                                                        \
+    return match_candidates(                                                   \
+        key, (const SmolRTSP_HeaderId[]){__VA_ARGS__},                         \
+        SLICE99_ARRAY_LEN(((const SmolRTSP_HeaderId[]){__VA_ARGS__})))
+
+    // Well-known keys of the same length differ mostly in the first letter, so
+    // a mismatching candidate is rejected at once.
+    switch (key.len) {
+    case 3:
+        CANDIDATES(SmolRTSP_HeaderId_Via);
+    case 4:
+        CANDIDATES(
+            SmolRTSP_HeaderId_CSeq, SmolRTSP_HeaderId_Date,
+            SmolRTSP_HeaderId_From);
+    case 5:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Allow, SmolRTSP_HeaderId_Range,
+            SmolRTSP_HeaderId_Scale, SmolRTSP_HeaderId_Speed);
+    case 6:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Accept, SmolRTSP_HeaderId_Public,
+            SmolRTSP_HeaderId_Server);
+    case 7:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Expires, SmolRTSP_HeaderId_Require,
+            SmolRTSP_HeaderId_Session);
+    case 8:
+        CANDIDATES(SmolRTSP_HeaderId_Referer, SmolRTSP_HeaderId_RtpInfo);
+    case 9:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Bandwidth, SmolRTSP_HeaderId_Blocksize,
+            SmolRTSP_HeaderId_Transport);
+    case 10:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Conference, SmolRTSP_HeaderId_Connection,
+            SmolRTSP_HeaderId_UserAgent);
+    case 11:
+        CANDIDATES(SmolRTSP_HeaderId_RetryAfter, SmolRTSP_HeaderId_Unsupported);
+    case 12:
+        CANDIDATES(
+            SmolRTSP_HeaderId_ContentBase, SmolRTSP_HeaderId_ContentType);
+    case 13:
+        CANDIDATES(
+            SmolRTSP_HeaderId_Authorization, SmolRTSP_HeaderId_CacheControl,
+            SmolRTSP_HeaderId_LastModified, SmolRTSP_HeaderId_ProxyRequire);
+    case 14:
+        CANDIDATES(SmolRTSP_HeaderId_ContentLength);
+    case 15:
+        CANDIDATES(
+            SmolRTSP_HeaderId_AcceptEncoding,
+            SmolRTSP_HeaderId_AcceptLanguage);
+    case 16:
+        CANDIDATES(
+            SmolRTSP_HeaderId_ContentEncoding,
+            SmolRTSP_HeaderId_ContentLanguage,
+            SmolRTSP_HeaderId_ContentLocation,
+            SmolRTSP_HeaderId_WwwAuthenticate);
+    case 17:
+        CANDIDATES(SmolRTSP_HeaderId_IfModifiedSince);
+    case 18:
+        CANDIDATES(SmolRTSP_HeaderId_ProxyAuthenticate);
+    default:
+        return SmolRTSP_HeaderId_Unknown;
+    }
+
+#undef CANDIDATES
+}
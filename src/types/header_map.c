@@ -9,28 +9,65 @@
 
 #include <alloca.h>
 
+static bool find_linear(
+    const SmolRTSP_HeaderMap *restrict self, CharSlice99 key,
+    CharSlice99 *restrict value);
+
 SmolRTSP_HeaderMap SmolRTSP_HeaderMap_empty(void) {
     SmolRTSP_HeaderMap self;
-    memset(self.headers, '\0', sizeof self.headers);
-    self.len = 0;
+    SmolRTSP_HeaderMap_clear(&self);
     return self;
 }
 
+void SmolRTSP_HeaderMap_clear(SmolRTSP_HeaderMap *self) {
+    assert(self);
+
+    self->len = 0;
+    memset(self->index, 0, sizeof self->index);
+    self->indexed = true;
+}
+
 bool SmolRTSP_HeaderMap_find(
     const SmolRTSP_HeaderMap *restrict self, CharSlice99 key,
     CharSlice99 *restrict value) {
     assert(self);
 
-    for (size_t i = 0; i < self->len; i++) {
-        if (CharSlice99_primitive_eq(self->headers[i].key, key)) {
-            if (value != NULL) {
-                *value = self->headers[i].value;
+    const SmolRTSP_HeaderId id = SmolRTSP_HeaderId_from_key(key);
+    if (SmolRTSP_HeaderId_Unknown == id || !self->indexed) {
+        return find_linear(self, key, value);
+    }
+
+    return SmolRTSP_HeaderMap_find_id(self, id, value);
+}
+
+bool SmolRTSP_HeaderMap_find_id(
+    const SmolRTSP_HeaderMap *restrict self, SmolRTSP_HeaderId id,
+    CharSlice99 *restrict value) {
+    assert(self);
+    assert(id != SmolRTSP_HeaderId_Unknown && id < SMOLRTSP_HEADER_ID_COUNT);
+
+    if (!self->indexed) {
+        for (size_t i = 0; i < self->len; i++) {
+            if (SmolRTSP_HeaderId_from_key(self->headers[i].key) == id) {
+                if (value != NULL) {
+                    *value = self->headers[i].value;
+                }
+                return true;
             }
-            return true;
         }
+
+        return false;
     }
 
-    return false;
+    const uint8_t pos = self->index[id];
+    if (0 == pos) {
+        return false;
+    }
+
+    if (value != NULL) {
+        *value = self->headers[pos - 1].value;
+    }
+    return true;
 }
 
 bool SmolRTSP_HeaderMap_contains_key(
@@ -44,6 +81,13 @@ void SmolRTSP_HeaderMap_append(
     assert(self);
     assert(!SmolRTSP_HeaderMap_is_full(self));
 
+    if (self->indexed) {
+        const SmolRTSP_HeaderId id = SmolRTSP_HeaderId_from_key(h.key);
+        if (id != SmolRTSP_HeaderId_Unknown && 0 == self->index[id]) {
+            self->index[id] = (uint8_t)(self->len + 1);
+        }
+    }
+
     self->headers[self->len] = h;
     self->len++;
 }
@@ -70,7 +114,7 @@ SmolRTSP_HeaderMap_parse(SmolRTSP_HeaderMap *restrict self, CharSlice99 input) {
 
     const CharSlice99 backup = input;
 
-    self->len = 0;
+    SmolRTSP_HeaderMap_clear(self);
 
     while (true) {
         if (CharSlice99_primitive_ends_with(
@@ -137,3 +181,18 @@ int smolrtsp_scanf_header(
 
     return ret;
 }
+
+static bool find_linear(
+    const SmolRTSP_HeaderMap *restrict self, CharSlice99 key,
+    CharSlice99 *restrict value) {
+    for (size_t i = 0; i < self->len; i++) {
+        if (smolrtsp_eq_ignore_case(self->headers[i].key, key)) {
+            if (value != NULL) {
+                *value = self->headers[i].value;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
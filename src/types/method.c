@@ -3,6 +3,7 @@
 #include "parsing.h"
 
 #include <assert.h>
+#include <string.h>
 
 SmolRTSP_ParseResult
 SmolRTSP_Method_parse(SmolRTSP_Method *restrict self, CharSlice99 input) {
@@ -27,3 +28,63 @@ bool SmolRTSP_Method_eq(
 
     return CharSlice99_primitive_eq(*lhs, *rhs);
 }
+
+static const char *const method_names[] = {
+    [SmolRTSP_MethodId_Options] = "OPTIONS",
+    [SmolRTSP_MethodId_Describe] = "DESCRIBE",
+    [SmolRTSP_MethodId_Announce] = "ANNOUNCE",
+    [SmolRTSP_MethodId_Setup] = "SETUP",
+    [SmolRTSP_MethodId_Play] = "PLAY",
+    [SmolRTSP_MethodId_Pause] = "PAUSE",
+    [SmolRTSP_MethodId_Teardown] = "TEARDOWN",
+    [SmolRTSP_MethodId_GetParameter] = "GET_PARAMETER",
+    [SmolRTSP_MethodId_SetParameter] = "SET_PARAMETER",
+    [SmolRTSP_MethodId_Redirect] = "REDIRECT",
+    [SmolRTSP_MethodId_Record] = "RECORD",
+};
+
+SmolRTSP_MethodId SmolRTSP_MethodId_from_method(SmolRTSP_Method self) {
+    SmolRTSP_MethodId id = SmolRTSP_MethodId_Unknown;
+
+    switch (self.len) {
+    case 4:
+        id = SmolRTSP_MethodId_Play;
+        break;
+    case 5:
+        id = 'S' == self.ptr[0] ? SmolRTSP_MethodId_Setup
+                                : SmolRTSP_MethodId_Pause;
+        break;
+    case 6:
+        id = SmolRTSP_MethodId_Record;
+        break;
+    case 7:
+        id = SmolRTSP_MethodId_Options;
+        break;
+    case 8:
+        switch (self.ptr[0]) {
+        case 'D':
+            id = SmolRTSP_MethodId_Describe;
+            break;
+        case 'A':
+            id = SmolRTSP_MethodId_Announce;
+            break;
+        case 'T':
+            id = SmolRTSP_MethodId_Teardown;
+            break;
+        default:
+            id = SmolRTSP_MethodId_Redirect;
+            break;
+        }
+        break;
+    case 13:
+        id = 'G' == self.ptr[0] ? SmolRTSP_MethodId_GetParameter
+                                : SmolRTSP_MethodId_SetParameter;
+        break;
+    default:
+        return SmolRTSP_MethodId_Unknown;
+    }
+
+    return memcmp(self.ptr, method_names[id], self.len) == 0
+               ? id
+               : SmolRTSP_MethodId_Unknown;
+}
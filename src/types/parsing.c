@@ -1,7 +1,6 @@
 #include "parsing.h"
 
 #include <assert.h>
-#include <ctype.h>
 #include <string.h>
 
 SmolRTSP_ParseResult smolrtsp_match_until(
@@ -22,34 +21,77 @@ SmolRTSP_ParseResult smolrtsp_match_until(
     return SmolRTSP_ParseResult_partial();
 }
 
-static bool whitespace_matcher(char c, void *ctx) {
-    (void)ctx;
-    return c == ' ';
-}
-
-static bool non_whitespace_matcher(char c, void *ctx) {
-    (void)ctx;
-    return !whitespace_matcher(c, NULL);
-}
+// The character classes of the tokens, locale-independent. Bytes outside of
+// ASCII belong to no class.
+enum {
+    CHAR_CLASS_SPACE = 1 << 0,
+    CHAR_CLASS_DIGIT = 1 << 1,
+    CHAR_CLASS_IDENT = 1 << 2,
+    CHAR_CLASS_HEADER_NAME = 1 << 3,
+};
+
+#define SPACE       CHAR_CLASS_SPACE
+#define DIGIT       (CHAR_CLASS_DIGIT | CHAR_CLASS_IDENT)
+#define ALPHA       (CHAR_CLASS_IDENT | CHAR_CLASS_HEADER_NAME)
+#define IDENT       CHAR_CLASS_IDENT
+#define HEADER_NAME CHAR_CLASS_HEADER_NAME
+
+static const uint8_t char_classes[256] = {
+    [' '] = SPACE,
+    ['-'] = HEADER_NAME,
+    ['0'] = DIGIT, ['1'] = DIGIT, ['2'] = DIGIT, ['3'] = DIGIT, ['4'] = DIGIT,
+    ['5'] = DIGIT, ['6'] = DIGIT, ['7'] = DIGIT, ['8'] = DIGIT, ['9'] = DIGIT,
+    ['A'] = ALPHA, ['B'] = ALPHA, ['C'] = ALPHA, ['D'] = ALPHA, ['E'] = ALPHA,
+    ['F'] = ALPHA, ['G'] = ALPHA, ['H'] = ALPHA, ['I'] = ALPHA, ['J'] = ALPHA,
+    ['K'] = ALPHA, ['L'] = ALPHA, ['M'] = ALPHA, ['N'] = ALPHA, ['O'] = ALPHA,
+    ['P'] = ALPHA, ['Q'] = ALPHA, ['R'] = ALPHA, ['S'] = ALPHA, ['T'] = ALPHA,
+    ['U'] = ALPHA, ['V'] = ALPHA, ['W'] = ALPHA, ['X'] = ALPHA, ['Y'] = ALPHA,
+    ['Z'] = ALPHA,
+    ['_'] = IDENT,
+    ['a'] = ALPHA, ['b'] = ALPHA, ['c'] = ALPHA, ['d'] = ALPHA, ['e'] = ALPHA,
+    ['f'] = ALPHA, ['g'] = ALPHA, ['h'] = ALPHA, ['i'] = ALPHA, ['j'] = ALPHA,
+    ['k'] = ALPHA, ['l'] = ALPHA, ['m'] = ALPHA, ['n'] = ALPHA, ['o'] = ALPHA,
+    ['p'] = ALPHA, ['q'] = ALPHA, ['r'] = ALPHA, ['s'] = ALPHA, ['t'] = ALPHA,
+    ['u'] = ALPHA, ['v'] = ALPHA, ['w'] = ALPHA, ['x'] = ALPHA, ['y'] = ALPHA,
+    ['z'] = ALPHA,
+};
+
+#undef SPACE
+#undef DIGIT
+#undef ALPHA
+#undef IDENT
+#undef HEADER_NAME
+
+static bool is_of_class(char c, uint8_t char_class) {
+    return (char_classes[(unsigned char)c] & char_class) != 0;
+}
+
+// Consumes @p input while its characters are (`in_class`) or are not
+// (`!in_class`) of `char_class`.
+static SmolRTSP_ParseResult
+match_class(CharSlice99 input, uint8_t char_class, bool in_class) {
+    for (size_t i = 0; i < input.len; i++) {
+        if (is_of_class(input.ptr[i], char_class) != in_class) {
+            return SmolRTSP_ParseResult_complete(i);
+        }
+    }
 
-static bool numeric_matcher(char c, void *ctx) {
-    (void)ctx;
-    return isdigit(c);
+    return SmolRTSP_ParseResult_partial();
 }
 
-static bool ident_matcher(char c, void *ctx) {
-    (void)ctx;
-    return isalnum(c) || c == '_';
-}
+// Like `match_class` but fails unless the first character is of `char_class`.
+static SmolRTSP_ParseResult match_token(
+    CharSlice99 input, uint8_t char_class, SmolRTSP_ParseType type) {
+    if (CharSlice99_is_empty(input)) {
+        return SmolRTSP_ParseResult_partial();
+    }
 
-static bool header_name_char_matcher(char c, void *ctx) {
-    (void)ctx;
-    return isalpha(c) || c == '-';
-}
+    if (!is_of_class(input.ptr[0], char_class)) {
+        return SmolRTSP_ParseResult_Failure(
+            SmolRTSP_ParseError_TypeMismatch(type, input));
+    }
 
-static bool char_matcher(char c, void *ctx) {
-    const char expected = *(const char *)ctx;
-    return c == expected;
+    return match_class(input, char_class, true);
 }
 
 SmolRTSP_ParseResult
@@ -59,18 +101,21 @@ smolrtsp_match_until_str(CharSlice99 input, const char *restrict str) {
     const size_t str_len = strlen(str);
     assert(str_len > 0);
 
-    size_t offset = 0;
-
-    for (size_t i = 0; i < input.len; i++) {
-        if (input.len - i < str_len) {
-            return SmolRTSP_ParseResult_partial();
+    // Jump between the occurrences of the first character with `memchr`, which
+    // is vectorized by the C library, and verify the rest only there.
+    const char *ptr = input.ptr, *const end = input.ptr + input.len;
+    while ((size_t)(end - ptr) >= str_len) {
+        ptr = memchr(ptr, str[0], (size_t)(end - ptr) - (str_len - 1));
+        if (NULL == ptr) {
+            break;
         }
 
-        if (memcmp(input.ptr + i, str, str_len) == 0) {
-            return SmolRTSP_ParseResult_complete(offset + str_len);
+        if (memcmp(ptr + 1, str + 1, str_len - 1) == 0) {
+            return SmolRTSP_ParseResult_complete(
+                (size_t)(ptr - input.ptr) + str_len);
         }
 
-        offset++;
+        ptr++;
     }
 
     return SmolRTSP_ParseResult_partial();
@@ -85,7 +130,13 @@ SmolRTSP_ParseResult smolrtsp_match_until_double_crlf(CharSlice99 input) {
 }
 
 SmolRTSP_ParseResult smolrtsp_match_char(CharSlice99 input, char c) {
-    return smolrtsp_match_until(input, char_matcher, &c);
+    for (size_t i = 0; i < input.len; i++) {
+        if (input.ptr[i] != c) {
+            return SmolRTSP_ParseResult_complete(i);
+        }
+    }
+
+    return SmolRTSP_ParseResult_partial();
 }
 
 SmolRTSP_ParseResult
@@ -116,38 +167,85 @@ smolrtsp_match_str(CharSlice99 input, const char *restrict str) {
 }
 
 SmolRTSP_ParseResult smolrtsp_match_whitespaces(CharSlice99 input) {
-    return smolrtsp_match_until(input, whitespace_matcher, NULL);
+    return match_class(input, CHAR_CLASS_SPACE, true);
 }
 
 SmolRTSP_ParseResult smolrtsp_match_non_whitespaces(CharSlice99 input) {
-    return smolrtsp_match_until(input, non_whitespace_matcher, NULL);
+    return match_class(input, CHAR_CLASS_SPACE, false);
 }
 
-// TODO: refactor the following functions.
-
 SmolRTSP_ParseResult smolrtsp_match_numeric(CharSlice99 input) {
-    if (!numeric_matcher(input.ptr[0], NULL)) {
-        return SmolRTSP_ParseResult_Failure(
-            SmolRTSP_ParseError_TypeMismatch(SmolRTSP_ParseType_Int, input));
+    return match_token(input, CHAR_CLASS_DIGIT, SmolRTSP_ParseType_Int);
+}
+
+SmolRTSP_ParseResult smolrtsp_match_ident(CharSlice99 input) {
+    return match_token(input, CHAR_CLASS_IDENT, SmolRTSP_ParseType_Ident);
+}
+
+SmolRTSP_ParseResult smolrtsp_match_header_name(CharSlice99 input) {
+    return match_token(
+        input, CHAR_CLASS_HEADER_NAME, SmolRTSP_ParseType_HeaderName);
+}
+
+static bool is_blank(char c) {
+    return ' ' == c || '\t' == c;
+}
+
+CharSlice99 smolrtsp_trim(CharSlice99 input) {
+    while (!CharSlice99_is_empty(input) && is_blank(input.ptr[0])) {
+        input = CharSlice99_advance(input, 1);
+    }
+    while (!CharSlice99_is_empty(input) &&
+           is_blank(input.ptr[input.len - 1])) {
+        input = CharSlice99_sub(input, 0, input.len - 1);
     }
 
-    return smolrtsp_match_until(input, numeric_matcher, NULL);
+    return input;
 }
 
-SmolRTSP_ParseResult smolrtsp_match_ident(CharSlice99 input) {
-    if (!ident_matcher(input.ptr[0], NULL)) {
-        return SmolRTSP_ParseResult_Failure(
-            SmolRTSP_ParseError_TypeMismatch(SmolRTSP_ParseType_Ident, input));
+bool smolrtsp_parse_uint(
+    CharSlice99 input, uint64_t max, uint64_t *restrict result) {
+    assert(result);
+
+    input = smolrtsp_trim(input);
+
+    if (CharSlice99_is_empty(input)) {
+        return false;
     }
 
-    return smolrtsp_match_until(input, ident_matcher, NULL);
+    uint64_t value = 0;
+    for (size_t i = 0; i < input.len; i++) {
+        const char c = input.ptr[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+
+        const unsigned digit = (unsigned)(c - '0');
+        if (digit > max || value > (max - digit) / 10) {
+            return false;
+        }
+
+        value = value * 10 + digit;
+    }
+
+    *result = value;
+    return true;
 }
 
-SmolRTSP_ParseResult smolrtsp_match_header_name(CharSlice99 input) {
-    if (!header_name_char_matcher(input.ptr[0], NULL)) {
-        return SmolRTSP_ParseResult_Failure(SmolRTSP_ParseError_TypeMismatch(
-            SmolRTSP_ParseType_HeaderName, input));
+static char to_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+bool smolrtsp_eq_ignore_case(CharSlice99 lhs, CharSlice99 rhs) {
+    if (lhs.len != rhs.len) {
+        return false;
+    }
+
+    for (size_t i = 0; i < lhs.len; i++) {
+        if (to_lower(lhs.ptr[i]) != to_lower(rhs.ptr[i])) {
+            return false;
+        }
     }
 
-    return smolrtsp_match_until(input, header_name_char_matcher, NULL);
+    return true;
 }
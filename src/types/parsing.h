@@ -1,6 +1,9 @@
 #pragma once
 
 #include <smolrtsp/types/error.h>
+#include <smolrtsp/types/rtsp_version.h>
+#include <smolrtsp/types/status_code.h>
+#include <smolrtsp/writer.h>
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -46,3 +49,49 @@ SmolRTSP_ParseResult smolrtsp_match_non_whitespaces(CharSlice99 input);
 SmolRTSP_ParseResult smolrtsp_match_numeric(CharSlice99 input);
 SmolRTSP_ParseResult smolrtsp_match_ident(CharSlice99 input);
 SmolRTSP_ParseResult smolrtsp_match_header_name(CharSlice99 input);
+
+/**
+ * Returns @p input without the leading and trailing spaces and tabs.
+ */
+CharSlice99 smolrtsp_trim(CharSlice99 input);
+
+/**
+ * Parses @p input as a decimal number not greater than @p max, without any
+ * copying.
+ *
+ * Spaces and tabs around the digits are allowed; signs and any other
+ * characters are not.
+ *
+ * @return Whether @p input is such a number. On failure, @p result is left
+ * unchanged.
+ */
+bool smolrtsp_parse_uint(
+    CharSlice99 input, uint64_t max, uint64_t *restrict result);
+
+/**
+ * Tests @p lhs and @p rhs for equality, ignoring the case of ASCII letters.
+ */
+bool smolrtsp_eq_ignore_case(CharSlice99 lhs, CharSlice99 rhs);
+
+/**
+ * Writes the header `<key>: <value>\r\n` to @p w with #smolrtsp_write_uint,
+ * the same as #SmolRTSP_Header_serialize would with the formatted value.
+ */
+ssize_t smolrtsp_serialize_uint_header(
+    CharSlice99 key, uint64_t value, SmolRTSP_Writer w);
+
+/**
+ * The length of `RTSP/1.0 NNN `, the beginning of the most common status line.
+ */
+#define SMOLRTSP_STATUS_LINE_PREFIX_LEN (sizeof("RTSP/1.0 000 ") - 1)
+
+/**
+ * Renders the beginning of the status line of @p version and @p code up to the
+ * reason phrase into @p prefix, without any formatting machinery.
+ *
+ * @return Whether the status line has such a prefix, i.e., @p version is
+ * RTSP/1.0 and @p code has three digits.
+ */
+bool smolrtsp_status_line_prefix(
+    SmolRTSP_RtspVersion version, SmolRTSP_StatusCode code,
+    char prefix[restrict static SMOLRTSP_STATUS_LINE_PREFIX_LEN]);
@@ -1,20 +1,21 @@
 #include <smolrtsp/types/request.h>
 
+#include <smolrtsp/types/request_parser.h>
+
 #include "../macros.h"
 #include "parsing.h"
 #include <smolrtsp/util.h>
 
 #include <assert.h>
-#include <inttypes.h>
-
-#include <alloca.h>
 
 #include <slice99.h>
 
 SmolRTSP_Request SmolRTSP_Request_uninit(void) {
     SmolRTSP_Request self;
-    memset(&self, '\0', sizeof self);
-    self.header_map = SmolRTSP_HeaderMap_empty();
+    memset(&self.start_line, '\0', sizeof self.start_line);
+    SmolRTSP_HeaderMap_clear(&self.header_map);
+    self.body = SmolRTSP_MessageBody_empty();
+    self.cseq = 0;
     return self;
 }
 
@@ -29,21 +30,17 @@ ssize_t SmolRTSP_Request_serialize(
 
     if (!SmolRTSP_HeaderMap_contains_key(
             &self->header_map, SMOLRTSP_HEADER_C_SEQ)) {
-        const SmolRTSP_Header cseq = {
-            SMOLRTSP_HEADER_C_SEQ,
-            CharSlice99_alloca_fmt("%" PRIu32, self->cseq),
-        };
-        CHK_WRITE_ERR(result, SmolRTSP_Header_serialize(&cseq, w));
+        CHK_WRITE_ERR(
+            result, smolrtsp_serialize_uint_header(
+                        SMOLRTSP_HEADER_C_SEQ, self->cseq, w));
     }
 
     if (!SmolRTSP_HeaderMap_contains_key(
             &self->header_map, SMOLRTSP_HEADER_CONTENT_LENGTH) &&
         !CharSlice99_is_empty(self->body)) {
-        const SmolRTSP_Header content_length = {
-            SMOLRTSP_HEADER_CONTENT_LENGTH,
-            CharSlice99_alloca_fmt("%zd", self->body.len),
-        };
-        CHK_WRITE_ERR(result, SmolRTSP_Header_serialize(&content_length, w));
+        CHK_WRITE_ERR(
+            result, smolrtsp_serialize_uint_header(
+                        SMOLRTSP_HEADER_CONTENT_LENGTH, self->body.len, w));
     }
 
     CHK_WRITE_ERR(result, SmolRTSP_HeaderMap_serialize(&self->header_map, w));
@@ -58,66 +55,8 @@ SmolRTSP_ParseResult
 SmolRTSP_Request_parse(SmolRTSP_Request *restrict self, CharSlice99 input) {
     assert(self);
 
-    const CharSlice99 backup = input;
-
-    // TODO: implement proper parsing of interleaved binary data.
-    for (;;) {
-        if (input.len < sizeof(uint32_t)) {
-            return SmolRTSP_ParseResult_partial();
-        }
-
-        if ('$' == input.ptr[0]) {
-            uint8_t channel_id = 0;
-            uint16_t payload_len = 0;
-            smolrtsp_parse_interleaved_header(
-                (const uint8_t *)input.ptr, &channel_id, &payload_len);
-
-            input = CharSlice99_advance(input, sizeof(uint32_t));
-
-            if (input.len < (size_t)payload_len) {
-                return SmolRTSP_ParseResult_partial();
-            }
-            input = CharSlice99_advance(input, (size_t)payload_len);
-        } else {
-            break;
-        }
-    }
-
-    MATCH(SmolRTSP_RequestLine_parse(&self->start_line, input));
-    MATCH(SmolRTSP_HeaderMap_parse(&self->header_map, input));
-
-    CharSlice99 content_length;
-    size_t content_length_int = 0;
-    const bool content_length_found = SmolRTSP_HeaderMap_find(
-        &self->header_map, SMOLRTSP_HEADER_CONTENT_LENGTH, &content_length);
-
-    if (content_length_found) {
-        if (sscanf(
-                CharSlice99_alloca_c_str(content_length), "%zd",
-                &content_length_int) != 1) {
-            return SmolRTSP_ParseResult_Failure(
-                SmolRTSP_ParseError_ContentLength(content_length));
-        }
-    }
-
-    MATCH(SmolRTSP_MessageBody_parse(&self->body, input, content_length_int));
-
-    CharSlice99 cseq_value;
-    const bool cseq_found = SmolRTSP_HeaderMap_find(
-        &self->header_map, SMOLRTSP_HEADER_C_SEQ, &cseq_value);
-    if (!cseq_found) {
-        return SmolRTSP_ParseResult_Failure(SmolRTSP_ParseError_MissingCSeq());
-    }
-
-    uint32_t cseq;
-    if (sscanf(CharSlice99_alloca_c_str(cseq_value), "%" SCNu32, &cseq) != 1) {
-        return SmolRTSP_ParseResult_Failure(
-            SmolRTSP_ParseError_InvalidCSeq(cseq_value));
-    }
-
-    self->cseq = cseq;
-
-    return SmolRTSP_ParseResult_complete(input.ptr - backup.ptr);
+    SmolRTSP_RequestParser parser = SmolRTSP_RequestParser_new();
+    return SmolRTSP_RequestParser_parse(&parser, self, input);
 }
 
 bool SmolRTSP_Request_eq(
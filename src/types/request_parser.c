@@ -0,0 +1,269 @@
+#include <smolrtsp/types/request_parser.h>
+
+#include "../probes.h"
+#include "parsing.h"
+#include <smolrtsp/util.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+static bool next_line(
+    SmolRTSP_RequestParser *restrict self, CharSlice99 input,
+    CharSlice99 *restrict line);
+static SmolRTSP_ParseResult parse_line(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_ParseResult res,
+    CharSlice99 line);
+static SmolRTSP_ParseResult finish_headers(
+    SmolRTSP_RequestParser *restrict self,
+    const SmolRTSP_Request *restrict request);
+static SmolRTSP_ParseResult finish(SmolRTSP_Request *restrict request);
+static SmolRTSP_ParseResult parse(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input);
+#if SMOLRTSP_PROBES_ENABLED
+static void probe_parse_end(SmolRTSP_ParseResult res);
+#endif
+
+SmolRTSP_RequestParser SmolRTSP_RequestParser_new(void) {
+    return (SmolRTSP_RequestParser){
+        .section = SmolRTSP_RequestParserSection_StartLine,
+        .offset = 0,
+        .scanned = 0,
+        .content_length = 0,
+    };
+}
+
+SmolRTSP_ParseResult SmolRTSP_RequestParser_parse(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input) {
+    assert(self);
+    assert(request);
+    assert(self->offset <= input.len);
+
+    SMOLRTSP_PROBE(request_parse_start, input.ptr, input.len, self->offset);
+    const SmolRTSP_ParseResult res = parse(self, request, input);
+#if SMOLRTSP_PROBES_ENABLED
+    probe_parse_end(res);
+#endif
+
+    return res;
+}
+
+static SmolRTSP_ParseResult parse(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_Request *restrict request,
+    CharSlice99 input) {
+    for (;;) {
+        const CharSlice99 rest = CharSlice99_advance(input, self->offset);
+        CharSlice99 line;
+
+        switch (self->section) {
+        case SmolRTSP_RequestParserSection_StartLine:
+            // Interleaved binary data is skipped here; `SmolRTSP_Demuxer`
+            // hands it to the handlers of its channels instead.
+            if (rest.len < sizeof(uint32_t)) {
+                return SmolRTSP_ParseResult_partial();
+            }
+
+            if ('$' == rest.ptr[0]) {
+                uint8_t channel_id = 0;
+                uint16_t payload_len = 0;
+                smolrtsp_parse_interleaved_header(
+                    (const uint8_t *)rest.ptr, &channel_id, &payload_len);
+
+                const size_t frame_len = sizeof(uint32_t) + payload_len;
+                if (rest.len < frame_len) {
+                    return SmolRTSP_ParseResult_partial();
+                }
+
+                self->offset += frame_len;
+                break;
+            }
+
+            if (!next_line(self, rest, &line)) {
+                return SmolRTSP_ParseResult_partial();
+            }
+
+            {
+                const SmolRTSP_ParseResult res = parse_line(
+                    self,
+                    SmolRTSP_RequestLine_parse(&request->start_line, line),
+                    line);
+                if (!SmolRTSP_ParseResult_is_complete(res)) {
+                    return res;
+                }
+            }
+
+            SmolRTSP_HeaderMap_clear(&request->header_map);
+            self->section = SmolRTSP_RequestParserSection_Headers;
+            break;
+
+        case SmolRTSP_RequestParserSection_Headers:
+            if (CharSlice99_primitive_starts_with(rest, SMOLRTSP_CRLF)) {
+                self->offset += SMOLRTSP_CRLF.len;
+
+                const SmolRTSP_ParseResult res =
+                    finish_headers(self, request);
+                if (SmolRTSP_ParseResult_is_failure(res)) {
+                    return res;
+                }
+
+                self->section = SmolRTSP_RequestParserSection_Body;
+                break;
+            }
+            if (rest.len < SMOLRTSP_CRLF.len) {
+                return SmolRTSP_ParseResult_partial();
+            }
+            if (SmolRTSP_HeaderMap_is_full(&request->header_map)) {
+                return SmolRTSP_ParseResult_Failure(
+                    SmolRTSP_ParseError_HeaderMapOverflow());
+            }
+
+            if (!next_line(self, rest, &line)) {
+                return SmolRTSP_ParseResult_partial();
+            }
+
+            {
+                SmolRTSP_Header header = {0};
+                const SmolRTSP_ParseResult res = parse_line(
+                    self, SmolRTSP_Header_parse(&header, line), line);
+                if (!SmolRTSP_ParseResult_is_complete(res)) {
+                    return res;
+                }
+
+                SmolRTSP_HeaderMap_append(&request->header_map, header);
+            }
+            break;
+
+        case SmolRTSP_RequestParserSection_Body: {
+            const SmolRTSP_ParseResult res = SmolRTSP_MessageBody_parse(
+                &request->body, rest, self->content_length);
+            if (!SmolRTSP_ParseResult_is_complete(res)) {
+                return res;
+            }
+
+            self->offset += self->content_length;
+            self->section = SmolRTSP_RequestParserSection_Done;
+            break;
+        }
+
+        case SmolRTSP_RequestParserSection_Done: {
+            const SmolRTSP_ParseResult res = finish(request);
+            if (SmolRTSP_ParseResult_is_failure(res)) {
+                return res;
+            }
+
+            return SmolRTSP_ParseResult_complete(self->offset);
+        }
+        }
+    }
+}
+
+// Finds the first line of `input`, scanning only the bytes after
+// `self->scanned` (and the last scanned byte, in case it is the `\r` of a
+// split CRLF).
+static bool next_line(
+    SmolRTSP_RequestParser *restrict self, CharSlice99 input,
+    CharSlice99 *restrict line) {
+    const size_t start = self->scanned > 0 ? self->scanned - 1 : 0;
+
+    const SmolRTSP_ParseResult res =
+        smolrtsp_match_until_crlf(CharSlice99_advance(input, start));
+
+    match(res) {
+        of(SmolRTSP_ParseResult_Success, status) {
+            match(*status) {
+                of(SmolRTSP_ParseStatus_Complete, offset) {
+                    *line = CharSlice99_sub(input, 0, start + *offset);
+                    return true;
+                }
+                otherwise {}
+            }
+        }
+        otherwise {}
+    }
+
+    self->scanned = input.len;
+    return false;
+}
+
+// Commits the complete line `line` parsed with the result `res`. A parser that
+// still wants more input has not found the terminator where it expected.
+static SmolRTSP_ParseResult parse_line(
+    SmolRTSP_RequestParser *restrict self, SmolRTSP_ParseResult res,
+    CharSlice99 line) {
+    if (SmolRTSP_ParseResult_is_failure(res)) {
+        return res;
+    }
+    if (SmolRTSP_ParseResult_is_partial(res)) {
+        return SmolRTSP_ParseResult_Failure(
+            SmolRTSP_ParseError_StrMismatch(SMOLRTSP_CRLF, line));
+    }
+
+    self->offset += line.len;
+    self->scanned = 0;
+
+    return SmolRTSP_ParseResult_complete(line.len);
+}
+
+static SmolRTSP_ParseResult finish_headers(
+    SmolRTSP_RequestParser *restrict self,
+    const SmolRTSP_Request *restrict request) {
+    CharSlice99 content_length;
+    uint64_t content_length_int = 0;
+    const bool content_length_found = SmolRTSP_HeaderMap_find_id(
+        &request->header_map, SmolRTSP_HeaderId_ContentLength,
+        &content_length);
+
+    if (content_length_found &&
+        !smolrtsp_parse_uint(content_length, SIZE_MAX, &content_length_int)) {
+        return SmolRTSP_ParseResult_Failure(
+            SmolRTSP_ParseError_ContentLength(content_length));
+    }
+
+    self->content_length = (size_t)content_length_int;
+
+    return SmolRTSP_ParseResult_complete(0);
+}
+
+static SmolRTSP_ParseResult finish(SmolRTSP_Request *restrict request) {
+    CharSlice99 cseq_value;
+    const bool cseq_found = SmolRTSP_HeaderMap_find_id(
+        &request->header_map, SmolRTSP_HeaderId_CSeq, &cseq_value);
+    if (!cseq_found) {
+        return SmolRTSP_ParseResult_Failure(SmolRTSP_ParseError_MissingCSeq());
+    }
+
+    uint64_t cseq;
+    if (!smolrtsp_parse_uint(cseq_value, UINT32_MAX, &cseq)) {
+        return SmolRTSP_ParseResult_Failure(
+            SmolRTSP_ParseError_InvalidCSeq(cseq_value));
+    }
+
+    request->cseq = (uint32_t)cseq;
+
+    return SmolRTSP_ParseResult_complete(0);
+}
+
+#if SMOLRTSP_PROBES_ENABLED
+
+static void probe_parse_end(SmolRTSP_ParseResult res) {
+    int status = -1;
+    size_t offset = 0;
+
+    match(res) {
+        of(SmolRTSP_ParseResult_Success, parse_status) {
+            match(*parse_status) {
+                of(SmolRTSP_ParseStatus_Complete, size) {
+                    status = 0;
+                    offset = *size;
+                }
+                otherwise status = 1;
+            }
+        }
+        otherwise status = -1;
+    }
+
+    SMOLRTSP_PROBE(request_parse_end, status, offset);
+}
+
+#endif // SMOLRTSP_PROBES_ENABLED
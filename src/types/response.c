@@ -4,16 +4,21 @@
 #include "parsing.h"
 
 #include <assert.h>
-#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
 
-#include <alloca.h>
+#include <sys/uio.h>
 
 #include <slice99.h>
 
+static size_t format_cseq_line(uint32_t cseq, char *restrict line);
+
 SmolRTSP_Response SmolRTSP_Response_uninit(void) {
     SmolRTSP_Response self;
-    memset(&self, '\0', sizeof self);
-    self.header_map = SmolRTSP_HeaderMap_empty();
+    memset(&self.start_line, '\0', sizeof self.start_line);
+    SmolRTSP_HeaderMap_clear(&self.header_map);
+    self.body = SmolRTSP_MessageBody_empty();
+    self.cseq = 0;
     return self;
 }
 
@@ -24,26 +29,43 @@ ssize_t SmolRTSP_Response_serialize(
 
     ssize_t result = 0;
 
-    CHK_WRITE_ERR(
-        result, SmolRTSP_ResponseLine_serialize(&self->start_line, w));
-
-    if (!SmolRTSP_HeaderMap_contains_key(
-            &self->header_map, SMOLRTSP_HEADER_C_SEQ)) {
-        const SmolRTSP_Header cseq = {
-            SMOLRTSP_HEADER_C_SEQ,
-            CharSlice99_alloca_fmt("%" PRIu32, self->cseq),
+    const bool cseq_given = SmolRTSP_HeaderMap_contains_key(
+        &self->header_map, SMOLRTSP_HEADER_C_SEQ);
+
+    // The common case: `RTSP/1.0 NNN <reason>\r\nCSeq: <cseq>\r\n` with a
+    // single write.
+    char prefix[SMOLRTSP_STATUS_LINE_PREFIX_LEN];
+    if (!cseq_given &&
+        smolrtsp_status_line_prefix(
+            self->start_line.version, self->start_line.code, prefix)) {
+        char cseq_line[sizeof("\r\nCSeq: 4294967295\r\n") - 1];
+        const size_t cseq_line_len = format_cseq_line(self->cseq, cseq_line);
+
+        struct iovec vecs[] = {
+            {prefix, sizeof prefix},
+            {self->start_line.reason.ptr, self->start_line.reason.len},
+            {cseq_line, cseq_line_len},
         };
-        CHK_WRITE_ERR(result, SmolRTSP_Header_serialize(&cseq, w));
+        const SmolRTSP_IoVecSlice bufs =
+            SmolRTSP_IoVecSlice_new(vecs, SLICE99_ARRAY_LEN(vecs));
+        CHK_WRITE_ERR(result, smolrtsp_writev(w, bufs));
+    } else {
+        CHK_WRITE_ERR(
+            result, SmolRTSP_ResponseLine_serialize(&self->start_line, w));
+
+        if (!cseq_given) {
+            CHK_WRITE_ERR(
+                result, smolrtsp_serialize_uint_header(
+                            SMOLRTSP_HEADER_C_SEQ, self->cseq, w));
+        }
     }
 
     if (!SmolRTSP_HeaderMap_contains_key(
             &self->header_map, SMOLRTSP_HEADER_CONTENT_LENGTH) &&
         !CharSlice99_is_empty(self->body)) {
-        const SmolRTSP_Header content_length = {
-            SMOLRTSP_HEADER_CONTENT_LENGTH,
-            CharSlice99_alloca_fmt("%zd", self->body.len),
-        };
-        CHK_WRITE_ERR(result, SmolRTSP_Header_serialize(&content_length, w));
+        CHK_WRITE_ERR(
+            result, smolrtsp_serialize_uint_header(
+                        SMOLRTSP_HEADER_CONTENT_LENGTH, self->body.len, w));
     }
 
     CHK_WRITE_ERR(result, SmolRTSP_HeaderMap_serialize(&self->header_map, w));
@@ -87,35 +109,33 @@ SmolRTSP_Response_parse(SmolRTSP_Response *restrict self, CharSlice99 input) {
     MATCH(SmolRTSP_HeaderMap_parse(&self->header_map, input));
 
     CharSlice99 content_length;
-    size_t content_length_int = 0;
-    const bool content_length_is_found = SmolRTSP_HeaderMap_find(
-        &self->header_map, SMOLRTSP_HEADER_CONTENT_LENGTH, &content_length);
-
-    if (content_length_is_found) {
-        if (sscanf(
-                CharSlice99_alloca_c_str(content_length), "%zd",
-                &content_length_int) != 1) {
-            return SmolRTSP_ParseResult_Failure(
-                SmolRTSP_ParseError_ContentLength(content_length));
-        }
+    uint64_t content_length_int = 0;
+    const bool content_length_is_found = SmolRTSP_HeaderMap_find_id(
+        &self->header_map, SmolRTSP_HeaderId_ContentLength, &content_length);
+
+    if (content_length_is_found &&
+        !smolrtsp_parse_uint(content_length, SIZE_MAX, &content_length_int)) {
+        return SmolRTSP_ParseResult_Failure(
+            SmolRTSP_ParseError_ContentLength(content_length));
     }
 
-    MATCH(SmolRTSP_MessageBody_parse(&self->body, input, content_length_int));
+    MATCH(SmolRTSP_MessageBody_parse(
+        &self->body, input, (size_t)content_length_int));
 
     CharSlice99 cseq_value;
-    const bool cseq_found = SmolRTSP_HeaderMap_find(
-        &self->header_map, SMOLRTSP_HEADER_C_SEQ, &cseq_value);
+    const bool cseq_found = SmolRTSP_HeaderMap_find_id(
+        &self->header_map, SmolRTSP_HeaderId_CSeq, &cseq_value);
     if (!cseq_found) {
         return SmolRTSP_ParseResult_Failure(SmolRTSP_ParseError_MissingCSeq());
     }
 
-    uint32_t cseq;
-    if (sscanf(CharSlice99_alloca_c_str(cseq_value), "%" SCNu32, &cseq) != 1) {
+    uint64_t cseq;
+    if (!smolrtsp_parse_uint(cseq_value, UINT32_MAX, &cseq)) {
         return SmolRTSP_ParseResult_Failure(
             SmolRTSP_ParseError_InvalidCSeq(cseq_value));
     }
 
-    self->cseq = cseq;
+    self->cseq = (uint32_t)cseq;
 
     return SmolRTSP_ParseResult_complete(input.ptr - backup.ptr);
 }
@@ -131,3 +151,24 @@ bool SmolRTSP_Response_eq(
            SmolRTSP_MessageBody_eq(&lhs->body, &rhs->body) &&
            lhs->cseq == rhs->cseq;
 }
+
+// Renders `\r\nCSeq: <cseq>\r\n` into `line`, returning its length.
+static size_t format_cseq_line(uint32_t cseq, char *restrict line) {
+    const char head[] = "\r\nCSeq: ";
+    memcpy(line, head, sizeof head - 1);
+
+    char digits[10];
+    size_t digits_len = 0;
+    do {
+        digits[sizeof digits - ++digits_len] = (char)('0' + cseq % 10);
+        cseq /= 10;
+    } while (cseq > 0);
+
+    char *p = line + sizeof head - 1;
+    memcpy(p, digits + sizeof digits - digits_len, digits_len);
+    p += digits_len;
+    *p++ = '\r';
+    *p++ = '\n';
+
+    return (size_t)(p - line);
+}
@@ -7,11 +7,24 @@
 #include <assert.h>
 #include <string.h>
 
+#include <sys/uio.h>
+
 ssize_t SmolRTSP_ResponseLine_serialize(
     const SmolRTSP_ResponseLine *restrict self, SmolRTSP_Writer w) {
     assert(self);
     assert(w.self && w.vptr);
 
+    char prefix[SMOLRTSP_STATUS_LINE_PREFIX_LEN];
+    if (smolrtsp_status_line_prefix(self->version, self->code, prefix)) {
+        struct iovec vecs[] = {
+            {prefix, sizeof prefix},
+            {self->reason.ptr, self->reason.len},
+            {SMOLRTSP_CRLF.ptr, SMOLRTSP_CRLF.len},
+        };
+        return smolrtsp_writev(
+            w, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(vecs));
+    }
+
     ssize_t result = 0;
 
     CHK_WRITE_ERR(result, SmolRTSP_RtspVersion_serialize(&self->version, w));
@@ -24,6 +37,22 @@ ssize_t SmolRTSP_ResponseLine_serialize(
     return result;
 }
 
+bool smolrtsp_status_line_prefix(
+    SmolRTSP_RtspVersion version, SmolRTSP_StatusCode code,
+    char prefix[restrict static SMOLRTSP_STATUS_LINE_PREFIX_LEN]) {
+    if (version.major != 1 || version.minor != 0 || code < 100 || code > 999) {
+        return false;
+    }
+
+    memcpy(prefix, "RTSP/1.0 ", strlen("RTSP/1.0 "));
+    prefix[9] = (char)('0' + code / 100);
+    prefix[10] = (char)('0' + code / 10 % 10);
+    prefix[11] = (char)('0' + code % 10);
+    prefix[12] = ' ';
+
+    return true;
+}
+
 SmolRTSP_ParseResult SmolRTSP_ResponseLine_parse(
     SmolRTSP_ResponseLine *restrict self, CharSlice99 input) {
     assert(self);
@@ -0,0 +1,389 @@
+#include <smolrtsp/types/rtcp.h>
+
+#include <assert.h>
+#include <errno.h>
+
+#define RTCP_VERSION          2
+#define RTCP_HEADER_SIZE      4
+#define RTCP_SSRC_SIZE        4
+#define RTCP_SENDER_INFO_SIZE 20
+#define RTCP_NACK_SIZE        4
+#define RTCP_FIR_SIZE         8
+
+// The base sequence number, the packet status count, the reference time, and
+// the feedback packet count of a transport-wide feedback.
+#define RTCP_TRANSPORT_CC_HEADER_SIZE 8
+
+// The receive deltas are in multiples of 250 microseconds, and the reference
+// time in multiples of 64 milliseconds.
+#define RTCP_TRANSPORT_CC_DELTA_US          250
+#define RTCP_TRANSPORT_CC_REFERENCE_TIME_US 64000
+
+// The symbols of the packet statuses.
+#define RTCP_TRANSPORT_CC_NOT_RECEIVED 0
+#define RTCP_TRANSPORT_CC_SMALL_DELTA  1
+#define RTCP_TRANSPORT_CC_LARGE_DELTA  2
+
+#define RTCP_VERSION_SHIFT 6
+#define RTCP_PADDING_MASK  0x20
+#define RTCP_COUNT_MASK    0x1F
+
+static size_t report_blocks_offset(uint8_t packet_ty);
+static size_t chunk_len(uint16_t chunk);
+static uint8_t chunk_symbol(uint16_t chunk, size_t i);
+static uint16_t read_u16(const uint8_t *data);
+static uint32_t read_u32(const uint8_t *data);
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value);
+
+int SmolRTSP_RtcpPacket_parse(
+    U8Slice99 *restrict input, SmolRTSP_RtcpPacket *restrict packet) {
+    assert(input);
+    assert(packet);
+
+    /*
+     *  0                   1                   2                   3
+     *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |V=2|P|    RC   |      PT       |             length            |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     */
+
+    if (input->len < RTCP_HEADER_SIZE ||
+        input->ptr[0] >> RTCP_VERSION_SHIFT != RTCP_VERSION) {
+        goto fail;
+    }
+
+    // The length is in 32-bit words minus one, including the header.
+    const size_t size =
+        ((size_t)(input->ptr[2] << 8 | input->ptr[3]) + 1) * sizeof(uint32_t);
+    if (size > input->len) {
+        goto fail;
+    }
+
+    U8Slice99 payload = U8Slice99_sub(*input, RTCP_HEADER_SIZE, size);
+    if (input->ptr[0] & RTCP_PADDING_MASK) {
+        const uint8_t padding = input->ptr[size - 1];
+        if (0 == padding || padding > payload.len) {
+            goto fail;
+        }
+        payload.len -= padding;
+    }
+
+    const uint8_t packet_ty = input->ptr[1],
+                  count = input->ptr[0] & RTCP_COUNT_MASK;
+
+    const size_t offset = report_blocks_offset(packet_ty);
+    if (offset > 0 &&
+        payload.len < offset + count * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE) {
+        goto fail;
+    }
+    if ((SMOLRTSP_RTCP_RTPFB == packet_ty || SMOLRTSP_RTCP_PSFB == packet_ty) &&
+        payload.len < 2 * RTCP_SSRC_SIZE) {
+        goto fail;
+    }
+
+    *packet = (SmolRTSP_RtcpPacket){
+        .packet_ty = packet_ty,
+        .count = count,
+        .payload = payload,
+    };
+    *input = U8Slice99_advance(*input, size);
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
+
+uint32_t SmolRTSP_RtcpPacket_sender_ssrc(SmolRTSP_RtcpPacket self) {
+    assert(
+        SMOLRTSP_RTCP_SR == self.packet_ty ||
+        SMOLRTSP_RTCP_RR == self.packet_ty ||
+        SMOLRTSP_RTCP_RTPFB == self.packet_ty ||
+        SMOLRTSP_RTCP_PSFB == self.packet_ty);
+
+    return read_u32(self.payload.ptr);
+}
+
+uint32_t SmolRTSP_RtcpPacket_media_ssrc(SmolRTSP_RtcpPacket self) {
+    assert(
+        SMOLRTSP_RTCP_RTPFB == self.packet_ty ||
+        SMOLRTSP_RTCP_PSFB == self.packet_ty);
+
+    return read_u32(self.payload.ptr + RTCP_SSRC_SIZE);
+}
+
+size_t SmolRTSP_RtcpPacket_nacks_count(SmolRTSP_RtcpPacket self) {
+    assert(SMOLRTSP_RTCP_RTPFB == self.packet_ty);
+    assert(SMOLRTSP_RTCP_FMT_NACK == self.count);
+
+    return (self.payload.len - 2 * RTCP_SSRC_SIZE) / RTCP_NACK_SIZE;
+}
+
+SmolRTSP_RtcpNack SmolRTSP_RtcpPacket_nack(SmolRTSP_RtcpPacket self, size_t i) {
+    assert(i < SmolRTSP_RtcpPacket_nacks_count(self));
+
+    const uint32_t nack =
+        read_u32(self.payload.ptr + 2 * RTCP_SSRC_SIZE + i * RTCP_NACK_SIZE);
+
+    return (SmolRTSP_RtcpNack){
+        .seq_num = (uint16_t)(nack >> 16),
+        .bitmask = (uint16_t)nack,
+    };
+}
+
+int SmolRTSP_RtcpPacket_transport_feedback(
+    SmolRTSP_RtcpPacket self, SmolRTSP_RtcpTransportFeedback *restrict feedback,
+    SmolRTSP_RtcpPacketStatus *restrict statuses, size_t max) {
+    assert(SMOLRTSP_RTCP_RTPFB == self.packet_ty);
+    assert(SMOLRTSP_RTCP_FMT_TRANSPORT_CC == self.count);
+    assert(feedback);
+    assert(statuses || 0 == max);
+
+    /*
+     *  0                   1                   2                   3
+     *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |      base sequence number     |      packet status count      |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |                 reference time                | fb pkt. count |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |          packet chunk         |         packet chunk          |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     * |         recv delta            |  recv delta   |     ...       |
+     * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     */
+
+    const uint8_t *data = self.payload.ptr + 2 * RTCP_SSRC_SIZE;
+    const size_t len = self.payload.len - 2 * RTCP_SSRC_SIZE;
+    if (len < RTCP_TRANSPORT_CC_HEADER_SIZE) {
+        goto fail;
+    }
+
+    const uint32_t reference_time = read_u32(data + 4) >> 8;
+    *feedback = (SmolRTSP_RtcpTransportFeedback){
+        .base_seq_num = read_u16(data),
+        .status_count = read_u16(data + 2),
+        .reference_time_us =
+            (int64_t)reference_time * RTCP_TRANSPORT_CC_REFERENCE_TIME_US,
+        .fb_pkt_count = data[7],
+    };
+
+    // The receive deltas follow the chunks covering all the packets.
+    size_t deltas = RTCP_TRANSPORT_CC_HEADER_SIZE;
+    for (size_t reported = 0; reported < feedback->status_count;) {
+        if (deltas + 2 > len) {
+            goto fail;
+        }
+        const size_t n = chunk_len(read_u16(data + deltas));
+        if (0 == n) {
+            goto fail;
+        }
+        reported += n;
+        deltas += 2;
+    }
+
+    const size_t count =
+        feedback->status_count < max ? feedback->status_count : max;
+    int64_t arrival_us = feedback->reference_time_us;
+    size_t status = 0;
+    for (size_t chunk_offset = RTCP_TRANSPORT_CC_HEADER_SIZE; status < count;
+         chunk_offset += 2) {
+        const uint16_t chunk = read_u16(data + chunk_offset);
+
+        for (size_t i = 0, n = chunk_len(chunk); i < n && status < count;
+             i++, status++) {
+            const uint8_t symbol = chunk_symbol(chunk, i);
+            SmolRTSP_RtcpPacketStatus *s = &statuses[status];
+            s->seq_num = (uint16_t)(feedback->base_seq_num + status);
+            s->received = symbol != RTCP_TRANSPORT_CC_NOT_RECEIVED;
+            s->arrival_us = 0;
+
+            int64_t delta;
+            if (RTCP_TRANSPORT_CC_NOT_RECEIVED == symbol) {
+                continue;
+            } else if (RTCP_TRANSPORT_CC_SMALL_DELTA == symbol) {
+                if (deltas + 1 > len) {
+                    goto fail;
+                }
+                delta = data[deltas];
+                deltas += 1;
+            } else if (RTCP_TRANSPORT_CC_LARGE_DELTA == symbol) {
+                if (deltas + 2 > len) {
+                    goto fail;
+                }
+                delta = (int16_t)read_u16(data + deltas);
+                deltas += 2;
+            } else {
+                goto fail;
+            }
+
+            arrival_us += delta * RTCP_TRANSPORT_CC_DELTA_US;
+            s->arrival_us = arrival_us;
+        }
+    }
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
+
+bool SmolRTSP_RtcpPacket_is_keyframe_request(
+    SmolRTSP_RtcpPacket self, uint32_t ssrc) {
+    if (self.packet_ty != SMOLRTSP_RTCP_PSFB) {
+        return false;
+    }
+
+    if (SMOLRTSP_RTCP_FMT_PLI == self.count) {
+        return SmolRTSP_RtcpPacket_media_ssrc(self) == ssrc;
+    }
+
+    if (SMOLRTSP_RTCP_FMT_FIR == self.count) {
+        // Each FCI entry is the SSRC of a source followed by a command
+        // sequence number and 3 reserved bytes.
+        for (size_t offset = 2 * RTCP_SSRC_SIZE;
+             offset + RTCP_FIR_SIZE <= self.payload.len;
+             offset += RTCP_FIR_SIZE) {
+            if (read_u32(self.payload.ptr + offset) == ssrc) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+SmolRTSP_RtcpSenderReport
+SmolRTSP_RtcpPacket_sender_report(SmolRTSP_RtcpPacket self) {
+    assert(SMOLRTSP_RTCP_SR == self.packet_ty);
+
+    const uint8_t *data = self.payload.ptr;
+
+    return (SmolRTSP_RtcpSenderReport){
+        .ssrc = read_u32(data),
+        .ntp_timestamp =
+            (uint64_t)read_u32(data + 4) << 32 | read_u32(data + 8),
+        .rtp_timestamp = read_u32(data + 12),
+        .packet_count = read_u32(data + 16),
+        .octet_count = read_u32(data + 20),
+    };
+}
+
+SmolRTSP_RtcpReportBlock
+SmolRTSP_RtcpPacket_report_block(SmolRTSP_RtcpPacket self, size_t i) {
+    assert(i < self.count);
+
+    const uint8_t *data = self.payload.ptr +
+                          report_blocks_offset(self.packet_ty) +
+                          i * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE;
+
+    // Sign-extend the 24-bit cumulative number of packets lost.
+    const uint32_t lost = read_u32(data + 4) & 0xFFFFFF;
+    const int32_t cumulative_lost =
+        lost & 0x800000 ? (int32_t)lost - 0x1000000 : (int32_t)lost;
+
+    return (SmolRTSP_RtcpReportBlock){
+        .ssrc = read_u32(data),
+        .fraction_lost = data[4],
+        .cumulative_lost = cumulative_lost,
+        .extended_highest_seq_num = read_u32(data + 8),
+        .jitter = read_u32(data + 12),
+        .last_sr = read_u32(data + 16),
+        .delay_since_last_sr = read_u32(data + 20),
+    };
+}
+
+uint8_t *SmolRTSP_RtcpSenderReport_serialize(
+    SmolRTSP_RtcpSenderReport self, uint8_t buffer[restrict]) {
+    assert(buffer);
+
+    buffer[0] = RTCP_VERSION << RTCP_VERSION_SHIFT;
+    buffer[1] = SMOLRTSP_RTCP_SR;
+    buffer[2] = 0;
+    buffer[3] = SMOLRTSP_RTCP_SENDER_REPORT_SIZE / sizeof(uint32_t) - 1;
+
+    uint8_t *p = buffer + RTCP_HEADER_SIZE;
+    p = write_u32(p, self.ssrc);
+    p = write_u32(p, (uint32_t)(self.ntp_timestamp >> 32));
+    p = write_u32(p, (uint32_t)self.ntp_timestamp);
+    p = write_u32(p, self.rtp_timestamp);
+    p = write_u32(p, self.packet_count);
+    p = write_u32(p, self.octet_count);
+    assert(p == buffer + SMOLRTSP_RTCP_SENDER_REPORT_SIZE);
+
+    return buffer;
+}
+
+uint8_t *SmolRTSP_RtcpReportBlock_serialize(
+    SmolRTSP_RtcpReportBlock self, uint8_t buffer[restrict]) {
+    assert(buffer);
+
+    uint8_t *p = buffer;
+    p = write_u32(p, self.ssrc);
+    p = write_u32(
+        p, (uint32_t)self.fraction_lost << 24 |
+               ((uint32_t)self.cumulative_lost & 0xFFFFFF));
+    p = write_u32(p, self.extended_highest_seq_num);
+    p = write_u32(p, self.jitter);
+    p = write_u32(p, self.last_sr);
+    p = write_u32(p, self.delay_since_last_sr);
+    assert(p == buffer + SMOLRTSP_RTCP_REPORT_BLOCK_SIZE);
+
+    return buffer;
+}
+
+// Returns the offset of the report blocks in the payload of an SR or RR
+// packet, or 0 for the other packet types.
+static size_t report_blocks_offset(uint8_t packet_ty) {
+    switch (packet_ty) {
+    case SMOLRTSP_RTCP_SR:
+        return RTCP_SSRC_SIZE + RTCP_SENDER_INFO_SIZE;
+    case SMOLRTSP_RTCP_RR:
+        return RTCP_SSRC_SIZE;
+    default:
+        return 0;
+    }
+}
+
+// Returns the number of packet statuses of a transport-wide feedback chunk.
+static size_t chunk_len(uint16_t chunk) {
+    if (!(chunk & 0x8000)) {
+        // A run length chunk: the symbol and the length of the run.
+        return chunk & 0x1FFF;
+    }
+
+    // A status vector chunk of 14 one-bit symbols or 7 two-bit ones.
+    return chunk & 0x4000 ? 7 : 14;
+}
+
+static uint8_t chunk_symbol(uint16_t chunk, size_t i) {
+    if (!(chunk & 0x8000)) {
+        return (uint8_t)(chunk >> 13 & 0x3);
+    }
+
+    if (chunk & 0x4000) {
+        return (uint8_t)(chunk >> (12 - 2 * i) & 0x3);
+    }
+
+    return (uint8_t)(chunk >> (13 - i) & 0x1);
+}
+
+static uint16_t read_u16(const uint8_t *data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+static uint32_t read_u32(const uint8_t *data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+           (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+static uint8_t *write_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+    return buffer + 4;
+}
@@ -1,6 +1,7 @@
 #include <smolrtsp/types/rtp.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 
 #include <slice99.h>
@@ -9,6 +10,10 @@
 #define RTP_HEADER_PADDING_SHIFT   5
 #define RTP_HEADER_EXTENSION_SHIFT 4
 #define RTP_HEADER_MARKER_SHIFT    7
+#define RTP_HEADER_CSRC_COUNT_MASK 0x0F
+#define RTP_HEADER_PAYLOAD_TY_MASK 0x7F
+#define RTP_FIXED_HEADER_SIZE      12
+#define RTP_EXTENSION_HEADER_SIZE  4
 
 size_t SmolRTSP_RtpHeader_size(SmolRTSP_RtpHeader self) {
     static const size_t version_bits = 2, padding_bits = 1, extension_bits = 1,
@@ -95,3 +100,70 @@ uint8_t *SmolRTSP_RtpHeader_serialize(
 
     return buffer_backup;
 }
+
+int SmolRTSP_RtpHeader_parse(
+    U8Slice99 *restrict packet, SmolRTSP_RtpHeader *restrict header) {
+    assert(packet);
+    assert(header);
+
+    const uint8_t *bytes = packet->ptr;
+
+    if (packet->len < RTP_FIXED_HEADER_SIZE ||
+        bytes[0] >> RTP_HEADER_VERSION_SHIFT != 2) {
+        goto fail;
+    }
+
+    SmolRTSP_RtpHeader h = {
+        .version = 2,
+        .padding = (bytes[0] >> RTP_HEADER_PADDING_SHIFT) & 1,
+        .extension = (bytes[0] >> RTP_HEADER_EXTENSION_SHIFT) & 1,
+        .csrc_count = bytes[0] & RTP_HEADER_CSRC_COUNT_MASK,
+        .marker = bytes[1] >> RTP_HEADER_MARKER_SHIFT,
+        .payload_ty = bytes[1] & RTP_HEADER_PAYLOAD_TY_MASK,
+    };
+    memcpy(&h.sequence_number, bytes + 2, sizeof h.sequence_number);
+    memcpy(&h.timestamp, bytes + 4, sizeof h.timestamp);
+    memcpy(&h.ssrc, bytes + 8, sizeof h.ssrc);
+
+    size_t size = RTP_FIXED_HEADER_SIZE + h.csrc_count * sizeof(uint32_t);
+    if (packet->len < size) {
+        goto fail;
+    }
+    h.csrc = h.csrc_count > 0
+                 ? (uint32_t *)(void *)(packet->ptr + RTP_FIXED_HEADER_SIZE)
+                 : NULL;
+
+    if (h.extension) {
+        if (packet->len < size + RTP_EXTENSION_HEADER_SIZE) {
+            goto fail;
+        }
+        memcpy(&h.extension_profile, bytes + size, sizeof(uint16_t));
+        memcpy(&h.extension_payload_len, bytes + size + 2, sizeof(uint16_t));
+        size += RTP_EXTENSION_HEADER_SIZE;
+
+        const size_t words = (size_t)bytes[size - 2] << 8 | bytes[size - 1];
+        if (packet->len - size < words * sizeof(uint32_t)) {
+            goto fail;
+        }
+        h.extension_payload = packet->ptr + size;
+        size += words * sizeof(uint32_t);
+    }
+
+    U8Slice99 payload = U8Slice99_advance(*packet, size);
+    if (h.padding) {
+        const uint8_t padding = bytes[packet->len - 1];
+        if (0 == padding || padding > payload.len) {
+            goto fail;
+        }
+        payload.len -= padding;
+    }
+
+    *header = h;
+    *packet = payload;
+
+    return 0;
+
+fail:
+    errno = EBADMSG;
+    return -1;
+}
@@ -0,0 +1,409 @@
+#include "uring.h"
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+struct SmolRTSP_Uring {
+    int fd;
+
+    // The submission queue. `sq_tail` is advanced by us and `sq_head` by the
+    // kernel.
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, sq_entries;
+    struct io_uring_sqe *sqes;
+
+    // The completion queue. `cq_tail` is advanced by the kernel and `cq_head`
+    // by us.
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+
+    // The entries queued but not yet submitted, and the submitted ones whose
+    // completions have not been reaped yet.
+    unsigned to_submit;
+    size_t submitted;
+
+    // The pool of `buffers_count` buffers of `buffer_size` bytes each, which
+    // is registered as a single fixed buffer if `fixed` is set.
+    char *pool;
+    SmolRTSP_UringBuffer *buffers, *free_list;
+    size_t buffer_size, buffers_count, in_use;
+    bool fixed;
+
+    size_t errors;
+};
+
+static int setup(SmolRTSP_Uring *self, SmolRTSP_UringConfig config);
+static int map_rings(SmolRTSP_Uring *self, const struct io_uring_params *p);
+static void unmap_rings(SmolRTSP_Uring *self);
+static int enter(SmolRTSP_Uring *self, unsigned min_complete, unsigned flags);
+static void complete(SmolRTSP_Uring *self, const struct io_uring_cqe *cqe);
+
+SmolRTSP_UringConfig SmolRTSP_UringConfig_default(void) {
+    return (SmolRTSP_UringConfig){
+        .entries = 256,
+        .buffer_size = 2048,
+        .buffers_count = 1024,
+    };
+}
+
+SmolRTSP_Uring *SmolRTSP_Uring_new(SmolRTSP_UringConfig config) {
+    assert(config.entries > 0);
+    assert(config.buffer_size > 0);
+    assert(config.buffers_count > 0);
+
+    SmolRTSP_Uring *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(self, 0, sizeof *self);
+
+    self->pool = smolrtsp_malloc(config.buffers_count * config.buffer_size);
+    self->buffers =
+        smolrtsp_malloc(config.buffers_count * sizeof self->buffers[0]);
+    if (NULL == self->pool || NULL == self->buffers) {
+        smolrtsp_free(self->pool);
+        smolrtsp_free(self->buffers);
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (setup(self, config) == -1) {
+        const int error = errno;
+        smolrtsp_free(self->pool);
+        smolrtsp_free(self->buffers);
+        smolrtsp_free(self);
+        errno = error;
+        return NULL;
+    }
+
+    self->buffer_size = config.buffer_size;
+    self->buffers_count = config.buffers_count;
+    self->free_list = NULL;
+
+    for (size_t i = config.buffers_count; i > 0; i--) {
+        SmolRTSP_UringBuffer *buf = &self->buffers[i - 1];
+        buf->data = self->pool + (i - 1) * config.buffer_size;
+        buf->offset = buf->len = 0;
+        buf->writer = NULL;
+        buf->next = self->free_list;
+        self->free_list = buf;
+    }
+
+    // Without registration (e.g., due to `RLIMIT_MEMLOCK`), the kernel just
+    // maps the pages on every write.
+    const struct iovec pool_vec = {
+        .iov_base = self->pool,
+        .iov_len = config.buffers_count * config.buffer_size,
+    };
+    self->fixed = syscall(
+                      __NR_io_uring_register, self->fd,
+                      IORING_REGISTER_BUFFERS, &pool_vec, 1) == 0;
+
+    return self;
+}
+
+int SmolRTSP_Uring_submit(SmolRTSP_Uring *self) {
+    assert(self);
+
+    const unsigned to_submit = self->to_submit;
+
+    while (self->to_submit > 0) {
+        if (enter(self, 0, 0) == -1) {
+            return -1;
+        }
+    }
+
+    SmolRTSP_Uring_reap(self);
+
+    return (int)to_submit;
+}
+
+size_t SmolRTSP_Uring_reap(SmolRTSP_Uring *self) {
+    assert(self);
+
+    size_t reaped = 0;
+    unsigned head = *self->cq_head;
+
+    for (;;) {
+        const unsigned tail = __atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            break;
+        }
+
+        // Copy the entry out and return its slot to the kernel first, since
+        // completing a writer buffer can queue another write.
+        const struct io_uring_cqe cqe = self->cqes[head & *self->cq_mask];
+        head++;
+        __atomic_store_n(self->cq_head, head, __ATOMIC_RELEASE);
+
+        complete(self, &cqe);
+        reaped++;
+    }
+
+    return reaped;
+}
+
+int SmolRTSP_Uring_drain(SmolRTSP_Uring *self) {
+    assert(self);
+
+    while (self->to_submit > 0 || self->submitted > 0) {
+        if (enter(self, 1, IORING_ENTER_GETEVENTS) == -1) {
+            return -1;
+        }
+        SmolRTSP_Uring_reap(self);
+    }
+
+    return 0;
+}
+
+size_t SmolRTSP_Uring_in_flight(const SmolRTSP_Uring *self) {
+    assert(self);
+    return self->in_use;
+}
+
+size_t SmolRTSP_Uring_errors(const SmolRTSP_Uring *self) {
+    assert(self);
+    return self->errors;
+}
+
+static void SmolRTSP_Uring_drop(VSelf) {
+    VSELF(SmolRTSP_Uring);
+    assert(self);
+
+    // The kernel must not write from the pool after it has been freed.
+    while (SmolRTSP_Uring_drain(self) == -1 && EINTR == errno) {}
+
+    unmap_rings(self);
+    close(self->fd);
+
+    smolrtsp_free(self->buffers);
+    smolrtsp_free(self->pool);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Uring);
+
+size_t smolrtsp_uring_buffer_size(const SmolRTSP_Uring *ring) {
+    assert(ring);
+    return ring->buffer_size;
+}
+
+bool smolrtsp_uring_is_full(SmolRTSP_Uring *ring) {
+    assert(ring);
+
+    if (NULL == ring->free_list) {
+        SmolRTSP_Uring_reap(ring);
+    }
+
+    return NULL == ring->free_list;
+}
+
+SmolRTSP_UringBuffer *smolrtsp_uring_acquire(SmolRTSP_Uring *ring) {
+    assert(ring);
+
+    if (smolrtsp_uring_is_full(ring)) {
+        errno = ENOBUFS;
+        return NULL;
+    }
+
+    SmolRTSP_UringBuffer *buf = ring->free_list;
+    ring->free_list = buf->next;
+    ring->in_use++;
+
+    buf->offset = buf->len = 0;
+    buf->writer = NULL;
+    buf->next = NULL;
+
+    return buf;
+}
+
+void smolrtsp_uring_release(SmolRTSP_Uring *ring, SmolRTSP_UringBuffer *buf) {
+    assert(ring);
+    assert(buf);
+
+    buf->writer = NULL;
+    buf->next = ring->free_list;
+    ring->free_list = buf;
+    ring->in_use--;
+}
+
+int smolrtsp_uring_queue_write(
+    SmolRTSP_Uring *ring, int fd, SmolRTSP_UringBuffer *buf) {
+    assert(ring);
+    assert(fd >= 0);
+    assert(buf);
+    assert(buf->offset < buf->len);
+
+    unsigned tail = *ring->sq_tail;
+    while (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+           ring->sq_entries) {
+        // Reaping here could complete another writer in the middle of its
+        // write, so only make room in the submission queue.
+        if (enter(ring, 0, 0) == -1) {
+            return -1;
+        }
+    }
+
+    const unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof *sqe);
+
+    sqe->opcode = ring->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->off = (uint64_t)-1; // The current position, as if by `write`.
+    sqe->addr = (uint64_t)(uintptr_t)(buf->data + buf->offset);
+    sqe->len = (uint32_t)(buf->len - buf->offset);
+    sqe->buf_index = 0;
+    sqe->user_data = (uint64_t)(uintptr_t)buf;
+
+    ring->sq_array[index] = index;
+    tail++;
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    ring->to_submit++;
+
+    return 0;
+}
+
+static int setup(SmolRTSP_Uring *self, SmolRTSP_UringConfig config) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+
+    // Every buffer can be in flight at once, so make room for all their
+    // completions.
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = config.buffers_count > 2 * (size_t)config.entries
+                       ? (unsigned)config.buffers_count
+                       : 2 * config.entries;
+
+    self->fd = (int)syscall(__NR_io_uring_setup, config.entries, &p);
+    if (self->fd < 0) {
+        return -1;
+    }
+
+    if (map_rings(self, &p) == -1) {
+        const int error = errno;
+        close(self->fd);
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int map_rings(SmolRTSP_Uring *self, const struct io_uring_params *p) {
+    self->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    self->cq_ring_size =
+        p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    self->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (self->cq_ring_size > self->sq_ring_size) {
+            self->sq_ring_size = self->cq_ring_size;
+        }
+        self->cq_ring_size = 0;
+    }
+
+    self->sq_ring = mmap(
+        NULL, self->sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, self->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == self->sq_ring) {
+        return -1;
+    }
+
+    self->cq_ring = self->sq_ring;
+    if (self->cq_ring_size > 0) {
+        self->cq_ring = mmap(
+            NULL, self->cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, self->fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == self->cq_ring) {
+            munmap(self->sq_ring, self->sq_ring_size);
+            return -1;
+        }
+    }
+
+    self->sqes = mmap(
+        NULL, self->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, self->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == self->sqes) {
+        if (self->cq_ring_size > 0) {
+            munmap(self->cq_ring, self->cq_ring_size);
+        }
+        munmap(self->sq_ring, self->sq_ring_size);
+        return -1;
+    }
+
+    char *sq = self->sq_ring, *cq = self->cq_ring;
+
+    self->sq_head = (unsigned *)(sq + p->sq_off.head);
+    self->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+    self->sq_mask = (unsigned *)(sq + p->sq_off.ring_mask);
+    self->sq_array = (unsigned *)(sq + p->sq_off.array);
+    self->sq_entries = p->sq_entries;
+
+    self->cq_head = (unsigned *)(cq + p->cq_off.head);
+    self->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+    self->cq_mask = (unsigned *)(cq + p->cq_off.ring_mask);
+    self->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+
+    return 0;
+}
+
+static void unmap_rings(SmolRTSP_Uring *self) {
+    munmap(self->sqes, self->sqes_size);
+    if (self->cq_ring_size > 0) {
+        munmap(self->cq_ring, self->cq_ring_size);
+    }
+    munmap(self->sq_ring, self->sq_ring_size);
+}
+
+// Submits the queued entries and waits for `min_complete` completions.
+static int enter(SmolRTSP_Uring *self, unsigned min_complete, unsigned flags) {
+    int ret;
+    do {
+        ret = (int)syscall(
+            __NR_io_uring_enter, self->fd, self->to_submit, min_complete,
+            flags, NULL, 0);
+    } while (ret < 0 && EINTR == errno && self->to_submit > 0);
+
+    if (ret < 0) {
+        return -1;
+    }
+
+    self->to_submit -= (unsigned)ret;
+    self->submitted += (size_t)ret;
+
+    return 0;
+}
+
+static void complete(SmolRTSP_Uring *self, const struct io_uring_cqe *cqe) {
+    SmolRTSP_UringBuffer *buf =
+        (SmolRTSP_UringBuffer *)(uintptr_t)cqe->user_data;
+    self->submitted--;
+
+    if (buf->writer != NULL) {
+        smolrtsp_uring_writer_complete(buf->writer, buf, cqe->res);
+        return;
+    }
+
+    if (cqe->res < 0) {
+        self->errors++;
+    }
+    smolrtsp_uring_release(self, buf);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <smolrtsp/uring.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A packet buffer of `SmolRTSP_Uring`.
+ *
+ * The bytes `data[offset..len)` are still to be written. A buffer owned by a
+ * writer is linked into its chain; the completion of its write is reported to
+ * the writer, if it is still alive.
+ */
+typedef struct SmolRTSP_UringBuffer {
+    char *data;
+    size_t offset, len;
+
+    struct SmolRTSP_UringWriter *writer;
+    struct SmolRTSP_UringBuffer *next;
+} SmolRTSP_UringBuffer;
+
+// The size of every buffer of `ring`.
+size_t smolrtsp_uring_buffer_size(const SmolRTSP_Uring *ring);
+
+// Whether all the buffers of `ring` are in use, reaping completions if so.
+bool smolrtsp_uring_is_full(SmolRTSP_Uring *ring);
+
+// Takes a free buffer, reaping completions if there is none. Returns `NULL`
+// and sets `errno` to `ENOBUFS` if all of them are still in use.
+SmolRTSP_UringBuffer *smolrtsp_uring_acquire(SmolRTSP_Uring *ring);
+
+// Returns `buf` to the pool.
+void smolrtsp_uring_release(SmolRTSP_Uring *ring, SmolRTSP_UringBuffer *buf);
+
+// Queues a write of the pending bytes of `buf` to `fd`, submitting the queued
+// entries first if the submission queue is full.
+int smolrtsp_uring_queue_write(
+    SmolRTSP_Uring *ring, int fd, SmolRTSP_UringBuffer *buf);
+
+// Handles the result `res` of the write of `buf`, which belongs to `writer`.
+// Defined in `writer/uring.c`.
+void smolrtsp_uring_writer_complete(
+    struct SmolRTSP_UringWriter *writer, SmolRTSP_UringBuffer *buf, int res);
@@ -1,12 +1,12 @@
 #include <smolrtsp/util.h>
 
+#include "types/parsing.h"
+
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include <string.h>
 
-#include <alloca.h>
 #include <arpa/inet.h>
 
 const char *SmolRTSP_LowerTransport_str(SmolRTSP_LowerTransport self) {
@@ -20,107 +20,218 @@ const char *SmolRTSP_LowerTransport_str(SmolRTSP_LowerTransport self) {
     }
 }
 
-#define PARSE_RANGE(lhs, rhs, specifier, param)                                \
-    sscanf((param), "%*[^=]=%" specifier "-%" specifier, &(lhs), &(rhs))
-#define STARTS_WITH(str, beginning)                                            \
-    (strncmp((str), (beginning), strlen(beginning)) == 0)
-
+static CharSlice99 next_token(CharSlice99 *restrict input, char delimiter);
 static int parse_lower_transport(
-    SmolRTSP_TransportConfig *restrict result, const char *header_value);
+    SmolRTSP_TransportConfig *restrict result, CharSlice99 protocol);
 static int parse_transport_param(
-    SmolRTSP_TransportConfig *restrict result, const char *param);
-static int parse_channel_pair(
-    SmolRTSP_ChannelPair *restrict val, const char *restrict param);
+    SmolRTSP_TransportConfig *restrict result, CharSlice99 param);
+static int parse_range(
+    CharSlice99 value, uint64_t max, uint64_t *restrict lhs,
+    uint64_t *restrict rhs);
 static int
-parse_port_pair(SmolRTSP_PortPair *restrict val, const char *restrict param);
+parse_channel_pair(SmolRTSP_ChannelPair *restrict val, CharSlice99 value);
+static int parse_port_pair(SmolRTSP_PortPair *restrict val, CharSlice99 value);
+static int parse_ssrc(uint32_t *restrict val, CharSlice99 value);
+static CharSlice99 unquote(CharSlice99 value);
+static int parse_npt_time(
+    CharSlice99 value, bool *restrict is_now, uint64_t *restrict ms);
 
 int smolrtsp_parse_transport(
     SmolRTSP_TransportConfig *restrict config, CharSlice99 header_value) {
     assert(config);
 
+    const int ret = smolrtsp_parse_transport_next(config, &header_value);
+    return 1 == ret ? 0 : -1;
+}
+
+int smolrtsp_parse_transport_next(
+    SmolRTSP_TransportConfig *restrict config,
+    CharSlice99 *restrict header_value) {
+    assert(config);
+    assert(header_value);
+
+    if (CharSlice99_is_empty(smolrtsp_trim(*header_value))) {
+        return 0;
+    }
+
+    CharSlice99 rest = *header_value;
+    CharSlice99 spec = next_token(&rest, ',');
+
     SmolRTSP_TransportConfig result = {
         .lower = 0,
+        .secure = false,
         .unicast = false,
         .multicast = false,
         .interleaved = SmolRTSP_ChannelPair_None(),
         .client_port = SmolRTSP_PortPair_None(),
+        .server_port = SmolRTSP_PortPair_None(),
+        .port = SmolRTSP_PortPair_None(),
+        .destination = CharSlice99_empty(),
+        .source = CharSlice99_empty(),
+        .ttl = SmolRTSP_U8_None(),
+        .layers = SmolRTSP_U32_None(),
+        .ssrc = SmolRTSP_U32_None(),
+        .mode = CharSlice99_empty(),
+        .append = false,
     };
 
-    const char *input = CharSlice99_alloca_c_str(header_value);
-
-    if (parse_lower_transport(&result, input) == -1) {
+    if (parse_lower_transport(&result, next_token(&spec, ';')) == -1) {
         return -1;
     }
-    if ((input = strchr(input, ';')) == NULL) {
-        goto success;
-    }
-    input++;
-
-    while (input != NULL) {
-        const char *next_param = strchr(input, ';');
-        const CharSlice99 param =
-            NULL == next_param
-                ? CharSlice99_from_str((char *)input)
-                : CharSlice99_from_ptrdiff((char *)input, (char *)next_param);
 
-        if (parse_transport_param(&result, CharSlice99_alloca_c_str(param)) ==
-            -1) {
+    while (!CharSlice99_is_empty(spec)) {
+        if (parse_transport_param(&result, next_token(&spec, ';')) == -1) {
             return -1;
         }
-
-        input = next_param != NULL ? next_param + 1 : NULL;
     }
 
-success:
     *config = result;
-    return 0;
+    *header_value = rest;
+    return 1;
 }
 
-static int parse_lower_transport(
-    SmolRTSP_TransportConfig *restrict result, const char *header_value) {
-    const char *rtp_avp = "RTP/AVP";
-    if (strncmp(header_value, rtp_avp, strlen(rtp_avp)) != 0) {
-        return -1;
+// Returns the part of `*input` before the first `delimiter` outside double
+// quotes, without the surrounding blanks, and advances `*input` past the
+// delimiter.
+static CharSlice99 next_token(CharSlice99 *restrict input, char delimiter) {
+    bool quoted = false;
+    size_t i = 0;
+
+    for (; i < input->len; i++) {
+        const char c = input->ptr[i];
+        if ('"' == c) {
+            quoted = !quoted;
+        } else if (delimiter == c && !quoted) {
+            break;
+        }
     }
-    header_value += strlen(rtp_avp);
 
-    if (strncmp(header_value, "/TCP", strlen("/TCP")) == 0) {
+    const CharSlice99 token = CharSlice99_sub(*input, 0, i);
+    *input = CharSlice99_advance(*input, i < input->len ? i + 1 : i);
+
+    return smolrtsp_trim(token);
+}
+
+static int parse_lower_transport(
+    SmolRTSP_TransportConfig *restrict result, CharSlice99 protocol) {
+    if (smolrtsp_eq_ignore_case(protocol, CharSlice99_from_str("RTP/AVP")) ||
+        smolrtsp_eq_ignore_case(
+            protocol, CharSlice99_from_str("RTP/AVP/UDP"))) {
+        result->lower = SmolRTSP_LowerTransport_UDP;
+    } else if (smolrtsp_eq_ignore_case(
+                   protocol, CharSlice99_from_str("RTP/AVP/TCP"))) {
         result->lower = SmolRTSP_LowerTransport_TCP;
-    } else if (strncmp(header_value, "/UDP", strlen("/UDP")) == 0) {
+    } else if (
+        smolrtsp_eq_ignore_case(protocol, CharSlice99_from_str("RTP/SAVP")) ||
+        smolrtsp_eq_ignore_case(
+            protocol, CharSlice99_from_str("RTP/SAVP/UDP"))) {
         result->lower = SmolRTSP_LowerTransport_UDP;
+        result->secure = true;
+    } else if (smolrtsp_eq_ignore_case(
+                   protocol, CharSlice99_from_str("RTP/SAVP/TCP"))) {
+        result->lower = SmolRTSP_LowerTransport_TCP;
+        result->secure = true;
     } else {
-        result->lower = SmolRTSP_LowerTransport_UDP;
+        return -1;
     }
 
     return 0;
 }
 
 static int parse_transport_param(
-    SmolRTSP_TransportConfig *restrict result, const char *param) {
-    if (STARTS_WITH(param, "unicast")) {
+    SmolRTSP_TransportConfig *restrict result, CharSlice99 param) {
+    CharSlice99 name = param, value = CharSlice99_empty();
+
+    const char *eq =
+        CharSlice99_is_empty(param) ? NULL : memchr(param.ptr, '=', param.len);
+    if (eq != NULL) {
+        const size_t eq_idx = (size_t)(eq - param.ptr);
+        name = smolrtsp_trim(CharSlice99_sub(param, 0, eq_idx));
+        value = smolrtsp_trim(CharSlice99_advance(param, eq_idx + 1));
+    }
+
+#define IS(expected)                                                           \
+    smolrtsp_eq_ignore_case(name, CharSlice99_from_str(expected))
+
+    if (IS("unicast")) {
         result->unicast = true;
-    } else if (STARTS_WITH(param, "multicast")) {
+    } else if (IS("multicast")) {
         result->multicast = true;
-    } else if (STARTS_WITH(param, "interleaved")) {
+    } else if (IS("append")) {
+        result->append = true;
+    } else if (IS("interleaved")) {
         SmolRTSP_ChannelPair val;
-        if (parse_channel_pair(&val, param) == -1) {
+        if (parse_channel_pair(&val, value) == -1) {
             return -1;
         }
         result->interleaved = SmolRTSP_ChannelPair_Some(val);
-    } else if (STARTS_WITH(param, "client_port")) {
+    } else if (IS("client_port") || IS("server_port") || IS("port")) {
         SmolRTSP_PortPair val;
-        if (parse_port_pair(&val, param) == -1) {
+        if (parse_port_pair(&val, value) == -1) {
             return -1;
         }
-        result->client_port = SmolRTSP_PortPair_Some(val);
+
+        const SmolRTSP_PortPairOption port = SmolRTSP_PortPair_Some(val);
+        if (IS("client_port")) {
+            result->client_port = port;
+        } else if (IS("server_port")) {
+            result->server_port = port;
+        } else {
+            result->port = port;
+        }
+    } else if (IS("destination")) {
+        result->destination = value;
+    } else if (IS("source")) {
+        result->source = value;
+    } else if (IS("ttl")) {
+        uint64_t ttl;
+        if (!smolrtsp_parse_uint(value, UINT8_MAX, &ttl)) {
+            return -1;
+        }
+        result->ttl = SmolRTSP_U8_Some((uint8_t)ttl);
+    } else if (IS("layers")) {
+        uint64_t layers;
+        if (!smolrtsp_parse_uint(value, UINT32_MAX, &layers)) {
+            return -1;
+        }
+        result->layers = SmolRTSP_U32_Some((uint32_t)layers);
+    } else if (IS("ssrc")) {
+        uint32_t ssrc;
+        if (parse_ssrc(&ssrc, value) == -1) {
+            return -1;
+        }
+        result->ssrc = SmolRTSP_U32_Some(ssrc);
+    } else if (IS("mode")) {
+        result->mode = unquote(value);
     }
 
+#undef IS
+
     return 0;
 }
 
-static int parse_channel_pair(
-    SmolRTSP_ChannelPair *restrict val, const char *restrict param) {
-    if (PARSE_RANGE(val->rtp_channel, val->rtcp_channel, SCNu8, param) != 2) {
+// Parses `value` of the form `lhs-rhs`, or `lhs` meaning `lhs-(lhs + 1)`.
+static int parse_range(
+    CharSlice99 value, uint64_t max, uint64_t *restrict lhs,
+    uint64_t *restrict rhs) {
+    const char *dash =
+        CharSlice99_is_empty(value) ? NULL : memchr(value.ptr, '-', value.len);
+
+    if (NULL == dash) {
+        if (!smolrtsp_parse_uint(value, max - 1, lhs)) {
+            return -1;
+        }
+
+        *rhs = *lhs + 1;
+        return 0;
+    }
+
+    const size_t dash_idx = (size_t)(dash - value.ptr);
+    const CharSlice99 lhs_str = CharSlice99_sub(value, 0, dash_idx),
+                      rhs_str = CharSlice99_advance(value, dash_idx + 1);
+
+    if (!smolrtsp_parse_uint(lhs_str, max, lhs) ||
+        !smolrtsp_parse_uint(rhs_str, max, rhs)) {
         return -1;
     }
 
@@ -128,11 +239,185 @@ static int parse_channel_pair(
 }
 
 static int
-parse_port_pair(SmolRTSP_PortPair *restrict val, const char *restrict param) {
-    if (PARSE_RANGE(val->rtp_port, val->rtcp_port, SCNu16, param) != 2) {
+parse_channel_pair(SmolRTSP_ChannelPair *restrict val, CharSlice99 value) {
+    uint64_t rtp_channel, rtcp_channel;
+    if (parse_range(value, UINT8_MAX, &rtp_channel, &rtcp_channel) == -1) {
+        return -1;
+    }
+
+    val->rtp_channel = (uint8_t)rtp_channel;
+    val->rtcp_channel = (uint8_t)rtcp_channel;
+
+    return 0;
+}
+
+static int parse_port_pair(SmolRTSP_PortPair *restrict val, CharSlice99 value) {
+    uint64_t rtp_port, rtcp_port;
+    if (parse_range(value, UINT16_MAX, &rtp_port, &rtcp_port) == -1) {
         return -1;
     }
 
+    val->rtp_port = (uint16_t)rtp_port;
+    val->rtcp_port = (uint16_t)rtcp_port;
+
+    return 0;
+}
+
+// Parses `value` of the form `8*8(HEX)`, allowing fewer digits as many clients
+// do.
+static int parse_ssrc(uint32_t *restrict val, CharSlice99 value) {
+    if (CharSlice99_is_empty(value) || value.len > 2 * sizeof(uint32_t)) {
+        return -1;
+    }
+
+    uint32_t ssrc = 0;
+    for (size_t i = 0; i < value.len; i++) {
+        const char c = value.ptr[i];
+        uint32_t digit;
+
+        if (c >= '0' && c <= '9') {
+            digit = (uint32_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (uint32_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            digit = (uint32_t)(c - 'A' + 10);
+        } else {
+            return -1;
+        }
+
+        ssrc = (ssrc << 4) | digit;
+    }
+
+    *val = ssrc;
+    return 0;
+}
+
+static CharSlice99 unquote(CharSlice99 value) {
+    if (value.len >= 2 && '"' == value.ptr[0] &&
+        '"' == value.ptr[value.len - 1]) {
+        return CharSlice99_sub(value, 1, value.len - 1);
+    }
+
+    return value;
+}
+
+int smolrtsp_parse_npt_range(
+    SmolRTSP_NptRange *restrict range, CharSlice99 header_value) {
+    assert(range);
+
+    // The `;time=` parameter.
+    CharSlice99 value = smolrtsp_trim(next_token(&header_value, ';'));
+
+    static const char prefix[] = "npt";
+    if (value.len < sizeof prefix - 1 ||
+        memcmp(value.ptr, prefix, sizeof prefix - 1) != 0) {
+        return -1;
+    }
+    value = smolrtsp_trim(CharSlice99_advance(value, sizeof prefix - 1));
+    if (CharSlice99_is_empty(value) || value.ptr[0] != '=') {
+        return -1;
+    }
+    value = CharSlice99_advance(value, 1);
+
+    const char *dash =
+        CharSlice99_is_empty(value) ? NULL : memchr(value.ptr, '-', value.len);
+    if (NULL == dash) {
+        return -1;
+    }
+
+    const size_t dash_idx = (size_t)(dash - value.ptr);
+    const CharSlice99
+        start = smolrtsp_trim(CharSlice99_sub(value, 0, dash_idx)),
+        end = smolrtsp_trim(CharSlice99_advance(value, dash_idx + 1));
+
+    SmolRTSP_NptRange result = {0};
+
+    // `-npt-time` starts at the beginning.
+    if (!CharSlice99_is_empty(start) &&
+        parse_npt_time(start, &result.start_is_now, &result.start_ms) == -1) {
+        return -1;
+    }
+
+    if (!CharSlice99_is_empty(end)) {
+        bool end_is_now;
+        if (parse_npt_time(end, &end_is_now, &result.end_ms) == -1 ||
+            end_is_now) {
+            return -1;
+        }
+        result.has_end = true;
+    } else if (CharSlice99_is_empty(start)) {
+        return -1;
+    }
+
+    *range = result;
+    return 0;
+}
+
+// Parses `now`, `npt-sec` (`12.5`), or `npt-hhmmss` (`1:02:03.5`).
+static int parse_npt_time(
+    CharSlice99 value, bool *restrict is_now, uint64_t *restrict ms) {
+    if (CharSlice99_primitive_eq(value, CharSlice99_from_str("now"))) {
+        *is_now = true;
+        *ms = 0;
+        return 0;
+    }
+
+    CharSlice99 fraction = CharSlice99_empty();
+    const char *dot = memchr(value.ptr, '.', value.len);
+    if (dot != NULL) {
+        const size_t dot_idx = (size_t)(dot - value.ptr);
+        fraction = CharSlice99_advance(value, dot_idx + 1);
+        value = CharSlice99_sub(value, 0, dot_idx);
+    }
+
+    // Up to three colon-separated fields; the hours are unbounded.
+    uint64_t fields[3];
+    size_t fields_count = 0;
+    for (;;) {
+        const char *colon =
+            CharSlice99_is_empty(value) ? NULL
+                                        : memchr(value.ptr, ':', value.len);
+        const CharSlice99 field =
+            NULL == colon
+                ? value
+                : CharSlice99_sub(value, 0, (size_t)(colon - value.ptr));
+
+        if (3 == fields_count ||
+            !smolrtsp_parse_uint(
+                field, 0 == fields_count ? UINT32_MAX : 59,
+                &fields[fields_count])) {
+            return -1;
+        }
+        fields_count++;
+
+        if (NULL == colon) {
+            break;
+        }
+        value = CharSlice99_advance(value, field.len + 1);
+    }
+
+    if (2 == fields_count) {
+        return -1;
+    }
+
+    uint64_t seconds = fields[0];
+    if (3 == fields_count) {
+        seconds = fields[0] * 3600 + fields[1] * 60 + fields[2];
+    }
+
+    uint64_t millis = 0;
+    for (size_t i = 0; i < fraction.len; i++) {
+        const char c = fraction.ptr[i];
+        if (c < '0' || c > '9') {
+            return -1;
+        }
+        if (i < 3) {
+            millis += (uint64_t)(c - '0') * (0 == i ? 100 : 1 == i ? 10 : 1);
+        }
+    }
+
+    *is_now = false;
+    *ms = seconds * 1000 + millis;
     return 0;
 }
 
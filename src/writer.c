@@ -3,6 +3,7 @@
 #include "macros.h"
 
 #include <assert.h>
+#include <errno.h>
 
 ssize_t smolrtsp_write_slices(
     SmolRTSP_Writer w, size_t len,
@@ -18,3 +19,73 @@ ssize_t smolrtsp_write_slices(
 
     return result;
 }
+
+ssize_t SmolRTSP_Writer_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(void);
+    (void)self;
+    (void)bufs;
+
+    errno = ENOSYS;
+    return -1;
+}
+
+char *SmolRTSP_Writer_reserve(VSelf, size_t len) {
+    VSELF(void);
+    (void)self;
+    (void)len;
+
+    errno = ENOSYS;
+    return NULL;
+}
+
+void SmolRTSP_Writer_commit(VSelf, size_t len) {
+    VSELF(void);
+    (void)self;
+    (void)len;
+}
+
+ssize_t smolrtsp_writev(SmolRTSP_Writer w, SmolRTSP_IoVecSlice bufs) {
+    assert(w.self && w.vptr);
+
+    const ssize_t ret = VCALL(w, writev, bufs);
+    if (ret != -1 || errno != ENOSYS) {
+        return ret;
+    }
+
+    ssize_t result = 0;
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        const CharSlice99 vec =
+            CharSlice99_new(bufs.ptr[i].iov_base, bufs.ptr[i].iov_len);
+        CHK_WRITE_ERR(result, VCALL(w, write, vec));
+    }
+
+    return result;
+}
+
+ssize_t smolrtsp_write_uint(SmolRTSP_Writer w, uint64_t value) {
+    assert(w.self && w.vptr);
+
+    size_t len = 1;
+    for (uint64_t rest = value / 10; rest > 0; rest /= 10) {
+        len++;
+    }
+
+    char digits[20];
+    char *space = VCALL(w, reserve, len);
+    if (NULL == space) {
+        space = digits;
+    }
+
+    for (size_t i = len; i > 0; i--) {
+        space[i - 1] = (char)('0' + value % 10);
+        value /= 10;
+    }
+
+    if (space == digits) {
+        return VCALL(w, write, CharSlice99_new(digits, len));
+    }
+
+    VCALL(w, commit, len);
+    return (ssize_t)len;
+}
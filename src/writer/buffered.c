@@ -0,0 +1,199 @@
+#include <smolrtsp/writer.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <alloca.h>
+#include <sys/uio.h>
+
+static ssize_t
+flush_with(SmolRTSP_BufferedWriter *self, SmolRTSP_IoVecSlice bufs);
+static size_t total_len(SmolRTSP_IoVecSlice bufs);
+
+SmolRTSP_BufferedWriter SmolRTSP_BufferedWriter_new(
+    SmolRTSP_Writer inner, char *buffer, size_t capacity) {
+    assert(inner.self && inner.vptr);
+    assert(buffer);
+
+    return (SmolRTSP_BufferedWriter){
+        .inner = inner,
+        .buffer = buffer,
+        .capacity = capacity,
+        .len = 0,
+    };
+}
+
+ssize_t SmolRTSP_BufferedWriter_flush(SmolRTSP_BufferedWriter *self) {
+    assert(self);
+    return flush_with(self, SmolRTSP_IoVecSlice_empty());
+}
+
+typedef SmolRTSP_BufferedWriter BufferedWriter;
+
+#define BufferedWriter_writev_CUSTOM ()
+static ssize_t BufferedWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    const size_t len = total_len(bufs);
+
+    if (len > self->capacity - self->len) {
+        const ssize_t ret = flush_with(self, bufs);
+        return ret < 0 ? ret : (ssize_t)len;
+    }
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        memcpy(self->buffer + self->len, bufs.ptr[i].iov_base,
+               bufs.ptr[i].iov_len);
+        self->len += bufs.ptr[i].iov_len;
+    }
+
+    return (ssize_t)len;
+}
+
+static ssize_t BufferedWriter_write(VSelf, CharSlice99 data) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    struct iovec vec = {.iov_base = data.ptr, .iov_len = data.len};
+    return BufferedWriter_writev(self, SmolRTSP_IoVecSlice_new(&vec, 1));
+}
+
+#define BufferedWriter_reserve_CUSTOM ()
+static char *BufferedWriter_reserve(VSelf, size_t len) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    if (len > self->capacity - self->len &&
+        SmolRTSP_BufferedWriter_flush(self) < 0) {
+        return NULL;
+    }
+    if (len > self->capacity) {
+        errno = ENOBUFS;
+        return NULL;
+    }
+
+    return self->buffer + self->len;
+}
+
+#define BufferedWriter_commit_CUSTOM ()
+static void BufferedWriter_commit(VSelf, size_t len) {
+    VSELF(BufferedWriter);
+    assert(self);
+    assert(len <= self->capacity - self->len);
+
+    self->len += len;
+}
+
+static void BufferedWriter_lock(VSelf) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    VCALL(self->inner, lock);
+}
+
+static void BufferedWriter_unlock(VSelf) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    VCALL(self->inner, unlock);
+}
+
+static size_t BufferedWriter_filled(VSelf) {
+    VSELF(BufferedWriter);
+    assert(self);
+
+    return VCALL(self->inner, filled) + self->len;
+}
+
+static int BufferedWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
+    VSELF(BufferedWriter);
+
+    assert(self);
+    assert(fmt);
+
+    // `vsnprintf` needs room for the null character, which is then
+    // overwritten by the next write.
+    va_list ap_copy;
+    va_copy(ap_copy, ap);
+    const int ret = vsnprintf(
+        self->buffer + self->len, self->capacity - self->len, fmt, ap_copy);
+    va_end(ap_copy);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if ((size_t)ret < self->capacity - self->len) {
+        self->len += (size_t)ret;
+        return ret;
+    }
+
+    if (SmolRTSP_BufferedWriter_flush(self) < 0) {
+        return -1;
+    }
+    if ((size_t)ret < self->capacity) {
+        self->len = (size_t)vsnprintf(self->buffer, self->capacity, fmt, ap);
+        return ret;
+    }
+
+    return VCALL(self->inner, vwritef, fmt, ap);
+}
+
+static int BufferedWriter_writef(VSelf, const char *restrict fmt, ...) {
+    VSELF(BufferedWriter);
+
+    assert(self);
+    assert(fmt);
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    const int ret = BufferedWriter_vwritef(self, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+impl(SmolRTSP_Writer, BufferedWriter);
+
+SmolRTSP_Writer smolrtsp_buffered_writer(SmolRTSP_BufferedWriter *self) {
+    assert(self);
+    return DYN(BufferedWriter, SmolRTSP_Writer, self);
+}
+
+// Writes the pending data followed by `bufs` in a single vectored write.
+static ssize_t
+flush_with(SmolRTSP_BufferedWriter *self, SmolRTSP_IoVecSlice bufs) {
+    struct iovec *vecs = alloca(sizeof(struct iovec) * (bufs.len + 1));
+    size_t vecs_len = 0;
+
+    if (self->len > 0) {
+        vecs[vecs_len++] =
+            (struct iovec){.iov_base = self->buffer, .iov_len = self->len};
+    }
+    for (size_t i = 0; i < bufs.len; i++) {
+        if (bufs.ptr[i].iov_len > 0) {
+            vecs[vecs_len++] = bufs.ptr[i];
+        }
+    }
+
+    self->len = 0;
+
+    if (0 == vecs_len) {
+        return 0;
+    }
+
+    return smolrtsp_writev(
+        self->inner, SmolRTSP_IoVecSlice_new(vecs, vecs_len));
+}
+
+static size_t total_len(SmolRTSP_IoVecSlice bufs) {
+    size_t len = 0;
+    for (size_t i = 0; i < bufs.len; i++) {
+        len += bufs.ptr[i].iov_len;
+    }
+
+    return len;
+}
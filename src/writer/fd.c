@@ -2,6 +2,13 @@
 
 #include <assert.h>
 
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
 typedef int FdWriter;
 
 static ssize_t FdWriter_write(VSelf, CharSlice99 data) {
@@ -11,6 +18,14 @@ static ssize_t FdWriter_write(VSelf, CharSlice99 data) {
     return write(*self, data.ptr, data.len);
 }
 
+#define FdWriter_writev_CUSTOM ()
+static ssize_t FdWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(FdWriter);
+    assert(self);
+
+    return writev(*self, bufs.ptr, bufs.len);
+}
+
 static void FdWriter_lock(VSelf) {
     VSELF(FdWriter);
     (void)self;
@@ -23,8 +38,9 @@ static void FdWriter_unlock(VSelf) {
 
 static size_t FdWriter_filled(VSelf) {
     VSELF(FdWriter);
-    (void)self;
-    return 0;
+    assert(self);
+
+    return smolrtsp_fd_unsent_bytes(*self);
 }
 
 static int FdWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
@@ -57,3 +73,21 @@ SmolRTSP_Writer smolrtsp_fd_writer(int *fd) {
     assert(fd);
     return DYN(FdWriter, SmolRTSP_Writer, fd);
 }
+
+size_t smolrtsp_fd_unsent_bytes(int fd) {
+    int unsent = 0;
+
+#if defined(SIOCOUTQ)
+    if (ioctl(fd, SIOCOUTQ, &unsent) == -1) {
+        return 0;
+    }
+#elif defined(TIOCOUTQ)
+    if (ioctl(fd, TIOCOUTQ, &unsent) == -1) {
+        return 0;
+    }
+#else
+    (void)fd;
+#endif
+
+    return unsent > 0 ? (size_t)unsent : 0;
+}
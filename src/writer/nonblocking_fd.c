@@ -0,0 +1,250 @@
+#include <smolrtsp/writer.h>
+
+#include "../alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/uio.h>
+
+// The size of the on-stack buffer that most formatted strings fit into.
+#define FORMAT_BUFFER_SIZE 512
+
+static bool would_block(void);
+static bool reserve_buffer(SmolRTSP_NonblockingFdWriter *self);
+static void buffer_from(
+    SmolRTSP_NonblockingFdWriter *self, SmolRTSP_IoVecSlice bufs, size_t skip);
+
+SmolRTSP_NonblockingFdWriter SmolRTSP_NonblockingFdWriter_new(
+    int fd, char *buffer, size_t capacity) {
+    assert(buffer);
+
+    return (SmolRTSP_NonblockingFdWriter){
+        .fd = fd,
+        .buffer = buffer,
+        .capacity = capacity,
+        .len = 0,
+        .lazy = false,
+    };
+}
+
+SmolRTSP_NonblockingFdWriter
+SmolRTSP_NonblockingFdWriter_new_lazy(int fd, size_t capacity) {
+    return (SmolRTSP_NonblockingFdWriter){
+        .fd = fd,
+        .buffer = NULL,
+        .capacity = capacity,
+        .len = 0,
+        .lazy = true,
+    };
+}
+
+void SmolRTSP_NonblockingFdWriter_release(SmolRTSP_NonblockingFdWriter *self) {
+    assert(self);
+
+    if (self->lazy) {
+        smolrtsp_free(self->buffer);
+        self->buffer = NULL;
+        self->len = 0;
+    }
+}
+
+ssize_t SmolRTSP_NonblockingFdWriter_flush(SmolRTSP_NonblockingFdWriter *self) {
+    assert(self);
+
+    while (self->len > 0) {
+        const ssize_t ret = write(self->fd, self->buffer, self->len);
+        if (ret < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return would_block() ? (ssize_t)self->len : -1;
+        }
+
+        memmove(self->buffer, self->buffer + ret, self->len - (size_t)ret);
+        self->len -= (size_t)ret;
+    }
+
+    SmolRTSP_NonblockingFdWriter_release(self);
+
+    return 0;
+}
+
+typedef SmolRTSP_NonblockingFdWriter NonblockingFdWriter;
+
+#define NonblockingFdWriter_writev_CUSTOM ()
+static ssize_t NonblockingFdWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(NonblockingFdWriter);
+    assert(self);
+
+    const size_t total = SmolRTSP_IoVecSlice_len(bufs);
+
+    // The pending data must go first to keep the stream in order.
+    if (SmolRTSP_NonblockingFdWriter_flush(self) < 0) {
+        return -1;
+    }
+
+    if (self->len > 0) {
+        if (total > self->capacity - self->len) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        buffer_from(self, bufs, 0);
+        return (ssize_t)total;
+    }
+
+    ssize_t sent;
+    do {
+        sent = writev(self->fd, bufs.ptr, bufs.len);
+    } while (sent < 0 && EINTR == errno);
+
+    if (sent < 0) {
+        if (!would_block()) {
+            return -1;
+        }
+        sent = 0;
+    }
+
+    const size_t rest = total - (size_t)sent;
+    if (0 == rest) {
+        return (ssize_t)total;
+    }
+
+    if (rest > self->capacity || !reserve_buffer(self)) {
+        // Nothing has been sent, so the message can still be rejected as a
+        // whole; otherwise, report a partial write.
+        if (0 == sent) {
+            errno = rest > self->capacity ? EAGAIN : ENOMEM;
+            return -1;
+        }
+        return sent;
+    }
+
+    buffer_from(self, bufs, (size_t)sent);
+    return (ssize_t)total;
+}
+
+static ssize_t NonblockingFdWriter_write(VSelf, CharSlice99 data) {
+    VSELF(NonblockingFdWriter);
+    assert(self);
+
+    struct iovec vec = {.iov_base = data.ptr, .iov_len = data.len};
+    return NonblockingFdWriter_writev(self, SmolRTSP_IoVecSlice_new(&vec, 1));
+}
+
+static void NonblockingFdWriter_lock(VSelf) {
+    VSELF(NonblockingFdWriter);
+    (void)self;
+}
+
+static void NonblockingFdWriter_unlock(VSelf) {
+    VSELF(NonblockingFdWriter);
+    (void)self;
+}
+
+static size_t NonblockingFdWriter_filled(VSelf) {
+    VSELF(NonblockingFdWriter);
+    assert(self);
+
+    return self->len + smolrtsp_fd_unsent_bytes(self->fd);
+}
+
+static int
+NonblockingFdWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
+    VSELF(NonblockingFdWriter);
+
+    assert(self);
+    assert(fmt);
+
+    // The string is formatted first, so that it is written as a single
+    // message.
+    char stack_buffer[FORMAT_BUFFER_SIZE];
+    char *str = stack_buffer;
+
+    va_list ap_copy;
+    va_copy(ap_copy, ap);
+    const int len = vsnprintf(str, sizeof stack_buffer, fmt, ap_copy);
+    va_end(ap_copy);
+
+    if (len < 0) {
+        return len;
+    }
+    if ((size_t)len >= sizeof stack_buffer) {
+        str = smolrtsp_malloc((size_t)len + 1 /* null character */);
+        if (NULL == str) {
+            errno = ENOMEM;
+            return -1;
+        }
+        vsnprintf(str, (size_t)len + 1, fmt, ap);
+    }
+
+    const ssize_t ret =
+        NonblockingFdWriter_write(self, CharSlice99_new(str, (size_t)len));
+
+    if (str != stack_buffer) {
+        smolrtsp_free(str);
+    }
+
+    return (int)ret;
+}
+
+static int NonblockingFdWriter_writef(VSelf, const char *restrict fmt, ...) {
+    VSELF(NonblockingFdWriter);
+
+    assert(self);
+    assert(fmt);
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    const int ret = NonblockingFdWriter_vwritef(self, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+impl(SmolRTSP_Writer, NonblockingFdWriter);
+
+SmolRTSP_Writer
+smolrtsp_nonblocking_fd_writer(SmolRTSP_NonblockingFdWriter *self) {
+    assert(self);
+    return DYN(NonblockingFdWriter, SmolRTSP_Writer, self);
+}
+
+static bool would_block(void) {
+    return EAGAIN == errno || EWOULDBLOCK == errno;
+}
+
+static bool reserve_buffer(SmolRTSP_NonblockingFdWriter *self) {
+    if (NULL == self->buffer) {
+        assert(self->lazy);
+        self->buffer = smolrtsp_malloc(self->capacity);
+    }
+
+    return self->buffer != NULL;
+}
+
+// Appends `bufs` without their first `skip` bytes to the pending data.
+static void buffer_from(
+    SmolRTSP_NonblockingFdWriter *self, SmolRTSP_IoVecSlice bufs, size_t skip) {
+    for (size_t i = 0; i < bufs.len; i++) {
+        const size_t vec_len = bufs.ptr[i].iov_len;
+        if (skip >= vec_len) {
+            skip -= vec_len;
+            continue;
+        }
+
+        const size_t n = vec_len - skip;
+        assert(n <= self->capacity - self->len);
+        memcpy(
+            self->buffer + self->len, (const char *)bufs.ptr[i].iov_base + skip,
+            n);
+        self->len += n;
+        skip = 0;
+    }
+}
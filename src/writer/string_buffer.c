@@ -0,0 +1,159 @@
+#include <smolrtsp/writer.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/uio.h>
+
+static size_t space_left(const SmolRTSP_StringBuffer *self);
+
+SmolRTSP_StringBuffer SmolRTSP_StringBuffer_new(char *buffer, size_t capacity) {
+    assert(buffer);
+    assert(capacity > 0);
+
+    buffer[0] = '\0';
+
+    return (SmolRTSP_StringBuffer){
+        .buffer = buffer,
+        .capacity = capacity,
+        .len = 0,
+        .truncated = false,
+    };
+}
+
+CharSlice99 SmolRTSP_StringBuffer_as_slice(const SmolRTSP_StringBuffer *self) {
+    assert(self);
+    return CharSlice99_new(self->buffer, self->len);
+}
+
+typedef SmolRTSP_StringBuffer StringBufferWriter;
+
+static ssize_t StringBufferWriter_write(VSelf, CharSlice99 data) {
+    VSELF(StringBufferWriter);
+    assert(self);
+
+    const size_t n = data.len < space_left(self) ? data.len : space_left(self);
+    memcpy(self->buffer + self->len, data.ptr, n);
+    self->len += n;
+    self->buffer[self->len] = '\0';
+
+    if (n < data.len) {
+        self->truncated = true;
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    return (ssize_t)n;
+}
+
+#define StringBufferWriter_writev_CUSTOM ()
+static ssize_t StringBufferWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(StringBufferWriter);
+    assert(self);
+
+    ssize_t result = 0;
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        const ssize_t ret = StringBufferWriter_write(
+            self, CharSlice99_new(bufs.ptr[i].iov_base, bufs.ptr[i].iov_len));
+        if (ret < 0) {
+            return ret;
+        }
+        result += ret;
+    }
+
+    return result;
+}
+
+#define StringBufferWriter_reserve_CUSTOM ()
+static char *StringBufferWriter_reserve(VSelf, size_t len) {
+    VSELF(StringBufferWriter);
+    assert(self);
+
+    if (len > space_left(self)) {
+        errno = ENOBUFS;
+        return NULL;
+    }
+
+    return self->buffer + self->len;
+}
+
+#define StringBufferWriter_commit_CUSTOM ()
+static void StringBufferWriter_commit(VSelf, size_t len) {
+    VSELF(StringBufferWriter);
+    assert(self);
+    assert(len <= space_left(self));
+
+    self->len += len;
+    self->buffer[self->len] = '\0';
+}
+
+static void StringBufferWriter_lock(VSelf) {
+    VSELF(StringBufferWriter);
+    (void)self;
+}
+
+static void StringBufferWriter_unlock(VSelf) {
+    VSELF(StringBufferWriter);
+    (void)self;
+}
+
+static size_t StringBufferWriter_filled(VSelf) {
+    VSELF(StringBufferWriter);
+    assert(self);
+
+    return self->len;
+}
+
+static int
+StringBufferWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
+    VSELF(StringBufferWriter);
+
+    assert(self);
+    assert(fmt);
+
+    const int ret = vsnprintf(
+        self->buffer + self->len, self->capacity - self->len, fmt, ap);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if ((size_t)ret > space_left(self)) {
+        self->len = self->capacity - 1;
+        self->truncated = true;
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    self->len += (size_t)ret;
+    return ret;
+}
+
+static int StringBufferWriter_writef(VSelf, const char *restrict fmt, ...) {
+    VSELF(StringBufferWriter);
+
+    assert(self);
+    assert(fmt);
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    const int ret = StringBufferWriter_vwritef(self, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+impl(SmolRTSP_Writer, StringBufferWriter);
+
+SmolRTSP_Writer smolrtsp_string_buffer_writer(SmolRTSP_StringBuffer *self) {
+    assert(self);
+    return DYN(StringBufferWriter, SmolRTSP_Writer, self);
+}
+
+// The room left for the characters, excluding the null character.
+static size_t space_left(const SmolRTSP_StringBuffer *self) {
+    return self->capacity - 1 - self->len;
+}
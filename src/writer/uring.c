@@ -0,0 +1,314 @@
+#include <smolrtsp/uring.h>
+
+#include "../alloc.h"
+#include "../uring.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The size of the on-stack buffer that most formatted strings fit into.
+#define FORMAT_BUFFER_SIZE 512
+
+struct SmolRTSP_UringWriter {
+    SmolRTSP_Uring *ring;
+    int fd;
+
+    // The chain of buffers to be written in order. Only `head` can be in
+    // flight, and data is appended to `tail` while it is not.
+    SmolRTSP_UringBuffer *head, *tail;
+    bool head_in_flight;
+
+    size_t pending;
+
+    // The `errno` of the first failed write, or 0.
+    int error;
+};
+
+static int append(SmolRTSP_UringWriter *self, SmolRTSP_IoVecSlice bufs);
+static void release_chain(SmolRTSP_UringWriter *self);
+static void start(SmolRTSP_UringWriter *self);
+static void fail(SmolRTSP_UringWriter *self, int error);
+
+SmolRTSP_UringWriter *SmolRTSP_UringWriter_new(SmolRTSP_Uring *ring, int fd) {
+    assert(ring);
+    assert(fd >= 0);
+
+    SmolRTSP_UringWriter *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->ring = ring;
+    self->fd = fd;
+    self->head = self->tail = NULL;
+    self->head_in_flight = false;
+    self->pending = 0;
+    self->error = 0;
+
+    return self;
+}
+
+static void SmolRTSP_UringWriter_drop(VSelf) {
+    VSELF(SmolRTSP_UringWriter);
+    assert(self);
+
+    release_chain(self);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_UringWriter);
+
+typedef SmolRTSP_UringWriter UringWriter;
+
+#define UringWriter_writev_CUSTOM ()
+static ssize_t UringWriter_writev(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(UringWriter);
+    assert(self);
+
+    if (self->error != 0) {
+        errno = self->error;
+        return -1;
+    }
+
+    const size_t total = SmolRTSP_IoVecSlice_len(bufs);
+    if (append(self, bufs) == -1) {
+        return -1;
+    }
+
+    if (!self->head_in_flight && self->head != NULL) {
+        start(self);
+        if (self->error != 0) {
+            errno = self->error;
+            return -1;
+        }
+    }
+
+    return (ssize_t)total;
+}
+
+static ssize_t UringWriter_write(VSelf, CharSlice99 data) {
+    VSELF(UringWriter);
+    assert(self);
+
+    struct iovec vec = {.iov_base = data.ptr, .iov_len = data.len};
+    return UringWriter_writev(self, SmolRTSP_IoVecSlice_new(&vec, 1));
+}
+
+static void UringWriter_lock(VSelf) {
+    VSELF(UringWriter);
+    (void)self;
+}
+
+static void UringWriter_unlock(VSelf) {
+    VSELF(UringWriter);
+    (void)self;
+}
+
+static size_t UringWriter_filled(VSelf) {
+    VSELF(UringWriter);
+    assert(self);
+
+    return self->pending;
+}
+
+static int UringWriter_vwritef(VSelf, const char *restrict fmt, va_list ap) {
+    VSELF(UringWriter);
+
+    assert(self);
+    assert(fmt);
+
+    char stack_buffer[FORMAT_BUFFER_SIZE];
+    char *str = stack_buffer;
+
+    va_list ap_copy;
+    va_copy(ap_copy, ap);
+    const int len = vsnprintf(str, sizeof stack_buffer, fmt, ap_copy);
+    va_end(ap_copy);
+
+    if (len < 0) {
+        return len;
+    }
+    if ((size_t)len >= sizeof stack_buffer) {
+        str = smolrtsp_malloc((size_t)len + 1 /* null character */);
+        if (NULL == str) {
+            errno = ENOMEM;
+            return -1;
+        }
+        vsnprintf(str, (size_t)len + 1, fmt, ap);
+    }
+
+    const ssize_t ret =
+        UringWriter_write(self, CharSlice99_new(str, (size_t)len));
+
+    if (str != stack_buffer) {
+        smolrtsp_free(str);
+    }
+
+    return (int)ret;
+}
+
+static int UringWriter_writef(VSelf, const char *restrict fmt, ...) {
+    VSELF(UringWriter);
+
+    assert(self);
+    assert(fmt);
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    const int ret = UringWriter_vwritef(self, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+impl(SmolRTSP_Writer, UringWriter);
+
+SmolRTSP_Writer smolrtsp_uring_writer(SmolRTSP_UringWriter *self) {
+    assert(self);
+    return DYN(UringWriter, SmolRTSP_Writer, self);
+}
+
+void smolrtsp_uring_writer_complete(
+    SmolRTSP_UringWriter *self, SmolRTSP_UringBuffer *buf, int res) {
+    assert(self);
+    assert(buf == self->head);
+
+    self->head_in_flight = false;
+
+    if (-EINTR == res || -EAGAIN == res) {
+        start(self);
+        return;
+    }
+    if (res <= 0) {
+        fail(self, res < 0 ? -res : EIO);
+        return;
+    }
+
+    buf->offset += (size_t)res;
+    self->pending -= (size_t)res;
+
+    if (buf->offset == buf->len) {
+        self->head = buf->next;
+        if (self->tail == buf) {
+            self->tail = NULL;
+        }
+        smolrtsp_uring_release(self->ring, buf);
+    }
+
+    // Either the rest of a partial write or the next buffer.
+    if (self->head != NULL) {
+        start(self);
+    }
+}
+
+// Appends `bufs` to the chain as a whole, or fails with `ENOBUFS` leaving the
+// chain as it was.
+static int append(SmolRTSP_UringWriter *self, SmolRTSP_IoVecSlice bufs) {
+    const size_t buffer_size = smolrtsp_uring_buffer_size(self->ring);
+
+    SmolRTSP_UringBuffer *const old_tail = self->tail;
+    const size_t old_tail_len = old_tail != NULL ? old_tail->len : 0;
+
+    // An in-flight buffer must not change under the kernel.
+    SmolRTSP_UringBuffer *tail =
+        old_tail != NULL && !(self->head_in_flight && old_tail == self->head)
+            ? old_tail
+            : NULL;
+
+    for (size_t i = 0; i < bufs.len; i++) {
+        const char *data = bufs.ptr[i].iov_base;
+        size_t len = bufs.ptr[i].iov_len;
+
+        while (len > 0) {
+            if (NULL == tail || tail->len == buffer_size) {
+                SmolRTSP_UringBuffer *buf = smolrtsp_uring_acquire(self->ring);
+                if (NULL == buf) {
+                    goto rollback;
+                }
+
+                buf->writer = self;
+                if (self->tail != NULL) {
+                    self->tail->next = buf;
+                } else {
+                    self->head = buf;
+                }
+                self->tail = tail = buf;
+            }
+
+            const size_t n = buffer_size - tail->len < len
+                                 ? buffer_size - tail->len
+                                 : len;
+            memcpy(tail->data + tail->len, data, n);
+            tail->len += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    self->pending += SmolRTSP_IoVecSlice_len(bufs);
+    return 0;
+
+rollback:;
+    SmolRTSP_UringBuffer *buf = old_tail != NULL ? old_tail->next : self->head;
+    while (buf != NULL) {
+        SmolRTSP_UringBuffer *next = buf->next;
+        smolrtsp_uring_release(self->ring, buf);
+        buf = next;
+    }
+
+    if (old_tail != NULL) {
+        old_tail->len = old_tail_len;
+        old_tail->next = NULL;
+    } else {
+        self->head = NULL;
+    }
+    self->tail = old_tail;
+
+    errno = ENOBUFS;
+    return -1;
+}
+
+// Releases the chain; the in-flight buffer is released by the ring once it
+// completes.
+static void release_chain(SmolRTSP_UringWriter *self) {
+    SmolRTSP_UringBuffer *buf = self->head;
+
+    if (self->head_in_flight) {
+        buf = buf->next;
+        self->head->writer = NULL;
+        self->head->next = NULL;
+    }
+
+    while (buf != NULL) {
+        SmolRTSP_UringBuffer *next = buf->next;
+        smolrtsp_uring_release(self->ring, buf);
+        buf = next;
+    }
+
+    self->head = self->tail = NULL;
+    self->head_in_flight = false;
+    self->pending = 0;
+}
+
+static void start(SmolRTSP_UringWriter *self) {
+    assert(self->head != NULL);
+    assert(!self->head_in_flight);
+
+    if (smolrtsp_uring_queue_write(self->ring, self->fd, self->head) == -1) {
+        fail(self, errno);
+        return;
+    }
+
+    self->head_in_flight = true;
+}
+
+static void fail(SmolRTSP_UringWriter *self, int error) {
+    self->error = error;
+    release_chain(self);
+}
@@ -0,0 +1,511 @@
+#include "xdp.h"
+
+#include "alloc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <linux/if_xdp.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#define ETHERNET_HEADER_SIZE 14
+
+// No packets are received, but the kernel requires a fill ring.
+#define FILL_RING_SIZE 64
+
+typedef struct {
+    // `producer` is advanced by the writing side and `consumer` by the
+    // reading one; `cached_producer` and `cached_consumer` are our copies.
+    uint32_t *producer, *consumer, *flags;
+    void *descs;
+    uint32_t mask, size;
+    uint32_t cached_producer, cached_consumer;
+
+    void *map;
+    size_t map_size;
+} Ring;
+
+struct SmolRTSP_Xdp {
+    int fd;
+    bool zerocopy, need_wakeup;
+
+    Ring tx, completion, fill;
+
+    // The frames not in use, as a stack of UMEM addresses; `acquired` is the
+    // frame taken by `smolrtsp_xdp_acquire`.
+    uint8_t *umem;
+    size_t umem_size;
+    uint64_t *free_frames;
+    uint32_t free_count, frames_count, frame_size;
+    uint64_t acquired;
+
+    // The descriptors queued since the last `SmolRTSP_Xdp_submit`.
+    uint32_t to_submit;
+
+    uint8_t mac[6];
+    size_t max_payload_size;
+};
+
+static int setup(SmolRTSP_Xdp *self, SmolRTSP_XdpConfig config);
+static int query_interface(SmolRTSP_Xdp *self, const char *ifname);
+static int map_ring(
+    Ring *ring, int fd, const struct xdp_ring_offset *off, uint32_t size,
+    size_t desc_size, off_t pgoff);
+static void unmap_ring(Ring *ring);
+static void teardown(SmolRTSP_Xdp *self);
+static int bind_socket(SmolRTSP_Xdp *self, unsigned ifindex, uint32_t queue);
+static int kick(SmolRTSP_Xdp *self);
+static uint32_t tx_free(SmolRTSP_Xdp *self);
+
+SmolRTSP_XdpConfig SmolRTSP_XdpConfig_default(const char *ifname) {
+    assert(ifname);
+
+    return (SmolRTSP_XdpConfig){
+        .ifname = ifname,
+        .queue_id = 0,
+        .frame_size = 2048,
+        .frames_count = 4096,
+        .ring_size = 2048,
+    };
+}
+
+SmolRTSP_Xdp *SmolRTSP_Xdp_new(SmolRTSP_XdpConfig config) {
+    assert(config.ifname);
+    assert(2048 == config.frame_size || 4096 == config.frame_size);
+    assert(config.frames_count > 0);
+    assert(config.ring_size > 0);
+    assert(0 == (config.ring_size & (config.ring_size - 1)));
+
+    SmolRTSP_Xdp *self = smolrtsp_malloc(sizeof *self);
+    if (NULL == self) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(self, 0, sizeof *self);
+    self->fd = -1;
+
+    self->free_frames =
+        smolrtsp_malloc(config.frames_count * sizeof self->free_frames[0]);
+    if (NULL == self->free_frames) {
+        smolrtsp_free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (setup(self, config) == -1) {
+        const int error = errno;
+        smolrtsp_free(self->free_frames);
+        smolrtsp_free(self);
+        errno = error;
+        return NULL;
+    }
+
+    self->frames_count = self->free_count = config.frames_count;
+    self->frame_size = config.frame_size;
+    for (uint32_t i = 0; i < config.frames_count; i++) {
+        self->free_frames[i] =
+            (uint64_t)(config.frames_count - 1 - i) * config.frame_size;
+    }
+
+    return self;
+}
+
+int SmolRTSP_Xdp_submit(SmolRTSP_Xdp *self) {
+    assert(self);
+
+    const uint32_t to_submit = self->to_submit;
+    self->to_submit = 0;
+
+    if (to_submit > 0 && kick(self) == -1) {
+        return -1;
+    }
+
+    SmolRTSP_Xdp_reap(self);
+
+    return (int)to_submit;
+}
+
+size_t SmolRTSP_Xdp_reap(SmolRTSP_Xdp *self) {
+    assert(self);
+
+    Ring *cq = &self->completion;
+    const uint32_t producer = __atomic_load_n(cq->producer, __ATOMIC_ACQUIRE);
+    const uint64_t *addrs = cq->descs;
+
+    uint32_t consumer = cq->cached_consumer;
+    for (; consumer != producer; consumer++) {
+        self->free_frames[self->free_count++] = addrs[consumer & cq->mask];
+    }
+
+    const size_t reaped = consumer - cq->cached_consumer;
+    cq->cached_consumer = consumer;
+    __atomic_store_n(cq->consumer, consumer, __ATOMIC_RELEASE);
+
+    return reaped;
+}
+
+size_t SmolRTSP_Xdp_in_flight(const SmolRTSP_Xdp *self) {
+    assert(self);
+    return self->frames_count - self->free_count;
+}
+
+bool SmolRTSP_Xdp_is_zerocopy(const SmolRTSP_Xdp *self) {
+    assert(self);
+    return self->zerocopy;
+}
+
+uint64_t SmolRTSP_Xdp_invalid_descs(const SmolRTSP_Xdp *self) {
+    assert(self);
+
+    struct xdp_statistics stats;
+    memset(&stats, 0, sizeof stats);
+    socklen_t len = sizeof stats;
+    if (getsockopt(self->fd, SOL_XDP, XDP_STATISTICS, &stats, &len) == -1) {
+        return 0;
+    }
+
+    return stats.tx_invalid_descs;
+}
+
+static void SmolRTSP_Xdp_drop(VSelf) {
+    VSELF(SmolRTSP_Xdp);
+    assert(self);
+
+    teardown(self);
+    smolrtsp_free(self->free_frames);
+    smolrtsp_free(self);
+}
+
+implExtern(SmolRTSP_Droppable, SmolRTSP_Xdp);
+
+const uint8_t *smolrtsp_xdp_mac(const SmolRTSP_Xdp *xdp) {
+    assert(xdp);
+    return xdp->mac;
+}
+
+size_t smolrtsp_xdp_max_payload_size(const SmolRTSP_Xdp *xdp) {
+    assert(xdp);
+    return xdp->max_payload_size;
+}
+
+bool smolrtsp_xdp_is_full(SmolRTSP_Xdp *xdp) {
+    assert(xdp);
+
+    if (0 == xdp->free_count) {
+        SmolRTSP_Xdp_reap(xdp);
+    }
+    if (0 == tx_free(xdp)) {
+        // Let the kernel consume the ring, as `SmolRTSP_Xdp_submit` would.
+        if (kick(xdp) == 0) {
+            xdp->to_submit = 0;
+        }
+        SmolRTSP_Xdp_reap(xdp);
+    }
+
+    return 0 == xdp->free_count || 0 == tx_free(xdp);
+}
+
+uint8_t *smolrtsp_xdp_acquire(SmolRTSP_Xdp *xdp) {
+    assert(xdp);
+
+    if (smolrtsp_xdp_is_full(xdp)) {
+        errno = ENOBUFS;
+        return NULL;
+    }
+
+    xdp->acquired = xdp->free_frames[--xdp->free_count];
+
+    return xdp->umem + xdp->acquired;
+}
+
+void smolrtsp_xdp_queue(SmolRTSP_Xdp *xdp, uint32_t len) {
+    assert(xdp);
+    assert(len <= xdp->frame_size);
+
+    Ring *tx = &xdp->tx;
+    struct xdp_desc *descs = tx->descs;
+
+    descs[tx->cached_producer & tx->mask] = (struct xdp_desc){
+        .addr = xdp->acquired,
+        .len = len,
+        .options = 0,
+    };
+    tx->cached_producer++;
+    __atomic_store_n(tx->producer, tx->cached_producer, __ATOMIC_RELEASE);
+    xdp->to_submit++;
+}
+
+static int setup(SmolRTSP_Xdp *self, SmolRTSP_XdpConfig config) {
+    const unsigned ifindex = if_nametoindex(config.ifname);
+    if (0 == ifindex) {
+        return -1;
+    }
+
+    self->fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (-1 == self->fd) {
+        return -1;
+    }
+
+    if (query_interface(self, config.ifname) == -1) {
+        goto fail;
+    }
+    const size_t frame_payload_size =
+        config.frame_size - SMOLRTSP_XDP_HEADERS_SIZE;
+    if (self->max_payload_size > frame_payload_size) {
+        self->max_payload_size = frame_payload_size;
+    }
+
+    self->umem_size = (size_t)config.frames_count * config.frame_size;
+    self->umem = mmap(
+        NULL, self->umem_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (MAP_FAILED == self->umem) {
+        self->umem = NULL;
+        goto fail;
+    }
+
+    const struct xdp_umem_reg reg = {
+        .addr = (uint64_t)(uintptr_t)self->umem,
+        .len = self->umem_size,
+        .chunk_size = config.frame_size,
+        .headroom = 0,
+        .flags = 0,
+    };
+    const uint32_t fill_size = FILL_RING_SIZE;
+    if (setsockopt(self->fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof reg) == -1 ||
+        setsockopt(
+            self->fd, SOL_XDP, XDP_UMEM_FILL_RING, &fill_size,
+            sizeof fill_size) == -1 ||
+        setsockopt(
+            self->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &config.ring_size,
+            sizeof config.ring_size) == -1 ||
+        setsockopt(
+            self->fd, SOL_XDP, XDP_TX_RING, &config.ring_size,
+            sizeof config.ring_size) == -1) {
+        goto fail;
+    }
+
+    struct xdp_mmap_offsets off;
+    socklen_t off_len = sizeof off;
+    if (getsockopt(self->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &off_len) ==
+        -1) {
+        goto fail;
+    }
+
+    if (map_ring(
+            &self->tx, self->fd, &off.tx, config.ring_size,
+            sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) == -1) {
+        goto fail;
+    }
+    if (map_ring(
+            &self->completion, self->fd, &off.cr, config.ring_size,
+            sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) == -1) {
+        goto fail;
+    }
+    if (map_ring(
+            &self->fill, self->fd, &off.fr, fill_size, sizeof(uint64_t),
+            XDP_UMEM_PGOFF_FILL_RING) == -1) {
+        goto fail;
+    }
+
+    // We are the producer of the TX ring, so all its descriptors are free.
+    self->tx.cached_consumer = *self->tx.consumer;
+    self->tx.cached_producer = *self->tx.producer;
+    self->completion.cached_consumer = *self->completion.consumer;
+
+    if (bind_socket(self, ifindex, config.queue_id) == -1) {
+        goto fail;
+    }
+
+    return 0;
+
+fail:;
+    const int error = errno;
+    teardown(self);
+    errno = error;
+    return -1;
+}
+
+// Fills in the MAC address of `ifname` and the maximum payload allowed by its
+// MTU.
+static int query_interface(SmolRTSP_Xdp *self, const char *ifname) {
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof ifr);
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) == -1) {
+        goto fail;
+    }
+    memcpy(self->mac, ifr.ifr_hwaddr.sa_data, sizeof self->mac);
+
+    if (ioctl(fd, SIOCGIFMTU, &ifr) == -1) {
+        goto fail;
+    }
+    self->max_payload_size =
+        ifr.ifr_mtu > SMOLRTSP_XDP_HEADERS_SIZE - ETHERNET_HEADER_SIZE
+            ? (size_t)ifr.ifr_mtu -
+                  (SMOLRTSP_XDP_HEADERS_SIZE - ETHERNET_HEADER_SIZE)
+            : 0;
+
+    close(fd);
+    return 0;
+
+fail:;
+    const int error = errno;
+    close(fd);
+    errno = error;
+    return -1;
+}
+
+static int map_ring(
+    Ring *ring, int fd, const struct xdp_ring_offset *off, uint32_t size,
+    size_t desc_size, off_t pgoff) {
+    ring->map_size = off->desc + size * desc_size;
+    ring->map = mmap(
+        NULL, ring->map_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (MAP_FAILED == ring->map) {
+        ring->map = NULL;
+        return -1;
+    }
+
+    char *base = ring->map;
+    ring->producer = (uint32_t *)(base + off->producer);
+    ring->consumer = (uint32_t *)(base + off->consumer);
+    ring->flags = (uint32_t *)(base + off->flags);
+    ring->descs = base + off->desc;
+    ring->mask = size - 1;
+    ring->size = size;
+
+    return 0;
+}
+
+static void unmap_ring(Ring *ring) {
+    if (ring->map != NULL) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+}
+
+// Releases the rings, the socket, and the UMEM set up so far.
+static void teardown(SmolRTSP_Xdp *self) {
+    unmap_ring(&self->tx);
+    unmap_ring(&self->completion);
+    unmap_ring(&self->fill);
+
+    // The kernel releases the UMEM together with the socket.
+    if (self->fd != -1) {
+        close(self->fd);
+    }
+    if (self->umem != NULL) {
+        munmap(self->umem, self->umem_size);
+    }
+}
+
+// Binds to the queue in zero-copy mode if the driver supports it, and in copy
+// mode otherwise; without `XDP_USE_NEED_WAKEUP` (before Linux 5.4), every
+// submission has to kick the kernel.
+static int bind_socket(SmolRTSP_Xdp *self, unsigned ifindex, uint32_t queue) {
+    static const struct {
+        uint16_t flags;
+        bool zerocopy, need_wakeup;
+    } modes[] = {
+        {XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP, true, true},
+        {XDP_COPY | XDP_USE_NEED_WAKEUP, false, true},
+        {XDP_COPY, false, false},
+    };
+
+    int error = 0;
+    for (size_t i = 0; i < sizeof modes / sizeof modes[0]; i++) {
+        const struct sockaddr_xdp addr = {
+            .sxdp_family = AF_XDP,
+            .sxdp_flags = modes[i].flags,
+            .sxdp_ifindex = ifindex,
+            .sxdp_queue_id = queue,
+        };
+
+        if (bind(self->fd, (const struct sockaddr *)&addr, sizeof addr) == 0) {
+            self->zerocopy = modes[i].zerocopy;
+            self->need_wakeup = modes[i].need_wakeup;
+            return 0;
+        }
+
+        // A missing interface, queue, or privilege is not worth retrying.
+        error = errno;
+        if (error != EOPNOTSUPP && error != EINVAL &&
+            error != EPROTONOSUPPORT) {
+            break;
+        }
+    }
+
+    errno = error;
+    return -1;
+}
+
+// Wakes the kernel up to transmit the TX ring if it needs so.
+static int kick(SmolRTSP_Xdp *self) {
+    // In copy mode, the kernel transmits only a bounded batch per call.
+    uint32_t consumer = self->tx.cached_consumer;
+    do {
+        if (self->need_wakeup && !(__atomic_load_n(
+                                       self->tx.flags, __ATOMIC_ACQUIRE) &
+                                   XDP_RING_NEED_WAKEUP)) {
+            return 0;
+        }
+
+        if (sendto(self->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) == -1) {
+            // The kernel is busy with the ring or the NIC queue is full: the
+            // next submission retries.
+            if (EAGAIN == errno || EWOULDBLOCK == errno || EBUSY == errno ||
+                ENOBUFS == errno || ENETDOWN == errno) {
+                return 0;
+            }
+            if (errno != EINTR) {
+                return -1;
+            }
+        }
+
+        if (self->zerocopy) {
+            return 0;
+        }
+
+        const uint32_t last = consumer;
+        consumer = __atomic_load_n(self->tx.consumer, __ATOMIC_ACQUIRE);
+        if (consumer == last) {
+            return 0;
+        }
+    } while (consumer != self->tx.cached_producer);
+
+    return 0;
+}
+
+static uint32_t tx_free(SmolRTSP_Xdp *self) {
+    Ring *tx = &self->tx;
+
+    uint32_t n = tx->size - (tx->cached_producer - tx->cached_consumer);
+    if (0 == n) {
+        tx->cached_consumer = __atomic_load_n(tx->consumer, __ATOMIC_ACQUIRE);
+        n = tx->size - (tx->cached_producer - tx->cached_consumer);
+    }
+
+    return n;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <smolrtsp/xdp.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The MAC address of the interface of `xdp`.
+const uint8_t *smolrtsp_xdp_mac(const SmolRTSP_Xdp *xdp);
+
+// The maximum UDP payload of a frame of `xdp`.
+size_t smolrtsp_xdp_max_payload_size(const SmolRTSP_Xdp *xdp);
+
+// Whether there is no free frame or TX descriptor, reaping completions and
+// submitting the TX ring first if so.
+bool smolrtsp_xdp_is_full(SmolRTSP_Xdp *xdp);
+
+// Takes a free frame and reserves a TX descriptor for it, returning `NULL` and
+// setting `errno` to `ENOBUFS` if `smolrtsp_xdp_is_full`. The frame must be
+// passed to `smolrtsp_xdp_queue` before the next call.
+uint8_t *smolrtsp_xdp_acquire(SmolRTSP_Xdp *xdp);
+
+// Queues the frame last acquired, holding a packet of `len` bytes, on the TX
+// ring.
+void smolrtsp_xdp_queue(SmolRTSP_Xdp *xdp, uint32_t len);
@@ -0,0 +1,159 @@
+#include <smolrtsp/admission.h>
+
+#include <smolrtsp/types/method.h>
+
+#include <greatest.h>
+
+#include <string.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+static uint64_t fake_now_us;
+
+static uint64_t fake_clock_us(void) {
+    return fake_now_us;
+}
+
+static SmolRTSP_Admission *new_admission(
+    uint64_t max_bitrate, uint64_t max_packet_rate, uint64_t session_bitrate) {
+    fake_now_us = 0;
+
+    SmolRTSP_AdmissionConfig config = SmolRTSP_AdmissionConfig_default();
+    config.max_bitrate = max_bitrate;
+    config.max_packet_rate = max_packet_rate;
+    config.session_bitrate = session_bitrate;
+    config.clock_us = fake_clock_us;
+
+    return SmolRTSP_Admission_new(config);
+}
+
+TEST meter(void) {
+    SmolRTSP_Admission *admission = new_admission(0, 0, 0);
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_Transport t =
+        smolrtsp_transport_metered(smolrtsp_transport_udp(fds[0]), admission);
+
+    char data[100] = {0};
+    struct iovec bufs[] = {{.iov_base = data, .iov_len = sizeof data}};
+    const SmolRTSP_IoVecSlice packet = Slice99_typed_from_array(bufs);
+
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_EQ(0, VCALL(t, transmit, packet));
+    }
+    SmolRTSP_IoVecSlice packets[] = {packet, packet};
+    ASSERT_EQ(
+        2, VCALL(
+               t, transmit_batch,
+               (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets)));
+
+    // The window has not elapsed yet.
+    SmolRTSP_EgressRates rates = SmolRTSP_Admission_rates(admission);
+    ASSERT_EQ(0, rates.bitrate);
+    ASSERT_EQ(0, rates.packet_rate);
+
+    fake_now_us = SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US;
+    rates = SmolRTSP_Admission_rates(admission);
+    ASSERT_EQ(10 * sizeof data * 8, rates.bitrate);
+    ASSERT_EQ(10, rates.packet_rate);
+
+    // An idle window.
+    fake_now_us = 2 * SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US;
+    rates = SmolRTSP_Admission_rates(admission);
+    ASSERT_EQ(0, rates.bitrate);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_Admission, SmolRTSP_Droppable).drop(admission);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST budget(void) {
+    SmolRTSP_Admission *admission = new_admission(10000, 0, 4000);
+
+    // The sessions of a rush are accounted before the meter sees them.
+    ASSERT(SmolRTSP_Admission_try_admit(admission));
+    ASSERT(SmolRTSP_Admission_try_admit(admission));
+    ASSERT(SmolRTSP_Admission_is_over_budget(admission));
+    ASSERT(!SmolRTSP_Admission_try_admit(admission));
+
+    // Now they are measured: 4000 bits per second.
+    SmolRTSP_Admission_record(admission, 10, 500);
+    fake_now_us = SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US;
+    ASSERT_EQ(4000, SmolRTSP_Admission_rates(admission).bitrate);
+    ASSERT(SmolRTSP_Admission_try_admit(admission));
+    ASSERT(!SmolRTSP_Admission_try_admit(admission));
+
+    VTABLE(SmolRTSP_Admission, SmolRTSP_Droppable).drop(admission);
+
+    // A budget of packets.
+    admission = new_admission(0, 100, 0);
+    SmolRTSP_Admission_record(admission, 100, 1000);
+    fake_now_us = SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US;
+    ASSERT(SmolRTSP_Admission_is_over_budget(admission));
+
+    SmolRTSP_Admission_record(admission, 99, 1000);
+    fake_now_us = 2 * SMOLRTSP_ADMISSION_DEFAULT_WINDOW_US;
+    ASSERT(SmolRTSP_Admission_try_admit(admission));
+
+    VTABLE(SmolRTSP_Admission, SmolRTSP_Droppable).drop(admission);
+    PASS();
+}
+
+static enum greatest_test_res check_request(
+    SmolRTSP_Admission *admission, CharSlice99 method,
+    SmolRTSP_ControlFlow expected_flow, const char *expected) {
+    char buffer[256] = {0};
+    SmolRTSP_Context *ctx =
+        SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 1);
+
+    SmolRTSP_Request req = SmolRTSP_Request_uninit();
+    req.start_line.method = method;
+    req.cseq = 1;
+
+    ASSERT_EQ(expected_flow, smolrtsp_admission_check(admission, ctx, &req));
+    ASSERT_STR_EQ(expected, buffer);
+
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    PASS();
+}
+
+TEST check(void) {
+    SmolRTSP_Admission *admission = new_admission(10000, 0, 6000);
+
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_SETUP, SmolRTSP_ControlFlow_Continue, ""));
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_PLAY, SmolRTSP_ControlFlow_Continue, ""));
+
+    const char *rejection = "RTSP/1.0 453 Not Enough Bandwidth\r\n"
+                            "CSeq: 1\r\n"
+                            "\r\n";
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_SETUP, SmolRTSP_ControlFlow_Break,
+        rejection));
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_PLAY, SmolRTSP_ControlFlow_Break,
+        rejection));
+    ASSERT_EQ(2, SmolRTSP_Admission_rejected(admission));
+
+    // The existing sessions are not affected.
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_TEARDOWN, SmolRTSP_ControlFlow_Continue,
+        ""));
+    CHECK_CALL(check_request(
+        admission, SMOLRTSP_METHOD_OPTIONS, SmolRTSP_ControlFlow_Continue,
+        ""));
+
+    VTABLE(SmolRTSP_Admission, SmolRTSP_Droppable).drop(admission);
+    PASS();
+}
+
+SUITE(admission) {
+    RUN_TEST(meter);
+    RUN_TEST(budget);
+    RUN_TEST(check);
+}
@@ -0,0 +1,555 @@
+#include <smolrtsp/allocator.h>
+
+#include <greatest.h>
+
+#include <smolrtsp/admission.h>
+#include <smolrtsp/context.h>
+#include <smolrtsp/gop_cache.h>
+#include <smolrtsp/live_source.h>
+#include <smolrtsp/multicast.h>
+#include <smolrtsp/nal_splitter.h>
+#include <smolrtsp/nal_transport.h>
+#include <smolrtsp/pacer.h>
+#include <smolrtsp/param_set_cache.h>
+#include <smolrtsp/rtp_fanout.h>
+#include <smolrtsp/rtp_transport.h>
+#include <smolrtsp/send_workers.h>
+#include <smolrtsp/session_registry.h>
+#include <smolrtsp/timer_wheel.h>
+#include <smolrtsp/transport.h>
+#include <smolrtsp/udp_sender.h>
+#include <smolrtsp/writer.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The allocator of the library before the tests, which is not libc in the
+// `SMOLRTSP_STATIC_POOLS` build.
+static SmolRTSP_Allocator default_allocator;
+
+// Counts the allocations and fails them once `budget` is exhausted, if
+// `limited`; reallocations fail as well then.
+typedef struct {
+    size_t allocations, frees;
+    bool limited;
+    size_t budget;
+} TestPool;
+
+static void *test_malloc(void *user_data, size_t size) {
+    TestPool *pool = user_data;
+    if (pool->limited) {
+        if (0 == pool->budget) {
+            return NULL;
+        }
+        pool->budget--;
+    }
+
+    pool->allocations++;
+    return malloc(size);
+}
+
+static void *test_realloc(void *user_data, void *ptr, size_t size) {
+    TestPool *pool = user_data;
+    if (pool->limited && 0 == pool->budget) {
+        return NULL;
+    }
+
+    return realloc(ptr, size);
+}
+
+static void test_free(void *user_data, void *ptr) {
+    TestPool *pool = user_data;
+    pool->frees++;
+    free(ptr);
+}
+
+static void set_test_allocator(TestPool *pool) {
+    smolrtsp_set_allocator((SmolRTSP_Allocator){
+        .malloc = test_malloc,
+        .realloc = test_realloc,
+        .free = test_free,
+        .user_data = pool,
+    });
+}
+
+TEST counts_allocations(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    TestPool pool = {0};
+    set_test_allocator(&pool);
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.aggregation = true;
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new_with_config(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000),
+        config);
+    const size_t allocations = pool.allocations;
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+
+    smolrtsp_set_allocator(default_allocator);
+
+    // The UDP and RTP transports, the NAL transport with its parameter set
+    // cache and aggregator.
+    ASSERT_EQ(5, allocations);
+    ASSERT_EQ(pool.allocations, pool.frees);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST transports_fail_gracefully(void) {
+    char buffer[32] = {0};
+    const SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    errno = 0;
+    const SmolRTSP_Transport udp = smolrtsp_transport_udp(STDOUT_FILENO);
+    const int udp_errno = errno;
+
+    errno = 0;
+    const SmolRTSP_Transport tcp = smolrtsp_transport_tcp(w, 0, 0);
+    const int tcp_errno = errno;
+
+    errno = 0;
+    SmolRTSP_Context *ctx = SmolRTSP_Context_new(w, 123);
+    const int ctx_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(NULL, udp.self);
+    ASSERT_EQ(ENOMEM, udp_errno);
+    ASSERT_EQ(NULL, tcp.self);
+    ASSERT_EQ(ENOMEM, tcp_errno);
+    ASSERT_EQ(NULL, ctx);
+    ASSERT_EQ(ENOMEM, ctx_errno);
+
+    PASS();
+}
+
+TEST nal_transport_fails_gracefully(void) {
+    char buffer[32] = {0};
+    const SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.aggregation = true;
+
+    // Fail the NAL transport itself, its parameter set cache, and its
+    // aggregator in turn, after the TCP and RTP transports.
+    for (size_t budget = 2; budget < 5; budget++) {
+        TestPool pool = {.limited = true, .budget = budget};
+        set_test_allocator(&pool);
+
+        SmolRTSP_RtpTransport *rtp = SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_tcp(w, 0, 0), 96, 90000);
+        errno = 0;
+        SmolRTSP_NalTransport *t =
+            SmolRTSP_NalTransport_new_with_config(rtp, config);
+        const int nal_errno = errno;
+        VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(rtp);
+
+        smolrtsp_set_allocator(default_allocator);
+
+        ASSERT_EQ(NULL, t);
+        ASSERT_EQ(ENOMEM, nal_errno);
+        ASSERT_EQ(pool.allocations, pool.frees);
+    }
+
+    PASS();
+}
+
+TEST header_fails_gracefully(void) {
+    char buffer[512] = {0};
+    const SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
+
+    SmolRTSP_Context *ctx = SmolRTSP_Context_new(w, 123);
+
+    char value[2048];
+    memset(value, 'a', sizeof value - 1);
+    value[sizeof value - 1] = '\0';
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    // The value does not fit into the arena of the context.
+    errno = 0;
+    smolrtsp_header(ctx, SMOLRTSP_HEADER_SERVER, "%s", value);
+    const int header_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(ENOMEM, header_errno);
+    ASSERT_EQ(-1, SmolRTSP_Context_get_ret(ctx));
+
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    PASS();
+}
+
+TEST session_fails_gracefully(void) {
+    SmolRTSP_SessionRegistry *registry =
+        SmolRTSP_SessionRegistry_new(16, 1000);
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    errno = 0;
+    SmolRTSP_Session *session =
+        SmolRTSP_SessionRegistry_create(registry, CharSlice99_from_str("1"));
+    const int session_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(NULL, session);
+    ASSERT_EQ(ENOMEM, session_errno);
+    ASSERT_EQ(0, SmolRTSP_SessionRegistry_len(registry));
+
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(registry);
+    PASS();
+}
+
+TEST param_set_cache_fails_gracefully(void) {
+    uint8_t sps[] = {0x42, 0xC0, 0x1E}, pps[] = {0xCE, 0x3C, 0x80};
+    const SmolRTSP_H264NalHeader sps_header = {
+        .forbidden_zero_bit = false,
+        .ref_idc = 0b11,
+        .unit_type = SMOLRTSP_H264_NAL_UNIT_SPS,
+    };
+    const SmolRTSP_H264NalHeader pps_header = {
+        .forbidden_zero_bit = false,
+        .ref_idc = 0b11,
+        .unit_type = SMOLRTSP_H264_NAL_UNIT_PPS,
+    };
+    const SmolRTSP_NalUnit sps_nalu = {
+        SmolRTSP_NalHeader_H264(sps_header), U8Slice99_new(sps, sizeof sps)};
+    const SmolRTSP_NalUnit pps_nalu = {
+        SmolRTSP_NalHeader_H264(pps_header), U8Slice99_new(pps, sizeof pps)};
+
+    SmolRTSP_ParamSetCache *cache = SmolRTSP_ParamSetCache_new();
+    ASSERT_EQ(1, SmolRTSP_ParamSetCache_update(cache, sps_nalu));
+    ASSERT_EQ(1, SmolRTSP_ParamSetCache_update(cache, pps_nalu));
+    const char *sprop = SmolRTSP_ParamSetCache_sprop(cache);
+    sps[0] = 0x4D;
+
+    // Fail the copy of the new SPS, then its SDP representation.
+    for (size_t budget = 0; budget < 2; budget++) {
+        TestPool pool = {.limited = true, .budget = budget};
+        set_test_allocator(&pool);
+
+        errno = 0;
+        const int ret = SmolRTSP_ParamSetCache_update(cache, sps_nalu);
+        const int update_errno = errno;
+
+        smolrtsp_set_allocator(default_allocator);
+
+        ASSERT_EQ(-1, ret);
+        ASSERT_EQ(ENOMEM, update_errno);
+        ASSERT_EQ(pool.allocations, pool.frees);
+        ASSERT_EQ(2, SmolRTSP_ParamSetCache_version(cache));
+        ASSERT_EQ(0x42, SmolRTSP_ParamSetCache_sps(cache).ptr[1]);
+        ASSERT_EQ(sprop, SmolRTSP_ParamSetCache_sprop(cache));
+    }
+
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+
+    // The NAL transport passes the failure on.
+    char buffer[256] = {0};
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_tcp(smolrtsp_string_writer(buffer), 0, 0), 96,
+            90000));
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    errno = 0;
+    const int ret = SmolRTSP_NalTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(0), sps_nalu);
+    const int send_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(-1, ret);
+    ASSERT_EQ(ENOMEM, send_errno);
+    ASSERT_EQ(1, SmolRTSP_NalTransport_stats(t).errors);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST media_objects_fail_gracefully(void) {
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    errno = 0;
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H264);
+    const int splitter_errno = errno;
+
+    errno = 0;
+    SmolRTSP_GopCache *gop_cache = SmolRTSP_GopCache_new(1024);
+    const int gop_cache_errno = errno;
+
+    errno = 0;
+    SmolRTSP_RtpFanout *fanout =
+        SmolRTSP_RtpFanout_new(90000, SmolRTSP_NalTransportConfig_default());
+    const int fanout_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(NULL, splitter);
+    ASSERT_EQ(ENOMEM, splitter_errno);
+    ASSERT_EQ(NULL, gop_cache);
+    ASSERT_EQ(ENOMEM, gop_cache_errno);
+    ASSERT_EQ(NULL, fanout);
+    ASSERT_EQ(ENOMEM, fanout_errno);
+
+    PASS();
+}
+
+// Creates an object by `new` with each allocation failing in turn, expecting
+// `NULL` and no leak until all of them succeed.
+#define CHECK_EVERY_ALLOCATION(T, new)                                         \
+    do {                                                                       \
+        for (size_t budget = 0;; budget++) {                                   \
+            TestPool pool = {.limited = true, .budget = budget};               \
+            set_test_allocator(&pool);                                         \
+            errno = 0;                                                         \
+            T *object = new;                                                   \
+            const int new_errno = errno;                                       \
+            if (object != NULL) {                                              \
+                VTABLE(T, SmolRTSP_Droppable).drop(object);                    \
+            }                                                                  \
+            smolrtsp_set_allocator(default_allocator);                         \
+                                                                               \
+            ASSERT_EQ(pool.allocations, pool.frees);                           \
+            if (object != NULL) {                                              \
+                break;                                                         \
+            }                                                                  \
+            ASSERT_EQ(ENOMEM, new_errno);                                      \
+        }                                                                      \
+    } while (0)
+
+TEST runtime_objects_fail_gracefully(void) {
+    CHECK_EVERY_ALLOCATION(SmolRTSP_TimerWheel, SmolRTSP_TimerWheel_new(0));
+    CHECK_EVERY_ALLOCATION(
+        SmolRTSP_SessionRegistry, SmolRTSP_SessionRegistry_new(16, 1000));
+    CHECK_EVERY_ALLOCATION(SmolRTSP_LiveSource, SmolRTSP_LiveSource_new(4));
+    CHECK_EVERY_ALLOCATION(
+        SmolRTSP_Admission,
+        SmolRTSP_Admission_new(SmolRTSP_AdmissionConfig_default()));
+    CHECK_EVERY_ALLOCATION(
+        SmolRTSP_MulticastPool,
+        SmolRTSP_MulticastPool_new(
+            (struct in_addr){htonl(0xEFFF0001)}, 4, 5000));
+    CHECK_EVERY_ALLOCATION(
+        SmolRTSP_UdpSender, SmolRTSP_UdpSender_new(0, 4, 1500));
+    CHECK_EVERY_ALLOCATION(SmolRTSP_SendWorkers, SmolRTSP_SendWorkers_new(2));
+
+    PASS();
+}
+
+#undef CHECK_EVERY_ALLOCATION
+
+TEST multicast_acquire_fails_gracefully(void) {
+    SmolRTSP_MulticastPool *multicast = SmolRTSP_MulticastPool_new(
+        (struct in_addr){htonl(0xEFFF0001)}, 1, 5000);
+    ASSERT(multicast);
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    SmolRTSP_MulticastGroup group;
+    errno = 0;
+    const int ret = SmolRTSP_MulticastPool_acquire(
+        multicast, CharSlice99_from_str("stream"), &group);
+    const int acquire_errno = errno;
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(-1, ret);
+    ASSERT_EQ(ENOMEM, acquire_errno);
+
+    // The group is still free for the next acquisition.
+    ASSERT_EQ(
+        0, SmolRTSP_MulticastPool_acquire(
+               multicast, CharSlice99_from_str("stream"), &group));
+
+    VTABLE(SmolRTSP_MulticastPool, SmolRTSP_Droppable).drop(multicast);
+
+    PASS();
+}
+
+TEST splitter_skips_unbuffered_nalu(void) {
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H264);
+    ASSERT(splitter);
+
+    // The first NAL unit spans the chunks and is not buffered, but the second
+    // one is within the last chunk.
+    uint8_t first[] = {0x00, 0x00, 0x01, 0x65, 0xAA},
+            second[] = {0xBB, 0x00, 0x00, 0x01, 0x41, 0xCC, 0x00, 0x00, 0x01};
+    SmolRTSP_NalUnit nalu;
+
+    TestPool pool = {.limited = true, .budget = 0};
+    set_test_allocator(&pool);
+
+    errno = 0;
+    SmolRTSP_NalSplitter_feed(splitter, U8Slice99_new(first, sizeof first));
+    const int first_ret = SmolRTSP_NalSplitter_next(splitter, &nalu);
+    const int first_errno = errno;
+
+    SmolRTSP_NalSplitter_feed(splitter, U8Slice99_new(second, sizeof second));
+    const int second_ret = SmolRTSP_NalSplitter_next(splitter, &nalu);
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT_EQ(-1, first_ret);
+    ASSERT_EQ(ENOMEM, first_errno);
+    ASSERT_EQ(1, second_ret);
+    ASSERT_EQ(1, nalu.payload.len);
+    ASSERT_EQ(0xCC, nalu.payload.ptr[0]);
+    ASSERT_EQ(0, SmolRTSP_NalSplitter_next(splitter, &nalu));
+
+    VTABLE(SmolRTSP_NalSplitter, SmolRTSP_Droppable).drop(splitter);
+    PASS();
+}
+
+static union {
+    uint8_t bytes[SMOLRTSP_POOLS_ARENA_SIZE(2, 1, 0, 0, 0, 0, 0, 0)];
+    long double align;
+} small_arena;
+
+TEST pools_allocate_by_size(void) {
+    SmolRTSP_Pools pools;
+    const size_t too_many[SMOLRTSP_POOL_CLASSES] = {3, 1};
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_Pools_init(
+                &pools, small_arena.bytes, sizeof small_arena.bytes,
+                too_many));
+    ASSERT_EQ(EINVAL, errno);
+
+    const size_t blocks[SMOLRTSP_POOL_CLASSES] = {2, 1};
+    ASSERT_EQ(
+        0, SmolRTSP_Pools_init(
+               &pools, small_arena.bytes, sizeof small_arena.bytes, blocks));
+    const SmolRTSP_Allocator a = SmolRTSP_Allocator_pools(&pools);
+
+    void *x = a.malloc(a.user_data, 1), *y = a.malloc(a.user_data, 64);
+    ASSERT(x && y && x != y);
+
+    // A full class does not spill over to the larger ones.
+    ASSERT_EQ(NULL, a.malloc(a.user_data, 64));
+    void *z = a.malloc(a.user_data, 65);
+    ASSERT(z);
+    ASSERT_EQ(NULL, a.malloc(a.user_data, 65));
+    ASSERT_EQ(
+        NULL,
+        a.malloc(
+            a.user_data,
+            SMOLRTSP_POOL_BLOCK_SIZE(SMOLRTSP_POOL_CLASSES - 1) + 1));
+
+    SmolRTSP_PoolStats stats = SmolRTSP_Pools_stats(&pools, 0);
+    ASSERT_EQ(64, stats.block_size);
+    ASSERT_EQ(2, stats.blocks);
+    ASSERT_EQ(2, stats.used);
+    ASSERT_EQ(1, stats.failures);
+
+    // A reallocation keeps its block while it fits, and fails without a
+    // larger one.
+    a.free(a.user_data, x);
+    ASSERT_EQ(y, a.realloc(a.user_data, y, 64));
+    ASSERT_EQ(NULL, a.realloc(a.user_data, y, 200));
+
+    a.free(a.user_data, z);
+    memset(y, 0xAB, 64);
+    uint8_t *moved = a.realloc(a.user_data, y, 200);
+    ASSERT(moved && moved != y);
+    for (size_t i = 0; i < 64; i++) {
+        ASSERT_EQ(0xAB, moved[i]);
+    }
+
+    // The freed blocks are reused.
+    ASSERT_EQ(y, a.malloc(a.user_data, 10));
+
+    stats = SmolRTSP_Pools_stats(&pools, 0);
+    ASSERT_EQ(1, stats.used);
+    ASSERT_EQ(2, stats.peak);
+    stats = SmolRTSP_Pools_stats(&pools, 1);
+    ASSERT_EQ(256, stats.block_size);
+    ASSERT_EQ(1, stats.used);
+    ASSERT_EQ(2, stats.failures);
+
+    PASS();
+}
+
+static union {
+    uint8_t bytes[SMOLRTSP_POOLS_ARENA_SIZE(8, 8, 8, 8, 8, 2, 0, 0)];
+    long double align;
+} large_arena;
+
+TEST library_allocates_from_pools(void) {
+    SmolRTSP_Pools pools;
+    const size_t blocks[SMOLRTSP_POOL_CLASSES] = {8, 8, 8, 8, 8, 2};
+    ASSERT_EQ(
+        0, SmolRTSP_Pools_init(
+               &pools, large_arena.bytes, sizeof large_arena.bytes, blocks));
+    smolrtsp_set_allocator(SmolRTSP_Allocator_pools(&pools));
+
+    char buffer[32] = {0};
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.aggregation = true;
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new_with_config(
+        SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_tcp(smolrtsp_string_writer(buffer), 0, 0), 96,
+            90000),
+        config);
+
+    size_t used = 0;
+    for (size_t i = 0; i < SMOLRTSP_POOL_CLASSES; i++) {
+        used += SmolRTSP_Pools_stats(&pools, i).used;
+    }
+
+    if (t != NULL) {
+        VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    }
+
+    size_t remaining = 0;
+    for (size_t i = 0; i < SMOLRTSP_POOL_CLASSES; i++) {
+        remaining += SmolRTSP_Pools_stats(&pools, i).used;
+    }
+
+    smolrtsp_set_allocator(default_allocator);
+
+    ASSERT(t);
+    ASSERT_EQ(5, used);
+    ASSERT_EQ(0, remaining);
+
+    PASS();
+}
+
+SUITE(allocator) {
+    default_allocator = smolrtsp_allocator();
+
+    RUN_TEST(counts_allocations);
+    RUN_TEST(transports_fail_gracefully);
+    RUN_TEST(nal_transport_fails_gracefully);
+    RUN_TEST(header_fails_gracefully);
+    RUN_TEST(session_fails_gracefully);
+    RUN_TEST(param_set_cache_fails_gracefully);
+    RUN_TEST(media_objects_fail_gracefully);
+    RUN_TEST(runtime_objects_fail_gracefully);
+    RUN_TEST(multicast_acquire_fails_gracefully);
+    RUN_TEST(splitter_skips_unbuffered_nalu);
+    RUN_TEST(pools_allocate_by_size);
+    RUN_TEST(library_allocates_from_pools);
+}
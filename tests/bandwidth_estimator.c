@@ -0,0 +1,268 @@
+#include <smolrtsp/bandwidth_estimator.h>
+
+#include <greatest.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PACKET_SIZE     1200
+#define BASE_DELAY_US   20000
+#define FEEDBACK_US     50000
+#define MAX_FEEDBACK    64
+#define MAX_FEEDBACK_SZ 512
+
+// Writes a transport-wide feedback of the packets
+// `[base_seq_num; base_seq_num + count)` with two-bit status vectors and large
+// deltas; a negative arrival time means a lost packet.
+static size_t write_feedback(
+    uint8_t buffer[restrict], uint16_t base_seq_num,
+    const int64_t arrivals_us[], size_t count) {
+    int64_t reference_us = -1;
+    for (size_t i = 0; i < count && reference_us < 0; i++) {
+        if (arrivals_us[i] >= 0) {
+            reference_us = arrivals_us[i] / 64000 * 64000;
+        }
+    }
+    if (reference_us < 0) {
+        reference_us = 0;
+    }
+
+    uint8_t *p = buffer + 4;
+    const uint8_t ssrcs[] = {0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB, 0xCC, 0xDD};
+    memcpy(p, ssrcs, sizeof ssrcs);
+    p += sizeof ssrcs;
+
+    const uint32_t reference_time = (uint32_t)(reference_us / 64000);
+    const uint8_t header[] = {
+        (uint8_t)(base_seq_num >> 8),
+        (uint8_t)base_seq_num,
+        (uint8_t)(count >> 8),
+        (uint8_t)count,
+        (uint8_t)(reference_time >> 16),
+        (uint8_t)(reference_time >> 8),
+        (uint8_t)reference_time,
+        0,
+    };
+    memcpy(p, header, sizeof header);
+    p += sizeof header;
+
+    for (size_t i = 0; i < count; i += 7) {
+        uint16_t chunk = 0xC000;
+        for (size_t j = 0; j < 7 && i + j < count; j++) {
+            if (arrivals_us[i + j] >= 0) {
+                chunk |= (uint16_t)(2 << (12 - 2 * j));
+            }
+        }
+        *p++ = (uint8_t)(chunk >> 8);
+        *p++ = (uint8_t)chunk;
+    }
+
+    int64_t prev_us = reference_us;
+    for (size_t i = 0; i < count; i++) {
+        if (arrivals_us[i] >= 0) {
+            const int16_t delta = (int16_t)((arrivals_us[i] - prev_us) / 250);
+            *p++ = (uint8_t)((uint16_t)delta >> 8);
+            *p++ = (uint8_t)delta;
+            prev_us = arrivals_us[i];
+        }
+    }
+
+    while ((p - buffer) % 4 != 0) {
+        *p++ = 0;
+    }
+
+    const size_t len = (size_t)(p - buffer);
+    buffer[0] = 0x80 | 15;
+    buffer[1] = 205;
+    buffer[2] = (uint8_t)((len / 4 - 1) >> 8);
+    buffer[3] = (uint8_t)(len / 4 - 1);
+
+    return len;
+}
+
+static int ingest_feedback(
+    SmolRTSP_BandwidthEstimator *e, uint16_t base_seq_num,
+    const int64_t arrivals_us[], size_t count, uint64_t time_us) {
+    uint8_t buffer[MAX_FEEDBACK_SZ];
+    U8Slice99 input = U8Slice99_new(
+        buffer, write_feedback(buffer, base_seq_num, arrivals_us, count));
+
+    SmolRTSP_RtcpPacket packet;
+    if (SmolRTSP_RtcpPacket_parse(&input, &packet) == -1) {
+        return -1;
+    }
+
+    return SmolRTSP_BandwidthEstimator_on_feedback(e, packet, time_us);
+}
+
+typedef struct {
+    uint64_t time_us;
+    uint16_t seq_num;
+    int64_t link_free_us;
+} Link;
+
+// Sends a packet every `interval_us` for `duration_us` over a link of
+// `capacity` bits per second (unlimited if 0) losing every `loss_period`-th
+// packet (none if 0), with feedback every `FEEDBACK_US`.
+static void simulate(
+    SmolRTSP_BandwidthEstimator *e, Link *link, uint64_t duration_us,
+    uint64_t interval_us, uint64_t capacity, size_t loss_period) {
+    const uint64_t end_us = link->time_us + duration_us;
+
+    while (link->time_us < end_us) {
+        int64_t arrivals_us[MAX_FEEDBACK];
+        const uint16_t base_seq_num = link->seq_num;
+        size_t count = 0;
+
+        for (const uint64_t feedback_us = link->time_us + FEEDBACK_US;
+             link->time_us < feedback_us && count < MAX_FEEDBACK;
+             link->time_us += interval_us, count++) {
+            SmolRTSP_BandwidthEstimator_on_packet_sent(
+                e, link->seq_num, PACKET_SIZE, link->time_us);
+
+            int64_t arrival_us = (int64_t)(link->time_us + BASE_DELAY_US);
+            if (capacity > 0) {
+                if (link->link_free_us > arrival_us) {
+                    arrival_us = link->link_free_us;
+                }
+                arrival_us +=
+                    (int64_t)((uint64_t)PACKET_SIZE * 8 * 1000000 / capacity);
+                arrival_us = arrival_us / 250 * 250;
+                link->link_free_us = arrival_us;
+            }
+
+            const bool lost = loss_period > 0 &&
+                              0 == link->seq_num % loss_period;
+            arrivals_us[count] = lost ? -1 : arrival_us;
+            link->seq_num++;
+        }
+
+        const int ret = ingest_feedback(
+            e, base_seq_num, arrivals_us, count,
+            link->time_us + BASE_DELAY_US);
+        assert(0 == ret);
+        (void)ret;
+    }
+}
+
+TEST increase_on_idle_link(void) {
+    SmolRTSP_BandwidthEstimator *e = SmolRTSP_BandwidthEstimator_new(
+        SmolRTSP_BandwidthEstimatorConfig_default());
+    ASSERT(e);
+    ASSERT_EQ(
+        SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE,
+        SmolRTSP_BandwidthEstimator_target_bitrate(e));
+
+    // 1.92 Mbit/s over a link with a constant delay.
+    Link link = {0};
+    simulate(e, &link, 3000000, 5000, 0, 0);
+
+    const SmolRTSP_BandwidthEstimatorStats stats =
+        SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(SmolRTSP_BandwidthUsage_Normal, stats.usage);
+    ASSERT_EQ(600, stats.packets_acked);
+    ASSERT_EQ(0, stats.packets_lost);
+    ASSERT_EQ(60, stats.feedbacks);
+    ASSERT(stats.acked_bitrate > 1800000 && stats.acked_bitrate < 2000000);
+    ASSERT(
+        stats.target_bitrate >
+        SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE * 11 / 10);
+
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(e);
+    PASS();
+}
+
+TEST decrease_on_queueing(void) {
+    SmolRTSP_BandwidthEstimatorConfig config =
+        SmolRTSP_BandwidthEstimatorConfig_default();
+    config.initial_bitrate = 2000000;
+    SmolRTSP_BandwidthEstimator *e = SmolRTSP_BandwidthEstimator_new(config);
+    ASSERT(e);
+
+    // 1.92 Mbit/s over a link of 1 Mbit/s: the queue grows steadily.
+    Link link = {0};
+    simulate(e, &link, 2000000, 5000, 1000000, 0);
+
+    const SmolRTSP_BandwidthEstimatorStats stats =
+        SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(0, stats.packets_lost);
+    ASSERT(stats.acked_bitrate > 900000 && stats.acked_bitrate < 1100000);
+    ASSERT(stats.target_bitrate < 1000000);
+    ASSERT_EQ(stats.delay_based_bitrate, stats.target_bitrate);
+
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(e);
+    PASS();
+}
+
+TEST decrease_on_loss(void) {
+    SmolRTSP_BandwidthEstimator *e = SmolRTSP_BandwidthEstimator_new(
+        SmolRTSP_BandwidthEstimatorConfig_default());
+    ASSERT(e);
+
+    // Every fifth packet is lost.
+    Link link = {0};
+    simulate(e, &link, 2000000, 5000, 0, 5);
+
+    const SmolRTSP_BandwidthEstimatorStats stats =
+        SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(80, stats.packets_lost);
+    ASSERT_EQ(320, stats.packets_acked);
+    ASSERT(stats.fraction_lost >= 50 && stats.fraction_lost <= 52);
+    ASSERT(
+        stats.target_bitrate <
+        SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_INITIAL_BITRATE / 2);
+    ASSERT_EQ(stats.loss_based_bitrate, stats.target_bitrate);
+    ASSERT(
+        stats.target_bitrate >=
+        SMOLRTSP_BANDWIDTH_ESTIMATOR_DEFAULT_MIN_BITRATE);
+
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(e);
+    PASS();
+}
+
+TEST unknown_packets(void) {
+    SmolRTSP_BandwidthEstimator *e = SmolRTSP_BandwidthEstimator_new(
+        SmolRTSP_BandwidthEstimatorConfig_default());
+    ASSERT(e);
+
+    SmolRTSP_BandwidthEstimator_on_packet_sent(e, 7, PACKET_SIZE, 0);
+
+    // Only the packet 7 has been sent.
+    const int64_t arrivals_us[] = {20000, 21000, 22000};
+    ASSERT_EQ(0, ingest_feedback(e, 6, arrivals_us, 3, 30000));
+    SmolRTSP_BandwidthEstimatorStats stats =
+        SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(1, stats.feedbacks);
+    ASSERT_EQ(1, stats.packets_acked);
+
+    // Already acknowledged.
+    ASSERT_EQ(0, ingest_feedback(e, 7, arrivals_us, 1, 40000));
+    stats = SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(2, stats.feedbacks);
+    ASSERT_EQ(1, stats.packets_acked);
+
+    // The receive deltas are missing.
+    const uint8_t malformed[] = {
+        0x8F, 205,  0, 4, 0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB,
+        0xCC, 0xDD, 0, 7, 0,    1,    0,    0,    0,    0,
+    };
+    U8Slice99 input = U8Slice99_new((uint8_t *)malformed, sizeof malformed);
+    SmolRTSP_RtcpPacket packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_BandwidthEstimator_on_feedback(e, packet, 50000));
+    ASSERT_EQ(EBADMSG, errno);
+    ASSERT_EQ(2, SmolRTSP_BandwidthEstimator_stats(e).feedbacks);
+
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(e);
+    PASS();
+}
+
+SUITE(bandwidth_estimator) {
+    RUN_TEST(increase_on_idle_link);
+    RUN_TEST(decrease_on_queueing);
+    RUN_TEST(decrease_on_loss);
+    RUN_TEST(unknown_packets);
+}
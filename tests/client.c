@@ -0,0 +1,313 @@
+#include <smolrtsp/client.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    bool playing, closed;
+    int error;
+    SmolRTSP_StatusCode status;
+
+    size_t nalus_count;
+    size_t track_id;
+    uint32_t timestamp;
+    uint8_t unit_type;
+    uint8_t payload[16];
+    size_t payload_len;
+} Recorder;
+
+static void Recorder_on_playing(VSelf, SmolRTSP_ClientSession *session) {
+    VSELF(Recorder);
+    (void)session;
+    self->playing = true;
+}
+
+static void Recorder_on_nal_unit(
+    VSelf, SmolRTSP_ClientSession *session, size_t track_id,
+    uint32_t timestamp, SmolRTSP_NalUnit nalu) {
+    VSELF(Recorder);
+    (void)session;
+
+    self->nalus_count++;
+    self->track_id = track_id;
+    self->timestamp = timestamp;
+    self->unit_type = SmolRTSP_NalHeader_unit_type(nalu.header);
+    self->payload_len = nalu.payload.len < sizeof self->payload
+                            ? nalu.payload.len
+                            : sizeof self->payload;
+    memcpy(self->payload, nalu.payload.ptr, self->payload_len);
+}
+
+static void Recorder_on_close(
+    VSelf, SmolRTSP_ClientSession *session, int error,
+    SmolRTSP_StatusCode status) {
+    VSELF(Recorder);
+    (void)session;
+
+    self->closed = true;
+    self->error = error;
+    self->status = status;
+}
+
+impl(SmolRTSP_ClientHandler, Recorder);
+
+// Listens on an ephemeral port of the loopback interface.
+static int listen_loopback(struct sockaddr_in *addr) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    *addr = (struct sockaddr_in){
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof *addr;
+    if (bind(fd, (struct sockaddr *)addr, sizeof *addr) == -1 ||
+        listen(fd, 1) == -1 ||
+        getsockname(fd, (struct sockaddr *)addr, &addr_len) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Accepts the connection of the client, with a timeout for the reads.
+static int accept_client(int listen_fd) {
+    const int fd = accept(listen_fd, NULL, NULL);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const struct timeval timeout = {.tv_sec = 2};
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) ==
+        -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Reads `count` requests (without bodies) into `buffer`, polling `client`
+// meanwhile.
+static size_t read_requests(
+    SmolRTSP_Client *client, int fd, char buffer[restrict], size_t size,
+    size_t count) {
+    size_t len = 0, found = 0;
+    buffer[0] = '\0';
+
+    for (int attempt = 0; attempt < 100 && found < count; attempt++) {
+        if (SmolRTSP_Client_poll(client, 10) == -1) {
+            break;
+        }
+
+        const ssize_t n = recv(fd, buffer + len, size - len - 1, MSG_DONTWAIT);
+        if (n <= 0) {
+            continue;
+        }
+        len += (size_t)n;
+        buffer[len] = '\0';
+
+        found = 0;
+        for (const char *s = buffer; (s = strstr(s, "\r\n\r\n")) != NULL;
+             s += 4) {
+            found++;
+        }
+    }
+
+    return found;
+}
+
+static void pump(SmolRTSP_Client *client, const bool *done) {
+    for (int attempt = 0; attempt < 100 && !*done; attempt++) {
+        if (SmolRTSP_Client_poll(client, 10) == -1) {
+            break;
+        }
+    }
+}
+
+static bool write_str(int fd, const char *s) {
+    return write(fd, s, strlen(s)) == (ssize_t)strlen(s);
+}
+
+#ifndef SMOLRTSP_NO_H265
+
+// The SDP has an H.265 track, so this test needs the H.265 support.
+static const char sdp[] = "v=0\r\n"
+                          "o=- 0 0 IN IP4 127.0.0.1\r\n"
+                          "s=cam\r\n"
+                          "a=control:*\r\n"
+                          "m=audio 0 RTP/AVP 97\r\n"
+                          "a=rtpmap:97 MPEG4-GENERIC/48000\r\n"
+                          "a=control:audio\r\n"
+                          "m=video 0 RTP/AVP 96\r\n"
+                          "a=rtpmap:96 H264/90000\r\n"
+                          "a=control:video0\r\n"
+                          "m=video 0 RTP/AVP 98\r\n"
+                          "a=rtpmap:98 H265/90000\r\n"
+                          "a=control:rtsp://127.0.0.1/cam/video1\r\n";
+
+TEST pull(void) {
+    struct sockaddr_in addr;
+    const int listen_fd = listen_loopback(&addr);
+    ASSERT(listen_fd != -1);
+
+    SmolRTSP_Client *client =
+        SmolRTSP_Client_new(SmolRTSP_ClientConfig_default());
+    ASSERT(client);
+
+    Recorder recorder = {0};
+    SmolRTSP_ClientSession *session = SmolRTSP_Client_open(
+        client, (const struct sockaddr *)&addr, sizeof addr,
+        CharSlice99_from_str("rtsp://127.0.0.1/cam"),
+        DYN(Recorder, SmolRTSP_ClientHandler, &recorder));
+    ASSERT(session);
+
+    const int fd = accept_client(listen_fd);
+    ASSERT(fd != -1);
+
+    char requests[4096];
+    char response[1024];
+
+    ASSERT_EQ(1, read_requests(client, fd, requests, sizeof requests, 1));
+    ASSERT_EQ(
+        requests,
+        strstr(requests, "DESCRIBE rtsp://127.0.0.1/cam RTSP/1.0\r\n"));
+    ASSERT(strstr(requests, "CSeq: 1\r\n"));
+    ASSERT(strstr(requests, "Accept: application/sdp\r\n"));
+
+    snprintf(
+        response, sizeof response,
+        "RTSP/1.0 200 OK\r\nCSeq: 1\r\nContent-Base: "
+        "rtsp://127.0.0.1/cam/\r\nContent-Type: "
+        "application/sdp\r\nContent-Length: %zu\r\n\r\n%s",
+        strlen(sdp), sdp);
+    ASSERT(write_str(fd, response));
+
+    // The first `SETUP` goes alone: there is no session to join yet.
+    ASSERT_EQ(1, read_requests(client, fd, requests, sizeof requests, 1));
+    ASSERT_EQ(
+        requests,
+        strstr(requests, "SETUP rtsp://127.0.0.1/cam/video0 RTSP/1.0\r\n"));
+    ASSERT(strstr(requests, "CSeq: 2\r\n"));
+    ASSERT(strstr(
+        requests, "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n"));
+    ASSERT_FALSE(strstr(requests, "Session:"));
+
+    ASSERT_EQ(2, SmolRTSP_ClientSession_tracks_count(session));
+    ASSERT_EQ(
+        SmolRTSP_NalCodec_H264,
+        SmolRTSP_ClientSession_track_codec(session, 0));
+    ASSERT_EQ(
+        SmolRTSP_NalCodec_H265,
+        SmolRTSP_ClientSession_track_codec(session, 1));
+
+    ASSERT(write_str(
+        fd, "RTSP/1.0 200 OK\r\nCSeq: 2\r\nSession: 1234;timeout=60\r\n"
+            "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n"));
+
+    // The second `SETUP` and `PLAY` are pipelined.
+    ASSERT_EQ(2, read_requests(client, fd, requests, sizeof requests, 2));
+    ASSERT_EQ(
+        requests,
+        strstr(requests, "SETUP rtsp://127.0.0.1/cam/video1 RTSP/1.0\r\n"));
+    ASSERT(strstr(
+        requests, "Transport: RTP/AVP/TCP;unicast;interleaved=2-3\r\n"));
+    ASSERT(strstr(requests, "PLAY rtsp://127.0.0.1/cam/ RTSP/1.0\r\n"));
+    ASSERT(strstr(requests, "CSeq: 4\r\n"));
+    ASSERT(strstr(requests, "Session: 1234\r\n"));
+    ASSERT_EQ(
+        SmolRTSP_ClientState_Starting, SmolRTSP_ClientSession_state(session));
+
+    ASSERT(write_str(
+        fd, "RTSP/1.0 200 OK\r\nCSeq: 3\r\nSession: 1234\r\n\r\n"
+            "RTSP/1.0 200 OK\r\nCSeq: 4\r\nSession: 1234\r\n\r\n"));
+    pump(client, &recorder.playing);
+    ASSERT(recorder.playing);
+    ASSERT_EQ(
+        SmolRTSP_ClientState_Playing, SmolRTSP_ClientSession_state(session));
+
+    // An IDR slice on the channel of the first track.
+    const uint8_t frame[] = {
+        '$',  0x00, 0x00, 0x11, 0x80, 96,   0x00, 0x01, 0x00,
+        0x01, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x65, 0xAA,
+        0xBB, 0xCC, 0xDD,
+    };
+    ASSERT_EQ((ssize_t)sizeof frame, write(fd, frame, sizeof frame));
+
+    for (int attempt = 0; attempt < 100 && 0 == recorder.nalus_count;
+         attempt++) {
+        ASSERT(SmolRTSP_Client_poll(client, 10) != -1);
+    }
+    ASSERT_EQ(1, recorder.nalus_count);
+    ASSERT_EQ(0, recorder.track_id);
+    ASSERT_EQ(0x00010000, recorder.timestamp);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, recorder.unit_type);
+    ASSERT_EQ(4, recorder.payload_len);
+    ASSERT_MEM_EQ(frame + sizeof frame - 4, recorder.payload, 4);
+
+    // The source goes away.
+    close(fd);
+    pump(client, &recorder.closed);
+    ASSERT(recorder.closed);
+    ASSERT_EQ(0, recorder.error);
+    ASSERT_EQ(0, recorder.status);
+
+    VTABLE(SmolRTSP_Client, SmolRTSP_Droppable).drop(client);
+    close(listen_fd);
+    PASS();
+}
+
+#endif
+
+TEST describe_failure(void) {
+    struct sockaddr_in addr;
+    const int listen_fd = listen_loopback(&addr);
+    ASSERT(listen_fd != -1);
+
+    SmolRTSP_Client *client =
+        SmolRTSP_Client_new(SmolRTSP_ClientConfig_default());
+    ASSERT(client);
+
+    Recorder recorder = {0};
+    ASSERT(SmolRTSP_Client_open(
+        client, (const struct sockaddr *)&addr, sizeof addr,
+        CharSlice99_from_str("rtsp://127.0.0.1/missing"),
+        DYN(Recorder, SmolRTSP_ClientHandler, &recorder)));
+
+    const int fd = accept_client(listen_fd);
+    ASSERT(fd != -1);
+
+    char requests[1024];
+    ASSERT_EQ(1, read_requests(client, fd, requests, sizeof requests, 1));
+    ASSERT(write_str(fd, "RTSP/1.0 404 Not Found\r\nCSeq: 1\r\n\r\n"));
+
+    pump(client, &recorder.closed);
+    ASSERT(recorder.closed);
+    ASSERT_EQ(EPROTO, recorder.error);
+    ASSERT_EQ(SMOLRTSP_STATUS_NOT_FOUND, recorder.status);
+
+    close(fd);
+    VTABLE(SmolRTSP_Client, SmolRTSP_Droppable).drop(client);
+    close(listen_fd);
+    PASS();
+}
+
+SUITE(client) {
+#ifndef SMOLRTSP_NO_H265
+    RUN_TEST(pull);
+#endif
+    RUN_TEST(describe_failure);
+}
@@ -4,6 +4,8 @@
 
 #include <smolrtsp/types/header.h>
 
+#include <string.h>
+
 TEST context_creation(void) {
     char buffer[32] = {0};
     const SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
@@ -115,10 +117,42 @@ TEST respond_internal_error(void) {
     PASS();
 }
 
+TEST respond_arena_overflow(void) {
+    static char buffer[4096];
+    buffer[0] = '\0';
+    SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
+
+    SmolRTSP_Context *ctx = SmolRTSP_Context_new(w, 1);
+
+    // Header values that do not fit into the arena go to the heap; the
+    // others keep using it.
+    char long_value[1025];
+    memset(long_value, 'x', sizeof long_value - 1);
+    long_value[sizeof long_value - 1] = '\0';
+
+    smolrtsp_header(ctx, SMOLRTSP_HEADER_SESSION, "%d", 12345678);
+    smolrtsp_header(ctx, SMOLRTSP_HEADER_SERVER, "%s", long_value);
+    smolrtsp_header(ctx, SMOLRTSP_HEADER_PUBLIC, "%s", "OPTIONS, DESCRIBE");
+
+    ssize_t ret = smolrtsp_respond_ok(ctx);
+    ASSERT(ret > 0);
+    ASSERT_EQ((size_t)ret, strlen(buffer));
+
+    const char *server = strstr(buffer, "Server: ");
+    ASSERT(server != NULL);
+    ASSERT_EQ(0, strncmp(server + strlen("Server: "), long_value, 1024));
+    ASSERT(strstr(buffer, "Session: 12345678\r\n") != NULL);
+    ASSERT(strstr(buffer, "Public: OPTIONS, DESCRIBE\r\n") != NULL);
+
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    PASS();
+}
+
 SUITE(context) {
     RUN_TEST(context_creation);
     RUN_TEST(respond_empty);
     RUN_TEST(respond);
     RUN_TEST(respond_ok);
     RUN_TEST(respond_internal_error);
+    RUN_TEST(respond_arena_overflow);
 }
@@ -6,11 +6,11 @@
 #include <stdbool.h>
 
 static SmolRTSP_Request options_req, describe_req, setup_req, play_req,
-    teardown_req, abracadabra_req;
+    teardown_req, get_parameter_req, abracadabra_req;
 
 typedef struct {
     bool options_completed, describe_completed, setup_completed, play_completed,
-        teardown_completed, abracadabra_completed;
+        teardown_completed, get_parameter_completed, abracadabra_completed;
     int before_invoked_n, after_invoked_n;
     bool dropped;
 } Client;
@@ -79,6 +79,19 @@ Client_teardown(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
     assert(ret > 0);
 }
 
+static void Client_get_parameter(
+    VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
+    VSELF(Client);
+
+    self->get_parameter_completed = true;
+    assert(req == &get_parameter_req);
+    smolrtsp_header(ctx, HEADER_TEST_METHOD, "get_parameter");
+    const ssize_t ret = smolrtsp_respond_ok(ctx);
+    assert(ret > 0);
+}
+
+#define Client_get_parameter_CUSTOM ()
+
 static void
 Client_unknown(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
     VSELF(Client);
@@ -120,13 +133,15 @@ impl(SmolRTSP_Controller, Client);
 
 TEST dispatch(void) {
     options_req.cseq = describe_req.cseq = setup_req.cseq = play_req.cseq =
-        teardown_req.cseq = abracadabra_req.cseq = 123;
+        teardown_req.cseq = get_parameter_req.cseq = abracadabra_req.cseq =
+            123;
 
     options_req.start_line.method = SMOLRTSP_METHOD_OPTIONS;
     describe_req.start_line.method = SMOLRTSP_METHOD_DESCRIBE;
     setup_req.start_line.method = SMOLRTSP_METHOD_SETUP;
     play_req.start_line.method = SMOLRTSP_METHOD_PLAY;
     teardown_req.start_line.method = SMOLRTSP_METHOD_TEARDOWN;
+    get_parameter_req.start_line.method = SMOLRTSP_METHOD_GET_PARAMETER;
     abracadabra_req.start_line.method = CharSlice99_from_str("Abracadabra");
 
     char buffer[256] = {0};
@@ -138,6 +153,7 @@ TEST dispatch(void) {
         .setup_completed = false,
         .play_completed = false,
         .teardown_completed = false,
+        .get_parameter_completed = false,
         .abracadabra_completed = false,
         .before_invoked_n = 0,
         .after_invoked_n = 0,
@@ -170,6 +186,12 @@ TEST dispatch(void) {
     CHECK(setup);
     CHECK(play);
     CHECK(teardown);
+    CHECK(get_parameter);
+    CHECK(abracadabra);
+
+    // Methods without a handler of their own fall back to `unknown`.
+    abracadabra_req.start_line.method = SMOLRTSP_METHOD_RECORD;
+    client.abracadabra_completed = false;
     CHECK(abracadabra);
 
 #undef CHECK
@@ -177,6 +199,50 @@ TEST dispatch(void) {
     PASS();
 }
 
+TEST dispatch_with_context(void) {
+    char buffer[256] = {0};
+    SmolRTSP_Context *ctx =
+        SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 0);
+
+    Client client = {0};
+    SmolRTSP_Controller controller = DYN(Client, SmolRTSP_Controller, &client);
+
+    options_req.start_line.method = SMOLRTSP_METHOD_OPTIONS;
+    describe_req.start_line.method = SMOLRTSP_METHOD_DESCRIBE;
+    options_req.cseq = 1;
+    describe_req.cseq = 2;
+
+    // The headers of the previous response must not leak into the next one.
+    smolrtsp_dispatch_with_context(ctx, controller, &options_req);
+    ASSERT(client.options_completed);
+    ASSERT_STR_EQ(
+        "RTSP/1.0 200 OK\r\n"
+        "CSeq: 1\r\n"
+        "Authorization: WWW-Authenticate\r\n"
+        "Server: MyServer\r\n"
+        "Test-Method: options\r\n\r\n",
+        buffer);
+    buffer[0] = '\0';
+
+    smolrtsp_dispatch_with_context(ctx, controller, &describe_req);
+    ASSERT(client.describe_completed);
+    ASSERT_STR_EQ(
+        "RTSP/1.0 200 OK\r\n"
+        "CSeq: 2\r\n"
+        "Authorization: WWW-Authenticate\r\n"
+        "Server: MyServer\r\n"
+        "Test-Method: describe\r\n\r\n",
+        buffer);
+
+    ASSERT_EQ(2, client.before_invoked_n);
+    ASSERT_EQ(2, client.after_invoked_n);
+    ASSERT_EQ(2, SmolRTSP_Context_get_cseq(ctx));
+
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    PASS();
+}
+
 SUITE(controller) {
     RUN_TEST(dispatch);
+    RUN_TEST(dispatch_with_context);
 }
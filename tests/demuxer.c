@@ -0,0 +1,165 @@
+#include <smolrtsp/demuxer.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+typedef struct {
+    int frames_n;
+    uint8_t channel_id;
+    U8Slice99 payload;
+} Recorder;
+
+static void Recorder_on_frame(VSelf, uint8_t channel_id, U8Slice99 payload) {
+    VSELF(Recorder);
+
+    self->frames_n++;
+    self->channel_id = channel_id;
+    self->payload = payload;
+}
+
+impl(SmolRTSP_FrameHandler, Recorder);
+
+static const char input_str[] = "$\x01\x00\x03"
+                                "abc"
+                                "$\x02\x00\x01"
+                                "z"
+                                "OPTIONS * RTSP/1.0\r\n"
+                                "CSeq: 1\r\n"
+                                "\r\n"
+                                "$\x01\x00\x02"
+                                "de";
+
+TEST parse_frames_and_request(void) {
+    const CharSlice99 input =
+        CharSlice99_new((char *)input_str, sizeof input_str - 1);
+    const size_t request_end = input.len - 6;
+
+    Recorder recorder = {0};
+    SmolRTSP_Demuxer demuxer = SmolRTSP_Demuxer_new();
+    const int ret = SmolRTSP_Demuxer_bind(
+        &demuxer, 1, DYN(Recorder, SmolRTSP_FrameHandler, &recorder));
+    ASSERT_EQ(0, ret);
+
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+
+    for (size_t len = 0; len < request_end; len++) {
+        const SmolRTSP_ParseResult res = SmolRTSP_Demuxer_parse(
+            &demuxer, &request, CharSlice99_sub(input, 0, len));
+        ASSERT(SmolRTSP_ParseResult_is_partial(res));
+        ASSERT_EQ(len < 7 ? 0 : 1, recorder.frames_n);
+    }
+
+    SmolRTSP_ParseResult res = SmolRTSP_Demuxer_parse(
+        &demuxer, &request, CharSlice99_sub(input, 0, request_end));
+
+    match(res) {
+        of(SmolRTSP_ParseResult_Success, status) {
+            match(*status) {
+                of(SmolRTSP_ParseStatus_Complete, offset) {
+                    ASSERT_EQ(request_end, *offset);
+                }
+                otherwise FAIL();
+            }
+        }
+        otherwise FAIL();
+    }
+
+    ASSERT_EQ(1, recorder.frames_n);
+    ASSERT_EQ(1, recorder.channel_id);
+    ASSERT_EQ(
+        (const void *)(input.ptr + 4), (const void *)recorder.payload.ptr);
+    ASSERT_EQ(3, recorder.payload.len);
+    ASSERT_EQ(1, demuxer.dropped_frames);
+    ASSERT_EQ(
+        SmolRTSP_MethodId_Options,
+        SmolRTSP_MethodId_from_method(request.start_line.method));
+    ASSERT_EQ(1, request.cseq);
+
+    // A frame that is not followed by a request.
+    const CharSlice99 rest = CharSlice99_advance(input, request_end);
+    request = SmolRTSP_Request_uninit();
+    res = SmolRTSP_Demuxer_parse(&demuxer, &request, rest);
+    ASSERT(SmolRTSP_ParseResult_is_partial(res));
+    ASSERT_EQ(2, recorder.frames_n);
+    ASSERT_MEM_EQ("de", recorder.payload.ptr, 2);
+
+    ASSERT_EQ(rest.len, SmolRTSP_Demuxer_drain(&demuxer));
+    ASSERT_EQ(0, SmolRTSP_Demuxer_drain(&demuxer));
+
+    res = SmolRTSP_Demuxer_parse(&demuxer, &request, CharSlice99_empty());
+    ASSERT(SmolRTSP_ParseResult_is_partial(res));
+    ASSERT_EQ(2, recorder.frames_n);
+
+    PASS();
+}
+
+TEST drain_started_request(void) {
+    static const char data[] = "$\x00\x00\x01xOPTIONS * RTSP/1.0\r\n";
+    const CharSlice99 input =
+        CharSlice99_new((char *)data, sizeof data - 1);
+
+    SmolRTSP_Demuxer demuxer = SmolRTSP_Demuxer_new();
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+
+    const SmolRTSP_ParseResult res =
+        SmolRTSP_Demuxer_parse(&demuxer, &request, input);
+    ASSERT(SmolRTSP_ParseResult_is_partial(res));
+    ASSERT_EQ(1, demuxer.dropped_frames);
+
+    // The request refers to the buffer, which must not move.
+    ASSERT_EQ(0, SmolRTSP_Demuxer_drain(&demuxer));
+
+    PASS();
+}
+
+TEST bind_channels(void) {
+    Recorder recorders[SMOLRTSP_DEMUXER_MAX_CHANNELS + 1] = {0};
+    SmolRTSP_Demuxer demuxer = SmolRTSP_Demuxer_new();
+
+    for (size_t i = 0; i < SMOLRTSP_DEMUXER_MAX_CHANNELS; i++) {
+        const int ret = SmolRTSP_Demuxer_bind(
+            &demuxer, (uint8_t)i,
+            DYN(Recorder, SmolRTSP_FrameHandler, &recorders[i]));
+        ASSERT_EQ(0, ret);
+    }
+
+    const SmolRTSP_FrameHandler extra = DYN(
+        Recorder, SmolRTSP_FrameHandler,
+        &recorders[SMOLRTSP_DEMUXER_MAX_CHANNELS]);
+
+    errno = 0;
+    int ret = SmolRTSP_Demuxer_bind(&demuxer, 200, extra);
+    ASSERT_EQ(-1, ret);
+    ASSERT_EQ(ENOSPC, errno);
+
+    // Rebinding an already bound channel takes no extra room.
+    ret = SmolRTSP_Demuxer_bind(&demuxer, 0, extra);
+    ASSERT_EQ(0, ret);
+
+    SmolRTSP_Demuxer_unbind(&demuxer, 3);
+    ret = SmolRTSP_Demuxer_bind(&demuxer, 200, extra);
+    ASSERT_EQ(0, ret);
+
+    static const char data[] = "$\x03\x00\x01x$\x00\x00\x01y";
+    const CharSlice99 input =
+        CharSlice99_new((char *)data, sizeof data - 1);
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+    const SmolRTSP_ParseResult res =
+        SmolRTSP_Demuxer_parse(&demuxer, &request, input);
+    ASSERT(SmolRTSP_ParseResult_is_partial(res));
+
+    ASSERT_EQ(0, recorders[3].frames_n);
+    ASSERT_EQ(0, recorders[0].frames_n);
+    ASSERT_EQ(1, recorders[SMOLRTSP_DEMUXER_MAX_CHANNELS].frames_n);
+    ASSERT_EQ(1, demuxer.dropped_frames);
+
+    PASS();
+}
+
+SUITE(demuxer) {
+    RUN_TEST(parse_frames_and_request);
+    RUN_TEST(drain_started_request);
+    RUN_TEST(bind_channels);
+}
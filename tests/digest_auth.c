@@ -0,0 +1,378 @@
+#include <smolrtsp/digest_auth.h>
+
+#include <greatest.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REALM    "smolrtsp"
+#define USERNAME "user"
+#define PASSWORD "secret"
+#define URI      "rtsp://localhost/stream"
+
+static uint64_t fake_now_us;
+
+static uint64_t fake_clock_us(void) {
+    return fake_now_us;
+}
+
+static SmolRTSP_DigestAuth *new_auth_without_users(size_t nonces_count) {
+    fake_now_us = 0;
+
+    SmolRTSP_DigestAuthConfig config = SmolRTSP_DigestAuthConfig_default(REALM);
+    config.nonces_count = nonces_count;
+    config.clock_us = fake_clock_us;
+
+    SmolRTSP_DigestAuth *auth = SmolRTSP_DigestAuth_new(config);
+    assert(auth);
+
+    return auth;
+}
+
+static SmolRTSP_DigestAuth *new_auth(size_t nonces_count) {
+    SmolRTSP_DigestAuth *auth = new_auth_without_users(nonces_count);
+    const int ret = SmolRTSP_DigestAuth_add_user(auth, USERNAME, PASSWORD);
+    assert(0 == ret);
+    (void)ret;
+
+    return auth;
+}
+
+// `smolrtsp_digest_ha1` is `MD5(a ":" b ":" c)`, which also yields the other
+// digests: the URI starts with `rtsp:`, and the password may contain colons.
+static void make_authorization(
+    char *buffer, size_t size, const char *method, const char *password,
+    const char *nonce, const char *qop_tail) {
+    char ha1[SMOLRTSP_DIGEST_HEX_LEN + 1], ha2[SMOLRTSP_DIGEST_HEX_LEN + 1],
+        response[SMOLRTSP_DIGEST_HEX_LEN + 1];
+    smolrtsp_digest_ha1(USERNAME, REALM, password, ha1);
+    smolrtsp_digest_ha1(method, "rtsp", URI + strlen("rtsp:"), ha2);
+
+    if (NULL == qop_tail) {
+        smolrtsp_digest_ha1(ha1, nonce, ha2, response);
+        snprintf(
+            buffer, size,
+            "Digest username=\"" USERNAME "\", realm=\"" REALM "\", "
+            "nonce=\"%s\", uri=\"" URI "\", response=\"%s\"",
+            nonce, response);
+    } else {
+        char tail[128];
+        snprintf(tail, sizeof tail, "%s:%s", qop_tail, ha2);
+        smolrtsp_digest_ha1(ha1, nonce, tail, response);
+
+        char nc[16], cnonce[16];
+        sscanf(qop_tail, "%8[^:]:%15[^:]", nc, cnonce);
+        snprintf(
+            buffer, size,
+            "Digest username=\"" USERNAME "\", realm=\"" REALM "\", "
+            "nonce=\"%s\", uri=\"" URI "\", qop=auth, nc=%s, cnonce=\"%s\", "
+            "response=\"%s\"",
+            nonce, nc, cnonce, response);
+    }
+}
+
+static SmolRTSP_DigestAuthResult verify(
+    SmolRTSP_DigestAuth *auth, const char *method, const char *authorization) {
+    return SmolRTSP_DigestAuth_verify(
+        auth, CharSlice99_from_str((char *)method), CharSlice99_from_str(URI),
+        CharSlice99_from_str((char *)authorization));
+}
+
+TEST parse(void) {
+    SmolRTSP_DigestCredentials creds;
+
+    ASSERT_EQ(
+        0, SmolRTSP_DigestCredentials_parse(
+               CharSlice99_from_str(
+                   "Digest username=\"Mufasa\",realm=\"testrealm@host.com\", "
+                   "nonce=\"dcd98b\", uri=\"/dir/index.html\", qop=auth, "
+                   "nc=00000001, cnonce=\"0a4f113b\", foo=\"a, b\", "
+                   "response=\"6629fae4\", opaque=\"5ccc\", algorithm=MD5"),
+               &creds));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("Mufasa"), creds.username));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("testrealm@host.com"), creds.realm));
+    ASSERT(
+        CharSlice99_primitive_eq(CharSlice99_from_str("dcd98b"), creds.nonce));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("/dir/index.html"), creds.uri));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("6629fae4"), creds.response));
+    ASSERT(
+        CharSlice99_primitive_eq(CharSlice99_from_str("MD5"), creds.algorithm));
+    ASSERT(CharSlice99_primitive_eq(CharSlice99_from_str("auth"), creds.qop));
+    ASSERT(
+        CharSlice99_primitive_eq(CharSlice99_from_str("00000001"), creds.nc));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("0a4f113b"), creds.cnonce));
+    ASSERT(
+        CharSlice99_primitive_eq(CharSlice99_from_str("5ccc"), creds.opaque));
+
+    ASSERT_EQ(
+        0, SmolRTSP_DigestCredentials_parse(
+               CharSlice99_from_str(
+                   "digest username=u, nonce=n, uri=/, response=r"),
+               &creds));
+    ASSERT(CharSlice99_is_empty(creds.realm));
+    ASSERT(CharSlice99_is_empty(creds.qop));
+
+    const char *malformed[] = {
+        "Basic dXNlcjpzZWNyZXQ=",
+        "Digest",
+        "Digest username=\"u\", nonce=\"n\", uri=\"/\"",
+        "Digest username=\"u, nonce=n, uri=/, response=r",
+        "Digest username u, nonce=n, uri=/, response=r",
+        "Digest username=u nonce=n, uri=/, response=r",
+    };
+    for (size_t i = 0; i < sizeof malformed / sizeof malformed[0]; i++) {
+        errno = 0;
+        ASSERT_EQ(
+            -1, SmolRTSP_DigestCredentials_parse(
+                    CharSlice99_from_str((char *)malformed[i]), &creds));
+        ASSERT_EQ(EBADMSG, errno);
+    }
+
+    PASS();
+}
+
+TEST ha1(void) {
+    char ha1[SMOLRTSP_DIGEST_HEX_LEN + 1];
+
+    // RFC 2617, section 3.5.
+    smolrtsp_digest_ha1("Mufasa", "testrealm@host.com", "Circle Of Life", ha1);
+    ASSERT_STR_EQ("939e7578ed9e3c518a452acee763bce9", ha1);
+
+    smolrtsp_digest_ha1("", "", "", ha1);
+    ASSERT_STR_EQ("4501c091b0366d76ea3218b6cfdd8097", ha1);
+
+    // More than one block.
+    char password[101];
+    memset(password, 'a', 100);
+    password[100] = '\0';
+    smolrtsp_digest_ha1("user", "realm", password, ha1);
+    ASSERT_STR_EQ("bfca636b1533dfa438b4411762c222fe", ha1);
+
+    PASS();
+}
+
+TEST add_user_ha1(void) {
+    SmolRTSP_DigestAuth *auth = new_auth_without_users(4);
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_DigestAuth_add_user_ha1(
+                auth, USERNAME, CharSlice99_from_str("939e7578")));
+    ASSERT_EQ(EINVAL, errno);
+    ASSERT_EQ(
+        -1, SmolRTSP_DigestAuth_add_user_ha1(
+                auth, USERNAME,
+                CharSlice99_from_str("939e7578ed9e3c518a452acee763bcez")));
+
+    char nonce[SMOLRTSP_DIGEST_NONCE_LEN + 1];
+    SmolRTSP_DigestAuth_issue_nonce(auth, nonce);
+
+    char authorization[512];
+    make_authorization(
+        authorization, sizeof authorization, "OPTIONS", PASSWORD, nonce, NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Rejected,
+        verify(auth, "OPTIONS", authorization));
+
+    // An HA1 in uppercase, as some tools write it.
+    char ha1[SMOLRTSP_DIGEST_HEX_LEN + 1];
+    smolrtsp_digest_ha1(USERNAME, REALM, PASSWORD, ha1);
+    for (char *c = ha1; *c != '\0'; c++) {
+        if (*c >= 'a' && *c <= 'f') {
+            *c = (char)(*c - 'a' + 'A');
+        }
+    }
+    ASSERT_EQ(
+        0, SmolRTSP_DigestAuth_add_user_ha1(
+               auth, USERNAME, CharSlice99_from_str(ha1)));
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "OPTIONS", authorization));
+
+    VTABLE(SmolRTSP_DigestAuth, SmolRTSP_Droppable).drop(auth);
+    PASS();
+}
+
+TEST verify_requests(void) {
+    SmolRTSP_DigestAuth *auth = new_auth(4);
+
+    char nonce[SMOLRTSP_DIGEST_NONCE_LEN + 1];
+    SmolRTSP_DigestAuth_issue_nonce(auth, nonce);
+    ASSERT_EQ(SMOLRTSP_DIGEST_NONCE_LEN, strlen(nonce));
+
+    char authorization[512];
+    make_authorization(
+        authorization, sizeof authorization, "DESCRIBE", PASSWORD, nonce,
+        NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "DESCRIBE", authorization));
+    ASSERT_EQ(0, SmolRTSP_DigestAuth_stats(auth).fast_path);
+
+    // The keep-alive requests repeat the same request.
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "DESCRIBE", authorization));
+    ASSERT_EQ(1, SmolRTSP_DigestAuth_stats(auth).fast_path);
+
+    // The same digest for another method is wrong.
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Rejected,
+        verify(auth, "PLAY", authorization));
+
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD, nonce, NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "PLAY", authorization));
+
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", "wrong", nonce, NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Rejected,
+        verify(auth, "PLAY", authorization));
+
+    // A right digest over a nonce that is not ours.
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD,
+        "00000000000000000000000000000000", NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Stale, verify(auth, "PLAY", authorization));
+
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD, nonce, NULL);
+    fake_now_us = SMOLRTSP_DIGEST_AUTH_DEFAULT_NONCE_LIFETIME_US;
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Stale, verify(auth, "PLAY", authorization));
+
+    const SmolRTSP_DigestAuthStats stats = SmolRTSP_DigestAuth_stats(auth);
+    ASSERT_EQ(3, stats.accepted);
+    ASSERT_EQ(1, stats.fast_path);
+    ASSERT_EQ(2, stats.stale);
+    ASSERT_EQ(2, stats.rejected);
+    ASSERT_EQ(0, stats.challenged);
+
+    VTABLE(SmolRTSP_DigestAuth, SmolRTSP_Droppable).drop(auth);
+    PASS();
+}
+
+TEST eviction(void) {
+    SmolRTSP_DigestAuth *auth = new_auth(2);
+
+    char first[SMOLRTSP_DIGEST_NONCE_LEN + 1], nonce[sizeof first];
+    SmolRTSP_DigestAuth_issue_nonce(auth, first);
+    SmolRTSP_DigestAuth_issue_nonce(auth, nonce);
+
+    char authorization[512];
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD, first, NULL);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "PLAY", authorization));
+
+    // The third nonce takes the slot of the first one.
+    SmolRTSP_DigestAuth_issue_nonce(auth, nonce);
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Stale, verify(auth, "PLAY", authorization));
+
+    VTABLE(SmolRTSP_DigestAuth, SmolRTSP_Droppable).drop(auth);
+    PASS();
+}
+
+TEST qop_auth(void) {
+    SmolRTSP_DigestAuth *auth = new_auth(4);
+
+    char nonce[SMOLRTSP_DIGEST_NONCE_LEN + 1];
+    SmolRTSP_DigestAuth_issue_nonce(auth, nonce);
+
+    char authorization[512];
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD, nonce,
+        "00000001:0a4f113b:auth");
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "PLAY", authorization));
+
+    // A replay.
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Rejected,
+        verify(auth, "PLAY", authorization));
+
+    make_authorization(
+        authorization, sizeof authorization, "PLAY", PASSWORD, nonce,
+        "00000002:0a4f113b:auth");
+    ASSERT_EQ(
+        SmolRTSP_DigestAuthResult_Accepted,
+        verify(auth, "PLAY", authorization));
+    ASSERT_EQ(0, SmolRTSP_DigestAuth_stats(auth).fast_path);
+
+    VTABLE(SmolRTSP_DigestAuth, SmolRTSP_Droppable).drop(auth);
+    PASS();
+}
+
+TEST check(void) {
+    SmolRTSP_DigestAuth *auth = new_auth(4);
+
+    char buffer[256] = {0};
+    SmolRTSP_Context *ctx =
+        SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 1);
+
+    SmolRTSP_Request req = SmolRTSP_Request_uninit();
+    req.start_line.method = CharSlice99_from_str("OPTIONS");
+    req.start_line.uri = CharSlice99_from_str(URI);
+    req.cseq = 1;
+
+    ASSERT_EQ(
+        SmolRTSP_ControlFlow_Break,
+        smolrtsp_digest_auth_check(auth, ctx, &req));
+
+    const char *expected_prefix =
+        "RTSP/1.0 401 Unauthorized\r\nCSeq: 1\r\n"
+        "WWW-Authenticate: Digest realm=\"" REALM "\", nonce=\"";
+    ASSERT_EQ(0, strncmp(expected_prefix, buffer, strlen(expected_prefix)));
+
+    char nonce[SMOLRTSP_DIGEST_NONCE_LEN + 1];
+    memcpy(nonce, buffer + strlen(expected_prefix), SMOLRTSP_DIGEST_NONCE_LEN);
+    nonce[SMOLRTSP_DIGEST_NONCE_LEN] = '\0';
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+
+    char authorization[512];
+    make_authorization(
+        authorization, sizeof authorization, "OPTIONS", PASSWORD, nonce, NULL);
+    SmolRTSP_HeaderMap_append(
+        &req.header_map,
+        (SmolRTSP_Header){
+            SMOLRTSP_HEADER_AUTHORIZATION,
+            CharSlice99_from_str(authorization),
+        });
+
+    memset(buffer, '\0', sizeof buffer);
+    ctx = SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 1);
+    ASSERT_EQ(
+        SmolRTSP_ControlFlow_Continue,
+        smolrtsp_digest_auth_check(auth, ctx, &req));
+    ASSERT_STR_EQ("", buffer);
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+
+    ASSERT_EQ(1, SmolRTSP_DigestAuth_stats(auth).challenged);
+
+    VTABLE(SmolRTSP_DigestAuth, SmolRTSP_Droppable).drop(auth);
+    PASS();
+}
+
+SUITE(digest_auth) {
+    RUN_TEST(parse);
+    RUN_TEST(ha1);
+    RUN_TEST(add_user_ha1);
+    RUN_TEST(verify_requests);
+    RUN_TEST(eviction);
+    RUN_TEST(qop_auth);
+    RUN_TEST(check);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <smolrtsp/transport.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FAKE_TRANSPORT_MAX_PACKETS     16
+#define FAKE_TRANSPORT_MAX_PACKET_SIZE 256
+
+// Records the transmitted packets, of which only the first
+// `FAKE_TRANSPORT_MAX_PACKET_SIZE` bytes are kept; `full` controls `is_full`.
+// Packets larger than `mtu` (if non-zero) are rejected with `EMSGSIZE`, after
+// which `max_packet_size` reports `mtu`.
+typedef struct {
+    bool full;
+    size_t mtu, max_packet_size;
+    size_t packets_count, largest_packet;
+    size_t packet_sizes[FAKE_TRANSPORT_MAX_PACKETS];
+    uint8_t packets[FAKE_TRANSPORT_MAX_PACKETS][FAKE_TRANSPORT_MAX_PACKET_SIZE];
+} FakeTransport;
+
+static void FakeTransport_drop(VSelf) {
+    VSELF(FakeTransport);
+    (void)self;
+}
+
+impl(SmolRTSP_Droppable, FakeTransport);
+
+static int FakeTransport_transmit(VSelf, SmolRTSP_IoVecSlice bufs) {
+    VSELF(FakeTransport);
+
+    const size_t len = SmolRTSP_IoVecSlice_len(bufs);
+    if (self->mtu > 0 && len > self->mtu) {
+        self->max_packet_size = self->mtu;
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (len > self->largest_packet) {
+        self->largest_packet = len;
+    }
+
+    assert(self->packets_count < FAKE_TRANSPORT_MAX_PACKETS);
+    uint8_t *packet = self->packets[self->packets_count];
+    size_t size = 0;
+    for (size_t i = 0; i < bufs.len && size < FAKE_TRANSPORT_MAX_PACKET_SIZE;
+         i++) {
+        size_t n = bufs.ptr[i].iov_len;
+        if (n > FAKE_TRANSPORT_MAX_PACKET_SIZE - size) {
+            n = FAKE_TRANSPORT_MAX_PACKET_SIZE - size;
+        }
+        if (n > 0) {
+            memcpy(packet + size, bufs.ptr[i].iov_base, n);
+        }
+        size += n;
+    }
+    self->packet_sizes[self->packets_count++] = len;
+
+    return 0;
+}
+
+static bool FakeTransport_is_full(VSelf) {
+    VSELF(FakeTransport);
+    return self->full;
+}
+
+#define FakeTransport_max_packet_size_CUSTOM ()
+static size_t FakeTransport_max_packet_size(VSelf) {
+    VSELF(FakeTransport);
+    return self->max_packet_size;
+}
+
+impl(SmolRTSP_Transport, FakeTransport);
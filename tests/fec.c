@@ -0,0 +1,246 @@
+#include <smolrtsp/fec.h>
+
+#include "fake_transport.h"
+#include <greatest.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE    12
+#define REPAIR_HEADER_SIZE 28
+
+static SmolRTSP_Transport
+new_encoder(FakeTransport *fake, SmolRTSP_FecConfig config) {
+    *fake = (FakeTransport){0};
+
+    SmolRTSP_FecEncoder *encoder = SmolRTSP_FecEncoder_new(
+        DYN(FakeTransport, SmolRTSP_Transport, fake), (SmolRTSP_Transport){0},
+        config);
+    assert(encoder);
+
+    return DYN(SmolRTSP_FecEncoder, SmolRTSP_Transport, encoder);
+}
+
+// Transmits an RTP packet of `payload_size` bytes derived from `seq_num`, with
+// the header and the payload in separate buffers.
+static int transmit_packet(
+    SmolRTSP_Transport t, uint16_t seq_num, size_t payload_size, bool marker) {
+    uint8_t header[RTP_HEADER_SIZE] = {
+        0x80,
+        (uint8_t)(96 | (marker ? 0x80 : 0)),
+        (uint8_t)(seq_num >> 8),
+        (uint8_t)seq_num,
+        0,
+        0,
+        (uint8_t)(seq_num >> 8),
+        (uint8_t)(seq_num * 3),
+        0x11,
+        0x22,
+        0x33,
+        0x44,
+    };
+
+    uint8_t payload[128];
+    assert(payload_size <= sizeof payload);
+    for (size_t i = 0; i < payload_size; i++) {
+        payload[i] = (uint8_t)(seq_num * 31 + i * 7);
+    }
+
+    struct iovec bufs[] = {
+        {.iov_base = header, .iov_len = sizeof header},
+        {.iov_base = payload, .iov_len = payload_size},
+    };
+
+    return VCALL(t, transmit, SmolRTSP_IoVecSlice_new(bufs, 2));
+}
+
+// Rebuilds the only missing packet `seq_num` of a group from its repair packet
+// and the other packets, as a receiver would.
+static size_t recover(
+    const FakeTransport *fake, size_t repair, const size_t *others,
+    size_t others_count, uint16_t seq_num, uint8_t packet[restrict]) {
+    const uint8_t *fec = fake->packets[repair] + RTP_HEADER_SIZE + 4;
+    const size_t repair_len = fake->packet_sizes[repair] - REPAIR_HEADER_SIZE;
+
+    uint8_t bits[2] = {fec[0], fec[1]};
+    uint16_t length = (uint16_t)(fec[2] << 8 | fec[3]);
+    uint8_t ts[4] = {fec[4], fec[5], fec[6], fec[7]};
+    uint8_t payload[256] = {0};
+    memcpy(payload, fake->packets[repair] + REPAIR_HEADER_SIZE, repair_len);
+
+    for (size_t i = 0; i < others_count; i++) {
+        const uint8_t *p = fake->packets[others[i]];
+        const size_t len = fake->packet_sizes[others[i]] - RTP_HEADER_SIZE;
+        bits[0] ^= p[0];
+        bits[1] ^= p[1];
+        length ^= (uint16_t)len;
+        for (size_t j = 0; j < 4; j++) {
+            ts[j] ^= p[4 + j];
+        }
+        for (size_t j = 0; j < len; j++) {
+            payload[j] ^= p[RTP_HEADER_SIZE + j];
+        }
+    }
+
+    packet[0] = 0x80 | (bits[0] & 0x3F);
+    packet[1] = bits[1];
+    packet[2] = (uint8_t)(seq_num >> 8);
+    packet[3] = (uint8_t)seq_num;
+    memcpy(packet + 4, ts, 4);
+    memcpy(packet + 8, fake->packets[repair] + RTP_HEADER_SIZE, 4);
+    memcpy(packet + RTP_HEADER_SIZE, payload, length);
+
+    return RTP_HEADER_SIZE + length;
+}
+
+TEST row_parity(void) {
+    SmolRTSP_FecConfig config = SmolRTSP_FecConfig_default();
+    config.columns = 3;
+    config.payload_ty = 110;
+    config.ssrc = 0xABCDEF01;
+
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_encoder(&fake, config);
+
+    // Lengths around the vector widths, so that every kernel tail is hit.
+    ASSERT_EQ(0, transmit_packet(t, 1000, 100, false));
+    ASSERT_EQ(0, transmit_packet(t, 1001, 37, true));
+    ASSERT_EQ(0, transmit_packet(t, 1002, 65, false));
+    ASSERT_EQ(4, fake.packets_count);
+
+    const uint8_t *repair = fake.packets[3];
+    ASSERT_EQ(REPAIR_HEADER_SIZE + 100, fake.packet_sizes[3]);
+    ASSERT_EQ(0x81, repair[0]);
+    ASSERT_EQ(110, repair[1]);
+    ASSERT_MEM_EQ(((const uint8_t[]){0xAB, 0xCD, 0xEF, 0x01}), repair + 8, 4);
+    ASSERT_MEM_EQ(((const uint8_t[]){0x11, 0x22, 0x33, 0x44}), repair + 12, 4);
+    // R=0, F=1, SN base 1000, L=3, D=0.
+    ASSERT_EQ(0x40, repair[16] & 0xC0);
+    ASSERT_MEM_EQ(((const uint8_t[]){0x03, 0xE8, 3, 0}), repair + 24, 4);
+
+    // Every packet of the row can be rebuilt from the others.
+    for (size_t lost = 0; lost < 3; lost++) {
+        size_t others[2], count = 0;
+        for (size_t i = 0; i < 3; i++) {
+            if (i != lost) {
+                others[count++] = i;
+            }
+        }
+
+        uint8_t packet[256];
+        const size_t size =
+            recover(&fake, 3, others, 2, (uint16_t)(1000 + lost), packet);
+        ASSERT_EQ(fake.packet_sizes[lost], size);
+        ASSERT_MEM_EQ(fake.packets[lost], packet, size);
+    }
+
+    const SmolRTSP_FecStats stats = SmolRTSP_FecEncoder_fec_stats(t.self);
+    ASSERT_EQ(3, stats.protected_packets);
+    ASSERT_EQ(1, stats.repair_packets);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST column_parity(void) {
+    SmolRTSP_FecConfig config = SmolRTSP_FecConfig_default();
+    config.columns = 2;
+    config.rows = 2;
+    config.row = false;
+    config.column = true;
+
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_encoder(&fake, config);
+
+    for (uint16_t seq_num = 0; seq_num < 4; seq_num++) {
+        ASSERT_EQ(0, transmit_packet(t, seq_num, 20 + seq_num, false));
+    }
+
+    // The columns complete with the packets 2 and 3.
+    ASSERT_EQ(6, fake.packets_count);
+    ASSERT_MEM_EQ(((const uint8_t[]){0, 0, 2, 2}), fake.packets[3] + 24, 4);
+    ASSERT_MEM_EQ(((const uint8_t[]){0, 1, 2, 2}), fake.packets[5] + 24, 4);
+
+    uint8_t packet[256];
+    size_t size = recover(&fake, 3, (const size_t[]){2}, 1, 0, packet);
+    ASSERT_EQ(fake.packet_sizes[0], size);
+    ASSERT_MEM_EQ(fake.packets[0], packet, size);
+
+    size = recover(&fake, 5, (const size_t[]){1}, 1, 3, packet);
+    ASSERT_EQ(fake.packet_sizes[4], size);
+    ASSERT_MEM_EQ(fake.packets[4], packet, size);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST out_of_sequence(void) {
+    SmolRTSP_FecConfig config = SmolRTSP_FecConfig_default();
+    config.columns = 2;
+    config.max_packet_size = RTP_HEADER_SIZE + 64;
+
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_encoder(&fake, config);
+
+    ASSERT_EQ(0, transmit_packet(t, 10, 8, false));
+    // A retransmission and a too large packet are forwarded as is.
+    ASSERT_EQ(0, transmit_packet(t, 10, 8, false));
+    ASSERT_EQ(0, transmit_packet(t, 11, 65, false));
+    // The gap abandons the row of the packet 10.
+    ASSERT_EQ(0, transmit_packet(t, 12, 8, false));
+    ASSERT_EQ(0, transmit_packet(t, 13, 8, false));
+
+    ASSERT_EQ(6, fake.packets_count);
+    ASSERT_MEM_EQ(((const uint8_t[]){0, 12, 2, 0}), fake.packets[5] + 24, 4);
+
+    const SmolRTSP_FecStats stats = SmolRTSP_FecEncoder_fec_stats(t.self);
+    ASSERT_EQ(3, stats.protected_packets);
+    ASSERT_EQ(2, stats.unprotected_packets);
+    ASSERT_EQ(1, stats.repair_packets);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST max_packet_size(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_encoder(&fake, SmolRTSP_FecConfig_default());
+
+    ASSERT_EQ(SMOLRTSP_FEC_DEFAULT_MAX_PACKET_SIZE, VCALL(t, max_packet_size));
+
+    fake.max_packet_size = 1200;
+    ASSERT_EQ(1200 - SMOLRTSP_FEC_OVERHEAD, VCALL(t, max_packet_size));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST sdp(void) {
+    SmolRTSP_FecConfig config = SmolRTSP_FecConfig_default();
+    config.columns = 5;
+    config.rows = 4;
+    config.column = true;
+    config.payload_ty = 100;
+
+    char buffer[256] = {0};
+    const ssize_t ret = SmolRTSP_FecConfig_sdp(
+        config, smolrtsp_string_writer(buffer), 90000, 200000);
+
+    const char *expected =
+        "a=rtpmap:100 flexfec/90000\r\n"
+        "a=fmtp:100 repair-window=200000; L=5; D=4; ToP=2\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    PASS();
+}
+
+SUITE(fec) {
+    RUN_TEST(row_parity);
+    RUN_TEST(column_parity);
+    RUN_TEST(out_of_sequence);
+    RUN_TEST(max_packet_size);
+    RUN_TEST(sdp);
+}
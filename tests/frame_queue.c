@@ -0,0 +1,152 @@
+#include <smolrtsp/frame_queue.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#define FRAMES_COUNT 2000
+
+static enum greatest_test_res
+read_exactly(int fd, size_t len, char buffer[restrict static len]) {
+    size_t received = 0;
+    while (received < len) {
+        const ssize_t n = read(fd, buffer + received, len - received);
+        ASSERT(n > 0);
+        received += (size_t)n;
+    }
+
+    PASS();
+}
+
+TEST push_frames(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    SmolRTSP_FrameQueue *queue =
+        SmolRTSP_FrameQueue_new(smolrtsp_fd_writer(&fds[0]), 0);
+
+    SmolRTSP_Transport video = smolrtsp_transport_frame_queue(queue, 0);
+    SmolRTSP_Transport audio = smolrtsp_transport_frame_queue(queue, 2);
+
+    struct iovec video_bufs[] = {
+        {.iov_base = "ab", .iov_len = 2},
+        {.iov_base = "cd", .iov_len = 2},
+    };
+    struct iovec audio_bufs[] = {{.iov_base = "xyz", .iov_len = 3}};
+
+    ASSERT_EQ(
+        0, VCALL(
+               video, transmit,
+               (SmolRTSP_IoVecSlice)Slice99_typed_from_array(video_bufs)));
+    ASSERT_EQ(
+        0, VCALL(
+               audio, transmit,
+               (SmolRTSP_IoVecSlice)Slice99_typed_from_array(audio_bufs)));
+    ASSERT_EQ(0, SmolRTSP_FrameQueue_len(queue));
+
+    // The frames are still unread, so the socket is over the limit.
+    ASSERT(VCALL(video, is_full));
+
+    static const char expected[] = "$\x00\x00\x04"
+                                   "abcd"
+                                   "$\x02\x00\x03"
+                                   "xyz";
+    char buffer[sizeof expected - 1];
+    CHECK_CALL(read_exactly(fds[1], sizeof buffer, buffer));
+    ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+    ASSERT_EQ(0, SmolRTSP_FrameQueue_failures(queue));
+
+    VCALL_SUPER(video, SmolRTSP_Droppable, drop);
+    VCALL_SUPER(audio, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_FrameQueue, SmolRTSP_Droppable).drop(queue);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+typedef struct {
+    SmolRTSP_Transport t;
+    bool ok;
+} Producer;
+
+static void *producer_routine(void *arg) {
+    Producer *producer = arg;
+
+    for (uint32_t i = 0; i < FRAMES_COUNT; i++) {
+        const uint32_t seq = htonl(i);
+        struct iovec bufs[] = {{.iov_base = (void *)&seq, .iov_len = 4}};
+
+        if (VCALL(
+                producer->t, transmit,
+                (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs)) != 0) {
+            producer->ok = false;
+        }
+    }
+
+    return NULL;
+}
+
+TEST push_concurrently(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    SmolRTSP_FrameQueue *queue =
+        SmolRTSP_FrameQueue_new(smolrtsp_fd_writer(&fds[0]), SIZE_MAX);
+
+    Producer producers[2];
+    pthread_t threads[2];
+    for (uint8_t i = 0; i < 2; i++) {
+        producers[i] = (Producer){
+            .t = smolrtsp_transport_frame_queue(queue, i),
+            .ok = true,
+        };
+        ASSERT_EQ(
+            0, pthread_create(
+                   &threads[i], NULL, producer_routine, &producers[i]));
+    }
+
+    // Every frame must arrive whole, and the frames of a channel in order.
+    static char buffer[2 * FRAMES_COUNT * 8];
+    CHECK_CALL(read_exactly(fds[1], sizeof buffer, buffer));
+
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(0, pthread_join(threads[i], NULL));
+        ASSERT(producers[i].ok);
+        VCALL_SUPER(producers[i].t, SmolRTSP_Droppable, drop);
+    }
+
+    uint32_t next_seq[2] = {0, 0};
+    for (size_t offset = 0; offset < sizeof buffer; offset += 8) {
+        ASSERT_EQ('$', buffer[offset]);
+        const uint8_t channel_id = (uint8_t)buffer[offset + 1];
+        ASSERT(channel_id < 2);
+        ASSERT_MEM_EQ("\x00\x04", buffer + offset + 2, 2);
+
+        uint32_t seq;
+        memcpy(&seq, buffer + offset + 4, sizeof seq);
+        ASSERT_EQ(next_seq[channel_id]++, ntohl(seq));
+    }
+
+    ASSERT_EQ(FRAMES_COUNT, next_seq[0]);
+    ASSERT_EQ(FRAMES_COUNT, next_seq[1]);
+    ASSERT_EQ(0, SmolRTSP_FrameQueue_len(queue));
+
+    VTABLE(SmolRTSP_FrameQueue, SmolRTSP_Droppable).drop(queue);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+SUITE(frame_queue) {
+    RUN_TEST(push_frames);
+    RUN_TEST(push_concurrently);
+}
@@ -0,0 +1,131 @@
+#include <smolrtsp/gop_cache.h>
+
+#include <greatest.h>
+
+#include <assert.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdint.h>
+
+#define RTP_HEADER_SIZE 12
+
+static uint8_t payload[8];
+
+static void push(SmolRTSP_GopCache *cache, uint32_t ts, uint8_t unit_type) {
+    const int ret = SmolRTSP_GopCache_push(
+        cache, SmolRTSP_RtpTimestamp_Raw(ts),
+        (SmolRTSP_NalUnit){
+            SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+                .forbidden_zero_bit = false,
+                .ref_idc = 0b11,
+                .unit_type = unit_type,
+            }),
+            U8Slice99_new(payload, sizeof payload),
+        });
+    assert(0 == ret);
+    (void)ret;
+}
+
+static void push_gop(SmolRTSP_GopCache *cache, uint32_t ts, size_t frames) {
+    push(cache, ts, SMOLRTSP_H264_NAL_UNIT_SPS);
+    push(cache, ts, SMOLRTSP_H264_NAL_UNIT_PPS);
+    push(cache, ts, SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR);
+    for (size_t i = 1; i < frames; i++) {
+        push(
+            cache, ts + (uint32_t)i * 3000,
+            SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    }
+}
+
+TEST keeps_last_gop(void) {
+    SmolRTSP_GopCache *cache = SmolRTSP_GopCache_new(1024);
+
+    // Nothing before the first IDR is cached.
+    push(cache, 0, SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    ASSERT_EQ(0, SmolRTSP_GopCache_len(cache));
+
+    push_gop(cache, 3000, 3);
+    ASSERT_EQ(5, SmolRTSP_GopCache_len(cache));
+    ASSERT_EQ(6000, SmolRTSP_GopCache_duration(cache));
+
+    // The next IDR replaces the GOP, keeping its own parameter sets.
+    push_gop(cache, 30000, 2);
+    ASSERT_EQ(4, SmolRTSP_GopCache_len(cache));
+    ASSERT_EQ(3000, SmolRTSP_GopCache_duration(cache));
+
+    SmolRTSP_GopCache *ref = SmolRTSP_GopCache_ref(cache);
+    ASSERT_EQ(cache, ref);
+    VTABLE(SmolRTSP_GopCache, SmolRTSP_Droppable).drop(ref);
+    ASSERT_EQ(4, SmolRTSP_GopCache_len(cache));
+
+    VTABLE(SmolRTSP_GopCache, SmolRTSP_Droppable).drop(cache);
+    PASS();
+}
+
+TEST overflow(void) {
+    // Room for three NAL units.
+    SmolRTSP_GopCache *cache = SmolRTSP_GopCache_new(3 * sizeof payload);
+
+    push_gop(cache, 0, 1);
+    ASSERT_EQ(3, SmolRTSP_GopCache_len(cache));
+
+    // A GOP that does not fit is discarded until the next IDR.
+    push(cache, 3000, SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    ASSERT_EQ(0, SmolRTSP_GopCache_len(cache));
+    push(cache, 6000, SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    ASSERT_EQ(0, SmolRTSP_GopCache_len(cache));
+
+    push_gop(cache, 9000, 1);
+    ASSERT_EQ(3, SmolRTSP_GopCache_len(cache));
+
+    VTABLE(SmolRTSP_GopCache, SmolRTSP_Droppable).drop(cache);
+    PASS();
+}
+
+TEST replay(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000));
+
+    SmolRTSP_GopCache *cache = SmolRTSP_GopCache_new(1024);
+    push_gop(cache, 100000, 3);
+
+    ASSERT_EQ(
+        0, SmolRTSP_GopCache_replay(cache, t, SmolRTSP_RtpTimestamp_Raw(500)));
+
+    const uint32_t expected_ts[] = {500, 500, 500, 3500, 6500};
+    const uint8_t expected_types[] = {
+        SMOLRTSP_H264_NAL_UNIT_SPS,
+        SMOLRTSP_H264_NAL_UNIT_PPS,
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR,
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR,
+    };
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(expected_ts); i++) {
+        uint8_t packet[64];
+        const ssize_t len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+        ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload), len);
+
+        const uint32_t ts = (uint32_t)packet[4] << 24 |
+                            (uint32_t)packet[5] << 16 |
+                            (uint32_t)packet[6] << 8 | packet[7];
+        ASSERT_EQ(expected_ts[i], ts);
+        ASSERT_EQ(expected_types[i], packet[RTP_HEADER_SIZE] & 0x1F);
+    }
+
+    VTABLE(SmolRTSP_GopCache, SmolRTSP_Droppable).drop(cache);
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+SUITE(gop_cache) {
+    RUN_TEST(keeps_last_gop);
+    RUN_TEST(overflow);
+    RUN_TEST(replay);
+}
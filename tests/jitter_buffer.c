@@ -0,0 +1,227 @@
+#include <smolrtsp/jitter_buffer.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LATENCY_US 1000
+
+// Pushes an RTP packet with `seq_num`, whose payload byte is `seq_num`
+// truncated.
+static int push(SmolRTSP_JitterBuffer *jb, uint16_t seq_num, uint64_t now_us) {
+    uint8_t packet[13] = {0x80, 96, (uint8_t)(seq_num >> 8), (uint8_t)seq_num};
+    packet[12] = (uint8_t)seq_num;
+
+    return SmolRTSP_JitterBuffer_push(
+        jb, U8Slice99_new(packet, sizeof packet), now_us);
+}
+
+static enum greatest_test_res
+expect_pop(SmolRTSP_JitterBuffer *jb, uint64_t now_us, uint16_t seq_num) {
+    U8Slice99 packet;
+    ASSERT(SmolRTSP_JitterBuffer_pop(jb, now_us, &packet));
+    ASSERT_EQ(13, packet.len);
+    ASSERT_EQ(seq_num, (uint16_t)(packet.ptr[2] << 8 | packet.ptr[3]));
+    ASSERT_EQ((uint8_t)seq_num, packet.ptr[12]);
+
+    PASS();
+}
+
+static bool can_pop(SmolRTSP_JitterBuffer *jb, uint64_t now_us) {
+    U8Slice99 packet;
+    return SmolRTSP_JitterBuffer_pop(jb, now_us, &packet);
+}
+
+TEST reorder(void) {
+    SmolRTSP_JitterBuffer *jb = SmolRTSP_JitterBuffer_new(8, 64, LATENCY_US);
+    ASSERT(jb);
+
+    // In order: released at once.
+    ASSERT_EQ(0, push(jb, 10, 0));
+    CHECK_CALL(expect_pop(jb, 0, 10));
+    ASSERT_FALSE(can_pop(jb, 0));
+
+    // 12 waits for 11.
+    ASSERT_EQ(0, push(jb, 12, 0));
+    ASSERT_FALSE(can_pop(jb, 10));
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_len(jb));
+    ASSERT_EQ(0, push(jb, 11, 20));
+    CHECK_CALL(expect_pop(jb, 20, 11));
+    CHECK_CALL(expect_pop(jb, 20, 12));
+    ASSERT_FALSE(can_pop(jb, 20));
+
+    // Across the wraparound of the sequence numbers.
+    SmolRTSP_JitterBuffer *wrap =
+        SmolRTSP_JitterBuffer_new(8, 64, LATENCY_US);
+    ASSERT(wrap);
+    const uint16_t arrivals[] = {65534, 0, 65535, 1};
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_EQ(0, push(wrap, arrivals[i], 0));
+    }
+    const uint16_t order[] = {65534, 65535, 0, 1};
+    for (size_t i = 0; i < 4; i++) {
+        CHECK_CALL(expect_pop(wrap, 0, order[i]));
+    }
+
+    const SmolRTSP_JitterBufferStats stats = SmolRTSP_JitterBuffer_stats(wrap);
+    ASSERT_EQ(4, stats.packets);
+    ASSERT_EQ(0, stats.lost);
+
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(jb);
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(wrap);
+    PASS();
+}
+
+TEST loss(void) {
+    SmolRTSP_JitterBuffer *jb = SmolRTSP_JitterBuffer_new(8, 64, LATENCY_US);
+    ASSERT(jb);
+
+    ASSERT_EQ(0, push(jb, 10, 0));
+    ASSERT_EQ(0, push(jb, 12, 100));
+    CHECK_CALL(expect_pop(jb, 100, 10));
+
+    // 11 is reported once.
+    SmolRTSP_RtcpNack nacks[2];
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_nacks(jb, nacks, 2));
+    ASSERT_EQ(11, nacks[0].seq_num);
+    ASSERT_EQ(0, nacks[0].bitmask);
+    ASSERT_EQ(0, SmolRTSP_JitterBuffer_nacks(jb, nacks, 2));
+
+    // 12 is held for the latency budget from its arrival.
+    ASSERT_FALSE(can_pop(jb, 100 + LATENCY_US - 1));
+    CHECK_CALL(expect_pop(jb, 100 + LATENCY_US, 12));
+
+    // 11 is too late now.
+    ASSERT_EQ(0, push(jb, 11, 2000));
+    ASSERT_FALSE(can_pop(jb, 2000));
+
+    const SmolRTSP_JitterBufferStats stats = SmolRTSP_JitterBuffer_stats(jb);
+    ASSERT_EQ(2, stats.packets);
+    ASSERT_EQ(1, stats.lost);
+    ASSERT_EQ(1, stats.late);
+
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(jb);
+    PASS();
+}
+
+TEST nacks(void) {
+    SmolRTSP_JitterBuffer *jb = SmolRTSP_JitterBuffer_new(64, 64, LATENCY_US);
+    ASSERT(jb);
+
+    const uint16_t arrivals[] = {100, 103, 105, 130};
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_EQ(0, push(jb, arrivals[i], 0));
+    }
+    // 104 arrives before the report.
+    ASSERT_EQ(0, push(jb, 104, 0));
+
+    // 101, 102, and 106-129 are missing; the NACKs that do not fit are
+    // reported next time.
+    SmolRTSP_RtcpNack nacks[2];
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_nacks(jb, nacks, 1));
+    ASSERT_EQ(101, nacks[0].seq_num);
+    // 102 and 106-117.
+    ASSERT_EQ(0xFFF1, nacks[0].bitmask);
+
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_nacks(jb, nacks, 2));
+    ASSERT_EQ(118, nacks[0].seq_num);
+    // 119-129.
+    ASSERT_EQ(0x07FF, nacks[0].bitmask);
+    ASSERT_EQ(0, SmolRTSP_JitterBuffer_nacks(jb, nacks, 2));
+
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(jb);
+    PASS();
+}
+
+TEST reset_and_errors(void) {
+    SmolRTSP_JitterBuffer *jb = SmolRTSP_JitterBuffer_new(4, 13, LATENCY_US);
+    ASSERT(jb);
+
+    ASSERT_EQ(0, push(jb, 0, 0));
+    ASSERT_EQ(0, push(jb, 2, 0));
+    ASSERT_EQ(0, push(jb, 2, 0));
+
+    // Too far ahead for four slots.
+    ASSERT_EQ(0, push(jb, 10, 0));
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_len(jb));
+    CHECK_CALL(expect_pop(jb, 0, 10));
+
+    uint8_t packet[14] = {0x80, 96};
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_JitterBuffer_push(jb, U8Slice99_new(packet, 11), 0));
+    ASSERT_EQ(EBADMSG, errno);
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_JitterBuffer_push(jb, U8Slice99_new(packet, 14), 0));
+    ASSERT_EQ(EMSGSIZE, errno);
+
+    const SmolRTSP_JitterBufferStats stats = SmolRTSP_JitterBuffer_stats(jb);
+    ASSERT_EQ(3, stats.packets);
+    ASSERT_EQ(1, stats.duplicates);
+    ASSERT_EQ(2, stats.discarded);
+    ASSERT_EQ(0, stats.lost);
+
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(jb);
+    PASS();
+}
+
+TEST restart(void) {
+    SmolRTSP_JitterBuffer *jb = SmolRTSP_JitterBuffer_new(8, 64, LATENCY_US);
+    ASSERT(jb);
+
+    ASSERT_EQ(0, push(jb, 2000, 0));
+    CHECK_CALL(expect_pop(jb, 0, 2000));
+    ASSERT_EQ(0, push(jb, 2002, 0));
+
+    // Slightly late packets never restart the buffer.
+    for (size_t i = 0; i < 16; i++) {
+        ASSERT_EQ(0, push(jb, 1999, 0));
+    }
+    ASSERT_EQ(1, SmolRTSP_JitterBuffer_len(jb));
+
+    // The sequence jumps backwards by 1000: the first packets are taken for
+    // late ones, then the output resumes.
+    for (uint16_t seq_num = 1000; seq_num < 1008; seq_num++) {
+        ASSERT_EQ(0, push(jb, seq_num, 0));
+    }
+    CHECK_CALL(expect_pop(jb, 0, 1007));
+    ASSERT_EQ(0, push(jb, 1008, 0));
+    CHECK_CALL(expect_pop(jb, 0, 1008));
+    ASSERT_FALSE(can_pop(jb, 0));
+
+    // A new SSRC is followed at once.
+    uint8_t packet[13] = {0x80, 96, 0, 5, 0, 0, 0, 0, 0x11, 0x22, 0x33, 0x44};
+    packet[12] = 5;
+    ASSERT_EQ(
+        0, SmolRTSP_JitterBuffer_push(
+               jb, U8Slice99_new(packet, sizeof packet), 0));
+    CHECK_CALL(expect_pop(jb, 0, 5));
+
+    const SmolRTSP_JitterBufferStats stats = SmolRTSP_JitterBuffer_stats(jb);
+    ASSERT_EQ(5, stats.packets);
+    ASSERT_EQ(16 + 7, stats.late);
+    // 2002, held when the sequence jumped.
+    ASSERT_EQ(1, stats.discarded);
+    ASSERT_EQ(0, stats.lost);
+
+    VTABLE(SmolRTSP_JitterBuffer, SmolRTSP_Droppable).drop(jb);
+    PASS();
+}
+
+TEST overflow(void) {
+    errno = 0;
+    ASSERT_EQ(NULL, SmolRTSP_JitterBuffer_new(4, SIZE_MAX / 2, LATENCY_US));
+    ASSERT_EQ(EINVAL, errno);
+
+    PASS();
+}
+
+SUITE(jitter_buffer) {
+    RUN_TEST(reorder);
+    RUN_TEST(loss);
+    RUN_TEST(nacks);
+    RUN_TEST(reset_and_errors);
+    RUN_TEST(restart);
+    RUN_TEST(overflow);
+}
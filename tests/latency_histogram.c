@@ -0,0 +1,107 @@
+#include <smolrtsp/latency_histogram.h>
+
+#include <greatest.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+static SmolRTSP_LatencyHistogram *new_histogram(void) {
+    SmolRTSP_LatencyHistogram *self = calloc(1, sizeof *self);
+    assert(self);
+    return self;
+}
+
+TEST exact_small_values(void) {
+    SmolRTSP_LatencyHistogram *h = new_histogram();
+
+    for (uint64_t value = 1; value <= 10; value++) {
+        SmolRTSP_LatencyHistogram_record(h, value);
+    }
+
+    ASSERT_EQ(10, h->total_count);
+    ASSERT_EQ(55, h->sum_us);
+    ASSERT_EQ(10, h->max_us);
+    ASSERT_EQ(5, SmolRTSP_LatencyHistogram_mean(h));
+
+    ASSERT_EQ(1, SmolRTSP_LatencyHistogram_value_at_percentile(h, 0));
+    ASSERT_EQ(5, SmolRTSP_LatencyHistogram_value_at_percentile(h, 50));
+    ASSERT_EQ(9, SmolRTSP_LatencyHistogram_value_at_percentile(h, 90));
+    ASSERT_EQ(10, SmolRTSP_LatencyHistogram_value_at_percentile(h, 100));
+
+    free(h);
+    PASS();
+}
+
+TEST relative_precision(void) {
+    const uint64_t values[] = {100, 1000, 12345, 1000000, UINT64_C(3000000000)};
+    for (size_t i = 0; i < sizeof values / sizeof values[0]; i++) {
+        SmolRTSP_LatencyHistogram *h = new_histogram();
+        SmolRTSP_LatencyHistogram_record(h, values[i]);
+        SmolRTSP_LatencyHistogram_record(h, UINT64_C(5000000000));
+
+        // The value is rounded up to its bucket by at most 1/16.
+        const uint64_t median =
+            SmolRTSP_LatencyHistogram_value_at_percentile(h, 50);
+        ASSERT(median >= values[i]);
+        ASSERT(median - values[i] <= values[i] / 16);
+
+        free(h);
+    }
+
+    // Beyond the maximum value, only `max_us` is exact.
+    SmolRTSP_LatencyHistogram *h = new_histogram();
+    SmolRTSP_LatencyHistogram_record(h, UINT64_C(5000000000));
+    ASSERT_EQ(
+        UINT64_C(5000000000),
+        SmolRTSP_LatencyHistogram_value_at_percentile(h, 100));
+
+    free(h);
+    PASS();
+}
+
+TEST snapshot_and_merge(void) {
+    SmolRTSP_LatencyHistogram *a = new_histogram(), *b = new_histogram(),
+                              *total = new_histogram();
+
+    for (int i = 0; i < 90; i++) {
+        SmolRTSP_LatencyHistogram_record(a, 20);
+    }
+    for (int i = 0; i < 10; i++) {
+        SmolRTSP_LatencyHistogram_record(b, 5000);
+    }
+
+    SmolRTSP_LatencyHistogram *snapshot = new_histogram();
+    SmolRTSP_LatencyHistogram_snapshot(a, snapshot);
+    SmolRTSP_LatencyHistogram_merge(total, snapshot);
+    SmolRTSP_LatencyHistogram_snapshot(b, snapshot);
+    SmolRTSP_LatencyHistogram_merge(total, snapshot);
+
+    ASSERT_EQ(100, total->total_count);
+    ASSERT_EQ(90 * 20 + 10 * 5000, total->sum_us);
+    ASSERT_EQ(5000, total->max_us);
+    ASSERT_EQ(20, SmolRTSP_LatencyHistogram_value_at_percentile(total, 90));
+    ASSERT_EQ(5000, SmolRTSP_LatencyHistogram_value_at_percentile(total, 99));
+
+    free(a);
+    free(b);
+    free(total);
+    free(snapshot);
+    PASS();
+}
+
+TEST empty(void) {
+    SmolRTSP_LatencyHistogram *h = new_histogram();
+
+    ASSERT_EQ(0, SmolRTSP_LatencyHistogram_value_at_percentile(h, 99));
+    ASSERT_EQ(0, SmolRTSP_LatencyHistogram_mean(h));
+
+    free(h);
+    PASS();
+}
+
+SUITE(latency_histogram) {
+    RUN_TEST(exact_small_values);
+    RUN_TEST(relative_precision);
+    RUN_TEST(snapshot_and_merge);
+    RUN_TEST(empty);
+}
@@ -0,0 +1,474 @@
+#include <smolrtsp/live_source.h>
+
+#include <greatest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdint.h>
+
+#define RTP_HEADER_SIZE 12
+
+static uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static SmolRTSP_NalUnit nalu(uint8_t unit_type) {
+    return (SmolRTSP_NalUnit){
+        SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+            .forbidden_zero_bit = false,
+            .ref_idc = 0b11,
+            .unit_type = unit_type,
+        }),
+        U8Slice99_new(payload, sizeof payload),
+    };
+}
+
+static SmolRTSP_LiveFrame *idr_frame(uint32_t ts) {
+    const SmolRTSP_NalUnit nalus[] = {
+        nalu(SMOLRTSP_H264_NAL_UNIT_SPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_PPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR),
+    };
+    return SmolRTSP_LiveFrame_new(
+        SmolRTSP_RtpTimestamp_Raw(ts), nalus, SLICE99_ARRAY_LEN(nalus));
+}
+
+static SmolRTSP_LiveFrame *non_idr_frame(uint32_t ts) {
+    const SmolRTSP_NalUnit slice =
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    return SmolRTSP_LiveFrame_new(SmolRTSP_RtpTimestamp_Raw(ts), &slice, 1);
+}
+
+// Receives the `n` packets of a frame, checking that only the last one is
+// marked.
+static enum greatest_test_res
+recv_packets(int fd, size_t n, uint32_t expected_ts) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t packet[64];
+        const ssize_t len = recv(fd, packet, sizeof packet, MSG_DONTWAIT);
+        ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload), len);
+
+        const uint32_t ts = (uint32_t)packet[4] << 24 |
+                            (uint32_t)packet[5] << 16 |
+                            (uint32_t)packet[6] << 8 | packet[7];
+        ASSERT_EQ(expected_ts, ts);
+        ASSERT_EQ(i + 1 == n, (packet[1] & 0x80) != 0);
+    }
+
+    PASS();
+}
+
+TEST frame(void) {
+    SmolRTSP_LiveFrame *frame = idr_frame(3000);
+
+    ASSERT(SmolRTSP_LiveFrame_is_idr(frame));
+    ASSERT_EQ(3, SmolRTSP_LiveFrame_nalus_count(frame));
+    const SmolRTSP_RtpTimestamp ts = SmolRTSP_LiveFrame_timestamp(frame);
+    match(ts) {
+        of(SmolRTSP_RtpTimestamp_Raw, raw) ASSERT_EQ(3000, *raw);
+        otherwise FAIL();
+    }
+
+    // The NAL units are copied.
+    const SmolRTSP_NalUnit copy = SmolRTSP_LiveFrame_nalu(frame, 2);
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        SmolRTSP_NalHeader_unit_type(copy.header));
+    ASSERT(copy.payload.ptr != payload);
+    ASSERT_MEM_EQ(payload, copy.payload.ptr, sizeof payload);
+
+    SmolRTSP_LiveFrame *ref = SmolRTSP_LiveFrame_ref(frame);
+    ASSERT_EQ(frame, ref);
+    VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(ref);
+    VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(frame);
+
+    frame = non_idr_frame(0);
+    ASSERT(!SmolRTSP_LiveFrame_is_idr(frame));
+    VTABLE(SmolRTSP_LiveFrame, SmolRTSP_Droppable).drop(frame);
+    PASS();
+}
+
+TEST subscribe(void) {
+    int fds[2][2];
+    SmolRTSP_NalTransport *t[2];
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]));
+        t[i] = SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_udp(fds[i][0]), 96, 90000));
+    }
+
+    SmolRTSP_LiveSource *source = SmolRTSP_LiveSource_new(4);
+    SmolRTSP_LiveSource_push(source, non_idr_frame(0));
+
+    // Without an IDR in the ring, the first subscriber waits for one.
+    SmolRTSP_LiveSubscriber *first = SmolRTSP_LiveSubscriber_new(source, t[0]);
+    ASSERT_EQ(0, SmolRTSP_LiveSubscriber_pump(first, 10));
+
+    SmolRTSP_LiveSource_push(source, idr_frame(3000));
+    SmolRTSP_LiveSource_push(source, non_idr_frame(6000));
+    ASSERT_EQ(3, SmolRTSP_LiveSource_frames_count(source));
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_lag(first));
+
+    // Each subscriber goes at its own pace.
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(first, 1));
+    CHECK_CALL(recv_packets(fds[0][1], 3, 3000));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_lag(first));
+
+    // A later subscriber starts from the latest IDR.
+    SmolRTSP_LiveSubscriber *second =
+        SmolRTSP_LiveSubscriber_new(source, t[1]);
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_lag(second));
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_pump(second, 10));
+    CHECK_CALL(recv_packets(fds[1][1], 3, 3000));
+    CHECK_CALL(recv_packets(fds[1][1], 1, 6000));
+
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(first, 10));
+    CHECK_CALL(recv_packets(fds[0][1], 1, 6000));
+
+    ASSERT_EQ(0, SmolRTSP_LiveSubscriber_skipped(first));
+    ASSERT_EQ(0, SmolRTSP_LiveSubscriber_skipped(second));
+
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(first);
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(second);
+    VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(source);
+    for (size_t i = 0; i < 2; i++) {
+        VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t[i]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    PASS();
+}
+
+TEST overrun(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000));
+
+    SmolRTSP_LiveSource *source = SmolRTSP_LiveSource_new(4);
+    SmolRTSP_LiveSource_push(source, idr_frame(0));
+
+    SmolRTSP_LiveSubscriber *sub = SmolRTSP_LiveSubscriber_new(source, t);
+
+    for (uint32_t i = 1; i <= 6; i++) {
+        SmolRTSP_LiveSource_push(source, non_idr_frame(i * 3000));
+    }
+
+    // The IDR has left the ring, so the subscriber waits for the next one.
+    ASSERT_EQ(0, SmolRTSP_LiveSubscriber_pump(sub, 10));
+    ASSERT_EQ(7, SmolRTSP_LiveSubscriber_skipped(sub));
+
+    SmolRTSP_LiveSource_push(source, non_idr_frame(21000));
+    SmolRTSP_LiveSource_push(source, idr_frame(24000));
+    SmolRTSP_LiveSource_push(source, non_idr_frame(27000));
+
+    // After the next overrun, it resumes from the IDR still in the ring.
+    for (uint32_t i = 10; i <= 11; i++) {
+        SmolRTSP_LiveSource_push(source, non_idr_frame(i * 3000));
+    }
+    ASSERT_EQ(4, SmolRTSP_LiveSubscriber_pump(sub, 10));
+    ASSERT_EQ(8, SmolRTSP_LiveSubscriber_skipped(sub));
+    CHECK_CALL(recv_packets(fds[1], 3, 24000));
+    for (uint32_t i = 9; i <= 11; i++) {
+        CHECK_CALL(recv_packets(fds[1], 1, i * 3000));
+    }
+
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(sub);
+    VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(source);
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+static uint64_t fake_now_us;
+
+static uint64_t fake_clock_us(void) {
+    return fake_now_us;
+}
+
+static void count_keyframe_request(void *user_data) {
+    (*(size_t *)user_data)++;
+}
+
+TEST keyframe_requests(void) {
+    int fds[2][2];
+    SmolRTSP_RtpTransport *rtp[2];
+    SmolRTSP_NalTransport *t[2];
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]));
+        rtp[i] = SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_udp(fds[i][0]), 96, 90000);
+        t[i] = SmolRTSP_NalTransport_new(rtp[i]);
+    }
+
+    size_t encoder_requests = 0;
+    fake_now_us = 0;
+
+    SmolRTSP_KeyframeRequestConfig config =
+        SmolRTSP_KeyframeRequestConfig_default();
+    config.request_keyframe = count_keyframe_request;
+    config.user_data = &encoder_requests;
+    config.clock_us = fake_clock_us;
+
+    SmolRTSP_LiveSource *source = SmolRTSP_LiveSource_new(4);
+    SmolRTSP_LiveSource_set_keyframe_requests(source, config);
+    SmolRTSP_LiveSource_push(source, idr_frame(0));
+
+    // A client that has just joined is served from the ring.
+    SmolRTSP_LiveSubscriber *first = SmolRTSP_LiveSubscriber_new(source, t[0]);
+    SmolRTSP_LiveSubscriber *second =
+        SmolRTSP_LiveSubscriber_new(source, t[1]);
+    ASSERT_FALSE(SmolRTSP_LiveSubscriber_request_keyframe(first));
+    ASSERT_EQ(0, encoder_requests);
+
+    SmolRTSP_LiveSource_push(source, non_idr_frame(3000));
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_pump(first, 10));
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_pump(second, 10));
+
+    // A storm of requests results in a single encoder callback.
+    ASSERT(SmolRTSP_LiveSubscriber_request_keyframe(first));
+    fake_now_us = config.window_us - 1;
+    ASSERT_FALSE(SmolRTSP_LiveSubscriber_request_keyframe(second));
+    ASSERT_FALSE(SmolRTSP_LiveSubscriber_request_keyframe(first));
+    ASSERT_EQ(1, encoder_requests);
+
+    // A PLI ingested by the RTP transport is picked up by the next pump.
+    uint8_t packet[64];
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload),
+        recv(fds[1][1], packet, sizeof packet, MSG_DONTWAIT));
+    const uint8_t pli[] = {
+        0x81,      206,       0,         2,         0,         0,
+        0,         1,         packet[8], packet[9], packet[10], packet[11],
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_ingest_rtcp(
+               rtp[1], U8Slice99_new((uint8_t *)pli, sizeof pli), 0));
+
+    fake_now_us = config.window_us;
+    ASSERT_EQ(0, SmolRTSP_LiveSubscriber_pump(second, 10));
+    ASSERT_EQ(2, encoder_requests);
+
+    const SmolRTSP_KeyframeRequestStats stats =
+        SmolRTSP_LiveSource_keyframe_request_stats(source);
+    ASSERT_EQ(5, stats.requests);
+    ASSERT_EQ(2, stats.forwarded);
+    ASSERT_EQ(2, stats.coalesced);
+    ASSERT_EQ(1, stats.served_from_ring);
+
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(first);
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(second);
+    VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(source);
+    for (size_t i = 0; i < 2; i++) {
+        VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t[i]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    PASS();
+}
+
+static SmolRTSP_LiveFrame *idr_only_frame(uint32_t ts) {
+    const SmolRTSP_NalUnit slice = nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR);
+    return SmolRTSP_LiveFrame_new(SmolRTSP_RtpTimestamp_Raw(ts), &slice, 1);
+}
+
+// Receives a packet of a stream, checking that it follows the previous one
+// (`*seq_num`) of the same SSRC (`*ssrc`).
+static enum greatest_test_res recv_next_packet(
+    int fd, uint8_t expected_unit_type, uint16_t *restrict seq_num,
+    uint32_t *restrict ssrc) {
+    uint8_t packet[64];
+    const ssize_t len = recv(fd, packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload), len);
+
+    const uint16_t packet_seq_num = (uint16_t)(packet[2] << 8 | packet[3]);
+    const uint32_t packet_ssrc = (uint32_t)packet[8] << 24 |
+                                 (uint32_t)packet[9] << 16 |
+                                 (uint32_t)packet[10] << 8 | packet[11];
+    ASSERT_EQ((uint16_t)(*seq_num + 1), packet_seq_num);
+    ASSERT_EQ(*ssrc, packet_ssrc);
+    ASSERT_EQ(expected_unit_type, packet[RTP_HEADER_SIZE] & 0x1F);
+
+    *seq_num = packet_seq_num;
+    PASS();
+}
+
+TEST switch_rendition(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000));
+
+    size_t encoder_requests = 0;
+    SmolRTSP_KeyframeRequestConfig config =
+        SmolRTSP_KeyframeRequestConfig_default();
+    config.request_keyframe = count_keyframe_request;
+    config.user_data = &encoder_requests;
+
+    SmolRTSP_LiveSource *main = SmolRTSP_LiveSource_new(4),
+                        *sub = SmolRTSP_LiveSource_new(4);
+    SmolRTSP_LiveSource_set_keyframe_requests(sub, config);
+    SmolRTSP_LiveSource_push(main, idr_frame(0));
+    SmolRTSP_LiveSource_push(sub, idr_frame(0));
+
+    SmolRTSP_LiveSubscriber *subscriber = SmolRTSP_LiveSubscriber_new(main, t);
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(subscriber, 10));
+
+    uint8_t packet[64];
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload),
+        recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload),
+        recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload),
+        recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+    uint16_t seq_num = (uint16_t)(packet[2] << 8 | packet[3]);
+    uint32_t ssrc = (uint32_t)packet[8] << 24 | (uint32_t)packet[9] << 16 |
+                    (uint32_t)packet[10] << 8 | packet[11];
+
+    // The IDR frame already in the ring of the new source is in the past, so
+    // the subscriber asks for a new one and stays with the old source.
+    SmolRTSP_LiveSubscriber_switch(subscriber, sub);
+    ASSERT_EQ(1, encoder_requests);
+    SmolRTSP_LiveSource_push(main, non_idr_frame(3000));
+    SmolRTSP_LiveSource_push(sub, non_idr_frame(3000));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(subscriber, 10));
+    CHECK_CALL(recv_next_packet(
+        fds[1], SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR, &seq_num, &ssrc));
+    ASSERT_EQ(main, SmolRTSP_LiveSubscriber_source(subscriber));
+
+    // The IDR frame without parameter sets is preceded by the cached ones.
+    SmolRTSP_LiveSource_push(main, non_idr_frame(6000));
+    SmolRTSP_LiveSource_push(sub, idr_only_frame(6000));
+    SmolRTSP_LiveSource_push(sub, non_idr_frame(9000));
+    ASSERT_EQ(2, SmolRTSP_LiveSubscriber_pump(subscriber, 10));
+    ASSERT_EQ(sub, SmolRTSP_LiveSubscriber_source(subscriber));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_switches(subscriber));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_skipped(subscriber));
+
+    CHECK_CALL(recv_next_packet(
+        fds[1], SMOLRTSP_H264_NAL_UNIT_SPS, &seq_num, &ssrc));
+    CHECK_CALL(recv_next_packet(
+        fds[1], SMOLRTSP_H264_NAL_UNIT_PPS, &seq_num, &ssrc));
+    CHECK_CALL(recv_next_packet(
+        fds[1], SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, &seq_num, &ssrc));
+    CHECK_CALL(recv_next_packet(
+        fds[1], SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR, &seq_num, &ssrc));
+
+    // Switching back to the current source cancels a pending switch.
+    SmolRTSP_LiveSubscriber_switch(subscriber, main);
+    SmolRTSP_LiveSubscriber_switch(subscriber, sub);
+    SmolRTSP_LiveSource_push(main, idr_frame(12000));
+    SmolRTSP_LiveSource_push(sub, non_idr_frame(12000));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(subscriber, 10));
+    ASSERT_EQ(sub, SmolRTSP_LiveSubscriber_source(subscriber));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_switches(subscriber));
+
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(subscriber);
+    VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(main);
+    VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(sub);
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST adapt(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_RtpTransport *rtp =
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000);
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(rtp);
+
+    SmolRTSP_LiveSource *sources[3];
+    for (size_t i = 0; i < 3; i++) {
+        sources[i] = SmolRTSP_LiveSource_new(4);
+    }
+    const SmolRTSP_Rendition renditions[] = {
+        {sources[0], 500000},
+        {sources[1], 2000000},
+        {sources[2], 8000000},
+    };
+    const SmolRTSP_RenditionPolicy policy = SmolRTSP_RenditionPolicy_default();
+
+    SmolRTSP_BandwidthEstimatorConfig config =
+        SmolRTSP_BandwidthEstimatorConfig_default();
+    config.min_bitrate = 100000;
+    config.initial_bitrate = 20000000;
+    config.max_bitrate = 20000000;
+    SmolRTSP_BandwidthEstimator *estimator =
+        SmolRTSP_BandwidthEstimator_new(config);
+    ASSERT(estimator);
+
+    SmolRTSP_LiveSubscriber *subscriber =
+        SmolRTSP_LiveSubscriber_new(sources[0], t);
+
+    // Without an estimate nor losses, the rendition is kept.
+    ASSERT_EQ(
+        0, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, NULL));
+
+    // The ladder is climbed one rendition at a time.
+    ASSERT_EQ(
+        1, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, estimator));
+    ASSERT_EQ(
+        2, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, estimator));
+    ASSERT_EQ(
+        2, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, estimator));
+
+    // The switch happens at the next IDR frame of the picked rendition.
+    ASSERT_EQ(sources[0], SmolRTSP_LiveSubscriber_source(subscriber));
+    SmolRTSP_LiveSource_push(sources[2], idr_frame(0));
+    ASSERT_EQ(1, SmolRTSP_LiveSubscriber_pump(subscriber, 10));
+    ASSERT_EQ(sources[2], SmolRTSP_LiveSubscriber_source(subscriber));
+
+    // A receiver report with heavy losses steps down.
+    uint8_t packet[64];
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload),
+        recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+    const uint8_t receiver_report[] = {
+        0x81,      201,        0,          7,          0,   0,   0, 1,
+        packet[8], packet[9],  packet[10], packet[11], 128, 0,   0, 64,
+        0,         0,          0,          0,          0,   0,   0, 0,
+        0,         0,          0,          0,          0,   0,   0, 0,
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_ingest_rtcp(
+               rtp,
+               U8Slice99_new(
+                   (uint8_t *)receiver_report, sizeof receiver_report),
+               0));
+    ASSERT_EQ(
+        1, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, NULL));
+
+    // The same report is not counted twice.
+    ASSERT_EQ(
+        1, SmolRTSP_LiveSubscriber_adapt(
+               subscriber, renditions, 3, policy, NULL));
+
+    VTABLE(SmolRTSP_LiveSubscriber, SmolRTSP_Droppable).drop(subscriber);
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(estimator);
+    for (size_t i = 0; i < 3; i++) {
+        VTABLE(SmolRTSP_LiveSource, SmolRTSP_Droppable).drop(sources[i]);
+    }
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+SUITE(live_source) {
+    RUN_TEST(frame);
+    RUN_TEST(subscribe);
+    RUN_TEST(overrun);
+    RUN_TEST(keyframe_requests);
+    RUN_TEST(switch_rendition);
+    RUN_TEST(adapt);
+}
@@ -18,24 +18,68 @@ int main(int argc, char *argv[]) {
     SMOLRTSP_SUITE(types_method);
     SMOLRTSP_SUITE(types_reason_phrase);
     SMOLRTSP_SUITE(types_request_line);
+    SMOLRTSP_SUITE(types_request_parser);
     SMOLRTSP_SUITE(types_request_uri);
     SMOLRTSP_SUITE(types_request);
     SMOLRTSP_SUITE(types_response_line);
     SMOLRTSP_SUITE(types_response);
     SMOLRTSP_SUITE(types_rtsp_version);
     SMOLRTSP_SUITE(types_sdp);
+    SMOLRTSP_SUITE(types_rtcp);
+    SMOLRTSP_SUITE(types_rtp);
     SMOLRTSP_SUITE(types_status_code);
 
     SMOLRTSP_SUITE(nal_h264);
     SMOLRTSP_SUITE(nal_h265);
     SMOLRTSP_SUITE(nal);
+    SMOLRTSP_SUITE(nal_length);
+    SMOLRTSP_SUITE(nal_rbsp);
+    SMOLRTSP_SUITE(nal_splitter);
+    SMOLRTSP_SUITE(nal_packetizer);
 
     SMOLRTSP_SUITE(util);
     SMOLRTSP_SUITE(writer);
     SMOLRTSP_SUITE(transport);
+    SMOLRTSP_SUITE(rtp_clock);
+    SMOLRTSP_SUITE(rtp_transport);
+    SMOLRTSP_SUITE(rtp_depacketizer);
+    SMOLRTSP_SUITE(jitter_buffer);
+    SMOLRTSP_SUITE(gop_cache);
+    SMOLRTSP_SUITE(nal_transport);
+    SMOLRTSP_SUITE(param_set_cache);
+    SMOLRTSP_SUITE(sdp_cache);
+    SMOLRTSP_SUITE(rtp_fanout);
+    SMOLRTSP_SUITE(pacer);
+    SMOLRTSP_SUITE(fec);
+    SMOLRTSP_SUITE(srtp);
+    SMOLRTSP_SUITE(send_workers);
+    SMOLRTSP_SUITE(uring);
+    SMOLRTSP_SUITE(xdp);
+    SMOLRTSP_SUITE(packet_pool);
+    SMOLRTSP_SUITE(bandwidth_estimator);
+    SMOLRTSP_SUITE(packetized_file);
+    SMOLRTSP_SUITE(track_scheduler);
+    SMOLRTSP_SUITE(numa);
+    SMOLRTSP_SUITE(digest_auth);
+    SMOLRTSP_SUITE(shm_ring);
+    SMOLRTSP_SUITE(tcp_scheduler);
     SMOLRTSP_SUITE(io_vec);
     SMOLRTSP_SUITE(context);
     SMOLRTSP_SUITE(controller);
+    SMOLRTSP_SUITE(demuxer);
+    SMOLRTSP_SUITE(frame_queue);
+    SMOLRTSP_SUITE(server);
+    SMOLRTSP_SUITE(client);
+    SMOLRTSP_SUITE(session_registry);
+    SMOLRTSP_SUITE(timer_wheel);
+    SMOLRTSP_SUITE(media_file);
+    SMOLRTSP_SUITE(live_source);
+    SMOLRTSP_SUITE(multicast);
+    SMOLRTSP_SUITE(udp_sender);
+    SMOLRTSP_SUITE(udp_receiver);
+    SMOLRTSP_SUITE(admission);
+    SMOLRTSP_SUITE(latency_histogram);
+    SMOLRTSP_SUITE(allocator);
 
     GREATEST_MAIN_END();
 }
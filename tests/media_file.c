@@ -0,0 +1,210 @@
+#include <smolrtsp/media_file.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// SPS, PPS, and a picture of two IDR slices; two non-IDR pictures, the second
+// one preceded by SEI.
+static const uint8_t annex_b[] = {
+    0xAB, 0xCD,                                     // Garbage.
+    0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F, // SPS.
+    0x00, 0x00, 0x01, 0x68, 0xCE, 0x38, 0x80,       // PPS.
+    0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21,       // IDR, the first slice.
+    0x00, 0x00, 0x00, 0x01, 0x65, 0x40, 0x21,       // IDR, the second slice.
+    0x00, 0x00, 0x01, 0x41, 0x9A, 0x02,             // Non-IDR.
+    0x00, 0x00, 0x01, 0x06, 0x05, 0x01,             // SEI.
+    0x00, 0x00, 0x01, 0x41, 0x9A, 0x04, 0x00, 0x00, // Non-IDR.
+};
+
+static enum greatest_test_res
+write_file(const char *path, const uint8_t *data, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    ASSERT_EQ(len, fwrite(data, 1, len, fp));
+    ASSERT_EQ(0, fclose(fp));
+
+    PASS();
+}
+
+static enum greatest_test_res
+check_nalu(SmolRTSP_MediaFile *file, size_t i, uint8_t unit_type, uint8_t b) {
+    const SmolRTSP_NalUnit nalu = SmolRTSP_MediaFile_nalu(file, i);
+    ASSERT_EQ(unit_type, SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT(nalu.payload.len > 0);
+    ASSERT_EQ(b, nalu.payload.ptr[0]);
+
+    PASS();
+}
+
+static enum greatest_test_res check_access_unit(
+    SmolRTSP_MediaFile *file, size_t i, size_t first_nalu, size_t nalus_count,
+    bool is_idr) {
+    const SmolRTSP_AccessUnit au = SmolRTSP_MediaFile_access_unit(file, i);
+    ASSERT_EQ(first_nalu, au.first_nalu);
+    ASSERT_EQ(nalus_count, au.nalus_count);
+    ASSERT_EQ(is_idr, au.is_idr);
+
+    PASS();
+}
+
+static enum greatest_test_res check_annex_b(SmolRTSP_MediaFile *file) {
+    ASSERT_EQ(SmolRTSP_NalCodec_H264, SmolRTSP_MediaFile_codec(file));
+    ASSERT_EQ(7, SmolRTSP_MediaFile_nalus_count(file));
+
+    CHECK_CALL(check_nalu(file, 0, 7, 0x42));
+    CHECK_CALL(check_nalu(file, 2, 5, 0x88));
+    CHECK_CALL(check_nalu(file, 5, 6, 0x05));
+
+    // The trailing zeros are stripped.
+    const SmolRTSP_NalUnit last = SmolRTSP_MediaFile_nalu(file, 6);
+    ASSERT_EQ(2, last.payload.len);
+    const SmolRTSP_NalUnit idr = SmolRTSP_MediaFile_nalu(file, 2);
+    ASSERT_EQ(3, idr.payload.len);
+
+    ASSERT_EQ(3, SmolRTSP_MediaFile_access_units_count(file));
+    CHECK_CALL(check_access_unit(file, 0, 0, 4, true));
+    CHECK_CALL(check_access_unit(file, 1, 4, 1, false));
+    CHECK_CALL(check_access_unit(file, 2, 5, 2, false));
+
+    ASSERT_EQ(0, SmolRTSP_MediaFile_find_idr(file, 2));
+
+    PASS();
+}
+
+TEST open_annex_b(void) {
+    char path[] = "/tmp/smolrtsp-media-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_file(path, annex_b, sizeof annex_b));
+
+    char index_path[sizeof path + 4];
+    snprintf(index_path, sizeof index_path, "%s.idx", path);
+
+    // Built and persisted on the first open, loaded on the second.
+    for (int i = 0; i < 2; i++) {
+        SmolRTSP_MediaFile *file = SmolRTSP_MediaFile_open(
+            path, SmolRTSP_NalCodec_H264, 0, index_path);
+        ASSERT(file != NULL);
+        CHECK_CALL(check_annex_b(file));
+        VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(file);
+
+        struct stat st;
+        ASSERT_EQ(0, stat(index_path, &st));
+    }
+
+    // An index of another file is not used.
+    const uint8_t other[] = {0x00, 0x00, 0x01, 0x65, 0x88, 0x80};
+    CHECK_CALL(write_file(path, other, sizeof other));
+
+    SmolRTSP_MediaFile *file =
+        SmolRTSP_MediaFile_open(path, SmolRTSP_NalCodec_H264, 0, index_path);
+    ASSERT(file != NULL);
+    ASSERT_EQ(1, SmolRTSP_MediaFile_nalus_count(file));
+    ASSERT_EQ(1, SmolRTSP_MediaFile_access_units_count(file));
+    VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(file);
+
+    remove(index_path);
+    remove(path);
+    PASS();
+}
+
+TEST open_length_prefixed(void) {
+    const uint8_t data[] = {
+        0x00, 0x00, 0x00, 0x03, 0x65, 0x88, 0x80, // IDR.
+        0x00, 0x00, 0x00, 0x02, 0x41, 0x9A,       // Non-IDR.
+        0x00, 0x00, 0x00, 0x02, 0x41, 0x9A,       // Non-IDR.
+    };
+
+    char path[] = "/tmp/smolrtsp-media-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_file(path, data, sizeof data));
+
+    SmolRTSP_MediaFile *file =
+        SmolRTSP_MediaFile_open(path, SmolRTSP_NalCodec_H264, 4, NULL);
+    ASSERT(file != NULL);
+
+    ASSERT_EQ(3, SmolRTSP_MediaFile_nalus_count(file));
+    CHECK_CALL(check_nalu(file, 0, 5, 0x88));
+    CHECK_CALL(check_nalu(file, 2, 1, 0x9A));
+
+    // The NAL units are not copied.
+    ASSERT_EQ(
+        (const uint8_t *)SmolRTSP_MediaFile_nalu(file, 0).payload.ptr + 7,
+        (const uint8_t *)SmolRTSP_MediaFile_nalu(file, 1).payload.ptr);
+
+    ASSERT_EQ(3, SmolRTSP_MediaFile_access_units_count(file));
+    CHECK_CALL(check_access_unit(file, 2, 2, 1, false));
+    ASSERT_EQ(0, SmolRTSP_MediaFile_find_idr(file, 2));
+
+    VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(file);
+
+    // A truncated NAL unit.
+    CHECK_CALL(write_file(path, data, sizeof data - 1));
+    errno = 0;
+    ASSERT_EQ(
+        NULL, SmolRTSP_MediaFile_open(path, SmolRTSP_NalCodec_H264, 4, NULL));
+    ASSERT_EQ(EBADMSG, errno);
+
+    remove(path);
+
+    errno = 0;
+    ASSERT_EQ(
+        NULL, SmolRTSP_MediaFile_open(path, SmolRTSP_NalCodec_H264, 4, NULL));
+    ASSERT_EQ(ENOENT, errno);
+
+    PASS();
+}
+
+TEST seek(void) {
+    // Non-IDR, IDR, non-IDR, non-IDR, IDR, non-IDR.
+    const uint8_t data[] = {
+        0x02, 0x41, 0x9A, 0x02, 0x65, 0x88, 0x02, 0x41, 0x9A,
+        0x02, 0x41, 0x9A, 0x02, 0x65, 0x88, 0x02, 0x41, 0x9A,
+    };
+
+    char path[] = "/tmp/smolrtsp-media-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_file(path, data, sizeof data));
+
+    SmolRTSP_MediaFile *file =
+        SmolRTSP_MediaFile_open(path, SmolRTSP_NalCodec_H264, 1, NULL);
+    ASSERT(file != NULL);
+    ASSERT_EQ(6, SmolRTSP_MediaFile_access_units_count(file));
+
+    ASSERT_EQ(-1, SmolRTSP_MediaFile_find_idr(file, 0));
+    ASSERT_EQ(1, SmolRTSP_MediaFile_find_idr(file, 1));
+    ASSERT_EQ(1, SmolRTSP_MediaFile_find_idr(file, 3));
+    ASSERT_EQ(4, SmolRTSP_MediaFile_find_idr(file, 5));
+
+    // 25 fps, i.e., 40 ms per access unit.
+    ASSERT_EQ(-1, SmolRTSP_MediaFile_seek(file, 39, 25, 1));
+    ASSERT_EQ(1, SmolRTSP_MediaFile_seek(file, 40, 25, 1));
+    ASSERT_EQ(1, SmolRTSP_MediaFile_seek(file, 159, 25, 1));
+    ASSERT_EQ(4, SmolRTSP_MediaFile_seek(file, 160, 25, 1));
+    ASSERT_EQ(4, SmolRTSP_MediaFile_seek(file, UINT64_MAX, 25, 1));
+
+    // 29.97 fps: the access unit 4 starts at 133.47 ms.
+    ASSERT_EQ(1, SmolRTSP_MediaFile_seek(file, 133, 30000, 1001));
+    ASSERT_EQ(4, SmolRTSP_MediaFile_seek(file, 134, 30000, 1001));
+
+    VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(file);
+    remove(path);
+    PASS();
+}
+
+SUITE(media_file) {
+    RUN_TEST(open_annex_b);
+    RUN_TEST(open_length_prefixed);
+    RUN_TEST(seek);
+}
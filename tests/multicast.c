@@ -0,0 +1,144 @@
+#include <smolrtsp/multicast.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST multicast_socket(void) {
+    struct in_addr group;
+    ASSERT_EQ(1, inet_pton(AF_INET, "239.255.0.1", &group));
+
+    SmolRTSP_MulticastConfig config = SmolRTSP_MulticastConfig_default();
+    config.ttl = 4;
+    config.loopback = true;
+
+    const int fd = smolrtsp_multicast_socket(AF_INET, &group, 5000, config);
+    if (-1 == fd && (ENETUNREACH == errno || ENODEV == errno)) {
+        // No multicast route (e.g., in containers).
+        SKIP();
+    }
+    ASSERT(fd != -1);
+
+    int value = 0;
+    socklen_t len = sizeof value;
+    ASSERT_EQ(0, getsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &value, &len));
+    ASSERT_EQ(4, value);
+    len = sizeof value;
+    ASSERT_EQ(0, getsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &value, &len));
+    ASSERT_EQ(1, value);
+
+    struct sockaddr_in peer;
+    len = sizeof peer;
+    ASSERT_EQ(0, getpeername(fd, (struct sockaddr *)&peer, &len));
+    ASSERT_EQ(group.s_addr, peer.sin_addr.s_addr);
+    ASSERT_EQ(htons(5000), peer.sin_port);
+
+    close(fd);
+    PASS();
+}
+
+TEST multicast_socket_unicast(void) {
+    struct in_addr addr;
+    ASSERT_EQ(1, inet_pton(AF_INET, "127.0.0.1", &addr));
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, smolrtsp_multicast_socket(
+                AF_INET, &addr, 5000, SmolRTSP_MulticastConfig_default()));
+    ASSERT_EQ(EINVAL, errno);
+
+    PASS();
+}
+
+static enum greatest_test_res check_group(
+    SmolRTSP_MulticastGroup group, const char *addr, uint16_t rtp_port) {
+    char buffer[INET_ADDRSTRLEN];
+    ASSERT(inet_ntop(AF_INET, &group.addr, buffer, sizeof buffer));
+    ASSERT_STR_EQ(addr, buffer);
+    ASSERT_EQ(rtp_port, group.ports.rtp_port);
+    ASSERT_EQ(rtp_port + 1, group.ports.rtcp_port);
+
+    PASS();
+}
+
+TEST pool(void) {
+    struct in_addr first_group;
+    ASSERT_EQ(1, inet_pton(AF_INET, "239.255.0.254", &first_group));
+
+    SmolRTSP_MulticastPool *pool =
+        SmolRTSP_MulticastPool_new(first_group, 2, 5000);
+    const CharSlice99 video = CharSlice99_from_str("rtsp://host/video"),
+                      audio = CharSlice99_from_str("rtsp://host/audio"),
+                      other = CharSlice99_from_str("rtsp://host/other");
+
+    SmolRTSP_MulticastGroup group;
+    ASSERT_EQ(0, SmolRTSP_MulticastPool_acquire(pool, video, &group));
+    CHECK_CALL(check_group(group, "239.255.0.254", 5000));
+
+    // The clients of the same stream share its group.
+    ASSERT_EQ(0, SmolRTSP_MulticastPool_acquire(pool, video, &group));
+    CHECK_CALL(check_group(group, "239.255.0.254", 5000));
+
+    ASSERT_EQ(0, SmolRTSP_MulticastPool_acquire(pool, audio, &group));
+    CHECK_CALL(check_group(group, "239.255.0.255", 5002));
+
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_MulticastPool_acquire(pool, other, &group));
+    ASSERT_EQ(ENOSPC, errno);
+
+    ASSERT(!SmolRTSP_MulticastPool_release(pool, video));
+    ASSERT(SmolRTSP_MulticastPool_release(pool, video));
+    ASSERT(!SmolRTSP_MulticastPool_release(pool, video));
+
+    ASSERT_EQ(0, SmolRTSP_MulticastPool_acquire(pool, other, &group));
+    CHECK_CALL(check_group(group, "239.255.0.254", 5000));
+
+    VTABLE(SmolRTSP_MulticastPool, SmolRTSP_Droppable).drop(pool);
+    PASS();
+}
+
+TEST transport_header(void) {
+    char buffer[512] = {0};
+    SmolRTSP_Context *ctx =
+        SmolRTSP_Context_new(smolrtsp_string_writer(buffer), 3);
+
+    SmolRTSP_MulticastGroup group = {
+        .ports = {.rtp_port = 5000, .rtcp_port = 5001},
+    };
+    ASSERT_EQ(1, inet_pton(AF_INET, "239.255.0.1", &group.addr));
+
+    smolrtsp_multicast_transport_header(ctx, group, 16);
+    ASSERT(smolrtsp_respond_ok(ctx) > 0);
+
+    const char *expected =
+        "RTSP/1.0 200 OK\r\n"
+        "CSeq: 3\r\n"
+        "Transport: "
+        "RTP/AVP;multicast;destination=239.255.0.1;port=5000-5001;ttl=16\r\n"
+        "\r\n";
+    ASSERT_STR_EQ(expected, buffer);
+
+    // The header parses back.
+    SmolRTSP_TransportConfig config;
+    ASSERT_EQ(
+        0, smolrtsp_parse_transport(
+               &config, CharSlice99_from_str("RTP/AVP;multicast;destination="
+                                             "239.255.0.1;port=5000-5001;ttl="
+                                             "16")));
+    ASSERT(config.multicast);
+
+    VTABLE(SmolRTSP_Context, SmolRTSP_Droppable).drop(ctx);
+    PASS();
+}
+
+SUITE(multicast) {
+    RUN_TEST(multicast_socket);
+    RUN_TEST(multicast_socket_unicast);
+    RUN_TEST(pool);
+    RUN_TEST(transport_header);
+}
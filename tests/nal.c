@@ -3,6 +3,7 @@
 #include <greatest.h>
 
 #include <alloca.h>
+#include <string.h>
 
 static const SmolRTSP_H264NalHeader h264_header = {
     .forbidden_zero_bit = false,
@@ -151,6 +152,58 @@ TEST test_start_code_4b(void) {
     PASS();
 }
 
+TEST find_next_start_code(void) {
+#define CHECK(expected, ...)                                                   \
+    ASSERT_EQ(                                                                 \
+        expected,                                                              \
+        smolrtsp_find_next_start_code(                                         \
+            (U8Slice99)Slice99_typed_from_array((uint8_t[]){__VA_ARGS__})))
+
+    ASSERT_EQ(0, smolrtsp_find_next_start_code(U8Slice99_empty()));
+    CHECK(2, 0x00, 0x00);
+    CHECK(0, 0x00, 0x00, 0x01);
+    CHECK(0, 0x00, 0x00, 0x00, 0x01, 0xAB);
+    CHECK(2, 0xAB, 0xCD, 0x00, 0x00, 0x01);
+    CHECK(1, 0xAB, 0x00, 0x00, 0x00, 0x01);
+    CHECK(5, 0x00, 0x01, 0x00, 0x01, 0x01);
+
+#undef CHECK
+
+    PASS();
+}
+
+// Compares the vectorized scanner against a naive one on buffers long enough to
+// exercise the SIMD loops and their tails.
+TEST find_next_start_code_long(void) {
+    uint8_t data[300];
+
+    for (size_t pos = 0; pos + 3 <= sizeof data; pos += 7) {
+        for (size_t len = pos + 3; len <= sizeof data; len += 29) {
+            memset(data, 0xAB, sizeof data);
+            // Decoys that are not start codes.
+            for (size_t i = 0; i + 1 < pos; i += 5) {
+                data[i] = 0x00;
+                data[i + 1] = 0x00;
+            }
+            if (pos > 0) {
+                data[pos - 1] = 0xAB;
+            }
+            data[pos] = 0x00;
+            data[pos + 1] = 0x00;
+            data[pos + 2] = 0x01;
+
+            ASSERT_EQ(
+                pos, smolrtsp_find_next_start_code(U8Slice99_new(data, len)));
+
+            // There is nothing after the start code.
+            const U8Slice99 rest = U8Slice99_new(data + pos + 3, len - pos - 3);
+            ASSERT_EQ(rest.len, smolrtsp_find_next_start_code(rest));
+        }
+    }
+
+    PASS();
+}
+
 SUITE(nal) {
     RUN_TEST(header_unit_type_h264);
     RUN_TEST(header_unit_type_h265);
@@ -167,4 +220,6 @@ SUITE(nal) {
     RUN_TEST(determine_start_code);
     RUN_TEST(test_start_code_3b);
     RUN_TEST(test_start_code_4b);
+    RUN_TEST(find_next_start_code);
+    RUN_TEST(find_next_start_code_long);
 }
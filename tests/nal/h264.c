@@ -2,6 +2,8 @@
 
 #include <greatest.h>
 
+#include <errno.h>
+
 TEST parse(void) {
     const SmolRTSP_H264NalHeader h = SmolRTSP_H264NalHeader_parse(0b01011010);
 
@@ -51,8 +53,50 @@ TEST write_fu_header(void) {
     PASS();
 }
 
+// The SPS of `examples/media/video.h264` (High profile, 480x270), which has
+// emulation prevention bytes.
+static const uint8_t sps[] = {
+    0x64, 0x00, 0x15, 0xAC, 0xD9, 0x41, 0xE0, 0x8F, 0xEA, 0x6A,
+    0x0C, 0x02, 0x0D, 0x6E, 0x00, 0x00, 0x03, 0x00, 0x02, 0x00,
+    0x00, 0x03, 0x00, 0x64, 0x1E, 0x2C, 0x5B, 0x2C,
+};
+
+TEST parse_sps(void) {
+    SmolRTSP_H264Sps self;
+    ASSERT_EQ(
+        0, SmolRTSP_H264Sps_parse(
+               &self, U8Slice99_new((uint8_t *)sps, sizeof sps)));
+
+    ASSERT_EQ(100, self.profile_idc);
+    ASSERT_EQ(0x00, self.constraint_flags);
+    ASSERT_EQ(21, self.level_idc);
+    ASSERT_EQ(0, self.seq_parameter_set_id);
+    ASSERT_EQ(1, self.chroma_format_idc);
+    ASSERT_EQ(8, self.bit_depth_luma);
+    ASSERT_EQ(8, self.bit_depth_chroma);
+    ASSERT_EQ(4, self.max_num_ref_frames);
+    ASSERT(self.frame_mbs_only_flag);
+    ASSERT_EQ(480, self.width);
+    ASSERT_EQ(270, self.height);
+
+    PASS();
+}
+
+TEST parse_truncated_sps(void) {
+    SmolRTSP_H264Sps self;
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_H264Sps_parse(&self, U8Slice99_new((uint8_t *)sps, 8)));
+    ASSERT_EQ(EBADMSG, errno);
+
+    PASS();
+}
+
 SUITE(nal_h264) {
     RUN_TEST(parse);
     RUN_TEST(serialize);
     RUN_TEST(write_fu_header);
+    RUN_TEST(parse_sps);
+    RUN_TEST(parse_truncated_sps);
 }
@@ -2,6 +2,8 @@
 
 #include <greatest.h>
 
+#include <errno.h>
+
 TEST parse(void) {
     const SmolRTSP_H265NalHeader h =
         SmolRTSP_H265NalHeader_parse((uint8_t[]){0b01001011, 0b10101101});
@@ -55,8 +57,78 @@ TEST write_fu_header(void) {
     PASS();
 }
 
+// Main profile, level 3.1, 1920x1080 coded as 1920x1088 with a conformance
+// window.
+static const uint8_t vps[] = {
+    0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5D, 0x80,
+};
+
+static const uint8_t sps[] = {
+    0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x03, 0x00, 0x5D, 0xA0, 0x03, 0xC0, 0x80, 0x11, 0x07, 0xCB, 0xC0,
+};
+
+static enum greatest_test_res
+check_profile_tier_level(const SmolRTSP_H265ProfileTierLevel *ptl) {
+    ASSERT_EQ(0, ptl->profile_space);
+    ASSERT(!ptl->tier_flag);
+    ASSERT_EQ(1, ptl->profile_idc);
+    ASSERT_EQ(0x60000000, ptl->profile_compatibility_flags);
+    ASSERT_EQ(93, ptl->level_idc);
+    PASS();
+}
+
+TEST parse_vps(void) {
+    SmolRTSP_H265Vps self;
+    ASSERT_EQ(
+        0, SmolRTSP_H265Vps_parse(
+               &self, U8Slice99_new((uint8_t *)vps, sizeof vps)));
+
+    ASSERT_EQ(0, self.video_parameter_set_id);
+    ASSERT_EQ(1, self.max_layers);
+    ASSERT_EQ(1, self.max_sub_layers);
+    ASSERT(self.temporal_id_nesting_flag);
+    CHECK_CALL(check_profile_tier_level(&self.profile_tier_level));
+
+    PASS();
+}
+
+TEST parse_sps(void) {
+    SmolRTSP_H265Sps self;
+    ASSERT_EQ(
+        0, SmolRTSP_H265Sps_parse(
+               &self, U8Slice99_new((uint8_t *)sps, sizeof sps)));
+
+    ASSERT_EQ(0, self.video_parameter_set_id);
+    ASSERT_EQ(1, self.max_sub_layers);
+    CHECK_CALL(check_profile_tier_level(&self.profile_tier_level));
+    ASSERT_EQ(0, self.seq_parameter_set_id);
+    ASSERT_EQ(1, self.chroma_format_idc);
+    ASSERT_EQ(1920, self.width);
+    ASSERT_EQ(1080, self.height);
+    ASSERT_EQ(8, self.bit_depth_luma);
+    ASSERT_EQ(8, self.bit_depth_chroma);
+
+    PASS();
+}
+
+TEST parse_truncated_sps(void) {
+    SmolRTSP_H265Sps self;
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_H265Sps_parse(&self, U8Slice99_new((uint8_t *)sps, 16)));
+    ASSERT_EQ(EBADMSG, errno);
+
+    PASS();
+}
+
 SUITE(nal_h265) {
     RUN_TEST(parse);
     RUN_TEST(serialize);
     RUN_TEST(write_fu_header);
+    RUN_TEST(parse_vps);
+    RUN_TEST(parse_sps);
+    RUN_TEST(parse_truncated_sps);
 }
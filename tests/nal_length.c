@@ -0,0 +1,176 @@
+#include <smolrtsp/nal_length.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+TEST iter_4b(void) {
+    const uint8_t data[] = {
+        0x00, 0x00, 0x00, 0x03, 0x67, 0xAA, 0xBB,       // SPS.
+        0x00, 0x00, 0x00, 0x02, 0x68, 0xCC,             // PPS.
+        0x00, 0x00, 0x00, 0x04, 0x65, 0x00, 0x00, 0x01, // IDR.
+    };
+
+    SmolRTSP_NalLengthIter iter = SmolRTSP_NalLengthIter_new(
+        SmolRTSP_NalCodec_H264, 4, U8Slice99_new((uint8_t *)data, sizeof data));
+    SmolRTSP_NalUnit nalu;
+
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_sps(nalu.header));
+    ASSERT_EQ(data + 5, nalu.payload.ptr);
+    ASSERT_EQ(2, nalu.payload.len);
+
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_pps(nalu.header));
+    ASSERT_EQ(1, nalu.payload.len);
+
+    // Start codes inside a NAL unit are data, not delimiters.
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_coded_slice_idr(nalu.header));
+    ASSERT_EQ(3, nalu.payload.len);
+
+    ASSERT_EQ(0, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+
+    PASS();
+}
+
+TEST iter_1b_2b(void) {
+    const uint8_t data_1b[] = {0x02, 0x41, 0xAA, 0x01, 0x01};
+    const uint8_t data_2b[] = {0x00, 0x03, 0x40, 0x01, 0xAB};
+
+    SmolRTSP_NalLengthIter iter = SmolRTSP_NalLengthIter_new(
+        SmolRTSP_NalCodec_H264, 1,
+        U8Slice99_new((uint8_t *)data_1b, sizeof data_1b));
+    SmolRTSP_NalUnit nalu;
+
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_coded_slice_non_idr(nalu.header));
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT_EQ(0, nalu.payload.len);
+    ASSERT_EQ(0, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+
+    iter = SmolRTSP_NalLengthIter_new(
+        SmolRTSP_NalCodec_H265, 2,
+        U8Slice99_new((uint8_t *)data_2b, sizeof data_2b));
+
+    ASSERT_EQ(1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_vps(nalu.header));
+    ASSERT_EQ(1, nalu.payload.len);
+    ASSERT_EQ(0xAB, nalu.payload.ptr[0]);
+    ASSERT_EQ(0, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+
+    PASS();
+}
+
+TEST iter_malformed(void) {
+    const uint8_t truncated_length[] = {0x00, 0x00, 0x00};
+    const uint8_t too_long[] = {0x00, 0x00, 0x00, 0x05, 0x65, 0x01};
+    const uint8_t empty_nalu[] = {0x00, 0x00, 0x00, 0x00};
+
+    const U8Slice99 cases[] = {
+        U8Slice99_new((uint8_t *)truncated_length, sizeof truncated_length),
+        U8Slice99_new((uint8_t *)too_long, sizeof too_long),
+        U8Slice99_new((uint8_t *)empty_nalu, sizeof empty_nalu),
+    };
+
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(cases); i++) {
+        SmolRTSP_NalLengthIter iter =
+            SmolRTSP_NalLengthIter_new(SmolRTSP_NalCodec_H264, 4, cases[i]);
+        SmolRTSP_NalUnit nalu;
+
+        errno = 0;
+        ASSERT_EQ(-1, SmolRTSP_NalLengthIter_next(&iter, &nalu));
+        ASSERT_EQ(EBADMSG, errno);
+    }
+
+    PASS();
+}
+
+TEST parse_avcc(void) {
+    const uint8_t avcc[] = {
+        0x01, 0x64, 0x00, 0x1F, // Version, profile, compatibility, level.
+        0xFF,                   // 4-byte lengths.
+        0xE1,                   // 1 SPS.
+        0x00, 0x03, 0x67, 0x64, 0x00,
+        0x01, // 1 PPS.
+        0x00, 0x02, 0x68, 0xEE,
+    };
+
+    SmolRTSP_NalExtradata extradata;
+    ASSERT_EQ(
+        0, SmolRTSP_NalExtradata_parse(
+               &extradata, SmolRTSP_NalCodec_H264,
+               U8Slice99_new((uint8_t *)avcc, sizeof avcc)));
+
+    ASSERT_EQ(4, extradata.length_size);
+    ASSERT_EQ(2, extradata.parameter_sets_count);
+    ASSERT(SmolRTSP_NalHeader_is_sps(extradata.parameter_sets[0].header));
+    ASSERT_EQ(2, extradata.parameter_sets[0].payload.len);
+    ASSERT_EQ(avcc + 9, extradata.parameter_sets[0].payload.ptr);
+    ASSERT(SmolRTSP_NalHeader_is_pps(extradata.parameter_sets[1].header));
+    ASSERT_EQ(0xEE, extradata.parameter_sets[1].payload.ptr[0]);
+
+    // Truncated in the middle of the PPS.
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_NalExtradata_parse(
+                &extradata, SmolRTSP_NalCodec_H264,
+                U8Slice99_new((uint8_t *)avcc, sizeof avcc - 1)));
+    ASSERT_EQ(EBADMSG, errno);
+
+    PASS();
+}
+
+#ifndef SMOLRTSP_NO_H265
+
+TEST parse_hvcc(void) {
+    uint8_t hvcc[64] = {0x01}; // Version 1, zero profile/tier/level.
+    hvcc[21] = 0x0F; // 4-byte lengths.
+
+    const uint8_t arrays[] = {
+        0x03, // 3 arrays.
+        0xA0, 0x00, 0x01, 0x00, 0x03, 0x40, 0x01, 0x0C, // VPS.
+        0xA1, 0x00, 0x01, 0x00, 0x03, 0x42, 0x01, 0x01, // SPS.
+        0xA2, 0x00, 0x01, 0x00, 0x03, 0x44, 0x01, 0xC1, // PPS.
+    };
+    memcpy(hvcc + 22, arrays, sizeof arrays);
+
+    SmolRTSP_NalExtradata extradata;
+    ASSERT_EQ(
+        0, SmolRTSP_NalExtradata_parse(
+               &extradata, SmolRTSP_NalCodec_H265,
+               U8Slice99_new(hvcc, 22 + sizeof arrays)));
+
+    ASSERT_EQ(4, extradata.length_size);
+    ASSERT_EQ(3, extradata.parameter_sets_count);
+    ASSERT(SmolRTSP_NalHeader_is_vps(extradata.parameter_sets[0].header));
+    ASSERT(SmolRTSP_NalHeader_is_sps(extradata.parameter_sets[1].header));
+    ASSERT(SmolRTSP_NalHeader_is_pps(extradata.parameter_sets[2].header));
+    ASSERT_EQ(1, extradata.parameter_sets[2].payload.len);
+    ASSERT_EQ(0xC1, extradata.parameter_sets[2].payload.ptr[0]);
+
+    // An unsupported configuration version.
+    hvcc[0] = 0x02;
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_NalExtradata_parse(
+                &extradata, SmolRTSP_NalCodec_H265,
+                U8Slice99_new(hvcc, 22 + sizeof arrays)));
+    ASSERT_EQ(EBADMSG, errno);
+
+    PASS();
+}
+
+#endif
+
+SUITE(nal_length) {
+    RUN_TEST(iter_4b);
+    RUN_TEST(iter_1b_2b);
+    RUN_TEST(iter_malformed);
+    RUN_TEST(parse_avcc);
+#ifndef SMOLRTSP_NO_H265
+    RUN_TEST(parse_hvcc);
+#endif
+}
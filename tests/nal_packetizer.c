@@ -0,0 +1,147 @@
+#include "nal_packetizer.h"
+
+#include <greatest.h>
+
+#include <stdint.h>
+
+#define MAX_PACKET_SIZE 4
+
+#define FU_START 0x80
+#define FU_END   0x40
+
+static uint8_t payload[3 * MAX_PACKET_SIZE + 1];
+
+static SmolRTSP_NalUnit idr(size_t len) {
+    return (SmolRTSP_NalUnit){
+        SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+            .forbidden_zero_bit = false,
+            .ref_idc = 0b11,
+            .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        }),
+        U8Slice99_new(payload, len),
+    };
+}
+
+static void
+init(SmolRTSP_NalPacketizer *self, SmolRTSP_NalUnit nalu, bool marker) {
+    const SmolRTSP_NalHeaderInfo info = SmolRTSP_NalHeaderInfo_new(nalu.header);
+    SmolRTSP_NalPacketizer_init(self, nalu, &info, MAX_PACKET_SIZE, marker);
+}
+
+// Checks that the packets of `self` are FU fragments of `nalu` of
+// `MAX_PACKET_SIZE` bytes but the last one of `last_len` bytes, with the S, E,
+// and RTP marker bits at the ends only.
+static enum greatest_test_res check_fragments(
+    SmolRTSP_NalPacketizer *self, SmolRTSP_NalUnit nalu, size_t count,
+    size_t last_len) {
+    ASSERT_EQ(count, SmolRTSP_NalPacketizer_count(self));
+
+    for (size_t i = 0; i < count; i++) {
+        const SmolRTSP_RtpPacket packet = SmolRTSP_NalPacketizer_at(self, i);
+        const bool is_first = 0 == i, is_last = count - 1 == i;
+
+        ASSERT_EQ(SMOLRTSP_H264_FU_HEADER_SIZE, packet.payload_header.len);
+        // FU-A with the NRI of the NAL unit.
+        ASSERT_EQ(0x7C, packet.payload_header.ptr[0]);
+        ASSERT_EQ(
+            (is_first ? FU_START : 0) | (is_last ? FU_END : 0) |
+                SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+            packet.payload_header.ptr[1]);
+        ASSERT_EQ(is_last, packet.marker);
+
+        ASSERT_EQ(nalu.payload.ptr + i * MAX_PACKET_SIZE, packet.payload.ptr);
+        ASSERT_EQ(is_last ? last_len : MAX_PACKET_SIZE, packet.payload.len);
+    }
+
+    PASS();
+}
+
+TEST single_nalu(void) {
+    const SmolRTSP_NalUnit nalu = idr(MAX_PACKET_SIZE - 2);
+
+    SmolRTSP_NalPacketizer packetizer;
+    init(&packetizer, nalu, true);
+    ASSERT_EQ(1, SmolRTSP_NalPacketizer_count(&packetizer));
+
+    const SmolRTSP_RtpPacket packet =
+        SmolRTSP_NalPacketizer_at(&packetizer, 0);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_HEADER_SIZE, packet.payload_header.len);
+    ASSERT_EQ(
+        0x60 | SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        packet.payload_header.ptr[0]);
+    ASSERT_EQ(nalu.payload.ptr, packet.payload.ptr);
+    ASSERT_EQ(nalu.payload.len, packet.payload.len);
+    ASSERT(packet.marker);
+
+    PASS();
+}
+
+TEST exact_multiple(void) {
+    const SmolRTSP_NalUnit nalu = idr(3 * MAX_PACKET_SIZE);
+
+    SmolRTSP_NalPacketizer packetizer;
+    init(&packetizer, nalu, true);
+    CHECK_CALL(check_fragments(&packetizer, nalu, 3, MAX_PACKET_SIZE));
+
+    PASS();
+}
+
+TEST short_last_fragment(void) {
+    const SmolRTSP_NalUnit nalu = idr(3 * MAX_PACKET_SIZE + 1);
+
+    SmolRTSP_NalPacketizer packetizer;
+    init(&packetizer, nalu, true);
+    CHECK_CALL(check_fragments(&packetizer, nalu, 4, 1));
+
+    PASS();
+}
+
+TEST single_fragment(void) {
+    // Too large for a single NAL unit packet with its header, but fits into
+    // one fragment, which is both the start and the end.
+    const SmolRTSP_NalUnit nalu = idr(MAX_PACKET_SIZE);
+
+    SmolRTSP_NalPacketizer packetizer;
+    init(&packetizer, nalu, true);
+    CHECK_CALL(check_fragments(&packetizer, nalu, 1, MAX_PACKET_SIZE));
+
+    PASS();
+}
+
+TEST ranges(void) {
+    const SmolRTSP_NalUnit nalu = idr(3 * MAX_PACKET_SIZE + 1);
+
+    SmolRTSP_NalPacketizer packetizer;
+    init(&packetizer, nalu, false);
+
+    // Filled in any order, the ranges make up the same packets as `next`.
+    SmolRTSP_RtpPacket ranges[4];
+    SmolRTSP_NalPacketizer_range(&packetizer, 2, 2, &ranges[2]);
+    SmolRTSP_NalPacketizer_range(&packetizer, 0, 2, &ranges[0]);
+
+    SmolRTSP_RtpPacket packets[4];
+    ASSERT_EQ(3, SmolRTSP_NalPacketizer_next(&packetizer, 3, packets));
+    ASSERT_EQ(1, SmolRTSP_NalPacketizer_next(&packetizer, 1, &packets[3]));
+    ASSERT_EQ(0, SmolRTSP_NalPacketizer_next(&packetizer, 1, &packets[3]));
+
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_EQ(packets[i].marker, ranges[i].marker);
+        ASSERT(U8Slice99_primitive_eq(
+            packets[i].payload_header, ranges[i].payload_header));
+        ASSERT_EQ(packets[i].payload.ptr, ranges[i].payload.ptr);
+        ASSERT_EQ(packets[i].payload.len, ranges[i].payload.len);
+    }
+
+    // Without the marker requested, no packet is marked.
+    ASSERT(!packets[3].marker);
+
+    PASS();
+}
+
+SUITE(nal_packetizer) {
+    RUN_TEST(single_nalu);
+    RUN_TEST(exact_multiple);
+    RUN_TEST(short_last_fragment);
+    RUN_TEST(single_fragment);
+    RUN_TEST(ranges);
+}
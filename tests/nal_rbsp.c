@@ -0,0 +1,138 @@
+#include <smolrtsp/nal_rbsp.h>
+
+#include <greatest.h>
+
+#include <stdint.h>
+#include <string.h>
+
+// Both sides of an H.265 SPS prefix.
+static const uint8_t rbsp[] = {0x01, 0x60, 0x00, 0x00, 0x00, 0x90,
+                               0x00, 0x00, 0x00, 0x00, 0x00, 0x5D};
+static const uint8_t ebsp[] = {0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90,
+                               0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+                               0x5D};
+
+TEST unescape(void) {
+    uint8_t buffer[sizeof ebsp];
+    const size_t len = smolrtsp_nal_unescape(
+        U8Slice99_new((uint8_t *)ebsp, sizeof ebsp), buffer);
+
+    ASSERT_EQ(sizeof rbsp, len);
+    ASSERT_MEM_EQ(rbsp, buffer, len);
+
+    PASS();
+}
+
+TEST escape(void) {
+    const U8Slice99 data = U8Slice99_new((uint8_t *)rbsp, sizeof rbsp);
+    ASSERT_EQ(sizeof ebsp, smolrtsp_nal_escaped_size(data));
+
+    uint8_t buffer[SMOLRTSP_NAL_ESCAPED_MAX_SIZE(sizeof rbsp)];
+    const size_t len = smolrtsp_nal_escape(data, buffer);
+
+    ASSERT_EQ(sizeof ebsp, len);
+    ASSERT_MEM_EQ(ebsp, buffer, len);
+
+    PASS();
+}
+
+TEST escape_trailing_zeros(void) {
+    const uint8_t data[] = {0xAA, 0x00, 0x00},
+                  expected[] = {0xAA, 0x00, 0x00, 0x03};
+
+    uint8_t buffer[SMOLRTSP_NAL_ESCAPED_MAX_SIZE(sizeof data)];
+    const size_t len = smolrtsp_nal_escape(
+        U8Slice99_new((uint8_t *)data, sizeof data), buffer);
+
+    ASSERT_EQ(sizeof expected, len);
+    ASSERT_MEM_EQ(expected, buffer, len);
+
+    PASS();
+}
+
+// Zero runs of every length at every alignment, across the SIMD block sizes.
+TEST round_trip(void) {
+    static uint8_t data[1024], escaped[SMOLRTSP_NAL_ESCAPED_MAX_SIZE(1024)],
+        unescaped[SMOLRTSP_NAL_ESCAPED_MAX_SIZE(1024)];
+
+    static const uint8_t alphabet[] = {0x00, 0x00, 0x00, 0x01,
+                                       0x02, 0x03, 0x04, 0xFF};
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < sizeof data; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = alphabet[(seed >> 16) % sizeof alphabet];
+    }
+
+    for (size_t len = 0; len <= sizeof data; len += 7) {
+        const U8Slice99 input = U8Slice99_new(data, len);
+        const size_t escaped_len = smolrtsp_nal_escape(input, escaped);
+        ASSERT_EQ(smolrtsp_nal_escaped_size(input), escaped_len);
+        ASSERT(escaped_len <= SMOLRTSP_NAL_ESCAPED_MAX_SIZE(len));
+
+        // No start code prefix can remain in the NAL unit payload.
+        for (size_t i = 0; i + 2 < escaped_len; i++) {
+            ASSERT(
+                !(0x00 == escaped[i] && 0x00 == escaped[i + 1] &&
+                  escaped[i + 2] < 0x03));
+        }
+
+        const size_t unescaped_len = smolrtsp_nal_unescape(
+            U8Slice99_new(escaped, escaped_len), unescaped);
+        ASSERT_EQ(len, unescaped_len);
+        ASSERT_MEM_EQ(data, unescaped, len);
+
+        // In place.
+        ASSERT_EQ(
+            len, smolrtsp_nal_unescape(
+                     U8Slice99_new(escaped, escaped_len), escaped));
+        ASSERT_MEM_EQ(data, escaped, len);
+    }
+
+    PASS();
+}
+
+TEST reader(void) {
+    // 101 | 1 | 010 | 011 | 00100 | 00101 | 0000 and an emulation prevention
+    // byte within a 16-bit read.
+    const uint8_t data[] = {0xB4, 0xC8, 0x50, 0x00, 0x00, 0x03, 0x01, 0xFF};
+
+    SmolRTSP_RbspReader r =
+        SmolRTSP_RbspReader_new(U8Slice99_new((uint8_t *)data, sizeof data));
+
+    ASSERT_EQ(0b101, SmolRTSP_RbspReader_bits(&r, 3));
+    ASSERT_EQ(0, SmolRTSP_RbspReader_ue(&r));
+    ASSERT_EQ(1, SmolRTSP_RbspReader_ue(&r));
+    ASSERT_EQ(-1, SmolRTSP_RbspReader_se(&r));
+    ASSERT_EQ(3, SmolRTSP_RbspReader_ue(&r));
+    ASSERT_EQ(-2, SmolRTSP_RbspReader_se(&r));
+    SmolRTSP_RbspReader_skip(&r, 4);
+    ASSERT_EQ(0x0000, SmolRTSP_RbspReader_bits(&r, 16));
+    ASSERT_EQ(0x01FF, SmolRTSP_RbspReader_bits(&r, 16));
+    ASSERT(SmolRTSP_RbspReader_is_ok(&r));
+
+    ASSERT_EQ(0, SmolRTSP_RbspReader_bits(&r, 1));
+    ASSERT(!SmolRTSP_RbspReader_is_ok(&r));
+
+    PASS();
+}
+
+TEST reader_invalid_ue(void) {
+    const uint8_t data[8] = {0};
+
+    SmolRTSP_RbspReader r =
+        SmolRTSP_RbspReader_new(U8Slice99_new((uint8_t *)data, sizeof data));
+
+    ASSERT_EQ(0, SmolRTSP_RbspReader_ue(&r));
+    ASSERT(!SmolRTSP_RbspReader_is_ok(&r));
+
+    PASS();
+}
+
+SUITE(nal_rbsp) {
+    RUN_TEST(unescape);
+    RUN_TEST(escape);
+    RUN_TEST(escape_trailing_zeros);
+    RUN_TEST(round_trip);
+    RUN_TEST(reader);
+    RUN_TEST(reader_invalid_ue);
+}
@@ -0,0 +1,135 @@
+#include <smolrtsp/nal_splitter.h>
+
+#include <greatest.h>
+
+#include <stdint.h>
+#include <string.h>
+
+// Three H.264 NAL units (SPS, PPS, IDR) with both kinds of start codes.
+static const uint8_t stream[] = {
+    0xFF, 0x00,                               // Garbage.
+    0x00, 0x00, 0x00, 0x01, 0x67, 0xAA, 0xBB, // SPS.
+    0x00, 0x00, 0x01, 0x68, 0xCC,             // PPS.
+    0x00, 0x00, 0x00, 0x01, 0x65, 0x01, 0x02, 0x03, 0x00, 0x00, 0x02, // IDR.
+};
+
+typedef struct {
+    uint8_t unit_type;
+    size_t payload_len;
+    uint8_t payload[16];
+} ExpectedNalu;
+
+static const ExpectedNalu expected[] = {
+    {SMOLRTSP_H264_NAL_UNIT_SPS, 2, {0xAA, 0xBB}},
+    {SMOLRTSP_H264_NAL_UNIT_PPS, 1, {0xCC}},
+    {SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+     6,
+     {0x01, 0x02, 0x03, 0x00, 0x00, 0x02}},
+};
+
+static enum greatest_test_res
+check_nalu(const SmolRTSP_NalUnit *nalu, const ExpectedNalu *e) {
+    ASSERT_EQ(e->unit_type, SmolRTSP_NalHeader_unit_type(nalu->header));
+    ASSERT_EQ(e->payload_len, nalu->payload.len);
+    ASSERT_MEM_EQ(e->payload, nalu->payload.ptr, e->payload_len);
+    PASS();
+}
+
+// Feeds `stream` in chunks of `chunk_size` bytes.
+static enum greatest_test_res split_in_chunks(size_t chunk_size) {
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H264);
+
+    size_t count = 0;
+    SmolRTSP_NalUnit nalu;
+
+    for (size_t offset = 0; offset < sizeof stream; offset += chunk_size) {
+        // Copy each chunk, so that stale pointers into previous chunks would be
+        // detected.
+        uint8_t chunk[sizeof stream];
+        const size_t len = sizeof stream - offset < chunk_size
+                               ? sizeof stream - offset
+                               : chunk_size;
+        memcpy(chunk, stream + offset, len);
+
+        SmolRTSP_NalSplitter_feed(splitter, U8Slice99_new(chunk, len));
+        while (SmolRTSP_NalSplitter_next(splitter, &nalu) == 1) {
+            ASSERT(count < SLICE99_ARRAY_LEN(expected));
+            CHECK_CALL(check_nalu(&nalu, &expected[count]));
+            count++;
+        }
+        memset(chunk, 0xEE, sizeof chunk);
+    }
+
+    ASSERT(SmolRTSP_NalSplitter_finish(splitter, &nalu));
+    ASSERT_EQ(SLICE99_ARRAY_LEN(expected) - 1, count);
+    CHECK_CALL(check_nalu(&nalu, &expected[count]));
+    ASSERT(!SmolRTSP_NalSplitter_finish(splitter, &nalu));
+
+    VTABLE(SmolRTSP_NalSplitter, SmolRTSP_Droppable).drop(splitter);
+    PASS();
+}
+
+TEST split_whole_buffer(void) {
+    CHECK_CALL(split_in_chunks(sizeof stream));
+    PASS();
+}
+
+TEST split_chunks(void) {
+    // Every chunk size makes start codes straddle boundaries at different
+    // offsets.
+    for (size_t chunk_size = 1; chunk_size < sizeof stream; chunk_size++) {
+        CHECK_CALL(split_in_chunks(chunk_size));
+    }
+
+    PASS();
+}
+
+TEST no_copy_within_chunk(void) {
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H264);
+
+    SmolRTSP_NalSplitter_feed(
+        splitter, U8Slice99_new((uint8_t *)stream, sizeof stream));
+
+    SmolRTSP_NalUnit nalu;
+    ASSERT_EQ(1, SmolRTSP_NalSplitter_next(splitter, &nalu));
+    ASSERT_EQ(stream + 7, nalu.payload.ptr);
+    ASSERT_EQ(1, SmolRTSP_NalSplitter_next(splitter, &nalu));
+    ASSERT_EQ(stream + 13, nalu.payload.ptr);
+    ASSERT_EQ(0, SmolRTSP_NalSplitter_next(splitter, &nalu));
+
+    ASSERT(SmolRTSP_NalSplitter_finish(splitter, &nalu));
+
+    VTABLE(SmolRTSP_NalSplitter, SmolRTSP_Droppable).drop(splitter);
+    PASS();
+}
+
+TEST split_h265(void) {
+    const uint8_t data[] = {0x00, 0x00, 0x01, 0x40, 0x01, 0xAB,
+                            0x00, 0x00, 0x01, 0x42, 0x01, 0xCD};
+
+    SmolRTSP_NalSplitter *splitter =
+        SmolRTSP_NalSplitter_new(SmolRTSP_NalCodec_H265);
+    SmolRTSP_NalSplitter_feed(
+        splitter, U8Slice99_new((uint8_t *)data, sizeof data));
+
+    SmolRTSP_NalUnit nalu;
+    ASSERT_EQ(1, SmolRTSP_NalSplitter_next(splitter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_vps(nalu.header));
+    ASSERT_EQ(1, nalu.payload.len);
+    ASSERT_EQ(0, SmolRTSP_NalSplitter_next(splitter, &nalu));
+    ASSERT(SmolRTSP_NalSplitter_finish(splitter, &nalu));
+    ASSERT(SmolRTSP_NalHeader_is_sps(nalu.header));
+    ASSERT_EQ(0xCD, nalu.payload.ptr[0]);
+
+    VTABLE(SmolRTSP_NalSplitter, SmolRTSP_Droppable).drop(splitter);
+    PASS();
+}
+
+SUITE(nal_splitter) {
+    RUN_TEST(split_whole_buffer);
+    RUN_TEST(split_chunks);
+    RUN_TEST(no_copy_within_chunk);
+    RUN_TEST(split_h265);
+}
@@ -0,0 +1,820 @@
+#include <smolrtsp/nal_transport.h>
+
+#include "fake_transport.h"
+#include <greatest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+static const SmolRTSP_H264NalHeader h264_idr_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b11,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+};
+
+static const SmolRTSP_H264NalHeader h264_non_idr_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b10,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR,
+};
+
+static const SmolRTSP_H264NalHeader h264_non_ref_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR,
+};
+
+static const SmolRTSP_H264NalHeader h264_sps_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b11,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_SPS,
+};
+
+static const SmolRTSP_H264NalHeader h264_pps_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b11,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_PPS,
+};
+
+// The NAL unit type, or the payload type of an aggregation or fragmentation
+// unit, of the `i`th packet transmitted to `fake`.
+static uint8_t unit_type(const FakeTransport *fake, size_t i) {
+    return fake->packets[i][RTP_HEADER_SIZE] & 0x1F;
+}
+
+static bool marker(const FakeTransport *fake, size_t i) {
+    return fake->packets[i][1] >> 7;
+}
+
+static SmolRTSP_NalTransport *
+new_fake_transport(FakeTransport *fake, SmolRTSP_BackpressurePolicy policy) {
+    *fake = (FakeTransport){0};
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.backpressure_policy = policy;
+
+    return SmolRTSP_NalTransport_new_with_config(
+        SmolRTSP_RtpTransport_new(
+            DYN(FakeTransport, SmolRTSP_Transport, fake), 96, 90000),
+        config);
+}
+
+static int send_h264(
+    SmolRTSP_NalTransport *t, uint32_t ts, SmolRTSP_H264NalHeader h) {
+    static uint8_t payload[10];
+
+    return SmolRTSP_NalTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(ts),
+        (SmolRTSP_NalUnit){
+            SmolRTSP_NalHeader_H264(h),
+            U8Slice99_new(payload, sizeof payload),
+        });
+}
+
+static int send_h265(
+    SmolRTSP_NalTransport *t, uint32_t ts, uint8_t unit_type,
+    uint8_t temporal_id) {
+    static uint8_t payload[10];
+
+    const SmolRTSP_H265NalHeader h = {
+        .forbidden_zero_bit = false,
+        .unit_type = unit_type,
+        .nuh_layer_id = 0,
+        .nuh_temporal_id_plus1 = (uint8_t)(temporal_id + 1),
+    };
+
+    return SmolRTSP_NalTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(ts),
+        (SmolRTSP_NalUnit){
+            SmolRTSP_NalHeader_H265(h),
+            U8Slice99_new(payload, sizeof payload),
+        });
+}
+
+static SmolRTSP_NalTransport *
+new_transport_with_config(int fds[2], SmolRTSP_NalTransportConfig config) {
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0) {
+        return NULL;
+    }
+
+    return SmolRTSP_NalTransport_new_with_config(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000),
+        config);
+}
+
+static SmolRTSP_NalTransport *new_transport(int fds[2], size_t max_size) {
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.max_h264_nalu_size = max_size;
+
+    return new_transport_with_config(fds, config);
+}
+
+static void drop_transport(SmolRTSP_NalTransport *t, int fds[2]) {
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST send_single_nalu(void) {
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_transport(fds, 100);
+    ASSERT(t);
+
+    uint8_t payload[10];
+    memset(payload, 0xAB, sizeof payload);
+
+    const int ret = SmolRTSP_NalTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(0),
+        (SmolRTSP_NalUnit){
+            SmolRTSP_NalHeader_H264(h264_idr_header),
+            U8Slice99_new(payload, sizeof payload)});
+    ASSERT_EQ(0, ret);
+
+    uint8_t packet[256];
+    const ssize_t len = read(fds[1], packet, sizeof packet);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + sizeof payload), len);
+    ASSERT(packet[1] >> 7);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, packet[12] & 0x1F);
+    ASSERT_MEM_EQ(payload, packet + RTP_HEADER_SIZE + 1, sizeof payload);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST send_fragmentized_nalu(void) {
+    enum { max_size = 100, fragments_count = 150 };
+
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_transport(fds, max_size);
+    ASSERT(t);
+
+    // The last fragment is shorter than the others.
+    static uint8_t payload[max_size * (fragments_count - 1) + 7];
+    for (size_t i = 0; i < sizeof payload; i++) {
+        payload[i] = (uint8_t)i;
+    }
+
+    const int ret = SmolRTSP_NalTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(0),
+        (SmolRTSP_NalUnit){
+            SmolRTSP_NalHeader_H264(h264_idr_header),
+            U8Slice99_new(payload, sizeof payload)});
+    ASSERT_EQ(0, ret);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < fragments_count; i++) {
+        const bool is_first = 0 == i, is_last = fragments_count - 1 == i;
+        const size_t fragment_size = is_last ? 7 : max_size;
+
+        uint8_t packet[256];
+        const ssize_t len = read(fds[1], packet, sizeof packet);
+        ASSERT_EQ(
+            (ssize_t)(RTP_HEADER_SIZE + SMOLRTSP_H264_FU_HEADER_SIZE +
+                      fragment_size),
+            len);
+
+        ASSERT_EQ(i, (size_t)((packet[2] << 8) | packet[3]));
+        ASSERT_EQ(is_last, packet[1] >> 7);
+
+        const uint8_t fu_indicator = packet[RTP_HEADER_SIZE],
+                      fu_header = packet[RTP_HEADER_SIZE + 1];
+        ASSERT_EQ(28, fu_indicator & 0x1F); // FU-A
+        ASSERT_EQ(is_first, fu_header >> 7);
+        ASSERT_EQ(is_last, (fu_header >> 6) & 1);
+        ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, fu_header & 0x1F);
+
+        ASSERT_MEM_EQ(
+            payload + offset,
+            packet + RTP_HEADER_SIZE + SMOLRTSP_H264_FU_HEADER_SIZE,
+            fragment_size);
+        offset += fragment_size;
+    }
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(1, stats.nalus);
+    ASSERT_EQ(1, stats.fragmented_nalus);
+    ASSERT_EQ(fragments_count, stats.fragments);
+    ASSERT_EQ(0, stats.errors);
+    ASSERT_EQ(fragments_count, stats.rtp.packets);
+    ASSERT_EQ(fragments_count, stats.rtp.transport.packets);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST backpressure_block(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+
+    fake.full = true;
+    ASSERT_EQ(0, send_h264(t, 0, h264_non_idr_header));
+    ASSERT_EQ(1, fake.packets_count);
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(0, stats.dropped_nalus);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST backpressure_drop_until_idr(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_DropUntilIdr);
+
+    ASSERT_EQ(0, send_h264(t, 0, h264_non_idr_header));
+
+    // The transport becomes full in the middle of an IDR access unit.
+    fake.full = true;
+    ASSERT_EQ(0, send_h264(t, 1, h264_idr_header));
+    fake.full = false;
+    ASSERT_EQ(0, send_h264(t, 1, h264_idr_header));
+    ASSERT_EQ(0, send_h264(t, 2, h264_non_idr_header));
+
+    // Parameter sets pass through, and the next IDR resumes the stream.
+    ASSERT_EQ(0, send_h264(t, 3, h264_sps_header));
+    ASSERT_EQ(0, send_h264(t, 3, h264_idr_header));
+    ASSERT_EQ(0, send_h264(t, 4, h264_non_idr_header));
+
+    ASSERT_EQ(4, fake.packets_count);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR, unit_type(&fake, 0));
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_SPS, unit_type(&fake, 1));
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, unit_type(&fake, 2));
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR, unit_type(&fake, 3));
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(3, stats.dropped_nalus);
+    ASSERT_EQ(3 * 11, stats.dropped_bytes);
+    ASSERT_EQ(2, stats.dropped_access_units);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST backpressure_drop_access_unit(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_DropAccessUnit);
+
+    fake.full = true;
+    ASSERT_EQ(0, send_h264(t, 0, h264_non_idr_header));
+    fake.full = false;
+    ASSERT_EQ(0, send_h264(t, 0, h264_non_idr_header));
+    ASSERT_EQ(0, send_h264(t, 1, h264_non_idr_header));
+
+    ASSERT_EQ(1, fake.packets_count);
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(2, stats.dropped_nalus);
+    ASSERT_EQ(1, stats.dropped_access_units);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST backpressure_thin_h264(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Thin);
+
+    ASSERT_EQ(0, send_h264(t, 0, h264_idr_header));
+    ASSERT_EQ(0, send_h264(t, 1, h264_non_ref_header));
+
+    // Only the non-reference pictures are dropped while the transport is full.
+    fake.full = true;
+    ASSERT_EQ(0, send_h264(t, 2, h264_non_idr_header));
+    ASSERT_EQ(0, send_h264(t, 3, h264_sps_header));
+    ASSERT_EQ(0, send_h264(t, 3, h264_non_ref_header));
+    ASSERT_EQ(1, SmolRTSP_NalTransport_stats(t).thinning_level);
+    ASSERT_EQ(4, fake.packets_count);
+
+    // The thinning continues until enough access units found room.
+    fake.full = false;
+    uint32_t ts = 4;
+    for (size_t i = 1; i < SMOLRTSP_THINNING_RECOVERY_ACCESS_UNITS; i++) {
+        ASSERT_EQ(
+            0, send_h264(
+                   t, ts++,
+                   i == 1 ? h264_non_ref_header : h264_non_idr_header));
+    }
+    ASSERT_EQ(1, SmolRTSP_NalTransport_stats(t).thinning_level);
+    ASSERT_EQ(0, send_h264(t, ts, h264_non_ref_header));
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(0, stats.thinning_level);
+    ASSERT_EQ(2, stats.dropped_nalus);
+    ASSERT_EQ(2, stats.dropped_access_units);
+    ASSERT_EQ(
+        4 + SMOLRTSP_THINNING_RECOVERY_ACCESS_UNITS - 1, fake.packets_count);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST backpressure_thin_h265(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Thin);
+
+    // Two temporal sub-layers, each with non-reference pictures.
+    ASSERT_EQ(0, send_h265(t, 0, SMOLRTSP_H265_NAL_UNIT_IDR_W_RADL, 0));
+    ASSERT_EQ(0, send_h265(t, 1, SMOLRTSP_H265_NAL_UNIT_TSA_R, 1));
+    ASSERT_EQ(0, send_h265(t, 2, SMOLRTSP_H265_NAL_UNIT_TRAIL_N, 1));
+    ASSERT_EQ(3, fake.packets_count);
+
+    // Every full access unit drops one more kind of pictures, from the top.
+    fake.full = true;
+    ASSERT_EQ(0, send_h265(t, 3, SMOLRTSP_H265_NAL_UNIT_TRAIL_N, 1));
+    ASSERT_EQ(0, send_h265(t, 4, SMOLRTSP_H265_NAL_UNIT_TSA_R, 1));
+    ASSERT_EQ(0, send_h265(t, 5, SMOLRTSP_H265_NAL_UNIT_TRAIL_R, 0));
+    ASSERT_EQ(4, fake.packets_count);
+    ASSERT_EQ(0, send_h265(t, 6, SMOLRTSP_H265_NAL_UNIT_TRAIL_N, 0));
+
+    // The base layer reference pictures and parameter sets always pass.
+    ASSERT_EQ(0, send_h265(t, 7, SMOLRTSP_H265_NAL_UNIT_SPS_NUT, 0));
+    ASSERT_EQ(0, send_h265(t, 7, SMOLRTSP_H265_NAL_UNIT_TRAIL_R, 0));
+    ASSERT_EQ(6, fake.packets_count);
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(3, stats.thinning_level);
+    ASSERT_EQ(3, stats.dropped_nalus);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+static SmolRTSP_NalTransport *new_aggregating_transport(int fds[2]) {
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.max_h264_nalu_size = 100;
+    config.max_h265_nalu_size = 100;
+    config.aggregation = true;
+
+    return new_transport_with_config(fds, config);
+}
+
+TEST aggregate_stap_a(void) {
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_aggregating_transport(fds);
+    ASSERT(t);
+
+    // SPS, PPS, and the IDR slice (11 bytes each) go out in one STAP-A.
+    ASSERT_EQ(0, send_h264(t, 0, h264_sps_header));
+    ASSERT_EQ(0, send_h264(t, 0, h264_pps_header));
+    ASSERT_EQ(0, send_h264(t, 0, h264_idr_header));
+
+    uint8_t packet[256];
+    ssize_t len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + 3 * (2 + 11)), len);
+    ASSERT(packet[1] >> 7);
+    ASSERT_EQ(0x78, packet[RTP_HEADER_SIZE]); // NRI = 3, STAP-A.
+
+    const uint8_t expected_types[] = {
+        SMOLRTSP_H264_NAL_UNIT_SPS,
+        SMOLRTSP_H264_NAL_UNIT_PPS,
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+    };
+    const uint8_t *unit = packet + RTP_HEADER_SIZE + 1;
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(expected_types); i++) {
+        ASSERT_EQ(0, unit[0]);
+        ASSERT_EQ(11, unit[1]);
+        ASSERT_EQ(expected_types[i], unit[2] & 0x1F);
+        unit += 2 + 11;
+    }
+
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ(-1, len);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST aggregate_h265_ap(void) {
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_aggregating_transport(fds);
+    ASSERT(t);
+
+    const uint8_t unit_types[] = {
+        SMOLRTSP_H265_NAL_UNIT_VPS_NUT,
+        SMOLRTSP_H265_NAL_UNIT_SPS_NUT,
+        SMOLRTSP_H265_NAL_UNIT_IDR_W_RADL,
+    };
+    uint8_t payload[5] = {0};
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(unit_types); i++) {
+        const SmolRTSP_H265NalHeader h = {
+            .forbidden_zero_bit = false,
+            .unit_type = unit_types[i],
+            .nuh_layer_id = 0,
+            .nuh_temporal_id_plus1 = 1,
+        };
+        ASSERT_EQ(
+            0, SmolRTSP_NalTransport_send_packet(
+                   t, SmolRTSP_RtpTimestamp_Raw(0),
+                   (SmolRTSP_NalUnit){
+                       SmolRTSP_NalHeader_H265(h),
+                       U8Slice99_new(payload, sizeof payload)}));
+    }
+
+    uint8_t packet[256];
+    const ssize_t len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 2 + 3 * (2 + 7)), len);
+
+    // Type = 48 (AP), LayerId = 0, TID = 1.
+    ASSERT_EQ(48 << 1, packet[RTP_HEADER_SIZE]);
+    ASSERT_EQ(1, packet[RTP_HEADER_SIZE + 1]);
+    ASSERT_EQ(7, packet[RTP_HEADER_SIZE + 3]);
+    ASSERT_EQ(
+        SMOLRTSP_H265_NAL_UNIT_VPS_NUT, packet[RTP_HEADER_SIZE + 4] >> 1);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST aggregate_flush(void) {
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_aggregating_transport(fds);
+    ASSERT(t);
+
+    uint8_t packet[256];
+
+    // A held back NAL unit is sent when the timestamp changes.
+    ASSERT_EQ(0, send_h264(t, 0, h264_sps_header));
+    ASSERT_EQ(-1, recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+    ASSERT_EQ(0, send_h264(t, 1, h264_sps_header));
+
+    // A lone NAL unit is sent as a single NAL unit packet.
+    ssize_t len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 11), len);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_SPS, packet[RTP_HEADER_SIZE] & 0x1F);
+    ASSERT(!(packet[1] >> 7));
+
+    ASSERT_EQ(0, SmolRTSP_NalTransport_flush(t));
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 11), len);
+    ASSERT_EQ(0, SmolRTSP_NalTransport_flush(t));
+    ASSERT_EQ(-1, recv(fds[1], packet, sizeof packet, MSG_DONTWAIT));
+
+    // A NAL unit that does not fit flushes the pending ones and is fragmented.
+    static uint8_t big_payload[150];
+    ASSERT_EQ(0, send_h264(t, 2, h264_pps_header));
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(2),
+               (SmolRTSP_NalUnit){
+                   SmolRTSP_NalHeader_H264(h264_idr_header),
+                   U8Slice99_new(big_payload, sizeof big_payload)}));
+
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 11), len);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_PPS, packet[RTP_HEADER_SIZE] & 0x1F);
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ(28, packet[RTP_HEADER_SIZE] & 0x1F); // FU-A
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST path_mtu_budget(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+
+    static uint8_t payload[2000];
+    const SmolRTSP_NalUnit nalu = {
+        SmolRTSP_NalHeader_H264(h264_idr_header),
+        U8Slice99_new(payload, sizeof payload),
+    };
+
+    // The reported limit overrides `max_h264_nalu_size`.
+    fake.max_packet_size = 1000;
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(0), nalu));
+    ASSERT_EQ(3, fake.packets_count);
+    ASSERT_EQ(1000, fake.largest_packet);
+
+    // The path shrinks: the NAL unit is sent again in smaller packets.
+    fake.packets_count = 0;
+    fake.largest_packet = 0;
+    fake.mtu = 600;
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(1), nalu));
+    ASSERT_EQ(4, fake.packets_count);
+    ASSERT_EQ(600, fake.largest_packet);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST param_sets_cached(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+
+    ASSERT_EQ(0, send_h264(t, 0, h264_sps_header));
+    ASSERT_EQ(0, send_h264(t, 0, h264_pps_header));
+    ASSERT_EQ(0, send_h264(t, 0, h264_idr_header));
+
+    const SmolRTSP_ParamSetCache *cache = SmolRTSP_NalTransport_param_sets(t);
+    ASSERT(SmolRTSP_ParamSetCache_is_complete(cache));
+    ASSERT_EQ(11, SmolRTSP_ParamSetCache_sps(cache).len);
+    ASSERT_EQ(0x68, SmolRTSP_ParamSetCache_pps(cache).ptr[0]);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST access_unit_marker(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+
+    static uint8_t payload[2000];
+    const SmolRTSP_NalUnit small_slice = {
+        SmolRTSP_NalHeader_H264(h264_non_idr_header),
+        U8Slice99_new(payload, 10),
+    };
+    const SmolRTSP_NalUnit large_slice = {
+        SmolRTSP_NalHeader_H264(h264_non_idr_header),
+        U8Slice99_new(payload, sizeof payload),
+    };
+    const SmolRTSP_RtpTimestamp ts = SmolRTSP_RtpTimestamp_Raw(0);
+
+    // Without access unit boundaries, every slice is marked.
+    ASSERT_EQ(0, SmolRTSP_NalTransport_send_packet(t, ts, small_slice));
+    ASSERT_EQ(0, SmolRTSP_NalTransport_send_packet(t, ts, small_slice));
+    ASSERT_EQ(2, fake.packets_count);
+    ASSERT(marker(&fake, 0));
+    ASSERT(marker(&fake, 1));
+
+    // Only the last packet of the last slice is marked, including the
+    // fragments of a slice in the middle.
+    fake.packets_count = 0;
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_au_packet(t, ts, small_slice, false));
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_au_packet(t, ts, large_slice, false));
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_au_packet(t, ts, large_slice, true));
+    ASSERT_EQ(5, fake.packets_count);
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT(!marker(&fake, i));
+    }
+    ASSERT(marker(&fake, 4));
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST send_access_unit(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+    fake.max_packet_size = 1000;
+
+    static uint8_t payload[2000];
+    const SmolRTSP_NalUnit nalus[] = {
+        {SmolRTSP_NalHeader_H264(h264_sps_header), U8Slice99_new(payload, 10)},
+        {SmolRTSP_NalHeader_H264(h264_pps_header), U8Slice99_new(payload, 10)},
+        {SmolRTSP_NalHeader_H264(h264_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+        {SmolRTSP_NalHeader_H264(h264_idr_header), U8Slice99_new(payload, 10)},
+    };
+
+    // The arrays are reused for the second access unit.
+    for (uint32_t ts = 0; ts < 2; ts++) {
+        fake.packets_count = 0;
+        ASSERT_EQ(
+            0, SmolRTSP_NalTransport_send_access_unit(
+                   t, SmolRTSP_RtpTimestamp_Raw(ts), nalus,
+                   SLICE99_ARRAY_LEN(nalus)));
+
+        const uint8_t expected_types[] = {
+            SMOLRTSP_H264_NAL_UNIT_SPS,
+            SMOLRTSP_H264_NAL_UNIT_PPS,
+            28,
+            28,
+            28,
+            SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        };
+        ASSERT_EQ(SLICE99_ARRAY_LEN(expected_types), fake.packets_count);
+        for (size_t i = 0; i < fake.packets_count; i++) {
+            ASSERT_EQ(expected_types[i], unit_type(&fake, i));
+            ASSERT_EQ(i + 1 == fake.packets_count, marker(&fake, i));
+        }
+    }
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(8, stats.nalus);
+    ASSERT_EQ(2, stats.fragmented_nalus);
+    ASSERT_EQ(6, stats.fragments);
+    ASSERT_EQ(12, stats.rtp.packets);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST send_access_unit_aggregated(void) {
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_aggregating_transport(fds);
+    ASSERT(t);
+
+    static uint8_t payload[10];
+    const SmolRTSP_NalUnit nalus[] = {
+        {SmolRTSP_NalHeader_H264(h264_sps_header),
+         U8Slice99_new(payload, sizeof payload)},
+        {SmolRTSP_NalHeader_H264(h264_pps_header),
+         U8Slice99_new(payload, sizeof payload)},
+        {SmolRTSP_NalHeader_H264(h264_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+        {SmolRTSP_NalHeader_H264(h264_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+    };
+
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_access_unit(
+               t, SmolRTSP_RtpTimestamp_Raw(0), nalus,
+               SLICE99_ARRAY_LEN(nalus)));
+
+    // The parameter sets go with the first slice, and the second slice goes
+    // alone.
+    uint8_t packet[256];
+    ssize_t len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 1 + 3 * (2 + 11)), len);
+    ASSERT(!(packet[1] >> 7));
+    ASSERT_EQ(0x78, packet[RTP_HEADER_SIZE]); // NRI = 3, STAP-A.
+
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + 11), len);
+    ASSERT(packet[1] >> 7);
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR, packet[RTP_HEADER_SIZE] & 0x1F);
+
+    len = recv(fds[1], packet, sizeof packet, MSG_DONTWAIT);
+    ASSERT_EQ(-1, len);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST send_access_unit_dropped(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_DropAccessUnit);
+
+    static uint8_t payload[10];
+    const SmolRTSP_NalUnit nalus[] = {
+        {SmolRTSP_NalHeader_H264(h264_non_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+        {SmolRTSP_NalHeader_H264(h264_non_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+    };
+
+    fake.full = true;
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_access_unit(
+               t, SmolRTSP_RtpTimestamp_Raw(0), nalus,
+               SLICE99_ARRAY_LEN(nalus)));
+    ASSERT_EQ(0, fake.packets_count);
+
+    const SmolRTSP_NalTransportStats stats = SmolRTSP_NalTransport_stats(t);
+    ASSERT_EQ(0, stats.nalus);
+    ASSERT_EQ(2, stats.dropped_nalus);
+    ASSERT_EQ(1, stats.dropped_access_units);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+TEST send_access_unit_path_mtu(void) {
+    FakeTransport fake;
+    SmolRTSP_NalTransport *t =
+        new_fake_transport(&fake, SmolRTSP_BackpressurePolicy_Block);
+    fake.max_packet_size = 1000;
+    fake.mtu = 600;
+
+    static uint8_t payload[2000];
+    const SmolRTSP_NalUnit nalus[] = {
+        {SmolRTSP_NalHeader_H264(h264_sps_header), U8Slice99_new(payload, 10)},
+        {SmolRTSP_NalHeader_H264(h264_idr_header),
+         U8Slice99_new(payload, sizeof payload)},
+    };
+
+    // The SPS gets through, and the slice is sent again in smaller packets.
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_access_unit(
+               t, SmolRTSP_RtpTimestamp_Raw(0), nalus,
+               SLICE99_ARRAY_LEN(nalus)));
+    ASSERT_EQ(5, fake.packets_count);
+    ASSERT_EQ(SMOLRTSP_H264_NAL_UNIT_SPS, unit_type(&fake, 0));
+    ASSERT_EQ(600, fake.largest_packet);
+    ASSERT(marker(&fake, 4));
+    ASSERT_EQ(1, SmolRTSP_NalTransport_stats(t).emsgsize_retries);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    PASS();
+}
+
+static uint64_t ticking_now_us;
+
+// Advances by 10 microseconds on every call.
+static uint64_t ticking_clock_us(void) {
+    return ticking_now_us += 10;
+}
+
+TEST latency(void) {
+    static SmolRTSP_LatencyHistogram latency;
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.aggregation = true;
+    config.latency = &latency;
+    config.clock_us = ticking_clock_us;
+
+    int fds[2];
+    SmolRTSP_NalTransport *t = new_transport_with_config(fds, config);
+    ASSERT(t);
+
+    // The SPS is held back, and the IDR slice flushes it.
+    ASSERT_EQ(0, send_h264(t, 0, h264_sps_header));
+    ASSERT_EQ(0, latency.total_count);
+    ASSERT_EQ(0, send_h264(t, 0, h264_idr_header));
+    ASSERT_EQ(0, send_h264(t, 1, h264_non_idr_header));
+
+    ASSERT_EQ(2, latency.total_count);
+    ASSERT_EQ(10, latency.max_us);
+    ASSERT_EQ(10, SmolRTSP_LatencyHistogram_value_at_percentile(&latency, 99));
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+TEST new_udp(void) {
+    enum { max_size = 100 };
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    // The NAL, RTP, and UDP transports in a single allocation.
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.max_h264_nalu_size = max_size;
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new_udp(
+        fds[0], SmolRTSP_UdpTransportConfig_default(), 96, 90000, config);
+    ASSERT(t);
+
+    uint8_t payload[max_size * 2];
+    memset(payload, 0xAB, sizeof payload);
+    ASSERT_EQ(
+        0, SmolRTSP_NalTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(0),
+               (SmolRTSP_NalUnit){
+                   SmolRTSP_NalHeader_H264(h264_idr_header),
+                   U8Slice99_new(payload, sizeof payload)}));
+
+    // Fragmented into FU-A packets, the last one with the marker.
+    size_t packets_count = 0;
+    bool marker = false;
+    while (!marker) {
+        uint8_t packet[256];
+        const ssize_t len = read(fds[1], packet, sizeof packet);
+        ASSERT(len > (ssize_t)(RTP_HEADER_SIZE + SMOLRTSP_H264_FU_HEADER_SIZE));
+        ASSERT_EQ(28, packet[12] & 0x1F); // FU-A
+        marker = packet[1] >> 7;
+        packets_count++;
+    }
+    ASSERT(packets_count > 1);
+    ASSERT_EQ(packets_count, SmolRTSP_NalTransport_stats(t).rtp.packets);
+
+    drop_transport(t, fds);
+    PASS();
+}
+
+SUITE(nal_transport) {
+    RUN_TEST(send_single_nalu);
+    RUN_TEST(send_fragmentized_nalu);
+    RUN_TEST(backpressure_block);
+    RUN_TEST(backpressure_drop_until_idr);
+    RUN_TEST(backpressure_drop_access_unit);
+    RUN_TEST(backpressure_thin_h264);
+    RUN_TEST(backpressure_thin_h265);
+    RUN_TEST(aggregate_stap_a);
+    RUN_TEST(aggregate_h265_ap);
+    RUN_TEST(aggregate_flush);
+    RUN_TEST(path_mtu_budget);
+    RUN_TEST(param_sets_cached);
+    RUN_TEST(access_unit_marker);
+    RUN_TEST(send_access_unit);
+    RUN_TEST(send_access_unit_aggregated);
+    RUN_TEST(send_access_unit_dropped);
+    RUN_TEST(send_access_unit_path_mtu);
+    RUN_TEST(latency);
+    RUN_TEST(new_udp);
+}
@@ -0,0 +1,55 @@
+#include <smolrtsp/numa.h>
+
+#include <greatest.h>
+
+#include <sched.h>
+
+TEST cpu_numa_node(void) {
+    ASSERT_EQ(-1, smolrtsp_cpu_numa_node(-1));
+
+    // Either unknown or a valid node, depending on the kernel.
+    const int cpu = smolrtsp_allowed_cpu(0);
+    ASSERT(cpu >= 0);
+    ASSERT(smolrtsp_cpu_numa_node(cpu) >= -1);
+
+    PASS();
+}
+
+TEST interface_numa_node(void) {
+    // A virtual device has no NUMA node.
+    ASSERT_EQ(-1, smolrtsp_interface_numa_node("lo"));
+
+    // Never a path outside of `/sys/class/net`.
+    ASSERT_EQ(-1, smolrtsp_interface_numa_node(""));
+    ASSERT_EQ(-1, smolrtsp_interface_numa_node(".."));
+    ASSERT_EQ(-1, smolrtsp_interface_numa_node("../../devices/system"));
+
+    PASS();
+}
+
+TEST allowed_cpu(void) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof set, &set));
+    const size_t count = (size_t)CPU_COUNT(&set);
+
+    int prev = -1;
+    for (size_t i = 0; i < count; i++) {
+        const int cpu = smolrtsp_allowed_cpu(i);
+        ASSERT(cpu > prev);
+        ASSERT(CPU_ISSET(cpu, &set));
+        prev = cpu;
+    }
+
+    // The workers beyond the CPUs wrap around.
+    ASSERT_EQ(smolrtsp_allowed_cpu(0), smolrtsp_allowed_cpu(count));
+    ASSERT_EQ(smolrtsp_allowed_cpu(1), smolrtsp_allowed_cpu(count + 1));
+
+    PASS();
+}
+
+SUITE(numa) {
+    RUN_TEST(cpu_numa_node);
+    RUN_TEST(interface_numa_node);
+    RUN_TEST(allowed_cpu);
+}
@@ -0,0 +1,161 @@
+#include <smolrtsp/pacer.h>
+
+#include "fake_transport.h"
+#include <greatest.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static uint64_t fake_now_us;
+
+static uint64_t fake_clock_us(void) {
+    return fake_now_us;
+}
+
+static SmolRTSP_Transport new_pacer_with_latency(
+    FakeTransport *fake, SmolRTSP_LatencyHistogram *latency) {
+    *fake = (FakeTransport){0};
+    fake_now_us = 1000;
+
+    SmolRTSP_PacerConfig config = SmolRTSP_PacerConfig_default();
+    config.rate = 100000; // 100 bytes per millisecond.
+    config.burst = 200;
+    config.max_queue_size = 1024;
+    config.latency = latency;
+    config.clock_us = fake_clock_us;
+
+    SmolRTSP_Pacer *pacer = SmolRTSP_Pacer_new(
+        DYN(FakeTransport, SmolRTSP_Transport, fake), config);
+
+    return DYN(SmolRTSP_Pacer, SmolRTSP_Transport, pacer);
+}
+
+static SmolRTSP_Transport new_pacer(FakeTransport *fake) {
+    return new_pacer_with_latency(fake, NULL);
+}
+
+static int transmit_bytes(SmolRTSP_Transport t, size_t size) {
+    static uint8_t data[1024];
+    assert(size <= sizeof data);
+
+    struct iovec vec = {data, size};
+
+    return VCALL(t, transmit, SmolRTSP_IoVecSlice_new(&vec, 1));
+}
+
+TEST pace_burst(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_pacer(&fake);
+    SmolRTSP_Pacer *pacer = t.self;
+
+    // The first two packets fit into the bucket.
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(0, transmit_bytes(t, 100));
+    }
+    ASSERT_EQ(2, fake.packets_count);
+    ASSERT_EQ(200, SmolRTSP_Pacer_queued_bytes(pacer));
+    ASSERT_EQ(2000, SmolRTSP_Pacer_next_deadline(pacer));
+
+    // Nothing is due yet.
+    fake_now_us = 1500;
+    ASSERT_EQ(0, SmolRTSP_Pacer_poll(pacer));
+    ASSERT_EQ(2, fake.packets_count);
+
+    fake_now_us = 2000;
+    ASSERT_EQ(0, SmolRTSP_Pacer_poll(pacer));
+    ASSERT_EQ(3, fake.packets_count);
+    ASSERT_EQ(3000, SmolRTSP_Pacer_next_deadline(pacer));
+
+    fake_now_us = 10000;
+    ASSERT_EQ(0, SmolRTSP_Pacer_poll(pacer));
+    ASSERT_EQ(4, fake.packets_count);
+    ASSERT_EQ(0, SmolRTSP_Pacer_queued_bytes(pacer));
+    ASSERT_EQ(SMOLRTSP_PACER_IDLE, SmolRTSP_Pacer_next_deadline(pacer));
+
+    for (size_t i = 0; i < fake.packets_count; i++) {
+        ASSERT_EQ(100, fake.packet_sizes[i]);
+    }
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST pace_batch(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_pacer(&fake);
+    SmolRTSP_Pacer *pacer = t.self;
+
+    uint8_t data[150] = {0};
+    struct iovec vecs[] = {{data, 150}, {data, 50}, {data, 100}};
+    SmolRTSP_IoVecSlice batch[] = {
+        SmolRTSP_IoVecSlice_new(&vecs[0], 1),
+        SmolRTSP_IoVecSlice_new(&vecs[1], 1),
+        SmolRTSP_IoVecSlice_new(&vecs[2], 1),
+    };
+
+    const ssize_t ret = VCALL(
+        t, transmit_batch,
+        (SmolRTSP_IoVecBatch)Slice99_typed_from_array(batch));
+    ASSERT_EQ(3, ret);
+    ASSERT_EQ(2, fake.packets_count);
+    ASSERT_EQ(100, SmolRTSP_Pacer_queued_bytes(pacer));
+
+    fake_now_us += 1000;
+    ASSERT_EQ(0, SmolRTSP_Pacer_poll(pacer));
+    ASSERT_EQ(3, fake.packets_count);
+    ASSERT_EQ(100, fake.packet_sizes[2]);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST pace_queue_overflow(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_pacer(&fake);
+
+    ASSERT(!VCALL(t, is_full));
+
+    ASSERT_EQ(0, transmit_bytes(t, 200));
+    ASSERT_EQ(0, transmit_bytes(t, 600));
+    ASSERT(VCALL(t, is_full));
+
+    ASSERT_EQ(0, transmit_bytes(t, 400));
+    ASSERT_EQ(-1, transmit_bytes(t, 200));
+    ASSERT_EQ(ENOBUFS, errno);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST pace_latency(void) {
+    static SmolRTSP_LatencyHistogram latency;
+
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_pacer_with_latency(&fake, &latency);
+    SmolRTSP_Pacer *pacer = t.self;
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(0, transmit_bytes(t, 100));
+    }
+
+    fake_now_us += 1500;
+    ASSERT_EQ(0, SmolRTSP_Pacer_poll(pacer));
+    ASSERT_EQ(3, fake.packets_count);
+
+    // Two packets are transmitted immediately and one after 1.5 ms.
+    ASSERT_EQ(3, latency.total_count);
+    ASSERT_EQ(1500, latency.max_us);
+    ASSERT_EQ(0, SmolRTSP_LatencyHistogram_value_at_percentile(&latency, 50));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+SUITE(pacer) {
+    RUN_TEST(pace_burst);
+    RUN_TEST(pace_batch);
+    RUN_TEST(pace_queue_overflow);
+    RUN_TEST(pace_latency);
+}
@@ -0,0 +1,155 @@
+#include <smolrtsp/packet_pool.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+TEST acquire_and_release(void) {
+    SmolRTSP_PacketPoolConfig config = SmolRTSP_PacketPoolConfig_default();
+    config.buffer_size = 1500;
+    config.buffers_count = 2;
+
+    SmolRTSP_PacketPool *pool = SmolRTSP_PacketPool_new(config);
+    ASSERT(pool);
+    ASSERT_EQ(1536, SmolRTSP_PacketPool_buffer_size(pool));
+    ASSERT_EQ(2, SmolRTSP_PacketPool_available(pool));
+
+    SmolRTSP_PacketBuf *a = SmolRTSP_PacketPool_acquire(pool),
+                       *b = SmolRTSP_PacketPool_acquire(pool);
+    ASSERT(a);
+    ASSERT(b);
+    ASSERT_EQ(
+        0, (uintptr_t)SmolRTSP_PacketBuf_data(a) %
+               SMOLRTSP_PACKET_POOL_ALIGNMENT);
+    ASSERT_EQ(
+        0, (uintptr_t)SmolRTSP_PacketBuf_data(b) %
+               SMOLRTSP_PACKET_POOL_ALIGNMENT);
+    ASSERT_EQ(0, SmolRTSP_PacketBuf_bytes(a).len);
+
+    errno = 0;
+    ASSERT_EQ(NULL, SmolRTSP_PacketPool_acquire(pool));
+    ASSERT_EQ(ENOBUFS, errno);
+
+    // A reference per stage holding the packet.
+    ASSERT_EQ(a, SmolRTSP_PacketBuf_retain(a));
+    ASSERT_EQ(2, SmolRTSP_PacketBuf_refcount(a));
+    SmolRTSP_PacketBuf_release(a);
+    ASSERT_EQ(0, SmolRTSP_PacketPool_available(pool));
+    SmolRTSP_PacketBuf_release(a);
+    ASSERT_EQ(1, SmolRTSP_PacketPool_available(pool));
+
+    // The buffer released last is reused first.
+    ASSERT_EQ(a, SmolRTSP_PacketPool_acquire(pool));
+    SmolRTSP_PacketBuf_release(a);
+    SmolRTSP_PacketBuf_release(b);
+    ASSERT_EQ(2, SmolRTSP_PacketPool_available(pool));
+
+    const SmolRTSP_PacketPoolStats stats = SmolRTSP_PacketPool_stats(pool);
+    ASSERT_EQ(3, stats.acquired);
+    ASSERT_EQ(1, stats.exhausted);
+    ASSERT_EQ(2, stats.peak_in_use);
+
+    VTABLE(SmolRTSP_PacketPool, SmolRTSP_Droppable).drop(pool);
+    PASS();
+}
+
+TEST write_packet(void) {
+    SmolRTSP_PacketPoolConfig config = SmolRTSP_PacketPoolConfig_default();
+    config.buffer_size = 64;
+    config.buffers_count = 1;
+
+    SmolRTSP_PacketPool *pool = SmolRTSP_PacketPool_new(config);
+    ASSERT(pool);
+    SmolRTSP_PacketBuf *buf = SmolRTSP_PacketPool_acquire(pool);
+    ASSERT(buf);
+
+    uint8_t packet[65] = {0x80, 96, 0x12, 0x34};
+    ASSERT_EQ(0, SmolRTSP_PacketBuf_write(buf, U8Slice99_new(packet, 4)));
+    U8Slice99 bytes = SmolRTSP_PacketBuf_bytes(buf);
+    ASSERT_EQ(4, bytes.len);
+    ASSERT_MEM_EQ(packet, bytes.ptr, 4);
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_PacketBuf_write(
+                buf, U8Slice99_new(packet, sizeof packet)));
+    ASSERT_EQ(EMSGSIZE, errno);
+    ASSERT_EQ(4, SmolRTSP_PacketBuf_bytes(buf).len);
+
+    SmolRTSP_PacketBuf_data(buf)[4] = 0xAB;
+    SmolRTSP_PacketBuf_set_len(buf, 5);
+    bytes = SmolRTSP_PacketBuf_bytes(buf);
+    ASSERT_EQ(5, bytes.len);
+    ASSERT_EQ(0xAB, bytes.ptr[4]);
+
+    SmolRTSP_PacketBuf_release(buf);
+    VTABLE(SmolRTSP_PacketPool, SmolRTSP_Droppable).drop(pool);
+    PASS();
+}
+
+TEST hugepages(void) {
+    SmolRTSP_PacketPoolConfig config = SmolRTSP_PacketPoolConfig_default();
+    config.buffers_count = 16;
+    config.hugepages = true;
+
+    // Without huge pages, the pool falls back to regular ones.
+    SmolRTSP_PacketPool *pool = SmolRTSP_PacketPool_new(config);
+    ASSERT(pool);
+
+    // Every buffer is usable.
+    SmolRTSP_PacketBuf *bufs[16];
+    for (size_t i = 0; i < 16; i++) {
+        bufs[i] = SmolRTSP_PacketPool_acquire(pool);
+        ASSERT(bufs[i]);
+        ASSERT_EQ(
+            0, (uintptr_t)SmolRTSP_PacketBuf_data(bufs[i]) %
+                   SMOLRTSP_PACKET_POOL_ALIGNMENT);
+        memset(SmolRTSP_PacketBuf_data(bufs[i]), 0xFF, 2048);
+    }
+    ASSERT_EQ(0, SmolRTSP_PacketPool_available(pool));
+
+    for (size_t i = 0; i < 16; i++) {
+        SmolRTSP_PacketBuf_release(bufs[i]);
+    }
+
+    VTABLE(SmolRTSP_PacketPool, SmolRTSP_Droppable).drop(pool);
+    PASS();
+}
+
+TEST numa_node(void) {
+    SmolRTSP_PacketPoolConfig config = SmolRTSP_PacketPoolConfig_default();
+    config.buffers_count = 16;
+    ASSERT_EQ(-1, config.numa_node);
+
+    SmolRTSP_PacketPool *pool = SmolRTSP_PacketPool_new(config);
+    ASSERT(pool);
+    ASSERT_EQ(-1, SmolRTSP_PacketPool_numa_node(pool));
+    VTABLE(SmolRTSP_PacketPool, SmolRTSP_Droppable).drop(pool);
+
+    // Bound unless the kernel lacks NUMA support.
+    config.numa_node = 0;
+    pool = SmolRTSP_PacketPool_new(config);
+    ASSERT(pool);
+    const int node = SmolRTSP_PacketPool_numa_node(pool);
+    ASSERT(0 == node || -1 == node);
+
+    SmolRTSP_PacketBuf *buf = SmolRTSP_PacketPool_acquire(pool);
+    ASSERT(buf);
+    ASSERT_EQ(
+        0, (uintptr_t)SmolRTSP_PacketBuf_data(buf) %
+               SMOLRTSP_PACKET_POOL_ALIGNMENT);
+    memset(SmolRTSP_PacketBuf_data(buf), 0xFF, 2048);
+    SmolRTSP_PacketBuf_release(buf);
+
+    VTABLE(SmolRTSP_PacketPool, SmolRTSP_Droppable).drop(pool);
+    PASS();
+}
+
+SUITE(packet_pool) {
+    RUN_TEST(acquire_and_release);
+    RUN_TEST(write_packet);
+    RUN_TEST(hugepages);
+    RUN_TEST(numa_node);
+}
@@ -0,0 +1,208 @@
+#include <smolrtsp/packetized_file.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define RTP_HEADER_SIZE 12
+#define IDR_SIZE        301
+
+static enum greatest_test_res
+write_file(const char *path, const uint8_t *data, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    ASSERT_EQ(len, fwrite(data, 1, len, fp));
+    ASSERT_EQ(0, fclose(fp));
+
+    PASS();
+}
+
+// Writes an H.264 stream with two-byte length prefixes: SPS, PPS, and an IDR
+// slice of `IDR_SIZE` bytes; a non-IDR slice; an IDR slice.
+static enum greatest_test_res write_media(const char *path) {
+    uint8_t data[64 + IDR_SIZE];
+    size_t len = 0;
+
+    const uint8_t params[] = {
+        0x00, 0x04, 0x67, 0x42, 0x00, 0x1F, // SPS.
+        0x00, 0x04, 0x68, 0xCE, 0x38, 0x80, // PPS.
+        IDR_SIZE >> 8, IDR_SIZE & 0xFF, 0x65,
+    };
+    memcpy(data, params, sizeof params);
+    len += sizeof params;
+    for (size_t i = 1; i < IDR_SIZE; i++) {
+        data[len++] = (uint8_t)i;
+    }
+
+    const uint8_t rest[] = {
+        0x00, 0x03, 0x41, 0x9A, 0x02, // Non-IDR.
+        0x00, 0x02, 0x65, 0x88,       // IDR.
+    };
+    memcpy(data + len, rest, sizeof rest);
+    len += sizeof rest;
+
+    return write_file(path, data, len);
+}
+
+static enum greatest_test_res check_packet(
+    const SmolRTSP_PacketizedFile *file, size_t i, uint8_t first_byte,
+    uint32_t timestamp, bool marker, bool is_idr) {
+    const SmolRTSP_PacketizedPacket packet =
+        SmolRTSP_PacketizedFile_packet(file, i);
+    ASSERT(packet.payload.len > 0);
+    ASSERT_EQ(first_byte, packet.payload.ptr[0]);
+    ASSERT_EQ(timestamp, packet.timestamp);
+    ASSERT_EQ(marker, packet.marker);
+    ASSERT_EQ(is_idr, packet.is_idr);
+
+    PASS();
+}
+
+// Writes the pre-packetized file of the stream of `write_media` to `path`.
+static enum greatest_test_res write_packetized(const char *path) {
+    char media_path[] = "/tmp/smolrtsp-media-XXXXXX";
+    const int fd = mkstemp(media_path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_media(media_path));
+
+    SmolRTSP_MediaFile *media =
+        SmolRTSP_MediaFile_open(media_path, SmolRTSP_NalCodec_H264, 2, NULL);
+    ASSERT(media != NULL);
+
+    SmolRTSP_PacketizedFileConfig config =
+        SmolRTSP_PacketizedFileConfig_default();
+    config.max_packet_size = 100;
+    const int ret = SmolRTSP_PacketizedFile_write(path, media, config);
+
+    VTABLE(SmolRTSP_MediaFile, SmolRTSP_Droppable).drop(media);
+    remove(media_path);
+    ASSERT_EQ(0, ret);
+
+    PASS();
+}
+
+TEST write_and_open(void) {
+    char path[] = "/tmp/smolrtsp-packetized-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_packetized(path));
+
+    SmolRTSP_PacketizedFile *file = SmolRTSP_PacketizedFile_open(path);
+    ASSERT(file != NULL);
+    ASSERT_EQ(SmolRTSP_NalCodec_H264, SmolRTSP_PacketizedFile_codec(file));
+    ASSERT_EQ(90000, SmolRTSP_PacketizedFile_clock_rate(file));
+    ASSERT(SmolRTSP_PacketizedFile_sprop(file) != NULL);
+    ASSERT_STR_EQ(
+        "sprop-parameter-sets=Z0IAHw==,aM44gA==",
+        SmolRTSP_PacketizedFile_sprop(file));
+
+    // SPS, PPS, four FU-A packets of the IDR slice; a single NAL unit packet
+    // per every other access unit, 40 ms apart.
+    ASSERT_EQ(8, SmolRTSP_PacketizedFile_packets_count(file));
+    CHECK_CALL(check_packet(file, 0, 0x67, 0, false, true));
+    CHECK_CALL(check_packet(file, 1, 0x68, 0, false, false));
+    for (size_t i = 2; i < 6; i++) {
+        CHECK_CALL(check_packet(file, i, 0x7C, 0, 5 == i, false));
+        ASSERT(SmolRTSP_PacketizedFile_packet(file, i).payload.len <= 100);
+    }
+    CHECK_CALL(check_packet(file, 6, 0x41, 3600, true, false));
+    CHECK_CALL(check_packet(file, 7, 0x65, 7200, true, true));
+
+    ASSERT_EQ(0, SmolRTSP_PacketizedFile_seek(file, 0));
+    ASSERT_EQ(0, SmolRTSP_PacketizedFile_seek(file, 79));
+    ASSERT_EQ(7, SmolRTSP_PacketizedFile_seek(file, 80));
+    ASSERT_EQ(7, SmolRTSP_PacketizedFile_seek(file, UINT64_MAX));
+
+    VTABLE(SmolRTSP_PacketizedFile, SmolRTSP_Droppable).drop(file);
+    remove(path);
+    PASS();
+}
+
+TEST send_packets(void) {
+    char path[] = "/tmp/smolrtsp-packetized-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_packetized(path));
+
+    SmolRTSP_PacketizedFile *file = SmolRTSP_PacketizedFile_open(path);
+    ASSERT(file != NULL);
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_RtpTransport *t = SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_udp(fds[0]), 96, 90000);
+    ASSERT(t);
+
+    const size_t count = SmolRTSP_PacketizedFile_packets_count(file);
+    ASSERT_EQ(0, SmolRTSP_PacketizedFile_send(file, t, 0, count, 1000));
+
+    // The payloads are sent as stored, with patched RTP headers.
+    for (size_t i = 0; i < count; i++) {
+        const SmolRTSP_PacketizedPacket expected =
+            SmolRTSP_PacketizedFile_packet(file, i);
+
+        uint8_t packet[256];
+        const ssize_t len = read(fds[1], packet, sizeof packet);
+        ASSERT_EQ((ssize_t)(RTP_HEADER_SIZE + expected.payload.len), len);
+        ASSERT_EQ(i, (size_t)((packet[2] << 8) | packet[3]));
+        const uint32_t timestamp =
+            (uint32_t)packet[4] << 24 | (uint32_t)packet[5] << 16 |
+            (uint32_t)packet[6] << 8 | packet[7];
+        ASSERT_EQ(1000 + expected.timestamp, timestamp);
+        ASSERT_EQ(expected.marker, packet[1] >> 7);
+        ASSERT_MEM_EQ(
+            expected.payload.ptr, packet + RTP_HEADER_SIZE,
+            expected.payload.len);
+    }
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    VTABLE(SmolRTSP_PacketizedFile, SmolRTSP_Droppable).drop(file);
+    remove(path);
+    PASS();
+}
+
+TEST open_malformed(void) {
+    char path[] = "/tmp/smolrtsp-packetized-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT(fd != -1);
+    close(fd);
+    CHECK_CALL(write_packetized(path));
+
+    // A future version of the format.
+    FILE *fp = fopen(path, "r+b");
+    ASSERT(fp != NULL);
+    ASSERT_EQ(0, fseek(fp, 8, SEEK_SET));
+    ASSERT_EQ(1, fwrite(&(uint32_t){2}, sizeof(uint32_t), 1, fp));
+    ASSERT_EQ(0, fclose(fp));
+
+    errno = 0;
+    ASSERT_EQ(NULL, SmolRTSP_PacketizedFile_open(path));
+    ASSERT_EQ(EBADMSG, errno);
+
+    // Truncated.
+    const uint8_t garbage[] = {'S', 'R', 'T', 'S', 'P'};
+    CHECK_CALL(write_file(path, garbage, sizeof garbage));
+    errno = 0;
+    ASSERT_EQ(NULL, SmolRTSP_PacketizedFile_open(path));
+    ASSERT_EQ(EBADMSG, errno);
+
+    remove(path);
+    PASS();
+}
+
+SUITE(packetized_file) {
+    RUN_TEST(write_and_open);
+    RUN_TEST(send_packets);
+    RUN_TEST(open_malformed);
+}
@@ -0,0 +1,127 @@
+#include <smolrtsp/param_set_cache.h>
+
+#include <greatest.h>
+
+#include <stdint.h>
+#include <string.h>
+
+static SmolRTSP_NalUnit h264_nalu(uint8_t unit_type, U8Slice99 payload) {
+    return (SmolRTSP_NalUnit){
+        SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+            .forbidden_zero_bit = false,
+            .ref_idc = 0b11,
+            .unit_type = unit_type,
+        }),
+        payload,
+    };
+}
+
+static SmolRTSP_NalUnit h265_nalu(uint8_t unit_type, U8Slice99 payload) {
+    return (SmolRTSP_NalUnit){
+        SmolRTSP_NalHeader_H265((SmolRTSP_H265NalHeader){
+            .forbidden_zero_bit = false,
+            .unit_type = unit_type,
+            .nuh_layer_id = 0,
+            .nuh_temporal_id_plus1 = 1,
+        }),
+        payload,
+    };
+}
+
+TEST h264(void) {
+    uint8_t sps[] = {0x42, 0xC0, 0x1E}, pps[] = {0xCE, 0x3C, 0x80};
+
+    SmolRTSP_ParamSetCache *cache = SmolRTSP_ParamSetCache_new();
+    ASSERT(!SmolRTSP_ParamSetCache_is_complete(cache));
+    ASSERT_EQ(NULL, SmolRTSP_ParamSetCache_sprop(cache));
+
+    ASSERT_EQ(
+        0, SmolRTSP_ParamSetCache_update(
+               cache, h264_nalu(
+                          SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+                          U8Slice99_new(sps, sizeof sps))));
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h264_nalu(
+                          SMOLRTSP_H264_NAL_UNIT_SPS,
+                          U8Slice99_new(sps, sizeof sps))));
+    ASSERT(!SmolRTSP_ParamSetCache_is_complete(cache));
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h264_nalu(
+                          SMOLRTSP_H264_NAL_UNIT_PPS,
+                          U8Slice99_new(pps, sizeof pps))));
+    ASSERT(SmolRTSP_ParamSetCache_is_complete(cache));
+    ASSERT_EQ(2, SmolRTSP_ParamSetCache_version(cache));
+
+    const U8Slice99 cached_sps = SmolRTSP_ParamSetCache_sps(cache);
+    ASSERT_EQ(4, cached_sps.len);
+    ASSERT_EQ(0x67, cached_sps.ptr[0]);
+    ASSERT_MEM_EQ(sps, cached_sps.ptr + 1, sizeof sps);
+    ASSERT(U8Slice99_is_empty(SmolRTSP_ParamSetCache_vps(cache)));
+
+    ASSERT_STR_EQ(
+        "sprop-parameter-sets=Z0LAHg==,aM48gA==",
+        SmolRTSP_ParamSetCache_sprop(cache));
+
+    // The same bytes do not change the cache.
+    const char *sprop = SmolRTSP_ParamSetCache_sprop(cache);
+    ASSERT_EQ(
+        0, SmolRTSP_ParamSetCache_update(
+               cache, h264_nalu(
+                          SMOLRTSP_H264_NAL_UNIT_SPS,
+                          U8Slice99_new(sps, sizeof sps))));
+    ASSERT_EQ(sprop, SmolRTSP_ParamSetCache_sprop(cache));
+    ASSERT_EQ(2, SmolRTSP_ParamSetCache_version(cache));
+
+    // A new PPS does.
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h264_nalu(
+                          SMOLRTSP_H264_NAL_UNIT_PPS, U8Slice99_new(pps, 2))));
+    ASSERT_STR_EQ(
+        "sprop-parameter-sets=Z0LAHg==,aM48",
+        SmolRTSP_ParamSetCache_sprop(cache));
+    ASSERT_EQ(3, SmolRTSP_ParamSetCache_version(cache));
+
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+    PASS();
+}
+
+TEST h265(void) {
+    uint8_t data[] = {0x0C};
+
+    SmolRTSP_ParamSetCache *cache = SmolRTSP_ParamSetCache_new();
+
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h265_nalu(
+                          SMOLRTSP_H265_NAL_UNIT_SPS_NUT,
+                          U8Slice99_new(data, sizeof data))));
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h265_nalu(
+                          SMOLRTSP_H265_NAL_UNIT_PPS_NUT,
+                          U8Slice99_new(data, sizeof data))));
+
+    // H.265 needs a VPS as well.
+    ASSERT(!SmolRTSP_ParamSetCache_is_complete(cache));
+    ASSERT_EQ(
+        1, SmolRTSP_ParamSetCache_update(
+               cache, h265_nalu(
+                          SMOLRTSP_H265_NAL_UNIT_VPS_NUT,
+                          U8Slice99_new(data, sizeof data))));
+    ASSERT(SmolRTSP_ParamSetCache_is_complete(cache));
+
+    ASSERT_STR_EQ(
+        "sprop-vps=QAEM;sprop-sps=QgEM;sprop-pps=RAEM",
+        SmolRTSP_ParamSetCache_sprop(cache));
+
+    VTABLE(SmolRTSP_ParamSetCache, SmolRTSP_Droppable).drop(cache);
+    PASS();
+}
+
+SUITE(param_set_cache) {
+    RUN_TEST(h264);
+    RUN_TEST(h265);
+}
@@ -0,0 +1,67 @@
+#include <smolrtsp/rtp_clock.h>
+
+#include <greatest.h>
+
+#include <stdint.h>
+
+TEST timestamp_video(void) {
+    const SmolRTSP_RtpClock clock = SmolRTSP_RtpClock_new(90000);
+
+    ASSERT_EQ(0, SmolRTSP_RtpClock_timestamp(&clock, 0));
+    ASSERT_EQ(90000, SmolRTSP_RtpClock_timestamp(&clock, 1000000));
+    ASSERT_EQ(3002, SmolRTSP_RtpClock_timestamp(&clock, 33366));
+    ASSERT_EQ(3003, SmolRTSP_RtpClock_timestamp(&clock, 33367));
+
+    PASS();
+}
+
+TEST timestamp_audio(void) {
+    const SmolRTSP_RtpClock clock = SmolRTSP_RtpClock_new(44100);
+
+    // These are not representable with a kHz-granular clock rate.
+    ASSERT_EQ(44100, SmolRTSP_RtpClock_timestamp(&clock, 1000000));
+    ASSERT_EQ(1024, SmolRTSP_RtpClock_timestamp(&clock, 23220));
+    ASSERT_EQ(22050, SmolRTSP_RtpClock_timestamp(&clock, 500000));
+
+    // No overflow for Unix time in microseconds.
+    const uint64_t unix_us = UINT64_C(1700000000) * 1000000 + 250000;
+    ASSERT_EQ(
+        (uint32_t)(UINT64_C(1700000000) * 44100 + 11025),
+        SmolRTSP_RtpClock_timestamp(&clock, unix_us));
+
+    PASS();
+}
+
+TEST timestamp_with_epoch(void) {
+    const SmolRTSP_RtpClock clock =
+        SmolRTSP_RtpClock_with_epoch(8000, 5000000, UINT32_MAX - 7, 0);
+
+    ASSERT_EQ(UINT32_MAX - 7, SmolRTSP_RtpClock_timestamp(&clock, 5000000));
+    // Wraps around.
+    ASSERT_EQ(0, SmolRTSP_RtpClock_timestamp(&clock, 5001000));
+    ASSERT_EQ(UINT32_MAX - 15, SmolRTSP_RtpClock_timestamp(&clock, 4999000));
+
+    PASS();
+}
+
+TEST ntp_timestamp(void) {
+    ASSERT_EQ(SMOLRTSP_NTP_UNIX_EPOCH_DIFF << 32, smolrtsp_ntp_timestamp(0));
+    ASSERT_EQ(
+        ((SMOLRTSP_NTP_UNIX_EPOCH_DIFF + 1) << 32) | UINT32_C(0x80000000),
+        smolrtsp_ntp_timestamp(1500000));
+
+    const SmolRTSP_RtpClock clock = SmolRTSP_RtpClock_with_epoch(
+        90000, 1000, 0, UINT64_C(1700000000) * 1000000);
+    ASSERT_EQ(
+        (UINT64_C(1700000000) + SMOLRTSP_NTP_UNIX_EPOCH_DIFF + 2) << 32,
+        SmolRTSP_RtpClock_ntp_timestamp(&clock, 2001000));
+
+    PASS();
+}
+
+SUITE(rtp_clock) {
+    RUN_TEST(timestamp_video);
+    RUN_TEST(timestamp_audio);
+    RUN_TEST(timestamp_with_epoch);
+    RUN_TEST(ntp_timestamp);
+}
@@ -0,0 +1,322 @@
+#include <smolrtsp/rtp_depacketizer.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+// Writes an RTP packet with the sequence number `seq_num` and `payload` to
+// `buffer`.
+static U8Slice99 make_packet(
+    uint8_t *buffer, uint16_t seq_num, const uint8_t *payload, size_t len) {
+    const uint8_t header[RTP_HEADER_SIZE] = {
+        0x80, 96, (uint8_t)(seq_num >> 8), (uint8_t)seq_num, 0, 0, 0x0B, 0xB8,
+        0x11, 0x22, 0x33, 0x44,
+    };
+    memcpy(buffer, header, sizeof header);
+    memcpy(buffer + sizeof header, payload, len);
+
+    return U8Slice99_new(buffer, sizeof header + len);
+}
+
+TEST h264_single_and_stap_a(void) {
+    SmolRTSP_RtpDepacketizer *d =
+        SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec_H264, 1024);
+    ASSERT(d);
+
+    uint8_t buffer[64];
+    SmolRTSP_RtpHeader header;
+    SmolRTSP_NalUnit nalu;
+
+    const uint8_t single[] = {0x65, 0x01, 0x02, 0x03};
+    U8Slice99 packet = make_packet(buffer, 1, single, sizeof single);
+    ASSERT_EQ(0, SmolRTSP_RtpDepacketizer_feed(d, packet, &header));
+    ASSERT_EQ(3000, ntohl(header.timestamp));
+
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT_EQ(3, nalu.payload.len);
+    // The NAL unit is not copied.
+    ASSERT_EQ(packet.ptr + RTP_HEADER_SIZE + 1, nalu.payload.ptr);
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    // STAP-A with SPS and PPS.
+    const uint8_t stap_a[] = {
+        0x78, 0, 2, 0x67, 0xAA, 0, 3, 0x68, 0xBB, 0xCC,
+    };
+    packet = make_packet(buffer, 2, stap_a, sizeof stap_a);
+    ASSERT_EQ(0, SmolRTSP_RtpDepacketizer_feed(d, packet, &header));
+
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_SPS, SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT_MEM_EQ(((const uint8_t[]){0xAA}), nalu.payload.ptr, 1);
+    ASSERT_EQ(packet.ptr + RTP_HEADER_SIZE + 4, nalu.payload.ptr);
+
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_PPS, SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT_EQ(2, nalu.payload.len);
+    ASSERT_MEM_EQ(((const uint8_t[]){0xBB, 0xCC}), nalu.payload.ptr, 2);
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    const SmolRTSP_RtpDepacketizerStats stats =
+        SmolRTSP_RtpDepacketizer_stats(d);
+    ASSERT_EQ(3, stats.nalus);
+    ASSERT_EQ(0, stats.reassembled_nalus);
+    ASSERT_EQ(0, stats.lost_packets);
+    ASSERT_EQ(0, stats.discarded_packets);
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable).drop(d);
+    PASS();
+}
+
+TEST h264_fu_a(void) {
+    SmolRTSP_RtpDepacketizer *d =
+        SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec_H264, 1024);
+    ASSERT(d);
+
+    // An IDR slice (NRI=3) in three fragments.
+    const uint8_t fragments[][4] = {
+        {0x7C, 0x85, 0x01, 0x02},
+        {0x7C, 0x05, 0x03, 0x04},
+        {0x7C, 0x45, 0x05, 0x06},
+    };
+
+    uint8_t buffer[64];
+    SmolRTSP_RtpHeader header;
+    SmolRTSP_NalUnit nalu;
+
+    for (size_t i = 0; i < 3; i++) {
+        const U8Slice99 packet = make_packet(
+            buffer, (uint16_t)(0xFFFF + i), fragments[i], sizeof fragments[i]);
+        ASSERT_EQ(0, SmolRTSP_RtpDepacketizer_feed(d, packet, &header));
+        if (i < 2) {
+            ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+        }
+    }
+
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+    match(nalu.header) {
+        of(SmolRTSP_NalHeader_H264, h264) {
+            ASSERT_EQ(0b11, h264->ref_idc);
+        }
+        otherwise FAIL();
+    }
+    ASSERT_EQ(6, nalu.payload.len);
+    ASSERT_MEM_EQ(
+        ((const uint8_t[]){0x01, 0x02, 0x03, 0x04, 0x05, 0x06}),
+        nalu.payload.ptr, 6);
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    const SmolRTSP_RtpDepacketizerStats stats =
+        SmolRTSP_RtpDepacketizer_stats(d);
+    ASSERT_EQ(1, stats.nalus);
+    ASSERT_EQ(1, stats.reassembled_nalus);
+    ASSERT_EQ(0, stats.lost_packets);
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable).drop(d);
+    PASS();
+}
+
+TEST fragment_loss(void) {
+    SmolRTSP_RtpDepacketizer *d =
+        SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec_H264, 8);
+    ASSERT(d);
+
+    uint8_t buffer[64];
+    SmolRTSP_RtpHeader header;
+    SmolRTSP_NalUnit nalu;
+
+    const uint8_t start[] = {0x7C, 0x85, 0x01}, end[] = {0x7C, 0x45, 0x03},
+                  single[] = {0x41, 0x07};
+
+    // The middle fragment (11) is lost.
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 10, start, sizeof start), &header));
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 12, end, sizeof end), &header));
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    // A late packet is discarded.
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 11, single, sizeof single), &header));
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 13, single, sizeof single), &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+
+    // A fragmented NAL unit of 9 bytes exceeds the buffer.
+    const uint8_t big_start[] = {0x7C, 0x85, 1, 2, 3, 4},
+                  big_end[] = {0x7C, 0x45, 5, 6, 7, 8};
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 14, big_start, sizeof big_start),
+               &header));
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 15, big_end, sizeof big_end), &header));
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    const SmolRTSP_RtpDepacketizerStats stats =
+        SmolRTSP_RtpDepacketizer_stats(d);
+    ASSERT_EQ(1, stats.nalus);
+    ASSERT_EQ(0, stats.reassembled_nalus);
+    ASSERT_EQ(1, stats.lost_packets);
+    // The abandoned start, the orphaned end, the late packet, and both
+    // fragments of the large NAL unit.
+    ASSERT_EQ(5, stats.discarded_packets);
+
+    errno = 0;
+    const uint8_t not_rtp[] = {0x40, 96, 0, 1};
+    ASSERT_EQ(
+        -1, SmolRTSP_RtpDepacketizer_feed(
+                d, U8Slice99_new((uint8_t *)not_rtp, sizeof not_rtp),
+                &header));
+    ASSERT_EQ(EBADMSG, errno);
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable).drop(d);
+    PASS();
+}
+
+TEST restart(void) {
+    SmolRTSP_RtpDepacketizer *d =
+        SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec_H264, 1024);
+    ASSERT(d);
+
+    uint8_t buffer[64];
+    SmolRTSP_RtpHeader header;
+    SmolRTSP_NalUnit nalu;
+
+    const uint8_t single[] = {0x41, 0x07};
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 2000, single, sizeof single), &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    // The sequence jumps backwards by 1000: a few packets are taken for late
+    // ones, then the output resumes.
+    size_t emitted = 0;
+    for (uint16_t seq_num = 1000; seq_num < 1016; seq_num++) {
+        ASSERT_EQ(
+            0, SmolRTSP_RtpDepacketizer_feed(
+                   d, make_packet(buffer, seq_num, single, sizeof single),
+                   &header));
+        if (SmolRTSP_RtpDepacketizer_next(d, &nalu)) {
+            emitted++;
+        } else {
+            ASSERT_EQ(0, emitted);
+        }
+    }
+    ASSERT_EQ(9, emitted);
+
+    // A new SSRC is followed at once, whatever its sequence numbers.
+    U8Slice99 packet = make_packet(buffer, 5, single, sizeof single);
+    packet.ptr[8] = 0x55;
+    ASSERT_EQ(0, SmolRTSP_RtpDepacketizer_feed(d, packet, &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    packet = make_packet(buffer, 7, single, sizeof single);
+    packet.ptr[8] = 0x55;
+    ASSERT_EQ(0, SmolRTSP_RtpDepacketizer_feed(d, packet, &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    const SmolRTSP_RtpDepacketizerStats stats =
+        SmolRTSP_RtpDepacketizer_stats(d);
+    ASSERT_EQ(1 + 9 + 2, stats.nalus);
+    ASSERT_EQ(7, stats.discarded_packets);
+    // Only the packet 6 of the new SSRC, not the jumps.
+    ASSERT_EQ(1, stats.lost_packets);
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable).drop(d);
+    PASS();
+}
+
+#ifndef SMOLRTSP_NO_H265
+
+TEST h265_ap_and_fu(void) {
+    SmolRTSP_RtpDepacketizer *d =
+        SmolRTSP_RtpDepacketizer_new(SmolRTSP_NalCodec_H265, 1024);
+    ASSERT(d);
+
+    uint8_t buffer[64];
+    SmolRTSP_RtpHeader header;
+    SmolRTSP_NalUnit nalu;
+
+    // AP with VPS and SPS.
+    const uint8_t ap[] = {
+        0x60, 0x01, 0, 3, 0x40, 0x01, 0xAA, 0, 4, 0x42, 0x01, 0xBB, 0xCC,
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 1, ap, sizeof ap), &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H265_NAL_UNIT_VPS_NUT,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT_EQ(1, nalu.payload.len);
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H265_NAL_UNIT_SPS_NUT,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+    ASSERT_EQ(2, nalu.payload.len);
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    // An IDR_W_RADL picture in two fragments.
+    const uint8_t start[] = {0x62, 0x01, 0x93, 0x01, 0x02},
+                  end[] = {0x62, 0x01, 0x53, 0x03};
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 2, start, sizeof start), &header));
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        0, SmolRTSP_RtpDepacketizer_feed(
+               d, make_packet(buffer, 3, end, sizeof end), &header));
+    ASSERT(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+    ASSERT_EQ(
+        SMOLRTSP_H265_NAL_UNIT_IDR_W_RADL,
+        SmolRTSP_NalHeader_unit_type(nalu.header));
+    match(nalu.header) {
+        of(SmolRTSP_NalHeader_H265, h265) {
+            ASSERT_EQ(1, h265->nuh_temporal_id_plus1);
+        }
+        otherwise FAIL();
+    }
+    ASSERT_EQ(3, nalu.payload.len);
+    ASSERT_MEM_EQ(((const uint8_t[]){0x01, 0x02, 0x03}), nalu.payload.ptr, 3);
+    ASSERT_FALSE(SmolRTSP_RtpDepacketizer_next(d, &nalu));
+
+    VTABLE(SmolRTSP_RtpDepacketizer, SmolRTSP_Droppable).drop(d);
+    PASS();
+}
+
+#endif
+
+SUITE(rtp_depacketizer) {
+    RUN_TEST(h264_single_and_stap_a);
+    RUN_TEST(h264_fu_a);
+    RUN_TEST(fragment_loss);
+    RUN_TEST(restart);
+#ifndef SMOLRTSP_NO_H265
+    RUN_TEST(h265_ap_and_fu);
+#endif
+}
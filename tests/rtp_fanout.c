@@ -0,0 +1,207 @@
+#include <smolrtsp/rtp_fanout.h>
+
+#include "fake_transport.h"
+#include <greatest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+#define SUBSCRIBERS_COUNT 3
+
+static const SmolRTSP_H264NalHeader h264_idr_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b11,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+};
+
+static uint32_t read_u32(const uint8_t data[restrict]) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+           ((uint32_t)data[2] << 8) | data[3];
+}
+
+TEST fanout_to_subscribers(void) {
+    enum { max_size = 100, fragments_count = 5 };
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.max_h264_nalu_size = max_size;
+    SmolRTSP_RtpFanout *fanout = SmolRTSP_RtpFanout_new(90000, config);
+
+    int fds[SUBSCRIBERS_COUNT][2];
+    SmolRTSP_RtpTransport *subs[SUBSCRIBERS_COUNT];
+    for (size_t i = 0; i < SUBSCRIBERS_COUNT; i++) {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]));
+        subs[i] = SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_udp(fds[i][0]), 96, 90000);
+        ASSERT_EQ(
+            0, SmolRTSP_RtpFanout_subscribe(
+                   fanout, subs[i], (uint32_t)i * 1000));
+    }
+    ASSERT_EQ(SUBSCRIBERS_COUNT, SmolRTSP_RtpFanout_subscribers_count(fanout));
+
+    static uint8_t payload[max_size * (fragments_count - 1) + 1];
+    for (size_t i = 0; i < sizeof payload; i++) {
+        payload[i] = (uint8_t)i;
+    }
+
+    const SmolRTSP_NalUnit nalu = {
+        SmolRTSP_NalHeader_H264(h264_idr_header),
+        U8Slice99_new(payload, sizeof payload),
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpFanout_send_packet(
+               fanout, SmolRTSP_RtpTimestamp_Raw(5), nalu));
+
+    uint8_t expected[fragments_count][256];
+    ssize_t expected_len[fragments_count];
+
+    for (size_t i = 0; i < SUBSCRIBERS_COUNT; i++) {
+        for (size_t j = 0; j < fragments_count; j++) {
+            uint8_t packet[256];
+            const ssize_t len = read(fds[i][1], packet, sizeof packet);
+            ASSERT(len > RTP_HEADER_SIZE);
+
+            ASSERT_EQ(j, (size_t)((packet[2] << 8) | packet[3]));
+            ASSERT_EQ(5 + i * 1000, read_u32(packet + 4));
+            ASSERT_EQ(fragments_count - 1 == j, packet[1] >> 7);
+
+            // All the subscribers receive the same payloads.
+            if (0 == i) {
+                memcpy(expected[j], packet, len);
+                expected_len[j] = len;
+            } else {
+                ASSERT_EQ(expected_len[j], len);
+                ASSERT_MEM_EQ(
+                    expected[j] + RTP_HEADER_SIZE, packet + RTP_HEADER_SIZE,
+                    len - RTP_HEADER_SIZE);
+            }
+        }
+    }
+
+    ASSERT(SmolRTSP_RtpFanout_unsubscribe(fanout, subs[1]));
+    ASSERT_FALSE(SmolRTSP_RtpFanout_unsubscribe(fanout, subs[1]));
+    ASSERT_EQ(
+        SUBSCRIBERS_COUNT - 1, SmolRTSP_RtpFanout_subscribers_count(fanout));
+
+    VTABLE(SmolRTSP_RtpFanout, SmolRTSP_Droppable).drop(fanout);
+    for (size_t i = 0; i < SUBSCRIBERS_COUNT; i++) {
+        VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(subs[i]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+
+    PASS();
+}
+
+TEST fanout_without_subscribers(void) {
+    SmolRTSP_RtpFanout *fanout =
+        SmolRTSP_RtpFanout_new(90000, SmolRTSP_NalTransportConfig_default());
+
+    uint8_t payload[10] = {0};
+    const SmolRTSP_NalUnit nalu = {
+        SmolRTSP_NalHeader_H264(h264_idr_header),
+        U8Slice99_new(payload, sizeof payload),
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpFanout_send_packet(
+               fanout, SmolRTSP_RtpTimestamp_Raw(0), nalu));
+
+    VTABLE(SmolRTSP_RtpFanout, SmolRTSP_Droppable).drop(fanout);
+    PASS();
+}
+
+TEST relay(void) {
+    enum { max_size = 100, narrow_size = 50, nalu_size = 80 };
+
+    SmolRTSP_NalTransportConfig config = SmolRTSP_NalTransportConfig_default();
+    config.max_h264_nalu_size = max_size;
+    SmolRTSP_RtpFanout *fanout = SmolRTSP_RtpFanout_new(90000, config);
+
+    // Takes the packets as they are.
+    FakeTransport wide = {.max_packet_size = 0};
+    SmolRTSP_RtpTransport *wide_sub = SmolRTSP_RtpTransport_new(
+        DYN(FakeTransport, SmolRTSP_Transport, &wide), 96, 90000);
+    ASSERT_EQ(0, SmolRTSP_RtpFanout_subscribe(fanout, wide_sub, 0));
+
+    // Needs the NAL units split into smaller fragments.
+    FakeTransport narrow = {.max_packet_size = RTP_HEADER_SIZE + narrow_size};
+    SmolRTSP_RtpTransport *narrow_sub = SmolRTSP_RtpTransport_new(
+        DYN(FakeTransport, SmolRTSP_Transport, &narrow), 96, 90000);
+    ASSERT_EQ(0, SmolRTSP_RtpFanout_subscribe(fanout, narrow_sub, 1000));
+
+    // A single NAL unit packet: sequence number 500, timestamp 7000, marker.
+    uint8_t packet[RTP_HEADER_SIZE + nalu_size] = {
+        0x80, 0x80 | 97, 0x01, 0xF4, 0x00, 0x00, 0x1B, 0x58,
+        0x12, 0x34, 0x56, 0x78, 0x65,
+    };
+    for (size_t i = RTP_HEADER_SIZE + 1; i < sizeof packet; i++) {
+        packet[i] = (uint8_t)i;
+    }
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpFanout_relay_packet(
+               fanout, SmolRTSP_NalCodec_H264,
+               U8Slice99_new(packet, sizeof packet)));
+
+    ASSERT_EQ(1, wide.packets_count);
+    ASSERT_EQ(sizeof packet, wide.packet_sizes[0]);
+    ASSERT_EQ(0x80 | 96, wide.packets[0][1]);
+    ASSERT_EQ(0, (wide.packets[0][2] << 8) | wide.packets[0][3]);
+    ASSERT_EQ(7000, read_u32(wide.packets[0] + 4));
+    ASSERT_MEM_EQ(
+        packet + RTP_HEADER_SIZE, wide.packets[0] + RTP_HEADER_SIZE,
+        nalu_size);
+
+    // FU-A packets: the indicator, the FU header, and the fragment.
+    ASSERT_EQ(2, narrow.packets_count);
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT(narrow.packet_sizes[i] <= RTP_HEADER_SIZE + narrow_size);
+        ASSERT_EQ(8000, read_u32(narrow.packets[i] + 4));
+        // FU-A.
+        ASSERT_EQ(28, narrow.packets[i][12] & 0x1F);
+        ASSERT_EQ(1 == i, narrow.packets[i][1] >> 7);
+    }
+    ASSERT_EQ(
+        nalu_size - 1 + 2 * 2,
+        narrow.packet_sizes[0] + narrow.packet_sizes[1] - 2 * RTP_HEADER_SIZE);
+
+    // The packet 501 is lost, and arrives after 502.
+    packet[3] = 0xF6;
+    ASSERT_EQ(
+        0, SmolRTSP_RtpFanout_relay_packet(
+               fanout, SmolRTSP_NalCodec_H264,
+               U8Slice99_new(packet, sizeof packet)));
+    packet[3] = 0xF5;
+    ASSERT_EQ(
+        0, SmolRTSP_RtpFanout_relay_packet(
+               fanout, SmolRTSP_NalCodec_H264,
+               U8Slice99_new(packet, sizeof packet)));
+
+    ASSERT_EQ(2, wide.packets_count);
+    ASSERT_EQ(2, (wide.packets[1][2] << 8) | wide.packets[1][3]);
+    ASSERT_EQ(4, narrow.packets_count);
+
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_RtpFanout_relay_packet(
+                fanout, SmolRTSP_NalCodec_H264, U8Slice99_new(packet, 4)));
+    ASSERT_EQ(EBADMSG, errno);
+
+    VTABLE(SmolRTSP_RtpFanout, SmolRTSP_Droppable).drop(fanout);
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(wide_sub);
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(narrow_sub);
+    PASS();
+}
+
+SUITE(rtp_fanout) {
+    RUN_TEST(fanout_to_subscribers);
+    RUN_TEST(fanout_without_subscribers);
+    RUN_TEST(relay);
+}
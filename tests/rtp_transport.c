@@ -0,0 +1,910 @@
+#include <smolrtsp/rtp_transport.h>
+
+#include <greatest.h>
+
+#include <smolrtsp/types/rtcp.h>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+static SmolRTSP_RtpTransport *new_transport(int fds[2]) {
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0) {
+        return NULL;
+    }
+
+    return SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_udp(fds[0]), 96, 90000);
+}
+
+static uint16_t packet_seq_num(const uint8_t packet[restrict]) {
+    return (uint16_t)((packet[2] << 8) | packet[3]);
+}
+
+static bool packet_marker(const uint8_t packet[restrict]) {
+    return packet[1] >> 7;
+}
+
+static uint32_t packet_ssrc(const uint8_t packet[restrict]) {
+    return (uint32_t)packet[8] << 24 | (uint32_t)packet[9] << 16 |
+           (uint32_t)packet[10] << 8 | packet[11];
+}
+
+static uint64_t fake_time_us;
+
+static uint64_t fake_clock_us(void) {
+    return fake_time_us;
+}
+
+// Ingests a generic NACK of `seq_num` and `bitmask` for `ssrc`.
+static int ingest_nack(
+    SmolRTSP_RtpTransport *t, uint32_t ssrc, uint16_t seq_num,
+    uint16_t bitmask) {
+    const uint8_t nack[] = {
+        0x81,
+        205,
+        0,
+        3,
+        0,
+        0,
+        0,
+        1,
+        (uint8_t)(ssrc >> 24),
+        (uint8_t)(ssrc >> 16),
+        (uint8_t)(ssrc >> 8),
+        (uint8_t)ssrc,
+        (uint8_t)(seq_num >> 8),
+        (uint8_t)seq_num,
+        (uint8_t)(bitmask >> 8),
+        (uint8_t)bitmask,
+    };
+
+    return SmolRTSP_RtpTransport_ingest_rtcp(
+        t, U8Slice99_new((uint8_t *)nack, sizeof nack), 0);
+}
+
+// Sends `count` one-byte packets and returns the SSRC.
+static uint32_t send_packets(SmolRTSP_RtpTransport *t, int fd, size_t count) {
+    uint32_t ssrc = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t payload = (uint8_t)i;
+        const int ret = SmolRTSP_RtpTransport_send_packet(
+            t, SmolRTSP_RtpTimestamp_Raw(1000), true, U8Slice99_empty(),
+            U8Slice99_new((uint8_t *)&payload, 1));
+        assert(0 == ret);
+        (void)ret;
+
+        uint8_t packet[64];
+        const ssize_t len = read(fd, packet, sizeof packet);
+        assert(RTP_HEADER_SIZE + 1 == len);
+        (void)len;
+        ssrc = packet_ssrc(packet);
+    }
+
+    return ssrc;
+}
+
+TEST send_packet(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    const int ret = SmolRTSP_RtpTransport_send_packet(
+        t, SmolRTSP_RtpTimestamp_Raw(0xAABBCCDD), true,
+        U8Slice99_new((uint8_t *)"ab", 2), U8Slice99_new((uint8_t *)"cde", 3));
+    ASSERT_EQ(0, ret);
+
+    uint8_t packet[64];
+    const ssize_t len = read(fds[1], packet, sizeof packet);
+    ASSERT_EQ(RTP_HEADER_SIZE + 5, len);
+
+    ASSERT_EQ(2, packet[0] >> 6);
+    ASSERT(packet_marker(packet));
+    ASSERT_EQ(96, packet[1] & 0x7F);
+    ASSERT_EQ(0, packet_seq_num(packet));
+    ASSERT_MEM_EQ(
+        ((const uint8_t[]){0xAA, 0xBB, 0xCC, 0xDD}), packet + 4, 4);
+    ASSERT_MEM_EQ("abcde", packet + RTP_HEADER_SIZE, 5);
+
+    const SmolRTSP_RtpTransportStats stats = SmolRTSP_RtpTransport_stats(t);
+    ASSERT_EQ(1, stats.packets);
+    ASSERT_EQ(5, stats.payload_bytes);
+    ASSERT_EQ(0, stats.errors);
+    ASSERT_EQ(1, stats.transport.packets);
+    ASSERT_EQ(RTP_HEADER_SIZE + 5, stats.transport.bytes);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST send_batch(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    // More packets than fit into a single internal batch.
+    enum { packets_count = 100 };
+    SmolRTSP_RtpPacket packets[packets_count];
+    uint8_t payloads[packets_count];
+    for (size_t i = 0; i < packets_count; i++) {
+        payloads[i] = (uint8_t)i;
+        packets[i] = (SmolRTSP_RtpPacket){
+            .marker = packets_count - 1 == i,
+            .payload_header = U8Slice99_empty(),
+            .payload = U8Slice99_new(&payloads[i], 1),
+        };
+    }
+
+    const int ret = SmolRTSP_RtpTransport_send_batch(
+        t, SmolRTSP_RtpTimestamp_Raw(123),
+        SmolRTSP_RtpPacketSlice_new(packets, packets_count));
+    ASSERT_EQ(0, ret);
+
+    for (size_t i = 0; i < packets_count; i++) {
+        uint8_t packet[64];
+        const ssize_t len = read(fds[1], packet, sizeof packet);
+        ASSERT_EQ(RTP_HEADER_SIZE + 1, len);
+        ASSERT_EQ(i, packet_seq_num(packet));
+        ASSERT_EQ(packets_count - 1 == i, packet_marker(packet));
+        ASSERT_EQ(i, packet[RTP_HEADER_SIZE]);
+    }
+
+    // The sequence numbers must continue after the batch.
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(123), false, U8Slice99_empty(),
+               U8Slice99_new(payloads, 1)));
+    uint8_t packet[64];
+    ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+    ASSERT_EQ(packets_count, packet_seq_num(packet));
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST header_template_is_not_mutated(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    uint8_t packets[2][64];
+    for (size_t i = 0; i < 2; i++) {
+        const bool marker = 0 == i;
+        ASSERT_EQ(
+            0, SmolRTSP_RtpTransport_send_packet(
+                   t, SmolRTSP_RtpTimestamp_Raw((uint32_t)i), marker,
+                   U8Slice99_empty(), U8Slice99_empty()));
+        ASSERT_EQ(RTP_HEADER_SIZE, read(fds[1], packets[i], 64));
+    }
+
+    ASSERT(packet_marker(packets[0]));
+    ASSERT_FALSE(packet_marker(packets[1]));
+    ASSERT_EQ(1, packet_seq_num(packets[1]));
+    ASSERT_EQ(1, packets[1][7]);
+    // The SSRC stays the same.
+    ASSERT_MEM_EQ(packets[0] + 8, packets[1] + 8, 4);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST sender_report(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    int rtcp_fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, rtcp_fds));
+    const SmolRTSP_Transport rtcp = smolrtsp_transport_udp(rtcp_fds[0]);
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(0), false, U8Slice99_empty(),
+               U8Slice99_new((uint8_t *)"abc", 3)));
+    uint8_t packet[64];
+    ASSERT_EQ(RTP_HEADER_SIZE + 3, read(fds[1], packet, sizeof packet));
+
+    const uint64_t time_us = UINT64_C(1500000);
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_send_sender_report(t, rtcp, time_us));
+
+    uint8_t buffer[64];
+    const ssize_t len = read(rtcp_fds[1], buffer, sizeof buffer);
+    ASSERT_EQ(SMOLRTSP_RTCP_SENDER_REPORT_SIZE, len);
+
+    U8Slice99 input = U8Slice99_new(buffer, (size_t)len);
+    SmolRTSP_RtcpPacket rtcp_packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &rtcp_packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_SR, rtcp_packet.packet_ty);
+
+    const SmolRTSP_RtcpSenderReport report =
+        SmolRTSP_RtcpPacket_sender_report(rtcp_packet);
+    ASSERT_MEM_EQ(packet + 8, buffer + 4, 4);
+    ASSERT_EQ(smolrtsp_ntp_timestamp(time_us), report.ntp_timestamp);
+    ASSERT_EQ(135000, report.rtp_timestamp);
+    ASSERT_EQ(1, report.packet_count);
+    ASSERT_EQ(3, report.octet_count);
+
+    ASSERT_EQ(1, SmolRTSP_RtpTransport_stats(t).rtcp.sender_reports);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    VCALL_SUPER(rtcp, SmolRTSP_Droppable, drop);
+    close(fds[0]);
+    close(fds[1]);
+    close(rtcp_fds[0]);
+    close(rtcp_fds[1]);
+    PASS();
+}
+
+TEST ingest_receiver_report(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(0), false, U8Slice99_empty(),
+               U8Slice99_empty()));
+    uint8_t packet[64];
+    ASSERT_EQ(RTP_HEADER_SIZE, read(fds[1], packet, sizeof packet));
+    const uint32_t ssrc = (uint32_t)packet[8] << 24 |
+                          (uint32_t)packet[9] << 16 |
+                          (uint32_t)packet[10] << 8 | packet[11];
+
+    // The client got our SR at 10s, held it for 0.25s, and its report arrives
+    // at 10.3s, so the RTT is 50ms.
+    const uint64_t sr_us = UINT64_C(10000000), arrival_us = UINT64_C(10300000);
+    const SmolRTSP_RtcpReportBlock blocks[] = {
+        {.ssrc = ssrc + 1, .fraction_lost = 255},
+        {
+            .ssrc = ssrc,
+            .fraction_lost = 26,
+            .cumulative_lost = 12,
+            .extended_highest_seq_num = 1000,
+            .jitter = 900,
+            .last_sr = (uint32_t)(smolrtsp_ntp_timestamp(sr_us) >> 16),
+            .delay_since_last_sr = 65536 / 4,
+        },
+    };
+
+    uint8_t rr[8 + 2 * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE] = {
+        0x82, 201, 0, 13, 0, 0, 0, 1,
+    };
+    for (size_t i = 0; i < 2; i++) {
+        uint8_t *block = rr + 8 + i * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE;
+        ASSERT_EQ(block, SmolRTSP_RtcpReportBlock_serialize(blocks[i], block));
+    }
+
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_ingest_rtcp(
+               t, U8Slice99_new(rr, sizeof rr), arrival_us));
+
+    SmolRTSP_RtcpStats stats = SmolRTSP_RtpTransport_stats(t).rtcp;
+    ASSERT_EQ(1, stats.reports);
+    ASSERT_EQ(26, stats.fraction_lost);
+    ASSERT_EQ(12, stats.cumulative_lost);
+    ASSERT_EQ(1000, stats.extended_highest_seq_num);
+    ASSERT_EQ(900, stats.jitter);
+    ASSERT_EQ(10000, stats.jitter_us);
+    ASSERT(stats.rtt_us >= 49900 && stats.rtt_us <= 50100);
+
+    // A truncated packet is counted and does not change the state.
+    ASSERT_EQ(
+        -1, SmolRTSP_RtpTransport_ingest_rtcp(
+                t, U8Slice99_new(rr, sizeof rr - 4), arrival_us));
+    stats = SmolRTSP_RtpTransport_stats(t).rtcp;
+    ASSERT_EQ(1, stats.malformed);
+    ASSERT_EQ(1, stats.reports);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST retransmit_on_nack(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    fake_time_us = 0;
+    SmolRTSP_RtpRetransmissionConfig config =
+        SmolRTSP_RtpRetransmissionConfig_default();
+    config.clock_us = fake_clock_us;
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_enable_retransmission(t, config));
+
+    const uint32_t ssrc = send_packets(t, fds[1], 4);
+
+    // The packets 1 and 3 are lost.
+    ASSERT_EQ(0, ingest_nack(t, ssrc, 1, 0x2));
+
+    for (uint16_t seq_num = 1; seq_num <= 3; seq_num += 2) {
+        uint8_t packet[64];
+        ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+        ASSERT_EQ(seq_num, packet_seq_num(packet));
+        ASSERT_EQ(ssrc, packet_ssrc(packet));
+        ASSERT_EQ(seq_num, packet[RTP_HEADER_SIZE]);
+    }
+
+    SmolRTSP_RtpTransportStats stats = SmolRTSP_RtpTransport_stats(t);
+    ASSERT_EQ(2, stats.rtcp.nacks);
+    ASSERT_EQ(2, stats.retransmissions);
+    ASSERT_EQ(0, stats.retransmission_misses);
+    ASSERT_EQ(4, stats.packets);
+
+    // Too old to be worth resending.
+    fake_time_us = config.max_age_us + 1;
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_RtpTransport_retransmit(t, 2));
+    ASSERT_EQ(ENOENT, errno);
+
+    // Never sent.
+    fake_time_us = 0;
+    ASSERT_EQ(-1, SmolRTSP_RtpTransport_retransmit(t, 4));
+    ASSERT_EQ(2, SmolRTSP_RtpTransport_stats(t).retransmission_misses);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST retransmit_bounded_by_bytes(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    // Room for three packets of 13 bytes.
+    SmolRTSP_RtpRetransmissionConfig config =
+        SmolRTSP_RtpRetransmissionConfig_default();
+    config.max_bytes = 3 * (RTP_HEADER_SIZE + 1) + 5;
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_enable_retransmission(t, config));
+
+    send_packets(t, fds[1], 10);
+
+    for (uint16_t seq_num = 0; seq_num < 10; seq_num++) {
+        const int ret = SmolRTSP_RtpTransport_retransmit(t, seq_num);
+        ASSERT_EQ(seq_num >= 7 ? 0 : -1, ret);
+        if (0 == ret) {
+            uint8_t packet[64];
+            ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+            ASSERT_EQ(seq_num, packet_seq_num(packet));
+        }
+    }
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST retransmit_rtx(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    SmolRTSP_RtpRetransmissionConfig config =
+        SmolRTSP_RtpRetransmissionConfig_default();
+    config.rtx = true;
+    config.rtx_payload_ty = 97;
+    config.rtx_ssrc = 0x12345678;
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_enable_retransmission(t, config));
+
+    const uint32_t ssrc = send_packets(t, fds[1], 3);
+    ASSERT_EQ(0, ingest_nack(t, ssrc, 1, 0x1));
+
+    uint16_t rtx_seq_num = 0;
+    for (uint16_t seq_num = 1; seq_num <= 2; seq_num++) {
+        uint8_t packet[64];
+        ASSERT_EQ(
+            RTP_HEADER_SIZE + 2 + 1, read(fds[1], packet, sizeof packet));
+        ASSERT(packet_marker(packet));
+        ASSERT_EQ(97, packet[1] & 0x7F);
+        ASSERT_EQ(0x12345678, packet_ssrc(packet));
+        ASSERT_MEM_EQ(((const uint8_t[]){0, 0, 0x03, 0xE8}), packet + 4, 4);
+        if (2 == seq_num) {
+            ASSERT_EQ((uint16_t)(rtx_seq_num + 1), packet_seq_num(packet));
+        }
+        rtx_seq_num = packet_seq_num(packet);
+
+        // The original sequence number precedes the original payload.
+        ASSERT_EQ(seq_num, packet_seq_num(packet + RTP_HEADER_SIZE - 2));
+        ASSERT_EQ(seq_num, packet[RTP_HEADER_SIZE + 2]);
+    }
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST extensions(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    const size_t max_payload_size = SmolRTSP_RtpTransport_max_payload_size(t);
+
+    fake_time_us = 1500000;
+    SmolRTSP_RtpRetransmissionConfig retransmission_config =
+        SmolRTSP_RtpRetransmissionConfig_default();
+    retransmission_config.clock_us = fake_clock_us;
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_enable_retransmission(
+               t, retransmission_config));
+
+    SmolRTSP_RtpExtensionsConfig config =
+        SmolRTSP_RtpExtensionsConfig_default();
+    config.abs_send_time_id = 3;
+    config.transport_wide_cc_id = 5;
+    config.clock_us = fake_clock_us;
+    SmolRTSP_RtpTransport_enable_extensions(t, config);
+
+    // The elements of 1 + 3 and 1 + 2 bytes, padded to 32 bits.
+    const size_t header_size = RTP_HEADER_SIZE + 4 + 8;
+    if (max_payload_size > 1) {
+        ASSERT_EQ(
+            max_payload_size - 12, SmolRTSP_RtpTransport_max_payload_size(t));
+    }
+
+    uint8_t packet[64];
+    for (uint8_t i = 0; i < 2; i++) {
+        ASSERT_EQ(
+            0, SmolRTSP_RtpTransport_send_packet(
+                   t, SmolRTSP_RtpTimestamp_Raw(1000), false, U8Slice99_empty(),
+                   U8Slice99_new(&i, 1)));
+
+        ASSERT_EQ(
+            (ssize_t)(header_size + 1), read(fds[1], packet, sizeof packet));
+        ASSERT(packet[0] & 0x10);
+        ASSERT_EQ(i, packet_seq_num(packet));
+
+        // 1.5 seconds in 6.18 fixed point.
+        const uint8_t expected[] = {
+            0xBE, 0xDE, 0, 2, 0x32, 0x06, 0, 0, 0x51, 0, i, 0,
+        };
+        ASSERT_MEM_EQ(expected, packet + RTP_HEADER_SIZE, sizeof expected);
+        ASSERT_EQ(i, packet[header_size]);
+    }
+
+    // A retransmission is a new transmission for congestion control.
+    fake_time_us = 2000000;
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_retransmit(t, 0));
+    ASSERT_EQ(
+        (ssize_t)(header_size + 1), read(fds[1], packet, sizeof packet));
+    ASSERT_EQ(0, packet_seq_num(packet));
+    ASSERT_MEM_EQ(
+        ((const uint8_t[]){0x32, 0x08, 0, 0, 0x51, 0, 2}),
+        packet + RTP_HEADER_SIZE + 4, 7);
+    ASSERT_EQ(0, packet[header_size]);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST abs_send_time_wall_clock(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    // 1.5 seconds past a multiple of 64 seconds since the epoch.
+    fake_time_us = UINT64_C(1700000000000000) + 1500000;
+    SmolRTSP_RtpExtensionsConfig config =
+        SmolRTSP_RtpExtensionsConfig_default();
+    config.abs_send_time_id = 3;
+    config.clock_us = fake_clock_us;
+    SmolRTSP_RtpTransport_enable_extensions(t, config);
+
+    uint8_t payload = 0;
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(1000), false, U8Slice99_empty(),
+               U8Slice99_new(&payload, 1)));
+
+    uint8_t packet[64];
+    ASSERT_EQ(
+        (ssize_t)(RTP_HEADER_SIZE + 4 + 4 + 1),
+        read(fds[1], packet, sizeof packet));
+    ASSERT_MEM_EQ(
+        ((const uint8_t[]){0xBE, 0xDE, 0, 1, 0x32, 0x06, 0, 0}),
+        packet + RTP_HEADER_SIZE, 8);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST extensions_two_byte(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    // The shared counter of another stream of the same transport.
+    uint16_t transport_wide_seq_num = 0xFFFF;
+
+    SmolRTSP_RtpExtensionsConfig config =
+        SmolRTSP_RtpExtensionsConfig_default();
+    config.transport_wide_cc_id = 15;
+    config.transport_wide_seq_num = &transport_wide_seq_num;
+    SmolRTSP_RtpTransport_enable_extensions(t, config);
+
+    const uint8_t payload = 0xAB;
+    SmolRTSP_RtpPacket packets[] = {
+        {.marker = false,
+         .payload_header = U8Slice99_empty(),
+         .payload = U8Slice99_new((uint8_t *)&payload, 1)},
+        {.marker = true,
+         .payload_header = U8Slice99_empty(),
+         .payload = U8Slice99_new((uint8_t *)&payload, 1)},
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_batch(
+               t, SmolRTSP_RtpTimestamp_Raw(1000),
+               (SmolRTSP_RtpPacketSlice)Slice99_typed_from_array(packets)));
+
+    // The element of 2 + 2 bytes.
+    const size_t header_size = RTP_HEADER_SIZE + 4 + 4;
+    for (uint16_t i = 0; i < 2; i++) {
+        uint8_t packet[64];
+        ASSERT_EQ(
+            (ssize_t)(header_size + 1), read(fds[1], packet, sizeof packet));
+        ASSERT(packet[0] & 0x10);
+
+        const uint16_t seq_num = (uint16_t)(0xFFFF + i);
+        const uint8_t expected[] = {
+            0x10, 0, 0, 1, 15, 2, (uint8_t)(seq_num >> 8), (uint8_t)seq_num,
+        };
+        ASSERT_MEM_EQ(expected, packet + RTP_HEADER_SIZE, sizeof expected);
+        ASSERT_EQ(payload, packet[header_size]);
+    }
+    ASSERT_EQ(1, transport_wide_seq_num);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST extensions_sdp(void) {
+    SmolRTSP_RtpExtensionsConfig config =
+        SmolRTSP_RtpExtensionsConfig_default();
+    config.abs_send_time_id = 3;
+    config.transport_wide_cc_id = 5;
+
+    char buffer[256] = {0};
+    const ssize_t ret = SmolRTSP_RtpExtensionsConfig_sdp(
+        config, smolrtsp_string_writer(buffer));
+
+    const char *expected =
+        "a=extmap:3 " SMOLRTSP_RTP_EXT_ABS_SEND_TIME_URI "\r\n"
+        "a=extmap:5 " SMOLRTSP_RTP_EXT_TRANSPORT_WIDE_CC_URI "\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    PASS();
+}
+
+TEST bandwidth_estimation(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    SmolRTSP_BandwidthEstimator *e = SmolRTSP_BandwidthEstimator_new(
+        SmolRTSP_BandwidthEstimatorConfig_default());
+    ASSERT(e);
+
+    SmolRTSP_RtpExtensionsConfig config =
+        SmolRTSP_RtpExtensionsConfig_default();
+    config.transport_wide_cc_id = 5;
+    SmolRTSP_RtpTransport_enable_extensions(t, config);
+    SmolRTSP_RtpTransport_set_bandwidth_estimator(t, e);
+
+    for (uint8_t i = 0; i < 2; i++) {
+        ASSERT_EQ(
+            0, SmolRTSP_RtpTransport_send_packet(
+                   t, SmolRTSP_RtpTimestamp_Raw(1000), false, U8Slice99_empty(),
+                   U8Slice99_new(&i, 1)));
+        uint8_t packet[64];
+        ASSERT(read(fds[1], packet, sizeof packet) > 0);
+    }
+
+    // Both packets have arrived 1 ms apart.
+    const uint8_t feedback[] = {
+        0x8F, 205,  0,    5, 0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB, 0xCC, 0xDD,
+        0,    0,    0,    2, 0,    0,    0,    0,    0x20, 0x02, 4,    4,
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_ingest_rtcp(
+               t, U8Slice99_new((uint8_t *)feedback, sizeof feedback), 0));
+
+    const SmolRTSP_BandwidthEstimatorStats stats =
+        SmolRTSP_BandwidthEstimator_stats(e);
+    ASSERT_EQ(1, stats.feedbacks);
+    ASSERT_EQ(2, stats.packets_acked);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    VTABLE(SmolRTSP_BandwidthEstimator, SmolRTSP_Droppable).drop(e);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST new_udp(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    // The RTP and UDP transports in a single allocation.
+    SmolRTSP_RtpTransport *t = SmolRTSP_RtpTransport_new_udp(
+        fds[0], SmolRTSP_UdpTransportConfig_default(), 96, 90000);
+    ASSERT(t);
+
+    uint8_t payloads[3] = {1, 2, 3};
+    SmolRTSP_RtpPacket packets[3];
+    for (size_t i = 0; i < 3; i++) {
+        packets[i] = (SmolRTSP_RtpPacket){
+            .marker = 2 == i,
+            .payload_header = U8Slice99_empty(),
+            .payload = U8Slice99_new(&payloads[i], 1),
+        };
+    }
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_batch(
+               t, SmolRTSP_RtpTimestamp_Raw(0),
+               SmolRTSP_RtpPacketSlice_new(packets, 3)));
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_packet(
+               t, SmolRTSP_RtpTimestamp_Raw(0), true, U8Slice99_empty(),
+               U8Slice99_new(payloads, 1)));
+
+    for (size_t i = 0; i < 4; i++) {
+        uint8_t packet[64];
+        ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+        ASSERT_EQ(i, packet_seq_num(packet));
+    }
+
+    const SmolRTSP_RtpTransportStats stats = SmolRTSP_RtpTransport_stats(t);
+    ASSERT_EQ(4, stats.packets);
+    ASSERT_EQ(4, stats.transport.packets);
+    ASSERT_EQ(4 * (RTP_HEADER_SIZE + 1), stats.transport.bytes);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+// Reads a packet of `payload_len` bytes and returns its timestamp.
+static uint32_t read_audio_packet(int fd, size_t payload_len) {
+    uint8_t packet[RTP_HEADER_SIZE + 1024];
+    const ssize_t len = read(fd, packet, sizeof packet);
+    assert((ssize_t)(RTP_HEADER_SIZE + payload_len) == len);
+    (void)len;
+    (void)payload_len;
+
+    return (uint32_t)packet[4] << 24 | (uint32_t)packet[5] << 16 |
+           (uint32_t)packet[6] << 8 | packet[7];
+}
+
+TEST audio_aggregation(void) {
+    enum { frame_size = 160 };
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_RtpTransport *t = SmolRTSP_RtpTransport_new(
+        smolrtsp_transport_udp(fds[0]), 0, 8000);
+    ASSERT(t);
+
+    // 20 ms G.711 frames into 60 ms packets.
+    SmolRTSP_RtpAudioAggregationConfig config =
+        SmolRTSP_RtpAudioAggregationConfig_default();
+    config.ptime_ms = 60;
+    config.maxptime_ms = 60;
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_enable_audio_aggregation(t, config));
+
+    uint8_t frame[frame_size];
+    memset(frame, 0xD5, sizeof frame);
+
+    for (uint32_t i = 0; i < 6; i++) {
+        ASSERT_EQ(
+            0, SmolRTSP_RtpTransport_send_audio_frame(
+                   t, SmolRTSP_RtpTimestamp_Raw(1000 + i * frame_size),
+                   U8Slice99_new(frame, frame_size), frame_size));
+    }
+    ASSERT_EQ(1000, read_audio_packet(fds[1], 3 * frame_size));
+    ASSERT_EQ(1000 + 3 * frame_size, read_audio_packet(fds[1], 3 * frame_size));
+    ASSERT_EQ(2, SmolRTSP_RtpTransport_stats(t).packets);
+
+    // A gap (e.g., silence suppression) sends the queued frames first.
+    const uint32_t after_gap = 1000 + 10 * frame_size;
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_audio_frame(
+               t, SmolRTSP_RtpTimestamp_Raw(1000 + 6 * frame_size),
+               U8Slice99_new(frame, frame_size), frame_size));
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_audio_frame(
+               t, SmolRTSP_RtpTimestamp_Raw(after_gap),
+               U8Slice99_new(frame, frame_size), frame_size));
+    ASSERT_EQ(1000 + 6 * frame_size, read_audio_packet(fds[1], frame_size));
+
+    // A longer frame would exceed the maxptime.
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_audio_frame(
+               t, SmolRTSP_RtpTimestamp_Raw(after_gap + frame_size),
+               U8Slice99_new(frame, frame_size), 3 * frame_size));
+    ASSERT_EQ(after_gap, read_audio_packet(fds[1], frame_size));
+    ASSERT_EQ(after_gap + frame_size, read_audio_packet(fds[1], frame_size));
+
+    // The end of the stream.
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_send_audio_frame(
+               t, SmolRTSP_RtpTimestamp_Raw(after_gap + 4 * frame_size),
+               U8Slice99_new(frame, frame_size), frame_size));
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_flush_audio(t));
+    ASSERT_EQ(
+        after_gap + 4 * frame_size, read_audio_packet(fds[1], frame_size));
+    ASSERT_EQ(0, SmolRTSP_RtpTransport_flush_audio(t));
+    ASSERT_EQ(6, SmolRTSP_RtpTransport_stats(t).packets);
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST audio_aggregation_sdp(void) {
+    char buffer[256] = {0};
+    const ssize_t ret = SmolRTSP_RtpAudioAggregationConfig_sdp(
+        SmolRTSP_RtpAudioAggregationConfig_default(),
+        smolrtsp_string_writer(buffer));
+
+    const char *expected = "a=ptime:60\r\na=maxptime:120\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    PASS();
+}
+
+#define PRODUCERS_COUNT      3
+#define PRODUCER_ITERATIONS  100
+#define PRODUCER_BATCH_SIZE  3
+#define PRODUCED_PACKETS_LEN \
+    (PRODUCERS_COUNT * PRODUCER_ITERATIONS * PRODUCER_BATCH_SIZE)
+
+typedef struct {
+    SmolRTSP_RtpTransport *t;
+    uint8_t id;
+    bool ok;
+} RtpProducer;
+
+// Sends the packets of the producer ID as batches or, for the last producer,
+// one by one.
+static void *rtp_producer_routine(void *arg) {
+    RtpProducer *producer = arg;
+
+    SmolRTSP_RtpPacket packets[PRODUCER_BATCH_SIZE];
+    for (size_t i = 0; i < PRODUCER_BATCH_SIZE; i++) {
+        packets[i] = (SmolRTSP_RtpPacket){
+            .marker = PRODUCER_BATCH_SIZE - 1 == i,
+            .payload_header = U8Slice99_empty(),
+            .payload = U8Slice99_new(&producer->id, 1),
+        };
+    }
+
+    for (size_t i = 0; i < PRODUCER_ITERATIONS; i++) {
+        if (PRODUCERS_COUNT - 1 == producer->id) {
+            for (size_t j = 0; j < PRODUCER_BATCH_SIZE; j++) {
+                if (SmolRTSP_RtpTransport_send_packet(
+                        producer->t, SmolRTSP_RtpTimestamp_Raw(0), false,
+                        packets[j].payload_header, packets[j].payload) != 0) {
+                    producer->ok = false;
+                }
+            }
+        } else if (
+            SmolRTSP_RtpTransport_send_batch(
+                producer->t, SmolRTSP_RtpTimestamp_Raw(0),
+                SmolRTSP_RtpPacketSlice_new(packets, PRODUCER_BATCH_SIZE)) !=
+            0) {
+            producer->ok = false;
+        }
+    }
+
+    return NULL;
+}
+
+TEST thread_safety(void) {
+    int fds[2];
+    SmolRTSP_RtpTransport *t = new_transport(fds);
+    ASSERT(t);
+
+    SmolRTSP_RtpTransport_enable_thread_safety(t);
+    ASSERT_EQ(
+        0, SmolRTSP_RtpTransport_enable_retransmission(
+               t, SmolRTSP_RtpRetransmissionConfig_default()));
+
+    RtpProducer producers[PRODUCERS_COUNT];
+    pthread_t threads[PRODUCERS_COUNT];
+    for (uint8_t i = 0; i < PRODUCERS_COUNT; i++) {
+        producers[i] = (RtpProducer){.t = t, .id = i, .ok = true};
+        ASSERT_EQ(
+            0, pthread_create(
+                   &threads[i], NULL, rtp_producer_routine, &producers[i]));
+    }
+
+    // Every sequence number must be taken exactly once.
+    static uint8_t senders[PRODUCED_PACKETS_LEN];
+    static bool seen[PRODUCED_PACKETS_LEN];
+    memset(seen, 0, sizeof seen);
+    for (size_t i = 0; i < PRODUCED_PACKETS_LEN; i++) {
+        uint8_t packet[64];
+        ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+
+        const uint16_t seq_num = packet_seq_num(packet);
+        ASSERT(seq_num < PRODUCED_PACKETS_LEN);
+        ASSERT_FALSE(seen[seq_num]);
+        seen[seq_num] = true;
+        senders[seq_num] = packet[RTP_HEADER_SIZE];
+    }
+
+    for (size_t i = 0; i < PRODUCERS_COUNT; i++) {
+        ASSERT_EQ(0, pthread_join(threads[i], NULL));
+        ASSERT(producers[i].ok);
+    }
+
+    ASSERT_EQ(PRODUCED_PACKETS_LEN, SmolRTSP_RtpTransport_stats(t).packets);
+
+    // The history has kept all the packets despite the interleaving.
+    const uint16_t resent[] = {
+        0,
+        PRODUCED_PACKETS_LEN / 2,
+        PRODUCED_PACKETS_LEN - 1,
+    };
+    for (size_t i = 0; i < sizeof resent / sizeof resent[0]; i++) {
+        ASSERT_EQ(0, SmolRTSP_RtpTransport_retransmit(t, resent[i]));
+
+        uint8_t packet[64];
+        ASSERT_EQ(RTP_HEADER_SIZE + 1, read(fds[1], packet, sizeof packet));
+        ASSERT_EQ(resent[i], packet_seq_num(packet));
+        ASSERT_EQ(senders[resent[i]], packet[RTP_HEADER_SIZE]);
+    }
+
+    VTABLE(SmolRTSP_RtpTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+SUITE(rtp_transport) {
+    RUN_TEST(send_packet);
+    RUN_TEST(send_batch);
+    RUN_TEST(header_template_is_not_mutated);
+    RUN_TEST(sender_report);
+    RUN_TEST(ingest_receiver_report);
+    RUN_TEST(retransmit_on_nack);
+    RUN_TEST(retransmit_bounded_by_bytes);
+    RUN_TEST(retransmit_rtx);
+    RUN_TEST(extensions);
+    RUN_TEST(abs_send_time_wall_clock);
+    RUN_TEST(extensions_two_byte);
+    RUN_TEST(extensions_sdp);
+    RUN_TEST(bandwidth_estimation);
+    RUN_TEST(new_udp);
+    RUN_TEST(audio_aggregation);
+    RUN_TEST(audio_aggregation_sdp);
+    RUN_TEST(thread_safety);
+}
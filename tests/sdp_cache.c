@@ -0,0 +1,109 @@
+#include <smolrtsp/sdp_cache.h>
+
+#include <smolrtsp/types/sdp.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+static uint64_t key_of(const char *sprop, uint16_t port) {
+    uint64_t key = SMOLRTSP_SDP_KEY_INIT;
+    key = smolrtsp_sdp_key(key, sprop, strlen(sprop));
+    key = smolrtsp_sdp_key(key, &port, sizeof port);
+    return key;
+}
+
+static int render_count;
+
+static enum greatest_test_res
+describe(SmolRTSP_SdpCache *cache, const char *sprop, CharSlice99 *sdp) {
+    const uint64_t key = key_of(sprop, 0);
+
+    if (SmolRTSP_SdpCache_lookup(cache, key, sdp)) {
+        PASS();
+    }
+
+    render_count++;
+
+    SmolRTSP_Writer w = SmolRTSP_SdpCache_begin(cache);
+    ssize_t ret = 0;
+    SMOLRTSP_SDP_DESCRIBE(
+        ret, w, (SMOLRTSP_SDP_VERSION, "0"),
+        (SMOLRTSP_SDP_ATTR, "fmtp:96 %s", sprop));
+    ASSERT(ret > 0);
+
+    const int commit_ret = SmolRTSP_SdpCache_commit(cache, key, sdp);
+    ASSERT_EQ(0, commit_ret);
+
+    PASS();
+}
+
+TEST render_once(void) {
+    char buffer[128];
+    SmolRTSP_SdpCache cache = SmolRTSP_SdpCache_new(buffer, sizeof buffer);
+    CharSlice99 sdp = CharSlice99_empty();
+
+    render_count = 0;
+
+    const char *sprop = "sprop-parameter-sets=Z0IACpZTBYmI,aMljiA==";
+    CHECK_CALL(describe(&cache, sprop, &sdp));
+    CHECK_CALL(describe(&cache, sprop, &sdp));
+    ASSERT_EQ(1, render_count);
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str(
+            "v=0\r\na=fmtp:96 sprop-parameter-sets=Z0IACpZTBYmI,aMljiA==\r\n"),
+        sdp));
+
+    // New parameter sets change the key.
+    CHECK_CALL(describe(&cache, "sprop-parameter-sets=Z0IAH,aMljiA==", &sdp));
+    ASSERT_EQ(2, render_count);
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str(
+            "v=0\r\na=fmtp:96 sprop-parameter-sets=Z0IAH,aMljiA==\r\n"),
+        sdp));
+
+    SmolRTSP_SdpCache_invalidate(&cache);
+    CHECK_CALL(describe(&cache, "sprop-parameter-sets=Z0IAH,aMljiA==", &sdp));
+    ASSERT_EQ(3, render_count);
+
+    PASS();
+}
+
+TEST key(void) {
+    ASSERT(key_of("abc", 554) != key_of("abc", 555));
+    ASSERT(key_of("abc", 554) != key_of("abd", 554));
+    ASSERT_EQ(key_of("abc", 554), key_of("abc", 554));
+    ASSERT_EQ(
+        SMOLRTSP_SDP_KEY_INIT,
+        smolrtsp_sdp_key(SMOLRTSP_SDP_KEY_INIT, NULL, 0));
+
+    PASS();
+}
+
+TEST overflow(void) {
+    char buffer[8];
+    SmolRTSP_SdpCache cache = SmolRTSP_SdpCache_new(buffer, sizeof buffer);
+
+    SmolRTSP_Writer w = SmolRTSP_SdpCache_begin(&cache);
+    ssize_t ret = 0;
+    SMOLRTSP_SDP_DESCRIBE(ret, w, (SMOLRTSP_SDP_SESSION_NAME, "too long"));
+
+    CharSlice99 sdp;
+    errno = 0;
+    const int commit_ret = SmolRTSP_SdpCache_commit(&cache, 1, &sdp);
+    ASSERT_EQ(-1, commit_ret);
+    ASSERT_EQ(ENOBUFS, errno);
+
+    const bool found = SmolRTSP_SdpCache_lookup(&cache, 1, &sdp);
+    ASSERT(!found);
+
+    PASS();
+}
+
+SUITE(sdp_cache) {
+    RUN_TEST(render_once);
+    RUN_TEST(key);
+    RUN_TEST(overflow);
+}
@@ -0,0 +1,204 @@
+#include <smolrtsp/send_workers.h>
+
+#include <smolrtsp/numa.h>
+
+#include <greatest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RTP_HEADER_SIZE 12
+
+static const SmolRTSP_H264NalHeader h264_idr_header = {
+    .forbidden_zero_bit = false,
+    .ref_idc = 0b11,
+    .unit_type = SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR,
+};
+
+TEST send_from_workers(void) {
+    enum { transports_count = 3, nalus_count = 20 };
+
+    SmolRTSP_SendWorkers *workers = SmolRTSP_SendWorkers_new(2);
+
+    int fds[transports_count][2];
+    SmolRTSP_NalTransport *transports[transports_count];
+    SmolRTSP_SendQueue *queues[transports_count];
+
+    for (size_t i = 0; i < transports_count; i++) {
+        const bool socketpair_ok =
+            socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]) == 0;
+        ASSERT(socketpair_ok);
+
+        transports[i] = SmolRTSP_NalTransport_new(SmolRTSP_RtpTransport_new(
+            smolrtsp_transport_udp(fds[i][0]), 96, 90000));
+        queues[i] = SmolRTSP_SendWorkers_attach(
+            workers, transports[i], nalus_count);
+    }
+
+    for (uint8_t n = 0; n < nalus_count; n++) {
+        for (size_t i = 0; i < transports_count; i++) {
+            uint8_t payload[4];
+            memset(payload, n, sizeof payload);
+
+            // The payload is copied, so the buffer can be reused right away.
+            const int ret = SmolRTSP_SendQueue_push(
+                queues[i], SmolRTSP_RtpTimestamp_Raw(n),
+                (SmolRTSP_NalUnit){
+                    SmolRTSP_NalHeader_H264(h264_idr_header),
+                    U8Slice99_new(payload, sizeof payload),
+                });
+            ASSERT_EQ(0, ret);
+        }
+    }
+
+    for (size_t i = 0; i < transports_count; i++) {
+        for (uint8_t n = 0; n < nalus_count; n++) {
+            uint8_t packet[64];
+            const ssize_t len = read(fds[i][1], packet, sizeof packet);
+            ASSERT_EQ(RTP_HEADER_SIZE + 1 + 4, len);
+
+            // The order of NAL units is preserved per transport.
+            ASSERT_EQ(n, (packet[2] << 8) | packet[3]);
+            ASSERT_EQ(n, packet[RTP_HEADER_SIZE + 1]);
+        }
+    }
+
+    for (size_t i = 0; i < transports_count; i++) {
+        ASSERT_EQ(0, SmolRTSP_SendQueue_failures(queues[i]));
+        SmolRTSP_SendWorkers_detach(workers, queues[i]);
+        VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(transports[i]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+
+    VTABLE(SmolRTSP_SendWorkers, SmolRTSP_Droppable).drop(workers);
+    PASS();
+}
+
+TEST push_to_full_queue(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    SmolRTSP_SendWorkers *workers = SmolRTSP_SendWorkers_new(1);
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000));
+
+    // Fill the socket buffer so that the worker gets stuck on the first NAL
+    // unit and cannot drain the queue.
+    const int sndbuf = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+    static uint8_t filler[1024];
+    size_t fillers_count = 0;
+    while (send(fds[0], filler, sizeof filler, MSG_DONTWAIT) > 0) {
+        fillers_count++;
+    }
+
+    SmolRTSP_SendQueue *queue = SmolRTSP_SendWorkers_attach(workers, t, 2);
+
+    const SmolRTSP_NalUnit nalu = {
+        SmolRTSP_NalHeader_H264(h264_idr_header),
+        U8Slice99_new(filler, 16),
+    };
+
+    size_t pushed = 0;
+    int ret = 0;
+    for (int i = 0; i < 8; i++) {
+        ret = SmolRTSP_SendQueue_push(
+            queue, SmolRTSP_RtpTimestamp_Raw(0), nalu);
+        if (-1 == ret) {
+            break;
+        }
+        pushed++;
+    }
+    ASSERT_EQ(-1, ret);
+    ASSERT_EQ(ENOBUFS, errno);
+    ASSERT_EQ(2, pushed);
+
+    // Unblock the worker and receive everything it has sent.
+    for (size_t i = 0; i < fillers_count + pushed; i++) {
+        uint8_t packet[sizeof filler];
+        const ssize_t len = read(fds[1], packet, sizeof packet);
+        ASSERT(len > 0);
+    }
+
+    SmolRTSP_SendWorkers_detach(workers, queue);
+    VTABLE(SmolRTSP_SendWorkers, SmolRTSP_Droppable).drop(workers);
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+
+    PASS();
+}
+
+TEST attach_on_node(void) {
+    SmolRTSP_SendWorkersConfig config = SmolRTSP_SendWorkersConfig_default(2);
+    config.pin_workers = true;
+    SmolRTSP_SendWorkers *workers =
+        SmolRTSP_SendWorkers_new_with_config(config);
+    ASSERT_EQ(2, SmolRTSP_SendWorkers_workers_count(workers));
+
+    for (size_t i = 0; i < 2; i++) {
+        const SmolRTSP_SendWorkerStats stats =
+            SmolRTSP_SendWorkers_worker_stats(workers, i);
+        ASSERT_EQ(smolrtsp_allowed_cpu(i), stats.cpu);
+        ASSERT_EQ(smolrtsp_cpu_numa_node(stats.cpu), stats.numa_node);
+        ASSERT_EQ(0, stats.queues);
+    }
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_NalTransport *t = SmolRTSP_NalTransport_new(
+        SmolRTSP_RtpTransport_new(smolrtsp_transport_udp(fds[0]), 96, 90000));
+
+    // No worker is on this node.
+    SmolRTSP_SendQueue *remote =
+        SmolRTSP_SendWorkers_attach_on_node(workers, t, 1, 1000);
+    const size_t remote_worker = SmolRTSP_SendQueue_worker(remote);
+    ASSERT_EQ(
+        1, SmolRTSP_SendWorkers_worker_stats(workers, remote_worker)
+               .remote_attachments);
+    SmolRTSP_SendWorkers_detach(workers, remote);
+
+    const int node = SmolRTSP_SendWorkers_worker_stats(workers, 1).numa_node;
+    if (node >= 0) {
+        // The least loaded worker of the node.
+        SmolRTSP_SendQueue *first =
+            SmolRTSP_SendWorkers_attach_on_node(workers, t, 1, node);
+        const size_t first_worker = SmolRTSP_SendQueue_worker(first);
+        const SmolRTSP_SendWorkerStats stats =
+            SmolRTSP_SendWorkers_worker_stats(workers, first_worker);
+        ASSERT_EQ(node, stats.numa_node);
+        ASSERT_EQ(1, stats.local_attachments);
+        ASSERT_EQ(1, stats.queues);
+
+        SmolRTSP_SendQueue *second =
+            SmolRTSP_SendWorkers_attach_on_node(workers, t, 1, node);
+
+        if (smolrtsp_cpu_numa_node(smolrtsp_allowed_cpu(0)) == node) {
+            ASSERT(first_worker != SmolRTSP_SendQueue_worker(second));
+        }
+
+        SmolRTSP_SendWorkers_detach(workers, first);
+        SmolRTSP_SendWorkers_detach(workers, second);
+    }
+
+    ASSERT_EQ(0, SmolRTSP_SendWorkers_worker_stats(workers, 0).queues);
+    ASSERT_EQ(0, SmolRTSP_SendWorkers_worker_stats(workers, 1).queues);
+
+    VTABLE(SmolRTSP_NalTransport, SmolRTSP_Droppable).drop(t);
+    close(fds[0]);
+    close(fds[1]);
+    VTABLE(SmolRTSP_SendWorkers, SmolRTSP_Droppable).drop(workers);
+    PASS();
+}
+
+SUITE(send_workers) {
+    RUN_TEST(send_from_workers);
+    RUN_TEST(push_to_full_queue);
+    RUN_TEST(attach_on_node);
+}
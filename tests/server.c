@@ -0,0 +1,609 @@
+#include <smolrtsp/server.h>
+
+#include <smolrtsp/allocator.h>
+#include <smolrtsp/numa.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string.h>
+
+typedef struct {
+    int accepted, dropped;
+} Stats;
+
+typedef struct {
+    Stats *stats;
+} Client;
+
+static void Client_drop(VSelf) {
+    VSELF(Client);
+
+    __atomic_add_fetch(&self->stats->dropped, 1, __ATOMIC_SEQ_CST);
+    free(self);
+}
+
+impl(SmolRTSP_Droppable, Client);
+
+static void
+Client_options(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
+    VSELF(Client);
+    (void)self;
+    (void)req;
+
+    smolrtsp_header(ctx, SMOLRTSP_HEADER_PUBLIC, "OPTIONS");
+    smolrtsp_respond_ok(ctx);
+}
+
+static void
+Client_unknown(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
+    VSELF(Client);
+    (void)self;
+    (void)req;
+
+    smolrtsp_respond(ctx, SMOLRTSP_STATUS_NOT_IMPLEMENTED, "Not Implemented");
+}
+
+#define Client_describe Client_unknown
+#define Client_setup    Client_unknown
+#define Client_play     Client_unknown
+#define Client_teardown Client_unknown
+
+static SmolRTSP_ControlFlow
+Client_before(VSelf, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
+    VSELF(Client);
+    (void)self;
+    (void)ctx;
+    (void)req;
+
+    return SmolRTSP_ControlFlow_Continue;
+}
+
+static void Client_after(
+    VSelf, ssize_t ret, SmolRTSP_Context *ctx, const SmolRTSP_Request *req) {
+    VSELF(Client);
+    (void)self;
+    (void)ret;
+    (void)ctx;
+    (void)req;
+}
+
+impl(SmolRTSP_Controller, Client);
+
+static bool accept_cb(
+    SmolRTSP_ServerConnection *conn, void *arg,
+    SmolRTSP_Controller *controller) {
+    (void)conn;
+    Stats *stats = arg;
+
+    Client *client = malloc(sizeof *client);
+    client->stats = stats;
+    *controller = DYN(Client, SmolRTSP_Controller, client);
+
+    __atomic_add_fetch(&stats->accepted, 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+static int connect_to(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = htons(port),
+    };
+    if (connect(fd, (const struct sockaddr *)&addr, sizeof addr) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static enum greatest_test_res
+read_exactly(int fd, size_t len, char buffer[restrict static len]) {
+    size_t received = 0;
+    while (received < len) {
+        const ssize_t n = read(fd, buffer + received, len - received);
+        ASSERT(n > 0);
+        received += (size_t)n;
+    }
+
+    PASS();
+}
+
+TEST serve_requests(void) {
+    Stats stats = {0};
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 2;
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+    ASSERT(SmolRTSP_Server_port(server) != 0);
+
+    enum { CLIENTS_COUNT = 8 };
+    int fds[CLIENTS_COUNT];
+    for (size_t i = 0; i < CLIENTS_COUNT; i++) {
+        fds[i] = connect_to(SmolRTSP_Server_port(server));
+        ASSERT(fds[i] != -1);
+    }
+
+    // Two pipelined requests, the second one split over two writes.
+    static const char requests[] = "OPTIONS * RTSP/1.0\r\n"
+                                   "CSeq: 1\r\n"
+                                   "\r\n"
+                                   "DESCRIBE rtsp://localhost/ RTSP/1.0\r\n"
+                                   "CSeq: 2\r\n";
+    static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 1\r\n"
+                                   "Public: OPTIONS\r\n"
+                                   "\r\n"
+                                   "RTSP/1.0 501 Not Implemented\r\n"
+                                   "CSeq: 2\r\n"
+                                   "\r\n";
+
+    for (size_t i = 0; i < CLIENTS_COUNT; i++) {
+        ASSERT_EQ(
+            sizeof requests - 1, write(fds[i], requests, sizeof requests - 1));
+        ASSERT_EQ(2, write(fds[i], "\r\n", 2));
+    }
+
+    for (size_t i = 0; i < CLIENTS_COUNT; i++) {
+        char buffer[sizeof expected - 1];
+        CHECK_CALL(read_exactly(fds[i], sizeof buffer, buffer));
+        ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+    }
+
+    ASSERT_EQ(
+        CLIENTS_COUNT, __atomic_load_n(&stats.accepted, __ATOMIC_SEQ_CST));
+
+    // A closed connection drops its controller.
+    close(fds[0]);
+    while (0 == __atomic_load_n(&stats.dropped, __ATOMIC_SEQ_CST)) {
+        usleep(1000);
+    }
+
+    // Dropping the server drops the controllers of the remaining connections.
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+    ASSERT_EQ(CLIENTS_COUNT, stats.dropped);
+
+    for (size_t i = 1; i < CLIENTS_COUNT; i++) {
+        char c;
+        ASSERT_EQ(0, read(fds[i], &c, 1));
+        close(fds[i]);
+    }
+
+    PASS();
+}
+
+TEST pin_workers(void) {
+    Stats stats = {0};
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 2;
+    config.pin_workers = true;
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+
+    for (size_t i = 0; i < 2; i++) {
+        const SmolRTSP_ServerWorkerStats worker_stats =
+            SmolRTSP_Server_worker_stats(server, i);
+        ASSERT_EQ(smolrtsp_allowed_cpu(i), worker_stats.cpu);
+        ASSERT_EQ(
+            smolrtsp_cpu_numa_node(worker_stats.cpu), worker_stats.numa_node);
+    }
+
+    const int fd = connect_to(SmolRTSP_Server_port(server));
+    ASSERT(fd != -1);
+
+    static const char request[] = "OPTIONS * RTSP/1.0\r\n"
+                                  "CSeq: 1\r\n"
+                                  "\r\n";
+    static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 1\r\n"
+                                   "Public: OPTIONS\r\n"
+                                   "\r\n";
+    ASSERT_EQ(sizeof request - 1, write(fd, request, sizeof request - 1));
+    char buffer[sizeof expected - 1];
+    CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+    ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+    // The connection is counted by the worker that has accepted it.
+    uint64_t connections = 0, local_connections = 0;
+    for (size_t i = 0; i < 2; i++) {
+        const SmolRTSP_ServerWorkerStats worker_stats =
+            SmolRTSP_Server_worker_stats(server, i);
+        connections += worker_stats.connections;
+        local_connections += worker_stats.local_connections;
+    }
+    ASSERT_EQ(1, connections);
+    ASSERT(local_connections <= 1);
+
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+    close(fd);
+
+    PASS();
+}
+
+static uint64_t buffered_connections(const SmolRTSP_Server *server) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < 2; i++) {
+        n += SmolRTSP_Server_worker_stats(server, i).buffered_connections;
+    }
+
+    return n;
+}
+
+TEST idle_connections(void) {
+    Stats stats = {0};
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 2;
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+
+    const int fd = connect_to(SmolRTSP_Server_port(server));
+    ASSERT(fd != -1);
+
+    static const char request_line[] = "OPTIONS * RTSP/1.0\r\n";
+    static const char rest[] = "CSeq: 1\r\n"
+                               "\r\n";
+    static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 1\r\n"
+                                   "Public: OPTIONS\r\n"
+                                   "\r\n";
+
+    // A partial request is kept in a buffer of the connection.
+    ASSERT_EQ(
+        sizeof request_line - 1,
+        write(fd, request_line, sizeof request_line - 1));
+    for (int i = 0; i < 1000 && 0 == buffered_connections(server); i++) {
+        usleep(1000);
+    }
+    ASSERT_EQ(1, buffered_connections(server));
+
+    // Once the request is complete and answered, the connection holds no
+    // buffers.
+    ASSERT_EQ(sizeof rest - 1, write(fd, rest, sizeof rest - 1));
+    char buffer[sizeof expected - 1];
+    CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+    ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+    for (int i = 0; i < 1000 && buffered_connections(server) > 0; i++) {
+        usleep(1000);
+    }
+    ASSERT_EQ(0, buffered_connections(server));
+
+    // A request received in full is parsed in the buffer of the worker.
+    ASSERT_EQ(
+        sizeof request_line - 1,
+        write(fd, request_line, sizeof request_line - 1));
+    ASSERT_EQ(sizeof rest - 1, write(fd, rest, sizeof rest - 1));
+    CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+    ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+    close(fd);
+
+    PASS();
+}
+
+static uint64_t rejected_connections(const SmolRTSP_Server *server) {
+    return SmolRTSP_Server_worker_stats(server, 0).rejected_connections;
+}
+
+// Sends `data` in one segment and expects the server to close the connection
+// for exceeding a limit.
+static enum greatest_test_res
+expect_rejected(SmolRTSP_Server *server, const char *data, size_t len) {
+    const uint64_t rejected = rejected_connections(server);
+
+    const int fd = connect_to(SmolRTSP_Server_port(server));
+    ASSERT(fd != -1);
+    ASSERT_EQ((ssize_t)len, write(fd, data, len));
+
+    char buffer[64];
+    ASSERT(read(fd, buffer, sizeof buffer) <= 0);
+    ASSERT_EQ(rejected + 1, rejected_connections(server));
+
+    close(fd);
+    PASS();
+}
+
+TEST limits(void) {
+    Stats stats = {0};
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 1;
+    config.max_request_size = 64;
+    config.request_timeout_ms = 40;
+    config.max_parse_attempts = 3;
+    config.max_interleaved_pending = 100;
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+
+    // A request within the limits.
+    {
+        const int fd = connect_to(SmolRTSP_Server_port(server));
+        ASSERT(fd != -1);
+
+        static const char request[] = "OPTIONS * RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+        static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                       "CSeq: 1\r\n"
+                                       "Public: OPTIONS\r\n"
+                                       "\r\n";
+        ASSERT_EQ(sizeof request - 1, write(fd, request, sizeof request - 1));
+        char buffer[sizeof expected - 1];
+        CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+        ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+        close(fd);
+    }
+
+    // A request longer than `max_request_size`.
+    static const char long_request[] =
+        "OPTIONS * RTSP/1.0\r\nCSeq: 1\r\nUser-Agent: "
+        "0123456789012345678901234567890123456789\r\n";
+    CHECK_CALL(expect_rejected(server, long_request, sizeof long_request - 1));
+
+    // A body that will not fit is rejected before it is received.
+    static const char long_body[] =
+        "SET_PARAMETER * RTSP/1.0\r\nContent-Length: 100\r\n\r\n";
+    CHECK_CALL(expect_rejected(server, long_body, sizeof long_body - 1));
+
+    // A frame longer than `max_interleaved_pending`: 256 bytes on channel 0.
+    static const char long_frame[] = "$\x00\x01\x00";
+    CHECK_CALL(expect_rejected(server, long_frame, sizeof long_frame - 1));
+
+    // A request that is not complete in time.
+    CHECK_CALL(expect_rejected(server, "OPTIONS", 7));
+
+    // A request trickled in too many reads.
+    {
+        const uint64_t rejected = rejected_connections(server);
+
+        const int fd = connect_to(SmolRTSP_Server_port(server));
+        ASSERT(fd != -1);
+        for (int i = 0; i < 3; i++) {
+            ASSERT_EQ(1, write(fd, "O", 1));
+            usleep(5000);
+        }
+
+        char buffer[64];
+        ASSERT(read(fd, buffer, sizeof buffer) <= 0);
+        ASSERT_EQ(rejected + 1, rejected_connections(server));
+
+        close(fd);
+    }
+
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+
+    PASS();
+}
+
+static SmolRTSP_Allocator default_allocator;
+
+static void *failing_malloc(void *user_data, size_t size) {
+    (void)user_data;
+    (void)size;
+    return NULL;
+}
+
+static void *failing_realloc(void *user_data, void *ptr, size_t size) {
+    (void)user_data;
+    (void)ptr;
+    (void)size;
+    return NULL;
+}
+
+// The blocks allocated before the failing allocator was set go back to their
+// own allocator.
+static void failing_free(void *user_data, void *ptr) {
+    (void)user_data;
+    default_allocator.free(default_allocator.user_data, ptr);
+}
+
+TEST out_of_memory(void) {
+    Stats stats = {0};
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 1;
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+
+    // A connection that cannot be allocated is closed right away.
+    {
+        const uint64_t rejected = rejected_connections(server);
+
+        default_allocator = smolrtsp_allocator();
+        smolrtsp_set_allocator((SmolRTSP_Allocator){
+            .malloc = failing_malloc,
+            .realloc = failing_realloc,
+            .free = failing_free,
+            .user_data = NULL,
+        });
+
+        const int fd = connect_to(SmolRTSP_Server_port(server));
+        char buffer[64];
+        const ssize_t n = fd != -1 ? read(fd, buffer, sizeof buffer) : -1;
+
+        smolrtsp_set_allocator(default_allocator);
+
+        ASSERT(fd != -1);
+        ASSERT(n <= 0);
+        ASSERT_EQ(rejected + 1, rejected_connections(server));
+        ASSERT_EQ(0, stats.accepted);
+
+        close(fd);
+    }
+
+    // The server keeps serving the other clients.
+    {
+        const int fd = connect_to(SmolRTSP_Server_port(server));
+        ASSERT(fd != -1);
+
+        static const char request[] = "OPTIONS * RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+        static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                       "CSeq: 1\r\n"
+                                       "Public: OPTIONS\r\n"
+                                       "\r\n";
+        ASSERT_EQ(sizeof request - 1, write(fd, request, sizeof request - 1));
+        char buffer[sizeof expected - 1];
+        CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+        ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+        close(fd);
+    }
+
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+
+    PASS();
+}
+
+TEST keep_alive(void) {
+    Stats stats = {0};
+
+    SmolRTSP_SessionRegistry *sessions =
+        SmolRTSP_SessionRegistry_new(16, 60000);
+    SmolRTSP_Session *session =
+        SmolRTSP_SessionRegistry_create(sessions, CharSlice99_from_str("1234"));
+    ASSERT(session != NULL);
+    SmolRTSP_Session_release(session);
+
+    SmolRTSP_ServerConfig config =
+        SmolRTSP_ServerConfig_default(accept_cb, &stats);
+    config.workers_count = 2;
+    config.keep_alive_sessions = sessions;
+    config.keep_alive_public = "OPTIONS, GET_PARAMETER";
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    SmolRTSP_Server *server = SmolRTSP_Server_start(
+        (const struct sockaddr *)&addr, sizeof addr, config);
+    ASSERT(server != NULL);
+
+    const int fd = connect_to(SmolRTSP_Server_port(server));
+    ASSERT(fd != -1);
+
+    // The keep-alive of an unknown session and the one with a body go to the
+    // controller.
+    static const char requests[] =
+        "GET_PARAMETER rtsp://localhost/ RTSP/1.0\r\n"
+        "CSeq: 2\r\n"
+        "Session: 1234\r\n"
+        "\r\n"
+        "OPTIONS * RTSP/1.0\r\n"
+        "cseq: 3\r\n"
+        "User-Agent: test\r\n"
+        "session: 1234;timeout=60\r\n"
+        "\r\n"
+        "GET_PARAMETER rtsp://localhost/ RTSP/1.0\r\n"
+        "CSeq: 4\r\n"
+        "Session: 5678\r\n"
+        "\r\n"
+        "GET_PARAMETER rtsp://localhost/ RTSP/1.0\r\n"
+        "CSeq: 5\r\n"
+        "Session: 1234\r\n"
+        "Content-Length: 2\r\n"
+        "\r\n"
+        "ab"
+        "GET_PARAMETER rtsp://localhost/ RTSP/1.0\r\n"
+        "CSeq: 4294967295\r\n"
+        "Session: 1234\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    static const char expected[] = "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 2\r\n"
+                                   "Session: 1234\r\n"
+                                   "\r\n"
+                                   "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 3\r\n"
+                                   "Session: 1234\r\n"
+                                   "Public: OPTIONS, GET_PARAMETER\r\n"
+                                   "\r\n"
+                                   "RTSP/1.0 501 Not Implemented\r\n"
+                                   "CSeq: 4\r\n"
+                                   "\r\n"
+                                   "RTSP/1.0 501 Not Implemented\r\n"
+                                   "CSeq: 5\r\n"
+                                   "\r\n"
+                                   "RTSP/1.0 200 OK\r\n"
+                                   "CSeq: 4294967295\r\n"
+                                   "Session: 1234\r\n"
+                                   "\r\n";
+
+    ASSERT_EQ(sizeof requests - 1, write(fd, requests, sizeof requests - 1));
+    char buffer[sizeof expected - 1];
+    CHECK_CALL(read_exactly(fd, sizeof buffer, buffer));
+    ASSERT_MEM_EQ(expected, buffer, sizeof buffer);
+
+    uint64_t keep_alives = 0;
+    for (size_t i = 0; i < 2; i++) {
+        keep_alives += SmolRTSP_Server_worker_stats(server, i).keep_alives;
+    }
+    ASSERT_EQ(3, keep_alives);
+
+    VTABLE(SmolRTSP_Server, SmolRTSP_Droppable).drop(server);
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(sessions);
+    close(fd);
+
+    PASS();
+}
+
+SUITE(server) {
+    RUN_TEST(serve_requests);
+    RUN_TEST(pin_workers);
+    RUN_TEST(idle_connections);
+    RUN_TEST(keep_alive);
+    RUN_TEST(limits);
+    RUN_TEST(out_of_memory);
+}
@@ -0,0 +1,177 @@
+#include <smolrtsp/session_registry.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <unistd.h>
+
+typedef struct {
+    int *dropped_n;
+} Stream;
+
+static void Stream_drop(VSelf) {
+    VSELF(Stream);
+    (*self->dropped_n)++;
+}
+
+impl(SmolRTSP_Droppable, Stream);
+
+TEST create_find_remove(void) {
+    SmolRTSP_SessionRegistry *registry =
+        SmolRTSP_SessionRegistry_new(0, 60000);
+
+    int dropped_n = 0;
+    Stream streams[2] = {{&dropped_n}, {&dropped_n}};
+
+    SmolRTSP_Session *session = SmolRTSP_SessionRegistry_create(
+        registry, CharSlice99_from_str("12345678"));
+    ASSERT(session != NULL);
+    ASSERT_EQ(
+        0, SmolRTSP_Session_add_stream(
+               session, DYN(Stream, SmolRTSP_Droppable, &streams[0])));
+    ASSERT_EQ(
+        0, SmolRTSP_Session_add_stream(
+               session, DYN(Stream, SmolRTSP_Droppable, &streams[1])));
+    SmolRTSP_Session_release(session);
+
+    errno = 0;
+    ASSERT_EQ(
+        NULL, SmolRTSP_SessionRegistry_create(
+                  registry, CharSlice99_from_str("12345678")));
+    ASSERT_EQ(EEXIST, errno);
+    ASSERT_EQ(1, SmolRTSP_SessionRegistry_len(registry));
+
+    // The parameters of a `Session` header are ignored.
+    session = SmolRTSP_SessionRegistry_find(
+        registry, CharSlice99_from_str(" 12345678;timeout=60"));
+    ASSERT(session != NULL);
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("12345678"), SmolRTSP_Session_id(session)));
+
+    SmolRTSP_Droppable found[SMOLRTSP_SESSION_MAX_STREAMS];
+    ASSERT_EQ(
+        2, SmolRTSP_Session_streams(
+               session, found, SMOLRTSP_SESSION_MAX_STREAMS));
+    ASSERT_EQ((void *)&streams[1], found[1].self);
+
+    ASSERT_EQ(
+        NULL, SmolRTSP_SessionRegistry_find(
+                  registry, CharSlice99_from_str("1234567")));
+
+    // The streams outlive the removal while the session is referenced.
+    ASSERT(SmolRTSP_SessionRegistry_remove(
+        registry, CharSlice99_from_str("12345678")));
+    ASSERT(!SmolRTSP_SessionRegistry_remove(
+        registry, CharSlice99_from_str("12345678")));
+    ASSERT_EQ(0, SmolRTSP_SessionRegistry_len(registry));
+    ASSERT_EQ(0, dropped_n);
+
+    SmolRTSP_Session_release(session);
+    ASSERT_EQ(2, dropped_n);
+
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(registry);
+    PASS();
+}
+
+TEST many_sessions(void) {
+    SmolRTSP_SessionRegistry *registry =
+        SmolRTSP_SessionRegistry_new(16, 60000);
+
+    enum { SESSIONS_COUNT = 10000 };
+
+    // Far more sessions than the initial buckets, so that the shards grow.
+    for (int i = 0; i < SESSIONS_COUNT; i++) {
+        char id[16];
+        snprintf(id, sizeof id, "%d", i);
+
+        SmolRTSP_Session *session = SmolRTSP_SessionRegistry_create(
+            registry, CharSlice99_from_str(id));
+        ASSERT(session != NULL);
+        SmolRTSP_Session_release(session);
+    }
+    ASSERT_EQ(SESSIONS_COUNT, SmolRTSP_SessionRegistry_len(registry));
+
+    for (int i = 0; i < SESSIONS_COUNT; i++) {
+        char id[16];
+        snprintf(id, sizeof id, "%d", i);
+
+        SmolRTSP_Session *session =
+            SmolRTSP_SessionRegistry_find(registry, CharSlice99_from_str(id));
+        ASSERT(session != NULL);
+        ASSERT(CharSlice99_primitive_eq(
+            CharSlice99_from_str(id), SmolRTSP_Session_id(session)));
+        SmolRTSP_Session_release(session);
+    }
+
+    // The registry drops the remaining sessions.
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(registry);
+    PASS();
+}
+
+TEST expire_sessions(void) {
+    SmolRTSP_SessionRegistry *registry = SmolRTSP_SessionRegistry_new(0, 20);
+
+    int dropped_n = 0;
+    Stream stream = {&dropped_n};
+
+    SmolRTSP_Session *session =
+        SmolRTSP_SessionRegistry_create(registry, CharSlice99_from_str("a"));
+    ASSERT_EQ(
+        0, SmolRTSP_Session_add_stream(
+               session, DYN(Stream, SmolRTSP_Droppable, &stream)));
+    SmolRTSP_Session_release(session);
+
+    session =
+        SmolRTSP_SessionRegistry_create(registry, CharSlice99_from_str("b"));
+    SmolRTSP_Session_release(session);
+
+    ASSERT_EQ(0, SmolRTSP_SessionRegistry_expire(registry));
+
+    usleep(30 * 1000);
+
+    // A lookup keeps "b" alive.
+    session =
+        SmolRTSP_SessionRegistry_find(registry, CharSlice99_from_str("b"));
+    SmolRTSP_Session_release(session);
+
+    ASSERT_EQ(1, SmolRTSP_SessionRegistry_expire(registry));
+    ASSERT_EQ(1, dropped_n);
+    ASSERT_EQ(
+        NULL,
+        SmolRTSP_SessionRegistry_find(registry, CharSlice99_from_str("a")));
+    ASSERT_EQ(1, SmolRTSP_SessionRegistry_len(registry));
+
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(registry);
+    PASS();
+}
+
+TEST create_invalid(void) {
+    SmolRTSP_SessionRegistry *registry = SmolRTSP_SessionRegistry_new(0, 0);
+
+    char long_id[SMOLRTSP_SESSION_ID_MAX_LEN + 1];
+    memset(long_id, 'x', sizeof long_id);
+
+    errno = 0;
+    ASSERT_EQ(
+        NULL, SmolRTSP_SessionRegistry_create(
+                  registry, CharSlice99_new(long_id, sizeof long_id)));
+    ASSERT_EQ(EINVAL, errno);
+
+    errno = 0;
+    ASSERT_EQ(
+        NULL,
+        SmolRTSP_SessionRegistry_create(registry, CharSlice99_empty()));
+    ASSERT_EQ(EINVAL, errno);
+
+    VTABLE(SmolRTSP_SessionRegistry, SmolRTSP_Droppable).drop(registry);
+    PASS();
+}
+
+SUITE(session_registry) {
+    RUN_TEST(create_find_remove);
+    RUN_TEST(many_sessions);
+    RUN_TEST(expire_sessions);
+    RUN_TEST(create_invalid);
+}
@@ -0,0 +1,219 @@
+#include <smolrtsp/shm_ring.h>
+
+#include <greatest.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+static uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static SmolRTSP_NalUnit nalu(uint8_t unit_type) {
+    return (SmolRTSP_NalUnit){
+        SmolRTSP_NalHeader_H264((SmolRTSP_H264NalHeader){
+            .forbidden_zero_bit = false,
+            .ref_idc = 0b11,
+            .unit_type = unit_type,
+        }),
+        U8Slice99_new(payload, sizeof payload),
+    };
+}
+
+// Opens the ring of `producer` as the other process would.
+static SmolRTSP_ShmRing *open_consumer(const SmolRTSP_ShmRing *producer) {
+    return SmolRTSP_ShmRing_open(
+        dup(SmolRTSP_ShmRing_memfd(producer)),
+        dup(SmolRTSP_ShmRing_eventfd(producer)));
+}
+
+static void drop_ring(SmolRTSP_ShmRing *ring) {
+    VTABLE(SmolRTSP_ShmRing, SmolRTSP_Droppable).drop(ring);
+}
+
+// Peeks an access unit of a single NAL unit, expecting the raw timestamp `ts`,
+// and releases it.
+static enum greatest_test_res
+expect_single(SmolRTSP_ShmRing *consumer, uint32_t ts) {
+    SmolRTSP_ShmAccessUnit au;
+    ASSERT_EQ(0, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT_EQ(1, au.nalus_count);
+    ASSERT(MATCHES(au.ts, SmolRTSP_RtpTimestamp_Raw));
+    ASSERT_EQ(ts, SmolRTSP_RtpTimestamp_compute(au.ts, 90000));
+    ASSERT_EQ(sizeof payload, au.nalus[0].payload.len);
+    ASSERT_MEM_EQ(payload, au.nalus[0].payload.ptr, sizeof payload);
+    SmolRTSP_ShmRing_release(consumer);
+
+    PASS();
+}
+
+TEST push_and_peek(void) {
+    SmolRTSP_ShmRing *producer =
+        SmolRTSP_ShmRing_new(256, SmolRTSP_NalCodec_H264);
+    ASSERT(producer);
+    SmolRTSP_ShmRing *consumer = open_consumer(producer);
+    ASSERT(consumer);
+    ASSERT_EQ(SmolRTSP_NalCodec_H264, SmolRTSP_ShmRing_codec(consumer));
+
+    SmolRTSP_ShmAccessUnit au;
+    ASSERT_EQ(-1, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT_EQ(EAGAIN, errno);
+
+    const SmolRTSP_NalUnit nalus[] = {
+        nalu(SMOLRTSP_H264_NAL_UNIT_SPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_PPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR),
+    };
+    ASSERT_EQ(
+        0, SmolRTSP_ShmRing_push(
+               producer, SmolRTSP_RtpTimestamp_SysClockUs(123456789), nalus,
+               SLICE99_ARRAY_LEN(nalus)));
+
+    uint64_t signals = 0;
+    ASSERT_EQ(
+        (ssize_t)sizeof signals,
+        read(SmolRTSP_ShmRing_eventfd(consumer), &signals, sizeof signals));
+    ASSERT_EQ(1, signals);
+
+    ASSERT_EQ(0, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT(MATCHES(au.ts, SmolRTSP_RtpTimestamp_SysClockUs));
+    ASSERT_EQ(SLICE99_ARRAY_LEN(nalus), au.nalus_count);
+    for (size_t i = 0; i < au.nalus_count; i++) {
+        ASSERT_EQ(
+            SmolRTSP_NalHeader_unit_type(nalus[i].header),
+            SmolRTSP_NalHeader_unit_type(au.nalus[i].header));
+        ASSERT_EQ(sizeof payload, au.nalus[i].payload.len);
+        ASSERT_MEM_EQ(payload, au.nalus[i].payload.ptr, sizeof payload);
+
+        // Not copied out of the ring.
+        ASSERT(au.nalus[i].payload.ptr != payload);
+    }
+
+    // Until released, the same access unit is peeked again.
+    SmolRTSP_ShmAccessUnit again;
+    ASSERT_EQ(0, SmolRTSP_ShmRing_peek(consumer, &again));
+    ASSERT_EQ(au.nalus[0].payload.ptr, again.nalus[0].payload.ptr);
+
+    SmolRTSP_ShmRing_release(consumer);
+    ASSERT_EQ(-1, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT_EQ(EAGAIN, errno);
+
+    drop_ring(consumer);
+    drop_ring(producer);
+    PASS();
+}
+
+TEST wraparound(void) {
+    // Every access unit of a single NAL unit takes 40 bytes, so the fourth
+    // one does not fit before the end of the ring.
+    SmolRTSP_ShmRing *producer =
+        SmolRTSP_ShmRing_new(128, SmolRTSP_NalCodec_H264);
+    ASSERT(producer);
+    SmolRTSP_ShmRing *consumer = open_consumer(producer);
+    ASSERT(consumer);
+
+    const SmolRTSP_NalUnit slice =
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+
+    for (uint32_t ts = 1; ts <= 3; ts++) {
+        ASSERT_EQ(
+            0, SmolRTSP_ShmRing_push(
+                   producer, SmolRTSP_RtpTimestamp_Raw(ts), &slice, 1));
+    }
+
+    ASSERT_EQ(
+        -1, SmolRTSP_ShmRing_push(
+                producer, SmolRTSP_RtpTimestamp_Raw(4), &slice, 1));
+    ASSERT_EQ(ENOBUFS, errno);
+
+    CHECK_CALL(expect_single(consumer, 1));
+
+    // Now goes to the beginning of the ring.
+    ASSERT_EQ(
+        0, SmolRTSP_ShmRing_push(
+               producer, SmolRTSP_RtpTimestamp_Raw(4), &slice, 1));
+
+    CHECK_CALL(expect_single(consumer, 2));
+    CHECK_CALL(expect_single(consumer, 3));
+    CHECK_CALL(expect_single(consumer, 4));
+
+    SmolRTSP_ShmAccessUnit au;
+    ASSERT_EQ(-1, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT_EQ(EAGAIN, errno);
+
+    drop_ring(consumer);
+    drop_ring(producer);
+    PASS();
+}
+
+TEST too_large(void) {
+    SmolRTSP_ShmRing *ring = SmolRTSP_ShmRing_new(48, SmolRTSP_NalCodec_H264);
+    ASSERT(ring);
+
+    const SmolRTSP_NalUnit nalus[] = {
+        nalu(SMOLRTSP_H264_NAL_UNIT_SPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_PPS),
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_IDR),
+    };
+    ASSERT_EQ(
+        -1, SmolRTSP_ShmRing_push(
+                ring, SmolRTSP_RtpTimestamp_Raw(0), nalus,
+                SLICE99_ARRAY_LEN(nalus)));
+    ASSERT_EQ(EMSGSIZE, errno);
+
+    SmolRTSP_NalUnit many[SMOLRTSP_SHM_RING_MAX_NALUS + 1] = {0};
+    ASSERT_EQ(
+        -1, SmolRTSP_ShmRing_push(
+                ring, SmolRTSP_RtpTimestamp_Raw(0), many,
+                SLICE99_ARRAY_LEN(many)));
+    ASSERT_EQ(EMSGSIZE, errno);
+
+    drop_ring(ring);
+    PASS();
+}
+
+TEST untrusted(void) {
+    // A `memfd` that may shrink under the mapping.
+    const int memfd = memfd_create("not-a-ring", MFD_CLOEXEC);
+    ASSERT(memfd != -1);
+    ASSERT_EQ(0, ftruncate(memfd, 4096));
+    ASSERT_EQ(NULL, SmolRTSP_ShmRing_open(memfd, -1));
+    ASSERT_EQ(EINVAL, errno);
+    close(memfd);
+
+    SmolRTSP_ShmRing *producer =
+        SmolRTSP_ShmRing_new(128, SmolRTSP_NalCodec_H264);
+    ASSERT(producer);
+    SmolRTSP_ShmRing *consumer = open_consumer(producer);
+    ASSERT(consumer);
+
+    const SmolRTSP_NalUnit slice =
+        nalu(SMOLRTSP_H264_NAL_UNIT_CODED_SLICE_NON_IDR);
+    ASSERT_EQ(
+        0, SmolRTSP_ShmRing_push(
+               producer, SmolRTSP_RtpTimestamp_Raw(0), &slice, 1));
+
+    // The size of the first record, right after the 192-byte header, claims
+    // more than the ring.
+    const uint32_t size = 1024;
+    ASSERT_EQ(
+        (ssize_t)sizeof size,
+        pwrite(SmolRTSP_ShmRing_memfd(producer), &size, sizeof size, 192));
+
+    SmolRTSP_ShmAccessUnit au;
+    ASSERT_EQ(-1, SmolRTSP_ShmRing_peek(consumer, &au));
+    ASSERT_EQ(EBADMSG, errno);
+
+    drop_ring(consumer);
+    drop_ring(producer);
+    PASS();
+}
+
+SUITE(shm_ring) {
+    RUN_TEST(push_and_peek);
+    RUN_TEST(wraparound);
+    RUN_TEST(too_large);
+    RUN_TEST(untrusted);
+}
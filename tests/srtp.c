@@ -0,0 +1,287 @@
+#include <smolrtsp/srtp.h>
+
+#include "fake_transport.h"
+#include <greatest.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// The reference keys of libsrtp, whose session keys are those of RFC 3711,
+// appendix B.3.
+static const SmolRTSP_SrtpKeys reference_keys = {
+    .suite = SmolRTSP_SrtpSuite_AesCm128HmacSha1_80,
+    .master_key =
+        {
+            0xE1, 0xF9, 0x7A, 0x0D, 0x3E, 0x01, 0x8B, 0xE0,
+            0xD6, 0x4F, 0xA3, 0x2C, 0x06, 0xDE, 0x41, 0x39,
+        },
+    .master_salt =
+        {
+            0x0E, 0xC6, 0x75, 0xAD, 0x49, 0x8A, 0xFE,
+            0xEB, 0xB6, 0x96, 0x0B, 0x3A, 0xAB, 0xE6,
+        },
+};
+
+static SmolRTSP_Transport
+new_srtp(FakeTransport *fake, SmolRTSP_SrtpKeys keys, bool rtcp) {
+    *fake = (FakeTransport){0};
+
+    const SmolRTSP_Transport inner =
+        DYN(FakeTransport, SmolRTSP_Transport, fake);
+    SmolRTSP_SrtpTransport *t =
+        rtcp ? SmolRTSP_SrtpTransport_new_rtcp(inner, keys)
+             : SmolRTSP_SrtpTransport_new(inner, keys);
+    assert(t);
+
+    return DYN(SmolRTSP_SrtpTransport, SmolRTSP_Transport, t);
+}
+
+TEST protect_rtp(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_srtp(&fake, reference_keys, false);
+
+    uint8_t header[] = {
+        0x80, 0x0F, 0x12, 0x34, 0xDE, 0xCA, 0xFB, 0xAD, 0xCA, 0xFE, 0xBA, 0xBE,
+    };
+    uint8_t payload[16];
+    memset(payload, 0xAB, sizeof payload);
+
+    // The header and the payload are in separate buffers, and left intact.
+    struct iovec bufs[] = {
+        {.iov_base = header, .iov_len = sizeof header},
+        {.iov_base = payload, .iov_len = sizeof payload},
+    };
+    ASSERT_EQ(0, VCALL(t, transmit, SmolRTSP_IoVecSlice_new(bufs, 2)));
+    ASSERT_EQ(0xAB, payload[0]);
+
+    const uint8_t expected[] = {
+        0x80, 0x0F, 0x12, 0x34, 0xDE, 0xCA, 0xFB, 0xAD, 0xCA, 0xFE,
+        0xBA, 0xBE, 0x4E, 0x55, 0xDC, 0x4C, 0xE7, 0x99, 0x78, 0xD8,
+        0x8C, 0xA4, 0xD2, 0x15, 0x94, 0x9D, 0x24, 0x02, 0xB7, 0x8D,
+        0x6A, 0xCC, 0x99, 0xEA, 0x17, 0x9B, 0x8D, 0xBB,
+    };
+    ASSERT_EQ(1, fake.packets_count);
+    ASSERT_EQ(sizeof expected, fake.packet_sizes[0]);
+    ASSERT_MEM_EQ(expected, fake.packets[0], sizeof expected);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+
+    // The 32-bit tag is a prefix of the 80-bit one.
+    SmolRTSP_SrtpKeys keys = reference_keys;
+    keys.suite = SmolRTSP_SrtpSuite_AesCm128HmacSha1_32;
+    t = new_srtp(&fake, keys, false);
+
+    ASSERT_EQ(0, VCALL(t, transmit, SmolRTSP_IoVecSlice_new(bufs, 2)));
+    ASSERT_EQ(sizeof expected - 6, fake.packet_sizes[0]);
+    ASSERT_MEM_EQ(expected, fake.packets[0], sizeof expected - 6);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+static int transmit_packet(SmolRTSP_Transport t, uint16_t seq_num) {
+    uint8_t packet[12 + 20] = {
+        0x80, 0x60, (uint8_t)(seq_num >> 8), (uint8_t)seq_num, 0, 0, 0, 0,
+        0x11, 0x22, 0x33, 0x44,
+    };
+    for (size_t i = 0; i < 20; i++) {
+        packet[12 + i] = (uint8_t)i;
+    }
+
+    struct iovec buf = {.iov_base = packet, .iov_len = sizeof packet};
+    return VCALL(t, transmit, SmolRTSP_IoVecSlice_new(&buf, 1));
+}
+
+TEST rollover_counter(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_srtp(&fake, reference_keys, false);
+
+    ASSERT_EQ(0, transmit_packet(t, 0xFFFF));
+    ASSERT_EQ(0, transmit_packet(t, 0x0000));
+    // A retransmission from before the wrap-around keeps its index.
+    ASSERT_EQ(0, transmit_packet(t, 0xFFFF));
+    ASSERT_EQ(3, fake.packets_count);
+
+    // The indices 0x0FFFF and 0x10000.
+    const uint8_t expected[2][42] = {
+        {
+            0x80, 0x60, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33,
+            0x44, 0x12, 0x4D, 0x1E, 0x08, 0xAE, 0x0A, 0x4F, 0xEC, 0xF6, 0xF5,
+            0x9C, 0xEC, 0x4B, 0x09, 0xB4, 0x41, 0x20, 0xA0, 0x6D, 0xB8, 0xA8,
+            0x02, 0x03, 0xAF, 0xBB, 0xE2, 0x5B, 0xD9, 0x15, 0xDA,
+        },
+        {
+            0x80, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33,
+            0x44, 0xFA, 0x3A, 0x8F, 0xCC, 0xA6, 0x5B, 0x99, 0x84, 0x1E, 0x58,
+            0xA3, 0x4A, 0x06, 0xAB, 0x79, 0xA0, 0x05, 0xE5, 0x42, 0x64, 0xA3,
+            0xD5, 0xF8, 0x0F, 0x03, 0x66, 0xAC, 0x6F, 0xAC, 0xF0,
+        },
+    };
+    ASSERT_MEM_EQ(expected[0], fake.packets[0], sizeof expected[0]);
+    ASSERT_MEM_EQ(expected[1], fake.packets[1], sizeof expected[1]);
+    ASSERT_MEM_EQ(expected[0], fake.packets[2], sizeof expected[0]);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST protect_rtcp(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_srtp(&fake, reference_keys, true);
+
+    uint8_t rr[32] = {0x81, 0xC9, 0x00, 0x07, 0xCA, 0xFE, 0xBA, 0xBE};
+    for (size_t i = 8; i < sizeof rr; i++) {
+        rr[i] = (uint8_t)(i - 8);
+    }
+
+    struct iovec buf = {.iov_base = rr, .iov_len = sizeof rr};
+    ASSERT_EQ(0, VCALL(t, transmit, SmolRTSP_IoVecSlice_new(&buf, 1)));
+
+    // E=1, the SRTCP index 0, and the tag.
+    const uint8_t expected[] = {
+        0x81, 0xC9, 0x00, 0x07, 0xCA, 0xFE, 0xBA, 0xBE, 0x1A, 0x36, 0x88, 0x32,
+        0xA7, 0xC5, 0xC1, 0xD6, 0x45, 0xBF, 0x2F, 0xAB, 0x59, 0x12, 0x1B, 0x9B,
+        0x3F, 0x27, 0xB0, 0xF1, 0x8F, 0x9A, 0x1A, 0x7E, 0x80, 0x00, 0x00, 0x00,
+        0xAA, 0x88, 0xA7, 0x27, 0xEB, 0xD4, 0xB3, 0x73, 0x66, 0xC6,
+    };
+    ASSERT_EQ(sizeof rr + SMOLRTSP_SRTCP_OVERHEAD, fake.packet_sizes[0]);
+    ASSERT_MEM_EQ(expected, fake.packets[0], sizeof expected);
+
+    // The packet decrypts back, but not once it is tampered with.
+    U8Slice99 packet = U8Slice99_new(fake.packets[0], fake.packet_sizes[0]);
+    ASSERT_EQ(0, SmolRTSP_SrtpTransport_unprotect_rtcp(t.self, &packet));
+    ASSERT_EQ(sizeof rr, packet.len);
+    ASSERT_MEM_EQ(rr, packet.ptr, sizeof rr);
+
+    ASSERT_EQ(0, VCALL(t, transmit, SmolRTSP_IoVecSlice_new(&buf, 1)));
+    ASSERT_EQ(0x01, fake.packets[1][sizeof rr + 3]);
+    fake.packets[1][9] ^= 1;
+    packet = U8Slice99_new(fake.packets[1], fake.packet_sizes[1]);
+    errno = 0;
+    ASSERT_EQ(-1, SmolRTSP_SrtpTransport_unprotect_rtcp(t.self, &packet));
+    ASSERT_EQ(EBADMSG, errno);
+
+    packet = U8Slice99_new(fake.packets[1], 21);
+    ASSERT_EQ(-1, SmolRTSP_SrtpTransport_unprotect_rtcp(t.self, &packet));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST batch(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_srtp(&fake, reference_keys, false);
+
+    uint8_t packets[3][12 + 20] = {{0}};
+    struct iovec bufs[3];
+    SmolRTSP_IoVecSlice slices[3];
+    for (size_t i = 0; i < 3; i++) {
+        packets[i][0] = 0x80;
+        packets[i][3] = (uint8_t)i;
+        bufs[i] = (struct iovec){packets[i], sizeof packets[i]};
+        slices[i] = SmolRTSP_IoVecSlice_new(&bufs[i], 1);
+    }
+
+    ASSERT_EQ(3, VCALL(t, transmit_batch, SmolRTSP_IoVecBatch_new(slices, 3)));
+    ASSERT_EQ(3, fake.packets_count);
+
+    // The same packets protected one by one.
+    FakeTransport single;
+    SmolRTSP_Transport t2 = new_srtp(&single, reference_keys, false);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_EQ(0, VCALL(t2, transmit, slices[i]));
+        ASSERT_EQ(single.packet_sizes[i], fake.packet_sizes[i]);
+        ASSERT_MEM_EQ(single.packets[i], fake.packets[i], fake.packet_sizes[i]);
+    }
+
+    // A malformed packet is rejected.
+    bufs[0].iov_len = 11;
+    errno = 0;
+    ASSERT_EQ(-1, VCALL(t, transmit, slices[0]));
+    ASSERT_EQ(EINVAL, errno);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VCALL_SUPER(t2, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST max_packet_size(void) {
+    FakeTransport fake;
+    SmolRTSP_Transport t = new_srtp(&fake, reference_keys, false);
+
+    ASSERT_EQ(0, VCALL(t, max_packet_size));
+    fake.max_packet_size = 1200;
+    ASSERT_EQ(1190, VCALL(t, max_packet_size));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    PASS();
+}
+
+TEST sdp(void) {
+    char buffer[128] = {0};
+    const ssize_t ret = SmolRTSP_SrtpKeys_sdp(
+        reference_keys, smolrtsp_string_writer(buffer), 1);
+
+    const char *expected =
+        "a=crypto:1 AES_CM_128_HMAC_SHA1_80 "
+        "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqvm\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    SmolRTSP_SrtpKeys keys;
+    ASSERT_EQ(
+        0, SmolRTSP_SrtpKeys_parse_sdp(
+               &keys, CharSlice99_from_str(
+                          "1 AES_CM_128_HMAC_SHA1_32 "
+                          "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqvm|2^20"
+                          " KDR=0")));
+    ASSERT_EQ(SmolRTSP_SrtpSuite_AesCm128HmacSha1_32, keys.suite);
+    ASSERT_MEM_EQ(
+        reference_keys.master_key, keys.master_key, sizeof keys.master_key);
+    ASSERT_MEM_EQ(
+        reference_keys.master_salt, keys.master_salt, sizeof keys.master_salt);
+
+    const char *malformed[] = {
+        "",
+        "x AES_CM_128_HMAC_SHA1_80 "
+        "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqvm",
+        "1 AEAD_AES_128_GCM inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqvm",
+        "1 AES_CM_128_HMAC_SHA1_80 "
+        "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYL",
+        "1 AES_CM_128_HMAC_SHA1_80 "
+        "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqv!",
+        // An MKI.
+        "1 AES_CM_128_HMAC_SHA1_80 "
+        "inline:4fl6DT4Bi+DWT6MsBt5BOQ7Gda1Jiv7rtpYLOqvm|2^20|1:4",
+    };
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(malformed); i++) {
+        errno = 0;
+        ASSERT_EQ(
+            -1, SmolRTSP_SrtpKeys_parse_sdp(
+                    &keys, CharSlice99_from_str((char *)malformed[i])));
+        ASSERT_EQ(EINVAL, errno);
+    }
+
+    SmolRTSP_SrtpKeys a, b;
+    ASSERT_EQ(
+        0, SmolRTSP_SrtpKeys_generate(
+               &a, SmolRTSP_SrtpSuite_AesCm128HmacSha1_80));
+    ASSERT_EQ(
+        0, SmolRTSP_SrtpKeys_generate(
+               &b, SmolRTSP_SrtpSuite_AesCm128HmacSha1_80));
+    ASSERT(memcmp(a.master_key, b.master_key, sizeof a.master_key) != 0);
+
+    PASS();
+}
+
+SUITE(srtp) {
+    RUN_TEST(protect_rtp);
+    RUN_TEST(rollover_counter);
+    RUN_TEST(protect_rtcp);
+    RUN_TEST(batch);
+    RUN_TEST(max_packet_size);
+    RUN_TEST(sdp);
+}
@@ -0,0 +1,196 @@
+#include <smolrtsp/tcp_scheduler.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#define PAYLOAD_SIZE 60
+#define PACKET_SIZE  (4 + PAYLOAD_SIZE)
+
+static char output[4096];
+static SmolRTSP_StringBuffer out;
+
+static SmolRTSP_TcpScheduler *
+new_scheduler(size_t max_filled, size_t max_queued, size_t quantum) {
+    out = SmolRTSP_StringBuffer_new(output, sizeof output);
+
+    return SmolRTSP_TcpScheduler_new(
+        smolrtsp_string_buffer_writer(&out),
+        (SmolRTSP_TcpSchedulerConfig){
+            .max_filled = max_filled,
+            .max_queued = max_queued,
+            .quantum = quantum,
+        });
+}
+
+// Pretends that the peer has received the whole output.
+static void drain(void) {
+    out.len = 0;
+}
+
+static int transmit(SmolRTSP_Transport t, size_t payload_size) {
+    char payload[PAYLOAD_SIZE] = {0};
+    struct iovec bufs[] = {
+        {.iov_base = payload, .iov_len = 1},
+        {.iov_base = payload + 1, .iov_len = payload_size - 1},
+    };
+
+    return VCALL(
+        t, transmit, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs));
+}
+
+static void drop_transport(SmolRTSP_Transport t) {
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+}
+
+static void drop_scheduler(SmolRTSP_TcpScheduler *scheduler) {
+    VTABLE(SmolRTSP_TcpScheduler, SmolRTSP_Droppable).drop(scheduler);
+}
+
+TEST strict_priority(void) {
+    SmolRTSP_TcpScheduler *scheduler = new_scheduler(100, 4096, 1500);
+    ASSERT(scheduler);
+
+    const uint8_t video_id = 0, audio_id = 2;
+    ASSERT_EQ(
+        0, SmolRTSP_TcpScheduler_set_class(
+               scheduler, audio_id,
+               (SmolRTSP_TcpChannelClass){.priority = 1, .weight = 1}));
+
+    SmolRTSP_Transport video =
+        smolrtsp_transport_tcp_scheduled(scheduler, video_id, 0);
+    SmolRTSP_Transport audio =
+        smolrtsp_transport_tcp_scheduled(scheduler, audio_id, 0);
+    ASSERT(video.self && audio.self);
+
+    // The first two packets of the burst are written at once, and the rest is
+    // held back.
+    for (size_t i = 0; i < 5; i++) {
+        ASSERT_EQ(0, transmit(video, PAYLOAD_SIZE));
+    }
+    ASSERT_EQ(2 * PACKET_SIZE, out.len);
+    ASSERT_EQ(3 * PACKET_SIZE, SmolRTSP_TcpScheduler_pending(scheduler));
+
+    ASSERT_EQ(0, transmit(audio, 10));
+    ASSERT_EQ(2 * PACKET_SIZE, out.len);
+
+    // The audio packet goes out first.
+    drain();
+    ASSERT_EQ(3, SmolRTSP_TcpScheduler_flush(scheduler));
+    ASSERT_EQ(14 + 2 * PACKET_SIZE, out.len);
+    ASSERT_EQ('$', output[0]);
+    ASSERT_EQ(audio_id, output[1]);
+    ASSERT_EQ('$', output[14]);
+    ASSERT_EQ(video_id, output[15]);
+    ASSERT_EQ('$', output[14 + PACKET_SIZE]);
+
+    // Nothing is written while the writer is filled.
+    ASSERT_EQ(0, SmolRTSP_TcpScheduler_flush(scheduler));
+
+    drain();
+    ASSERT_EQ(1, SmolRTSP_TcpScheduler_flush(scheduler));
+    ASSERT_EQ(PACKET_SIZE, out.len);
+    ASSERT_EQ(0, SmolRTSP_TcpScheduler_pending(scheduler));
+
+    const SmolRTSP_TcpSchedulerStats stats =
+        SmolRTSP_TcpScheduler_stats(scheduler);
+    ASSERT_EQ(2, stats.direct);
+    ASSERT_EQ(4, stats.queued);
+    ASSERT_EQ(1, stats.overtakes);
+    ASSERT_EQ(0, stats.rejected);
+
+    ASSERT_EQ(5, VCALL(video, stats).packets);
+    ASSERT_EQ(1, VCALL(audio, stats).packets);
+
+    drop_transport(video);
+    drop_transport(audio);
+    drop_scheduler(scheduler);
+    PASS();
+}
+
+TEST weighted(void) {
+    // A packet at a time, with a quantum of exactly one packet.
+    SmolRTSP_TcpScheduler *scheduler = new_scheduler(1, 4096, PACKET_SIZE);
+    ASSERT(scheduler);
+
+    ASSERT_EQ(
+        0, SmolRTSP_TcpScheduler_set_class(
+               scheduler, 0,
+               (SmolRTSP_TcpChannelClass){.priority = 0, .weight = 1}));
+    ASSERT_EQ(
+        0, SmolRTSP_TcpScheduler_set_class(
+               scheduler, 1,
+               (SmolRTSP_TcpChannelClass){.priority = 0, .weight = 3}));
+
+    SmolRTSP_Transport t[] = {
+        smolrtsp_transport_tcp_scheduled(scheduler, 0, 0),
+        smolrtsp_transport_tcp_scheduled(scheduler, 1, 0),
+    };
+
+    // The writer is filled, so everything is queued.
+    out.len = 1;
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_EQ(0, transmit(t[0], PAYLOAD_SIZE));
+        ASSERT_EQ(0, transmit(t[1], PAYLOAD_SIZE));
+    }
+    ASSERT_EQ(16 * PACKET_SIZE, SmolRTSP_TcpScheduler_pending(scheduler));
+
+    char order[9] = {0};
+    for (size_t i = 0; i < 8; i++) {
+        drain();
+        ASSERT_EQ(1, SmolRTSP_TcpScheduler_flush(scheduler));
+        ASSERT_EQ(PACKET_SIZE, out.len);
+        order[i] = (char)('0' + output[1]);
+    }
+    ASSERT_STR_EQ("11101110", order);
+
+    for (size_t i = 0; i < 2; i++) {
+        drop_transport(t[i]);
+    }
+    drop_scheduler(scheduler);
+    PASS();
+}
+
+TEST limits(void) {
+    SmolRTSP_TcpScheduler *scheduler =
+        new_scheduler(1, 2 * PACKET_SIZE, 1500);
+    ASSERT(scheduler);
+
+    SmolRTSP_Transport t =
+        smolrtsp_transport_tcp_scheduled(scheduler, 0, 2 * PACKET_SIZE);
+    ASSERT(t.self);
+
+    out.len = 1;
+    ASSERT(!VCALL(t, is_full));
+    ASSERT_EQ(0, transmit(t, PAYLOAD_SIZE));
+    ASSERT_EQ(0, transmit(t, PAYLOAD_SIZE));
+    ASSERT(VCALL(t, is_full));
+
+    ASSERT_EQ(-1, transmit(t, PAYLOAD_SIZE));
+    ASSERT_EQ(ENOBUFS, errno);
+    ASSERT_EQ(1, SmolRTSP_TcpScheduler_stats(scheduler).rejected);
+    ASSERT_EQ(1, VCALL(t, stats).errors_enobufs);
+
+    for (uint8_t id = 1; id < SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS; id++) {
+        ASSERT_EQ(
+            0, SmolRTSP_TcpScheduler_set_class(
+                   scheduler, id,
+                   (SmolRTSP_TcpChannelClass){.priority = 0, .weight = 1}));
+    }
+    ASSERT_EQ(
+        -1, SmolRTSP_TcpScheduler_set_class(
+                scheduler, SMOLRTSP_TCP_SCHEDULER_MAX_CHANNELS,
+                (SmolRTSP_TcpChannelClass){.priority = 0, .weight = 1}));
+    ASSERT_EQ(ENOSPC, errno);
+
+    drop_transport(t);
+    drop_scheduler(scheduler);
+    PASS();
+}
+
+SUITE(tcp_scheduler) {
+    RUN_TEST(strict_priority);
+    RUN_TEST(weighted);
+    RUN_TEST(limits);
+}
@@ -0,0 +1,173 @@
+#include <smolrtsp/timer_wheel.h>
+
+#include <greatest.h>
+
+typedef struct Stream {
+    SmolRTSP_TimerWheel *wheel;
+    SmolRTSP_Timer timer;
+
+    // The ticks at which the timer has fired.
+    uint64_t fired[8];
+    size_t fired_n;
+
+    // Re-arms every `period` ticks if non-zero.
+    uint64_t period;
+
+    // Cancelled on the first expiry if non-null.
+    SmolRTSP_Timer *victim;
+} Stream;
+
+static uint64_t Stream_on_timer(VSelf, uint64_t now) {
+    VSELF(Stream);
+
+    if (self->fired_n < sizeof self->fired / sizeof self->fired[0]) {
+        self->fired[self->fired_n] = now;
+    }
+    self->fired_n++;
+
+    if (self->victim != NULL) {
+        SmolRTSP_TimerWheel_cancel(self->wheel, self->victim);
+        self->victim = NULL;
+    }
+
+    return self->period;
+}
+
+impl(SmolRTSP_TimerHandler, Stream);
+
+static void Stream_init(Stream *self, SmolRTSP_TimerWheel *wheel) {
+    *self = (Stream){.wheel = wheel};
+    self->timer =
+        SmolRTSP_Timer_new(DYN(Stream, SmolRTSP_TimerHandler, self));
+}
+
+TEST fire_in_order(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(1000);
+
+    Stream streams[3];
+    for (size_t i = 0; i < 3; i++) {
+        Stream_init(&streams[i], wheel);
+    }
+
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[0].timer, 30);
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[1].timer, 10);
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[2].timer, 0);
+    ASSERT_EQ(3, SmolRTSP_TimerWheel_len(wheel));
+    ASSERT(SmolRTSP_Timer_is_pending(&streams[0].timer));
+
+    ASSERT_EQ(1, SmolRTSP_TimerWheel_advance(wheel, 1001));
+    ASSERT_EQ(1, streams[2].fired_n);
+    ASSERT_EQ(1001, streams[2].fired[0]);
+
+    // A late advance reports the scheduled ticks.
+    ASSERT_EQ(2, SmolRTSP_TimerWheel_advance(wheel, 1100));
+    ASSERT_EQ(1010, streams[1].fired[0]);
+    ASSERT_EQ(1030, streams[0].fired[0]);
+    ASSERT_EQ(1100, SmolRTSP_TimerWheel_now(wheel));
+
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_len(wheel));
+    ASSERT(!SmolRTSP_Timer_is_pending(&streams[0].timer));
+
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    PASS();
+}
+
+TEST periodic(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(0);
+
+    Stream stream;
+    Stream_init(&stream, wheel);
+    stream.period = 40;
+
+    SmolRTSP_TimerWheel_schedule(wheel, &stream.timer, 40);
+
+    // Irregular advances do not shift the period.
+    const uint64_t advances[] = {39, 45, 100, 101, 200};
+    for (size_t i = 0; i < sizeof advances / sizeof advances[0]; i++) {
+        (void)SmolRTSP_TimerWheel_advance(wheel, advances[i]);
+    }
+
+    ASSERT_EQ(5, stream.fired_n);
+    for (size_t i = 0; i < 5; i++) {
+        ASSERT_EQ(40 * (i + 1), stream.fired[i]);
+    }
+    ASSERT(SmolRTSP_Timer_is_pending(&stream.timer));
+
+    stream.period = 0;
+    ASSERT_EQ(1, SmolRTSP_TimerWheel_advance(wheel, 240));
+    ASSERT(!SmolRTSP_Timer_is_pending(&stream.timer));
+
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    PASS();
+}
+
+TEST cancel(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(0);
+
+    Stream streams[3];
+    for (size_t i = 0; i < 3; i++) {
+        Stream_init(&streams[i], wheel);
+    }
+
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[0].timer, 5);
+    SmolRTSP_TimerWheel_cancel(wheel, &streams[0].timer);
+    SmolRTSP_TimerWheel_cancel(wheel, &streams[0].timer);
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_len(wheel));
+
+    // Rescheduling moves a pending timer.
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[0].timer, 5);
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[0].timer, 8);
+    ASSERT_EQ(1, SmolRTSP_TimerWheel_len(wheel));
+
+    // A handler can cancel a timer expiring at the same tick.
+    streams[1].victim = &streams[2].timer;
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[1].timer, 10);
+    SmolRTSP_TimerWheel_schedule(wheel, &streams[2].timer, 10);
+
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_advance(wheel, 7));
+    ASSERT_EQ(2, SmolRTSP_TimerWheel_advance(wheel, 10));
+    ASSERT_EQ(8, streams[0].fired[0]);
+    ASSERT_EQ(1, streams[1].fired_n);
+    ASSERT_EQ(0, streams[2].fired_n);
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_len(wheel));
+
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    PASS();
+}
+
+TEST long_delays(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(123);
+
+    const uint64_t delays[] = {70, 5000, 300000, 20000000, 40000000};
+    enum { DELAYS_N = sizeof delays / sizeof delays[0] };
+
+    Stream streams[DELAYS_N];
+    for (size_t i = 0; i < DELAYS_N; i++) {
+        Stream_init(&streams[i], wheel);
+        SmolRTSP_TimerWheel_schedule(wheel, &streams[i].timer, delays[i]);
+    }
+
+    for (size_t i = 0; i < DELAYS_N; i++) {
+        ASSERT_EQ(0, SmolRTSP_TimerWheel_advance(wheel, 123 + delays[i] - 1));
+        ASSERT_EQ(1, SmolRTSP_TimerWheel_advance(wheel, 123 + delays[i]));
+        ASSERT_EQ(1, streams[i].fired_n);
+        ASSERT_EQ(123 + delays[i], streams[i].fired[0]);
+    }
+
+    // Pending timers are merely unlinked on drop.
+    Stream stream;
+    Stream_init(&stream, wheel);
+    SmolRTSP_TimerWheel_schedule(wheel, &stream.timer, 1000);
+
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    ASSERT(!SmolRTSP_Timer_is_pending(&stream.timer));
+
+    PASS();
+}
+
+SUITE(timer_wheel) {
+    RUN_TEST(fire_in_order);
+    RUN_TEST(periodic);
+    RUN_TEST(cancel);
+    RUN_TEST(long_delays);
+}
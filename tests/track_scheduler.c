@@ -0,0 +1,126 @@
+#include <smolrtsp/track_scheduler.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+
+typedef struct {
+    // Runs every `period` ticks, `runs_limit` times if non-zero.
+    uint64_t period;
+    size_t runs_limit;
+
+    // The due ticks at which the track has run.
+    uint64_t runs[16];
+    size_t runs_n;
+} Track;
+
+static uint64_t Track_on_timer(VSelf, uint64_t now) {
+    VSELF(Track);
+
+    if (self->runs_n < sizeof self->runs / sizeof self->runs[0]) {
+        self->runs[self->runs_n] = now;
+    }
+    self->runs_n++;
+
+    return self->runs_limit > 0 && self->runs_n == self->runs_limit
+               ? 0
+               : self->period;
+}
+
+impl(SmolRTSP_TimerHandler, Track);
+
+TEST coalesce_tracks(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(0);
+    ASSERT(wheel);
+
+    SmolRTSP_TrackSchedulerConfig config =
+        SmolRTSP_TrackSchedulerConfig_default();
+    config.slack = 5;
+    SmolRTSP_TrackScheduler *scheduler =
+        SmolRTSP_TrackScheduler_new(wheel, config);
+    ASSERT(scheduler);
+
+    // Audio every 20 ms, and video every 40 ms a bit later.
+    Track audio = {.period = 20}, video = {.period = 40};
+    ASSERT_EQ(
+        0, SmolRTSP_TrackScheduler_add(
+               scheduler, DYN(Track, SmolRTSP_TimerHandler, &audio), 20));
+    ASSERT_EQ(
+        0, SmolRTSP_TrackScheduler_add(
+               scheduler, DYN(Track, SmolRTSP_TimerHandler, &video), 25));
+    ASSERT_EQ(2, SmolRTSP_TrackScheduler_len(scheduler));
+    ASSERT_EQ(1, SmolRTSP_TimerWheel_len(wheel));
+
+    for (uint64_t now = 1; now <= 200; now++) {
+        SmolRTSP_TimerWheel_advance(wheel, now);
+    }
+
+    // The video runs together with the audio, without a wakeup of its own.
+    ASSERT_EQ(10, audio.runs_n);
+    ASSERT_EQ(5, video.runs_n);
+    const SmolRTSP_TrackSchedulerStats stats =
+        SmolRTSP_TrackScheduler_stats(scheduler);
+    ASSERT_EQ(10, stats.wakeups);
+    ASSERT_EQ(15, stats.runs);
+
+    // A track runs at its due ticks rather than at the wakeups, so that it
+    // does not drift.
+    ASSERT_EQ(20, audio.runs[0]);
+    ASSERT_EQ(25, video.runs[0]);
+    ASSERT_EQ(65, video.runs[1]);
+
+    VTABLE(SmolRTSP_TrackScheduler, SmolRTSP_Droppable).drop(scheduler);
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_len(wheel));
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    PASS();
+}
+
+TEST remove_finished_tracks(void) {
+    SmolRTSP_TimerWheel *wheel = SmolRTSP_TimerWheel_new(100);
+    ASSERT(wheel);
+    SmolRTSP_TrackScheduler *scheduler = SmolRTSP_TrackScheduler_new(
+        wheel, SmolRTSP_TrackSchedulerConfig_default());
+    ASSERT(scheduler);
+
+    Track tracks[SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS + 1];
+    for (size_t i = 0; i < SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS; i++) {
+        tracks[i] = (Track){.period = 10, .runs_limit = i + 1};
+        ASSERT_EQ(
+            0, SmolRTSP_TrackScheduler_add(
+                   scheduler, DYN(Track, SmolRTSP_TimerHandler, &tracks[i]),
+                   10));
+    }
+
+    errno = 0;
+    tracks[SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS] = (Track){.period = 10};
+    ASSERT_EQ(
+        -1,
+        SmolRTSP_TrackScheduler_add(
+            scheduler,
+            DYN(Track, SmolRTSP_TimerHandler,
+                &tracks[SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS]),
+            10));
+    ASSERT_EQ(ENOSPC, errno);
+
+    // Every track stops after its runs; the scheduler stops after the last.
+    for (uint64_t now = 101; now <= 300; now++) {
+        SmolRTSP_TimerWheel_advance(wheel, now);
+    }
+    for (size_t i = 0; i < SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS; i++) {
+        ASSERT_EQ(i + 1, tracks[i].runs_n);
+    }
+    ASSERT_EQ(0, SmolRTSP_TrackScheduler_len(scheduler));
+    ASSERT_EQ(0, SmolRTSP_TimerWheel_len(wheel));
+    ASSERT_EQ(
+        SMOLRTSP_TRACK_SCHEDULER_MAX_TRACKS,
+        SmolRTSP_TrackScheduler_stats(scheduler).wakeups);
+
+    VTABLE(SmolRTSP_TrackScheduler, SmolRTSP_Droppable).drop(scheduler);
+    VTABLE(SmolRTSP_TimerWheel, SmolRTSP_Droppable).drop(wheel);
+    PASS();
+}
+
+SUITE(track_scheduler) {
+    RUN_TEST(coalesce_tracks);
+    RUN_TEST(remove_finished_tracks);
+}
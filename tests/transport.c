@@ -3,10 +3,12 @@
 #include <greatest.h>
 
 #include <arpa/inet.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -73,6 +75,513 @@ TEST check_udp(void) {
     PASS();
 }
 
+static enum greatest_test_res test_transport_batch(
+    SmolRTSP_Transport t, int read_fd, size_t len,
+    const char expected[restrict static len]) {
+    struct iovec bufs_0[] = {
+        {.iov_base = DATA_0, .iov_len = sizeof((char[]){DATA_0}) - 1},
+    };
+    struct iovec bufs_1[] = {
+        {.iov_base = DATA_1, .iov_len = sizeof((char[]){DATA_1}) - 1},
+    };
+
+    SmolRTSP_IoVecSlice packets[] = {
+        Slice99_typed_from_array(bufs_0),
+        Slice99_typed_from_array(bufs_1),
+    };
+
+    const size_t ret = smolrtsp_transmit_batch(
+        t, (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets));
+    ASSERT_EQ(2, ret);
+
+    char *buffer = malloc(len);
+    size_t received = 0;
+    while (received < len) {
+        const ssize_t n = read(read_fd, buffer + received, len - received);
+        ASSERT(n > 0);
+        received += n;
+    }
+    ASSERT_MEM_EQ(expected, buffer, len);
+    free(buffer);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+
+    PASS();
+}
+
+TEST check_tcp_batch(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    const uint8_t chn_id = 7;
+
+    SmolRTSP_Transport tcp =
+        smolrtsp_transport_tcp(smolrtsp_fd_writer(&fds[0]), chn_id, 0);
+
+    const char expected[] = {'$', chn_id, 0,   strlen(DATA_0), 'a', 'b', 'c',
+                             '$', chn_id, 0,   strlen(DATA_1), 'd', 'e', 'f',
+                             'g', 'h',    'i'};
+
+    CHECK_CALL(test_transport_batch(tcp, fds[1], sizeof expected, expected));
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_tcp_empty_vectors(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    const uint8_t chn_id = 3;
+
+    SmolRTSP_Transport tcp =
+        smolrtsp_transport_tcp(smolrtsp_fd_writer(&fds[0]), chn_id, 0);
+
+    // A packet without a payload header, as sent from a pre-packetized file.
+    struct iovec bufs[] = {
+        {.iov_base = DATA_0, .iov_len = sizeof((char[]){DATA_0}) - 1},
+        {.iov_base = NULL, .iov_len = 0},
+        {.iov_base = DATA_1, .iov_len = sizeof((char[]){DATA_1}) - 1},
+    };
+    SmolRTSP_IoVecSlice packets[] = {
+        Slice99_typed_from_array(bufs),
+        Slice99_typed_from_array(bufs),
+    };
+
+    const size_t ret = smolrtsp_transmit_batch(
+        tcp, (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets));
+    ASSERT_EQ(2, ret);
+    ASSERT_EQ(0, VCALL(tcp, transmit, packets[0]));
+
+    const char total_len = strlen(DATA_0) + strlen(DATA_1);
+    const char packet[] = {'$', chn_id, 0,   total_len, 'a', 'b', 'c',
+                           'd', 'e',    'f', 'g',       'h', 'i'};
+
+    for (size_t i = 0; i < 3; i++) {
+        char buffer[sizeof packet];
+        size_t received = 0;
+        while (received < sizeof buffer) {
+            const ssize_t n =
+                read(fds[1], buffer + received, sizeof buffer - received);
+            ASSERT(n > 0);
+            received += n;
+        }
+        ASSERT_MEM_EQ(packet, buffer, sizeof packet);
+    }
+
+    VCALL_SUPER(tcp, SmolRTSP_Droppable, drop);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_udp_batch(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    SmolRTSP_Transport udp = smolrtsp_transport_udp(fds[0]);
+
+    // `SOCK_SEQPACKET` preserves message boundaries, so read each datagram
+    // separately.
+    char expected[] = {DATA_0};
+    struct iovec bufs[] = {
+        {.iov_base = DATA_0, .iov_len = strlen(DATA_0)},
+    };
+    SmolRTSP_IoVecSlice packets[] = {
+        Slice99_typed_from_array(bufs),
+        Slice99_typed_from_array(bufs),
+    };
+
+    const size_t ret = smolrtsp_transmit_batch(
+        udp, (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets));
+    ASSERT_EQ(2, ret);
+
+    for (size_t i = 0; i < 2; i++) {
+        char buffer[16];
+        const ssize_t n = read(fds[1], buffer, sizeof buffer);
+        ASSERT_EQ((ssize_t)strlen(expected), n);
+        ASSERT_MEM_EQ(expected, buffer, strlen(expected));
+    }
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_udp_gso(void) {
+    const int recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT(recv_fd != -1);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    ASSERT_EQ(0, bind(recv_fd, (const struct sockaddr *)&addr, sizeof addr));
+    ASSERT_EQ(0, getsockname(recv_fd, (struct sockaddr *)&addr, &addr_len));
+
+    const int send_fd =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    ASSERT(send_fd != -1);
+
+    SmolRTSP_UdpTransportConfig config = SmolRTSP_UdpTransportConfig_default();
+    config.gso = true;
+    SmolRTSP_Transport udp =
+        smolrtsp_transport_udp_with_config(send_fd, config);
+
+    // Four full-sized segments and a shorter one, which is the shape of an FU
+    // fragment train. The result must be the same with or without GSO.
+    static char data[4 * 100 + 30];
+    for (size_t i = 0; i < sizeof data; i++) {
+        data[i] = (char)i;
+    }
+
+    struct iovec bufs[5][2];
+    SmolRTSP_IoVecSlice packets[5];
+    for (size_t i = 0; i < 5; i++) {
+        const size_t size = 4 == i ? 30 : 100;
+        bufs[i][0] = (struct iovec){data + i * 100, 10};
+        bufs[i][1] = (struct iovec){data + i * 100 + 10, size - 10};
+        packets[i] = (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs[i]);
+    }
+
+    const size_t ret = smolrtsp_transmit_batch(
+        udp, (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets));
+    ASSERT_EQ(5, ret);
+
+    for (size_t i = 0; i < 5; i++) {
+        char buffer[256];
+        const ssize_t n = recv(recv_fd, buffer, sizeof buffer, 0);
+        ASSERT_EQ(4 == i ? 30 : 100, n);
+        ASSERT_MEM_EQ(data + i * 100, buffer, n);
+    }
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+
+    close(send_fd);
+    close(recv_fd);
+    PASS();
+}
+
+TEST check_udp_gso_einval(void) {
+#ifdef UDP_GRO
+    const int recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT(recv_fd != -1);
+
+    // The receiver coalesces a super-buffer back, so that it can tell GSO
+    // from `sendmmsg`.
+    const int on = 1, off = 0;
+    ASSERT_EQ(0, setsockopt(recv_fd, SOL_UDP, UDP_GRO, &on, sizeof on));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    ASSERT_EQ(0, bind(recv_fd, (const struct sockaddr *)&addr, sizeof addr));
+    ASSERT_EQ(0, getsockname(recv_fd, (struct sockaddr *)&addr, &addr_len));
+
+    const int send_fd =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    ASSERT(send_fd != -1);
+    if (!smolrtsp_udp_gso_supported(send_fd)) {
+        close(send_fd);
+        close(recv_fd);
+        SKIP();
+    }
+
+    SmolRTSP_UdpTransportConfig config = SmolRTSP_UdpTransportConfig_default();
+    config.gso = true;
+    SmolRTSP_Transport udp =
+        smolrtsp_transport_udp_with_config(send_fd, config);
+    const size_t max_packet_size = VCALL(udp, max_packet_size);
+
+    static char data[3 * 100];
+    struct iovec bufs[3];
+    SmolRTSP_IoVecSlice packets[3];
+    for (size_t i = 0; i < 3; i++) {
+        bufs[i] = (struct iovec){data + i * 100, 100};
+        packets[i] = (SmolRTSP_IoVecSlice){&bufs[i], 1};
+    }
+    const SmolRTSP_IoVecBatch batch =
+        (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets);
+
+    char buffer[sizeof data];
+
+    // Without UDP checksums, the kernel rejects GSO with `EINVAL`, as it does
+    // segments exceeding the path MTU. The segments still fit, so the batch is
+    // sent anyway.
+    ASSERT_EQ(
+        0, setsockopt(send_fd, SOL_SOCKET, SO_NO_CHECK, &on, sizeof on));
+    ASSERT_EQ(3, smolrtsp_transmit_batch(udp, batch));
+    ASSERT_EQ(max_packet_size, VCALL(udp, max_packet_size));
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_EQ(100, recv(recv_fd, buffer, sizeof buffer, 0));
+    }
+
+    // GSO has not been disabled.
+    ASSERT_EQ(
+        0, setsockopt(send_fd, SOL_SOCKET, SO_NO_CHECK, &off, sizeof off));
+    ASSERT_EQ(3, smolrtsp_transmit_batch(udp, batch));
+    ASSERT_EQ((ssize_t)sizeof data, recv(recv_fd, buffer, sizeof buffer, 0));
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+
+    close(send_fd);
+    close(recv_fd);
+    PASS();
+#else
+    SKIP();
+#endif
+}
+
+TEST check_max_packet_size(void) {
+    const int recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT(recv_fd != -1);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    ASSERT_EQ(0, bind(recv_fd, (const struct sockaddr *)&addr, sizeof addr));
+    ASSERT_EQ(0, getsockname(recv_fd, (struct sockaddr *)&addr, &addr_len));
+
+    const int send_fd =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    ASSERT(send_fd != -1);
+
+    // The path MTU of the loopback interface minus the IP and UDP headers.
+    SmolRTSP_Transport udp = smolrtsp_transport_udp(send_fd);
+    const size_t max_packet_size = VCALL(udp, max_packet_size);
+    ASSERT(max_packet_size >= 1500 - 28);
+    ASSERT(max_packet_size <= 65535 - 28);
+
+    // An oversized datagram is rejected at once.
+    static char data[65536];
+    struct iovec bufs[] = {{data, sizeof data}};
+    errno = 0;
+    ASSERT_EQ(
+        -1, VCALL(
+                udp, transmit,
+                (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs)));
+    ASSERT_EQ(EMSGSIZE, errno);
+    ASSERT_EQ(max_packet_size, VCALL(udp, max_packet_size));
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+    close(send_fd);
+    close(recv_fd);
+
+    // No limit is known for local and stream sockets.
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    SmolRTSP_Transport local = smolrtsp_transport_udp(fds[0]),
+                       tcp = smolrtsp_transport_tcp(
+                           smolrtsp_fd_writer(&fds[0]), 0, 0);
+    ASSERT_EQ(0, VCALL(local, max_packet_size));
+    ASSERT_EQ(0, VCALL(tcp, max_packet_size));
+
+    VCALL_SUPER(local, SmolRTSP_Droppable, drop);
+    VCALL_SUPER(tcp, SmolRTSP_Droppable, drop);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_udp_zerocopy(void) {
+    const int recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT(recv_fd != -1);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    ASSERT_EQ(0, bind(recv_fd, (const struct sockaddr *)&addr, sizeof addr));
+    ASSERT_EQ(0, getsockname(recv_fd, (struct sockaddr *)&addr, &addr_len));
+
+    const int send_fd =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    ASSERT(send_fd != -1);
+
+    SmolRTSP_ZeroCopyState state = {0};
+    SmolRTSP_UdpTransportConfig config = SmolRTSP_UdpTransportConfig_default();
+    config.zerocopy_threshold = 1000;
+    config.zerocopy_state = &state;
+    SmolRTSP_Transport udp =
+        smolrtsp_transport_udp_with_config(send_fd, config);
+
+    static char small[10], large[1200];
+    memset(small, 'a', sizeof small);
+    memset(large, 'b', sizeof large);
+
+    struct iovec small_buf = {small, sizeof small},
+                 large_buf = {large, sizeof large};
+
+    ASSERT_EQ(0, VCALL(udp, transmit, (SmolRTSP_IoVecSlice){&small_buf, 1}));
+    ASSERT_EQ(0, VCALL(udp, transmit, (SmolRTSP_IoVecSlice){&large_buf, 1}));
+
+    // Only the large packet goes through `MSG_ZEROCOPY` (if the kernel
+    // supports it at all).
+    ASSERT(state.sent <= 1);
+    const uint32_t mark = state.sent;
+
+    for (int attempt = 0; attempt < 100; attempt++) {
+        ASSERT(smolrtsp_zerocopy_reap(send_fd, &state) != -1);
+        if (SmolRTSP_ZeroCopyState_is_released(state, mark)) {
+            break;
+        }
+        usleep(1000);
+    }
+    ASSERT(SmolRTSP_ZeroCopyState_is_released(state, mark));
+    ASSERT_EQ(mark, state.completed);
+
+    char buffer[2048];
+    ASSERT_EQ((ssize_t)sizeof small, recv(recv_fd, buffer, sizeof buffer, 0));
+    ASSERT_MEM_EQ(small, buffer, sizeof small);
+    ASSERT_EQ((ssize_t)sizeof large, recv(recv_fd, buffer, sizeof buffer, 0));
+    ASSERT_MEM_EQ(large, buffer, sizeof large);
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+
+    close(send_fd);
+    close(recv_fd);
+    PASS();
+}
+
+TEST check_udp_tx_timestamps(void) {
+    const int recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT(recv_fd != -1);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addr_len = sizeof addr;
+    ASSERT_EQ(0, bind(recv_fd, (const struct sockaddr *)&addr, sizeof addr));
+    ASSERT_EQ(0, getsockname(recv_fd, (struct sockaddr *)&addr, &addr_len));
+
+    const int send_fd =
+        smolrtsp_dgram_socket(AF_INET, &addr.sin_addr, ntohs(addr.sin_port));
+    ASSERT(send_fd != -1);
+
+    SmolRTSP_LatencyHistogram histogram = {0};
+    SmolRTSP_TxTimestampsConfig timestamps_config =
+        SmolRTSP_TxTimestampsConfig_default();
+    timestamps_config.capacity = 4;
+    timestamps_config.software = &histogram;
+    SmolRTSP_TxTimestamps *timestamps =
+        SmolRTSP_TxTimestamps_new(timestamps_config);
+    ASSERT(timestamps);
+
+    SmolRTSP_UdpTransportConfig config = SmolRTSP_UdpTransportConfig_default();
+    config.tx_timestamps = timestamps;
+    SmolRTSP_Transport udp =
+        smolrtsp_transport_udp_with_config(send_fd, config);
+
+    static char data[100];
+    memset(data, 'a', sizeof data);
+    struct iovec buf = {data, sizeof data};
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(0, VCALL(udp, transmit, (SmolRTSP_IoVecSlice){&buf, 1}));
+    }
+
+    // The loopback device reports software timestamps (if the kernel supports
+    // them at all), every one matching its transmission.
+    SmolRTSP_TxTimestampsStats stats = {0};
+    for (int attempt = 0; attempt < 100 && stats.software < 3; attempt++) {
+        ASSERT(SmolRTSP_TxTimestamps_reap(timestamps, send_fd, NULL) != -1);
+        stats = SmolRTSP_TxTimestamps_stats(timestamps);
+        usleep(1000);
+    }
+    ASSERT(stats.software <= 3);
+    ASSERT_EQ(0, stats.hardware);
+    ASSERT_EQ(0, stats.unmatched);
+    ASSERT_EQ(stats.software, histogram.total_count);
+
+    char buffer[2048];
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(
+            (ssize_t)sizeof data, recv(recv_fd, buffer, sizeof buffer, 0));
+    }
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_TxTimestamps, SmolRTSP_Droppable).drop(timestamps);
+
+    close(send_fd);
+    close(recv_fd);
+    PASS();
+}
+
+TEST check_stats(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    SmolRTSP_Transport udp = smolrtsp_transport_udp(fds[0]),
+                       tcp = smolrtsp_transport_tcp(
+                           smolrtsp_fd_writer(&fds[0]), 0, 0);
+
+    struct iovec bufs[] = {{.iov_base = DATA_0, .iov_len = strlen(DATA_0)}};
+    const SmolRTSP_IoVecSlice packet = Slice99_typed_from_array(bufs);
+    SmolRTSP_IoVecSlice packets[] = {packet, packet};
+    const SmolRTSP_IoVecBatch batch = Slice99_typed_from_array(packets);
+
+    ASSERT_EQ(0, VCALL(udp, transmit, packet));
+    ASSERT_EQ(2, smolrtsp_transmit_batch(udp, batch));
+    ASSERT_EQ(0, VCALL(tcp, transmit, packet));
+
+    SmolRTSP_TransportStats stats = VCALL(udp, stats);
+    ASSERT_EQ(3, stats.packets);
+    ASSERT_EQ(3 * strlen(DATA_0), stats.bytes);
+
+    stats = VCALL(tcp, stats);
+    ASSERT_EQ(1, stats.packets);
+    ASSERT_EQ(strlen(DATA_0), stats.bytes);
+
+    // A datagram larger than the socket buffer.
+    static char data[4 * 1024 * 1024];
+    struct iovec oversized[] = {{.iov_base = data, .iov_len = sizeof data}};
+    ASSERT_EQ(
+        -1, VCALL(
+                udp, transmit,
+                (SmolRTSP_IoVecSlice)Slice99_typed_from_array(oversized)));
+
+    stats = VCALL(udp, stats);
+    ASSERT_EQ(3, stats.packets);
+    ASSERT_EQ(1, stats.errors_emsgsize);
+    ASSERT_EQ(0, stats.errors_other);
+
+    VCALL_SUPER(udp, SmolRTSP_Droppable, drop);
+    VCALL_SUPER(tcp, SmolRTSP_Droppable, drop);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST zerocopy_state_wraparound(void) {
+    const SmolRTSP_ZeroCopyState state = {
+        .sent = 2, .completed = 1, .copied = 0};
+
+    ASSERT(SmolRTSP_ZeroCopyState_is_released(state, 0));
+    ASSERT(SmolRTSP_ZeroCopyState_is_released(state, 1));
+    ASSERT_FALSE(SmolRTSP_ZeroCopyState_is_released(state, 2));
+    ASSERT(SmolRTSP_ZeroCopyState_is_released(state, UINT32_MAX));
+
+    PASS();
+}
+
 TEST sockaddr_get_ipv4(void) {
     struct sockaddr_storage addr;
     memset(&addr, '\0', sizeof addr);
@@ -110,6 +619,16 @@ TEST sockaddr_get_unknown(void) {
 SUITE(transport) {
     RUN_TEST(check_tcp);
     RUN_TEST(check_udp);
+    RUN_TEST(check_tcp_batch);
+    RUN_TEST(check_tcp_empty_vectors);
+    RUN_TEST(check_udp_batch);
+    RUN_TEST(check_udp_gso);
+    RUN_TEST(check_udp_gso_einval);
+    RUN_TEST(check_max_packet_size);
+    RUN_TEST(check_udp_zerocopy);
+    RUN_TEST(check_udp_tx_timestamps);
+    RUN_TEST(check_stats);
+    RUN_TEST(zerocopy_state_wraparound);
     RUN_TEST(sockaddr_get_ipv4);
     RUN_TEST(sockaddr_get_ipv6);
     RUN_TEST(sockaddr_get_unknown);
@@ -41,7 +41,76 @@ TEST serialize_header(void) {
     PASS();
 }
 
+TEST header_id_from_key(void) {
+    const struct {
+        CharSlice99 key;
+        SmolRTSP_HeaderId id;
+    } well_known[] = {
+        {SMOLRTSP_HEADER_ACCEPT, SmolRTSP_HeaderId_Accept},
+        {SMOLRTSP_HEADER_ACCEPT_ENCODING, SmolRTSP_HeaderId_AcceptEncoding},
+        {SMOLRTSP_HEADER_ACCEPT_LANGUAGE, SmolRTSP_HeaderId_AcceptLanguage},
+        {SMOLRTSP_HEADER_ALLOW, SmolRTSP_HeaderId_Allow},
+        {SMOLRTSP_HEADER_AUTHORIZATION, SmolRTSP_HeaderId_Authorization},
+        {SMOLRTSP_HEADER_BANDWIDTH, SmolRTSP_HeaderId_Bandwidth},
+        {SMOLRTSP_HEADER_BLOCKSIZE, SmolRTSP_HeaderId_Blocksize},
+        {SMOLRTSP_HEADER_CACHE_CONTROL, SmolRTSP_HeaderId_CacheControl},
+        {SMOLRTSP_HEADER_CONFERENCE, SmolRTSP_HeaderId_Conference},
+        {SMOLRTSP_HEADER_CONNECTION, SmolRTSP_HeaderId_Connection},
+        {SMOLRTSP_HEADER_CONTENT_BASE, SmolRTSP_HeaderId_ContentBase},
+        {SMOLRTSP_HEADER_CONTENT_ENCODING, SmolRTSP_HeaderId_ContentEncoding},
+        {SMOLRTSP_HEADER_CONTENT_LANGUAGE, SmolRTSP_HeaderId_ContentLanguage},
+        {SMOLRTSP_HEADER_CONTENT_LENGTH, SmolRTSP_HeaderId_ContentLength},
+        {SMOLRTSP_HEADER_CONTENT_LOCATION, SmolRTSP_HeaderId_ContentLocation},
+        {SMOLRTSP_HEADER_CONTENT_TYPE, SmolRTSP_HeaderId_ContentType},
+        {SMOLRTSP_HEADER_C_SEQ, SmolRTSP_HeaderId_CSeq},
+        {SMOLRTSP_HEADER_DATE, SmolRTSP_HeaderId_Date},
+        {SMOLRTSP_HEADER_EXPIRES, SmolRTSP_HeaderId_Expires},
+        {SMOLRTSP_HEADER_FROM, SmolRTSP_HeaderId_From},
+        {SMOLRTSP_HEADER_IF_MODIFIED_SINCE, SmolRTSP_HeaderId_IfModifiedSince},
+        {SMOLRTSP_HEADER_LAST_MODIFIED, SmolRTSP_HeaderId_LastModified},
+        {SMOLRTSP_HEADER_PROXY_AUTHENTICATE,
+         SmolRTSP_HeaderId_ProxyAuthenticate},
+        {SMOLRTSP_HEADER_PROXY_REQUIRE, SmolRTSP_HeaderId_ProxyRequire},
+        {SMOLRTSP_HEADER_PUBLIC, SmolRTSP_HeaderId_Public},
+        {SMOLRTSP_HEADER_RANGE, SmolRTSP_HeaderId_Range},
+        {SMOLRTSP_HEADER_REFERER, SmolRTSP_HeaderId_Referer},
+        {SMOLRTSP_HEADER_REQUIRE, SmolRTSP_HeaderId_Require},
+        {SMOLRTSP_HEADER_RETRY_AFTER, SmolRTSP_HeaderId_RetryAfter},
+        {SMOLRTSP_HEADER_RTP_INFO, SmolRTSP_HeaderId_RtpInfo},
+        {SMOLRTSP_HEADER_SCALE, SmolRTSP_HeaderId_Scale},
+        {SMOLRTSP_HEADER_SESSION, SmolRTSP_HeaderId_Session},
+        {SMOLRTSP_HEADER_SERVER, SmolRTSP_HeaderId_Server},
+        {SMOLRTSP_HEADER_SPEED, SmolRTSP_HeaderId_Speed},
+        {SMOLRTSP_HEADER_TRANSPORT, SmolRTSP_HeaderId_Transport},
+        {SMOLRTSP_HEADER_UNSUPPORTED, SmolRTSP_HeaderId_Unsupported},
+        {SMOLRTSP_HEADER_USER_AGENT, SmolRTSP_HeaderId_UserAgent},
+        {SMOLRTSP_HEADER_VIA, SmolRTSP_HeaderId_Via},
+        {SMOLRTSP_HEADER_WWW_AUTHENTICATE, SmolRTSP_HeaderId_WwwAuthenticate},
+    };
+
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(well_known); i++) {
+        ASSERT_EQ(
+            well_known[i].id, SmolRTSP_HeaderId_from_key(well_known[i].key));
+    }
+
+    ASSERT_EQ(
+        SmolRTSP_HeaderId_CSeq,
+        SmolRTSP_HeaderId_from_key(CharSlice99_from_str("cseq")));
+    ASSERT_EQ(
+        SmolRTSP_HeaderId_ContentLength,
+        SmolRTSP_HeaderId_from_key(CharSlice99_from_str("CONTENT-length")));
+    ASSERT_EQ(
+        SmolRTSP_HeaderId_Unknown,
+        SmolRTSP_HeaderId_from_key(CharSlice99_from_str("X-Custom")));
+    ASSERT_EQ(
+        SmolRTSP_HeaderId_Unknown,
+        SmolRTSP_HeaderId_from_key(CharSlice99_from_str("Content-Size")));
+
+    PASS();
+}
+
 SUITE(types_header) {
     RUN_TEST(parse_header);
     RUN_TEST(serialize_header);
+    RUN_TEST(header_id_from_key);
 }
@@ -63,6 +63,43 @@ TEST find(void) {
     PASS();
 }
 
+TEST find_ignore_case(void) {
+    SmolRTSP_HeaderMap parsed = SmolRTSP_HeaderMap_empty();
+    const SmolRTSP_ParseResult res = SmolRTSP_HeaderMap_parse(
+        &parsed, CharSlice99_from_str("cseq: 1\r\nX-Custom: a\r\n"
+                                      "CSEQ: 2\r\nx-custom: b\r\n\r\n"));
+    ASSERT(SmolRTSP_ParseResult_is_complete(res));
+
+    const SmolRTSP_HeaderMap literal = SmolRTSP_HeaderMap_from_array({
+        {CharSlice99_from_str("cseq"), CharSlice99_from_str("1")},
+        {CharSlice99_from_str("X-Custom"), CharSlice99_from_str("a")},
+        {CharSlice99_from_str("CSEQ"), CharSlice99_from_str("2")},
+    });
+
+    // The indexed and the linearly searched maps agree, and the first header
+    // wins.
+    const SmolRTSP_HeaderMap *maps[] = {&parsed, &literal};
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(maps); i++) {
+        CharSlice99 value;
+
+        ASSERT(SmolRTSP_HeaderMap_find(maps[i], SMOLRTSP_HEADER_C_SEQ, &value));
+        ASSERT(CharSlice99_primitive_eq(value, CharSlice99_from_str("1")));
+
+        ASSERT(SmolRTSP_HeaderMap_find_id(
+            maps[i], SmolRTSP_HeaderId_CSeq, &value));
+        ASSERT(CharSlice99_primitive_eq(value, CharSlice99_from_str("1")));
+
+        ASSERT(SmolRTSP_HeaderMap_find(
+            maps[i], CharSlice99_from_str("x-CUSTOM"), &value));
+        ASSERT(CharSlice99_primitive_eq(value, CharSlice99_from_str("a")));
+
+        ASSERT(!SmolRTSP_HeaderMap_find_id(
+            maps[i], SmolRTSP_HeaderId_Session, NULL));
+    }
+
+    PASS();
+}
+
 TEST contains_key(void) {
     const SmolRTSP_HeaderMap map = HEADER_MAP;
 
@@ -84,6 +121,26 @@ TEST append(void) {
     PASS();
 }
 
+TEST clear(void) {
+    SmolRTSP_HeaderMap map = SmolRTSP_HeaderMap_empty();
+    SmolRTSP_HeaderMap_append(&map, HEADER_MAP.headers[0]);
+
+    SmolRTSP_HeaderMap_clear(&map);
+    ASSERT_EQ(0, map.len);
+    ASSERT(
+        !SmolRTSP_HeaderMap_contains_key(&map, SMOLRTSP_HEADER_CONTENT_LENGTH));
+
+    SmolRTSP_HeaderMap_append(&map, HEADER_MAP.headers[2]);
+    SmolRTSP_HeaderMap_append(&map, HEADER_MAP.headers[0]);
+
+    CharSlice99 value;
+    ASSERT(SmolRTSP_HeaderMap_find_id(
+        &map, SmolRTSP_HeaderId_ContentLength, &value));
+    ASSERT(CharSlice99_primitive_eq(CharSlice99_from_str("10"), value));
+
+    PASS();
+}
+
 TEST is_full(void) {
     SmolRTSP_HeaderMap map = SmolRTSP_HeaderMap_empty();
 
@@ -119,8 +176,10 @@ SUITE(types_header_map) {
     RUN_TEST(parse_header_map);
     RUN_TEST(serialize_header_map);
     RUN_TEST(find);
+    RUN_TEST(find_ignore_case);
     RUN_TEST(contains_key);
     RUN_TEST(append);
+    RUN_TEST(clear);
     RUN_TEST(is_full);
     RUN_TEST(scanf_header);
 }
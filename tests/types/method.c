@@ -28,6 +28,39 @@ TEST parse_method(void) {
     PASS();
 }
 
+TEST method_id_from_method(void) {
+#define CHECK(method, id)                                                      \
+    ASSERT_EQ(                                                                 \
+        SmolRTSP_MethodId_##id,                                                \
+        SmolRTSP_MethodId_from_method(SMOLRTSP_METHOD_##method))
+
+    CHECK(OPTIONS, Options);
+    CHECK(DESCRIBE, Describe);
+    CHECK(ANNOUNCE, Announce);
+    CHECK(SETUP, Setup);
+    CHECK(PLAY, Play);
+    CHECK(PAUSE, Pause);
+    CHECK(TEARDOWN, Teardown);
+    CHECK(GET_PARAMETER, GetParameter);
+    CHECK(SET_PARAMETER, SetParameter);
+    CHECK(REDIRECT, Redirect);
+    CHECK(RECORD, Record);
+
+#undef CHECK
+
+    const char *unknown[] = {"", "play", "PLAX", "SETUQ", "XXXXXXXX",
+                             "GET_PARAMETERS", "PUT_PARAMETER"};
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(unknown); i++) {
+        ASSERT_EQ(
+            SmolRTSP_MethodId_Unknown,
+            SmolRTSP_MethodId_from_method(
+                CharSlice99_from_str((char *)unknown[i])));
+    }
+
+    PASS();
+}
+
 SUITE(types_method) {
     RUN_TEST(parse_method);
+    RUN_TEST(method_id_from_method);
 }
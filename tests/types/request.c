@@ -38,6 +38,41 @@ TEST parse_request(void) {
     PASS();
 }
 
+TEST parse_invalid_numbers(void) {
+    SmolRTSP_Request result = SmolRTSP_Request_uninit();
+    SmolRTSP_ParseResult ret = SmolRTSP_Request_parse(
+        &result, CharSlice99_from_str("OPTIONS * RTSP/1.0\r\n"
+                                      "CSeq: 4294967296\r\n\r\n"));
+    match(ret) {
+        of(SmolRTSP_ParseResult_Failure, err) {
+            ASSERT(MATCHES(*err, SmolRTSP_ParseError_InvalidCSeq));
+        }
+        otherwise FAIL();
+    }
+
+    result = SmolRTSP_Request_uninit();
+    ret = SmolRTSP_Request_parse(
+        &result, CharSlice99_from_str("OPTIONS * RTSP/1.0\r\n"
+                                      "CSeq: 1\r\n"
+                                      "Content-Length: -1\r\n\r\n"));
+    match(ret) {
+        of(SmolRTSP_ParseResult_Failure, err) {
+            ASSERT(MATCHES(*err, SmolRTSP_ParseError_ContentLength));
+        }
+        otherwise FAIL();
+    }
+
+    // Spaces before the line terminator are fine.
+    result = SmolRTSP_Request_uninit();
+    ret = SmolRTSP_Request_parse(
+        &result, CharSlice99_from_str("OPTIONS * RTSP/1.0\r\n"
+                                      "CSeq: 4294967295 \r\n\r\n"));
+    ASSERT(SmolRTSP_ParseResult_is_complete(ret));
+    ASSERT_EQ(UINT32_MAX, result.cseq);
+
+    PASS();
+}
+
 TEST serialize_request(void) {
     char buffer[500] = {0};
 
@@ -74,5 +109,6 @@ TEST serialize_request(void) {
 
 SUITE(types_request) {
     RUN_TEST(parse_request);
+    RUN_TEST(parse_invalid_numbers);
     RUN_TEST(serialize_request);
 }
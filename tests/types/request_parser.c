@@ -0,0 +1,98 @@
+#include <smolrtsp/types/request_parser.h>
+
+#include <greatest.h>
+
+#include <string.h>
+
+static const char request_str[] =
+    "$\x01\x00\x03xyz"
+    "SET_PARAMETER rtsp://example.com RTSP/1.0\r\n"
+    "CSeq: 7\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello";
+
+TEST parse_byte_by_byte(void) {
+    const CharSlice99 input =
+        CharSlice99_new((char *)request_str, sizeof request_str - 1);
+
+    SmolRTSP_RequestParser parser = SmolRTSP_RequestParser_new();
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+
+    for (size_t len = 0; len < input.len; len++) {
+        const SmolRTSP_ParseResult res = SmolRTSP_RequestParser_parse(
+            &parser, &request, CharSlice99_sub(input, 0, len));
+        ASSERT(SmolRTSP_ParseResult_is_partial(res));
+        ASSERT(parser.offset + parser.scanned <= len);
+    }
+
+    SmolRTSP_ParseResult res =
+        SmolRTSP_RequestParser_parse(&parser, &request, input);
+    ASSERT(SmolRTSP_ParseResult_is_complete(res));
+    ASSERT_EQ(input.len, parser.offset);
+
+    const SmolRTSP_Request expected = {
+        .start_line =
+            {
+                .method = SMOLRTSP_METHOD_SET_PARAMETER,
+                .uri = CharSlice99_from_str("rtsp://example.com"),
+                .version = {.major = 1, .minor = 0},
+            },
+        .header_map = SmolRTSP_HeaderMap_from_array({
+            {SMOLRTSP_HEADER_C_SEQ, CharSlice99_from_str("7")},
+            {SMOLRTSP_HEADER_CONTENT_LENGTH, CharSlice99_from_str("5")},
+        }),
+        .body = CharSlice99_from_str("hello"),
+        .cseq = 7,
+    };
+    ASSERT(SmolRTSP_Request_eq(&expected, &request));
+
+    // The same as parsing at once.
+    SmolRTSP_Request at_once = SmolRTSP_Request_uninit();
+    res = SmolRTSP_Request_parse(&at_once, input);
+    ASSERT(SmolRTSP_ParseResult_is_complete(res));
+    ASSERT(SmolRTSP_Request_eq(&expected, &at_once));
+
+    PASS();
+}
+
+TEST parse_malformed_line(void) {
+    const CharSlice99 input =
+        CharSlice99_from_str("DESCRIBE rtsp://example.com\r\nCSeq: 1\r\n\r\n");
+
+    SmolRTSP_RequestParser parser = SmolRTSP_RequestParser_new();
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+
+    const SmolRTSP_ParseResult res =
+        SmolRTSP_RequestParser_parse(&parser, &request, input);
+    ASSERT(SmolRTSP_ParseResult_is_failure(res));
+
+    PASS();
+}
+
+TEST parse_missing_cseq(void) {
+    const CharSlice99 input = CharSlice99_from_str(
+        "DESCRIBE rtsp://example.com RTSP/1.0\r\nAccept: application/sdp"
+        "\r\n\r\n");
+
+    SmolRTSP_RequestParser parser = SmolRTSP_RequestParser_new();
+    SmolRTSP_Request request = SmolRTSP_Request_uninit();
+
+    const SmolRTSP_ParseResult res =
+        SmolRTSP_RequestParser_parse(&parser, &request, input);
+
+    match(res) {
+        of(SmolRTSP_ParseResult_Failure, err) {
+            ASSERT(MATCHES(*err, SmolRTSP_ParseError_MissingCSeq));
+        }
+        otherwise FAIL();
+    }
+
+    PASS();
+}
+
+SUITE(types_request_parser) {
+    RUN_TEST(parse_byte_by_byte);
+    RUN_TEST(parse_malformed_line);
+    RUN_TEST(parse_missing_cseq);
+}
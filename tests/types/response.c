@@ -75,7 +75,47 @@ TEST serialize_response(void) {
     PASS();
 }
 
+TEST serialize_response_uncommon(void) {
+    char buffer[500] = {0};
+
+    // Neither RTSP/1.0 nor an implicit `CSeq`, so the general path is taken.
+    SmolRTSP_Response response = {
+        .start_line =
+            {
+                .version = {2, 0},
+                .code = SMOLRTSP_STATUS_NOT_FOUND,
+                .reason = CharSlice99_from_str("Not Found"),
+            },
+        .header_map = SmolRTSP_HeaderMap_from_array({
+            {SMOLRTSP_HEADER_C_SEQ, CharSlice99_from_str("7")},
+        }),
+        .body = CharSlice99_empty(),
+        .cseq = 4294967295,
+    };
+
+    ssize_t ret =
+        SmolRTSP_Response_serialize(&response, smolrtsp_string_writer(buffer));
+
+    const char *expected = "RTSP/2.0 404 Not Found\r\nCSeq: 7\r\n\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    buffer[0] = '\0';
+    response.start_line.version = (SmolRTSP_RtspVersion){1, 0};
+    response.header_map = SmolRTSP_HeaderMap_empty();
+
+    ret =
+        SmolRTSP_Response_serialize(&response, smolrtsp_string_writer(buffer));
+
+    expected = "RTSP/1.0 404 Not Found\r\nCSeq: 4294967295\r\n\r\n";
+    ASSERT_EQ((ssize_t)strlen(expected), ret);
+    ASSERT_STR_EQ(expected, buffer);
+
+    PASS();
+}
+
 SUITE(types_response) {
     RUN_TEST(parse_response);
     RUN_TEST(serialize_response);
+    RUN_TEST(serialize_response_uncommon);
 }
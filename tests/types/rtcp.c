@@ -0,0 +1,239 @@
+#include <smolrtsp/types/rtcp.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+TEST sender_report_round_trip(void) {
+    const SmolRTSP_RtcpSenderReport report = {
+        .ssrc = 0x11223344,
+        .ntp_timestamp = UINT64_C(0xAABBCCDD00112233),
+        .rtp_timestamp = 90000,
+        .packet_count = 7,
+        .octet_count = 7000,
+    };
+
+    uint8_t buffer[SMOLRTSP_RTCP_SENDER_REPORT_SIZE];
+    ASSERT_EQ(buffer, SmolRTSP_RtcpSenderReport_serialize(report, buffer));
+
+    // V=2, no report blocks, PT=SR, 6 words after the first one.
+    ASSERT_MEM_EQ(((const uint8_t[]){0x80, 200, 0, 6}), buffer, 4);
+
+    U8Slice99 input = U8Slice99_new(buffer, sizeof buffer);
+    SmolRTSP_RtcpPacket packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT(U8Slice99_is_empty(input));
+    ASSERT_EQ(SMOLRTSP_RTCP_SR, packet.packet_ty);
+    ASSERT_EQ(0, packet.count);
+    ASSERT_EQ(0x11223344, SmolRTSP_RtcpPacket_sender_ssrc(packet));
+
+    const SmolRTSP_RtcpSenderReport parsed =
+        SmolRTSP_RtcpPacket_sender_report(packet);
+    ASSERT_EQ(report.ssrc, parsed.ssrc);
+    ASSERT_EQ(report.ntp_timestamp, parsed.ntp_timestamp);
+    ASSERT_EQ(report.rtp_timestamp, parsed.rtp_timestamp);
+    ASSERT_EQ(report.packet_count, parsed.packet_count);
+    ASSERT_EQ(report.octet_count, parsed.octet_count);
+
+    PASS();
+}
+
+TEST compound_receiver_report(void) {
+    // RR with two report blocks, followed by an SDES with padding.
+    uint8_t buffer[8 + 2 * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE + 8] = {
+        0x82, 201, 0, 13, 0xDE, 0xAD, 0xBE, 0xEF,
+    };
+
+    const SmolRTSP_RtcpReportBlock blocks[] = {
+        {
+            .ssrc = 1,
+            .fraction_lost = 64,
+            .cumulative_lost = -3,
+            .extended_highest_seq_num = 0x00010005,
+            .jitter = 450,
+            .last_sr = 0x12345678,
+            .delay_since_last_sr = 65536,
+        },
+        {.ssrc = 2, .cumulative_lost = 0x7FFFFF},
+    };
+    for (size_t i = 0; i < 2; i++) {
+        uint8_t *block = buffer + 8 + i * SMOLRTSP_RTCP_REPORT_BLOCK_SIZE;
+        ASSERT_EQ(block, SmolRTSP_RtcpReportBlock_serialize(blocks[i], block));
+    }
+    memcpy(
+        buffer + sizeof buffer - 8,
+        (const uint8_t[]){0xA0, 202, 0, 1, 0, 0, 0, 4}, 8);
+
+    U8Slice99 input = U8Slice99_new(buffer, sizeof buffer);
+    SmolRTSP_RtcpPacket packet;
+
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_RR, packet.packet_ty);
+    ASSERT_EQ(2, packet.count);
+    ASSERT_EQ(0xDEADBEEF, SmolRTSP_RtcpPacket_sender_ssrc(packet));
+
+    const SmolRTSP_RtcpReportBlock first =
+        SmolRTSP_RtcpPacket_report_block(packet, 0);
+    ASSERT_EQ(1, first.ssrc);
+    ASSERT_EQ(64, first.fraction_lost);
+    ASSERT_EQ(-3, first.cumulative_lost);
+    ASSERT_EQ(0x00010005, first.extended_highest_seq_num);
+    ASSERT_EQ(450, first.jitter);
+    ASSERT_EQ(0x12345678, first.last_sr);
+    ASSERT_EQ(65536, first.delay_since_last_sr);
+
+    const SmolRTSP_RtcpReportBlock second =
+        SmolRTSP_RtcpPacket_report_block(packet, 1);
+    ASSERT_EQ(2, second.ssrc);
+    ASSERT_EQ(0x7FFFFF, second.cumulative_lost);
+
+    // The padding (all four bytes of the SDES payload) is stripped.
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_SDES, packet.packet_ty);
+    ASSERT_EQ(0, packet.payload.len);
+    ASSERT(U8Slice99_is_empty(input));
+
+    PASS();
+}
+
+TEST malformed(void) {
+    const uint8_t cases[][8] = {
+        // Too short.
+        {0x80, 201, 0},
+        // Version 1.
+        {0x40, 201, 0, 1, 0, 0, 0, 1},
+        // The length exceeds the input.
+        {0x80, 201, 0, 2, 0, 0, 0, 1},
+        // The report block is missing.
+        {0x81, 201, 0, 1, 0, 0, 0, 1},
+        // The padding exceeds the payload.
+        {0xA0, 201, 0, 1, 0, 0, 0, 5},
+    };
+    const size_t lens[] = {3, 8, 8, 8, 8};
+
+    for (size_t i = 0; i < sizeof lens / sizeof lens[0]; i++) {
+        U8Slice99 input = U8Slice99_new((uint8_t *)cases[i], lens[i]);
+        SmolRTSP_RtcpPacket packet;
+
+        errno = 0;
+        ASSERT_EQ(-1, SmolRTSP_RtcpPacket_parse(&input, &packet));
+        ASSERT_EQ(EBADMSG, errno);
+        ASSERT_EQ(lens[i], input.len);
+    }
+
+    PASS();
+}
+
+TEST generic_nack(void) {
+    // The NACK of the packets 256, 257, and 272 from 0x01020304 to 0xAABBCCDD.
+    const uint8_t buffer[] = {
+        0x81, 205,  0,    3,    0x01, 0x02, 0x03, 0x04,
+        0xAA, 0xBB, 0xCC, 0xDD, 0x01, 0x00, 0x80, 0x01,
+    };
+
+    U8Slice99 input = U8Slice99_new((uint8_t *)buffer, sizeof buffer);
+    SmolRTSP_RtcpPacket packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_RTPFB, packet.packet_ty);
+    ASSERT_EQ(SMOLRTSP_RTCP_FMT_NACK, packet.count);
+    ASSERT_EQ(0x01020304, SmolRTSP_RtcpPacket_sender_ssrc(packet));
+    ASSERT_EQ(0xAABBCCDD, SmolRTSP_RtcpPacket_media_ssrc(packet));
+
+    ASSERT_EQ(1, SmolRTSP_RtcpPacket_nacks_count(packet));
+    const SmolRTSP_RtcpNack nack = SmolRTSP_RtcpPacket_nack(packet, 0);
+    ASSERT_EQ(256, nack.seq_num);
+    ASSERT_EQ(0x8001, nack.bitmask);
+
+    PASS();
+}
+
+TEST transport_feedback(void) {
+    // The packets 100-104 except 102 from 0x01020304, padded to 32 bits.
+    const uint8_t buffer[] = {
+        0xAF, 205,  0,    7,    0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB, 0xCC,
+        0xDD, 0,    100,  0,    5,    0,    0,    1,    7,    0x20, 0x02,
+        0xC9, 0x00, 4,    8,    0xFF, 0xFC, 16,   0,    0,    3,
+    };
+
+    U8Slice99 input = U8Slice99_new((uint8_t *)buffer, sizeof buffer);
+    SmolRTSP_RtcpPacket packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_RTPFB, packet.packet_ty);
+    ASSERT_EQ(SMOLRTSP_RTCP_FMT_TRANSPORT_CC, packet.count);
+
+    SmolRTSP_RtcpTransportFeedback feedback;
+    SmolRTSP_RtcpPacketStatus statuses[8];
+    ASSERT_EQ(
+        0, SmolRTSP_RtcpPacket_transport_feedback(
+               packet, &feedback, statuses, 8));
+    ASSERT_EQ(100, feedback.base_seq_num);
+    ASSERT_EQ(5, feedback.status_count);
+    ASSERT_EQ(64000, feedback.reference_time_us);
+    ASSERT_EQ(7, feedback.fb_pkt_count);
+
+    // A run of two small deltas, then a vector of a lost packet, a large
+    // (negative) delta, and a small one.
+    const bool received[] = {true, true, false, true, true};
+    const int64_t arrivals_us[] = {65000, 67000, 0, 66000, 70000};
+    for (size_t i = 0; i < 5; i++) {
+        ASSERT_EQ(100 + i, statuses[i].seq_num);
+        ASSERT_EQ(received[i], statuses[i].received);
+        ASSERT_EQ(arrivals_us[i], statuses[i].arrival_us);
+    }
+
+    // Only the first statuses.
+    ASSERT_EQ(
+        0, SmolRTSP_RtcpPacket_transport_feedback(
+               packet, &feedback, statuses, 1));
+    ASSERT_EQ(65000, statuses[0].arrival_us);
+
+    // The receive deltas are cut off.
+    packet.payload.len -= 3;
+    errno = 0;
+    ASSERT_EQ(
+        -1, SmolRTSP_RtcpPacket_transport_feedback(
+                packet, &feedback, statuses, 8));
+    ASSERT_EQ(EBADMSG, errno);
+
+    PASS();
+}
+
+TEST keyframe_request(void) {
+    // PLI about 0xAABBCCDD.
+    const uint8_t pli[] = {
+        0x81, 206, 0, 2, 0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB, 0xCC, 0xDD,
+    };
+    // FIR with entries for 0x11111111 and 0xAABBCCDD.
+    const uint8_t fir[] = {
+        0x84, 206,  0,    6,    0x01, 0x02, 0x03, 0x04, 0,    0, 0, 0,
+        0x11, 0x11, 0x11, 0x11, 7,    0,    0,    0,    0xAA, 0xBB, 0xCC, 0xDD,
+        8,    0,    0,    0,
+    };
+
+    U8Slice99 input = U8Slice99_new((uint8_t *)pli, sizeof pli);
+    SmolRTSP_RtcpPacket packet;
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_PSFB, packet.packet_ty);
+    ASSERT_EQ(SMOLRTSP_RTCP_FMT_PLI, packet.count);
+    ASSERT(SmolRTSP_RtcpPacket_is_keyframe_request(packet, 0xAABBCCDD));
+    ASSERT_FALSE(SmolRTSP_RtcpPacket_is_keyframe_request(packet, 0x11111111));
+
+    input = U8Slice99_new((uint8_t *)fir, sizeof fir);
+    ASSERT_EQ(0, SmolRTSP_RtcpPacket_parse(&input, &packet));
+    ASSERT_EQ(SMOLRTSP_RTCP_FMT_FIR, packet.count);
+    ASSERT(SmolRTSP_RtcpPacket_is_keyframe_request(packet, 0xAABBCCDD));
+    ASSERT(SmolRTSP_RtcpPacket_is_keyframe_request(packet, 0x11111111));
+    ASSERT_FALSE(SmolRTSP_RtcpPacket_is_keyframe_request(packet, 0x01020304));
+
+    PASS();
+}
+
+SUITE(types_rtcp) {
+    RUN_TEST(sender_report_round_trip);
+    RUN_TEST(compound_receiver_report);
+    RUN_TEST(malformed);
+    RUN_TEST(generic_nack);
+    RUN_TEST(transport_feedback);
+    RUN_TEST(keyframe_request);
+}
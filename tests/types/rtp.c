@@ -0,0 +1,107 @@
+#include <smolrtsp/types/rtp.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <string.h>
+
+TEST parse_round_trip(void) {
+    uint32_t csrc[] = {htonl(0xAABBCCDD), htonl(0x01020304)};
+    const SmolRTSP_RtpHeader header = {
+        .version = 2,
+        .padding = false,
+        .extension = false,
+        .csrc_count = 2,
+        .marker = true,
+        .payload_ty = 97,
+        .sequence_number = htons(0xBEEF),
+        .timestamp = htonl(90000),
+        .ssrc = htonl(0x11223344),
+        .csrc = csrc,
+    };
+
+    uint32_t words[8] = {0};
+    uint8_t *buffer = (uint8_t *)words;
+    const size_t size = SmolRTSP_RtpHeader_size(header);
+    ASSERT_EQ(20, size);
+    ASSERT_EQ(buffer, SmolRTSP_RtpHeader_serialize(header, buffer));
+    memcpy(buffer + size, "xyz", 3);
+
+    U8Slice99 packet = U8Slice99_new(buffer, size + 3);
+    SmolRTSP_RtpHeader parsed;
+    ASSERT_EQ(0, SmolRTSP_RtpHeader_parse(&packet, &parsed));
+    ASSERT_EQ(buffer + size, packet.ptr);
+    ASSERT_EQ(3, packet.len);
+
+    ASSERT_EQ(2, parsed.version);
+    ASSERT_FALSE(parsed.padding);
+    ASSERT_FALSE(parsed.extension);
+    ASSERT_EQ(2, parsed.csrc_count);
+    ASSERT(parsed.marker);
+    ASSERT_EQ(97, parsed.payload_ty);
+    ASSERT_EQ(0xBEEF, ntohs(parsed.sequence_number));
+    ASSERT_EQ(90000, ntohl(parsed.timestamp));
+    ASSERT_EQ(0x11223344, ntohl(parsed.ssrc));
+    ASSERT_EQ(0xAABBCCDD, ntohl(parsed.csrc[0]));
+    ASSERT_EQ(0x01020304, ntohl(parsed.csrc[1]));
+
+    PASS();
+}
+
+TEST parse_extension_and_padding(void) {
+    // X=1, P=1, a one-word extension, 2 bytes of payload, 2 bytes of padding.
+    uint8_t buffer[] = {
+        0xB0, 96,   0,    1,    0, 0, 0, 0, 0, 0, 0, 1, //
+        0xBE, 0xDE, 0,    1,    1, 2, 3, 4,             //
+        0xAA, 0xBB, 0x00, 0x02,
+    };
+
+    U8Slice99 packet = U8Slice99_new(buffer, sizeof buffer);
+    SmolRTSP_RtpHeader parsed;
+    ASSERT_EQ(0, SmolRTSP_RtpHeader_parse(&packet, &parsed));
+    ASSERT(parsed.padding);
+    ASSERT(parsed.extension);
+    ASSERT_EQ(0xBEDE, ntohs(parsed.extension_profile));
+    ASSERT_EQ(1, ntohs(parsed.extension_payload_len));
+    ASSERT_EQ(buffer + 16, parsed.extension_payload);
+    ASSERT_EQ(buffer + 20, packet.ptr);
+    ASSERT_EQ(2, packet.len);
+
+    PASS();
+}
+
+TEST parse_malformed(void) {
+    const uint8_t cases[][16] = {
+        // Too short.
+        {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0},
+        // Version 1.
+        {0x40, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1},
+        // The CSRC is missing.
+        {0x81, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1},
+        // The extension exceeds the packet.
+        {0x90, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1},
+        // The padding exceeds the payload.
+        {0xA0, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0xAA, 3},
+    };
+    const size_t lens[] = {11, 12, 12, 16, 14};
+
+    for (size_t i = 0; i < sizeof lens / sizeof lens[0]; i++) {
+        U8Slice99 packet = U8Slice99_new((uint8_t *)cases[i], lens[i]);
+        SmolRTSP_RtpHeader parsed;
+
+        errno = 0;
+        ASSERT_EQ(-1, SmolRTSP_RtpHeader_parse(&packet, &parsed));
+        ASSERT_EQ(EBADMSG, errno);
+        ASSERT_EQ(lens[i], packet.len);
+    }
+
+    PASS();
+}
+
+SUITE(types_rtp) {
+    RUN_TEST(parse_round_trip);
+    RUN_TEST(parse_extension_and_padding);
+    RUN_TEST(parse_malformed);
+}
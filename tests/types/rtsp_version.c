@@ -17,6 +17,8 @@ TEST parse_rtsp_version(void) {
         SmolRTSP_RtspVersion_parse(&result, CharSlice99_from_str("192"))));
     ASSERT(SmolRTSP_ParseResult_is_failure(
         SmolRTSP_RtspVersion_parse(&result, CharSlice99_from_str(" ~ RTSP/"))));
+    ASSERT(SmolRTSP_ParseResult_is_failure(SmolRTSP_RtspVersion_parse(
+        &result, CharSlice99_from_str("RTSP/256.0 "))));
 
     PASS();
 }
@@ -0,0 +1,146 @@
+#include <smolrtsp/udp_receiver.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Creates a receiving socket on an ephemeral loopback port and a socket
+// connected to it.
+static int loopback_pair(int *sender, size_t rcvbuf) {
+    const struct in_addr loopback = {.s_addr = htonl(INADDR_LOOPBACK)};
+    const int fd = smolrtsp_recv_dgram_socket(AF_INET, &loopback, 0, rcvbuf);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    socklen_t len = sizeof addr;
+    if (getsockname(fd, (struct sockaddr *)&addr, &len) == -1 ||
+        fcntl(fd, F_SETFL, O_NONBLOCK) == -1 ||
+        (*sender = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (connect(*sender, (const struct sockaddr *)&addr, len) == -1) {
+        close(*sender);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+TEST batch(void) {
+    int sender;
+    const int fd = loopback_pair(&sender, 0);
+    ASSERT(fd != -1);
+
+    SmolRTSP_UdpReceiver *receiver = SmolRTSP_UdpReceiver_new(fd, 2, 4);
+    ASSERT(receiver);
+
+    ASSERT_EQ(-1, SmolRTSP_UdpReceiver_receive(receiver));
+    ASSERT_EQ(EAGAIN, errno);
+
+    const char *dgrams[] = {"abc", "defgh", "ij"};
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_EQ(
+            (ssize_t)strlen(dgrams[i]),
+            send(sender, dgrams[i], strlen(dgrams[i]), 0));
+    }
+
+    // The capacity is two datagrams, and the second one is truncated.
+    ASSERT_EQ(2, SmolRTSP_UdpReceiver_receive(receiver));
+    SmolRTSP_UdpDatagram dgram = SmolRTSP_UdpReceiver_datagram(receiver, 0);
+    ASSERT_EQ(3, dgram.data.len);
+    ASSERT_MEM_EQ("abc", dgram.data.ptr, 3);
+    ASSERT_FALSE(dgram.truncated);
+
+    struct sockaddr_in sender_addr;
+    socklen_t len = sizeof sender_addr;
+    ASSERT_EQ(
+        0, getsockname(sender, (struct sockaddr *)&sender_addr, &len));
+    ASSERT_EQ(sizeof sender_addr, dgram.addr_len);
+    ASSERT_EQ(AF_INET, dgram.addr->sa_family);
+    const struct sockaddr_in *source = (const struct sockaddr_in *)dgram.addr;
+    ASSERT_EQ(sender_addr.sin_port, source->sin_port);
+
+    dgram = SmolRTSP_UdpReceiver_datagram(receiver, 1);
+    ASSERT_EQ(4, dgram.data.len);
+    ASSERT_MEM_EQ("defg", dgram.data.ptr, 4);
+    ASSERT(dgram.truncated);
+
+    ASSERT_EQ(1, SmolRTSP_UdpReceiver_receive(receiver));
+    dgram = SmolRTSP_UdpReceiver_datagram(receiver, 0);
+    ASSERT_MEM_EQ("ij", dgram.data.ptr, 2);
+
+    const SmolRTSP_UdpReceiverStats stats =
+        SmolRTSP_UdpReceiver_stats(receiver);
+    ASSERT_EQ(3, stats.datagrams);
+    ASSERT_EQ(1, stats.truncated);
+    ASSERT_EQ(0, stats.dropped);
+
+    VTABLE(SmolRTSP_UdpReceiver, SmolRTSP_Droppable).drop(receiver);
+    close(sender);
+    close(fd);
+    PASS();
+}
+
+TEST overflow(void) {
+    int sender;
+    // The kernel rounds the buffer up to its minimum.
+    const int fd = loopback_pair(&sender, 1);
+    ASSERT(fd != -1);
+
+    SmolRTSP_UdpReceiver *receiver = SmolRTSP_UdpReceiver_new(fd, 64, 1500);
+    ASSERT(receiver);
+
+    const uint8_t payload[1000] = {0};
+    for (size_t i = 0; i < 64; i++) {
+        ASSERT_EQ(
+            (ssize_t)sizeof payload, send(sender, payload, sizeof payload, 0));
+    }
+
+    uint64_t received = 0;
+    ssize_t n;
+    while ((n = SmolRTSP_UdpReceiver_receive(receiver)) > 0) {
+        received += (uint64_t)n;
+    }
+    ASSERT_EQ(EAGAIN, errno);
+    ASSERT(received > 0 && received < 64);
+
+    // The drops are reported with the datagrams queued after them.
+    ASSERT_EQ(
+        (ssize_t)sizeof payload, send(sender, payload, sizeof payload, 0));
+    ASSERT_EQ(1, SmolRTSP_UdpReceiver_receive(receiver));
+
+    const SmolRTSP_UdpReceiverStats stats =
+        SmolRTSP_UdpReceiver_stats(receiver);
+    ASSERT_EQ(received + 1, stats.datagrams);
+    ASSERT_EQ(64 - received, stats.dropped);
+
+    VTABLE(SmolRTSP_UdpReceiver, SmolRTSP_Droppable).drop(receiver);
+    close(sender);
+    close(fd);
+    PASS();
+}
+
+TEST unsupported_af(void) {
+    errno = 0;
+    ASSERT_EQ(-1, smolrtsp_recv_dgram_socket(AF_UNIX, NULL, 0, 0));
+    ASSERT_EQ(EAFNOSUPPORT, errno);
+
+    PASS();
+}
+
+SUITE(udp_receiver) {
+    RUN_TEST(batch);
+    RUN_TEST(overflow);
+    RUN_TEST(unsupported_af);
+}
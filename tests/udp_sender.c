@@ -0,0 +1,141 @@
+#include <smolrtsp/udp_sender.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Binds a receiving socket to an ephemeral loopback port.
+static int receiver(struct sockaddr_in *addr) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+
+    memset(addr, '\0', sizeof *addr);
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof *addr;
+    if (bind(fd, (const struct sockaddr *)addr, len) == -1 ||
+        getsockname(fd, (struct sockaddr *)addr, &len) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static enum greatest_test_res recv_str(int fd, const char *expected) {
+    char buffer[64];
+    const ssize_t len = recv(fd, buffer, sizeof buffer, MSG_DONTWAIT);
+    ASSERT_EQ((ssize_t)strlen(expected), len);
+    ASSERT_MEM_EQ(expected, buffer, (size_t)len);
+
+    PASS();
+}
+
+static int transmit_str(SmolRTSP_Transport t, const char *str) {
+    struct iovec bufs[] = {
+        {.iov_base = (void *)str, .iov_len = 1},
+        {.iov_base = (void *)(str + 1), .iov_len = strlen(str) - 1},
+    };
+
+    return VCALL(
+        t, transmit, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs));
+}
+
+TEST many_destinations(void) {
+    struct sockaddr_in addrs[2];
+    int receivers[2];
+    for (size_t i = 0; i < 2; i++) {
+        receivers[i] = receiver(&addrs[i]);
+        ASSERT(receivers[i] != -1);
+    }
+
+    const int fd = smolrtsp_shared_dgram_socket(AF_INET);
+    ASSERT(fd != -1);
+
+    SmolRTSP_UdpSender *sender = SmolRTSP_UdpSender_new(fd, 3, 16);
+    SmolRTSP_Transport t[2];
+    for (size_t i = 0; i < 2; i++) {
+        t[i] = smolrtsp_transport_udp_sender(
+            sender, (const struct sockaddr *)&addrs[i]);
+        ASSERT_EQ(16, VCALL(t[i], max_packet_size));
+    }
+
+    ASSERT_EQ(0, transmit_str(t[0], "abc"));
+    ASSERT_EQ(0, transmit_str(t[1], "defg"));
+    ASSERT_EQ(0, transmit_str(t[0], "hi"));
+    ASSERT_EQ(3, SmolRTSP_UdpSender_pending(sender));
+
+    // Nothing is sent before the flush.
+    char buffer[32];
+    ASSERT_EQ(-1, recv(receivers[0], buffer, sizeof buffer, MSG_DONTWAIT));
+    ASSERT_EQ(EAGAIN, errno);
+
+    // The queue is full, so it is flushed first.
+    ASSERT(!VCALL(t[1], is_full));
+    ASSERT_EQ(0, transmit_str(t[1], "jk"));
+    ASSERT_EQ(1, SmolRTSP_UdpSender_pending(sender));
+    CHECK_CALL(recv_str(receivers[0], "abc"));
+    CHECK_CALL(recv_str(receivers[0], "hi"));
+    CHECK_CALL(recv_str(receivers[1], "defg"));
+
+    ASSERT_EQ(1, SmolRTSP_UdpSender_flush(sender));
+    ASSERT_EQ(0, SmolRTSP_UdpSender_pending(sender));
+    CHECK_CALL(recv_str(receivers[1], "jk"));
+
+    ASSERT_EQ(0, SmolRTSP_UdpSender_flush(sender));
+    ASSERT_EQ(0, SmolRTSP_UdpSender_errors(sender));
+
+    for (size_t i = 0; i < 2; i++) {
+        VCALL_SUPER(t[i], SmolRTSP_Droppable, drop);
+        close(receivers[i]);
+    }
+    VTABLE(SmolRTSP_UdpSender, SmolRTSP_Droppable).drop(sender);
+    close(fd);
+    PASS();
+}
+
+TEST oversized(void) {
+    struct sockaddr_in addr;
+    const int receiver_fd = receiver(&addr);
+    ASSERT(receiver_fd != -1);
+
+    const int fd = smolrtsp_shared_dgram_socket(AF_INET);
+    ASSERT(fd != -1);
+
+    SmolRTSP_UdpSender *sender = SmolRTSP_UdpSender_new(fd, 4, 4);
+    SmolRTSP_Transport t =
+        smolrtsp_transport_udp_sender(sender, (const struct sockaddr *)&addr);
+
+    errno = 0;
+    ASSERT_EQ(-1, transmit_str(t, "abcde"));
+    ASSERT_EQ(EMSGSIZE, errno);
+    ASSERT_EQ(0, SmolRTSP_UdpSender_pending(sender));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_UdpSender, SmolRTSP_Droppable).drop(sender);
+    close(fd);
+    close(receiver_fd);
+    PASS();
+}
+
+TEST unsupported_family(void) {
+    errno = 0;
+    ASSERT_EQ(-1, smolrtsp_shared_dgram_socket(AF_UNIX));
+    ASSERT_EQ(EAFNOSUPPORT, errno);
+
+    PASS();
+}
+
+SUITE(udp_sender) {
+    RUN_TEST(many_destinations);
+    RUN_TEST(oversized);
+    RUN_TEST(unsupported_family);
+}
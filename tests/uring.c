@@ -0,0 +1,180 @@
+#include <smolrtsp/uring.h>
+
+#include <greatest.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+static SmolRTSP_Uring *new_ring(size_t buffer_size, size_t buffers_count) {
+    SmolRTSP_UringConfig config = SmolRTSP_UringConfig_default();
+    config.entries = 4;
+    config.buffer_size = buffer_size;
+    config.buffers_count = buffers_count;
+
+    return SmolRTSP_Uring_new(config);
+}
+
+TEST check_transport(void) {
+    SmolRTSP_Uring *ring = new_ring(16, 8);
+    // io_uring can be disabled (e.g., in containers).
+    if (NULL == ring) {
+        SKIP();
+    }
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    SmolRTSP_Transport t = smolrtsp_transport_uring(ring, fds[0]);
+    ASSERT_EQ(16, VCALL(t, max_packet_size));
+
+    struct iovec bufs[] = {
+        {.iov_base = "abc", .iov_len = 3},
+        {.iov_base = "defg", .iov_len = 4},
+    };
+    struct iovec bufs_1[] = {{.iov_base = "xyz", .iov_len = 3}};
+
+    ASSERT_EQ(
+        0, VCALL(
+               t, transmit, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs)));
+
+    SmolRTSP_IoVecSlice packets[] = {
+        Slice99_typed_from_array(bufs_1),
+        Slice99_typed_from_array(bufs_1),
+    };
+    ASSERT_EQ(
+        2, VCALL(
+               t, transmit_batch,
+               (SmolRTSP_IoVecBatch)Slice99_typed_from_array(packets)));
+    ASSERT_EQ(3, SmolRTSP_Uring_in_flight(ring));
+
+    // Nothing is sent before the submission.
+    char buffer[32];
+    ASSERT_EQ(-1, recv(fds[1], buffer, sizeof buffer, MSG_DONTWAIT));
+    ASSERT_EQ(EAGAIN, errno);
+
+    ASSERT_EQ(3, SmolRTSP_Uring_submit(ring));
+    ASSERT_EQ(0, SmolRTSP_Uring_drain(ring));
+    ASSERT_EQ(0, SmolRTSP_Uring_in_flight(ring));
+    ASSERT_EQ(0, SmolRTSP_Uring_errors(ring));
+
+    ASSERT_EQ(7, read(fds[1], buffer, sizeof buffer));
+    ASSERT_MEM_EQ("abcdefg", buffer, 7);
+    ASSERT_EQ(3, read(fds[1], buffer, sizeof buffer));
+    ASSERT_MEM_EQ("xyz", buffer, 3);
+    ASSERT_EQ(3, read(fds[1], buffer, sizeof buffer));
+
+    struct iovec oversized[] = {
+        {.iov_base = "0123456789abcdefg", .iov_len = 17},
+    };
+    errno = 0;
+    ASSERT_EQ(
+        -1, VCALL(
+                t, transmit,
+                (SmolRTSP_IoVecSlice)Slice99_typed_from_array(oversized)));
+    ASSERT_EQ(EMSGSIZE, errno);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_Uring, SmolRTSP_Droppable).drop(ring);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_transport_full(void) {
+    SmolRTSP_Uring *ring = new_ring(16, 2);
+    // io_uring can be disabled (e.g., in containers).
+    if (NULL == ring) {
+        SKIP();
+    }
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    SmolRTSP_Transport t = smolrtsp_transport_uring(ring, fds[0]);
+
+    struct iovec bufs[] = {{.iov_base = "abc", .iov_len = 3}};
+    const SmolRTSP_IoVecSlice packet = Slice99_typed_from_array(bufs);
+
+    ASSERT_EQ(0, VCALL(t, transmit, packet));
+    ASSERT_EQ(0, VCALL(t, transmit, packet));
+    ASSERT(VCALL(t, is_full));
+
+    errno = 0;
+    ASSERT_EQ(-1, VCALL(t, transmit, packet));
+    ASSERT_EQ(ENOBUFS, errno);
+
+    // The buffers are reused once their writes complete.
+    ASSERT_EQ(0, SmolRTSP_Uring_drain(ring));
+    ASSERT(!VCALL(t, is_full));
+    ASSERT_EQ(0, VCALL(t, transmit, packet));
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_Uring, SmolRTSP_Droppable).drop(ring);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+TEST check_writer(void) {
+    SmolRTSP_Uring *ring = new_ring(16, 8);
+    // io_uring can be disabled (e.g., in containers).
+    if (NULL == ring) {
+        SKIP();
+    }
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    SmolRTSP_UringWriter *writer = SmolRTSP_UringWriter_new(ring, fds[0]);
+    SmolRTSP_Writer w = smolrtsp_uring_writer(writer);
+
+    // The second write is larger than a buffer and goes after the first one,
+    // which is in flight by then.
+    static const char long_str[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    ASSERT_EQ(3, VCALL(w, write, CharSlice99_from_str("abc")));
+    ASSERT_EQ(36, VCALL(w, write, CharSlice99_from_str((char *)long_str)));
+    ASSERT_EQ(4, VCALL(w, writef, "%d", 1234));
+    ASSERT_EQ(43, VCALL(w, filled));
+
+    ASSERT_EQ(1, SmolRTSP_Uring_submit(ring));
+    ASSERT_EQ(0, SmolRTSP_Uring_drain(ring));
+    ASSERT_EQ(0, VCALL(w, filled));
+    ASSERT_EQ(0, SmolRTSP_Uring_in_flight(ring));
+
+    char buffer[64];
+    size_t received = 0;
+    while (received < 43) {
+        const ssize_t n = read(fds[1], buffer + received, 43 - received);
+        ASSERT(n > 0);
+        received += (size_t)n;
+    }
+    ASSERT_MEM_EQ("abc0123456789abcdefghijklmnopqrstuvwxyz1234", buffer, 43);
+
+    // A write that needs more buffers than there are is rejected as a whole.
+    char huge[16 * 8 + 1];
+    memset(huge, 'x', sizeof huge);
+    errno = 0;
+    ASSERT_EQ(-1, VCALL(w, write, CharSlice99_new(huge, sizeof huge)));
+    ASSERT_EQ(ENOBUFS, errno);
+    ASSERT_EQ(0, VCALL(w, filled));
+    ASSERT_EQ(0, SmolRTSP_Uring_in_flight(ring));
+
+    VTABLE(SmolRTSP_UringWriter, SmolRTSP_Droppable).drop(writer);
+    VTABLE(SmolRTSP_Uring, SmolRTSP_Droppable).drop(ring);
+
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+SUITE(uring) {
+    RUN_TEST(check_transport);
+    RUN_TEST(check_transport_full);
+    RUN_TEST(check_writer);
+}
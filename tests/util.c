@@ -65,6 +65,14 @@ TEST parse_transport_minimal(void) {
         smolrtsp_parse_transport(&config, CharSlice99_from_str("RTP/AVP/UDP"));
     ASSERT_EQ(0, ret);
     ASSERT_EQ(SmolRTSP_LowerTransport_UDP, config.lower);
+    ASSERT(!config.secure);
+    CHECK_REST;
+
+    ret = smolrtsp_parse_transport(
+        &config, CharSlice99_from_str("RTP/SAVP/TCP"));
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(SmolRTSP_LowerTransport_TCP, config.lower);
+    ASSERT(config.secure);
     CHECK_REST;
 
 #undef CHECK_REST
@@ -104,6 +112,129 @@ TEST parse_transport_trailing_semicolon(void) {
     PASS();
 }
 
+TEST parse_transport_out_of_range(void) {
+    SmolRTSP_TransportConfig config;
+
+    const char *invalid[] = {
+        "RTP/AVP/TCP;interleaved=0-256",
+        "RTP/AVP/TCP;interleaved=-1-0",
+        "RTP/AVP;client_port=3056-65536",
+        "RTP/AVP;client_port=3056-",
+        "RTP/AVP;client_port=65535",
+        "RTP/AVP;client_port=30x6-3057",
+        "RTP/AVP;ttl=256",
+        "RTP/AVP;ssrc=123456789",
+        "RTP/AVP;ssrc=XYZ",
+        "RTP/AVPF",
+        "",
+    };
+
+    for (size_t i = 0; i < SLICE99_ARRAY_LEN(invalid); i++) {
+        ASSERT_EQ(
+            -1, smolrtsp_parse_transport(
+                    &config, CharSlice99_from_str((char *)invalid[i])));
+    }
+
+    PASS();
+}
+
+TEST parse_transport_all_params(void) {
+    SmolRTSP_TransportConfig config;
+
+    int ret = smolrtsp_parse_transport(
+        &config, CharSlice99_from_str(
+                     "RTP/AVP;multicast;destination=224.2.0.1;source=10.0.0.1;"
+                     "ttl=16;port=3456-3457;server_port=6970;layers=2;"
+                     "ssrc=0A1b2C3d;mode=\"PLAY,RECORD\";append;x-foo=bar"));
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(SmolRTSP_LowerTransport_UDP, config.lower);
+    ASSERT(!config.unicast);
+    ASSERT(config.multicast);
+    ASSERT(config.append);
+    ASSERT(MATCHES(config.interleaved, SmolRTSP_ChannelPair_None));
+    ASSERT(MATCHES(config.client_port, SmolRTSP_PortPair_None));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("224.2.0.1"), config.destination));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("10.0.0.1"), config.source));
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("PLAY,RECORD"), config.mode));
+
+    match(config.port) {
+        of(SmolRTSP_PortPair_Some, val) {
+            ASSERT_EQ(3456, val->rtp_port);
+            ASSERT_EQ(3457, val->rtcp_port);
+        }
+        otherwise FAIL();
+    }
+
+    // A single port implies the next one for RTCP.
+    match(config.server_port) {
+        of(SmolRTSP_PortPair_Some, val) {
+            ASSERT_EQ(6970, val->rtp_port);
+            ASSERT_EQ(6971, val->rtcp_port);
+        }
+        otherwise FAIL();
+    }
+
+    match(config.ttl) {
+        of(SmolRTSP_U8_Some, val) ASSERT_EQ(16, *val);
+        otherwise FAIL();
+    }
+    match(config.layers) {
+        of(SmolRTSP_U32_Some, val) ASSERT_EQ(2, *val);
+        otherwise FAIL();
+    }
+    match(config.ssrc) {
+        of(SmolRTSP_U32_Some, val) ASSERT_EQ(0x0A1B2C3D, *val);
+        otherwise FAIL();
+    }
+
+    PASS();
+}
+
+TEST parse_transport_multiple_specs(void) {
+    CharSlice99 header_value = CharSlice99_from_str(
+        "rtp/avp/tcp;Interleaved=2-3;mode=\"PLAY,RECORD\" , "
+        "RTP/AVP;unicast;client_port=4588-4589");
+    SmolRTSP_TransportConfig config;
+
+    ASSERT_EQ(1, smolrtsp_parse_transport_next(&config, &header_value));
+    ASSERT_EQ(SmolRTSP_LowerTransport_TCP, config.lower);
+    ASSERT(CharSlice99_primitive_eq(
+        CharSlice99_from_str("PLAY,RECORD"), config.mode));
+    match(config.interleaved) {
+        of(SmolRTSP_ChannelPair_Some, val) {
+            ASSERT_EQ(2, val->rtp_channel);
+            ASSERT_EQ(3, val->rtcp_channel);
+        }
+        otherwise FAIL();
+    }
+
+    ASSERT_EQ(1, smolrtsp_parse_transport_next(&config, &header_value));
+    ASSERT_EQ(SmolRTSP_LowerTransport_UDP, config.lower);
+    ASSERT(config.unicast);
+    ASSERT(MATCHES(config.interleaved, SmolRTSP_ChannelPair_None));
+    match(config.client_port) {
+        of(SmolRTSP_PortPair_Some, val) {
+            ASSERT_EQ(4588, val->rtp_port);
+            ASSERT_EQ(4589, val->rtcp_port);
+        }
+        otherwise FAIL();
+    }
+
+    ASSERT_EQ(0, smolrtsp_parse_transport_next(&config, &header_value));
+
+    header_value = CharSlice99_from_str("RTP/AVP, RTP/SAVP, RTP/AVPF");
+    ASSERT_EQ(1, smolrtsp_parse_transport_next(&config, &header_value));
+    ASSERT(!config.secure);
+    ASSERT_EQ(1, smolrtsp_parse_transport_next(&config, &header_value));
+    ASSERT(config.secure);
+    ASSERT_EQ(-1, smolrtsp_parse_transport_next(&config, &header_value));
+
+    PASS();
+}
+
 TEST interleaved_header(void) {
     uint8_t channel_id = 123;
     uint16_t payload_len = 54321;
@@ -129,10 +260,57 @@ TEST parse_interleaved_header(void) {
     PASS();
 }
 
+static enum greatest_test_res check_npt_range(
+    const char *value, bool start_is_now, uint64_t start_ms, bool has_end,
+    uint64_t end_ms) {
+    SmolRTSP_NptRange range;
+    ASSERT_EQ(
+        0,
+        smolrtsp_parse_npt_range(&range, CharSlice99_from_str((char *)value)));
+
+    ASSERT_EQ(start_is_now, range.start_is_now);
+    ASSERT_EQ(start_ms, range.start_ms);
+    ASSERT_EQ(has_end, range.has_end);
+    ASSERT_EQ(end_ms, range.end_ms);
+
+    PASS();
+}
+
+TEST parse_npt_range(void) {
+    CHECK_CALL(check_npt_range("npt=0-", false, 0, false, 0));
+    CHECK_CALL(check_npt_range("npt=12.5-", false, 12500, false, 0));
+    CHECK_CALL(check_npt_range("npt = 1.2345-20", false, 1234, true, 20000));
+    CHECK_CALL(check_npt_range("npt=now-", true, 0, false, 0));
+    CHECK_CALL(check_npt_range("npt=-34.05", false, 0, true, 34050));
+    CHECK_CALL(check_npt_range(
+        "npt=1:02:03.5-25:00:00", false, 3723500, true, 90000000));
+    CHECK_CALL(check_npt_range(
+        "npt=10-;time=19970123T153600Z", false, 10000, false, 0));
+
+    const char *malformed[] = {
+        "", "npt=", "npt=-", "npt=10", "npt=a-", "npt=1:2-", "npt=1:60:00-",
+        "npt=1.x-", "npt=0-now", "smpte=10:07:00-10:07:33:05.01",
+        "clock=19961108T142300Z-",
+    };
+    for (size_t i = 0; i < sizeof malformed / sizeof malformed[0]; i++) {
+        SmolRTSP_NptRange range = {.start_ms = 123};
+        ASSERT_EQ(
+            -1, smolrtsp_parse_npt_range(
+                    &range, CharSlice99_from_str((char *)malformed[i])));
+        ASSERT_EQ(123, range.start_ms);
+    }
+
+    PASS();
+}
+
 SUITE(util) {
     RUN_TEST(parse_transport_config);
     RUN_TEST(parse_transport_minimal);
     RUN_TEST(parse_transport_trailing_semicolon);
+    RUN_TEST(parse_transport_out_of_range);
+    RUN_TEST(parse_transport_all_params);
+    RUN_TEST(parse_transport_multiple_specs);
     RUN_TEST(interleaved_header);
     RUN_TEST(parse_interleaved_header);
+    RUN_TEST(parse_npt_range);
 }
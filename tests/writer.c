@@ -2,6 +2,11 @@
 
 #include <greatest.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -30,6 +35,15 @@ TEST fd_writer(void) {
         ASSERT_STRN_EQ("123 abc !@#", buffer, ret);
     }
 
+    {
+        struct iovec vecs[] = {{"abc", 3}, {"", 0}, {"de", 2}};
+        ssize_t ret = smolrtsp_writev(
+            w, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(vecs));
+        ASSERT_EQ(5, ret);
+        read(fds[1], buffer, ret);
+        ASSERT_STRN_EQ("abcde", buffer, ret);
+    }
+
     close(fds[0]);
     close(fds[1]);
 
@@ -85,6 +99,19 @@ TEST string_writer(void) {
     PASS();
 }
 
+TEST writev_fallback(void) {
+    char buffer[32] = {0};
+    SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
+
+    struct iovec vecs[] = {{"abc", 3}, {"~", 1}, {"&* 123", 6}};
+    const ssize_t ret =
+        smolrtsp_writev(w, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(vecs));
+    ASSERT_EQ(10, ret);
+    ASSERT_STR_EQ("abc~&* 123", buffer);
+
+    PASS();
+}
+
 TEST write_slices(void) {
     char buffer[128] = {0};
     SmolRTSP_Writer w = smolrtsp_string_writer(buffer);
@@ -119,10 +146,299 @@ TEST write_slices_macro(void) {
     PASS();
 }
 
+TEST buffered_writer(void) {
+    char output[64] = {0};
+    char buffer[8];
+
+    SmolRTSP_BufferedWriter bw = SmolRTSP_BufferedWriter_new(
+        smolrtsp_string_writer(output), buffer, sizeof buffer);
+    SmolRTSP_Writer w = smolrtsp_buffered_writer(&bw);
+
+    {
+        ssize_t ret = VCALL(w, write, CharSlice99_from_str("abc"));
+        ASSERT_EQ(3, ret);
+        ASSERT_STR_EQ("", output);
+        ASSERT_EQ(3, VCALL(w, filled));
+    }
+
+    // Does not fit together with the null character, so "abc" is flushed
+    // first.
+    {
+        ssize_t ret = VCALL(w, writef, "%d", 12345);
+        ASSERT_EQ(5, ret);
+        ASSERT_STR_EQ("abc", output);
+        ASSERT_EQ(5, bw.len);
+    }
+
+    // Larger than the buffer, so is written right after the pending data.
+    {
+        ssize_t ret = VCALL(w, write, CharSlice99_from_str("0123456789"));
+        ASSERT_EQ(10, ret);
+        ASSERT_STR_EQ("abc123450123456789", output);
+        ASSERT_EQ(0, bw.len);
+    }
+
+    {
+        ssize_t ret = VCALL(w, writef, "%s", "too long for the buffer");
+        ASSERT_EQ(23, ret);
+        ASSERT_STR_EQ("abc123450123456789too long for the buffer", output);
+    }
+
+    {
+        struct iovec vecs[] = {{"x", 1}, {"", 0}, {"yz", 2}};
+        ssize_t ret = smolrtsp_writev(
+            w, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(vecs));
+        ASSERT_EQ(3, ret);
+        ASSERT_EQ(3, bw.len);
+    }
+
+    ssize_t ret = SmolRTSP_BufferedWriter_flush(&bw);
+    ASSERT_EQ(3, ret);
+    ASSERT_STR_EQ("abc123450123456789too long for the bufferxyz", output);
+
+    ret = SmolRTSP_BufferedWriter_flush(&bw);
+    ASSERT_EQ(0, ret);
+
+    PASS();
+}
+
+TEST write_uint(void) {
+    char output[64] = {0};
+
+    // Without `reserve`.
+    {
+        SmolRTSP_Writer w = smolrtsp_string_writer(output);
+        errno = 0;
+        ASSERT_EQ(NULL, VCALL(w, reserve, 1));
+        ASSERT_EQ(ENOSYS, errno);
+
+        ssize_t ret = smolrtsp_write_uint(w, 0);
+        ASSERT_EQ(1, ret);
+        ret = smolrtsp_write_uint(w, UINT64_MAX);
+        ASSERT_EQ(20, ret);
+        ASSERT_STR_EQ("018446744073709551615", output);
+    }
+
+    output[0] = '\0';
+
+    // Formatted right into the buffer.
+    {
+        char buffer[4];
+        SmolRTSP_BufferedWriter bw = SmolRTSP_BufferedWriter_new(
+            smolrtsp_string_writer(output), buffer, sizeof buffer);
+        SmolRTSP_Writer w = smolrtsp_buffered_writer(&bw);
+
+        ssize_t ret = smolrtsp_write_uint(w, 123);
+        ASSERT_EQ(3, ret);
+        ASSERT_EQ(3, bw.len);
+        ASSERT_MEM_EQ("123", buffer, 3);
+
+        ret = smolrtsp_write_uint(w, 4567);
+        ASSERT_EQ(4, ret);
+        ASSERT_STR_EQ("123", output);
+        ASSERT_MEM_EQ("4567", buffer, 4);
+
+        // Does not fit even into the empty buffer.
+        errno = 0;
+        ASSERT_EQ(NULL, VCALL(w, reserve, 5));
+        ASSERT_EQ(ENOBUFS, errno);
+        ASSERT_STR_EQ("1234567", output);
+
+        ret = smolrtsp_write_uint(w, 89012);
+        ASSERT_EQ(5, ret);
+        ASSERT_STR_EQ("123456789012", output);
+    }
+
+    PASS();
+}
+
+TEST string_buffer_writer(void) {
+    char buffer[16];
+    SmolRTSP_StringBuffer sb = SmolRTSP_StringBuffer_new(buffer, sizeof buffer);
+    SmolRTSP_Writer w = smolrtsp_string_buffer_writer(&sb);
+
+    {
+        ssize_t ret = VCALL(w, write, CharSlice99_from_str("abc"));
+        ASSERT_EQ(3, ret);
+        ret = VCALL(w, writef, "%d abc", 123);
+        ASSERT_EQ(7, ret);
+        ret = smolrtsp_write_uint(w, 45);
+        ASSERT_EQ(2, ret);
+        ASSERT_STR_EQ("abc123 abc45", buffer);
+        ASSERT_EQ(12, VCALL(w, filled));
+        ASSERT(!sb.truncated);
+    }
+
+    // 16 bytes minus the null character.
+    {
+        errno = 0;
+        ssize_t ret = VCALL(w, writef, "%s", "defgh");
+        ASSERT_EQ(-1, ret);
+        ASSERT_EQ(ENOBUFS, errno);
+        ASSERT(sb.truncated);
+        ASSERT_STR_EQ("abc123 abc45def", buffer);
+        ASSERT(CharSlice99_primitive_eq(
+            CharSlice99_from_str("abc123 abc45def"),
+            SmolRTSP_StringBuffer_as_slice(&sb)));
+
+        ret = VCALL(w, write, CharSlice99_from_str("x"));
+        ASSERT_EQ(-1, ret);
+        ASSERT_STR_EQ("abc123 abc45def", buffer);
+    }
+
+    sb = SmolRTSP_StringBuffer_new(buffer, 4);
+    {
+        errno = 0;
+        ssize_t ret = VCALL(w, write, CharSlice99_from_str("abcdef"));
+        ASSERT_EQ(-1, ret);
+        ASSERT_EQ(ENOBUFS, errno);
+        ASSERT_STR_EQ("abc", buffer);
+    }
+
+    PASS();
+}
+
+TEST fd_writer_filled(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+
+    SmolRTSP_Writer w = smolrtsp_fd_writer(&fds[0]);
+    ASSERT_EQ(0, VCALL(w, filled));
+
+    ssize_t ret = VCALL(w, write, CharSlice99_from_str("abc"));
+    ASSERT_EQ(3, ret);
+    ASSERT(VCALL(w, filled) > 0);
+
+    char buffer[3];
+    ret = read(fds[1], buffer, sizeof buffer);
+    ASSERT_EQ(3, ret);
+    ASSERT_EQ(0, VCALL(w, filled));
+
+    close(fds[0]);
+    close(fds[1]);
+
+    PASS();
+}
+
+TEST nonblocking_fd_writer(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+    const int flags = fcntl(fds[0], F_GETFL);
+    ASSERT_EQ(0, fcntl(fds[0], F_SETFL, flags | O_NONBLOCK));
+
+    char pending[64];
+    SmolRTSP_NonblockingFdWriter nbw =
+        SmolRTSP_NonblockingFdWriter_new(fds[0], pending, sizeof pending);
+    SmolRTSP_Writer w = smolrtsp_nonblocking_fd_writer(&nbw);
+
+    // Write 16-byte messages until the socket and the buffer are full.
+    enum { max_messages = 1 << 16, message_len = 16 };
+    size_t accepted = 0;
+    for (; accepted < max_messages; accepted++) {
+        char message[message_len];
+        memset(message, 'a' + accepted % 26, sizeof message);
+
+        const ssize_t ret =
+            VCALL(w, write, CharSlice99_new(message, sizeof message));
+        if (ret < 0) {
+            ASSERT(EAGAIN == errno || EWOULDBLOCK == errno);
+            break;
+        }
+        ASSERT_EQ(message_len, ret);
+    }
+
+    ASSERT(accepted < max_messages);
+    ASSERT(VCALL(w, filled) >= nbw.len);
+    ASSERT(VCALL(w, filled) > 0);
+
+    // Receive everything, flushing the pending data along the way. Every
+    // accepted message must arrive whole, in order.
+    size_t received = 0;
+    for (;;) {
+        char buffer[4096];
+        const ssize_t pending_n = SmolRTSP_NonblockingFdWriter_flush(&nbw);
+        ASSERT(pending_n >= 0);
+
+        const ssize_t ret = recv(fds[1], buffer, sizeof buffer, MSG_DONTWAIT);
+        if (ret <= 0) {
+            ASSERT_EQ(0, pending_n);
+            break;
+        }
+
+        for (ssize_t i = 0; i < ret; i++, received++) {
+            ASSERT_EQ((char)('a' + (received / message_len) % 26), buffer[i]);
+        }
+    }
+
+    ASSERT_EQ(accepted * message_len, received);
+    ASSERT_EQ(0, nbw.len);
+
+    // Works as usual once there is room again.
+    ssize_t ret = VCALL(w, writef, "%d", 123);
+    ASSERT_EQ(3, ret);
+
+    close(fds[0]);
+    close(fds[1]);
+
+    PASS();
+}
+
+TEST nonblocking_fd_writer_lazy(void) {
+    int fds[2];
+    const bool socketpair_ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+    ASSERT(socketpair_ok);
+    const int flags = fcntl(fds[0], F_GETFL);
+    ASSERT_EQ(0, fcntl(fds[0], F_SETFL, flags | O_NONBLOCK));
+
+    SmolRTSP_NonblockingFdWriter nbw =
+        SmolRTSP_NonblockingFdWriter_new_lazy(fds[0], 64);
+    SmolRTSP_Writer w = smolrtsp_nonblocking_fd_writer(&nbw);
+    ASSERT_EQ(NULL, nbw.buffer);
+
+    // What the kernel accepts at once needs no buffer.
+    ASSERT_EQ(3, VCALL(w, write, CharSlice99_from_str("abc")));
+    ASSERT_EQ(NULL, nbw.buffer);
+
+    char message[16] = {0};
+    while (0 == nbw.len) {
+        ASSERT_EQ(
+            (ssize_t)sizeof message,
+            VCALL(w, write, CharSlice99_new(message, sizeof message)));
+    }
+    ASSERT(nbw.buffer != NULL);
+
+    // The buffer is released once drained.
+    for (;;) {
+        char buffer[4096];
+        const ssize_t pending_n = SmolRTSP_NonblockingFdWriter_flush(&nbw);
+        ASSERT(pending_n >= 0);
+        if (0 == pending_n) {
+            break;
+        }
+        ASSERT(recv(fds[1], buffer, sizeof buffer, MSG_DONTWAIT) > 0);
+    }
+    ASSERT_EQ(NULL, nbw.buffer);
+
+    SmolRTSP_NonblockingFdWriter_release(&nbw);
+    close(fds[0]);
+    close(fds[1]);
+
+    PASS();
+}
+
 SUITE(writer) {
     RUN_TEST(fd_writer);
     RUN_TEST(file_writer);
     RUN_TEST(string_writer);
+    RUN_TEST(writev_fallback);
+    RUN_TEST(buffered_writer);
+    RUN_TEST(write_uint);
+    RUN_TEST(string_buffer_writer);
+    RUN_TEST(fd_writer_filled);
+    RUN_TEST(nonblocking_fd_writer);
+    RUN_TEST(nonblocking_fd_writer_lazy);
 
     RUN_TEST(write_slices);
     RUN_TEST(write_slices_macro);
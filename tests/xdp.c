@@ -0,0 +1,209 @@
+#include <smolrtsp/xdp.h>
+
+#include <greatest.h>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const SmolRTSP_XdpFlow flow = {
+    .src_mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01},
+    .dst_mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02},
+    .src_addr = {.s_addr = 0x0100000A}, // 10.0.0.1
+    .dst_addr = {.s_addr = 0x0200000A}, // 10.0.0.2
+    .src_port = 5004,
+    .dst_port = 6970,
+    .ttl = 0,
+    .dscp = 34,
+};
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+TEST check_headers(void) {
+    uint8_t frame[SMOLRTSP_XDP_HEADERS_SIZE];
+    smolrtsp_xdp_write_headers(&flow, 1200, frame);
+
+    ASSERT_MEM_EQ(flow.dst_mac, frame, 6);
+    ASSERT_MEM_EQ(flow.src_mac, frame + 6, 6);
+    ASSERT_EQ(0x0800, get_u16(frame + 12));
+
+    const uint8_t *ip = frame + 14;
+    ASSERT_EQ(0x45, ip[0]);
+    ASSERT_EQ(34 << 2, ip[1]);
+    ASSERT_EQ(20 + 8 + 1200, get_u16(ip + 2));
+    ASSERT_EQ(0x4000, get_u16(ip + 6));
+    ASSERT_EQ(64, ip[8]);
+    ASSERT_EQ(IPPROTO_UDP, ip[9]);
+    ASSERT_MEM_EQ(&flow.src_addr, ip + 12, 4);
+    ASSERT_MEM_EQ(&flow.dst_addr, ip + 16, 4);
+
+    // The one's complement sum of a valid header is 0xFFFF.
+    uint32_t sum = 0;
+    for (size_t i = 0; i < 20; i += 2) {
+        sum += get_u16(ip + i);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    ASSERT_EQ(0xFFFF, sum);
+
+    const uint8_t *udp = ip + 20;
+    ASSERT_EQ(5004, get_u16(udp));
+    ASSERT_EQ(6970, get_u16(udp + 2));
+    ASSERT_EQ(8 + 1200, get_u16(udp + 4));
+    ASSERT_EQ(0, get_u16(udp + 6));
+
+    PASS();
+}
+
+TEST no_interface(void) {
+    errno = 0;
+    ASSERT_EQ(
+        NULL,
+        SmolRTSP_Xdp_new(SmolRTSP_XdpConfig_default("smolrtsp-none")));
+    ASSERT_EQ(ENODEV, errno);
+
+    PASS();
+}
+
+TEST udp_fallback(void) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+
+    SmolRTSP_Transport t = smolrtsp_transport_xdp_or_udp(NULL, NULL, fds[0]);
+    ASSERT(t.self);
+
+    struct iovec bufs[] = {{.iov_base = "abc", .iov_len = 3}};
+    ASSERT_EQ(
+        0, VCALL(
+               t, transmit, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs)));
+
+    char buffer[8];
+    ASSERT_EQ(3, recv(fds[1], buffer, sizeof buffer, MSG_DONTWAIT));
+    ASSERT_MEM_EQ("abc", buffer, 3);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    close(fds[0]);
+    close(fds[1]);
+    PASS();
+}
+
+// Captures the frames leaving the loopback interface.
+static int capture_loopback(void) {
+    const int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+    if (-1 == fd) {
+        return -1;
+    }
+
+    const struct sockaddr_ll addr = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons(ETH_P_IP),
+        .sll_ifindex = (int)if_nametoindex("lo"),
+    };
+    const struct timeval timeout = {.tv_sec = 1};
+    if (bind(fd, (const struct sockaddr *)&addr, sizeof addr) == -1 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) ==
+            -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+TEST loopback(void) {
+    SmolRTSP_XdpConfig config = SmolRTSP_XdpConfig_default("lo");
+    config.frames_count = 64;
+    config.ring_size = 32;
+
+    SmolRTSP_Xdp *xdp = SmolRTSP_Xdp_new(config);
+    // AF_XDP needs `CAP_NET_RAW` and a recent kernel.
+    if (NULL == xdp) {
+        SKIP();
+    }
+
+    const int capture = capture_loopback();
+    ASSERT(capture != -1);
+
+    // The loopback interface does not deliver the frames sent through
+    // AF_XDP to local sockets, so only check what leaves it.
+    const struct in_addr loopback_addr = {.s_addr = htonl(INADDR_LOOPBACK)};
+    const int fd = smolrtsp_dgram_socket(AF_INET, &loopback_addr, 6970);
+    ASSERT(fd != -1);
+
+    // The loopback interface has the null MAC address.
+    const uint8_t next_hop_mac[6] = {0};
+    SmolRTSP_Transport t = smolrtsp_transport_xdp_or_udp(xdp, next_hop_mac, fd);
+    ASSERT(t.self);
+    ASSERT(VCALL(t, max_packet_size) > 0);
+
+    struct iovec bufs[] = {
+        {.iov_base = "abc", .iov_len = 3},
+        {.iov_base = "defg", .iov_len = 4},
+    };
+    ASSERT_EQ(
+        0, VCALL(
+               t, transmit, (SmolRTSP_IoVecSlice)Slice99_typed_from_array(bufs)));
+    ASSERT_EQ(1, SmolRTSP_Xdp_in_flight(xdp));
+    ASSERT_EQ(1, SmolRTSP_Xdp_submit(xdp));
+
+    struct sockaddr_in local;
+    socklen_t local_len = sizeof local;
+    ASSERT_EQ(0, getsockname(fd, (struct sockaddr *)&local, &local_len));
+
+    uint8_t expected[SMOLRTSP_XDP_HEADERS_SIZE + 7];
+    const SmolRTSP_XdpFlow loopback_flow = {
+        .src_addr = loopback_addr,
+        .dst_addr = loopback_addr,
+        .src_port = ntohs(local.sin_port),
+        .dst_port = 6970,
+    };
+    smolrtsp_xdp_write_headers(&loopback_flow, 7, expected);
+    memcpy(expected + SMOLRTSP_XDP_HEADERS_SIZE, "abcdefg", 7);
+
+    // Other traffic may pass through the interface meanwhile.
+    bool found = false;
+    for (int attempt = 0; attempt < 100 && !found; attempt++) {
+        uint8_t frame[128];
+        const ssize_t n = recv(capture, frame, sizeof frame, 0);
+        ASSERT(n != -1);
+        found = sizeof expected == (size_t)n &&
+                0 == memcmp(expected, frame, sizeof expected);
+    }
+    ASSERT(found);
+
+    // The kernel reports the completions asynchronously.
+    for (int attempt = 0; attempt < 100 && SmolRTSP_Xdp_in_flight(xdp) > 0;
+         attempt++) {
+        usleep(10000);
+        SmolRTSP_Xdp_reap(xdp);
+    }
+    ASSERT_EQ(0, SmolRTSP_Xdp_in_flight(xdp));
+    ASSERT_EQ(0, SmolRTSP_Xdp_invalid_descs(xdp));
+    ASSERT_EQ(1, VCALL(t, stats).packets);
+
+    VCALL_SUPER(t, SmolRTSP_Droppable, drop);
+    VTABLE(SmolRTSP_Xdp, SmolRTSP_Droppable).drop(xdp);
+    close(fd);
+    close(capture);
+    PASS();
+}
+
+SUITE(xdp) {
+    RUN_TEST(check_headers);
+    RUN_TEST(no_interface);
+    RUN_TEST(udp_fallback);
+    RUN_TEST(loopback);
+}